@@ -2687,6 +2687,10 @@ void os::pd_commit_memory_or_exit(char* addr, size_t size, bool exec,
   #define MADV_HUGEPAGE 14
 #endif
 
+#ifndef MADV_NOHUGEPAGE
+  #define MADV_NOHUGEPAGE 15
+#endif
+
 int os::Linux::commit_memory_impl(char* addr, size_t size,
                                   size_t alignment_hint, bool exec) {
   int err = os::Linux::commit_memory_impl(addr, size, exec);
@@ -4189,6 +4193,20 @@ char* os::semeru_pd_attempt_reserve_memory_at(size_t bytes, char* requested_addr
 }
 
 
+/**
+ * Semeru
+ * 
+ * Let THP back the range, or keep it on 4KB pages, by the G1 Region type. -XX:+SemeruYoungHugePages.
+ * It only controls the new faults and khugepaged. The huge pages already there stay,
+ * the kernel splits a huge page when it swaps the page out to the memory servers.
+ * 
+ * We don't check the return value, the THP may be disabled by the kernel.
+ */
+void os::semeru_advise_huge_pages(char* addr, size_t bytes, bool huge) {
+	::madvise(addr, bytes, huge ? MADV_HUGEPAGE : MADV_NOHUGEPAGE);
+}
+
+
 
 
 
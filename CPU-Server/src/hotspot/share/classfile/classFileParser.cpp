@@ -3850,6 +3850,27 @@ class ClassFileParser::FieldLayoutInfo : public ResourceObj {
   bool          has_nonstatic_fields;
 };
 
+// Semeru - Is the instance field listed by SemeruColdFields, as pkg/Class.field or pkg/Class.* ?
+static bool is_semeru_cold_field(const Symbol* class_name, const Symbol* field_name) {
+  const char* p = SemeruColdFields;
+  while (*p != '\0') {
+    const char* end = strpbrk(p, ", \n");
+    if (end == NULL) {
+      end = p + strlen(p);
+    }
+    const char* dot = (const char*)memchr(p, '.', end - p);
+    if (dot != NULL && class_name->equals(p, (int)(dot - p))) {
+      const char* field = dot + 1;
+      const int len = (int)(end - field);
+      if ((len == 1 && *field == '*') || field_name->equals(field, len)) {
+        return true;
+      }
+    }
+    p = (*end == '\0') ? end : end + 1;
+  }
+  return false;
+}
+
 // Layout fields and fill in FieldLayoutInfo.  Could use more refactoring!
 void ClassFileParser::layout_fields(ConstantPool* cp,
                                     const FieldAllocationCount* fac,
@@ -3879,6 +3900,25 @@ void ClassFileParser::layout_fields(ConstantPool* cp,
     }
   }
 
+  // Semeru - Count the cold instance fields by type, they are laid out after all the others.
+  // Left to the defaults for the boot classes, some have hard-coded offsets, and for the contended ones.
+  int nonstatic_cold_count = 0;
+  FieldAllocationCount fac_cold;
+  ResourceBitMap cold_fields;
+  if (SemeruColdFields[0] != '\0' && _loader_data->class_loader() != NULL &&
+      nonstatic_contended_count == 0 && !parsed_annotations->is_contended()) {
+    cold_fields.initialize(_fields->length());
+    for (AllFieldStream fs(_fields, cp); !fs.done(); fs.next()) {
+      if (fs.access_flags().is_static()) continue;
+
+      if (is_semeru_cold_field(_class_name, fs.name())) {
+        cold_fields.set_bit(fs.index());
+        fac_cold.count[fs.allocation_type()]++;
+        nonstatic_cold_count++;
+      }
+    }
+  }
+
 
   // Calculate the starting byte offsets
   int next_static_oop_offset    = InstanceMirrorKlass::offset_of_static_fields();
@@ -3910,12 +3950,12 @@ void ClassFileParser::layout_fields(ConstantPool* cp,
   // Compute the non-contended fields count.
   // The packing code below relies on these counts to determine if some field
   // can be squeezed into the alignment gap. Contended fields are obviously
-  // exempt from that.
-  unsigned int nonstatic_double_count = fac->count[NONSTATIC_DOUBLE] - fac_contended.count[NONSTATIC_DOUBLE];
-  unsigned int nonstatic_word_count   = fac->count[NONSTATIC_WORD]   - fac_contended.count[NONSTATIC_WORD];
-  unsigned int nonstatic_short_count  = fac->count[NONSTATIC_SHORT]  - fac_contended.count[NONSTATIC_SHORT];
-  unsigned int nonstatic_byte_count   = fac->count[NONSTATIC_BYTE]   - fac_contended.count[NONSTATIC_BYTE];
-  unsigned int nonstatic_oop_count    = fac->count[NONSTATIC_OOP]    - fac_contended.count[NONSTATIC_OOP];
+  // exempt from that, and so are the Semeru cold fields.
+  unsigned int nonstatic_double_count = fac->count[NONSTATIC_DOUBLE] - fac_contended.count[NONSTATIC_DOUBLE] - fac_cold.count[NONSTATIC_DOUBLE];
+  unsigned int nonstatic_word_count   = fac->count[NONSTATIC_WORD]   - fac_contended.count[NONSTATIC_WORD]   - fac_cold.count[NONSTATIC_WORD];
+  unsigned int nonstatic_short_count  = fac->count[NONSTATIC_SHORT]  - fac_contended.count[NONSTATIC_SHORT]  - fac_cold.count[NONSTATIC_SHORT];
+  unsigned int nonstatic_byte_count   = fac->count[NONSTATIC_BYTE]   - fac_contended.count[NONSTATIC_BYTE]   - fac_cold.count[NONSTATIC_BYTE];
+  unsigned int nonstatic_oop_count    = fac->count[NONSTATIC_OOP]    - fac_contended.count[NONSTATIC_OOP]    - fac_cold.count[NONSTATIC_OOP];
 
   // Total non-static fields count, including every contended field
   unsigned int nonstatic_fields_count = fac->count[NONSTATIC_DOUBLE] + fac->count[NONSTATIC_WORD] +
@@ -4093,6 +4133,9 @@ void ClassFileParser::layout_fields(ConstantPool* cp,
     // contended instance fields are handled below
     if (fs.is_contended() && !fs.access_flags().is_static()) continue;
 
+    // so are the Semeru cold ones
+    if (nonstatic_cold_count > 0 && cold_fields.at(fs.index())) continue;
+
     int real_offset = 0;
     const FieldAllocationType atype = (const FieldAllocationType) fs.allocation_type();
 
@@ -4188,6 +4231,63 @@ void ClassFileParser::layout_fields(ConstantPool* cp,
     fs.set_offset(real_offset);
   }
 
+  // Semeru - The cold fields go after all the other instance fields of the class.
+  // Largest first, so they need no gap between them. An object whose cold fields
+  // are never touched keeps its hot ones in fewer cache lines and pages.
+  if (nonstatic_cold_count > 0) {
+    static const FieldAllocationType cold_order[] = {
+      NONSTATIC_DOUBLE, NONSTATIC_OOP, NONSTATIC_WORD, NONSTATIC_SHORT, NONSTATIC_BYTE
+    };
+
+    for (size_t i = 0; i < ARRAY_SIZE(cold_order); i++) {
+      if (fac_cold.count[cold_order[i]] == 0) continue;
+
+      for (AllFieldStream fs(_fields, cp); !fs.done(); fs.next()) {
+        if (fs.is_offset_set() || !cold_fields.at(fs.index())) continue;
+        if ((FieldAllocationType) fs.allocation_type() != cold_order[i]) continue;
+
+        int size = 0;
+        switch (cold_order[i]) {
+          case NONSTATIC_DOUBLE: size = BytesPerLong;  break;
+          case NONSTATIC_OOP:    size = heapOopSize;   break;
+          case NONSTATIC_WORD:   size = BytesPerInt;   break;
+          case NONSTATIC_SHORT:  size = BytesPerShort; break;
+          case NONSTATIC_BYTE:   size = 1;             break;
+          default:
+            ShouldNotReachHere();
+        }
+
+        next_nonstatic_padded_offset = align_up(next_nonstatic_padded_offset, size);
+        const int real_offset = next_nonstatic_padded_offset;
+        next_nonstatic_padded_offset += size;
+
+        if (cold_order[i] == NONSTATIC_OOP) {
+          // Record this oop in the oop maps
+          if( nonstatic_oop_map_count > 0 &&
+              nonstatic_oop_offsets[nonstatic_oop_map_count - 1] ==
+              real_offset -
+              int(nonstatic_oop_counts[nonstatic_oop_map_count - 1]) *
+              heapOopSize ) {
+            // This oop is adjacent to the previous one, add to current oop map
+            assert(nonstatic_oop_map_count - 1 < max_nonstatic_oop_maps, "range check");
+            nonstatic_oop_counts[nonstatic_oop_map_count - 1] += 1;
+          } else {
+            // This oop is not adjacent to the previous one, create new oop map
+            assert(nonstatic_oop_map_count < max_nonstatic_oop_maps, "range check");
+            nonstatic_oop_offsets[nonstatic_oop_map_count] = real_offset;
+            nonstatic_oop_counts [nonstatic_oop_map_count] = 1;
+            nonstatic_oop_map_count += 1;
+            if( first_nonstatic_oop_offset == 0 ) { // Undefined
+              first_nonstatic_oop_offset = real_offset;
+            }
+          }
+        }
+
+        fs.set_offset(real_offset);
+      }
+    }
+  }
+
 
   // Handle the contended cases.
   //
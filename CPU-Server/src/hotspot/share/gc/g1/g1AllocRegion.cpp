@@ -355,6 +355,12 @@ void G1GCAllocRegion::retire_region(HeapRegion* alloc_region,
   _g1h->retire_gc_alloc_region(alloc_region, allocated_bytes, _purpose);
 }
 
+void ColdOldGCAllocRegion::retire_region(HeapRegion* alloc_region,
+                                         size_t allocated_bytes) {
+  G1GCAllocRegion::retire_region(alloc_region, allocated_bytes);
+  _g1h->note_cold_region_retired(alloc_region);
+}
+
 size_t G1GCAllocRegion::retire(bool fill_up) {
   HeapRegion* retired = get();
   size_t end_waste = G1AllocRegion::retire(fill_up);
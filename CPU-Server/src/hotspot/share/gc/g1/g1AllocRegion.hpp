@@ -281,4 +281,15 @@ public:
   virtual HeapRegion* release();
 };
 
+// Semeru, the cold old Regions are recorded at retirement, the heap evicts them as a whole
+// after the pause, -XX:+SemeruBulkEvictColdRegions.
+class ColdOldGCAllocRegion : public OldGCAllocRegion {
+protected:
+  virtual void retire_region(HeapRegion* alloc_region, size_t allocated_bytes);
+
+public:
+  ColdOldGCAllocRegion(G1EvacStats* stats)
+  : OldGCAllocRegion(stats) { }
+};
+
 #endif // SHARE_VM_GC_G1_G1ALLOCREGION_HPP
@@ -40,6 +40,8 @@ G1Allocator::G1Allocator(G1CollectedHeap* heap) :
   _mutator_alloc_region(),
   _survivor_gc_alloc_region(heap->alloc_buffer_stats(InCSetState::Young)),
   _old_gc_alloc_region(heap->alloc_buffer_stats(InCSetState::Old)),
+  _cold_old_gc_alloc_region(heap->alloc_buffer_stats(InCSetState::Old)),
+  _cold_old_is_full(false),
   _retained_old_gc_alloc_region(NULL) {
 }
 
@@ -99,9 +101,11 @@ void G1Allocator::init_gc_alloc_regions(EvacuationInfo& evacuation_info) {
 
   _survivor_is_full = false;
   _old_is_full = false;
+  _cold_old_is_full = false;
 
   _survivor_gc_alloc_region.init();
   _old_gc_alloc_region.init();
+  _cold_old_gc_alloc_region.init();
   reuse_retained_old_region(evacuation_info,
                             &_old_gc_alloc_region,
                             &_retained_old_gc_alloc_region);
@@ -109,8 +113,11 @@ void G1Allocator::init_gc_alloc_regions(EvacuationInfo& evacuation_info) {
 
 void G1Allocator::release_gc_alloc_regions(EvacuationInfo& evacuation_info) {
   evacuation_info.set_allocation_regions(survivor_gc_alloc_region()->count() +
-                                         old_gc_alloc_region()->count());
+                                         old_gc_alloc_region()->count() +
+                                         cold_old_gc_alloc_region()->count());
   survivor_gc_alloc_region()->release();
+  // The cold Region is retired into the old set, new old objects are hot.
+  cold_old_gc_alloc_region()->release();
   // If we have an old GC alloc region to release, we'll save it in
   // _retained_old_gc_alloc_region. If we don't
   // _retained_old_gc_alloc_region will become NULL. This is what we
@@ -122,6 +129,7 @@ void G1Allocator::release_gc_alloc_regions(EvacuationInfo& evacuation_info) {
 void G1Allocator::abandon_gc_alloc_regions() {
   assert(survivor_gc_alloc_region()->get() == NULL, "pre-condition");
   assert(old_gc_alloc_region()->get() == NULL, "pre-condition");
+  assert(cold_old_gc_alloc_region()->get() == NULL, "pre-condition");
   _retained_old_gc_alloc_region = NULL;
 }
 
@@ -165,9 +173,10 @@ size_t G1Allocator::used_in_alloc_regions() {
 
 
 HeapWord* G1Allocator::par_allocate_during_gc(InCSetState dest,
-                                              size_t word_size) {
+                                              size_t word_size,
+                                              bool cold) {
   size_t temp = 0;
-  HeapWord* result = par_allocate_during_gc(dest, word_size, word_size, &temp);
+  HeapWord* result = par_allocate_during_gc(dest, word_size, word_size, &temp, cold);
   assert(result == NULL || temp == word_size,
          "Requested " SIZE_FORMAT " words, but got " SIZE_FORMAT " at " PTR_FORMAT,
          word_size, temp, p2i(result));
@@ -177,11 +186,16 @@ HeapWord* G1Allocator::par_allocate_during_gc(InCSetState dest,
 HeapWord* G1Allocator::par_allocate_during_gc(InCSetState dest,
                                               size_t min_word_size,
                                               size_t desired_word_size,
-                                              size_t* actual_word_size) {
+                                              size_t* actual_word_size,
+                                              bool cold) {
   switch (dest.value()) {
     case InCSetState::Young:
+      assert(!cold, "Only the old objects are cold");
       return survivor_attempt_allocation(min_word_size, desired_word_size, actual_word_size);
     case InCSetState::Old:
+      if (cold) {
+        return cold_old_attempt_allocation(min_word_size, desired_word_size, actual_word_size);
+      }
       return old_attempt_allocation(min_word_size, desired_word_size, actual_word_size);
     default:
       ShouldNotReachHere();
@@ -234,6 +248,28 @@ HeapWord* G1Allocator::old_attempt_allocation(size_t min_word_size,
   return result;
 }
 
+// A failure only stops the cold allocation, the object falls back to the old alloc region.
+HeapWord* G1Allocator::cold_old_attempt_allocation(size_t min_word_size,
+                                                   size_t desired_word_size,
+                                                   size_t* actual_word_size) {
+  assert(!_g1h->is_humongous(desired_word_size),
+         "we should not be seeing humongous-size allocations in this path");
+
+  HeapWord* result = cold_old_gc_alloc_region()->attempt_allocation(min_word_size,
+                                                                    desired_word_size,
+                                                                    actual_word_size);
+  if (result == NULL && !_cold_old_is_full) {
+    MutexLockerEx x(FreeList_lock, Mutex::_no_safepoint_check_flag);
+    result = cold_old_gc_alloc_region()->attempt_allocation_locked(min_word_size,
+                                                                   desired_word_size,
+                                                                   actual_word_size);
+    if (result == NULL) {
+      _cold_old_is_full = true;
+    }
+  }
+  return result;
+}
+
 uint G1PLABAllocator::calc_survivor_alignment_bytes() {
   assert(SurvivorAlignmentInBytes >= ObjectAlignmentInBytes, "sanity");
   if (SurvivorAlignmentInBytes == ObjectAlignmentInBytes) {
@@ -251,6 +287,7 @@ G1PLABAllocator::G1PLABAllocator(G1Allocator* allocator) :
   _allocator(allocator),
   _surviving_alloc_buffer(_g1h->desired_plab_sz(InCSetState::Young)),
   _tenured_alloc_buffer(_g1h->desired_plab_sz(InCSetState::Old)),
+  _cold_tenured_alloc_buffer(_g1h->desired_plab_sz(InCSetState::Old)),
   _survivor_alignment_bytes(calc_survivor_alignment_bytes()) {
   for (uint state = 0; state < InCSetState::Num; state++) {
     _direct_allocated[state] = 0;
@@ -266,7 +303,8 @@ bool G1PLABAllocator::may_throw_away_buffer(size_t const allocation_word_sz, siz
 
 HeapWord* G1PLABAllocator::allocate_direct_or_new_plab(InCSetState dest,
                                                        size_t word_sz,
-                                                       bool* plab_refill_failed) {
+                                                       bool* plab_refill_failed,
+                                                       bool cold) {
   size_t plab_word_size = _g1h->desired_plab_sz(dest);
   size_t required_in_plab = PLAB::size_required_for_allocation(word_sz);
 
@@ -275,14 +313,15 @@ HeapWord* G1PLABAllocator::allocate_direct_or_new_plab(InCSetState dest,
   if ((required_in_plab <= plab_word_size) &&
     may_throw_away_buffer(required_in_plab, plab_word_size)) {
 
-    PLAB* alloc_buf = alloc_buffer(dest);
+    PLAB* alloc_buf = alloc_buffer(dest, cold);
     alloc_buf->retire();
 
     size_t actual_plab_size = 0;
     HeapWord* buf = _allocator->par_allocate_during_gc(dest,
                                                        required_in_plab,
                                                        plab_word_size,
-                                                       &actual_plab_size);
+                                                       &actual_plab_size,
+                                                       cold);
 
     assert(buf == NULL || ((actual_plab_size >= required_in_plab) && (actual_plab_size <= plab_word_size)),
            "Requested at minimum " SIZE_FORMAT ", desired " SIZE_FORMAT " words, but got " SIZE_FORMAT " at " PTR_FORMAT,
@@ -301,15 +340,15 @@ HeapWord* G1PLABAllocator::allocate_direct_or_new_plab(InCSetState dest,
     *plab_refill_failed = true;
   }
   // Try direct allocation.
-  HeapWord* result = _allocator->par_allocate_during_gc(dest, word_sz);
+  HeapWord* result = _allocator->par_allocate_during_gc(dest, word_sz, cold);
   if (result != NULL) {
     _direct_allocated[dest.value()] += word_sz;
   }
   return result;
 }
 
-void G1PLABAllocator::undo_allocation(InCSetState dest, HeapWord* obj, size_t word_sz) {
-  alloc_buffer(dest)->undo_allocation(obj, word_sz);
+void G1PLABAllocator::undo_allocation(InCSetState dest, HeapWord* obj, size_t word_sz, bool cold) {
+  alloc_buffer(dest, cold)->undo_allocation(obj, word_sz);
 }
 
 void G1PLABAllocator::flush_and_retire_stats() {
@@ -322,6 +361,7 @@ void G1PLABAllocator::flush_and_retire_stats() {
       _direct_allocated[state] = 0;
     }
   }
+  _cold_tenured_alloc_buffer.flush_and_retire_stats(_g1h->alloc_buffer_stats(InCSetState::Old));
 }
 
 void G1PLABAllocator::waste(size_t& wasted, size_t& undo_wasted) {
@@ -334,6 +374,8 @@ void G1PLABAllocator::waste(size_t& wasted, size_t& undo_wasted) {
       undo_wasted += buf->undo_waste();
     }
   }
+  wasted += _cold_tenured_alloc_buffer.waste();
+  undo_wasted += _cold_tenured_alloc_buffer.undo_waste();
 }
 
 bool G1ArchiveAllocator::_archive_check_enabled = false;
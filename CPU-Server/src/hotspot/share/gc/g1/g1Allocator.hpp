@@ -55,6 +55,11 @@ private:
   // old objects.
   OldGCAllocRegion _old_gc_alloc_region;
 
+  // Semeru, alloc region used for the old objects swapped out at the pause start,
+  // -XX:+SemeruColdEvacuation. Never retained, the next pause starts a new one.
+  ColdOldGCAllocRegion _cold_old_gc_alloc_region;
+  bool _cold_old_is_full;
+
   HeapRegion* _retained_old_gc_alloc_region;
 
   bool survivor_is_full() const;
@@ -71,6 +76,7 @@ private:
   inline MutatorAllocRegion* mutator_alloc_region();
   inline SurvivorGCAllocRegion* survivor_gc_alloc_region();
   inline OldGCAllocRegion* old_gc_alloc_region();
+  inline ColdOldGCAllocRegion* cold_old_gc_alloc_region();
 
   // Allocation attempt during GC for a survivor object / PLAB.
   HeapWord* survivor_attempt_allocation(size_t min_word_size,
@@ -81,6 +87,11 @@ private:
   HeapWord* old_attempt_allocation(size_t min_word_size,
                                           size_t desired_word_size,
                                           size_t* actual_word_size);
+
+  // Allocation attempt during GC for a cold old object / PLAB.
+  HeapWord* cold_old_attempt_allocation(size_t min_word_size,
+                                        size_t desired_word_size,
+                                        size_t* actual_word_size);
 public:
   G1Allocator(G1CollectedHeap* heap);
 
@@ -112,13 +123,16 @@ public:
   // allocation region, either by picking one or expanding the
   // heap, and then allocate a block of the given size. The block
   // may not be a humongous - it must fit into a single heap region.
+  // Cold is only valid for the Old dest, then the cold old alloc region is used.
   HeapWord* par_allocate_during_gc(InCSetState dest,
-                                   size_t word_size);
+                                   size_t word_size,
+                                   bool cold = false);
 
   HeapWord* par_allocate_during_gc(InCSetState dest,
                                    size_t min_word_size,
                                    size_t desired_word_size,
-                                   size_t* actual_word_size);
+                                   size_t* actual_word_size,
+                                   bool cold = false);
 };
 
 // Manages the PLABs used during garbage collection. Interface for allocation from PLABs.
@@ -132,6 +146,7 @@ private:
 
   PLAB  _surviving_alloc_buffer;
   PLAB  _tenured_alloc_buffer;
+  PLAB  _cold_tenured_alloc_buffer;   // Semeru, the cold Old dest
   PLAB* _alloc_buffers[InCSetState::Num];
 
   // The survivor alignment in effect in bytes.
@@ -145,7 +160,7 @@ private:
   size_t _direct_allocated[InCSetState::Num];
 
   void flush_and_retire_stats();
-  inline PLAB* alloc_buffer(InCSetState dest);
+  inline PLAB* alloc_buffer(InCSetState dest, bool cold = false);
 
   // Calculate the survivor space object alignment in bytes. Returns that or 0 if
   // there are no restrictions on survivor alignment.
@@ -161,20 +176,24 @@ public:
   // allocating a new PLAB. Returns the address of the allocated memory, NULL if
   // not successful. Plab_refill_failed indicates whether an attempt to refill the
   // PLAB failed or not.
+  // Cold selects the cold PLAB of the Old dest, -XX:+SemeruColdEvacuation.
   HeapWord* allocate_direct_or_new_plab(InCSetState dest,
                                         size_t word_sz,
-                                        bool* plab_refill_failed);
+                                        bool* plab_refill_failed,
+                                        bool cold = false);
 
   // Allocate word_sz words in the PLAB of dest.  Returns the address of the
   // allocated memory, NULL if not successful.
   inline HeapWord* plab_allocate(InCSetState dest,
-                                 size_t word_sz);
+                                 size_t word_sz,
+                                 bool cold = false);
 
   inline HeapWord* allocate(InCSetState dest,
                             size_t word_sz,
-                            bool* refill_failed);
+                            bool* refill_failed,
+                            bool cold = false);
 
-  void undo_allocation(InCSetState dest, HeapWord* obj, size_t word_sz);
+  void undo_allocation(InCSetState dest, HeapWord* obj, size_t word_sz, bool cold = false);
 };
 
 // G1ArchiveRegionMap is a boolean array used to mark G1 regions as
@@ -69,6 +69,14 @@ static double non_young_other_cost_per_region_ms_defaults[] = {
   1.0, 0.7, 0.7, 0.5, 0.5, 0.42, 0.42, 0.30
 };
 
+// Semeru, a 4KB RDMA read per fault, shared by the evacuation workers.
+static double semeru_swap_in_cost_per_page_ms_defaults[] = {
+  0.01, 0.005, 0.005, 0.0025, 0.0025, 0.0017, 0.0017, 0.0013
+};
+
+// Semeru, the control path flush is posted by the VM thread alone.
+static double semeru_flush_cost_per_page_ms = 0.002;
+
 G1Analytics::G1Analytics(const G1Predictions* predictor) :
     _predictor(predictor),
     _recent_gc_times_ms(new TruncatedSeq(NumPrevPausesForHeuristics)),
@@ -90,6 +98,8 @@ G1Analytics::G1Analytics(const G1Predictions* predictor) :
     _pending_cards_seq(new TruncatedSeq(TruncatedSeqLength)),
     _rs_lengths_seq(new TruncatedSeq(TruncatedSeqLength)),
     _cost_per_byte_ms_during_cm_seq(new TruncatedSeq(TruncatedSeqLength)),
+    _semeru_swap_in_cost_per_page_ms_seq(new TruncatedSeq(TruncatedSeqLength)),
+    _semeru_flush_cost_per_page_ms_seq(new TruncatedSeq(TruncatedSeqLength)),
     _recent_prev_end_times_for_all_gcs_sec(new TruncatedSeq(NumPrevPausesForHeuristics)),
     _recent_avg_pause_time_ratio(0.0),
     _last_pause_time_ratio(0.0) {
@@ -109,6 +119,8 @@ G1Analytics::G1Analytics(const G1Predictions* predictor) :
   _constant_other_time_ms_seq->add(constant_other_time_ms_defaults[index]);
   _young_other_cost_per_region_ms_seq->add(young_other_cost_per_region_ms_defaults[index]);
   _non_young_other_cost_per_region_ms_seq->add(non_young_other_cost_per_region_ms_defaults[index]);
+  _semeru_swap_in_cost_per_page_ms_seq->add(semeru_swap_in_cost_per_page_ms_defaults[index]);
+  _semeru_flush_cost_per_page_ms_seq->add(semeru_flush_cost_per_page_ms);
 
   // start conservatively (around 50ms is about right)
   _concurrent_mark_remark_times_ms->add(0.05);
@@ -214,6 +226,14 @@ void G1Analytics::report_rs_lengths(double rs_lengths) {
   _rs_lengths_seq->add(rs_lengths);
 }
 
+void G1Analytics::report_semeru_swap_in_cost_per_page_ms(double cost_per_page_ms) {
+  _semeru_swap_in_cost_per_page_ms_seq->add(cost_per_page_ms);
+}
+
+void G1Analytics::report_semeru_flush_cost_per_page_ms(double cost_per_page_ms) {
+  _semeru_flush_cost_per_page_ms_seq->add(cost_per_page_ms);
+}
+
 size_t G1Analytics::predict_rs_length_diff() const {
   return get_new_size_prediction(_rs_length_diff_seq);
 }
@@ -290,6 +310,14 @@ double G1Analytics::predict_cost_per_byte_ms() const {
   return get_new_prediction(_cost_per_byte_ms_seq);
 }
 
+double G1Analytics::predict_semeru_swap_in_cost_per_page_ms() const {
+  return get_new_prediction(_semeru_swap_in_cost_per_page_ms_seq);
+}
+
+double G1Analytics::predict_semeru_flush_cost_per_page_ms() const {
+  return get_new_prediction(_semeru_flush_cost_per_page_ms_seq);
+}
+
 double G1Analytics::predict_constant_other_time_ms() const {
   return get_new_prediction(_constant_other_time_ms_seq);
 }
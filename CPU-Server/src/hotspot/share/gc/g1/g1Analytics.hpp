@@ -62,6 +62,11 @@ class G1Analytics: public CHeapObj<mtGC> {
 
   TruncatedSeq* _cost_per_byte_ms_during_cm_seq;
 
+  // Semeru, the pages of the old Regions swapped out to the memory servers.
+  // Faulted in by the CPU server evacuation, or flushed with the memory server CSet.
+  TruncatedSeq* _semeru_swap_in_cost_per_page_ms_seq;
+  TruncatedSeq* _semeru_flush_cost_per_page_ms_seq;
+
   // Statistics kept per GC stoppage, pause or full.
   TruncatedSeq* _recent_prev_end_times_for_all_gcs_sec;
 
@@ -110,6 +115,8 @@ public:
   void report_constant_other_time_ms(double constant_other_time_ms);
   void report_pending_cards(double pending_cards);
   void report_rs_lengths(double rs_lengths);
+  void report_semeru_swap_in_cost_per_page_ms(double cost_per_page_ms);
+  void report_semeru_flush_cost_per_page_ms(double cost_per_page_ms);
 
   size_t predict_rs_length_diff() const;
 
@@ -151,6 +158,9 @@ public:
 
   double predict_cost_per_byte_ms() const;
 
+  double predict_semeru_swap_in_cost_per_page_ms() const;
+  double predict_semeru_flush_cost_per_page_ms() const;
+
   // Add a new GC of the given duration and end time to the record.
   void update_recent_gc_times(double end_time_sec, double elapsed_ms);
   void compute_pause_time_ratio(double interval_ms, double pause_time_ms);
@@ -153,6 +153,13 @@ void G1Arguments::initialize() {
   }
 #endif
 
+  // Semeru CPU - The objects of the Regions left to the memory servers aren't visited by the concurrent mark,
+  // their classes aren't known at the remark.
+  if (SemeruRemoteConcurrentMark && ClassUnloadingWithConcurrentMark) {
+    log_info(gc)("-XX:+SemeruRemoteConcurrentMark disables ClassUnloadingWithConcurrentMark");
+    FLAG_SET_ERGO(bool, ClassUnloadingWithConcurrentMark, false);
+  }
+
   initialize_verification_types();
 }
 
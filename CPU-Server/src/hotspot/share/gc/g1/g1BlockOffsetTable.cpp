@@ -447,6 +447,16 @@ HeapWord* G1BlockOffsetTablePart::initialize_threshold() {
   return _next_offset_threshold;
 }
 
+void G1BlockOffsetTablePart::set_threshold_at(HeapWord* top) {
+  assert(top >= _space->bottom() && top <= _space->end(), "top 0x%lx is out of the Region", (size_t)top);
+  size_t index = _bot->index_for_raw(top);
+  if (_bot->address_for_index_raw(index) < top) {
+    index++;
+  }
+  _next_offset_index     = index;
+  _next_offset_threshold = _bot->address_for_index_raw(index);
+}
+
 void G1BlockOffsetTablePart::set_for_starts_humongous(HeapWord* obj_top, size_t fill_size) {
   // The first BOT entry should have offset 0.
   reset_bot();
@@ -241,6 +241,10 @@ public:
   // updated.
   HeapWord* threshold() const { return _next_offset_threshold; }
 
+  // Semeru CPU - The memory server compacted the covered Region up to top, and rebuilt the entries below it.
+  // Continue the updates from the first boundary at or above top.
+  void set_threshold_at(HeapWord* top);
+
   //void alloc_existed_block_work(HeapWord* blk_start, HeapWord* blk_end);
 
   // These must be guaranteed to work properly (i.e., do nothing)
@@ -0,0 +1,227 @@
+/**
+ * Semeru CPU Server - the old Regions the concurrent mark leaves to their memory servers, -XX:+SemeruRemoteConcurrentMark.
+ *
+ */
+
+#include "precompiled.hpp"
+#include "gc/g1/g1CMRemoteRegions.hpp"
+#include "gc/g1/g1CollectedHeap.inline.hpp"
+#include "gc/g1/g1ConcurrentMark.inline.hpp"
+#include "gc/g1/heapRegion.inline.hpp"
+#include "logging/log.hpp"
+#include "oops/oop.inline.hpp"
+#include "runtime/os.hpp"
+#include "runtime/rdma_cp_comm.hpp"
+
+G1CMRemoteRegions::G1CMRemoteRegions(G1CollectedHeap* g1h, G1ConcurrentMark* cm) :
+  _g1h(g1h),
+  _cm(cm),
+  _max_regions(MIN2(g1h->max_regions(), (uint)SEMERU_MAX_REGIONS)),
+  _kept(NEW_C_HEAP_ARRAY(uint, _max_regions, mtGC)),
+  _num_kept(0) {
+  for (size_t mem_id = 0; mem_id < MAX_NUM_OF_MEMORY_SERVER; mem_id++) {
+    _failed[mem_id] = false;
+  }
+}
+
+G1CMRemoteRegions::~G1CMRemoteRegions() {
+  FREE_C_HEAP_ARRAY(uint, _kept);
+}
+
+/**
+ * Only a Region the memory server traced and holds completely, whose objects are all live and parsable
+ * without the prev bitmap. A Region marked from the roots of the initial mark pause is traced as usual,
+ * the Regions of the memory server CSet are left out, the memory server may be compacting them.
+ */
+bool G1CMRemoteRegions::is_candidate(HeapRegion* hr, const bool* in_mem_server_cset) const {
+  if (!hr->is_old() || hr->is_pinned() || hr->top() == hr->bottom() || in_mem_server_cset[hr->hrm_index()] ||
+      !hr->is_region_cm_scanned()) {
+    return false;
+  }
+  HeapWord* const ptams = hr->prev_top_at_mark_start();
+  if (ptams != hr->bottom() && hr->marked_bytes() != pointer_delta(ptams, hr->bottom()) * HeapWordSize) {
+    return false;
+  }
+  if (_cm->next_mark_bitmap()->get_next_marked_addr(hr->bottom(), hr->top()) < hr->top()) {
+    return false;
+  }
+  int const mem_id = hr->region_to_memory_server_mapping();
+  return mem_id >= 0 && (size_t)mem_id < SemeruMemServerNum &&
+         _g1h->swapped_out_pages(hr) == HeapRegion::GrainBytes/PAGE_SIZE;
+}
+
+// The card is written, write the header of the request and its sequence, on the same QP.
+bool G1CMRemoteRegions::post(int mem_id, uint32_t seq) {
+  remote_card_scan* scan = _g1h->remote_cards();
+  scan->_num_cards   = 1;
+  scan->_mode        = remote_card_scan::Refine;
+  scan->_request_seq = seq;
+  if (semeru_cp_write(mem_id, (void*)&scan->_num_cards, 2 * sizeof(uint32_t)) != 0 ||
+      semeru_cp_write(mem_id, (void*)&scan->_request_seq, sizeof(uint32_t)) != 0) {
+    log_warning(semeru,rdma)("%s, can't post the concurrent mark request to memory server[%d].", __func__, mem_id);
+    _failed[mem_id] = true;
+    return false;
+  }
+  _g1h->ring_mem_server_doorbell((size_t)mem_id);
+  return true;
+}
+
+bool G1CMRemoteRegions::receive(int mem_id, uint32_t seq) {
+  remote_card_scan* scan = _g1h->remote_cards();
+  jlong deadline = os::javaTimeMillis() + (jlong)SemeruRemoteConcurrentMarkTimeoutMs;
+  scan->_done_seq = seq - 1;   // the local copy may hold the reply of the previous memory server.
+  do {
+    if (semeru_cp_read(mem_id, (void*)&scan->_done_seq, remote_card_scan::reply_size()) == 0 &&
+        scan->_done_seq == seq) {
+      return true;
+    }
+    os::naked_short_sleep(1);
+  } while (os::javaTimeMillis() < deadline);
+
+  log_debug(gc, marking)("Semeru remote concurrent mark: memory server[%d] didn't reply, its Regions are scanned locally", mem_id);
+  _failed[mem_id] = true;
+  return false;
+}
+
+// The targets of the fields are marked as the referents of a root Region, the bitmap scan traces them.
+size_t G1CMRemoteRegions::mark_fields(const remote_card_scan::slot* slots, size_t num_slots, uint worker_id) {
+  size_t num_marked = 0;
+  for (size_t i = 0; i < num_slots; i++) {
+    HeapWord* addr = slots[i]._value;
+    if (!_g1h->is_in_g1_reserved(addr)) {
+      continue;
+    }
+    HeapRegion* hr = _g1h->heap_region_containing_or_null(addr);
+    if (hr == NULL || hr->is_free() || hr->is_continues_humongous() || addr >= hr->top()) {
+      continue;
+    }
+    if (_cm->mark_in_next_bitmap(worker_id, hr, oop(addr))) {
+      num_marked++;
+    }
+  }
+  return num_marked;
+}
+
+void G1CMRemoteRegions::select() {
+  assert_at_safepoint_on_vm_thread();
+  _num_kept = 0;
+  for (size_t mem_id = 0; mem_id < MAX_NUM_OF_MEMORY_SERVER; mem_id++) {
+    _failed[mem_id] = false;
+  }
+  if (_g1h->remote_cards() == NULL) {
+    return;
+  }
+
+  bool* in_mem_server_cset = NEW_C_HEAP_ARRAY(bool, _max_regions, mtGC);
+  memset(in_mem_server_cset, 0, _max_regions * sizeof(bool));
+  received_memory_server_cset* cset = _g1h->recv_mem_server_cset();
+  for (size_t mem_id = 0; mem_id < SemeruMemServerNum; mem_id++) {
+    size_t num_mem_cset = *(cset->num_received_regions(mem_id));
+    for (size_t i = 0; i < num_mem_cset; i++) {
+      uint index = cset->get(mem_id, i);
+      if (index < _max_regions) {
+        in_mem_server_cset[index] = true;
+      }
+    }
+  }
+
+  for (uint i = 0; i < _max_regions; i++) {
+    HeapRegion* hr = _g1h->region_at_or_null(i);
+    if (hr != NULL && is_candidate(hr, in_mem_server_cset)) {
+      hr->note_start_of_remote_marking();
+      _kept[_num_kept++] = i;
+    }
+  }
+  FREE_C_HEAP_ARRAY(bool, in_mem_server_cset);
+
+  log_debug(gc, marking)("Semeru remote concurrent mark: %u evicted Regions left to the memory servers", _num_kept);
+}
+
+/**
+ * One Region in flight per memory server, the same sequence for all of them in a round.
+ * An abort of the root Region scan, for a full GC, stops the rounds.
+ */
+void G1CMRemoteRegions::mark_roots(G1CMRootRegions* root_regions, uint worker_id) {
+  if (_num_kept == 0) {
+    return;
+  }
+  remote_card_scan* scan = _g1h->remote_cards();
+  jlong start = os::javaTimeMillis();
+
+  // The kept Regions of each memory server.
+  uint* regions[MAX_NUM_OF_MEMORY_SERVER];
+  uint  num_regions[MAX_NUM_OF_MEMORY_SERVER];
+  uint  next[MAX_NUM_OF_MEMORY_SERVER];
+  for (size_t mem_id = 0; mem_id < SemeruMemServerNum; mem_id++) {
+    regions[mem_id]     = NEW_C_HEAP_ARRAY(uint, _num_kept, mtGC);
+    num_regions[mem_id] = 0;
+    next[mem_id]        = 0;
+  }
+  for (uint k = 0; k < _num_kept; k++) {
+    int mem_id = _g1h->region_at(_kept[k])->region_to_memory_server_mapping();
+    regions[mem_id][num_regions[mem_id]++] = _kept[k];
+  }
+
+  size_t num_fields = 0;
+  size_t num_marked = 0;
+  uint   num_local  = 0;
+  bool more = true;
+  while (more && !root_regions->should_abort()) {
+    uint32_t seq = scan->_request_seq + 1;
+    int  requested[MAX_NUM_OF_MEMORY_SERVER];
+    bool posted[MAX_NUM_OF_MEMORY_SERVER];
+    more = false;
+
+    // 1) A Refine request of the whole Region, every field pointing out of it.
+    for (size_t mem_id = 0; mem_id < SemeruMemServerNum; mem_id++) {
+      requested[mem_id] = -1;
+      posted[mem_id]    = false;
+      if (next[mem_id] == num_regions[mem_id]) {
+        continue;
+      }
+      uint index = regions[mem_id][next[mem_id]++];
+      HeapRegion* hr = _g1h->region_at(index);
+      requested[mem_id] = (int)index;
+      more = true;
+      if (_failed[mem_id]) {
+        continue;
+      }
+      remote_card_scan::card* c = &scan->_cards[0];
+      c->_block = hr->bottom();
+      c->_start = hr->bottom();
+      c->_end   = hr->top();
+      if (semeru_cp_write((int)mem_id, (void*)c, sizeof(remote_card_scan::card)) != 0) {
+        _failed[mem_id] = true;
+        continue;
+      }
+      posted[mem_id] = post((int)mem_id, seq);
+    }
+
+    // 2) The targets of the replied fields are marked. Otherwise the Region is scanned here, from its bottom.
+    for (size_t mem_id = 0; mem_id < SemeruMemServerNum; mem_id++) {
+      if (requested[mem_id] < 0) {
+        continue;
+      }
+      if (posted[mem_id] && receive((int)mem_id, seq)) {
+        size_t num_slots = scan->_num_slots;
+        if (scan->_overflow == 0 && num_slots <= SEMERU_MAX_REMOTE_SLOTS &&
+            (num_slots == 0 ||
+             semeru_cp_read((int)mem_id, (void*)scan->_slots, num_slots * sizeof(remote_card_scan::slot)) == 0)) {
+          num_marked += mark_fields(scan->_slots, num_slots, worker_id);
+          num_fields += num_slots;
+          continue;
+        }
+      }
+      _cm->scan_root_region(_g1h->region_at((uint)requested[mem_id]), worker_id);
+      num_local++;
+    }
+  }
+
+  for (size_t mem_id = 0; mem_id < SemeruMemServerNum; mem_id++) {
+    FREE_C_HEAP_ARRAY(uint, regions[mem_id]);
+  }
+
+  log_info(gc, marking)("Semeru remote concurrent mark: %u of %u evicted Regions traced by the memory servers (%u scanned locally), "
+                        SIZE_FORMAT " fields, " SIZE_FORMAT " marked, " JLONG_FORMAT " ms",
+                        _num_kept - num_local, _num_kept, num_local, num_fields, num_marked, os::javaTimeMillis() - start);
+}
@@ -0,0 +1,65 @@
+/**
+ * Semeru CPU Server - the old Regions the concurrent mark leaves to their memory servers, -XX:+SemeruRemoteConcurrentMark.
+ *
+ */
+
+#ifndef SHARE_VM_GC_G1_G1CMREMOTEREGIONS_HPP
+#define SHARE_VM_GC_G1_G1CMREMOTEREGIONS_HPP
+
+#include "gc/shared/rdmaStructure.hpp"
+#include "memory/allocation.hpp"
+
+class G1CMRootRegions;
+class G1CollectedHeap;
+class G1ConcurrentMark;
+class HeapRegion;
+
+/**
+ * Semeru CPU - The concurrent mark traces every old Region below its nTAMS, so it swaps in the evicted ones,
+ * though their memory servers already traced them, _cm_scanned, and hold their complete content.
+ *
+ * A fully evicted old Region traced by its memory server is a black box for the concurrent mark instead.
+ * 1) select(), by the VM thread at the end of the initial mark pause. The nTAMS of the Region is set to its bottom,
+ *    every object of it is taken as live, as if allocated since the start of the marking. Nothing is marked in it,
+ *    nothing of it is pushed or scanned, the SATB entries into it are filtered out.
+ * 2) mark_roots(), by the concurrent mark thread before the root Regions are scanned. One Refine request of
+ *    [bottom, top) per Region through the remote_card_scan at REMOTE_CARD_SCAN_OFFSET, the memory servers reply
+ *    the fields pointing out of the Region. Their targets are marked, as the fields of a root Region.
+ *    A Region whose fields don't fit into a reply, or whose memory server doesn't reply in time, is scanned
+ *    locally as a root Region. The young pauses wait for the root Regions, the line isn't shared meanwhile.
+ * 3) At the end of the marking, the prev TAMS of the Region is its bottom. Its liveness stays the one the memory
+ *    server computed on its alive bitmap, the alive ratio of its MemoryToCPUAtGC, which selects it for the memory
+ *    server compaction. The CPU server neither rebuilds its remembered set nor evacuates it in the mixed pauses.
+ *
+ * The memory server walks every object of [bottom, top), only a Region without a dead object below its prev TAMS
+ * is left. The classes of the objects in the left Regions are not known here, see G1Arguments::initialize().
+ */
+class G1CMRemoteRegions : public CHeapObj<mtGC> {
+  G1CollectedHeap*  _g1h;
+  G1ConcurrentMark* _cm;
+  uint              _max_regions;
+  uint*             _kept;        // the Region indexes of this cycle
+  uint              _num_kept;
+
+  // A memory server without a reply in time isn't asked again within this cycle.
+  bool _failed[MAX_NUM_OF_MEMORY_SERVER];
+
+  bool is_candidate(HeapRegion* hr, const bool* in_mem_server_cset) const;
+  bool post(int mem_id, uint32_t seq);
+  bool receive(int mem_id, uint32_t seq);
+  size_t mark_fields(const remote_card_scan::slot* slots, size_t num_slots, uint worker_id);
+
+public:
+  G1CMRemoteRegions(G1CollectedHeap* g1h, G1ConcurrentMark* cm);
+  ~G1CMRemoteRegions();
+
+  // By the VM thread, at the initial mark pause after the evacuation.
+  void select();
+
+  // By the concurrent mark thread, before the root Regions are scanned.
+  void mark_roots(G1CMRootRegions* root_regions, uint worker_id);
+
+  uint num_kept() const { return _num_kept; }
+};
+
+#endif // SHARE_VM_GC_G1_G1CMREMOTEREGIONS_HPP
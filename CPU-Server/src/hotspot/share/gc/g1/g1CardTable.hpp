@@ -86,6 +86,8 @@ public:
   //mhr: restore
   inline void set_card_claimed(size_t card_index);
   //inline bool set_card_claimed(size_t card_index);
+  // Semeru, give back a card claimed while it was clean, by the VM thread before the evacuation.
+  inline void set_card_unclaimed(size_t card_index);
   void verify_g1_young_region(MemRegion mr) PRODUCT_RETURN;
   void g1_mark_as_young(const MemRegion& mr);
 
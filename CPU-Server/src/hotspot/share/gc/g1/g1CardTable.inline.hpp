@@ -40,6 +40,12 @@ void G1CardTable::set_card_claimed(size_t card_index) {
   }
   _byte_map[card_index] = val;
 }
+
+void G1CardTable::set_card_unclaimed(size_t card_index) {
+  assert(_byte_map[card_index] == (jbyte)claimed_card_val(), "only a clean card claimed");
+  _byte_map[card_index] = clean_card_val();
+}
+
 // bool G1CardTable::set_card_claimed(size_t card_index) {
 //   bool success = true;
 //   jbyte oldval = _byte_map[card_index];
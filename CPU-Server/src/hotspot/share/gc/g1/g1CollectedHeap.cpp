@@ -24,8 +24,10 @@
 
 #include "precompiled.hpp"
 #include "classfile/classLoaderDataGraph.hpp"
+#include "classfile/javaClasses.hpp"
 #include "classfile/metadataOnStackMark.hpp"
 #include "classfile/stringTable.hpp"
+#include "classfile/systemDictionary.hpp"
 #include "code/codeCache.hpp"
 #include "code/icBuffer.hpp"
 #include "gc/g1/g1Allocator.inline.hpp"
@@ -36,6 +38,7 @@
 #include "gc/g1/g1CollectorState.hpp"
 #include "gc/g1/g1ConcurrentRefine.hpp"
 #include "gc/g1/g1ConcurrentRefineThread.hpp"
+#include "gc/g1/g1ConcurrentMark.inline.hpp"
 #include "gc/g1/g1ConcurrentMarkThread.inline.hpp"
 #include "gc/g1/g1EvacStats.inline.hpp"
 #include "gc/g1/g1FullCollector.hpp"
@@ -53,6 +56,15 @@
 #include "gc/g1/g1RootClosures.hpp"
 #include "gc/g1/g1RootProcessor.hpp"
 #include "gc/g1/g1SATBMarkQueueSet.hpp"
+#include "gc/g1/g1SemeruEventSender.hpp"
+#include "gc/g1/g1SemeruFaultProfiler.hpp"
+#include "gc/g1/g1SemeruRdmaStats.hpp"
+#include "gc/g1/g1SemeruCommThread.hpp"
+#include "gc/g1/g1SemeruMetaReplicationThread.hpp"
+#include "gc/g1/g1SemeruOffHeapArena.hpp"
+#include "gc/g1/g1SemeruRemoteArrayOps.hpp"
+#include "gc/g1/g1SemeruPretenureProfile.hpp"
+#include "gc/g1/g1SemeruTargetQueueThread.hpp"
 #include "gc/g1/g1StringDedup.hpp"
 #include "gc/g1/g1ThreadLocalData.hpp"
 #include "gc/g1/g1YCTypes.hpp"
@@ -73,6 +85,7 @@
 #include "gc/shared/oopStorageParState.hpp"
 #include "gc/shared/parallelCleaning.hpp"
 #include "gc/shared/preservedMarks.inline.hpp"
+#include "gc/shared/rdmaMetaLayout.hpp"
 #include "gc/shared/suspendibleThreadSet.hpp"
 #include "gc/shared/referenceProcessor.inline.hpp"
 #include "gc/shared/taskqueue.inline.hpp"
@@ -80,8 +93,10 @@
 #include "gc/shared/workerPolicy.hpp"
 #include "logging/log.hpp"
 #include "memory/allocation.hpp"
+#include "memory/heapInspection.hpp"
 #include "memory/iterator.hpp"
 #include "memory/resourceArea.hpp"
+#include "memory/universe.hpp"
 #include "oops/access.inline.hpp"
 #include "oops/compressedOops.inline.hpp"
 #include "oops/oop.inline.hpp"
@@ -96,6 +111,8 @@
 #include "utilities/globalDefinitions.hpp"
 #include "utilities/stack.inline.hpp"
 
+#include <sys/mman.h>
+
 size_t G1CollectedHeap::_humongous_object_threshold_in_words = 0;
 
 // INVARIANTS/NOTES
@@ -161,12 +178,40 @@ HeapRegion* G1CollectedHeap::new_heap_region(uint hrs_index,
 
 // Private methods.
 
+// Semeru CPU, rank the free Regions by their swapped out pages.
+class G1SwappedOutPagesCost : public FreeRegionCost {
+  const G1CollectedHeap* _g1h;
+public:
+  G1SwappedOutPagesCost(const G1CollectedHeap* g1h) : _g1h(g1h) { }
+  size_t cost(HeapRegion* hr) { return _g1h->swapped_out_pages(hr); }
+};
+
+/**
+ * Semeru CPU - A free Region keeps its pages swapped out to the memory server,
+ *  e.g. it's freed by the memory server compaction or evicted after the last GC.
+ *  The mutator or the GC workers allocating into it fault in each page over RDMA, only to overwrite the dead content.
+ *  Prefer a resident one among the first SemeruResidentAllocWindow free Regions, from the same end as G1.
+ *  The CPU server's swap out map is read, no syscall per Region.
+ */
+HeapRegion* G1CollectedHeap::allocate_free_region(HeapRegionType type) {
+  if (SemeruResidentAllocWindow > 0 && _swap_out_map != NULL && !g1_collector_policy()->is_hetero_heap()) {
+    G1SwappedOutPagesCost cost(this);
+    HeapRegion* hr = _hrm->allocate_cheapest_free_region(type, (uint)SemeruResidentAllocWindow, &cost);
+    if (hr != NULL) {
+      log_trace(semeru, alloc)("%s, Region[0x%x] %s, 0x%lx pages swapped out", __func__,
+                               hr->hrm_index(), type.get_str(), swapped_out_pages(hr));
+    }
+    return hr;
+  }
+  return _hrm->allocate_free_region(type);
+}
+
 HeapRegion* G1CollectedHeap::new_region(size_t word_size, HeapRegionType type, bool do_expand) {
   assert(!is_humongous(word_size) || word_size <= HeapRegion::GrainWords,
          "the only time we use this to allocate a humongous region is "
          "when we are allocating a single humongous region");
 
-  HeapRegion* res = _hrm->allocate_free_region(type);
+  HeapRegion* res = allocate_free_region(type);
 
   if (res == NULL && do_expand && _expand_heap_after_alloc_failure) {
     // Currently, only attempts to allocate GC alloc regions set
@@ -408,6 +453,61 @@ G1CollectedHeap::mem_allocate(size_t word_size,
   return attempt_allocation(word_size, word_size, &dummy);
 }
 
+/**
+ * Semeru CPU - Pretenure the large objects of the Klasses the young pauses keep promoting, see G1SemeruPretenureProfile.
+ *  They skip the eden, the survivor copies and the promotion copy. The pretenure Region is not mlocked as young,
+ *  and is evicted to its memory server with the cold Regions of the next pause once it's retired.
+ *
+ *  The compiled code defers the card marks of an object allocated out of the young gen by the slow path,
+ *  the same as for the humongous objects, the initializing stores are not missed by the remembered sets.
+ *  A Region taken during the concurrent marking has its TAMS at the bottom, the new objects are implicitly live.
+ */
+HeapWord* G1CollectedHeap::mem_allocate_pretenured(Klass* klass, size_t word_size) {
+  if (_pretenure_profile == NULL || is_humongous(word_size) ||
+      !_pretenure_profile->should_pretenure(klass, word_size)) {
+    return NULL;
+  }
+
+  MutexLocker ml(Heap_lock);
+  HeapWord* result = NULL;
+  if (_pretenure_region != NULL) {
+    result = _pretenure_region->allocate(word_size);
+    if (result == NULL) {
+      retire_pretenure_region();
+    }
+  }
+
+  if (result == NULL) {
+    HeapRegion* hr = new_region(word_size, HeapRegionType::Old, false /* do_expand */);
+    if (hr == NULL) {
+      return NULL;   // the eden allocation triggers the pause
+    }
+    hr->set_old();
+    _verifier->check_bitmaps("Pretenure Region Allocation", hr);
+    _g1_policy->remset_tracker()->update_at_allocate(hr);
+    _hr_printer.alloc(hr);
+    old_set_add(hr);
+    _pretenure_region = hr;
+    result = hr->allocate(word_size);
+    assert(result != NULL, "a new Region fits a non-humongous object");
+  }
+
+  increase_used(word_size * HeapWordSize);
+  log_trace(semeru, alloc)("%s, 0x%lx words in Region[0x%x]", __func__, word_size, _pretenure_region->hrm_index());
+  return result;
+}
+
+// Under the Heap_lock, or at the start of a pause.
+void G1CollectedHeap::retire_pretenure_region() {
+  HeapRegion* hr = _pretenure_region;
+  if (hr == NULL) {
+    return;
+  }
+  _pretenure_region = NULL;
+  _hr_printer.retire(hr);
+  hint_cold_region(hr);
+}
+
 HeapWord* G1CollectedHeap::attempt_allocation_slow(size_t word_size) {
   ResourceMark rm; // For retrieving the thread names in log messages.
 
@@ -1010,6 +1110,11 @@ void G1CollectedHeap::abort_concurrent_cycle() {
   // Abandon current iterations of concurrent marking and concurrent
   // refinement, if any are in progress.
   concurrent_mark()->concurrent_cycle_abort();
+
+  // -XX:+SemeruSATBForwarding, the entries recorded out of the marking get stale by the compaction.
+  if (SemeruSATBForwarding) {
+    G1BarrierSet::satb_mark_queue_set().abandon_partial_marking();
+  }
 }
 
 void G1CollectedHeap::prepare_heap_for_full_collection() {
@@ -1482,6 +1587,10 @@ public:
 G1CollectedHeap::G1CollectedHeap(G1CollectorPolicy* collector_policy) :
   CollectedHeap(),
   _young_gen_sampling_thread(NULL),
+  _semeru_target_queue_thread(NULL),
+  _semeru_meta_replication_thread(NULL),
+  _semeru_comm_thread(NULL),
+  _cpu_server_flags_ticket(0),
   _workers(NULL),
   _collector_policy(collector_policy),
   _card_table(NULL),
@@ -1555,11 +1664,34 @@ G1CollectedHeap::G1CollectedHeap(G1CollectorPolicy* collector_policy) :
 
   //mhr: modify
   pair_array = NEW_C_HEAP_ARRAY(AddrPair, 524288, mtGC);
-  _queue_bitmap = NEW_C_HEAP_ARRAY(size_t, 67108870, mtGC);
-  memset(_queue_bitmap, 0 , 67108870*sizeof(size_t));
-  gctime = 0;
-  commtime = 0;
-  regiontime = 0;
+  // 1 bit per HeapWord of the Semeru heap, see HashQueue.
+  const size_t queue_bitmap_words = RDMA_DATA_REGION_NUM * REGION_SIZE_GB * ONE_GB / HeapWordSize / BitsPerWord;
+  _queue_bitmap = NEW_C_HEAP_ARRAY(size_t, queue_bitmap_words, mtGC);
+  memset(_queue_bitmap, 0 , queue_bitmap_words*sizeof(size_t));
+  _mem_server_doorbell_seq = 0;
+  _mem_server_stw_deadline = 0.0;
+  _meta_epoch = 0;
+  _confirmed_meta_epoch = 0;
+  _swap_out_map = NULL;
+  _swap_out_map_entries = 0;
+  _swap_in_map = NULL;
+  _swap_ins_seen = NULL;
+  _swap_in_heat = NULL;
+  _page_residency = NULL;
+  _page_residency_sampled = NULL;
+  _cold_regions_to_evict = NULL;
+  _num_cold_regions_to_evict = 0;
+  _cold_regions_evicting = false;
+  _cold_hinted = NULL;
+  _pretenure_profile = NULL;
+  _pretenure_region = NULL;
+  _cold_hints = NULL;
+  _num_cold_hints = 0;
+  _compacted_region_ring_tails = NULL;
+  _mark_message_tails = NULL;
+  _page_affinity_shared = false;
+  _mem_compacted_regions = NULL;
+  _num_mem_compacted_regions = 0;
 
 
   for (uint i = 0; i < n_queues; i++) {
@@ -1672,6 +1804,33 @@ jint G1CollectedHeap::initialize_young_gen_sampling_thread() {
   return JNI_OK;
 }
 
+jint G1CollectedHeap::initialize_semeru_target_queue_thread() {
+  _semeru_target_queue_thread = new G1SemeruTargetQueueThread();
+  if (_semeru_target_queue_thread->osthread() == NULL) {
+    vm_shutdown_during_initialization("Could not create G1SemeruTargetQueueThread");
+    return JNI_ENOMEM;
+  }
+  return JNI_OK;
+}
+
+jint G1CollectedHeap::initialize_semeru_meta_replication_thread() {
+  _semeru_meta_replication_thread = new G1SemeruMetaReplicationThread();
+  if (_semeru_meta_replication_thread->osthread() == NULL) {
+    vm_shutdown_during_initialization("Could not create G1SemeruMetaReplicationThread");
+    return JNI_ENOMEM;
+  }
+  return JNI_OK;
+}
+
+jint G1CollectedHeap::initialize_semeru_comm_thread() {
+  _semeru_comm_thread = new G1SemeruCommThread();
+  if (_semeru_comm_thread->osthread() == NULL) {
+    vm_shutdown_during_initialization("Could not create G1SemeruCommThread");
+    return JNI_ENOMEM;
+  }
+  return JNI_OK;
+}
+
 jint G1CollectedHeap::initialize() {
   os::enable_vtime();
 
@@ -1716,11 +1875,26 @@ jint G1CollectedHeap::initialize() {
   ReservedSpace rdma_rs; 
   ReservedSpace g1_rs;
   
-  if(SemeruEnableMemPool && UseCompressedOops==false){
+  // The layout of the RDMA meta space.
+  // It has to be ready before any RDMA structure is allocated.
+  SemeruMetaLayout::initialize(HeapRegion::GrainBytes, SemeruMemServerNum);
+
+  if(SemeruEnableMemPool){
     // Initialize the Semeru Heap
 
+    // The old generation mapped to a file is never written to the memory servers.
+    // The young generation is kept in the local DRAM by -XX:+SemeruPinYoungRegions instead.
+    if (AllocateOldGenAt != NULL) {
+      vm_shutdown_during_initialization("AllocateOldGenAt is not supported by SemeruEnableMemPool, use -XX:+SemeruPinYoungRegions");
+      return JNI_EINVAL;
+    }
+
     size_t reserved_for_rdma_data = RDMA_STRUCTURE_SPACE_SIZE;	// Bytes, Reserved for structures transfered by RDMA.
 
+    // The layout of the RDMA meta space covers the whole data space, the same with the memory servers.
+    guarantee(max_byte_size <= SemeruMetaLayout::heap_size(),
+              "-Xmx 0x%lx exceeds the Semeru data space 0x%lx.", max_byte_size, SemeruMetaLayout::heap_size());
+
     // max_byte_size is also controlled by -Xmx at CPU server now.
     heap_rs = Universe::reserve_semeru_memory_pool(max_byte_size + reserved_for_rdma_data,
                                                                 heap_alignment);
@@ -1945,6 +2119,36 @@ jint G1CollectedHeap::initialize() {
     return ecode;
   }
 
+  if (SemeruConcurrentTargetQueue) {
+    ecode = initialize_semeru_target_queue_thread();
+    if (ecode != JNI_OK) {
+      return ecode;
+    }
+  }
+
+  if (SemeruConcurrentMetaReplication) {
+    ecode = initialize_semeru_meta_replication_thread();
+    if (ecode != JNI_OK) {
+      return ecode;
+    }
+  }
+
+  if (SemeruCommThread) {
+    ecode = initialize_semeru_comm_thread();
+    if (ecode != JNI_OK) {
+      return ecode;
+    }
+  }
+
+  if (SemeruTimeline) {
+    G1SemeruTimeline::initialize();
+  }
+
+  if (SemeruFaultSamplePeriod > 0) {
+    G1SemeruFaultProfiler::initialize();
+  }
+  G1SemeruRdmaStats::initialize();
+
   {
     DirtyCardQueueSet& dcqs = G1BarrierSet::dirty_card_queue_set();
     dcqs.set_process_completed_buffers_threshold(concurrent_refine()->yellow_zone());
@@ -1976,6 +2180,89 @@ jint G1CollectedHeap::initialize() {
 
   _collection_set.initialize(max_regions());
 
+  // The RDMA meta space is reserved.
+  // Let the kernel control path reuse its pinned pages instead of walking the page table for each call.
+  if (syscall(RDMA_META_REGISTER, 0, (char*)SEMERU_START_ADDR, SemeruMetaLayout::used_size()) != 0) {
+    log_debug(semeru,alloc)("%s, register the RDMA meta space [0x%lx, 0x%lx) failed. ", __func__,
+                            (size_t)SEMERU_START_ADDR, (size_t)(SEMERU_START_ADDR + SemeruMetaLayout::used_size()));
+  }
+
+  // Before any Region is swapped out, the kernel counters start from 0.
+  if (SemeruEnableMemPool) {
+    initialize_swap_out_map();
+  }
+
+  // Above the heap, the reclaim hints cover it too.
+  G1SemeruOffHeapArena::initialize(g1_reserved().end());
+
+  if (SemeruReclaimHints) {
+    _hrm->initialize_reclaim_hints();
+  }
+
+  if (SemeruPinYoungRegions || SemeruRegionHints) {
+    _hrm->initialize_dram_pins();
+  }
+
+  if ((SemeruColdEvacuation || SemeruEvacLookAhead) && _swap_out_map != NULL) {
+    _page_residency = NEW_C_HEAP_ARRAY(unsigned char, max_reserved_capacity() / PAGE_SIZE, mtGC);
+    _page_residency_sampled = NEW_C_HEAP_ARRAY(bool, max_regions(), mtGC);
+    memset(_page_residency_sampled, 0, max_regions() * sizeof(bool));
+
+    if (SemeruColdEvacuation && SemeruBulkEvictColdRegions) {
+      _cold_regions_to_evict = NEW_C_HEAP_ARRAY(uint, max_regions(), mtGC);
+    }
+  }
+
+  if ((SemeruRegionHints || SemeruPretenureLargeObjects) && _swap_out_map != NULL) {
+    // A Region can be both retired and hinted within a pause.
+    FREE_C_HEAP_ARRAY(uint, _cold_regions_to_evict);
+    _cold_regions_to_evict = NEW_C_HEAP_ARRAY(uint, 2 * max_regions(), mtGC);
+    _cold_hints = NEW_C_HEAP_ARRAY(uint, max_regions(), mtGC);
+    _cold_hinted = NEW_C_HEAP_ARRAY(volatile bool, max_regions(), mtGC);
+    memset((void*)_cold_hinted, 0, max_regions() * sizeof(bool));
+  }
+
+  if (SemeruPretenureLargeObjects) {
+    _pretenure_profile = new G1SemeruPretenureProfile();
+  }
+
+  if (_compacted_region_ring != NULL) {
+    _compacted_region_ring_tails = NEW_C_HEAP_ARRAY(size_t, SemeruMemServerNum, mtGC);
+    memset(_compacted_region_ring_tails, 0, SemeruMemServerNum * sizeof(size_t));
+    _mem_compacted_regions = NEW_C_HEAP_ARRAY(uint, SemeruMemServerNum * _compacted_region_ring->_capacity, mtGC);
+  }
+
+  if (_mark_messages != NULL && SemeruMarkMessages) {
+    _mark_message_tails = NEW_C_HEAP_ARRAY(size_t, SemeruMemServerNum, mtGC);
+    memset(_mark_message_tails, 0, SemeruMemServerNum * sizeof(size_t));
+  }
+
+  // The kernel prefetcher follows the page groups of the whole heap, the entries are only written by the GC.
+  if (_page_affinity != NULL && SemeruPageAffinity) {
+    size_t bytes = align_up(_page_affinity->bytes_of((void*)RDMA_DATA_SPACE_START_ADDR, g1_reserved().end()), os::vm_page_size());
+    if (syscall(RDMA_PAGE_AFFINITY, 0, (char*)_page_affinity->_next, bytes) == 0) {
+      _page_affinity_shared = true;
+    } else {
+      log_debug(semeru,alloc)("%s, the kernel doesn't take the page affinity.", __func__);
+    }
+  }
+
+  // Build the user space control path.
+  semeru_cp_comm_init();
+
+  // The large array copies and fills of the mutators, over the control path.
+  G1SemeruRemoteArrayOps::initialize(this);
+
+  // The remote faults of the Java threads, for the time to safepoint. Only the main thread runs so far,
+  // the others bind their slots in JavaThread::run().
+  if (SemeruSafepointFaultState && semeru_fault_state_init() && Thread::current()->is_Java_thread()) {
+    JavaThread::current()->set_semeru_fault_slot(semeru_fault_state_attach());
+  }
+
+  if (SemeruHeapSnapshotFile != NULL) {
+    drop_stale_heap_snapshot();
+  }
+
   return JNI_OK;
 }
 
@@ -1985,10 +2272,32 @@ void G1CollectedHeap::stop() {
   // that are destroyed during shutdown.
   _cr->stop();
   _young_gen_sampling_thread->stop();
+  if (_semeru_target_queue_thread != NULL) {
+    _semeru_target_queue_thread->stop();
+  }
+  if (_semeru_meta_replication_thread != NULL) {
+    _semeru_meta_replication_thread->stop();
+  }
+  if (_semeru_comm_thread != NULL) {
+    _semeru_comm_thread->stop();
+  }
   _cm_thread->stop();
   if (G1StringDedup::is_enabled()) {
     G1StringDedup::stop();
   }
+
+  if (SemeruHeapSnapshotFile != NULL) {
+    VM_G1SemeruHeapSnapshot op;
+    VMThread::execute(&op);
+  }
+
+  if (G1SemeruFaultProfiler::is_enabled()) {
+    LogTarget(Info, semeru) lt;
+    if (lt.is_enabled()) {
+      LogStream ls(lt);
+      G1SemeruFaultProfiler::print_on(&ls);
+    }
+  }
 }
 
 void G1CollectedHeap::safepoint_synchronize_begin() {
@@ -2366,6 +2675,120 @@ void G1CollectedHeap::object_iterate(ObjectClosure* cl) {
   heap_region_iterate(&blk);
 }
 
+class IterateUncountedObjectClosureRegionClosure: public HeapRegionClosure {
+  ObjectClosure* _cl;
+  const BitMap*  _counted;
+public:
+  IterateUncountedObjectClosureRegionClosure(ObjectClosure* cl, const BitMap* counted) : _cl(cl), _counted(counted) {}
+  bool do_heap_region(HeapRegion* r) {
+    if (!r->is_continues_humongous() && !_counted->at(r->hrm_index())) {
+      r->object_iterate(_cl);
+    }
+    return false;
+  }
+};
+
+void G1CollectedHeap::object_iterate_uncounted(ObjectClosure* cl, const BitMap* counted) {
+  IterateUncountedObjectClosureRegionClosure blk(cl, counted);
+  heap_region_iterate(&blk);
+}
+
+/**
+ * Semeru CPU - Let the memory servers count the fully evicted Regions of the class histogram, see remote_heap_histogram.
+ * The Regions are counted where their pages are, walking them here would swap all of them in.
+ *
+ * 1) Request the fully evicted, non humongous Regions of each memory server, with their used words.
+ * 2) Wait for each reply, merge its klasses into cit, and set its Regions in counted.
+ *    An overflowed reply, or none within remote_heap_histogram_timeout_ms, leaves the Regions to the caller.
+ */
+size_t G1CollectedHeap::count_remote_heap_histogram(KlassInfoTable* cit, BitMap* counted){
+  const jlong remote_heap_histogram_timeout_ms = 10 * 1000;
+  remote_heap_histogram* histo = _heap_histogram;
+  uint32_t seq = histo->_request_seq + 1;
+  size_t missed = 0;
+  bool requested[MAX_NUM_OF_MEMORY_SERVER] = { false };
+  int* mem_of_region = NEW_C_HEAP_ARRAY(int, max_regions(), mtGC);
+
+  for(uint i = 0; i < max_regions(); i++){
+    mem_of_region[i] = -1;
+  }
+
+  // 1) One request per memory server, the same sequence for all of them.
+  for(size_t mem_id = 0; mem_id < SemeruMemServerNum; mem_id++){
+    size_t num_regions = 0;
+    memset(histo->_used_words, 0, sizeof(histo->_used_words));
+
+    for(uint i = 0; i < max_regions(); i++){
+      HeapRegion* hr = _hrm->at_or_null(i);
+      if(hr == NULL || hr->is_free() || hr->is_humongous() || hr->region_to_memory_server_mapping() != (int)mem_id ||
+         swapped_out_pages(hr) < HeapRegion::GrainBytes/PAGE_SIZE){
+        continue;
+      }
+      histo->_used_words[i] = (uint32_t)pointer_delta(hr->top(), hr->bottom());
+      mem_of_region[i] = (int)mem_id;
+      num_regions++;
+    }
+    if(num_regions == 0){
+      continue;
+    }
+
+    // The used words are written before the sequence, on the same QP.
+    histo->_request_seq = seq;
+    if(semeru_cp_write((int)mem_id, (void*)histo->_used_words, sizeof(histo->_used_words)) != 0 ||
+       semeru_cp_write((int)mem_id, (void*)&histo->_request_seq, sizeof(uint32_t)) != 0){
+      log_warning(semeru,rdma)("%s, can't request the heap histogram of memory server[%lu].", __func__, mem_id);
+      continue;
+    }
+    ring_mem_server_doorbell(mem_id);
+    requested[mem_id] = true;
+    log_debug(semeru,rdma)("%s, request the heap histogram %u of 0x%lx Regions from memory server[%lu].", __func__, seq, num_regions, mem_id);
+  }
+
+  // 2) Merge the replies.
+  for(size_t mem_id = 0; mem_id < SemeruMemServerNum; mem_id++){
+    if(!requested[mem_id]){
+      continue;
+    }
+
+    jlong start = os::javaTimeMillis();
+    bool replied = false;
+    histo->_done_seq = seq - 1;   // the local copy may hold the reply of the previous memory server.
+    while(os::javaTimeMillis() - start < remote_heap_histogram_timeout_ms){
+      if(semeru_cp_read((int)mem_id, (void*)&histo->_done_seq, remote_heap_histogram::reply_size()) == 0 &&
+         histo->_done_seq == seq){
+        replied = true;
+        break;
+      }
+      os::naked_short_sleep(1);
+    }
+
+    if(!replied || histo->_overflow != 0 ||
+       (histo->_num_entries > 0 &&
+        semeru_cp_read((int)mem_id, (void*)histo->_entries, histo->_num_entries * sizeof(remote_heap_histogram::entry)) != 0)){
+      log_warning(semeru,rdma)("%s, memory server[%lu] %s the heap histogram %u, walk its Regions locally.", __func__, mem_id,
+                               !replied ? "didn't reply" : "overflowed", seq);
+      continue;
+    }
+
+    for(size_t e = 0; e < histo->_num_entries; e++){
+      remote_heap_histogram::entry* cur = &histo->_entries[e];
+      if(!cit->record_instances(cur->_klass, cur->_count, cur->_words)){
+        missed += cur->_count;
+      }
+    }
+    for(uint i = 0; i < max_regions(); i++){
+      if(mem_of_region[i] == (int)mem_id){
+        counted->set_bit(i);
+      }
+    }
+    log_debug(semeru,rdma)("%s, memory server[%lu] counted 0x%lx Regions, %lu klasses, in " JLONG_FORMAT " ms.", __func__, mem_id,
+                           (size_t)histo->_num_regions, (size_t)histo->_num_entries, os::javaTimeMillis() - start);
+  }
+
+  FREE_C_HEAP_ARRAY(int, mem_of_region);
+  return missed;
+}
+
 void G1CollectedHeap::heap_region_iterate(HeapRegionClosure* cl) const {
   _hrm->iterate(cl);
 }
@@ -2567,6 +2990,15 @@ void G1CollectedHeap::print_gc_threads_on(outputStream* st) const {
   _cm->print_worker_threads_on(st);
   _cr->print_threads_on(st);
   _young_gen_sampling_thread->print_on(st);
+  if (_semeru_target_queue_thread != NULL) {
+    _semeru_target_queue_thread->print_on(st);
+  }
+  if (_semeru_meta_replication_thread != NULL) {
+    _semeru_meta_replication_thread->print_on(st);
+  }
+  if (_semeru_comm_thread != NULL) {
+    _semeru_comm_thread->print_on(st);
+  }
   if (G1StringDedup::is_enabled()) {
     G1StringDedup::print_worker_threads_on(st);
   }
@@ -2578,6 +3010,15 @@ void G1CollectedHeap::gc_threads_do(ThreadClosure* tc) const {
   _cm->threads_do(tc);
   _cr->threads_do(tc);
   tc->do_thread(_young_gen_sampling_thread);
+  if (_semeru_target_queue_thread != NULL) {
+    tc->do_thread(_semeru_target_queue_thread);
+  }
+  if (_semeru_meta_replication_thread != NULL) {
+    tc->do_thread(_semeru_meta_replication_thread);
+  }
+  if (_semeru_comm_thread != NULL) {
+    tc->do_thread(_semeru_comm_thread);
+  }
   if (G1StringDedup::is_enabled()) {
     G1StringDedup::threads_do(tc);
   }
@@ -2677,6 +3118,8 @@ void G1CollectedHeap::gc_prologue(bool full) {
   // always_do_update_barrier = false;
   assert(InlineCacheBuffer::is_empty(), "should have cleaned up ICBuffer");
 
+  retire_pretenure_region();
+
   // This summary needs to be printed before incrementing total collections.
   g1_rem_set()->print_periodic_summary_info("Before GC RS summary", total_collections());
 
@@ -2833,6 +3276,12 @@ class RegisterHumongousWithInCSetFastTestClosure : public HeapRegionClosure {
     // may reduce needed headroom.
 
 
+    // The memory servers found references to the object, don't flush its remembered set to rescan the cards for nothing.
+    // The rescan swaps in the referencing cards.
+    if (SemeruRemoteHumongous && region->is_region_cm_scanned() && region->_mem_to_cpu_gc->_alive_ratio > 0.0) {
+      return false;
+    }
+
     //mhr: huge
     // return obj->is_typeArray() &&
     //        g1h->is_potential_eager_reclaim_candidate(region);
@@ -3187,7 +3636,12 @@ G1CollectedHeap::do_collection_pause_at_safepoint(double target_pause_time_ms) {
           concurrent_mark()->pre_initial_mark();
         }
 
+        update_swap_in_heat();
         g1_policy()->finalize_collection_set(target_pause_time_ms, &_survivor);
+        record_young_residency();
+        G1SemeruEventSender::send_swap_in_event();
+        sample_page_residency();
+        prefetch_collection_set();
 
         evacuation_info.set_collectionset_regions(collection_set()->region_length());
 
@@ -3371,6 +3825,150 @@ G1CollectedHeap::do_collection_pause_at_safepoint(double target_pause_time_ms) {
 
 
 
+// Flush the klass metadata in [send_base, send_base + len) to all the memory servers.
+// Only the pages written since the last GC are sent, the kernel tracks them by the soft-dirty bit.
+// Fall back to the whole range if the incremental write is not supported.
+static void send_metadata_range(char* send_base, size_t len) {
+  jlong start = os::elapsed_counter();
+  int dirty_pages = syscall(RDMA_WRITE_DIRTY, -1, send_base, len);
+  if (dirty_pages >= 0) {
+    G1SemeruRdmaStats::record(-1, (size_t)dirty_pages * PAGE_SIZE, start);
+    log_debug(semeru, rdma)("Write metadata 0x%lx , size 0x%lx, dirty 0x%x pages to all Memory Servers",
+                            (size_t)send_base, len, dirty_pages);
+    return;
+  }
+
+  semeru_cp_bcast(send_base, len);  // flush the klass to all the memory servers at once
+  log_debug(semeru, rdma)("Write metadata 0x%lx , size 0x%lx to all Memory Servers", (size_t)send_base , len);
+}
+
+/**
+ * Semeru CPU - Ship the klass metadata changed since the last round to all the memory servers.
+ *  1) Each SpaceManager hands out the metaspace chunks allocated since its last send.
+ *  2) The chunks are sorted and merged into ranges, gaps smaller than 16KB are sent along.
+ *  3) Only the dirty pages of each range are written, send_metadata_range().
+ *
+ *  Out of the pause, the caller is joined to the suspendible thread set, so the class loaders can't be
+ *  unloaded underneath, and each metaspace is read under its allocation lock.
+ */
+int G1CollectedHeap::replicate_metadata(bool at_safepoint) {
+  assert(at_safepoint == SafepointSynchronize::is_at_safepoint(), "%s, wrong context", __func__);
+
+  int num_pair = 0;
+  ClassLoaderDataGraphMetaspaceIterator iter;
+  while(iter.repeat()){
+    ClassLoaderMetaspace* clms = iter.get_next();
+    if(clms != NULL)
+      clms->send_metadata(pair_array, num_pair);
+  }
+  if (num_pair == 0) {
+    if (at_safepoint) {
+      _confirmed_meta_epoch = _meta_epoch;
+    }
+    return 0;
+  }
+  QuickSort::sort(pair_array, num_pair, G1CollectedHeap::compare_meta_st, true);
+
+  int num_sent = 0;
+  char* send_base = NULL;
+  size_t send_end = 0;
+  for(int i = 0; i < num_pair; i ++){
+    if(send_base == NULL) {
+      send_base = pair_array[i].st;
+      send_end = (size_t)pair_array[i].ed;
+      continue;
+    }
+    if((size_t)pair_array[i].st > send_end + 0x4000) {
+      send_metadata_range(send_base, send_end - (size_t)send_base);
+      num_sent++;
+      send_base = pair_array[i].st;
+      send_end = (size_t)pair_array[i].ed;
+    }
+    else {
+      send_end = (size_t)pair_array[i].ed > send_end ?  (size_t)pair_array[i].ed : send_end;
+    }
+  }
+
+  if(send_base != NULL) {
+    send_metadata_range(send_base, send_end - (size_t)send_base);
+    num_sent++;
+  }
+
+  Atomic::inc(&_meta_epoch);
+  if (at_safepoint) {
+    _confirmed_meta_epoch = _meta_epoch;
+  }
+  return num_sent;
+}
+
+/**
+ * Semeru CPU - Read the MemoryToCPUAtGC of the old Regions marked from the roots and not traced by the memory servers yet.
+ *  The STW workers claim the Regions by chunks, and each worker chains its reads into vectored RDMA reads,
+ *  up to SEMERU_RDMA_IOV_MAX entries of any memory servers per read.
+ *  The workers share the QP of each memory server, the posting is serialized but the reads are in flight together.
+ */
+class G1SemeruReadRegionInfoTask : public AbstractGangTask {
+  G1CollectedHeap* _g1h;
+  uint             _max_regions;
+  volatile uint    _next_region;
+  volatile size_t  _num_read;
+
+  static const uint ChunkRegions = 64;
+
+public:
+  G1SemeruReadRegionInfoTask(G1CollectedHeap* g1h) :
+    AbstractGangTask("Semeru Read Region Info"),
+    _g1h(g1h),
+    _max_regions(g1h->max_regions()),
+    _next_region(0),
+    _num_read(0) { }
+
+  void work(uint worker_id) {
+    G1GCParPhaseTimesTracker x(_g1h->g1_policy()->phase_times(), G1GCPhaseTimes::SemeruReadRegionInfo, worker_id);
+    semeru_rdma_iovec* iov = NEW_C_HEAP_ARRAY(semeru_rdma_iovec, SEMERU_RDMA_IOV_MAX, mtGC);
+    int nr_iov = 0;
+    size_t num_read = 0;
+
+    for (uint start = Atomic::add(ChunkRegions, &_next_region) - ChunkRegions; start < _max_regions;
+         start = Atomic::add(ChunkRegions, &_next_region) - ChunkRegions) {
+      uint end = MIN2(start + ChunkRegions, _max_regions);
+      for (uint i = start; i < end; i++) {
+        HeapRegion* hr = _g1h->region_at_or_null(i);
+        if (hr == NULL) {
+          continue;
+        }
+
+        log_debug(semeru)("Before read: Region %u marked from root: %d\n", i, hr->cross_region_ref_target_queue()->_marked_from_root);
+        bool traced = hr->is_old() || (SemeruRemoteHumongous && hr->is_starts_humongous());
+        if (hr->is_free() || !traced || !hr->cross_region_ref_target_queue()->_marked_from_root || hr->_mem_to_cpu_gc->_cm_scanned) {
+          continue;
+        }
+
+        iov[nr_iov].mem_server_id = hr->region_to_memory_server_mapping();
+        iov[nr_iov].write_type    = 0;  // data
+        iov[nr_iov].start_addr    = (char*)hr->_mem_to_cpu_gc;
+        iov[nr_iov].size          = sizeof(MemoryToCPUAtGC);
+        num_read++;
+
+        if (++nr_iov == SEMERU_RDMA_IOV_MAX) {
+          HeapRegion::read_mem_to_cpu_gc(iov, nr_iov);
+          nr_iov = 0;
+        }
+      }
+    }
+
+    if (nr_iov > 0) {
+      HeapRegion::read_mem_to_cpu_gc(iov, nr_iov);
+    }
+    FREE_C_HEAP_ARRAY(semeru_rdma_iovec, iov);
+
+    _g1h->g1_policy()->phase_times()->record_thread_work_item(G1GCPhaseTimes::SemeruReadRegionInfo, worker_id, num_read);
+    Atomic::add(num_read, &_num_read);
+  }
+
+  size_t num_read() const { return _num_read; }
+};
+
 /**
  * Semeru CPU Server Stop-the-wolrd GC, CSSC
  *  
@@ -3378,28 +3976,86 @@ G1CollectedHeap::do_collection_pause_at_safepoint(double target_pause_time_ms) {
 bool
 G1CollectedHeap::semeru_do_collection_pause_at_safepoint(double target_pause_time_ms) {
 
-  double read_time_st = os::elapsedTime();
+  // The communication with the memory servers below is part of the pause phases.
+  g1_policy()->note_gc_start();
+  G1GCPhaseTimes* phase_times = g1_policy()->phase_times();
+  double open_window_start = os::elapsedTime();
+  G1SemeruRdmaStats::begin_pause();
+  G1SemeruRdmaStats::set_phase(G1SemeruRdmaStats::OpenWindow);
+
+  // The flags of the last close_stw_window() may be still queued.
+  wait_cpu_server_flags_sent();
+  if (G1SemeruTimeline::is_enabled()) {
+    G1SemeruTimeline::begin_pause(total_collections());
+  }
+
+  // The overwritten references recorded since the last pause, before their objects move.
+  if(SemeruSATBForwarding){
+    G1BarrierSet::satb_mark_queue_set().prepare_forwarding_for_pause();
+  }
+
+  // The memory servers push new states after they see the STW window.
+  reset_mem_server_states();
+  close_concurrent_compaction_grants();
+  if(SemeruRemoteRefProcessing){
+    enqueue_remote_pending_references();
+  }
+  if(SemeruRemoteStringDedup){
+    // The memory servers recognize the Strings by the klasses of this server, see G1SemeruStringDedup.
+    cpu_server_flags()->_string_klass        = SystemDictionary::String_klass();
+    cpu_server_flags()->_byte_array_klass    = Universe::byteArrayKlassObj();
+    cpu_server_flags()->_remote_string_dedup = true;
+  }
+  cpu_server_flags()->_checksum_sample_percent = (uint)SemeruChecksumSamplePercent;
+  cpu_server_flags()->_selective_invalidation  = SemeruSelectiveInvalidation;
+  cpu_server_flags()->_page_affinity           = _page_affinity_shared;
+  cpu_server_flags()->_timeline                = G1SemeruTimeline::is_enabled();
+  cpu_server_flags()->_stw_budget_us = mem_server_pause_budget_us(target_pause_time_ms, open_window_start);
           
   cpu_server_flags()->set_cpu_server_in_stw();
   log_debug(semeru,mem_trace)("%s, Update CSet to memory server. \n", __func__);
-  send_cpu_server_flags_to_mem_server();
-  
-
-  uint len = _hrm->max_length();
-  for (uint i = 0; i < len; i++) {
-    if (!_hrm->is_available(i)) {
-      continue;
-    }
-    HeapRegion* hr = _hrm->at(i);
-    
-    log_debug(semeru)("Before read: Region %u marked from root: %d\n", i, hr->cross_region_ref_target_queue()->_marked_from_root);
-    if(!hr->is_free() && hr->is_old() && hr->cross_region_ref_target_queue()->_marked_from_root && !hr->_mem_to_cpu_gc->_cm_scanned) {
-      hr->read_info_before_gc();
-    }
+  send_cpu_server_flags_to_mem_server_async();
+  if (G1SemeruTimeline::is_enabled()) {
+    G1SemeruTimeline::open_window(cpu_server_flags()->state_seq());
+  }
+  double wait_start = os::elapsedTime();
+  phase_times->record_semeru_open_window_time_ms((wait_start - open_window_start) * MILLIUNITS);
+  G1SemeruRdmaStats::set_phase(G1SemeruRdmaStats::WaitMemServer);
+
+  // Take back the grants while the flags are in flight.
+  release_concurrent_compaction_grants();
+  wait_cpu_server_flags_sent();
+  double sync_start = os::elapsedTime();
+  phase_times->record_semeru_wait_mem_server_time_ms((sync_start - wait_start) * MILLIUNITS);
+  G1SemeruRdmaStats::set_phase(G1SemeruRdmaStats::SyncCompacted);
+
+  sync_compacted_region_bots();
+  drain_compacted_region_rings();
+  if(SemeruSelectiveInvalidation){
+    invalidate_rewritten_pages();
+  }
+  if(_mark_message_tails != NULL){
+    relay_mark_messages();
+  }
+  // The code and the heap hold still here, the faults sampled since the last pause are resolved.
+  G1SemeruFaultProfiler::drain();
+  double read_start = os::elapsedTime();
+  phase_times->record_semeru_sync_compacted_time_ms((read_start - sync_start) * MILLIUNITS);
+  G1SemeruRdmaStats::set_phase(G1SemeruRdmaStats::ReadRegionInfo);
+
+  if(SemeruIncrementalLiveness){
+    sync_region_liveness();
+  }else{
+    G1SemeruReadRegionInfoTask read_task(this);
+    workers()->run_task(&read_task);
+    log_debug(semeru,rdma)("%s, read the info of 0x%lx old Regions by %u workers.", __func__,
+                           read_task.num_read(), workers()->active_workers());
+  }
+  if(_page_affinity_shared){
+    sync_page_affinity();
   }
-  double read_time_ed = os::elapsedTime();
-  log_debug(semeru)("read MetaData: %lf\n", read_time_ed-read_time_st);
-          commtime += read_time_ed-read_time_st;
+  phase_times->record_semeru_read_region_info_time_ms((os::elapsedTime() - read_start) * MILLIUNITS);
+  G1SemeruRdmaStats::set_phase(G1SemeruRdmaStats::OtherPause);
 
 
   //chenxi
@@ -3412,6 +4068,7 @@ G1CollectedHeap::semeru_do_collection_pause_at_safepoint(double target_pause_tim
   guarantee(!is_gc_active(), "collection is not reentrant");
 
   if (GCLocker::check_active_before_gc()) {
+    G1SemeruRdmaStats::end_pause();
     return false;
   }
 
@@ -3423,8 +4080,6 @@ G1CollectedHeap::semeru_do_collection_pause_at_safepoint(double target_pause_tim
   SvcGCMarker sgcm(SvcGCMarker::MINOR);
   ResourceMark rm;
 
-  g1_policy()->note_gc_start();
-
   //mhr: modify
   //no need to wait
   //wait_for_root_region_scanning();
@@ -3570,11 +4225,15 @@ G1CollectedHeap::semeru_do_collection_pause_at_safepoint(double target_pause_tim
 
         //mhr: modify
         //mhr: reimplement the whole collection set choosing part
+        update_swap_in_heat();
         g1_policy()->semeru_finalize_collection_set(&_survivor);
+        record_young_residency();
+        sample_page_residency();
+        prefetch_collection_set();
 
         //Update meta klass data to each memory servers
         bool update_klass = false;
-        for(int mem_id=0; mem_id<NUM_OF_MEMORY_SERVER; mem_id++){
+        for(int mem_id=0; mem_id<(int)SemeruMemServerNum; mem_id++){
           if(recv_mem_server_cset()->num_of_enqueued_regions(mem_id)!=0){
             update_klass = true;
             break;
@@ -3582,53 +4241,14 @@ G1CollectedHeap::semeru_do_collection_pause_at_safepoint(double target_pause_tim
         }
 
         if(update_klass){
-          //mhr: for debug
-          int num_pair = 0;
-          ClassLoaderDataGraphMetaspaceIterator iter;
-          while(iter.repeat()){
-            ClassLoaderMetaspace* clms = iter.get_next();
-            if(clms != NULL)
-              clms->send_metadata(pair_array, num_pair);
-          }
-          QuickSort::sort(pair_array, num_pair, G1CollectedHeap::compare_meta_st, true);
-
-          double send_time_st = os::elapsedTime();
-
-          char* send_base = NULL;
-          size_t send_end = 0;
-          for(int i = 0; i < num_pair; i ++){
-            if(send_base == NULL) {
-              send_base = pair_array[i].st;
-              send_end = (size_t)pair_array[i].ed;
-              continue;
-            }
-            if((size_t)pair_array[i].st > send_end + 0x4000) {
-              //log_debug(semeru, rdma)("Write metadata 0x%lx , size 0x%lx to Memory Server", (size_t)send_base , ((send_end - (size_t)send_base -1)/0x1000 + 1)*0x1000 );
-              for(int mem_id =0; mem_id < NUM_OF_MEMORY_SERVER; mem_id++){
-                syscall(RDMA_WRITE, mem_id, send_base, (send_end - (size_t)send_base));  // flush the klass to each memory servers
-                log_debug(semeru, rdma)("Write metadata 0x%lx , size 0x%lx to all Memory Server[%d]", (size_t)send_base , (send_end - (size_t)send_base), mem_id );
-              }
-              send_base = pair_array[i].st;
-              send_end = (size_t)pair_array[i].ed;
-            }
-            else {
-              send_end = (size_t)pair_array[i].ed > send_end ?  (size_t)pair_array[i].ed : send_end;
-            }
-
-          }
-
-          if(send_base != NULL) {
-   
-            for(int mem_id =0; mem_id < NUM_OF_MEMORY_SERVER; mem_id++){
-              syscall(RDMA_WRITE, mem_id, send_base, (send_end - (size_t)send_base));  // flush the klass to each memory servers
-              log_debug(semeru, rdma)("Write metadata 0x%lx , size 0x%lx to all Memory Server[%d]", (size_t)send_base , (send_end - (size_t)send_base), mem_id );
-            }
-            
+          double send_klass_start = os::elapsedTime();
+          G1SemeruRdmaStats::set_phase(G1SemeruRdmaStats::SendKlass);
+          int num_sent = replicate_metadata(true /* at_safepoint */);
+          G1SemeruRdmaStats::set_phase(G1SemeruRdmaStats::OtherPause);
+          phase_times->record_semeru_send_klass_time_ms((os::elapsedTime() - send_klass_start) * MILLIUNITS);
+          if (SemeruConcurrentMetaReplication) {
+            log_debug(semeru, rdma)("Confirm metadata epoch %lu, 0x%x residual ranges", _confirmed_meta_epoch, num_sent);
           }
-          double send_time_ed = os::elapsedTime();
-          tty->print("Send MetaData: %lf\n", send_time_ed-send_time_st);
-          commtime += send_time_ed-send_time_st;
-
         }
         
         //debug
@@ -3781,6 +4401,7 @@ G1CollectedHeap::semeru_do_collection_pause_at_safepoint(double target_pause_tim
       log_info(gc)("To-space exhausted");
     }
 
+    G1SemeruRdmaStats::end_pause();
     g1_policy()->print_phases();
     heap_transition.print();
 
@@ -3810,6 +4431,9 @@ G1CollectedHeap::semeru_do_collection_pause_at_safepoint(double target_pause_tim
     _gc_timer_stw->register_gc_end();
     _gc_tracer_stw->report_gc_end(_gc_timer_stw->gc_end(), _gc_timer_stw->time_partitions());
   }
+  if (G1SemeruTimeline::is_enabled()) {
+    G1SemeruTimeline::end_pause();
+  }
   // It should now be safe to tell the concurrent mark thread to start
   // without its logging output interfering with the logging output
   // that came from the pause.
@@ -3838,13 +4462,6 @@ G1CollectedHeap::semeru_do_collection_pause_at_safepoint(double target_pause_tim
   //   log_debug(semeru,rdma)("%s, _collection_set._optional_region_length 0x%x , Skip.\n", __func__, mem_cset_length);
   // }
 
-  double all_time_ed = os::elapsedTime();
-  tty->print("All gc: %lf\n", all_time_ed-read_time_st);
-  gctime += all_time_ed-read_time_st;
-
-
-
-  tty->print("Total gc and comm and region: %lf, %lf, %lf\n", gctime, commtime, regiontime);
   return true;
 }
 
@@ -3949,13 +4566,7 @@ public:
       {
         double start = os::elapsedTime();
         G1ParEvacuateFollowersClosure evac(_g1h, pss, _queues, _terminator.terminator(), G1GCPhaseTimes::ObjCopy);
-
-
-        double start_evac = os::elapsedTime();
-
         evac.do_void();
-        double end_evac = os::elapsedTime();
-        log_debug(semeru,rdma)("Evac: %lfs\n", end_evac-start_evac);
 
         evac_term_attempts = evac.term_attempts();
         term_sec = evac.term_time();
@@ -3967,6 +4578,12 @@ public:
         p->record_thread_work_item(G1GCPhaseTimes::Termination, worker_id, evac_term_attempts);
       }
 
+      {
+        // The target queues of the memory server CSet are sent right after this task.
+        G1GCParPhaseTimesTracker x(_g1h->g1_policy()->phase_times(), G1GCPhaseTimes::SemeruTargetQueue, worker_id);
+        pss->flush_target_marks();
+      }
+
       assert(pss->queue_is_empty(), "should be empty");
 
       if (log_is_enabled(Debug, gc, task, stats)) {
@@ -4252,15 +4869,14 @@ public:
 
       G1ScanRSForRegionClosureMemUpdate cl(_g1h->g1_rem_set()->scan_state(), pss, worker_id);
 
-      size_t len = _g1h->_mem_server_flags->_compacted_region_length;
-      OrderAccess::loadload();
+      size_t len = _g1h->_num_mem_compacted_regions;
       if (len == 0) {
         return;
       }
       size_t start_pos = (worker_id * len) / _n_workers;
       size_t cur_pos = start_pos;
       do {
-        HeapRegion* r = _g1h->region_at(_g1h->_mem_server_flags->_compacted_regions[cur_pos]);
+        HeapRegion* r = _g1h->region_at(_g1h->_mem_compacted_regions[cur_pos]);
         bool result = cl.do_heap_region(r);
         if (result) {
           cl.set_incomplete();
@@ -4309,6 +4925,10 @@ void G1CollectedHeap::complete_cleaning(BoolObjectClosure* is_alive,
   G1StringDedupUnlinkOrOopsDoClosure dedup_closure(is_alive, NULL, false);
   ParallelCleaningTask g1_unlink_task(is_alive, &dedup_closure, n_workers, class_unloading_occurred);
   workers()->run_task(&g1_unlink_task);
+
+  if (class_unloading_occurred && _pretenure_profile != NULL) {
+    _pretenure_profile->clear();
+  }
 }
 
 void G1CollectedHeap::partial_cleaning(BoolObjectClosure* is_alive,
@@ -4666,6 +5286,24 @@ void G1CollectedHeap::pre_evacuate_collection_set() {
   }
 }
 
+/**
+ * -XX:+SemeruWireCompression, encode the entries of [first, nr_iov) of at least SemeruWireCompressionMinBytes
+ * into the wire buffer of mem_id, and drop them from iov. The others are kept in order.
+ * Only the meta space entries, the memory server decodes into the runtime part of the meta space.
+ * 
+ * Return the new nr_iov.
+ */
+static int compress_rdma_iovec(semeru_rdma_iovec* iov, int first, int nr_iov, int mem_id){
+  int kept = first;
+  for(int i = first; i < nr_iov; i++){
+    if(iov[i].write_type != 0 || iov[i].size < SemeruWireCompressionMinBytes ||
+       !SemeruWireBuffer::append(mem_id, iov[i].start_addr, iov[i].size)){
+      iov[kept++] = iov[i];
+    }
+  }
+  return kept;
+}
+
 void G1CollectedHeap::evacuate_collection_set(G1ParScanThreadStateSet* per_thread_states) {
   // Should G1EvacuationFailureALot be in effect for this GC?
   NOT_PRODUCT(set_evacuation_failure_alot_for_current_gc();)
@@ -4676,6 +5314,8 @@ void G1CollectedHeap::evacuate_collection_set(G1ParScanThreadStateSet* per_threa
 
   double start_par_time_sec = os::elapsedTime();
   double end_par_time_sec;
+  // Accounted by the Semeru phases, see G1GCPhaseTimes::print_semeru_mem_server_comm().
+  double semeru_comm_sec = 0.0;
 
   {
     const uint n_workers = workers()->active_workers();
@@ -4707,44 +5347,125 @@ void G1CollectedHeap::evacuate_collection_set(G1ParScanThreadStateSet* per_threa
     size_t server_0_len = 0;
     size_t server_1_len = 0;
 
-    double send_region_info_st = os::elapsedTime();
     double send_region_tim = 0;
-
-    for(size_t mem_id=0; mem_id< NUM_OF_MEMORY_SERVER; mem_id++){
+    size_t flushed_pages = 0;
+
+    // Pipelined over the memory servers.
+    // 1) The data, the metadata and the CSet signal of a memory server are chained into its vectored writes.
+    //    The kernel drains the server's earlier writes before the signal, so the signal still comes last.
+    // 2) All the servers' vectors are posted before any is waited, their transfers are in flight together.
+    // 3) Each server is woken up as soon as its own vector is done, it starts compacting while the others are still written.
+    semeru_rdma_iovec* region_iov = NEW_C_HEAP_ARRAY(semeru_rdma_iovec, SEMERU_RDMA_IOV_MAX, mtGC);
+    int* server_tickets = NEW_C_HEAP_ARRAY(int, SemeruMemServerNum, mtGC);
+    const int region_iov_num = HeapRegion::info_at_gc_iov_num + HeapRegion::target_queue_iov_num + 1 /* remembered set */ + 1 /* data */;
+    Ticks dispatch_start[MAX_NUM_OF_MEMORY_SERVER];
+    size_t dispatch_bytes[MAX_NUM_OF_MEMORY_SERVER];
+
+    double send_region_st = os::elapsedTime();
+    G1SemeruRdmaStats::set_phase(G1SemeruRdmaStats::SendCSet);
+    for(size_t mem_id=0; mem_id< SemeruMemServerNum; mem_id++){
       size_t num_mem_cset = *(_recv_mem_server_cset->num_received_regions(mem_id));
+      int nr_iov = 0;
+      int ticket = -1;
+      dispatch_start[mem_id] = Ticks::now();
+      dispatch_bytes[mem_id] = 0;
+      SemeruWireBuffer::begin((int)mem_id);
       for(size_t i = 0; i < num_mem_cset; i ++){
         uint hr_index = _recv_mem_server_cset->get(mem_id,i);
         HeapRegion* hr = region_at(hr_index);
         guarantee(hr != NULL, "Tried to access region %u that has a NULL HeapRegion*", hr_index);
+        dispatch_bytes[mem_id] += hr->used();
+        G1SemeruEventSender::send_cset_region_event((uint)mem_id, hr);
         //hr->cross_region_ref_update_queue()->_marked_from_root = true;
         hr->cross_region_ref_target_queue()->_marked_from_root = true;
-        hr->send_info_at_gc();
-        hr->send_target_queue_at_gc();
-        double send_region_st = os::elapsedTime();
-        hr->flush_data();
-        double send_region_ed = os::elapsedTime();
-        send_region_tim += send_region_ed - send_region_st;
+        // The memory server compacts the Region past the signal, the swapped out pages cached locally get stale.
+        syscall(RDMA_REGION_FENCE, SEMERU_FENCE_REWRITE, hr->bottom(), HeapRegion::GrainBytes);
+        if(nr_iov + region_iov_num + 1 /* signal */ > SEMERU_RDMA_IOV_MAX){
+          ticket = post_rdma_iovec_async(region_iov, nr_iov, ticket);
+          nr_iov = 0;
+        }
+        hr->update_write_epoch();
+        hr->mark_info_at_gc_dirty();
+        int meta_iov = nr_iov;
+        nr_iov += hr->bot_at_gc_iovec(region_iov + nr_iov);
+        // The residual delta of the concurrent sends, unless the memory server traced the Region and consumed its copy.
+        bool tq_delta = SemeruConcurrentTargetQueue && !hr->is_region_cm_scanned();
+        hr->claim_target_marks_unsent();
+        nr_iov += hr->target_queue_iovec(region_iov + nr_iov, tq_delta);
+        if(SemeruWireCompression){
+          nr_iov = compress_rdma_iovec(region_iov, meta_iov, nr_iov, (int)mem_id);
+        }
+        // -XX:+SemeruRemoteRemSets, the remembered set of the Region is kept by its memory server from now on.
+        nr_iov += g1_rem_set()->stash_rem_set(hr, (int)mem_id, region_iov + nr_iov);
+        nr_iov += hr->data_iovec(region_iov + nr_iov);
+        flushed_pages += HeapRegion::GrainBytes/PAGE_SIZE - swapped_out_pages(hr);
       } // end of i, each enqueed region
 
-      // Update cset to memory server, if non-empty
+      // The per-Region structures, a few writes for all the Regions of this server.
+      nr_iov = append_dirty_arena_runs(region_iov, nr_iov, SEMERU_RDMA_IOV_MAX - 3 /* wire buffer, CSet overflow, signal */, (int)mem_id, &ticket);
+
+      // Update cset to memory server, if non-empty.
+      // Its overflow pages first, then the header page as the signal.
       if(num_mem_cset){
-        
-        //Comment this to disable memory server CT
-        update_cset_to_mem_server(mem_id);
-        log_info(semeru,rdma)("%s, write %lx regions cset to memory server[%lu] ",__func__, num_mem_cset, mem_id);
-      }
+        _recv_mem_server_cset->bump_seq(mem_id);
+        char* wire_start;
+        size_t wire_size;
+        if(SemeruWireBuffer::finish((int)mem_id, _recv_mem_server_cset->seq(mem_id), &wire_start, &wire_size)){
+          region_iov[nr_iov].mem_server_id = (int)mem_id;
+          region_iov[nr_iov].write_type    = 0;  // data
+          region_iov[nr_iov].start_addr    = wire_start;
+          region_iov[nr_iov].size          = wire_size;
+          nr_iov++;
+          log_info(semeru,rdma)("%s, memory server[%lu] 0x%lx bytes of target queues and BOT compressed into 0x%lx", __func__,
+                                mem_id, SemeruWireBuffer::raw_bytes((int)mem_id), wire_size);
+        }
+        char* overflow_start;
+        size_t overflow_size = _recv_mem_server_cset->overflow_size(mem_id, &overflow_start);
+        if(overflow_size > 0){
+          region_iov[nr_iov].mem_server_id = (int)mem_id;
+          region_iov[nr_iov].write_type    = 0;  // data
+          region_iov[nr_iov].start_addr    = overflow_start;
+          region_iov[nr_iov].size          = align_up(overflow_size, PAGE_SIZE);
+          nr_iov++;
+        }
 
+        //Comment this to disable memory server CT
+        region_iov[nr_iov].mem_server_id = (int)mem_id;
+        region_iov[nr_iov].write_type    = 1;  // signal
+        region_iov[nr_iov].start_addr    = (char*)_recv_mem_server_cset;
+        region_iov[nr_iov].size          = MEMORY_SERVER_CSET_HEADER_SIZE;
+        nr_iov++;
+      }
+      server_tickets[mem_id] = post_rdma_iovec_async(region_iov, nr_iov, ticket);
     }// end of mem_id, each memory server
+
+    for(size_t mem_id=0; mem_id< SemeruMemServerNum; mem_id++){
+      wait_rdma_ticket(server_tickets[mem_id]);
+      size_t num_mem_cset = *(_recv_mem_server_cset->num_received_regions(mem_id));
+      if(num_mem_cset){
+        ring_mem_server_doorbell(mem_id);
+        G1SemeruEventSender::send_cset_dispatch_event((uint)mem_id, (uint)num_mem_cset, dispatch_bytes[mem_id], dispatch_start[mem_id]);
+        G1SemeruTimeline::record(SEMERU_TL_CSET_SENT, (uint32_t)mem_id);
+        log_info(semeru,rdma)("%s, write %lx regions cset to memory server[%lu], seq %u",__func__, num_mem_cset, mem_id,
+                              _recv_mem_server_cset->seq(mem_id));
+      }
+    }
+    send_region_tim = os::elapsedTime() - send_region_st;
     log_info(semeru,rdma)("%s, Send information to all memory servers done.\n", __func__);
+    FREE_C_HEAP_ARRAY(int, server_tickets);
+    FREE_C_HEAP_ARRAY(semeru_rdma_iovec, region_iov);
 
+    // The flush cost of the memory server CSet, learned by the cost model of the CSet selection.
+    g1_policy()->record_semeru_flush_time_ms(send_region_tim * MILLIUNITS, flushed_pages);
+    phase_times->record_semeru_send_cset_time_ms(send_region_tim * MILLIUNITS);
 
+    double close_start = os::elapsedTime();
+    G1SemeruRdmaStats::set_phase(G1SemeruRdmaStats::CloseWindow);
     close_stw_window();
-
-
-    double send_region_info_ed = os::elapsedTime();
-    tty->print("Send region time all: %lf, only region time: %lf\n", send_region_info_ed - send_region_info_st, send_region_tim);
-    commtime += send_region_info_ed - send_region_info_st;
-    regiontime += send_region_tim;
+    G1SemeruRdmaStats::set_phase(G1SemeruRdmaStats::OtherPause);
+    double close_window_sec = os::elapsedTime() - close_start;
+    phase_times->record_semeru_close_window_time_ms(close_window_sec * MILLIUNITS);
+    semeru_comm_sec = send_region_tim + close_window_sec;
 
 
     //send_evacuated_region_info();
@@ -4779,7 +5500,7 @@ void G1CollectedHeap::evacuate_collection_set(G1ParScanThreadStateSet* per_threa
     end_par_time_sec = os::elapsedTime();
   }
 
-  double par_time_ms = (end_par_time_sec - start_par_time_sec) * 1000.0;
+  double par_time_ms = (end_par_time_sec - start_par_time_sec - semeru_comm_sec) * 1000.0;
   phase_times->record_par_time(par_time_ms);
 
   double code_root_fixup_time_ms =
@@ -4806,11 +5527,15 @@ void G1CollectedHeap::close_stw_window(){
   // }
 
 
+  // The Regions sent in this window can be compacted by the memory servers before the next one.
+  grant_concurrent_compaction();
+
   // Modify state  
   cpu_server_flags()->set_cpu_server_in_mutator();
     
-  // inform Memory server
-  send_cpu_server_flags_to_mem_server();
+  // inform Memory server, the mutators don't wait for the acknowledgements.
+  send_cpu_server_flags_to_mem_server_async();
+  G1SemeruTimeline::record(SEMERU_TL_WINDOW_CLOSED);
 
   log_debug(semeru,rdma)("%s, Close STW windown and inform all Memory Servers. \n", __func__);
 
@@ -4821,6 +5546,1033 @@ void G1CollectedHeap::close_stw_window(){
   // log_debug(semeru,rdma)("%s, Send complete target queue done. \n", __func__);
 }
 
+bool G1CollectedHeap::wait_mem_server_state(size_t mem_id, int state) {
+  Ticks start = Ticks::now();
+  G1SemeruTimeline::record(SEMERU_TL_WAIT_START, (uint32_t)(mem_id << 8 | state));
+  bool arrived = syscall(RDMA_WAIT_MEM_SERVER, mem_id, NULL, state) == 0;
+  G1SemeruTimeline::record(SEMERU_TL_WAIT_END, (uint32_t)(mem_id << 8 | state));
+  G1SemeruEventSender::send_mem_server_wait_event(mem_id, state, arrived, start);
+  return arrived;
+}
+
+/**
+ * Semeru CPU - Let the kernel count the swapped out pages of each Region into a page array of the JVM.
+ *  The kernel pins its pages and updates the counters along with the swap in/out,
+ *  the array is read-only here. The CSet selection stops issuing a syscall per Region.
+ */
+void G1CollectedHeap::initialize_swap_out_map(){
+  size_t entries = pointer_delta(_hrm->reserved().end(), (HeapWord*)RDMA_DATA_SPACE_START_ADDR) >> HeapRegion::LogOfHRGrainWords;
+  size_t bytes   = align_up(entries * sizeof(int), os::vm_page_size());
+
+  char* map = os::reserve_memory(bytes, NULL, os::vm_page_size());
+  if (map == NULL) {
+    return;
+  }
+  os::commit_memory_or_exit(map, bytes, false, "Semeru swap out map");
+
+  if (syscall(RDMA_SWAP_OUT_MAP, HeapRegion::LogOfHRGrainBytes, map, bytes) != 0) {
+    log_debug(semeru,alloc)("%s, the kernel doesn't share the swap out map, fall back to SYS_NUM_SWAP_OUT_PAGES.", __func__);
+    os::release_memory(map, bytes);
+    return;
+  }
+  os::protect_memory(map, bytes, os::MEM_PROT_READ);
+
+  _swap_out_map         = (const volatile int*)map;
+  _swap_out_map_entries = entries;
+  log_debug(semeru,alloc)("%s, swap out map 0x%lx, 0x%lx Regions", __func__, (size_t)map, entries);
+
+  if (SemeruHotRegionSwapIns > 0) {
+    initialize_swap_in_map(entries, bytes);
+  }
+}
+
+/**
+ * Semeru CPU - The swap out map only tells how much of a Region is resident, not how hot it is.
+ *  A Region evicted and faulted back in again and again looks as cold as a dead one right after its eviction.
+ *  The kernel also counts the pages of each Region its frontswap loads read, into a second array of the JVM.
+ */
+void G1CollectedHeap::initialize_swap_in_map(size_t entries, size_t bytes) {
+  char* map = os::reserve_memory(bytes, NULL, os::vm_page_size());
+  if (map == NULL) {
+    return;
+  }
+  os::commit_memory_or_exit(map, bytes, false, "Semeru swap in map");
+
+  if (syscall(RDMA_SWAP_IN_MAP, HeapRegion::LogOfHRGrainBytes, map, bytes) != 0) {
+    log_debug(semeru,alloc)("%s, the kernel doesn't share the swap-ins, no Region is hot.", __func__);
+    os::release_memory(map, bytes);
+    return;
+  }
+  os::protect_memory(map, bytes, os::MEM_PROT_READ);
+
+  _swap_in_map   = (const volatile int*)map;
+  _swap_ins_seen = NEW_C_HEAP_ARRAY(int, entries, mtGC);
+  _swap_in_heat  = NEW_C_HEAP_ARRAY(float, entries, mtGC);
+  memset(_swap_ins_seen, 0, entries * sizeof(int));
+  memset(_swap_in_heat, 0, entries * sizeof(float));
+}
+
+/**
+ * Semeru CPU - The heat of a Region is its swap-ins of this pause interval plus half of its heat before,
+ *  a burst of faults fades out after a few pauses. Hot Regions aren't handed to the memory servers,
+ *  and their objects aren't copied to the cold Regions.
+ *  The entries past max_regions() are never committed, see initialize_swap_out_map().
+ */
+void G1CollectedHeap::update_swap_in_heat() {
+  if (_swap_in_map == NULL) {
+    return;
+  }
+
+  uint hot = 0;
+  for (uint i = 0; i < max_regions(); i++) {
+    int now = _swap_in_map[i];
+    // A reset of the kernel statistics starts it over.
+    int delta = now >= _swap_ins_seen[i] ? now - _swap_ins_seen[i] : now;
+    _swap_ins_seen[i] = now;
+    _swap_in_heat[i]  = _swap_in_heat[i] / 2 + delta;
+    if (_swap_in_heat[i] >= (float)SemeruHotRegionSwapIns) {
+      hot++;
+    }
+  }
+  log_debug(semeru,alloc)("%s, %u hot Regions", __func__, hot);
+}
+
+size_t G1CollectedHeap::swapped_out_pages(HeapRegion* hr) const {
+  size_t region_pages = HeapRegion::GrainBytes / PAGE_SIZE;
+
+  if (_swap_out_map == NULL) {
+    return syscall(SYS_NUM_SWAP_OUT_PAGES, (size_t)hr->bottom(), HeapRegion::GrainBytes);
+  }
+
+  size_t index = pointer_delta(hr->bottom(), (HeapWord*)RDMA_DATA_SPACE_START_ADDR) >> HeapRegion::LogOfHRGrainWords;
+  assert(index < _swap_out_map_entries, "Region[%u] is out of the swap out map", hr->hrm_index());
+
+  // The counter can be off by the pages in flight, keep it in [0, region_pages].
+  int swapped_out = _swap_out_map[index];
+  return MIN2((size_t)MAX2(swapped_out, 0), region_pages);
+}
+
+/**
+ * Semeru CPU - A sparse access to a cold Region, e.g. a probe of a large hash table, swaps in
+ *  a whole page for a few bytes and the page pushes a hot one out of the local cache.
+ *  Read the bytes by one small RDMA read instead, RDMA_PEEK, the page stays on the memory server.
+ *
+ *  Only the old and humongous Regions with at least SemeruRemoteReadEvictedPercent of their pages
+ *  swapped out are peeked, the kernel still answers 1 for a resident page.
+ */
+bool G1CollectedHeap::semeru_peek(const void* addr, void* buf, size_t size) {
+  if (!is_in_reserved(addr) ||
+      align_down((uintptr_t)addr, PAGE_SIZE) != align_down((uintptr_t)addr + size - 1, PAGE_SIZE)) {
+    return false;
+  }
+
+  HeapRegion* hr = heap_region_containing(addr);
+  if (!hr->is_old() && !hr->is_humongous()) {
+    return false;
+  }
+  if (swapped_out_pages(hr) * 100 < SemeruRemoteReadEvictedPercent * (HeapRegion::GrainBytes / PAGE_SIZE)) {
+    return false;
+  }
+
+  int ret = semeru_cp_peek((void*)addr, buf, size);
+  if (ret < 0) {
+    log_debug(semeru,rdma)("%s, peek " SIZE_FORMAT " bytes at 0x%lx of Region[%u] failed, load it.",
+                           __func__, size, (size_t)addr, hr->hrm_index());
+  }
+  return ret == 0;
+}
+
+/**
+ * Semeru CPU - Called by the compiled array loads in a loop, once per page of elements, with the address
+ *  SemeruLoopPrefetchPages pages ahead, see Parse::semeru_loop_prefetch(). The scan keeps that many reads
+ *  on the fly instead of faulting every page in one by one.
+ *  The swap out map is the residency check, the syscall is only paid in the Regions with swapped out pages.
+ *  addr may be past the end of the array, a wasted read at most.
+ */
+void G1CollectedHeap::semeru_loop_prefetch(const void* addr) {
+  if (_swap_out_map == NULL || !is_in_reserved(addr)) {
+    return;
+  }
+
+  size_t index = pointer_delta(addr, (void*)RDMA_DATA_SPACE_START_ADDR, 1) >> HeapRegion::LogOfHRGrainBytes;
+  if (index >= _swap_out_map_entries || _swap_out_map[index] <= 0) {
+    return;
+  }
+
+  syscall(RDMA_FETCH_ASYNC, 0, (char*)align_down((uintptr_t)addr, PAGE_SIZE), PAGE_SIZE);
+}
+
+class G1YoungSwappedOutPagesClosure : public HeapRegionClosure {
+  G1CollectedHeap* _g1h;
+  uint   _young_length;
+  size_t _swapped_out_pages;
+public:
+  G1YoungSwappedOutPagesClosure(G1CollectedHeap* g1h) : _g1h(g1h), _young_length(0), _swapped_out_pages(0) { }
+
+  bool do_heap_region(HeapRegion* hr) {
+    if (hr->is_young()) {
+      _young_length++;
+      _swapped_out_pages += _g1h->swapped_out_pages(hr);
+    }
+    return false;
+  }
+
+  uint   young_length()      const { return _young_length; }
+  size_t swapped_out_pages() const { return _swapped_out_pages; }
+};
+
+/**
+ * Semeru CPU - Eden and survivors swapped out to the memory server are faulted in again by the evacuation.
+ *  Sampled at the pause start, before the evacuation touches them. Only with the shared swap out map,
+ *  the syscall per Region is too slow for every pause.
+ */
+void G1CollectedHeap::record_young_residency() {
+  if (!SemeruCacheYoungSizing || _swap_out_map == NULL) {
+    return;
+  }
+
+  G1YoungSwappedOutPagesClosure cl(this);
+  collection_set()->iterate(&cl);
+
+  int on_demand_swapins = syscall(SYS_NUM_ON_DEMAND_SWAPIN);
+  g1_policy()->record_semeru_young_residency(cl.young_length(), cl.swapped_out_pages(), (size_t)MAX2(on_demand_swapins, 0));
+}
+
+class G1SamplePageResidencyClosure : public HeapRegionClosure {
+  G1CollectedHeap* _g1h;
+  unsigned char*   _page_residency;
+  bool*            _sampled;
+  uint             _sampled_regions;
+public:
+  G1SamplePageResidencyClosure(G1CollectedHeap* g1h, unsigned char* page_residency, bool* sampled) :
+    _g1h(g1h), _page_residency(page_residency), _sampled(sampled), _sampled_regions(0) { }
+
+  bool do_heap_region(HeapRegion* hr) {
+    if (_g1h->swapped_out_pages(hr) == 0) {
+      return false;
+    }
+    size_t page = pointer_delta(hr->bottom(), _g1h->reserved_region().start()) / (PAGE_SIZE / HeapWordSize);
+    if (mincore(hr->bottom(), HeapRegion::GrainBytes, _page_residency + page) == 0) {
+      _sampled[hr->hrm_index()] = true;
+      _sampled_regions++;
+    }
+    return false;
+  }
+
+  uint sampled_regions() const { return _sampled_regions; }
+};
+
+/**
+ * Semeru CPU - The kernel swaps out the least recently accessed pages, by the page table's access bits.
+ *  A page still swapped out at the pause start holds the objects the mutators haven't touched since,
+ *  the cold ones. The evacuation copies them into the cold old Regions, see G1Allocator::cold_old_attempt_allocation(),
+ *  so the hot objects don't keep their pages in the local cache. The cold Regions are evicted again as a whole,
+ *  and are picked into the memory server CSet by their cache ratio.
+ *  The optional Regions added later are not sampled, their objects are taken as hot.
+ */
+void G1CollectedHeap::sample_page_residency() {
+  if (_page_residency_sampled == NULL) {
+    return;
+  }
+
+  memset(_page_residency_sampled, 0, max_regions() * sizeof(bool));
+  G1SamplePageResidencyClosure cl(this, _page_residency, _page_residency_sampled);
+  collection_set()->iterate(&cl);
+
+  log_debug(semeru, alloc)("%s, sampled the page residency of 0x%x CSet Regions", __func__, cl.sampled_regions());
+}
+
+class G1PrefetchCSetClosure : public HeapRegionClosure {
+  G1CollectedHeap* _g1h;
+  size_t _budget_pages;
+  size_t _issued_pages;
+  uint   _prefetched_regions;
+public:
+  G1PrefetchCSetClosure(G1CollectedHeap* g1h, size_t budget_pages) :
+    _g1h(g1h), _budget_pages(budget_pages), _issued_pages(0), _prefetched_regions(0) { }
+
+  bool do_heap_region(HeapRegion* hr) {
+    // Only the mostly swapped out Regions, the others are faulted in by the kernel's own prefetch.
+    if (_g1h->swapped_out_pages(hr) * 2 < HeapRegion::GrainBytes / PAGE_SIZE || hr->top() == hr->bottom()) {
+      return false;
+    }
+
+    int issued = syscall(RDMA_PREFETCH_RANGE, 0, hr->bottom(), pointer_delta(hr->top(), hr->bottom(), 1));
+    if (issued < 0) {
+      return true;  // the kernel doesn't prefetch
+    }
+    _issued_pages += issued;
+    _prefetched_regions++;
+    return _issued_pages >= _budget_pages;
+  }
+
+  size_t issued_pages()       const { return _issued_pages; }
+  uint   prefetched_regions() const { return _prefetched_regions; }
+};
+
+/**
+ * Semeru CPU - The evacuation faults in the swapped out pages of the CSet one by one.
+ *  Read them into the kernel's prefetch cache right after the CSet is chosen, the RDMA reads overlap
+ *  the rest of the pause setup, and the faults copy the data locally. Bounded by -XX:SemeruCSetPrefetchPages.
+ */
+void G1CollectedHeap::prefetch_collection_set() {
+  if (SemeruCSetPrefetchPages == 0 || _swap_out_map == NULL) {
+    return;
+  }
+
+  G1PrefetchCSetClosure cl(this, SemeruCSetPrefetchPages);
+  collection_set()->iterate(&cl);
+
+  log_debug(semeru, rdma)("%s, prefetch 0x%lx pages of 0x%x CSet Regions", __func__, cl.issued_pages(), cl.prefetched_regions());
+}
+
+void G1CollectedHeap::note_cold_region_retired(HeapRegion* hr) {
+  if (_cold_regions_to_evict == NULL || !SemeruBulkEvictColdRegions) {
+    return;
+  }
+  assert(_num_cold_regions_to_evict < max_regions(), "Region[%u] is retired twice", hr->hrm_index());
+  _cold_regions_to_evict[_num_cold_regions_to_evict++] = hr->hrm_index();
+}
+
+/**
+ * Semeru CPU - The application knows the objects it won't touch for a while, e.g. a finished cache segment.
+ *  Their old Region is evicted with the cold Regions of the next pause. Each Region is queued once.
+ */
+bool G1CollectedHeap::hint_cold_region(HeapRegion* hr) {
+  if (_cold_hints == NULL || !hr->is_old()) {
+    return false;
+  }
+  uint index = hr->hrm_index();
+  if (_cold_hinted[index] || Atomic::cmpxchg(true, &_cold_hinted[index], false) != false) {
+    return true;
+  }
+  uint slot = Atomic::add(1u, &_num_cold_hints) - 1;
+  assert(slot < max_regions(), "Region[%u] is hinted twice", index);
+  _cold_hints[slot] = index;
+  return true;
+}
+
+static int compare_region_index(uint* a, uint* b) {
+  return *a < *b ? -1 : (*a > *b ? 1 : 0);
+}
+
+/**
+ * Semeru CPU - The cold Regions only hold the objects swapped out at the pause start,
+ *  their pages are going to be swapped out again. Evict them right away instead of waiting for the kswapd's LRU.
+ *  The kernel unmaps and writes the pages of each run in the background, and frees them.
+ *  The evictions of the previous pause are waited first, one batch is in flight at most.
+ */
+void G1CollectedHeap::evict_cold_regions() {
+  if (_cold_regions_to_evict == NULL) {
+    return;
+  }
+
+  if (_cold_regions_evicting) {
+    int not_paged_out = syscall(RDMA_EVICT_WAIT, 0, NULL, 0);
+    log_debug(semeru,alloc)("%s, the previous evictions left %d pages resident.", __func__, not_paged_out);
+    _cold_regions_evicting = false;
+  }
+
+  // The hinted Regions, unless they were freed or pinned since.
+  if (_cold_hints != NULL) {
+    uint num_hints = _num_cold_hints;
+    for (uint i = 0; i < num_hints; i++) {
+      uint index = _cold_hints[i];
+      _cold_hinted[index] = false;
+      if (region_at(index)->is_old() && !_hrm->is_pinned_in_dram(index)) {
+        _cold_regions_to_evict[_num_cold_regions_to_evict++] = index;
+      }
+    }
+    _num_cold_hints = 0;
+  }
+
+  if (_num_cold_regions_to_evict == 0) {
+    return;
+  }
+
+  QuickSort::sort(_cold_regions_to_evict, _num_cold_regions_to_evict, compare_region_index, false);
+
+  uint num_runs = 0;
+  for (uint i = 0; i < _num_cold_regions_to_evict; ) {
+    uint first = _cold_regions_to_evict[i];
+    uint last = first;
+    for (i++; i < _num_cold_regions_to_evict && _cold_regions_to_evict[i] <= last + 1; i++) {
+      last = _cold_regions_to_evict[i];   // a retired Region can be hinted too
+    }
+
+    HeapRegion* hr = region_at(first);
+    if (syscall(RDMA_EVICT, 1 /* async */, hr->bottom(), (size_t)(last - first + 1) * HeapRegion::GrainBytes) != 0) {
+      log_debug(semeru,alloc)("%s, can't evict Region[%u, %u], left to the kswapd.", __func__, first, last);
+      continue;
+    }
+    _cold_regions_evicting = true;
+    num_runs++;
+  }
+
+  log_debug(semeru,alloc)("%s, evict 0x%x cold Regions in 0x%x runs.", __func__, _num_cold_regions_to_evict, num_runs);
+  _num_cold_regions_to_evict = 0;
+}
+
+/**
+ * Semeru CPU - Grant the fully evicted Regions of the memory server CSet for the concurrent compaction.
+ *
+ * 1) The kernel fences the Region first, the swap-ins and swap-outs after this point are recorded by page.
+ * 2) Then the Region is checked to be fully evicted. A Region with resident pages is released.
+ * The memory server only reads the grants after the flags are sent, at the end of close_stw_window().
+ */
+void G1CollectedHeap::grant_concurrent_compaction(){
+  flags_of_cpu_server_state* flags = cpu_server_flags();
+  size_t num_granted = 0;
+
+  flags->_num_granted_regions = 0;
+  if(!SemeruConcurrentCompact){
+    return;
+  }
+  flags->_region_state_atomics = SemeruRegionStateAtomics;
+
+  for(size_t mem_id = 0; mem_id < SemeruMemServerNum; mem_id++){
+    size_t num_mem_cset = *(_recv_mem_server_cset->num_received_regions(mem_id));
+    for(size_t i = 0; i < num_mem_cset && num_granted < SEMERU_MAX_GRANTED_REGIONS; i++){
+      HeapRegion* hr = region_at(_recv_mem_server_cset->get(mem_id, i));
+      if(hr->is_humongous()){
+        continue;
+      }
+
+      if(syscall(RDMA_REGION_FENCE, SEMERU_FENCE_GRANT, hr->bottom(), HeapRegion::GrainBytes) != 0){
+        log_debug(semeru,rdma)("%s, can't fence Region[%u], the kernel fence table is full.", __func__, hr->hrm_index());
+        break;
+      }
+
+      if(swapped_out_pages(hr) < HeapRegion::GrainBytes/PAGE_SIZE ||
+         (SemeruRegionStateAtomics && !cas_region_state(hr, 1 << region_state_words::cpu_owned, region_state_words::granted, true))){
+        syscall(RDMA_REGION_FENCE, SEMERU_FENCE_RELEASE, hr->bottom(), HeapRegion::GrainBytes);
+        continue;
+      }
+
+      flags->_granted_regions[num_granted] = hr->hrm_index();
+      flags->_grant_state[num_granted]     = flags_of_cpu_server_state::grant_open;
+      num_granted++;
+    }
+  }
+
+  OrderAccess::storestore();
+  flags->_num_granted_regions = num_granted;
+  log_debug(semeru,rdma)("%s, grant %lu fully evicted Regions for the concurrent compaction.", __func__, num_granted);
+}
+
+/**
+ * Semeru CPU - Close the grants at the start of the STW window, before the flags are sent.
+ * The faults on the committed Regions are blocked by the kernel until released.
+ *
+ * A grant the memory server never claimed is revoked by its state word instead, it has no image to commit.
+ * Its Region isn't blocked, nor waited for at the release, nor synced.
+ * A Region whose pages were swapped in and written back since the grant is committed with its written pages,
+ * the memory server copies the objects on them into its image again.
+ */
+void G1CollectedHeap::close_concurrent_compaction_grants(){
+  flags_of_cpu_server_state* flags = cpu_server_flags();
+  size_t num_reconciled = 0;
+
+  for(size_t i = 0; i < flags->_num_granted_regions; i++){
+    HeapRegion* hr = region_at(flags->_granted_regions[i]);
+    flags->_num_reconciled[i] = 0;
+
+    // Only a claimable word, the memory server doesn't claim by the CPU atomics without IBV_ATOMIC_GLOB.
+    if(SemeruRegionStateAtomics &&
+       (region_state_words::flags_of(_region_states->word(hr->hrm_index())) & region_state_words::claimable) &&
+       cas_region_state(hr, 1 << region_state_words::granted, region_state_words::cpu_owned, false)){
+      syscall(RDMA_REGION_FENCE, SEMERU_FENCE_RELEASE, hr->bottom(), HeapRegion::GrainBytes);
+      flags->_grant_state[i] = flags_of_cpu_server_state::grant_revoked;
+      log_debug(semeru,rdma)("%s, Region[%u] grant unclaimed, revoked.", __func__, hr->hrm_index());
+      continue;
+    }
+
+    int intact = syscall(RDMA_REGION_FENCE, SEMERU_FENCE_CLOSE, hr->bottom(), HeapRegion::GrainBytes);
+    if(intact == 2){
+      semeru_fence_written written;
+      written.start = (uint64_t)(uintptr_t)hr->bottom();
+      bool reconcilable = syscall(RDMA_REGION_FENCE, SEMERU_FENCE_WRITTEN, &written, sizeof(written)) == 0 &&
+                          num_reconciled + written.nr_pages <= SEMERU_MAX_RECONCILED_PAGES;
+      // A written page may stay in the swap cache, its next access would skip the memory server.
+      for(uint32_t p = 0; reconcilable && p < written.nr_pages; p++){
+        reconcilable = semeru_cp_invalidate((char*)hr->bottom() + (size_t)written.pages[p] * PAGE_SIZE, PAGE_SIZE) == 0;
+      }
+      if(!reconcilable){
+        syscall(RDMA_REGION_FENCE, SEMERU_FENCE_RELEASE, hr->bottom(), HeapRegion::GrainBytes);
+        intact = 0;
+      }else{
+        flags->_reconciled_first[i] = (uint16_t)num_reconciled;
+        flags->_num_reconciled[i]   = (uint16_t)written.nr_pages;
+        for(uint32_t p = 0; p < written.nr_pages; p++){
+          flags->_reconciled_pages[num_reconciled++] = written.pages[p];
+        }
+      }
+    }
+    flags->_grant_state[i] = intact >= 1 ? flags_of_cpu_server_state::grant_committed : flags_of_cpu_server_state::grant_revoked;
+
+    log_debug(semeru,rdma)("%s, Region[%u] grant %s, 0x%x pages to reconcile.", __func__, hr->hrm_index(),
+                           intact >= 1 ? "committed" : "revoked", (uint)flags->_num_reconciled[i]);
+  }
+}
+
+/**
+ * Semeru CPU - The memory servers copy the committed images back before they push MEM_SERVER_NOTIFY_COMPACT_START.
+ * Release the committed Regions after that, before any GC thread touches the heap.
+ *  A memory server silent for SemeruConcurrentCompactCommitWaits notification timeouts is taken as lost,
+ *  its Regions are released anyway rather than blocking the pause and the faults on them.
+ */
+void G1CollectedHeap::release_concurrent_compaction_grants(){
+  flags_of_cpu_server_state* flags = cpu_server_flags();
+  bool waited[MAX_NUM_OF_MEMORY_SERVER] = { false };
+  uint waits[MAX_NUM_OF_MEMORY_SERVER] = { 0 };
+
+  for(size_t i = 0; i < flags->_num_granted_regions; i++){
+    if(flags->_grant_state[i] != flags_of_cpu_server_state::grant_committed){
+      continue;   // dropped by the kernel at close.
+    }
+
+    HeapRegion* hr = region_at(flags->_granted_regions[i]);
+    int mem_id = hr->region_to_memory_server_mapping();
+    while(!waited[mem_id] && waits[mem_id] < SemeruConcurrentCompactCommitWaits){
+      waited[mem_id] = wait_mem_server_state(mem_id, MEM_SERVER_NOTIFY_COMPACT_START);
+      if(!waited[mem_id] && ++waits[mem_id] < SemeruConcurrentCompactCommitWaits){
+        log_warning(semeru,rdma)("%s, memory server[%d] doesn't commit the concurrent compaction, keep waiting.", __func__, mem_id);
+      } else if(!waited[mem_id]){
+        log_error(semeru,rdma)("%s, memory server[%d] doesn't commit the concurrent compaction in %u waits, release Region[%u] anyway.",
+                               __func__, mem_id, waits[mem_id], hr->hrm_index());
+      }
+    }
+
+    syscall(RDMA_REGION_FENCE, SEMERU_FENCE_RELEASE, hr->bottom(), HeapRegion::GrainBytes);
+  }
+
+  // Take all the granted Regions back. The committed ones are copied back already,
+  // an image still being built for a revoked one can't be finished any more.
+  if(SemeruRegionStateAtomics){
+    const uint taken = (1 << region_state_words::granted) | (1 << region_state_words::compacting) | (1 << region_state_words::compacted);
+    for(size_t i = 0; i < flags->_num_granted_regions; i++){
+      cas_region_state(region_at(flags->_granted_regions[i]), taken, region_state_words::cpu_owned, false);
+    }
+  }
+}
+
+/**
+ * Semeru CPU - The local word is the last value returned by the RDMA CAS, the expected value of the next one.
+ *  A CAS failed only by the flags or the sequence, e.g. the memory server set the word claimable, is retried.
+ */
+bool G1CollectedHeap::cas_region_state(HeapRegion* hr, uint from_states, uint64_t to_state, bool bump_seq){
+  volatile uint64_t* word = _region_states->word_addr(hr->hrm_index());
+  int mem_id = hr->region_to_memory_server_mapping();
+  uint64_t expected = *word;
+
+  while(region_state_words::state_of(expected) < 32 && ((from_states >> region_state_words::state_of(expected)) & 1)){
+    uint64_t swap = region_state_words::word_of(to_state, region_state_words::flags_of(expected),
+                                                region_state_words::seq_of(expected) + (bump_seq ? 1 : 0));
+    uint64_t old;
+    if(semeru_cp_cas(mem_id, word, expected, swap, &old) != 0){
+      log_warning(semeru,rdma)("%s, RDMA CAS on the state word of Region[%u] failed.", __func__, hr->hrm_index());
+      return false;
+    }
+
+    if(old == expected){
+      *word = swap;
+      return true;
+    }
+    *word = old;
+    expected = old;
+  }
+  return false;
+}
+
+/**
+ * Semeru CPU - The committed Regions were compacted by the memory servers, adopt their new top and BOT.
+ * 1) Read the MemoryToCPUAtGC of the committed Regions, it records the BOT cards each memory server rebuilt.
+ * 2) Read only these cards, the entries below the first moved object and above the new top are unchanged or unused.
+ * Both are vectored reads, up to SEMERU_RDMA_IOV_MAX entries of any memory servers per read.
+ */
+void G1CollectedHeap::sync_compacted_region_bots(){
+  flags_of_cpu_server_state* flags = cpu_server_flags();
+  semeru_rdma_iovec* iov = NEW_C_HEAP_ARRAY(semeru_rdma_iovec, SEMERU_RDMA_IOV_MAX, mtGC);
+  size_t synced_cards = 0;
+  int nr_iov = 0;
+
+  for(int round = 0; round < 2; round++){
+    for(size_t i = 0; i < flags->_num_granted_regions; i++){
+      if(flags->_grant_state[i] != flags_of_cpu_server_state::grant_committed){
+        continue;
+      }
+
+      HeapRegion* hr = region_at(flags->_granted_regions[i]);
+      if(round == 0){
+        iov[nr_iov].mem_server_id = hr->region_to_memory_server_mapping();
+        iov[nr_iov].write_type    = 0;  // data
+        iov[nr_iov].start_addr    = (char*)hr->_mem_to_cpu_gc;
+        iov[nr_iov].size          = sizeof(MemoryToCPUAtGC);
+        nr_iov++;
+      }else if(hr->bot_update_iovec(iov + nr_iov) > 0){
+        synced_cards += iov[nr_iov].size;
+        nr_iov++;
+      }
+
+      if(nr_iov == SEMERU_RDMA_IOV_MAX){
+        if(round == 0){
+          HeapRegion::read_mem_to_cpu_gc(iov, nr_iov);
+        }else{
+          guarantee(semeru_cp_readv(iov, nr_iov) == 0, "%s, RDMA vectored read of %d entries failed.", __func__, nr_iov);
+        }
+        nr_iov = 0;
+      }
+    }
+
+    if(nr_iov > 0){
+      if(round == 0){
+        HeapRegion::read_mem_to_cpu_gc(iov, nr_iov);
+      }else{
+        guarantee(semeru_cp_readv(iov, nr_iov) == 0, "%s, RDMA vectored read of %d entries failed.", __func__, nr_iov);
+      }
+      nr_iov = 0;
+    }
+  }
+  FREE_C_HEAP_ARRAY(semeru_rdma_iovec, iov);
+
+  for(size_t i = 0; i < flags->_num_granted_regions; i++){
+    if(flags->_grant_state[i] == flags_of_cpu_server_state::grant_committed){
+      HeapRegion* hr = region_at(flags->_granted_regions[i]);
+      hr->apply_bot_update();
+      if(SemeruSelectiveInvalidation){
+        hr->invalidate_rewritten_pages();
+      }
+      // A fault of the sampled pages reads them from the memory server, the same path as any swap-in.
+      if(SemeruChecksumSamplePercent > 0){
+        guarantee(hr->verify_compaction_checksums(),
+                  "Region[%u] differs from its compaction on memory server[%d], RDMA or compaction corruption.",
+                  hr->hrm_index(), hr->region_to_memory_server_mapping());
+      }
+    }
+  }
+
+  log_debug(semeru,rdma)("%s, read 0x%lx BOT cards of the committed Regions.", __func__, synced_cards);
+}
+
+/**
+ * Semeru CPU - Take the Regions compacted by the memory servers since the last STW window.
+ * 1) Read the reserve and head lines of each ring, the slots in front of the head are published.
+ * 2) Read only the slots of [tail, head), twice if they wrap around the ring.
+ * 3) Write back the tail, the compaction workers reuse the read slots.
+ */
+void G1CollectedHeap::drain_compacted_region_rings(){
+  compacted_region_ring* ring = _compacted_region_ring;
+  size_t num_dropped = 0;
+  _num_mem_compacted_regions = 0;
+
+  for(uint mem_id = 0; mem_id < SemeruMemServerNum; mem_id++){
+    size_t read_size = (char*)&ring->_tail - (char*)&ring->_reserved;
+    guarantee(semeru_cp_read(mem_id, (void*)&ring->_reserved, read_size) == 0,
+              "%s, read the compacted Region ring of memory server[%u] failed.", __func__, mem_id);
+
+    size_t tail = _compacted_region_ring_tails[mem_id];
+    size_t head = ring->_head;
+    guarantee(head - tail <= ring->_capacity, "%s, memory server[%u] published 0x%lx slots over its ring of 0x%lx.",
+              __func__, mem_id, head - tail, ring->_capacity);
+    num_dropped += ring->_dropped;
+    if(head == tail){
+      continue;
+    }
+
+    size_t first_len, second_len;
+    ring->ranges_of(tail, head, &first_len, &second_len);
+    guarantee(semeru_cp_read(mem_id, (void*)(ring->_slots + ring->slot_of(tail)), first_len * sizeof(uint32_t)) == 0,
+              "%s, read the compacted Regions of memory server[%u] failed.", __func__, mem_id);
+    if(second_len > 0){
+      guarantee(semeru_cp_read(mem_id, (void*)ring->_slots, second_len * sizeof(uint32_t)) == 0,
+                "%s, read the compacted Regions of memory server[%u] failed.", __func__, mem_id);
+    }
+
+    for(size_t pos = tail; pos < head; pos++){
+      _mem_compacted_regions[_num_mem_compacted_regions++] = ring->_slots[ring->slot_of(pos)];
+    }
+
+    _compacted_region_ring_tails[mem_id] = head;
+    ring->_tail = head;
+    guarantee(semeru_cp_write(mem_id, (void*)&ring->_tail, sizeof(size_t)) == 0,
+              "%s, write back the tail of memory server[%u] failed.", __func__, mem_id);
+  }
+
+  log_debug(semeru,rdma)("%s, drained %u compacted Regions, %lu dropped on full rings.", __func__,
+                         _num_mem_compacted_regions, num_dropped);
+}
+
+/**
+ * Semeru CPU - -XX:+SemeruSelectiveInvalidation, the local copies of the compacted Regions are stale
+ *  only in the pages the memory servers rewrote, not the whole Region.
+ * 1) Read the MemoryToCPUAtGC of the Regions drained from the rings, for their rewritten page ranges.
+ * 2) RDMA_INVALIDATE drops the local pages and swap cache pages of each range, the next access swaps them in.
+ *    The other pages of the Region stay cached.
+ * The committed grants already dropped theirs in sync_compacted_region_bots(), their ranges are consumed.
+ */
+void G1CollectedHeap::invalidate_rewritten_pages(){
+  semeru_rdma_iovec* iov = NEW_C_HEAP_ARRAY(semeru_rdma_iovec, SEMERU_RDMA_IOV_MAX, mtGC);
+  size_t num_regions = 0;
+  size_t num_left = 0;
+  uint done = 0;
+  int nr_iov = 0;
+
+  for(uint i = 0; i < _num_mem_compacted_regions; i++){
+    HeapRegion* hr = region_at(_mem_compacted_regions[i]);
+    iov[nr_iov].mem_server_id = hr->region_to_memory_server_mapping();
+    iov[nr_iov].write_type    = 0;  // data
+    iov[nr_iov].start_addr    = (char*)hr->_mem_to_cpu_gc;
+    iov[nr_iov].size          = sizeof(MemoryToCPUAtGC);
+
+    if(++nr_iov == SEMERU_RDMA_IOV_MAX || i + 1 == _num_mem_compacted_regions){
+      HeapRegion::read_mem_to_cpu_gc(iov, nr_iov);
+      nr_iov = 0;
+
+      for(; done <= i; done++){
+        HeapRegion* r = region_at(_mem_compacted_regions[done]);
+        if(r->_mem_to_cpu_gc->_num_rewritten > 0){
+          num_left += r->invalidate_rewritten_pages();
+          num_regions++;
+        }
+      }
+    }
+  }
+  FREE_C_HEAP_ARRAY(semeru_rdma_iovec, iov);
+
+  log_debug(semeru,rdma)("%s, rewritten pages of %lu compacted Regions dropped, 0x%lx pages left mapped.", __func__,
+                         num_regions, num_left);
+}
+
+/**
+ * Semeru CPU - Relay the targets the memory servers' concurrent marking found out of the Regions they traced.
+ *  The memory servers aren't connected to each other, each one appends its targets to its own outbox.
+ * 1) Read the index lines of each outbox, then only the targets of [tail, head), twice if they wrap around.
+ * 2) Mark each target into the target queue of its Region, the queue goes to the owning memory server
+ *    with the Region's CSet dispatch, and the target is traced as a root of the Region.
+ * 3) Write back the tail, the CM tasks reuse the read slots.
+ *
+ * A target is only valid until its Region moves. The Regions compacted since the last window are drained
+ * just before, their targets are dropped. The targets relayed earlier are reset with the Region's target queue.
+ */
+void G1CollectedHeap::relay_mark_messages(){
+  mark_message_ring* ring = _mark_messages;
+  size_t num_relayed = 0;
+  size_t num_skipped = 0;
+  size_t num_dropped = 0;
+
+  bool* moved = NEW_C_HEAP_ARRAY(bool, max_regions(), mtGC);
+  memset(moved, 0, max_regions() * sizeof(bool));
+  for(uint i = 0; i < _num_mem_compacted_regions; i++){
+    if(_mem_compacted_regions[i] < max_regions()){
+      moved[_mem_compacted_regions[i]] = true;
+    }
+  }
+
+  for(uint mem_id = 0; mem_id < SemeruMemServerNum; mem_id++){
+    size_t read_size = (char*)&ring->_tail - (char*)&ring->_reserved;
+    guarantee(semeru_cp_read(mem_id, (void*)&ring->_reserved, read_size) == 0,
+              "%s, read the mark messages of memory server[%u] failed.", __func__, mem_id);
+
+    size_t tail = _mark_message_tails[mem_id];
+    size_t head = ring->_head;
+    guarantee(head - tail <= SEMERU_MARK_MESSAGES, "%s, memory server[%u] published 0x%lx mark messages over its ring.",
+              __func__, mem_id, head - tail);
+    num_dropped += ring->_dropped;
+    if(head == tail){
+      continue;
+    }
+
+    size_t first_len, second_len;
+    mark_message_ring::ranges_of(tail, head, &first_len, &second_len);
+    guarantee(semeru_cp_read(mem_id, (void*)(ring->_targets + mark_message_ring::slot_of(tail)), first_len * sizeof(HeapWord*)) == 0,
+              "%s, read the mark messages of memory server[%u] failed.", __func__, mem_id);
+    if(second_len > 0){
+      guarantee(semeru_cp_read(mem_id, (void*)ring->_targets, second_len * sizeof(HeapWord*)) == 0,
+                "%s, read the mark messages of memory server[%u] failed.", __func__, mem_id);
+    }
+
+    for(size_t pos = tail; pos < head; pos++){
+      HeapWord* target = ring->_targets[mark_message_ring::slot_of(pos)];
+      HeapRegion* hr = is_in_g1_reserved(target) ? region_at_or_null(addr_to_region(target)) : NULL;
+      if(hr == NULL || moved[hr->hrm_index()] || hr->is_free() || !hr->records_target_marks() || target >= hr->top()){
+        num_skipped++;
+        continue;
+      }
+      if(hr->cross_region_ref_target_queue()->push(oop(target)) && SemeruConcurrentTargetQueue &&
+         hr->set_target_marks_unsent()){
+        semeru_target_queue_thread()->note_unsent_region();
+      }
+      num_relayed++;
+    }
+
+    _mark_message_tails[mem_id] = head;
+    ring->_tail = head;
+    guarantee(semeru_cp_write(mem_id, (void*)&ring->_tail, sizeof(size_t)) == 0,
+              "%s, write back the mark message tail of memory server[%u] failed.", __func__, mem_id);
+  }
+
+  FREE_C_HEAP_ARRAY(bool, moved);
+  log_debug(semeru,rdma)("%s, relayed %lu mark messages, %lu stale, %lu dropped on full outboxes.", __func__,
+                         num_relayed, num_skipped, num_dropped);
+}
+
+/**
+ * Semeru CPU - -XX:+SemeruPageAffinity, the memory servers link the pages their tracing reached from
+ *  the same root, see page_affinity_table. The kernel prefetcher reads our copy of the table.
+ *  Only the entries of the old Regions whose _affinity_version moved since the last read are read,
+ *  one entry of the vectored read per Region. A Region read while its tracing rewrites the entries
+ *  is read again by its next version, the kernel bounds the walk of a torn ring.
+ */
+void G1CollectedHeap::sync_page_affinity(){
+  semeru_rdma_iovec* iov = NEW_C_HEAP_ARRAY(semeru_rdma_iovec, SEMERU_RDMA_IOV_MAX, mtGC);
+  size_t num_regions = 0;
+  int nr_iov = 0;
+
+  for(uint i = 0; i < max_regions(); i++){
+    HeapRegion* hr = region_at_or_null(i);
+    if(hr == NULL || hr->is_free() || !hr->is_old()){
+      continue;
+    }
+
+    uint32_t version = hr->_mem_to_cpu_gc->_affinity_version;
+    if(version == hr->_synced_affinity_version){
+      continue;
+    }
+    hr->_synced_affinity_version = version;
+
+    iov[nr_iov].mem_server_id = hr->region_to_memory_server_mapping();
+    iov[nr_iov].write_type    = 0;  // data
+    iov[nr_iov].start_addr    = (char*)_page_affinity->entries_of(hr->bottom());
+    iov[nr_iov].size          = _page_affinity->bytes_of(hr->bottom(), hr->end());
+    num_regions++;
+
+    if(++nr_iov == SEMERU_RDMA_IOV_MAX){
+      guarantee(semeru_cp_readv(iov, nr_iov) == 0, "%s, RDMA vectored read of %d entries failed.", __func__, nr_iov);
+      nr_iov = 0;
+    }
+  }
+
+  if(nr_iov > 0){
+    guarantee(semeru_cp_readv(iov, nr_iov) == 0, "%s, RDMA vectored read of %d entries failed.", __func__, nr_iov);
+  }
+  FREE_C_HEAP_ARRAY(semeru_rdma_iovec, iov);
+
+  log_debug(semeru,rdma)("%s, page affinity of %lu old Regions read.", __func__, num_regions);
+}
+
+void G1CollectedHeap::clear_page_affinity(HeapRegion* hr){
+  if(!_page_affinity_shared){
+    return;
+  }
+  // Until the memory server traces the Region again.
+  hr->_synced_affinity_version = hr->_mem_to_cpu_gc->_affinity_version;
+  _page_affinity->clear(hr->bottom(), hr->end());
+}
+
+/**
+ * Semeru CPU - Take the References cleared by the memory servers, at the start of the STW window before the flags are sent.
+ * 1) Each memory server reports a chain per compacted Region, linked by the discovered fields.
+ *    Only the pending Reference part of its flags page is read, it's only written out of the window by a lagging server,
+ *    the chains before the published number are complete.
+ * 2) Link each tail to the pending list, one page of the tail is swapped in, and install the head.
+ *    The ReferenceHandler is notified at the end of the pause as for the local discovery.
+ * 3) Ack the epoch and the number of the read chains, the memory server retires them at the start of its window.
+ */
+void G1CollectedHeap::enqueue_remote_pending_references(){
+  flags_of_cpu_server_state* cpu_flags = cpu_server_flags();
+  flags_of_mem_server_state* mem_flags = mem_server_flags();
+  size_t num_enqueued = 0;
+
+  // The LRUCurrentHeapPolicy, see LRUCurrentHeapPolicy::setup().
+  cpu_flags->_remote_ref_processing = true;
+  cpu_flags->_soft_ref_clock        = java_lang_ref_SoftReference::clock();
+  cpu_flags->_soft_ref_max_interval = (jlong)(Universe::get_heap_free_at_last_gc() / M) * SoftRefLRUPolicyMSPerMB;
+
+  for(uint mem_id = 0; mem_id < SemeruMemServerNum; mem_id++){
+    size_t read_size = (char*)(mem_flags->_pending_ref_chains + SEMERU_MAX_PENDING_REF_CHAINS) - (char*)&mem_flags->_pending_ref_chains_epoch;
+    guarantee(semeru_cp_read(mem_id, (void*)&mem_flags->_pending_ref_chains_epoch, read_size) == 0,
+              "%s, read the pending References of memory server[%u] failed.", __func__, mem_id);
+
+    uint   epoch = mem_flags->_pending_ref_chains_epoch;
+    size_t num   = MIN2((size_t)mem_flags->_num_pending_ref_chains, (size_t)SEMERU_MAX_PENDING_REF_CHAINS);
+    size_t i     = epoch == cpu_flags->_pending_ref_chains_acked_epoch[mem_id] ? cpu_flags->_pending_ref_chains_acked[mem_id] : 0;
+
+    for( ; i < num; i++){
+      oop head = (oop)mem_flags->_pending_ref_chains[i][0];
+      oop tail = (oop)mem_flags->_pending_ref_chains[i][1];
+      if(head == NULL){
+        continue;   // dropped, the Region's compaction was revoked.
+      }
+
+      oop old = Universe::swap_reference_pending_list(head);
+      HeapAccess<AS_NO_KEEPALIVE>::oop_store_at(tail, java_lang_ref_Reference::discovered_offset, old);
+      num_enqueued++;
+    }
+
+    cpu_flags->_pending_ref_chains_acked_epoch[mem_id] = epoch;
+    cpu_flags->_pending_ref_chains_acked[mem_id]       = num;
+  }
+
+  log_debug(semeru,rdma)("%s, enqueued %lu chains of References cleared by the memory servers.", __func__, num_enqueued);
+}
+
+/**
+ * Semeru CPU - Refresh the liveness of the old Regions, instead of reading them one by one.
+ * 1) Read the liveness epoch page of each memory server, one page per server.
+ *    The page is at the same address on all the servers, so they are read and compared in turn.
+ * 2) Chain the MemoryToCPUAtGC of the old Regions whose epoch changed, one vectored RDMA read per SEMERU_RDMA_IOV_MAX.
+ *    A Region updated after its epoch is read, is read again at the next GC.
+ * The CSet selection sees the fresh _cm_scanned and alive ratio of all the old Regions.
+ *
+ * -XX:+SemeruLivenessVector reads the liveness itself instead of the epochs, see region_liveness_vector.
+ * Only the torn entries are left to the vectored read.
+ *
+ * A Region takes the epoch it's read at only after its MemoryToCPUAtGC is read consistently, see read_synced_liveness.
+ * A torn one is left unscanned and read again by the next GC. So is a memory server whose epochs can't be read.
+ */
+static void read_synced_liveness(semeru_rdma_iovec* iov, HeapRegion** regions, uint32_t* epochs, int nr_iov){
+  bool stable[SEMERU_RDMA_IOV_MAX];
+  HeapRegion::read_mem_to_cpu_gc(iov, nr_iov, stable);
+  for(int i = 0; i < nr_iov; i++){
+    if(stable[i]){
+      regions[i]->_synced_liveness_epoch = epochs[i];
+    }
+  }
+}
+
+void G1CollectedHeap::sync_region_liveness(){
+  semeru_rdma_iovec* iov = NEW_C_HEAP_ARRAY(semeru_rdma_iovec, SEMERU_RDMA_IOV_MAX, mtGC);
+  HeapRegion** regions   = NEW_C_HEAP_ARRAY(HeapRegion*, SEMERU_RDMA_IOV_MAX, mtGC);
+  uint32_t* epochs       = NEW_C_HEAP_ARRAY(uint32_t, SEMERU_RDMA_IOV_MAX, mtGC);
+  uint len = _hrm->max_length();
+  size_t num_synced = 0;
+  size_t num_copied = 0;
+  int nr_iov = 0;
+
+  for(int mem_id = 0; mem_id < (int)SemeruMemServerNum; mem_id++){
+    int ret;
+    if(SemeruLivenessVector){
+      ret = semeru_cp_read(mem_id, _liveness_vector, align_up((size_t)len * sizeof(region_liveness_vector::entry), PAGE_SIZE));
+    }else{
+      ret = semeru_cp_read(mem_id, _liveness_epochs, align_up((size_t)len * sizeof(uint32_t), PAGE_SIZE));
+    }
+    if(ret != 0){
+      log_warning(semeru,rdma)("%s, reading the liveness %s of memory server[%d] failed, %d. Its Regions keep their liveness.",
+                               __func__, SemeruLivenessVector ? "vector" : "epochs", mem_id, ret);
+      continue;
+    }
+
+    for(uint i = 0; i < len; i++){
+      if(!_hrm->is_available(i)){
+        continue;
+      }
+      HeapRegion* hr = _hrm->at(i);
+      if(hr->is_free() || !hr->is_old() || hr->region_to_memory_server_mapping() != mem_id){
+        continue;
+      }
+
+      if(SemeruLivenessVector){
+        const region_liveness_vector::entry* e = &_liveness_vector->_entries[i];
+        if(region_liveness_vector::is_stable(e)){
+          if(e->_version != hr->_synced_liveness_epoch){
+            hr->_synced_liveness_epoch              = e->_version;
+            hr->_mem_to_cpu_gc->_cm_scanned         = e->_cm_scanned != 0;
+            hr->_mem_to_cpu_gc->_marked_alive_bytes = e->_marked_alive_bytes;
+            hr->_mem_to_cpu_gc->_alive_ratio        = e->_alive_ratio;
+            num_copied++;
+          }
+          continue;
+        }
+        // Torn by the memory server, read the MemoryToCPUAtGC. The next GC takes the entry again.
+        epochs[nr_iov] = hr->_synced_liveness_epoch;
+      }else{
+        uint32_t epoch = _liveness_epochs->epoch_of(i);
+        if(epoch == hr->_synced_liveness_epoch){
+          continue;
+        }
+        epochs[nr_iov] = epoch;
+      }
+      regions[nr_iov] = hr;
+
+      iov[nr_iov].mem_server_id = mem_id;
+      iov[nr_iov].write_type    = 0;  // data
+      iov[nr_iov].start_addr    = (char*)hr->_mem_to_cpu_gc;
+      iov[nr_iov].size          = sizeof(MemoryToCPUAtGC);
+      num_synced++;
+
+      if(++nr_iov == SEMERU_RDMA_IOV_MAX){
+        read_synced_liveness(iov, regions, epochs, nr_iov);
+        nr_iov = 0;
+      }
+    }
+  }
+
+  if(nr_iov > 0){
+    read_synced_liveness(iov, regions, epochs, nr_iov);
+  }
+  FREE_C_HEAP_ARRAY(uint32_t, epochs);
+  FREE_C_HEAP_ARRAY(HeapRegion*, regions);
+  FREE_C_HEAP_ARRAY(semeru_rdma_iovec, iov);
+
+  log_debug(semeru,rdma)("%s, liveness of %lu changed old Regions from the vector, %lu read.", __func__,
+                         num_copied, num_synced);
+}
+
+class G1MarkRemoteClassLoadersClosure : public CLDClosure {
+  G1ConcurrentMark* _cm;
+  const uint64_t*   _summary;
+  size_t            _num_marked;
+
+public:
+  G1MarkRemoteClassLoadersClosure(G1ConcurrentMark* cm, const uint64_t* summary) :
+    _cm(cm), _summary(summary), _num_marked(0) { }
+
+  void do_cld(ClassLoaderData* cld) {
+    if (cld->is_the_null_class_loader_data() || !region_cld_liveness::is_set(_summary, cld)) {
+      return;
+    }
+    oop holder = cld->holder_no_keepalive();
+    if (holder != NULL && _cm->mark_in_next_bitmap(0, holder)) {
+      _num_marked++;
+    }
+  }
+
+  size_t num_marked() const { return _num_marked; }
+};
+
+/**
+ * The CPU server can't tell the class loaders of the objects in the evicted Regions without swapping them in.
+ * The memory servers hash them per Region while they trace. A loader with a set bit in any old Region
+ * is taken as alive, its holder is marked ahead of the finger and traced by the concurrent marking,
+ * so the remark unloads a loader only if neither side saw its objects.
+ */
+void G1CollectedHeap::mark_remote_class_loaders(){
+  assert(SafepointSynchronize::is_at_safepoint(), "the class loader graph is walked at the initial mark.");
+  uint64_t summary[SEMERU_CLD_BITMAP_WORDS] = { 0 };
+  uint len = _hrm->max_length();
+  size_t read_size = MIN2((size_t)len * SEMERU_CLD_BITMAP_WORDS * sizeof(uint64_t), (size_t)CLD_LIVENESS_SIZE_LIMIT);
+
+  for(int mem_id = 0; mem_id < (int)SemeruMemServerNum; mem_id++){
+    semeru_cp_read(mem_id, _cld_liveness, read_size);
+
+    for(uint i = 0; i < len; i++){
+      if(!_hrm->is_available(i)){
+        continue;
+      }
+      HeapRegion* hr = _hrm->at(i);
+      if(hr->is_free() || !(hr->is_old() || hr->is_humongous()) || hr->region_to_memory_server_mapping() != mem_id){
+        continue;
+      }
+      _cld_liveness->merge_into(i, summary);
+    }
+  }
+
+  G1MarkRemoteClassLoadersClosure cl(concurrent_mark(), summary);
+  ClassLoaderDataGraph::cld_do(&cl);
+
+  log_debug(semeru,mem_trace)("%s, marked the holders of 0x%lx class loaders alive on the memory servers.", __func__, cl.num_marked());
+}
+
 /**
  * Broadcast the evacated Region's information to other servers.
  * After Memory server receiving the data, it can start cross-region reference updating.
@@ -4839,19 +6591,159 @@ void G1CollectedHeap::send_evacuated_region_info(){
   if (len == 0) {
     return;
   }
+  // Send all the target queues by vectored writes.
+  // With the _semeru_comm_thread, the flags are queued behind them, nothing is waited here.
+  semeru_rdma_iovec* iov = NEW_C_HEAP_ARRAY(semeru_rdma_iovec, SEMERU_RDMA_IOV_MAX, mtGC);
+  int nr_iov = 0;
   for(size_t i = 0; i < len; i++) {
     HeapRegion* r = region_at(_collection_set._collection_set_regions[i]);
-    r->send_target_queue_at_gc(); 
+    if(nr_iov + HeapRegion::target_queue_iov_num > SEMERU_RDMA_IOV_MAX){
+      send_rdma_iovec(iov, nr_iov);
+      nr_iov = 0;
+    }
+    nr_iov += r->target_queue_iovec(iov + nr_iov);
   }
+  if(nr_iov){
+    send_rdma_iovec(iov, nr_iov);
+  }
+  FREE_C_HEAP_ARRAY(semeru_rdma_iovec, iov);
 
-
+  wait_cpu_server_flags_sent();
   cpu_server_flags()->_cpu_server_data_sent = true;
-  send_cpu_server_flags_to_mem_server();
+  send_cpu_server_flags_to_mem_server_async();
 
 
   log_debug(semeru,rdma)("%s, Send CPU server data done, wait on the MS to stop current compacting. \n", __func__);
 }
 
+/**
+ * Semeru CPU - Invoked by the G1SemeruTargetQueueThread, joined to the suspendible thread set.
+ *  The post-write barrier logs the cross-Region stores of the compiled code and the interpreter into the dirty card queues,
+ *  and the concurrent refinement pushes their old targets into the BitQueues. Send the pages changed since the last send
+ *  to the memory servers between the pauses, so the concurrent tracing there doesn't wait for the next pause to see them.
+ *
+ *  The marks are conservative, a resent mark only keeps its target alive one more cycle.
+ *  The pending writes are issued before a yield, the pause may reset the queues.
+ */
+uint G1CollectedHeap::send_concurrent_target_marks(SuspendibleThreadSetJoiner* sts){
+  semeru_rdma_iovec* iov = NEW_C_HEAP_ARRAY(semeru_rdma_iovec, SEMERU_RDMA_IOV_MAX, mtGC);
+  int nr_iov = 0;
+  uint sent = 0;
+
+  for(uint i = 0; i < max_regions(); i++){
+    if(sts->should_yield()){
+      if(nr_iov){
+        semeru_cp_writev(iov, nr_iov);
+        nr_iov = 0;
+      }
+      sts->yield();
+    }
+
+    HeapRegion* hr = region_at_or_null(i);
+    if(hr == NULL || !hr->claim_target_marks_unsent()){
+      continue;
+    }
+    if(!hr->is_old()){
+      continue;   // freed or reused since the refinement, its queue is reset at the pause.
+    }
+
+    if(nr_iov + HeapRegion::target_queue_iov_num > SEMERU_RDMA_IOV_MAX){
+      semeru_cp_writev(iov, nr_iov);
+      nr_iov = 0;
+    }
+    nr_iov += hr->target_queue_iovec(iov + nr_iov, true /* delta */);
+    sent++;
+  }
+  if(nr_iov){
+    semeru_cp_writev(iov, nr_iov);
+  }
+  FREE_C_HEAP_ARRAY(semeru_rdma_iovec, iov);
+
+  return sent;
+}
+
+/**
+ * Issue the iov by RDMA_WRITEV_ASYNC, the kernel copies the iov, so the caller can reuse it at return.
+ * At most one vectored write is in flight, the previous ticket is waited first.
+ * 
+ * Return the ticket of the issued write, -1 if nothing is outstanding.
+ */
+void G1CollectedHeap::send_rdma_iovec(semeru_rdma_iovec* iov, int nr_iov){
+  if(_semeru_comm_thread != NULL){
+    _semeru_comm_thread->submit_writev(iov, nr_iov);
+  }else{
+    semeru_cp_writev(iov, nr_iov);
+  }
+}
+
+void G1CollectedHeap::send_cpu_server_flags_to_mem_server(){
+  send_cpu_server_flags_to_mem_server_async();
+  wait_cpu_server_flags_sent();
+}
+
+void G1CollectedHeap::send_cpu_server_flags_to_mem_server_async(){
+  if(_semeru_comm_thread != NULL){
+    _cpu_server_flags_ticket = _semeru_comm_thread->submit_bcast(_cpu_server_flags, FLAGS_OF_CPU_SERVER_STATE_SIZE);
+    return;
+  }
+
+  int mem_id;
+  semeru_cp_bcast(_cpu_server_flags, FLAGS_OF_CPU_SERVER_STATE_SIZE);
+  for(mem_id=0; mem_id<(int)SemeruMemServerNum; mem_id ++ ){
+    ring_mem_server_doorbell(mem_id);
+  }
+}
+
+void G1CollectedHeap::wait_cpu_server_flags_sent(){
+  if(_semeru_comm_thread != NULL){
+    _semeru_comm_thread->wait(_cpu_server_flags_ticket);
+  }
+}
+
+int G1CollectedHeap::post_rdma_iovec_async(semeru_rdma_iovec* iov, int nr_iov, int prev_ticket){
+  wait_rdma_ticket(prev_ticket);
+  if(nr_iov == 0){
+    return -1;
+  }
+
+  return semeru_cp_writev_async(iov, nr_iov);
+}
+
+template <class E>
+static int append_arena_runs(G1CollectedHeap* g1h, semeru_rdma_iovec* iov, int nr_iov, int max_iov, int mem_id, int* ticket){
+  while(true){
+    int space  = max_iov - nr_iov;
+    int filled = E::dirty_runs_iovec(iov + nr_iov, space, mem_id);
+    nr_iov += filled;
+    if(filled < space){
+      return nr_iov;
+    }
+    *ticket = g1h->post_rdma_iovec_async(iov, nr_iov, *ticket);
+    nr_iov = 0;
+  }
+}
+
+/**
+ * Semeru CPU - The CPUToMemoryAtGC, MemoryToCPUAtGC and SyncBetweenMemoryAndCPU are bumped contiguously in their arenas.
+ *  The Regions placed on one memory server are mostly adjacent, so each arena is sent by a few runs,
+ *  instead of one entry per Region.
+ */
+int G1CollectedHeap::append_dirty_arena_runs(semeru_rdma_iovec* iov, int nr_iov, int max_iov, int mem_id, int* ticket){
+  nr_iov = append_arena_runs<CPUToMemoryAtGC>(this, iov, nr_iov, max_iov, mem_id, ticket);
+  nr_iov = append_arena_runs<MemoryToCPUAtGC>(this, iov, nr_iov, max_iov, mem_id, ticket);
+  nr_iov = append_arena_runs<SyncBetweenMemoryAndCPU>(this, iov, nr_iov, max_iov, mem_id, ticket);
+  return nr_iov;
+}
+
+void G1CollectedHeap::wait_rdma_ticket(int ticket){
+  if(ticket < 0){
+    return;
+  }
+
+  int ret = semeru_cp_wait(ticket);
+  guarantee(ret == 0, "%s, RDMA vectored write ticket[%d] failed.", __func__, ticket);
+}
+
 /**
  * Keep reading data until the mem_server_flags->mem_server_wait_on_exchange is ture.
  *  
@@ -4867,16 +6759,19 @@ void G1CollectedHeap::read_data_from_memory_servers(){
 
   // 1) Read the _mem_server_wait_on_data_exchange until it's true.
   // if _mem_server_wait_on_data_exchange true, means memory server stop claiming any Region and wait for data exchanging now.
+  // The memory server pushes this state, sleep until it arrives and then read the flags.
   //
+  wait_mem_server_state(0, MEM_SERVER_NOTIFY_WAIT_ON_EXCHANGE);
   while(mem_server_wait_on_exchange == false){
     read_mem_server_flags_from_mem_server();
-    regions_compacted = mem_server_flags()->_compacted_region_length;
+    drain_compacted_region_rings();
+    regions_compacted = _num_mem_compacted_regions;
     //mem_server_wait_on_exchange = mem_server_flags()->_mem_server_wait_on_data_exchange;
     mem_server_wait_on_exchange = true;
 
     //2) Read the data incrementally
     while(regions_data_received < regions_compacted){
-      region_index = mem_server_flags()->_compacted_regions[regions_data_received];
+      region_index = _mem_compacted_regions[regions_data_received];
       hr = _hrm->at(region_index);
       hr->read_info_at_gc();
 
@@ -4886,9 +6781,9 @@ void G1CollectedHeap::read_data_from_memory_servers(){
   }
 
     
-  log_debug(semeru,rdma)(" End of %s, compacted_region num 0x%lx, mem_wait_on_exchange ? %d, mem_on_compact ? %d ", 
+  log_debug(semeru,rdma)(" End of %s, compacted_region num 0x%x, mem_wait_on_exchange ? %d, mem_on_compact ? %d ", 
                                                       __func__,
-                                                      mem_server_flags()->_compacted_region_length, 
+                                                      _num_mem_compacted_regions, 
                                                       mem_server_flags()->_mem_server_wait_on_data_exchange, 
                                                       mem_server_flags()->_is_mem_server_in_compact);
 
@@ -4934,18 +6829,65 @@ void G1CollectedHeap::send_uncompacted_region_queue(){
  * 
  */
 void G1CollectedHeap::busy_wait_the_end_of_mem_server_compaction(){
-  
+  bool   done[MAX_NUM_OF_MEMORY_SERVER] = { false };
+  size_t pending = 0;
+
   log_debug(semeru,rdma)("%s, wait the end of cross_region update of Memory Servers", __func__);
 
-  do{
-    // check the _mem_server_wait_on_data_exchange agian.
-      read_mem_server_flags_from_mem_server();
-  }while(mem_server_flags()->_is_mem_server_in_compact);
+  // Each memory server pushes the end of its own compaction, only read the flags of the ones timed out.
+  for(size_t mem_id = 0; mem_id < SemeruMemServerNum; mem_id++){
+    done[mem_id] = wait_mem_server_state(mem_id, MEM_SERVER_NOTIFY_COMPACT_DONE);
+    if(!done[mem_id]){
+      pending++;
+    }
+  }
+
+  // Past the budget, the memory servers stop at the end of the Regions they are compacting.
+  // The rest of the wait is at most one Region, report the overrun.
+  bool overrun = false;
+  while(pending > 0){
+    for(size_t mem_id = 0; mem_id < SemeruMemServerNum; mem_id++){
+      if(done[mem_id]){
+        continue;
+      }
+      // check the _is_mem_server_in_compact of this memory server agian.
+      read_mem_server_flags_from_mem_server(mem_id);
+      if(!mem_server_flags()->_is_mem_server_in_compact){
+        done[mem_id] = true;
+        pending--;
+      }
+    }
+    if(!overrun && _mem_server_stw_deadline > 0.0 && os::elapsedTime() > _mem_server_stw_deadline){
+      overrun = true;
+      log_info(semeru,rdma)("%s, the pause budget ran out, wait for the memory servers to stop at a Region boundary.", __func__);
+    }
+  }
 
   log_debug(semeru,rdma)("%s, CPU server are all done. Resume mutators ... ", __func__);
 }
 
 
+/**
+ * Semeru CPU - The budget of the memory servers' compaction in the STW window.
+ *  What is left of the pause target after the work done since pause_start, at least 1us.
+ *  The memory servers measure it from the time they see the window, the flags write latency isn't deducted.
+ */
+uint32_t G1CollectedHeap::mem_server_pause_budget_us(double target_pause_time_ms, double pause_start){
+  if(!SemeruPauseBudget){
+    _mem_server_stw_deadline = 0.0;
+    return 0;
+  }
+
+  double now     = os::elapsedTime();
+  double left_ms = MAX2(target_pause_time_ms - (now - pause_start) * MILLIUNITS, 0.001);
+  _mem_server_stw_deadline = now + left_ms / MILLIUNITS;
+
+  log_debug(semeru,rdma)("%s, %.3fms of the %.3fms pause target left for the memory servers.", __func__,
+                         left_ms, target_pause_time_ms);
+  return (uint32_t)MIN2(left_ms * 1000.0, (double)max_juint);
+}
+
+
 void G1CollectedHeap::wait_here_for_debug(){
 
     {    
@@ -5298,6 +7240,7 @@ void G1CollectedHeap::post_evacuate_collection_set(EvacuationInfo& evacuation_in
   _preserved_marks_set.assert_empty();
 
   _allocator->release_gc_alloc_regions(evacuation_info);
+  evict_cold_regions();
 
   //mhr: modify
   // HeapRegion* hr = NULL;
@@ -5360,16 +7303,174 @@ void G1CollectedHeap::free_region(HeapRegion* hr,
   if (!skip_hot_card_cache && !hr->is_young()) {
     _hot_card_cache->reset_card_counts(hr);
   }
+
+  // A young Region is mostly resident and allocated again soon, only drop its swapped out pages.
+  if (SemeruDiscardFreedRegions && (!hr->is_young() || (_swap_out_map != NULL && swapped_out_pages(hr) > 0))) {
+    discard_freed_region(hr);
+  }
+
   hr->hr_clear(skip_remset, true /* clear_space */, locked /* locked */);
   _g1_policy->remset_tracker()->update_at_free(hr);
   free_list->add_ordered(hr);
 }
 
+/**
+ * Semeru CPU - The dead content of a freed Region would still be written to the memory servers
+ *  when the kernel swaps its dirty pages out, and its swapped out pages would stay there.
+ *  Drop both before the Region is on the free list, RDMA_DISCARD. The resident pages are lazily freed,
+ *  they are kept if the Region is allocated again before the reclaim gets to them.
+ *  The memory servers learn the Region is free from its type in the meta space.
+ */
+void G1CollectedHeap::discard_freed_region(HeapRegion* hr) {
+  int swapped_out = syscall(RDMA_DISCARD, 0, hr->bottom(), HeapRegion::GrainBytes);
+  if (swapped_out < 0) {
+    log_debug(semeru,alloc)("%s, discard Region[%u] 0x%lx failed.", __func__, hr->hrm_index(), (size_t)hr->bottom());
+    return;
+  }
+  log_trace(semeru,alloc)("%s, Region[%u] 0x%lx, %d swap entries freed.", __func__, hr->hrm_index(),
+                          (size_t)hr->bottom(), swapped_out);
+}
+
+
+/**
+ * Semeru CPU - Heap snapshot, -XX:SemeruHeapSnapshotFile.
+ *  At the exit, the used Regions are swapped out to the memory servers and their swap entries are held by the kernel,
+ *  RDMA_SNAPSHOT. The pages stay on the memory servers after this process is gone. The manifest records the heap
+ *  and the Regions a restoring process maps again at the same addresses, their pages are faulted in over RDMA.
+ *
+ *  The manifest is a semeru_snapshot_header and one semeru_snapshot_region per saved Region.
+ */
+#define SEMERU_SNAPSHOT_MAGIC    0x53484e50   // "SHNP"
+#define SEMERU_SNAPSHOT_VERSION  1
+
+struct semeru_snapshot_header {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t heap_start;
+  uint64_t heap_bytes;      // reserved
+  uint64_t region_bytes;
+  uint32_t num_regions;     // records behind the header
+  uint32_t mem_server_num;
+  uint64_t missed_pages;    // not saved, e.g. locked in memory
+};
+
+struct semeru_snapshot_region {
+  uint32_t index;
+  uint32_t type;            // G1HeapRegionTraceType
+  uint64_t top;             // bytes from the bottom
+  int32_t  mem_server;
+  uint32_t pad;
+};
+
+bool G1CollectedHeap::save_heap_snapshot() {
+  assert(SafepointSynchronize::is_at_safepoint(), "%s, only at the exit safepoint.", __func__);
+
+  if (_cold_regions_evicting) {
+    syscall(RDMA_EVICT_WAIT, 0, NULL, 0);
+    _cold_regions_evicting = false;
+  }
+
+  // The klass metadata the Regions point to.
+  replicate_metadata(true /* at_safepoint */);
+
+  semeru_snapshot_region* records = NEW_C_HEAP_ARRAY(semeru_snapshot_region, max_regions(), mtGC);
+  uint num_records = 0;
+  size_t missed = 0;
+
+  for (uint i = 0; i < max_regions(); ) {
+    if (!_hrm.is_available(i) || region_at(i)->is_free()) {
+      i++;
+      continue;
+    }
+
+    uint first = i;
+    for (; i < max_regions() && _hrm.is_available(i) && !region_at(i)->is_free(); i++) {
+      HeapRegion* hr = region_at(i);
+      semeru_snapshot_region* r = &records[num_records++];
+      r->index      = i;
+      r->type       = (uint32_t)hr->get_trace_type();
+      r->top        = pointer_delta(hr->top(), hr->bottom(), 1);
+      r->mem_server = semeru_mem_server_of_addr(hr->bottom());
+      r->pad        = 0;
+    }
+
+    int not_saved = syscall(RDMA_SNAPSHOT, SEMERU_SNAPSHOT_SAVE, region_at(first)->bottom(),
+                            (size_t)(i - first) * HeapRegion::GrainBytes);
+    if (not_saved < 0) {
+      log_warning(semeru,alloc)("%s, can't save Region[%u, %u], the snapshot is given up.", __func__, first, i - 1);
+      syscall(RDMA_SNAPSHOT, SEMERU_SNAPSHOT_DROP, _reserved.start(), _reserved.byte_size());
+      FREE_C_HEAP_ARRAY(semeru_snapshot_region, records);
+      return false;
+    }
+    missed += (size_t)not_saved;
+  }
+
+  semeru_snapshot_header header;
+  header.magic          = SEMERU_SNAPSHOT_MAGIC;
+  header.version        = SEMERU_SNAPSHOT_VERSION;
+  header.heap_start     = (uint64_t)(uintptr_t)_reserved.start();
+  header.heap_bytes     = _reserved.byte_size();
+  header.region_bytes   = HeapRegion::GrainBytes;
+  header.num_regions    = num_records;
+  header.mem_server_num = (uint32_t)SemeruMemServerNum;
+  header.missed_pages   = missed;
+
+  FILE* f = os::fopen(SemeruHeapSnapshotFile, "wb");
+  bool written = f != NULL &&
+                 fwrite(&header, sizeof(header), 1, f) == 1 &&
+                 fwrite(records, sizeof(semeru_snapshot_region), num_records, f) == num_records;
+  if (f != NULL && fclose(f) != 0) {
+    written = false;
+  }
+  FREE_C_HEAP_ARRAY(semeru_snapshot_region, records);
+
+  if (!written) {
+    // Nobody could find the held pages without the manifest.
+    log_warning(semeru,alloc)("%s, write %s failed, %s. The snapshot is given up.", __func__, SemeruHeapSnapshotFile,
+                              os::strerror(errno));
+    syscall(RDMA_SNAPSHOT, SEMERU_SNAPSHOT_DROP, _reserved.start(), _reserved.byte_size());
+    return false;
+  }
+
+  log_info(semeru,alloc)("%s, 0x%x Regions saved to the memory servers, 0x%lx pages missed, manifest %s", __func__,
+                         num_records, missed, SemeruHeapSnapshotFile);
+  return true;
+}
+
+/**
+ * The snapshot of the previous run holds the swap slots of the heap pages, they wouldn't be swapped out again.
+ * This JVM builds its heap from scratch, drop it.
+ */
+void G1CollectedHeap::drop_stale_heap_snapshot() {
+  semeru_snapshot_header header;
+  FILE* f = os::fopen(SemeruHeapSnapshotFile, "rb");
+  if (f == NULL) {
+    return;
+  }
+  bool valid = fread(&header, sizeof(header), 1, f) == 1 &&
+               header.magic == SEMERU_SNAPSHOT_MAGIC && header.version == SEMERU_SNAPSHOT_VERSION;
+  fclose(f);
+
+  if (valid) {
+    int dropped = syscall(RDMA_SNAPSHOT, SEMERU_SNAPSHOT_DROP, (char*)(uintptr_t)header.heap_start, (size_t)header.heap_bytes);
+    log_info(semeru,alloc)("%s, the snapshot of 0x%x Regions at 0x%lx is dropped, %d pages.", __func__,
+                           header.num_regions, (size_t)header.heap_start, dropped);
+  } else {
+    log_warning(semeru,alloc)("%s, %s isn't a heap snapshot manifest.", __func__, SemeruHeapSnapshotFile);
+  }
+  remove(SemeruHeapSnapshotFile);
+}
+
 void G1CollectedHeap::free_humongous_region(HeapRegion* hr,
                                             FreeRegionList* free_list) {
   assert(hr->is_humongous(), "this is only for humongous regions");
   assert(free_list != NULL, "pre-condition");
   hr->clear_humongous();
+  if (SemeruRemoteHumongous) {
+    // The marks and the remote liveness of the object don't carry over to the next allocation into the Region.
+    hr->cross_region_ref_target_queue()->reset();
+    hr->reset_region_cm_scanned();
+  }
   free_region(hr, free_list, false /* skip_remset */, false /* skip_hcc */, true /* locked */);
 }
 
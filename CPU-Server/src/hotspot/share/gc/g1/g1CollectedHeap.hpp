@@ -41,6 +41,7 @@
 #include "gc/g1/g1HRPrinter.hpp"
 #include "gc/g1/g1InCSetState.hpp"
 #include "gc/g1/g1MonitoringSupport.hpp"
+#include "gc/g1/g1SemeruTimeline.hpp"
 #include "gc/g1/g1SurvivorRegions.hpp"
 #include "gc/g1/g1YCTypes.hpp"
 #include "gc/g1/heapRegionManager.hpp"
@@ -57,7 +58,11 @@
 
 // Semeru
 //  Added by Chenxi
+#include "gc/shared/rdmaMetaLayout.hpp"
 #include "gc/shared/rdmaStructure.inline.hpp"
+#include "gc/shared/rdmaWireCodec.hpp"
+#include "runtime/atomic.hpp"
+#include "runtime/rdma_cp_comm.hpp"
 
 
 
@@ -75,6 +80,7 @@ class G1ParScanThreadState;
 class MemoryPool;
 class MemoryManager;
 class ObjectClosure;
+class KlassInfoTable;
 class SpaceClosure;
 class CompactibleSpaceClosure;
 class Space;
@@ -84,6 +90,11 @@ class G1Policy;
 class G1HotCardCache;
 class G1RemSet;
 class G1YoungRemSetSamplingThread;
+class G1SemeruTargetQueueThread;
+class G1SemeruMetaReplicationThread;
+class G1SemeruCommThread;
+class G1SemeruPretenureProfile;
+class SuspendibleThreadSetJoiner;
 class HeapRegionRemSetIterator;
 class G1ConcurrentMark;
 class G1ConcurrentMarkThread;
@@ -184,13 +195,15 @@ public :
   //mhr: modify
   AddrPair* pair_array;
   size_t* _queue_bitmap;
-  double gctime;
-  double commtime;
-  double regiontime;
   //bool fullGC;
 
   static int compare_meta_st(const AddrPair a, const AddrPair b) ;
 
+  // Epochs of the klass metadata replication. A round that ships some ranges opens a new epoch,
+  // the pause confirms the latest one.
+  volatile size_t _meta_epoch;
+  size_t _confirmed_meta_epoch;
+
   // This flag can only be setted by CPU server via the RDMA.
   // Memory server keeps reading its value to know the runging state of CPU server.
   // Memory server has to read  the value from memory every time.
@@ -199,22 +212,151 @@ public :
 
   flags_of_mem_server_state* _mem_server_flags;
 
+  // The liveness epochs of the Regions, LIVENESS_EPOCH_OFFSET.
+  // Overwritten by the page of each memory server in turn, see sync_region_liveness().
+  region_liveness_epochs* _liveness_epochs;
+
+  // The class loader bitmaps of the Regions, CLD_LIVENESS_OFFSET.
+  // Overwritten by the page of each memory server in turn, see mark_remote_class_loaders().
+  region_cld_liveness* _cld_liveness;
+
+  // The compacted Region ring, COMPACTED_REGION_RING_OFFSET.
+  // Only the index lines and the new slots of each memory server are read into it, see drain_compacted_region_rings().
+  compacted_region_ring* _compacted_region_ring;
+  size_t*                _compacted_region_ring_tails;   // by memory server
+
+  // The Region state words, REGION_STATE_OFFSET, -XX:+SemeruRegionStateAtomics.
+  // Never read or written by the RDMA read/write, each word is the last value returned by the RDMA atomics.
+  region_state_words* _region_states;
+
+  // The class histogram of the fully evicted Regions, HEAP_HISTOGRAM_OFFSET, -XX:+SemeruRemoteHeapHistogram.
+  // The request is written to each memory server in turn, the reply is read back into the same place.
+  remote_heap_histogram* _heap_histogram;
+
+  // The versioned liveness of the Regions, LIVENESS_VECTOR_OFFSET, -XX:+SemeruLivenessVector.
+  // Overwritten by the vector of each memory server in turn, see sync_region_liveness().
+  region_liveness_vector* _liveness_vector;
+
+  // The remembered set cards of the fully evicted old Regions, REMOTE_CARD_SCAN_OFFSET, -XX:+SemeruRemoteCardScan.
+  // Refilled for each memory server in turn, see G1RemoteCardScanState.
+  remote_card_scan* _remote_card_scan;
+
+  // The dirty cards of the fully evicted old Regions, REMOTE_REFINE_OFFSET, -XX:+SemeruRemoteRefinement.
+  // One batch at a time, see G1RemoteRefineQueue.
+  remote_card_scan* _remote_refine;
+
+  // The remembered set cards of the Regions handed to the memory server CSet, REMSET_STASH_OFFSET, -XX:+SemeruRemoteRemSets.
+  // See G1RemoteRemSetStash.
+  remote_rem_set_stash* _remset_stash;
+
+  // The outboxes of the memory server concurrent marking, MARK_MESSAGE_OFFSET, -XX:+SemeruMarkMessages.
+  // Only the index lines and the new targets of each memory server are read into it, see relay_mark_messages().
+  mark_message_ring* _mark_messages;
+  size_t*            _mark_message_tails;   // by memory server
+
+  // The page affinity the memory servers' tracing found, PAGE_AFFINITY_OFFSET, -XX:+SemeruPageAffinity.
+  // Only the entries of the Regions with a new _affinity_version are read, see sync_page_affinity().
+  // Shared with the kernel prefetcher once _page_affinity_shared.
+  page_affinity_table* _page_affinity;
+  bool                 _page_affinity_shared;
+
+  // A copy or fill of a large array range done by a memory server, REMOTE_ARRAY_OP_OFFSET, -XX:+SemeruRemoteArrayOps.
+  // One request at a time, see G1SemeruRemoteArrayOps.
+  remote_array_op* _remote_array_op;
+
+  // The Regions compacted by the memory servers since the last STW window, drained at its start.
+  uint* _mem_compacted_regions;
+  uint  _num_mem_compacted_regions;
+
+  // Sequence number of the doorbell. Rung by the VM thread, and by the concurrent refinement.
+  volatile uint _mem_server_doorbell_seq;
+
+  // -XX:+SemeruPauseBudget, os::elapsedTime() when the budget sent at the open of the STW window runs out. 0, unbounded.
+  double _mem_server_stw_deadline;
+
+  // The swapped out pages of each Region, counted by the kernel, RDMA_SWAP_OUT_MAP.
+  // Read-only to the JVM. NULL if the kernel doesn't share them, then ask by SYS_NUM_SWAP_OUT_PAGES.
+  const volatile int* _swap_out_map;
+  size_t              _swap_out_map_entries;
+
+  void initialize_swap_out_map();
+
+  // -XX:SemeruHotRegionSwapIns. The pages of each Region read back from the memory servers, RDMA_SWAP_IN_MAP.
+  // Only grows, read-only to the JVM. The delta of each pause is decayed into the heat of the Region.
+  const volatile int* _swap_in_map;
+  int*                _swap_ins_seen;   // the counters at the last pause
+  float*              _swap_in_heat;
+
+  void initialize_swap_in_map(size_t entries, size_t bytes);
+
+  // -XX:+SemeruDiscardFreedRegions, drop the local pages and swap entries of a Region being freed.
+  void discard_freed_region(HeapRegion* hr);
+
+  // -XX:SemeruHeapSnapshotFile, give up the snapshot of the previous run before the heap is used.
+  void drop_stale_heap_snapshot();
+
+  // -XX:+SemeruColdEvacuation and -XX:+SemeruEvacLookAhead. The residency of the heap pages at the pause start,
+  // one mincore() byte per page. Only the CSet Regions with swapped out pages are sampled, the others are taken as resident.
+  unsigned char* _page_residency;
+  bool*          _page_residency_sampled;
+
+  // -XX:+SemeruBulkEvictColdRegions. The cold old Regions retired by this pause, evicted after it by RDMA_EVICT.
+  uint* _cold_regions_to_evict;
+  uint  _num_cold_regions_to_evict;
+  bool  _cold_regions_evicting;   // evictions queued to the kernel, not waited yet
+
+  // -XX:+SemeruRegionHints and -XX:+SemeruPretenureLargeObjects. The old Regions marked cold by the application,
+  // or filled by the pretenured objects, merged into the evictions of the next pause.
+  volatile bool* _cold_hinted;   // by Region index
+  uint*          _cold_hints;
+  volatile uint  _num_cold_hints;
+
+  // -XX:+SemeruPretenureLargeObjects. The old Region the pretenured objects are allocated in, under the Heap_lock.
+  // Dropped at every pause, an old Region is only allocated by one of the mutators or the GC.
+  G1SemeruPretenureProfile* _pretenure_profile;
+  HeapRegion*               _pretenure_region;
+
 
   void initialize_cpu_mem_comm_structs(ReservedSpace* rs){
     if(rs == NULL){
       _recv_mem_server_cset = NULL;
       _cpu_server_flags = NULL;
       _mem_server_flags = NULL;
+      _liveness_epochs = NULL;
+      _cld_liveness = NULL;
+      _compacted_region_ring = NULL;
+      _region_states = NULL;
+      _heap_histogram = NULL;
+      _liveness_vector = NULL;
+      _remote_card_scan = NULL;
+      _remote_refine = NULL;
+      _remset_stash = NULL;
+      _mark_messages = NULL;
+      _page_affinity = NULL;
+      _remote_array_op = NULL;
     }else{
 
       _recv_mem_server_cset 	= new(MEMORY_SERVER_CSET_SIZE, rs->base() + MEMORY_SERVER_CSET_OFFSET) received_memory_server_cset();
 	    _cpu_server_flags				=	new(FLAGS_OF_CPU_SERVER_STATE_SIZE, rs->base() + FLAGS_OF_CPU_SERVER_STATE_OFFSET) flags_of_cpu_server_state();
       _mem_server_flags       =	new(FLAGS_OF_MEM_SERVER_STATE_SIZE, rs->base() + FLAGS_OF_MEM_SERVER_STATE_OFFSET) flags_of_mem_server_state();
+      _liveness_epochs        = new(LIVENESS_EPOCH_SIZE_LIMIT, rs->base() + LIVENESS_EPOCH_OFFSET) region_liveness_epochs(rs->base() + LIVENESS_EPOCH_OFFSET, LIVENESS_EPOCH_SIZE_LIMIT);
+      _cld_liveness           = new(CLD_LIVENESS_SIZE_LIMIT, rs->base() + CLD_LIVENESS_OFFSET) region_cld_liveness(rs->base() + CLD_LIVENESS_OFFSET, CLD_LIVENESS_SIZE_LIMIT);
+      _compacted_region_ring  = new(COMPACTED_REGION_RING_SIZE_LIMIT, rs->base() + COMPACTED_REGION_RING_OFFSET) compacted_region_ring(SemeruMetaLayout::num_regions());
+      _region_states          = new(REGION_STATE_SIZE_LIMIT, rs->base() + REGION_STATE_OFFSET) region_state_words(rs->base() + REGION_STATE_OFFSET, REGION_STATE_SIZE_LIMIT);
+      _heap_histogram         = new(HEAP_HISTOGRAM_SIZE_LIMIT, rs->base() + HEAP_HISTOGRAM_OFFSET) remote_heap_histogram();
+      _liveness_vector        = new(LIVENESS_VECTOR_SIZE_LIMIT, rs->base() + LIVENESS_VECTOR_OFFSET) region_liveness_vector(rs->base() + LIVENESS_VECTOR_OFFSET, LIVENESS_VECTOR_SIZE_LIMIT);
+      _remote_card_scan       = new(REMOTE_CARD_SCAN_SIZE_LIMIT, rs->base() + REMOTE_CARD_SCAN_OFFSET) remote_card_scan();
+      _remote_refine          = new(REMOTE_REFINE_SIZE_LIMIT, rs->base() + REMOTE_REFINE_OFFSET) remote_card_scan();
+      _remset_stash           = new(REMSET_STASH_SIZE_LIMIT, rs->base() + REMSET_STASH_OFFSET) remote_rem_set_stash();
+      _mark_messages          = new(MARK_MESSAGE_SIZE_LIMIT, rs->base() + MARK_MESSAGE_OFFSET) mark_message_ring();
+      _page_affinity          = new(PAGE_AFFINITY_SIZE_LIMIT, rs->base() + PAGE_AFFINITY_OFFSET) page_affinity_table();
+      _remote_array_op        = new(REMOTE_ARRAY_OP_SIZE_LIMIT, rs->base() + REMOTE_ARRAY_OP_OFFSET) remote_array_op();
+      SemeruWireBuffer::initialize(SemeruMemServerNum);
 
 		  #ifdef ASSERT
 		  log_debug(semeru, alloc)("%s, Meta data allocation Start\n", __func__);
 		  log_debug(semeru, alloc)("	received_memory_server_cset 0x%lx, flexible array 0x%lx",  
-																							(size_t)_recv_mem_server_cset, (size_t)_recv_mem_server_cset->_region_cset  );
+																							(size_t)_recv_mem_server_cset, (size_t)_recv_mem_server_cset + MEMORY_SERVER_CSET_HEADER_SIZE  );
 		  log_debug(semeru, alloc)("	flags_of_cpu_server_state  0x%lx, flexible array 0x%lx",  
 																							(size_t)_cpu_server_flags, (size_t)0 );
       log_debug(semeru, alloc)("	flags_of_mem_server_state  0x%lx, flexible array 0x%lx",  
@@ -228,17 +370,23 @@ public :
 
   received_memory_server_cset* recv_mem_server_cset() { return _recv_mem_server_cset;  }
   void update_cset_to_mem_server(size_t mem_id )	{ 
-    syscall(RDMA_WRITE_SIGNAL, mem_id, _recv_mem_server_cset, MEMORY_SERVER_CSET_SIZE);	 
+    char* overflow_start;
+    size_t overflow_size = _recv_mem_server_cset->overflow_size(mem_id, &overflow_start);
+    _recv_mem_server_cset->bump_seq(mem_id);
+    if(overflow_size > 0){
+      semeru_cp_write((int)mem_id, overflow_start, align_up(overflow_size, PAGE_SIZE));
+    }
+    syscall(RDMA_WRITE_SIGNAL, mem_id, _recv_mem_server_cset, MEMORY_SERVER_CSET_HEADER_SIZE);	 
+    ring_mem_server_doorbell(mem_id);
   }
 
   flags_of_cpu_server_state* cpu_server_flags() { return _cpu_server_flags;  }
-  void send_cpu_server_flags_to_mem_server()	  { 
-    int mem_id;
-    for(mem_id=0; mem_id<NUM_OF_MEMORY_SERVER; mem_id ++ ){
-      syscall(RDMA_WRITE, mem_id, _cpu_server_flags, FLAGS_OF_CPU_SERVER_STATE_SIZE); 
-    }
-
-  }
+  void send_cpu_server_flags_to_mem_server();
+  // -XX:+SemeruCommThread, queue the flags behind the pending writes and return,
+  // wait_cpu_server_flags_sent() before the flags are changed again.
+  void send_cpu_server_flags_to_mem_server_async();
+  void wait_cpu_server_flags_sent();
+  G1SemeruCommThread* semeru_comm_thread() const { return _semeru_comm_thread; }
   void read_cpu_server_flags_from_mem_server(size_t mem_id = 0)	{ 
 
     //
@@ -251,10 +399,7 @@ public :
 
   flags_of_mem_server_state* mem_server_flags() {  return _mem_server_flags;  }
   void send_mem_server_flags_to_mem_server()	  { 
-    int mem_id;
-    for(mem_id=0; mem_id<NUM_OF_MEMORY_SERVER; mem_id ++ ){
-      syscall(RDMA_WRITE, mem_id, _mem_server_flags, FLAGS_OF_MEM_SERVER_STATE_SIZE);	
-    }
+    semeru_cp_bcast(_mem_server_flags, FLAGS_OF_MEM_SERVER_STATE_SIZE);
   }
 
   // default is to read memory server #0
@@ -267,14 +412,137 @@ public :
     
   }
 
+  // The memory servers push their state transitions.
+  // Sleep until the state is reached instead of reading the flags repeatedly.
+  // Return false for timeout, then the caller falls back to reading the flags.
+  // Each wait is reported as a SemeruMemoryServerWait event.
+  bool wait_mem_server_state(size_t mem_id, int state);
+
+  // The swapped out pages of a Region, plain loads of the map shared with the kernel.
+  size_t swapped_out_pages(HeapRegion* hr) const;
+  bool shares_swap_out_map() const { return _swap_out_map != NULL; }
+
+  remote_card_scan* remote_cards() const { return _remote_card_scan; }
+  remote_card_scan* remote_refine() const { return _remote_refine; }
+  remote_rem_set_stash* remset_stash() const { return _remset_stash; }
+  remote_array_op* remote_array() const { return _remote_array_op; }
+
+  // -XX:+SemeruRemoteFieldReads. Read the size bytes at addr, a field of a cold old or humongous Region,
+  // from the memory server into buf when its page is swapped out. False if the caller has to load it.
+  bool semeru_peek(const void* addr, void* buf, size_t size);
+
+  // -XX:SemeruLoopPrefetchPages. A compiled array scan is about to reach the page of addr,
+  // issue its read if the Region has swapped out pages.
+  void semeru_loop_prefetch(const void* addr);
+
+  // The swapped out pages of the young Regions in the CSet, fed to the young gen sizer.
+  void record_young_residency();
+
+  // Sample the page residency of the CSet Regions, before the evacuation faults their pages in.
+  void sample_page_residency();
+
+  // Decay the swap-ins since the last pause into the heat of each Region, before the CSet is chosen.
+  void update_swap_in_heat();
+  // A Region swapped in again and again since it was swapped out, -XX:SemeruHotRegionSwapIns.
+  inline bool is_swap_in_hot(HeapRegion* hr) const;
+
+  // Read the swapped out pages of the CSet Regions into the kernel's prefetch cache, before the evacuation.
+  void prefetch_collection_set();
+
+  // The page of obj, in the CSet Region hr, was swapped out at the pause start.
+  inline bool is_swapped_out_at_pause_start(HeapRegion* hr, oop obj) const;
+  // -XX:+SemeruColdEvacuation, and the Region isn't hot.
+  inline bool is_cold_at_pause_start(HeapRegion* hr, oop obj) const;
+  // -XX:+SemeruEvacLookAhead, the read of the page of obj is issued, the other workers don't ask again.
+  inline void note_page_fetched(oop obj);
+
+  // A cold old alloc region is retired, under the FreeList_lock or by the VM thread.
+  void note_cold_region_retired(HeapRegion* hr);
+
+  // Queue the eviction of the cold Regions retired by this pause, the runs of adjacent Regions at once.
+  void evict_cold_regions();
+
+  // jdk.internal.misc.SemeruHints.markCold, by any Java thread. Return false if hr isn't old.
+  bool hint_cold_region(HeapRegion* hr);
+
+  // -XX:SemeruHeapSnapshotFile, at the safepoint of the exit. Keep the used Regions on the memory servers
+  // beyond this process and write their manifest. Return false if nothing was saved.
+  bool save_heap_snapshot();
+
+  // Wake up the memory server after its CSet or flags are written,
+  // instead of letting it check them periodically.
+  void ring_mem_server_doorbell(size_t mem_id) {
+    uint32_t seq = Atomic::add(1u, &_mem_server_doorbell_seq);
+    if (G1SemeruTimeline::is_enabled()) {
+      G1SemeruTimeline::doorbell(mem_id, seq);
+    }
+    syscall(RDMA_RING_DOORBELL, mem_id, NULL, (size_t)seq);
+  }
+
+  // Forget the states of the last STW window.
+  void reset_mem_server_states() {
+    int mem_id;
+    for(mem_id=0; mem_id<(int)SemeruMemServerNum; mem_id ++ ){
+      syscall(RDMA_WAIT_MEM_SERVER, mem_id, NULL, 0);
+    }
+  }
+
   
   // Synchronization with Memory server
   //
   void close_stw_window();
+  // -XX:+SemeruConcurrentCompact, the Region grants of the concurrent compaction.
+  void grant_concurrent_compaction();
+  void close_concurrent_compaction_grants();
+  void release_concurrent_compaction_grants();
+  // -XX:+SemeruRegionStateAtomics, move the Region's state word on its memory server by the RDMA CAS.
+  // from_states is a mask of the region_state_words::RegionState. False if the word isn't in any of them.
+  bool cas_region_state(HeapRegion* hr, uint from_states, uint64_t to_state, bool bump_seq);
+  // Pull the top and the rebuilt BOT cards of the committed Regions.
+  void sync_compacted_region_bots();
+  // Take the indexes of the Regions the memory servers compacted, only the new slots of their rings.
+  void drain_compacted_region_rings();
+  // -XX:+SemeruSelectiveInvalidation, drop the local copies of the pages the memory servers rewrote
+  // in the drained Regions. After drain_compacted_region_rings().
+  void invalidate_rewritten_pages();
+  // -XX:+SemeruMarkMessages, mark the targets the memory servers' tracing found out of their Regions
+  // into the target queues, shipped with the CSet dispatch. After drain_compacted_region_rings().
+  void relay_mark_messages();
+  // -XX:+SemeruPageAffinity, read the page affinity of the old Regions the memory servers traced again,
+  // after their MemoryToCPUAtGC are read.
+  void sync_page_affinity();
+  // The objects of the Region moved or died, its page groups are stale.
+  void clear_page_affinity(HeapRegion* hr);
+  // -XX:+SemeruRemoteRefProcessing, refresh the SoftReference policy sent to the memory servers,
+  // and enqueue the References they cleared since the last STW window.
+  void enqueue_remote_pending_references();
+  // -XX:+SemeruIncrementalLiveness, read the liveness of the old Regions changed since the last GC.
+  void sync_region_liveness();
+  // -XX:+SemeruRemoteClassUnloading, at the initial mark. Mark the holders of the class loaders
+  // whose objects the memory servers marked in the old Regions, the concurrent marking traces them.
+  void mark_remote_class_loaders();
   void send_evacuated_region_info();
+  // -XX:+SemeruConcurrentTargetQueue, send the target queues refined since their last send, out of the pauses.
+  // Return the number of sent Regions.
+  uint send_concurrent_target_marks(SuspendibleThreadSetJoiner* sts);
+  // Ship the klass metadata allocated or written since the last round to all the memory servers.
+  // Invoked at the pause, or by the G1SemeruMetaReplicationThread joined to the suspendible thread set.
+  // Return the number of shipped ranges.
+  int  replicate_metadata(bool at_safepoint);
+  size_t meta_epoch() const { return _meta_epoch; }
+  // Vectored control path, queued to the _semeru_comm_thread if there is one, RDMA_WRITEV otherwise.
+  void send_rdma_iovec(semeru_rdma_iovec* iov, int nr_iov);
+  // Vectored control path, wait for the previous ticket and issue the iov by RDMA_WRITEV_ASYNC.
+  int  post_rdma_iovec_async(semeru_rdma_iovec* iov, int nr_iov, int prev_ticket);
+  // Append the structures marked by HeapRegion::mark_info_at_gc_dirty(), one entry per run of each arena.
+  // A full vector is posted, return the entries left in iov.
+  int  append_dirty_arena_runs(semeru_rdma_iovec* iov, int nr_iov, int max_iov, int mem_id, int* ticket);
+  void wait_rdma_ticket(int ticket);
   void read_data_from_memory_servers();
   void send_uncompacted_region_queue();
   void busy_wait_the_end_of_mem_server_compaction();
+  // -XX:+SemeruPauseBudget, the part of target_pause_time_ms left for the memory servers, in us. 0, unbounded.
+  uint32_t mem_server_pause_budget_us(double target_pause_time_ms, double pause_start);
 
   bool is_mem_server_ready() {return true;}
 
@@ -296,6 +564,14 @@ public:
 
 private:
   G1YoungRemSetSamplingThread* _young_gen_sampling_thread;
+  // -XX:+SemeruConcurrentTargetQueue, NULL otherwise.
+  G1SemeruTargetQueueThread* _semeru_target_queue_thread;
+  // -XX:+SemeruConcurrentMetaReplication, NULL otherwise.
+  G1SemeruMetaReplicationThread* _semeru_meta_replication_thread;
+  // -XX:+SemeruCommThread, NULL otherwise.
+  G1SemeruCommThread* _semeru_comm_thread;
+  // The ticket of the last flags queued to the _semeru_comm_thread.
+  jlong _cpu_server_flags_ticket;
 
   WorkGang* _workers;
   G1CollectorPolicy* _collector_policy;
@@ -529,6 +805,9 @@ private:
   // Old, Eden, Humongous, Survivor defined in HeapRegionType.)
   HeapRegion* new_region(size_t word_size, HeapRegionType type, bool do_expand);
 
+  // Semeru, take a free region, the resident ones first.
+  HeapRegion* allocate_free_region(HeapRegionType type);
+
   // Initialize a contiguous set of free regions of length num_regions
   // and starting at index first so that they appear as a single
   // humongous region.
@@ -576,6 +855,11 @@ private:
   virtual HeapWord* mem_allocate(size_t word_size,
                                  bool*  gc_overhead_limit_was_exceeded);
 
+  // Semeru, a large object of a Klass profiled as long-lived goes into an old Region, -XX:+SemeruPretenureLargeObjects.
+  // NULL falls back to the young allocation.
+  virtual HeapWord* mem_allocate_pretenured(Klass* klass, size_t word_size);
+  void retire_pretenure_region();
+
   // First-level mutator allocation attempt: try to allocate out of
   // the mutator alloc region without taking the Heap_lock. This
   // should only be used for non-humongous allocations.
@@ -665,6 +949,8 @@ private:
   void merge_per_thread_state_info(G1ParScanThreadStateSet* per_thread_states);
 public:
   G1YoungRemSetSamplingThread* sampling_thread() const { return _young_gen_sampling_thread; }
+  G1SemeruTargetQueueThread* semeru_target_queue_thread() const { return _semeru_target_queue_thread; }
+  G1SemeruPretenureProfile* pretenure_profile() const { return _pretenure_profile; }
 
   WorkGang* workers() const { return _workers; }
 
@@ -1083,6 +1369,9 @@ public:
 private:
   jint initialize_concurrent_refinement();
   jint initialize_young_gen_sampling_thread();
+  jint initialize_semeru_target_queue_thread();
+  jint initialize_semeru_meta_replication_thread();
+  jint initialize_semeru_comm_thread();
 public:
   // Initialize the G1CollectedHeap to have the initial and
   // maximum sizes and remembered and barrier sets
@@ -1287,6 +1576,12 @@ public:
   // Iterate over all objects, calling "cl.do_object" on each.
   virtual void object_iterate(ObjectClosure* cl);
 
+  // -XX:+SemeruRemoteHeapHistogram, at a safepoint. The memory servers count the instances of the fully evicted
+  // Regions into cit, the Regions they counted are set in counted. Return the instances cit missed.
+  size_t count_remote_heap_histogram(KlassInfoTable* cit, BitMap* counted);
+  // Iterate over the objects of the Regions not set in counted.
+  void object_iterate_uncounted(ObjectClosure* cl, const BitMap* counted);
+
   virtual void safe_object_iterate(ObjectClosure* cl) {
     object_iterate(cl);
   }
@@ -66,6 +66,31 @@ inline HeapRegion* G1CollectedHeap::next_region_in_humongous(HeapRegion* hr) con
   return _hrm->next_region_in_humongous(hr);
 }
 
+inline bool G1CollectedHeap::is_swap_in_hot(HeapRegion* hr) const {
+  return _swap_in_heat != NULL && _swap_in_heat[hr->hrm_index()] >= (float)SemeruHotRegionSwapIns;
+}
+
+inline bool G1CollectedHeap::is_swapped_out_at_pause_start(HeapRegion* hr, oop obj) const {
+  if (_page_residency_sampled == NULL || !_page_residency_sampled[hr->hrm_index()]) {
+    return false;
+  }
+  size_t page = pointer_delta((HeapWord*)obj, _reserved.start()) / (PAGE_SIZE / HeapWordSize);
+  return (_page_residency[page] & 1) == 0;
+}
+
+inline bool G1CollectedHeap::is_cold_at_pause_start(HeapRegion* hr, oop obj) const {
+  // Swapped out now, but faulted back in soon after each eviction.
+  if (!SemeruColdEvacuation || is_swap_in_hot(hr)) {
+    return false;
+  }
+  return is_swapped_out_at_pause_start(hr, obj);
+}
+
+inline void G1CollectedHeap::note_page_fetched(oop obj) {
+  size_t page = pointer_delta((HeapWord*)obj, _reserved.start()) / (PAGE_SIZE / HeapWordSize);
+  _page_residency[page] |= 1;
+}
+
 inline uint G1CollectedHeap::addr_to_region(HeapWord* addr) const {
   assert(is_in_reserved(addr),
          "Cannot calculate region index for address " PTR_FORMAT " that is outside of the heap [" PTR_FORMAT ", " PTR_FORMAT ")",
@@ -40,6 +40,7 @@
 //mhr: modify for transfer
 #include "gc/shared/rdmaStructure.hpp"
 #include "gc/g1/g1Allocator.inline.hpp"
+#include "runtime/rdma_cp_comm.hpp"
 //mhr: modify for cache
 //#include "gc/g1/ratio.hpp"
 
@@ -69,6 +70,7 @@ G1CollectionSet::G1CollectionSet(G1CollectedHeap* g1h, G1Policy* policy) :
   _collection_set_regions(NULL),
   _collection_set_cur_length(0),
   _collection_set_max_length(0),
+  _semeru_swapped_out_live_pages(0.0),
   _optional_regions(NULL),
   _optional_region_length(0),
   _optional_region_max_length(0),
@@ -434,12 +436,18 @@ void G1CollectionSet::semeru_finalize_parts(G1SurvivorRegions* survivors) {
   // finalize_incremental_building();
   size_t cssc_cache_threshold_in_pages = _policy->cssc_cache_threshold_in_pages(); //mhr: need to implement
   size_t msct_cache_threshold_in_pages = _policy->msct_cache_threshold_in_pages(); 
+  double live_threshold_ratio = _policy->mem_server_live_threshold_ratio();
+  if(SemeruSelectiveInvalidation){
+    // Only the pages the memory servers rewrite lose their local copies, a cached Region is compacted there too.
+    msct_cache_threshold_in_pages = HeapRegion::GrainBytes / PAGE_SIZE;
+  }
   size_t max_cset_length = _policy->calc_max_cserver_cset_length();
   size_t new_collection_set_length = 0;
   size_t candidates_length = 0;
   _bytes_used_before = 0; //useless
   _eden_region_length = _survivor_region_length = 0;
   _rebuild_set_length = 0;
+  _semeru_swapped_out_live_pages = 0.0;
 
   HeapRegionManager* hrm = _g1h->hrm();
 
@@ -453,6 +461,9 @@ void G1CollectionSet::semeru_finalize_parts(G1SurvivorRegions* survivors) {
 
   initialize_optional(len);
   
+  // The data Regions moved by the kernel are dispatched to their new memory servers from this CSet on.
+  semeru_sync_placement();
+
   received_memory_server_cset* rmsc = _g1h->recv_mem_server_cset(); 
   rmsc->reset();                                                                                                                     
  
@@ -491,14 +502,41 @@ void G1CollectionSet::semeru_finalize_parts(G1SurvivorRegions* survivors) {
       log_debug(semeru)("%s, Region %u alive ratio: %lf",__func__, i, hr->_mem_to_cpu_gc->_alive_ratio);
 
       size_t region_cached_pages = cache_ratio_pages(hr); // Get the number of cached pages for this region.
-
-      if(region_cached_pages > cssc_cache_threshold_in_pages && hr->_mem_to_cpu_gc->_cm_scanned) {
+      // Faulted back in soon after each eviction, the CPU server keeps using it. Keep it local.
+      bool swap_in_hot = _g1h->is_swap_in_hot(hr);
+
+      if(SemeruCSetCostModel && hr->_mem_to_cpu_gc->_cm_scanned && hr->_mem_to_cpu_gc->_alive_ratio < live_threshold_ratio) {
+        // Mostly dead, reclaim it on the server predicted to take the shorter pause.
+        size_t swapped_out_pages = HeapRegion::GrainBytes/PAGE_SIZE - region_cached_pages;
+        double evac_time_ms  = _policy->predict_semeru_evac_time_ms(hr, swapped_out_pages);
+        double flush_time_ms = _policy->predict_semeru_flush_time_ms(region_cached_pages);
+
+        if(!_g1h->_allocator->is_retained_old_region(hr) && !hr->cross_region_ref_target_queue()->_marked_from_root &&
+           !swap_in_hot && flush_time_ms < evac_time_ms){
+          add_mem_server_region(hr);
+        }else{
+          candidates_regions[candidates_length++] = hr;
+        }
+        log_debug(semeru)("%s, region[%u] alive ratio %lf, cache ratio %lf, predicted evacuation %1.3fms, flush %1.3fms", __func__,
+                          hr->hrm_index(), hr->_mem_to_cpu_gc->_alive_ratio,
+                          (double)region_cached_pages*PAGE_SIZE/HeapRegion::GrainBytes, evac_time_ms, flush_time_ms);
+      }
+      else if(region_cached_pages > cssc_cache_threshold_in_pages && hr->_mem_to_cpu_gc->_cm_scanned) {
          /*&& hr->_mem_to_cpu_gc->_alive_ratio < 0.5*/
         log_debug(semeru)("%s, Candidate Region %u scanned?: %d",__func__, i, hr->_mem_to_cpu_gc->_cm_scanned);
         log_debug(semeru)("%s, Candidate Region %u alive ratio: %lf",__func__, i, hr->_mem_to_cpu_gc->_alive_ratio);
         //mhr: debug
         candidates_regions[candidates_length++] = hr;
       }
+      else if(SemeruIncrementalLiveness && hr->_mem_to_cpu_gc->_cm_scanned && hr->_mem_to_cpu_gc->_alive_ratio < live_threshold_ratio &&
+              !_g1h->_allocator->is_retained_old_region(hr) && !hr->cross_region_ref_target_queue()->_marked_from_root &&
+              region_cached_pages <= msct_cache_threshold_in_pages && !swap_in_hot){
+        // The memory server already proved it mostly dead, compact it there instead of swapping it in to evacuate.
+        add_mem_server_region(hr);
+        log_info(semeru)("%s, region[%u] alive ratio %lf, is added into memory srever CSet, cache ratio %lf", __func__, 
+                                              hr->hrm_index(), hr->_mem_to_cpu_gc->_alive_ratio, 
+                                              (double)region_cached_pages*PAGE_SIZE/HeapRegion::GrainBytes );
+      }
       else if(!_g1h->_allocator->is_retained_old_region(hr) && !hr->_mem_to_cpu_gc->_cm_scanned && !hr->cross_region_ref_target_queue()->_marked_from_root){
         
         // Only flush regions withi low cache ratio to memory servers
@@ -508,14 +546,51 @@ void G1CollectionSet::semeru_finalize_parts(G1SurvivorRegions* survivors) {
                                               (double)msct_cache_threshold_in_pages*PAGE_SIZE/HeapRegion::GrainBytes );
           continue;
         }
+        if(swap_in_hot) {
+          log_debug(semeru)("%s, region[%u] is swapped in again and again, skip the MSCT.", __func__, hr->hrm_index());
+          continue;
+        }
         
-        rmsc->add(hr->hrm_index()); // add this region into memory server CSet
-        _g1h->old_set_remove(hr);
-        add_optional_region(hr);
+        add_mem_server_region(hr); // add this region into memory server CSet
         log_info(semeru)("%s, region[%u] is added into memory srever CSet, cache ratio %lf", __func__, 
                                               hr->hrm_index(), (double)region_cached_pages*PAGE_SIZE/HeapRegion::GrainBytes );
       }
     }
+    else if(SemeruRemoteHumongous && hr->is_starts_humongous()) {
+      // The whole humongous object is traced on the memory servers, by the references recorded in its target queue.
+      // It is never moved. A dead object is freed by the eager reclaim of the pause, without swapping it in.
+      BitQueue* target_queue = hr->cross_region_ref_target_queue();
+      if(!hr->_mem_to_cpu_gc->_cm_scanned && !target_queue->_marked_from_root) {
+        size_t obj_regions = 0;
+        size_t obj_cached_pages = 0;
+        bool swap_in_hot = false;
+        for(HeapRegion* r = hr; r != NULL; r = _g1h->next_region_in_humongous(r)) {
+          obj_regions++;
+          obj_cached_pages += cache_ratio_pages(r);
+          swap_in_hot |= _g1h->is_swap_in_hot(r);
+        }
+        if(obj_cached_pages > msct_cache_threshold_in_pages * obj_regions || swap_in_hot) {
+          continue;
+        }
+
+        // Flush all the Regions of the object, the array slices are traced in place.
+        for(HeapRegion* r = hr; r != NULL; r = _g1h->next_region_in_humongous(r)) {
+          rmsc->add(r->hrm_index(), r->region_to_memory_server_mapping());
+        }
+        log_info(semeru)("%s, humongous region[%u] of %lu regions is added into memory srever CSet, cache ratio %lf", __func__,
+                         hr->hrm_index(), obj_regions, (double)obj_cached_pages*PAGE_SIZE/(HeapRegion::GrainBytes*obj_regions));
+      }
+      else if(hr->_mem_to_cpu_gc->_cm_scanned && hr->_mem_to_cpu_gc->_alive_ratio > 0.0) {
+        // Retrace a live object after a while, the references to it may be gone.
+        target_queue->_age++;
+        if(target_queue->_age > (int)RebuildThreshold) {
+          hr->reset_region_cm_scanned();
+          target_queue->_marked_from_root = false;
+          target_queue->_age = -1;
+          log_debug(semeru)("Retrace humongous Region %u", hr->hrm_index());
+        }
+      }
+    }
     else { // humonguous region fall into this path.
 
       log_debug(semeru)("%s, region[%u] humonguous? %d", __func__, hr->hrm_index(), hr->is_humongous() );
@@ -561,6 +636,7 @@ void G1CollectionSet::semeru_finalize_parts(G1SurvivorRegions* survivors) {
       _collection_set_regions[_collection_set_cur_length++] = hr->hrm_index();
       _bytes_used_before += hr->used();
       _g1h->register_old_region_with_cset(hr);
+      _semeru_swapped_out_live_pages += hr->_mem_to_cpu_gc->_alive_ratio * _g1h->swapped_out_pages(hr);
       log_trace(gc, cset)("Added region %d to collection set", hr->hrm_index());
     }
     else {
@@ -568,7 +644,7 @@ void G1CollectionSet::semeru_finalize_parts(G1SurvivorRegions* survivors) {
       hr->cross_region_ref_target_queue()->_age++;
       int threshold = RebuildThreshold;
       if(hr->cross_region_ref_target_queue()->_age > threshold) {
-        rmsc->add(hr->hrm_index());
+        rmsc->add(hr->hrm_index(), hr->region_to_memory_server_mapping());
         // mhr: add as optional
         _g1h->old_set_remove(hr);
         add_optional_region(hr);
@@ -710,17 +786,22 @@ static int compare_region_idx(const uint a, const uint b) {
   }
 }
 
+void G1CollectionSet::add_mem_server_region(HeapRegion* hr) {
+  _g1h->recv_mem_server_cset()->add(hr->hrm_index(), hr->region_to_memory_server_mapping());
+  _g1h->old_set_remove(hr);
+  add_optional_region(hr);
+}
+
 /**
  * Return the pages cached in CPU server local DRAM of this region, hr. 
  */
 size_t G1CollectionSet::cache_ratio_pages(HeapRegion* hr) {
 
-  // Example of use swap out ratio
-  // Kernel doesn't float point, so we can only renturn the swapped out page numbers.
-  // The requested range can only be at [SEMERU_START_ADDR + RDMA_STRUCTURE_SPACE_SIZE, to the heap END(32GB max))
+  // The kernel counts the swapped out pages of each Region into the map shared with the JVM.
+  // Plain loads in the STW window, no syscall per Region.
   size_t request_start_addr = (size_t)hr->bottom();
   size_t request_size = HeapRegion::GrainBytes; // one Region
-  size_t swapped_out_pages  = syscall(SYS_NUM_SWAP_OUT_PAGES, request_start_addr, request_size);
+  size_t swapped_out_pages  = _g1h->swapped_out_pages(hr);
   log_debug(semeru)("%s, Region[%u], swapped out 0x%lx pages ( out of 0x%lx pages, ratio %f) for range[0x%lx, 0x%lx) \n", 
                 __func__, hr->hrm_index(), swapped_out_pages, HeapRegion::GrainBytes/PAGE_SIZE , (double)swapped_out_pages*PAGE_SIZE/HeapRegion::GrainBytes, 
                 request_start_addr, request_start_addr + request_size );
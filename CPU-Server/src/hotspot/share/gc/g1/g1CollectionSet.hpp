@@ -61,6 +61,9 @@ public:
   size_t _collection_set_max_length;
   size_t _rebuild_set_length;
 
+  // Semeru, the alive ratio weighted swapped out pages of the old Regions evacuated by the CPU server.
+  double _semeru_swapped_out_live_pages;
+
   // When doing mixed collections we can add old regions to the collection, which
   // can be collected if there is enough time. We call these optional regions and
   // the pointer to these regions are stored in the array below.
@@ -125,6 +128,8 @@ private:
 
   //mhr: modify
   size_t cache_ratio_pages(HeapRegion* hr);
+  // Hand the old Region to its memory server, compacted after the STW window.
+  void add_mem_server_region(HeapRegion* hr);
 
 public:
   G1CollectionSet(G1CollectedHeap* g1h, G1Policy* policy);
@@ -201,6 +206,7 @@ public:
   //mhr: modify
   //mhr: new
   void semeru_finalize_parts(G1SurvivorRegions* survivors);
+  double semeru_swapped_out_live_pages() const { return _semeru_swapped_out_live_pages; }
   //void finalize_parts_with_ratio(G1SurvivorRegions* survivors);
 
   // Add old region "hr" to the collection set.
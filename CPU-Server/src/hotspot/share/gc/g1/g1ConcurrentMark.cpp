@@ -26,6 +26,7 @@
 #include "classfile/classLoaderDataGraph.hpp"
 #include "code/codeCache.hpp"
 #include "gc/g1/g1BarrierSet.hpp"
+#include "gc/g1/g1CMRemoteRegions.hpp"
 #include "gc/g1/g1CollectedHeap.inline.hpp"
 #include "gc/g1/g1CollectorState.hpp"
 #include "gc/g1/g1ConcurrentMark.inline.hpp"
@@ -278,10 +279,10 @@ void G1CMRootRegions::add(HeapRegion* hr) {
   _root_regions[idx] = hr;
 }
 
-void G1CMRootRegions::prepare_for_scan() {
+void G1CMRootRegions::prepare_for_scan(bool has_remote_regions) {
   assert(!scan_in_progress(), "pre-condition");
 
-  _scan_in_progress = _num_root_regions > 0;
+  _scan_in_progress = _num_root_regions > 0 || has_remote_regions;
 
   _claimed_root_regions = 0;
   _should_abort = false;
@@ -367,6 +368,7 @@ G1ConcurrentMark::G1ConcurrentMark(G1CollectedHeap* g1h,
   _heap(_g1h->reserved_region()),
 
   _root_regions(_g1h->max_regions()),
+  _remote_regions(SemeruRemoteConcurrentMark ? new G1CMRemoteRegions(g1h, this) : NULL),
 
   _global_mark_stack(),
 
@@ -756,13 +758,24 @@ void G1ConcurrentMark::post_initial_mark() {
   rp->enable_discovery();
   rp->setup_policy(false); // snapshot the soft ref policy to be used in this cycle
 
-  SATBMarkQueueSet& satb_mq_set = G1BarrierSet::satb_mark_queue_set();
+  G1SATBMarkQueueSet& satb_mq_set = G1BarrierSet::satb_mark_queue_set();
   // This is the start of  the marking cycle, we're expected all
   // threads to have SATB queues with active set to false.
+  // Unless -XX:+SemeruSATBForwarding activated them at an earlier pause.
   satb_mq_set.set_active_all_threads(true, /* new active value */
-                                     false /* expected_active */);
+                                     SemeruSATBForwarding && satb_mq_set.is_active() /* expected_active */);
+  satb_mq_set.set_g1_marking(true);
 
-  _root_regions.prepare_for_scan();
+  // The evicted Regions traced by the memory servers aren't traced again.
+  if (_remote_regions != NULL) {
+    _remote_regions->select();
+  }
+  _root_regions.prepare_for_scan(_remote_regions != NULL && _remote_regions->num_kept() > 0);
+
+  // The class loaders of the evicted Regions are known by the memory servers.
+  if (SemeruRemoteClassUnloading && ClassUnloadingWithConcurrentMark) {
+    _g1h->mark_remote_class_loaders();
+  }
 
   // update_g1_committed() will be called at the end of an evac pause
   // when marking is on. So, it's also called at the end of the
@@ -919,17 +932,24 @@ void G1ConcurrentMark::scan_root_regions() {
   if (root_regions()->scan_in_progress()) {
     assert(!has_aborted(), "Aborting before root region scanning is finished not supported.");
 
-    _num_concurrent_workers = MIN2(calc_active_marking_workers(),
-                                   // We distribute work on a per-region basis, so starting
-                                   // more threads than that is useless.
-                                   root_regions()->num_root_regions());
-    assert(_num_concurrent_workers <= _max_concurrent_workers,
-           "Maximum number of marking threads exceeded");
+    // Serially, the requests share a single line of each memory server.
+    if (_remote_regions != NULL) {
+      _remote_regions->mark_roots(root_regions(), 0 /* worker_id */);
+    }
 
-    G1CMRootRegionScanTask task(this);
-    log_debug(gc, ergo)("Running %s using %u workers for %u work units.",
-                        task.name(), _num_concurrent_workers, root_regions()->num_root_regions());
-    _concurrent_workers->run_task(&task, _num_concurrent_workers);
+    if (root_regions()->num_root_regions() > 0) {
+      _num_concurrent_workers = MIN2(calc_active_marking_workers(),
+                                     // We distribute work on a per-region basis, so starting
+                                     // more threads than that is useless.
+                                     root_regions()->num_root_regions());
+      assert(_num_concurrent_workers <= _max_concurrent_workers,
+             "Maximum number of marking threads exceeded");
+
+      G1CMRootRegionScanTask task(this);
+      log_debug(gc, ergo)("Running %s using %u workers for %u work units.",
+                          task.name(), _num_concurrent_workers, root_regions()->num_root_regions());
+      _concurrent_workers->run_task(&task, _num_concurrent_workers);
+    }
 
     // It's possible that has_aborted() is true here without actually
     // aborting the survivor scan earlier. This is OK as it's
@@ -1148,6 +1168,11 @@ void G1ConcurrentMark::remark() {
 
   verify_during_pause(G1HeapVerifier::G1VerifyRemark, VerifyOption_G1UsePrevMarking, "Remark before");
 
+  // The partial buffers are drained by the remark tasks below, not by the filter. Forward their entries first.
+  if (SemeruSATBForwarding) {
+    G1BarrierSet::satb_mark_queue_set().filter_thread_buffers();
+  }
+
   {
     GCTraceTime(Debug, gc, phases) debug("Finalize Marking", _gc_timer_cm);
     finalize_marking();
@@ -1159,12 +1184,14 @@ void G1ConcurrentMark::remark() {
   if (mark_finished) {
     weak_refs_work(false /* clear_all_soft_refs */);
 
-    SATBMarkQueueSet& satb_mq_set = G1BarrierSet::satb_mark_queue_set();
+    G1SATBMarkQueueSet& satb_mq_set = G1BarrierSet::satb_mark_queue_set();
     // We're done with marking.
     // This is the end of the marking cycle, we're expected all
     // threads to have SATB queues with active set to true.
-    satb_mq_set.set_active_all_threads(false, /* new active value */
+    // -XX:+SemeruSATBForwarding keeps them active for the memory servers.
+    satb_mq_set.set_active_all_threads(SemeruSATBForwarding, /* new active value */
                                        true /* expected_active */);
+    satb_mq_set.set_g1_marking(false);
 
     {
       GCTraceTime(Debug, gc, phases) debug("Flush Task Caches", _gc_timer_cm);
@@ -2043,13 +2070,14 @@ void G1ConcurrentMark::concurrent_cycle_abort() {
   _second_overflow_barrier_sync.abort();
   _has_aborted = true;
 
-  SATBMarkQueueSet& satb_mq_set = G1BarrierSet::satb_mark_queue_set();
+  G1SATBMarkQueueSet& satb_mq_set = G1BarrierSet::satb_mark_queue_set();
   satb_mq_set.abandon_partial_marking();
   // This can be called either during or outside marking, we'll read
   // the expected_active value from the SATB queue set.
   satb_mq_set.set_active_all_threads(
-                                 false, /* new active value */
+                                 SemeruSATBForwarding, /* new active value */
                                  satb_mq_set.is_active() /* expected_active */);
+  satb_mq_set.set_g1_marking(false);
 }
 
 static void print_ms_time_info(const char* prefix, const char* name,
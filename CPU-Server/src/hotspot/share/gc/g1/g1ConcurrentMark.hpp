@@ -37,6 +37,7 @@ class ConcurrentGCTimer;
 class G1ConcurrentMarkThread;
 class G1CollectedHeap;
 class G1CMOopClosure;
+class G1CMRemoteRegions;
 class G1CMTask;
 class G1ConcurrentMark;
 class G1OldTracer;
@@ -256,11 +257,13 @@ public:
 
   void add(HeapRegion* hr);
 
-  // Reset the claiming / scanning of the root regions.
-  void prepare_for_scan();
+  // Reset the claiming / scanning of the root regions. Semeru CPU - The Regions left
+  // to the memory servers are roots as well, -XX:+SemeruRemoteConcurrentMark.
+  void prepare_for_scan(bool has_remote_regions);
 
   // Forces get_next() to return NULL so that the iteration aborts early.
   void abort() { _should_abort = true; }
+  bool should_abort() const { return _should_abort; }
 
   // Return true if the CM thread are actively scanning root regions,
   // false otherwise.
@@ -314,6 +317,9 @@ class G1ConcurrentMark : public CHeapObj<mtGC> {
   // Root region tracking and claiming
   G1CMRootRegions         _root_regions;
 
+  // Semeru CPU - The evicted Regions traced by the memory servers, -XX:+SemeruRemoteConcurrentMark.
+  G1CMRemoteRegions*      _remote_regions;
+
   // For grey objects
   G1CMMarkStack           _global_mark_stack; // Grey objects behind global finger
   HeapWord* volatile      _finger;            // The global finger, region aligned,
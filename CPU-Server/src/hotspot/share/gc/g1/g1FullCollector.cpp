@@ -113,6 +113,7 @@ G1FullCollector::G1FullCollector(G1CollectedHeap* heap, bool explicit_gc, bool c
     _serial_compaction_point(),
     _is_alive(heap->concurrent_mark()->next_mark_bitmap()),
     _is_alive_mutator(heap->ref_processor_stw(), &_is_alive),
+    _remote_regions(SemeruRemoteFullGC ? new G1FullGCRemoteRegions(heap) : NULL),
     _always_subject_to_discovery(),
     _is_subject_mutator(heap->ref_processor_stw(), &_always_subject_to_discovery) {
   assert(SafepointSynchronize::is_at_safepoint(), "must be at a safepoint");
@@ -135,6 +136,9 @@ G1FullCollector::~G1FullCollector() {
   }
   FREE_C_HEAP_ARRAY(G1FullGCMarker*, _markers);
   FREE_C_HEAP_ARRAY(G1FullGCCompactionPoint*, _compaction_points);
+  if (_remote_regions != NULL) {
+    delete _remote_regions;
+  }
 }
 
 void G1FullCollector::prepare_collection() {
@@ -165,6 +169,8 @@ void G1FullCollector::prepare_collection() {
 }
 
 void G1FullCollector::collect() {
+  phase0_keep_remote_regions();
+
   phase1_mark_live_objects();
   verify_after_marking();
 
@@ -200,6 +206,14 @@ void G1FullCollector::complete_collection() {
   _heap->print_heap_after_full_collection(scope()->heap_transition());
 }
 
+void G1FullCollector::phase0_keep_remote_regions() {
+  if (_remote_regions == NULL) {
+    return;
+  }
+  GCTraceTime(Info, gc, phases) info("Phase 0: Keep evicted Regions on the memory servers", scope()->timer());
+  _remote_regions->select();
+}
+
 void G1FullCollector::phase1_mark_live_objects() {
   // Recursively traverse all live objects and mark them.
   GCTraceTime(Info, gc, phases) info("Phase 1: Mark live objects", scope()->timer());
@@ -219,7 +233,7 @@ void G1FullCollector::phase1_mark_live_objects() {
   }
 
   // Class unloading and cleanup.
-  if (ClassUnloading) {
+  if (class_unloading()) {
     GCTraceTime(Debug, gc, phases) debug("Phase 1: Class Unloading and Cleanup", scope()->timer());
     // Unload classes and purge the SystemDictionary.
     bool purged_class = SystemDictionary::do_unloading(scope()->timer());
@@ -250,6 +264,11 @@ void G1FullCollector::phase3_adjust_pointers() {
 
   G1FullGCAdjustTask task(this);
   run_task(&task);
+
+  // The forwardees are valid until the compaction.
+  if (_remote_regions != NULL) {
+    _remote_regions->update_fields();
+  }
 }
 
 void G1FullCollector::phase4_do_compaction() {
@@ -279,6 +298,11 @@ void G1FullCollector::verify_after_marking() {
     // Only do verification if VerifyDuringGC and G1VerifyFull is set.
     return;
   }
+  if (G1FullGCRemoteRegions::is_active()) {
+    // The objects kept on the memory servers are live without a mark.
+    log_info(gc, verify)("Skipping verification during GC (full), Regions are kept on the memory servers");
+    return;
+  }
 
   HandleMark hm;  // handle scope
 #if COMPILER2_OR_JVMCI
@@ -28,6 +28,7 @@
 #include "gc/g1/g1FullGCCompactionPoint.hpp"
 #include "gc/g1/g1FullGCMarker.hpp"
 #include "gc/g1/g1FullGCOopClosures.hpp"
+#include "gc/g1/g1FullGCRemoteRegions.hpp"
 #include "gc/g1/g1FullGCScope.hpp"
 #include "gc/shared/preservedMarks.hpp"
 #include "gc/shared/referenceProcessor.hpp"
@@ -65,6 +66,7 @@ class G1FullCollector : StackObj {
   G1FullGCCompactionPoint   _serial_compaction_point;
   G1IsAliveClosure          _is_alive;
   ReferenceProcessorIsAliveMutator _is_alive_mutator;
+  G1FullGCRemoteRegions*    _remote_regions;   // -XX:+SemeruRemoteFullGC
 
   static uint calc_active_workers();
 
@@ -89,8 +91,13 @@ public:
   G1FullGCCompactionPoint* serial_compaction_point() { return &_serial_compaction_point; }
   G1CMBitMap*              mark_bitmap();
   ReferenceProcessor*      reference_processor();
+  G1FullGCRemoteRegions*   remote_regions() { return _remote_regions; }
+
+  // The classes of the objects kept on the memory servers are unknown, nothing is unloaded then.
+  bool class_unloading() const { return ClassUnloading && !G1FullGCRemoteRegions::is_active(); }
 
 private:
+  void phase0_keep_remote_regions();
   void phase1_mark_live_objects();
   void phase2_prepare_compaction();
   void phase3_adjust_pointers();
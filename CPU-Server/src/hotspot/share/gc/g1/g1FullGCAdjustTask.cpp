@@ -31,6 +31,7 @@
 #include "gc/g1/g1FullGCCompactionPoint.hpp"
 #include "gc/g1/g1FullGCMarker.hpp"
 #include "gc/g1/g1FullGCOopClosures.inline.hpp"
+#include "gc/g1/g1FullGCRemoteRegions.inline.hpp"
 #include "gc/g1/heapRegion.inline.hpp"
 #include "gc/shared/gcTraceTime.inline.hpp"
 #include "gc/shared/referenceProcessor.hpp"
@@ -64,6 +65,10 @@ class G1AdjustRegionClosure : public HeapRegionClosure {
 
   //mhr: modify
   bool do_heap_region(HeapRegion* r) {
+    if (G1FullGCRemoteRegions::is_kept_region(r->hrm_index())) {
+      // Its fields are updated by its memory server, G1FullGCRemoteRegions::update_fields().
+      return false;
+    }
     if (r->is_humongous()) {
       G1AdjustClosureNew cl;
       cl.set_worker_id(_worker_id);
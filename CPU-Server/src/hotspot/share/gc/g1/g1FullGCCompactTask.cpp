@@ -28,6 +28,7 @@
 #include "gc/g1/g1FullCollector.hpp"
 #include "gc/g1/g1FullGCCompactionPoint.hpp"
 #include "gc/g1/g1FullGCCompactTask.hpp"
+#include "gc/g1/g1FullGCRemoteRegions.inline.hpp"
 #include "gc/g1/heapRegion.inline.hpp"
 #include "gc/shared/gcTraceTime.inline.hpp"
 #include "logging/log.hpp"
@@ -54,6 +55,9 @@ public:
         }
       }
       current->reset_during_compaction();
+    } else if (G1FullGCRemoteRegions::is_kept_region(current->hrm_index())) {
+      // Kept in place, every object is live after the full GC.
+      current->reset_during_compaction();
     }
     return false;
   }
@@ -48,7 +48,7 @@ void G1FullGCMarkTask::work(uint worker_id) {
   G1FullGCMarker* marker = collector()->marker(worker_id);
   MarkingCodeBlobClosure code_closure(marker->mark_closure(), !CodeBlobToOopClosure::FixRelocations);
 
-  if (ClassUnloading) {
+  if (collector()->class_unloading()) {
     _root_processor.process_strong_roots(
         marker->mark_closure(),
         marker->cld_closure(),
@@ -60,6 +60,11 @@ void G1FullGCMarkTask::work(uint worker_id) {
         &code_closure);
   }
 
+  // The fields of the Regions kept on the memory servers.
+  if (collector()->remote_regions() != NULL) {
+    collector()->remote_regions()->mark_roots(marker);
+  }
+
   // Mark stack is populated, now process and drain it.
   marker->complete_marking(collector()->oop_queue_set(), collector()->array_queue_set(), _terminator.terminator());
 
@@ -43,6 +43,11 @@ inline bool G1FullGCMarker::mark_object(oop obj) {
     return false;
   }
 
+  // Not marking the objects kept on the memory servers, they are all live.
+  if (G1FullGCRemoteRegions::is_kept(obj)) {
+    return false;
+  }
+
   // Try to mark.
   if (!_bitmap->par_mark(obj)) {
     // Lost mark race.
@@ -71,8 +76,9 @@ template <class T> inline void G1FullGCMarker::mark_and_push(T* p) {
       _oop_stack.push(obj);
       assert(_bitmap->is_marked(obj), "Must be marked now - map self");
     } else {
-      assert(_bitmap->is_marked(obj) || G1ArchiveAllocator::is_closed_archive_object(obj),
-             "Must be marked by other or closed archive object");
+      assert(_bitmap->is_marked(obj) || G1ArchiveAllocator::is_closed_archive_object(obj) ||
+             G1FullGCRemoteRegions::is_kept(obj),
+             "Must be marked by other, closed archive or kept object");
     }
   }
 }
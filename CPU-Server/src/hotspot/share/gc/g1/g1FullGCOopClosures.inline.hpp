@@ -29,6 +29,7 @@
 #include "gc/g1/g1ConcurrentMarkBitMap.inline.hpp"
 #include "gc/g1/g1FullGCMarker.inline.hpp"
 #include "gc/g1/g1FullGCOopClosures.hpp"
+#include "gc/g1/g1FullGCRemoteRegions.inline.hpp"
 #include "gc/g1/heapRegionRemSet.hpp"
 #include "memory/iterator.inline.hpp"
 #include "oops/access.inline.hpp"
@@ -72,6 +73,10 @@ template <class T> inline void G1AdjustClosureNew::adjust_pointer(T* p) {
     // We never forward archive objects.
     return;
   }
+  if (G1FullGCRemoteRegions::is_kept(obj)) {
+    // Kept in place, its mark word is not a forwarding pointer.
+    return;
+  }
 
   oop forwardee = obj->forwardee();
   if (forwardee == NULL) {
@@ -161,6 +166,10 @@ template <class T> inline void G1AdjustClosure::adjust_pointer(T* p) {
     // We never forward archive objects.
     return;
   }
+  if (G1FullGCRemoteRegions::is_kept(obj)) {
+    // Kept in place, its mark word is not a forwarding pointer.
+    return;
+  }
 
   oop forwardee = obj->forwardee();
   if (forwardee == NULL) {
@@ -216,7 +225,7 @@ inline void G1AdjustClosure::do_oop(oop* p)       { do_oop_work(p); }
 inline void G1AdjustClosure::do_oop(narrowOop* p) { do_oop_work(p); }
 
 inline bool G1IsAliveClosure::do_object_b(oop p) {
-  return _bitmap->is_marked(p) || G1ArchiveAllocator::is_closed_archive_object(p);
+  return _bitmap->is_marked(p) || G1ArchiveAllocator::is_closed_archive_object(p) || G1FullGCRemoteRegions::is_kept(p);
 }
 
 template<typename T>
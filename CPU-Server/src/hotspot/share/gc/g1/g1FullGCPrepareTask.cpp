@@ -30,6 +30,7 @@
 #include "gc/g1/g1FullGCMarker.hpp"
 #include "gc/g1/g1FullGCOopClosures.inline.hpp"
 #include "gc/g1/g1FullGCPrepareTask.hpp"
+#include "gc/g1/g1FullGCRemoteRegions.inline.hpp"
 #include "gc/g1/g1HotCardCache.hpp"
 #include "gc/g1/heapRegion.inline.hpp"
 #include "gc/shared/gcTraceTime.inline.hpp"
@@ -49,7 +50,7 @@ bool G1FullGCPrepareTask::G1CalculatePointersClosure::do_heap_region(HeapRegion*
     } else {
       free_humongous_region(hr);
     }
-  } else if (!hr->is_pinned()) {
+  } else if (!hr->is_pinned() && !G1FullGCRemoteRegions::is_kept_region(hr->hrm_index())) {
     prepare_for_compaction(hr);
   }
 
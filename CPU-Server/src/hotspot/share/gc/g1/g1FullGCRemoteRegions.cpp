@@ -0,0 +1,373 @@
+/**
+ * Semeru CPU Server - the old Regions the full GC leaves to their memory servers, -XX:+SemeruRemoteFullGC.
+ *
+ */
+
+#include "precompiled.hpp"
+#include "gc/g1/g1Allocator.inline.hpp"
+#include "gc/g1/g1CollectedHeap.inline.hpp"
+#include "gc/g1/g1FullGCMarker.inline.hpp"
+#include "gc/g1/g1FullGCRemoteRegions.inline.hpp"
+#include "gc/g1/heapRegion.inline.hpp"
+#include "gc/g1/heapRegionRemSet.hpp"
+#include "logging/log.hpp"
+#include "oops/access.inline.hpp"
+#include "oops/oop.inline.hpp"
+#include "runtime/atomic.hpp"
+#include "runtime/os.hpp"
+#include "runtime/rdma_cp_comm.hpp"
+
+G1FullGCRemoteRegions* G1FullGCRemoteRegions::_active = NULL;
+
+G1FullGCRemoteRegions::G1FullGCRemoteRegions(G1CollectedHeap* g1h) :
+  _g1h(g1h),
+  _max_regions(MIN2(g1h->max_regions(), (uint)SEMERU_MAX_REGIONS)),
+  _kept(NEW_C_HEAP_ARRAY(bool, _max_regions, mtGC)),
+  _kept_list(NEW_C_HEAP_ARRAY(uint, _max_regions, mtGC)),
+  _slot_end(NEW_C_HEAP_ARRAY(size_t, _max_regions, mtGC)),
+  _num_kept(0),
+  _slots(NULL),
+  _num_slots(0),
+  _max_slots(0),
+  _claimed_slots(0) {
+  memset(_kept, 0, _max_regions * sizeof(bool));
+  for (size_t mem_id = 0; mem_id < MAX_NUM_OF_MEMORY_SERVER; mem_id++) {
+    _failed[mem_id] = false;
+  }
+}
+
+G1FullGCRemoteRegions::~G1FullGCRemoteRegions() {
+  if (_active == this) {
+    _active = NULL;
+  }
+  if (_slots != NULL) {
+    FREE_C_HEAP_ARRAY(remote_card_scan::slot, _slots);
+  }
+  FREE_C_HEAP_ARRAY(size_t, _slot_end);
+  FREE_C_HEAP_ARRAY(uint, _kept_list);
+  FREE_C_HEAP_ARRAY(bool, _kept);
+}
+
+/**
+ * Only a Region the memory server holds completely, and whose objects are all live and parsable
+ * without the prev bitmap : nothing marked below the prev TAMS is dead.
+ * The Regions of the memory server CSet are left out, the memory server may be compacting them.
+ */
+bool G1FullGCRemoteRegions::is_candidate(HeapRegion* hr, const bool* in_mem_server_cset) const {
+  if (!hr->is_old() || hr->is_pinned() || hr->top() == hr->bottom() || in_mem_server_cset[hr->hrm_index()]) {
+    return false;
+  }
+  HeapWord* const ptams = hr->prev_top_at_mark_start();
+  if (ptams != hr->bottom() && hr->marked_bytes() != pointer_delta(ptams, hr->bottom()) * HeapWordSize) {
+    return false;
+  }
+  int const mem_id = hr->region_to_memory_server_mapping();
+  return mem_id >= 0 && (size_t)mem_id < SemeruMemServerNum && !_failed[mem_id] &&
+         _g1h->swapped_out_pages(hr) == HeapRegion::GrainBytes/PAGE_SIZE;
+}
+
+// The payload of the request is written, write its header and the sequence, on the same QP.
+bool G1FullGCRemoteRegions::post(int mem_id, remote_card_scan::Mode mode, uint32_t seq, uint32_t num_cards) {
+  remote_card_scan* scan = _g1h->remote_cards();
+  scan->_num_cards   = num_cards;
+  scan->_mode        = mode;
+  scan->_request_seq = seq;
+  if (semeru_cp_write(mem_id, (void*)&scan->_num_cards, 2 * sizeof(uint32_t)) != 0 ||
+      semeru_cp_write(mem_id, (void*)&scan->_request_seq, sizeof(uint32_t)) != 0) {
+    log_warning(semeru,rdma)("%s, can't post the full GC request to memory server[%d].", __func__, mem_id);
+    _failed[mem_id] = true;
+    return false;
+  }
+  _g1h->ring_mem_server_doorbell((size_t)mem_id);
+  return true;
+}
+
+bool G1FullGCRemoteRegions::receive(int mem_id, uint32_t seq) {
+  remote_card_scan* scan = _g1h->remote_cards();
+  jlong deadline = os::javaTimeMillis() + (jlong)SemeruRemoteFullGCTimeoutMs;
+  scan->_done_seq = seq - 1;   // the local copy may hold the reply of the previous memory server.
+  do {
+    if (semeru_cp_read(mem_id, (void*)&scan->_done_seq, remote_card_scan::reply_size()) == 0 &&
+        scan->_done_seq == seq) {
+      return true;
+    }
+    os::naked_short_sleep(1);
+  } while (os::javaTimeMillis() < deadline);
+
+  log_debug(gc, phases)("Semeru remote full GC: memory server[%d] didn't reply, its Regions are collected locally", mem_id);
+  _failed[mem_id] = true;
+  return false;
+}
+
+void G1FullGCRemoteRegions::add_slots(uint region_index, const remote_card_scan::slot* slots, size_t num_slots) {
+  if (_num_slots + num_slots > _max_slots) {
+    _max_slots = MAX2(_max_slots * 2, _num_slots + num_slots);
+    _slots = REALLOC_C_HEAP_ARRAY(remote_card_scan::slot, _slots, _max_slots, mtGC);
+  }
+  memcpy(&_slots[_num_slots], slots, num_slots * sizeof(remote_card_scan::slot));
+  _num_slots += num_slots;
+
+  _kept[region_index]       = true;
+  _kept_list[_num_kept]     = region_index;
+  _slot_end[_num_kept]      = _num_slots;
+  _num_kept++;
+}
+
+void G1FullGCRemoteRegions::store_locally(const remote_card_scan::slot* updates, size_t num_updates) {
+  for (size_t i = 0; i < num_updates; i++) {
+    if (UseCompressedOops) {
+      RawAccess<IS_NOT_NULL>::oop_store((narrowOop*)updates[i]._addr, oop(updates[i]._value));
+    } else {
+      RawAccess<IS_NOT_NULL>::oop_store((oop*)updates[i]._addr, oop(updates[i]._value));
+    }
+  }
+}
+
+/**
+ * One Region in flight per memory server, the same sequence for all of them in a round.
+ * The remote_card_scan at REMOTE_CARD_SCAN_OFFSET is only used by the evacuation pause otherwise.
+ */
+void G1FullGCRemoteRegions::select() {
+  remote_card_scan* scan = _g1h->remote_cards();
+  if (scan == NULL) {
+    return;
+  }
+  jlong start = os::javaTimeMillis();
+
+  bool* in_mem_server_cset = NEW_C_HEAP_ARRAY(bool, _max_regions, mtGC);
+  memset(in_mem_server_cset, 0, _max_regions * sizeof(bool));
+  received_memory_server_cset* cset = _g1h->recv_mem_server_cset();
+  for (size_t mem_id = 0; mem_id < SemeruMemServerNum; mem_id++) {
+    size_t num_mem_cset = *(cset->num_received_regions(mem_id));
+    for (size_t i = 0; i < num_mem_cset; i++) {
+      uint index = cset->get(mem_id, i);
+      if (index < _max_regions) {
+        in_mem_server_cset[index] = true;
+      }
+    }
+  }
+
+  // The candidates of each memory server.
+  uint* candidates[MAX_NUM_OF_MEMORY_SERVER];
+  uint  num_candidates[MAX_NUM_OF_MEMORY_SERVER];
+  uint  next[MAX_NUM_OF_MEMORY_SERVER];
+  uint  total = 0;
+  for (size_t mem_id = 0; mem_id < SemeruMemServerNum; mem_id++) {
+    candidates[mem_id]     = NEW_C_HEAP_ARRAY(uint, _max_regions, mtGC);
+    num_candidates[mem_id] = 0;
+    next[mem_id]           = 0;
+  }
+  for (uint i = 0; i < _max_regions; i++) {
+    HeapRegion* hr = _g1h->region_at_or_null(i);
+    if (hr != NULL && is_candidate(hr, in_mem_server_cset)) {
+      int mem_id = hr->region_to_memory_server_mapping();
+      candidates[mem_id][num_candidates[mem_id]++] = i;
+      total++;
+    }
+  }
+
+  size_t overflowed = 0;
+  bool more = total > 0;
+  while (more) {
+    uint32_t seq = scan->_request_seq + 1;
+    int requested[MAX_NUM_OF_MEMORY_SERVER];
+    more = false;
+
+    // 1) A Refine request of the whole Region, every field pointing out of it.
+    for (size_t mem_id = 0; mem_id < SemeruMemServerNum; mem_id++) {
+      requested[mem_id] = -1;
+      if (_failed[mem_id] || next[mem_id] == num_candidates[mem_id]) {
+        continue;
+      }
+      uint index = candidates[mem_id][next[mem_id]++];
+      HeapRegion* hr = _g1h->region_at(index);
+      remote_card_scan::card* c = &scan->_cards[0];
+      c->_block = hr->bottom();
+      c->_start = hr->bottom();
+      c->_end   = hr->top();
+      if (semeru_cp_write((int)mem_id, (void*)c, sizeof(remote_card_scan::card)) != 0 ||
+          !post((int)mem_id, remote_card_scan::Refine, seq, 1)) {
+        _failed[mem_id] = true;
+        continue;
+      }
+      requested[mem_id] = (int)index;
+      more = true;
+    }
+
+    // 2) The Region is kept if all its fields fit into the reply.
+    for (size_t mem_id = 0; mem_id < SemeruMemServerNum; mem_id++) {
+      if (requested[mem_id] < 0 || !receive((int)mem_id, seq)) {
+        continue;
+      }
+      size_t num_slots = scan->_num_slots;
+      if (scan->_overflow != 0 || num_slots > SEMERU_MAX_REMOTE_SLOTS ||
+          (num_slots > 0 &&
+           semeru_cp_read((int)mem_id, (void*)scan->_slots, num_slots * sizeof(remote_card_scan::slot)) != 0)) {
+        overflowed++;
+        continue;
+      }
+      add_slots((uint)requested[mem_id], scan->_slots, num_slots);
+    }
+  }
+
+  for (size_t mem_id = 0; mem_id < SemeruMemServerNum; mem_id++) {
+    FREE_C_HEAP_ARRAY(uint, candidates[mem_id]);
+  }
+  FREE_C_HEAP_ARRAY(bool, in_mem_server_cset);
+
+  if (_num_kept > 0) {
+    _active = this;
+  }
+  log_info(gc, phases)("Semeru remote full GC: %u of %u evicted Regions kept on the memory servers (" SIZE_FORMAT " overflowed), "
+                       SIZE_FORMAT " fields, " JLONG_FORMAT " ms",
+                       _num_kept, total, overflowed, _num_slots, os::javaTimeMillis() - start);
+}
+
+// The kept objects are not marked, the targets of their fields are marked and traced as roots.
+void G1FullGCRemoteRegions::mark_roots(G1FullGCMarker* marker) {
+  while (_claimed_slots < _num_slots) {
+    size_t next = Atomic::add(slot_chunk_size(), &_claimed_slots) - slot_chunk_size();
+    size_t max = MIN2(next + slot_chunk_size(), _num_slots);
+    for (size_t i = next; i < max; i++) {
+      oop obj = oop(_slots[i]._value);
+      marker->mark_and_push(&obj);
+    }
+  }
+}
+
+/**
+ * The new value of each field whose target is forwarded, grouped by the memory server of its Region.
+ * The remembered set of the forwardee gets the field, as G1AdjustClosureNew::adjust_pointer() does for the rest.
+ */
+void G1FullGCRemoteRegions::update_fields() {
+  if (_num_kept == 0) {
+    return;
+  }
+  remote_card_scan* scan = _g1h->remote_cards();
+  jlong start = os::javaTimeMillis();
+
+  remote_card_scan::slot* updates = NEW_C_HEAP_ARRAY(remote_card_scan::slot, MAX2(_num_slots, (size_t)1), mtGC);
+  uint*   order      = NEW_C_HEAP_ARRAY(uint, _num_kept, mtGC);     // positions in _kept_list, by memory server
+  size_t* update_end = NEW_C_HEAP_ARRAY(size_t, _num_kept, mtGC);   // the updates of order[i] end here
+  bool*   stored     = NEW_C_HEAP_ARRAY(bool, _num_kept, mtGC);     // by the memory server
+  uint    first[MAX_NUM_OF_MEMORY_SERVER + 1];
+  size_t  num_updates = 0;
+  uint    n = 0;
+
+  for (size_t mem_id = 0; mem_id < SemeruMemServerNum; mem_id++) {
+    first[mem_id] = n;
+    for (uint k = 0; k < _num_kept; k++) {
+      HeapRegion* hr = _g1h->region_at(_kept_list[k]);
+      if (hr->region_to_memory_server_mapping() != (int)mem_id) {
+        continue;
+      }
+      for (size_t i = (k == 0 ? 0 : _slot_end[k - 1]); i < _slot_end[k]; i++) {
+        void* p = _slots[i]._addr;
+        oop obj = oop(_slots[i]._value);
+        if (is_kept(obj) || G1ArchiveAllocator::is_archived_object(obj)) {
+          continue;
+        }
+        oop forwardee = obj->forwardee();
+        if (forwardee == NULL) {
+          continue;
+        }
+        updates[num_updates]._addr  = p;
+        updates[num_updates]._value = (HeapWord*)forwardee;
+        num_updates++;
+
+        if (!HeapRegion::is_in_same_region((HeapWord*)p, forwardee)) {
+          HeapRegionRemSet* to_rem_set = _g1h->heap_region_containing(forwardee)->rem_set();
+          if (!to_rem_set->is_tracked()) {
+            to_rem_set->set_state_complete();
+          }
+          to_rem_set->add_reference(p, 0);
+        }
+      }
+      order[n]      = k;
+      update_end[n] = num_updates;
+      stored[n]     = false;
+      n++;
+    }
+  }
+  first[SemeruMemServerNum] = n;
+  assert(n == _num_kept, "every kept Region has a memory server");
+
+  // Batches of whole Regions, one per memory server in flight.
+  uint next[MAX_NUM_OF_MEMORY_SERVER];
+  uint batch_first[MAX_NUM_OF_MEMORY_SERVER];
+  for (size_t mem_id = 0; mem_id < SemeruMemServerNum; mem_id++) {
+    next[mem_id] = first[mem_id];
+  }
+  bool more = true;
+  while (more) {
+    uint32_t seq = scan->_request_seq + 1;
+    bool requested[MAX_NUM_OF_MEMORY_SERVER];
+    more = false;
+
+    for (size_t mem_id = 0; mem_id < SemeruMemServerNum; mem_id++) {
+      uint p = next[mem_id];
+      batch_first[mem_id] = p;
+      requested[mem_id]   = false;
+      if (p == first[mem_id + 1]) {
+        continue;
+      }
+      size_t begin = (p == 0 ? 0 : update_end[p - 1]);
+      uint q = p;
+      while (q < first[mem_id + 1] && update_end[q] - begin <= SEMERU_MAX_REMOTE_SLOTS) {
+        q++;
+      }
+      next[mem_id] = q;
+      more = true;
+
+      size_t count = update_end[q - 1] - begin;
+      if (count == 0 || _failed[mem_id]) {
+        continue;
+      }
+      scan->_num_slots = count;
+      memcpy(scan->_slots, updates + begin, count * sizeof(remote_card_scan::slot));
+      requested[mem_id] = semeru_cp_write((int)mem_id, (void*)scan->_slots, count * sizeof(remote_card_scan::slot)) == 0 &&
+                          semeru_cp_write((int)mem_id, (void*)&scan->_num_slots, sizeof(size_t)) == 0 &&
+                          post((int)mem_id, remote_card_scan::Apply, seq, 0);
+    }
+
+    for (size_t mem_id = 0; mem_id < SemeruMemServerNum; mem_id++) {
+      uint p = batch_first[mem_id];
+      if (p == next[mem_id]) {
+        continue;
+      }
+      size_t count = update_end[next[mem_id] - 1] - (p == 0 ? 0 : update_end[p - 1]);
+      bool done = count == 0 ||
+                  (requested[mem_id] && receive((int)mem_id, seq) && scan->_overflow == 0 && scan->_num_scanned == count);
+      for (; p < next[mem_id]; p++) {
+        stored[p] = done;
+      }
+    }
+  }
+
+  // The cached pages of the Regions rewritten by the memory servers are stale. A Region swapped in meanwhile,
+  // or not updated remotely, gets the new values locally, they are written back with its pages.
+  size_t remote_updates = 0;
+  for (uint p = 0; p < n; p++) {
+    HeapRegion* hr = _g1h->region_at(_kept_list[order[p]]);
+    size_t begin = (p == 0 ? 0 : update_end[p - 1]);
+    size_t count = update_end[p] - begin;
+    if (count == 0) {
+      continue;
+    }
+    if (stored[p]) {
+      syscall(RDMA_REGION_FENCE, SEMERU_FENCE_REWRITE, hr->bottom(), HeapRegion::GrainBytes);
+      remote_updates += count;
+    }
+    if (!stored[p] || _g1h->swapped_out_pages(hr) < HeapRegion::GrainBytes/PAGE_SIZE) {
+      store_locally(updates + begin, count);
+    }
+  }
+
+  FREE_C_HEAP_ARRAY(bool, stored);
+  FREE_C_HEAP_ARRAY(size_t, update_end);
+  FREE_C_HEAP_ARRAY(uint, order);
+  FREE_C_HEAP_ARRAY(remote_card_scan::slot, updates);
+
+  log_info(gc, phases)("Semeru remote full GC: " SIZE_FORMAT " of " SIZE_FORMAT " fields of the kept Regions updated by the memory servers, "
+                       JLONG_FORMAT " ms", remote_updates, num_updates, os::javaTimeMillis() - start);
+}
@@ -0,0 +1,82 @@
+/**
+ * Semeru CPU Server - the old Regions the full GC leaves to their memory servers, -XX:+SemeruRemoteFullGC.
+ *
+ */
+
+#ifndef SHARE_VM_GC_G1_G1FULLGCREMOTEREGIONS_HPP
+#define SHARE_VM_GC_G1_G1FULLGCREMOTEREGIONS_HPP
+
+#include "gc/shared/rdmaStructure.hpp"
+#include "memory/allocation.hpp"
+#include "oops/oopsHierarchy.hpp"
+
+class G1CollectedHeap;
+class G1FullGCMarker;
+class HeapRegion;
+
+/**
+ * Semeru CPU - The full GC marks, adjusts and compacts every Region, so it swaps in the whole heap,
+ * and evicts the pages it just touched to make room for the next ones. Most of the pause is spent in the swap.
+ *
+ * A fully evicted, completely live old Region is kept in place instead, its memory server holds the complete content.
+ * 1) select(), by the VM thread before the marking. One Refine request of [bottom, top) per Region through
+ *    the remote_card_scan at REMOTE_CARD_SCAN_OFFSET, the memory servers reply the fields pointing out of the Region.
+ *    A Region whose fields don't fit into a reply, or whose memory server doesn't reply in time, is collected as usual.
+ * 2) mark_roots(), by the marking workers. The objects of the kept Regions are live and not traced,
+ *    the targets of their fields are the roots of the rest of the heap.
+ * 3) The kept Regions are not compacted, the fields pointing into them are not adjusted.
+ * 4) update_fields(), by the VM thread after the pointers are adjusted, while the forwardees are still valid.
+ *    The new values of the fields are sent back by Apply requests, the Region is fenced, the cached pages are stale.
+ *    A field the memory server didn't store, or of a Region swapped in meanwhile, is stored locally.
+ *
+ * The classes of the objects in the kept Regions are not known here, no class is unloaded by such a full GC.
+ */
+class G1FullGCRemoteRegions : public CHeapObj<mtGC> {
+  // The full GC in progress, if it keeps any Region.
+  static G1FullGCRemoteRegions* _active;
+
+  G1CollectedHeap* _g1h;
+  uint             _max_regions;
+  bool*            _kept;         // by Region index
+  uint*            _kept_list;
+  size_t*          _slot_end;     // the slots of _kept_list[i] are [_slot_end[i-1], _slot_end[i])
+  uint             _num_kept;
+
+  // The fields of the kept Regions replied by the memory servers.
+  remote_card_scan::slot* _slots;
+  size_t                  _num_slots;
+  size_t                  _max_slots;
+  size_t volatile         _claimed_slots;
+
+  // A memory server without a reply in time isn't asked again within this full GC.
+  bool _failed[MAX_NUM_OF_MEMORY_SERVER];
+
+  static size_t slot_chunk_size() { return 64; }
+
+  bool is_candidate(HeapRegion* hr, const bool* in_mem_server_cset) const;
+  bool post(int mem_id, remote_card_scan::Mode mode, uint32_t seq, uint32_t num_cards);
+  bool receive(int mem_id, uint32_t seq);
+  void add_slots(uint region_index, const remote_card_scan::slot* slots, size_t num_slots);
+  static void store_locally(const remote_card_scan::slot* updates, size_t num_updates);
+
+public:
+  G1FullGCRemoteRegions(G1CollectedHeap* g1h);
+  ~G1FullGCRemoteRegions();
+
+  // By the VM thread, before the marking.
+  void select();
+
+  // By the marking workers, before the marking stacks are drained.
+  void mark_roots(G1FullGCMarker* marker);
+
+  // By the VM thread, after the pointers are adjusted and before the compaction.
+  void update_fields();
+
+  uint num_kept() const { return _num_kept; }
+
+  static bool is_active() { return _active != NULL; }
+  static inline bool is_kept_region(uint region_index);
+  static inline bool is_kept(const void* p);
+};
+
+#endif // SHARE_VM_GC_G1_G1FULLGCREMOTEREGIONS_HPP
@@ -0,0 +1,22 @@
+/**
+ * Semeru CPU Server - the old Regions the full GC leaves to their memory servers, -XX:+SemeruRemoteFullGC.
+ *
+ */
+
+#ifndef SHARE_VM_GC_G1_G1FULLGCREMOTEREGIONS_INLINE_HPP
+#define SHARE_VM_GC_G1_G1FULLGCREMOTEREGIONS_INLINE_HPP
+
+#include "gc/g1/g1CollectedHeap.inline.hpp"
+#include "gc/g1/g1FullGCRemoteRegions.hpp"
+
+inline bool G1FullGCRemoteRegions::is_kept_region(uint region_index) {
+  G1FullGCRemoteRegions* active = _active;
+  return active != NULL && region_index < active->_max_regions && active->_kept[region_index];
+}
+
+inline bool G1FullGCRemoteRegions::is_kept(const void* p) {
+  G1FullGCRemoteRegions* active = _active;
+  return active != NULL && is_kept_region(active->_g1h->addr_to_region((HeapWord*)p));
+}
+
+#endif // SHARE_VM_GC_G1_G1FULLGCREMOTEREGIONS_INLINE_HPP
@@ -126,6 +126,11 @@ G1GCPhaseTimes::G1GCPhaseTimes(STWGCTimer* gc_timer, uint max_gc_threads) :
   _gc_par_phases[YoungFreeCSet] = new WorkerDataArray<double>(max_gc_threads, "Young Free Collection Set (ms):");
   _gc_par_phases[NonYoungFreeCSet] = new WorkerDataArray<double>(max_gc_threads, "Non-Young Free Collection Set (ms):");
 
+  _gc_par_phases[SemeruReadRegionInfo] = new WorkerDataArray<double>(max_gc_threads, "Read Region Metadata (ms):");
+  _semeru_read_regions = new WorkerDataArray<size_t>(max_gc_threads, "Read Regions:");
+  _gc_par_phases[SemeruReadRegionInfo]->link_thread_work_items(_semeru_read_regions);
+  _gc_par_phases[SemeruTargetQueue] = new WorkerDataArray<double>(max_gc_threads, "Target Queue Flush (ms):");
+
   reset();
 }
 
@@ -162,6 +167,13 @@ void G1GCPhaseTimes::reset() {
   _cur_fast_reclaim_humongous_reclaimed = 0;
   _cur_verify_before_time_ms = 0.0;
   _cur_verify_after_time_ms = 0.0;
+  _cur_semeru_open_window_time_ms = 0.0;
+  _cur_semeru_wait_mem_server_time_ms = 0.0;
+  _cur_semeru_sync_compacted_time_ms = 0.0;
+  _cur_semeru_read_region_info_time_ms = 0.0;
+  _cur_semeru_send_klass_time_ms = 0.0;
+  _cur_semeru_send_cset_time_ms = 0.0;
+  _cur_semeru_close_window_time_ms = 0.0;
 
   for (int i = 0; i < GCParPhasesSentinel; i++) {
     if (_gc_par_phases[i] != NULL) {
@@ -210,7 +222,8 @@ void G1GCPhaseTimes::note_gc_end() {
                                  worker_time(ScanRS, i) +
                                  worker_time(CodeRoots, i) +
                                  worker_time(ObjCopy, i) +
-                                 worker_time(Termination, i);
+                                 worker_time(Termination, i) +
+                                 worker_time(SemeruTargetQueue, i);
 
       record_time_secs(Other, i, total_worker_time - worker_known_time);
     } else {
@@ -223,6 +236,7 @@ void G1GCPhaseTimes::note_gc_end() {
       ASSERT_PHASE_UNINITIALIZED(CodeRoots);
       ASSERT_PHASE_UNINITIALIZED(ObjCopy);
       ASSERT_PHASE_UNINITIALIZED(Termination);
+      ASSERT_PHASE_UNINITIALIZED(SemeruTargetQueue);
     }
   }
 }
@@ -338,6 +352,49 @@ void G1GCPhaseTimes::trace_count(const char* name, size_t value) const {
   log_trace(gc, phases)("%s%s: " SIZE_FORMAT, Indents[3], name, value);
 }
 
+// The RDMA operations of the phase in this pause, G1SemeruRdmaStats.
+void G1GCPhaseTimes::trace_semeru_rdma(G1SemeruRdmaStats::Phase phase, const char* name) const {
+  const G1SemeruRdmaStats::Counters* c = G1SemeruRdmaStats::last_pause(phase);
+  if (c->_ops == 0 && c->_ticks == 0) {
+    return;
+  }
+  log_trace(gc, phases)("%s%s: " JLONG_FORMAT " ops, " SIZE_FORMAT "%s, " TIME_FORMAT, Indents[3], name, c->_ops,
+                        byte_size_in_proper_unit((size_t)c->_bytes), proper_unit_for_byte_size((size_t)c->_bytes),
+                        TimeHelper::counter_to_millis(c->_ticks));
+}
+
+// The CSet send and the close of the STW window are taken out of the evacuation time.
+double G1GCPhaseTimes::print_semeru_mem_server_comm() const {
+  const double sum_ms = _cur_semeru_open_window_time_ms +
+                        _cur_semeru_wait_mem_server_time_ms +
+                        _cur_semeru_sync_compacted_time_ms +
+                        _cur_semeru_read_region_info_time_ms +
+                        _cur_semeru_send_klass_time_ms +
+                        _cur_semeru_send_cset_time_ms +
+                        _cur_semeru_close_window_time_ms;
+
+  info_time("Semeru Memory Servers", sum_ms);
+
+  debug_time("Open STW Window", _cur_semeru_open_window_time_ms);
+  trace_semeru_rdma(G1SemeruRdmaStats::OpenWindow);
+  debug_time("Wait For Memory Servers", _cur_semeru_wait_mem_server_time_ms);
+  trace_semeru_rdma(G1SemeruRdmaStats::WaitMemServer);
+  debug_time("Sync Compacted Regions", _cur_semeru_sync_compacted_time_ms);
+  trace_semeru_rdma(G1SemeruRdmaStats::SyncCompacted);
+  debug_time("Read Region Metadata", _cur_semeru_read_region_info_time_ms);
+  trace_phase(_gc_par_phases[SemeruReadRegionInfo]);
+  trace_semeru_rdma(G1SemeruRdmaStats::ReadRegionInfo);
+  debug_time("Send Klass Metadata", _cur_semeru_send_klass_time_ms);
+  trace_semeru_rdma(G1SemeruRdmaStats::SendKlass);
+  debug_time("Send Collection Set", _cur_semeru_send_cset_time_ms);
+  trace_semeru_rdma(G1SemeruRdmaStats::SendCSet);
+  debug_time("Close STW Window", _cur_semeru_close_window_time_ms);
+  trace_semeru_rdma(G1SemeruRdmaStats::CloseWindow);
+  // The other phases of the pause, e.g. the remote remembered set scans of the evacuation.
+  trace_semeru_rdma(G1SemeruRdmaStats::OtherPause, "Other RDMA");
+  return sum_ms;
+}
+
 double G1GCPhaseTimes::print_pre_evacuate_collection_set() const {
   const double sum_ms = _root_region_scan_wait_time_ms +
                         _recorded_young_cset_choice_time_ms +
@@ -395,6 +452,7 @@ double G1GCPhaseTimes::print_evacuate_collection_set() const {
 #endif
   debug_phase(_gc_par_phases[ObjCopy]);
   debug_phase(_gc_par_phases[Termination]);
+  debug_phase(_gc_par_phases[SemeruTargetQueue]);
   debug_phase(_gc_par_phases[Other]);
   debug_phase(_gc_par_phases[GCWorkerTotal]);
   trace_phase(_gc_par_phases[GCWorkerEnd], false);
@@ -481,6 +539,7 @@ void G1GCPhaseTimes::print() {
   }
 
   double accounted_ms = 0.0;
+  accounted_ms += print_semeru_mem_server_comm();
   accounted_ms += print_pre_evacuate_collection_set();
   accounted_ms += print_evacuate_collection_set();
   accounted_ms += print_evacuate_optional_collection_set();
@@ -527,7 +586,9 @@ const char* G1GCPhaseTimes::phase_name(GCParPhases phase) {
       "StringDedupTableFixup",
       "RedirtyCards",
       "YoungFreeCSet",
-      "NonYoungFreeCSet"
+      "NonYoungFreeCSet",
+      "SemeruReadRegionInfo",
+      "SemeruTargetQueue"
       //GCParPhasesSentinel only used to tell end of enum
       };
 
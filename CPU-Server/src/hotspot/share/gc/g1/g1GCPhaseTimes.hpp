@@ -25,6 +25,7 @@
 #ifndef SHARE_VM_GC_G1_G1GCPHASETIMES_HPP
 #define SHARE_VM_GC_G1_G1GCPHASETIMES_HPP
 
+#include "gc/g1/g1SemeruRdmaStats.hpp"
 #include "gc/shared/referenceProcessorPhaseTimes.hpp"
 #include "gc/shared/weakProcessorPhaseTimes.hpp"
 #include "jfr/jfrEvents.hpp"
@@ -79,6 +80,8 @@ class G1GCPhaseTimes : public CHeapObj<mtGC> {
     RedirtyCards,
     YoungFreeCSet,
     NonYoungFreeCSet,
+    SemeruReadRegionInfo,
+    SemeruTargetQueue,
     GCParPhasesSentinel
   };
 
@@ -126,6 +129,8 @@ class G1GCPhaseTimes : public CHeapObj<mtGC> {
 
   WorkerDataArray<size_t>* _redirtied_cards;
 
+  WorkerDataArray<size_t>* _semeru_read_regions;
+
   double _cur_collection_par_time_ms;
   double _cur_optional_evac_ms;
   double _cur_collection_code_root_fixup_time_ms;
@@ -176,6 +181,15 @@ class G1GCPhaseTimes : public CHeapObj<mtGC> {
   double _cur_verify_before_time_ms;
   double _cur_verify_after_time_ms;
 
+  // Semeru, the communication with the memory servers in the pause.
+  double _cur_semeru_open_window_time_ms;
+  double _cur_semeru_wait_mem_server_time_ms;
+  double _cur_semeru_sync_compacted_time_ms;
+  double _cur_semeru_read_region_info_time_ms;
+  double _cur_semeru_send_klass_time_ms;
+  double _cur_semeru_send_cset_time_ms;
+  double _cur_semeru_close_window_time_ms;
+
   ReferenceProcessorPhaseTimes _ref_phase_times;
   WeakProcessorPhaseTimes _weak_phase_times;
 
@@ -196,7 +210,9 @@ class G1GCPhaseTimes : public CHeapObj<mtGC> {
   void debug_time_for_reference(const char* name, double value) const;
   void trace_time(const char* name, double value) const;
   void trace_count(const char* name, size_t value) const;
+  void trace_semeru_rdma(G1SemeruRdmaStats::Phase phase, const char* name = "RDMA") const;
 
+  double print_semeru_mem_server_comm() const;
   double print_pre_evacuate_collection_set() const;
   double print_evacuate_collection_set() const;
   double print_evacuate_optional_collection_set() const;
@@ -339,6 +355,34 @@ class G1GCPhaseTimes : public CHeapObj<mtGC> {
     _cur_verify_after_time_ms = time_ms;
   }
 
+  void record_semeru_open_window_time_ms(double time_ms) {
+    _cur_semeru_open_window_time_ms = time_ms;
+  }
+
+  void record_semeru_wait_mem_server_time_ms(double time_ms) {
+    _cur_semeru_wait_mem_server_time_ms = time_ms;
+  }
+
+  void record_semeru_sync_compacted_time_ms(double time_ms) {
+    _cur_semeru_sync_compacted_time_ms = time_ms;
+  }
+
+  void record_semeru_read_region_info_time_ms(double time_ms) {
+    _cur_semeru_read_region_info_time_ms = time_ms;
+  }
+
+  void record_semeru_send_klass_time_ms(double time_ms) {
+    _cur_semeru_send_klass_time_ms = time_ms;
+  }
+
+  void record_semeru_send_cset_time_ms(double time_ms) {
+    _cur_semeru_send_cset_time_ms = time_ms;
+  }
+
+  void record_semeru_close_window_time_ms(double time_ms) {
+    _cur_semeru_close_window_time_ms = time_ms;
+  }
+
   void inc_external_accounted_time_ms(double time_ms) {
     _external_accounted_time_ms += time_ms;
   }
@@ -303,6 +303,9 @@ public:
   virtual ReferenceIterationMode reference_iteration_mode() { return DO_FIELDS; }
 
   template <class T> void do_oop_work(T* p);
+  // The field p holding obj, loaded by do_oop_work() or read by a memory server, -XX:+SemeruRemoteRefinement.
+  // p itself isn't loaded.
+  template <class T> void do_field(T* p, oop obj);
   virtual void do_oop(narrowOop* p) { do_oop_work(p); }
   virtual void do_oop(oop* p)       { do_oop_work(p); }
 };
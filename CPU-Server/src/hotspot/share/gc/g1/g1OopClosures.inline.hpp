@@ -30,6 +30,7 @@
 #include "gc/g1/g1OopClosures.hpp"
 #include "gc/g1/g1ParScanThreadState.inline.hpp"
 #include "gc/g1/g1RemSet.hpp"
+#include "gc/g1/g1SemeruTargetQueueThread.hpp"
 #include "gc/g1/heapRegion.inline.hpp"
 #include "gc/g1/heapRegionRemSet.hpp"
 #include "memory/iterator.inline.hpp"
@@ -57,6 +58,8 @@ inline void G1ScanClosureBase::prefetch_and_push(T* p, const oop obj) {
          obj->forwardee() == RawAccess<>::oop_load(p)),
          "p should still be pointing to obj or to its forwardee");
 
+  // Semeru, the RDMA read of a swapped out object, the counterpart of the cache prefetch above.
+  _par_scan_state->look_ahead(obj);
   _par_scan_state->push_on_queue(p);
 }
 
@@ -183,8 +186,11 @@ inline void G1ConcurrentRefineOopClosureNew::do_oop_work(T* p) {
   if (CompressedOops::is_null(o)) {
     return;
   }
-  oop obj = CompressedOops::decode_not_null(o);
+  do_field(p, CompressedOops::decode_not_null(o));
+}
 
+template <class T>
+inline void G1ConcurrentRefineOopClosureNew::do_field(T* p, oop obj) {
   check_obj_during_refinement(p, obj);
 
   if (HeapRegion::is_in_same_region(p, obj)) {
@@ -210,16 +216,20 @@ inline void G1ConcurrentRefineOopClosureNew::do_oop_work(T* p) {
 
     //mhr: modify
     //mhr: new
-    if(!_g1h->heap_region_containing(obj)->is_young()&&!_g1h->heap_region_containing(obj)->is_humongous())
-      to_target_obj_bit_queue->push(obj);
+    if(_g1h->heap_region_containing(obj)->records_target_marks()&&
+       to_target_obj_bit_queue->push(obj) && SemeruConcurrentTargetQueue &&
+       _g1h->heap_region_containing(obj)->set_target_marks_unsent())
+      _g1h->semeru_target_queue_thread()->note_unsent_region();
   }
   else{
     to_rem_set->add_reference(p, _worker_i);
 
     //mhr: modify
     //mhr: new
-    if(!_g1h->heap_region_containing(obj)->is_young()&&!_g1h->heap_region_containing(obj)->is_humongous())
-      to_target_obj_bit_queue->push(obj);
+    if(_g1h->heap_region_containing(obj)->records_target_marks()&&
+       to_target_obj_bit_queue->push(obj) && SemeruConcurrentTargetQueue &&
+       _g1h->heap_region_containing(obj)->set_target_marks_unsent())
+      _g1h->semeru_target_queue_thread()->note_unsent_region();
   }
 }
 
@@ -269,7 +279,7 @@ inline void G1ScanObjsDuringUpdateRSClosureNew::do_oop_work(T* p) {
 
     //mhr: modify
     //mhr: new
-    if(!_g1h->heap_region_containing(obj)->is_young()&&!_g1h->heap_region_containing(obj)->is_humongous())
+    if(_g1h->heap_region_containing(obj)->records_target_marks())
       to_target_obj_bit_queue->push(obj);
   }
   else{
@@ -277,7 +287,7 @@ inline void G1ScanObjsDuringUpdateRSClosureNew::do_oop_work(T* p) {
 
     //mhr: modify
     //mhr: new
-    if(!_g1h->heap_region_containing(obj)->is_young()&&!_g1h->heap_region_containing(obj)->is_humongous())
+    if(_g1h->heap_region_containing(obj)->records_target_marks())
       to_target_obj_bit_queue->push(obj);
   }
 }
@@ -29,9 +29,11 @@
 #include "gc/g1/g1OopClosures.inline.hpp"
 #include "gc/g1/g1ParScanThreadState.inline.hpp"
 #include "gc/g1/g1RootClosures.hpp"
+#include "gc/g1/g1SemeruPretenureProfile.hpp"
 #include "gc/g1/g1StringDedup.hpp"
 #include "gc/shared/gcTrace.hpp"
 #include "gc/shared/taskqueue.inline.hpp"
+#include "logging/log.hpp"
 #include "memory/allocation.inline.hpp"
 #include "oops/access.inline.hpp"
 #include "oops/oop.inline.hpp"
@@ -55,7 +57,15 @@ G1ParScanThreadState::G1ParScanThreadState(G1CollectedHeap* g1h,
     _stack_trim_lower_threshold(GCDrainStackTargetSize),
     _trim_ticks(),
     _old_gen_is_full(false),
-    _num_optional_regions(optional_cset_length)
+    _num_optional_regions(optional_cset_length),
+    _deferred(NULL),
+    _deferred_head(0),
+    _num_deferred(0),
+    _arrived_page(0),
+    _deferred_tasks(0),
+    _look_ahead(false),
+    _look_ahead_page(0),
+    _look_ahead_fetches(0)
 {
   // we allocate G1YoungSurvRateNumRegions plus one entries, since
   // we "sacrifice" entry 0 to keep track of surviving bytes for
@@ -84,11 +94,26 @@ G1ParScanThreadState::G1ParScanThreadState(G1CollectedHeap* g1h,
   _closures = G1EvacuationRootClosures::create_root_closures(this, _g1h);
 
   _oops_into_optional_regions = new G1OopStarChunkedList[_num_optional_regions];
+
+  if (SemeruEvacDeferredTasks > 0 && _g1h->shares_swap_out_map()) {
+    _deferred = NEW_C_HEAP_ARRAY(StarTask, SemeruEvacDeferredTasks, mtGC);
+  }
+  _look_ahead = SemeruEvacLookAhead && _g1h->shares_swap_out_map();
 }
 
 // Pass locally gathered statistics to global state.
 void G1ParScanThreadState::flush(size_t* surviving_young_words) {
+  assert(_num_deferred == 0, "%u deferred references of worker %u are left", _num_deferred, _worker_id);
+  if (_deferred_tasks > 0) {
+    log_debug(semeru, rdma)("%s, worker %u deferred " SIZE_FORMAT " references to swapped out objects",
+                            __func__, _worker_id, _deferred_tasks);
+  }
+  if (_look_ahead_fetches > 0) {
+    log_debug(semeru, rdma)("%s, worker %u issued " SIZE_FORMAT " reads of swapped out pages ahead of their copy",
+                            __func__, _worker_id, _look_ahead_fetches);
+  }
   _dcq.flush();
+  flush_target_marks();
   // Update allocation statistics.
   _plab_allocator->flush_and_retire_stats();
   _g1h->g1_policy()->record_age_table(&_age_table);
@@ -99,11 +124,24 @@ void G1ParScanThreadState::flush(size_t* surviving_young_words) {
   }
 }
 
+void G1TargetMarkCache::flush() {
+  for (uint i = 0; i < Entries; i++) {
+    Entry* e = &_entries[i];
+    if (e->_queue != NULL) {
+      e->_queue->push_bits(e->_word, e->_bits);
+      e->_queue = NULL;
+    }
+  }
+}
+
 G1ParScanThreadState::~G1ParScanThreadState() {
   delete _plab_allocator;
   delete _closures;
   FREE_C_HEAP_ARRAY(size_t, _surviving_young_words_base);
   delete[] _oops_into_optional_regions;
+  if (_deferred != NULL) {
+    FREE_C_HEAP_ARRAY(StarTask, _deferred);
+  }
 }
 
 void G1ParScanThreadState::waste(size_t& wasted, size_t& undo_wasted) {
@@ -148,9 +186,78 @@ bool G1ParScanThreadState::verify_task(StarTask ref) const {
 void G1ParScanThreadState::trim_queue() {
   StarTask ref;
   do {
-    // Fully drain the queue.
-    trim_queue_to_threshold(0);
-  } while (!_refs->is_empty());
+    do {
+      // Fully drain the queue.
+      trim_queue_to_threshold(0);
+    } while (!_refs->is_empty());
+    // Then the deferred references, their fields may fill the queue again.
+  } while (dispatch_deferred());
+}
+
+/**
+ * Semeru CPU - A fault on a swapped out page blocks the worker for the whole RDMA round trip.
+ *  Ask the kernel by RDMA_FETCH_ASYNC instead, it issues the read without waiting. While the page is on the fly,
+ *  the reference is put aside and the worker copies the other objects of its queue.
+ *  Only the objects of the Regions with swapped out pages pay the syscall.
+ */
+bool G1ParScanThreadState::defer_evac_on_fetch(StarTask ref, oop obj, uintptr_t page) {
+  if (_g1h->swapped_out_pages(_g1h->heap_region_containing(obj)) == 0) {
+    return false;
+  }
+
+  int not_arrived = syscall(RDMA_FETCH_ASYNC, 0, (char*)page, PAGE_SIZE);
+  if (not_arrived < 0) {
+    // No prefetch cache in the kernel. Stop asking once the deferred references are gone.
+    if (_num_deferred == 0) {
+      log_debug(semeru, rdma)("%s, RDMA_FETCH_ASYNC failed, worker %u stops deferring.", __func__, _worker_id);
+      FREE_C_HEAP_ARRAY(StarTask, _deferred);
+      _deferred = NULL;
+    }
+    return false;
+  }
+  if (not_arrived == 0) {
+    _arrived_page = page;
+    return false;
+  }
+
+  _deferred[(_deferred_head + _num_deferred) % SemeruEvacDeferredTasks] = ref;
+  _num_deferred++;
+  _deferred_tasks++;
+  return true;
+}
+
+/**
+ * Semeru CPU - The deferral above only overlaps the reads of the references popped from the queue.
+ *  Issue them at the push instead, a read is then on the fly for each of the swapped out targets
+ *  in the queue. By the pop, the page has mostly arrived and the fault or the deferral is short.
+ */
+void G1ParScanThreadState::look_ahead_fetch(oop obj, uintptr_t page) {
+  int not_arrived = syscall(RDMA_FETCH_ASYNC, 0, (char*)page, PAGE_SIZE);
+  if (not_arrived < 0) {
+    // No prefetch cache in the kernel.
+    log_debug(semeru, rdma)("%s, RDMA_FETCH_ASYNC failed, worker %u stops looking ahead.", __func__, _worker_id);
+    _look_ahead = false;
+    return;
+  }
+  _g1h->note_page_fetched(obj);
+  if (not_arrived == 0) {
+    _arrived_page = page;
+    return;
+  }
+  _look_ahead_fetches++;
+}
+
+// The queue is empty here, so the reference is dispatched without being deferred again.
+// Its fault waits for the rest of the RDMA read, if any.
+bool G1ParScanThreadState::dispatch_deferred() {
+  if (_num_deferred == 0) {
+    return false;
+  }
+  StarTask ref = _deferred[_deferred_head];
+  _deferred_head = (_deferred_head + 1) % SemeruEvacDeferredTasks;
+  _num_deferred--;
+  dispatch_reference(ref);
+  return true;
 }
 
 HeapWord* G1ParScanThreadState::allocate_in_next_plab(InCSetState const state,
@@ -243,7 +350,18 @@ oop G1ParScanThreadState::copy_to_survivor_space(InCSetState const state,
   // if((((unsigned long long)old)>>12) == 0x7fffc0136ULL) {
   //   printf("found old!: %llu \n", (unsigned long long)old);
   // }
-  HeapWord* obj_ptr = _plab_allocator->plab_allocate(dest_state, word_sz);
+  // Semeru, the old objects swapped out at the pause start are copied apart from the hot ones.
+  // See G1CollectedHeap::sample_page_residency(). A failure falls back to the old alloc region.
+  bool cold = dest_state.is_old() && _g1h->is_cold_at_pause_start(from_region, old);
+  HeapWord* obj_ptr = NULL;
+  if (cold) {
+    bool cold_refill_failed = false;
+    obj_ptr = _plab_allocator->allocate(dest_state, word_sz, &cold_refill_failed, cold);
+    cold = obj_ptr != NULL;
+  }
+  if (obj_ptr == NULL) {
+    obj_ptr = _plab_allocator->plab_allocate(dest_state, word_sz);
+  }
 
   // PLAB allocations should succeed most of the time, so we'll
   // normally check against NULL once and that's it.
@@ -280,7 +398,7 @@ oop G1ParScanThreadState::copy_to_survivor_space(InCSetState const state,
   if (_g1h->evacuation_should_fail()) {
     // Doing this after all the allocation attempts also tests the
     // undo_allocation() method too.
-    _plab_allocator->undo_allocation(dest_state, obj_ptr, word_sz);
+    _plab_allocator->undo_allocation(dest_state, obj_ptr, word_sz, cold);
 
     //mhr: debug
     //assert(false, "Should not fail in evacuation");
@@ -329,6 +447,9 @@ oop G1ParScanThreadState::copy_to_survivor_space(InCSetState const state,
     } else {
       obj->set_mark_raw(old_mark);
       // obj->set_mark_raw(old_mark->set_in_target_object_queue(0));
+      if (state.is_young() && _g1h->pretenure_profile() != NULL) {
+        _g1h->pretenure_profile()->record_promotion(obj->klass(), word_sz);
+      }
     }
 
     if (G1StringDedup::is_enabled()) {
@@ -359,7 +480,7 @@ oop G1ParScanThreadState::copy_to_survivor_space(InCSetState const state,
     }
     return obj;
   } else {
-    _plab_allocator->undo_allocation(dest_state, obj_ptr, word_sz);
+    _plab_allocator->undo_allocation(dest_state, obj_ptr, word_sz, cold);
     return forward_ptr;
   }
 }
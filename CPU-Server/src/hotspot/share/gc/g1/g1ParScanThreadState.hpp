@@ -43,6 +43,31 @@ class G1EvacuationRootClosures;
 class HeapRegion;
 class outputStream;
 
+// Semeru, the cross-Region target marks of one evacuation worker, combined by the word of the target BitQueue.
+// Direct mapped. A conflicting entry is pushed into its BitQueue, so a hot word costs one shared access per eviction
+// instead of one CAS per reference. Flushed at the end of the evacuation, before the target queues are sent.
+class G1TargetMarkCache {
+  static const uint LogEntries = 8;
+  static const uint Entries    = 1u << LogEntries;
+
+  struct Entry {
+    BitQueue* _queue;
+    size_t    _word;
+    size_t    _bits;
+  };
+  Entry _entries[Entries];
+
+  static uint slot_of(const BitQueue* q, size_t word) {
+    return (uint)((word ^ (q->_region_index << (LogEntries / 2))) & (Entries - 1));
+  }
+
+public:
+  G1TargetMarkCache() { memset(_entries, 0, sizeof(_entries)); }
+
+  inline void add(BitQueue* q, oop o);
+  void flush();
+};
+
 class G1ParScanThreadState : public CHeapObj<mtGC> {
   G1CollectedHeap* _g1h;
   RefToScanQueue*  _refs;
@@ -91,6 +116,21 @@ class G1ParScanThreadState : public CHeapObj<mtGC> {
   size_t _num_optional_regions;
   G1OopStarChunkedList* _oops_into_optional_regions;
 
+  G1TargetMarkCache _target_marks;
+
+  // Semeru, -XX:SemeruEvacDeferredTasks. The references whose objects are on swapped out pages still
+  // on the fly, a ring retried oldest first each time the task queue drains. NULL if disabled.
+  StarTask* _deferred;
+  uint      _deferred_head;
+  uint      _num_deferred;
+  uintptr_t _arrived_page;   // the page the kernel last found arrived, its objects skip the syscall
+  size_t    _deferred_tasks; // statistics
+
+  // Semeru, -XX:+SemeruEvacLookAhead. The read of a swapped out page is issued when a reference to it is pushed.
+  bool      _look_ahead;
+  uintptr_t _look_ahead_page;    // the page of the last pushed reference
+  size_t    _look_ahead_fetches; // statistics
+
 public:
   G1ParScanThreadState(G1CollectedHeap* g1h,
                        uint worker_id,
@@ -101,7 +141,7 @@ public:
   void set_ref_discoverer(ReferenceDiscoverer* rd) { _scanner.set_ref_discoverer(rd); }
 
 #ifdef ASSERT
-  bool queue_is_empty() const { return _refs->is_empty(); }
+  bool queue_is_empty() const { return _refs->is_empty() && _num_deferred == 0; }
 
   bool verify_ref(narrowOop* ref) const;
   bool verify_ref(oop* ref) const;
@@ -110,6 +150,9 @@ public:
 
   template <class T> void do_oop_ext(T* ref);
   template <class T> void push_on_queue(T* ref);
+  // Issue the read of the page of obj, about to be pushed, if it was swapped out at the pause start.
+  // The worker copies the objects ahead of it in its queue meanwhile.
+  inline void look_ahead(oop obj);
 
   template <class T> void enqueue_card_if_tracked(T* p, oop o) {
     assert(!HeapRegion::is_in_same_region(p, o), "Should have filtered out cross-region references already.");
@@ -141,6 +184,9 @@ public:
 
   void flush(size_t* surviving_young_words);
 
+  // Push the combined cross-Region target marks into the BitQueues.
+  void flush_target_marks() { _target_marks.flush(); }
+
 private:
   #define G1_PARTIAL_ARRAY_MASK 0x2
 
@@ -180,6 +226,14 @@ private:
 
   inline void dispatch_reference(StarTask ref);
 
+  // Put the reference aside if obj is on a page still read from the memory server
+  // and there is other work to copy meanwhile.
+  template <class T> inline bool defer_evac(T* p, oop obj);
+  bool defer_evac_on_fetch(StarTask ref, oop obj, uintptr_t page);
+  void look_ahead_fetch(oop obj, uintptr_t page);
+  // Dispatch the oldest deferred reference, false if there is none.
+  bool dispatch_deferred();
+
   // Tries to allocate word_sz in the PLAB of the next "generation" after trying to
   // allocate into dest. State is the original (source) cset state for the object
   // that is allocated for. Previous_plab_refill_failed indicates whether previously
@@ -29,6 +29,7 @@
 #include "gc/g1/g1OopStarChunkedList.inline.hpp"
 #include "gc/g1/g1ParScanThreadState.hpp"
 #include "gc/g1/g1RemSet.hpp"
+#include "gc/g1/heapRegion.inline.hpp"
 #include "oops/access.inline.hpp"
 #include "oops/oop.inline.hpp"
 
@@ -54,6 +55,11 @@ template <class T> void G1ParScanThreadState::do_oop_evac(T* p) {
     return;
   }
 
+  // Semeru, the mark word below faults on a swapped out page.
+  if (_deferred != NULL && defer_evac(p, obj)) {
+    return;
+  }
+
   //mhr: debug
   // if(in_cset_state.is_old()) {
   //   assert(in_cset_state.is_old(), "");
@@ -137,6 +143,28 @@ inline void G1ParScanThreadState::do_oop_partial_array(oop* p) {
   to_obj_array->oop_iterate_range(&_scanner, start, end);
 }
 
+inline void G1ParScanThreadState::look_ahead(oop obj) {
+  if (!_look_ahead) {
+    return;
+  }
+  uintptr_t page = align_down((uintptr_t)(void*)obj, PAGE_SIZE);
+  if (page == _look_ahead_page || page == _arrived_page) {
+    return;
+  }
+  _look_ahead_page = page;
+  if (_g1h->is_swapped_out_at_pause_start(_g1h->heap_region_containing(obj), obj)) {
+    look_ahead_fetch(obj, page);
+  }
+}
+
+template <class T> inline bool G1ParScanThreadState::defer_evac(T* p, oop obj) {
+  uintptr_t page = align_down((uintptr_t)(void*)obj, PAGE_SIZE);
+  if (page == _arrived_page || _num_deferred == SemeruEvacDeferredTasks || _refs->is_empty()) {
+    return false;
+  }
+  return defer_evac_on_fetch(StarTask(p), obj, page);
+}
+
 inline void G1ParScanThreadState::deal_with_reference(oop* ref_to_scan) {
   if (!has_partial_array_mask(ref_to_scan)) {
     do_oop_evac(ref_to_scan);
@@ -214,6 +242,24 @@ inline void G1ParScanThreadState::reset_trim_ticks() {
   _trim_ticks = Tickspan();
 }
 
+inline void G1TargetMarkCache::add(BitQueue* q, oop o) {
+  if (q->_marked_from_root) {
+    return;
+  }
+
+  size_t word = q->word_of(o);
+  Entry* e = &_entries[slot_of(q, word)];
+  if (e->_queue != q || e->_word != word) {
+    if (e->_queue != NULL) {
+      e->_queue->push_bits(e->_word, e->_bits);
+    }
+    e->_queue = q;
+    e->_word  = word;
+    e->_bits  = 0;
+  }
+  e->_bits |= q->bit_of(o);
+}
+
 template <typename T>
 inline void G1ParScanThreadState::remember_root_into_optional_region(T* p) {
   oop o = RawAccess<IS_NOT_NULL>::oop_load(p);
@@ -223,8 +269,8 @@ inline void G1ParScanThreadState::remember_root_into_optional_region(T* p) {
   //mhr: modify
   //For root queue
   HeapRegion* hr = _g1h->heap_region_containing(o);
-  if(!hr->is_young() && !hr->is_humongous())
-    hr->cross_region_ref_target_queue()->push(o);
+  if(hr->records_target_marks())
+    _target_marks.add(hr->cross_region_ref_target_queue(), o);
 
 }
 
@@ -238,8 +284,8 @@ inline void G1ParScanThreadState::remember_reference_into_optional_region(T* p)
   //mhr: modify
   //For root queue
   HeapRegion* hr = _g1h->heap_region_containing(o);
-  if(!hr->is_young() && !hr->is_humongous())
-    hr->cross_region_ref_target_queue()->push(o);
+  if(hr->records_target_marks())
+    _target_marks.add(hr->cross_region_ref_target_queue(), o);
 }
 
 G1OopStarChunkedList* G1ParScanThreadState::oops_into_optional_region(const HeapRegion* hr) {
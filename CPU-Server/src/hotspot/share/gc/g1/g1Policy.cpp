@@ -696,6 +696,17 @@ void G1Policy::record_collection_pause_end(double pause_time_ms, size_t cards_sc
     size_t copied_bytes = _collection_set->bytes_used_before() - freed_bytes;
     double cost_per_byte_ms = 0.0;
 
+    // Semeru, the object copy beyond the prediction is taken by faulting in the swapped out alive objects.
+    // Sampled before this pause's copy cost is added to the prediction.
+    double swapped_out_live_pages = _collection_set->semeru_swapped_out_live_pages();
+    if (copied_bytes > 0 && swapped_out_live_pages >= 1.0) {
+      double swap_in_time_ms = average_time_ms(G1GCPhaseTimes::ObjCopy) -
+                               _analytics->predict_object_copy_time_ms(copied_bytes, collector_state()->mark_or_rebuild_in_progress());
+      if (swap_in_time_ms > 0.0) {
+        _analytics->report_semeru_swap_in_cost_per_page_ms(swap_in_time_ms / swapped_out_live_pages);
+      }
+    }
+
     if (copied_bytes > 0) {
       cost_per_byte_ms = average_time_ms(G1GCPhaseTimes::ObjCopy) / (double) copied_bytes;
       _analytics->report_cost_per_byte_ms(cost_per_byte_ms, collector_state()->mark_or_rebuild_in_progress());
@@ -1178,6 +1189,39 @@ uint G1Policy::cssc_cache_threshold_in_pages() const {
   return result;
 }
 
+/**
+ * Semeru - The alive objects of the Region are copied, MemoryToCPUAtGC->_alive_ratio of its used bytes.
+ *  The alive ratio of its swapped out pages are faulted in before being copied.
+ */
+double G1Policy::predict_semeru_evac_time_ms(HeapRegion* hr, size_t swapped_out_pages) const {
+  double alive_ratio = hr->_mem_to_cpu_gc->_alive_ratio;
+  size_t alive_bytes = (size_t)(alive_ratio * hr->used());
+
+  return _analytics->predict_object_copy_time_ms(alive_bytes, collector_state()->mark_or_rebuild_in_progress()) +
+         alive_ratio * swapped_out_pages * _analytics->predict_semeru_swap_in_cost_per_page_ms();
+}
+
+void G1Policy::record_semeru_young_residency(uint young_length, size_t swapped_out_young_pages, size_t on_demand_swapins) {
+  _young_gen_sizer->record_young_residency(young_length, swapped_out_young_pages, on_demand_swapins);
+}
+
+double G1Policy::predict_semeru_flush_time_ms(size_t cached_pages) const {
+  return cached_pages * _analytics->predict_semeru_flush_cost_per_page_ms();
+}
+
+void G1Policy::record_semeru_flush_time_ms(double flush_time_ms, size_t flushed_pages) {
+  if (flushed_pages > 0) {
+    _analytics->report_semeru_flush_cost_per_page_ms(flush_time_ms / flushed_pages);
+  }
+}
+
+/**
+ * Semeru - SemeruMemServerLiveThresholdPercent, never above the liveness a mixed GC still collects.
+ */
+double G1Policy::mem_server_live_threshold_ratio() const {
+  return (double)MIN2(SemeruMemServerLiveThresholdPercent, G1MixedGCLiveThresholdPercent) / 100;
+}
+
 /**
  * MSCT only tracing regions when its cache ratio lower than  msct_cache_threshold_in_pages() 
  */
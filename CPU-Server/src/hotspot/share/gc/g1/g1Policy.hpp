@@ -251,6 +251,18 @@ public:
   uint calc_max_cserver_cset_length();
   uint cssc_cache_threshold_in_pages() const;
   uint msct_cache_threshold_in_pages() const;
+  // The alive ratio below which a Region scanned by the memory server is compacted there.
+  double mem_server_live_threshold_ratio() const;
+
+  // Semeru, -XX:+SemeruCSetCostModel. The pause time of reclaiming a scanned old Region on each server.
+  // CPU server, evacuate the alive objects, the swapped out ones are faulted in first.
+  double predict_semeru_evac_time_ms(HeapRegion* hr, size_t swapped_out_pages) const;
+  // Memory server, flush the pages cached in CPU server DRAM. The compaction runs out of the pause.
+  double predict_semeru_flush_time_ms(size_t cached_pages) const;
+  void record_semeru_flush_time_ms(double flush_time_ms, size_t flushed_pages);
+
+  // Semeru, bound the young gen by its residency in the local cache, see G1YoungGenSizer::record_young_residency().
+  void record_semeru_young_residency(uint young_length, size_t swapped_out_young_pages, size_t on_demand_swapins);
   uint garbage_threshold_in_bytes() const;
 
   // Calculate the minimum number of old regions we'll add to the CSet
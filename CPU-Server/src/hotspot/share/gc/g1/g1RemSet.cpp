@@ -45,6 +45,7 @@
 #include "memory/resourceArea.hpp"
 #include "oops/access.inline.hpp"
 #include "oops/oop.inline.hpp"
+#include "runtime/mutexLocker.hpp"
 #include "runtime/os.hpp"
 #include "utilities/align.hpp"
 #include "utilities/globalDefinitions.hpp"
@@ -294,10 +295,573 @@ public:
   }
 };
 
+/**
+ * Semeru CPU - -XX:+SemeruRemoteCardScan, see remote_card_scan.
+ *
+ * Scanning a remembered set card of a fully evicted old Region swaps in its pages, most of them only to find
+ * no field pointing into the CSet. The memory servers hold the complete content of such Regions, so they scan
+ * the cards and only send back the fields pointing into the CSet. Only the pages of these fields are faulted in,
+ * when the evacuation updates them.
+ *
+ * 1) request(), by the VM thread before the evacuation. Claim the cards of the evicted Regions in the remembered
+ *    sets of the CSet and send them to the memory server of their Region. Cards beyond the capacity of a request
+ *    are left to the workers.
+ * 2) Wait for the replies. The cards of a memory server without a reply in time, or with too many slots,
+ *    are unclaimed and scanned by the workers as usual.
+ * 3) scan_slots(), by the workers within the Scan RS phase. The slots are claimed in chunks.
+ *
+ * A card is only sent if its first block is above the prev TAMS of its Region. Every object from there on
+ * is live, the memory server doesn't need the prev mark bitmap.
+ */
+class G1RemoteCardScanState : public CHeapObj<mtGC> {
+  G1CollectedHeap* _g1h;
+  G1CardTable*     _ct;
+  uint             _max_regions;
+
+  // The memory server of each fully evicted old Region, -1 for the others. Set by request().
+  int* _mem_of_region;
+
+  // The cards requested from each memory server, by card index.
+  size_t* _card_index[MAX_NUM_OF_MEMORY_SERVER];
+  uint    _num_cards[MAX_NUM_OF_MEMORY_SERVER];
+
+  // The slots replied by all the memory servers.
+  remote_card_scan::slot* _slots;
+  size_t                  _num_slots;
+  size_t                  _max_slots;
+  size_t volatile         _claimed_slots;
+
+  static size_t slot_chunk_size() { return 64; }
+
+  void add_card(G1RemSetScanState* scan_state, size_t card_index) {
+    HeapWord* const card_start = _g1h->bot()->address_for_index_raw(card_index);
+    uint const region_idx = _g1h->addr_to_region(card_start);
+    if (region_idx >= _max_regions || _mem_of_region[region_idx] < 0) {
+      return;
+    }
+    int const mem_id = _mem_of_region[region_idx];
+    HeapWord* const top = scan_state->scan_top(region_idx);
+    if (card_start >= top || _num_cards[mem_id] == SEMERU_MAX_REMOTE_CARDS ||
+        _ct->is_card_claimed(card_index) || _ct->is_card_dirty(card_index)) {
+      return;
+    }
+
+    HeapRegion* const hr = _g1h->region_at(region_idx);
+    if (hr->block_at_or_preceding(card_start) < hr->prev_top_at_mark_start()) {
+      return;
+    }
+
+    // Claimed now, the same card may be in the remembered sets of several CSet Regions.
+    _ct->set_card_claimed(card_index);
+    _card_index[mem_id][_num_cards[mem_id]++] = card_index;
+  }
+
+  class G1CollectRemoteCardsClosure : public HeapRegionClosure {
+    G1RemoteCardScanState* _state;
+    G1RemSetScanState*     _scan_state;
+  public:
+    G1CollectRemoteCardsClosure(G1RemoteCardScanState* state, G1RemSetScanState* scan_state) :
+      _state(state), _scan_state(scan_state) { }
+
+    virtual bool do_heap_region(HeapRegion* r) {
+      if (!r->rem_set()->cardset_is_empty()) {
+        HeapRegionRemSetIterator iter(r->rem_set());
+        size_t card_index;
+        while (iter.has_next(card_index)) {
+          _state->add_card(_scan_state, card_index);
+        }
+      }
+      return false;
+    }
+  };
+
+  bool send(G1RemSetScanState* scan_state, size_t mem_id, uint32_t seq) {
+    remote_card_scan* scan = _g1h->remote_cards();
+    uint num_cards = _num_cards[mem_id];
+    for (uint i = 0; i < num_cards; i++) {
+      HeapWord* const card_start = _g1h->bot()->address_for_index_raw(_card_index[mem_id][i]);
+      HeapRegion* const hr = _g1h->heap_region_containing(card_start);
+      remote_card_scan::card* c = &scan->_cards[i];
+      c->_block = hr->block_at_or_preceding(card_start);
+      c->_start = card_start;
+      c->_end   = MIN2(card_start + BOTConstants::N_words, scan_state->scan_top(hr->hrm_index()));
+    }
+    scan->_num_cards   = num_cards;
+    scan->_mode        = remote_card_scan::ScanCSet;
+    scan->_request_seq = seq;
+
+    // The cards are written before the sequence, on the same QP.
+    return semeru_cp_write((int)mem_id, (void*)scan->_in_cset, sizeof(scan->_in_cset)) == 0 &&
+           semeru_cp_write((int)mem_id, (void*)scan->_cards, num_cards * sizeof(remote_card_scan::card)) == 0 &&
+           semeru_cp_write((int)mem_id, (void*)&scan->_num_cards, 2 * sizeof(uint32_t)) == 0 &&
+           semeru_cp_write((int)mem_id, (void*)&scan->_request_seq, sizeof(uint32_t)) == 0;
+  }
+
+  bool receive(size_t mem_id, uint32_t seq, jlong deadline) {
+    remote_card_scan* scan = _g1h->remote_cards();
+    bool replied = false;
+    scan->_done_seq = seq - 1;   // the local copy may hold the reply of the previous memory server.
+    do {
+      if (semeru_cp_read((int)mem_id, (void*)&scan->_done_seq, remote_card_scan::reply_size()) == 0 &&
+          scan->_done_seq == seq) {
+        replied = true;
+        break;
+      }
+      os::naked_short_sleep(1);
+    } while (os::javaTimeMillis() < deadline);
+
+    if (!replied || scan->_overflow != 0 || scan->_num_slots > SEMERU_MAX_REMOTE_SLOTS ||
+        (scan->_num_slots > 0 &&
+         semeru_cp_read((int)mem_id, (void*)scan->_slots, scan->_num_slots * sizeof(remote_card_scan::slot)) != 0)) {
+      log_debug(gc, remset)("Semeru remote card scan: memory server[" SIZE_FORMAT "] %s, %u cards scanned locally",
+                            mem_id, !replied ? "didn't reply" : "overflowed", _num_cards[mem_id]);
+      return false;
+    }
+
+    size_t num_slots = scan->_num_slots;
+    if (_num_slots + num_slots > _max_slots) {
+      _max_slots = MAX2(_max_slots * 2, _num_slots + num_slots);
+      _slots = REALLOC_C_HEAP_ARRAY(remote_card_scan::slot, _slots, _max_slots, mtGC);
+    }
+    memcpy(&_slots[_num_slots], scan->_slots, num_slots * sizeof(remote_card_scan::slot));
+    _num_slots += num_slots;
+    return true;
+  }
+
+public:
+  G1RemoteCardScanState(G1CollectedHeap* g1h, G1CardTable* ct, uint max_regions) :
+    _g1h(g1h),
+    _ct(ct),
+    _max_regions(MIN2(max_regions, (uint)SEMERU_MAX_REGIONS)),
+    _mem_of_region(NEW_C_HEAP_ARRAY(int, max_regions, mtGC)),
+    _slots(NULL),
+    _num_slots(0),
+    _max_slots(0),
+    _claimed_slots(0) {
+    for (size_t mem_id = 0; mem_id < MAX_NUM_OF_MEMORY_SERVER; mem_id++) {
+      _card_index[mem_id] = mem_id < SemeruMemServerNum ? NEW_C_HEAP_ARRAY(size_t, SEMERU_MAX_REMOTE_CARDS, mtGC) : NULL;
+      _num_cards[mem_id]  = 0;
+    }
+  }
+
+  ~G1RemoteCardScanState() {
+    for (size_t mem_id = 0; mem_id < MAX_NUM_OF_MEMORY_SERVER; mem_id++) {
+      if (_card_index[mem_id] != NULL) {
+        FREE_C_HEAP_ARRAY(size_t, _card_index[mem_id]);
+      }
+    }
+    if (_slots != NULL) {
+      FREE_C_HEAP_ARRAY(remote_card_scan::slot, _slots);
+    }
+    FREE_C_HEAP_ARRAY(int, _mem_of_region);
+  }
+
+  // By the VM thread, after the scan state is reset.
+  void request(G1RemSetScanState* scan_state) {
+    remote_card_scan* scan = _g1h->remote_cards();
+    uint32_t seq = scan->_request_seq + 1;
+    jlong start = os::javaTimeMillis();
+    bool requested[MAX_NUM_OF_MEMORY_SERVER] = { false };
+
+    _num_slots = 0;
+    _claimed_slots = 0;
+    for (size_t mem_id = 0; mem_id < SemeruMemServerNum; mem_id++) {
+      _num_cards[mem_id] = 0;
+    }
+
+    uint num_evicted = 0;
+    for (uint i = 0; i < _max_regions; i++) {
+      HeapRegion* hr = _g1h->region_at_or_null(i);
+      _mem_of_region[i] = -1;
+      scan->_in_cset[i] = 0;
+      if (hr == NULL) {
+        continue;
+      }
+      scan->_in_cset[i] = _g1h->in_cset_state(oop(hr->bottom())).is_default() ? 0 : 1;
+      if (hr->is_old() && scan_state->scan_top(i) != NULL &&
+          _g1h->swapped_out_pages(hr) == HeapRegion::GrainBytes/PAGE_SIZE) {
+        _mem_of_region[i] = hr->region_to_memory_server_mapping();
+        num_evicted++;
+      }
+    }
+    if (num_evicted == 0) {
+      return;
+    }
+
+    G1CollectRemoteCardsClosure cl(this, scan_state);
+    _g1h->collection_set_iterate(&cl);
+
+    // 1) One request per memory server, the same sequence for all of them.
+    for (size_t mem_id = 0; mem_id < SemeruMemServerNum; mem_id++) {
+      if (_num_cards[mem_id] == 0) {
+        continue;
+      }
+      if (!send(scan_state, mem_id, seq)) {
+        log_warning(semeru,rdma)("%s, can't request the card scan of memory server[%lu].", __func__, mem_id);
+        continue;
+      }
+      _g1h->ring_mem_server_doorbell(mem_id);
+      requested[mem_id] = true;
+    }
+
+    // 2) Collect the replies, one deadline for all of them.
+    jlong deadline = start + (jlong)SemeruRemoteCardScanTimeoutMs;
+    size_t offloaded = 0;
+    for (size_t mem_id = 0; mem_id < SemeruMemServerNum; mem_id++) {
+      if (_num_cards[mem_id] == 0) {
+        continue;
+      }
+      if (!requested[mem_id] || !receive(mem_id, seq, deadline)) {
+        for (uint i = 0; i < _num_cards[mem_id]; i++) {
+          _ct->set_card_unclaimed(_card_index[mem_id][i]);
+        }
+        continue;
+      }
+      for (uint i = 0; i < _num_cards[mem_id]; i++) {
+        scan_state->add_dirty_region(_g1h->addr_to_region(_g1h->bot()->address_for_index_raw(_card_index[mem_id][i])));
+      }
+      offloaded += _num_cards[mem_id];
+    }
+
+    log_debug(gc, remset)("Semeru remote card scan: %u evicted Regions, " SIZE_FORMAT " cards, " SIZE_FORMAT " slots, " JLONG_FORMAT " ms",
+                          num_evicted, offloaded, _num_slots, os::javaTimeMillis() - start);
+  }
+
+  // By the workers. Return the slots applied to cl.
+  size_t scan_slots(G1ScanObjsDuringScanRSClosure* cl) {
+    size_t scanned = 0;
+    while (_claimed_slots < _num_slots) {
+      size_t next = Atomic::add(slot_chunk_size(), &_claimed_slots) - slot_chunk_size();
+      size_t max = MIN2(next + slot_chunk_size(), _num_slots);
+      for (size_t i = next; i < max; i++) {
+        void* p = _slots[i]._addr;
+        assert(_g1h->is_in_reserved(p), "slot " PTR_FORMAT " out of the heap", p2i(p));
+        if (UseCompressedOops) {
+          cl->do_oop((narrowOop*)p);
+        } else {
+          cl->do_oop((oop*)p);
+        }
+        scanned++;
+      }
+      cl->trim_queue_partially();
+    }
+    return scanned;
+  }
+};
+
+/**
+ * Semeru CPU - -XX:+SemeruRemoteRefinement, see remote_card_scan at REMOTE_REFINE_OFFSET.
+ *
+ * Refining a dirty card of a fully evicted old Region swaps in its pages, and the hot pages of the mutators
+ * are evicted for them. Such a card is cleaned as usual, then queued for the memory server of its Region.
+ * The thread queueing the last card of a batch sends it and waits for the reply. The cross-region fields found
+ * there are applied by G1ConcurrentRefineOopClosureNew::do_field() without loading them, only the remembered
+ * sets and the target marks of the referenced Regions are updated here.
+ *
+ * A write to the card after its cleaning dirties it again, as for a local refinement. The cards of a failed
+ * batch, and at the start of a pause the cards not sent yet, are re-dirtied into the shared dirty card queue.
+ * Only one batch is out at a time, the others keep queueing meanwhile.
+ */
+class G1RemoteRefineQueue : public CHeapObj<mtGC> {
+  G1CollectedHeap* _g1h;
+  Mutex*           _lock;            // the pending cards
+  Mutex*           _exchange_lock;   // the remote_card_scan and _batch
+
+  jbyte** _pending[MAX_NUM_OF_MEMORY_SERVER];
+  uint    _num_pending[MAX_NUM_OF_MEMORY_SERVER];
+  jbyte** _batch;
+
+  uint32_t       _seq;
+  volatile jlong _disabled_until;   // os::javaTimeMillis(), after a failed batch
+
+  static const jlong retry_after_failure_ms = 1000;
+
+  static void redirty(jbyte** cards, uint num) {
+    MutexLockerEx x(Shared_DirtyCardQ_lock, Mutex::_no_safepoint_check_flag);
+    DirtyCardQueue* sdcq = G1BarrierSet::dirty_card_queue_set().shared_dirty_card_queue();
+    for (uint i = 0; i < num; i++) {
+      if (*cards[i] != G1CardTable::dirty_card_val()) {
+        *cards[i] = G1CardTable::dirty_card_val();
+        sdcq->enqueue(cards[i]);
+      }
+    }
+  }
+
+  // Under _exchange_lock. False if the cards have to be refined locally.
+  bool send_and_apply(G1CardTable* ct, size_t mem_id, uint num, uint worker_i) {
+    remote_card_scan* scan = _g1h->remote_refine();
+    uint32_t seq = ++_seq;
+
+    for (uint i = 0; i < num; i++) {
+      HeapWord* const card_start = ct->addr_for(_batch[i]);
+      HeapRegion* const hr = _g1h->heap_region_containing(card_start);
+      remote_card_scan::card* c = &scan->_cards[i];
+      c->_block = hr->block_at_or_preceding(card_start);
+      c->_start = card_start;
+      c->_end   = MIN2(card_start + G1CardTable::card_size_in_words, hr->top());
+    }
+    scan->_num_cards   = num;
+    scan->_mode        = remote_card_scan::Refine;
+    scan->_request_seq = seq;
+
+    // The cards are written before the sequence, on the same QP.
+    if (semeru_cp_write((int)mem_id, (void*)scan->_cards, num * sizeof(remote_card_scan::card)) != 0 ||
+        semeru_cp_write((int)mem_id, (void*)&scan->_num_cards, 2 * sizeof(uint32_t)) != 0 ||
+        semeru_cp_write((int)mem_id, (void*)&scan->_request_seq, sizeof(uint32_t)) != 0) {
+      return false;
+    }
+    _g1h->ring_mem_server_doorbell(mem_id);
+
+    jlong deadline = os::javaTimeMillis() + (jlong)SemeruRemoteCardScanTimeoutMs;
+    bool replied = false;
+    scan->_done_seq = seq - 1;
+    do {
+      if (semeru_cp_read((int)mem_id, (void*)&scan->_done_seq, remote_card_scan::reply_size()) == 0 &&
+          scan->_done_seq == seq) {
+        replied = true;
+        break;
+      }
+      os::naked_short_sleep(1);
+    } while (os::javaTimeMillis() < deadline);
+
+    size_t num_slots = scan->_num_slots;
+    if (!replied || scan->_overflow != 0 || num_slots > SEMERU_MAX_REMOTE_SLOTS ||
+        (num_slots > 0 && semeru_cp_read((int)mem_id, (void*)scan->_slots, num_slots * sizeof(remote_card_scan::slot)) != 0)) {
+      return false;
+    }
+
+    G1ConcurrentRefineOopClosureNew cl(_g1h, worker_i);
+    for (size_t i = 0; i < num_slots; i++) {
+      remote_card_scan::slot* s = &scan->_slots[i];
+      if (!_g1h->is_in_reserved(s->_addr) || !_g1h->is_in_reserved(s->_value)) {
+        continue;
+      }
+      if (UseCompressedOops) {
+        cl.do_field((narrowOop*)s->_addr, oop(s->_value));
+      } else {
+        cl.do_field((oop*)s->_addr, oop(s->_value));
+      }
+    }
+    return true;
+  }
+
+  void exchange(G1CardTable* ct, size_t mem_id, uint worker_i) {
+    if (!_exchange_lock->try_lock()) {
+      return;   // the other batch is still out
+    }
+
+    uint num;
+    {
+      MutexLockerEx x(_lock, Mutex::_no_safepoint_check_flag);
+      num = _num_pending[mem_id];
+      memcpy(_batch, _pending[mem_id], num * sizeof(jbyte*));
+      _num_pending[mem_id] = 0;
+    }
+
+    if (num > 0 && !send_and_apply(ct, mem_id, num, worker_i)) {
+      log_debug(gc, refine)("Semeru remote refinement: memory server[" SIZE_FORMAT "] failed %u cards, refined locally",
+                            mem_id, num);
+      _disabled_until = os::javaTimeMillis() + retry_after_failure_ms;
+      redirty(_batch, num);
+    }
+    _exchange_lock->unlock();
+  }
+
+public:
+  G1RemoteRefineQueue(G1CollectedHeap* g1h) :
+    _g1h(g1h),
+    _lock(new Mutex(Mutex::leaf, "Semeru remote refinement queue", true, Monitor::_safepoint_check_never)),
+    _exchange_lock(new Mutex(Mutex::nonleaf, "Semeru remote refinement exchange", true, Monitor::_safepoint_check_never)),
+    _batch(NEW_C_HEAP_ARRAY(jbyte*, SEMERU_MAX_REMOTE_CARDS, mtGC)),
+    _seq(0),
+    _disabled_until(0) {
+    for (size_t mem_id = 0; mem_id < MAX_NUM_OF_MEMORY_SERVER; mem_id++) {
+      _pending[mem_id]     = mem_id < SemeruMemServerNum ? NEW_C_HEAP_ARRAY(jbyte*, SEMERU_MAX_REMOTE_CARDS, mtGC) : NULL;
+      _num_pending[mem_id] = 0;
+    }
+  }
+
+  ~G1RemoteRefineQueue() {
+    for (size_t mem_id = 0; mem_id < MAX_NUM_OF_MEMORY_SERVER; mem_id++) {
+      if (_pending[mem_id] != NULL) {
+        FREE_C_HEAP_ARRAY(jbyte*, _pending[mem_id]);
+      }
+    }
+    FREE_C_HEAP_ARRAY(jbyte*, _batch);
+    delete _exchange_lock;
+    delete _lock;
+  }
+
+  // By a refining thread, after the card is cleaned. False if the card has to be refined locally.
+  bool offer(G1CardTable* ct, jbyte* card_ptr, HeapRegion* r, HeapWord* start, uint worker_i) {
+    if (!r->is_old() || (_disabled_until != 0 && os::javaTimeMillis() < _disabled_until) ||
+        _g1h->swapped_out_pages(r) != HeapRegion::GrainBytes/PAGE_SIZE ||
+        r->block_at_or_preceding(start) < r->prev_top_at_mark_start()) {
+      return false;
+    }
+
+    size_t mem_id = (size_t)r->region_to_memory_server_mapping();
+    uint num;
+    {
+      MutexLockerEx x(_lock, Mutex::_no_safepoint_check_flag);
+      num = _num_pending[mem_id];
+      if (num == SEMERU_MAX_REMOTE_CARDS) {
+        return false;
+      }
+      _pending[mem_id][num++] = card_ptr;
+      _num_pending[mem_id] = num;
+    }
+
+    if (num >= SemeruRemoteRefineBatchCards) {
+      exchange(ct, mem_id, worker_i);
+    }
+    return true;
+  }
+
+  // By the VM thread at the start of a pause, before the dirty card logs are concatenated.
+  void flush() {
+    assert(SafepointSynchronize::is_at_safepoint(), "the refinement is stopped");
+    size_t flushed = 0;
+    for (size_t mem_id = 0; mem_id < SemeruMemServerNum; mem_id++) {
+      redirty(_pending[mem_id], _num_pending[mem_id]);
+      flushed += _num_pending[mem_id];
+      _num_pending[mem_id] = 0;
+    }
+    if (flushed > 0) {
+      log_debug(gc, refine)("Semeru remote refinement: " SIZE_FORMAT " queued cards left to Update RS", flushed);
+    }
+  }
+};
+
+/**
+ * Semeru CPU - -XX:+SemeruRemoteRemSets, see remote_rem_set_stash at REMSET_STASH_OFFSET.
+ *
+ * An old Region handed to the memory server CSet is compacted there, its remembered set is only scanned
+ * again if the CPU server evacuates it. Its table is kept in the page of the Region on its memory server instead:
+ * 1) At the dispatch, the cards of a complete table are written into the page with the CSet vector of the server,
+ *    and the local table is cleared. The Region keeps its Complete state.
+ * 2) The concurrent refinement, local or by the memory servers, adds the new references into the local table.
+ * 3) When the Region is in the CSet of a pause, the pages of all such Regions are read back in one vectored read
+ *    and their cards added again, before the remembered sets are scanned.
+ * A Region is stashed once. The stash is dropped with its table, see HeapRegionRemSet::clear_locked().
+ */
+class G1RemoteRemSetStash : public CHeapObj<mtGC> {
+  G1CollectedHeap* _g1h;
+
+  class G1CollectStashedClosure : public HeapRegionClosure {
+    G1CollectedHeap*   _g1h;
+    semeru_rdma_iovec* _iov;
+    HeapRegion**       _regions;
+    int                _nr_iov;
+    size_t             _num_cards;
+
+  public:
+    G1CollectStashedClosure(G1CollectedHeap* g1h) : _g1h(g1h), _nr_iov(0), _num_cards(0) {
+      _iov     = NEW_C_HEAP_ARRAY(semeru_rdma_iovec, SEMERU_RDMA_IOV_MAX, mtGC);
+      _regions = NEW_C_HEAP_ARRAY(HeapRegion*, SEMERU_RDMA_IOV_MAX, mtGC);
+    }
+
+    ~G1CollectStashedClosure() {
+      FREE_C_HEAP_ARRAY(HeapRegion*, _regions);
+      FREE_C_HEAP_ARRAY(semeru_rdma_iovec, _iov);
+    }
+
+    void read_and_add() {
+      if (_nr_iov == 0) {
+        return;
+      }
+      guarantee(semeru_cp_readv(_iov, _nr_iov) == 0, "%s, RDMA vectored read of %d remembered sets failed.", __func__, _nr_iov);
+
+      G1BlockOffsetTable* bot = _g1h->bot();
+      for (int i = 0; i < _nr_iov; i++) {
+        HeapRegionRemSet* rs = _regions[i]->rem_set();
+        const uint32_t* cards = (const uint32_t*)_iov[i].start_addr;
+        uint n = rs->take_stashed_cards();
+        for (uint k = 0; k < n; k++) {
+          rs->add_reference((OopOrNarrowOopStar)bot->address_for_index_raw(cards[k]));
+        }
+        _num_cards += n;
+      }
+      _nr_iov = 0;
+    }
+
+    bool do_heap_region(HeapRegion* hr) {
+      uint n = hr->rem_set()->stashed_cards();
+      if (n == 0) {
+        return false;
+      }
+      _regions[_nr_iov] = hr;
+      _iov[_nr_iov].mem_server_id = hr->region_to_memory_server_mapping();
+      _iov[_nr_iov].write_type    = 0;  // data
+      _iov[_nr_iov].start_addr    = (char*)_g1h->remset_stash()->cards_of(hr->hrm_index());
+      _iov[_nr_iov].size          = n * sizeof(uint32_t);
+      if (++_nr_iov == SEMERU_RDMA_IOV_MAX) {
+        read_and_add();
+      }
+      return false;
+    }
+
+    size_t num_cards() const { return _num_cards; }
+  };
+
+public:
+  G1RemoteRemSetStash(G1CollectedHeap* g1h) : _g1h(g1h) {
+    guarantee((g1h->g1_reserved().byte_size() >> CardTable::card_shift) <= max_juint,
+              "%s, the card indexes of the heap exceed 32 bits.", __func__);
+  }
+
+  // At the dispatch of the memory server CSet. Return the entries used of iov, the page to write.
+  int stash(HeapRegion* hr, int mem_id, semeru_rdma_iovec* iov) {
+    HeapRegionRemSet* rs = hr->rem_set();
+    if (!hr->is_old() || !rs->is_complete() || rs->stashed_cards() > 0) {
+      return 0;
+    }
+    size_t occupied = rs->occupied();
+    if (occupied < SemeruRemoteRemSetMinCards || occupied > SEMERU_REMSET_STASH_CARDS) {
+      return 0;
+    }
+
+    uint32_t* cards = _g1h->remset_stash()->cards_of(hr->hrm_index());
+    HeapRegionRemSetIterator iter(rs);
+    size_t card_index;
+    uint n = 0;
+    while (iter.has_next(card_index)) {
+      if (n == SEMERU_REMSET_STASH_CARDS) {
+        return 0;
+      }
+      cards[n++] = (uint32_t)card_index;
+    }
+    rs->stash_cards(n);
+
+    iov->mem_server_id = mem_id;
+    iov->write_type    = 0;  // data
+    iov->start_addr    = (char*)cards;
+    iov->size          = n * sizeof(uint32_t);
+    log_trace(gc, remset)("Semeru remote remembered sets: Region[%u] " SIZE_FORMAT " cards to memory server[%d]",
+                          hr->hrm_index(), occupied, mem_id);
+    return 1;
+  }
+
+  // By the VM thread, before the remembered sets of the CSet are scanned.
+  void fetch() {
+    Ticks start = Ticks::now();
+    G1CollectStashedClosure cl(_g1h);
+    _g1h->collection_set_iterate(&cl);
+    cl.read_and_add();
+    if (cl.num_cards() > 0) {
+      log_debug(gc, remset)("Semeru remote remembered sets: " SIZE_FORMAT " cards read back, " JLONG_FORMAT " ms",
+                            cl.num_cards(), (Ticks::now() - start).milliseconds());
+    }
+  }
+};
+
 G1RemSet::G1RemSet(G1CollectedHeap* g1h,
                    G1CardTable* ct,
                    G1HotCardCache* hot_card_cache) :
   _scan_state(new G1RemSetScanState()),
+  _remote_cards(NULL),
+  _remote_refine(NULL),
+  _remote_rem_sets(NULL),
   _prev_period_summary(),
   _g1h(g1h),
   _num_conc_refined_cards(0),
@@ -310,6 +874,15 @@ G1RemSet::~G1RemSet() {
   if (_scan_state != NULL) {
     delete _scan_state;
   }
+  if (_remote_cards != NULL) {
+    delete _remote_cards;
+  }
+  if (_remote_refine != NULL) {
+    delete _remote_refine;
+  }
+  if (_remote_rem_sets != NULL) {
+    delete _remote_rem_sets;
+  }
 }
 
 uint G1RemSet::num_par_rem_sets() {
@@ -319,6 +892,15 @@ uint G1RemSet::num_par_rem_sets() {
 void G1RemSet::initialize(size_t capacity, uint max_regions) {
   G1FromCardCache::initialize(num_par_rem_sets(), max_regions);
   _scan_state->initialize(max_regions);
+  if (SemeruRemoteCardScan && _g1h->remote_cards() != NULL) {
+    _remote_cards = new G1RemoteCardScanState(_g1h, _ct, max_regions);
+  }
+  if (SemeruRemoteRefinement && _g1h->remote_refine() != NULL) {
+    _remote_refine = new G1RemoteRefineQueue(_g1h);
+  }
+  if (SemeruRemoteRemSets && _g1h->remset_stash() != NULL) {
+    _remote_rem_sets = new G1RemoteRemSetStash(_g1h);
+  }
 }
 
 G1ScanRSForRegionClosure::G1ScanRSForRegionClosure(G1RemSetScanState* scan_state,
@@ -798,11 +1380,17 @@ void G1RemSet::scan_rem_set(G1ParScanThreadState* pss, uint worker_i) {
   //
   //G1ScanRSForRegionClosureNew cl(_scan_state, &scan_cl, pss, G1GCPhaseTimes::ScanRS, worker_i);
   G1ScanRSForRegionClosure cl(_scan_state, &scan_cl, pss, G1GCPhaseTimes::ScanRS, worker_i);
+
+  // The cards scanned by the memory servers, before the Regions claim the rest.
+  double remote_start = os::elapsedTime();
+  size_t remote_slots = _remote_cards != NULL ? _remote_cards->scan_slots(&scan_cl) : 0;
+  double remote_time = os::elapsedTime() - remote_start;
+
   _g1h->collection_set_iterate_from(&cl, worker_i);
 
   G1GCPhaseTimes* p = _g1p->phase_times();
 
-  p->record_time_secs(G1GCPhaseTimes::ScanRS, worker_i, cl.rem_set_root_scan_time().seconds());
+  p->record_time_secs(G1GCPhaseTimes::ScanRS, worker_i, cl.rem_set_root_scan_time().seconds() + remote_time);
   p->add_time_secs(G1GCPhaseTimes::ObjCopy, worker_i, cl.rem_set_trim_partially_time().seconds());
 
   p->record_thread_work_item(G1GCPhaseTimes::ScanRS, worker_i, cl.cards_scanned(), G1GCPhaseTimes::ScanRSScannedCards);
@@ -811,6 +1399,10 @@ void G1RemSet::scan_rem_set(G1ParScanThreadState* pss, uint worker_i) {
 
   p->record_time_secs(G1GCPhaseTimes::CodeRoots, worker_i, cl.strong_code_root_scan_time().seconds());
   p->add_time_secs(G1GCPhaseTimes::ObjCopy, worker_i, cl.strong_code_root_trim_partially_time().seconds());
+
+  if (remote_slots > 0) {
+    log_trace(gc, remset)("Semeru remote card scan: worker %u, " SIZE_FORMAT " slots, %.3f ms", worker_i, remote_slots, remote_time * 1000.0);
+  }
 }
 
 
@@ -947,11 +1539,30 @@ void G1RemSet::oops_into_collection_set_do(G1ParScanThreadState* pss, uint worke
   log_debug(semeru)("Update and scan remset: %lfs, %lfs\n", mid-start, end-mid);
 }
 
+int G1RemSet::stash_rem_set(HeapRegion* hr, int mem_id, semeru_rdma_iovec* iov) {
+  return _remote_rem_sets != NULL ? _remote_rem_sets->stash(hr, mem_id, iov) : 0;
+}
+
 void G1RemSet::prepare_for_oops_into_collection_set_do() {
+  // The cards queued for the memory servers are refined by Update RS.
+  if (_remote_refine != NULL) {
+    _remote_refine->flush();
+  }
+
   DirtyCardQueueSet& dcqs = G1BarrierSet::dirty_card_queue_set();
   dcqs.concatenate_logs();
 
+  // The stashed cards of the CSet Regions are scanned as the local ones, and sent by the remote card scan.
+  if (_remote_rem_sets != NULL) {
+    _remote_rem_sets->fetch();
+  }
+
   _scan_state->reset();
+
+  // -XX:+SemeruRemoteCardScan, after the scan tops are taken.
+  if (_remote_cards != NULL) {
+    _remote_cards->request(_scan_state);
+  }
 }
 
 void G1RemSet::cleanup_after_oops_into_collection_set_do() {
@@ -1097,6 +1708,12 @@ void G1RemSet::refine_card_concurrently(jbyte* card_ptr,
   MemRegion dirty_region(start, MIN2(scan_limit, end));
   assert(!dirty_region.is_empty(), "sanity");
 
+  // Semeru, the card of a fully evicted Region is refined by its memory server.
+  if (_remote_refine != NULL && _remote_refine->offer(_ct, card_ptr, r, start, worker_i)) {
+    _num_conc_refined_cards++;
+    return;
+  }
+
   //mhr: modify
   //mhr: new
   G1ConcurrentRefineOopClosureNew conc_refine_cl(_g1h, worker_i);
@@ -46,6 +46,9 @@ class G1CollectedHeap;
 class G1CMBitMap;
 class G1HotCardCache;
 class G1RemSetScanState;
+class G1RemoteCardScanState;
+class G1RemoteRefineQueue;
+class G1RemoteRemSetStash;
 class G1ParScanThreadState;
 class G1Policy;
 class G1ScanObjsDuringScanRSClosure;
@@ -59,6 +62,15 @@ class G1RemSet: public CHeapObj<mtGC> {
 private:
   G1RemSetScanState* _scan_state;
 
+  // -XX:+SemeruRemoteCardScan, the cards of the evicted old Regions scanned by the memory servers. NULL if off.
+  G1RemoteCardScanState* _remote_cards;
+
+  // -XX:+SemeruRemoteRefinement, the dirty cards of the evicted old Regions refined by the memory servers. NULL if off.
+  G1RemoteRefineQueue* _remote_refine;
+
+  // -XX:+SemeruRemoteRemSets, the remembered sets of the memory server CSet Regions kept by the memory servers. NULL if off.
+  G1RemoteRemSetStash* _remote_rem_sets;
+
   G1RemSetSummary _prev_period_summary;
 
 //mhr: modify
@@ -111,6 +123,10 @@ public:
   void prepare_for_oops_into_collection_set_do();
   void cleanup_after_oops_into_collection_set_do();
 
+  // -XX:+SemeruRemoteRemSets, at the dispatch of the memory server CSet.
+  // Return the entries of iov used to write the remembered set of hr to its memory server, 0 or 1.
+  int stash_rem_set(HeapRegion* hr, int mem_id, semeru_rdma_iovec* iov);
+
   G1RemSetScanState* scan_state() const { return _scan_state; }
 
   // Refine the card corresponding to "card_ptr". Safe to be called concurrently
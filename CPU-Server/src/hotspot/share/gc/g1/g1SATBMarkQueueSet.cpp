@@ -25,14 +25,15 @@
 #include "precompiled.hpp"
 #include "gc/g1/g1CollectedHeap.inline.hpp"
 #include "gc/g1/g1SATBMarkQueueSet.hpp"
+#include "gc/g1/g1SemeruTargetQueueThread.hpp"
 #include "gc/g1/g1ThreadLocalData.hpp"
-#include "gc/g1/heapRegion.hpp"
+#include "gc/g1/heapRegion.inline.hpp"
 #include "gc/shared/satbMarkQueue.hpp"
 #include "oops/oop.hpp"
 #include "utilities/debug.hpp"
 #include "utilities/globalDefinitions.hpp"
 
-G1SATBMarkQueueSet::G1SATBMarkQueueSet() : _g1h(NULL) {}
+G1SATBMarkQueueSet::G1SATBMarkQueueSet() : _g1h(NULL), _g1_marking(false) {}
 
 void G1SATBMarkQueueSet::initialize(G1CollectedHeap* g1h,
                                     Monitor* cbl_mon,
@@ -111,21 +112,54 @@ static inline bool discard_entry(const void* entry, G1CollectedHeap* g1h) {
   return !requires_marking(entry, g1h) || g1h->is_marked_next((oop)entry);
 }
 
+// Semeru CPU - -XX:+SemeruSATBForwarding. The overwritten reference is a root of the Region it points into,
+// for the tracing of the Region by its memory server. It's marked into the Region's target queue, which
+// -XX:+SemeruConcurrentTargetQueue sends between the pauses, or the pause sends with the Region.
+// The entry is valid, the buffers are filtered at the start of each pause, before any object moves.
+static inline void forward_entry(const void* entry, G1CollectedHeap* g1h) {
+  HeapRegion* hr = g1h->heap_region_containing(entry);
+  if (!hr->records_target_marks() || hr->is_free() || (HeapWord*)entry >= hr->top()) {
+    return;
+  }
+  if (hr->cross_region_ref_target_queue()->push(oop(entry)) && SemeruConcurrentTargetQueue &&
+      hr->set_target_marks_unsent()) {
+    g1h->semeru_target_queue_thread()->note_unsent_region();
+  }
+}
+
 // Workaround for not yet having std::bind.
 class G1SATBMarkQueueFilterFn {
   G1CollectedHeap* _g1h;
+  bool             _forward;
+  bool             _g1_marking;
 
 public:
-  G1SATBMarkQueueFilterFn(G1CollectedHeap* g1h) : _g1h(g1h) {}
+  G1SATBMarkQueueFilterFn(G1CollectedHeap* g1h, bool g1_marking) :
+    _g1h(g1h), _forward(SemeruSATBForwarding), _g1_marking(g1_marking) {}
 
   // Return true if entry should be filtered out (removed), false if
   // it should be retained.
   bool operator()(const void* entry) const {
+    if (_forward) {
+      forward_entry(entry, _g1h);
+      if (!_g1_marking) {
+        return true;
+      }
+    }
     return discard_entry(entry, _g1h);
   }
 };
 
 void G1SATBMarkQueueSet::filter(SATBMarkQueue* queue) {
   assert(_g1h != NULL, "SATB queue set not initialized");
-  apply_filter(G1SATBMarkQueueFilterFn(_g1h), queue);
+  apply_filter(G1SATBMarkQueueFilterFn(_g1h, _g1_marking), queue);
+}
+
+void G1SATBMarkQueueSet::prepare_forwarding_for_pause() {
+  assert(SemeruSATBForwarding, "invariant");
+  if (!is_active()) {
+    // The first pause, the Java threads attached later take the active state of the set.
+    set_active_all_threads(true /* new active value */, false /* expected_active */);
+  }
+  filter_thread_buffers();
 }
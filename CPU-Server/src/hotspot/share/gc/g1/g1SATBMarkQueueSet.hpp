@@ -33,6 +33,10 @@ class JavaThread;
 class G1SATBMarkQueueSet : public SATBMarkQueueSet {
   G1CollectedHeap* _g1h;
 
+  // Semeru CPU - The concurrent marking of this server consumes the entries, between its initial mark and remark.
+  // With -XX:+SemeruSATBForwarding the queues stay active out of it, the filter only forwards the entries then.
+  bool _g1_marking;
+
 public:
   G1SATBMarkQueueSet();
 
@@ -46,6 +50,12 @@ public:
   static void handle_zero_index_for_thread(JavaThread* t);
   virtual SATBMarkQueue& satb_queue_for_thread(JavaThread* const t) const;
   virtual void filter(SATBMarkQueue* queue);
+
+  void set_g1_marking(bool marking) { _g1_marking = marking; }
+
+  // Semeru CPU - -XX:+SemeruSATBForwarding, at a safepoint before any object moves.
+  // Activate the queues, and forward the partial buffers of the threads.
+  void prepare_forwarding_for_pause();
 };
 
 #endif // SHARE_VM_GC_G1_G1SATBMARKQUEUE_HPP
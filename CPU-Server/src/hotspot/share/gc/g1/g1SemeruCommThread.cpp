@@ -0,0 +1,203 @@
+/**
+ * Semeru CPU Server - issue the control path writes off the critical path of their callers.
+ *
+ */
+
+#include "precompiled.hpp"
+#include "gc/g1/g1CollectedHeap.inline.hpp"
+#include "gc/g1/g1SemeruCommThread.hpp"
+#include "logging/log.hpp"
+#include "runtime/mutexLocker.hpp"
+#include "runtime/orderAccess.hpp"
+#include "runtime/os.hpp"
+#include "utilities/quickSort.hpp"
+
+G1SemeruCommThread::G1SemeruCommThread() :
+  ConcurrentGCThread(),
+  _vtime_start(0.0),
+  _vtime_accum(0.0),
+  _monitor(NULL),
+  _queue(NULL),
+  _submitted(0),
+  _completed(0),
+  _batch(NULL),
+  _iov(NULL)
+{
+  _monitor = new Monitor(Mutex::nonleaf, "Semeru comm monitor", true,
+                         Monitor::_safepoint_check_never);
+  _queue = NEW_C_HEAP_ARRAY(Request, QueueSize, mtGC);
+  _batch = NEW_C_HEAP_ARRAY(Request, QueueSize, mtGC);
+  _iov   = NEW_C_HEAP_ARRAY(semeru_rdma_iovec, 2 * SEMERU_RDMA_IOV_MAX, mtGC);
+
+  set_name("G1 Semeru Comm");
+  create_and_start();
+}
+
+// Wait for a free slot if the ring is full. With the _monitor held.
+void G1SemeruCommThread::enqueue(const Request& r) {
+  while (_submitted - _completed >= (jlong)QueueSize) {
+    _monitor->wait(Mutex::_no_safepoint_check_flag);
+  }
+  _queue[_submitted % QueueSize] = r;
+  OrderAccess::release_store(&_submitted, _submitted + 1);
+}
+
+jlong G1SemeruCommThread::submit_writev(const semeru_rdma_iovec* iov, int nr_iov) {
+  MutexLockerEx x(_monitor, Mutex::_no_safepoint_check_flag);
+  for (int i = 0; i < nr_iov; i++) {
+    Request r = { iov[i], false };
+    enqueue(r);
+  }
+  _monitor->notify_all();
+  return _submitted;
+}
+
+jlong G1SemeruCommThread::submit_bcast(void* start_addr, size_t size) {
+  MutexLockerEx x(_monitor, Mutex::_no_safepoint_check_flag);
+  Request r;
+  r._iov.mem_server_id = -1;
+  r._iov.write_type    = 0;
+  r._iov.start_addr    = (char*)start_addr;
+  r._iov.size          = size;
+  r._bcast             = true;
+  enqueue(r);
+  _monitor->notify_all();
+  return _submitted;
+}
+
+void G1SemeruCommThread::wait(jlong ticket) {
+  if (is_completed(ticket)) {
+    return;
+  }
+  MutexLockerEx x(_monitor, Mutex::_no_safepoint_check_flag);
+  while (!is_completed(ticket)) {
+    _monitor->wait(Mutex::_no_safepoint_check_flag);
+  }
+}
+
+// Copy the pending requests, their slots are freed after they are sent.
+int G1SemeruCommThread::take_batch() {
+  MutexLockerEx x(_monitor, Mutex::_no_safepoint_check_flag);
+  while (_submitted == _completed && !should_terminate()) {
+    _monitor->wait(Mutex::_no_safepoint_check_flag);
+  }
+  int n = (int)(_submitted - _completed);
+  for (int i = 0; i < n; i++) {
+    _batch[i] = _queue[(_completed + i) % QueueSize];
+  }
+  return n;
+}
+
+static int compare_requests_by_server(G1SemeruCommThread::Request* ra, G1SemeruCommThread::Request* rb) {
+  const semeru_rdma_iovec* a = &ra->_iov;
+  const semeru_rdma_iovec* b = &rb->_iov;
+  if (a->mem_server_id != b->mem_server_id) {
+    return a->mem_server_id < b->mem_server_id ? -1 : 1;
+  }
+  // The signals after the data of their memory server.
+  if (a->write_type != b->write_type) {
+    return a->write_type < b->write_type ? -1 : 1;
+  }
+  if (a->start_addr != b->start_addr) {
+    return a->start_addr < b->start_addr ? -1 : 1;
+  }
+  return 0;
+}
+
+/**
+ * Send the n writes of reqs, a part of _batch.
+ * Sorted by memory server, the overlapping or adjacent data ranges of one server are merged.
+ */
+void G1SemeruCommThread::flush_writes(Request* reqs, int n) {
+  if (n == 0) {
+    return;
+  }
+
+  QuickSort::sort(reqs, n, compare_requests_by_server, false);
+  int m = 0;
+  for (int i = 1; i < n; i++) {
+    semeru_rdma_iovec* last = &reqs[m]._iov;
+    const semeru_rdma_iovec* cur = &reqs[i]._iov;
+    if (cur->mem_server_id == last->mem_server_id && cur->write_type == 0 && last->write_type == 0 &&
+        cur->start_addr <= last->start_addr + last->size) {
+      char* end = MAX2(last->start_addr + last->size, cur->start_addr + cur->size);
+      last->size = (unsigned long)(end - last->start_addr);
+    } else {
+      reqs[++m] = reqs[i];
+    }
+  }
+  const int nr_entries = m + 1;
+
+  // Post a vector while the previous one is in flight, post_rdma_iovec_async() waits for the previous one first.
+  // The two halves of _iov take turns, a half is refilled only after its last vector completed.
+  G1CollectedHeap* g1h = G1CollectedHeap::heap();
+  int ticket = -1;
+  int half = 0;
+  for (int start = 0; start < nr_entries; start += SEMERU_RDMA_IOV_MAX, half ^= 1) {
+    int len = MIN2(nr_entries - start, (int)SEMERU_RDMA_IOV_MAX);
+    semeru_rdma_iovec* vec = _iov + half * SEMERU_RDMA_IOV_MAX;
+    for (int i = 0; i < len; i++) {
+      vec[i] = reqs[start + i]._iov;
+    }
+    ticket = g1h->post_rdma_iovec_async(vec, len, ticket);
+  }
+  g1h->wait_rdma_ticket(ticket);
+
+  log_trace(semeru, rdma)("%s, 0x%x writes sent by 0x%x entries", __func__, n, nr_entries);
+}
+
+void G1SemeruCommThread::issue_batch(int n) {
+  G1CollectedHeap* g1h = G1CollectedHeap::heap();
+  int start = 0;
+  for (int i = 0; i < n; i++) {
+    if (!_batch[i]._bcast) {
+      continue;
+    }
+    flush_writes(_batch + start, i - start);
+    start = i + 1;
+
+    const semeru_rdma_iovec* b = &_batch[i]._iov;
+    if (i + 1 < n && _batch[i + 1]._bcast &&
+        _batch[i + 1]._iov.start_addr == b->start_addr && _batch[i + 1]._iov.size == b->size) {
+      continue;  // the next one sends the same range again
+    }
+    semeru_cp_bcast(b->start_addr, (size_t)b->size);
+    for (size_t mem_id = 0; mem_id < SemeruMemServerNum; mem_id++) {
+      g1h->ring_mem_server_doorbell(mem_id);
+    }
+  }
+  flush_writes(_batch + start, n - start);
+}
+
+void G1SemeruCommThread::run_service() {
+  _vtime_start = os::elapsedVTime();
+
+  // Not joined to the suspendible thread set, the VM thread waits for the tickets in the pause.
+  while (true) {
+    int n = take_batch();
+    if (n == 0) {
+      break;  // terminated and nothing left
+    }
+
+    issue_batch(n);
+
+    {
+      MutexLockerEx x(_monitor, Mutex::_no_safepoint_check_flag);
+      OrderAccess::release_store(&_completed, _completed + n);
+      _monitor->notify_all();
+    }
+
+    if (os::supports_vtime()) {
+      _vtime_accum = (os::elapsedVTime() - _vtime_start);
+    } else {
+      _vtime_accum = 0.0;
+    }
+  }
+
+  log_debug(semeru, rdma)("%s, stopping, 0x%lx requests sent", __func__, (size_t)_completed);
+}
+
+void G1SemeruCommThread::stop_service() {
+  MutexLockerEx x(_monitor, Mutex::_no_safepoint_check_flag);
+  _monitor->notify_all();
+}
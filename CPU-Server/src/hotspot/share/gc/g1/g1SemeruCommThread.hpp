@@ -0,0 +1,74 @@
+/**
+ * Semeru CPU Server - issue the control path writes off the critical path of their callers.
+ *
+ */
+
+#ifndef SHARE_VM_GC_G1_G1SEMERUCOMMTHREAD_HPP
+#define SHARE_VM_GC_G1_G1SEMERUCOMMTHREAD_HPP
+
+#include "gc/shared/concurrentGCThread.hpp"
+#include "runtime/orderAccess.hpp"
+#include "runtime/rdma_cp_comm.hpp"
+
+/**
+ * Semeru CPU - The communication thread of the control path, -XX:+SemeruCommThread.
+ *
+ * The callers submit the vectored writes and the broadcasts of the flags, and get a ticket back,
+ * then keep working until they need the data to be on the memory servers, wait(ticket).
+ *
+ * 1) The requests are issued in the order of their submission. Each run of writes between two broadcasts
+ *    is sorted by memory server, the adjacent ranges are merged, and sent by RDMA_WRITEV_ASYNC in vectors
+ *    of SEMERU_RDMA_IOV_MAX entries, the next one posted while the previous one is in flight.
+ * 2) A broadcast waits for the writes before it, then rings the doorbells of all the memory servers.
+ *    The broadcasts of the same range queued back to back are sent once, the range is read when it's sent.
+ * 3) A ticket completes when all the requests up to it are acknowledged.
+ *
+ * The data is read when it's sent, not when it's submitted. The caller doesn't change a range before its ticket completes.
+ */
+class G1SemeruCommThread: public ConcurrentGCThread {
+public:
+  static const uint QueueSize = 4 * SEMERU_RDMA_IOV_MAX;
+
+  struct Request {
+    semeru_rdma_iovec _iov;
+    bool              _bcast;  // to all the memory servers, then the doorbells
+  };
+
+private:
+  double _vtime_start;  // Initial virtual time.
+  double _vtime_accum;  // Accumulated virtual time.
+
+  Monitor* _monitor;
+
+  // A ring of QueueSize requests, [_completed, _submitted) are pending, the ticket of a request is its sequence.
+  Request*       _queue;
+  volatile jlong _submitted;
+  volatile jlong _completed;
+
+  // Owned by the thread.
+  Request*           _batch;
+  semeru_rdma_iovec* _iov;
+
+  void enqueue(const Request& r);
+
+  int  take_batch();
+  void issue_batch(int n);
+  void flush_writes(Request* reqs, int n);
+
+  void run_service();
+  void stop_service();
+public:
+  G1SemeruCommThread();
+
+  // Return the ticket of the last entry.
+  jlong submit_writev(const semeru_rdma_iovec* iov, int nr_iov);
+  jlong submit_bcast(void* start_addr, size_t size);
+
+  bool is_completed(jlong ticket) const { return OrderAccess::load_acquire(&_completed) >= ticket; }
+  void wait(jlong ticket);
+
+  // Total virtual time so far.
+  double vtime_accum() { return _vtime_accum; }
+};
+
+#endif // SHARE_VM_GC_G1_G1SEMERUCOMMTHREAD_HPP
@@ -0,0 +1,70 @@
+/**
+ * Semeru CPU Server - the JFR events of the memory server CSet, the handshakes with the memory servers and the swap.
+ *
+ */
+
+#include "precompiled.hpp"
+#include "gc/g1/g1SemeruEventSender.hpp"
+#include "gc/g1/heapRegion.hpp"
+#include "gc/shared/gcId.hpp"
+#include "jfr/jfrEvents.hpp"
+
+size_t G1SemeruEventSender::_last_on_demand_swapins = 0;
+
+void G1SemeruEventSender::send_cset_region_event(uint mem_id, HeapRegion* hr) {
+  EventSemeruCSetRegion e;
+  if (e.should_commit()) {
+    e.set_gcId(GCId::current());
+    e.set_memoryServer(mem_id);
+    e.set_index(hr->hrm_index());
+    e.set_used(hr->used());
+    e.commit();
+  }
+}
+
+void G1SemeruEventSender::send_cset_dispatch_event(uint mem_id, uint regions, size_t bytes, const Ticks& start) {
+  EventSemeruCSetDispatch e(UNTIMED);
+  if (e.should_commit()) {
+    e.set_gcId(GCId::current());
+    e.set_memoryServer(mem_id);
+    e.set_regions(regions);
+    e.set_bytes(bytes);
+    e.set_starttime(start);
+    e.set_endtime(Ticks::now());
+    e.commit();
+  }
+}
+
+void G1SemeruEventSender::send_mem_server_wait_event(size_t mem_id, int state, bool arrived, const Ticks& start) {
+  EventSemeruMemoryServerWait e(UNTIMED);
+  if (e.should_commit()) {
+    e.set_memoryServer((uint)mem_id);
+    e.set_state(state);
+    e.set_arrived(arrived);
+    e.set_starttime(start);
+    e.set_endtime(Ticks::now());
+    e.commit();
+  }
+}
+
+void G1SemeruEventSender::send_swap_in_event() {
+  EventSemeruSwapIn e;
+  if (!e.should_commit()) {
+    return;
+  }
+
+  int on_demand_swapins = syscall(SYS_NUM_ON_DEMAND_SWAPIN);
+  if (on_demand_swapins < 0) {
+    return;
+  }
+
+  // The kernel counter is reset with the swap statistics.
+  size_t total = (size_t)on_demand_swapins;
+  size_t swapins = total >= _last_on_demand_swapins ? total - _last_on_demand_swapins : total;
+  _last_on_demand_swapins = total;
+
+  e.set_gcId(GCId::current());
+  e.set_swapIns(swapins);
+  e.set_totalSwapIns(total);
+  e.commit();
+}
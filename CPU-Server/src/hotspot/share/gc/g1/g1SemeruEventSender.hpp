@@ -0,0 +1,27 @@
+/**
+ * Semeru CPU Server - the JFR events of the memory server CSet, the handshakes with the memory servers and the swap.
+ *
+ */
+
+#ifndef SHARE_VM_GC_G1_G1SEMERUEVENTSENDER_HPP
+#define SHARE_VM_GC_G1_G1SEMERUEVENTSENDER_HPP
+
+#include "memory/allocation.hpp"
+#include "utilities/ticks.hpp"
+
+class HeapRegion;
+
+class G1SemeruEventSender : public AllStatic {
+  // The kernel counter of the on demand swap ins at the last pause.
+  static size_t _last_on_demand_swapins;
+
+public:
+  static void send_cset_region_event(uint mem_id, HeapRegion* hr);
+  static void send_cset_dispatch_event(uint mem_id, uint regions, size_t bytes, const Ticks& start);
+  static void send_mem_server_wait_event(size_t mem_id, int state, bool arrived, const Ticks& start);
+
+  // Once per pause, the syscall is only issued when the event is enabled.
+  static void send_swap_in_event();
+};
+
+#endif // SHARE_VM_GC_G1_G1SEMERUEVENTSENDER_HPP
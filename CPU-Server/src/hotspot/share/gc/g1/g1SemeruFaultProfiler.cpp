@@ -0,0 +1,257 @@
+/**
+ * Semeru CPU Server - the profile of the remote faults, -XX:SemeruFaultSamplePeriod.
+ *
+ */
+
+#include "precompiled.hpp"
+#include "code/codeCache.hpp"
+#include "code/compiledMethod.hpp"
+#include "code/scopeDesc.hpp"
+#include "gc/g1/g1CollectedHeap.inline.hpp"
+#include "gc/g1/g1SemeruFaultProfiler.hpp"
+#include "gc/g1/heapRegion.inline.hpp"
+#include "interpreter/interpreter.hpp"
+#include "logging/log.hpp"
+#include "memory/resourceArea.hpp"
+#include "oops/method.hpp"
+#include "oops/oop.inline.hpp"
+#include "runtime/mutexLocker.hpp"
+#include "runtime/orderAccess.hpp"
+#include "runtime/os.hpp"
+#include "runtime/safepoint.hpp"
+#include "utilities/ostream.hpp"
+#include "utilities/quickSort.hpp"
+
+#include <sys/syscall.h>
+#include <unistd.h>
+
+semeru_fault_sample_ring*       G1SemeruFaultProfiler::_ring        = NULL;
+Mutex*                          G1SemeruFaultProfiler::_lock        = NULL;
+G1SemeruFaultProfiler::Table*   G1SemeruFaultProfiler::_methods     = NULL;
+G1SemeruFaultProfiler::Table*   G1SemeruFaultProfiler::_types       = NULL;
+size_t                          G1SemeruFaultProfiler::_num_samples = 0;
+
+static const char* sample_type_name(uint type) {
+  switch (type) {
+    case SEMERU_FAULT_READ:       return "read";
+    case SEMERU_FAULT_PREFETCHED: return "prefetched";
+    case SEMERU_FAULT_LOCAL:      return "local";
+    default:                      return "unknown";
+  }
+}
+
+static uint name_hash(const char* name) {
+  uint h = 2166136261u;   // FNV-1a
+  for (const char* c = name; *c != '\0'; c++) {
+    h = (h ^ (uint)(unsigned char)*c) * 16777619u;
+  }
+  return h;
+}
+
+size_t G1SemeruFaultProfiler::Entry::total() const {
+  size_t n = 0;
+  for (uint i = 0; i < SEMERU_FAULT_TYPES; i++) {
+    n += _samples[i];
+  }
+  return n;
+}
+
+G1SemeruFaultProfiler::Entry* G1SemeruFaultProfiler::Table::find_or_add(const char* name) {
+  uint hash = name_hash(name);
+  for (uint i = 0; i < TableSize; i++) {
+    Entry* e = &_entries[(hash + i) & (TableSize - 1)];
+    if (e->_name == NULL) {
+      if (_used >= TableSize / 4 * 3) {
+        return &_other;   // keep the probes short
+      }
+      e->_name = os::strdup(name, mtGC);
+      e->_hash = hash;
+      _used++;
+      return e;
+    }
+    if (e->_hash == hash && strcmp(e->_name, name) == 0) {
+      return e;
+    }
+  }
+  return &_other;
+}
+
+void G1SemeruFaultProfiler::initialize() {
+  char* ring = os::reserve_memory(RingBytes, NULL, os::vm_page_size());
+  if (ring == NULL) {
+    return;
+  }
+  os::commit_memory_or_exit(ring, RingBytes, false, "Semeru fault samples");
+
+  if (syscall(RDMA_FAULT_SAMPLES, (int)SemeruFaultSamplePeriod, ring, RingBytes) != 0) {
+    log_warning(semeru)("%s, the kernel doesn't sample the remote faults, -XX:SemeruFaultSamplePeriod is ignored.", __func__);
+    os::release_memory(ring, RingBytes);
+    return;
+  }
+
+  _lock    = new Mutex(Mutex::nonleaf, "Semeru fault profiler lock", true, Monitor::_safepoint_check_never);
+  _methods = NEW_C_HEAP_OBJ(Table, mtGC);
+  _types   = NEW_C_HEAP_OBJ(Table, mtGC);
+  memset(_methods, 0, sizeof(Table));
+  memset(_types, 0, sizeof(Table));
+  _methods->_other._name = (char*)"<other>";
+  _types->_other._name   = (char*)"<other>";
+  OrderAccess::release_store(&_ring, (semeru_fault_sample_ring*)ring);
+
+  log_info(semeru)("%s, 1 of %lu swap-ins sampled into %u entries at 0x%lx", __func__,
+                   SemeruFaultSamplePeriod, _ring->nr_entries, (size_t)ring);
+}
+
+/**
+ * The Java method and bci of a compiled pc, the innermost inlined one.
+ * The interpreted frames aren't walked, the sample doesn't carry their fp.
+ */
+void G1SemeruFaultProfiler::resolve_code(address pc, char* buf, int buflen) {
+  if (Interpreter::contains(pc)) {
+    jio_snprintf(buf, buflen, "<interpreted>");
+    return;
+  }
+
+  CodeBlob* cb = CodeCache::find_blob_unsafe(pc);
+  if (cb != NULL) {
+    CompiledMethod* cm = cb->as_compiled_method_or_null();
+    if (cm == NULL) {
+      jio_snprintf(buf, buflen, "stub %s", cb->name());
+      return;
+    }
+    if (!cm->is_alive()) {
+      jio_snprintf(buf, buflen, "<flushed code>");
+      return;
+    }
+    ScopeDesc* sd = cm->scope_desc_near(pc);
+    if (sd == NULL || sd->method() == NULL) {
+      jio_snprintf(buf, buflen, "%s", cm->method()->name_and_sig_as_C_string());
+      return;
+    }
+    jio_snprintf(buf, buflen, "%s @ %d", sd->method()->name_and_sig_as_C_string(), sd->bci());
+    return;
+  }
+
+  int offset = 0;
+  char sym[256];
+  if (os::dll_address_to_function_name(pc, sym, sizeof(sym), &offset)) {
+    jio_snprintf(buf, buflen, "%s %s", os::address_is_in_vm(pc) ? "vm" : "native", sym);
+  } else {
+    jio_snprintf(buf, buflen, "<unknown code>");
+  }
+}
+
+/**
+ * The Klass of the object containing addr.
+ * The young Regions have no BOT, their objects aren't walked to.
+ */
+void G1SemeruFaultProfiler::resolve_object(address addr, char* buf, int buflen) {
+  G1CollectedHeap* g1h = G1CollectedHeap::heap();
+  if (!g1h->is_in_g1_reserved(addr)) {
+    jio_snprintf(buf, buflen, "<non-heap>");
+    return;
+  }
+
+  HeapRegion* hr = g1h->heap_region_containing(addr);
+  if (hr->is_free() || (HeapWord*)addr >= hr->top()) {
+    jio_snprintf(buf, buflen, "<free>");
+    return;
+  }
+  if (hr->is_young()) {
+    jio_snprintf(buf, buflen, "<young>");
+    return;
+  }
+
+  HeapWord* start;
+  if (hr->is_continues_humongous()) {
+    start = hr->humongous_start_region()->bottom();
+  } else {
+    start = hr->block_start(addr);
+  }
+  oop obj = (oop)start;
+  if (start == NULL || !oopDesc::is_oop(obj)) {
+    jio_snprintf(buf, buflen, "<not an object>");
+    return;
+  }
+  jio_snprintf(buf, buflen, "%s", obj->klass()->external_name());
+}
+
+void G1SemeruFaultProfiler::record(Table* t, const char* name, const semeru_fault_sample* s) {
+  Entry* e = t->find_or_add(name);
+  e->_samples[s->type < SEMERU_FAULT_TYPES ? s->type : SEMERU_FAULT_READ]++;
+  e->_latency_ns += s->latency_ns;
+}
+
+void G1SemeruFaultProfiler::drain() {
+  assert(SafepointSynchronize::is_at_safepoint(), "The code and the heap hold still at a safepoint");
+  if (!is_enabled()) {
+    return;
+  }
+
+  uint64_t tail = _ring->tail;
+  uint64_t head = OrderAccess::load_acquire(&_ring->head);
+  if (head == tail) {
+    return;
+  }
+
+  MutexLockerEx x(_lock, Mutex::_no_safepoint_check_flag);
+  char buf[512];
+  for (uint64_t i = tail; i < head; i++) {
+    ResourceMark rm;
+    const semeru_fault_sample* s = &_ring->samples()[i % _ring->nr_entries];
+    resolve_code((address)s->ip, buf, sizeof(buf));
+    record(_methods, buf, s);
+    resolve_object((address)s->vaddr, buf, sizeof(buf));
+    record(_types, buf, s);
+  }
+  _num_samples += head - tail;
+
+  // The samples are read before the kernel reuses their slots.
+  OrderAccess::release_store(&_ring->tail, head);
+  log_debug(semeru)("%s, 0x%lx samples", __func__, (size_t)(head - tail));
+}
+
+// The most samples first.
+int G1SemeruFaultProfiler::compare_by_samples(Entry** a, Entry** b) {
+  size_t na = (*a)->total();
+  size_t nb = (*b)->total();
+  return na > nb ? -1 : (na < nb ? 1 : 0);
+}
+
+void G1SemeruFaultProfiler::print_table(Table* t, const char* title, outputStream* st) {
+  Entry** sorted = NEW_RESOURCE_ARRAY(Entry*, TableSize + 1);
+  uint n = 0;
+  for (uint i = 0; i < TableSize; i++) {
+    if (t->_entries[i]._name != NULL) {
+      sorted[n++] = &t->_entries[i];
+    }
+  }
+  if (t->_other.total() > 0) {
+    sorted[n++] = &t->_other;
+  }
+  QuickSort::sort(sorted, n, compare_by_samples, false);
+
+  st->print_cr("%s, %u of %u:", title, MIN2(n, MaxPrinted), n);
+  st->print_cr("  %8s %6s %8s %10s %8s %12s  %s", "samples", "%", sample_type_name(SEMERU_FAULT_READ),
+               sample_type_name(SEMERU_FAULT_PREFETCHED), sample_type_name(SEMERU_FAULT_LOCAL), "avg us", "name");
+  for (uint i = 0; i < n && i < MaxPrinted; i++) {
+    Entry* e = sorted[i];
+    size_t total = e->total();
+    st->print_cr("  %8lu %5.1f%% %8lu %10lu %8lu %12.1f  %s", total, total * 100.0 / MAX2(_num_samples, (size_t)1),
+                 e->_samples[SEMERU_FAULT_READ], e->_samples[SEMERU_FAULT_PREFETCHED], e->_samples[SEMERU_FAULT_LOCAL],
+                 total == 0 ? 0.0 : (double)e->_latency_ns / total / NANOUNITS * MICROUNITS, e->_name);
+  }
+}
+
+void G1SemeruFaultProfiler::print_on(outputStream* st) {
+  ResourceMark rm;
+  MutexLockerEx x(_lock, Mutex::_no_safepoint_check_flag);
+
+  st->print_cr("Semeru remote faults, 1 of %lu swap-ins sampled: 0x%lx samples resolved, 0x%lx dropped by a full ring.",
+               SemeruFaultSamplePeriod, _num_samples, (size_t)_ring->dropped);
+  if (_num_samples == 0) {
+    return;
+  }
+  print_table(_methods, "By code", st);
+  print_table(_types, "By object type", st);
+}
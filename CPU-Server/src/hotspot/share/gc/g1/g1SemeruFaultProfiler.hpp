@@ -0,0 +1,79 @@
+/**
+ * Semeru CPU Server - the profile of the remote faults, -XX:SemeruFaultSamplePeriod.
+ *
+ */
+
+#ifndef SHARE_VM_GC_G1_G1SEMERUFAULTPROFILER_HPP
+#define SHARE_VM_GC_G1_G1SEMERUFAULTPROFILER_HPP
+
+#include "memory/allocation.hpp"
+#include "utilities/globalDefinitions.hpp"
+
+class outputStream;
+
+/**
+ * Semeru CPU - Which Java code and which objects wait for the memory servers.
+ *
+ * 1) The kernel samples 1 of SemeruFaultSamplePeriod swap-ins of this process, RDMA_FAULT_SAMPLES.
+ *    Each sample is the user ip and sp of the faulting thread, the faulting address, the latency and how
+ *    the page was served. The samples are written into a ring shared with the JVM, a full ring drops them.
+ * 2) The VM thread drains the ring at each pause, the code and the heap hold still there.
+ *    The ip is resolved to the compiled Java method and bci, the interpreter, a stub or a native symbol.
+ *    The faulting address is resolved to the Klass of the object containing it.
+ *    The allocation site of an object isn't recorded in this tree, the Klass stands for it,
+ *    as in G1SemeruPretenureProfile.
+ * 3) The samples are counted per method and per Klass, with their latency.
+ *    Logged by -Xlog:semeru at exit, jcmd GC.semeru_fault_profile prints them at any time.
+ *
+ * A sample is resolved up to a pause after its fault. The code flushed and the objects moved in between
+ * are counted as <flushed code> or under the object moved in, the ring is kept small against it.
+ */
+class G1SemeruFaultProfiler : public AllStatic {
+public:
+  static const size_t RingBytes  = 1 * M;   // about 26K samples
+  static const uint   TableSize  = 4096;    // entries per table, a power of 2
+  static const uint   MaxPrinted = 50;      // of each table
+
+private:
+  struct Entry {
+    char*  _name;       // NULL for an empty slot
+    uint   _hash;
+    size_t _samples[SEMERU_FAULT_TYPES];
+    jlong  _latency_ns;
+
+    size_t total() const;
+  };
+
+  // Open addressing. A full table counts the new names into _other.
+  struct Table {
+    Entry  _entries[TableSize];
+    uint   _used;
+    Entry  _other;
+
+    Entry* find_or_add(const char* name);
+  };
+
+  static semeru_fault_sample_ring* _ring;
+  static Mutex*                    _lock;     // the tables are updated or printed
+  static Table*                    _methods;
+  static Table*                    _types;
+  static size_t                    _num_samples;
+
+  static void resolve_code(address pc, char* buf, int buflen);
+  static void resolve_object(address addr, char* buf, int buflen);
+  static void record(Table* t, const char* name, const semeru_fault_sample* s);
+  static int  compare_by_samples(Entry** a, Entry** b);
+  static void print_table(Table* t, const char* title, outputStream* st);
+
+public:
+  // Share the ring with the kernel. Disabled if the kernel doesn't take it.
+  static void initialize();
+  static bool is_enabled() { return _ring != NULL; }
+
+  // By the VM thread, at a safepoint.
+  static void drain();
+
+  static void print_on(outputStream* st);
+};
+
+#endif // SHARE_VM_GC_G1_G1SEMERUFAULTPROFILER_HPP
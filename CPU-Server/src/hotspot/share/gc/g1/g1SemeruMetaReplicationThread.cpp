@@ -0,0 +1,67 @@
+/**
+ * Semeru CPU Server - replicate the klass metadata to the memory servers between the pauses.
+ *
+ */
+
+#include "precompiled.hpp"
+#include "gc/g1/g1CollectedHeap.inline.hpp"
+#include "gc/g1/g1SemeruMetaReplicationThread.hpp"
+#include "gc/shared/suspendibleThreadSet.hpp"
+#include "logging/log.hpp"
+#include "runtime/mutexLocker.hpp"
+#include "runtime/os.hpp"
+
+G1SemeruMetaReplicationThread::G1SemeruMetaReplicationThread() :
+  ConcurrentGCThread(),
+  _vtime_start(0.0),
+  _vtime_accum(0.0),
+  _monitor(NULL)
+{
+  _monitor = new Monitor(Mutex::nonleaf, "Semeru meta replication monitor", true,
+                         Monitor::_safepoint_check_never);
+
+  set_name("G1 Semeru Meta Replication");
+  create_and_start();
+}
+
+void G1SemeruMetaReplicationThread::sleep_before_next_round() {
+  MutexLockerEx x(_monitor, Mutex::_no_safepoint_check_flag);
+  if (!should_terminate()) {
+    _monitor->wait(Mutex::_no_safepoint_check_flag, SemeruMetaReplicationIntervalMillis);
+  }
+}
+
+void G1SemeruMetaReplicationThread::run_service() {
+  _vtime_start = os::elapsedVTime();
+
+  while (!should_terminate()) {
+    sleep_before_next_round();
+    if (should_terminate()) {
+      break;
+    }
+
+    int sent;
+    {
+      SuspendibleThreadSetJoiner sts_join;
+      sent = G1CollectedHeap::heap()->replicate_metadata(false /* at_safepoint */);
+    }
+
+    if (sent > 0) {
+      log_debug(semeru, rdma)("%s, shipped 0x%x metadata ranges, epoch %lu", __func__, sent,
+                              G1CollectedHeap::heap()->meta_epoch());
+    }
+
+    if (os::supports_vtime()) {
+      _vtime_accum = (os::elapsedVTime() - _vtime_start);
+    } else {
+      _vtime_accum = 0.0;
+    }
+  }
+
+  log_debug(semeru, rdma)("%s, stopping", __func__);
+}
+
+void G1SemeruMetaReplicationThread::stop_service() {
+  MutexLockerEx x(_monitor, Mutex::_no_safepoint_check_flag);
+  _monitor->notify();
+}
@@ -0,0 +1,39 @@
+/**
+ * Semeru CPU Server - replicate the klass metadata to the memory servers between the pauses.
+ *
+ */
+
+#ifndef SHARE_VM_GC_G1_G1SEMERUMETAREPLICATIONTHREAD_HPP
+#define SHARE_VM_GC_G1_G1SEMERUMETAREPLICATIONTHREAD_HPP
+
+#include "gc/shared/concurrentGCThread.hpp"
+
+/**
+ * Semeru CPU - The metaspace replication thread, -XX:+SemeruConcurrentMetaReplication.
+ *
+ * The klass metadata is almost immutable after the class loading. Every SemeruMetaReplicationIntervalMillis,
+ * this thread ships the metaspace chunks allocated since the last round, and the pages written since then,
+ * to all the memory servers, see G1CollectedHeap::replicate_metadata().
+ * Each round that ships something opens a new epoch.
+ *
+ * Joined to the suspendible thread set, a round never overlaps a pause.
+ * The pause then only confirms the epoch and ships the residue of the last interval, usually nothing.
+ */
+class G1SemeruMetaReplicationThread: public ConcurrentGCThread {
+  double _vtime_start;  // Initial virtual time.
+  double _vtime_accum;  // Accumulated virtual time.
+
+  Monitor* _monitor;
+
+  void sleep_before_next_round();
+
+  void run_service();
+  void stop_service();
+public:
+  G1SemeruMetaReplicationThread();
+
+  // Total virtual time so far.
+  double vtime_accum() { return _vtime_accum; }
+};
+
+#endif // SHARE_VM_GC_G1_G1SEMERUMETAREPLICATIONTHREAD_HPP
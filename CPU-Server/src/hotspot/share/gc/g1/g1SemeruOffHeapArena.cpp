@@ -0,0 +1,191 @@
+/**
+ * Semeru CPU Server - the off-heap arena backed by the memory servers, -XX:SemeruOffHeapArenaSize.
+ *
+ */
+
+#include "precompiled.hpp"
+#include "gc/g1/g1CollectedHeap.hpp"
+#include "gc/g1/g1SemeruOffHeapArena.hpp"
+#include "gc/g1/heapRegion.hpp"
+#include "gc/g1/heapRegionManager.hpp"
+#include "gc/shared/rdmaMetaLayout.hpp"
+#include "logging/log.hpp"
+#include "runtime/mutexLocker.hpp"
+#include "runtime/os.hpp"
+#include "services/memTracker.hpp"
+#include "utilities/align.hpp"
+#include "utilities/bitMap.inline.hpp"
+
+#include <sys/syscall.h>
+#include <unistd.h>
+
+char*         G1SemeruOffHeapArena::_base        = NULL;
+char*         G1SemeruOffHeapArena::_end         = NULL;
+size_t        G1SemeruOffHeapArena::_num_pages   = 0;
+CHeapBitMap*  G1SemeruOffHeapArena::_used        = NULL;
+CHeapBitMap*  G1SemeruOffHeapArena::_starts      = NULL;
+uint32_t*     G1SemeruOffHeapArena::_block_pages = NULL;
+uint32_t*     G1SemeruOffHeapArena::_unit_pages  = NULL;
+size_t        G1SemeruOffHeapArena::_chunk_pages[RDMA_DATA_REGION_NUM];
+size_t        G1SemeruOffHeapArena::_next_page  = 0;
+size_t        G1SemeruOffHeapArena::_used_pages = 0;
+Mutex*        G1SemeruOffHeapArena::_lock       = NULL;
+
+void G1SemeruOffHeapArena::initialize(HeapWord* heap_end) {
+  if (!SemeruEnableMemPool || SemeruOffHeapArenaSize == 0) {
+    return;
+  }
+
+  char* data_end = (char*)(RDMA_DATA_SPACE_START_ADDR + SemeruMetaLayout::heap_size());
+  size_t size = align_down(SemeruOffHeapArenaSize, HeapRegion::GrainBytes);
+  if (size == 0 || size > pointer_delta(data_end, (char*)heap_end, 1)) {
+    log_warning(semeru, alloc)("%s, no room for the off-heap arena of 0x%lx bytes between the heap end 0x%lx and "
+                               "the data space end 0x%lx, -XX:SemeruOffHeapArenaSize is ignored.",
+                               __func__, SemeruOffHeapArenaSize, (size_t)heap_end, (size_t)data_end);
+    return;
+  }
+
+  char* base = data_end - size;
+  char* rs = os::attempt_reserve_memory_at(size, base);
+  if (rs != base) {
+    if (rs != NULL) {
+      os::release_memory(rs, size);
+    }
+    log_warning(semeru, alloc)("%s, can't reserve the off-heap arena [0x%lx, 0x%lx), -XX:SemeruOffHeapArenaSize is ignored.",
+                               __func__, (size_t)base, (size_t)data_end);
+    return;
+  }
+  MemTracker::record_virtual_memory_type((address)base, mtOther);
+
+  _num_pages   = size / os::vm_page_size();
+  _used        = new CHeapBitMap(_num_pages, mtOther);
+  _starts      = new CHeapBitMap(_num_pages, mtOther);
+  _block_pages = NEW_C_HEAP_ARRAY(uint32_t, _num_pages, mtOther);
+  _unit_pages  = NEW_C_HEAP_ARRAY(uint32_t, size / HeapRegion::GrainBytes, mtOther);
+  memset(_unit_pages, 0, size / HeapRegion::GrainBytes * sizeof(uint32_t));
+  memset(_chunk_pages, 0, sizeof(_chunk_pages));
+  _lock = new Mutex(Mutex::leaf, "Semeru off-heap arena lock", true, Monitor::_safepoint_check_never);
+  _end  = data_end;
+  _base = base;
+
+  log_info(semeru, alloc)("%s, off-heap arena [0x%lx, 0x%lx), blocks of at least 0x%lx bytes", __func__,
+                          (size_t)_base, (size_t)_end, SemeruOffHeapMinAllocation);
+}
+
+size_t G1SemeruOffHeapArena::used() {
+  return _used_pages * os::vm_page_size();
+}
+
+// The first free run of num_pages from _next_page, then from the bottom. _num_pages if none.
+size_t G1SemeruOffHeapArena::find_pages(size_t num_pages) {
+  size_t from[2] = { _next_page, 0 };
+  for (int pass = 0; pass < 2; pass++) {
+    size_t start = _used->get_next_zero_offset(from[pass], _num_pages);
+    while (start + num_pages <= _num_pages) {
+      size_t end = _used->get_next_one_offset(start, start + num_pages);
+      if (end == start + num_pages) {
+        return start;
+      }
+      start = _used->get_next_zero_offset(end, _num_pages);
+    }
+  }
+  return _num_pages;
+}
+
+/**
+ * The used pages of the units and of the data chunks under a block.
+ *  A unit gets its first block, or loses its last one, its reclaim hint changes.
+ *  A chunk gets its first block, it's backed by the memory servers. It loses its last one, it's released,
+ *  unless it's shared with the heap, whose Regions expand and release it.
+ */
+void G1SemeruOffHeapArena::update_backing(size_t first_page, size_t num_pages, bool allocate) {
+  const size_t page_size   = os::vm_page_size();
+  const size_t chunk_bytes = REGION_SIZE_GB * ONE_GB;
+  HeapRegionManager* hrm   = G1CollectedHeap::heap()->hrm();
+
+  size_t page = first_page;
+  while (page < first_page + num_pages) {
+    char*  addr  = _base + page * page_size;
+    size_t unit  = pointer_delta(addr, _base, 1) / HeapRegion::GrainBytes;
+    size_t chunk = pointer_delta(addr, (char*)RDMA_DATA_SPACE_START_ADDR, 1) / chunk_bytes;
+    char*  unit_end = _base + (unit + 1) * HeapRegion::GrainBytes;
+    size_t n = MIN2(first_page + num_pages, pointer_delta(unit_end, _base, 1) / page_size) - page;
+
+    if (allocate) {
+      if (_unit_pages[unit] == 0) {
+        hrm->set_off_heap_reclaim_hint(addr, true);
+      }
+      if (_chunk_pages[chunk] == 0 &&
+          syscall(RDMA_EXPAND_CHUNKS, 0, (char*)RDMA_DATA_SPACE_START_ADDR + chunk * chunk_bytes, chunk_bytes) != 0) {
+        log_warning(semeru, alloc)("%s, expand the remote memory of the off-heap arena at 0x%lx failed.", __func__, (size_t)addr);
+      }
+      _unit_pages[unit]   += (uint32_t)n;
+      _chunk_pages[chunk] += n;
+    } else {
+      _unit_pages[unit]   -= (uint32_t)n;
+      _chunk_pages[chunk] -= n;
+      if (_unit_pages[unit] == 0) {
+        hrm->set_off_heap_reclaim_hint(addr, false);
+      }
+      char* chunk_start = (char*)RDMA_DATA_SPACE_START_ADDR + chunk * chunk_bytes;
+      if (_chunk_pages[chunk] == 0 && chunk_start >= _base &&
+          syscall(RDMA_RELEASE_CHUNKS, 0, chunk_start, chunk_bytes) != 0) {
+        log_warning(semeru, alloc)("%s, release the remote memory [0x%lx, 0x%lx) failed.", __func__,
+                                   (size_t)chunk_start, (size_t)(chunk_start + chunk_bytes));
+      }
+    }
+    page += n;
+  }
+}
+
+void* G1SemeruOffHeapArena::allocate(size_t bytes) {
+  assert(is_enabled(), "The off-heap arena is disabled");
+  const size_t page_size = os::vm_page_size();
+  size_t num_pages = align_up(bytes, page_size) / page_size;
+  if (num_pages == 0 || num_pages > _num_pages || num_pages > max_juint) {
+    return NULL;
+  }
+
+  MutexLockerEx x(_lock, Mutex::_no_safepoint_check_flag);
+  size_t page = find_pages(num_pages);
+  if (page == _num_pages) {
+    log_debug(semeru, alloc)("%s, the off-heap arena has no 0x%lx free pages, 0x%lx used.", __func__, num_pages, _used_pages);
+    return NULL;
+  }
+
+  char* addr = _base + page * page_size;
+  if (!os::commit_memory(addr, num_pages * page_size, false)) {
+    return NULL;
+  }
+  _used->set_range(page, page + num_pages);
+  _starts->set_bit(page);
+  _block_pages[page] = (uint32_t)num_pages;
+  _used_pages += num_pages;
+  _next_page = page + num_pages;
+  update_backing(page, num_pages, true);
+  return addr;
+}
+
+size_t G1SemeruOffHeapArena::block_size(const void* p) {
+  size_t page = pointer_delta(p, _base, 1) / os::vm_page_size();
+  MutexLockerEx x(_lock, Mutex::_no_safepoint_check_flag);
+  return (size_t)_block_pages[page] * os::vm_page_size();
+}
+
+void G1SemeruOffHeapArena::free(void* p) {
+  assert(contains(p), "0x%lx is out of the off-heap arena", (size_t)p);
+  const size_t page_size = os::vm_page_size();
+  size_t page = pointer_delta(p, _base, 1) / page_size;
+
+  MutexLockerEx x(_lock, Mutex::_no_safepoint_check_flag);
+  guarantee(is_aligned(p, page_size) && _starts->at(page),
+            "0x%lx isn't a block of the off-heap arena", (size_t)p);
+  size_t num_pages = _block_pages[page];
+
+  // The local pages and the swap entries of the block go away, nothing is written back.
+  os::uncommit_memory((char*)p, num_pages * page_size);
+  _used->clear_range(page, page + num_pages);
+  _starts->clear_bit(page);
+  _used_pages -= num_pages;
+  update_backing(page, num_pages, false);
+}
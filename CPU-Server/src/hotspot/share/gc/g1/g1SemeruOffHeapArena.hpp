@@ -0,0 +1,64 @@
+/**
+ * Semeru CPU Server - the off-heap arena backed by the memory servers, -XX:SemeruOffHeapArenaSize.
+ *
+ */
+
+#ifndef SHARE_VM_GC_G1_G1SEMERUOFFHEAPARENA_HPP
+#define SHARE_VM_GC_G1_G1SEMERUOFFHEAPARENA_HPP
+
+#include "memory/allocation.hpp"
+#include "runtime/globals.hpp"
+#include "utilities/globalDefinitions.hpp"
+
+class CHeapBitMap;
+
+/**
+ * Semeru CPU - The off-heap caches, the direct ByteBuffers and the Unsafe.allocateMemory blocks, are malloc-ed
+ * out of the Semeru data space. They stay in the local DRAM or go to the normal swap device.
+ *
+ * The arena is the end of the data space, above the heap, [end - SemeruOffHeapArenaSize, end).
+ * 1) Its pages are swapped in and out by the Semeru frontswap path, as the heap pages are.
+ *    The data chunks under it are backed by the memory servers while any block is in them,
+ *    RDMA_EXPAND_CHUNKS and RDMA_RELEASE_CHUNKS, as the committed heap Regions.
+ * 2) Unsafe.allocateMemory takes the blocks of at least SemeruOffHeapMinAllocation from it, whole pages,
+ *    committed at the allocation and uncommitted at the free. A full arena falls back to malloc.
+ * 3) With -XX:+SemeruReclaimHints, the kernel sees the Region-sized units of the arena holding a block
+ *    as SEMERU_RECLAIM_FIRST, swapped out before the young Regions, the others as not committed.
+ *
+ * The memory servers don't trace the arena, it holds no object. The blocks are first fit from the last one.
+ */
+class G1SemeruOffHeapArena : public AllStatic {
+  static char*         _base;         // NULL if disabled
+  static char*         _end;
+  static size_t        _num_pages;
+  static CHeapBitMap*  _used;         // one bit per page
+  static CHeapBitMap*  _starts;       // the first page of each block
+  static uint32_t*     _block_pages;  // the pages of a block, valid at its first page
+  static uint32_t*     _unit_pages;   // the used pages of each Region-sized unit
+  static size_t        _chunk_pages[RDMA_DATA_REGION_NUM];  // the used pages of each data chunk
+  static size_t        _next_page;    // where the next search starts
+  static size_t        _used_pages;
+  static Mutex*        _lock;
+
+  static size_t find_pages(size_t num_pages);
+  static void update_backing(size_t first_page, size_t num_pages, bool allocate);
+
+public:
+  // After the heap is reserved, before the reclaim hints are shared with the kernel.
+  static void initialize(HeapWord* heap_end);
+
+  static bool is_enabled() { return _base != NULL; }
+  static char* end()       { return _end; }
+
+  static bool contains(const void* p) { return (const char*)p >= _base && (const char*)p < _end; }
+  static bool should_allocate(size_t bytes) { return is_enabled() && bytes >= SemeruOffHeapMinAllocation; }
+
+  // NULL if the arena has no free pages for it.
+  static void* allocate(size_t bytes);
+  static void free(void* p);
+  static size_t block_size(const void* p);
+
+  static size_t used();
+};
+
+#endif // SHARE_VM_GC_G1_G1SEMERUOFFHEAPARENA_HPP
@@ -0,0 +1,71 @@
+/**
+ * Semeru CPU Server - the classes whose large objects are allocated in the old Regions, -XX:+SemeruPretenureLargeObjects.
+ *
+ */
+
+#include "precompiled.hpp"
+#include "gc/g1/g1SemeruPretenureProfile.hpp"
+#include "gc/shared/gc_globals.hpp"
+#include "memory/universe.hpp"
+#include "runtime/atomic.hpp"
+#include "runtime/safepoint.hpp"
+
+G1SemeruPretenureProfile::G1SemeruPretenureProfile() :
+  _min_words(SemeruPretenureMinBytes / HeapWordSize) {
+  clear();
+}
+
+G1SemeruPretenureProfile::Entry* G1SemeruPretenureProfile::find(const Klass* k) const {
+  uint index = hash(k);
+  for (uint i = 0; i < MaxProbes; i++) {
+    Entry* e = (Entry*)&_table[(index + i) & (TableSize - 1)];
+    Klass* cur = e->_klass;
+    if (cur == k) {
+      return e;
+    }
+    if (cur == NULL) {
+      return NULL;
+    }
+  }
+  return NULL;
+}
+
+void G1SemeruPretenureProfile::record_promotion(Klass* k, size_t word_sz) {
+  if (word_sz < _min_words) {
+    return;
+  }
+
+  uint index = hash(k);
+  for (uint i = 0; i < MaxProbes; i++) {
+    Entry* e = &_table[(index + i) & (TableSize - 1)];
+    Klass* cur = e->_klass;
+    if (cur == NULL) {
+      cur = Atomic::cmpxchg(k, &e->_klass, (Klass*)NULL);
+      if (cur == NULL) {
+        cur = k;
+      }
+    }
+    if (cur == k) {
+      if (e->_promotions < SemeruPretenurePromotions) {
+        Atomic::inc(&e->_promotions);
+      }
+      return;
+    }
+  }
+}
+
+bool G1SemeruPretenureProfile::should_pretenure(const Klass* k, size_t word_sz) const {
+  if (word_sz < _min_words) {
+    return false;
+  }
+  Entry* e = find(k);
+  return e != NULL && e->_promotions >= SemeruPretenurePromotions;
+}
+
+void G1SemeruPretenureProfile::clear() {
+  assert(SafepointSynchronize::is_at_safepoint() || !Universe::is_fully_initialized(), "only at a safepoint");
+  for (uint i = 0; i < TableSize; i++) {
+    _table[i]._klass = NULL;
+    _table[i]._promotions = 0;
+  }
+}
@@ -0,0 +1,54 @@
+/**
+ * Semeru CPU Server - the classes whose large objects are allocated in the old Regions, -XX:+SemeruPretenureLargeObjects.
+ *
+ */
+
+#ifndef SHARE_VM_GC_G1_G1SEMERUPRETENUREPROFILE_HPP
+#define SHARE_VM_GC_G1_G1SEMERUPRETENUREPROFILE_HPP
+
+#include "memory/allocation.hpp"
+
+class Klass;
+
+/**
+ * Semeru CPU - A large long-lived object is allocated in eden, copied to survivor and then to old,
+ * each copy faults its pages into the local DRAM, and the old copy is written back to the memory server later.
+ *
+ * The profile counts, by Klass, the large objects the young pauses promote into the old Regions.
+ * A Klass reaching SemeruPretenurePromotions has its large objects allocated in an old Region right away,
+ * see G1CollectedHeap::mem_allocate_pretenured(). The Klass is the allocation site here, the interpreter
+ * and the compiled code don't record the bci of an allocation.
+ *
+ * A fixed open-addressing table, the Klasses not fitting into it are never pretenured.
+ * Cleared when classes are unloaded, the Klass pointers can be stale after that.
+ */
+class G1SemeruPretenureProfile : public CHeapObj<mtGC> {
+  struct Entry {
+    Klass* volatile _klass;
+    volatile uint   _promotions;
+  };
+
+  static const uint TableSize = 1024;
+  static const uint MaxProbes = 8;
+
+  Entry  _table[TableSize];
+  size_t _min_words;
+
+  static uint hash(const Klass* k) { return (uint)(((uintptr_t)k >> LogBytesPerWord) & (TableSize - 1)); }
+
+  Entry* find(const Klass* k) const;
+
+public:
+  G1SemeruPretenureProfile();
+
+  // By the GC workers, a young object of word_sz is copied into an old Region.
+  void record_promotion(Klass* k, size_t word_sz);
+
+  // By the mutators, outside of the TLAB.
+  bool should_pretenure(const Klass* k, size_t word_sz) const;
+
+  // At a safepoint, after the class unloading.
+  void clear();
+};
+
+#endif // SHARE_VM_GC_G1_G1SEMERUPRETENUREPROFILE_HPP
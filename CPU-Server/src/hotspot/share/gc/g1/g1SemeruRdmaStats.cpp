@@ -0,0 +1,144 @@
+/**
+ * Semeru CPU Server - the RDMA operations of the control path, per GC phase and memory server.
+ *
+ */
+
+#include "precompiled.hpp"
+#include "gc/g1/g1SemeruRdmaStats.hpp"
+#include "memory/resourceArea.hpp"
+#include "runtime/atomic.hpp"
+#include "runtime/os.hpp"
+#include "runtime/perfData.hpp"
+#include "utilities/exceptions.hpp"
+
+volatile int                   G1SemeruRdmaStats::_phase = G1SemeruRdmaStats::Concurrent;
+bool                           G1SemeruRdmaStats::_in_pause = false;
+G1SemeruRdmaStats::Counters    G1SemeruRdmaStats::_pending[G1SemeruRdmaStats::NumPhases][MAX_NUM_OF_MEMORY_SERVER + 1];
+G1SemeruRdmaStats::Counters    G1SemeruRdmaStats::_last_pause[G1SemeruRdmaStats::NumPhases];
+PerfCounter*                   G1SemeruRdmaStats::_perf[G1SemeruRdmaStats::NumPhases][MAX_NUM_OF_MEMORY_SERVER + 1][3];
+
+enum { PerfOps, PerfBytes, PerfTicks };
+
+const char* G1SemeruRdmaStats::phase_name(Phase p) {
+  switch (p) {
+    case Concurrent:     return "concurrent";
+    case OpenWindow:     return "openWindow";
+    case WaitMemServer:  return "waitMemServer";
+    case SyncCompacted:  return "syncCompacted";
+    case ReadRegionInfo: return "readRegionInfo";
+    case SendKlass:      return "sendKlass";
+    case SendCSet:       return "sendCSet";
+    case CloseWindow:    return "closeWindow";
+    case OtherPause:     return "otherPause";
+    default:             ShouldNotReachHere(); return NULL;
+  }
+}
+
+static void create_counters(const char* ns, PerfCounter** counters, TRAPS) {
+  counters[PerfOps]   = PerfDataManager::create_counter(SUN_GC, PerfDataManager::counter_name(ns, "ops"),
+                                                        PerfData::U_Events, CHECK);
+  counters[PerfBytes] = PerfDataManager::create_counter(SUN_GC, PerfDataManager::counter_name(ns, "bytes"),
+                                                        PerfData::U_Bytes, CHECK);
+  counters[PerfTicks] = PerfDataManager::create_counter(SUN_GC, PerfDataManager::counter_name(ns, "time"),
+                                                        PerfData::U_Ticks, CHECK);
+}
+
+void G1SemeruRdmaStats::initialize() {
+  if (!UsePerfData) {
+    return;
+  }
+
+  EXCEPTION_MARK;
+  ResourceMark rm;
+  for (int p = 0; p < NumPhases; p++) {
+    const char* pns = PerfDataManager::name_space("semeru", phase_name((Phase)p));
+    create_counters(pns, _perf[p][AllServers], CHECK);
+    for (int mem_id = 0; mem_id < (int)SemeruMemServerNum; mem_id++) {
+      create_counters(PerfDataManager::name_space(pns, "server", mem_id), _perf[p][mem_id], CHECK);
+    }
+  }
+}
+
+void G1SemeruRdmaStats::add(int mem_server_id, jlong ops, jlong bytes, jlong ticks) {
+  Counters* c = &_pending[_phase][mem_server_id];
+  if (ops > 0) {
+    Atomic::add(ops, &c->_ops);
+  }
+  if (bytes > 0) {
+    Atomic::add(bytes, &c->_bytes);
+  }
+  Atomic::add(ticks, &c->_ticks);
+}
+
+void G1SemeruRdmaStats::record(int mem_server_id, size_t bytes, jlong start) {
+  jlong ticks = os::elapsed_counter() - start;
+  if (mem_server_id >= 0) {
+    add(mem_server_id, 1, (jlong)bytes, ticks);
+    return;
+  }
+
+  // Each memory server receives the whole range.
+  jlong share = ticks / (jlong)SemeruMemServerNum;
+  for (int mem_id = 0; mem_id < (int)SemeruMemServerNum; mem_id++) {
+    add(mem_id, 1, (jlong)bytes, share);
+  }
+}
+
+void G1SemeruRdmaStats::record_iovec(const semeru_rdma_iovec* iov, int nr_iov, jlong start) {
+  if (nr_iov <= 0) {
+    return;
+  }
+  jlong share = (os::elapsed_counter() - start) / nr_iov;
+  for (int i = 0; i < nr_iov; i++) {
+    add(iov[i].mem_server_id, 1, (jlong)iov[i].size, share);
+  }
+}
+
+void G1SemeruRdmaStats::record_wait(jlong start) {
+  add(AllServers, 0, 0, os::elapsed_counter() - start);
+}
+
+// Move the pending counts of p into the perf counters, and into the last pause.
+void G1SemeruRdmaStats::publish(Phase p, bool to_last_pause) {
+  for (int mem_id = 0; mem_id <= AllServers; mem_id++) {
+    Counters* c = &_pending[p][mem_id];
+    jlong ops   = Atomic::xchg((jlong)0, &c->_ops);
+    jlong bytes = Atomic::xchg((jlong)0, &c->_bytes);
+    jlong ticks = Atomic::xchg((jlong)0, &c->_ticks);
+
+    if (to_last_pause) {
+      _last_pause[p]._ops   += ops;
+      _last_pause[p]._bytes += bytes;
+      _last_pause[p]._ticks += ticks;
+    }
+    if (_perf[p][AllServers][PerfOps] != NULL) {
+      _perf[p][AllServers][PerfOps]->inc(ops);
+      _perf[p][AllServers][PerfBytes]->inc(bytes);
+      _perf[p][AllServers][PerfTicks]->inc(ticks);
+      if (mem_id < AllServers && _perf[p][mem_id][PerfOps] != NULL) {
+        _perf[p][mem_id][PerfOps]->inc(ops);
+        _perf[p][mem_id][PerfBytes]->inc(bytes);
+        _perf[p][mem_id][PerfTicks]->inc(ticks);
+      }
+    }
+  }
+}
+
+void G1SemeruRdmaStats::begin_pause() {
+  publish(Concurrent, false);
+  for (int p = 0; p < NumPhases; p++) {
+    _last_pause[p]._ops   = 0;
+    _last_pause[p]._bytes = 0;
+    _last_pause[p]._ticks = 0;
+  }
+  _in_pause = true;
+  _phase    = OtherPause;
+}
+
+void G1SemeruRdmaStats::end_pause() {
+  _in_pause = false;
+  _phase    = Concurrent;
+  for (int p = Concurrent + 1; p < NumPhases; p++) {
+    publish((Phase)p, true);
+  }
+}
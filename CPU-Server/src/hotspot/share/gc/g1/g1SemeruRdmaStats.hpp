@@ -0,0 +1,88 @@
+/**
+ * Semeru CPU Server - the RDMA operations of the control path, per GC phase and memory server.
+ *
+ */
+
+#ifndef SHARE_VM_GC_G1_G1SEMERURDMASTATS_HPP
+#define SHARE_VM_GC_G1_G1SEMERURDMASTATS_HPP
+
+#include "memory/allocation.hpp"
+#include "utilities/globalDefinitions.hpp"
+
+class PerfCounter;
+
+/**
+ * Semeru CPU - How many RDMA operations and bytes each phase of a pause moves, and how long they take.
+ *
+ * 1) The semeru_cp_* functions of runtime/rdma_cp_comm.hpp time each operation, either path,
+ *    the user space verbs or the kernel syscall, and add it to the current phase and its memory server.
+ *    A vectored operation counts one operation per entry, its time is split over the entries.
+ *    The waits of the async writes only add their time, to the phase.
+ * 2) The VM thread moves the current phase along the Semeru phases of G1GCPhaseTimes.
+ *    Out of the pauses, the operations of the concurrent threads go to Concurrent.
+ *    A thread not stopped by the safepoint, e.g. the G1SemeruCommThread, is counted into the pause phase.
+ * 3) The counts are published at each pause start and end, as sun.gc.semeru.<phase>.{ops,bytes,time}
+ *    and sun.gc.semeru.<phase>.server.<id>.{ops,bytes,time}. The time is in ticks, as the other sun.gc times.
+ *    The pause phases are also printed by -Xlog:gc+phases=trace under the Semeru Memory Servers phase.
+ *
+ * The data path, the swap-ins and swap-outs of the frontswap, isn't counted here.
+ */
+class G1SemeruRdmaStats : public AllStatic {
+public:
+  enum Phase {
+    Concurrent,
+    OpenWindow,
+    WaitMemServer,
+    SyncCompacted,
+    ReadRegionInfo,
+    SendKlass,
+    SendCSet,
+    CloseWindow,
+    OtherPause,
+    NumPhases
+  };
+
+  struct Counters {
+    volatile jlong _ops;
+    volatile jlong _bytes;
+    volatile jlong _ticks;
+  };
+
+private:
+  static const int AllServers = MAX_NUM_OF_MEMORY_SERVER;   // the column of the waits and the totals
+
+  static volatile int  _phase;
+  static bool          _in_pause;
+  // Not yet published, per phase and memory server.
+  static Counters      _pending[NumPhases][MAX_NUM_OF_MEMORY_SERVER + 1];
+  // Of the last pause, per phase.
+  static Counters      _last_pause[NumPhases];
+  // Per phase and memory server, then the phase total. NULL without UsePerfData.
+  static PerfCounter*  _perf[NumPhases][MAX_NUM_OF_MEMORY_SERVER + 1][3];
+
+  static void add(int mem_server_id, jlong ops, jlong bytes, jlong ticks);
+  static void publish(Phase p, bool to_last_pause);
+
+public:
+  static const char* phase_name(Phase p);
+
+  static void initialize();
+
+  // By the VM thread. The phases are only moved within the Semeru pauses.
+  static void begin_pause();
+  static void end_pause();
+  static void set_phase(Phase p) {
+    if (_in_pause) {
+      _phase = p;
+    }
+  }
+
+  // By any thread. start is the os::elapsed_counter() before the operation, mem_server_id -1 for all of them.
+  static void record(int mem_server_id, size_t bytes, jlong start);
+  static void record_iovec(const semeru_rdma_iovec* iov, int nr_iov, jlong start);
+  static void record_wait(jlong start);
+
+  static const Counters* last_pause(Phase p) { return &_last_pause[p]; }
+};
+
+#endif // SHARE_VM_GC_G1_G1SEMERURDMASTATS_HPP
@@ -0,0 +1,176 @@
+/**
+ * Semeru CPU Server - the copies and fills of the swapped out array ranges, done by their memory server, -XX:+SemeruRemoteArrayOps.
+ *
+ */
+
+#include "precompiled.hpp"
+#include "gc/g1/g1CollectedHeap.inline.hpp"
+#include "gc/g1/g1SemeruRemoteArrayOps.hpp"
+#include "gc/g1/heapRegion.inline.hpp"
+#include "logging/log.hpp"
+#include "runtime/mutexLocker.hpp"
+#include "runtime/os.hpp"
+#include "runtime/rdma_cp_comm.hpp"
+#include "utilities/align.hpp"
+
+#include <sys/mman.h>
+
+G1CollectedHeap* G1SemeruRemoteArrayOps::_g1h  = NULL;
+Mutex*           G1SemeruRemoteArrayOps::_lock = NULL;
+bool             G1SemeruRemoteArrayOps::_failed[MAX_NUM_OF_MEMORY_SERVER];
+
+void G1SemeruRemoteArrayOps::initialize(G1CollectedHeap* g1h) {
+  if (!SemeruRemoteArrayOps || !SemeruEnableMemPool || g1h->remote_array() == NULL) {
+    return;
+  }
+  for (size_t mem_id = 0; mem_id < MAX_NUM_OF_MEMORY_SERVER; mem_id++) {
+    _failed[mem_id] = false;
+  }
+  _lock = new Mutex(Mutex::leaf, "Semeru remote array op lock", true, Monitor::_safepoint_check_never);
+  _g1h  = g1h;
+  log_info(semeru, rdma)("%s, the array copies and fills of at least 0x%lx bytes go to the memory servers",
+                         __func__, SemeruRemoteArrayOpMinBytes);
+}
+
+/**
+ * The memory server of every Region under [start, end), -1 if they differ or one of them can't be sent,
+ * i.e. not old or humongous, or in the CSet of its memory server, which may be compacting it.
+ */
+int G1SemeruRemoteArrayOps::memory_server_of(const char* start, const char* end) {
+  received_memory_server_cset* cset = _g1h->recv_mem_server_cset();
+  int mem_id = -1;
+  for (const char* addr = start; addr < end; ) {
+    if (!_g1h->is_in_g1_reserved(addr)) {
+      return -1;
+    }
+    HeapRegion* hr = _g1h->heap_region_containing_or_null(addr);
+    if (hr == NULL || !(hr->is_old() || hr->is_humongous())) {
+      return -1;
+    }
+    int id = hr->region_to_memory_server_mapping();
+    if (id < 0 || (size_t)id >= SemeruMemServerNum || (mem_id >= 0 && id != mem_id)) {
+      return -1;
+    }
+    size_t num_mem_cset = *(cset->num_received_regions((size_t)id));
+    for (size_t i = 0; i < num_mem_cset; i++) {
+      if (cset->get((size_t)id, i) == hr->hrm_index()) {
+        return -1;
+      }
+    }
+    mem_id = id;
+    addr   = (const char*)hr->end();
+  }
+  return mem_id;
+}
+
+// Every page of [start, end) is swapped out, a resident one would be written back or read for nothing.
+bool G1SemeruRemoteArrayOps::is_swapped_out(const char* start, const char* end) {
+  char* first = align_down((char*)start, PAGE_SIZE);
+  size_t num_pages = pointer_delta(align_up((char*)end, PAGE_SIZE), first, 1) / PAGE_SIZE;
+  unsigned char* residency = NEW_C_HEAP_ARRAY(unsigned char, num_pages, mtGC);
+  bool swapped_out = mincore(first, num_pages * PAGE_SIZE, residency) == 0;
+  for (size_t i = 0; swapped_out && i < num_pages; i++) {
+    swapped_out = (residency[i] & 1) == 0;
+  }
+  FREE_C_HEAP_ARRAY(unsigned char, residency);
+  return swapped_out;
+}
+
+// Under _lock. The request fields, then the sequence on the same QP, then the reply is polled.
+bool G1SemeruRemoteArrayOps::request(int mem_id, remote_array_op::Op op, const char* src, char* dst, size_t bytes, int value) {
+  remote_array_op* rop = _g1h->remote_array();
+  uint32_t seq = rop->_request_seq + 1;
+  rop->_src   = (char*)src;
+  rop->_dst   = dst;
+  rop->_bytes = bytes;
+  rop->_op    = (uint32_t)op;
+  rop->_value = (uint32_t)(value & 0xff);
+  rop->_request_seq = seq;
+  if (semeru_cp_write(mem_id, (void*)rop, remote_array_op::request_size()) != 0 ||
+      semeru_cp_write(mem_id, (void*)&rop->_request_seq, sizeof(uint32_t)) != 0) {
+    log_warning(semeru,rdma)("%s, can't post the array op to memory server[%d].", __func__, mem_id);
+    _failed[mem_id] = true;
+    return false;
+  }
+  _g1h->ring_mem_server_doorbell((size_t)mem_id);
+
+  jlong deadline = os::javaTimeMillis() + (jlong)SemeruRemoteArrayOpTimeoutMs;
+  rop->_done_seq = seq - 1;   // the local copy may hold the reply of the previous memory server.
+  do {
+    if (semeru_cp_read(mem_id, (void*)&rop->_done_seq, remote_array_op::reply_size()) == 0 &&
+        rop->_done_seq == seq) {
+      return rop->_status == remote_array_op::Done;
+    }
+    os::naked_short_sleep(1);
+  } while (os::javaTimeMillis() < deadline);
+
+  // Cancelled, unless the memory server already took it. Either way the local copies are dropped below.
+  rop->_cancel_seq = seq;
+  semeru_cp_write(mem_id, (void*)&rop->_cancel_seq, sizeof(uint32_t));
+  log_warning(semeru,rdma)("%s, memory server[%d] didn't reply the array op in " UINTX_FORMAT " ms, it isn't asked again.",
+                           __func__, mem_id, SemeruRemoteArrayOpTimeoutMs);
+  _failed[mem_id] = true;
+  semeru_cp_invalidate(dst, bytes);
+  return false;
+}
+
+bool G1SemeruRemoteArrayOps::perform(remote_array_op::Op op, const char* src, char* dst, size_t bytes, int value) {
+  char* start = align_up(dst, PAGE_SIZE);
+  char* end   = align_down(dst + bytes, PAGE_SIZE);
+  if (end <= start) {
+    return false;
+  }
+  size_t head = pointer_delta(start, dst, 1);
+  size_t len  = pointer_delta(end, start, 1);
+  const char* src_start = (op == remote_array_op::Copy) ? src + head : NULL;
+
+  if (op == remote_array_op::Copy && src < dst + bytes && dst < src + bytes) {
+    return false;
+  }
+  int mem_id = memory_server_of(start, end);
+  if (mem_id < 0 || (op == remote_array_op::Copy && memory_server_of(src_start, src_start + len) != mem_id)) {
+    return false;
+  }
+
+  {
+    MutexLockerEx x(_lock, Mutex::_no_safepoint_check_flag);
+    if (_failed[mem_id] || !is_swapped_out(start, end) ||
+        (op == remote_array_op::Copy && !is_swapped_out(src_start, src_start + len))) {
+      return false;
+    }
+    if (!request(mem_id, op, src_start, start, len, value)) {
+      return false;
+    }
+
+    // The pages faulted in since the check hold the old content, they're rewritten.
+    int mapped = semeru_cp_invalidate(start, len);
+    if (mapped != 0) {
+      if (op == remote_array_op::Copy) {
+        memcpy(start, src_start, len);
+      } else {
+        memset(start, value, len);
+      }
+    }
+    log_debug(semeru,rdma)("%s, %s of 0x%lx bytes at 0x%lx by memory server[%d], %d pages rewritten locally", __func__,
+                           op == remote_array_op::Copy ? "copy" : "fill", len, (size_t)start, mem_id, mapped);
+  }
+
+  // The partial pages at both ends.
+  size_t tail = pointer_delta(dst + bytes, end, 1);
+  if (op == remote_array_op::Copy) {
+    memcpy(dst, src, head);
+    memcpy(end, src_start + len, tail);
+  } else {
+    memset(dst, value, head);
+    memset(end, value, tail);
+  }
+  return true;
+}
+
+bool G1SemeruRemoteArrayOps::copy(const void* src, void* dst, size_t bytes) {
+  return perform(remote_array_op::Copy, (const char*)src, (char*)dst, bytes, 0);
+}
+
+bool G1SemeruRemoteArrayOps::fill(void* dst, size_t bytes, int value) {
+  return perform(remote_array_op::Fill, NULL, (char*)dst, bytes, value);
+}
@@ -0,0 +1,53 @@
+/**
+ * Semeru CPU Server - the copies and fills of the swapped out array ranges, done by their memory server, -XX:+SemeruRemoteArrayOps.
+ *
+ */
+
+#ifndef SHARE_VM_GC_G1_G1SEMERUREMOTEARRAYOPS_HPP
+#define SHARE_VM_GC_G1_G1SEMERUREMOTEARRAYOPS_HPP
+
+#include "gc/shared/rdmaStructure.hpp"
+#include "memory/allocation.hpp"
+#include "runtime/globals.hpp"
+
+class G1CollectedHeap;
+class Mutex;
+
+/**
+ * Semeru CPU - A copy or a fill of a large primitive array range whose pages are all swapped out
+ * swaps in both ranges page by page, and pushes the hot pages out of the local cache, only to write
+ * the destination back to the memory server that held it.
+ *
+ * The memory server holding both ranges does it in its own memory instead, one request at a time
+ * through the remote_array_op at REMOTE_ARRAY_OP_OFFSET.
+ * 1) Only the whole destination pages are sent, the partial pages at both ends are done locally.
+ *    The ranges don't overlap, each page of them is swapped out, each Region under them is an old
+ *    or humongous Region of the same memory server, out of its CSet, none of them moves meanwhile.
+ * 2) The caller is a Java thread in the VM, no safepoint starts until the reply, at most
+ *    SemeruRemoteArrayOpTimeoutMs. Then the stale local copies of the destination are invalidated,
+ *    a page faulted in meanwhile is rewritten locally.
+ * 3) A memory server without a reply in time has its request cancelled, it isn't asked again.
+ *    The caller does the operation locally.
+ */
+class G1SemeruRemoteArrayOps : public AllStatic {
+  static G1CollectedHeap* _g1h;            // NULL if disabled
+  static Mutex*           _lock;           // one request in flight
+  static bool             _failed[MAX_NUM_OF_MEMORY_SERVER];
+
+  static int  memory_server_of(const char* start, const char* end);
+  static bool is_swapped_out(const char* start, const char* end);
+  static bool perform(remote_array_op::Op op, const char* src, char* dst, size_t bytes, int value);
+  static bool request(int mem_id, remote_array_op::Op op, const char* src, char* dst, size_t bytes, int value);
+
+public:
+  static void initialize(G1CollectedHeap* g1h);
+
+  static bool is_enabled() { return _g1h != NULL; }
+  static bool should_offload(size_t bytes) { return is_enabled() && bytes >= SemeruRemoteArrayOpMinBytes; }
+
+  // False if nothing is done, the caller copies or fills the range itself.
+  static bool copy(const void* src, void* dst, size_t bytes);
+  static bool fill(void* dst, size_t bytes, int value);
+};
+
+#endif // SHARE_VM_GC_G1_G1SEMERUREMOTEARRAYOPS_HPP
@@ -0,0 +1,91 @@
+/**
+ * Semeru CPU Server - send the target queues refined between the pauses to the memory servers.
+ *
+ */
+
+#include "precompiled.hpp"
+#include "gc/g1/g1CollectedHeap.inline.hpp"
+#include "gc/g1/g1SemeruTargetQueueThread.hpp"
+#include "gc/shared/suspendibleThreadSet.hpp"
+#include "logging/log.hpp"
+#include "runtime/atomic.hpp"
+#include "runtime/mutexLocker.hpp"
+#include "runtime/os.hpp"
+
+G1SemeruTargetQueueThread::G1SemeruTargetQueueThread() :
+  ConcurrentGCThread(),
+  _vtime_start(0.0),
+  _vtime_accum(0.0),
+  _active(false),
+  _monitor(NULL),
+  _num_unsent_regions(0)
+{
+  _monitor = new Monitor(Mutex::nonleaf, "Semeru target queue monitor", true,
+                         Monitor::_safepoint_check_never);
+
+  set_name("G1 Semeru Target Queue");
+  create_and_start();
+}
+
+void G1SemeruTargetQueueThread::note_unsent_region() {
+  if (Atomic::add(1u, &_num_unsent_regions) == SemeruTargetQueueRefineThreshold) {
+    activate();
+  }
+}
+
+void G1SemeruTargetQueueThread::wait_for_unsent_regions() {
+  MutexLockerEx x(_monitor, Mutex::_no_safepoint_check_flag);
+  if (!should_terminate() && !_active) {
+    _monitor->wait(Mutex::_no_safepoint_check_flag, G1ConcRefinementServiceIntervalMillis);
+  }
+}
+
+void G1SemeruTargetQueueThread::activate() {
+  MutexLockerEx x(_monitor, Mutex::_no_safepoint_check_flag);
+  _active = true;
+  _monitor->notify();
+}
+
+void G1SemeruTargetQueueThread::deactivate() {
+  MutexLockerEx x(_monitor, Mutex::_no_safepoint_check_flag);
+  _active = false;
+}
+
+void G1SemeruTargetQueueThread::run_service() {
+  _vtime_start = os::elapsedVTime();
+
+  while (!should_terminate()) {
+    // Wait for the threshold, or the service interval.
+    wait_for_unsent_regions();
+    if (should_terminate()) {
+      break;
+    }
+
+    // A Region flagged after the reset is sent by this round or counted for the next one.
+    Atomic::xchg(0u, &_num_unsent_regions);
+    deactivate();
+
+    uint sent;
+    {
+      SuspendibleThreadSetJoiner sts_join;
+      sent = G1CollectedHeap::heap()->send_concurrent_target_marks(&sts_join);
+    }
+
+    if (sent > 0) {
+      log_debug(semeru, rdma)("%s, sent the target queues of 0x%x refined Regions", __func__, sent);
+    }
+
+    if (os::supports_vtime()) {
+      _vtime_accum = (os::elapsedVTime() - _vtime_start);
+    } else {
+      _vtime_accum = 0.0;
+    }
+  }
+
+  log_debug(semeru, rdma)("%s, stopping", __func__);
+}
+
+void G1SemeruTargetQueueThread::stop_service() {
+  MutexLockerEx x(_monitor, Mutex::_no_safepoint_check_flag);
+  _monitor->notify();
+}
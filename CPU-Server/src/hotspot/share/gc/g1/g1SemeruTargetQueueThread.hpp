@@ -0,0 +1,50 @@
+/**
+ * Semeru CPU Server - send the target queues refined between the pauses to the memory servers.
+ *
+ */
+
+#ifndef SHARE_VM_GC_G1_G1SEMERUTARGETQUEUETHREAD_HPP
+#define SHARE_VM_GC_G1_G1SEMERUTARGETQUEUETHREAD_HPP
+
+#include "gc/shared/concurrentGCThread.hpp"
+
+/**
+ * Semeru CPU - The target queue refinement thread, -XX:+SemeruConcurrentTargetQueue.
+ *
+ * The concurrent refinement pushes the old targets of the cross-Region stores into the Regions' BitQueues,
+ * and flags the Regions whose queue got new marks. This thread sends the pages changed since the last send
+ * of the flagged Regions, modelled on G1ConcurrentRefineThread :
+ *
+ * 1) Activated by the refinement when SemeruTargetQueueRefineThreshold Regions are flagged,
+ *    or every G1ConcRefinementServiceIntervalMillis for the rest.
+ * 2) Joined to the suspendible thread set, it yields to the pauses between the Regions.
+ *
+ * The pause then only sends the residual delta of the memory server CSet, see G1CollectedHeap::evacuate_collection_set().
+ */
+class G1SemeruTargetQueueThread: public ConcurrentGCThread {
+  double _vtime_start;  // Initial virtual time.
+  double _vtime_accum;  // Accumulated virtual time.
+
+  bool _active;
+  Monitor* _monitor;
+
+  // Regions flagged since the last activation.
+  volatile uint _num_unsent_regions;
+
+  void wait_for_unsent_regions();
+  void deactivate();
+
+  void run_service();
+  void stop_service();
+public:
+  G1SemeruTargetQueueThread();
+
+  // The refinement flagged one more Region, activate the thread at the threshold.
+  void note_unsent_region();
+  void activate();
+
+  // Total virtual time so far.
+  double vtime_accum() { return _vtime_accum; }
+};
+
+#endif // SHARE_VM_GC_G1_G1SEMERUTARGETQUEUETHREAD_HPP
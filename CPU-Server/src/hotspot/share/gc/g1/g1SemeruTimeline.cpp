@@ -0,0 +1,287 @@
+/**
+ * Semeru CPU Server - the cross-server timeline of the pauses, -XX:+SemeruTimeline.
+ *
+ */
+
+#include "precompiled.hpp"
+#include "gc/g1/g1CollectedHeap.inline.hpp"
+#include "gc/g1/g1SemeruTimeline.hpp"
+#include "logging/log.hpp"
+#include "logging/logStream.hpp"
+#include "memory/resourceArea.hpp"
+#include "runtime/mutexLocker.hpp"
+#include "runtime/orderAccess.hpp"
+#include "runtime/os.hpp"
+#include "utilities/ostream.hpp"
+#include "utilities/quickSort.hpp"
+
+G1SemeruTimeline::Pause*    G1SemeruTimeline::_pauses      = NULL;
+size_t                      G1SemeruTimeline::_num_started = 0;
+G1SemeruTimeline::Pause*    G1SemeruTimeline::_current     = NULL;
+Mutex*                      G1SemeruTimeline::_lock        = NULL;
+G1SemeruTimeline::Doorbell  G1SemeruTimeline::_doorbells[MAX_NUM_OF_MEMORY_SERVER][G1SemeruTimeline::DoorbellHistory];
+G1SemeruTimeline::Estimate  G1SemeruTimeline::_estimates[MAX_NUM_OF_MEMORY_SERVER];
+
+void G1SemeruTimeline::initialize() {
+  _lock   = new Mutex(Mutex::nonleaf, "Semeru timeline lock", true, Monitor::_safepoint_check_never);
+  _pauses = NEW_C_HEAP_ARRAY(Pause, SemeruTimelinePauses, mtGC);
+  memset(_doorbells, 0, sizeof(_doorbells));
+  memset(_estimates, 0, sizeof(_estimates));
+}
+
+G1SemeruTimeline::Pause* G1SemeruTimeline::pause_at(size_t i) {
+  return &_pauses[i % SemeruTimelinePauses];
+}
+
+static const char* event_name(uint32_t type) {
+  switch (type) {
+    case SEMERU_TL_PAUSE_START:   return "pause start";
+    case SEMERU_TL_FLAGS_SENT:    return "window opened, flags sent";
+    case SEMERU_TL_CSET_SENT:     return "CSet sent to memory server";
+    case SEMERU_TL_WAIT_START:    return "wait for state";
+    case SEMERU_TL_WAIT_END:      return "state arrived";
+    case SEMERU_TL_WINDOW_CLOSED: return "window closed, flags sent";
+    case SEMERU_TL_PAUSE_END:     return "pause end";
+    case SEMERU_TL_DOORBELL_SEEN: return "doorbell arrived";
+    case SEMERU_TL_WINDOW_SEEN:   return "window seen";
+    case SEMERU_TL_COMMIT_START:  return "concurrent compaction commit start";
+    case SEMERU_TL_COMMIT_END:    return "concurrent compaction commit end";
+    case SEMERU_TL_STATE_PUSHED:  return "state pushed";
+    default:                      return "unknown";
+  }
+}
+
+void G1SemeruTimeline::doorbell(size_t mem_id, uint32_t seq) {
+  Doorbell* d = &_doorbells[mem_id][seq % DoorbellHistory];
+  d->_ns = os::javaTimeNanos();
+  OrderAccess::release_store(&d->_seq, seq);
+}
+
+// -1 if the doorbell is out of the history.
+jlong G1SemeruTimeline::doorbell_sent_at(uint mem_id, uint32_t seq) {
+  Doorbell* d = &_doorbells[mem_id][seq % DoorbellHistory];
+  jlong ns = d->_ns;
+  OrderAccess::loadload();
+  return OrderAccess::load_acquire(&d->_seq) == seq ? ns : -1;
+}
+
+void G1SemeruTimeline::record(uint32_t type, uint32_t arg) {
+  Pause* p = _current;
+  if (p == NULL) {
+    return;
+  }
+  uint i = Atomic::add(1u, &p->_num_events) - 1;
+  if (i < MaxEvents) {
+    p->_events[i]._ns   = os::javaTimeNanos();
+    p->_events[i]._type = type;
+    p->_events[i]._arg  = arg;
+  }
+}
+
+void G1SemeruTimeline::open_window(uint32_t window) {
+  if (_current != NULL) {
+    _current->_window = window;
+    record(SEMERU_TL_FLAGS_SENT, window);
+  }
+}
+
+/**
+ * Pair the doorbell opening the window with each state pushed back in it, keep the shortest round trip.
+ * The estimate of an earlier pause is kept while it's younger than EstimateAge and shorter.
+ */
+void G1SemeruTimeline::estimate_offset(Pause* p, uint mem_id) {
+  const semeru_timeline_event* ms_events = p->_ms_events[mem_id];
+  const uint num_ms   = p->_num_ms_events[mem_id];
+  const uint num_cpu  = MIN2((uint)p->_num_events, MaxEvents);
+  jlong t0 = -1;
+  jlong r  = 0;
+  jlong best_offset = 0;
+  jlong best_delay  = max_jlong;
+
+  for (uint i = 0; i < num_ms; i++) {
+    if (ms_events[i]._type == SEMERU_TL_DOORBELL_SEEN) {
+      t0 = doorbell_sent_at(mem_id, ms_events[i]._arg);
+      r  = ms_events[i]._ns;
+      break;
+    }
+  }
+
+  for (uint i = 0; t0 >= 0 && i < num_ms; i++) {
+    if (ms_events[i]._type != SEMERU_TL_STATE_PUSHED) {
+      continue;
+    }
+    const jlong s = ms_events[i]._ns;
+    for (uint j = 0; j < num_cpu; j++) {
+      const semeru_timeline_event* e = &p->_events[j];
+      if (e->_type != SEMERU_TL_WAIT_END || e->_arg != (mem_id << 8 | ms_events[i]._arg)) {
+        continue;
+      }
+      const jlong t1    = e->_ns;
+      const jlong delay = (t1 - t0) - (s - r);
+      if (t1 >= t0 && s >= r && delay >= 0 && delay < best_delay) {
+        best_delay  = delay;
+        best_offset = ((r - t0) + (s - t1)) / 2;
+      }
+      break;
+    }
+  }
+
+  Estimate* est = &_estimates[mem_id];
+  if (best_delay != max_jlong && (!est->_valid || best_delay <= est->_delay || est->_age >= EstimateAge)) {
+    est->_offset = best_offset;
+    est->_delay  = best_delay;
+    est->_age    = 0;
+    est->_valid  = true;
+  } else if (est->_valid) {
+    est->_age++;
+  }
+
+  if (est->_valid) {
+    p->_offset[mem_id] = est->_offset;
+    p->_error[mem_id]  = est->_delay / 2;
+  }
+}
+
+// Read the events the memory servers recorded in the window of p. With the _lock held.
+void G1SemeruTimeline::collect_mem_server_events(Pause* p) {
+  if (p->_collected) {
+    return;
+  }
+  p->_collected = true;
+
+  flags_of_mem_server_state* mem_flags = G1CollectedHeap::heap()->mem_server_flags();
+  size_t read_size = (char*)(mem_flags->_timeline_events + SEMERU_TIMELINE_MS_EVENTS) - (char*)&mem_flags->_timeline_window;
+
+  for (uint mem_id = 0; mem_id < SemeruMemServerNum; mem_id++) {
+    p->_num_ms_events[mem_id] = 0;
+    p->_error[mem_id]         = -1;
+    if (p->_window == 0) {
+      continue;   // the window wasn't opened
+    }
+    if (semeru_cp_read(mem_id, (void*)&mem_flags->_timeline_window, read_size) != 0) {
+      log_debug(semeru, timeline)("%s, read the timeline of memory server[%u] failed.", __func__, mem_id);
+      continue;
+    }
+    if (mem_flags->_timeline_window != p->_window) {
+      continue;   // the memory server didn't see the window
+    }
+
+    uint num = MIN2((uint)mem_flags->_num_timeline_events, (uint)SEMERU_TIMELINE_MS_EVENTS);
+    memcpy(p->_ms_events[mem_id], mem_flags->_timeline_events, num * sizeof(semeru_timeline_event));
+    p->_num_ms_events[mem_id] = num;
+    estimate_offset(p, mem_id);
+  }
+}
+
+void G1SemeruTimeline::begin_pause(size_t id) {
+  MutexLockerEx x(_lock, Mutex::_no_safepoint_check_flag);
+
+  if (_num_started > 0) {
+    Pause* last = pause_at(_num_started - 1);
+    collect_mem_server_events(last);
+
+    LogTarget(Info, semeru, timeline) lt;
+    if (lt.is_enabled()) {
+      LogStream ls(lt);
+      print_pause(last, &ls);
+    }
+  }
+
+  Pause* p = pause_at(_num_started);
+  memset(p, 0, sizeof(Pause));
+  p->_id = id;
+  _num_started++;
+  OrderAccess::release_store(&_current, p);
+  record(SEMERU_TL_PAUSE_START);
+}
+
+void G1SemeruTimeline::end_pause() {
+  record(SEMERU_TL_PAUSE_END);
+  MutexLockerEx x(_lock, Mutex::_no_safepoint_check_flag);
+  OrderAccess::release_store(&_current, (Pause*)NULL);
+}
+
+struct G1SemeruTimelineLine {
+  jlong                        _ns;       // on the clock of this server
+  int                          _server;   // -1 for this server
+  const semeru_timeline_event* _event;
+};
+
+static int compare_timeline_lines(G1SemeruTimelineLine* a, G1SemeruTimelineLine* b) {
+  if (a->_ns != b->_ns) {
+    return a->_ns < b->_ns ? -1 : 1;
+  }
+  return a->_server < b->_server ? -1 : (a->_server > b->_server ? 1 : 0);
+}
+
+void G1SemeruTimeline::print_pause(Pause* p, outputStream* st) {
+  ResourceMark rm;
+  const uint num_cpu = MIN2((uint)p->_num_events, MaxEvents);
+  G1SemeruTimelineLine* lines = NEW_RESOURCE_ARRAY(G1SemeruTimelineLine, MaxEvents + SemeruMemServerNum * SEMERU_TIMELINE_MS_EVENTS);
+  uint n = 0;
+
+  st->print_cr("Semeru timeline of pause %lu, window %u, on the clock of the CPU server:", p->_id, p->_window);
+  for (uint i = 0; i < num_cpu; i++) {
+    lines[n]._ns     = p->_events[i]._ns;
+    lines[n]._server = -1;
+    lines[n]._event  = &p->_events[i];
+    n++;
+  }
+  for (uint mem_id = 0; mem_id < SemeruMemServerNum; mem_id++) {
+    if (p->_num_ms_events[mem_id] == 0) {
+      continue;
+    }
+    if (p->_error[mem_id] < 0) {
+      st->print_cr("  memory server[%u], clock offset unknown, its %u events are left out", mem_id, p->_num_ms_events[mem_id]);
+      continue;
+    }
+    st->print_cr("  memory server[%u], clock offset %.3f ms +- %.3f ms", mem_id,
+                 (double)p->_offset[mem_id] / NANOSECS_PER_MILLISEC, (double)p->_error[mem_id] / NANOSECS_PER_MILLISEC);
+    for (uint i = 0; i < p->_num_ms_events[mem_id]; i++) {
+      lines[n]._ns     = p->_ms_events[mem_id][i]._ns - p->_offset[mem_id];
+      lines[n]._server = (int)mem_id;
+      lines[n]._event  = &p->_ms_events[mem_id][i];
+      n++;
+    }
+  }
+  if (n == 0) {
+    return;
+  }
+
+  QuickSort::sort(lines, n, compare_timeline_lines, false);
+  const jlong base = num_cpu > 0 ? p->_events[0]._ns : lines[0]._ns;
+  for (uint i = 0; i < n; i++) {
+    const semeru_timeline_event* e = lines[i]._event;
+    char who[16];
+    if (lines[i]._server < 0) {
+      jio_snprintf(who, sizeof(who), "cpu");
+    } else {
+      jio_snprintf(who, sizeof(who), "mem[%d]", lines[i]._server);
+    }
+    st->print_cr("  %10.3f ms  %-7s %s, 0x%x", (double)(lines[i]._ns - base) / NANOSECS_PER_MILLISEC, who,
+                 event_name(e->_type), e->_arg);
+  }
+}
+
+/**
+ * The kept pauses, the oldest first. The last pause is completed here if it's over,
+ * the memory servers are out of its window.
+ */
+void G1SemeruTimeline::print_on(outputStream* st) {
+  MutexLockerEx x(_lock, Mutex::_no_safepoint_check_flag);
+
+  size_t end = _num_started;
+  if (_current != NULL && end > 0) {
+    end--;    // in progress
+  }
+  size_t start = end > SemeruTimelinePauses ? end - SemeruTimelinePauses : 0;
+  if (start == end) {
+    st->print_cr("No Semeru pause recorded yet.");
+    return;
+  }
+  for (size_t i = start; i < end; i++) {
+    Pause* p = pause_at(i);
+    collect_mem_server_events(p);
+    print_pause(p, st);
+  }
+}
@@ -0,0 +1,96 @@
+/**
+ * Semeru CPU Server - the cross-server timeline of the pauses, -XX:+SemeruTimeline.
+ *
+ */
+
+#ifndef SHARE_VM_GC_G1_G1SEMERUTIMELINE_HPP
+#define SHARE_VM_GC_G1_G1SEMERUTIMELINE_HPP
+
+#include "gc/shared/rdmaStructure.hpp"
+#include "memory/allocation.hpp"
+#include "utilities/globalDefinitions.hpp"
+
+class outputStream;
+
+/**
+ * Semeru CPU - The phase events of the last SemeruTimelinePauses pauses, of this server and of the memory servers,
+ * merged on the clock of this server.
+ *
+ * 1) The VM thread records its events of a pause, SEMERU_TL_*, by os::javaTimeNanos().
+ *    Each memory server records its events of the STW window into its flags_of_mem_server_state, by its own clock.
+ *    They are read at the start of the next pause, before the next window is opened.
+ * 2) The clock offset of a memory server is estimated from the round trips of the window, NTP style.
+ *    The doorbell opening the window leaves here at t0 and arrives at r, a state is pushed back at s and seen here at t1.
+ *    offset = ((r - t0) + (s - t1)) / 2, within +- ((t1 - t0) - (s - r)) / 2.
+ *    A state pushed before the VM thread waits for it is seen late, the estimate of the shortest round trip
+ *    of the last EstimateAge pauses is kept.
+ * 3) A pause is logged by -Xlog:semeru+timeline once the events of its memory servers are read, at the next pause.
+ *    jcmd GC.semeru_timeline prints all the kept pauses.
+ *
+ * The kernel module records its transfers by the tracepoints of semeru_trace.h. Traced with the mono clock,
+ * e.g. perf -k mono, they are on the clock of this timeline.
+ */
+class G1SemeruTimeline : public AllStatic {
+public:
+  static const uint MaxEvents       = 64;   // of this server per pause
+  static const uint DoorbellHistory = 16;   // per memory server
+  static const uint EstimateAge     = 8;    // pauses
+
+private:
+  struct Pause {
+    size_t                _id;                // G1CollectedHeap::total_collections()
+    uint32_t              _window;            // the _state_seq of the STW window
+    volatile uint         _num_events;
+    semeru_timeline_event _events[MaxEvents];
+    uint                  _num_ms_events[MAX_NUM_OF_MEMORY_SERVER];
+    semeru_timeline_event _ms_events[MAX_NUM_OF_MEMORY_SERVER][SEMERU_TIMELINE_MS_EVENTS];
+    jlong                 _offset[MAX_NUM_OF_MEMORY_SERVER];   // the memory server's clock minus this one
+    jlong                 _error[MAX_NUM_OF_MEMORY_SERVER];    // -1 if the offset is unknown
+    bool                  _collected;                          // the events of the memory servers are read
+  };
+
+  struct Doorbell {
+    volatile uint32_t _seq;
+    volatile jlong    _ns;
+  };
+
+  struct Estimate {
+    jlong _offset;
+    jlong _delay;     // the round trip minus the time on the memory server
+    uint  _age;
+    bool  _valid;
+  };
+
+  static Pause*   _pauses;
+  static size_t   _num_started;     // the pause i is in _pauses[i % SemeruTimelinePauses]
+  static Pause*   _current;         // NULL between the pauses
+  static Mutex*   _lock;            // a slot is reused, or the kept pauses are printed
+
+  static Doorbell _doorbells[MAX_NUM_OF_MEMORY_SERVER][DoorbellHistory];
+  static Estimate _estimates[MAX_NUM_OF_MEMORY_SERVER];
+
+  static Pause* pause_at(size_t i);
+  static jlong  doorbell_sent_at(uint mem_id, uint32_t seq);
+  static void   collect_mem_server_events(Pause* p);
+  static void   estimate_offset(Pause* p, uint mem_id);
+  static void   print_pause(Pause* p, outputStream* st);
+
+public:
+  static void initialize();
+  static bool is_enabled() { return _pauses != NULL; }
+
+  // By the VM thread. begin_pause() also completes the last pause.
+  static void begin_pause(size_t id);
+  static void end_pause();
+  static void record(uint32_t type, uint32_t arg = 0);
+  // The flags of the window are sent, SEMERU_TL_FLAGS_SENT.
+  static void open_window(uint32_t window);
+
+  // By the threads ringing the doorbells, before the doorbell is posted.
+  static void doorbell(size_t mem_id, uint32_t seq);
+
+  // The completed pauses, the oldest first.
+  static void print_on(outputStream* st);
+};
+
+#endif // SHARE_VM_GC_G1_G1SEMERUTIMELINE_HPP
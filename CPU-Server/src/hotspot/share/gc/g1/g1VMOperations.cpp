@@ -130,7 +130,7 @@ void VM_G1CollectForAllocation::doit() {
   }
 
   // Try a partial collection of some kind.
-  if(SemeruEnableMemPool && UseCompressedOops==false){
+  if(SemeruEnableMemPool){
      _gc_succeeded = g1h->semeru_do_collection_pause_at_safepoint(_target_pause_time_ms);
   }else{
     _gc_succeeded = g1h->do_collection_pause_at_safepoint(_target_pause_time_ms);
@@ -226,3 +226,7 @@ void VM_G1Concurrent::doit_epilogue() {
   }
   Heap_lock->unlock();
 }
+
+void VM_G1SemeruHeapSnapshot::doit() {
+  _saved = G1CollectedHeap::heap()->save_heap_snapshot();
+}
@@ -33,6 +33,8 @@
 //   - VM_G1Concurrent
 //   - VM_G1CollectForAllocation
 //   - VM_G1CollectFull
+// VM_Operation:
+//   - VM_G1SemeruHeapSnapshot
 
 class VM_G1CollectFull : public VM_GC_Operation {
   bool _gc_succeeded;
@@ -85,4 +87,15 @@ public:
   virtual void doit_epilogue();
 };
 
+// Semeru CPU - -XX:SemeruHeapSnapshotFile, save the heap to the memory servers at the exit.
+class VM_G1SemeruHeapSnapshot : public VM_Operation {
+  bool _saved;
+
+public:
+  VM_G1SemeruHeapSnapshot() : _saved(false) { }
+  virtual VMOp_Type type() const { return VMOp_G1SemeruHeapSnapshot; }
+  virtual void doit();
+  bool saved() const { return _saved; }
+};
+
 #endif // SHARE_VM_GC_G1_G1VMOPERATIONS_HPP
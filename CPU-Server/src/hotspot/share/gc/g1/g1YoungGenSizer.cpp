@@ -30,16 +30,32 @@
 #include "logging/log.hpp"
 
 G1YoungGenSizer::G1YoungGenSizer() : _sizer_kind(SizerDefaults),
-  _adaptive_size(true), _min_desired_young_length(0), _max_desired_young_length(0) {
+  _adaptive_size(true), _cache_young_limit(0), _number_of_heap_regions(0), _last_on_demand_swapins(0),
+  _min_desired_young_length(0), _max_desired_young_length(0) {
 
   // Semeru CPU
+  // The local cache is bounded by the memory cgroup, unless the young gen is sized on the command line.
+  if (SemeruCgroupCacheLimit && !FLAG_IS_CMDLINE(SemeruLocalCachePercent) &&
+      !FLAG_IS_CMDLINE(NewSize) && !FLAG_IS_CMDLINE(MaxNewSize)) {
+    size_t percent = cgroup_cache_percent();
+    if (percent > 0) {
+      FLAG_SET_ERGO(size_t, SemeruLocalCachePercent, percent);
+    }
+  }
+
   // override the NewRatio
-  if(FLAG_IS_CMDLINE(SemeruLocalCachePercent)){
+  if(FLAG_IS_CMDLINE(SemeruLocalCachePercent) || FLAG_IS_ERGO(SemeruLocalCachePercent)){
 
     if (FLAG_IS_CMDLINE(NewSize) || FLAG_IS_CMDLINE(MaxNewSize)) {
       guarantee(false, "Do NOT set -XX:NewSize OR -XX:MaxNewSize and -XX:SemeruLocalCachePercent at the same time.");
     }
 
+    // Eden and survivors stay within the local cache, the pause time goal sizes the young gen below it.
+    if (SemeruCacheYoungSizing) {
+      _sizer_kind = SizerSemeruCache;
+      return;
+    }
+
     _sizer_kind = SizerNewRatio;
     _adaptive_size = false;
 
@@ -94,6 +110,28 @@ G1YoungGenSizer::G1YoungGenSizer() : _sizer_kind(SizerDefaults),
   }
 }
 
+/**
+ * Semeru CPU - The JVMs sharing a CPU server are bounded by their memory cgroups, not by a fixed percentage.
+ *  Take the part of the Java heap covered by the limit of our cgroup, the tightest of memory.high,
+ *  the soft limit and the hard limit, as reported by RDMA_CACHE_LIMIT.
+ *  With SemeruCgroupEvictPeriod, the kernel evicts the cold Regions of the data space near that limit,
+ *  before the cgroup throttles the mutators.
+ *
+ *  Return 0 if the cgroup has no limit.
+ */
+size_t G1YoungGenSizer::cgroup_cache_percent() {
+  int limit_mb = syscall(RDMA_CACHE_LIMIT, (int)SemeruCgroupEvictPeriod, (char*)RDMA_DATA_SPACE_START_ADDR, MaxHeapSize);
+  if (limit_mb <= 0) {
+    log_info(semeru, alloc)("%s, no memory cgroup limit (%d), the local cache isn't bounded.", __func__, limit_mb);
+    return 0;
+  }
+
+  size_t percent = MAX2(MIN2((size_t)limit_mb * M * 100 / MaxHeapSize, (size_t)100), (size_t)1);
+  log_info(semeru, alloc)("%s, memory cgroup limit %dMB, local cache " SIZE_FORMAT "%% of the heap, evicted every " UINTX_FORMAT "ms",
+                          __func__, limit_mb, percent, SemeruCgroupEvictPeriod);
+  return percent;
+}
+
 uint G1YoungGenSizer::calculate_default_min_length(uint new_number_of_heap_regions) {
   uint default_value = (new_number_of_heap_regions * G1NewSizePercent) / 100;
   return MAX2(1U, default_value);
@@ -104,6 +142,56 @@ uint G1YoungGenSizer::calculate_default_max_length(uint new_number_of_heap_regio
   return MAX2(1U, default_value);
 }
 
+uint G1YoungGenSizer::calculate_cache_regions(uint number_of_heap_regions) {
+  return MAX2(1U, (uint)(number_of_heap_regions * SemeruLocalCachePercent / 100));
+}
+
+// Start from half of the local cache, the other half keeps the hot old Regions.
+uint G1YoungGenSizer::calculate_cache_young_length(uint number_of_heap_regions) {
+  uint cache_regions = calculate_cache_regions(number_of_heap_regions);
+  uint limit = _cache_young_limit == 0 ? cache_regions / 2 : _cache_young_limit;
+  return MAX2(1U, MIN2(limit, cache_regions));
+}
+
+/**
+ * Semeru CPU - Feedback of a pause, for SizerSemeruCache.
+ *
+ * 1) Some young pages were swapped out, the young gen spilled to the memory server.
+ *    Shrink the limit to the young regions that were resident.
+ * 2) All resident, the young gen reached the limit and the mutators barely faulted since the last pause.
+ *    The local cache has room, grow the limit by one Region.
+ * The limit only bounds the max young length, the pause time goal picks the target below it.
+ */
+void G1YoungGenSizer::record_young_residency(uint young_length, size_t swapped_out_young_pages, size_t on_demand_swapins) {
+  if (_sizer_kind != SizerSemeruCache || _number_of_heap_regions == 0) {
+    return;
+  }
+
+  // The kernel counter is reset with the swap statistics.
+  size_t swapins = on_demand_swapins >= _last_on_demand_swapins ? on_demand_swapins - _last_on_demand_swapins : on_demand_swapins;
+  _last_on_demand_swapins = on_demand_swapins;
+
+  size_t region_pages = HeapRegion::GrainBytes / PAGE_SIZE;
+  uint cache_regions = calculate_cache_regions(_number_of_heap_regions);
+  uint limit = calculate_cache_young_length(_number_of_heap_regions);
+
+  if (swapped_out_young_pages > 0) {
+    uint spilled = (uint)((swapped_out_young_pages + region_pages - 1) / region_pages);
+    limit = MIN2(limit, young_length > spilled ? young_length - spilled : 1U);
+  } else if (swapins < region_pages && young_length >= limit) {
+    limit = MIN2(limit + 1, cache_regions);
+  }
+
+  if (limit != _cache_young_limit) {
+    log_debug(semeru, alloc)("%s, young limit %u -> %u Regions, cache 0x%x Regions, young 0x%x Regions, "
+                             "swapped out 0x%lx pages, on-demand swap-in 0x%lx pages", __func__,
+                             _cache_young_limit, limit, cache_regions, young_length, swapped_out_young_pages, swapins);
+  }
+  _cache_young_limit = limit;
+
+  recalculate_min_max_young_length(_number_of_heap_regions, &_min_desired_young_length, &_max_desired_young_length);
+}
+
 void G1YoungGenSizer::recalculate_min_max_young_length(uint number_of_heap_regions, uint* min_young_length, uint* max_young_length) {
   assert(number_of_heap_regions > 0, "Heap must be initialized");
 
@@ -127,6 +215,11 @@ void G1YoungGenSizer::recalculate_min_max_young_length(uint number_of_heap_regio
       *min_young_length = number_of_heap_regions / (NewRatio + 1);
       *max_young_length = *min_young_length;
       break;
+    case SizerSemeruCache:
+      *max_young_length = MIN2(calculate_default_max_length(number_of_heap_regions),
+                               calculate_cache_young_length(number_of_heap_regions));
+      *min_young_length = MIN2(calculate_default_min_length(number_of_heap_regions), *max_young_length);
+      break;
     default:
       ShouldNotReachHere();
   }
@@ -149,6 +242,7 @@ void G1YoungGenSizer::adjust_max_new_size(uint number_of_heap_regions) {
 }
 
 void G1YoungGenSizer::heap_size_changed(uint new_number_of_heap_regions) {
+  _number_of_heap_regions = new_number_of_heap_regions;
   recalculate_min_max_young_length(new_number_of_heap_regions, &_min_desired_young_length,
           &_max_desired_young_length);
 }
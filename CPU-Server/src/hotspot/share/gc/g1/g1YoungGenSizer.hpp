@@ -71,7 +71,8 @@ private:
     SizerNewSizeOnly,
     SizerMaxNewSizeOnly,
     SizerMaxAndNewSize,
-    SizerNewRatio
+    SizerNewRatio,
+    SizerSemeruCache
   };
   SizerKind _sizer_kind;
 
@@ -82,6 +83,15 @@ private:
   uint calculate_default_min_length(uint new_number_of_heap_regions);
   uint calculate_default_max_length(uint new_number_of_heap_regions);
 
+  // Semeru, SizerSemeruCache. The young length kept resident in the local cache, 0 before any young pause.
+  uint   _cache_young_limit;
+  uint   _number_of_heap_regions;
+  size_t _last_on_demand_swapins;
+
+  uint calculate_cache_regions(uint number_of_heap_regions);
+  static size_t cgroup_cache_percent();
+  uint calculate_cache_young_length(uint number_of_heap_regions);
+
   // Update the given values for minimum and maximum young gen length in regions
   // given the number of heap regions depending on the kind of sizing algorithm.
   void recalculate_min_max_young_length(uint number_of_heap_regions, uint* min_young_length, uint* max_young_length);
@@ -108,6 +118,10 @@ public:
     return _adaptive_size;
   }
 
+  // Semeru, the young regions of the last pause and their swapped out pages,
+  // and the kernel's on-demand swap-ins so far. Only used by SizerSemeruCache.
+  void record_young_residency(uint young_length, size_t swapped_out_young_pages, size_t on_demand_swapins);
+
   static G1YoungGenSizer* create_gen_sizer(G1CollectorPolicy* policy);
 };
 
@@ -35,6 +35,7 @@
 #include "gc/g1/heapRegionRemSet.hpp"
 #include "gc/g1/heapRegionTracer.hpp"
 #include "gc/shared/genOopClosures.inline.hpp"
+#include "gc/shared/rdmaChecksum.hpp"
 #include "gc/shared/space.inline.hpp"
 #include "logging/log.hpp"
 #include "logging/logStream.hpp"
@@ -43,8 +44,10 @@
 #include "oops/access.inline.hpp"
 #include "oops/compressedOops.inline.hpp"
 #include "oops/oop.inline.hpp"
+#include "runtime/rdma_cp_comm.hpp"
 #include "runtime/atomic.hpp"
 #include "runtime/orderAccess.hpp"
+#include "runtime/os.hpp"
 #include "utilities/growableArray.hpp"
 
 int    HeapRegion::LogOfHRGrainBytes = 0;
@@ -181,9 +184,22 @@ void HeapRegion::set_free() {
   _cpu_to_mem_gc->_type.set_free();
 }
 
+/**
+ * Semeru CPU - The young Regions are allocated and evacuated in the local memory, they are rarely swapped out.
+ * Back them by huge pages to cut the TLB misses of the allocation.
+ * The old and humongous Regions are swapped out page by page, a huge page would be split at its eviction anyway.
+ * A Region keeps the pages it got as young, until they are swapped out.
+ */
+void HeapRegion::advise_huge_pages(bool huge) {
+  if (SemeruYoungHugePages) {
+    os::semeru_advise_huge_pages((char*)bottom(), HeapRegion::GrainBytes, huge);
+  }
+}
+
 void HeapRegion::set_eden() {
   report_region_type_change(G1HeapRegionTraceType::Eden);
   _cpu_to_mem_gc->_type.set_eden();
+  advise_huge_pages(true);
 }
 
 void HeapRegion::set_eden_pre_gc() {
@@ -194,17 +210,20 @@ void HeapRegion::set_eden_pre_gc() {
 void HeapRegion::set_survivor() {
   report_region_type_change(G1HeapRegionTraceType::Survivor);
   _cpu_to_mem_gc->_type.set_survivor();
+  advise_huge_pages(true);
 }
 
 void HeapRegion::move_to_old() {
   if (_cpu_to_mem_gc->_type.relabel_as_old()) {
     report_region_type_change(G1HeapRegionTraceType::Old);
+    advise_huge_pages(false);
   }
 }
 
 void HeapRegion::set_old() {
   report_region_type_change(G1HeapRegionTraceType::Old);
   _cpu_to_mem_gc->_type.set_old();
+  advise_huge_pages(false);
 }
 
 void HeapRegion::set_open_archive() {
@@ -224,6 +243,7 @@ void HeapRegion::set_starts_humongous(HeapWord* obj_top, size_t fill_size) {
   report_region_type_change(G1HeapRegionTraceType::StartsHumongous);
   _cpu_to_mem_gc->_type.set_starts_humongous();
   _cpu_to_mem_gc->_humongous_start_region = this;
+  advise_huge_pages(false);
 
   _sync_mem_cpu->_bot_part.set_for_starts_humongous(obj_top, fill_size);
 }
@@ -236,6 +256,7 @@ void HeapRegion::set_continues_humongous(HeapRegion* first_hr) {
   report_region_type_change(G1HeapRegionTraceType::ContinuesHumongous);
   _cpu_to_mem_gc->_type.set_continues_humongous();
   _cpu_to_mem_gc->_humongous_start_region = first_hr;
+  advise_huge_pages(false);
 
  _sync_mem_cpu-> _bot_part.set_object_can_span(true);
 }
@@ -273,6 +294,10 @@ HeapRegion::HeapRegion(uint hrm_index,
   _cpu_to_mem_init = new(hrm_index) CPUToMemoryAtInit(hrm_index);
   _cpu_to_mem_gc = new(hrm_index) CPUToMemoryAtGC(hrm_index);
   _mem_to_cpu_gc = new(hrm_index) MemoryToCPUAtGC(hrm_index);
+  _synced_liveness_epoch = 0;
+  _synced_affinity_version = 0;
+  _flushed_top = NULL;
+  _target_marks_unsent = false;
   _sync_mem_cpu = new(hrm_index) SyncBetweenMemoryAndCPU(hrm_index, bot, this);
   _rem_set = new HeapRegionRemSet(bot, this);
 
@@ -297,6 +322,11 @@ void HeapRegion::initialize(MemRegion mr, bool clear_space, bool mangle_space) {
 }
 
 void HeapRegion::report_region_type_change(G1HeapRegionTraceType::Type to) {
+  G1CollectedHeap::heap()->hrm()->set_reclaim_hint(this, to);
+  G1CollectedHeap::heap()->hrm()->update_dram_pin(this, to);
+  if (to == G1HeapRegionTraceType::Free) {
+    G1CollectedHeap::heap()->clear_page_affinity(this);
+  }
   HeapRegionTracer::send_region_type_change(_cpu_to_mem_init->_hrm_index,
                                             get_trace_type(),
                                             to,
@@ -618,6 +648,7 @@ public:
 
         bool is_bad = !(from->is_young()
           || to->rem_set()->contains_reference(p)
+          || to->rem_set()->stashed_cards() > 0   // the cards on the memory server are not looked up
           || (_containing_obj->is_objArray() ?
                 cv_field == dirty :
                 cv_obj == dirty || cv_field == dirty));
@@ -915,21 +946,11 @@ void G1ContiguousSpace::initialize(MemRegion mr, bool clear_space, bool mangle_s
 
 /**
  * get the memory server id for the region.
- * 
- * !! Fix Me !! 
- * To support multiple memory servers.
+ * The region never crosses a RDMA data Region, REGION_SIZE_GB, so its bottom decides the memory server.
  * 
  */
 int HeapRegion::region_to_memory_server_mapping(){
-  int target_mem_id = -1;
-
-  if( (size_t)this->end() < (size_t)MEMORY_SERVER_1_START_ADDR ){
-    target_mem_id = 0;
-  }else{
-    target_mem_id = 1;
-  }
-
-  return target_mem_id;
+  return semeru_mem_server_of_addr(this->bottom());
 }
 
 
@@ -943,7 +964,7 @@ void HeapRegion::allocate_init_cross_region_ref_update_queue(uint hrm_index){
 
   // _sync_mem_cpu->_cross_region_ref_update_queue->initialize((size_t)hrm_index, bottom());
 	// log_debug(semeru,alloc)("%s,Region[0x%x] cross_region_ref_update_queue [0x%lx, 0x%lx) ", __func__, hrm_index, (size_t)_sync_mem_cpu->_cross_region_ref_update_queue, (size_t)CHeapRDMAObj<ElemPair, CROSS_REGION_REF_UPDATE_QUEUE_ALLOCTYPE>::_alloc_ptr );
-  _sync_mem_cpu->_cross_region_ref_target_queue = new (CROSS_REGION_REF_TARGET_Q_LEN, hrm_index) BitQueue(GrainWords);   // The instance should be allocated in RDMA Meta space.
+  _sync_mem_cpu->_cross_region_ref_target_queue = new (SemeruMetaLayout::cross_region_ref_target_q_len(), hrm_index) BitQueue(GrainWords);   // The instance should be allocated in RDMA Meta space.
   _sync_mem_cpu->_cross_region_ref_target_queue->initialize((size_t)hrm_index, bottom());
   log_debug(semeru,alloc)("%s,Region[0x%x] cross_region_ref_target_queue [0x%lx, 0x%lx) ", __func__, 
                                                                   hrm_index, 
@@ -1009,7 +1030,7 @@ void HeapRegion::object_iterate(ObjectClosure* blk) {
 
 
 //mhr: modify
-void HeapRegion::send_info_at_gc(){
+int HeapRegion::info_at_gc_iovec(semeru_rdma_iovec* iov){
   
   int target_mem_id;
 
@@ -1018,24 +1039,71 @@ void HeapRegion::send_info_at_gc(){
   // 1) Region basi information
   log_debug(semeru,rdma)("Write CPUToMemoryAtGC 0x%lx , class size 0x%lx to Memory Server[%d] ", 
                             (size_t)_cpu_to_mem_gc , (size_t)(sizeof(CPUToMemoryAtGC)), target_mem_id );
-  syscall(RDMA_WRITE, target_mem_id, _cpu_to_mem_gc, sizeof(CPUToMemoryAtGC));
+  iov[0].start_addr = (char*)_cpu_to_mem_gc;
+  iov[0].size       = sizeof(CPUToMemoryAtGC);
     
   // 2) Control the Memory server gc behavior. e.g. reset the  _cm_scanned to enable GC.
   log_debug(semeru,rdma)("Write MemoryToCPUAtGC 0x%lx , class size 0x%lx to Memory Server[%d] ", 
                             (size_t)_mem_to_cpu_gc , (size_t)(sizeof(MemoryToCPUAtGC)), target_mem_id );
-  syscall(RDMA_WRITE, target_mem_id, _mem_to_cpu_gc, sizeof(MemoryToCPUAtGC));
+  iov[1].start_addr = (char*)_mem_to_cpu_gc;
+  iov[1].size       = sizeof(MemoryToCPUAtGC);
   
   // 3) e.g. Region usage and allocation information
   log_debug(semeru,rdma)("Write SyncBetweenMemoryAndCPU 0x%lx , class size 0x%lx to Memory Server[%d]", 
                             (size_t)_sync_mem_cpu , (size_t)(sizeof(SyncBetweenMemoryAndCPU)), target_mem_id );
-  syscall(RDMA_WRITE, target_mem_id, _sync_mem_cpu, sizeof(SyncBetweenMemoryAndCPU));
+  iov[2].start_addr = (char*)_sync_mem_cpu;
+  iov[2].size       = sizeof(SyncBetweenMemoryAndCPU);
+
+  for(int i = 0; i < info_at_gc_iov_num - 1; i++){
+    iov[i].mem_server_id = target_mem_id;
+    iov[i].write_type    = 0;  // data
+  }
+
+  return info_at_gc_iov_num - 1 + bot_at_gc_iovec(iov + info_at_gc_iov_num - 1);
+}
+
+/**
+ * Semeru CPU - Mark the 3 structures of info_at_gc_iovec() dirty in their arenas.
+ *  They are sent with the other dirty Regions' by G1CollectedHeap::arena_runs_iovec(), the BOT is still per Region.
+ */
+void HeapRegion::mark_info_at_gc_dirty(){
+  CPUToMemoryAtGC::mark_dirty(_cpu_to_mem_gc);
+  MemoryToCPUAtGC::mark_dirty(_mem_to_cpu_gc);
+  SyncBetweenMemoryAndCPU::mark_dirty(_sync_mem_cpu);
+}
+
+int HeapRegion::bot_at_gc_iovec(semeru_rdma_iovec* iov){
+  int target_mem_id = region_to_memory_server_mapping();
 
     // Send the offset array of _sync_mem_cpu->_bot_part->_offset_array_part
-    // 1 byte for a card, 512 bytes
-  log_debug(semeru,rdma)("  Write SyncBetweenMemoryAndCPU->_bot_part->_offset_array_part 0x%lx, size 0x%lx \n", 
+    // 1 byte for a card, 512 bytes. Only the cards below top, the others are never read.
+  int nr_iov = 0;
+  size_t used_cards = top() > bottom() ? (pointer_delta(top() - 1, bottom()) >> BOTConstants::LogN_words) + 1 : 0;
+  log_debug(semeru,rdma)("  Write SyncBetweenMemoryAndCPU->_bot_part->_offset_array_part 0x%lx, size 0x%lx of 0x%lx \n", 
                                                                                     (size_t)_sync_mem_cpu->_bot_part.offset_array_part(), 
+                                                                                    used_cards,
                                                                                     _sync_mem_cpu->_bot_part.offset_array_part_length() );
-  syscall(RDMA_WRITE, target_mem_id, _sync_mem_cpu->_bot_part.offset_array_part(), _sync_mem_cpu->_bot_part.offset_array_part_length());
+  if(used_cards > 0){
+    iov[nr_iov].start_addr = (char*)_sync_mem_cpu->_bot_part.offset_array_part();
+    iov[nr_iov].size       = used_cards;
+    nr_iov++;
+  }
+
+  for(int i = 0; i < nr_iov; i++){
+    iov[i].mem_server_id = target_mem_id;
+    iov[i].write_type    = 0;  // data
+  }
+
+  return nr_iov;
+}
+
+//mhr: modify
+void HeapRegion::send_info_at_gc(){
+  semeru_rdma_iovec iov[info_at_gc_iov_num];
+  int nr_iov = info_at_gc_iovec(iov);
+
+  // All the structures are chained and posted by one syscall.
+  semeru_cp_writev(iov, nr_iov);
 	
 }
 
@@ -1045,16 +1113,84 @@ void HeapRegion::send_remset_at_gc(){
 	//mhr: TODO
 }
 //mhr: modify
-void HeapRegion::send_target_queue_at_gc(){
+/**
+ * Semeru CPU - Send the meta page of the BitQueue, and the bitmap pages claimed by BitQueue::claim_pages_to_send().
+ *  The other pages are unchanged on the memory server, or zero on both sides.
+ *  The contiguous pages are merged into one entry. After (target_queue_iov_num - 1) runs,
+ *  the last entry covers all the remaining pages to send.
+ */
+int HeapRegion::target_queue_iovec(semeru_rdma_iovec* iov, bool delta){
 
   int target_mem_id = region_to_memory_server_mapping();
+  BitQueue* tq = _sync_mem_cpu->_cross_region_ref_target_queue;
+  size_t num_pages = tq->num_pages();
+  size_t pages[BitQueue::SummaryWords];
+  size_t sent_bytes = 0;
+  int nr_iov = 0;
+
+  tq->claim_pages_to_send(pages, delta);
+
+  iov[nr_iov].start_addr = (char*)tq;
+  iov[nr_iov].size       = (char*)tq->_target_bitmap - (char*)tq;
+  sent_bytes += iov[nr_iov].size;
+  nr_iov++;
+
+  for(size_t p = 0; p < num_pages; ){
+    if(!BitQueue::is_page_in(pages, p)){
+      p++;
+      continue;
+    }
 
+    size_t run_end = p + 1;
+    if(nr_iov == target_queue_iov_num - 1){
+      run_end = num_pages;   // the last entry also covers the clean pages in between.
+      while(run_end > p + 1 && !BitQueue::is_page_in(pages, run_end - 1)){
+        run_end--;
+      }
+    }else{
+      while(run_end < num_pages && BitQueue::is_page_in(pages, run_end)){
+        run_end++;
+      }
+    }
 
-  BitQueue* tq = _sync_mem_cpu->_cross_region_ref_target_queue;
-	log_debug(semeru,rdma)("Write CrossRegionTargetQueue 0x%lx , size 0x%lx to Memory Server[%d]", 
-	 																  (size_t)_sync_mem_cpu->_cross_region_ref_target_queue , 
-                                    (size_t)(align_up(sizeof(BitQueue), PAGE_SIZE)+CROSS_REGION_REF_TARGET_Q_LEN*sizeof(size_t)),
-                                    target_mem_id );
+    iov[nr_iov].start_addr = (char*)tq->page_start(p);
+    iov[nr_iov].size       = ((char*)tq->page_start(run_end - 1) + tq->page_words(run_end - 1) * sizeof(size_t)) - (char*)tq->page_start(p);
+    sent_bytes += iov[nr_iov].size;
+    nr_iov++;
+    p = run_end;
+  }
+
+  for(int i = 0; i < nr_iov; i++){
+    iov[i].mem_server_id = target_mem_id;
+    iov[i].write_type    = 0;  // data
+  }
+
+	log_debug(semeru,rdma)("Write CrossRegionTargetQueue 0x%lx , 0x%lx of 0x%lx bytes by %d entries, 0x%x words, %s, to Memory Server[%d]", 
+	 																  (size_t)tq, sent_bytes,
+                                    (size_t)SemeruMetaLayout::cross_region_ref_target_q_commit_size(),
+                                    nr_iov, tq->_num_words, delta ? "delta" : "full", target_mem_id );
+
+  return nr_iov;
+}
+
+/**
+ * Semeru CPU - Clear the flag before the target queue is read.
+ *  A mark pushed after the clearing sets the flag again, it's sent next time if this send misses it.
+ */
+bool HeapRegion::claim_target_marks_unsent(){
+  if(!_target_marks_unsent){
+    return false;
+  }
+  _target_marks_unsent = false;
+  OrderAccess::fence();
+  return true;
+}
+
+//mhr: modify
+void HeapRegion::send_target_queue_at_gc(){
+
+  semeru_rdma_iovec iov[target_queue_iov_num];
+  int nr_iov = target_queue_iovec(iov);
   
   // log_debug(semeru,rdma)("CrossRegionTarQueue[0x%lx]  size: 0x%lx",tq->_region_index,  tq->_length );
 
@@ -1084,7 +1220,7 @@ void HeapRegion::send_target_queue_at_gc(){
 
 
 
-  syscall(RDMA_WRITE,target_mem_id, _sync_mem_cpu->_cross_region_ref_target_queue, align_up(sizeof(BitQueue), PAGE_SIZE)+CROSS_REGION_REF_TARGET_Q_LEN*sizeof(size_t));
+  semeru_cp_writev(iov, nr_iov);
 }
 
 
@@ -1121,12 +1257,183 @@ void HeapRegion::read_info_before_gc(){
   // #1 read _mem_to_cpu
 	log_debug(semeru,rdma)("Read MemoryToCPUAtGC 0x%lx , class size 0x%lx to Memory Server[%d]", 
                               (size_t)_mem_to_cpu_gc , (size_t)(sizeof(MemoryToCPUAtGC)), target_mem_id);
-  syscall(RDMA_READ, target_mem_id, _mem_to_cpu_gc, sizeof(MemoryToCPUAtGC));
+  semeru_rdma_iovec iov;
+  iov.mem_server_id = target_mem_id;
+  iov.write_type    = 0;  // data
+  iov.start_addr    = (char*)_mem_to_cpu_gc;
+  iov.size          = sizeof(MemoryToCPUAtGC);
+  read_mem_to_cpu_gc(&iov, 1);
 
 }
 
+/**
+ * Semeru CPU - A MemoryToCPUAtGC still torn after all the reads, none of its fields can be trusted.
+ *  The Region is taken as unscanned and fully alive, so that it's neither selected for the memory server
+ *  nor reclaimed by its liveness. The compaction deltas are dropped but all the local pages of the Region,
+ *  which may be rewritten, are dropped with them.
+ *  The versions are made even, so that the memory server can update it again after it's written back.
+ */
+static void reset_torn_mem_to_cpu_gc(MemoryToCPUAtGC* m){
+  m->_cm_scanned         = false;
+  m->_marked_alive_bytes = 0;
+  m->_alive_ratio        = 1.0;
+  m->_compacted_top      = NULL;
+  m->_bot_dirty_begin    = 0;
+  m->_bot_dirty_end      = 0;
+  m->_num_checksums      = 0;
+  m->_num_rewritten      = 1;
+  m->_rewritten[0][0]    = 0;
+  m->_rewritten[0][1]    = (uint32_t)(HeapRegion::GrainBytes / PAGE_SIZE);
+  m->_version            = (m->_version + 1) & ~(uint32_t)1;
+  m->_version_tail       = m->_version;
+}
+
+/**
+ * Semeru CPU - Read the MemoryToCPUAtGC of iov[0, nr_iov) by one vectored RDMA read.
+ *  The memory server doesn't stop updating them for the read, a record caught in the middle of an update
+ *  is read again by itself, see MemoryToCPUAtGC::is_stable(). The first half of the SemeruTornReadRetries
+ *  reads spin, the others yield to let the memory server finish its update.
+ *  A record still torn after them is reset to an unscanned Region, see reset_torn_mem_to_cpu_gc().
+ *  If stable isn't NULL, stable[i] tells whether iov[i] was read consistently.
+ *  Return the number of torn records.
+ */
+int HeapRegion::read_mem_to_cpu_gc(semeru_rdma_iovec* iov, int nr_iov, bool* stable){
+  guarantee(semeru_cp_readv(iov, nr_iov) == 0, "%s, RDMA vectored read of %d entries failed.", __func__, nr_iov);
+  OrderAccess::loadload();
+
+  int num_torn = 0;
+  for(int i = 0; i < nr_iov; i++){
+    MemoryToCPUAtGC* m = (MemoryToCPUAtGC*)iov[i].start_addr;
+    uint retries = 0;
+    while(!MemoryToCPUAtGC::is_stable(m) && retries < SemeruTornReadRetries){
+      if(retries < SemeruTornReadRetries / 2){
+        SpinPause();
+      }else{
+        os::naked_yield();
+      }
+      semeru_cp_read(iov[i].mem_server_id, (char*)m, sizeof(MemoryToCPUAtGC));
+      OrderAccess::loadload();
+      retries++;
+    }
+
+    bool is_stable = MemoryToCPUAtGC::is_stable(m);
+    if(!is_stable){
+      log_warning(semeru,rdma)("%s, MemoryToCPUAtGC 0x%lx of memory server[%d] still torn after %u reads, version 0x%x/0x%x, "
+                               "taken as unscanned", __func__, (size_t)m, iov[i].mem_server_id, retries, m->_version, m->_version_tail);
+      reset_torn_mem_to_cpu_gc(m);
+      num_torn++;
+    }
+    if(stable != NULL){
+      stable[i] = is_stable;
+    }
+  }
+  return num_torn;
+}
 
 
+
+/**
+ * Semeru CPU - The BOT entries of the Region were sent to the memory server before its compaction.
+ *  Only the cards it rebuilt are read back, the others are the same on both sides.
+ */
+int HeapRegion::bot_update_iovec(semeru_rdma_iovec* iov){
+  size_t begin = _mem_to_cpu_gc->_bot_dirty_begin;
+  size_t end   = MIN2(_mem_to_cpu_gc->_bot_dirty_end, _sync_mem_cpu->_bot_part.offset_array_part_length());
+  if(_mem_to_cpu_gc->_compacted_top == NULL || end <= begin){
+    return 0;
+  }
+
+  iov[0].mem_server_id = region_to_memory_server_mapping();
+  iov[0].write_type    = 0;  // data
+  iov[0].start_addr    = (char*)_sync_mem_cpu->_bot_part.offset_array_part() + begin;
+  iov[0].size          = end - begin;
+
+  log_debug(semeru,rdma)("Read BOT cards [0x%lx, 0x%lx) of Region[%u] from Memory Server[%d]",
+                         begin, end, hrm_index(), iov[0].mem_server_id);
+  return 1;
+}
+
+void HeapRegion::apply_bot_update(){
+  HeapWord* new_top = _mem_to_cpu_gc->_compacted_top;
+  if(new_top == NULL){
+    return;
+  }
+
+  set_top(new_top);
+  _sync_mem_cpu->_bot_part.set_threshold_at(new_top);
+
+  // Sent back with the MemoryToCPUAtGC, the memory server sees the range is pulled.
+  _mem_to_cpu_gc->_compacted_top   = NULL;
+  _mem_to_cpu_gc->_bot_dirty_begin = 0;
+  _mem_to_cpu_gc->_bot_dirty_end   = 0;
+}
+
+
+bool HeapRegion::verify_compaction_checksums(){
+  MemoryToCPUAtGC* m = _mem_to_cpu_gc;
+  size_t used = pointer_delta(top(), bottom(), 1);
+  uint num = MIN2(m->_num_checksums, (uint32_t)SEMERU_MAX_CHECKSUM_SAMPLES);
+
+  for(uint i = 0; i < num; i++){
+    size_t offset = (size_t)m->_checksum_pages[i] * PAGE_SIZE;
+    if(offset >= used){
+      log_error(semeru,rdma)("%s, Region[%u] sampled page 0x%x is above the top 0x%lx", __func__,
+                             hrm_index(), m->_checksum_pages[i], (size_t)top());
+      return false;
+    }
+
+    juint crc = SemeruCRC32C::compute((char*)bottom() + offset, MIN2((size_t)PAGE_SIZE, used - offset));
+    if(crc != m->_checksums[i]){
+      log_error(semeru,rdma)("%s, Region[%u] page 0x%x at 0x%lx, CRC32C 0x%x, the memory server computed 0x%x", __func__,
+                             hrm_index(), m->_checksum_pages[i], (size_t)bottom() + offset, crc, m->_checksums[i]);
+      return false;
+    }
+  }
+
+  m->_num_checksums = 0;
+  log_trace(semeru,rdma)("%s, Region[%u] 0x%x sampled pages verified", __func__, hrm_index(), num);
+  return true;
+}
+
+size_t HeapRegion::invalidate_rewritten_pages(){
+  MemoryToCPUAtGC* m = _mem_to_cpu_gc;
+  uint num = MIN2(m->_num_rewritten, (uint32_t)SEMERU_MAX_REWRITTEN_RANGES);
+  size_t region_pages = HeapRegion::GrainBytes / PAGE_SIZE;
+  size_t num_pages = 0;
+  size_t num_left  = 0;
+
+  for(uint i = 0; i < num; i++){
+    size_t begin = m->_rewritten[i][0];
+    size_t end   = MIN2((size_t)m->_rewritten[i][1], region_pages);
+    if(begin >= end){
+      continue;
+    }
+
+    int left = semeru_cp_invalidate((char*)bottom() + begin * PAGE_SIZE, (end - begin) * PAGE_SIZE);
+    guarantee(left >= 0, "%s, Region[%u] invalidate pages [0x%lx, 0x%lx) failed.", __func__, hrm_index(), begin, end);
+    num_pages += end - begin;
+    num_left  += left;
+  }
+
+  // Sent back with the MemoryToCPUAtGC, the memory server sees the ranges are consumed.
+  m->_num_rewritten = 0;
+  log_trace(semeru,rdma)("%s, Region[%u] 0x%lx rewritten pages in %u ranges, 0x%lx left mapped", __func__,
+                         hrm_index(), num_pages, num, num_left);
+  return num_left;
+}
+
+
+int HeapRegion::data_iovec(semeru_rdma_iovec* iov){
+  iov[0].mem_server_id = region_to_memory_server_mapping();
+  iov[0].write_type    = 0;  // data
+  iov[0].start_addr    = (char*)bottom();
+  iov[0].size          = GrainBytes;
+
+  log_debug(semeru,rdma)("Write Region[%u] , addr 0x%lx, sent size 0x%lx to Memory Server[%d]",
+                         hrm_index(), (size_t)bottom(), (size_t)GrainBytes, iov[0].mem_server_id);
+  return 1;
+}
+
 //mhr: modify
 // [?] Each Region can only be flushed by one thread, 
 // Should be flushed by gc threads ? Mutators must be suspended ?
@@ -1141,7 +1448,7 @@ void HeapRegion::flush_data(){
   //check_sync_between_memory_and_cpu("Check Region before sent");
   // [?]Run Control Path with Data Path together can cause CPU server crash.
   //    And multiple QP can lead to a much higher posibility ??
-  ret = syscall(RDMA_WRITE, target_mem_id, bottom(), GrainBytes);  
+  ret = semeru_cp_write(target_mem_id, bottom(), GrainBytes);  
   if(ret){
     tty->print("%s, RDMA write for region[%u] to memory server[%d] failed. Crash here. \n", __func__, this->hrm_index(),target_mem_id);
     guarantee(false," RDMA write failed." );
@@ -1155,6 +1462,25 @@ void HeapRegion::flush_data(){
 
 
 
+/**
+ * Semeru CPU - The memory server keeps the liveness of a Region whose write epoch, write check version
+ *  and root bitmap are unchanged, -XX:+SemeruIncrementalTracing on the memory server.
+ *  1) The top moved, e.g. allocated or promoted into.
+ *  2) Some pages are resident here, they can be written without any swap-out.
+ *     The writes to the evicted pages reach the memory server by the data path, which bumps the write check version.
+ */
+void HeapRegion::update_write_epoch(){
+  address committed_start;
+  size_t  committed_size;
+
+  if(!is_old() || top() != _flushed_top ||
+     os::committed_in_range((address)bottom(), GrainBytes, committed_start, committed_size)){
+    _cpu_to_mem_gc->_write_epoch++;
+  }
+  _flushed_top = top();
+
+  log_debug(semeru,rdma)("%s, Region[%u] write epoch 0x%x", __func__, hrm_index(), _cpu_to_mem_gc->_write_epoch);
+}
 
 /**
  * Just print, not pop any items. 
@@ -143,6 +143,10 @@ public:
   // [x] Only allocate && initialize this queue in Semeru heap.
   //TargetObjQueue* _target_obj_queue;
 
+  // Bumped by the CPU server when it may have written the Region since the last flush.
+  // The writes to the evicted pages are covered by the write check tags.
+  uint32_t _write_epoch;
+
 
   // functions
 
@@ -150,7 +154,8 @@ public:
    _type(),
    _humongous_start_region(NULL),
    _next(NULL),
-   _prev(NULL)
+   _prev(NULL),
+   _write_epoch(0)
    { }
 
 
@@ -167,22 +172,64 @@ public:
 class MemoryToCPUAtGC : public CHeapRDMAObj< MemoryToCPUAtGC, MEM_TO_CPU_AT_GC_ALLOCTYPE>{
 
 public:
+  // Seqlock of the memory server updates, the first and the last field. An update makes _version odd,
+  // writes the fields, then sets _version_tail and _version to the next even value.
+  // A record read by RDMA is only taken if both are the same and even, see is_stable().
+  volatile uint32_t _version;
+
   // this field identify this Region is already traced by the concurrent threads.
   // This value is setted by Semeru memory srver BUT also accessed by the CPU server.
   bool _cm_scanned;    
 
   size_t        _marked_alive_bytes;  // Marked alive objects. [ Abandoned ? ]
   double        _alive_ratio;         // Used to decide GC or not.
+
+  // The memory server compaction rewrote the BOT cards [_bot_dirty_begin, _bot_dirty_end) and the top.
+  // Cleared after they are pulled, see HeapRegion::bot_update_iovec().
+  HeapWord*     _compacted_top;
+  size_t        _bot_dirty_begin;
+  size_t        _bot_dirty_end;
+
+  // The CRC32C of the sampled pages of [bottom, _compacted_top), PAGE_SIZE each, the last one up to the top.
+  // Verified by the CPU server with the BOT, see HeapRegion::verify_compaction_checksums().
+  uint32_t      _num_checksums;
+  uint32_t      _checksum_pages[SEMERU_MAX_CHECKSUM_SAMPLES];
+  uint32_t      _checksums[SEMERU_MAX_CHECKSUM_SAMPLES];
+
+  // The page ranges [begin, end) of the Region, from its bottom, the memory server compaction rewrote.
+  // Only their local copies are dropped, see HeapRegion::invalidate_rewritten_pages().
+  uint32_t      _num_rewritten;
+  uint32_t      _rewritten[SEMERU_MAX_REWRITTEN_RANGES][2];
+
+  // Bumped each time the memory server rewrites the page affinity of this Region, see page_affinity_table.
+  uint32_t      _affinity_version;
+
+  volatile uint32_t _version_tail;
+
   //
   // functions
   //
   MemoryToCPUAtGC(uint hrm_index):
+    _version(0),
     _cm_scanned(false),
     _marked_alive_bytes(0),
-    _alive_ratio(0.0)
+    _alive_ratio(0.0),
+    _compacted_top(NULL),
+    _bot_dirty_begin(0),
+    _bot_dirty_end(0),
+    _num_checksums(0),
+    _num_rewritten(0),
+    _affinity_version(0),
+    _version_tail(0)
   {
 
   }
+
+  // The record isn't being rewritten by the memory server, and wasn't while it was read.
+  static inline bool is_stable(const MemoryToCPUAtGC* m) {
+    uint32_t v = m->_version;
+    return (v & 1) == 0 && v == m->_version_tail;
+  }
 };
 
 
@@ -378,6 +425,20 @@ public:
   MemoryToCPUAtGC     *_mem_to_cpu_gc;
   SyncBetweenMemoryAndCPU   *_sync_mem_cpu;
 
+  // The memory server's liveness epoch of this Region, when _mem_to_cpu_gc was read last time.
+  // The entry version of the liveness vector instead, -XX:+SemeruLivenessVector.
+  uint32_t            _synced_liveness_epoch;
+
+  // The _affinity_version of _mem_to_cpu_gc, when the page affinity of this Region was read last time.
+  uint32_t            _synced_affinity_version;
+
+  // The top of this Region at its last flush, see update_write_epoch().
+  HeapWord*           _flushed_top;
+
+  // The concurrent refinement added marks to the target queue after its last send,
+  // see G1CollectedHeap::send_concurrent_target_marks().
+  volatile bool       _target_marks_unsent;
+
 
   //
   // End of RDMA related structure 
@@ -727,6 +788,10 @@ public:
   // all fields related to the next marking info.
   inline void note_start_of_marking();
 
+  // Semeru CPU - The concurrent mark leaves the Region to its memory server, -XX:+SemeruRemoteConcurrentMark.
+  // Every object of it is taken as live, as if allocated since the start of the marking.
+  inline void note_start_of_remote_marking();
+
   // Notify the region that concurrent marking has finished. Copy the
   // (now finalized) next marking info fields into the prev marking
   // info fields.
@@ -742,8 +807,8 @@ public:
   void note_self_forwarding_removal_end(size_t marked_bytes);
 
   void reset_during_compaction() {
-    assert(is_humongous(),
-           "should only be called for humongous regions");
+    assert(is_humongous() || is_old(),
+           "should only be called for humongous regions, or old Regions kept by -XX:+SemeruRemoteFullGC");
 
     zero_marked_bytes();
     init_top_at_mark_start();
@@ -824,6 +889,9 @@ public:
 
   void set_free();
 
+  // Semeru CPU - THP for the young Regions, -XX:+SemeruYoungHugePages.
+  void advise_huge_pages(bool huge);
+
   void set_eden();
   void set_eden_pre_gc();
   void set_survivor();
@@ -911,6 +979,10 @@ public:
     return _sync_mem_cpu->_cross_region_ref_target_queue;
   }
 
+  // If the references into this Region are recorded in its target queue, the roots of the memory server tracing.
+  // A humongous object is only referenced by its start, -XX:+SemeruRemoteHumongous records it in the starts humongous Region.
+  inline bool records_target_marks() const;
+
 
   void set_region_cm_scanned()    { _mem_to_cpu_gc->_cm_scanned = true;  }
   void reset_region_cm_scanned()  { _mem_to_cpu_gc->_cm_scanned = false;  _mem_to_cpu_gc->_alive_ratio=0; _mem_to_cpu_gc->_marked_alive_bytes=0;}
@@ -1000,6 +1072,8 @@ public:
 
   HeapWord* block_start(const void* p);
   HeapWord* block_start_const(const void* p) const;
+  // A block start at or before p, from the BOT alone. Nothing of the heap is read.
+  inline HeapWord* block_at_or_preceding(const void* p) const;
 
   void reset_bot() {
     _sync_mem_cpu->_bot_part.reset_bot();
@@ -1023,9 +1097,39 @@ public:
   void send_info_at_gc();
   void send_remset_at_gc();
   void send_target_queue_at_gc();
+
+  // Fill the entries of send_info_at_gc()/send_target_queue_at_gc() into iov,
+  // return the number of filled entries.
+  static const int info_at_gc_iov_num = 4;
+  static const int target_queue_iov_num = 16;   // at most, see target_queue_iovec()
+  int info_at_gc_iovec(semeru_rdma_iovec* iov);
+  // The batched version of info_at_gc_iovec(), the structures are sent by their arena runs.
+  void mark_info_at_gc_dirty();
+  int bot_at_gc_iovec(semeru_rdma_iovec* iov);
+  // delta, only the pages changed since the last send, see BitQueue::claim_pages_to_send().
+  int target_queue_iovec(semeru_rdma_iovec* iov, bool delta = false);
+  // The whole Region, the same write as flush_data(), one entry.
+  int data_iovec(semeru_rdma_iovec* iov);
   void flush_data();
+  // Bump _cpu_to_mem_gc->_write_epoch before the flush, if the Region may have been written since the last one.
+  void update_write_epoch();
+  // -XX:+SemeruConcurrentTargetQueue, the target queue has marks to send between the pauses.
+  // Return true if the flag is set by this call.
+  bool set_target_marks_unsent()    { return !_target_marks_unsent && Atomic::cmpxchg(true, &_target_marks_unsent, false) == false; }
+  bool claim_target_marks_unsent();
   void read_info_at_gc();
   void read_info_before_gc();
+  static int read_mem_to_cpu_gc(semeru_rdma_iovec* iov, int nr_iov, bool* stable = NULL);
+  // The BOT cards rewritten by the memory server compaction, recorded in the MemoryToCPUAtGC read last.
+  // Return the number of filled entries, 0 or 1. apply_bot_update() after the read, to adopt the compacted top.
+  int bot_update_iovec(semeru_rdma_iovec* iov);
+  void apply_bot_update();
+  // -XX:SemeruChecksumSamplePercent, after apply_bot_update(). False if a sampled page differs from
+  // the memory server's checksum, the sampled pages are swapped in.
+  bool verify_compaction_checksums();
+  // -XX:+SemeruSelectiveInvalidation, drop the local copies of the pages the memory server compaction rewrote,
+  // recorded in the MemoryToCPUAtGC read last. Before any access to them. Return the pages still mapped.
+  size_t invalidate_rewritten_pages();
 
 
   //
@@ -123,6 +123,11 @@ HeapRegion::block_start_const(const void* p) const {
   return _sync_mem_cpu->_bot_part.block_start_const(p);
 }
 
+inline HeapWord* HeapRegion::block_at_or_preceding(const void* p) const {
+  G1BlockOffsetTablePart* bot_part = &_sync_mem_cpu->_bot_part;
+  return bot_part->block_at_or_preceding(p, true, bot_part->_next_offset_index - 1);
+}
+
 
 //
 // End of G1ContiguousSpace functions override.
@@ -260,6 +265,11 @@ inline void HeapRegion::note_start_of_marking() {
   _next_top_at_mark_start = top();
 }
 
+inline void HeapRegion::note_start_of_remote_marking() {
+  assert(_next_marked_bytes == 0, "Region %u is marked before the concurrent mark starts", hrm_index());
+  _next_top_at_mark_start = bottom();
+}
+
 inline void HeapRegion::note_end_of_marking() {
   _prev_top_at_mark_start = _next_top_at_mark_start;
   _next_top_at_mark_start = bottom();
@@ -271,6 +281,10 @@ inline bool HeapRegion::in_collection_set() const {
   return G1CollectedHeap::heap()->is_in_cset(this);
 }
 
+inline bool HeapRegion::records_target_marks() const {
+  return !is_young() && (!is_humongous() || (SemeruRemoteHumongous && is_starts_humongous()));
+}
+
 template <class Closure, bool is_gc_active>
 bool HeapRegion::do_oops_on_card_in_humongous(MemRegion mr,
                                               Closure* cl,
@@ -25,14 +25,22 @@
 #include "precompiled.hpp"
 #include "gc/g1/g1CollectedHeap.inline.hpp"
 #include "gc/g1/g1ConcurrentRefine.hpp"
+#include "gc/g1/g1SemeruOffHeapArena.hpp"
 #include "gc/g1/heapRegion.hpp"
 #include "gc/g1/heapRegionManager.inline.hpp"
 #include "gc/g1/heapRegionSet.inline.hpp"
 #include "gc/g1/heterogeneousHeapRegionManager.hpp"
 #include "gc/shared/collectorPolicy.hpp"
+#include "logging/log.hpp"
 #include "memory/allocation.hpp"
+#include "runtime/mutexLocker.hpp"
+#include "runtime/orderAccess.hpp"
+#include "runtime/os.hpp"
 #include "utilities/bitMap.inline.hpp"
 
+#include <errno.h>
+#include <sys/mman.h>
+
 class MasterFreeRegionListChecker : public HeapRegionSetChecker {
 public:
   void check_mt_safety() {
@@ -65,7 +73,11 @@ HeapRegionManager::HeapRegionManager() :
   _regions(), _heap_mapper(NULL),
   _prev_bitmap_mapper(NULL),
   _next_bitmap_mapper(NULL),
-  _free_list("Free list", new MasterFreeRegionListChecker())
+  _free_list("Free list", new MasterFreeRegionListChecker()),
+  _reclaim_hints(NULL),
+  _reclaim_hint_entries(0),
+  _dram_pinned(NULL),
+  _dram_pin_failed(false)
 { }
 
 HeapRegionManager* HeapRegionManager::create_manager(G1CollectedHeap* heap, G1CollectorPolicy* policy) {
@@ -99,6 +111,169 @@ void HeapRegionManager::initialize(G1RegionToSpaceMapper* heap_storage,
   _available_map.initialize(_regions.length());
 }
 
+/**
+ * Semeru CPU - The kernel picks the pages to swap out without knowing the Regions.
+ *  Share one hint byte per Region with it, the Region type and its reclaim priority:
+ *   free             : DISCARD, the content is dead, the page is freed without the RDMA write.
+ *   eden, survivor   : KEEP, skipped by the bulk eviction, RDMA_EVICT.
+ *   old, humongous   : FIRST.
+ *  The RDMA meta space, e.g. the flags, is always kept by the kernel.
+ *  The array is pinned by the kernel, its pages never fault.
+ */
+void HeapRegionManager::initialize_reclaim_hints() {
+  // The off-heap arena is above the heap, its units are covered too.
+  HeapWord* end  = MAX2(heap_end(), (HeapWord*)G1SemeruOffHeapArena::end());
+  size_t entries = pointer_delta(end, (HeapWord*)RDMA_DATA_SPACE_START_ADDR) >> HeapRegion::LogOfHRGrainWords;
+  size_t bytes   = align_up(entries, os::vm_page_size());
+
+  char* hints = os::reserve_memory(bytes, NULL, os::vm_page_size());
+  if (hints == NULL) {
+    return;
+  }
+  os::commit_memory_or_exit(hints, bytes, false, "Semeru reclaim hints");
+
+  // The Regions committed so far, the others stay SEMERU_RECLAIM_NORMAL.
+  for (uint i = 0; i < max_length(); i++) {
+    HeapRegion* hr = at_or_null(i);
+    if (hr != NULL) {
+      size_t index = pointer_delta(hr->bottom(), (HeapWord*)RDMA_DATA_SPACE_START_ADDR) >> HeapRegion::LogOfHRGrainWords;
+      hints[index] = (char)((hr->is_free() ? SEMERU_RECLAIM_DISCARD : SEMERU_RECLAIM_FIRST) << SEMERU_RECLAIM_SHIFT);
+    }
+  }
+
+  if (syscall(RDMA_RECLAIM_HINTS, HeapRegion::LogOfHRGrainBytes, hints, bytes) != 0) {
+    log_debug(semeru,alloc)("%s, the kernel doesn't take the reclaim hints.", __func__);
+    os::release_memory(hints, bytes);
+    return;
+  }
+
+  _reclaim_hints        = (volatile uint8_t*)hints;
+  _reclaim_hint_entries = entries;
+  log_debug(semeru,alloc)("%s, reclaim hints 0x%lx, 0x%lx Regions", __func__, (size_t)hints, entries);
+}
+
+void HeapRegionManager::set_reclaim_hint(HeapRegion* hr, G1HeapRegionTraceType::Type type) {
+  if (_reclaim_hints == NULL) {
+    return;
+  }
+
+  uint8_t priority;
+  switch (type) {
+    case G1HeapRegionTraceType::Free:     priority = SEMERU_RECLAIM_DISCARD; break;
+    case G1HeapRegionTraceType::Eden:
+    case G1HeapRegionTraceType::Survivor: priority = SEMERU_RECLAIM_KEEP;    break;
+    default:                              priority = SEMERU_RECLAIM_FIRST;   break;
+  }
+
+  size_t index = pointer_delta(hr->bottom(), (HeapWord*)RDMA_DATA_SPACE_START_ADDR) >> HeapRegion::LogOfHRGrainWords;
+  assert(index < _reclaim_hint_entries, "Region[%u] is out of the reclaim hints", hr->hrm_index());
+
+  // Visible to the swap path before the JVM writes the Region as its new type.
+  OrderAccess::release_store_fence(&_reclaim_hints[index],
+                                   (uint8_t)((priority << SEMERU_RECLAIM_SHIFT) | ((uint8_t)type & SEMERU_REGION_TYPE_MASK)));
+}
+
+// Not a Region of the heap, the type bits are the end sentinel.
+void HeapRegionManager::set_off_heap_reclaim_hint(const void* addr, bool in_use) {
+  if (_reclaim_hints == NULL) {
+    return;
+  }
+
+  size_t index = pointer_delta(addr, (void*)RDMA_DATA_SPACE_START_ADDR, 1) >> HeapRegion::LogOfHRGrainBytes;
+  assert(index < _reclaim_hint_entries, "0x%lx is out of the reclaim hints", (size_t)addr);
+
+  uint8_t priority = in_use ? SEMERU_RECLAIM_FIRST : SEMERU_RECLAIM_NORMAL;
+  OrderAccess::release_store_fence(&_reclaim_hints[index],
+                                   (uint8_t)((priority << SEMERU_RECLAIM_SHIFT) |
+                                             ((uint8_t)G1HeapRegionTraceType::G1HeapRegionTypeEndSentinel & SEMERU_REGION_TYPE_MASK)));
+}
+
+/**
+ * Semeru CPU - The young generation in the local DRAM, the old generation backed by the memory servers.
+ *  The heterogeneous heap, AllocateOldGenAt, splits the heap by a file mapping of the old generation,
+ *  its pages would be written back to the file instead of the memory servers. Here the split is by the Region type :
+ *  an eden or survivor Region is locked by mlock() while it's young, the kernel never swaps its pages out,
+ *  and the young pauses never fault. The Region is unlocked when it's freed or turns old, e.g. by an evacuation failure.
+ *  A Region is locked before the JVM allocates in it, it's mostly resident by SemeruResidentAllocWindow.
+ */
+void HeapRegionManager::initialize_dram_pins() {
+  _dram_pinned = NEW_C_HEAP_ARRAY(bool, max_length(), mtGC);
+  memset(_dram_pinned, 0, max_length() * sizeof(bool));
+
+  // The young Regions committed so far.
+  for (uint i = 0; i < max_length(); i++) {
+    HeapRegion* hr = at_or_null(i);
+    if (hr != NULL && hr->is_young()) {
+      update_dram_pin(hr, hr->is_eden() ? G1HeapRegionTraceType::Eden : G1HeapRegionTraceType::Survivor);
+    }
+  }
+}
+
+bool HeapRegionManager::lock_in_dram(HeapRegion* hr) {
+  uint index = hr->hrm_index();
+  if (_dram_pinned[index]) {
+    return true;
+  }
+  if (mlock(hr->bottom(), HeapRegion::GrainBytes) != 0) {
+    return false;
+  }
+  _dram_pinned[index] = true;
+  return true;
+}
+
+void HeapRegionManager::unlock_in_dram(HeapRegion* hr) {
+  uint index = hr->hrm_index();
+  if (!_dram_pinned[index]) {
+    return;
+  }
+  munlock(hr->bottom(), HeapRegion::GrainBytes);
+  _dram_pinned[index] = false;
+}
+
+void HeapRegionManager::update_dram_pin(HeapRegion* hr, G1HeapRegionTraceType::Type type) {
+  if (_dram_pinned == NULL) {
+    return;
+  }
+
+  // Any type change also drops the pin of -XX:+SemeruRegionHints.
+  bool young = SemeruPinYoungRegions &&
+               (type == G1HeapRegionTraceType::Eden || type == G1HeapRegionTraceType::Survivor);
+  if (!young) {
+    unlock_in_dram(hr);
+    return;
+  }
+
+  if (_dram_pin_failed) {
+    return;
+  }
+  if (!lock_in_dram(hr)) {
+    _dram_pin_failed = true;
+    log_warning(semeru, alloc)("%s, mlock() of Region[%u] failed, errno %d. The later young Regions are not locked in DRAM.",
+                               __func__, hr->hrm_index(), errno);
+  }
+}
+
+/**
+ * Semeru CPU - The pin hint of the application, jdk.internal.misc.SemeruHints.
+ *  The Region types only change under the Heap_lock, or in the pauses, which take it first.
+ *  The Region's swapped out pages are read back by the mlock().
+ */
+bool HeapRegionManager::pin_in_dram(HeapRegion* hr) {
+  assert_locked_or_safepoint(Heap_lock);
+  if (_dram_pinned == NULL || hr->is_free()) {
+    return false;
+  }
+  return lock_in_dram(hr);
+}
+
+void HeapRegionManager::unpin_in_dram(HeapRegion* hr) {
+  assert_locked_or_safepoint(Heap_lock);
+  if (_dram_pinned == NULL || (SemeruPinYoungRegions && hr->is_young())) {
+    return;
+  }
+  unlock_in_dram(hr);
+}
+
 bool HeapRegionManager::is_available(uint region) const {
   return _available_map.at(region);
 }
@@ -137,6 +312,8 @@ void HeapRegionManager::commit_regions(uint index, size_t num_regions, WorkGang*
   _cardtable_mapper->commit_regions(index, num_regions, pretouch_gang);
 
   _card_counts_mapper->commit_regions(index, num_regions, pretouch_gang);
+
+  resize_remote_memory(index, num_regions, true);
 }
 
 void HeapRegionManager::uncommit_regions(uint start, size_t num_regions) {
@@ -164,6 +341,54 @@ void HeapRegionManager::uncommit_regions(uint start, size_t num_regions) {
   _cardtable_mapper->uncommit_regions(start, num_regions);
 
   _card_counts_mapper->uncommit_regions(start, num_regions);
+
+  resize_remote_memory(start, num_regions, false);
+}
+
+// The memory servers register their data chunks, REGION_SIZE_GB each, only when the CPU server commits them.
+// Expanding covers all the chunks touched by the regions.
+// Releasing a chunk requires all the regions within it to be uncommitted.
+void HeapRegionManager::resize_remote_memory(uint index, size_t num_regions, bool expand) {
+  if (!SemeruEnableMemPool || (size_t)heap_bottom() < RDMA_DATA_SPACE_START_ADDR) {
+    return;
+  }
+
+  const size_t chunk_bytes = REGION_SIZE_GB * ONE_GB;
+  const uint regions_per_chunk = (uint)MAX2(chunk_bytes / HeapRegion::GrainBytes, (size_t)1);
+  char* start = (char*)G1CollectedHeap::heap()->bottom_addr_for_region(index);
+  size_t size = num_regions * HeapRegion::GrainBytes;
+
+  if (expand) {
+    if (syscall(RDMA_EXPAND_CHUNKS, 0, start, size) != 0) {
+      log_warning(semeru, alloc)("%s, expand the remote memory [" PTR_FORMAT ", " PTR_FORMAT ") failed.",
+                                 __func__, p2i(start), p2i(start + size));
+    }
+    return;
+  }
+
+  // Chunk index is relative to the data space, the same as the kernel.
+  size_t first_chunk = ((size_t)start - RDMA_DATA_SPACE_START_ADDR) / chunk_bytes;
+  size_t end_chunk = ((size_t)start + size - RDMA_DATA_SPACE_START_ADDR + chunk_bytes - 1) / chunk_bytes;
+  for (size_t chunk = first_chunk; chunk < end_chunk; chunk++) {
+    char* chunk_start = (char*)(RDMA_DATA_SPACE_START_ADDR + chunk * chunk_bytes);
+    if (chunk_start < (char*)heap_bottom() || chunk_start + chunk_bytes > (char*)heap_end()) {
+      continue; // partially out of the heap, keep it.
+    }
+
+    uint first_region = (uint)(((HeapWord*)chunk_start - heap_bottom()) / HeapRegion::GrainWords);
+    bool in_use = false;
+    for (uint i = first_region; i < first_region + regions_per_chunk; i++) {
+      if (is_available(i)) {
+        in_use = true;
+        break;
+      }
+    }
+
+    if (!in_use && syscall(RDMA_RELEASE_CHUNKS, 0, chunk_start, chunk_bytes) != 0) {
+      log_warning(semeru, alloc)("%s, release the remote memory [" PTR_FORMAT ", " PTR_FORMAT ") failed.",
+                                 __func__, p2i(chunk_start), p2i(chunk_start + chunk_bytes));
+    }
+  }
 }
 
 void HeapRegionManager::make_regions_available(uint start, uint num_regions, WorkGang* pretouch_gang) {
@@ -195,7 +420,7 @@ void HeapRegionManager::make_regions_available(uint start, uint num_regions, Wor
 
 	  // RDMA : Allocate the HeapRegion->_target_obj_q here.
     // Added by Chenxi.
-    if(SemeruEnableMemPool && UseCompressedOops==false){
+    if(SemeruEnableMemPool){
 		  //hr->allocate_init_target_oop_queue(hr->hrm_index()); 
       hr->allocate_init_cross_region_ref_update_queue(hr->hrm_index());
     }
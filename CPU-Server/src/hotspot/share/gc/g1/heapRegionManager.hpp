@@ -27,6 +27,7 @@
 
 #include "gc/g1/g1BiasedArray.hpp"
 #include "gc/g1/g1CollectorPolicy.hpp"
+#include "gc/g1/g1HeapRegionTraceType.hpp"
 #include "gc/g1/g1RegionToSpaceMapper.hpp"
 #include "gc/g1/heapRegionSet.hpp"
 #include "gc/shared/collectorPolicy.hpp"
@@ -114,6 +115,18 @@ class HeapRegionManager: public CHeapObj<mtGC> {
   // sequence could be found, otherwise res_idx contains the start index of this range.
   uint find_empty_from_idx_reverse(uint start_idx, uint* res_idx) const;
 
+  // Semeru, the reclaim hint of each Region shared with the kernel, RDMA_RECLAIM_HINTS.
+  // Written by the JVM, read by the swap path. NULL if the kernel doesn't take them.
+  volatile uint8_t* _reclaim_hints;
+  size_t            _reclaim_hint_entries;
+
+  // Semeru, the Regions locked in the local DRAM by -XX:+SemeruPinYoungRegions, by index.
+  bool* _dram_pinned;
+  bool  _dram_pin_failed;   // mlock() failed once, e.g. RLIMIT_MEMLOCK, the later young Regions stay swappable.
+
+  bool lock_in_dram(HeapRegion* hr);
+  void unlock_in_dram(HeapRegion* hr);
+
 protected:
   G1HeapRegionTable _regions;
   G1RegionToSpaceMapper* _heap_mapper;
@@ -123,6 +136,8 @@ protected:
 
   void make_regions_available(uint index, uint num_regions = 1, WorkGang* pretouch_gang = NULL);
   void uncommit_regions(uint index, size_t num_regions = 1);
+  // Semeru : expand/release the remote memory chunks backing the regions [index, index + num_regions).
+  void resize_remote_memory(uint index, size_t num_regions, bool expand);
   // Allocate a new HeapRegion for the given index.
   HeapRegion* new_heap_region(uint hrm_index);
 #ifdef ASSERT
@@ -190,6 +205,18 @@ public:
     return hr;
   }
 
+  // Semeru, allocate the free region of the least cost among the first max_scanned
+  // ones from the end allocate_free_region() takes.
+  HeapRegion* allocate_cheapest_free_region(HeapRegionType type, uint max_scanned, FreeRegionCost* cost) {
+    HeapRegion* hr = _free_list.remove_cheapest_region(!type.is_young(), max_scanned, cost);
+
+    if (hr != NULL) {
+      assert(hr->next() == NULL, "Single region should not have next");
+      assert(is_available(hr->hrm_index()), "Must be committed");
+    }
+    return hr;
+  }
+
   inline void allocate_free_regions_starting_at(uint first, uint num_regions);
 
   // Remove all regions from the free list.
@@ -266,6 +293,25 @@ public:
   // empty, and free.
   void shrink_at(uint index, size_t num_regions);
 
+  // Semeru, share the reclaim hints with the kernel, -XX:+SemeruReclaimHints.
+  void initialize_reclaim_hints();
+
+  // Publish the new type of the Region to the kernel, before the Region is used as that type.
+  void set_reclaim_hint(HeapRegion* hr, G1HeapRegionTraceType::Type type);
+
+  // The Region-sized unit of the off-heap arena at addr holds a block, or not, G1SemeruOffHeapArena.
+  void set_off_heap_reclaim_hint(const void* addr, bool in_use);
+
+  // Semeru, -XX:+SemeruPinYoungRegions. Lock the eden and survivor Regions in the local DRAM,
+  // and unlock a Region when it leaves the young generation.
+  void initialize_dram_pins();
+  void update_dram_pin(HeapRegion* hr, G1HeapRegionTraceType::Type type);
+
+  // -XX:+SemeruRegionHints, lock a Region in the local DRAM until its type changes. Under the Heap_lock.
+  bool pin_in_dram(HeapRegion* hr);
+  void unpin_in_dram(HeapRegion* hr);
+  bool is_pinned_in_dram(uint index) const { return _dram_pinned != NULL && _dram_pinned[index]; }
+
   virtual void verify();
 
   // Do some sanity checking.
@@ -605,6 +605,7 @@ HeapRegionRemSet::HeapRegionRemSet(G1BlockOffsetTable* bot,
     _m(Mutex::leaf, FormatBuffer<128>("HeapRegionRemSet lock #%u", hr->hrm_index()), true, Monitor::_safepoint_check_never),
     _other_regions(&_m),
     _hr(hr),
+    _stashed_cards(0),
     _state(Untracked)
 {
 }
@@ -638,10 +639,20 @@ void HeapRegionRemSet::clear_locked(bool only_cardset) {
   }
   clear_fcc();
   _other_regions.clear();
+  _stashed_cards = 0;
   set_state_empty();
   assert(occupied_locked() == 0, "Should be clear.");
 }
 
+void HeapRegionRemSet::stash_cards(uint n) {
+  assert(SafepointSynchronize::is_at_safepoint(), "the refinement is stopped");
+  assert(is_complete() && _stashed_cards == 0, "Only a complete table is stashed, once");
+  MutexLockerEx x(&_m, Mutex::_no_safepoint_check_flag);
+  clear_fcc();
+  _other_regions.clear();
+  _stashed_cards = n;
+}
+
 // Code roots support
 //
 // The code root set is protected by two separate locking schemes
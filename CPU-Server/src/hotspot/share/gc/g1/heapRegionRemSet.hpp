@@ -174,6 +174,9 @@ private:
 
   HeapRegion* _hr;
 
+  // -XX:+SemeruRemoteRemSets, the cards moved to the memory server. Not in _other_regions any more.
+  uint _stashed_cards;
+
   void clear_fcc();
 
 public:
@@ -182,7 +185,7 @@ public:
   static void setup_remset_size();
 
   bool cardset_is_empty() const {
-    return _other_regions.is_empty();
+    return _other_regions.is_empty() && _stashed_cards == 0;
   }
 
   bool is_empty() const {
@@ -190,7 +193,7 @@ public:
   }
 
   bool occupancy_less_or_equal_than(size_t occ) const {
-    return (strong_code_roots_list_length() == 0) && _other_regions.occupancy_less_or_equal_than(occ);
+    return (strong_code_roots_list_length() == 0) && _stashed_cards == 0 && _other_regions.occupancy_less_or_equal_than(occ);
   }
 
   size_t occupied() {
@@ -198,7 +201,7 @@ public:
     return occupied_locked();
   }
   size_t occupied_locked() {
-    return _other_regions.occupied();
+    return _other_regions.occupied() + _stashed_cards;
   }
 
   static jint n_coarsenings() { return OtherRegionsTable::n_coarsenings(); }
@@ -229,6 +232,7 @@ public:
       return;
     }
     clear_fcc();
+    _stashed_cards = 0;
     _state = Untracked;
   }
 
@@ -271,6 +275,17 @@ public:
   void clear(bool only_cardset = false);
   void clear_locked(bool only_cardset = false);
 
+  // -XX:+SemeruRemoteRemSets, see G1RemoteRemSetStash. At a safepoint.
+  uint stashed_cards() const { return _stashed_cards; }
+  // The n cards of the table are written to the memory server, drop them locally.
+  void stash_cards(uint n);
+  // The stashed cards are read back, the caller adds them again.
+  uint take_stashed_cards() {
+    uint n = _stashed_cards;
+    _stashed_cards = 0;
+    return n;
+  }
+
   // The actual # of bytes this hr_remset takes up.
   // Note also includes the strong code root set.
   size_t mem_size() {
@@ -179,6 +179,31 @@ void FreeRegionList::add_ordered(FreeRegionList* from_list) {
   from_list->verify_optional();
 }
 
+HeapRegion* FreeRegionList::remove_cheapest_region(bool from_head, uint max_scanned, FreeRegionCost* cost) {
+  check_mt_safety();
+  if (is_empty()) {
+    return NULL;
+  }
+
+  HeapRegion* best = NULL;
+  size_t best_cost = 0;
+  HeapRegion* curr = from_head ? _head : _tail;
+  for (uint i = 0; curr != NULL && i < max_scanned; i++) {
+    size_t c = cost->cost(curr);
+    if (best == NULL || c < best_cost) {
+      best = curr;
+      best_cost = c;
+      if (c == 0) {
+        break;
+      }
+    }
+    curr = from_head ? curr->next() : curr->prev();
+  }
+
+  remove_starting_at(best, 1);
+  return best;
+}
+
 void FreeRegionList::remove_starting_at(HeapRegion* first, uint num_regions) {
   check_mt_safety();
   assert_free_region_list(num_regions >= 1, "pre-condition");
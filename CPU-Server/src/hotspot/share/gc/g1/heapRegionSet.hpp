@@ -137,6 +137,12 @@ public:
 
 class FreeRegionListIterator;
 
+// Semeru, the cost of taking a free region, see FreeRegionList::remove_cheapest_region().
+class FreeRegionCost : public StackObj {
+public:
+  virtual size_t cost(HeapRegion* hr) = 0;
+};
+
 class FreeRegionList : public HeapRegionSetBase {
   friend class FreeRegionListIterator;
 
@@ -181,6 +187,10 @@ public:
   // Removes from head or tail based on the given argument.
   HeapRegion* remove_region(bool from_head);
 
+  // Semeru, removes the region of the least cost among the first max_scanned
+  // ones from the head or tail. The scan stops at a region of cost 0.
+  HeapRegion* remove_cheapest_region(bool from_head, uint max_scanned, FreeRegionCost* cost);
+
   // Merge two ordered lists. The result is also ordered. The order is
   // determined by hrm_index.
   void add_ordered(FreeRegionList* from_list);
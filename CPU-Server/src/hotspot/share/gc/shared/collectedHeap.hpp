@@ -148,6 +148,12 @@ class CollectedHeap : public CHeapObj<mtInternal> {
   virtual HeapWord* mem_allocate(size_t size,
                                  bool* gc_overhead_limit_was_exceeded) = 0;
 
+  // Semeru, allocate an object of klass directly in the old generation,
+  // before the TLAB is tried. NULL if the heap doesn't pretenure it.
+  virtual HeapWord* mem_allocate_pretenured(Klass* klass, size_t size) {
+    return NULL;
+  }
+
   // Filler object utilities.
   static inline size_t filler_array_hdr_size();
   static inline size_t filler_array_min_size();
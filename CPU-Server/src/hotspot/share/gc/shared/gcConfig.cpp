@@ -107,6 +107,13 @@ void GCConfig::fail_if_unsupported_gc_is_selected() {
 }
 
 void GCConfig::select_gc_ergonomically() {
+#if INCLUDE_G1GC
+  // Semeru - the offloading to the memory servers is only built into G1.
+  if (SemeruEnableMemPool) {
+    FLAG_SET_ERGO_IF_DEFAULT(bool, UseG1GC, true);
+    return;
+  }
+#endif
   if (os::is_server_class_machine()) {
 #if INCLUDE_G1GC
     FLAG_SET_ERGO_IF_DEFAULT(bool, UseG1GC, true);
@@ -173,6 +180,12 @@ GCArguments* GCConfig::select_gc() {
     vm_exit_during_initialization("Multiple garbage collectors selected", NULL);
   }
 
+  // Semeru - the memory servers trace and compact with the G1 Region layout, the CSet split
+  // and the G1 write barrier of the CPU server. ZGC and Shenandoah have no Semeru variant.
+  if (SemeruEnableMemPool && !UseG1GC) {
+    vm_exit_during_initialization("SemeruEnableMemPool requires -XX:+UseG1GC", NULL);
+  }
+
   // Exactly one GC selected
   FOR_EACH_SUPPORTED_GC(gc) {
     if (gc->_flag) {
@@ -745,6 +745,388 @@
           range(0, 128)                                                     \
           /*constraint(SemeruConcGCThreadsConstraintFunc,AfterErgo) */      \
                                                                             \
+  product(uint, SemeruMemServerNum, NUM_OF_MEMORY_SERVER,                   \
+          "Number of memory servers. Has to divide RDMA_DATA_REGION_NUM "   \
+          "and match the num_mem_servers of the Semeru kernel module")      \
+          range(1, MAX_NUM_OF_MEMORY_SERVER)                                \
+                                                                            \
+  product(ccstr, SemeruMemServerIPs, "10.0.0.4",                            \
+          "Comma separated IPv4 address of each memory server, "            \
+          "used by the user space control path")                            \
+                                                                            \
+  product(uint, SemeruPlacementPolicy, SEMERU_PLACEMENT_RANGE,              \
+          "Placement of the data Regions on the memory servers, 0 range, "  \
+          "1 interleave, 2 load-aware. The same with the kernel module")    \
+          range(0, SEMERU_PLACEMENT_LOAD)                                   \
+                                                                            \
+  product(bool, SemeruConcurrentCompact, false,                             \
+          "Grant the fully evicted Regions of the memory server CSet to "   \
+          "the memory servers, which compact them out of the STW window. "  \
+          "A swap-in or swap-out of the Region revokes the grant")          \
+                                                                            \
+  product(uint, SemeruConcurrentCompactCommitWaits, 8,                      \
+          "Waits for a memory server to copy its committed Regions back, "  \
+          "one notification timeout each, before their fences are "         \
+          "released anyway. The kernel drops them itself later")            \
+          range(1, 1024)                                                    \
+                                                                            \
+  product(bool, SemeruIncrementalLiveness, true,                            \
+          "At the start of a GC, read the liveness of all the old Regions " \
+          "changed since the last GC by one vectored RDMA read, and hand "  \
+          "the mostly dead Regions to the memory servers")                  \
+                                                                            \
+  product(uintx, SemeruMemServerLiveThresholdPercent, 30,                   \
+          "An old Region the memory server scanned with fewer alive "       \
+          "bytes than this percentage is compacted there. Bounded by "      \
+          "G1MixedGCLiveThresholdPercent")                                  \
+          range(0, 100)                                                     \
+                                                                            \
+  product(bool, SemeruLivenessVector, false,                                \
+          "With SemeruIncrementalLiveness, read the liveness of all the "   \
+          "Regions of a memory server by one RDMA read of its versioned "   \
+          "liveness vector, instead of the epochs and MemoryToCPUAtGC")     \
+                                                                            \
+  product(bool, SemeruCSetCostModel, false,                                 \
+          "Reclaim a scanned and mostly dead old Region on the server "     \
+          "predicted to take the shorter pause, by the learned "            \
+          "evacuation, swap-in and RDMA flush costs, instead of the fixed " \
+          "cache ratio thresholds")                                         \
+                                                                            \
+  product(uintx, SemeruResidentAllocWindow, 16,                             \
+          "Free Regions scanned for the one with the fewest swapped out "   \
+          "pages, when a mutator or GC alloc Region is taken. "             \
+          "0 takes the first free Region as G1")                            \
+                                                                            \
+  product(bool, SemeruCacheYoungSizing, false,                              \
+          "With SemeruLocalCachePercent, bound the young generation by "    \
+          "the part of the local cache it keeps resident, learned from "    \
+          "the swapped out young pages and the on-demand swap-ins. "        \
+          "false uses the fixed NewRatio bands")                            \
+                                                                            \
+  product(bool, SemeruColdEvacuation, false,                                \
+          "Evacuate the objects on the pages swapped out at the pause "     \
+          "start into their own old Regions, apart from the hot ones")      \
+                                                                            \
+  product(bool, SemeruBulkEvictColdRegions, false,                          \
+          "Evict the cold old Regions of -XX:+SemeruColdEvacuation as a "   \
+          "whole right after the pause, by RDMA_EVICT")                     \
+                                                                            \
+  product(uintx, SemeruCSetPrefetchPages, 0,                                \
+          "Swapped out pages of the CSet read into the kernel's prefetch "  \
+          "cache before the evacuation, by RDMA_PREFETCH_RANGE. "           \
+          "0 disables it. The kernel caches 4096 pages at most")            \
+          range(0, max_uintx)                                               \
+                                                                            \
+  product(bool, SemeruConcurrentTargetQueue, false,                         \
+          "Send the target marks found by the concurrent refinement to "    \
+          "the memory servers between the pauses")                          \
+                                                                            \
+  product(uintx, SemeruTargetQueueRefineThreshold, 16,                      \
+          "The number of Regions with unsent target marks to activate "     \
+          "the target queue thread, -XX:+SemeruConcurrentTargetQueue")      \
+          range(1, max_uintx)                                               \
+                                                                            \
+  product(bool, SemeruConcurrentMetaReplication, false,                     \
+          "Ship the new and written klass metadata to the memory servers "  \
+          "between the pauses, the pause only sends the residue")           \
+                                                                            \
+  product(uintx, SemeruMetaReplicationIntervalMillis, 50,                   \
+          "The interval of the metadata replication rounds, "               \
+          "-XX:+SemeruConcurrentMetaReplication")                           \
+          range(1, max_jint)                                                \
+                                                                            \
+  product(bool, SemeruRemoteHumongous, false,                               \
+          "Trace the swapped out humongous objects on the memory servers "  \
+          "and reclaim the dead ones without swapping them in")             \
+                                                                            \
+  product(bool, SemeruRemoteRefProcessing, false,                           \
+          "Let the memory servers clear the dead referents of the Soft, "   \
+          "Weak and Phantom References in the Regions they compact, "       \
+          "only the cleared References are enqueued here")                  \
+                                                                            \
+  product(bool, SemeruRemoteStringDedup, false,                             \
+          "Let the memory servers merge the identical value arrays of the " \
+          "Strings they trace, in the Regions they compact")                \
+                                                                            \
+  product(bool, SemeruRemoteClassUnloading, false,                          \
+          "Keep the class loaders of the objects marked by the memory "     \
+          "servers alive at the initial mark, the concurrent class "        \
+          "unloading takes their liveness from the memory servers")         \
+                                                                            \
+  product(uintx, SemeruChecksumSamplePercent, 0,                            \
+          "Percent of the pages of a compacted Region the memory servers "  \
+          "checksum by CRC32C, verified by the CPU server when it adopts "  \
+          "the compaction. At most SEMERU_MAX_CHECKSUM_SAMPLES pages per "  \
+          "Region, 0 to disable")                                           \
+          range(0, 100)                                                     \
+                                                                            \
+  product(bool, SemeruYoungHugePages, false,                                \
+          "Back the eden and survivor Regions by transparent huge pages, "  \
+          "the old and humongous Regions swapped out to the memory "        \
+          "servers by 4KB pages. Needs the THP mode madvise or always")     \
+                                                                            \
+  product(bool, SemeruRegionStateAtomics, false,                            \
+          "With SemeruConcurrentCompact, also grant and take back the "     \
+          "Regions by the RDMA atomics on their state words. An unclaimed " \
+          "grant is revoked at once instead of being compacted in vain")    \
+                                                                            \
+  product(bool, SemeruPauseBudget, false,                                   \
+          "Pass the remaining MaxGCPauseMillis of the pause to the memory " \
+          "servers when the STW window opens. They stop claiming Regions "  \
+          "to compact at a Region boundary when it runs out")               \
+                                                                            \
+  product(bool, SemeruRemoteHeapHistogram, false,                           \
+          "The class histogram, e.g. jmap -histo, lets the memory servers " \
+          "count the fully evicted Regions instead of swapping them in")    \
+                                                                            \
+  product(bool, SemeruRemoteFieldReads, false,                              \
+          "The Unsafe getters not intrinsified by the JIT read the fields " \
+          "of the cold old and humongous Regions by a small RDMA read, "    \
+          "without swapping their pages in")                                \
+                                                                            \
+  product(uintx, SemeruRemoteReadEvictedPercent, 50,                        \
+          "The percentage of swapped out pages above which a Region is "    \
+          "cold for SemeruRemoteFieldReads")                                \
+          range(0, 100)                                                     \
+                                                                            \
+  product(bool, SemeruReclaimHints, false,                                  \
+          "Publish the type of each Region to the kernel by "               \
+          "RDMA_RECLAIM_HINTS. The pages of the free Regions are evicted "  \
+          "without the write back, the young Regions are never bulk "       \
+          "evicted")                                                        \
+                                                                            \
+  product(bool, SemeruDiscardFreedRegions, false,                           \
+          "Drop the local pages and the swap entries of the freed "         \
+          "Regions by RDMA_DISCARD, their dead content is never written "   \
+          "back to the memory servers")                                     \
+                                                                            \
+  product(bool, SemeruWireCompression, false,                               \
+          "Run-length encode the large target queue and BOT writes of a "   \
+          "CSet into the wire buffer of its memory server, which decodes "  \
+          "them at the CSet dispatch. For the bandwidth bound pauses")      \
+                                                                            \
+  product(size_t, SemeruWireCompressionMinBytes, 16*K,                      \
+          "The smallest write encoded by SemeruWireCompression")            \
+          range(PAGE_SIZE, max_uintx)                                       \
+                                                                            \
+  product(ccstr, SemeruHeapSnapshotFile, NULL,                              \
+          "At a clean exit, keep the Java heap on the memory servers "      \
+          "and write its manifest to this file. A snapshot left by the "    \
+          "previous run is dropped at the start")                           \
+                                                                            \
+  product(uint, SemeruTornReadRetries, 64,                                  \
+          "Reads of a MemoryToCPUAtGC caught in the middle of a memory "    \
+          "server update, before it is taken as is")                        \
+          range(1, 4096)                                                    \
+                                                                            \
+  product(bool, SemeruRemoteCardScan, false,                                \
+          "The memory servers scan the remembered set cards of the fully "  \
+          "evicted old Regions for the evacuation pause, and send back "    \
+          "the fields pointing into the collection set")                    \
+                                                                            \
+  product(uintx, SemeruRemoteCardScanTimeoutMs, 20,                         \
+          "Milliseconds the evacuation pause waits for the cards scanned "  \
+          "by the memory servers, before it scans them locally")            \
+          range(1, 10000)                                                   \
+                                                                            \
+  product(bool, SemeruRemoteRefinement, false,                              \
+          "The concurrent refinement sends the dirty cards of the fully "   \
+          "evicted old Regions to their memory servers in batches, and "    \
+          "only applies the cross-region fields they find")                 \
+                                                                            \
+  product(uint, SemeruRemoteRefineBatchCards, 256,                          \
+          "Dirty cards of a memory server queued by the concurrent "        \
+          "refinement before they are sent together")                       \
+          range(1, 8192)                                                    \
+                                                                            \
+  product(bool, SemeruRemoteRemSets, false,                                 \
+          "Move the remembered set of an old Region handed to the memory "  \
+          "server CSet to its memory server, read it back when the CPU "    \
+          "server evacuates the Region")                                    \
+                                                                            \
+  product(uint, SemeruRemoteRemSetMinCards, 64,                             \
+          "Smallest remembered set, in cards, moved to the memory server "  \
+          "by -XX:+SemeruRemoteRemSets")                                    \
+          range(1, 1024)                                                    \
+                                                                            \
+  product(bool, SemeruRemoteFullGC, false,                                  \
+          "The full GC keeps the fully evicted, live old Regions in place. "\
+          "Their memory servers send the fields pointing out of them and "  \
+          "store the adjusted values, the CPU server doesn't swap them in") \
+                                                                            \
+  product(uintx, SemeruRemoteFullGCTimeoutMs, 1000,                         \
+          "Milliseconds the full GC waits for a memory server, before it "  \
+          "collects the remaining Regions of the memory server locally")    \
+          range(1, 60000)                                                   \
+                                                                            \
+  product(bool, SemeruMarkMessages, false,                                  \
+          "Relay the targets the memory servers' concurrent marking "       \
+          "found out of their Regions into the target queues, at the "      \
+          "start of each pause. Must match the memory servers")             \
+                                                                            \
+  product(bool, SemeruSATBForwarding, false,                                \
+          "Keep the SATB queues active out of the concurrent marking, and " \
+          "mark the overwritten references into the target queues of "      \
+          "their Regions, the roots of the memory server tracing. Sent "    \
+          "between the pauses with -XX:+SemeruConcurrentTargetQueue")       \
+                                                                            \
+  product(bool, SemeruPinYoungRegions, false,                               \
+          "Lock the eden and survivor Regions in the local DRAM by mlock, " \
+          "they are never swapped out to the memory servers. The old and "  \
+          "humongous Regions stay backed by the memory servers. Bounded "   \
+          "by RLIMIT_MEMLOCK")                                              \
+                                                                            \
+  product(bool, SemeruRegionHints, false,                                   \
+          "Accept the hints of jdk.internal.misc.SemeruHints: prefetch the "\
+          "swapped out pages of an object, evict the old Region of an "     \
+          "object with the cold Regions of the next pause, pin the Region " \
+          "of an object in the local DRAM until its type changes")          \
+                                                                            \
+  product(bool, SemeruPretenureLargeObjects, false,                         \
+          "Allocate the large objects of the classes the young pauses "     \
+          "keep promoting directly in an old Region, evicted to the "       \
+          "memory servers after the next pause")                            \
+                                                                            \
+  product(size_t, SemeruPretenureMinBytes, 64*K,                            \
+          "The smallest object profiled and pretenured by "                 \
+          "SemeruPretenureLargeObjects")                                    \
+          range(HeapWordSize, max_uintx)                                    \
+                                                                            \
+  product(uint, SemeruPretenurePromotions, 8,                               \
+          "The promotions of the large objects of a class before its "      \
+          "large objects are pretenured")                                   \
+          range(1, max_juint)                                               \
+                                                                            \
+  product(bool, SemeruCgroupCacheLimit, false,                              \
+          "Derive SemeruLocalCachePercent from the limit of the memory "    \
+          "cgroup, memory.high or the soft limit, when it isn't set on "    \
+          "the command line")                                               \
+                                                                            \
+  product(uintx, SemeruCgroupEvictPeriod, 100,                              \
+          "With SemeruCgroupCacheLimit, the period in ms the kernel "       \
+          "checks the cgroup and evicts the cold Regions near its limit. "  \
+          "0 leaves the reclaim to the cgroup")                             \
+          range(0, max_jint)                                                \
+                                                                            \
+  product(uintx, SemeruHotRegionSwapIns, 0,                                 \
+          "The pages of a Region swapped in since the last pause, plus "    \
+          "half of its count before. A Region above it is hot, it isn't "   \
+          "handed to the memory servers and its objects aren't copied "     \
+          "to the cold Regions. 0 disables it")                             \
+          range(0, max_jint)                                                \
+                                                                            \
+  product(uintx, SemeruEvacDeferredTasks, 0,                                \
+          "References to swapped out objects an evacuation worker puts "    \
+          "aside while their pages are read by RDMA_FETCH_ASYNC, it "       \
+          "copies the other objects meanwhile. 0 disables it")              \
+          range(0, 64*K)                                                    \
+                                                                            \
+  product(bool, SemeruSelectiveInvalidation, false,                         \
+          "The memory servers report the pages their compaction rewrote, "  \
+          "only these local copies are dropped. The Regions with many "     \
+          "pages cached locally are compacted by the memory servers too")   \
+                                                                            \
+  product(bool, SemeruPageAffinity, false,                                  \
+          "The memory servers link the pages their tracing reaches from "   \
+          "the same root. The kernel prefetches the rest of such a group "  \
+          "after the first fault in it, by RDMA_PAGE_AFFINITY")             \
+                                                                            \
+  product(bool, SemeruEvacLookAhead, false,                                 \
+          "An evacuation worker issues RDMA_FETCH_ASYNC for the page of "   \
+          "a reference it pushes, if the page was swapped out at the "      \
+          "pause start. The reads overlap the copy of the objects ahead "   \
+          "of it in the queue. Works with SemeruEvacDeferredTasks")         \
+                                                                            \
+  product(bool, SemeruSafepointFaultState, false,                           \
+          "The kernel marks the Java threads waiting for a remote page "    \
+          "in an array shared by RDMA_FAULT_STATE. The time to safepoint "  \
+          "spent on them is logged, and their faults issue no prefetch "    \
+          "while a safepoint synchronizes")                                 \
+                                                                            \
+  product(uintx, SemeruLoopPrefetchPages, 0,                                \
+          "C2 makes an array load in a loop read the page this far ahead "  \
+          "of it, once per page of elements, if its Region has swapped "    \
+          "out pages. Such loops aren't vectorized. 0 disables it")         \
+          range(0, 64)                                                      \
+                                                                            \
+  product(ccstrlist, SemeruColdFields, "",                                  \
+          "Comma separated pkg/Class.field or pkg/Class.* patterns of the " \
+          "rarely used instance fields. They are laid out after all the "   \
+          "other fields of the class, so the hot ones of a fat object "     \
+          "share fewer pages. Not for the classes of the boot loader, "     \
+          "nor with @Contended")                                            \
+                                                                            \
+  product(bool, SemeruCommThread, false,                                    \
+          "Queue the control path writes and the broadcasts of the flags "  \
+          "to a dedicated thread, which merges them per memory server "     \
+          "and sends them by vectored async RDMA. The pause doesn't "       \
+          "wait for the flags of its close")                                \
+                                                                            \
+  product(bool, SemeruTimeline, false,                                      \
+          "Record the phases of each pause on this server and on the "      \
+          "memory servers, merged on the clock of this server. Logged "     \
+          "by -Xlog:semeru+timeline, printed by jcmd GC.semeru_timeline")   \
+                                                                            \
+  product(uintx, SemeruTimelinePauses, 16,                                  \
+          "The number of the last pauses kept by -XX:+SemeruTimeline")      \
+          range(1, 1024)                                                    \
+                                                                            \
+  product(uintx, SemeruFaultSamplePeriod, 0,                                \
+          "Sample 1 of N swap-ins of this process and attribute them to "   \
+          "the Java methods and the object types at the next pause. "       \
+          "Logged by -Xlog:semeru at exit, printed by jcmd "                \
+          "GC.semeru_fault_profile. 0 disables it")                         \
+          range(0, max_jint)                                                \
+                                                                            \
+  product(bool, SemeruRemoteConcurrentMark, false,                          \
+          "The concurrent mark leaves the fully evicted old Regions traced "\
+          "by their memory servers live and unscanned, it marks the "       \
+          "targets of the fields the memory servers send out of them. "     \
+          "Disables ClassUnloadingWithConcurrentMark")                      \
+                                                                            \
+  product(uintx, SemeruRemoteConcurrentMarkTimeoutMs, 100,                  \
+          "Milliseconds the concurrent mark waits for a memory server, "    \
+          "before it scans the remaining Regions of the memory server "     \
+          "locally")                                                        \
+          range(1, 60000)                                                   \
+                                                                            \
+  product(size_t, SemeruOffHeapArenaSize, 0,                                \
+          "Bytes of an off-heap arena at the end of the Semeru data "       \
+          "space, above -Xmx, swapped to the memory servers as the heap. "  \
+          "The large Unsafe.allocateMemory blocks, e.g. the direct "        \
+          "ByteBuffers, are taken from it. 0 disables it")                  \
+                                                                            \
+  product(size_t, SemeruOffHeapMinAllocation, 64*K,                         \
+          "The smallest Unsafe.allocateMemory block taken from the "        \
+          "SemeruOffHeapArenaSize arena, the smaller ones stay on malloc")  \
+                                                                            \
+  product(bool, SemeruRemoteArrayOps, false,                                \
+          "Copy and fill the swapped out ranges of the large primitive "    \
+          "arrays on their memory server, not through the swap path")       \
+                                                                            \
+  product(size_t, SemeruRemoteArrayOpMinBytes, 16*M,                        \
+          "The smallest array copy or fill sent to a memory server, "       \
+          "-XX:+SemeruRemoteArrayOps")                                      \
+                                                                            \
+  product(uintx, SemeruRemoteArrayOpTimeoutMs, 100,                         \
+          "How long an array copy or fill waits for its memory server, "    \
+          "then it is done locally")                                        \
+          range(1, 60000)                                                   \
+                                                                            \
+  product(uint, SemeruAddressWindow, 0,                                     \
+          "The address window of this JVM when several Semeru JVMs share "  \
+          "the CPU server. Has to be one of the address_windows of the "    \
+          "Semeru kernel module and the SemeruAddressWindow of its memory " \
+          "servers")                                                        \
+          range(0, SEMERU_MAX_ADDRESS_WINDOWS - 1)                          \
+                                                                            \
+  product(uint, SemeruMemServerPort, 9400,                                  \
+          "RDMA port of the memory servers of this JVM for the user space " \
+          "control path, 9400 plus their SemeruTenantID. The Semeru kernel "\
+          "module connects to mem_server_port plus the slot of the window " \
+          "in its address_windows")                                         \
+          range(1, 65535)                                                   \
+                                                                            \
                                                                             \
   /* Semeru End */                                                          \
                                                                             \
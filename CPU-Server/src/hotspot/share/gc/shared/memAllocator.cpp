@@ -368,6 +368,15 @@ HeapWord* MemAllocator::allocate_inside_tlab_slow(Allocation& allocation) const
 }
 
 HeapWord* MemAllocator::mem_allocate(Allocation& allocation) const {
+  if (SemeruPretenureLargeObjects) {
+    HeapWord* result = _heap->mem_allocate_pretenured(_klass, _word_size);
+    if (result != NULL) {
+      allocation._allocated_outside_tlab = true;
+      _thread->incr_allocated_bytes(_word_size * HeapWordSize);
+      return result;
+    }
+  }
+
   if (UseTLAB) {
     HeapWord* result = allocate_inside_tlab(allocation);
     if (result != NULL) {
@@ -13,12 +13,17 @@
 #include "runtime/atomic.hpp"
 #include "utilities/globalDefinitions.hpp"
 #include "memory/allocation.hpp"  // Include all the headers of orginal allocation.hpp
+#include "gc/shared/rdmaMetaLayout.hpp"
 #include "logging/log.hpp"
 
 
 
 #define MEM_SERVER_CSET_BUFFER_SIZE		(size_t)(512 - 8) 	
 
+// Instances allocated by new(index) in one arena, at least a page each. All the arenas are SEMERU_PER_REGION_ZONE_SIZE.
+#define RDMA_ARENA_MAX_INSTANCES    (CPU_TO_MEMORY_GC_SIZE_LIMIT / PAGE_SIZE)
+#define RDMA_ARENA_DIRTY_WORDS      ((RDMA_ARENA_MAX_INSTANCES + BitsPerWord - 1) / BitsPerWord)
+
 
 /**
  * CHeapRDMAObj allocation type.
@@ -81,6 +86,9 @@ public:
   static char   *_alloc_ptr; 
   static size_t  _instance_size;  // only used for normal instance allocation. e.g. the obj in SemeruHeapRegion.
 
+  // One bit per instance of the arena, set by mark_dirty() and cleared when the instance is sent.
+  static size_t  _dirty_bits[RDMA_ARENA_DIRTY_WORDS];
+
 
   //
   //  Functions
@@ -258,7 +266,7 @@ public:
         //    First time entering the zone.
         if(CHeapRDMAObj<E, MEM_TO_CPU_AT_GC_ALLOCTYPE>::_alloc_ptr == NULL){
           requested_addr = (char*)(SEMERU_START_ADDR + MEMORY_TO_CPU_GC_OFFSET);
-          CHeapRDMAObj<E, CPU_TO_MEM_AT_GC_ALLOCTYPE>::_instance_size = commit_size;  // init here, compared latter.
+          CHeapRDMAObj<E, MEM_TO_CPU_AT_GC_ALLOCTYPE>::_instance_size = commit_size;  // init here, compared latter.
           
           if( (char*)commit_at(MEMORY_TO_CPU_GC_SIZE_LIMIT, mtGC, requested_addr) ==  requested_addr ){
 
@@ -501,9 +509,9 @@ public:
     switch(Alloc_type)  // based on the instantiation of Template
     {
       case ALLOC_TARGET_OBJ_QUEUE_ALLOCTYPE :
-        requested_addr = (char*)(SEMERU_START_ADDR + CROSS_REGION_REF_TARGET_Q_OFFSET + index * commit_size) ;
+        requested_addr = (char*)(SEMERU_START_ADDR + SemeruMetaLayout::cross_region_ref_target_q_offset() + index * commit_size) ;
 
-        assert(requested_addr + commit_size < (char*)(SEMERU_START_ADDR + CROSS_REGION_REF_TARGET_Q_OFFSET +CROSS_REGION_REF_TARGET_Q_SIZE_LIMIT), 
+        assert(requested_addr + commit_size < (char*)(SEMERU_START_ADDR + SemeruMetaLayout::cross_region_ref_target_q_offset() + SemeruMetaLayout::cross_region_ref_target_q_size()), 
                                                         "%s, Exceed the TARGET_OBJ_QUEUE's space range. \n", __func__ );
         
         // [?] How to handle the failure ?
@@ -552,6 +560,79 @@ public:
   }
 
 
+  //
+  // Arena descriptor of the instances allocated by new(index).
+  // They are bumped contiguously from the arena base, each takes arena_stride() bytes.
+  // So the dirty instances of a memory server can be sent by a few large writes, instead of one per instance.
+  //
+
+  static char* arena_base() {
+    switch(Alloc_type){
+      case CPU_TO_MEM_AT_INIT_ALLOCTYPE :       return (char*)(SEMERU_START_ADDR + CPU_TO_MEMORY_INIT_OFFSET);
+      case CPU_TO_MEM_AT_GC_ALLOCTYPE :         return (char*)(SEMERU_START_ADDR + CPU_TO_MEMORY_GC_OFFSET);
+      case MEM_TO_CPU_AT_GC_ALLOCTYPE :         return (char*)(SEMERU_START_ADDR + MEMORY_TO_CPU_GC_OFFSET);
+      case SYNC_BETWEEN_MEM_AND_CPU_ALLOCTYPE : return (char*)(SEMERU_START_ADDR + SYNC_MEMORY_AND_CPU_OFFSET);
+      default :                                 return NULL;    // not bumped by index.
+    }
+  }
+
+  static size_t arena_stride() { return _instance_size; }
+  static size_t arena_count()  { return _alloc_ptr == NULL ? 0 : (size_t)(_alloc_ptr - arena_base()) / arena_stride(); }
+
+  static size_t arena_index_of(const E* obj) {
+    assert((char*)obj >= arena_base() && (char*)obj < _alloc_ptr, "0x%lx is not in the arena", (size_t)obj);
+    return (size_t)((char*)obj - arena_base()) / arena_stride();
+  }
+
+  // Not MT safe, the instances are marked and sent by the VM thread in the pause.
+  static void mark_dirty(const E* obj) {
+    size_t index = arena_index_of(obj);
+    _dirty_bits[index / BitsPerWord] |= (size_t)1 << (index % BitsPerWord);
+  }
+
+  static bool is_dirty(size_t index) {
+    return (_dirty_bits[index / BitsPerWord] & ((size_t)1 << (index % BitsPerWord))) != 0;
+  }
+
+  /**
+   * Fill one entry per run of the dirty instances, up to max_iov entries, and clear the bits of the filled runs.
+   * Call it again with a fresh vector if it returns max_iov, there may be runs left.
+   * A run also covers the padding between its instances, but only sizeof(E) of its last one.
+   */
+  static int dirty_runs_iovec(semeru_rdma_iovec* iov, int max_iov, int mem_server_id) {
+    size_t count = arena_count();
+    int nr_iov = 0;
+
+    for(size_t i = 0; i < count && nr_iov < max_iov; ){
+      if(_dirty_bits[i / BitsPerWord] == 0){
+        i = align_down(i, (size_t)BitsPerWord) + BitsPerWord;   // skip the clean word
+        continue;
+      }
+      if(!is_dirty(i)){
+        i++;
+        continue;
+      }
+
+      size_t run_end = i + 1;
+      while(run_end < count && is_dirty(run_end)){
+        run_end++;
+      }
+      for(size_t j = i; j < run_end; j++){
+        _dirty_bits[j / BitsPerWord] &= ~((size_t)1 << (j % BitsPerWord));
+      }
+
+      iov[nr_iov].mem_server_id = mem_server_id;
+      iov[nr_iov].write_type    = 0;  // data
+      iov[nr_iov].start_addr    = arena_base() + i * arena_stride();
+      iov[nr_iov].size          = (run_end - i - 1) * arena_stride() + sizeof(E);
+      nr_iov++;
+      i = run_end;
+    }
+
+    return nr_iov;
+  }
+
+
   // commit space on reserved space
  // static char* commit_at(size_t length, MEMFLAGS flags, char* requested_addr)
 
@@ -579,6 +660,10 @@ template <class E , CHeapAllocType Alloc_type>
 size_t CHeapRDMAObj<E, Alloc_type>::_instance_size = 0;
 
 
+template <class E , CHeapAllocType Alloc_type>
+size_t CHeapRDMAObj<E, Alloc_type>::_dirty_bits[RDMA_ARENA_DIRTY_WORDS] = { 0 };
+
+
 
 
 
@@ -0,0 +1,109 @@
+/**
+ * Runtime layout of the RDMA meta space.
+ *
+ */
+
+#ifndef SHARE_GC_SHARED_RDMA_META_LAYOUT
+#define SHARE_GC_SHARED_RDMA_META_LAYOUT
+
+#include "memory/allocation.hpp"
+#include "utilities/globalDefinitions.hpp"
+
+class outputStream;
+
+
+/**
+ * Semeru - the layout of the RDMA meta space, computed at startup.
+ *
+ * [SEMERU_START_ADDR, SEMERU_START_ADDR + RDMA_STRUCTURE_SPACE_SIZE) is still sized at compile time,
+ * the kernel module and the start of the data space depend on it. It starts the address window of the JVM.
+ *
+ * 1) Fixed part, globalDefinitions.hpp.
+ *    The No-Swap-Part, the Klass instance space and the BOT global struct.
+ *    The kernel block path writes to FLAGS_OF_CPU_WRITE_CHECK_OFFSET directly.
+ *    The per-Region zones are checked against the Region number here.
+ *
+ * 2) Runtime part, [BLOCK_OFFSET_TABLE_OFFSET, used_size()).
+ *    Sized by the Semeru heap, the Region size and the number of memory servers :
+ *    a. Block Offset Table, 1 byte per 512 bytes card.
+ *    b. Cross-Region reference target queues, one BitQueue per Region, 1 bit per HeapWord.
+ *    c. Wire buffers, SEMERU_WIRE_BUFFER_SIZE per memory server, gc/shared/rdmaWireCodec.hpp.
+ *    d. Task queue chunks, SEMERU_TASK_QUEUE_CHUNK_ZONE_SIZE per memory server, task_queue_chunk_zone.
+ *
+ * The space behind used_size() is neither committed nor registered as RDMA buffer.
+ *
+ * The memory servers always map the whole data space, so the layout covers it,
+ * and the CPU server's -Xmx has to fit into it.
+ * Both sides compute the layout separately. The CPU server sends its digest
+ * as the private data of the RDMA connect request, and the memory server
+ * rejects the connection if the digest doesn't match its own layout.
+ * The kernel module connects before the JVM starts, its digest only carries
+ * the topology and the heap size, SEMERU_META_LAYOUT_KERNEL_MAGIC.
+ *
+ * The last page of the meta space is never used, it's the no-access prefix
+ * of the Semeru compressed oops, SEMERU_NARROW_OOP_BASE.
+ */
+
+
+#define SEMERU_META_LAYOUT_MAGIC  0x534d4c59   // "SMLY"
+// Sent by the kernel module, it only knows mem_server_num and heap_size, the rest are 0.
+#define SEMERU_META_LAYOUT_KERNEL_MAGIC  0x534d4c4b   // "SMLK"
+
+// Carried by the RDMA CM private data, at most 56 bytes for RC.
+// Keep the same with the Memory server, gc/shared/rdmaMetaLayout.hpp
+struct semeru_meta_layout_digest {
+  uint32_t magic;
+  uint32_t mem_server_num;
+  uint64_t heap_size;
+  uint64_t region_size;
+  uint64_t used_size;
+  uint32_t use_compressed_oops;   // the object layout of the Semeru heap
+  uint32_t obj_alignment;
+};
+
+
+class SemeruMetaLayout : AllStatic {
+private:
+  static bool   _initialized;
+  static size_t _heap_size;       // bytes of the Semeru heap covered by the layout.
+  static size_t _region_size;     // bytes of a heap Region.
+  static uint   _mem_server_num;
+
+  static size_t _block_offset_table_size;
+  static size_t _cross_region_ref_target_q_offset;
+  static size_t _cross_region_ref_target_q_len;     // size_t entries of each BitQueue
+  static size_t _cross_region_ref_target_q_size;    // the whole zone
+  static size_t _wire_buffer_offset;
+  static size_t _task_queue_chunk_offset;
+  static size_t _used_size;
+
+public:
+  // Invoke it before any CHeapRDMAObj is allocated into the Swap-Part.
+  static void initialize(size_t region_size, uint mem_server_num);
+  static bool is_initialized()  { return _initialized; }
+
+  static size_t heap_size()       { assert(_initialized, "RDMA meta layout is not initialized."); return _heap_size; }
+  static size_t region_size()     { assert(_initialized, "RDMA meta layout is not initialized."); return _region_size; }
+  static size_t num_regions()     { return heap_size() / region_size(); }
+
+  static size_t block_offset_table_size()           { assert(_initialized, "RDMA meta layout is not initialized."); return _block_offset_table_size; }
+  static size_t cross_region_ref_target_q_offset()  { assert(_initialized, "RDMA meta layout is not initialized."); return _cross_region_ref_target_q_offset; }
+  static size_t cross_region_ref_target_q_len()     { assert(_initialized, "RDMA meta layout is not initialized."); return _cross_region_ref_target_q_len; }
+  static size_t cross_region_ref_target_q_size()    { assert(_initialized, "RDMA meta layout is not initialized."); return _cross_region_ref_target_q_size; }
+  static size_t wire_buffer_offset()                { assert(_initialized, "RDMA meta layout is not initialized."); return _wire_buffer_offset; }
+  static size_t task_queue_chunk_offset()           { assert(_initialized, "RDMA meta layout is not initialized."); return _task_queue_chunk_offset; }
+
+  // The committed size of one BitQueue, the page aligned instance plus its bitmap.
+  static size_t cross_region_ref_target_q_commit_size();
+
+  // [0, used_size()) of the meta space is committed and registered as RDMA buffer.
+  static size_t used_size()       { assert(_initialized, "RDMA meta layout is not initialized."); return _used_size; }
+
+  static void fill_digest(struct semeru_meta_layout_digest* digest);
+  static bool match_digest(const struct semeru_meta_layout_digest* digest);
+
+  static void print_on(outputStream* st);
+};
+
+
+#endif // SHARE_GC_SHARED_RDMA_META_LAYOUT
@@ -4,69 +4,58 @@
  */
 
 #include "gc/shared/rdmaStructure.inline.hpp"   // why can't find this header by using shared/rdmaStructure.hpp
+#include "gc/shared/rdmaMetaLayout.hpp"
 
 
 
 
 
 //
-// Structure - TaskQueueRDMASuper
+// Structure - task_queue_chunk_zone
 //
 
-
-
-
-//
-// Structure - GenericTaskQueueRDMA
-//
-
-
-
-
-
-
-
-
-template<class E, CHeapAllocType Alloc_type, unsigned int N>
-int GenericTaskQueueRDMA<E, Alloc_type, N>::next_random_queue_id() {
-  return randomParkAndMiller(&_seed);  // defined in taskqueue.inlinel.hpp
+// The memory servers own the zones, the CPU server only reads their directories.
+task_queue_chunk_zone* task_queue_chunk_zone::at(size_t mem_id) {
+  assert(mem_id < MAX_NUM_OF_MEMORY_SERVER, "%s, wrong memory server id %lu", __func__, mem_id);
+  return (task_queue_chunk_zone*)(SEMERU_START_ADDR + SemeruMetaLayout::task_queue_chunk_offset() +
+                                  mem_id * SEMERU_TASK_QUEUE_CHUNK_ZONE_SIZE);
 }
 
 
 
-
-
-
-
-
-//
-// OverflowTargetObjQueue
-//
-
-
-
-
-
-
-
-
-
-
-// The size of the flexible array _region_cset[] is limited by global macro, utilities/globalDefinitions.hpp :
-//	#define MEMORY_SERVER_CSET_OFFSET     (size_t)0x8000000   // +128MB
-//	#define MEMORY_SERVER_CSET_SIZE       (size_t)0x1000      // 4KB 
+// The header page, MEMORY_SERVER_CSET_HEADER_SIZE. The overflow pages behind it are written by the CPU server.
 received_memory_server_cset::received_memory_server_cset(){
-	
+	STATIC_ASSERT(sizeof(received_memory_server_cset) <= MEMORY_SERVER_CSET_HEADER_SIZE);
+
 	reset(); // reset fields.
-	
+	for(int i = 0; i < MAX_NUM_OF_MEMORY_SERVER; i++){
+		_slots[i]._seq = 0;
+	}
 }
 
 
 
 flags_of_cpu_server_state::flags_of_cpu_server_state():
 _is_cpu_server_in_stw(false),
-_cpu_server_data_sent(false)
+_cpu_server_data_sent(false),
+_state_seq(0),
+_stw_budget_us(0),
+_num_granted_regions(0),
+_region_state_atomics(false),
+_remote_ref_processing(false),
+_soft_ref_clock(0),
+_soft_ref_max_interval(0),
+_remote_string_dedup(false),
+_string_klass(NULL),
+_byte_array_klass(NULL),
+_checksum_sample_percent(0)
 {
+	STATIC_ASSERT(sizeof(flags_of_cpu_server_state) <= FLAGS_OF_CPU_SERVER_STATE_SIZE);
+	for (int i = 0; i < MAX_NUM_OF_MEMORY_SERVER; i++) {
+		_pending_ref_chains_acked_epoch[i] = 0;
+		_pending_ref_chains_acked[i] = 0;
+	}
+
 	
 	// debug
 	#ifdef ASSERT
@@ -80,8 +69,14 @@ _cpu_server_data_sent(false)
 flags_of_mem_server_state::flags_of_mem_server_state():
 _mem_server_wait_on_data_exchange(false),
 _is_mem_server_in_compact(false),
-_compacted_region_length(0)
+_state_seq(0),
+_reserved_pending_ref_chains(0),
+_pending_ref_chains_epoch(0),
+_num_pending_ref_chains(0),
+_timeline_window(0),
+_num_timeline_events(0)
 {
+	STATIC_ASSERT(sizeof(flags_of_mem_server_state) <= FLAGS_OF_MEM_SERVER_STATE_SIZE);
 	
 	// debug
 	#ifdef ASSERT
@@ -11,7 +11,11 @@
 #include "utilities/sizes.hpp"
 #include "utilities/globalDefinitions.hpp"
 #include "gc/shared/rdmaAllocation.hpp"
+#include "gc/shared/rdmaMetaLayout.hpp"
+#include "runtime/rdma_cp_comm.hpp"
 #include "gc/shared/taskqueue.hpp"
+#include "runtime/orderAccess.hpp"
+#include "runtime/os.hpp"
 #include "utilities/formatBuffer.hpp"
 #include "utilities/quickSort.hpp"
 
@@ -29,269 +33,86 @@
 
 
 /**
- * Semeru - Support RDMA data transfer for this structure.
- *  
- * 		1) This object should be allocated at fixed address.
- * 		2) Parts of its fields also allocated at fixe address, just behind the instance.
- * 
+ * Semeru - the chunk zone of the task queues of a memory server, SEMERU_TASK_QUEUE_CHUNK_ZONE_SIZE bytes at
+ *  SemeruMetaLayout::task_queue_chunk_offset() + mem_id * SEMERU_TASK_QUEUE_CHUNK_ZONE_SIZE.
+ *
+ * [ header | one slot per chunk | chunks of SEMERU_TASK_QUEUE_CHUNK_SIZE bytes ]
+ *  The header and the slots are the chunk directory, a peer reads it in one RDMA read and then
+ *  only the used bytes of the chunks it wants. The slot of a chunk has its owning queue and its used elements.
+ *
+ * A queue takes a chunk from the free list when its chunks are full and gives it back once drained,
+ * so a queue holds as many chunks as its tasks need, and all the queues of the memory server share the zone.
+ * A zone without free chunk spills into chunks of the C-heap, the same for the queues, but out of the
+ * directory, _num_spilled tells a peer that the directory misses some tasks.
+ *
+ * Keep the same layout with the memory server, gc/shared/rdmaStructure.hpp
  */
-template <class E, unsigned int N, CHeapAllocType Alloc_type>
-class TaskQueueRDMASuper: public CHeapRDMAObj<E, Alloc_type> {
-protected:
-  // Internal type for indexing the queue; also used for the tag.
-  typedef NOT_LP64(uint16_t) LP64_ONLY(uint32_t) idx_t;
-
-  // The first free element after the last one pushed (mod N).
-  volatile uint _bottom;  // [x] points to the first free/available slot.
-
-  enum { MOD_N_MASK = N - 1 };
-
-  // Tag : Used for work stealing. 
-  // If other threads steal an elem by pop_global, _age.top++.
-  //
-  class Age {
-  public:
-    Age(size_t data = 0)         { _data = data; }
-    Age(const Age& age)          { _data = age._data; }
-    Age(idx_t top, idx_t tag)    { _fields._top = top; _fields._tag = tag; }
-
-    Age   get()        const volatile { return _data; }
-    void  set(Age age) volatile       { _data = age._data; }
-
-    idx_t top()        const volatile { return _fields._top; }
-    idx_t tag()        const volatile { return _fields._tag; }
-
-    // Increment top; if it wraps, increment tag also.
-    void increment() {
-      _fields._top = increment_index(_fields._top);
-      if (_fields._top == 0) ++_fields._tag;
-    }
-
-    Age cmpxchg(const Age new_age, const Age old_age) volatile;
-
-    bool operator ==(const Age& other) const { return _data == other._data; }
-
-  private:
-
-    // [?] What's the purpose of _top and _tag ?
-    //
-    struct fields {
-      idx_t _top;
-      idx_t _tag;
-    };
+struct task_queue_chunk_slot {
+  volatile uint32_t _queue;     // the owning queue, NoQueue for a free chunk
+  volatile uint32_t _used;      // elements in the chunk
+  uint32_t          _next;      // the free list, or the full chunks of the owning queue
+  uint32_t          _pad;
+};
 
-    union {
-      size_t _data;
-      fields _fields;
-    };
+class task_queue_chunk_zone : public CHeapRDMAObj<task_queue_chunk_zone>{
+public :
+  static const uint32_t NoChunk    = (uint32_t)-1;
+  static const uint32_t NoQueue    = (uint32_t)-1;
+  static const uint32_t SpillChunks = 256;    // C-heap chunks allocated together
+  static const uint32_t MaxSpills   = 1024;
+
+  uint32_t          _num_chunks;        // in the zone, indexes [0, _num_chunks)
+  uint32_t          _chunks_offset;     // of the first chunk from this, the size of the directory
+  volatile uint32_t _num_free;
+  volatile uint32_t _num_spilled;       // C-heap chunks, indexes [_num_chunks, _num_chunks + _num_spilled)
+  volatile uint32_t _next_queue_id;
+
+  // Local to the memory server.
+  volatile int      _lock ATTRIBUTE_ALIGNED(RDMA_ALIGNMENT_BYTES);   // the free list and the spill blocks
+  uint32_t          _free;              // head of the free list
+  struct Spill {
+    task_queue_chunk_slot _slots[SpillChunks];
+    char*                 _chunks;
   };
+  Spill* volatile   _spills[MaxSpills];
 
-  volatile Age _age;  // Used for work streal. _age._top points to the first inserted item.
-
-
+  task_queue_chunk_slot _slots[] ATTRIBUTE_ALIGNED(RDMA_ALIGNMENT_BYTES);
 
+  task_queue_chunk_zone();
 
-	// End of fields.
+  // The zone of mem_id in the meta space.
+  static task_queue_chunk_zone* at(size_t mem_id);
 
+  // Bytes a peer reads for the directory.
+  size_t directory_size() const { return _chunks_offset; }
 
-  // These both operate mod N.
-  static uint increment_index(uint ind) {
-    return (ind + 1) & MOD_N_MASK;
-  }
-  static uint decrement_index(uint ind) {
-    return (ind - 1) & MOD_N_MASK;
-  }
-
-  // Returns a number in the range [0..N).  If the result is "N-1", it should be
-  // interpreted as 0.
-  //
-  // [?] dirty_size means the pushed and not handled element size ??
-  //
-  uint dirty_size(uint bot, uint top) const {
-    return (bot - top) & MOD_N_MASK;    // -1 & MOD_N_MASK  = MOD_N_MASK (N-1).
-  }
-
-  // Returns the size corresponding to the given "bot" and "top".
-  //
-  // [?] Same with dirty_size, except for the boundary case. 
-  //
-  uint size(uint bot, uint top) const {
-    uint sz = dirty_size(bot, top);     // (_bottom - _top) & MOD_N_MASK
-    // Has the queue "wrapped", so that bottom is less than top?  There's a
-    // complicated special case here.  A pair of threads could perform pop_local
-    // and pop_global operations concurrently, starting from a state in which
-    // _bottom == _top+1.  The pop_local could succeed in decrementing _bottom,
-    // and the pop_global in incrementing _top (in which case the pop_global
-    // will be awarded the contested queue element.)  The resulting state must
-    // be interpreted as an empty queue.  (We only need to worry about one such
-    // event: only the queue owner performs pop_local's, and several concurrent
-    // threads attempting to perform the pop_global will all perform the same
-    // CAS, and only one can succeed.)  Any stealing thread that reads after
-    // either the increment or decrement will see an empty queue, and will not
-    // join the competitors.  The "sz == -1 || sz == N-1" state will not be
-    // modified by concurrent queues, so the owner thread can reset the state to
-    // _bottom == top so subsequent pushes will be performed normally.
-    return (sz == N - 1) ? 0 : sz;
-  }
-
-public:
-  TaskQueueRDMASuper() : _bottom(0), _age() {}
-
-  // Return true if the TaskQueue contains/does not contain any tasks.
-  bool peek()     const { return _bottom != _age.top(); }
-  bool is_empty() const { return size() == 0; }
-
-  // Return an estimate of the number of elements in the queue.
-  // The "careful" version admits the possibility of pop_local/pop_global
-  // races.
-  uint size() const {
-    return size(_bottom, _age.top());
-  }
-
-  uint dirty_size() const {
-    return dirty_size(_bottom, _age.top());
+  inline task_queue_chunk_slot* slot(uint32_t i) {
+    if (i < _num_chunks) {
+      return &_slots[i];
+    }
+    i -= _num_chunks;
+    return &OrderAccess::load_acquire(&_spills[i / SpillChunks])->_slots[i % SpillChunks];
   }
 
-  void set_empty() {
-    _bottom = 0;
-    _age.set(0);
+  inline char* chunk(uint32_t i) {
+    if (i < _num_chunks) {
+      return (char*)this + _chunks_offset + (size_t)i * SEMERU_TASK_QUEUE_CHUNK_SIZE;
+    }
+    i -= _num_chunks;
+    return OrderAccess::load_acquire(&_spills[i / SpillChunks])->_chunks + (size_t)(i % SpillChunks) * SEMERU_TASK_QUEUE_CHUNK_SIZE;
   }
 
-  // Maximum number of elements allowed in the queue.  This is two less
-  // than the actual queue size, for somewhat complicated reasons.
-  uint max_elems() const { return N - 2; }
-
-  // Total size of queue.
-  static const uint total_size() { return N; }
-
-  TASKQUEUE_STATS_ONLY(TaskQueueStats stats;)
-};
-
+  uint32_t new_queue_id() { return Atomic::add(1u, &_next_queue_id) - 1; }
 
+  // MT safe. An empty chunk owned by queue.
+  uint32_t allocate(uint32_t queue);
+  void     release(uint32_t i);
 
-
-// Semeru Copy the implementation of the Orginal GenericTaskQueue.
-// But changed their allocation policy.
-//
-//
-// GenericTaskQueue implements an ABP, Aurora-Blumofe-Plaxton, double-
-// ended-queue (deque), intended for use in work stealing. Queue operations
-// are non-blocking.
-//
-// A queue owner thread performs push() and pop_local() operations on one end
-// of the queue, while other threads may steal work using the pop_global()
-// method.
-//
-// The main difference to the original algorithm is that this
-// implementation allows wrap-around at the end of its allocated
-// storage, which is an array.
-//
-// The original paper is:
-//
-// Arora, N. S., Blumofe, R. D., and Plaxton, C. G.
-// Thread scheduling for multiprogrammed multiprocessors.
-// Theory of Computing Systems 34, 2 (2001), 115-144.
-//
-// The following paper provides an correctness proof and an
-// implementation for weakly ordered memory models including (pseudo-)
-// code containing memory barriers for a Chase-Lev deque. Chase-Lev is
-// similar to ABP, with the main difference that it allows resizing of the
-// underlying storage:
-//
-// Le, N. M., Pop, A., Cohen A., and Nardell, F. Z.
-// Correct and efficient work-stealing for weak memory models
-// Proceedings of the 18th ACM SIGPLAN symposium on Principles and
-// practice of parallel programming (PPoPP 2013), 69-80
-//
-
-template <class E, CHeapAllocType Alloc_type, unsigned int N = TASKQUEUE_SIZE>
-class GenericTaskQueueRDMA: public TaskQueueRDMASuper<E, N, Alloc_type> {
-
-
-protected:
-  typedef typename TaskQueueRDMASuper<E, N, Alloc_type>::Age Age;       // [?] What's the Age used for ? Work steal related.
-  typedef typename TaskQueueRDMASuper<E, N, Alloc_type>::idx_t idx_t;   // [?] purpose ?
-
-  using TaskQueueRDMASuper<E, N, Alloc_type>::_bottom;            // points to the first available slot.
-  using TaskQueueRDMASuper<E, N, Alloc_type>::_age;               // _age._top, points to the first inserted item. Usd by working steal.
-  using TaskQueueRDMASuper<E, N, Alloc_type>::increment_index;
-  using TaskQueueRDMASuper<E, N, Alloc_type>::decrement_index;
-  using TaskQueueRDMASuper<E, N, Alloc_type>::dirty_size;         // [?] Definition of dirty ??
-
-public:
-  using TaskQueueRDMASuper<E, N, Alloc_type>::max_elems;      // N-2, 2 slots are reserved for "complicated" reasons.
-  using TaskQueueRDMASuper<E, N, Alloc_type>::size;           // _bottom - _top
-
-#if  TASKQUEUE_STATS
-  using TaskQueueRDMASuper<E, N, Alloc_type>::stats;
-#endif
-
-private:
-  // Slow paths for push, pop_local.  (pop_global has no fast path.)
-  bool push_slow(E t, uint dirty_n_elems);
-  bool pop_local_slow(uint localBot, Age oldAge);
-
-public:
-  typedef E element_type;
-
-  // Initializes the queue to empty.
-  GenericTaskQueueRDMA();
-
-  void initialize();
-
-  // Push the task "t" on the queue.  Returns "false" iff the queue is full.
-  inline bool push(E t);
-
-  // Attempts to claim a task from the "local" end of the queue (the most
-  // recently pushed) as long as the number of entries exceeds the threshold.
-  // If successful, returns true and sets t to the task; otherwise, returns false
-  // (the queue is empty or the number of elements below the threshold).
-  inline bool pop_local(volatile E& t, uint threshold = 0);
-
-  // Like pop_local(), but uses the "global" end of the queue (the least
-  // recently pushed).
-  bool pop_global(volatile E& t);
-
-  // Delete any resource associated with the queue.
-  ~GenericTaskQueueRDMA();
-
-  // Apply fn to each element in the task queue.  The queue must not
-  // be modified while iterating.
-  template<typename Fn> void iterate(Fn fn);
-
-  // Promote to public
-  volatile E* _elems;       // [x] The real content, class pointer buffer, of the GenericTaskQueueRDMA. 
-  
-private:
-  DEFINE_PAD_MINUS_SIZE(0, DEFAULT_CACHE_LINE_SIZE, 0);
-  // Element array.
-  //volatile E* _elems;       // [x] The real content, buffer, of the GenericTaskQueue. 
-
-  DEFINE_PAD_MINUS_SIZE(1, DEFAULT_CACHE_LINE_SIZE, sizeof(E*));
-  // Queue owner local variables. Not to be accessed by other threads.
-
-  static const uint InvalidQueueId = uint(-1);
-  uint _last_stolen_queue_id; // The id of the queue we last stole from
-
-  int _seed; // Current random seed used for selecting a random queue during stealing.
-
-  DEFINE_PAD_MINUS_SIZE(2, DEFAULT_CACHE_LINE_SIZE, sizeof(uint) + sizeof(int));
-public:
-  int next_random_queue_id();
-
-  void set_last_stolen_queue_id(uint id)     { _last_stolen_queue_id = id; }
-  uint last_stolen_queue_id() const          { return _last_stolen_queue_id; }
-  bool is_last_stolen_queue_id_valid() const { return _last_stolen_queue_id != InvalidQueueId; }
-  void invalidate_last_stolen_queue_id()     { _last_stolen_queue_id = InvalidQueueId; }
+  // The spin locks of the zone and of the queues, held for a few stores.
+  static void lock(volatile int* l);
+  static void unlock(volatile int* l);
 };
 
-// The constructor of GenericTaskQueueRDMA
-template<class E, CHeapAllocType Alloc_type, unsigned int N>
-GenericTaskQueueRDMA<E, Alloc_type, N>::GenericTaskQueueRDMA() : 
-_last_stolen_queue_id(InvalidQueueId), 
-_seed(17 /* random number */) {
-  assert(sizeof(Age) == sizeof(size_t), "Depends on this.");
-}
 
 
 
@@ -301,154 +122,107 @@ _seed(17 /* random number */) {
 
 
 /**
- *  Target Object Queue, same as OverflowTaskQueue. But it's allocated at specific address.
- *  This strcuture is transfered by RDMA.
- *  
- *  [x] The last field of current class is _overflow_stack, not a flexible array.
- * 
+ * The memory server CSet, MEMORY_SERVER_CSET_OFFSET. A header page plus the overflow pages of each memory server.
+ *
+ * 1) The header page has one slot of MEMORY_SERVER_CSET_SLOT_SIZE bytes per memory server, on its own cache lines :
+ *    <_num_regions, _seq, the first MEM_SERVER_CSET_INLINE_REGIONS Region indexes>
+ *    The overflow pages of a memory server, MEMORY_SERVER_CSET_OVERFLOW_PAGES, keep the rest of its CSet.
+ * 2) The CPU server writes the used overflow pages of a memory server first, then the header page as the signal.
+ *    A CSet within the header slot costs one page, the same as before.
+ * 3) _seq is bumped by each CSet sent to the memory server. The memory server only dispatches a new sequence,
+ *    and takes the Regions by _num_regions, decreased by pop(), consumer.
+ * 4) Neither side is MT safe, only one thread produces or consumes the CSet of a memory server.
+ * 5) The layout is fixed for MAX_NUM_OF_MEMORY_SERVER, keep it the same on the CPU server and the memory servers.
+ *    Only the first SemeruMemServerNum slots are used.
  */
-template<class E, CHeapAllocType Alloc_type, unsigned int N = TASKQUEUE_SIZE>
-class OverflowTargetObjQueue: public GenericTaskQueueRDMA<E, Alloc_type, N>
-{
-public:
-  typedef Stack<E, mtGC>               overflow_t;     // Newly added overflow stack. no size limitation ??
-  typedef GenericTaskQueueRDMA<E, Alloc_type, N> taskqueue_t;    // Content is E* _elem, length is N, Mem_type is F.
-
-  // The start address for current OverflowTargetObjQueue instance, is this.
-  // GenericTaskQueue->(E*)_elems is the Content for every single GenericTaskQueue<E, F, N> taskqueue_t.
-  size_t  _region_index; // Corresponding the HeapRegion->index.
-
-  TASKQUEUE_STATS_ONLY(using taskqueue_t::stats;)
-
-  OverflowTargetObjQueue(); // Constructor.
-
-  // newly defined initialize() function for space allocation.
-  // Commit space for the GenericTaskQueueRDMA->(Class E*)_elem, just behind current class instance.
-  void initialize(size_t q_index);  
+#define MEM_SERVER_CSET_INLINE_REGIONS \
+  ((MEMORY_SERVER_CSET_SLOT_SIZE - sizeof(size_t) - sizeof(uint32_t)) / sizeof(uint))
+#define MEM_SERVER_CSET_OVERFLOW_REGIONS \
+  (MEMORY_SERVER_CSET_OVERFLOW_PAGES * PAGE_SIZE / sizeof(uint))
+#define MEM_SERVER_CSET_REGION_NUM \
+  (MEM_SERVER_CSET_INLINE_REGIONS + MEM_SERVER_CSET_OVERFLOW_REGIONS)
 
-  // Push task t onto the queue or onto the overflow stack.  Return true.
-  inline bool push(E t);
-  // Try to push task t onto the queue only. Returns true if successful, false otherwise.
-  inline bool try_push_to_taskqueue(E t);
-
-  // Attempt to pop from the overflow stack; return true if anything was popped.
-  inline bool pop_overflow(E& t);
-
-  inline overflow_t* overflow_stack() { return &_overflow_stack; }
-
-  inline bool taskqueue_empty() const { return taskqueue_t::is_empty(); }
-  inline bool overflow_empty()  const { return _overflow_stack.is_empty(); }
-  inline bool is_empty()        const {
-    return taskqueue_empty() && overflow_empty();
-  }
-
-  // Debug, the used slots of generic queue
-  inline uint bottom() const {return taskqueue_t::_bottom;}
-
-private:
-  overflow_t _overflow_stack;     // The Stack<E,F>
-};
-
-
-
-
-
-
-
-
-
-/**
- * Limit the instance size within 4KB 
- * 
- * size_t, unsigned long, 8 bytes.
- * 
- * 1) CPU server send data to rewrite the value of _num_regions and _regions_cset[].
- * 		This instance has to be allocated in a fixed memory range, reserved by both CPU server and memory server.
- * 2) Use _num_regions as flag of if new data are written here by CPU server, producer.
- * 		Also use _num_regions to index the content of _region_cset[], decreased by Memory server, consumer.
- * 3) This function is not MT safe. We ausme that only one thread can invoke this function.
- * 4) This structure is designed to support multiple Memory Servers.
- * 
- */
 class received_memory_server_cset : public CHeapRDMAObj<received_memory_server_cset>{
+public :
+  struct cset_slot {
+    volatile size_t   _num_regions;
+    volatile uint32_t _seq;
+    volatile uint     _regions[MEM_SERVER_CSET_INLINE_REGIONS];
+  } ATTRIBUTE_ALIGNED(RDMA_ALIGNMENT_BYTES);
 
 private :
-	// First field, identify if CPU server pushed new Regions here.
-	volatile size_t 	_num_regions[NUM_OF_MEMORY_SERVER];
-
-
-public :
-	// [x] a flexible array, points the memory just behind this instance.
-	// The size of current instance should be limited within 4K, 
-	// The array size should be limited by MEM_SERVER_CSET_BUFFER_SIZE.
-  // 	within 4KB, support 64GB per memory server. e.g. 512M per Region
-	volatile uint	_region_cset[NUM_OF_MEMORY_SERVER][128];    
+  cset_slot _slots[MAX_NUM_OF_MEMORY_SERVER];    // the header page
 
-  //
-  // Do NOT declare any variables behind _regions_cset[][] !!
-  //
-	
-	received_memory_server_cset();
-	
-	volatile size_t*	num_received_regions(size_t mem_id)	    {	return &_num_regions[mem_id];	}
-  uint              num_of_enqueued_regions(size_t mem_id)  { return _num_regions[mem_id]; }
+  // The overflow pages of mem_id, just behind the header page.
+  volatile uint* overflow_of(size_t mem_id) {
+    return (volatile uint*)((char*)this + MEMORY_SERVER_CSET_HEADER_SIZE + mem_id * MEMORY_SERVER_CSET_OVERFLOW_PAGES * PAGE_SIZE);
+  }
 
-	// Allocate the _region_cset just behind this instance ?
-	// void initialize(){
-	// 	_num_regions = 0;
-	// }
+  volatile uint* addr_of(size_t mem_id, size_t i) {
+    return i < MEM_SERVER_CSET_INLINE_REGIONS ? &_slots[mem_id]._regions[i]
+                                              : overflow_of(mem_id) + (i - MEM_SERVER_CSET_INLINE_REGIONS);
+  }
 
+public :
+  received_memory_server_cset();
 
+  volatile size_t*  num_received_regions(size_t mem_id)   { return &_slots[mem_id]._num_regions; }
+  uint              num_of_enqueued_regions(size_t mem_id) { return _slots[mem_id]._num_regions; }
+  uint32_t          seq(size_t mem_id)                     { return OrderAccess::load_acquire(&_slots[mem_id]._seq); }
 
-	void reset(){	
-    int i;
-    for(i=0; i<NUM_OF_MEMORY_SERVER; i++){
-      _num_regions[i] = 0;	
+  void reset(){
+    for(int i = 0; i < MAX_NUM_OF_MEMORY_SERVER; i++){
+      _slots[i]._num_regions = 0;
     }
   }
 
   void reset_cset_for_target_mem(size_t mem_id){
-    _num_regions[mem_id]  = 0;
+    _slots[mem_id]._num_regions = 0;
   }
 
-	//
-	// This function isn't MT safe.
-	// 
-	int	pop(size_t mem_id)	{
-		if(_num_regions[mem_id] >= 1)
-			return _region_cset[mem_id][--_num_regions[mem_id]];	
-		else
-			return -1; 
-	}
+  // CPU server, a new CSet for mem_id. Before its pages are written.
+  void bump_seq(size_t mem_id){
+    _slots[mem_id]._seq++;
+  }
 
-    //mhr: modify
-  uint get(size_t mem_id, size_t i) {
-    return _region_cset[mem_id][i];
+  // The used overflow bytes of mem_id, written before the header page. 0 if the CSet fits the header slot.
+  size_t overflow_size(size_t mem_id, char** start){
+    size_t num = _slots[mem_id]._num_regions;
+    *start = (char*)overflow_of(mem_id);
+    return num > MEM_SERVER_CSET_INLINE_REGIONS ? (num - MEM_SERVER_CSET_INLINE_REGIONS) * sizeof(uint) : 0;
   }
 
   //
-  // !! Fix Here !!
-  //  1) Assume 2 memory servers
-  //  2) Assume each JVM region is 512 MB
-  void add( uint region_id) {
-    // Region#0 is meta data region. Data Region is #1 to #8. REGION_SIZE_GB * ONE_GB, e.g. 4GB, per Region.
-    // For JVM,  region size is GrainBytes, e.g. 512MB. 
-    uint region_boundary_id =  (MEMORY_SERVER_1_REGION_START_ID - MEMORY_SERVER_0_REGION_START_ID) * ((REGION_SIZE_GB * ONE_GB)/(512*ONE_MB));
-    int mem_id;
-
-    if( region_id < region_boundary_id){
-      mem_id = 0;
-    }else{
-      mem_id = 1;
-    }
+  // This function isn't MT safe.
+  //
+  int pop(size_t mem_id) {
+    if(_slots[mem_id]._num_regions >= 1)
+      return *addr_of(mem_id, --_slots[mem_id]._num_regions);
+    else
+      return -1;
+  }
 
-    _region_cset[mem_id][_num_regions[mem_id]++] = region_id;
-	}
+  uint get(size_t mem_id, size_t i) {
+    return *addr_of(mem_id, i);
+  }
 
+  // mem_id is the memory server owning the region, HeapRegion::region_to_memory_server_mapping().
+  void add( uint region_id, int mem_id) {
+    assert(mem_id >= 0 && mem_id < MAX_NUM_OF_MEMORY_SERVER, "%s, wrong memory server id %d", __func__, mem_id);
+    guarantee(_slots[mem_id]._num_regions < MEM_SERVER_CSET_REGION_NUM, "%s, CSet of memory server[%d] is full.", __func__, mem_id);
 
+    *addr_of(mem_id, _slots[mem_id]._num_regions++) = region_id;
+  }
 };
 
 
+// One event of the cross-server timeline, -XX:+SemeruTimeline.
+struct semeru_timeline_event {
+  jlong    _ns;     // os::javaTimeNanos() of the recording server
+  uint32_t _type;   // SEMERU_TL_*
+  uint32_t _arg;
+};
+
 /**
  * Memory server need to know the current state of CPU srever to make its own decesion.
  * For example, if the CPU server is in STW GC now, memory server switch to Remark and Compact cm_scanned Regions.
@@ -460,15 +234,70 @@ public :
  * 
  * Size limitations, 1 page,4KB
  * 
+ * Each group of fields starts a RDMA_ALIGNMENT_BYTES line, so an incoming write of one group
+ * doesn't invalidate the line the memory server threads are polling.
  */
 class flags_of_cpu_server_state : public CHeapRDMAObj<flags_of_cpu_server_state>{
 	//private :
   public:
 
-    // CPU server states
+    // CPU server states, polled by the memory server threads.
+    // _state_seq is bumped by each change of _is_cpu_server_in_stw, a poller can tell a missed round trip.
     //
-    volatile bool _is_cpu_server_in_stw;
-    volatile bool _cpu_server_data_sent;
+    volatile bool     _is_cpu_server_in_stw ATTRIBUTE_ALIGNED(RDMA_ALIGNMENT_BYTES);
+    volatile bool     _cpu_server_data_sent;
+    volatile uint32_t _state_seq;
+    // -XX:+SemeruPauseBudget, the remaining MaxGCPauseMillis of the pause when the STW window opens, in us.
+    // The memory servers stop claiming Regions to compact when it runs out. 0, unbounded.
+    volatile uint32_t _stw_budget_us;
+
+    // -XX:+SemeruConcurrentCompact, the fully evicted Regions granted to the memory servers.
+    // Granted at the end of a STW window, closed by the CPU server at the start of the next one.
+    enum GrantState {
+      grant_open      = 1,    // the memory server can compact the Region out of the STW window.
+      grant_committed = 2,    // the Region is intact or reconcilable, the memory server copies its compacted image back.
+      grant_revoked   = 3     // a page is still swapped in, discard the compacted image.
+    };
+
+    volatile size_t _num_granted_regions ATTRIBUTE_ALIGNED(RDMA_ALIGNMENT_BYTES);
+    uint            _granted_regions[SEMERU_MAX_GRANTED_REGIONS];
+    volatile int    _grant_state[SEMERU_MAX_GRANTED_REGIONS];
+    // The pages written back into a committed grant since it was granted, the memory server reconciles them.
+    // Those of _granted_regions[i] are _reconciled_pages[_reconciled_first[i], + _num_reconciled[i]), page indexes within the Region.
+    uint16_t        _reconciled_first[SEMERU_MAX_GRANTED_REGIONS];
+    uint16_t        _num_reconciled[SEMERU_MAX_GRANTED_REGIONS];
+    uint32_t        _reconciled_pages[SEMERU_MAX_RECONCILED_PAGES];   // 1KB
+    // -XX:+SemeruRegionStateAtomics, the grants are also claimed and released by the Region state words.
+    volatile bool   _region_state_atomics;
+
+    // -XX:+SemeruRemoteRefProcessing, the memory servers clear the dead referents of the Regions they compact.
+    // The SoftReference policy of the CPU server, the LRUCurrentHeapPolicy, refreshed at the start of each STW window.
+    volatile bool   _remote_ref_processing ATTRIBUTE_ALIGNED(RDMA_ALIGNMENT_BYTES);
+    volatile jlong  _soft_ref_clock;          // java.lang.ref.SoftReference.clock, ms
+    volatile jlong  _soft_ref_max_interval;   // ms, a SoftReference idle longer than it can be cleared
+
+    // The pending Reference chains taken by the CPU server from each memory server,
+    // see flags_of_mem_server_state::retire_pending_ref_chains().
+    volatile uint   _pending_ref_chains_acked_epoch[MAX_NUM_OF_MEMORY_SERVER] ATTRIBUTE_ALIGNED(RDMA_ALIGNMENT_BYTES);
+    volatile size_t _pending_ref_chains_acked[MAX_NUM_OF_MEMORY_SERVER];
+
+    // -XX:+SemeruRemoteStringDedup, the memory servers merge the value arrays of the Strings they trace.
+    // The klasses of the CPU server, the memory servers read the replicated metadata at the same addresses.
+    volatile bool   _remote_string_dedup ATTRIBUTE_ALIGNED(RDMA_ALIGNMENT_BYTES);
+    Klass* volatile _string_klass;
+    Klass* volatile _byte_array_klass;
+
+    // -XX:SemeruChecksumSamplePercent, the percent of the pages of a compacted Region the memory servers checksum.
+    volatile uint   _checksum_sample_percent;
+
+    // -XX:+SemeruSelectiveInvalidation, the memory servers report the pages each compaction rewrote.
+    volatile bool   _selective_invalidation;
+
+    // -XX:+SemeruPageAffinity, the memory servers link the pages reached from the same root, see page_affinity_table.
+    volatile bool   _page_affinity;
+
+    // -XX:+SemeruTimeline, the memory servers record their events of each STW window.
+    volatile bool   _timeline;
 
 
 	public :
@@ -476,11 +305,33 @@ class flags_of_cpu_server_state : public CHeapRDMAObj<flags_of_cpu_server_state>
 
     //mhr: modify
     //mhr: new
-    inline void	set_cpu_server_in_stw()			{	_is_cpu_server_in_stw = true;		}
-		inline void set_cpu_server_in_mutator()	{	_is_cpu_server_in_stw = false;	}
+    inline void	set_cpu_server_in_stw()			{	_is_cpu_server_in_stw = true;	_state_seq++;	}
+		inline void set_cpu_server_in_mutator()	{	_is_cpu_server_in_stw = false;	_state_seq++;	}
+    inline uint32_t state_seq()             { return _state_seq; }
 
     inline volatile bool is_cpu_server_in_stw()	{	return _is_cpu_server_in_stw;	}
 
+    // The grant state of a Region, 0 if it isn't granted.
+    int grant_state_of(uint region_index) {
+      for (size_t i = 0; i < _num_granted_regions; i++) {
+        if (_granted_regions[i] == region_index) {
+          return _grant_state[i];
+        }
+      }
+      return 0;
+    }
+
+    // The pages of a committed grant to reconcile, 0 if none.
+    uint reconciled_pages_of(uint region_index, const uint32_t** pages) {
+      for (size_t i = 0; i < _num_granted_regions; i++) {
+        if (_granted_regions[i] == region_index) {
+          *pages = &_reconciled_pages[_reconciled_first[i]];
+          return _num_reconciled[i];
+        }
+      }
+      return 0;
+    }
+
 };
 
 
@@ -488,6 +339,12 @@ class flags_of_cpu_server_state : public CHeapRDMAObj<flags_of_cpu_server_state>
  *  Semeru
  *  For CPU server, this is read only class.
  *  4K Bytes.
+ *
+ *  Laid out by writer, each group starts a RDMA_ALIGNMENT_BYTES line :
+ *  1) the states, written by the memory server's CM thread and polled by the CPU server.
+ *  2) the reservation of the pending Reference chains, CAS by the compaction workers.
+ *  3) the published chains, read by the CPU server from _pending_ref_chains_epoch to the end.
+ * The compacted Regions are pushed to the compacted_region_ring.
  */
 class flags_of_mem_server_state : public CHeapRDMAObj<flags_of_mem_server_state>{
 	//private :
@@ -497,32 +354,99 @@ class flags_of_mem_server_state : public CHeapRDMAObj<flags_of_mem_server_state>
     //
 
     // CPU server needs to keep reading the data until this value changed to false.
-    volatile bool _mem_server_wait_on_data_exchange;
+    volatile bool _mem_server_wait_on_data_exchange ATTRIBUTE_ALIGNED(RDMA_ALIGNMENT_BYTES);
 
     volatile bool _is_mem_server_in_compact;
 
-    // Thread same structure
-    // Add a Region into the queue ONLY when its compaction is finished.
-    uint _compacted_regions[128];  // assume max regions num is 128.  512 Bytes.
-    volatile size_t _compacted_region_length;
+    // Bumped by each set_all_flags_to_start_mode()/set_all_flags_to_end_mode().
+    volatile uint32_t _state_seq;
+
+    // -XX:+SemeruRemoteRefProcessing, the References whose referents were cleared here, by compacted Region.
+    // Each chain is linked by the discovered fields, <head, tail> by the new addresses, a NULL head for a dropped chain.
+    // The CPU server links the tail to its pending list and takes the head.
+    // The slots are reserved before the clearing and published in order, the CPU server reads [0, _num_pending_ref_chains).
+    volatile size_t    _reserved_pending_ref_chains ATTRIBUTE_ALIGNED(RDMA_ALIGNMENT_BYTES);
+    volatile uint      _pending_ref_chains_epoch ATTRIBUTE_ALIGNED(RDMA_ALIGNMENT_BYTES);
+    volatile size_t    _num_pending_ref_chains;
+    HeapWord* volatile _pending_ref_chains[SEMERU_MAX_PENDING_REF_CHAINS][2];   // 2KB
+
+    // -XX:+SemeruTimeline, the events of the last STW window, by os::javaTimeNanos() of this memory server.
+    // Restarted when the memory server sees the window, read by the CPU server before it opens the next one.
+    volatile uint32_t     _timeline_window ATTRIBUTE_ALIGNED(RDMA_ALIGNMENT_BYTES);   // the _state_seq of the CPU server
+    volatile uint32_t     _num_timeline_events;
+    semeru_timeline_event _timeline_events[SEMERU_TIMELINE_MS_EVENTS];                 // 512 bytes
 
 	public :
 		flags_of_mem_server_state();
 
 
     inline volatile bool is_mem_server_in_compact()  { return _is_mem_server_in_compact; }
-    inline volatile size_t mem_server_compcated_region_length() { return _compacted_region_length;  }
+    inline uint32_t state_seq()                      { return _state_seq; }
+
+    // -XX:+SemeruTimeline, nothing is recorded before the first timeline_start().
+    // The events beyond SEMERU_TIMELINE_MS_EVENTS are dropped. MT safe.
+    inline void timeline_start(uint32_t window){
+      _num_timeline_events = 0;
+      OrderAccess::release_store(&_timeline_window, window);
+    }
 
-    // Add a claimed Region index.
-    // MT safe.
-    inline void add_claimed_region(uint region_index){
+    inline void timeline_record(uint32_t type, uint32_t arg, jlong ns = 0){
+      if(_timeline_window == 0){
+        return;
+      }
+      uint32_t i = Atomic::add(1u, &_num_timeline_events) - 1;
+      if(i < SEMERU_TIMELINE_MS_EVENTS){
+        _timeline_events[i]._ns   = ns != 0 ? ns : os::javaTimeNanos();
+        _timeline_events[i]._type = type;
+        _timeline_events[i]._arg  = arg;
+      }
+    }
+
+    // Reserve a slot for a Region's chain of cleared References. MT safe.
+    // False if all the slots are taken, the Region's referents can't be cleared in this window.
+    inline bool reserve_pending_ref_chain(size_t* slot){
       size_t available_slot;
 
       do{
-        available_slot = _compacted_region_length;
-      }while( Atomic::cmpxchg(available_slot+1, &_compacted_region_length, available_slot ) != available_slot );
+        available_slot = _reserved_pending_ref_chains;
+        if(available_slot >= SEMERU_MAX_PENDING_REF_CHAINS){
+          return false;
+        }
+      }while( Atomic::cmpxchg(available_slot+1, &_reserved_pending_ref_chains, available_slot ) != available_slot );
+
+      *slot = available_slot;
+      return true;
+    }
 
-      _compacted_regions[available_slot] = region_index;
+    // Publish the chain of a reserved slot, after the slots in front of it.
+    inline void publish_pending_ref_chain(size_t slot, HeapWord* head, HeapWord* tail){
+      _pending_ref_chains[slot][0] = head;
+      _pending_ref_chains[slot][1] = tail;
+
+      while(OrderAccess::load_acquire(&_num_pending_ref_chains) != slot){
+        SpinPause();
+      }
+      OrderAccess::release_store(&_num_pending_ref_chains, slot + 1);
+    }
+
+    /**
+     * Drop the chains taken by the CPU server, at the end of a STW window when all the reserved slots are published.
+     * The CPU server acks the epoch and the number of the chains it read, the ones published after its read are kept.
+     */
+    void retire_pending_ref_chains(flags_of_cpu_server_state* cpu_server_flags, uint mem_id){
+      if(cpu_server_flags->_pending_ref_chains_acked_epoch[mem_id] != _pending_ref_chains_epoch){
+        return;   // not read by the CPU server yet.
+      }
+
+      size_t taken = MIN2(cpu_server_flags->_pending_ref_chains_acked[mem_id], (size_t)_num_pending_ref_chains);
+      size_t left  = _num_pending_ref_chains - taken;
+      for(size_t i = 0; i < left; i++){
+        _pending_ref_chains[i][0] = _pending_ref_chains[taken + i][0];
+        _pending_ref_chains[i][1] = _pending_ref_chains[taken + i][1];
+      }
+      _num_pending_ref_chains      = left;
+      _reserved_pending_ref_chains = left;
+      OrderAccess::release_store(&_pending_ref_chains_epoch, _pending_ref_chains_epoch + 1);
     }
 
 
@@ -539,6 +463,7 @@ class flags_of_mem_server_state : public CHeapRDMAObj<flags_of_mem_server_state>
 
       // Sync #3, all done
       _is_mem_server_in_compact = true;
+      _state_seq++;
 
     }
 
@@ -558,6 +483,7 @@ class flags_of_mem_server_state : public CHeapRDMAObj<flags_of_mem_server_state>
 
       // Sync #3, all done
       _is_mem_server_in_compact = false;
+      _state_seq++;
 
     }
 
@@ -572,8 +498,8 @@ class flags_of_mem_server_state : public CHeapRDMAObj<flags_of_mem_server_state>
  *  with flexbile array.
  * 
  * Reverse 4 bytes for each Region,
- * Assume there are at most 1024 Regions. (The instance can NOT cost space)
- * Reserve 4KB.  Region[index]->write_check_flag = Region_index x 4 bytes.
+ * At most SEMERU_MAX_REGIONS Regions. (The instance can NOT cost space)
+ * Reserve FLAGS_OF_CPU_WRITE_CHECK_SIZE_LIMIT.  Region[index]->write_check_flag = Region_index x 4 bytes.
  *  
  */
 class flags_of_rdma_write_check : public CHeapRDMAObj<flags_of_rdma_write_check>{
@@ -606,6 +532,529 @@ public :
 };
 
 
+/**
+ * Liveness epochs of the Regions, LIVENESS_EPOCH_OFFSET.
+ *  with flexbile array, 4 bytes per Region.
+ *
+ * The memory server bumps a Region's epoch each time its MemoryToCPUAtGC, _cm_scanned and the alive ratio, changes.
+ * The CPU server reads the whole page at the start of a GC, compares it with the epochs it synced last time,
+ * and reads the MemoryToCPUAtGC of the changed Regions by one vectored RDMA read.
+ */
+class region_liveness_epochs : public CHeapRDMAObj<region_liveness_epochs>{
+public :
+  volatile uint32_t _epochs[];
+
+  region_liveness_epochs(char* start, size_t byte_size){
+    memset(start, 0, byte_size);
+  }
+
+  inline uint32_t epoch_of(size_t index) const { return _epochs[index]; }
+};
+
+
+/**
+ * The class loaders of the objects marked by the memory server, CLD_LIVENESS_OFFSET.
+ *  with flexible array, SEMERU_CLD_BITMAP_WORDS words per Region.
+ *
+ * A ClassLoaderData* of the CPU server, read from the replicated Klass, is hashed to one bit of its Region's bitmap.
+ * The memory server clears the bitmap when it claims the Region for tracing, and sets all the bits when the tracing fails.
+ * A set bit may be a collision, so the CPU server only keeps a class loader alive by it, never unloads one.
+ */
+class region_cld_liveness : public CHeapRDMAObj<region_cld_liveness>{
+public :
+  volatile uint64_t _bits[];
+
+  region_cld_liveness(char* start, size_t byte_size){
+    memset(start, 0, byte_size);
+  }
+
+  static inline size_t bit_of(const void* cld) {
+    uint64_t v = (uint64_t)(uintptr_t)cld >> LogHeapWordSize;
+    v ^= v >> 29;
+    v *= (uint64_t)0x9E3779B97F4A7C15ULL;
+    return (size_t)(v >> 32) % (SEMERU_CLD_BITMAP_WORDS * 64);
+  }
+
+  inline volatile uint64_t* bitmap_of(size_t index) { return _bits + index * SEMERU_CLD_BITMAP_WORDS; }
+
+  // CPU server, OR the bitmap of a Region into summary.
+  inline void merge_into(size_t index, uint64_t* summary) {
+    for (int i = 0; i < SEMERU_CLD_BITMAP_WORDS; i++) { summary[i] |= bitmap_of(index)[i]; }
+  }
+
+  static inline bool is_set(const uint64_t* summary, const void* cld) {
+    size_t bit = bit_of(cld);
+    return (summary[bit / 64] & ((uint64_t)1 << (bit % 64))) != 0;
+  }
+};
+
+/**
+ * The Regions compacted by the memory server, COMPACTED_REGION_RING_OFFSET.
+ *  with flexible array, _capacity Region indexes.
+ *
+ * Multiple producers, the compaction workers of the memory server. One consumer, the CPU server, by RDMA.
+ * The positions only grow, a position's slot is pos & (_capacity - 1).
+ * Each index is on its own RDMA_ALIGNMENT_BYTES line, by writer :
+ *  1) _reserved, the positions taken by the workers.
+ *  2) _head, the positions published in order. The CPU server reads this line, then only the slots of [tail, head).
+ *  3) _tail, the positions read by the CPU server. Written back by RDMA, read by the workers to check the room.
+ *
+ * The capacity is derived from the number of Regions, the same on both servers.
+ * A Region is compacted once per grant and the CPU server drains the ring at each STW window, so a full ring
+ * means the CPU server stopped draining. The worker doesn't wait on it, the index is dropped and counted.
+ */
+class compacted_region_ring : public CHeapRDMAObj<compacted_region_ring>{
+public :
+  volatile size_t   _reserved ATTRIBUTE_ALIGNED(RDMA_ALIGNMENT_BYTES);
+  volatile size_t   _dropped;
+
+  volatile size_t   _head ATTRIBUTE_ALIGNED(RDMA_ALIGNMENT_BYTES);
+
+  volatile size_t   _tail ATTRIBUTE_ALIGNED(RDMA_ALIGNMENT_BYTES);
+  size_t            _capacity;
+
+  volatile uint32_t _slots[] ATTRIBUTE_ALIGNED(RDMA_ALIGNMENT_BYTES);
+
+  compacted_region_ring(size_t num_regions) :
+    _reserved(0),
+    _dropped(0),
+    _head(0),
+    _tail(0),
+    _capacity(capacity_for(num_regions)) {
+    guarantee(_capacity <= SEMERU_MAX_COMPACTED_REGION_SLOTS &&
+              sizeof(compacted_region_ring) + _capacity * sizeof(uint32_t) <= COMPACTED_REGION_RING_SIZE_LIMIT,
+              "%s, 0x%lx Regions exceed the compacted Region ring.", __func__, num_regions);
+  }
+
+  static inline size_t capacity_for(size_t num_regions) {
+    size_t capacity = 1;
+    while (capacity < num_regions) {
+      capacity <<= 1;
+    }
+    return capacity;
+  }
+
+  inline size_t slot_of(size_t pos) const { return pos & (_capacity - 1); }
+
+  // Memory server. MT safe.
+  // False if the CPU server hasn't drained the ring, the index is dropped.
+  inline bool push(uint region_index){
+    size_t pos;
+    do{
+      pos = _reserved;
+      if(pos - OrderAccess::load_acquire(&_tail) >= _capacity){
+        Atomic::inc(&_dropped);
+        return false;
+      }
+    }while( Atomic::cmpxchg(pos + 1, &_reserved, pos) != pos );
+
+    _slots[slot_of(pos)] = region_index;
+
+    // Publish after the positions in front of it, the CPU server never reads a reserved but unwritten slot.
+    while(OrderAccess::load_acquire(&_head) != pos){
+      SpinPause();
+    }
+    OrderAccess::release_store(&_head, pos + 1);
+    return true;
+  }
+
+  // CPU server. The slots of [from, to) as at most 2 contiguous ranges, the second one is empty if not wrapped.
+  inline void ranges_of(size_t from, size_t to, size_t* first_len, size_t* second_len) const {
+    size_t len = to - from;
+    *first_len  = MIN2(len, _capacity - slot_of(from));
+    *second_len = len - *first_len;
+  }
+};
+
+
+/**
+ * Region state words, REGION_STATE_OFFSET.
+ *  with flexible array, 8 bytes per Region, |-- 8 bits state --|-- 8 bits flags --|-- 48 bits sequence --|.
+ *
+ * The ownership of a Region granted for the concurrent compaction, -XX:+SemeruRegionStateAtomics.
+ * The CPU server changes the word on the Region's memory server by the RDMA atomics, semeru_cp_cas().
+ * The memory server changes it by the CPU atomics, which are only atomic to the RDMA ones with IBV_ATOMIC_GLOB,
+ * so it sets the claimable flag first and the CPU server never revokes an unclaimable grant by the word.
+ *
+ *  cpu_owned --grant(CPU)--> granted --claim(MS)--> compacting --build(MS)--> compacted --reclaim(CPU)--> cpu_owned
+ *                               |                       |
+ *                               +--revoke(CPU)----------+--reclaim(CPU)--> cpu_owned, the image is discarded.
+ *
+ * Neither side waits for the other. A revoked grant is never claimed, and a reclaimed compaction never finishes,
+ * so the CPU server can take a Region back at any time without a handshake. The kernel fence still decides
+ * whether a finished image is committed. Each grant bumps the sequence, a stale claim fails.
+ *
+ * The CPU server's copy of the words is its last known value of the remote ones, not synced by the RDMA read/write.
+ */
+class region_state_words : public CHeapRDMAObj<region_state_words>{
+public :
+  enum RegionState {
+    cpu_owned   = 0,
+    granted     = 1,
+    compacting  = 2,
+    compacted   = 3
+  };
+
+  static const uint64_t claimable = 0x1;    // flags, set by a memory server with IBV_ATOMIC_GLOB.
+
+  static const int      seq_bits   = 48;
+  static const int      flag_shift = seq_bits;
+  static const int      state_shift = seq_bits + 8;
+  static const uint64_t seq_mask   = ((uint64_t)1 << seq_bits) - 1;
+
+  volatile uint64_t _words[];
+
+  region_state_words(char* start, size_t byte_size){
+    memset(start, 0, byte_size);
+  }
+
+  static inline uint64_t word_of(uint64_t state, uint64_t flags, uint64_t seq) {
+    return (state << state_shift) | ((flags & 0xff) << flag_shift) | (seq & seq_mask);
+  }
+  static inline uint64_t state_of(uint64_t word) { return word >> state_shift; }
+  static inline uint64_t flags_of(uint64_t word) { return (word >> flag_shift) & 0xff; }
+  static inline uint64_t seq_of(uint64_t word)   { return word & seq_mask; }
+
+  inline volatile uint64_t* word_addr(size_t index) { return &_words[index]; }
+  inline uint64_t word(size_t index) const         { return _words[index]; }
+};
+
+/**
+ * The class histogram of the fully evicted Regions, HEAP_HISTOGRAM_OFFSET, -XX:+SemeruRemoteHeapHistogram.
+ *  with flexible array, SEMERU_MAX_HISTOGRAM_KLASSES entries.
+ *
+ * Walking the whole heap for jmap -histo swaps every evicted page back in. The memory servers hold
+ * the complete copy of a fully evicted Region and the klasses are replicated at the same addresses,
+ * so each of them counts its own Regions and the CPU server only walks the resident ones.
+ *
+ * 1) CPU server, at a safepoint. Write the used words of the requested Regions of the memory server,
+ *    0 for the others, then bump _request_seq on its own line, and ring the doorbell.
+ * 2) Memory server. Walk [bottom, bottom + used words) of each requested Region, count the instances and
+ *    words of each klass into the open addressing table _entries, pack them to the front, and publish
+ *    _num_entries by _done_seq = _request_seq.
+ * 3) CPU server. Poll the reply line until _done_seq matches, read [0, _num_entries) and merge them.
+ *    A memory server with more klasses than the entries replies _overflow. Its Regions, and the ones of a
+ *    memory server not replying in time, are walked by the CPU server.
+ */
+class remote_heap_histogram : public CHeapRDMAObj<remote_heap_histogram>{
+public :
+  struct entry {
+    Klass* _klass;
+    size_t _count;
+    size_t _words;
+  };
+
+  // CPU server, the request.
+  uint32_t          _used_words[SEMERU_MAX_REGIONS];
+  volatile uint32_t _request_seq ATTRIBUTE_ALIGNED(RDMA_ALIGNMENT_BYTES);
+
+  // Memory server, the reply.
+  volatile uint32_t _done_seq ATTRIBUTE_ALIGNED(RDMA_ALIGNMENT_BYTES);
+  volatile uint32_t _overflow;
+  volatile size_t   _num_entries;
+  volatile size_t   _num_regions;   // counted Regions
+
+  entry             _entries[] ATTRIBUTE_ALIGNED(RDMA_ALIGNMENT_BYTES);
+
+  remote_heap_histogram() :
+    _request_seq(0),
+    _done_seq(0),
+    _overflow(0),
+    _num_entries(0),
+    _num_regions(0) {
+    guarantee(sizeof(remote_heap_histogram) + SEMERU_MAX_HISTOGRAM_KLASSES * sizeof(entry) <= HEAP_HISTOGRAM_SIZE_LIMIT,
+              "%s, the heap histogram exceeds its zone.", __func__);
+    memset(_used_words, 0, sizeof(_used_words));
+  }
+
+  // The size of the reply line, read by the CPU server.
+  static inline size_t reply_size() { return offset_of(remote_heap_histogram, _entries) - offset_of(remote_heap_histogram, _done_seq); }
+};
+
+/**
+ * The liveness of the Regions, LIVENESS_VECTOR_OFFSET.
+ *  with flexible array, one 32 bytes entry per Region.
+ *
+ * A contiguous copy of the liveness fields of each Region's MemoryToCPUAtGC. The memory server republishes
+ * the entry each time a traced batch changes them, so the CPU server reads the liveness of all the Regions
+ * of a memory server by one RDMA read, -XX:+SemeruLivenessVector.
+ *
+ * An entry is versioned at both ends. The writer makes _version odd, writes the fields, then sets _version_tail
+ * and _version to the next even value. The RDMA read doesn't order the bytes of an entry, so the CPU server
+ * only takes an entry whose two versions are the same and even, and reads the MemoryToCPUAtGC of a torn one.
+ */
+class region_liveness_vector : public CHeapRDMAObj<region_liveness_vector>{
+public :
+  struct entry {
+    volatile uint32_t _version;
+    uint32_t          _cm_scanned;
+    size_t            _marked_alive_bytes;
+    double            _alive_ratio;
+    volatile uint32_t _version_tail;
+    uint32_t          _pad;
+  };
+
+  entry _entries[];
+
+  region_liveness_vector(char* start, size_t byte_size){
+    guarantee(SEMERU_MAX_REGIONS * sizeof(entry) <= LIVENESS_VECTOR_SIZE_LIMIT, "%s, the liveness vector exceeds its zone.", __func__);
+    memset(start, 0, byte_size);
+  }
+
+  // CPU server, the entry is written completely and not being rewritten.
+  static inline bool is_stable(const entry* e) {
+    uint32_t v = e->_version;
+    return (v & 1) == 0 && v == e->_version_tail;
+  }
+};
+
+/**
+ * The remembered set cards of the fully evicted old Regions, REMOTE_CARD_SCAN_OFFSET, -XX:+SemeruRemoteCardScan.
+ *  with flexible array, SEMERU_MAX_REMOTE_SLOTS slots.
+ *
+ * Scanning a card of an evicted Region for the pointers into the CSet swaps in its pages, most of them
+ * only to find no such pointer. The memory server holds the complete copy of a fully evicted Region and
+ * scans the cards there, only the pages of the slots it finds are touched by the evacuation.
+ *
+ * 1) CPU server, serially before the evacuation. Claim the cards of the Regions of a memory server, write them
+ *    as [_block, _start, _end), _block a block start at or before _start from the BOT alone, _end clipped to
+ *    the scan top. _in_cset marks the Regions whose objects are roots, then bump _request_seq and ring the doorbell.
+ * 2) Memory server. Walk the objects from each _block, visit their fields in [_start, _end), record each field
+ *    pointing into an _in_cset Region with its decoded value, and publish _num_slots by _done_seq = _request_seq.
+ * 3) CPU server. Poll the reply line until _done_seq matches, read [0, _num_slots). The evacuation workers
+ *    take the slots as the roots of the cards. On _overflow, or no reply in time, the cards are scanned locally.
+ *
+ * The same layout at REMOTE_REFINE_OFFSET, -XX:+SemeruRemoteRefinement, with _mode Refine. _in_cset isn't used,
+ * every field pointing out of its own Region is recorded, the remembered set entries of the refined cards.
+ *
+ * The full GC, -XX:+SemeruRemoteFullGC, uses the REMOTE_CARD_SCAN_OFFSET line at the safepoint. A Refine request of
+ * one card [bottom, top) collects the outgoing fields of a Region kept in place. After the pointers are adjusted,
+ * an Apply request carries the new values in _slots, the memory server stores them into the fields.
+ *
+ * The concurrent mark, -XX:+SemeruRemoteConcurrentMark, uses the same Refine requests while it scans the root Regions,
+ * the young pauses wait for it. The targets of the fields are marked, the Region itself isn't traced.
+ */
+class remote_card_scan : public CHeapRDMAObj<remote_card_scan>{
+public :
+  struct card {
+    HeapWord* _block;
+    HeapWord* _start;
+    HeapWord* _end;
+  };
+
+  enum Mode {
+    ScanCSet = 0,   // the fields pointing into the _in_cset Regions
+    Refine   = 1,   // the fields pointing into another Region
+    Apply    = 2    // store the _slots written by the CPU server
+  };
+
+  struct slot {
+    void*     _addr;    // the field, an oop* or a narrowOop* as the heap uses
+    HeapWord* _value;   // the decoded object it points to
+  };
+
+  // CPU server, the request.
+  uint8_t           _in_cset[SEMERU_MAX_REGIONS];
+  card              _cards[SEMERU_MAX_REMOTE_CARDS];
+  volatile uint32_t _num_cards;
+  volatile uint32_t _mode;          // written with _num_cards
+  volatile uint32_t _request_seq ATTRIBUTE_ALIGNED(RDMA_ALIGNMENT_BYTES);
+
+  // Memory server, the reply.
+  volatile uint32_t _done_seq ATTRIBUTE_ALIGNED(RDMA_ALIGNMENT_BYTES);
+  volatile uint32_t _overflow;
+  volatile size_t   _num_slots;
+  volatile size_t   _num_scanned;   // cards
+
+  slot              _slots[] ATTRIBUTE_ALIGNED(RDMA_ALIGNMENT_BYTES);
+
+  remote_card_scan() :
+    _num_cards(0),
+    _mode(ScanCSet),
+    _request_seq(0),
+    _done_seq(0),
+    _overflow(0),
+    _num_slots(0),
+    _num_scanned(0) {
+    guarantee(sizeof(remote_card_scan) + SEMERU_MAX_REMOTE_SLOTS * sizeof(slot) <= REMOTE_CARD_SCAN_SIZE_LIMIT,
+              "%s, the remote card scan exceeds its zone.", __func__);
+    memset(_in_cset, 0, sizeof(_in_cset));
+  }
+
+  // The size of the reply line, read by the CPU server.
+  static inline size_t reply_size() { return offset_of(remote_card_scan, _slots) - offset_of(remote_card_scan, _done_seq); }
+};
+
+/**
+ * The remembered sets of the Regions handed to the memory server CSet, REMSET_STASH_OFFSET, -XX:+SemeruRemoteRemSets.
+ *
+ * The remembered set of an old Region left to its memory server is only needed again when the CPU server
+ * evacuates the Region itself. Its cards are written into the page of the Region with the CSet dispatch,
+ * and the local table is dropped. The references found later go into the local table as before.
+ * The memory server only stores the pages, the CPU server reads them back before the remembered sets are scanned.
+ */
+class remote_rem_set_stash : public CHeapRDMAObj<remote_rem_set_stash>{
+public :
+  struct region_page {
+    uint32_t _cards[SEMERU_REMSET_STASH_CARDS];   // card indexes
+  };
+
+  region_page _pages[];
+
+  remote_rem_set_stash() {
+    guarantee(SEMERU_MAX_REGIONS * sizeof(region_page) <= REMSET_STASH_SIZE_LIMIT, "%s, the remembered set stash exceeds its zone.", __func__);
+  }
+
+  inline uint32_t* cards_of(uint region_index) { return _pages[region_index]._cards; }
+};
+
+
+/**
+ * The outbox of the memory server concurrent marking, MARK_MESSAGE_OFFSET, -XX:+SemeruMarkMessages.
+ *  with flexible array, SEMERU_MARK_MESSAGES target addresses.
+ *
+ * A CM task only traces the Region it claimed, a reference out of it is left to the roots of a later cycle.
+ * With the messages, the task batches such targets and appends the batch here. The memory servers have no
+ * connection between each other, the CPU server relays : it drains the outbox of each memory server before
+ * the next CSet dispatch and marks the targets into the target queues of their Regions, which are shipped
+ * to the owning memory servers with the dispatch and traced as roots of the Region.
+ *
+ * Multiple producers, the CM tasks of the memory server. One consumer, the CPU server, by RDMA.
+ * Same protocol as the compacted_region_ring, the positions only grow, a position's slot is pos & (SEMERU_MARK_MESSAGES - 1).
+ *  1) _reserved, the positions taken by the tasks.
+ *  2) _head, the positions published in order. The CPU server reads this line, then only the slots of [tail, head).
+ *  3) _tail, the positions read by the CPU server. Written back by RDMA, read by the tasks to check the room.
+ *
+ * A message only adds a root, so a lost one is safe. A batch without room is dropped and counted,
+ * its targets are found by the next cycle as before.
+ */
+class mark_message_ring : public CHeapRDMAObj<mark_message_ring>{
+public :
+  volatile size_t   _reserved ATTRIBUTE_ALIGNED(RDMA_ALIGNMENT_BYTES);
+  volatile size_t   _dropped;
+
+  volatile size_t   _head ATTRIBUTE_ALIGNED(RDMA_ALIGNMENT_BYTES);
+
+  volatile size_t   _tail ATTRIBUTE_ALIGNED(RDMA_ALIGNMENT_BYTES);
+
+  HeapWord*         _targets[] ATTRIBUTE_ALIGNED(RDMA_ALIGNMENT_BYTES);
+
+  mark_message_ring() :
+    _reserved(0),
+    _dropped(0),
+    _head(0),
+    _tail(0) {
+    guarantee(is_power_of_2(SEMERU_MARK_MESSAGES) &&
+              sizeof(mark_message_ring) + SEMERU_MARK_MESSAGES * sizeof(HeapWord*) <= MARK_MESSAGE_SIZE_LIMIT,
+              "%s, the mark messages exceed their zone.", __func__);
+  }
+
+  static inline size_t slot_of(size_t pos) { return pos & (SEMERU_MARK_MESSAGES - 1); }
+
+  // CPU server. The slots of [from, to) as at most 2 contiguous ranges, the second one is empty if not wrapped.
+  static inline void ranges_of(size_t from, size_t to, size_t* first_len, size_t* second_len) {
+    size_t len = to - from;
+    *first_len  = MIN2(len, SEMERU_MARK_MESSAGES - slot_of(from));
+    *second_len = len - *first_len;
+  }
+};
+
+
+/**
+ * The page affinity of the data space, PAGE_AFFINITY_OFFSET, -XX:+SemeruPageAffinity.
+ *  with flexible array, an entry per page.
+ *
+ * The memory server traces a fully evicted Region from its roots, the targets of the other Regions.
+ * The pages reached from one root are mostly faulted in together when the CPU server walks the same path,
+ * a pointer chase the sequential and stride prefetch of the kernel can't follow.
+ * The tracing links each such group, SEMERU_AFFINITY_GROUP_MAX pages at most, into a ring :
+ * an entry is the distance in pages to the next page of its group, 0 for a page out of any group.
+ * A page joins the group of the first root reaching it.
+ *
+ * Written by the memory server for the Regions it traced, cleared by a compaction of the Region.
+ * The CPU server reads the entries of a Region after its MemoryToCPUAtGC->_affinity_version changed,
+ * and the kernel fetches the rest of the ring after the first fault in it.
+ * A ring torn by a concurrent write only costs some useless prefetch, the kernel bounds the walk.
+ */
+class page_affinity_table : public CHeapRDMAObj<page_affinity_table>{
+public :
+  volatile int32_t _next[];
+
+  page_affinity_table() {
+    guarantee(RDMA_DATA_REGION_NUM * REGION_SIZE_GB * ONE_GB / PAGE_SIZE * sizeof(int32_t) <= PAGE_AFFINITY_SIZE_LIMIT,
+              "%s, the page affinity exceeds its zone.", __func__);
+  }
+
+  static inline size_t page_of(const void* addr) { return ((size_t)addr - RDMA_DATA_SPACE_START_ADDR) / PAGE_SIZE; }
+
+  // The entries of [start, end), page aligned.
+  inline volatile int32_t* entries_of(const void* start) { return _next + page_of(start); }
+  inline size_t bytes_of(const void* start, const void* end) { return ((size_t)end - (size_t)start) / PAGE_SIZE * sizeof(int32_t); }
+  inline void clear(const void* start, const void* end) { memset((void*)entries_of(start), 0, bytes_of(start, end)); }
+};
+
+
+/**
+ * A copy or fill of a large primitive array range, REMOTE_ARRAY_OP_OFFSET, -XX:+SemeruRemoteArrayOps.
+ *
+ * A System.arraycopy or an Unsafe copy or fill over pages swapped out to a memory server swaps every page in,
+ * only to write most of them back later. The memory server holds the complete copy of the pages and
+ * moves the bytes there instead, they cross the network once as the request.
+ * 1) CPU server, a Java thread in the VM, one request at a time. The ranges don't overlap, every page under them
+ *    is swapped out to the same memory server, and no Region of them is in its CSet.
+ *    Write the request, then bump _request_seq, and ring the doorbell.
+ * 2) Memory server, the card scan thread. Copy [_src, _src + _bytes) to _dst, or fill _dst with _value,
+ *    unless _cancel_seq already covers the request. Publish _status by _done_seq = _request_seq.
+ * 3) CPU server. Poll the reply line until _done_seq matches, then drop the local copies of the pages written,
+ *    RDMA_INVALIDATE. The operation is redone locally if a page is still mapped, swapped in meanwhile.
+ *    A refused request, or one not replied in time, is done locally. The latter is cancelled by _cancel_seq first.
+ */
+class remote_array_op : public CHeapRDMAObj<remote_array_op>{
+public :
+  enum Op {
+    Copy = 0,
+    Fill = 1
+  };
+
+  enum Status {
+    Done    = 0,
+    Refused = 1     // a wrong range, or a cancelled request
+  };
+
+  // CPU server, the request.
+  char*             _src;           // Copy only
+  char*             _dst;
+  size_t            _bytes;
+  uint32_t          _op;
+  uint32_t          _value;         // Fill only, the byte
+  volatile uint32_t _cancel_seq;    // written alone, the requests up to it are refused
+  volatile uint32_t _request_seq ATTRIBUTE_ALIGNED(RDMA_ALIGNMENT_BYTES);
+
+  // Memory server, the reply.
+  volatile uint32_t _done_seq ATTRIBUTE_ALIGNED(RDMA_ALIGNMENT_BYTES);
+  volatile uint32_t _status;
+
+  remote_array_op() :
+    _src(NULL),
+    _dst(NULL),
+    _bytes(0),
+    _op(Copy),
+    _value(0),
+    _cancel_seq(0),
+    _request_seq(0),
+    _done_seq(0),
+    _status(Done) {
+    guarantee(sizeof(remote_array_op) <= REMOTE_ARRAY_OP_SIZE_LIMIT, "%s, the remote array op exceeds its zone.", __func__);
+  }
+
+  // The request fields written ahead of the sequence, and the reply line read by the CPU server.
+  static inline size_t request_size() { return offset_of(remote_array_op, _cancel_seq); }
+  static inline size_t reply_size()   { return sizeof(remote_array_op) - offset_of(remote_array_op, _done_seq); }
+};
+
+
+
+
 
 
 
@@ -852,8 +1301,11 @@ public:
 
   ~HashQueue(){clear();}
 
+  // 1 bit per HeapWord of a Region.
+  static size_t bitmap_words_per_region() { return SemeruMetaLayout::region_size() / HeapWordSize / BitsPerWord; }
+
   void reset() {
-    memset(g1hbitmap + bitmap_st, 0, 536870912ULL/8/64 * sizeof(size_t));
+    memset(g1hbitmap + bitmap_st, 0, bitmap_words_per_region() * sizeof(size_t));
     _length = 0;
     _marked_from_root=false;
     _age = -1;
@@ -870,8 +1322,8 @@ public:
     _marked_from_root=false;
     _age = -1;
     
-    bitmap_st = (_region_index * 536870912ULL)/8/64;
-    memset(g1hbitmap + bitmap_st, 0, 536870912ULL/8/64 * sizeof(size_t));
+    bitmap_st = _region_index * bitmap_words_per_region();
+    memset(g1hbitmap + bitmap_st, 0, bitmap_words_per_region() * sizeof(size_t));
     log_debug(semeru,alloc)("%s, Cross region refernce update queue, 0x%lx,  _queue 0x%lx , length 0x%lx", __func__, (size_t)this, (size_t)_queue, (size_t)_tot);
   */
   }
@@ -979,6 +1431,13 @@ public:
 class BitQueue : public CHeapRDMAObj<size_t, ALLOC_TARGET_OBJ_QUEUE_ALLOCTYPE> {
 
 public:
+  // 1 summary bit per page of _target_bitmap, 512 words. Covers Regions up to 1GB.
+  static const size_t LogWordsPerPage = 9;
+  static const size_t WordsPerPage    = (size_t)1 << LogWordsPerPage;
+  static const size_t SummaryWords    = 64;
+  // Compressed list, the indexes of the non-zero words of _target_bitmap.
+  static const uint   SparseMax       = 512;
+
 // 1) meta fields. Must within 4K
   size_t _region_index;
   HeapWord* _base;
@@ -986,6 +1445,15 @@ public:
   int _age;
   size_t _heap_words; //words
 
+  // The pages of _target_bitmap with any bit set.
+  size_t _summary[SummaryWords];
+  // CPU server only, the summary of the last send, see target_queue_iovec().
+  size_t _sent_summary[SummaryWords];
+  // CPU server only, the pages with marks added after the last send.
+  size_t _unsent_summary[SummaryWords];
+  // Unordered, one entry per non-zero word. The list overflows after SparseMax words, use the summary then.
+  volatile uint _num_words;
+  uint  _words[SparseMax];
 
   // 2) the real content
   size_t* _target_bitmap;
@@ -997,21 +1465,47 @@ public:
 
   ~BitQueue(){clear();}
 
+  // Clear cost is proportional to the set pages, or the listed words for a sparse Region.
   void reset() {
-    memset(_target_bitmap, 0, _heap_words/64 * sizeof(size_t));
+    clear_bits();
     _marked_from_root=false;
     _age = -1;
   }
 
+  void clear_bits() {
+    if (is_sparse()) {
+      for (uint i = 0; i < _num_words; i++) {
+        _target_bitmap[_words[i]] = 0;
+      }
+    } else {
+      for (size_t p = 0; p < num_pages(); p++) {
+        if (is_page_dirty(p)) {
+          memset(page_start(p), 0, page_words(p) * sizeof(size_t));
+        }
+      }
+    }
+    memset(_summary, 0, sizeof(_summary));
+    _num_words = 0;
+  }
+
   // invoke the initialization function explicitly 
+  // The queue is freshly committed by CHeapRDMAObj::commit_at(), the anonymous pages of
+  // _target_bitmap read as zero. They are left untouched, and only become resident
+  // when a target in their part of the Region is pushed.
   void initialize(size_t region_index, HeapWord* bottom) {
+    STATIC_ASSERT(sizeof(BitQueue) <= PAGE_SIZE);
+    guarantee(num_pages_of(heap_words_to_bitmap_words(_heap_words)) <= SummaryWords * BitsPerWord,
+              "Region of 0x%lx words is too large for the BitQueue summary.", _heap_words);
+
     _region_index = region_index;
     _base = bottom;
     _marked_from_root=false;
     _age = -1;
     _target_bitmap  = (size_t*)((char*)this + align_up(sizeof(BitQueue),PAGE_SIZE));
-    tty->print("target_bitmap: 0x%lx\n", (size_t)_target_bitmap);
-    memset(_target_bitmap, 0, _heap_words/64*sizeof(size_t));
+    memset(_summary, 0, sizeof(_summary));
+    memset(_sent_summary, 0, sizeof(_sent_summary));
+    memset(_unsent_summary, 0, sizeof(_unsent_summary));
+    _num_words = 0;
     log_debug(semeru,alloc)("%s, Cross region refernce target queue, 0x%lx,  _target_bitmap 0x%lx , length 0x%lx", __func__, (size_t)this, (size_t)_target_bitmap, (size_t)_heap_words/64);
   }
 
@@ -1020,31 +1514,94 @@ public:
     _age = -1;
   }
 
+  static size_t heap_words_to_bitmap_words(size_t heap_words) { return heap_words / 64; }
+  static size_t num_pages_of(size_t bitmap_words)             { return (bitmap_words + WordsPerPage - 1) >> LogWordsPerPage; }
+
+  size_t  bitmap_words() const          { return heap_words_to_bitmap_words(_heap_words); }
+  size_t  num_pages() const             { return num_pages_of(bitmap_words()); }
+  size_t* page_start(size_t p) const    { return _target_bitmap + (p << LogWordsPerPage); }
+  size_t  page_words(size_t p) const    { return MIN2(WordsPerPage, bitmap_words() - (p << LogWordsPerPage)); }
+  bool    is_page_dirty(size_t p) const { return (_summary[p / BitsPerWord] >> (p % BitsPerWord)) & 1; }
+  bool    is_sparse() const             { return _num_words <= SparseMax; }
+
   size_t* getbyte(size_t x) {
     return _target_bitmap + (x/64);
   }
 
-  void push(oop x) {
+  size_t word_of(oop x) const { return (size_t)((HeapWord*)x - _base) / 64; }
+  size_t bit_of(oop x) const  { return (size_t)1 << ((size_t)((HeapWord*)x - _base) % 64); }
+
+  bool push(oop x) {
+    return push_bits(word_of(x), bit_of(x));
+  }
+
+  // OR the marks into one word of _target_bitmap. Return true if any of the marks is new.
+  // A word already holding all the marks is only read, the popular targets aren't contended.
+  bool push_bits(size_t word, size_t bits) {
     if(_marked_from_root) {
-      return;
+      return false;
+    }
+    size_t* bytee = _target_bitmap + word;
+    size_t old_val = *bytee;
+    if((old_val & bits) == bits) {
+      return false;
     }
-    size_t k = (size_t)((HeapWord*)x - _base);
-    
-    size_t* bytee = getbyte(k);
 
-    k %= 64;
-    // if((k&1) != 0) {
-    //   tty->print("Error here! oop is not even! %lu\n", (size_t)(HeapWord*)x);
-    //   ShouldNotReachHere();
-    // }
+    size_t prev;
+    while((prev = Atomic::cmpxchg(old_val | bits, bytee, old_val)) != old_val) {
+      old_val = prev;
+    }
 
-    // k >>= 1;
-    size_t old_val, new_val;
-    do{
-      old_val = *bytee;
-      new_val = old_val|(1ULL << k);
-    }while( Atomic::cmpxchg(new_val, bytee, old_val) != old_val );
-    
+    // Only the first pusher of a word records it.
+    if(old_val == 0) {
+      note_word(word);
+    }
+    note_unsent_page(word >> LogWordsPerPage);
+    return true;
+  }
+
+private:
+  void note_word(size_t word) {
+    uint n = Atomic::add(1u, &_num_words) - 1;
+    if (n < SparseMax) {
+      _words[n] = (uint)word;
+    }
+
+    size_t  p    = word >> LogWordsPerPage;
+    size_t* s    = &_summary[p / BitsPerWord];
+    size_t  mask = (size_t)1 << (p % BitsPerWord);
+    size_t old_val;
+    while (((old_val = *s) & mask) == 0 &&
+           Atomic::cmpxchg(old_val | mask, s, old_val) != old_val) {
+    }
+  }
+
+  void note_unsent_page(size_t p) {
+    size_t* s    = &_unsent_summary[p / BitsPerWord];
+    size_t  mask = (size_t)1 << (p % BitsPerWord);
+    size_t old_val;
+    while (((old_val = *s) & mask) == 0 &&
+           Atomic::cmpxchg(old_val | mask, s, old_val) != old_val) {
+    }
+  }
+
+public:
+  static bool is_page_in(const size_t* pages, size_t p) {
+    return (pages[p / BitsPerWord] >> (p % BitsPerWord)) & 1;
+  }
+
+  // Take the pages of the next send into pages, and record the send, see target_queue_iovec().
+  // 1) full, the pages with marks now or at the last send.
+  // 2) delta, the pages with marks added since the last send, or cleared since then.
+  //    Only valid if the memory server still holds the pages of the previous sends.
+  // The unsent marks are taken before the bitmap is read, a mark pushed after them is sent next time.
+  void claim_pages_to_send(size_t* pages, bool delta) {
+    for (size_t i = 0; i < SummaryWords; i++) {
+      size_t unsent = Atomic::xchg((size_t)0, &_unsent_summary[i]);
+      pages[i] = delta ? (unsent | (_sent_summary[i] & ~_summary[i]))
+                       : (_summary[i] | _sent_summary[i]);
+      _sent_summary[i] = _summary[i];
+    }
   }
 };
 
@@ -1079,7 +1636,7 @@ public:
 
   void control_path_flush(int mem_server_id, char *message_start_addr, size_t message_size){
     
-      syscall(RDMA_WRITE, mem_server_id, message_start_addr, message_size);  
+      semeru_cp_write(mem_server_id, message_start_addr, message_size);  
       tty->print("%s, Pauseless debug flush data [0x%lx, 0x%lx)\n",
         __func__, (size_t)message_start_addr, (size_t)(message_start_addr + message_size) );
   }
@@ -1090,21 +1647,6 @@ public:
 
 
 
-/**
- * Semeru 
- *  
- *  CPU Server  - Producer 
- *     CPU server builds the TargetObjQueue from 3 roots. And send the TargetQueue to Memory sever at the end of each CPU server GC.
- *     First, from thread stack variables. This is done during CPU server GC.
- *     Second, Cross-Region references recoreded by the Post Write Barrier ?
- *     Third, the SATB buffer queue, recoreded by the Pre Write Barrier.
- *  
- *  Memory Server - Consumer 
- *     Receive the TargetObjQueue and use them as the scavenge roots.
- * 
- */
- typedef OverflowTargetObjQueue<StarTask, ALLOC_TARGET_OBJ_QUEUE_ALLOCTYPE>        TargetObjQueue;     // Override the typedef of OopTaskQueue
- //typedef GenericTaskQueueSet<TargetObjQueue, mtGC>     TargetObjQueueSet;  // Assign to a global ?
 
 
 
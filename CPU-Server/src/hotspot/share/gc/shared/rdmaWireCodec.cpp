@@ -0,0 +1,250 @@
+/**
+ * Compression of the bulk control path writes, decompressed by the memory servers.
+ *
+ */
+
+#include "precompiled.hpp"
+#include "gc/shared/rdmaMetaLayout.hpp"
+#include "gc/shared/rdmaWireCodec.hpp"
+#include "logging/log.hpp"
+#include "runtime/orderAccess.hpp"
+#include "runtime/os.hpp"
+#include "utilities/debug.hpp"
+
+size_t SemeruWireBuffer::_used[MAX_NUM_OF_MEMORY_SERVER];
+size_t SemeruWireBuffer::_raw[MAX_NUM_OF_MEMORY_SERVER];
+size_t SemeruWireBuffer::_num_records[MAX_NUM_OF_MEMORY_SERVER];
+
+
+static inline uint64_t wire_token(SemeruWireCodec::Kind kind, size_t count) {
+  return ((uint64_t)kind << SemeruWireCodec::KindShift) | (uint64_t)count;
+}
+
+// The i-th word of [src, src + bytes), the last one zero padded.
+static inline uint64_t wire_word_at(const void* src, size_t bytes, size_t i) {
+  size_t offset = i * sizeof(uint64_t);
+  if (offset + sizeof(uint64_t) <= bytes) {
+    return ((const uint64_t*)src)[i];
+  }
+  uint64_t w = 0;
+  memcpy(&w, (const char*)src + offset, bytes - offset);
+  return w;
+}
+
+static inline void wire_put_word(void* dst, size_t bytes, size_t i, uint64_t w) {
+  size_t offset = i * sizeof(uint64_t);
+  if (offset + sizeof(uint64_t) <= bytes) {
+    ((uint64_t*)dst)[i] = w;
+  } else {
+    memcpy((char*)dst + offset, &w, bytes - offset);
+  }
+}
+
+
+size_t SemeruWireCodec::encode(const void* src, size_t bytes, uint64_t* dst, size_t cap) {
+  size_t n   = (bytes + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+  size_t out = 0;
+  size_t i   = 0;
+
+  while (i < n) {
+    uint64_t w = wire_word_at(src, bytes, i);
+    size_t run = 1;
+    while (i + run < n && wire_word_at(src, bytes, i + run) == w) {
+      run++;
+    }
+
+    if (w == 0 || run >= MinFillWords) {
+      if (out + (w == 0 ? 1 : 2) > cap) {
+        return 0;
+      }
+      dst[out++] = wire_token(w == 0 ? Zero : Fill, run);
+      if (w != 0) {
+        dst[out++] = w;
+      }
+      i += run;
+      continue;
+    }
+
+    // A literal, up to the next zero word or the next fill run.
+    size_t start = i;
+    i += run;
+    while (i < n) {
+      uint64_t v = wire_word_at(src, bytes, i);
+      if (v == 0) {
+        break;
+      }
+      size_t r = 1;
+      while (r < MinFillWords && i + r < n && wire_word_at(src, bytes, i + r) == v) {
+        r++;
+      }
+      if (r >= MinFillWords) {
+        break;
+      }
+      i += r;
+    }
+
+    size_t len = i - start;
+    if (out + 1 + len > cap) {
+      return 0;
+    }
+    dst[out++] = wire_token(Literal, len);
+    for (size_t k = start; k < i; k++) {
+      dst[out++] = wire_word_at(src, bytes, k);
+    }
+  }
+
+  return out;
+}
+
+
+bool SemeruWireCodec::decode(const uint64_t* src, size_t encoded, void* dst, size_t bytes) {
+  size_t n   = (bytes + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+  size_t in  = 0;
+  size_t out = 0;
+
+  while (in < encoded) {
+    uint64_t token = src[in++];
+    size_t count   = (size_t)(token & CountMask);
+    if (count > n - out) {
+      return false;
+    }
+
+    switch (token >> KindShift) {
+      case Zero:
+        for (size_t k = 0; k < count; k++) {
+          wire_put_word(dst, bytes, out + k, 0);
+        }
+        break;
+      case Fill: {
+        if (in >= encoded) {
+          return false;
+        }
+        uint64_t w = src[in++];
+        for (size_t k = 0; k < count; k++) {
+          wire_put_word(dst, bytes, out + k, w);
+        }
+        break;
+      }
+      case Literal:
+        if (count > encoded - in) {
+          return false;
+        }
+        for (size_t k = 0; k < count; k++) {
+          wire_put_word(dst, bytes, out + k, src[in + k]);
+        }
+        in += count;
+        break;
+      default:
+        return false;
+    }
+    out += count;
+  }
+
+  return out == n;
+}
+
+
+void SemeruWireBuffer::initialize(uint mem_server_num) {
+  char* start = (char*)(SEMERU_START_ADDR + SemeruMetaLayout::wire_buffer_offset());
+  os::commit_memory_or_exit(start, (size_t)mem_server_num * SEMERU_WIRE_BUFFER_SIZE, !ExecMem, "Semeru wire buffers");
+  for (uint i = 0; i < mem_server_num; i++) {
+    buffer_of((int)i)->magic = 0;   // nothing to apply before the first CSet
+  }
+}
+
+semeru_wire_header* SemeruWireBuffer::buffer_of(int mem_id) {
+  return (semeru_wire_header*)(SEMERU_START_ADDR + SemeruMetaLayout::wire_buffer_offset() + (size_t)mem_id * SEMERU_WIRE_BUFFER_SIZE);
+}
+
+void SemeruWireBuffer::begin(int mem_id) {
+  _used[mem_id]        = sizeof(semeru_wire_header);
+  _raw[mem_id]         = 0;
+  _num_records[mem_id] = 0;
+}
+
+/**
+ * Encode [start, start + bytes) behind the records of this CSet.
+ * Return false if it doesn't fit, or doesn't get smaller. The caller writes it as is then.
+ */
+bool SemeruWireBuffer::append(int mem_id, const void* start, size_t bytes) {
+  size_t used = _used[mem_id];
+  if (used + sizeof(semeru_wire_record) + sizeof(uint64_t) > SEMERU_WIRE_BUFFER_SIZE) {
+    return false;
+  }
+  size_t cap  = (SEMERU_WIRE_BUFFER_SIZE - used - sizeof(semeru_wire_record)) / sizeof(uint64_t);
+
+  char* base = (char*)buffer_of(mem_id);
+  semeru_wire_record* record = (semeru_wire_record*)(base + used);
+  uint64_t* words = (uint64_t*)(record + 1);
+  size_t encoded = SemeruWireCodec::encode(start, bytes, words, MIN2(cap, bytes / sizeof(uint64_t)));
+  if (encoded == 0) {
+    return false;
+  }
+
+  record->dst           = (uint64_t)(uintptr_t)start;
+  record->bytes         = bytes;
+  record->encoded_words = encoded;
+  _used[mem_id]        += sizeof(semeru_wire_record) + encoded * sizeof(uint64_t);
+  _raw[mem_id]         += bytes;
+  _num_records[mem_id]++;
+  return true;
+}
+
+bool SemeruWireBuffer::finish(int mem_id, uint32_t seq, char** start, size_t* bytes) {
+  if (_num_records[mem_id] == 0) {
+    return false;
+  }
+
+  semeru_wire_header* header = buffer_of(mem_id);
+  header->magic       = SEMERU_WIRE_MAGIC;
+  header->seq         = seq;
+  header->used_bytes  = _used[mem_id];
+  header->num_records = _num_records[mem_id];
+  header->raw_bytes   = _raw[mem_id];
+
+  *start = (char*)header;
+  *bytes = _used[mem_id];
+  log_debug(semeru,rdma)("%s, memory server[%d] CSet seq %u, 0x%lx bytes in 0x%lx by %lu records", __func__, mem_id, seq,
+                         _raw[mem_id], _used[mem_id], _num_records[mem_id]);
+  return true;
+}
+
+/**
+ * Decode the records of the CSet seq into place.
+ * Only the runtime part of the meta space below the wire buffers, the BOT and the target queues, is written.
+ */
+bool SemeruWireBuffer::apply(int mem_id, uint32_t seq) {
+  semeru_wire_header* header = buffer_of(mem_id);
+  OrderAccess::loadload();
+  if (header->magic != SEMERU_WIRE_MAGIC || header->seq != seq) {
+    return false;
+  }
+
+  const size_t lo = SEMERU_START_ADDR + BLOCK_OFFSET_TABLE_OFFSET;
+  const size_t hi = SEMERU_START_ADDR + SemeruMetaLayout::wire_buffer_offset();
+  size_t used = MIN2((size_t)header->used_bytes, SEMERU_WIRE_BUFFER_SIZE);
+  size_t offset = sizeof(semeru_wire_header);
+  char* base = (char*)header;
+
+  for (uint64_t r = 0; r < header->num_records; r++) {
+    if (offset + sizeof(semeru_wire_record) > used) {
+      log_warning(semeru,rdma)("%s, CSet seq %u is truncated at record %lu.", __func__, seq, (size_t)r);
+      return false;
+    }
+    semeru_wire_record* record = (semeru_wire_record*)(base + offset);
+    size_t encoded_bytes = (size_t)record->encoded_words * sizeof(uint64_t);
+    offset += sizeof(semeru_wire_record);
+
+    if (encoded_bytes > used - offset || record->dst < lo || record->dst > hi || record->bytes > hi - record->dst ||
+        !SemeruWireCodec::decode((uint64_t*)(base + offset), (size_t)record->encoded_words, (void*)(uintptr_t)record->dst, (size_t)record->bytes)) {
+      log_warning(semeru,rdma)("%s, CSet seq %u, wrong record %lu, [0x%lx, +0x%lx)", __func__, seq, (size_t)r,
+                               (size_t)record->dst, (size_t)record->bytes);
+      return false;
+    }
+    offset += encoded_bytes;
+  }
+
+  log_debug(semeru,rdma)("%s, CSet seq %u, 0x%lx bytes from 0x%lx by %lu records", __func__, seq,
+                         (size_t)header->raw_bytes, (size_t)header->used_bytes, (size_t)header->num_records);
+  return true;
+}
@@ -0,0 +1,91 @@
+/**
+ * Compression of the bulk control path writes, decompressed by the memory servers.
+ *
+ */
+
+#ifndef SHARE_GC_SHARED_RDMAWIRECODEC_HPP
+#define SHARE_GC_SHARED_RDMAWIRECODEC_HPP
+
+#include "memory/allocation.hpp"
+#include "utilities/globalDefinitions.hpp"
+
+/**
+ * Semeru - word run-length coding of the bulk metadata.
+ *
+ * The target queue bitmaps are mostly zero words, the BOT of a Region full of large objects repeats its words.
+ * A token word is followed by its payload :
+ *  Zero    : count zero words, no payload.
+ *  Fill    : count copies of the next word.
+ *  Literal : the next count words.
+ * The last word of a range not aligned to words is zero padded, only its bytes are decoded.
+ */
+class SemeruWireCodec : AllStatic {
+public:
+  enum Kind { Zero = 0, Fill = 1, Literal = 2 };
+
+  static const uint     KindShift    = 62;
+  static const uint64_t CountMask    = ((uint64_t)1 << KindShift) - 1;
+  static const size_t   MinFillWords = 3;   // a shorter run is cheaper as a literal
+
+  // Encode [src, src + bytes) into dst of cap words.
+  // Return the encoded words, 0 if they don't fit into cap.
+  static size_t encode(const void* src, size_t bytes, uint64_t* dst, size_t cap);
+
+  // Decode encoded words of src into [dst, dst + bytes).
+  // Return false if the stream doesn't decode to exactly bytes, dst may be partially written then.
+  static bool decode(const uint64_t* src, size_t encoded, void* dst, size_t bytes);
+};
+
+
+#define SEMERU_WIRE_MAGIC  0x53575243   // "SWRC"
+
+// The head of a wire buffer, the compressed writes of one CSet to a memory server.
+struct semeru_wire_header {
+  uint32_t magic;
+  uint32_t seq;           // the CSet sequence of received_memory_server_cset
+  uint64_t used_bytes;    // including the header
+  uint64_t num_records;
+  uint64_t raw_bytes;     // the sum of the records before the encoding
+};
+
+// One destination range of the meta space, followed by its encoded words.
+struct semeru_wire_record {
+  uint64_t dst;
+  uint64_t bytes;
+  uint64_t encoded_words;
+};
+
+
+/**
+ * Semeru - the wire buffer of each memory server, SEMERU_WIRE_BUFFER_SIZE at SemeruMetaLayout::wire_buffer_offset().
+ *
+ * CPU server :
+ *  begin() at the start of a CSet, append() each large range instead of writing it,
+ *  then finish() gives the used part of the buffer, written before the CSet signal.
+ * Memory server :
+ *  apply() when a new CSet is dispatched, the header of the same sequence is decoded into the runtime part of the meta space.
+ *  A range that doesn't fit is still written by RDMA, a stale header of an older CSet is ignored.
+ */
+class SemeruWireBuffer : AllStatic {
+  static size_t _used[MAX_NUM_OF_MEMORY_SERVER];       // CPU server, bytes of the current CSet
+  static size_t _raw[MAX_NUM_OF_MEMORY_SERVER];
+  static size_t _num_records[MAX_NUM_OF_MEMORY_SERVER];
+
+public:
+  // Commit the buffers, before the meta space is registered.
+  static void initialize(uint mem_server_num);
+
+  static semeru_wire_header* buffer_of(int mem_id);
+
+  // CPU server
+  static void begin(int mem_id);
+  static bool append(int mem_id, const void* start, size_t bytes);
+  // Return false if nothing was appended. Otherwise [*start, *start + *bytes) is the buffer to write.
+  static bool finish(int mem_id, uint32_t seq, char** start, size_t* bytes);
+  static size_t raw_bytes(int mem_id)   { return _raw[mem_id]; }
+
+  // Memory server
+  static bool apply(int mem_id, uint32_t seq);
+};
+
+#endif // SHARE_GC_SHARED_RDMAWIRECODEC_HPP
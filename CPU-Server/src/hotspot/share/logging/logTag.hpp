@@ -178,6 +178,7 @@
   LOG_TAG(compact) /* Semeru*/ \
 	LOG_TAG(mem_trace) /* Semeru*/ \
   LOG_TAG(mem_compact) /* Semeru*/ \
+  LOG_TAG(timeline) /* Semeru*/ \
   LOG_TAG_LIST_EXT
 
 #define PREFIX_LOG_TAG(T) (LogTag::_##T)
@@ -28,6 +28,9 @@
 #include "classfile/moduleEntry.hpp"
 #include "classfile/systemDictionary.hpp"
 #include "gc/shared/collectedHeap.hpp"
+#if INCLUDE_G1GC
+#include "gc/g1/g1CollectedHeap.hpp"
+#endif
 #include "memory/heapInspection.hpp"
 #include "memory/resourceArea.hpp"
 #include "oops/oop.inline.hpp"
@@ -226,6 +229,18 @@ bool KlassInfoTable::record_instance(const oop obj) {
   }
 }
 
+bool KlassInfoTable::record_instances(Klass* k, size_t count, size_t words) {
+  KlassInfoEntry* elt = lookup(k);
+  if (elt != NULL) {
+    elt->set_count(elt->count() + count);
+    elt->set_words(elt->words() + words);
+    _size_of_instances_in_words += words;
+    return true;
+  } else {
+    return false;
+  }
+}
+
 void KlassInfoTable::iterate(KlassInfoClosure* cic) {
   assert(_size == 0 || _buckets != NULL, "Allocation failure should have been caught");
   for (int index = 0; index < _size; index++) {
@@ -714,6 +729,16 @@ size_t HeapInspection::populate_table(KlassInfoTable* cit, BoolObjectClosure *fi
   ResourceMark rm;
 
   RecordInstanceClosure ric(cit, filter);
+#if INCLUDE_G1GC
+  // Semeru, the memory servers count the fully evicted Regions, without swapping them in.
+  if (SemeruRemoteHeapHistogram && UseG1GC && filter == NULL) {
+    G1CollectedHeap* g1h = G1CollectedHeap::heap();
+    CHeapBitMap counted(g1h->max_regions(), mtInternal);
+    size_t missed = g1h->count_remote_heap_histogram(cit, &counted);
+    g1h->object_iterate_uncounted(&ric, &counted);
+    return missed + ric.missed_count();
+  }
+#endif
   Universe::heap()->object_iterate(&ric);
   return ric.missed_count();
 }
@@ -253,6 +253,8 @@ class KlassInfoTable: public StackObj {
   KlassInfoTable(bool add_all_classes);
   ~KlassInfoTable();
   bool record_instance(const oop obj);
+  // Semeru, the instances of k counted by a memory server.
+  bool record_instances(Klass* k, size_t count, size_t words);
   void iterate(KlassInfoClosure* cic);
   bool allocation_failed() { return _buckets == NULL; }
   size_t size_of_instances_in_words() const;
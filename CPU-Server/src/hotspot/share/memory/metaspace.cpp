@@ -40,7 +40,9 @@
 #include "memory/metaspaceTracer.hpp"
 #include "memory/universe.hpp"
 #include "runtime/init.hpp"
+#include "runtime/mutexLocker.hpp"
 #include "runtime/orderAccess.hpp"
+#include "runtime/safepoint.hpp"
 #include "services/memTracker.hpp"
 #include "utilities/copy.hpp"
 #include "utilities/debug.hpp"
@@ -1438,6 +1440,12 @@ ClassLoaderMetaspace::~ClassLoaderMetaspace() {
 
 //mhr: modify
 void ClassLoaderMetaspace::send_metadata(AddrPair* addrpair, int& pair_num) {
+  if (SafepointSynchronize::is_at_safepoint()) {
+    _vsm->send_metadata(addrpair, pair_num);
+    return;
+  }
+  // Concurrent replication, the mutators may be allocating into the current chunk.
+  MutexLockerEx cl(lock(), Mutex::_no_safepoint_check_flag);
   _vsm->send_metadata(addrpair, pair_num);
 }
 
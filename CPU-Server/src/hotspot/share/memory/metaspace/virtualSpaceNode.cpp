@@ -44,7 +44,8 @@ namespace metaspace {
 // Semeru CPU
 // added by Chenxi.
 
-char* VirtualSpaceNode::VirtualSpaceNode_alloc_ptr = (char*)(SEMERU_START_ADDR + KLASS_INSTANCE_OFFSET); // index for VirtualSpaceNode allocation.
+// An offset, SEMERU_START_ADDR is only known once the flags are parsed, -XX:SemeruAddressWindow.
+size_t VirtualSpaceNode::VirtualSpaceNode_alloc_offset = KLASS_INSTANCE_OFFSET; // index for VirtualSpaceNode allocation.
 
 
 // Decide if large pages should be committed when the memory is reserved.
@@ -77,10 +78,10 @@ VirtualSpaceNode::VirtualSpaceNode(bool is_class, size_t bytes) :
 
     // Allocate VirtualSpaceNode at fixed address
     // MT safe
-    char* requested_addr =  Atomic::add((size_t)bytes, &VirtualSpaceNode_alloc_ptr) - bytes; // Bump the alloc_ptr successflly
-    assert( (size_t)VirtualSpaceNode_alloc_ptr <= (size_t)(SEMERU_START_ADDR + KLASS_INSTANCE_OFFSET + KLASS_INSTANCE_OFFSET_SIZE_LIMIT), "exceed meta space limit." );
+    char* requested_addr =  (char*)(SEMERU_START_ADDR + Atomic::add((size_t)bytes, &VirtualSpaceNode_alloc_offset) - bytes); // Bump the alloc_offset successflly
+    assert( VirtualSpaceNode_alloc_offset <= (size_t)(KLASS_INSTANCE_OFFSET + KLASS_INSTANCE_OFFSET_SIZE_LIMIT), "exceed meta space limit." );
     log_debug(semeru, alloc)("%s, Reserve 0x%lx bytes spece at 0x%lx for VirtulSpaceNode. Curr VirtualSpaceNode_alloc_ptr 0x%lx \n",__func__,
-                                                   bytes, (size_t)requested_addr,  (size_t)VirtualSpaceNode_alloc_ptr);
+                                                   bytes, (size_t)requested_addr,  (size_t)(SEMERU_START_ADDR + VirtualSpaceNode_alloc_offset));
 
     _rs = ReservedSpace(bytes, Metaspace::reserve_alignment(), large_pages , requested_addr, true);  // MAP_FIXED 
   }
@@ -79,7 +79,7 @@ class VirtualSpaceNode : public CHeapObj<mtClass> {
 
   // Semeru CPU
   // added by Chenxi.
-  static char* VirtualSpaceNode_alloc_ptr;
+  static size_t VirtualSpaceNode_alloc_offset;  // the next free offset in the Semeru meta space, of any address window.
 
   VirtualSpaceNode(bool is_class, size_t byte_size);
   VirtualSpaceNode(bool is_class, ReservedSpace rs) :
@@ -1381,8 +1381,9 @@ ReservedSpace Universe::reserve_semeru_memory_pool(size_t heap_size, size_t alig
 				 alignment, heap_size );
 
 	size_t total_reserved = align_up(heap_size, alignment);
-	assert(!UseCompressedOops || (total_reserved <= (OopEncodingHeapMax - os::vm_page_size())),
-			"heap size is too big for compressed oops");
+	// Only the data space, behind the RDMA meta space, is encoded by the compressed oops.
+	guarantee(!UseCompressedOops || (total_reserved - RDMA_STRUCTURE_SPACE_SIZE <= (OopEncodingHeapMax - os::vm_page_size())),
+			"Semeru heap size 0x%lx is too big for compressed oops", total_reserved - RDMA_STRUCTURE_SPACE_SIZE);
 
 	bool use_large_pages = UseLargePages && is_aligned(alignment, os::large_page_size());
 	assert(!UseLargePages
@@ -1405,12 +1406,16 @@ ReservedSpace Universe::reserve_semeru_memory_pool(size_t heap_size, size_t alig
 
 		// We are good.
 
-		// if (UseCompressedOops) {
-		// 	// Universe::initialize_heap() will reset this to NULL if unscaled
-		// 	// or zero-based narrow oops are actually used.
-		// 	// Else heap start and base MUST differ, so that NULL can be encoded nonambigous.
-		// 	Universe::set_narrow_oop_base((address)total_rs.compressed_oop_base());
-		// }
+		// The Semeru heap is far above 32GB, always heap based compressed oops.
+		// The base is the last page of the RDMA meta space, never used by the meta layout.
+		// Protect it as the no-access prefix, so that NULL can be encoded nonambigous and
+		// the implicit null checks still work.
+		// The memory servers decode the Semeru heap with the same base, SEMERU_NARROW_OOP_BASE.
+		if (UseCompressedOops) {
+			guarantee(os::protect_memory((char*)SEMERU_NARROW_OOP_BASE, os::vm_page_size(), os::MEM_PROT_NONE, true),
+								"%s, Failed to protect the compressed oops prefix page 0x%lx", __func__, (size_t)SEMERU_NARROW_OOP_BASE);
+			Universe::set_narrow_oop_base((address)SEMERU_NARROW_OOP_BASE);
+		}
 
 		if (heap_start_addr != NULL) {
 			log_info(heap)("Successfully allocated Java heap at location 0x%llx", (unsigned long long)heap_start_addr);
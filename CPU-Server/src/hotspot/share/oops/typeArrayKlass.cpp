@@ -43,6 +43,9 @@
 #include "oops/typeArrayOop.inline.hpp"
 #include "runtime/handles.inline.hpp"
 #include "utilities/macros.hpp"
+#if INCLUDE_G1GC
+#include "gc/g1/g1SemeruRemoteArrayOps.hpp"
+#endif
 
 bool TypeArrayKlass::compute_is_subtype_of(Klass* k) {
   if (!k->is_typeArray_klass()) {
@@ -178,6 +181,15 @@ void TypeArrayKlass::copy_array(arrayOop s, int src_pos, arrayOop d, int dst_pos
   int l2es = log2_element_size();
   size_t src_offset = arrayOopDesc::base_offset_in_bytes(element_type()) + ((size_t)src_pos << l2es);
   size_t dst_offset = arrayOopDesc::base_offset_in_bytes(element_type()) + ((size_t)dst_pos << l2es);
+#if INCLUDE_G1GC
+  // Semeru CPU - a large copy between swapped out arrays is done by their memory server, -XX:+SemeruRemoteArrayOps.
+  //  The compiled arraycopy stubs don't come here, only the runtime System.arraycopy.
+  if (G1SemeruRemoteArrayOps::should_offload((size_t)length << l2es) &&
+      G1SemeruRemoteArrayOps::copy(cast_from_oop<char*>(s) + src_offset, cast_from_oop<char*>(d) + dst_offset,
+                                   (size_t)length << l2es)) {
+    return;
+  }
+#endif
   ArrayAccess<ARRAYCOPY_ATOMIC>::arraycopy<void>(s, src_offset, d, dst_offset, (size_t)length << l2es);
 }
 
@@ -477,6 +477,8 @@ class Parse : public GraphKit {
   void array_store(BasicType etype);
   // Helper function to compute array addressing
   Node* array_addressing(BasicType type, int vals, const Type* *result2=NULL);
+  // Semeru, read the page SemeruLoopPrefetchPages ahead of an array load in a loop.
+  void semeru_loop_prefetch(Node* ary, Node* idx, Node* adr, BasicType bt);
 
   void rtm_deopt();
 
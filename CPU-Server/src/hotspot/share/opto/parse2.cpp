@@ -36,6 +36,7 @@
 #include "opto/convertnode.hpp"
 #include "opto/divnode.hpp"
 #include "opto/idealGraphPrinter.hpp"
+#include "opto/idealKit.hpp"
 #include "opto/matcher.hpp"
 #include "opto/memnode.hpp"
 #include "opto/mulnode.hpp"
@@ -57,6 +58,10 @@ void Parse::array_load(BasicType bt) {
   Node* adr = array_addressing(bt, 0, &elemtype);
   if (stopped())  return;     // guaranteed null or range check
 
+  if (SemeruLoopPrefetchPages > 0 && UseG1GC) {
+    semeru_loop_prefetch(peek(1), peek(0), adr, bt);
+  }
+
   pop();                      // index (already used)
   Node* array = pop();        // the array itself
 
@@ -107,6 +112,39 @@ void Parse::array_store(BasicType bt) {
   access_store_at(array, adr, adr_type, val, elemtype, bt, MO_UNORDERED | IN_HEAP | IS_ARRAY);
 }
 
+//------------------------------semeru_loop_prefetch---------------------------
+/**
+ * Semeru - A scan of a large array in a swapped out Region faults every page in, one RDMA read at a time.
+ *  In a loop, the load calls the runtime when its index starts a page of elements, with the address
+ *  SemeruLoopPrefetchPages pages ahead. The runtime issues the read of that page if its Region has
+ *  swapped out pages, see G1CollectedHeap::semeru_loop_prefetch(), so a sequential scan keeps that many
+ *  reads on the fly. The call stays in the loop body, such a loop isn't vectorized.
+ */
+void Parse::semeru_loop_prefetch(Node* ary, Node* idx, Node* adr, BasicType bt) {
+  ciTypeFlow::Loop* lp = block()->flow()->loop();
+  if (lp == NULL || lp->is_root()) {
+    return;
+  }
+
+  jint per_page = (jint)(PAGE_SIZE / type2aelembytes(bt));
+  const TypeAryPtr* arytype = _gvn.type(ary)->is_aryptr();
+  if (arytype->size()->_hi <= per_page) {
+    return;   // at most one page of elements
+  }
+
+  Node* raw   = _gvn.transform(new CastP2XNode(NULL, adr));
+  Node* ahead = _gvn.transform(new CastX2PNode(_gvn.transform(new AddXNode(raw, _gvn.MakeConX((jint)(SemeruLoopPrefetchPages * PAGE_SIZE))))));
+
+  IdealKit ideal(this, true);
+#define __ ideal.
+  __ if_then(__ AndI(idx, __ ConI(per_page - 1)), BoolTest::eq, __ ConI(0), PROB_UNLIKELY_MAG(3)); {
+    __ make_leaf_call_no_fp(OptoRuntime::semeru_loop_prefetch_Type(),
+                            CAST_FROM_FN_PTR(address, OptoRuntime::semeru_loop_prefetch_C),
+                            "semeru_loop_prefetch", TypeRawPtr::BOTTOM, ahead);
+  } __ end_if();
+  final_sync(ideal);
+#undef __
+}
 
 //------------------------------array_addressing-------------------------------
 // Pull array and index from the stack.  Compute pointer-to-element.
@@ -35,6 +35,7 @@
 #include "code/vtableStubs.hpp"
 #include "compiler/compileBroker.hpp"
 #include "compiler/oopMap.hpp"
+#include "gc/g1/g1CollectedHeap.hpp"
 #include "gc/g1/heapRegion.hpp"
 #include "gc/shared/barrierSet.hpp"
 #include "gc/shared/collectedHeap.hpp"
@@ -1160,6 +1161,25 @@ const TypeFunc* OptoRuntime::osr_end_Type() {
   return TypeFunc::make(domain, range);
 }
 
+//-------------- Semeru array prefetch
+
+const TypeFunc* OptoRuntime::semeru_loop_prefetch_Type() {
+  // create input type (domain)
+  const Type **fields = TypeTuple::fields(1);
+  fields[TypeFunc::Parms+0] = TypeRawPtr::BOTTOM; // the address ahead
+  const TypeTuple *domain = TypeTuple::make(TypeFunc::Parms+1, fields);
+
+  // create result type
+  fields = TypeTuple::fields(1);
+  fields[TypeFunc::Parms+0] = NULL; // void
+  const TypeTuple *range = TypeTuple::make(TypeFunc::Parms, fields);
+  return TypeFunc::make(domain, range);
+}
+
+JRT_LEAF(void, OptoRuntime::semeru_loop_prefetch_C(void* addr))
+  G1CollectedHeap::heap()->semeru_loop_prefetch(addr);
+JRT_END
+
 //-------------- methodData update helpers
 
 const TypeFunc* OptoRuntime::profile_receiver_type_Type() {
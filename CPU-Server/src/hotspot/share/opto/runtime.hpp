@@ -232,6 +232,9 @@ private:
   // Leaf routines helping with method data update
   static void profile_receiver_type_C(DataLayout* data, oopDesc* receiver);
 
+  // Semeru, -XX:SemeruLoopPrefetchPages
+  static void semeru_loop_prefetch_C(void* addr);
+
   // Implicit exception support
   static void throw_div0_exception_C      (JavaThread* thread);
   static void throw_stack_overflow_error_C(JavaThread* thread);
@@ -304,6 +307,9 @@ private:
   // leaf methodData routine types
   static const TypeFunc* profile_receiver_type_Type();
 
+  // Semeru, leaf array prefetch routine type
+  static const TypeFunc* semeru_loop_prefetch_Type();
+
   // leaf on stack replacement interpreter accessor types
   static const TypeFunc* fetch_int_Type();
   static const TypeFunc* fetch_long_Type();
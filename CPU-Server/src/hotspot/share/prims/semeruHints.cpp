@@ -0,0 +1,127 @@
+/**
+ * Semeru CPU Server - the natives of jdk.internal.misc.SemeruHints, -XX:+SemeruRegionHints.
+ *
+ */
+
+#include "precompiled.hpp"
+#include "jni.h"
+#include "jvm.h"
+#include "classfile/vmSymbols.hpp"
+#include "gc/g1/g1CollectedHeap.inline.hpp"
+#include "gc/g1/heapRegion.inline.hpp"
+#include "gc/g1/heapRegionManager.hpp"
+#include "oops/oop.inline.hpp"
+#include "runtime/handles.inline.hpp"
+#include "runtime/interfaceSupport.inline.hpp"
+#include "runtime/jniHandles.inline.hpp"
+#include "runtime/mutexLocker.hpp"
+
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/**
+ * Semeru CPU - The application knows its access pattern better than the swap.
+ *  prefetch0  - read the swapped out pages of [obj + offset, obj + offset + length) into the prefetch cache.
+ *  markCold0  - evict the old Region of obj with the cold Regions of the next pause.
+ *  pin0       - lock the Region of obj in the local DRAM until its type changes, e.g. it's freed or collected.
+ *  unpin0     - drop the pin, the young Regions of -XX:+SemeruPinYoungRegions stay locked.
+ *
+ * All of them are hints, they do nothing without -XX:+SemeruRegionHints and -XX:+SemeruEnableMemPool.
+ * An object can be moved by a pause right after the call, the hint applies to the Region it was in.
+ */
+
+static bool semeru_hints_enabled() {
+  return SemeruRegionHints && UseG1GC && SemeruEnableMemPool;
+}
+
+JVM_ENTRY(jlong, SemeruHints_Prefetch(JNIEnv *env, jobject unused, jobject obj, jlong offset, jlong length))
+  if (obj == NULL) {
+    THROW_0(vmSymbols::java_lang_NullPointerException());
+  }
+  if (!semeru_hints_enabled() || offset < 0 || length <= 0) {
+    return 0;
+  }
+
+  oop o = JNIHandles::resolve_non_null(obj);
+  size_t obj_bytes = (size_t)o->size() * HeapWordSize;
+  if ((size_t)offset >= obj_bytes) {
+    return 0;
+  }
+  size_t bytes = MIN2((size_t)length, obj_bytes - (size_t)offset);
+  char* start = (char*)align_down((uintptr_t)o + (size_t)offset, PAGE_SIZE);
+  char* end = (char*)align_up((uintptr_t)o + (size_t)offset + bytes, PAGE_SIZE);
+
+  long issued;
+  {
+    // Only the addresses are passed down, the object can move meanwhile.
+    ThreadToNativeFromVM ttnfv(thread);
+    issued = syscall(RDMA_PREFETCH_RANGE, 0, start, pointer_delta(end, start, 1));
+  }
+  return issued < 0 ? 0 : (jlong)issued;
+JVM_END
+
+JVM_ENTRY(void, SemeruHints_MarkCold(JNIEnv *env, jobject unused, jobject obj))
+  if (obj == NULL) {
+    THROW(vmSymbols::java_lang_NullPointerException());
+  }
+  if (!semeru_hints_enabled()) {
+    return;
+  }
+
+  G1CollectedHeap* g1h = G1CollectedHeap::heap();
+  oop o = JNIHandles::resolve_non_null(obj);
+  g1h->hint_cold_region(g1h->heap_region_containing(o));
+JVM_END
+
+JVM_ENTRY(jboolean, SemeruHints_Pin(JNIEnv *env, jobject unused, jobject obj))
+  if (obj == NULL) {
+    THROW_0(vmSymbols::java_lang_NullPointerException());
+  }
+  if (!semeru_hints_enabled()) {
+    return JNI_FALSE;
+  }
+
+  G1CollectedHeap* g1h = G1CollectedHeap::heap();
+  MutexLocker ml(Heap_lock);
+  // Resolved under the Heap_lock, no pause can move the object out of the Region before the pin.
+  oop o = JNIHandles::resolve_non_null(obj);
+  return g1h->hrm()->pin_in_dram(g1h->heap_region_containing(o)) ? JNI_TRUE : JNI_FALSE;
+JVM_END
+
+JVM_ENTRY(void, SemeruHints_Unpin(JNIEnv *env, jobject unused, jobject obj))
+  if (obj == NULL) {
+    THROW(vmSymbols::java_lang_NullPointerException());
+  }
+  if (!semeru_hints_enabled()) {
+    return;
+  }
+
+  G1CollectedHeap* g1h = G1CollectedHeap::heap();
+  MutexLocker ml(Heap_lock);
+  oop o = JNIHandles::resolve_non_null(obj);
+  g1h->hrm()->unpin_in_dram(g1h->heap_region_containing(o));
+JVM_END
+
+#define CC (char*)  /* cast a literal from (const char*) */
+#define FN_PTR(f) CAST_FROM_FN_PTR(void*, &f)
+#define OBJ "Ljava/lang/Object;"
+
+static JNINativeMethod semeru_hints_methods[] = {
+  {CC "prefetch0",           CC "(" OBJ "JJ)J",   FN_PTR(SemeruHints_Prefetch)},
+  {CC "markCold0",           CC "(" OBJ ")V",     FN_PTR(SemeruHints_MarkCold)},
+  {CC "pin0",                CC "(" OBJ ")Z",     FN_PTR(SemeruHints_Pin)},
+  {CC "unpin0",              CC "(" OBJ ")V",     FN_PTR(SemeruHints_Unpin)}
+};
+
+#undef OBJ
+#undef FN_PTR
+#undef CC
+
+// This one function is exported, used by NativeLookup.
+JVM_ENTRY(void, JVM_RegisterSemeruHintsMethods(JNIEnv *env, jclass hintsclass))
+  {
+    ThreadToNativeFromVM ttnfv(thread);
+    int ok = env->RegisterNatives(hintsclass, semeru_hints_methods, sizeof(semeru_hints_methods)/sizeof(JNINativeMethod));
+    guarantee(ok == 0, "register SemeruHints natives");
+  }
+JVM_END
@@ -50,6 +50,11 @@
 #include "utilities/copy.hpp"
 #include "utilities/dtrace.hpp"
 #include "utilities/macros.hpp"
+#if INCLUDE_G1GC
+#include "gc/g1/g1CollectedHeap.hpp"
+#include "gc/g1/g1SemeruOffHeapArena.hpp"
+#include "gc/g1/g1SemeruRemoteArrayOps.hpp"
+#endif
 
 /**
  * Implementation of the jdk.internal.misc.Unsafe class
@@ -218,7 +223,15 @@ public:
       T ret = RawAccess<>::load(addr());
       return normalize_for_read(ret);
     } else {
-      T ret = HeapAccess<>::load_at(_obj, _offset);
+      T ret;
+#if INCLUDE_G1GC
+      // Semeru CPU - a field of a cold Region, read it from the memory server without the swap in.
+      if (SemeruRemoteFieldReads && UseG1GC &&
+          G1CollectedHeap::heap()->semeru_peek((const void*)addr(), &ret, sizeof(T))) {
+        return normalize_for_read(ret);
+      }
+#endif
+      ret = HeapAccess<>::load_at(_obj, _offset);
       return normalize_for_read(ret);
     }
   }
@@ -371,7 +384,16 @@ UNSAFE_ENTRY(jlong, Unsafe_AllocateMemory0(JNIEnv *env, jobject unsafe, jlong si
   size_t sz = (size_t)size;
 
   sz = align_up(sz, HeapWordSize);
-  void* x = os::malloc(sz, mtOther);
+  void* x = NULL;
+#if INCLUDE_G1GC
+  // Semeru CPU - the large blocks are backed by the memory servers, -XX:SemeruOffHeapArenaSize.
+  if (G1SemeruOffHeapArena::should_allocate(sz)) {
+    x = G1SemeruOffHeapArena::allocate(sz);
+  }
+#endif
+  if (x == NULL) {
+    x = os::malloc(sz, mtOther);
+  }
 
   return addr_to_java(x);
 } UNSAFE_END
@@ -381,6 +403,24 @@ UNSAFE_ENTRY(jlong, Unsafe_ReallocateMemory0(JNIEnv *env, jobject unsafe, jlong
   size_t sz = (size_t)size;
   sz = align_up(sz, HeapWordSize);
 
+#if INCLUDE_G1GC
+  // Semeru CPU - a block of the off-heap arena moves to a new block, of the arena or of malloc.
+  if (G1SemeruOffHeapArena::contains(p)) {
+    void* x = NULL;
+    if (G1SemeruOffHeapArena::should_allocate(sz)) {
+      x = G1SemeruOffHeapArena::allocate(sz);
+    }
+    if (x == NULL) {
+      x = os::malloc(sz, mtOther);
+    }
+    if (x != NULL) {
+      Copy::conjoint_memory_atomic(p, x, MIN2(sz, G1SemeruOffHeapArena::block_size(p)));
+      G1SemeruOffHeapArena::free(p);
+    }
+    return addr_to_java(x);
+  }
+#endif
+
   void* x = os::realloc(p, sz, mtOther);
 
   return addr_to_java(x);
@@ -389,6 +429,12 @@ UNSAFE_ENTRY(jlong, Unsafe_ReallocateMemory0(JNIEnv *env, jobject unsafe, jlong
 UNSAFE_ENTRY(void, Unsafe_FreeMemory0(JNIEnv *env, jobject unsafe, jlong addr)) {
   void* p = addr_from_java(addr);
 
+#if INCLUDE_G1GC
+  if (G1SemeruOffHeapArena::contains(p)) {
+    G1SemeruOffHeapArena::free(p);
+    return;
+  }
+#endif
   os::free(p);
 } UNSAFE_END
 
@@ -398,6 +444,12 @@ UNSAFE_ENTRY(void, Unsafe_SetMemory0(JNIEnv *env, jobject unsafe, jobject obj, j
   oop base = JNIHandles::resolve(obj);
   void* p = index_oop_from_field_offset_long(base, offset);
 
+#if INCLUDE_G1GC
+  // Semeru CPU - a large fill of a swapped out array is done by its memory server, -XX:+SemeruRemoteArrayOps.
+  if (base != NULL && G1SemeruRemoteArrayOps::should_offload(sz) && G1SemeruRemoteArrayOps::fill(p, sz, value)) {
+    return;
+  }
+#endif
   Copy::fill_to_memory_atomic(p, sz, value);
 } UNSAFE_END
 
@@ -410,6 +462,13 @@ UNSAFE_ENTRY(void, Unsafe_CopyMemory0(JNIEnv *env, jobject unsafe, jobject srcOb
   void* src = index_oop_from_field_offset_long(srcp, srcOffset);
   void* dst = index_oop_from_field_offset_long(dstp, dstOffset);
 
+#if INCLUDE_G1GC
+  // Semeru CPU - a large copy between swapped out arrays is done by their memory server, -XX:+SemeruRemoteArrayOps.
+  if (srcp != NULL && dstp != NULL && G1SemeruRemoteArrayOps::should_offload(sz) &&
+      G1SemeruRemoteArrayOps::copy(src, dst, sz)) {
+    return;
+  }
+#endif
   Copy::conjoint_memory_atomic(src, dst, sz);
 } UNSAFE_END
 
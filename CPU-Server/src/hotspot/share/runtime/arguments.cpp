@@ -1658,6 +1658,14 @@ void Arguments::set_use_compressed_klass_ptrs() {
       warning("UseCompressedClassPointers requires UseCompressedOops");
     }
     FLAG_SET_DEFAULT(UseCompressedClassPointers, false);
+  } else if (SemeruEnableMemPool) {
+    // Semeru - the memory servers read the Klass pointers of the object headers directly,
+    // and they don't share the compressed class space of the CPU server.
+    // Only the oops are compressed, with the fixed base SEMERU_NARROW_OOP_BASE.
+    if (UseCompressedClassPointers && !FLAG_IS_DEFAULT(UseCompressedClassPointers)) {
+      warning("UseCompressedClassPointers is not supported by SemeruEnableMemPool");
+    }
+    FLAG_SET_DEFAULT(UseCompressedClassPointers, false);
   } else {
     // Turn on UseCompressedClassPointers too
     if (FLAG_IS_DEFAULT(UseCompressedClassPointers)) {
@@ -3538,6 +3546,11 @@ void Arguments::set_shared_spaces_flags() {
         "Cannot dump shared archive when UseCompressedOops or UseCompressedClassPointers is off.", NULL);
     }
   } else {
+    // Semeru - the memory servers only see the klasses replicated from the Semeru meta space,
+    // the archived ones are mapped outside of it.
+    if (SemeruEnableMemPool) {
+      no_shared_spaces("The archived classes can't be replicated to the memory servers, SemeruEnableMemPool.");
+    }
     if (!UseCompressedOops || !UseCompressedClassPointers) {
       no_shared_spaces("UseCompressedOops and UseCompressedClassPointers must be on for UseSharedSpaces.");
     }
@@ -3987,6 +4000,9 @@ jint Arguments::parse(const JavaVMInitArgs* initial_cmd_args) {
 }
 
 jint Arguments::apply_ergo() {
+  // Semeru - the meta and data space of this JVM, before anything is placed in them.
+  semeru_start_addr = SEMERU_BASE_START_ADDR + (size_t)SemeruAddressWindow * SEMERU_ADDRESS_WINDOW_SIZE;
+
   // Set flags based on ergonomics.
   jint result = set_ergonomics_flags();
   if (result != JNI_OK) return result;
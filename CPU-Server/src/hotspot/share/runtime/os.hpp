@@ -348,6 +348,8 @@ class os: AllStatic {
   // Semeru
   // Added by Chenxi.
   static char* semeru_attempt_reserve_memory_at(size_t bytes, char* addr, size_t alignment, int file_desc = -1);
+  // madvise the THP usage of a heap range.
+  static void  semeru_advise_huge_pages(char* addr, size_t bytes, bool huge);
 
   static void   split_reserved_memory(char *base, size_t size,
                                       size_t split, bool realloc);
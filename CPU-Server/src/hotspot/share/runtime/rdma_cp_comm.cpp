@@ -0,0 +1,916 @@
+#include "precompiled.hpp"
+#include "runtime/rdma_cp_comm.hpp"
+#include "gc/g1/g1SemeruRdmaStats.hpp"
+#include "gc/shared/rdmaMetaLayout.hpp"
+#include "logging/log.hpp"
+#include "runtime/atomic.hpp"
+#include "runtime/globals.hpp"
+#include "runtime/orderAccess.hpp"
+#include "runtime/os.hpp"
+#include "utilities/align.hpp"
+#include "utilities/debug.hpp"
+#include "utilities/ostream.hpp"
+
+#include <unistd.h>
+
+#ifdef SEMERU_USER_CP
+#include <errno.h>
+#include <string.h>
+#include <pthread.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <rdma/rdma_cma.h>
+#endif
+
+
+#ifdef SEMERU_USER_CP
+
+// The same with the module parameter of the kernel module, semeru_cpu.c
+// Parsed from SemeruMemServerIPs. The port is SemeruMemServerPort, the tenant of our memory servers.
+static char        mem_server_ip[MAX_NUM_OF_MEMORY_SERVER][INET_ADDRSTRLEN];
+
+#define CP_CM_TIMEOUT_MS   2000  // address and route resolving
+#define CP_POLL_TIMEOUT_MS 100   // a posted chain, the same as CP_RDMA_WAIT_TIMEOUT_MS of the kernel path.
+#define CP_SQ_DEPTH        64    // chained wr per doorbell, only the last one is signaled.
+
+
+//
+// 2-sided RDMA message.
+// Keep the same layout with the Memory server, runtime/rdma_comm.hpp
+//
+enum cp_message_type{
+  CP_DONE = 1,
+  CP_SEND_CHUNKS,
+  CP_SEND_SINGLE_CHUNK,
+  CP_FREE_SIZE,
+  CP_EVICT,
+
+  CP_ACTIVITY,
+  CP_STOP,
+  CP_REQUEST_CHUNKS,
+  CP_REQUEST_SINGLE_CHUNK,
+  CP_QUERY,
+
+  CP_AVAILABLE_TO_QUERY,
+  CP_EXPAND_CHUNKS,
+  CP_RELEASE_CHUNKS
+};
+
+struct cp_message {
+  uint64_t buf[MAX_REGION_NUM];
+  uint64_t mapped_size[MAX_REGION_NUM];
+  uint32_t rkey[MAX_REGION_NUM];
+  int mapped_chunk;
+
+  enum cp_message_type type;
+};
+
+
+/**
+ * The user space RDMA connection to one memory server.
+ */
+struct cp_connection {
+  struct rdma_event_channel *ec;
+  struct rdma_cm_id         *cm_id;
+  struct ibv_pd             *pd;
+  struct ibv_cq             *cq;    // both send and recv, busy polling.
+  struct ibv_qp             *qp;
+
+  struct cp_message *send_msg;
+  struct ibv_mr     *send_mr;
+  struct cp_message *recv_msg;
+  struct ibv_mr     *recv_mr;
+
+  // local meta space, registered once.
+  struct ibv_mr     *meta_mr;
+
+  // remote meta Region, the chunk[0] of the memory server.
+  uint64_t  remote_meta_addr;
+  uint32_t  remote_meta_rkey;
+  size_t    remote_meta_size;
+
+  // the old value returned by the remote atomics.
+  uint64_t          *atomic_result;
+  struct ibv_mr     *atomic_mr;
+
+  pthread_mutex_t lock;   // GC workers share the QP, serialize the posting and polling.
+  bool      connected;
+};
+
+static struct cp_connection cp_conn[MAX_NUM_OF_MEMORY_SERVER];
+
+
+//
+// >>>>>>>>>>>>>>>>>>>>>>  Start of connection initialization >>>>>>>>>>>>>>>>>>>>>>
+//
+
+static bool cp_wait_cm_event(struct cp_connection* conn, enum rdma_cm_event_type expected){
+  struct rdma_cm_event* event = NULL;
+  enum rdma_cm_event_type type;
+
+  if(rdma_get_cm_event(conn->ec, &event) != 0){
+    return false;
+  }
+  type = event->event;
+  rdma_ack_cm_event(event);
+
+  if(type != expected){
+    log_warning(semeru,rdma)("%s, expect cm event %s, but get %s", __func__,
+                             rdma_event_str(expected), rdma_event_str(type));
+    return false;
+  }
+  return true;
+}
+
+/**
+ * Busy poll the CQ until the wr tagged by wr_id is done.
+ * RC QP completes the wr in order, the earlier unsignaled wr are done too.
+ *
+ * A wr not done within CP_POLL_TIMEOUT_MS, or done with an error, fails the transfer.
+ * The QP is left with a wr in flight or in error state, so the user space path to this memory server is
+ * turned off, the later transfers go through the kernel path.
+ */
+static int cp_poll_wr(struct cp_connection* conn, uint64_t wr_id){
+  struct ibv_wc wc;
+  int ret;
+  jlong deadline = os::javaTimeNanos() + (jlong)CP_POLL_TIMEOUT_MS * NANOSECS_PER_MILLISEC;
+
+  while(true){
+    ret = ibv_poll_cq(conn->cq, 1, &wc);
+    if(ret < 0){
+      log_warning(semeru,rdma)("%s, poll cq failed, %d", __func__, ret);
+      break;
+    }
+    if(ret == 0){
+      if(os::javaTimeNanos() - deadline > 0){
+        log_warning(semeru,rdma)("%s, wr 0x%lx isn't done in %d ms", __func__, (size_t)wr_id, CP_POLL_TIMEOUT_MS);
+        break;
+      }
+      continue;
+    }
+
+    if(wc.status != IBV_WC_SUCCESS){
+      log_warning(semeru,rdma)("%s, wr 0x%lx failed, %s", __func__, (size_t)wc.wr_id, ibv_wc_status_str(wc.status));
+      break;
+    }
+    if(wc.wr_id == wr_id){
+      return 0;
+    }
+  }
+
+  if(conn->connected){
+    conn->connected = false;
+    log_warning(semeru,rdma)("%s, user space control path is off, use the kernel path.", __func__);
+  }
+  return -1;
+}
+
+static int cp_post_recv(struct cp_connection* conn){
+  struct ibv_recv_wr wr, *bad_wr = NULL;
+  struct ibv_sge sge;
+
+  memset(&wr, 0, sizeof(wr));
+  wr.wr_id    = (uintptr_t)conn->recv_msg;
+  wr.sg_list  = &sge;
+  wr.num_sge  = 1;
+
+  sge.addr    = (uintptr_t)conn->recv_msg;
+  sge.length  = (uint32_t)sizeof(struct cp_message);
+  sge.lkey    = conn->recv_mr->lkey;
+
+  return ibv_post_recv(conn->qp, &wr, &bad_wr);
+}
+
+static int cp_send_message(struct cp_connection* conn, enum cp_message_type type){
+  struct ibv_send_wr wr, *bad_wr = NULL;
+  struct ibv_sge sge;
+
+  conn->send_msg->type = type;
+
+  memset(&wr, 0, sizeof(wr));
+  wr.wr_id      = (uintptr_t)conn->send_msg;
+  wr.opcode     = IBV_WR_SEND;
+  wr.sg_list    = &sge;
+  wr.num_sge    = 1;
+  wr.send_flags = IBV_SEND_SIGNALED;
+
+  sge.addr      = (uintptr_t)conn->send_msg;
+  sge.length    = (uint32_t)sizeof(struct cp_message);
+  sge.lkey      = conn->send_mr->lkey;
+
+  if(ibv_post_send(conn->qp, &wr, &bad_wr) != 0){
+    return -1;
+  }
+  return cp_poll_wr(conn, wr.wr_id);
+}
+
+static int cp_recv_message(struct cp_connection* conn, enum cp_message_type expected){
+  if(cp_poll_wr(conn, (uintptr_t)conn->recv_msg) != 0){
+    return -1;
+  }
+
+  if(conn->recv_msg->type != expected){
+    log_warning(semeru,rdma)("%s, expect message %d, but get %d", __func__, expected, conn->recv_msg->type);
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * Register the local meta space as ODP MR.
+ * Registering it by pinning would make the whole meta space resident on CPU server,
+ * so the user space path is disabled if the device has no ODP support.
+ */
+static bool cp_register_meta_space(struct cp_connection* conn){
+  struct ibv_device_attr_ex attr;
+  uint32_t rc_caps;
+
+  memset(&attr, 0, sizeof(attr));
+  if(ibv_query_device_ex(conn->cm_id->verbs, NULL, &attr) != 0){
+    return false;
+  }
+
+  rc_caps = attr.odp_caps.per_transport_caps.rc_odp_caps;
+  if(!(attr.odp_caps.general_caps & IBV_ODP_SUPPORT) ||
+     !(rc_caps & IBV_ODP_SUPPORT_SEND) || !(rc_caps & IBV_ODP_SUPPORT_READ)){
+    log_info(semeru,rdma)("%s, no On-Demand-Paging support for RC QP.", __func__);
+    return false;
+  }
+
+  conn->meta_mr = ibv_reg_mr(conn->pd, (void*)SEMERU_START_ADDR, SemeruMetaLayout::used_size(),
+                             IBV_ACCESS_LOCAL_WRITE | IBV_ACCESS_ON_DEMAND);
+  return conn->meta_mr != NULL;
+}
+
+/**
+ * Release whatever cp_connect() created so far, in the reverse order.
+ */
+static void cp_teardown(struct cp_connection* conn, bool established){
+  if(established){
+    rdma_disconnect(conn->cm_id);
+  }
+  if(conn->atomic_mr != NULL){
+    ibv_dereg_mr(conn->atomic_mr);
+  }
+  if(conn->meta_mr != NULL){
+    ibv_dereg_mr(conn->meta_mr);
+  }
+  if(conn->recv_mr != NULL){
+    ibv_dereg_mr(conn->recv_mr);
+  }
+  if(conn->send_mr != NULL){
+    ibv_dereg_mr(conn->send_mr);
+  }
+  if(conn->qp != NULL){
+    rdma_destroy_qp(conn->cm_id);
+  }
+  if(conn->cq != NULL){
+    ibv_destroy_cq(conn->cq);
+  }
+  if(conn->pd != NULL){
+    ibv_dealloc_pd(conn->pd);
+  }
+  if(conn->cm_id != NULL){
+    rdma_destroy_id(conn->cm_id);
+  }
+  if(conn->ec != NULL){
+    rdma_destroy_event_channel(conn->ec);
+  }
+  free(conn->atomic_result);
+  free(conn->recv_msg);
+  free(conn->send_msg);
+
+  conn->atomic_mr     = NULL;
+  conn->meta_mr       = NULL;
+  conn->recv_mr       = NULL;
+  conn->send_mr       = NULL;
+  conn->qp            = NULL;
+  conn->cq            = NULL;
+  conn->pd            = NULL;
+  conn->cm_id         = NULL;
+  conn->ec            = NULL;
+  conn->atomic_result = NULL;
+  conn->recv_msg      = NULL;
+  conn->send_msg      = NULL;
+}
+
+/**
+ * 1) Build the connection to the memory server, the same procesure with the kernel module.
+ * 2) Get the remote address/rkey of the meta Region, by REQUEST_CHUNKS.
+ * 3) Register the local meta space.
+ */
+static bool cp_connect(int mem_server_id){
+  struct cp_connection* conn = &cp_conn[mem_server_id];
+  struct sockaddr_in addr;
+  struct ibv_qp_init_attr qp_attr;
+  struct rdma_conn_param cm_params;
+  struct semeru_meta_layout_digest layout_digest;
+  bool established = false;
+  int err;
+
+  memset(conn, 0, sizeof(struct cp_connection));
+  pthread_mutex_init(&conn->lock, NULL);
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons((uint16_t)SemeruMemServerPort);
+  if(inet_pton(AF_INET, mem_server_ip[mem_server_id], &addr.sin_addr) != 1){
+    goto fail;
+  }
+
+  // 1) resolve the address and route
+  conn->ec = rdma_create_event_channel();
+  if(conn->ec == NULL || rdma_create_id(conn->ec, &conn->cm_id, NULL, RDMA_PS_TCP) != 0){
+    goto fail;
+  }
+  if(rdma_resolve_addr(conn->cm_id, NULL, (struct sockaddr*)&addr, CP_CM_TIMEOUT_MS) != 0 ||
+     !cp_wait_cm_event(conn, RDMA_CM_EVENT_ADDR_RESOLVED)){
+    goto fail;
+  }
+  if(rdma_resolve_route(conn->cm_id, CP_CM_TIMEOUT_MS) != 0 ||
+     !cp_wait_cm_event(conn, RDMA_CM_EVENT_ROUTE_RESOLVED)){
+    goto fail;
+  }
+
+  // 2) pd, cq, qp and the 2-sided message buffers
+  conn->pd = ibv_alloc_pd(conn->cm_id->verbs);
+  if(conn->pd == NULL){
+    goto fail;
+  }
+  conn->cq = ibv_create_cq(conn->cm_id->verbs, 2 * CP_SQ_DEPTH, NULL, NULL, 0);
+  if(conn->cq == NULL){
+    goto fail;
+  }
+
+  memset(&qp_attr, 0, sizeof(qp_attr));
+  qp_attr.send_cq = conn->cq;
+  qp_attr.recv_cq = conn->cq;
+  qp_attr.qp_type = IBV_QPT_RC;
+  qp_attr.cap.max_send_wr  = CP_SQ_DEPTH;
+  qp_attr.cap.max_recv_wr  = 4;
+  qp_attr.cap.max_send_sge = 1;   // the meta space is one MR, a contiguous range is one sge.
+  qp_attr.cap.max_recv_sge = 1;
+  if(rdma_create_qp(conn->cm_id, conn->pd, &qp_attr) != 0){
+    goto fail;
+  }
+  conn->qp = conn->cm_id->qp;
+
+  conn->send_msg = (struct cp_message*)calloc(1, sizeof(struct cp_message));
+  conn->recv_msg = (struct cp_message*)calloc(1, sizeof(struct cp_message));
+  if(conn->send_msg == NULL || conn->recv_msg == NULL){
+    goto fail;
+  }
+  conn->send_mr = ibv_reg_mr(conn->pd, conn->send_msg, sizeof(struct cp_message), IBV_ACCESS_LOCAL_WRITE);
+  conn->recv_mr = ibv_reg_mr(conn->pd, conn->recv_msg, sizeof(struct cp_message), IBV_ACCESS_LOCAL_WRITE);
+  if(conn->send_mr == NULL || conn->recv_mr == NULL){
+    goto fail;
+  }
+
+  // 3) connect. The memory server sends AVAILABLE_TO_QUERY once the connection is established.
+  //    Carry the layout of the RDMA meta space, the memory server rejects a different one.
+  if(cp_post_recv(conn) != 0){
+    goto fail;
+  }
+  SemeruMetaLayout::fill_digest(&layout_digest);
+  memset(&cm_params, 0, sizeof(cm_params));
+  cm_params.initiator_depth = cm_params.responder_resources = 1;
+  cm_params.retry_count = 7;
+  cm_params.rnr_retry_count = 7; // infinite retry
+  cm_params.private_data = &layout_digest;
+  cm_params.private_data_len = sizeof(layout_digest);
+  if(rdma_connect(conn->cm_id, &cm_params) != 0){
+    goto fail;
+  }
+  if(!cp_wait_cm_event(conn, RDMA_CM_EVENT_ESTABLISHED)){
+    log_warning(semeru,rdma)("%s, memory server[%d] refused the connection. Check the RDMA meta layout : heap 0x%lx, Region 0x%lx, %u memory servers.",
+                             __func__, mem_server_id, SemeruMetaLayout::heap_size(), SemeruMetaLayout::region_size(), SemeruMemServerNum);
+    goto fail;
+  }
+  established = true;
+  if(cp_recv_message(conn, CP_AVAILABLE_TO_QUERY) != 0){
+    goto fail;
+  }
+
+  // 4) get the remote meta Region
+  if(cp_post_recv(conn) != 0 ||
+     cp_send_message(conn, CP_REQUEST_CHUNKS) != 0 ||
+     cp_recv_message(conn, CP_SEND_CHUNKS) != 0){
+    goto fail;
+  }
+  conn->remote_meta_addr = conn->recv_msg->buf[0];
+  conn->remote_meta_rkey = conn->recv_msg->rkey[0];
+  conn->remote_meta_size = (size_t)conn->recv_msg->mapped_size[0];
+
+  // 5) local meta space
+  if(!cp_register_meta_space(conn)){
+    goto fail;
+  }
+
+  // 6) the 8 bytes buffer of the remote atomics. The memory server registers its meta Region with remote atomic access.
+  conn->atomic_result = (uint64_t*)calloc(1, sizeof(uint64_t));
+  if(conn->atomic_result == NULL){
+    goto fail;
+  }
+  conn->atomic_mr = ibv_reg_mr(conn->pd, conn->atomic_result, sizeof(uint64_t), IBV_ACCESS_LOCAL_WRITE);
+  if(conn->atomic_mr == NULL){
+    goto fail;
+  }
+
+  conn->connected = true;
+  log_info(semeru,rdma)("%s, user space control path to memory server[%d] %s:%u, remote meta Region 0x%lx, size 0x%lx",
+                        __func__, mem_server_id, mem_server_ip[mem_server_id], SemeruMemServerPort,
+                        (size_t)conn->remote_meta_addr, conn->remote_meta_size);
+  return true;
+
+fail:
+  // The caller reports errno, keep the one of the failed step.
+  err = errno;
+  cp_teardown(conn, established);
+  errno = err;
+  return false;
+}
+
+//
+// <<<<<<<<<<<<<<<<<<<<<<<  End of connection initialization <<<<<<<<<<<<<<<<<<<<<<<
+//
+
+
+/**
+ * The range has to be fully covered by both the local meta MR and the remote meta Region.
+ */
+static bool cp_covered(struct cp_connection* conn, void* start_addr, size_t size){
+  size_t offset = (size_t)start_addr - SEMERU_START_ADDR;
+
+  return conn->connected &&
+         (size_t)start_addr >= SEMERU_START_ADDR &&
+         offset + size <= SemeruMetaLayout::used_size() &&
+         offset + size <= conn->remote_meta_size;
+}
+
+static void cp_build_wr(struct cp_connection* conn, struct ibv_send_wr* wr, struct ibv_sge* sge,
+                        enum ibv_wr_opcode opcode, void* start_addr, size_t size){
+  memset(wr, 0, sizeof(struct ibv_send_wr));
+  wr->wr_id   = (uintptr_t)wr;
+  wr->opcode  = opcode;
+  wr->sg_list = sge;
+  wr->num_sge = 1;
+  wr->wr.rdma.remote_addr = conn->remote_meta_addr + ((size_t)start_addr - SEMERU_START_ADDR);
+  wr->wr.rdma.rkey        = conn->remote_meta_rkey;
+
+  sge->addr   = (uintptr_t)start_addr;
+  sge->length = (uint32_t)size;
+  sge->lkey   = conn->meta_mr->lkey;
+}
+
+/**
+ * Post the chained wr by one doorbell and wait for the signaled tail.
+ * Invoked with conn->lock.
+ */
+static int cp_post_chain(struct cp_connection* conn, struct ibv_send_wr* wr, int nr_wr){
+  struct ibv_send_wr* bad_wr = NULL;
+  int i;
+
+  for(i = 0; i < nr_wr - 1; i++){
+    wr[i].next = &wr[i + 1];
+  }
+  wr[nr_wr - 1].next = NULL;
+  wr[nr_wr - 1].send_flags = IBV_SEND_SIGNALED;
+
+  if(ibv_post_send(conn->qp, wr, &bad_wr) != 0){
+    log_warning(semeru,rdma)("%s, post %d chained wr failed, %s", __func__, nr_wr, strerror(errno));
+    return -1;
+  }
+  return cp_poll_wr(conn, wr[nr_wr - 1].wr_id);
+}
+
+static int cp_user_rw(int mem_server_id, enum ibv_wr_opcode opcode, void* start_addr, size_t size){
+  struct cp_connection* conn = &cp_conn[mem_server_id];
+  struct ibv_send_wr wr;
+  struct ibv_sge sge;
+  int ret;
+
+  cp_build_wr(conn, &wr, &sge, opcode, start_addr, size);
+
+  pthread_mutex_lock(&conn->lock);
+  ret = cp_post_chain(conn, &wr, 1);
+  pthread_mutex_unlock(&conn->lock);
+
+  return ret;
+}
+
+/**
+ * CAS or fetch-and-add the 8 bytes word addr on the remote meta Region.
+ * The old value lands in conn->atomic_result, the buffer is protected by conn->lock.
+ */
+static int cp_user_atomic(int mem_server_id, enum ibv_wr_opcode opcode, volatile uint64_t* addr,
+                          uint64_t compare_add, uint64_t swap, uint64_t* old){
+  struct cp_connection* conn = &cp_conn[mem_server_id];
+  struct ibv_send_wr wr;
+  struct ibv_sge sge;
+  int ret;
+
+  memset(&wr, 0, sizeof(wr));
+  wr.wr_id   = (uintptr_t)&wr;
+  wr.opcode  = opcode;
+  wr.sg_list = &sge;
+  wr.num_sge = 1;
+  wr.wr.atomic.remote_addr = conn->remote_meta_addr + ((size_t)addr - SEMERU_START_ADDR);
+  wr.wr.atomic.rkey        = conn->remote_meta_rkey;
+  wr.wr.atomic.compare_add = compare_add;
+  wr.wr.atomic.swap        = swap;
+
+  sge.addr   = (uintptr_t)conn->atomic_result;
+  sge.length = (uint32_t)sizeof(uint64_t);
+  sge.lkey   = conn->atomic_mr->lkey;
+
+  pthread_mutex_lock(&conn->lock);
+  ret = cp_post_chain(conn, &wr, 1);
+  *old = *(conn->atomic_result);
+  pthread_mutex_unlock(&conn->lock);
+
+  return ret;
+}
+
+/**
+ * Return true if every entry of the iov can go through the user space path.
+ */
+static bool cp_iov_covered(semeru_rdma_iovec* iov, int nr_iov){
+  int i;
+
+  for(i = 0; i < nr_iov; i++){
+    if(iov[i].write_type != 0 || iov[i].mem_server_id < 0 || iov[i].mem_server_id >= (int)SemeruMemServerNum ||
+       !cp_covered(&cp_conn[iov[i].mem_server_id], iov[i].start_addr, iov[i].size)){
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * Chain the entries of each memory server, at most CP_SQ_DEPTH wr per doorbell.
+ */
+static int cp_user_rwv(semeru_rdma_iovec* iov, int nr_iov, enum ibv_wr_opcode opcode){
+  struct ibv_send_wr wr[CP_SQ_DEPTH];
+  struct ibv_sge sge[CP_SQ_DEPTH];
+  struct cp_connection* conn;
+  int mem_server_id;
+  int nr_wr;
+  int i;
+  int ret = 0;
+
+  for(mem_server_id = 0; mem_server_id < (int)SemeruMemServerNum && ret == 0; mem_server_id++){
+    conn = &cp_conn[mem_server_id];
+    nr_wr = 0;
+
+    pthread_mutex_lock(&conn->lock);
+    for(i = 0; i < nr_iov && ret == 0; i++){
+      if(iov[i].mem_server_id != mem_server_id || iov[i].size == 0){
+        continue;
+      }
+
+      cp_build_wr(conn, &wr[nr_wr], &sge[nr_wr], opcode, iov[i].start_addr, iov[i].size);
+      if(++nr_wr == CP_SQ_DEPTH){
+        ret = cp_post_chain(conn, wr, nr_wr);
+        nr_wr = 0;
+      }
+    }
+    if(nr_wr && ret == 0){
+      ret = cp_post_chain(conn, wr, nr_wr);
+    }
+    pthread_mutex_unlock(&conn->lock);
+  }
+
+  return ret;
+}
+
+/**
+ * Split SemeruMemServerIPs, one address per memory server.
+ * Return the number of parsed addresses.
+ */
+static int cp_parse_mem_server_ips(){
+  const char* p = SemeruMemServerIPs;
+  int n = 0;
+
+  while(p != NULL && *p != '\0' && n < MAX_NUM_OF_MEMORY_SERVER){
+    const char* comma = strchr(p, ',');
+    size_t len = (comma != NULL) ? (size_t)(comma - p) : strlen(p);
+
+    if(len > 0 && len < INET_ADDRSTRLEN){
+      memcpy(mem_server_ip[n], p, len);
+      mem_server_ip[n][len] = '\0';
+      n++;
+    }
+    p = (comma != NULL) ? comma + 1 : NULL;
+  }
+
+  return n;
+}
+
+#endif // SEMERU_USER_CP
+
+
+
+void semeru_cp_comm_init(){
+  guarantee(RDMA_DATA_REGION_NUM % SemeruMemServerNum == 0,
+            "%s, SemeruMemServerNum %u has to divide the " SIZE_FORMAT " data Regions.",
+            __func__, SemeruMemServerNum, (size_t)RDMA_DATA_REGION_NUM);
+
+#ifdef SEMERU_USER_CP
+  int mem_server_id;
+  int nr_ips = cp_parse_mem_server_ips();
+
+  for(mem_server_id = 0; mem_server_id < (int)SemeruMemServerNum; mem_server_id++){
+    if(mem_server_id >= nr_ips){
+      log_warning(semeru,rdma)("%s, no SemeruMemServerIPs entry for memory server[%d]. Use the kernel path.",
+                               __func__, mem_server_id);
+      continue;
+    }
+
+    if(!cp_connect(mem_server_id)){
+      cp_conn[mem_server_id].connected = false;
+      log_warning(semeru,rdma)("%s, user space control path to memory server[%d] failed, %s. Use the kernel path.",
+                               __func__, mem_server_id, strerror(errno));
+    }
+  }
+#endif
+}
+
+// SEMERU_PLACEMENT_LOAD, the placement decided by the kernel at the first access of each data Region.
+// Record the memory server id + 1, 0 means not queried yet.
+// The kernel moves a data Region only at semeru_sync_placement(), which drops the records.
+static volatile int data_region_placement[RDMA_DATA_REGION_NUM];
+static int data_region_placement_epoch = -1;
+
+void semeru_sync_placement(){
+  if(SemeruPlacementPolicy != SEMERU_PLACEMENT_LOAD){
+    return;
+  }
+
+  int epoch = syscall(RDMA_QUERY_PLACEMENT, 0, NULL, 0);
+  if(epoch < 0 || epoch == data_region_placement_epoch){
+    return;
+  }
+
+  if(data_region_placement_epoch >= 0){
+    log_info(semeru,rdma)("%s, data Regions moved between the memory servers, placement epoch %d -> %d",
+                          __func__, data_region_placement_epoch, epoch);
+  }
+  for(size_t i = 0; i < RDMA_DATA_REGION_NUM; i++){
+    data_region_placement[i] = 0;
+  }
+  data_region_placement_epoch = epoch;
+}
+
+int semeru_mem_server_of_addr(void* addr){
+  size_t data_region = ((size_t)addr - RDMA_DATA_SPACE_START_ADDR) / (REGION_SIZE_GB * ONE_GB);
+  size_t data_region_per_mem_server = RDMA_DATA_REGION_NUM / SemeruMemServerNum;
+  int mem_server_id;
+
+  assert((size_t)addr >= RDMA_DATA_SPACE_START_ADDR && data_region < RDMA_DATA_REGION_NUM,
+         "%s, 0x%lx is not in the data space.", __func__, (size_t)addr);
+
+  switch(SemeruPlacementPolicy){
+    case SEMERU_PLACEMENT_INTERLEAVE:
+      return (int)(data_region % SemeruMemServerNum);
+
+    case SEMERU_PLACEMENT_LOAD:
+      mem_server_id = data_region_placement[data_region] - 1;
+      if(mem_server_id < 0){
+        // Racing threads get the same answer from the kernel.
+        mem_server_id = syscall(RDMA_QUERY_PLACEMENT, 0, addr, 0);
+        guarantee(mem_server_id >= 0, "%s, query the placement of 0x%lx failed.", __func__, (size_t)addr);
+        data_region_placement[data_region] = mem_server_id + 1;
+      }
+      return mem_server_id;
+
+    default: // SEMERU_PLACEMENT_RANGE
+      return (int)(data_region / data_region_per_mem_server);
+  }
+}
+
+bool semeru_cp_user_path_enabled(int mem_server_id){
+#ifdef SEMERU_USER_CP
+  return cp_conn[mem_server_id].connected;
+#else
+  return false;
+#endif
+}
+
+int semeru_cp_read(int mem_server_id, void* start_addr, size_t size){
+  jlong start = os::elapsed_counter();
+  int ret;
+#ifdef SEMERU_USER_CP
+  if(cp_covered(&cp_conn[mem_server_id], start_addr, size)){
+    ret = cp_user_rw(mem_server_id, IBV_WR_RDMA_READ, start_addr, size);
+  }else
+#endif
+  ret = syscall(RDMA_READ, mem_server_id, start_addr, size);
+  G1SemeruRdmaStats::record(mem_server_id, size, start);
+  return ret;
+}
+
+int semeru_cp_write(int mem_server_id, void* start_addr, size_t size){
+  jlong start = os::elapsed_counter();
+  int ret;
+#ifdef SEMERU_USER_CP
+  if(cp_covered(&cp_conn[mem_server_id], start_addr, size)){
+    ret = cp_user_rw(mem_server_id, IBV_WR_RDMA_WRITE, start_addr, size);
+  }else
+#endif
+  ret = syscall(RDMA_WRITE, mem_server_id, start_addr, size);
+  G1SemeruRdmaStats::record(mem_server_id, size, start);
+  return ret;
+}
+
+int semeru_cp_writev(semeru_rdma_iovec* iov, int nr_iov){
+  jlong start = os::elapsed_counter();
+  int ret;
+#ifdef SEMERU_USER_CP
+  if(cp_iov_covered(iov, nr_iov)){
+    ret = cp_user_rwv(iov, nr_iov, IBV_WR_RDMA_WRITE);
+  }else
+#endif
+  ret = syscall(RDMA_WRITEV, 0, iov, nr_iov);
+  G1SemeruRdmaStats::record_iovec(iov, nr_iov, start);
+  return ret;
+}
+
+int semeru_cp_writev_async(semeru_rdma_iovec* iov, int nr_iov){
+  jlong start = os::elapsed_counter();
+#ifdef SEMERU_USER_CP
+  // The user space path is close to the wire latency, just finish it here.
+  if(cp_iov_covered(iov, nr_iov)){
+    guarantee(cp_user_rwv(iov, nr_iov, IBV_WR_RDMA_WRITE) == 0, "%s, user space vectored write of %d entries failed.", __func__, nr_iov);
+    G1SemeruRdmaStats::record_iovec(iov, nr_iov, start);
+    return -1;
+  }
+#endif
+  int ticket = syscall(RDMA_WRITEV_ASYNC, 0, iov, nr_iov);
+  guarantee(ticket >= 0, "%s, RDMA vectored write of %d entries failed.", __func__, nr_iov);
+  // The posting only, the rest is counted by semeru_cp_wait().
+  G1SemeruRdmaStats::record_iovec(iov, nr_iov, start);
+  return ticket;
+}
+
+int semeru_cp_readv(semeru_rdma_iovec* iov, int nr_iov){
+  jlong start = os::elapsed_counter();
+  int ret;
+#ifdef SEMERU_USER_CP
+  if(cp_iov_covered(iov, nr_iov)){
+    ret = cp_user_rwv(iov, nr_iov, IBV_WR_RDMA_READ);
+  }else
+#endif
+  ret = syscall(RDMA_READV, 0, iov, nr_iov);
+  G1SemeruRdmaStats::record_iovec(iov, nr_iov, start);
+  return ret;
+}
+
+int semeru_cp_bcast(void* start_addr, size_t size){
+  jlong start = os::elapsed_counter();
+  int ret;
+#ifdef SEMERU_USER_CP
+  semeru_rdma_iovec iov[MAX_NUM_OF_MEMORY_SERVER];
+  int mem_server_id;
+
+  for(mem_server_id = 0; mem_server_id < (int)SemeruMemServerNum; mem_server_id++){
+    iov[mem_server_id].mem_server_id = mem_server_id;
+    iov[mem_server_id].write_type    = 0;
+    iov[mem_server_id].start_addr    = (char*)start_addr;
+    iov[mem_server_id].size          = size;
+  }
+  if(cp_iov_covered(iov, (int)SemeruMemServerNum)){
+    ret = cp_user_rwv(iov, (int)SemeruMemServerNum, IBV_WR_RDMA_WRITE);
+  }else
+#endif
+  ret = syscall(RDMA_BCAST, 0, start_addr, size);
+  G1SemeruRdmaStats::record(-1, size, start);
+  return ret;
+}
+
+static int semeru_cp_atomic(int mem_server_id, int op, volatile uint64_t* addr, uint64_t compare_add, uint64_t swap, uint64_t* old){
+  semeru_rdma_atomic atomic;
+  jlong start = os::elapsed_counter();
+  int ret;
+
+  assert(((size_t)addr & (sizeof(uint64_t) - 1)) == 0, "%s, 0x%lx is not 8 bytes aligned.", __func__, (size_t)addr);
+#ifdef SEMERU_USER_CP
+  if(cp_covered(&cp_conn[mem_server_id], (void*)addr, sizeof(uint64_t))){
+    ret = cp_user_atomic(mem_server_id, op == SEMERU_RDMA_ATOMIC_CAS ? IBV_WR_ATOMIC_CMP_AND_SWP : IBV_WR_ATOMIC_FETCH_AND_ADD,
+                         addr, compare_add, swap, old);
+    G1SemeruRdmaStats::record(mem_server_id, sizeof(uint64_t), start);
+    return ret;
+  }
+#endif
+  atomic.op          = op;
+  atomic.pad         = 0;
+  atomic.addr        = (char*)addr;
+  atomic.compare_add = compare_add;
+  atomic.swap        = swap;
+  atomic.result      = 0;
+  ret = syscall(RDMA_ATOMIC, mem_server_id, &atomic, 0);
+  *old = atomic.result;
+  G1SemeruRdmaStats::record(mem_server_id, sizeof(uint64_t), start);
+  return ret;
+}
+
+int semeru_cp_cas(int mem_server_id, volatile uint64_t* addr, uint64_t compare, uint64_t swap, uint64_t* old){
+  return semeru_cp_atomic(mem_server_id, SEMERU_RDMA_ATOMIC_CAS, addr, compare, swap, old);
+}
+
+int semeru_cp_fetch_add(int mem_server_id, volatile uint64_t* addr, uint64_t add, uint64_t* old){
+  return semeru_cp_atomic(mem_server_id, SEMERU_RDMA_ATOMIC_FETCH_ADD, addr, add, 0, old);
+}
+
+int semeru_cp_peek(void* addr, void* buf, size_t size){
+  semeru_rdma_peek peek;
+  jlong start = os::elapsed_counter();
+  int ret;
+
+  assert(size > 0 && size <= SEMERU_RDMA_PEEK_MAX_SIZE, "%s, can't peek " SIZE_FORMAT " bytes.", __func__, size);
+  peek.addr = (char*)addr;
+  peek.buf  = (char*)buf;
+  peek.size = size;
+  ret = syscall(RDMA_PEEK, 0, &peek, 0);
+  if(ret == 0){
+    G1SemeruRdmaStats::record(semeru_mem_server_of_addr(addr), size, start);
+  }
+  return ret;
+}
+
+int semeru_cp_invalidate(void* start_addr, size_t size){
+  assert(((size_t)start_addr & (PAGE_SIZE - 1)) == 0, "%s, 0x%lx is not page aligned.", __func__, (size_t)start_addr);
+  return syscall(RDMA_INVALIDATE, 0, start_addr, size);
+}
+
+int semeru_cp_wait(int ticket){
+  if(ticket < 0){
+    return 0;
+  }
+  jlong start = os::elapsed_counter();
+  int ret = syscall(RDMA_WAIT, ticket, NULL, 0);
+  G1SemeruRdmaStats::record_wait(start);
+  return ret;
+}
+
+
+//
+// -XX:+SemeruSafepointFaultState
+//
+
+#define CP_FAULT_STATE_SLOTS  (PAGE_SIZE / sizeof(uint32_t))  // one page, slot 0 is the safepoint flag
+
+static volatile uint32_t* fault_state = NULL;
+static volatile jbyte     fault_slot_used[CP_FAULT_STATE_SLOTS];
+
+bool semeru_fault_state_init(){
+  void* array = os::malloc(2 * PAGE_SIZE, mtInternal);
+  if(array == NULL){
+    return false;
+  }
+  volatile uint32_t* state = (volatile uint32_t*)align_up((size_t)array, PAGE_SIZE);
+  memset((void*)state, 0, PAGE_SIZE);
+
+  if(syscall(RDMA_FAULT_STATE, 0, (void*)state, PAGE_SIZE) != 0){
+    log_info(semeru, rdma)("%s, the kernel doesn't share the fault state, RDMA_FAULT_STATE failed.", __func__);
+    os::free(array);
+    return false;
+  }
+  fault_state = state;
+  log_info(semeru, rdma)("%s, %lu fault state slots at 0x%lx", __func__, CP_FAULT_STATE_SLOTS - 1, (size_t)state);
+  return true;
+}
+
+int semeru_fault_state_attach(){
+  if(fault_state == NULL){
+    return 0;
+  }
+  for(int slot = 1; slot < (int)CP_FAULT_STATE_SLOTS; slot++){
+    if(fault_slot_used[slot] == 0 && Atomic::cmpxchg((jbyte)1, &fault_slot_used[slot], (jbyte)0) == 0){
+      if(syscall(RDMA_FAULT_STATE, 1, NULL, slot) != 0){
+        fault_slot_used[slot] = 0;
+        return 0;
+      }
+      return slot;
+    }
+  }
+  return 0;  // more threads than slots, they stay unattributed.
+}
+
+void semeru_fault_state_detach(int slot){
+  if(slot == 0){
+    return;
+  }
+  syscall(RDMA_FAULT_STATE, 1, NULL, 0);
+  fault_state[slot] = 0;
+  OrderAccess::release_store(&fault_slot_used[slot], (jbyte)0);
+}
+
+bool semeru_fault_state_in_fault(int slot){
+  return slot != 0 && fault_state[slot] != 0;
+}
+
+void semeru_fault_state_safepoint(bool synchronizing){
+  if(fault_state != NULL){
+    fault_state[0] = synchronizing ? 1 : 0;
+  }
+}
@@ -0,0 +1,86 @@
+#ifndef RDMA_CP_COMM_H
+#define RDMA_CP_COMM_H
+
+#include "utilities/globalDefinitions.hpp"
+
+
+/**
+ * Semeru CPU server - user space control path.
+ *
+ * The JVM builds its own RDMA connection, one QP per memory server, by the user space verbs.
+ * The used RDMA meta space, [SEMERU_START_ADDR, SEMERU_START_ADDR + SemeruMetaLayout::used_size()),
+ * is registered once as an On-Demand-Paging MR, so the CHeapRDMAObj structures are read/written
+ * from user space directly, without the syscall and the per-call page walking.
+ * The connect request carries the digest of the layout, gc/shared/rdmaMetaLayout.hpp.
+ *
+ * The kernel control path, sys_do_semeru_rdma_ops, is still the fallback :
+ *  1) SEMERU_USER_CP is not defined, or the connection/registration failed at initialization.
+ *  2) The range is out of the registered meta space, e.g. flush the data Regions.
+ *  3) Signal writes. They need to drain the data path in kernel first.
+ *     All the user space writes are already done when the signal is issued.
+ *
+ * Warning :
+ *  The Memory server has RDMA_QUEUE_NUM slots for the QP of a CPU server.
+ *  It has to cover the kernel's online cores plus one QP of the JVM.
+ *
+ */
+
+// Connect to all the memory servers.
+// Invoke it after the RDMA meta space is reserved.
+void semeru_cp_comm_init();
+bool semeru_cp_user_path_enabled(int mem_server_id);
+
+// Memory server topology, the same placement with translate_data_addr_to_mem_server_addr() of the kernel module.
+// The data space is placed to the SemeruMemServerNum memory servers by SemeruPlacementPolicy.
+int semeru_mem_server_of_addr(void* addr);
+// Move the data Regions queued by the kernel between the memory servers, SEMERU_PLACEMENT_LOAD only.
+// Invoke it in the GC pause before any Region is dispatched to a memory server.
+void semeru_sync_placement();
+
+// The same semantics with syscall(RDMA_READ/RDMA_WRITE, ...). Return 0 for success.
+int semeru_cp_read(int mem_server_id, void* start_addr, size_t size);
+int semeru_cp_write(int mem_server_id, void* start_addr, size_t size);
+
+// The same semantics with syscall(RDMA_WRITEV/RDMA_WRITEV_ASYNC/RDMA_WAIT, ...).
+// semeru_cp_writev_async() returns -1 when all the entries are already done by the user space path.
+int semeru_cp_writev(semeru_rdma_iovec* iov, int nr_iov);
+int semeru_cp_writev_async(semeru_rdma_iovec* iov, int nr_iov);
+int semeru_cp_wait(int ticket);
+
+// The same semantics with syscall(RDMA_READV, ...). The entries are data only, write_type 0.
+int semeru_cp_readv(semeru_rdma_iovec* iov, int nr_iov);
+
+// The same semantics with syscall(RDMA_BCAST, 0, ...). Write the range to all the memory servers,
+// return 0 after every one of them acknowledged.
+int semeru_cp_bcast(void* start_addr, size_t size);
+
+// The same semantics with syscall(RDMA_ATOMIC, ...). addr is an 8 bytes word of the meta space,
+// the atomic is executed by the RDMA device of the memory server on its copy of the word.
+// Return 0 for success, the old value of the word is stored into *old.
+int semeru_cp_cas(int mem_server_id, volatile uint64_t* addr, uint64_t compare, uint64_t swap, uint64_t* old);
+int semeru_cp_fetch_add(int mem_server_id, volatile uint64_t* addr, uint64_t add, uint64_t* old);
+
+// The same semantics with syscall(RDMA_PEEK, ...). Read [addr, addr + size) of a swapped out data page
+// into buf by one small RDMA read, the page isn't swapped in. Always through the kernel, the data space
+// isn't registered by the user space path.
+// Return 0 for success, 1 if the page is resident and has to be loaded directly, -1 for error.
+int semeru_cp_peek(void* addr, void* buf, size_t size);
+
+// The same semantics with syscall(RDMA_INVALIDATE, ...). Drop the local copies of [start_addr, start_addr + size)
+// of the data space, rewritten by the memory servers. The next access swaps them in again.
+// Return the number of pages still mapped, -1 for error.
+int semeru_cp_invalidate(void* start_addr, size_t size);
+
+// -XX:+SemeruSafepointFaultState. The kernel marks the slot of a Java thread while it waits for the RDMA read
+// of a frontswap load, see RDMA_FAULT_STATE. Slot 0 is never bound, it tells the kernel a safepoint is synchronizing.
+// Return false if the kernel doesn't share the array.
+bool semeru_fault_state_init();
+// Bind the current thread to a free slot. Return the slot, 0 for none.
+int  semeru_fault_state_attach();
+// The current thread leaves its slot.
+void semeru_fault_state_detach(int slot);
+bool semeru_fault_state_in_fault(int slot);
+void semeru_fault_state_safepoint(bool synchronizing);
+
+
+#endif // RDMA_CP_COMM_H
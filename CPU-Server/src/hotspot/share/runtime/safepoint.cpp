@@ -52,6 +52,7 @@
 #include "runtime/mutexLocker.hpp"
 #include "runtime/orderAccess.hpp"
 #include "runtime/osThread.hpp"
+#include "runtime/rdma_cp_comm.hpp"
 #include "runtime/safepoint.hpp"
 #include "runtime/safepointMechanism.inline.hpp"
 #include "runtime/signature.hpp"
@@ -256,6 +257,16 @@ void SafepointSynchronize::begin() {
     int ncpus = os::processor_count() ;
     unsigned int iterations = 0;
 
+    // Semeru, the part of the synchronization only waiting for the threads in a remote page fault.
+    // Such a thread is at an arbitrary pc of its Java code, without an oop map, so it can't be taken
+    // as safe like a blocked native thread. Its fault issues no prefetch meanwhile, see semeru_frontswap_load().
+    jlong fault_wait_start = 0;
+    jlong fault_wait_ns    = 0;
+    int   max_in_fault     = 0;
+    if (SemeruSafepointFaultState) {
+      semeru_fault_state_safepoint(true);
+    }
+
     {
       JavaThreadIteratorWithHandle jtiwh;
 #ifdef ASSERT
@@ -272,6 +283,7 @@ void SafepointSynchronize::begin() {
       // Iterate through all threads until it have been determined how to stop them all at a safepoint
       int steps = 0 ;
       while(still_running > 0) {
+        int in_fault = 0;
         jtiwh.rewind();
         for (; JavaThread *cur = jtiwh.next(); ) {
           assert(!cur->is_ConcurrentGC_thread(), "A concurrent GC thread is unexpectly being suspended");
@@ -286,6 +298,8 @@ void SafepointSynchronize::begin() {
               //   steps >>= 1
               //   steps = MIN(steps, 2000-100)
               //   if (iterations != 0) steps -= NNN
+            } else if (semeru_fault_state_in_fault(cur->semeru_fault_slot())) {
+              in_fault++;
             }
             LogTarget(Trace, safepoint) lt;
             if (lt.is_enabled()) {
@@ -296,6 +310,15 @@ void SafepointSynchronize::begin() {
           }
         }
 
+        if (SemeruSafepointFaultState) {
+          jlong now = os::javaTimeNanos();
+          if (fault_wait_start != 0) {
+            fault_wait_ns += now - fault_wait_start;
+          }
+          fault_wait_start = (still_running > 0 && in_fault == still_running) ? now : 0;
+          max_in_fault = MAX2(max_in_fault, in_fault);
+        }
+
         if (iterations == 0) {
           initial_running = still_running;
           if (log_is_enabled(Debug, safepoint, stats)) {
@@ -387,6 +410,14 @@ void SafepointSynchronize::begin() {
     } // ThreadsListHandle destroyed here.
     assert(still_running == 0, "sanity check");
 
+    if (SemeruSafepointFaultState) {
+      semeru_fault_state_safepoint(false);
+      if (max_in_fault > 0) {
+        log_info(safepoint)("Semeru, %.3f ms of the synchronization only waited for the threads in remote page faults, "
+                            "%d of them at most", (double)fault_wait_ns / NANOSECS_PER_MILLISEC, max_in_fault);
+      }
+    }
+
     if (log_is_enabled(Debug, safepoint, stats)) {
       update_statistics_on_spin_end();
     }
@@ -82,6 +82,7 @@
 #include "runtime/orderAccess.hpp"
 #include "runtime/osThread.hpp"
 #include "runtime/prefetch.inline.hpp"
+#include "runtime/rdma_cp_comm.hpp"
 #include "runtime/safepoint.hpp"
 #include "runtime/safepointMechanism.inline.hpp"
 #include "runtime/safepointVerifiers.hpp"
@@ -1542,6 +1543,7 @@ void JavaThread::collect_counters(typeArrayOop array) {
 void JavaThread::initialize() {
   // Initialize fields
 
+  _semeru_fault_slot = 0;
   set_saved_exception_pc(NULL);
   set_threadObj(NULL);
   _anchor.clear();
@@ -1769,6 +1771,11 @@ void JavaThread::run() {
 
   this->cache_global_variables();
 
+  // Semeru, bound before the safepoint code sees the thread.
+  if (SemeruSafepointFaultState) {
+    set_semeru_fault_slot(semeru_fault_state_attach());
+  }
+
   // Thread is now sufficient initialized to be handled by the safepoint code as being
   // in the VM. Change thread state from _thread_new to _thread_in_vm
   ThreadStateTransition::transition_and_fence(this, _thread_new, _thread_in_vm);
@@ -2007,6 +2014,13 @@ void JavaThread::exit(bool destroy_vm, ExitType exit_type) {
   // before removing a thread from the list of active threads.
   BarrierSet::barrier_set()->on_thread_detach(this);
 
+  // Semeru, cleared before the slot is freed, the safepoint code doesn't see the next thread of the slot.
+  if (_semeru_fault_slot != 0) {
+    int slot = _semeru_fault_slot;
+    _semeru_fault_slot = 0;
+    semeru_fault_state_detach(slot);
+  }
+
   log_info(os, thread)("JavaThread %s (tid: " UINTX_FORMAT ").",
     exit_type == JavaThread::normal_exit ? "exiting" : "detaching",
     os::current_thread_id());
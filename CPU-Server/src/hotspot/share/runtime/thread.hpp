@@ -1129,6 +1129,9 @@ class JavaThread: public Thread {
   // For deadlock detection.
   int _depth_first_number;
 
+  // Semeru, -XX:+SemeruSafepointFaultState. The slot the kernel marks while this thread waits for a remote page, 0 for none.
+  int _semeru_fault_slot;
+
   // JVMTI PopFrame support
   // This is set to popframe_pending to signal that top Java frame should be popped immediately
   int _popframe_condition;
@@ -1788,6 +1791,10 @@ class JavaThread: public Thread {
   int depth_first_number() { return _depth_first_number; }
   void set_depth_first_number(int dfn) { _depth_first_number = dfn; }
 
+  // Semeru, the thread is in a remote page fault, see semeru_fault_state_attach().
+  int semeru_fault_slot() const { return _semeru_fault_slot; }
+  void set_semeru_fault_slot(int slot) { _semeru_fault_slot = slot; }
+
  private:
   void set_monitor_chunks(MonitorChunk* monitor_chunks) { _monitor_chunks = monitor_chunks; }
 
@@ -49,6 +49,10 @@
 #include "utilities/debug.hpp"
 #include "utilities/formatBuffer.hpp"
 #include "utilities/macros.hpp"
+#if INCLUDE_G1GC
+#include "gc/g1/g1SemeruFaultProfiler.hpp"
+#include "gc/g1/g1SemeruTimeline.hpp"
+#endif
 
 
 static void loadAgentModule(TRAPS) {
@@ -84,6 +88,10 @@ void DCmdRegistrant::register_dcmds(){
   DCmdFactory::register_DCmdFactory(new DCmdFactoryImpl<SystemGCDCmd>(full_export, true, false));
   DCmdFactory::register_DCmdFactory(new DCmdFactoryImpl<RunFinalizationDCmd>(full_export, true, false));
   DCmdFactory::register_DCmdFactory(new DCmdFactoryImpl<HeapInfoDCmd>(full_export, true, false));
+#if INCLUDE_G1GC
+  DCmdFactory::register_DCmdFactory(new DCmdFactoryImpl<SemeruTimelineDCmd>(full_export, true, false));
+  DCmdFactory::register_DCmdFactory(new DCmdFactoryImpl<SemeruFaultProfileDCmd>(full_export, true, false));
+#endif
   DCmdFactory::register_DCmdFactory(new DCmdFactoryImpl<FinalizerInfoDCmd>(full_export, true, false));
 #if INCLUDE_SERVICES
   DCmdFactory::register_DCmdFactory(new DCmdFactoryImpl<HeapDumpDCmd>(DCmd_Source_Internal | DCmd_Source_AttachAPI, true, false));
@@ -446,6 +454,24 @@ void RunFinalizationDCmd::execute(DCmdSource source, TRAPS) {
                          vmSymbols::void_method_signature(), CHECK);
 }
 
+#if INCLUDE_G1GC
+void SemeruTimelineDCmd::execute(DCmdSource source, TRAPS) {
+  if (!UseG1GC || !G1SemeruTimeline::is_enabled()) {
+    output()->print_cr("The Semeru timeline is disabled, run with -XX:+SemeruTimeline.");
+    return;
+  }
+  G1SemeruTimeline::print_on(output());
+}
+
+void SemeruFaultProfileDCmd::execute(DCmdSource source, TRAPS) {
+  if (!UseG1GC || !G1SemeruFaultProfiler::is_enabled()) {
+    output()->print_cr("The Semeru fault profiler is disabled, run with -XX:SemeruFaultSamplePeriod=N.");
+    return;
+  }
+  G1SemeruFaultProfiler::print_on(output());
+}
+#endif
+
 void HeapInfoDCmd::execute(DCmdSource source, TRAPS) {
   MutexLocker hl(Heap_lock);
   Universe::heap()->print_on(output());
@@ -285,6 +285,35 @@ public:
     virtual void execute(DCmdSource source, TRAPS);
 };
 
+// Semeru
+class SemeruTimelineDCmd : public DCmd {
+public:
+  SemeruTimelineDCmd(outputStream* output, bool heap) : DCmd(output, heap) { }
+  static const char* name() { return "GC.semeru_timeline"; }
+  static const char* description() {
+    return "Print the phases of the last pauses on this server and on the memory servers, -XX:+SemeruTimeline.";
+  }
+  static const char* impact() {
+    return "Low";
+  }
+  static int num_arguments() { return 0; }
+  virtual void execute(DCmdSource source, TRAPS);
+};
+
+class SemeruFaultProfileDCmd : public DCmd {
+public:
+  SemeruFaultProfileDCmd(outputStream* output, bool heap) : DCmd(output, heap) { }
+  static const char* name() { return "GC.semeru_fault_profile"; }
+  static const char* description() {
+    return "Print the sampled remote faults by Java method and by object type, -XX:SemeruFaultSamplePeriod.";
+  }
+  static const char* impact() {
+    return "Low";
+  }
+  static int num_arguments() { return 0; }
+  virtual void execute(DCmdSource source, TRAPS);
+};
+
 class HeapInfoDCmd : public DCmd {
 public:
   HeapInfoDCmd(outputStream* output, bool heap) : DCmd(output, heap) { }
@@ -48,6 +48,9 @@ int LogMinObjAlignmentInBytes  = -1;
 // Oop encoding heap max
 uint64_t OopEncodingHeapMax = 0;
 
+// Semeru - the window 0 until the flags are parsed, -XX:SemeruAddressWindow.
+size_t semeru_start_addr = SEMERU_BASE_START_ADDR;
+
 // Something to help porters sleep at night
 
 void basic_types_init() {
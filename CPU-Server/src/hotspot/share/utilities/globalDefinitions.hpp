@@ -118,9 +118,183 @@
 #define RDMA_WRITE_SIGNAL 333,0x3
 #define RDMA_WRITE  333,0x2
 #define RDMA_READ   333,0x1
+#define SEMERU_PREFETCH_HINT 333,0x9  // (window in pages, start_addr, size), window 0 removes the hints.
+#define RDMA_WRITEV       333,0xa  // (0, semeru_rdma_iovec*, entries), return after all the entries are done.
+#define RDMA_WRITEV_ASYNC 333,0xb  // (0, semeru_rdma_iovec*, entries), return a ticket for RDMA_WAIT.
+#define RDMA_WAIT         333,0xc  // (ticket, NULL, 0)
+#define RDMA_META_REGISTER 333,0xd // (0, start_addr, size), size 0 unregisters the meta space.
+#define RDMA_WRITE_DIRTY  333,0xe  // (mem_server_id or -1 for all, start_addr, size), return the number of dirty pages sent.
+#define RDMA_WAIT_MEM_SERVER 333,0xf // (mem_server_id, NULL, state), state 0 resets. Return -1 for timeout.
+#define RDMA_RING_DOORBELL 333,0x10  // (mem_server_id, NULL, seqno), wake up the memory server after writing the CSet or flags.
+#define RDMA_EXPAND_CHUNKS 333,0x11  // (0, start_addr, size), back the committed data space by the remote memory.
+#define RDMA_RELEASE_CHUNKS 333,0x12 // (0, start_addr, size), give back the remote chunks fully covered by the range.
+#define RDMA_QUERY_PLACEMENT 333,0x13 // (0, addr, 0), return the memory server id backing the data space addr. NULL addr moves the queued data Regions, returns the placement epoch.
+#define RDMA_REGION_FENCE 333,0x14   // (fence op, start_addr, size), fence a Region for the concurrent compaction.
+#define RDMA_READV        333,0x15   // (0, semeru_rdma_iovec*, entries), data entries only. Return after all the entries are done.
+#define RDMA_SWAP_OUT_MAP 333,0x16   // (unit log, counters, bytes), share the swapped out pages of each unit of the data space. bytes 0 unregisters it.
+#define RDMA_EVICT        333,0x17   // (async, start_addr, size), swap out the range at once. Sync returns the pages not paged out.
+#define RDMA_EVICT_WAIT   333,0x18   // (0, NULL, 0), wait for the async RDMA_EVICT, return the pages they didn't page out.
+#define RDMA_PREFETCH_RANGE 333,0x19 // (0, start_addr, size), read the swapped out pages into the prefetch cache. Return the pages issued.
+#define RDMA_BCAST        333,0x1a   // (server mask or 0 for all, start_addr, size), one write to all the memory servers in parallel.
+#define RDMA_BCAST_SIGNAL 333,0x1b   // (server mask or 0 for all, start_addr, size), the signal version of RDMA_BCAST.
+#define RDMA_ATOMIC       333,0x1c   // (mem_server_id, semeru_rdma_atomic*, 0), CAS or fetch-and-add a word of the meta space.
+#define RDMA_PEEK         333,0x1d   // (0, semeru_rdma_peek*, 0), read a few bytes of a swapped out page. Return 1 if the page is resident.
+#define RDMA_RECLAIM_HINTS 333,0x1e  // (unit log, hints, bytes), share the reclaim hint of each unit of the data space. bytes 0 unregisters it.
+#define RDMA_DISCARD      333,0x1f   // (0, start_addr, size), drop the local pages and swap entries of the freed Regions. Return the swap entries freed.
+#define RDMA_SNAPSHOT     333,0x20   // (snapshot op, start_addr, size), keep the pages of the range on the memory servers beyond this process.
+#define RDMA_FETCH_ASYNC  333,0x21   // (0, start_addr, size), a fault without waiting. Return the swapped out pages of the range not arrived yet, their reads are issued.
+#define RDMA_CACHE_LIMIT  333,0x23   // (evict period ms or 0, start_addr, size), return the memory cgroup limit in MB, 0 if unlimited. Evict the cold Regions of the range near it.
+#define RDMA_SWAP_IN_MAP  333,0x24   // (unit log, map, bytes), share the pages swapped in of each unit of the data space, only growing.
+#define RDMA_INVALIDATE   333,0x25   // (0, start_addr, size), drop the local copies of the pages the memory servers rewrote. Return the pages left.
+#define RDMA_PAGE_AFFINITY 333,0x26  // (0, table, bytes), share the page affinity of the data space with the prefetcher. bytes 0 unregisters it.
+#define RDMA_FAULT_STATE   333,0x27  // (op, addr, size), op 0 shares the fault state array of size bytes, op 1 binds the current thread to the slot size, 0 unbinds it.
+#define RDMA_FAULT_SAMPLES 333,0x28  // (period, ring, bytes), the kernel samples 1 of period swap-ins of this process into the ring. bytes 0 unregisters it.
+
+// Ops of RDMA_REGION_FENCE, the same as the kernel.
+#define SEMERU_FENCE_GRANT    0   // return 0, -1 if the kernel fence table is full.
+#define SEMERU_FENCE_CLOSE    1   // return 1 if the Region wasn't swapped in or out since the grant, 2 if its swapped in pages
+                                  // are all written back, 0 if revoked.
+#define SEMERU_FENCE_RELEASE  2
+#define SEMERU_FENCE_REWRITE  3   // the memory server rewrites the Region, write back and drop the local copies of its pages.
+#define SEMERU_FENCE_WRITTEN  4   // (op, semeru_fence_written*, bytes), the pages written back into a Region closed by 2.
+
+// Ops of RDMA_SNAPSHOT, the same as the kernel.
+#define SEMERU_SNAPSHOT_SAVE     0   // swap out the range and hold its swap entries. Return the pages not saved.
+#define SEMERU_SNAPSHOT_RESTORE  1   // map the held pages at the same addresses of the caller. Return the pages mapped.
+#define SEMERU_SNAPSHOT_DROP     2   // release the held pages. Return the pages dropped.
+
+// Reclaim hints of RDMA_RECLAIM_HINTS, one byte per Region, the same as the kernel.
+// Bits 0-3, the G1HeapRegionTraceType of the Region. Bits 4-5, the reclaim priority.
+#define SEMERU_REGION_TYPE_MASK   0xf
+#define SEMERU_RECLAIM_SHIFT      4
+#define SEMERU_RECLAIM_NORMAL     0   // not committed
+#define SEMERU_RECLAIM_KEEP       1   // eden and survivor, never bulk evicted
+#define SEMERU_RECLAIM_FIRST      2   // old, humongous and archive
+#define SEMERU_RECLAIM_DISCARD    3   // free, evicted without the write back
+
+// States pushed by the memory servers at the STW window, waited by RDMA_WAIT_MEM_SERVER.
+// Keep the same values with the Memory server JVM.
+#define MEM_SERVER_NOTIFY_COMPACT_START     1
+#define MEM_SERVER_NOTIFY_WAIT_ON_EXCHANGE  2
+#define MEM_SERVER_NOTIFY_COMPACT_DONE      3
+
+// -XX:+SemeruTimeline, the phase events of a STW window. Keep the same values with the Memory server JVM.
+// Recorded by the CPU server.
+#define SEMERU_TL_PAUSE_START       1
+#define SEMERU_TL_FLAGS_SENT        2   // the STW window is open
+#define SEMERU_TL_CSET_SENT         3   // arg, the memory server
+#define SEMERU_TL_WAIT_START        4   // arg, memory server << 8 | state
+#define SEMERU_TL_WAIT_END          5   // arg, memory server << 8 | state
+#define SEMERU_TL_WINDOW_CLOSED     6
+#define SEMERU_TL_PAUSE_END         7
+// Recorded by the memory servers.
+#define SEMERU_TL_DOORBELL_SEEN     16  // arg, the doorbell seqno, at its arrival
+#define SEMERU_TL_WINDOW_SEEN       17
+#define SEMERU_TL_COMMIT_START      18  // the images of the concurrent compaction copied back
+#define SEMERU_TL_COMMIT_END        19
+#define SEMERU_TL_STATE_PUSHED      20  // arg, the state
+// Events of a memory server in a STW window, in its flags_of_mem_server_state.
+#define SEMERU_TIMELINE_MS_EVENTS   32
+
+// Regions granted to the memory servers for the concurrent compaction at a time,
+// bounded by the fence table of the kernel, FS_FENCE_MAX_RANGES.
+#define SEMERU_MAX_GRANTED_REGIONS          64
+
+// Pages written back into the committed grants by the CPU server, reconciled by the memory servers, all the grants.
+#define SEMERU_MAX_RECONCILED_PAGES         256
+
+// Pages of a compacted Region checksummed by its memory server, -XX:SemeruChecksumSamplePercent.
+#define SEMERU_MAX_CHECKSUM_SAMPLES         64
+
+// Page ranges of a compacted Region its memory server rewrote, -XX:+SemeruSelectiveInvalidation.
+// Closer runs are merged beyond it.
+#define SEMERU_MAX_REWRITTEN_RANGES         32
+
+// Chains of cleared References reported by a memory server and not yet taken by the CPU server,
+// -XX:+SemeruRemoteRefProcessing. 16 bytes each, in the 4KB flags_of_mem_server_state.
+#define SEMERU_MAX_PENDING_REF_CHAINS       128
+
+#define SEMERU_RDMA_IOV_MAX 1024   // entries per RDMA_WRITEV/RDMA_READV, the same as the kernel.
+
+// One entry of the vectored control path write.
+// Keep the same layout with the kernel, extra_syscall/semeru_syscall.h
+struct semeru_rdma_iovec {
+  int           mem_server_id;
+  int           write_type;   // 0 for data, 1 for signal
+  char*         start_addr;
+  unsigned long size;
+};
+
+// Ops of RDMA_ATOMIC, the same as the kernel.
+#define SEMERU_RDMA_ATOMIC_CAS        0
+#define SEMERU_RDMA_ATOMIC_FETCH_ADD  1
+
+// One remote atomic, the kernel writes the old value of the word back to result.
+// Keep the same layout with the kernel, extra_syscall/semeru_syscall.h
+struct semeru_rdma_atomic {
+  int       op;           // SEMERU_RDMA_ATOMIC_xx
+  int       pad;
+  char*     addr;         // 8 bytes aligned, within the meta space
+  uint64_t  compare_add;  // the expected value of CAS, or the addend of fetch-and-add
+  uint64_t  swap;         // the new value of CAS
+  uint64_t  result;
+};
+
+// Pages written back into a granted Region the kernel records, beyond them the grant is revoked.
+#define SEMERU_FENCE_MAX_PAGES        32
+
+// The pages written back into a Region closed by SEMERU_FENCE_CLOSE 2, page indexes within the Region.
+// Keep the same layout with the kernel, struct fs_fence_written of semeru/frontswap_path.h
+struct semeru_fence_written {
+  uint64_t  start;        // the bottom of the Region, filled by the caller
+  uint32_t  nr_pages;
+  uint32_t  pages[SEMERU_FENCE_MAX_PAGES];
+};
+
+// Bytes read by one RDMA_PEEK at most.
+#define SEMERU_RDMA_PEEK_MAX_SIZE     256
+
+// One peek, the bytes of [addr, addr + size) are copied into buf without swapping the page in.
+// Keep the same layout with the kernel, extra_syscall/semeru_syscall.h
+struct semeru_rdma_peek {
+  char*     addr;         // within one page of the data space
+  char*     buf;
+  size_t    size;         // at most SEMERU_RDMA_PEEK_MAX_SIZE
+};
+
+// One sampled swap-in, the user registers of the faulting thread.
+// Keep the same layout with the kernel, include/linux/swap_global_struct_mem_layer.h
+struct semeru_fault_sample {
+  uint64_t  ip;           // the faulting instruction, or after the syscall touching the page
+  uint64_t  sp;
+  uint64_t  vaddr;        // the faulting address, or the page if the kernel doesn't know it
+  uint32_t  latency_ns;
+  uint32_t  type;         // how it was served, SEMERU_FAULT_*
+  int32_t   tid;
+  uint32_t  pad;
+};
+
+// The kernel writes the samples after the header and moves head, the JVM reads them and moves tail.
+struct semeru_fault_sample_ring {
+  volatile uint64_t head;
+  volatile uint64_t tail;
+  volatile uint64_t dropped;    // the ring was full
+  uint32_t          nr_entries;
+  uint32_t          period;
+  uint64_t          reserved[4];
+
+  semeru_fault_sample* samples() { return (semeru_fault_sample*)(this + 1); }
+};
+
+// The types of the samples, the same as enum fs_trace_type of the kernel module.
+#define SEMERU_FAULT_READ         0   // read from a memory server
+#define SEMERU_FAULT_PREFETCHED   1   // the page was prefetched
+#define SEMERU_FAULT_LOCAL        2   // served locally, the compressed copy, the zero page or the local tier
+#define SEMERU_FAULT_TYPES        3
 
 #define SYS_SWAP_STAT_RESET			335
 #define SYS_NUM_SWAP_OUT_PAGES	336
+#define SYS_NUM_ON_DEMAND_SWAPIN	337
 
 
 #define MAX_CSERVER_CSET_LENGTH 14
@@ -215,8 +389,15 @@
 #define REGION_SIZE_GB 4UL // RDMA manage granularity, not the Heap Region.
 #define RDMA_META_REGION_NUM 1UL
 #define RDMA_DATA_REGION_NUM 8UL  // default 32GB
-#define SEMERU_START_ADDR 0x400000000000UL
-#define NUM_OF_MEMORY_SERVER 1  // default 2 memory servers
+#define SEMERU_BASE_START_ADDR 0x400000000000UL
+// The address windows of the Semeru JVMs sharing a CPU server, -XX:SemeruAddressWindow, the same with the address_window of the Semeru kernel module.
+// Window w holds its meta and data space at SEMERU_BASE_START_ADDR + w * SEMERU_ADDRESS_WINDOW_SIZE.
+#define SEMERU_ADDRESS_WINDOW_SIZE 0x10000000000UL  // 1TB
+#define SEMERU_MAX_ADDRESS_WINDOWS 16
+extern size_t semeru_start_addr;  // of this JVM's window, set by Arguments::apply_ergo()
+#define SEMERU_START_ADDR semeru_start_addr
+#define NUM_OF_MEMORY_SERVER 1  // default number of memory servers, overridden by SemeruMemServerNum.
+#define MAX_NUM_OF_MEMORY_SERVER 8  // upper bound of the runtime memory server topology.
 
 
 // ###
@@ -230,8 +411,22 @@
 //
 // Data space
 #define RDMA_DATA_SPACE_START_ADDR (RDMA_META_SPACE_START_ADDR + RDMA_STRUCTURE_SPACE_SIZE)
+// Heap based compressed oops of the Semeru heap, the same on CPU and memory servers.
+// The last page of the meta space is the protected no-access prefix, so NULL is never a heap address.
+#define SEMERU_NARROW_OOP_BASE (RDMA_DATA_SPACE_START_ADDR - PAGE_SIZE)
 #define DATA_REGION_PER_MEM_SERVER (RDMA_DATA_REGION_NUM / NUM_OF_MEMORY_SERVER)
 
+// Runtime topology, N memory servers with RDMA_DATA_REGION_NUM % N == 0 :
+// memory server i owns the data Regions [i * RDMA_DATA_REGION_NUM/N, (i+1) * RDMA_DATA_REGION_NUM/N).
+// The N is SemeruMemServerNum, the same with the num_mem_servers of the kernel module.
+// The macros below only describe the default, NUM_OF_MEMORY_SERVER, topology.
+//
+// Placement policy of the data Regions, SemeruPlacementPolicy, the same with the placement_policy of the kernel module.
+// Each memory server still backs RDMA_DATA_REGION_NUM/N data Regions, only the order changes.
+#define SEMERU_PLACEMENT_RANGE 0      // the contiguous split above.
+#define SEMERU_PLACEMENT_INTERLEAVE 1 // round-robin, data Region i is on memory server i % N.
+#define SEMERU_PLACEMENT_LOAD 2       // the least loaded memory server is picked at the first access of a data Region.
+
 // Memory server #1, Data Region[1] to Region[5]
 // Only being used for correctness checks,
 // Plase calculated this derived information.
@@ -263,6 +458,10 @@
 
 //#define SEMERU_COMPACT
 
+// User space control path, runtime/rdma_cp_comm.hpp.
+// Needs the JVM linked with -libverbs -lrdmacm. The kernel syscall is used if disabled.
+//#define SEMERU_USER_CP
+
 
 //
 //################################## Address information ##################################
@@ -313,6 +512,13 @@
 // 2. Small meta data 
 //
 
+// The per-Region zones are sized for the smallest Semeru Region, so a Region size between
+// SEMERU_MIN_REGION_SIZE and the RDMA data Region works without another layout.
+// The Region size itself is decided at runtime, HeapRegion::GrainBytes, and checked by SemeruMetaLayout.
+#define SEMERU_MIN_REGION_SIZE               (size_t)(4*ONE_MB)
+#define SEMERU_MAX_REGIONS                   (size_t)(RDMA_DATA_REGION_NUM * REGION_SIZE_GB * ONE_GB / SEMERU_MIN_REGION_SIZE)  // 8192
+#define SEMERU_PER_REGION_ZONE_SIZE          (size_t)((SEMERU_MAX_REGIONS + 1) * PAGE_SIZE)  // a page per Region, the allocator keeps the last one free. 32MB
+
 // 2.1 Meta of HeapRegion.
 // These information need to be synchronized between CPU server and memory server.
 // Reserve 4K per region is enough.
@@ -321,30 +527,30 @@
 //     The structure of SemeruHeapRegion. 4K for each Region is enough.
 //     [x] precommit all the space.
 #define HEAP_REGION_MANAGER_OFFSET           (size_t)(ALIVE_BITMAP_OFFSET + ALIVE_BITMAP_SIZE)  // +768MB,  0x400,030,000,000
-#define HEAP_REGION_MANAGER_SIZE_LIMIT       (size_t)(4*ONE_MB) // each SemeruHeapRegion should less than 4K, this is enough for 1024 HeapRegion.
+#define HEAP_REGION_MANAGER_SIZE_LIMIT       SEMERU_PER_REGION_ZONE_SIZE // each SemeruHeapRegion should less than 4K.
 
 
 // 2.1.1 CPU Server To Memory server, Initialization
 // [x] precommit
 #define CPU_TO_MEMORY_INIT_OFFSET     (size_t)(HEAP_REGION_MANAGER_OFFSET + HEAP_REGION_MANAGER_SIZE_LIMIT) // +4KB, 0x400,008,004,000
-#define CPU_TO_MEMORY_INIT_SIZE_LIMIT (size_t) 4*ONE_MB    //
+#define CPU_TO_MEMORY_INIT_SIZE_LIMIT SEMERU_PER_REGION_ZONE_SIZE    //
 
 // 2.1.2 CPU Server To Memory server, GC
 // [x] precommit
 #define CPU_TO_MEMORY_GC_OFFSET       (size_t)(CPU_TO_MEMORY_INIT_OFFSET + CPU_TO_MEMORY_INIT_SIZE_LIMIT) // +16MB, 0x400,009,004,000
-#define CPU_TO_MEMORY_GC_SIZE_LIMIT   (size_t) 4*ONE_MB    //
+#define CPU_TO_MEMORY_GC_SIZE_LIMIT   SEMERU_PER_REGION_ZONE_SIZE    //
 
 
 // 2.1.3 Memory server To CPU server 
 // [x] precommit. Can't be evicted to this range via data path.
 #define MEMORY_TO_CPU_GC_OFFSET       (size_t)(CPU_TO_MEMORY_GC_OFFSET + CPU_TO_MEMORY_GC_SIZE_LIMIT) // +16MB, 0x400,00A,004,000
-#define MEMORY_TO_CPU_GC_SIZE_LIMIT   (size_t) 4*ONE_MB    //
+#define MEMORY_TO_CPU_GC_SIZE_LIMIT   SEMERU_PER_REGION_ZONE_SIZE    //
 
 
 // 2.1.4 Synchonize between CPU server and memory server
 // [x] precommit
 #define SYNC_MEMORY_AND_CPU_OFFSET       (size_t)(MEMORY_TO_CPU_GC_OFFSET + MEMORY_TO_CPU_GC_SIZE_LIMIT) // +16MB, 0x400,00B,004,000
-#define SYNC_MEMORY_AND_CPU_SIZE_LIMIT   (size_t) 4*ONE_MB    //
+#define SYNC_MEMORY_AND_CPU_SIZE_LIMIT   SEMERU_PER_REGION_ZONE_SIZE    //
 
 
 
@@ -354,7 +560,12 @@
 // 3.1 Memory server CSet
 // [x] precommit
 #define MEMORY_SERVER_CSET_OFFSET     (size_t)(SYNC_MEMORY_AND_CPU_OFFSET + SYNC_MEMORY_AND_CPU_SIZE_LIMIT)    // +1GB +4K, 0x400,050,000,000
-#define MEMORY_SERVER_CSET_SIZE       (size_t)PAGE_SIZE   // 4KB 
+// A header page of the CSet sizes, sequences and the first Regions, then the overflow pages of each memory server.
+// The overflow pages of a memory server hold all the Regions, see SemeruMetaLayout.
+#define MEMORY_SERVER_CSET_HEADER_SIZE      (size_t)PAGE_SIZE   // 4KB
+#define MEMORY_SERVER_CSET_SLOT_SIZE        (size_t)(MEMORY_SERVER_CSET_HEADER_SIZE / MAX_NUM_OF_MEMORY_SERVER)  // 512 bytes
+#define MEMORY_SERVER_CSET_OVERFLOW_PAGES   (size_t)(SEMERU_MAX_REGIONS * sizeof(uint) / PAGE_SIZE)  // per memory server, 8 pages
+#define MEMORY_SERVER_CSET_SIZE       (size_t)(MEMORY_SERVER_CSET_HEADER_SIZE + MAX_NUM_OF_MEMORY_SERVER * MEMORY_SERVER_CSET_OVERFLOW_PAGES * PAGE_SIZE)   // 260KB
 
 // 3.2 cpu server state, STW or Mutator 
 // Used as CPU <--> Memory server state exchange
@@ -370,11 +581,110 @@
 
 // 3.4 one-sided RDMA write check flags
 // 4 bytes per HeapRegion |-- 16 bits for dirty --|-- 16 bits for version --|
-// Assume the number of Region is 1024, 
-// Reserve 4KB for the write check flags.
+// Reserve for SEMERU_MAX_REGIONS.
 // [x] precommit
 #define FLAGS_OF_CPU_WRITE_CHECK_OFFSET       (size_t)(FLAGS_OF_MEM_SERVER_STATE_OFFSET + FLAGS_OF_MEM_SERVER_STATE_SIZE)  // +4KB, 0x400,008,003,000
-#define FLAGS_OF_CPU_WRITE_CHECK_SIZE_LIMIT   (size_t)PAGE_SIZE     // 4KB 
+#define FLAGS_OF_CPU_WRITE_CHECK_SIZE_LIMIT   (size_t)(SEMERU_MAX_REGIONS * sizeof(uint32_t))  // 32KB
+
+// 3.5 liveness epochs
+// 4 bytes per HeapRegion, bumped by the memory server each time it updates the Region's MemoryToCPUAtGC.
+// The CPU server reads this page first and only reads the MemoryToCPUAtGC of the changed Regions.
+// [x] precommit
+#define LIVENESS_EPOCH_OFFSET                 (size_t)(FLAGS_OF_CPU_WRITE_CHECK_OFFSET + FLAGS_OF_CPU_WRITE_CHECK_SIZE_LIMIT)  // +4KB, 0x400,008,004,000
+#define LIVENESS_EPOCH_SIZE_LIMIT             (size_t)(SEMERU_MAX_REGIONS * sizeof(uint32_t))  // 32KB
+
+// 3.6 class loader liveness
+// SEMERU_CLD_BITMAP_WORDS words per HeapRegion, the ClassLoaderData of the objects the memory server marked in it,
+// hashed into a bitmap. Read by the CPU server at the initial mark, -XX:+SemeruRemoteClassUnloading.
+// [x] precommit
+#define CLD_LIVENESS_OFFSET                   (size_t)(LIVENESS_EPOCH_OFFSET + LIVENESS_EPOCH_SIZE_LIMIT)  // +4KB, 0x400,008,005,000
+#define SEMERU_CLD_BITMAP_WORDS               8                       // 512 bits per Region
+#define CLD_LIVENESS_SIZE_LIMIT               (size_t)(SEMERU_MAX_REGIONS * SEMERU_CLD_BITMAP_WORDS * sizeof(uint64_t))  // 512KB
+
+// 3.7 compacted Region ring
+// The indexes of the Regions compacted by the memory server, pushed by its compaction workers.
+// The CPU server reads only the published [tail, head) and writes back its tail, see compacted_region_ring.
+// [x] precommit
+#define COMPACTED_REGION_RING_OFFSET          (size_t)(CLD_LIVENESS_OFFSET + CLD_LIVENESS_SIZE_LIMIT)  // +64KB, 0x400,008,015,000
+#define SEMERU_MAX_COMPACTED_REGION_SLOTS     SEMERU_MAX_REGIONS      // a power of 2
+#define COMPACTED_REGION_RING_SIZE_LIMIT      (size_t)(PAGE_SIZE + SEMERU_MAX_COMPACTED_REGION_SLOTS * sizeof(uint32_t))  // the 3 index lines in the first page, 36KB
+
+// 3.8 Region state words
+// 8 bytes per HeapRegion, |-- 16 bits owner --|-- 48 bits sequence --|, see region_state_words.
+// Only changed by the RDMA atomics of the CPU server, a Region is claimed and released without a handshake.
+// [x] precommit
+#define REGION_STATE_OFFSET                   (size_t)(COMPACTED_REGION_RING_OFFSET + COMPACTED_REGION_RING_SIZE_LIMIT)  // 8 bytes aligned
+#define REGION_STATE_SIZE_LIMIT               (size_t)(SEMERU_MAX_REGIONS * sizeof(uint64_t))  // 64KB
+
+// 3.9 heap histogram
+// The instances of each klass in the fully evicted Regions, counted by their memory server for the
+// CPU server's class histogram, -XX:+SemeruRemoteHeapHistogram. See remote_heap_histogram.
+// The used words of each requested Region, the request and reply lines, then the entries.
+// [x] precommit
+#define HEAP_HISTOGRAM_OFFSET                 (size_t)(REGION_STATE_OFFSET + REGION_STATE_SIZE_LIMIT)
+#define SEMERU_MAX_HISTOGRAM_KLASSES          8192                    // a power of 2
+#define HEAP_HISTOGRAM_SIZE_LIMIT             (size_t)(PAGE_SIZE + SEMERU_MAX_REGIONS * sizeof(uint32_t) + SEMERU_MAX_HISTOGRAM_KLASSES * 3 * sizeof(size_t))  // 228KB
+
+// 3.10 liveness vector
+// 32 bytes per HeapRegion, a versioned copy of the liveness in its MemoryToCPUAtGC, see region_liveness_vector.
+// Read by the CPU server in one RDMA read per memory server, -XX:+SemeruLivenessVector.
+// [x] precommit
+#define LIVENESS_VECTOR_OFFSET                (size_t)(HEAP_HISTOGRAM_OFFSET + HEAP_HISTOGRAM_SIZE_LIMIT)
+#define LIVENESS_VECTOR_SIZE_LIMIT            (size_t)(SEMERU_MAX_REGIONS * 4 * sizeof(uint64_t))  // 256KB
+
+// 3.11 remote card scan
+// The remembered set cards of the fully evicted old Regions, scanned by their memory server for a CPU server
+// pause, -XX:+SemeruRemoteCardScan. See remote_card_scan.
+// The CSet Regions and the cards of the request, the request and reply lines, then the slots found.
+// [x] precommit
+#define REMOTE_CARD_SCAN_OFFSET               (size_t)(LIVENESS_VECTOR_OFFSET + LIVENESS_VECTOR_SIZE_LIMIT)
+#define SEMERU_MAX_REMOTE_CARDS               8192
+#define SEMERU_MAX_REMOTE_SLOTS               16384
+#define REMOTE_CARD_SCAN_SIZE_LIMIT           (size_t)(2 * PAGE_SIZE + SEMERU_MAX_REGIONS + SEMERU_MAX_REMOTE_CARDS * 3 * sizeof(size_t) + SEMERU_MAX_REMOTE_SLOTS * 2 * sizeof(size_t))  // 464KB
+
+// 3.12 remote refinement
+// A second remote_card_scan, the dirty cards of the fully evicted old Regions refined by their memory server
+// for the concurrent refinement of the CPU server, -XX:+SemeruRemoteRefinement.
+// [x] precommit
+#define REMOTE_REFINE_OFFSET                  (size_t)(REMOTE_CARD_SCAN_OFFSET + REMOTE_CARD_SCAN_SIZE_LIMIT)
+#define REMOTE_REFINE_SIZE_LIMIT              REMOTE_CARD_SCAN_SIZE_LIMIT
+
+// 3.13 remembered set stash
+// A page per HeapRegion, the remembered set cards of a Region handed to the memory server CSet, by card index.
+// Written by the CPU server at the dispatch and read back in one vectored read when the Region is evacuated
+// by the CPU server, -XX:+SemeruRemoteRemSets. See remote_rem_set_stash.
+// Only the pages of the stashed Regions are touched.
+// [x] precommit
+#define REMSET_STASH_OFFSET                   (size_t)(REMOTE_REFINE_OFFSET + REMOTE_REFINE_SIZE_LIMIT)
+#define SEMERU_REMSET_STASH_CARDS             (size_t)(PAGE_SIZE / sizeof(uint32_t))  // 1024
+#define REMSET_STASH_SIZE_LIMIT               (size_t)(SEMERU_MAX_REGIONS * PAGE_SIZE)  // 32MB
+
+// 3.14 mark messages
+// The outbox of a memory server, the targets its concurrent marking found outside of the Region it traced.
+// Appended by the memory server, drained by the CPU server before the next CSet dispatch and handed to the
+// owning memory servers as marked-from-root targets, -XX:+SemeruMarkMessages. See mark_message_ring.
+// [x] precommit
+#define MARK_MESSAGE_OFFSET                   (size_t)(REMSET_STASH_OFFSET + REMSET_STASH_SIZE_LIMIT)
+#define SEMERU_MARK_MESSAGES                  (size_t)(128*1024)  // targets
+#define MARK_MESSAGE_SIZE_LIMIT               (size_t)(PAGE_SIZE + SEMERU_MARK_MESSAGES * sizeof(size_t))  // 1MB + 4KB
+
+// 3.15 page affinity
+// 4 bytes per page of the data space, the distance in pages to the next page of its group, 0 for none.
+// The pages the memory server tracing reached from the same root are linked into a ring per group.
+// Read by the CPU server for the changed Regions and shared with its kernel prefetcher,
+// -XX:+SemeruPageAffinity. See page_affinity_table.
+// [x] precommit
+#define PAGE_AFFINITY_OFFSET                  (size_t)(MARK_MESSAGE_OFFSET + MARK_MESSAGE_SIZE_LIMIT)
+#define SEMERU_AFFINITY_GROUP_MAX             32                      // pages per group, FS_PREFETCH_WINDOW_MAX of the kernel
+#define PAGE_AFFINITY_SIZE_LIMIT              (size_t)(RDMA_DATA_REGION_NUM * REGION_SIZE_GB * ONE_GB / PAGE_SIZE * sizeof(int32_t))  // 32MB
+
+// 3.16 remote array operation
+// A copy or fill of a large primitive array range whose pages are all swapped out to one memory server,
+// done by that memory server instead of swapping the pages in, -XX:+SemeruRemoteArrayOps. See remote_array_op.
+// The request and reply lines of one operation.
+// [x] precommit
+#define REMOTE_ARRAY_OP_OFFSET                (size_t)(PAGE_AFFINITY_OFFSET + PAGE_AFFINITY_SIZE_LIMIT)
+#define REMOTE_ARRAY_OP_SIZE_LIMIT            (size_t)PAGE_SIZE      // 4KB
 
 
 
@@ -386,7 +696,7 @@
 // ## Swap-Part ##
 //
 
-#define RDMA_META_REGION_SWAP_PART_OSSFET   (size_t)(FLAGS_OF_CPU_WRITE_CHECK_OFFSET + FLAGS_OF_CPU_WRITE_CHECK_SIZE_LIMIT)
+#define RDMA_META_REGION_SWAP_PART_OSSFET   (size_t)(REMOTE_ARRAY_OP_OFFSET + REMOTE_ARRAY_OP_SIZE_LIMIT)
 
 
 //  Klass instance space.
@@ -409,10 +719,10 @@
 
 // 4.2 The G1SemeruBlockOffsetTable->_offset_array
 //     Every SemeruHeapRegion will use a part of the _offset_array.
-//     1 u_char for a Card,512 bytes.  1 : 512,  128MB bot can cover 64GB heap.
+//     1 u_char for a Card,512 bytes.
+//     The size depends on the Semeru heap, SemeruMetaLayout::block_offset_table_size().
 //     [x]precommit by us for debug, no need to pad.
 #define BLOCK_OFFSET_TABLE_OFFSET             (size_t)(BOT_GLOBAL_STRUCT_OFFSET + BOT_GLOBAL_STRUCT_SIZE_LIMIT)    // +3GB,  0x400,0C0,000,000
-#define BLOCK_OFFSET_TABLE_OFFSET_SIZE_LIMIT  (size_t)128*ONE_MB    // 1 : 512,
 
 
 
@@ -424,34 +734,35 @@
 
 // 6. Cross-Region reference update queue
 // Record the <old_addr, new_addr > for the target object queue.
-// [?] Not sure how much space is needed for the cross-region-reference queue, give all the rest space to it. Need to shrink it latter.
-#define CROSS_REGION_REF_TARGET_Q_OFFSET        (size_t)(BLOCK_OFFSET_TABLE_OFFSET + BLOCK_OFFSET_TABLE_OFFSET_SIZE_LIMIT)
-#define CROSS_REGION_REF_TARGET_Q_LEN           (size_t)(512*ONE_MB/8/64)  // Region size/ bits per HeapWord / bits per size_t. 
-#define CROSS_REGION_REF_TARGET_Q_SIZE_LIMIT    (size_t)(512 * ONE_MB + 1 * ONE_MB)  // 32GB heap + reserved instance size, 4KB per instance/region. 
+// Placed right after the Block Offset Table. One BitQueue per Region, 1 bit per HeapWord.
+// Offset, length and size are computed at startup, gc/shared/rdmaMetaLayout.hpp :
+//   SemeruMetaLayout::cross_region_ref_target_q_offset()
+//   SemeruMetaLayout::cross_region_ref_target_q_len()
+//   SemeruMetaLayout::cross_region_ref_target_q_size()
 
 
-struct AddrPair{
-  char* st;
-  char* ed;
-};
+// 7. Wire buffers
+// The compressed control path writes of a CSet, one buffer per memory server, after the target queues.
+// Offset computed at startup, SemeruMetaLayout::wire_buffer_offset(), gc/shared/rdmaWireCodec.hpp.
+#define SEMERU_WIRE_BUFFER_SIZE               (size_t)(8*ONE_MB)   // per memory server
 
 
-// x Padding the rest space of the RDMA Region.
-//     Make it easier to register RDMA buffer.
-//     Commit a contiguous space for RDMA Meta Space.
-//     Points to the last item.
-// Warning : do NOT commit this space in CPU server.
-//           It's a waste of CPU server local cache.
-#define RDMA_PADDING_OFFSET       (size_t)(CROSS_REGION_REF_TARGET_Q_OFFSET + CROSS_REGION_REF_TARGET_Q_SIZE_LIMIT) 
-#define RDMA_PADDING_SIZE_LIMIT   (size_t)(RDMA_STRUCTURE_SPACE_SIZE - RDMA_PADDING_OFFSET > 0 ? RDMA_STRUCTURE_SPACE_SIZE - RDMA_PADDING_OFFSET : 0 )
+// 8. Task queue chunks
+// The chunked task queues of each memory server draw their chunks from its zone, after the wire buffers.
+// Offset computed at startup, SemeruMetaLayout::task_queue_chunk_offset(), gc/shared/rdmaStructure.hpp.
+#define SEMERU_TASK_QUEUE_CHUNK_ZONE_SIZE     (size_t)(32*ONE_MB)  // per memory server, the chunk directory and the chunks
+#define SEMERU_TASK_QUEUE_CHUNK_SIZE          (size_t)(4*1024)     // bytes of elements in a chunk
 
 
+struct AddrPair{
+  char* st;
+  char* ed;
+};
 
 
-//
 // x. End of RDMA structure commit size
-//
-#define END_OF_RDMA_COMMIT_ADDR   (size_t)(SEMERU_START_ADDR + RDMA_PADDING_OFFSET + RDMA_PADDING_SIZE_LIMIT)
+//    [SEMERU_START_ADDR, SEMERU_START_ADDR + SemeruMetaLayout::used_size()) is committed and registered as RDMA buffer.
+//    The rest of RDMA_STRUCTURE_SPACE_SIZE is only reserved, no padding any more.
 
 
 // properties for the whole Semeru heap.
@@ -0,0 +1,15 @@
+/*
+ * Semeru - the main class of a memory server LJVM in the disaggregation sweep, run_semeru_sweep.sh.
+ *
+ * The memory server's tracing and compaction run in the GC threads of the LJVM,
+ * the Java side only keeps the JVM alive until the sweep kills it.
+ */
+
+public class SemeruMemServerMain {
+  public static void main(String[] args) throws InterruptedException {
+    System.out.println("Semeru memory server up");
+    while (true) {
+      Thread.sleep(60_000);
+    }
+  }
+}
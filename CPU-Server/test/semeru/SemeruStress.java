@@ -0,0 +1,188 @@
+/*
+ * Semeru - GC stress workloads of the disaggregation sweep, run_semeru_sweep.sh.
+ *
+ * java SemeruStress <churn|graph|lru> <seconds> <live MB> <threads> [seed]
+ *
+ *  churn : short lived objects of mixed sizes, a small ring of survivors is promoted now and then.
+ *  graph : a large object graph spread over the old Regions, random subgraphs are replaced and traversed.
+ *  lru   : an access ordered cache, zipfian keys over twice its capacity, a miss allocates and evicts.
+ *
+ * Each thread owns live MB / threads of the live set. The first 10% of the time is the warmup.
+ * The last line is the result, parsed by the sweep :
+ *  RESULT workload=<name> seconds=<s> threads=<n> live_mb=<mb> ops=<n> ops_per_s=<n>
+ */
+
+import java.util.LinkedHashMap;
+import java.util.Map;
+import java.util.SplittableRandom;
+import java.util.concurrent.atomic.AtomicLong;
+
+public class SemeruStress {
+
+  interface Workload {
+    // One operation, the unit of the throughput.
+    void op();
+  }
+
+  static final class Churn implements Workload {
+    final SplittableRandom rnd;
+    final Object[] survivors;
+    int next;
+
+    Churn(long liveBytes, SplittableRandom rnd) {
+      this.rnd = rnd;
+      this.survivors = new Object[(int) Math.max(1, liveBytes / 10 / 2048)];
+    }
+
+    public void op() {
+      Object last = null;
+      for (int i = 0; i < 64; i++) {
+        last = new byte[16 + rnd.nextInt(4096)];
+      }
+      // One in 64 survives a while, until its ring slot is reused.
+      survivors[next] = last;
+      next = (next + 1) % survivors.length;
+    }
+  }
+
+  static final class Node {
+    Node[] edges;
+    long payload;
+
+    Node(int degree, long payload) {
+      this.edges = new Node[degree];
+      this.payload = payload;
+    }
+  }
+
+  static final class Graph implements Workload {
+    static final int DEGREE = 4;
+    static final int NODE_BYTES = 16 + 8 + 16 + DEGREE * 8; // header, payload, edges array
+
+    final SplittableRandom rnd;
+    final Node[] nodes;
+
+    Graph(long liveBytes, SplittableRandom rnd) {
+      this.rnd = rnd;
+      this.nodes = new Node[(int) Math.max(DEGREE, liveBytes / NODE_BYTES)];
+      for (int i = 0; i < nodes.length; i++) {
+        nodes[i] = new Node(DEGREE, i);
+      }
+      for (Node n : nodes) {
+        link(n);
+      }
+    }
+
+    void link(Node n) {
+      for (int e = 0; e < DEGREE; e++) {
+        n.edges[e] = nodes[rnd.nextInt(nodes.length)];
+      }
+    }
+
+    public void op() {
+      // Replace a node, the old one stays reachable from its in-edges until they are rewritten.
+      int victim = rnd.nextInt(nodes.length);
+      Node fresh = new Node(DEGREE, rnd.nextLong());
+      nodes[victim] = fresh;
+      link(fresh);
+
+      // Walk a random path, the pointer chasing touches cold Regions.
+      Node cur = nodes[rnd.nextInt(nodes.length)];
+      long sum = 0;
+      for (int step = 0; step < 32 && cur != null; step++) {
+        sum += cur.payload;
+        cur = cur.edges[rnd.nextInt(DEGREE)];
+      }
+      if (sum == 42) {
+        System.out.print("");
+      }
+    }
+  }
+
+  static final class Lru implements Workload {
+    static final int VALUE_BYTES = 1024;
+
+    final SplittableRandom rnd;
+    final LinkedHashMap<Long, byte[]> cache;
+    final int capacity;
+
+    Lru(long liveBytes, SplittableRandom rnd) {
+      this.rnd = rnd;
+      this.capacity = (int) Math.max(1, liveBytes / (VALUE_BYTES + 64));
+      this.cache = new LinkedHashMap<Long, byte[]>(capacity * 4 / 3 + 1, 0.75f, true) {
+        protected boolean removeEldestEntry(Map.Entry<Long, byte[]> eldest) {
+          return size() > capacity;
+        }
+      };
+    }
+
+    // Zipfian rank with s = 1 over [0, n), the inverse CDF n^u.
+    long zipf(long n) {
+      return Math.min(n - 1, (long) Math.pow(n, rnd.nextDouble()) - 1);
+    }
+
+    public void op() {
+      Long key = zipf(2L * capacity) * 2654435761L % (2L * capacity);
+      byte[] value = cache.get(key);
+      if (value == null) {
+        value = new byte[VALUE_BYTES];
+        value[0] = (byte) key.longValue();
+        cache.put(key, value);
+      }
+    }
+  }
+
+  static Workload create(String name, long liveBytes, SplittableRandom rnd) {
+    switch (name) {
+      case "churn": return new Churn(liveBytes, rnd);
+      case "graph": return new Graph(liveBytes, rnd);
+      case "lru":   return new Lru(liveBytes, rnd);
+      default: throw new IllegalArgumentException("unknown workload " + name);
+    }
+  }
+
+  public static void main(String[] args) throws Exception {
+    if (args.length < 4) {
+      System.err.println("usage : SemeruStress <churn|graph|lru> <seconds> <live MB> <threads> [seed]");
+      System.exit(1);
+    }
+
+    final String name = args[0];
+    final long seconds = Long.parseLong(args[1]);
+    final long liveMB = Long.parseLong(args[2]);
+    final int threads = Integer.parseInt(args[3]);
+    final long seed = args.length > 4 ? Long.parseLong(args[4]) : 1;
+
+    final long warmupEnd = System.nanoTime() + seconds * 100_000_000L; // 10%
+    final long end = System.nanoTime() + seconds * 1_000_000_000L;
+    final AtomicLong ops = new AtomicLong();
+
+    Thread[] workers = new Thread[threads];
+    for (int t = 0; t < threads; t++) {
+      final SplittableRandom rnd = new SplittableRandom(seed * 7919 + t);
+      workers[t] = new Thread(() -> {
+        Workload w = create(name, (liveMB << 20) / threads, rnd);
+        long done = 0;
+        long now;
+        while ((now = System.nanoTime()) < end) {
+          for (int i = 0; i < 256; i++) {
+            w.op();
+          }
+          if (now >= warmupEnd) {
+            done += 256;
+          }
+        }
+        ops.addAndGet(done);
+      }, "stress-" + t);
+      workers[t].start();
+    }
+    for (Thread w : workers) {
+      w.join();
+    }
+
+    long measured = seconds - seconds / 10;
+    System.out.println("RESULT workload=" + name + " seconds=" + seconds + " threads=" + threads +
+                       " live_mb=" + liveMB + " ops=" + ops.get() +
+                       " ops_per_s=" + ops.get() / Math.max(1, measured));
+  }
+}
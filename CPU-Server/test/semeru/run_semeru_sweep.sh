@@ -0,0 +1,250 @@
+#! /bin/bash
+
+###
+# Semeru end-to-end disaggregation sweep.
+#
+# For each memory server count, heap size, local cache percent and workload :
+#   1) launch the memory server LJVMs over ssh, SemeruMemServerMain
+#   2) load the Semeru kernel module for that many memory servers and mount the swap file
+#   3) run SemeruStress on the CPU server JVM, in a memory cgroup of the local cache size
+#   4) collect the GC pauses, the throughput, the swap ins/outs, the RDMA traffic
+#      and the sun.gc.semeru.* counters of the memory servers, then tear everything down
+#
+# One row per run is appended to ${OUT_DIR}/results.csv, the raw logs are kept in ${OUT_DIR}/<run>/.
+# Compare two results.csv to catch a regression of the offloading before deploying.
+#
+# Run it on the CPU server, with sudo rights and password-less ssh to the memory servers.
+# Every knob below can be overridden by the environment, e.g.
+#   CACHE_PERCENTS="25 50" SERVER_COUNTS="2" WORKLOADS="lru" ./run_semeru_sweep.sh
+#
+# Warning : the module is reloaded for every run, don't run it on a CPU server with another Semeru application.
+
+
+###
+# Configurations
+
+# The sweep
+CACHE_PERCENTS=${CACHE_PERCENTS:-"25 50 100"}    # -XX:SemeruLocalCachePercent
+HEAP_SIZES=${HEAP_SIZES:-"16 32"}                # Java heap in GB, has to fit the data Regions, 32GB by default
+SERVER_COUNTS=${SERVER_COUNTS:-"1 2"}            # has to divide RDMA_DATA_REGION_NUM
+WORKLOADS=${WORKLOADS:-"churn graph lru"}
+
+# The workload, see SemeruStress.java
+DURATION=${DURATION:-120}                        # seconds per run, the first 10% is the warmup
+LIVE_PERCENT=${LIVE_PERCENT:-50}                 # live set, percent of the heap
+WORKLOAD_THREADS=${WORKLOAD_THREADS:-8}
+SEED=${SEED:-1}
+
+# CPU server
+semeru_home=${SEMERU_HOME:-"${HOME}/Semeru"}
+build_mode=${BUILD_MODE:-"release"}
+CPU_JAVA_HOME=${CPU_JAVA_HOME:-"${semeru_home}/CPU-Server/build/linux-x86_64-server-${build_mode}/jdk"}
+SEMERU_MODULE=${SEMERU_MODULE:-"${semeru_home}/linux-4.11-rc8/semeru/semeru_cpu_server.ko"}
+SWAP_FILE=${SWAP_FILE:-"${HOME}/swapfile"}
+REGION_SIZE=${REGION_SIZE:-"512M"}               # G1HeapRegionSize, the same on both sides
+NATIVE_HEADROOM_MB=${NATIVE_HEADROOM_MB:-2048}   # cgroup room for the JVM native memory
+CPU_CORES=${CPU_CORES:-"1-15"}                   # core 0 is left to the control path
+CGROUP_NAME=${CGROUP_NAME:-"semeru_sweep"}
+
+# Memory servers, one entry per memory server, in the order of their ids
+MEM_SERVER_HOSTS=(${MEM_SERVER_HOSTS:-"mem0 mem1"})          # ssh host names
+MEM_SERVER_IPS=(${MEM_SERVER_IPS:-"10.0.0.2 10.0.0.4"})      # InfiniBand IPs
+MEM_JAVA_HOME=${MEM_JAVA_HOME:-"${semeru_home}/Memory-Server/build/linux-x86_64-server-${build_mode}/jdk"}
+MEM_CONC_THREADS=${MEM_CONC_THREADS:-8}                      # SemeruConcGCThreads
+MEM_SERVER_WARMUP=${MEM_SERVER_WARMUP:-20}                   # seconds until the LJVM listens
+META_REGION_GB=4
+DATA_REGIONS_GB=32
+
+OUT_DIR=${OUT_DIR:-"$(pwd)/semeru_sweep_$(date +%Y%m%d_%H%M%S)"}
+script_dir="$(cd "$(dirname "$0")" && pwd)"
+classes_dir="${OUT_DIR}/classes"
+
+
+###
+# Functions
+
+function log () {
+	echo "[$(date +%H:%M:%S)] $*"
+}
+
+function compile_workloads () {
+	mkdir -p "${classes_dir}"
+	"${CPU_JAVA_HOME}/bin/javac" -d "${classes_dir}" "${script_dir}/SemeruStress.java" "${script_dir}/SemeruMemServerMain.java" || exit 1
+	# The memory servers run their own copy.
+	for host in "${MEM_SERVER_HOSTS[@]}"
+	do
+		ssh "${host}" "mkdir -p ${classes_dir}" && scp -q "${classes_dir}/SemeruMemServerMain.class" "${host}:${classes_dir}/" || exit 1
+	done
+}
+
+# $1 memory server count
+function start_mem_servers () {
+	local num=$1
+	local mem_size="$(( META_REGION_GB + DATA_REGIONS_GB / num ))g"
+	local id
+
+	for (( id = 0; id < num; id++ ))
+	do
+		log "start memory server ${id} on ${MEM_SERVER_HOSTS[$id]}, ${mem_size}"
+		ssh "${MEM_SERVER_HOSTS[$id]}" "nohup numactl --cpunodebind=0 ${MEM_JAVA_HOME}/bin/java \
+			-XX:+SemeruEnableMemPool -XX:-UseCompressedOops -XX:G1HeapRegionSize=${REGION_SIZE} \
+			-XX:SemeruMemPoolMaxSize=${mem_size} -XX:SemeruMemPoolInitialSize=${mem_size} \
+			-XX:SemeruConcGCThreads=${MEM_CONC_THREADS} -XX:SemeruMemServerNum=${num} -XX:SemeruMemServerID=${id} \
+			-XX:+UsePerfData -cp ${classes_dir} SemeruMemServerMain > /tmp/${CGROUP_NAME}_mem${id}.log 2>&1 &"
+	done
+	sleep "${MEM_SERVER_WARMUP}"
+}
+
+# $1 memory server count, $2 run directory
+function stop_mem_servers () {
+	local num=$1
+	local run_dir=$2
+	local id
+
+	for (( id = 0; id < num; id++ ))
+	do
+		ssh "${MEM_SERVER_HOSTS[$id]}" "${MEM_JAVA_HOME}/bin/jcmd SemeruMemServerMain PerfCounter.print" \
+			> "${run_dir}/mem${id}_perf.txt" 2>/dev/null
+		ssh "${MEM_SERVER_HOSTS[$id]}" "pkill -f SemeruMemServerMain; cat /tmp/${CGROUP_NAME}_mem${id}.log" \
+			> "${run_dir}/mem${id}.log" 2>/dev/null
+	done
+}
+
+# $1 memory server count
+function load_semeru_module () {
+	local num=$1
+	local ips
+
+	ips=$(IFS=,; echo "${MEM_SERVER_IPS[*]:0:$num}")
+	log "insmod ${SEMERU_MODULE} num_mem_servers=${num} mem_server_ip=${ips}"
+	sudo insmod "${SEMERU_MODULE}" num_mem_servers="${num}" mem_server_ip="${ips}" || return 1
+
+	if [ ! -e "${SWAP_FILE}" ]
+	then
+		sudo fallocate -l "${DATA_REGIONS_GB}G" "${SWAP_FILE}"
+		sudo chmod 600 "${SWAP_FILE}"
+		sudo mkswap "${SWAP_FILE}" > /dev/null
+	fi
+	sudo swapon "${SWAP_FILE}"
+}
+
+function unload_semeru_module () {
+	sudo swapoff "${SWAP_FILE}" 2> /dev/null
+	sudo rmmod semeru_cpu_server 2> /dev/null
+}
+
+# $1 heap GB, $2 cache percent
+function set_cgroup_limit () {
+	local limit_mb=$(( $1 * 1024 * $2 / 100 + NATIVE_HEADROOM_MB ))
+	local cgroup_dir="/sys/fs/cgroup/memory/${CGROUP_NAME}"
+
+	sudo mkdir -p "${cgroup_dir}"
+	echo "$(( limit_mb << 20 ))" | sudo tee "${cgroup_dir}/memory.limit_in_bytes" > /dev/null
+}
+
+function vmstat_counter () {
+	awk -v key="$1" '$1 == key { print $2 }' /proc/vmstat
+}
+
+# The pauses of the -Xlog:gc lines, e.g. "... Pause Young (Normal) (G1 Evacuation Pause) 100M->50M(200M) 12.345ms"
+# Print : count p50_ms p99_ms max_ms total_ms
+function pause_stats () {
+	grep "Pause" "$1" | grep -o "[0-9.]*ms$" | tr -d "ms" | sort -n | awk '
+		{ v[NR] = $1; total += $1 }
+		END {
+			if (NR == 0) { print "0 0 0 0 0"; exit }
+			p50 = v[int(NR * 0.50 + 0.999)]; p99 = v[int(NR * 0.99 + 0.999)] # nearest rank
+			printf "%d %.3f %.3f %.3f %.3f\n", NR, p50, p99, v[NR], total
+		}'
+}
+
+# The last closed interval of /sys/kernel/debug/semeru/latency, summed over the memory servers.
+# Print : store_pages load_pages cp_reads cp_writes
+function rdma_stats () {
+	awk '$1 !~ /^#/ { n[$1] += $3 }
+		END { printf "%d %d %d %d\n", n["store"], n["load"], n["cp_read"], n["cp_write"] }' "$1"
+}
+
+# The sum of a sun.gc.semeru.* counter over the memory servers of a run.
+function mem_server_counter () {
+	cat "$1"/mem*_perf.txt 2>/dev/null | awk -F= -v key="sun.gc.semeru.$2" '$1 == key { sum += $2 } END { print sum + 0 }'
+}
+
+# $1 servers, $2 heap GB, $3 cache percent, $4 workload
+function run_one () {
+	local servers=$1 heap=$2 cache=$3 workload=$4
+	local run="s${servers}_h${heap}g_c${cache}_${workload}"
+	local run_dir="${OUT_DIR}/${run}"
+	local live_mb=$(( heap * 1024 * LIVE_PERCENT / 100 ))
+	local swapin_start swapout_start swapins swapouts ops_per_s
+
+	mkdir -p "${run_dir}"
+	log "run ${run}"
+
+	start_mem_servers "${servers}"
+	if ! load_semeru_module "${servers}"
+	then
+		log "load the Semeru module failed, skip ${run}"
+		stop_mem_servers "${servers}" "${run_dir}"
+		return
+	fi
+	set_cgroup_limit "${heap}" "${cache}"
+
+	echo 1 | sudo tee /sys/kernel/debug/semeru/latency_rotate > /dev/null
+	swapin_start=$(vmstat_counter pswpin)
+	swapout_start=$(vmstat_counter pswpout)
+
+	sudo cgexec --sticky -g memory:"${CGROUP_NAME}" taskset -c "${CPU_CORES}" "${CPU_JAVA_HOME}/bin/java" \
+		-XX:+SemeruEnableMemPool -XX:+EnableBitmap -XX:-UseCompressedOops -Xnoclassgc \
+		-XX:G1HeapRegionSize="${REGION_SIZE}" -XX:MetaspaceSize=0x10000000 \
+		-Xms"${heap}g" -Xmx"${heap}g" -XX:SemeruLocalCachePercent="${cache}" \
+		-XX:SemeruMemServerNum="${servers}" -XX:SemeruMemServerIPs="$(IFS=,; echo "${MEM_SERVER_IPS[*]:0:$servers}")" \
+		-Xlog:gc,gc+phases=debug:file="${run_dir}/gc.log" \
+		-cp "${classes_dir}" SemeruStress "${workload}" "${DURATION}" "${live_mb}" "${WORKLOAD_THREADS}" "${SEED}" \
+		> "${run_dir}/stdout.log" 2>&1
+
+	swapins=$(( $(vmstat_counter pswpin) - swapin_start ))
+	swapouts=$(( $(vmstat_counter pswpout) - swapout_start ))
+	echo 1 | sudo tee /sys/kernel/debug/semeru/latency_rotate > /dev/null
+	sudo cat /sys/kernel/debug/semeru/latency_last > "${run_dir}/rdma_latency.txt"
+
+	stop_mem_servers "${servers}" "${run_dir}"
+	unload_semeru_module
+
+	ops_per_s=$(grep "^RESULT" "${run_dir}/stdout.log" | grep -o "ops_per_s=[0-9]*" | cut -d= -f2)
+	echo "${servers},${heap},${cache},${workload},${ops_per_s:-FAILED},$(pause_stats "${run_dir}/gc.log" | tr ' ' ','),${swapins},${swapouts},$(rdma_stats "${run_dir}/rdma_latency.txt" | tr ' ' ','),$(mem_server_counter "${run_dir}" compactedBytes),$(mem_server_counter "${run_dir}" tracedRegions)" \
+		>> "${OUT_DIR}/results.csv"
+}
+
+
+###
+# Do the sweep
+
+mkdir -p "${OUT_DIR}"
+compile_workloads
+unload_semeru_module
+
+echo "servers,heap_gb,cache_percent,workload,ops_per_s,pauses,pause_p50_ms,pause_p99_ms,pause_max_ms,pause_total_ms,swap_ins,swap_outs,rdma_store_pages,rdma_load_pages,cp_reads,cp_writes,mem_compacted_bytes,mem_traced_regions" \
+	> "${OUT_DIR}/results.csv"
+
+for servers in ${SERVER_COUNTS}
+do
+	if [ "${servers}" -gt "${#MEM_SERVER_HOSTS[@]}" ]
+	then
+		log "only ${#MEM_SERVER_HOSTS[@]} memory servers in MEM_SERVER_HOSTS, skip ${servers}"
+		continue
+	fi
+	for heap in ${HEAP_SIZES}
+	do
+		for cache in ${CACHE_PERCENTS}
+		do
+			for workload in ${WORKLOADS}
+			do
+				run_one "${servers}" "${heap}" "${cache}" "${workload}"
+			done
+		done
+	done
+done
+
+log "done, ${OUT_DIR}/results.csv"
+column -s, -t < "${OUT_DIR}/results.csv"
@@ -4255,6 +4255,51 @@ char* os::semeru_pd_attempt_reserve_memory_at(size_t bytes, char* requested_addr
 }
 
 
+/**
+ * Semeru
+ * 
+ * Commit a range of the reserved memory pool with large pages.
+ * The memory pool is registered as RDMA buffer Region by Region. 
+ * The HCA translates a large page by one MTT entry, instead of one entry per 4KB page,
+ * so the random RDMA reads of the CPU server don't miss in the translation cache.
+ * 
+ * 	1) -XX:+UseHugeTLBFS, re-map the range by MAP_HUGETLB. The hugetlb pages are reserved by the mmap, fail early.
+ * 	2) -XX:+UseTransparentHugePages, commit with small pages and madvise(MADV_HUGEPAGE).
+ * 		The RDMA registration faults in the pages, as THP if the kernel has them.
+ * 
+ * The reservation was mapped PROT_NONE with small pages by semeru_anon_mmap(), the commit replaces it by MAP_FIXED.
+ * Return false if the large pages can't be got, the range is still reserved.
+ */
+bool os::semeru_pd_commit_large_pages(char* addr, size_t bytes) {
+	assert(UseLargePages, "only for large pages");
+	assert(is_aligned(addr, os::large_page_size()) && is_aligned(bytes, os::large_page_size()),
+	       "unaligned large pages range [0x%lx, 0x%lx)", (size_t)addr, (size_t)(addr + bytes));
+
+	if (UseHugeTLBFS) {
+		char* res = (char*)::mmap(addr, bytes, PROT_READ|PROT_WRITE,
+		                          MAP_PRIVATE|MAP_ANONYMOUS|MAP_FIXED|MAP_HUGETLB, -1, 0);
+		if (res == MAP_FAILED) {
+			warn_on_large_pages_failure(addr, bytes, errno);
+			// The failed MAP_FIXED mmap may have unmapped the reservation already.
+			::mmap(addr, bytes, PROT_NONE, MAP_PRIVATE|MAP_NORESERVE|MAP_ANONYMOUS|MAP_FIXED, -1, 0);
+			return false;
+		}
+		return true;
+	}
+
+	if (UseTransparentHugePages) {
+		if (os::Linux::commit_memory_impl(addr, bytes, false) != 0) {
+			return false;
+		}
+		::madvise(addr, bytes, MADV_HUGEPAGE);
+		return true;
+	}
+
+	// UseSHM, the segment can't be placed at a reserved address.
+	return false;
+}
+
+
 
 
 size_t os::read(int fd, void *buf, unsigned int nBytes) {
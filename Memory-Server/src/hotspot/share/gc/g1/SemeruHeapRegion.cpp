@@ -35,6 +35,7 @@
 #include "gc/g1/heapRegionRemSet.hpp"
 #include "gc/g1/heapRegionTracer.hpp"
 #include "gc/shared/genOopClosures.inline.hpp"
+#include "gc/shared/rdmaChecksum.hpp"
 #include "gc/shared/space.inline.hpp"
 #include "logging/log.hpp"
 #include "logging/logStream.hpp"
@@ -45,6 +46,7 @@
 #include "oops/oop.inline.hpp"
 #include "runtime/atomic.hpp"
 #include "runtime/orderAccess.hpp"
+#include "runtime/os.hpp"
 #include "utilities/growableArray.hpp"
 
 
@@ -52,6 +54,7 @@
 #include "gc/g1/g1SemeruCollectedHeap.inline.hpp"
 #include "gc/g1/SemeruHeapRegion.inline.hpp"
 #include "gc/g1/g1SemeruBlockOffsetTable.inline.hpp"
+#include "gc/g1/g1SemeruCompressedOops.inline.hpp"
 
 
 
@@ -169,6 +172,184 @@ HeapWord* SemeruHeapRegion::cross_threshold(HeapWord* start,
   return _sync_mem_cpu->_bot_part.threshold();
 }
 
+HeapWord* SemeruHeapRegion::initialize_threshold_at(HeapWord* addr, size_t* index) {
+  return _sync_mem_cpu->_bot_part.initialize_threshold_at(addr, index);
+}
+
+HeapWord* SemeruHeapRegion::cross_threshold_at(HeapWord* threshold, size_t* index,
+                                               HeapWord* start, HeapWord* end) {
+  _sync_mem_cpu->_bot_part.alloc_block_at(&threshold, index, start, end);
+  return threshold;
+}
+
+void SemeruHeapRegion::set_threshold(HeapWord* threshold, size_t index) {
+  _sync_mem_cpu->_bot_part.set_threshold(threshold, index);
+}
+
+static inline bool page_affinity() {
+  return G1SemeruCollectedHeap::heap()->cpu_server_flags()->_page_affinity;
+}
+
+/**
+ * Semeru MS - Invoked after the compaction of this Region, its top is final.
+ *  A range not pulled by the CPU server yet is merged, the CPU server clears it by sending the MemoryToCPUAtGC back.
+ */
+void SemeruHeapRegion::record_bot_update(HeapWord* addr) {
+  MemoryToCPUAtGC* m = _mem_to_cpu_gc;
+  size_t begin = pointer_delta(MIN2(addr, top()), bottom()) >> BOTConstants::LogN_words;
+  size_t end   = top() > bottom() ? (pointer_delta(top() - 1, bottom()) >> BOTConstants::LogN_words) + 1 : 0;
+
+  uint32_t v = m->begin_update();
+  if (m->_bot_dirty_end > m->_bot_dirty_begin) {
+    begin = MIN2(begin, m->_bot_dirty_begin);
+  }
+  m->_compacted_top   = top();
+  m->_bot_dirty_begin = begin;
+  m->_bot_dirty_end   = MAX2(begin, end);
+  if (page_affinity()) {
+    // The objects moved, the page groups of the last tracing are stale.
+    G1SemeruCollectedHeap::heap()->_page_affinity->clear(bottom(), this->end());
+    m->_affinity_version++;
+  }
+  m->end_update(v);
+  _liveness_epochs->bump(hrm_index());
+
+  log_debug(semeru, mem_compact)("%s, Region[0x%x] top 0x%lx, BOT cards [0x%lx, 0x%lx) updated", __func__,
+                                 hrm_index(), (size_t)top(), m->_bot_dirty_begin, m->_bot_dirty_end);
+}
+
+/**
+ * The samples are spread evenly over the used pages, from a random page of the first stride,
+ * so the successive compactions of a Region cover different pages.
+ */
+void SemeruHeapRegion::record_compaction_checksums() {
+  MemoryToCPUAtGC* m = _mem_to_cpu_gc;
+  uint percent = G1SemeruCollectedHeap::heap()->cpu_server_flags()->_checksum_sample_percent;
+  size_t used  = pointer_delta(top(), bottom(), 1);
+  size_t pages = align_up(used, (size_t)PAGE_SIZE) / PAGE_SIZE;
+
+  uint32_t v = m->begin_update();
+  if (percent == 0 || pages == 0) {
+    m->_num_checksums = 0;
+    m->end_update(v);
+    return;
+  }
+
+  size_t num    = MIN2(MAX2(pages * percent / 100, (size_t)1), (size_t)SEMERU_MAX_CHECKSUM_SAMPLES);
+  size_t stride = pages / num;
+  size_t page   = (size_t)os::random() % stride;
+  for (size_t i = 0; i < num; i++, page += stride) {
+    size_t offset = page * PAGE_SIZE;
+    m->_checksum_pages[i] = (uint32_t)page;
+    m->_checksums[i]      = SemeruCRC32C::compute((char*)bottom() + offset, MIN2((size_t)PAGE_SIZE, used - offset));
+  }
+  m->_num_checksums = (uint32_t)num;
+  m->end_update(v);
+
+  log_trace(semeru, mem_compact)("%s, Region[0x%x] 0x%lx of 0x%lx pages checksummed", __func__, hrm_index(), num, pages);
+}
+
+static inline bool selective_invalidation() {
+  return G1SemeruCollectedHeap::heap()->cpu_server_flags()->_selective_invalidation;
+}
+
+void SemeruHeapRegion::note_rewritten(const void* start, const void* end) {
+  if (!selective_invalidation() || end <= start) {
+    return;
+  }
+
+  size_t first = pointer_delta(start, bottom(), 1) / PAGE_SIZE;
+  size_t last  = MIN2((pointer_delta(end, bottom(), 1) - 1) / PAGE_SIZE, _rewritten_pages.size() - 1);
+  if (first == last) {
+    _rewritten_pages.par_set_bit(first);
+  } else {
+    _rewritten_pages.par_at_put_range(first, last + 1, true);
+  }
+  if (!_has_rewritten) {
+    _has_rewritten = true;
+  }
+}
+
+void SemeruHeapRegion::note_rewritten_field(const void* p) {
+  if (!selective_invalidation()) {
+    return;
+  }
+  SemeruHeapRegion* hr = G1SemeruCollectedHeap::heap()->heap_region_containing(p);
+  hr->note_rewritten(p, (const char*)p + heapOopSize);
+}
+
+/**
+ * The pages are reported as runs, a gap of at most max_gap pages is merged into them.
+ * Return the number of runs, only the first SEMERU_MAX_REWRITTEN_RANGES are written.
+ */
+static uint collect_rewritten_runs(BitMap* pages, size_t max_gap, MemoryToCPUAtGC* m) {
+  uint num = 0;
+  BitMap::idx_t end = 0;
+  for (BitMap::idx_t begin = pages->get_next_one_offset(0); begin < pages->size();
+       begin = pages->get_next_one_offset(end)) {
+    bool merged = num > 0 && begin - end <= max_gap;
+    end = pages->get_next_zero_offset(begin);
+    if (!merged) {
+      num++;
+    }
+    if (num <= SEMERU_MAX_REWRITTEN_RANGES) {
+      if (!merged) {
+        m->_rewritten[num - 1][0] = (uint32_t)begin;
+      }
+      m->_rewritten[num - 1][1] = (uint32_t)end;
+    }
+  }
+  return num;
+}
+
+/**
+ * Semeru MS - Invoked at the end of a compaction window, the inter-Region fields were recorded with the intra-Region ones.
+ *  A range not dropped by the CPU server yet is merged, the CPU server clears it by sending the MemoryToCPUAtGC back.
+ */
+void SemeruHeapRegion::record_rewritten_pages() {
+  if (!_has_rewritten) {
+    return;
+  }
+  _has_rewritten = false;
+
+  MemoryToCPUAtGC* m = _mem_to_cpu_gc;
+  uint32_t v = m->begin_update();
+  for (uint i = 0; i < MIN2(m->_num_rewritten, (uint32_t)SEMERU_MAX_REWRITTEN_RANGES); i++) {
+    _rewritten_pages.set_range(m->_rewritten[i][0], MIN2((size_t)m->_rewritten[i][1], _rewritten_pages.size()));
+  }
+
+  // Double the merged gap until the runs fit.
+  size_t max_gap = 0;
+  uint num;
+  while ((num = collect_rewritten_runs(&_rewritten_pages, max_gap, m)) > SEMERU_MAX_REWRITTEN_RANGES) {
+    max_gap = max_gap * 2 + 1;
+  }
+  m->_num_rewritten = num;
+  m->end_update(v);
+  _rewritten_pages.clear_range(0, _rewritten_pages.size());
+
+  log_debug(semeru, mem_compact)("%s, Region[0x%x] 0x%x page ranges rewritten, gaps of 0x%lx pages merged", __func__,
+                                 hrm_index(), num, max_gap);
+}
+
+void SemeruHeapRegion::clear_page_affinity() {
+  if (page_affinity()) {
+    G1SemeruCollectedHeap::heap()->_page_affinity->clear(bottom(), end());
+  }
+}
+
+void SemeruHeapRegion::publish_page_affinity() {
+  if (!page_affinity()) {
+    return;
+  }
+
+  MemoryToCPUAtGC* m = _mem_to_cpu_gc;
+  uint32_t v = m->begin_update();
+  m->_affinity_version++;
+  m->end_update(v);
+  _liveness_epochs->bump(hrm_index());
+}
+
 void SemeruHeapRegion::clear(bool mangle_space) {
   set_top(bottom());
   CompactibleSpace::clear(mangle_space);
@@ -299,6 +480,7 @@ void SemeruHeapRegion::hr_clear(bool keep_remset, bool clear_space, bool locked)
   uninstall_surv_rate_group();
   set_free();
   reset_pre_dummy_top();
+  invalidate_traced_liveness();
 
     //Debug
   if(rem_set() == NULL){
@@ -434,6 +616,18 @@ SemeruHeapRegion::SemeruHeapRegion(uint hrm_index,
     _mem_to_cpu_gc(NULL),
     _sync_mem_cpu(NULL),
     scan_failure(false),
+    _alive_bitmap_dirty_top(NULL),
+    _fwd_table(NULL),
+    _rewritten_pages(mtGC),
+    _has_rewritten(false),
+    _traced_valid(false),
+    _traced_version(0),
+    _traced_write_epoch(0),
+    _traced_root_digest(0),
+    _traced_top(NULL),
+    _traced_alive_words(0),
+    _traced_alive_ratio(0.0),
+    _root_digest(0),
     _rem_set(NULL),
     _evacuation_failed(false),
 #ifdef ASSERT
@@ -520,6 +714,9 @@ void SemeruHeapRegion::initialize(MemRegion mr,
   // assign the 1-sided rdma write check flag 
   G1SemeruCollectedHeap* g1h = G1SemeruCollectedHeap::heap();
   _write_check_flag = g1h->_rdma_write_check_flags->region_write_check_flag(region_index);
+  _liveness_epochs  = g1h->_liveness_epochs;
+  _liveness_vector  = g1h->_liveness_vector;
+  _rewritten_pages.initialize(SemeruGrainBytes / PAGE_SIZE);
 
   hr_clear(false /*par*/, false /*clear_space*/);
 
@@ -592,7 +789,7 @@ void SemeruHeapRegion::allocate_init_target_oop_bitmap(uint hrm_index){
   
   // Use target oop bitmap to replace the cross-region-update queue
   // The instance should be allocated in RDMA Meta space.
-  _sync_mem_cpu->_cross_region_ref_target_queue = new (CROSS_REGION_REF_TARGET_Q_LEN, hrm_index) BitQueue(SemeruGrainWords);  
+  _sync_mem_cpu->_cross_region_ref_target_queue = new (SemeruMetaLayout::cross_region_ref_target_q_len(), hrm_index) BitQueue(SemeruGrainWords);  
   _sync_mem_cpu->_cross_region_ref_target_queue->initialize((size_t)hrm_index, bottom());
   log_debug(semeru,alloc)("%s,Region[%d] _cross_region_ref_target_queue [0x%lx, 0x%lx), bitmap : 0x%lx ", __func__, 
                                                                            hrm_index, 
@@ -613,6 +810,85 @@ void SemeruHeapRegion::allocate_init_cross_region_ref_update_queue(uint hrm_inde
 }
 
 
+
+/**
+ * Semeru MS - Incremental tracing, -XX:+SemeruIncrementalTracing.
+ *  The liveness of a Region is decided by its contents and its root bitmap.
+ *  The contents are unchanged if
+ *  1) the CPU server's write epoch is the same, no resident page is flushed and the top didn't move ;
+ *  2) the write check version is the same and not dirty, no page is swapped out by the data path ;
+ *  3) the memory server didn't move or free the objects.
+ *  The root bitmap is written by the CPU server at each GC, compare its digest.
+ */
+uint64_t SemeruHeapRegion::root_bitmap_digest() {
+  BitQueue* roots = _sync_mem_cpu->_cross_region_ref_target_queue;
+  uint64_t  digest = roots->_marked_from_root ? 1 : 0;
+
+  // Only the pages set in the summary can have marks.
+  for (size_t p = 0; p < roots->num_pages(); p++) {
+    if (!roots->is_page_dirty(p)) {
+      continue;
+    }
+    size_t* page = roots->page_start(p);
+    for (size_t j = 0; j < roots->page_words(p); j++) {
+      size_t i = (p << BitQueue::LogWordsPerPage) + j;
+      if (page[j] != 0) {
+        digest = (digest ^ (page[j] + i * UCONST64(0x9e3779b97f4a7c15))) * UCONST64(0xff51afd7ed558ccd);
+      }
+    }
+  }
+  return digest;
+}
+
+bool SemeruHeapRegion::is_traced_liveness_valid() {
+  _root_digest = root_bitmap_digest();
+
+  return _traced_valid && !write_check_tag_dirty() &&
+         write_check_tag_version_val() == _traced_version &&
+         _cpu_to_mem_gc->_write_epoch == _traced_write_epoch &&
+         top() == _traced_top &&
+         _root_digest == _traced_root_digest;
+}
+
+void SemeruHeapRegion::restore_traced_liveness() {
+  // The roots are consumed as a tracing does. The alive bitmap is kept.
+  clear_root_objects();
+
+  reset_region_liveness();
+  set_alive_words(_traced_alive_words);
+  set_alive_ratio(_traced_alive_ratio);
+  set_region_cm_scanned();
+
+  log_debug(semeru,mem_trace)("%s, Region[0x%x] is unchanged since its last tracing, alive_ratio %f", __func__,
+                              hrm_index(), _traced_alive_ratio);
+}
+
+void SemeruHeapRegion::record_traced_liveness() {
+  _traced_valid       = true;
+  _traced_version     = _version_tag;
+  _traced_write_epoch = _cpu_to_mem_gc->_write_epoch;
+  _traced_root_digest = _root_digest;
+  _traced_top         = top();
+  _traced_alive_words = alive_words();
+  _traced_alive_ratio = alive_ratio();
+}
+
+/**
+ * Semeru MS - Clear the marks of the last tracing before the Region is traced again.
+ *  A Region never traced, or not marked since its last clear, is skipped. Otherwise only [bottom, dirty top)
+ *  is cleared, by non-temporal stores. The bitmap is written by the tracing anyway, the caches are left to the heap.
+ */
+void SemeruHeapRegion::clear_alive_bitmap() {
+  if (_alive_bitmap_dirty_top == NULL) {
+    return;
+  }
+
+  if (_alive_bitmap_dirty_top > bottom()) {
+    _alive_bitmap.clear_range_nontemporal(MemRegion(bottom(), _alive_bitmap_dirty_top));
+  }
+  _alive_bitmap_dirty_top = NULL;
+}
+
 void SemeruHeapRegion::report_region_type_change(G1HeapRegionTraceType::Type to) {
   HeapRegionTracer::send_region_type_change( _cpu_to_mem_init->_hrm_index,
                                             get_trace_type(),
@@ -923,7 +1199,7 @@ public:
     T heap_oop = RawAccess<>::oop_load(p);
     Log(gc, verify) log;
     if (!CompressedOops::is_null(heap_oop)) {
-      oop obj = CompressedOops::decode_not_null(heap_oop);
+      oop obj = SemeruCompressedOops::decode_not_null(heap_oop);
       bool failed = false;
       if (!_g1h->is_in_closed_subset(obj) || _g1h->is_obj_dead_cond(obj, _vo)) {
         MutexLockerEx x(ParGCRareEvent_lock,
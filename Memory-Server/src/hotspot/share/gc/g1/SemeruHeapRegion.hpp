@@ -33,6 +33,7 @@
 #include "gc/shared/ageTable.hpp"
 #include "gc/shared/cardTable.hpp"
 #include "gc/shared/spaceDecorator.hpp"
+#include "runtime/atomic.hpp"
 #include "utilities/macros.hpp"
 
 // Semeru
@@ -77,6 +78,7 @@ class nmethod;
 
 // Semeru
 class G1SemeruCollectedHeap;
+class G1SemeruForwardTable;
 class SemeruHeapRegion;
 
 
@@ -177,6 +179,9 @@ public:
   // [x] Only allocate && initialize this queue in Semeru heap.
   //TargetObjQueue* _target_obj_queue;
 
+  // Bumped by the CPU server when it may have written the Region since the last flush.
+  // The writes to the evicted pages are covered by the write check tags.
+  uint32_t _write_epoch;
 
 
   // functions
@@ -185,7 +190,8 @@ public:
    _type(),
    _humongous_start_region(NULL),
    _next(NULL),
-   _prev(NULL)   
+   _prev(NULL),
+   _write_epoch(0)   
    { }
 
 
@@ -202,6 +208,11 @@ public:
 class MemoryToCPUAtGC : public CHeapRDMAObj< MemoryToCPUAtGC, MEM_TO_CPU_AT_GC_ALLOCTYPE>{
 
 public:
+  // Seqlock of the updates, the first and the last field. The CPU server reads this object by RDMA
+  // at any time and only takes a copy whose two versions are the same and even.
+  // See begin_update() and end_update().
+  volatile uint32_t _version;
+
   // this field identify this Region is already traced by the concurrent threads.
   // This value is setted by Semeru memory srver BUT also accessed by the CPU server.
   bool _cm_scanned;    
@@ -210,17 +221,63 @@ public:
   volatile size_t        _marked_alive_bytes;  // Marked alive objects. [ Abandoned ? ]
   volatile double        _alive_ratio;         // Used to decide GC or not.
 
+  // The compaction rewrote the BOT cards [_bot_dirty_begin, _bot_dirty_end) of this Region, and its top.
+  // The CPU server pulls only these cards and clears the range, see SemeruHeapRegion::record_bot_update().
+  HeapWord*              _compacted_top;
+  size_t                 _bot_dirty_begin;
+  size_t                 _bot_dirty_end;
+
+  // The CRC32C of the sampled pages of [bottom, _compacted_top), PAGE_SIZE each, the last one up to the top.
+  // See SemeruHeapRegion::record_compaction_checksums().
+  uint32_t               _num_checksums;
+  uint32_t               _checksum_pages[SEMERU_MAX_CHECKSUM_SAMPLES];
+  uint32_t               _checksums[SEMERU_MAX_CHECKSUM_SAMPLES];
+
+  // The page ranges [begin, end) of this Region, from its bottom, the compactions rewrote.
+  // Merged until the CPU server drops their local copies and clears them, see SemeruHeapRegion::record_rewritten_pages().
+  uint32_t               _num_rewritten;
+  uint32_t               _rewritten[SEMERU_MAX_REWRITTEN_RANGES][2];
+
+  // Bumped each time the memory server rewrites the page affinity of this Region, see page_affinity_table.
+  uint32_t               _affinity_version;
+
+  volatile uint32_t      _version_tail;
+
   //
   // functions
   //
   MemoryToCPUAtGC(uint hrm_index):
+    _version(0),
     _cm_scanned(false),
     _marked_alive_bytes(0),
-    _alive_ratio(0.0)
+    _alive_ratio(0.0),
+    _compacted_top(NULL),
+    _bot_dirty_begin(0),
+    _bot_dirty_end(0),
+    _num_checksums(0),
+    _num_rewritten(0),
+    _affinity_version(0),
+    _version_tail(0)
   {
 
   }
 
+  // Make _version odd before writing the fields, it also excludes the other writers of this Region.
+  // Return the version to pass to end_update(). The CPU server may write back the object meanwhile,
+  // the versions are set from the returned one, not from the fields.
+  uint32_t begin_update() {
+    uint32_t v;
+    do {
+      v = _version & ~(uint32_t)1;
+    } while (Atomic::cmpxchg(v + 1, &_version, v) != v);
+    OrderAccess::storestore();
+    return v;
+  }
+
+  void end_update(uint32_t v) {
+    OrderAccess::release_store(&_version_tail, v + 2);
+    OrderAccess::release_store(&_version, v + 2);
+  }
 
   void reset() {
     _cm_scanned = 0;  // Should alrady be restted by CPU server.
@@ -461,6 +518,17 @@ public:
   G1CMBitMap  _alive_bitmap;        // pointed by G1SemeruCMTask->_alive_bitmap.
   G1CMBitMap  _target_oop_bitmap;   // Points to _sync_mem_cpu->_cross_region_ref_target_queue->_target_bitmap
   bool        scan_failure;     // identify if the concurrent tracing is failed.
+  // The end of the marks left in _alive_bitmap, NULL if it's clean.
+  // The top of the Region shrinks after a compaction, the marks of the last tracing can be above it.
+  HeapWord*   _alive_bitmap_dirty_top;
+
+  // The new address of the target objects, built when this Region is compacted.
+  // NULL if the Region isn't compacted in current compaction window.
+  G1SemeruForwardTable* _fwd_table;
+
+  // -XX:+SemeruSelectiveInvalidation, the pages of this Region written by the compactions since the last report.
+  CHeapBitMap   _rewritten_pages;
+  volatile bool _has_rewritten;
 
   // 1-sied RDMA write check flags
   // Points to FLAGS_OF_CPU_WRITE_CHECK_OFFSET, 4KB
@@ -470,6 +538,26 @@ public:
 
   uint32_t  _version_tag; // store the version value, low 16 bits.
 
+  // Points to g1h->_liveness_epochs, LIVENESS_EPOCH_OFFSET.
+  // Bumped after each update of _mem_to_cpu_gc.
+  region_liveness_epochs* _liveness_epochs;
+
+  // Points to g1h->_liveness_vector, LIVENESS_VECTOR_OFFSET.
+  // Republished after each update of the liveness of _mem_to_cpu_gc.
+  region_liveness_vector* _liveness_vector;
+
+  // Incremental tracing, -XX:+SemeruIncrementalTracing.
+  // The inputs and the results of the last complete tracing of this Region.
+  // Invalidated when the memory server moves or frees the objects.
+  bool      _traced_valid;
+  uint32_t  _traced_version;        // write check version tag
+  uint32_t  _traced_write_epoch;    // _cpu_to_mem_gc->_write_epoch
+  uint64_t  _traced_root_digest;
+  HeapWord* _traced_top;
+  size_t    _traced_alive_words;
+  double    _traced_alive_ratio;
+  uint64_t  _root_digest;           // of the root bitmap claimed by current tracing
+
 
   //
   // Functions
@@ -492,6 +580,17 @@ public:
     return false;
   }
 
+  // Digest of the root bitmap, _sync_mem_cpu->_cross_region_ref_target_queue.
+  uint64_t root_bitmap_digest();
+
+  // Tracing start check, the claimed Region isn't touched since its last complete tracing.
+  bool     is_traced_liveness_valid();
+  // Reuse the liveness of the last tracing instead of tracing the Region again.
+  void     restore_traced_liveness();
+  // Tracing end, record the inputs and the results.
+  void     record_traced_liveness();
+  void     invalidate_traced_liveness() { _traced_valid = false; }
+
  protected: 
   //
   // ############################# End of update fields section #############################
@@ -667,6 +766,26 @@ public:
   virtual HeapWord* initialize_threshold();
   virtual HeapWord* cross_threshold(HeapWord* start, HeapWord* end);
 
+  // Semeru MS - BOT updates of the chunked compaction, each chunk has its own threshold.
+  HeapWord* initialize_threshold_at(HeapWord* addr, size_t* index);
+  HeapWord* cross_threshold_at(HeapWord* threshold, size_t* index, HeapWord* start, HeapWord* end);
+  void      set_threshold(HeapWord* threshold, size_t index);
+
+  // The compaction rewrote the BOT entries from the card of addr to top, report them to the CPU server.
+  void      record_bot_update(HeapWord* addr);
+  // Checksum the sampled pages of [bottom, top) after the compaction, -XX:SemeruChecksumSamplePercent on the CPU server.
+  void      record_compaction_checksums();
+  // -XX:+SemeruSelectiveInvalidation on the CPU server. The compaction writes [start, end) of this Region, MT safe.
+  void      note_rewritten(const void* start, const void* end);
+  // The compaction writes the field at p, of any Region.
+  static void note_rewritten_field(const void* p);
+  // Report the pages written since the last report, merged with the ranges the CPU server hasn't taken.
+  void      record_rewritten_pages();
+  // -XX:+SemeruPageAffinity on the CPU server. Drop the page groups of the last tracing, see page_affinity_table.
+  void      clear_page_affinity();
+  // The tracing linked the page groups of this Region, the CPU server reads them at its next pause.
+  void      publish_page_affinity();
+
 
   void mangle_unused_area() PRODUCT_RETURN;
   void mangle_unused_area_complete() PRODUCT_RETURN;
@@ -752,6 +871,10 @@ public:
 
   // get current Region's alive/dest bitmap
   G1CMBitMap* alive_bitmap()  { return &_alive_bitmap;  }
+  // The tracing marks below the current top.
+  void note_alive_bitmap_dirty()  { _alive_bitmap_dirty_top = MAX2(_alive_bitmap_dirty_top, top()); }
+  // Clear only the range marked since the last clear, skipped for a clean bitmap.
+  void clear_alive_bitmap();
 
 	bool is_marked_alive(oop obj) const {	 return _alive_bitmap.is_marked( obj);	}
 
@@ -808,6 +931,18 @@ public:
   template<typename ApplyToMarkedClosure>
   inline void semeru_apply_to_marked_objects(G1CMBitMap* bitmap, ApplyToMarkedClosure* closure);
 
+  // Scan the marked objects starting in [start, end). Return false if the tracing failed.
+  template<typename ApplyToMarkedClosure>
+  inline bool semeru_apply_to_marked_range(G1CMBitMap* bitmap, ApplyToMarkedClosure* closure,
+                                           HeapWord* start, HeapWord* end, HeapWord** next_addr);
+
+  // Scan the roots of the target oop bitmap, only where the BitQueue's list or summary says.
+  template<typename ApplyToMarkedClosure>
+  inline void semeru_apply_to_root_objects(ApplyToMarkedClosure* closure);
+
+  // Clear the target oop bitmap after the scan, by the same list or summary.
+  void clear_root_objects() { _sync_mem_cpu->_cross_region_ref_target_queue->clear_bits(); }
+
   // Override for scan_and_forward support.
   void prepare_for_compaction(CompactPoint* cp);
   // Update heap region to be consistent after compaction.
@@ -833,7 +968,11 @@ public:
   // inline void semeru_apply_to_marked_objects(G1CMBitMap* bitmap, ApplyToMarkedClosure* closure);
 
   size_t marked_alive_bytes() { return _mem_to_cpu_gc->_marked_alive_bytes; }
-  void  add_to_marked_alive_bytes(size_t incr_bytes)  { _mem_to_cpu_gc->_marked_alive_bytes += incr_bytes;  }
+  void  add_to_marked_alive_bytes(size_t incr_bytes)  {
+    uint32_t v = _mem_to_cpu_gc->begin_update();
+    _mem_to_cpu_gc->_marked_alive_bytes += incr_bytes;
+    _mem_to_cpu_gc->end_update(v);
+  }
 
   // The number of bytes counted in the next marking.
   size_t next_marked_bytes() { return _next_marked_bytes; }
@@ -938,6 +1077,9 @@ public:
     return _sync_mem_cpu->_cross_region_ref_update_queue;
   }
 
+  G1SemeruForwardTable* fwd_table() const               { return _fwd_table;  }
+  void set_fwd_table(G1SemeruForwardTable* table)       { _fwd_table = table; }
+
   // Change this code to  check if a Region is in Memory Server CSet.
   //
   inline bool in_collection_set() const;
@@ -1160,14 +1302,23 @@ public:
   // The Semeru section
   //
 
-  void set_region_cm_scanned()    { _mem_to_cpu_gc->_cm_scanned = true;  }
-  void reset_region_cm_scanned()  { _mem_to_cpu_gc->_cm_scanned = false;  }
+  // The liveness of _mem_to_cpu_gc changed, let the CPU server see it.
+  void publish_liveness() {
+    _liveness_vector->publish(hrm_index(), _mem_to_cpu_gc->_cm_scanned, _mem_to_cpu_gc->_marked_alive_bytes,
+                              _mem_to_cpu_gc->_alive_ratio);
+    _liveness_epochs->bump(hrm_index());
+  }
+
+  // Each update of _mem_to_cpu_gc is bracketed by its begin_update() and end_update().
+  void set_region_cm_scanned()    { uint32_t v = _mem_to_cpu_gc->begin_update(); _mem_to_cpu_gc->_cm_scanned = true;  _mem_to_cpu_gc->end_update(v); publish_liveness(); }
+  void reset_region_cm_scanned()  { uint32_t v = _mem_to_cpu_gc->begin_update(); _mem_to_cpu_gc->_cm_scanned = false; _mem_to_cpu_gc->end_update(v); publish_liveness(); }
   bool is_region_cm_scanned()     { return _mem_to_cpu_gc->_cm_scanned; }
+  void reset_region_liveness()    { uint32_t v = _mem_to_cpu_gc->begin_update(); _mem_to_cpu_gc->reset(); _mem_to_cpu_gc->end_update(v); publish_liveness(); }
 
-  void    set_alive_words(size_t words)  { _mem_to_cpu_gc->_marked_alive_bytes = words;  }
+  void    set_alive_words(size_t words)  { uint32_t v = _mem_to_cpu_gc->begin_update(); _mem_to_cpu_gc->_marked_alive_bytes = words; _mem_to_cpu_gc->end_update(v); }
   size_t  alive_words()                  { return _mem_to_cpu_gc->_marked_alive_bytes; }  // abandoned ?
   
-  void    set_alive_ratio(double ratio)  {  _mem_to_cpu_gc->_alive_ratio = ratio;  }
+  void    set_alive_ratio(double ratio)  { uint32_t v = _mem_to_cpu_gc->begin_update(); _mem_to_cpu_gc->_alive_ratio = ratio; _mem_to_cpu_gc->end_update(v); publish_liveness(); }
   double  alive_ratio()                  { return _mem_to_cpu_gc->_alive_ratio;  }  
 
 
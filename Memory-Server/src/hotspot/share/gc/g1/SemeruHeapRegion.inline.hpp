@@ -34,6 +34,7 @@
 #include "runtime/atomic.hpp"
 #include "runtime/prefetch.inline.hpp"
 #include "utilities/align.hpp"
+#include "utilities/quickSort.hpp"
 
 
 // Semeru
@@ -244,6 +245,7 @@ inline void SemeruHeapRegion::complete_compaction() {
 	// treat all objects as being inside the unmarked area.
 	zero_marked_bytes();
 	init_top_at_mark_start();
+	invalidate_traced_liveness();
 
 	// Clear unused heap memory in debug builds.
 	if (ZapUnusedHeapArea) {
@@ -271,29 +273,24 @@ inline void SemeruHeapRegion::complete_compaction() {
  * 		=> This function will be inlined the caller.
  * 			 So the <typename ApplyToMarkedClosure> will be asigned the parameter, closure, 's class type.
  */
+template<typename ApplyToMarkedClosure>
+class SemeruPrefetchApplyClosure : public StackObj {
+	ApplyToMarkedClosure* _closure;
+public:
+	SemeruPrefetchApplyClosure(ApplyToMarkedClosure* closure) : _closure(closure) { }
+	size_t apply(oop obj) {
+		Prefetch::write((HeapWord*)obj, PrefetchScanIntervalInBytes);
+		return _closure->apply(obj);
+	}
+};
+
 template<typename ApplyToMarkedClosure>
 inline void SemeruHeapRegion::apply_to_marked_objects(G1CMBitMap* bitmap, ApplyToMarkedClosure* closure) {
 	HeapWord* limit = scan_limit();		// current Region top
-	HeapWord* next_addr = bottom();		// from Region start
 
-	while (next_addr < limit) {
-		
-		// disable prefetch for safe. Cause memory error Bug#8 ?
-		// After disable the prefetch, Bug#8 can also be triggered. 
-		Prefetch::write(next_addr, PrefetchScanIntervalInBytes);  
-		
-		// This explicit is_marked check is a way to avoid
-		// some extra work done by get_next_marked_addr for
-		// the case where next_addr is marked.
-		if (bitmap->is_marked(next_addr)) {  // oop is marked, means this object is alive during the tracing ?
-			oop current = oop(next_addr);
-			next_addr += closure->apply(current);		// the apply() function is defiend by the parameter, closure.
-		} else {
-			next_addr = bitmap->get_next_marked_addr(next_addr, limit);  // next alive objects. 
-		}
-	}
-
-	assert(next_addr == limit, "Should stop the scan at the limit.");
+	// The bitmap is scanned by words, see G1CMBitMap::iterate_marked_objects().
+	SemeruPrefetchApplyClosure<ApplyToMarkedClosure> prefetch_apply(closure);
+	bitmap->iterate_marked_objects(bottom(), limit, &prefetch_apply);
 }
 
 
@@ -337,6 +334,74 @@ inline void SemeruHeapRegion::semeru_apply_to_marked_objects(G1CMBitMap* bitmap,
 }
 
 
+/**
+ * Semeru MS - The ranges are scanned in address order.
+ *  *next_addr is the end of the last scanned object, the marks covered by it are skipped as above.
+ */
+template<typename ApplyToMarkedClosure>
+inline bool SemeruHeapRegion::semeru_apply_to_marked_range(G1CMBitMap* bitmap, ApplyToMarkedClosure* closure,
+                                                           HeapWord* start, HeapWord* end, HeapWord** next_addr) {
+	HeapWord* limit = MIN2(end, scan_limit());
+	HeapWord* addr  = MAX2(start, *next_addr);
+
+	while (addr < limit) {
+		addr = bitmap->get_next_marked_addr(addr, limit);
+		if (addr >= limit) {
+			break;
+		}
+
+		size_t obj_size = closure->apply(oop(addr));
+		if (obj_size == 0) {
+			// Trigerred Bug#8, concurrent tracing failed.
+			this->scan_failure = true;
+			return false;
+		}
+		addr += obj_size;
+	}
+
+	*next_addr = MAX2(*next_addr, addr);
+	return true;
+}
+
+static inline int compare_root_words(uint a, uint b) {
+	return a < b ? -1 : (a > b ? 1 : 0);
+}
+
+/**
+ * Semeru MS - Scan the roots written by the CPU server, the marked objects of _target_oop_bitmap.
+ *  1) A sparse BitQueue lists its non-zero words, sort them into address order.
+ *  2) Otherwise, only the bitmap pages set in the summary can have marks.
+ *  The scan is proportional to the roots, instead of the Region size.
+ */
+template<typename ApplyToMarkedClosure>
+inline void SemeruHeapRegion::semeru_apply_to_root_objects(ApplyToMarkedClosure* closure) {
+	BitQueue*   roots     = _sync_mem_cpu->_cross_region_ref_target_queue;
+	G1CMBitMap* bitmap    = &_target_oop_bitmap;
+	HeapWord*   next_addr = bottom();
+
+	if (roots->is_sparse()) {
+		QuickSort::sort(roots->_words, (size_t)roots->_num_words, compare_root_words, false);
+		for (uint i = 0; i < roots->_num_words; i++) {
+			HeapWord* start = bottom() + (size_t)roots->_words[i] * BitsPerWord;
+			if (!semeru_apply_to_marked_range(bitmap, closure, start, start + BitsPerWord, &next_addr)) {
+				return;
+			}
+		}
+	} else {
+		const size_t page_heap_words = BitQueue::WordsPerPage * BitsPerWord;
+		for (size_t p = 0; p < roots->num_pages(); p++) {
+			if (!roots->is_page_dirty(p)) {
+				continue;
+			}
+			HeapWord* start = bottom() + p * page_heap_words;
+			if (!semeru_apply_to_marked_range(bitmap, closure, start, start + page_heap_words, &next_addr)) {
+				return;
+			}
+		}
+	}
+}
+
+
 
 
 inline HeapWord* SemeruHeapRegion::par_allocate_no_bot_updates(size_t min_word_size,
@@ -30,6 +30,7 @@
 //#include "gc/g1/heapRegionSet.inline.hpp"
 #include "gc/g1/heterogeneousHeapRegionManager.hpp"   // useless ?
 #include "gc/shared/collectorPolicy.hpp"
+#include "gc/shared/rdmaMetaLayout.hpp"
 #include "memory/allocation.hpp"
 #include "utilities/bitMap.inline.hpp"
 
@@ -370,7 +371,7 @@ uint SemeruHeapRegionManager::expand_at(uint start, uint num_regions, WorkGang*
 	// 3) Padding for the unused Cross Region reference update queue
 	//		The BitQueue is defined in rdmaStructure.hpp as : CHeapRDMAObj<size_t, ALLOC_TARGET_OBJ_QUEUE_ALLOCTYPE>
 	start_addr_to_padding	=	CHeapRDMAObj<size_t, ALLOC_TARGET_OBJ_QUEUE_ALLOCTYPE>::_alloc_ptr ;
-	size_to_be_padded	=	(size_t)(SEMERU_START_ADDR + CROSS_REGION_REF_TARGET_Q_OFFSET + CROSS_REGION_REF_TARGET_Q_SIZE_LIMIT) -	(size_t)start_addr_to_padding;
+	size_to_be_padded	=	(size_t)(SEMERU_START_ADDR + SemeruMetaLayout::cross_region_ref_target_q_offset() + SemeruMetaLayout::cross_region_ref_target_q_size()) -	(size_t)start_addr_to_padding;
 	if(size_to_be_padded> 0){
 		G1SemeruCollectedHeap::heap()->_debug_rdma_padding_cross_region_ref_update_queue = new(size_to_be_padded, start_addr_to_padding) rdma_padding();
 		tty->print("WARNING in %s, padding data in Meta Region[0x%lx,0x%lx) for cross_region_ref_update_queue. \n",__func__,
@@ -105,6 +105,11 @@ public:
 
   void clear_region(SemeruHeapRegion* hr);
 
+  // Apply cl->apply(oop) to the marked objects of [start, limit) in address order.
+  // apply() returns the object size, the marks it covers are skipped. Return false if it returned 0.
+  template<typename ApplyToMarkedClosure>
+  inline bool iterate_marked_objects(HeapWord* start, HeapWord* limit, ApplyToMarkedClosure* cl);
+
 };
 
 #endif // SHARE_VM_GC_G1_G1CONCURRENTMARKBITMAP_HPP
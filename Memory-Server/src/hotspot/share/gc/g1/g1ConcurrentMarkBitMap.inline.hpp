@@ -30,6 +30,7 @@
 #include "memory/memRegion.hpp"
 #include "utilities/align.hpp"
 #include "utilities/bitMap.inline.hpp"
+#include "utilities/count_trailing_zeros.hpp"
 
 inline bool G1CMBitMap::iterate(G1CMBitMapClosure* cl, MemRegion mr) {
   assert(!mr.is_empty(), "Does not support empty memregion to iterate over");
@@ -51,4 +52,54 @@ inline bool G1CMBitMap::iterate(G1CMBitMapClosure* cl, MemRegion mr) {
   return true;
 }
 
+/**
+ * Semeru MS - Scan the bitmap by whole words, instead of one get_next_marked_addr() search per object.
+ *  1) The empty words are skipped 4 at a time, 256 bits. The OR of the 4 words is vectorized by the compiler.
+ *  2) The marks of a word are taken by count_trailing_zeros(), each one cleared from the local copy.
+ *  3) The marks before the end of the last object are masked off, the scan resumes at the word of its end.
+ * A dense Region, e.g. the phase#1 of a compaction, reads each bitmap word once.
+ */
+template<typename ApplyToMarkedClosure>
+inline bool G1CMBitMap::iterate_marked_objects(HeapWord* start, HeapWord* limit, ApplyToMarkedClosure* cl) {
+  const BitMap::bm_word_t* map = _bm.words();
+  BitMap::idx_t const end  = addr_to_offset(limit);
+  BitMap::idx_t const end_word = (end + BitsPerWord - 1) >> LogBitsPerWord;
+  BitMap::idx_t next = addr_to_offset(start);    // the first bit not covered by the applied objects
+  BitMap::idx_t w    = next >> LogBitsPerWord;
+
+  while (w < end_word) {
+    if (w + 4 <= end_word && (map[w] | map[w + 1] | map[w + 2] | map[w + 3]) == 0) {
+      w += 4;
+      continue;
+    }
+
+    BitMap::idx_t const base = w << LogBitsPerWord;
+    BitMap::bm_word_t bits = map[w];
+    if (next > base) {
+      bits &= ~(((BitMap::bm_word_t)1 << (next - base)) - 1);
+    }
+
+    while (bits != 0) {
+      BitMap::idx_t const offset = base + count_trailing_zeros(bits);
+      if (offset >= end) {
+        return true;
+      }
+
+      size_t const obj_size = cl->apply(oop(offset_to_addr(offset)));
+      if (obj_size == 0) {
+        return false;
+      }
+
+      next = offset + (obj_size >> _shifter);
+      if (next >= base + BitsPerWord) {
+        break;
+      }
+      bits &= ~(((BitMap::bm_word_t)1 << (next - base)) - 1);
+    }
+
+    w = MAX2(w + 1, next >> LogBitsPerWord);
+  }
+  return true;
+}
+
 #endif // SHARE_VM_GC_G1_G1CONCURRENTMARKBITMAP_INLINE_HPP
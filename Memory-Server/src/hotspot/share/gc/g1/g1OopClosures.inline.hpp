@@ -42,6 +42,7 @@
 
 // Semeru
 #include "gc/g1/g1SemeruCollectedHeap.hpp"
+#include "gc/g1/g1SemeruCompressedOops.inline.hpp"
 #include "gc/g1/g1SemeruConcurrentMark.inline.hpp"
 
 
@@ -173,7 +174,7 @@ void G1SemeruCMOopClosure::verify(T* p) {
 	if (should_verify_oops()) {
 		T heap_oop = RawAccess<>::oop_load(p);
 		if (!CompressedOops::is_null(heap_oop)) {
-			oop o = CompressedOops::decode_not_null(heap_oop);
+			oop o = SemeruCompressedOops::decode_not_null(heap_oop);
 			assert(Universe::semeru_heap()->semeru_is_in_closed_subset(o),
 						 "should be in closed *p " PTR_FORMAT " " PTR_FORMAT, p2i(p), p2i(o));
 		}
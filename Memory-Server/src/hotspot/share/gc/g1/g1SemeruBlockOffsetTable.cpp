@@ -433,6 +433,16 @@ HeapWord* G1SemeruBlockOffsetTablePart::initialize_threshold() {
   return _next_offset_threshold;
 }
 
+HeapWord* G1SemeruBlockOffsetTablePart::initialize_threshold_at(HeapWord* addr, size_t* index) const {
+  assert(addr >= _space->bottom() && addr <= _space->end(), "addr 0x%lx is out of the Region", (size_t)addr);
+  size_t i = _bot->index_for_raw(addr);
+  if (_bot->address_for_index_raw(i) < addr) {
+    i++;
+  }
+  *index = i;
+  return _bot->address_for_index_raw(i);
+}
+
 void G1SemeruBlockOffsetTablePart::set_for_starts_humongous(HeapWord* obj_top, size_t fill_size) {
   // The first BOT entry should have offset 0.
   reset_bot();
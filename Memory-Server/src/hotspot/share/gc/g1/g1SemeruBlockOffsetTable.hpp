@@ -27,6 +27,7 @@
 
 #include "gc/g1/g1RegionToSpaceMapper.hpp"
 #include "gc/shared/blockOffsetTable.hpp"
+#include "gc/shared/rdmaMetaLayout.hpp"
 #include "memory/memRegion.hpp"
 #include "memory/virtualspace.hpp"
 #include "utilities/globalDefinitions.hpp"
@@ -90,7 +91,7 @@ public:
   static size_t compute_size(size_t mem_region_words) {
     size_t number_of_slots = (mem_region_words / BOTConstants::N_words);   // number of slots/blocks:  e.g. 32GB heap.  4G words/(64 word per block)
     size_t block_off_table_bytes = ReservedSpace::allocation_align_size_up(number_of_slots); // page alignment.
-    assert(block_off_table_bytes <= BLOCK_OFFSET_TABLE_OFFSET_SIZE_LIMIT, "Exceed size limitations.");
+    assert(block_off_table_bytes <= SemeruMetaLayout::block_offset_table_size(), "Exceed size limitations.");
 
     return block_off_table_bytes;       // 1 byte,u_char, per slot.
   }
@@ -258,6 +259,19 @@ public:
   // Semeru
   void  initialize_array_offset_par(G1SemeruBlockOffsetTable* array, SemeruHeapRegion* coverd_region);
   void reset_fields_after_transfer(SemeruHeapRegion* covered_region);
+
+  // Semeru MS - the chunks of a Region are compacted in parallel, disjoint destination ranges.
+  // Each chunk updates the table with its own threshold, starting from the first boundary at or above addr.
+  HeapWord* initialize_threshold_at(HeapWord* addr, size_t* index) const;
+  void alloc_block_at(HeapWord** threshold, size_t* index, HeapWord* blk_start, HeapWord* blk_end) {
+    if (blk_end > *threshold) {
+      alloc_block_work(threshold, index, blk_start, blk_end);
+    }
+  }
+  void set_threshold(HeapWord* threshold, size_t index) {
+    _next_offset_threshold = threshold;
+    _next_offset_index     = index;
+  }
 };
 
 #endif // SHARE_VM_GC_G1_G1BLOCKOFFSETTABLE_HPP
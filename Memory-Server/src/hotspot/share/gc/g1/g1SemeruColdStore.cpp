@@ -0,0 +1,405 @@
+/**
+ * Semeru Memory Server - compress the cold Regions handed over by the CPU server, -XX:+SemeruColdStore.
+ * Spill the coldest ones to a local NVMe, -XX:SemeruColdSpillDir.
+ *
+ */
+
+#include "precompiled.hpp"
+#include "gc/g1/g1SemeruColdStore.hpp"
+#include "gc/g1/g1SemeruCollectedHeap.inline.hpp"
+#include "gc/g1/SemeruHeapRegion.inline.hpp"
+#include "gc/shared/gc_globals.hpp"
+#include "include/jvm.h"
+#include "logging/log.hpp"
+#include "runtime/atomic.hpp"
+#include "runtime/orderAccess.hpp"
+#include "runtime/os.hpp"
+#include "runtime/rdma_comm.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+G1SemeruColdStore::lz4_compress_fn   G1SemeruColdStore::_compress = NULL;
+G1SemeruColdStore::lz4_decompress_fn G1SemeruColdStore::_decompress = NULL;
+
+volatile uint8_t* G1SemeruColdStore::_states = NULL;
+char**            G1SemeruColdStore::_data = NULL;
+uint32_t*         G1SemeruColdStore::_len = NULL;
+size_t            G1SemeruColdStore::_num_blocks = 0;
+
+uint*             G1SemeruColdStore::_cold_cycles = NULL;
+bool*             G1SemeruColdStore::_compacted = NULL;
+
+char*             G1SemeruColdStore::_buf = NULL;
+int               G1SemeruColdStore::_buf_size = 0;
+pthread_mutex_t   G1SemeruColdStore::_lock = PTHREAD_MUTEX_INITIALIZER;
+
+int               G1SemeruColdStore::_spill_fd = -1;
+
+volatile size_t   G1SemeruColdStore::_num_compressed = 0;
+size_t            G1SemeruColdStore::_compressed_bytes = 0;
+size_t            G1SemeruColdStore::_num_spilled = 0;
+size_t            G1SemeruColdStore::_spilled_bytes = 0;
+
+void G1SemeruColdStore::initialize() {
+  if (!SemeruColdStore || is_enabled()) {
+    return;
+  }
+
+  if (SemeruMemPoolCXL) {
+    log_warning(semeru, mem_compact)("%s, the CPU server copies the CXL window by itself, -XX:+SemeruColdStore is ignored.", __func__);
+    return;
+  }
+  if (SemeruHeapRegion::SemeruGrainBytes % SEMERU_COLD_BLOCK_SIZE != 0) {
+    log_warning(semeru, mem_compact)("%s, the Region size 0x%lx isn't a multiple of the cold blocks, -XX:+SemeruColdStore is ignored.",
+                                     __func__, SemeruHeapRegion::SemeruGrainBytes);
+    return;
+  }
+
+  char ebuf[1024];
+  void* lib = os::dll_load("liblz4.so.1", ebuf, sizeof(ebuf));
+  if (lib == NULL) {
+    log_warning(semeru, mem_compact)("%s, can't load liblz4.so.1, %s. -XX:+SemeruColdStore is ignored.", __func__, ebuf);
+    return;
+  }
+  _compress = CAST_TO_FN_PTR(lz4_compress_fn, os::dll_lookup(lib, "LZ4_compress_default"));
+  _decompress = CAST_TO_FN_PTR(lz4_decompress_fn, os::dll_lookup(lib, "LZ4_decompress_safe"));
+  lz4_bound_fn bound = CAST_TO_FN_PTR(lz4_bound_fn, os::dll_lookup(lib, "LZ4_compressBound"));
+  if (_compress == NULL || _decompress == NULL || bound == NULL) {
+    log_warning(semeru, mem_compact)("%s, liblz4.so.1 misses the block API. -XX:+SemeruColdStore is ignored.", __func__);
+    return;
+  }
+
+  _num_blocks = (RDMA_DATA_REGION_NUM * REGION_SIZE_GB * ONE_GB) >> SEMERU_COLD_BLOCK_SHIFT;
+  _data = NEW_C_HEAP_ARRAY(char*, _num_blocks, mtGC);
+  memset(_data, 0, _num_blocks * sizeof(char*));
+  _len = NEW_C_HEAP_ARRAY(uint32_t, _num_blocks, mtGC);
+  memset(_len, 0, _num_blocks * sizeof(uint32_t));
+
+  _cold_cycles = NEW_C_HEAP_ARRAY(uint, SEMERU_MAX_REGIONS, mtGC);
+  memset(_cold_cycles, 0, SEMERU_MAX_REGIONS * sizeof(uint));
+  _compacted = NEW_C_HEAP_ARRAY(bool, SEMERU_MAX_REGIONS, mtGC);
+  memset(_compacted, 0, SEMERU_MAX_REGIONS * sizeof(bool));
+
+  _buf_size = bound((int)SEMERU_COLD_BLOCK_SIZE);
+  _buf = NEW_C_HEAP_ARRAY(char, _buf_size, mtGC);
+
+  if (SemeruColdSpillDir != NULL) {
+    initialize_spill();
+  }
+
+  uint8_t* states = NEW_C_HEAP_ARRAY(uint8_t, _num_blocks, mtGC);
+  memset(states, Hot, _num_blocks);
+  OrderAccess::storestore();   // the cq poller may check is_enabled() meanwhile.
+  _states = states;
+
+  log_info(semeru, mem_compact)("%s, the Regions cold for %u rounds are compressed, 0x%lx blocks of 0x%lx bytes",
+                                __func__, SemeruColdRegionCycles, _num_blocks, SEMERU_COLD_BLOCK_SIZE);
+}
+
+/**
+ * A sparse file as large as the data space, the block at its own offset. No allocation of the slots.
+ * Unlinked once opened, it goes away with the memory server process.
+ */
+void G1SemeruColdStore::initialize_spill() {
+  char path[JVM_MAXPATHLEN];
+  jio_snprintf(path, sizeof(path), "%s/semeru_cold_blocks_XXXXXX", SemeruColdSpillDir);
+
+  int fd = mkstemp(path);
+  if (fd < 0) {
+    log_warning(semeru, mem_compact)("%s, can't create the spill file in %s, %s. The cold blocks stay in the DRAM.",
+                                     __func__, SemeruColdSpillDir, os::strerror(errno));
+    return;
+  }
+  unlink(path);
+
+  if (ftruncate(fd, (off_t)(_num_blocks << SEMERU_COLD_BLOCK_SHIFT)) != 0) {
+    log_warning(semeru, mem_compact)("%s, can't resize the spill file, %s. The cold blocks stay in the DRAM.",
+                                     __func__, os::strerror(errno));
+    close(fd);
+    return;
+  }
+
+  _spill_fd = fd;
+  log_info(semeru, mem_compact)("%s, the Regions cold for %u rounds are spilled to %s",
+                                __func__, SemeruColdSpillCycles, SemeruColdSpillDir);
+}
+
+bool G1SemeruColdStore::spill_io(bool write, char* buf, size_t len, off_t offset) {
+  while (len > 0) {
+    ssize_t n = write ? pwrite(_spill_fd, buf, len, offset) : pread(_spill_fd, buf, len, offset);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return false;
+    }
+    buf += n;
+    len -= n;
+    offset += n;
+  }
+  return true;
+}
+
+bool G1SemeruColdStore::block_of(const void* addr, size_t* block) {
+  if ((size_t)addr < RDMA_DATA_SPACE_START_ADDR || !G1SemeruCollectedHeap::heap()->is_in_g1_reserved(addr)) {
+    return false;
+  }
+  *block = ((size_t)addr - RDMA_DATA_SPACE_START_ADDR) >> SEMERU_COLD_BLOCK_SHIFT;
+  return *block < _num_blocks;
+}
+
+uint G1SemeruColdStore::region_of_block(size_t block) {
+  return G1SemeruCollectedHeap::heap()->addr_to_region((HeapWord*)block_addr(block));
+}
+
+/**
+ * Compress a Cold block into the C heap and give its pages back.
+ * False if it isn't worth it, the block stays in the DRAM.
+ */
+bool G1SemeruColdStore::compress_block(size_t block) {
+  char* addr = block_addr(block);
+  int len = _compress(addr, _buf, (int)SEMERU_COLD_BLOCK_SIZE, _buf_size);
+  if (len <= 0 || (size_t)len > SEMERU_COLD_BLOCK_SIZE / 4 * 3) {
+    return false;
+  }
+
+  char* data = NEW_C_HEAP_ARRAY_RETURN_NULL(char, len, mtGC);
+  if (data == NULL) {
+    return false;
+  }
+  memcpy(data, _buf, len);
+  if (!semeru_discard_memory(addr, SEMERU_COLD_BLOCK_SIZE)) {
+    log_debug(semeru, mem_compact)("%s, discard the block at 0x%lx failed, %s", __func__, (size_t)addr, os::strerror(errno));
+    FREE_C_HEAP_ARRAY(char, data);
+    return false;
+  }
+
+  _data[block] = data;
+  _len[block] = (uint32_t)len;
+  _compressed_bytes += len;
+  Atomic::inc(&_num_compressed);
+  _states[block] = Compressed;
+  return true;
+}
+
+// The content of a compressed block is lost without it, no way back.
+void G1SemeruColdStore::decompress_block(size_t block, BlockState to) {
+  char* addr = block_addr(block);
+  int len = _decompress(_data[block], addr, (int)_len[block], (int)SEMERU_COLD_BLOCK_SIZE);
+  guarantee(len == (int)SEMERU_COLD_BLOCK_SIZE, "%s, the compressed block at 0x%lx is corrupted, %d bytes decompressed",
+            __func__, (size_t)addr, len);
+
+  FREE_C_HEAP_ARRAY(char, _data[block]);
+  _compressed_bytes -= _len[block];
+  _data[block] = NULL;
+  _len[block] = 0;
+  Atomic::dec(&_num_compressed);
+  OrderAccess::storestore();   // the content before the state, restore() checks the state without the lock.
+  _states[block] = to;
+}
+
+/**
+ * Write a Compressed or Incompressible block to the spill file and drop its DRAM copy.
+ * The file pages are written back and dropped too, or the page cache would keep the DRAM.
+ */
+bool G1SemeruColdStore::spill_block(size_t block) {
+  bool raw = _states[block] == Incompressible;
+  char* src = raw ? block_addr(block) : _data[block];
+  size_t len = raw ? SEMERU_COLD_BLOCK_SIZE : _len[block];
+  off_t offset = (off_t)(block << SEMERU_COLD_BLOCK_SHIFT);
+
+  if (!spill_io(true, src, len, offset) ||
+      sync_file_range(_spill_fd, offset, (off_t)len,
+                      SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER) != 0) {
+    log_debug(semeru, mem_compact)("%s, spill the block at 0x%lx failed, %s", __func__, (size_t)block_addr(block), os::strerror(errno));
+    return false;
+  }
+  posix_fadvise(_spill_fd, offset, (off_t)len, POSIX_FADV_DONTNEED);
+
+  if (raw) {
+    if (!semeru_discard_memory(src, SEMERU_COLD_BLOCK_SIZE)) {
+      return false;
+    }
+    _len[block] = (uint32_t)SEMERU_COLD_BLOCK_SIZE;
+  } else {
+    FREE_C_HEAP_ARRAY(char, _data[block]);
+    _data[block] = NULL;
+    _compressed_bytes -= len;
+    Atomic::dec(&_num_compressed);
+  }
+  _num_spilled++;
+  _spilled_bytes += len;
+  _states[block] = Spilled;
+  return true;
+}
+
+// The content of a spilled block is lost without it, no way back.
+void G1SemeruColdStore::unspill_block(size_t block, BlockState to) {
+  char* addr = block_addr(block);
+  size_t len = _len[block];
+  off_t offset = (off_t)(block << SEMERU_COLD_BLOCK_SHIFT);
+
+  if (len == SEMERU_COLD_BLOCK_SIZE) {
+    guarantee(spill_io(false, addr, len, offset), "%s, read the spilled block at 0x%lx failed, %s",
+              __func__, (size_t)addr, os::strerror(errno));
+  } else {
+    char* data = NEW_C_HEAP_ARRAY(char, len, mtGC);
+    guarantee(spill_io(false, data, len, offset), "%s, read the spilled block at 0x%lx failed, %s",
+              __func__, (size_t)addr, os::strerror(errno));
+    int n = _decompress(data, addr, (int)len, (int)SEMERU_COLD_BLOCK_SIZE);
+    guarantee(n == (int)SEMERU_COLD_BLOCK_SIZE, "%s, the spilled block at 0x%lx is corrupted, %d bytes decompressed",
+              __func__, (size_t)addr, n);
+    FREE_C_HEAP_ARRAY(char, data);
+  }
+  fallocate(_spill_fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, offset, (off_t)len);
+
+  _num_spilled--;
+  _spilled_bytes -= len;
+  _len[block] = 0;
+  OrderAccess::storestore();   // the content before the state, restore() checks the state without the lock.
+  _states[block] = to;
+}
+
+/**
+ * Bring the block back into the DRAM.
+ * Only FETCH_BLOCK, to Hot, takes back a block still in the DRAM.
+ */
+void G1SemeruColdStore::load_block(size_t block, BlockState to) {
+  if (_states[block] == Compressed) {
+    decompress_block(block, to);
+  } else if (_states[block] == Spilled) {
+    unspill_block(block, to);
+  } else if (to == Hot) {
+    _states[block] = Hot;
+  }
+}
+
+void G1SemeruColdStore::hand_over(const void* block_start) {
+  size_t block;
+  if (!is_enabled() || !block_of(block_start, &block)) {
+    return;
+  }
+
+  pthread_mutex_lock(&_lock);
+  if (_states[block] == Hot) {
+    _states[block] = Cold;
+  }
+  pthread_mutex_unlock(&_lock);
+}
+
+void G1SemeruColdStore::fetch(const void* block_start) {
+  size_t block;
+  if (!is_enabled() || !block_of(block_start, &block)) {
+    return;
+  }
+
+  pthread_mutex_lock(&_lock);
+  if (_states[block] == Compressed || _states[block] == Spilled) {
+    log_debug(semeru, mem_compact)("%s, block at 0x%lx %s for the CPU server", __func__, (size_t)block_start,
+                                   _states[block] == Spilled ? "read back" : "decompressed");
+  }
+  load_block(block, Hot);
+  _cold_cycles[region_of_block(block)] = 0;
+  pthread_mutex_unlock(&_lock);
+}
+
+void G1SemeruColdStore::note_compacted(SemeruHeapRegion* hr) {
+  if (is_enabled()) {
+    _compacted[hr->hrm_index()] = true;
+  }
+}
+
+void G1SemeruColdStore::restore(const void* start, const void* end) {
+  size_t first, last;
+  if (!is_enabled() || start >= end || !block_of(start, &first) || !block_of((char*)end - 1, &last)) {
+    return;
+  }
+
+  for (size_t block = first; block <= last; block++) {
+    if (_states[block] == Hot) {
+      continue;
+    }
+    pthread_mutex_lock(&_lock);
+    load_block(block, Cold);
+    _cold_cycles[region_of_block(block)] = 0;
+    pthread_mutex_unlock(&_lock);
+  }
+  OrderAccess::loadload();
+}
+
+void G1SemeruColdStore::restore_region(SemeruHeapRegion* hr) {
+  restore(hr->bottom(), hr->end());
+}
+
+/**
+ * Count the cold rounds of each Region. Compress the Regions cold for SemeruColdRegionCycles rounds,
+ * and spill the ones cold for SemeruColdSpillCycles rounds.
+ * The CPU server may fetch a block back meanwhile, the lock is held per block.
+ */
+void G1SemeruColdStore::compress_cold_regions() {
+  if (!is_enabled()) {
+    return;
+  }
+  if (!semeru_mem_pool_odp()) {
+    static bool warned = false;
+    if (!warned) {
+      log_warning(semeru, mem_compact)("%s, the memory pool is pinned, the cold blocks stay uncompressed.", __func__);
+      warned = true;
+    }
+    return;
+  }
+
+  G1SemeruCollectedHeap* semeru_heap = G1SemeruCollectedHeap::heap();
+  size_t blocks_per_region = SemeruHeapRegion::SemeruGrainBytes >> SEMERU_COLD_BLOCK_SHIFT;
+  size_t compressed = 0;
+  size_t incompressible = 0;
+  size_t spilled = 0;
+  double start = os::elapsedTime();
+
+  for (uint i = 0; i < semeru_heap->max_regions(); i++) {
+    SemeruHeapRegion* hr = semeru_heap->region_at_or_null(i);
+    size_t first;
+    if (hr == NULL || !block_of(hr->bottom(), &first) || first + blocks_per_region > _num_blocks) {
+      continue;
+    }
+
+    pthread_mutex_lock(&_lock);
+    bool cold = _compacted[i];
+    for (size_t block = first; cold && block < first + blocks_per_region; block++) {
+      cold = _states[block] != Hot;
+    }
+    _cold_cycles[i] = cold ? _cold_cycles[i] + 1 : 0;
+    uint cycles = _cold_cycles[i];
+    pthread_mutex_unlock(&_lock);
+
+    if (cycles < SemeruColdRegionCycles) {
+      continue;
+    }
+
+    bool spill = _spill_fd >= 0 && cycles >= SemeruColdSpillCycles;
+    for (size_t block = first; block < first + blocks_per_region; block++) {
+      pthread_mutex_lock(&_lock);
+      if (_states[block] == Cold && _cold_cycles[i] >= SemeruColdRegionCycles) {
+        if (compress_block(block)) {
+          compressed++;
+        } else {
+          _states[block] = Incompressible;
+          incompressible++;
+        }
+      }
+      if (spill && (_states[block] == Compressed || _states[block] == Incompressible) &&
+          _cold_cycles[i] >= SemeruColdSpillCycles && spill_block(block)) {
+        spilled++;
+      }
+      pthread_mutex_unlock(&_lock);
+    }
+  }
+
+  if (compressed + incompressible + spilled > 0) {
+    log_info(semeru, mem_compact)("%s, 0x%lx blocks compressed, 0x%lx incompressible, 0x%lx spilled. "
+                                  "0x%lx blocks held in 0x%lx bytes, 0x%lx blocks in 0x%lx bytes of the spill file, %.3f ms.",
+                                  __func__, compressed, incompressible, spilled, (size_t)_num_compressed, _compressed_bytes,
+                                  _num_spilled, _spilled_bytes, (os::elapsedTime() - start) * 1000.0);
+  }
+}
@@ -0,0 +1,119 @@
+/**
+ * Semeru Memory Server - compress the cold Regions handed over by the CPU server, -XX:+SemeruColdStore.
+ * Spill the coldest ones to a local NVMe, -XX:SemeruColdSpillDir.
+ *
+ */
+
+#ifndef SHARE_GC_G1_G1_SEMERU_COLD_STORE_HPP
+#define SHARE_GC_G1_G1_SEMERU_COLD_STORE_HPP
+
+#include "memory/allocation.hpp"
+#include "utilities/globalDefinitions.hpp"
+
+#include <pthread.h>
+
+class SemeruHeapRegion;
+
+/**
+ * Semeru MS - The archival data swapped out by the CPU server is rarely read again,
+ * but its pages stay uncompressed in the DRAM of the memory pool.
+ *
+ * The CPU server kernel hands a SEMERU_COLD_BLOCK_SIZE block over by COLD_BLOCKS after it wasn't
+ * swapped in or out for a report interval, and fetches it back by FETCH_BLOCK before its next RDMA access,
+ * see semeru/frontswap_cold.c. Between the two, the block is owned by this server.
+ *
+ *   Hot --COLD_BLOCKS--> Cold --compress_cold_regions()--> Compressed
+ *    ^                    |  ^                                |
+ *    +----FETCH_BLOCK-----+  +--------restore(), our GC-------+
+ *    +----FETCH_BLOCK, decompressed first---------------------+
+ *                                                             | SemeruColdSpillCycles
+ *                                                             v
+ *                                     FETCH_BLOCK, restore() <-- Spilled
+ *
+ * 1) _cold_cycles counts the rounds of the concurrent service a Region had all its blocks handed over.
+ *    A Region compacted at least once by us and cold for SemeruColdRegionCycles rounds has its blocks
+ *    compressed by LZ4 into the C heap, and their physical pages are given back.
+ *    A block saving less than a quarter is left as it is, Incompressible.
+ * 2) FETCH_BLOCK decompresses the block in place before the DONE, the RDMA access of the CPU server waits for it.
+ * 3) Our tracing, compaction and card scan restore the blocks before reading them. They stay handed over,
+ *    but the Region counts its SemeruColdRegionCycles again.
+ * 4) -XX:SemeruColdSpillDir, the lower tier once the DRAM of the memory servers runs out.
+ *    After SemeruColdSpillCycles cold rounds, the Compressed and Incompressible blocks are written to
+ *    a sparse file on the local NVMe, at the offset of the block in the data space, and leave the DRAM.
+ *    FETCH_BLOCK and restore() read them back, the RDMA access of the CPU server waits for the disk.
+ *    Only the object data is spilled. The bitmaps, the BOT and the other Region metadata stay in the meta space.
+ *
+ * Only for the On-Demand-Paging memory pool, a pinned MR keeps the discarded pages for the HCA.
+ * LZ4 is loaded from liblz4.so.1, the tier stays off without it.
+ */
+class G1SemeruColdStore : public AllStatic {
+  enum BlockState {
+    Hot            = 0,
+    Cold           = 1,   // handed over by the CPU server
+    Compressed     = 2,
+    Incompressible = 3,   // handed over, tried once
+    Spilled        = 4    // in the spill file, _len bytes. Uncompressed if SEMERU_COLD_BLOCK_SIZE.
+  };
+
+  typedef int (*lz4_compress_fn)(const char* src, char* dst, int src_size, int dst_capacity);
+  typedef int (*lz4_decompress_fn)(const char* src, char* dst, int compressed_size, int dst_capacity);
+  typedef int (*lz4_bound_fn)(int input_size);
+
+  static lz4_compress_fn   _compress;
+  static lz4_decompress_fn _decompress;
+
+  // Per block of the data space.
+  static volatile uint8_t* _states;
+  static char**            _data;
+  static uint32_t*         _len;
+  static size_t            _num_blocks;
+
+  // Per Region.
+  static uint*             _cold_cycles;
+  static bool*             _compacted;
+
+  static char*             _buf;          // the compression output
+  static int               _buf_size;
+  static pthread_mutex_t   _lock;         // the cq poller isn't a JVM thread, no Mutex
+
+  static int               _spill_fd;     // -1 without SemeruColdSpillDir
+
+  static volatile size_t   _num_compressed;
+  static size_t            _compressed_bytes;
+  static size_t            _num_spilled;
+  static size_t            _spilled_bytes;
+
+  static bool   block_of(const void* addr, size_t* block);
+  static char*  block_addr(size_t block) { return (char*)(RDMA_DATA_SPACE_START_ADDR + (block << SEMERU_COLD_BLOCK_SHIFT)); }
+  static uint   region_of_block(size_t block);
+
+  static void initialize_spill();
+  static bool spill_io(bool write, char* buf, size_t len, off_t offset);
+
+  // Under _lock.
+  static bool compress_block(size_t block);
+  static void decompress_block(size_t block, BlockState to);
+  static bool spill_block(size_t block);
+  static void unspill_block(size_t block, BlockState to);
+  static void load_block(size_t block, BlockState to);
+
+public:
+  static void initialize();
+  static bool is_enabled() { return _states != NULL; }
+
+  // COLD_BLOCKS and FETCH_BLOCK of the CPU server, on the cq poller.
+  static void hand_over(const void* block_start);
+  static void fetch(const void* block_start);
+
+  // Our compaction finished the Region.
+  static void note_compacted(SemeruHeapRegion* hr);
+
+  // Our GC is going to access [start, end).
+  static void restore(const void* start, const void* end);
+  static void restore_region(SemeruHeapRegion* hr);
+
+  // The end of a round of the concurrent service, compress and spill the cold Regions.
+  static void compress_cold_regions();
+};
+
+#endif // SHARE_GC_G1_G1_SEMERU_COLD_STORE_HPP
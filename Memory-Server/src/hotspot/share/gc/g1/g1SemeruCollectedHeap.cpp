@@ -72,6 +72,8 @@
 #include "gc/shared/oopStorageParState.hpp"
 #include "gc/shared/parallelCleaning.hpp"
 #include "gc/shared/preservedMarks.inline.hpp"
+#include "gc/shared/rdmaMetaLayout.hpp"
+#include "gc/shared/rdmaWireCodec.hpp"
 #include "gc/shared/suspendibleThreadSet.hpp"
 #include "gc/shared/referenceProcessor.inline.hpp"
 #include "gc/shared/taskqueue.inline.hpp"
@@ -100,6 +102,10 @@
 #include "gc/g1/g1SemeruConcurrentMark.inline.hpp"
 #include "gc/g1/g1SemeruCollectedHeap.hpp"
 #include "gc/g1/g1SemeruConcurrentMarkThread.inline.hpp"
+#include "gc/g1/g1SemeruRemoteCardScanThread.hpp"
+#include "gc/g1/g1SemeruRemoteRefProcessor.hpp"
+#include "gc/g1/g1SemeruStringDedup.hpp"
+#include "gc/g1/g1SemeruCounters.hpp"
 #include "gc/g1/SemeruHeapRegion.inline.hpp"
 #include "gc/g1/SemeruHeapRegionSet.inline.hpp"
 
@@ -1617,6 +1623,10 @@ G1SemeruCollectedHeap::G1SemeruCollectedHeap(G1SemeruCollectorPolicy* collector_
  	_is_alive_closure_stw(this),
  	_is_subject_to_discovery_stw(this),
 	_ref_processor_cm(NULL),
+	_remote_ref_discoverer(NULL),
+	_string_dedup(NULL),
+	_remote_card_scan_thread(NULL),
+	_semeru_counters(NULL),
 	_is_alive_closure_cm(this),
  	_is_subject_to_discovery_cm(this),
 	_in_cset_fast_test() {
@@ -1886,6 +1896,10 @@ jint G1SemeruCollectedHeap::initialize_memory_pool() {
 	// Ensure that the sizes are properly aligned.
 	Universe::check_alignment(init_byte_size, SemeruHeapRegion::SemeruGrainBytes, "g1 Semeru heap");  // Region size alignment
 	Universe::check_alignment(max_byte_size, SemeruHeapRegion::SemeruGrainBytes, "g1 Semeru heap");
+
+	// The layout of the RDMA meta space.
+	// The RDMA thread registers it once the space is reserved, so compute it before the reservation.
+	SemeruMetaLayout::initialize(SemeruHeapRegion::SemeruGrainBytes, SemeruMemServerNum);
 	//Universe::check_alignment(max_byte_size, heap_alignment, "g1 Semeru heap");		// useless here.
 
 
@@ -1980,8 +1994,8 @@ jint G1SemeruCollectedHeap::initialize_memory_pool() {
 	//
 
 	// For the memory_server_cset, we need to allocate space && invoke construction, so it should be operator new().
-	// if _mem_server_cset->_num_regions != 0, means new data are sent to Semeru memory server
-	//	  the real data is stored in flexible array, _mem_server_cset->_region_cset[]
+	// a new sequence of this server's slot means a new CSet is sent to Semeru memory server
+	//	  the Regions are in the header slot and the overflow pages behind the header page.
 	// 2) Commit the space directly.
 	char * area_start;
 	size_t area_size;
@@ -2002,29 +2016,103 @@ jint G1SemeruCollectedHeap::initialize_memory_pool() {
 	area_size  = FLAGS_OF_CPU_WRITE_CHECK_SIZE_LIMIT;
 	_rdma_write_check_flags = new(area_size, area_start) flags_of_rdma_write_check(area_start, area_size, sizeof(uint32_t)); 
 
+	area_start = rdma_rs.base() + LIVENESS_EPOCH_OFFSET;
+	area_size  = LIVENESS_EPOCH_SIZE_LIMIT;
+	_liveness_epochs = new(area_size, area_start) region_liveness_epochs(area_start, area_size);
+
+	area_start = rdma_rs.base() + CLD_LIVENESS_OFFSET;
+	area_size  = CLD_LIVENESS_SIZE_LIMIT;
+	_cld_liveness = new(area_size, area_start) region_cld_liveness(area_start, area_size);
+
+	area_start = rdma_rs.base() + COMPACTED_REGION_RING_OFFSET;
+	area_size  = COMPACTED_REGION_RING_SIZE_LIMIT;
+	_compacted_region_ring = new(area_size, area_start) compacted_region_ring(SemeruMetaLayout::num_regions());
+
+	area_start = rdma_rs.base() + REGION_STATE_OFFSET;
+	area_size  = REGION_STATE_SIZE_LIMIT;
+	_region_states = new(area_size, area_start) region_state_words(area_start, area_size);
+
+	area_start = rdma_rs.base() + HEAP_HISTOGRAM_OFFSET;
+	area_size  = HEAP_HISTOGRAM_SIZE_LIMIT;
+	_heap_histogram = new(area_size, area_start) remote_heap_histogram();
+
+	area_start = rdma_rs.base() + LIVENESS_VECTOR_OFFSET;
+	area_size  = LIVENESS_VECTOR_SIZE_LIMIT;
+	_liveness_vector = new(area_size, area_start) region_liveness_vector(area_start, area_size);
+
+	area_start = rdma_rs.base() + REMOTE_CARD_SCAN_OFFSET;
+	area_size  = REMOTE_CARD_SCAN_SIZE_LIMIT;
+	_remote_card_scan = new(area_size, area_start) remote_card_scan();
+
+	area_start = rdma_rs.base() + REMOTE_REFINE_OFFSET;
+	area_size  = REMOTE_REFINE_SIZE_LIMIT;
+	_remote_refine = new(area_size, area_start) remote_card_scan();
+
+	area_start = rdma_rs.base() + REMSET_STASH_OFFSET;
+	area_size  = REMSET_STASH_SIZE_LIMIT;
+	_remset_stash = new(area_size, area_start) remote_rem_set_stash();
+
+	area_start = rdma_rs.base() + MARK_MESSAGE_OFFSET;
+	area_size  = MARK_MESSAGE_SIZE_LIMIT;
+	_mark_messages = new(area_size, area_start) mark_message_ring();
+
+	area_start = rdma_rs.base() + PAGE_AFFINITY_OFFSET;
+	area_size  = PAGE_AFFINITY_SIZE_LIMIT;
+	_page_affinity = new(area_size, area_start) page_affinity_table();
+
+	area_start = rdma_rs.base() + REMOTE_ARRAY_OP_OFFSET;
+	area_size  = REMOTE_ARRAY_OP_SIZE_LIMIT;
+	_remote_array_op = new(area_size, area_start) remote_array_op();
+
+	// The compressed writes of the CPU server, decoded at the CSet dispatch.
+	SemeruWireBuffer::initialize(SemeruMemServerNum);
+
+	// The chunks of the task queues of this memory server, a peer reads their directory.
+	area_start = (char*)task_queue_chunk_zone::at(SemeruMemServerID);
+	area_size  = SEMERU_TASK_QUEUE_CHUNK_ZONE_SIZE;
+	new(area_size, area_start) task_queue_chunk_zone();
+
 
 
 //	#ifdef ASSERT
 		log_debug(semeru, alloc)("%s, Meta data allocation Start\n", __func__);
 		log_debug(semeru, alloc)("	received_memory_server_cset 0x%lx, flexible array 0x%lx",  
-																							(size_t)_recv_mem_server_cset, (size_t)_recv_mem_server_cset->_region_cset  );
+																							(size_t)_recv_mem_server_cset, (size_t)_recv_mem_server_cset + MEMORY_SERVER_CSET_HEADER_SIZE  );
 		log_debug(semeru, alloc)("	flags_of_cpu_server_state  0x%lx, flexible array 0x%lx",  
 																							(size_t)_cpu_server_flags, (size_t)0 );
 		log_debug(semeru, alloc)("	flags_of_mem_server_state  0x%lx, flexible array 0x%lx",  
 																							(size_t)_mem_server_flags, (size_t)0 );
 		log_debug(semeru, alloc)("	flags_of_rdma_write_check  0x%lx, flexible array 0x%lx",  
 																							(size_t)_rdma_write_check_flags, (size_t)_rdma_write_check_flags->one_sided_rdma_write_check_flags_base );
+		log_debug(semeru, alloc)("	region_liveness_epochs  0x%lx, flexible array 0x%lx",  
+																							(size_t)_liveness_epochs, (size_t)_liveness_epochs->_epochs );
+		log_debug(semeru, alloc)("	region_cld_liveness  0x%lx, flexible array 0x%lx",  
+																							(size_t)_cld_liveness, (size_t)_cld_liveness->_bits );
+		log_debug(semeru, alloc)("	compacted_region_ring  0x%lx, flexible array 0x%lx, capacity 0x%lx",  
+																							(size_t)_compacted_region_ring, (size_t)_compacted_region_ring->_slots, _compacted_region_ring->_capacity );
+		log_debug(semeru, alloc)("	region_state_words  0x%lx, flexible array 0x%lx",  
+																							(size_t)_region_states, (size_t)_region_states->_words );
+		log_debug(semeru, alloc)("	remote_heap_histogram  0x%lx, flexible array 0x%lx",  
+																							(size_t)_heap_histogram, (size_t)_heap_histogram->_entries );
+		log_debug(semeru, alloc)("	region_liveness_vector  0x%lx, flexible array 0x%lx",  
+																							(size_t)_liveness_vector, (size_t)_liveness_vector->_entries );
+		log_debug(semeru, alloc)("	remote_card_scan  0x%lx, flexible array 0x%lx",  
+																							(size_t)_remote_card_scan, (size_t)_remote_card_scan->_slots );
+		log_debug(semeru, alloc)("	remote_card_scan(refine)  0x%lx, flexible array 0x%lx",  
+																							(size_t)_remote_refine, (size_t)_remote_refine->_slots );
+		log_debug(semeru, alloc)("	remote_rem_set_stash  0x%lx, flexible array 0x%lx",  
+																							(size_t)_remset_stash, (size_t)_remset_stash->_pages );
+		log_debug(semeru, alloc)("	mark_message_ring  0x%lx, flexible array 0x%lx",  
+																							(size_t)_mark_messages, (size_t)_mark_messages->_targets );
+		log_debug(semeru, alloc)("	page_affinity_table  0x%lx, flexible array 0x%lx",  
+																							(size_t)_page_affinity, (size_t)_page_affinity->_next );
+		log_debug(semeru, alloc)("	remote_array_op  0x%lx",  (size_t)_remote_array_op );
 		log_debug(semeru, alloc)("%s, Meta data allocation End \n", __func__);
 //	#endif
 
-	// Debug
-	// Padding the available sapce of Meta region
-	// 
-	// Do padding for the first GB meta data space. Until the start of alive_bitmap.
-	_debug_meta_region_padding		= new(RDMA_PADDING_SIZE_LIMIT, rdma_rs.base() + RDMA_PADDING_OFFSET) rdma_padding();
-	tty->print("%s, (Memory Server Only) WARNING, padding data in Meta Region[0x%lx, 0x%lx). \n",__func__,
-	 																																				(size_t)(rdma_rs.base() + RDMA_PADDING_OFFSET),
-	 																																				(size_t)(rdma_rs.base() + RDMA_PADDING_OFFSET + RDMA_PADDING_SIZE_LIMIT));
+	// No padding behind the used meta space, [SEMERU_START_ADDR + SemeruMetaLayout::used_size(), RDMA_STRUCTURE_SPACE_SIZE).
+	// Only the used part is registered as RDMA buffer.
+	SemeruMetaLayout::print_on(tty);
 
 	//
 	// End of RDMA structure section
@@ -2067,6 +2155,7 @@ jint G1SemeruCollectedHeap::initialize_memory_pool() {
 	// The commit procesure is controlled by G1RegionToSpaceMapper, page granularity.
 
 	// Allocated at fixed address, RDMA Meta Space, SEMERU_START_ADDR + BLOCK_OFFSET_TABLE_OFFSET
+	guarantee(g1_rs.size() <= SemeruMetaLayout::heap_size(), "The Java heap exceeds the RDMA meta layout.");
 	G1RegionToSpaceMapper* bot_storage =
 		create_aux_memory_mapper_at_fixed_addr("Block Offset Table",
 														 (char*)(SEMERU_START_ADDR + BLOCK_OFFSET_TABLE_OFFSET),
@@ -2310,6 +2399,8 @@ void G1SemeruCollectedHeap::stop() {
 	//_cr->stop();			// Semeru Memory Server doesn't have Concurrent Refine thread.
 	//_young_gen_sampling_thread->stop();	// Not in Semeru Memory Server
 	_semeru_cm_thread->stop();
+	_string_dedup->stop();
+	_remote_card_scan_thread->stop();
 	if (G1StringDedup::is_enabled()) {
 		G1StringDedup::stop();
 	}
@@ -2395,6 +2486,18 @@ void G1SemeruCollectedHeap::ref_processing_init() {
 													 true,                                 // Reference discovery is atomic
 													 &_is_alive_closure_stw,               // is alive closure
 													 true);                                // allow changes to number of processing threads
+
+	// Enabled by the CPU server, -XX:+SemeruRemoteRefProcessing.
+	_remote_ref_discoverer = new G1SemeruRemoteRefDiscoverer(this);
+
+	// Enabled by the CPU server, -XX:+SemeruRemoteStringDedup.
+	_string_dedup = new G1SemeruStringDedup(this, max_regions());
+
+	// Enabled by the CPU server, -XX:+SemeruRemoteCardScan, -XX:+SemeruRemoteRefinement and -XX:+SemeruRemoteArrayOps.
+	_remote_card_scan_thread = new G1SemeruRemoteCardScanThread(_remote_card_scan, _remote_refine, _remote_array_op);
+
+	// sun.gc.semeru.*, one steal slot per concurrent task.
+	_semeru_counters = new G1SemeruCounters(this, SemeruConcGCThreads);
 }
 
 // return the super class's instance
@@ -113,6 +113,10 @@ class G1SemeruCollectedHeap;
 class G1SemeruCollectorPolicy;
 class G1SemeruConcurrentMark;
 class G1SemeruConcurrentMarkThread;
+class G1SemeruRemoteRefDiscoverer;
+class G1SemeruStringDedup;
+class G1SemeruRemoteCardScanThread;
+class G1SemeruCounters;
 
 
 typedef OverflowTaskQueue<StarTask, mtGC>         RefToScanQueue;
@@ -221,6 +225,42 @@ public :
   // The instance of flags_of_rdma_write_check needs to cost several bytes.
   flags_of_rdma_write_check* _rdma_write_check_flags; 
 
+  // 32 bits for each Region, read by the CPU server at the start of a GC.
+  region_liveness_epochs* _liveness_epochs;
+
+  // SEMERU_CLD_BITMAP_WORDS words for each Region, the class loaders of its marked objects. Read by the CPU server.
+  region_cld_liveness* _cld_liveness;
+
+  // The indexes of the compacted Regions, drained by the CPU server at each STW window.
+  compacted_region_ring* _compacted_region_ring;
+
+  // The ownership of the granted Regions, changed by the RDMA atomics of the CPU server.
+  region_state_words* _region_states;
+
+  // The class histogram of the fully evicted Regions, requested by the CPU server.
+  remote_heap_histogram* _heap_histogram;
+
+  // 32 bytes for each Region, the versioned liveness of its MemoryToCPUAtGC. Read by the CPU server in one go.
+  region_liveness_vector* _liveness_vector;
+
+  // The remembered set cards of the evicted old Regions, scanned for the evacuation pause of the CPU server.
+  remote_card_scan* _remote_card_scan;
+
+  // The dirty cards of the evicted old Regions, refined for the concurrent refinement of the CPU server.
+  remote_card_scan* _remote_refine;
+
+  // The remembered set cards of the Regions in the CSet of this server, only stored for the CPU server.
+  remote_rem_set_stash* _remset_stash;
+
+  // The targets the concurrent marking found out of its Regions, relayed by the CPU server, -XX:+SemeruMarkMessages.
+  mark_message_ring* _mark_messages;
+
+  // The pages the concurrent marking reached from the same root, read by the CPU server, -XX:+SemeruPageAffinity.
+  page_affinity_table* _page_affinity;
+
+  // A copy or fill of a large array range for the CPU server, -XX:+SemeruRemoteArrayOps.
+  remote_array_op* _remote_array_op;
+
   received_memory_server_cset* recv_mem_server_cset() { return _recv_mem_server_cset;  }
 
 
@@ -1051,6 +1091,18 @@ private:
   // The (concurrent marking) reference processor...
   ReferenceProcessor* _ref_processor_cm;      // [?] What's this reference processor used for ??
 
+  // Semeru MS - Discover the References of the concurrent tracing, the referents may be cleared by the compaction.
+  G1SemeruRemoteRefDiscoverer* _remote_ref_discoverer;
+
+  // Semeru MS - Merge the identical value arrays of the traced Strings, applied by the concurrent compaction.
+  G1SemeruStringDedup* _string_dedup;
+
+  // Serves _remote_card_scan, -XX:+SemeruRemoteCardScan on the CPU server.
+  G1SemeruRemoteCardScanThread* _remote_card_scan_thread;
+
+  // Semeru MS - The perf-data counters of the tracing and the compaction.
+  G1SemeruCounters* _semeru_counters;
+
   // Instance of the concurrent mark is_alive closure for embedding
   // into the Concurrent Marking reference processor as the
   // _is_alive_non_header field. Supplying a value for the
@@ -1163,6 +1215,10 @@ public:
   //
   ReferenceProcessor* ref_processor_cm() const { return _ref_processor_cm; }
 
+  G1SemeruRemoteRefDiscoverer* remote_ref_discoverer() const { return _remote_ref_discoverer; }
+  G1SemeruStringDedup* string_dedup() const { return _string_dedup; }
+  G1SemeruCounters* semeru_counters() const { return _semeru_counters; }
+
   size_t unused_committed_regions_in_bytes() const;
   virtual size_t capacity() const;
   virtual size_t used() const;
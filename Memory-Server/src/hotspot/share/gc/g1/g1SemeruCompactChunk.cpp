@@ -0,0 +1,276 @@
+/**
+ * Semeru Memory Server - compact a large Region by chunks, in parallel.
+ *
+ */
+
+#include "precompiled.hpp"
+#include "gc/g1/g1ConcurrentMarkBitMap.inline.hpp"
+#include "gc/g1/g1SemeruCompactChunk.hpp"
+#include "gc/g1/g1SemeruCompactionPoint.hpp"
+#include "gc/g1/g1SemeruSTWCompact.inline.hpp"
+#include "gc/g1/SemeruHeapRegion.inline.hpp"
+#include "logging/log.hpp"
+#include "oops/oop.inline.hpp"
+#include "runtime/atomic.hpp"
+#include "runtime/orderAccess.hpp"
+#include "runtime/os.hpp"
+
+
+G1SemeruCompactChunkTask::G1SemeruCompactChunkTask(size_t region_words, size_t chunk_words) :
+  _region(NULL),
+  _alive_bitmap(NULL),
+  _chunks(NULL),
+  _max_chunks((uint)(region_words / chunk_words + 1)),
+  _num_chunks(0),
+  _chunk_words(chunk_words),
+  _claim(claim_word(0, Idle, 0)),
+  _done_chunks(0),
+  _generation(0)
+{
+  _chunks = NEW_C_HEAP_ARRAY(Chunk, _max_chunks, mtGC);
+}
+
+G1SemeruCompactChunkTask::~G1SemeruCompactChunkTask() {
+  FREE_C_HEAP_ARRAY(Chunk, _chunks);
+}
+
+
+bool G1SemeruCompactChunkTask::should_split(SemeruHeapRegion* hr, uint active_workers) {
+  return SemeruCompactChunkSize != 0 && !SemeruCompressorCompact && active_workers > 1 &&
+         hr->used() > 2 * SemeruCompactChunkSize;
+}
+
+
+/**
+ * Semeru MS - Split the claimed Region into chunks of _chunk_words.
+ *  The chunk boundaries don't need to be object boundaries, a chunk owns the objects starting in it.
+ */
+void G1SemeruCompactChunkTask::setup(SemeruHeapRegion* hr) {
+  assert(((_claim >> 32) & 0xffff) == Idle, "Region[0x%x] is still in compaction", _region != NULL ? _region->hrm_index() : 0);
+
+  HeapWord* bottom = hr->bottom();
+  HeapWord* top    = hr->top();
+
+  _region       = hr;
+  _alive_bitmap = hr->alive_bitmap();
+  _num_chunks   = (uint)((pointer_delta(top, bottom) + _chunk_words - 1) / _chunk_words);
+  assert(_num_chunks <= _max_chunks, "Region[0x%x] has too many chunks, %u", hr->hrm_index(), _num_chunks);
+
+  for (uint i = 0; i < _num_chunks; i++) {
+    Chunk* c = &_chunks[i];
+    c->_start      = bottom + i * _chunk_words;
+    c->_end        = MIN2(c->_start + _chunk_words, top);
+    c->_src_end    = c->_start;
+    c->_live_words = 0;
+    c->_dest       = NULL;
+    c->_threshold  = NULL;
+    c->_bot_index  = 0;
+    c->_copied     = false;
+  }
+
+  _generation++;
+
+  log_debug(semeru, mem_compact)("%s, Region[0x%x] is split into %u chunks of 0x%lx words", __func__,
+                                 hr->hrm_index(), _num_chunks, _chunk_words);
+}
+
+
+/**
+ * Claim the next chunk of the published phase.
+ *  The phase and the index are only valid if the CAS on the whole claim word succeeds.
+ */
+bool G1SemeruCompactChunkTask::claim_chunk(uint* phase, uint* index) {
+  uint64_t w = OrderAccess::load_acquire(&_claim);
+
+  while (true) {
+    uint p = (uint)((w >> 32) & 0xffff);
+    uint i = (uint)(w & 0xffffffff);
+    if (p == Idle || i >= _num_chunks) {
+      return false;
+    }
+
+    uint64_t prev = Atomic::cmpxchg(w + 1, &_claim, w);
+    if (prev == w) {
+      *phase = p;
+      *index = i;
+      return true;
+    }
+    w = prev;
+  }
+}
+
+
+void G1SemeruCompactChunkTask::do_chunk(uint phase, uint index, G1SemeruSTWCompactTerminatorTask* worker) {
+  Chunk* c = &_chunks[index];
+
+  switch (phase) {
+    case CountLive: count_live_chunk(c);       break;
+    case Forward:   forward_chunk(c);          break;
+    case Adjust:    adjust_chunk(c, worker);   break;
+    case Copy:      copy_chunk(index);         break;
+    default:        ShouldNotReachHere();
+  }
+
+  Atomic::inc(&_done_chunks);
+}
+
+
+bool G1SemeruCompactChunkTask::help(G1SemeruSTWCompactTerminatorTask* worker) {
+  uint phase;
+  uint index;
+  bool worked = false;
+
+  while (claim_chunk(&phase, &index)) {
+    log_trace(semeru, mem_compact)("%s, worker[0x%x] helps Region[0x%x] phase %u chunk %u", __func__,
+                                   worker->worker_id(), _region->hrm_index(), phase, index);
+    do_chunk(phase, index, worker);
+    worked = true;
+  }
+  return worked;
+}
+
+
+void G1SemeruCompactChunkTask::run_phase(Phase phase, G1SemeruSTWCompactTerminatorTask* owner) {
+  uint p;
+  uint index;
+
+  _done_chunks = 0;
+  OrderAccess::release_store(&_claim, claim_word(_generation, phase, 0));   // publish
+
+  while (claim_chunk(&p, &index)) {
+    do_chunk(p, index, owner);
+  }
+
+  // The chunks claimed by the helpers.
+  while (OrderAccess::load_acquire(&_done_chunks) < _num_chunks) {
+    SpinPause();
+  }
+}
+
+
+/**
+ * Phase#1.1, the size of alive objects starting in the chunk.
+ */
+void G1SemeruCompactChunkTask::count_live_chunk(Chunk* c) {
+  HeapWord* addr = _alive_bitmap->get_next_marked_addr(c->_start, c->_end);
+
+  while (addr < c->_end) {
+    size_t size = oop(addr)->size();
+    c->_live_words += size;
+    c->_src_end     = addr + size;
+
+    if (addr + size >= c->_end) {
+      break;
+    }
+    addr = _alive_bitmap->get_next_marked_addr(addr + size, c->_end);
+  }
+}
+
+
+/**
+ * Phase#1.2, the chunks slide in address order, the same layout with a serial compaction of the Region.
+ */
+void G1SemeruCompactChunkTask::calculate_destinations() {
+  HeapWord* dest = _region->bottom();
+
+  for (uint i = 0; i < _num_chunks; i++) {
+    _chunks[i]._dest = dest;
+    dest += _chunks[i]._live_words;
+  }
+
+  _region->set_compaction_top(dest);
+}
+
+
+/**
+ * Phase#1.3, put the forwarding pointers, and record the chunk's destination range into the BOT.
+ */
+void G1SemeruCompactChunkTask::forward_chunk(Chunk* c) {
+  HeapWord* dest = c->_dest;
+  HeapWord* threshold = _region->initialize_threshold_at(dest, &c->_bot_index);
+  HeapWord* addr = _alive_bitmap->get_next_marked_addr(c->_start, c->_end);
+
+  while (addr < c->_end) {
+    size_t size = oop(addr)->size();
+    if (addr != dest) {
+      _region->note_rewritten(dest, dest + size);
+    }
+    G1SemeruCompactionPoint::forward_to(oop(addr), dest);
+    threshold = _region->cross_threshold_at(threshold, &c->_bot_index, dest, dest + size);
+    dest += size;
+
+    if (addr + size >= c->_end) {
+      break;
+    }
+    addr = _alive_bitmap->get_next_marked_addr(addr + size, c->_end);
+  }
+
+  assert(dest == c->_dest + c->_live_words, "chunk [0x%lx, 0x%lx) changed after counting", (size_t)c->_start, (size_t)c->_end);
+  c->_threshold = threshold;
+}
+
+
+/**
+ * Phase#2, the inter-Region fields are recorded into the executing worker's queue.
+ */
+void G1SemeruCompactChunkTask::adjust_chunk(Chunk* c, G1SemeruSTWCompactTerminatorTask* worker) {
+  G1SemeruAdjustClosure adjust_pointer(_region, worker->inter_region_ref_taskqueue());
+  G1SemeruAdjustLiveClosure adjust_oop(&adjust_pointer);
+  HeapWord* addr = _alive_bitmap->get_next_marked_addr(c->_start, c->_end);
+
+  while (addr < c->_end) {
+    size_t size = adjust_oop.apply(oop(addr));
+
+    if (addr + size >= c->_end) {
+      break;
+    }
+    addr = _alive_bitmap->get_next_marked_addr(addr + size, c->_end);
+  }
+}
+
+
+/**
+ * Phase#3, the copy of chunk i overwrites [dest_i, dest_i + live_i).
+ *  Wait for the lower chunks whose objects are still there.
+ */
+void G1SemeruCompactChunkTask::copy_chunk(uint index) {
+  Chunk* c = &_chunks[index];
+
+  for (uint j = 0; j < index; j++) {
+    if (_chunks[j]._src_end > c->_dest) {
+      while (!OrderAccess::load_acquire(&_chunks[j]._copied)) {
+        SpinPause();
+      }
+    }
+  }
+
+  G1SemeruCompactRegionClosure semeru_ms_compact;
+  HeapWord* addr = _alive_bitmap->get_next_marked_addr(c->_start, c->_end);
+
+  while (addr < c->_end) {
+    size_t size = semeru_ms_compact.apply(oop(addr));
+
+    if (addr + size >= c->_end) {
+      break;
+    }
+    addr = _alive_bitmap->get_next_marked_addr(addr + size, c->_end);
+  }
+
+  OrderAccess::release_store(&c->_copied, true);
+}
+
+
+/**
+ * The BOT threshold of the Region continues from its last non-empty chunk.
+ */
+void G1SemeruCompactChunkTask::finish() {
+  for (uint i = _num_chunks; i > 0; i--) {
+    Chunk* c = &_chunks[i - 1];
+    if (c->_live_words != 0) {
+      _region->set_threshold(c->_threshold, c->_bot_index);
+      break;
+    }
+  }
+
+  OrderAccess::release_store(&_claim, claim_word(_generation, Idle, 0));
+}
@@ -0,0 +1,107 @@
+/**
+ * Semeru Memory Server - compact a large Region by chunks, in parallel.
+ *
+ */
+
+#ifndef SHARE_GC_G1_G1_SEMERU_COMPACTCHUNK_HPP
+#define SHARE_GC_G1_G1_SEMERU_COMPACTCHUNK_HPP
+
+#include "memory/allocation.hpp"
+#include "oops/oopsHierarchy.hpp"
+#include "utilities/globalDefinitions.hpp"
+
+class G1CMBitMap;
+class G1SemeruSTWCompactTerminatorTask;
+class SemeruHeapRegion;
+
+
+/**
+ * Semeru MS - The chunks of a Region claimed by one compaction worker, -XX:SemeruCompactChunkSize.
+ *
+ * A worker claims the whole Region from the MS CSet. A few dense Regions leave the other workers idle.
+ * The claiming worker, the owner, splits a large Region into chunks and publishes them here.
+ * 1) A chunk owns the alive objects starting in its source range. The last object can exceed the range.
+ * 2) The Region is compacted into itself. The destination of a chunk is the prefix sum of the live words in front of it,
+ *    so each chunk forwards its objects without any shared compaction top.
+ * 3) The phases, count live words, forward, adjust intra-Region fields and copy, are run one by one.
+ *    Every worker, the owner and the idle ones, claims chunks of the current phase, the owner waits until all the chunks are done.
+ * 4) A chunk's copy only starts after the chunks whose objects are overwritten by it are copied.
+ *    The claims are in address order, the waiting never forms a cycle.
+ *
+ * The claim word packs < generation, phase, next chunk >. A worker holding a stale claim word
+ * of a previous phase or Region fails the CAS.
+ *
+ * One instance per compaction worker, reused by the Regions the worker owns.
+ */
+class G1SemeruCompactChunkTask : public CHeapObj<mtGC> {
+public:
+  enum Phase {
+    Idle       = 0,
+    CountLive  = 1,
+    Forward    = 2,
+    Adjust     = 3,
+    Copy       = 4
+  };
+
+private:
+  struct Chunk {
+    HeapWord*     _start;       // source range [_start, _end), the alive objects starting in it.
+    HeapWord*     _end;
+    HeapWord*     _src_end;     // end of the last alive object, can be beyond _end.
+    size_t        _live_words;
+    HeapWord*     _dest;        // new address of the first alive object.
+    HeapWord*     _threshold;   // BOT threshold after forwarding the chunk.
+    size_t        _bot_index;
+    volatile bool _copied;
+  };
+
+  SemeruHeapRegion*  _region;
+  G1CMBitMap*        _alive_bitmap;
+  Chunk*             _chunks;
+  uint               _max_chunks;
+  uint               _num_chunks;
+  size_t             _chunk_words;
+
+  volatile uint64_t  _claim;        // [ generation:16 | phase:16 | next chunk:32 ]
+  volatile uint      _done_chunks;  // chunks finished in current phase
+  uint               _generation;
+
+  static uint64_t claim_word(uint generation, uint phase, uint next) {
+    return ((uint64_t)(generation & 0xffff) << 48) | ((uint64_t)(phase & 0xffff) << 32) | (uint64_t)next;
+  }
+
+  bool claim_chunk(uint* phase, uint* index);
+  void do_chunk(uint phase, uint index, G1SemeruSTWCompactTerminatorTask* worker);
+
+  void count_live_chunk(Chunk* c);
+  void forward_chunk(Chunk* c);
+  void adjust_chunk(Chunk* c, G1SemeruSTWCompactTerminatorTask* worker);
+  void copy_chunk(uint index);
+
+public:
+  G1SemeruCompactChunkTask(size_t region_words, size_t chunk_words);
+  ~G1SemeruCompactChunkTask();
+
+  // The Region is worth splitting, used bytes over 2 chunks, and there are workers to help.
+  static bool should_split(SemeruHeapRegion* hr, uint active_workers);
+
+  // Owner, split hr into chunks.
+  void setup(SemeruHeapRegion* hr);
+
+  // Owner, publish a phase, process chunks together with the helpers until all are done.
+  void run_phase(Phase phase, G1SemeruSTWCompactTerminatorTask* owner);
+
+  // Owner, set the Region's compaction top and the chunks' destinations, after CountLive.
+  void calculate_destinations();
+
+  // Owner, after Copy. Retire the chunks and restore the Region's BOT threshold.
+  void finish();
+
+  // Helper, process chunks of the published phase. Return false if there is nothing to claim.
+  bool help(G1SemeruSTWCompactTerminatorTask* worker);
+
+  SemeruHeapRegion* region()     const { return _region; }
+  uint              num_chunks() const { return _num_chunks; }
+};
+
+#endif // SHARE_GC_G1_G1_SEMERU_COMPACTCHUNK_HPP
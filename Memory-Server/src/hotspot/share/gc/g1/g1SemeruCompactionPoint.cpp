@@ -34,10 +34,12 @@ G1SemeruCompactionPoint::G1SemeruCompactionPoint() :
     _compaction_top(NULL) {
   _compaction_regions = new (ResourceObj::C_HEAP, mtGC) GrowableArray<SemeruHeapRegion*>(32, true, mtGC);
   _compaction_region_iterator = _compaction_regions->begin();     // Points to all the Source Region list.
+  _freed_regions = new (ResourceObj::C_HEAP, mtGC) GrowableArray<SemeruHeapRegion*>(32, true, mtGC);
 }
 
 G1SemeruCompactionPoint::~G1SemeruCompactionPoint() {
   delete _compaction_regions;
+  delete _freed_regions;
 }
 
 void G1SemeruCompactionPoint::update() {
@@ -85,6 +87,10 @@ GrowableArray<SemeruHeapRegion*>* G1SemeruCompactionPoint::regions() {
   return _compaction_regions;
 }
 
+size_t G1SemeruCompactionPoint::free_words() {
+  return is_initialized() ? pointer_delta(_current_region->end(), _compaction_top) : 0;
+}
+
 bool G1SemeruCompactionPoint::object_will_fit(size_t size) {
   size_t space_left = pointer_delta(_current_region->end(), _compaction_top);
   return size <= space_left;
@@ -99,6 +105,47 @@ void G1SemeruCompactionPoint::switch_region() {
 }
 
 
+/**
+ * Semeru MS - Slide the last enqueued Region into itself, instead of bumping its alive objects
+ *  into the tail of the current destination.
+ *  The Regions skipped in between were evacuated, their compaction_top stays at bottom
+ *  and collect_freed_regions() frees them.
+ */
+void G1SemeruCompactionPoint::slide_in_place_last() {
+  SemeruHeapRegion* hr = _compaction_regions->last();
+  if (hr == _current_region) {
+    return;
+  }
+
+  _current_region->set_compaction_top(_compaction_top);
+  while (*_compaction_region_iterator != hr) {
+    ++_compaction_region_iterator;
+  }
+  _current_region = hr;
+  hr->set_compaction_top(hr->bottom());
+  initialize_values(true);
+}
+
+
+/**
+ * Semeru MS - Reserve size words in current CompactionPoint/Region, without forwarding any object.
+ *  The block of words is a run of contiguous alive objects, see G1SemeruCompressor::summarize().
+ */
+HeapWord* G1SemeruCompactionPoint::allocate(size_t size) {
+  assert(_current_region != NULL, "Must have been initialized");
+
+  while (!object_will_fit(size)) {
+    switch_region();
+  }
+
+  HeapWord* dest = _compaction_top;
+  _compaction_top += size;
+  if (_compaction_top > _threshold) {
+    _threshold = _current_region->cross_threshold(dest, _compaction_top);
+  }
+  return dest;
+}
+
 /**
  * Calculate the object, passed in parameter, 's destination address in current CompactionPoint/Region.
  *  
@@ -111,9 +158,25 @@ void G1SemeruCompactionPoint::forward(oop object, size_t size) {
     switch_region();  // Switch to a new compaction Region. No need to put any fake oop after the SemeruHeapRegion->_top
   }
 
-  // Store a forwarding pointer if the object should be moved.
   if ((HeapWord*)object != _compaction_top) {
-    object->forward_to(oop(_compaction_top));
+    _current_region->note_rewritten(_compaction_top, _compaction_top + size);
+  }
+  forward_to(object, _compaction_top);
+
+  // Update compaction values.
+  _compaction_top += size;
+  if (_compaction_top > _threshold) {
+    _threshold = _current_region->cross_threshold(_compaction_top - size, _compaction_top);
+  }
+}
+
+/**
+ * Semeru MS - Store the forwarding pointer to dest in object's markOop, if the object should be moved.
+ *  Shared by the CompactionPoint and the chunked compaction, which calculates dest itself.
+ */
+void G1SemeruCompactionPoint::forward_to(oop object, HeapWord* dest) {
+  if ((HeapWord*)object != dest) {
+    object->forward_to(oop(dest));
   } else {
     if (object->forwardee() != NULL) {
       // Object should not move but mark-word is used so it looks like the
@@ -134,12 +197,6 @@ void G1SemeruCompactionPoint::forward(oop object, size_t size) {
     }
     assert(object->forwardee() == NULL, "should be forwarded to NULL");
   }
-
-  // Update compaction values.
-  _compaction_top += size;
-  if (_compaction_top > _threshold) {
-    _threshold = _current_region->cross_threshold(_compaction_top - size, _compaction_top);
-  }
 }
 
 /**
@@ -183,5 +240,25 @@ void G1SemeruCompactionPoint::reset_compactionPoint(){
   _compaction_top = NULL;
   _compaction_regions->clear(); // set index, len to 0.
   _compaction_region_iterator = _compaction_regions->begin();   // point to _compaction_regions's first element.
+  _freed_regions->clear();
+
+}
+
 
+/**
+ * Semeru MS - The source Regions never switched to as a destination are empty after the compaction,
+ *  all their alive objects are bumped into the Regions in front of them.
+ *  Called once at the end of the worker's compaction, before reset_compactionPoint().
+ */
+void G1SemeruCompactionPoint::collect_freed_regions() {
+  if (!is_initialized()) {
+    return;
+  }
+
+  for (int i = 0; i < _compaction_regions->length(); i++) {
+    SemeruHeapRegion* hr = _compaction_regions->at(i);
+    if (hr != _current_region && hr->compaction_top() == hr->bottom()) {
+      _freed_regions->append(hr);
+    }
+  }
 }
\ No newline at end of file
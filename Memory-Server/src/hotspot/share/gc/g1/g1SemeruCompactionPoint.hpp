@@ -37,6 +37,7 @@ class G1SemeruCompactionPoint : public CHeapObj<mtGC> {
   HeapWord*   _compaction_top;      // the top, when this Region is used as compaction destination Region.
   GrowableArray<SemeruHeapRegion*>* _compaction_regions;    // The destination Region candidates. The enqueued source Region.
   GrowableArrayIterator<SemeruHeapRegion*> _compaction_region_iterator; // points to the _compaction_regions[]
+  GrowableArray<SemeruHeapRegion*>* _freed_regions;         // Emptied by this worker in current window, merged at its end.
 
   bool object_will_fit(size_t size);
   void initialize_values(bool init_threshold);
@@ -52,6 +53,8 @@ public:
   void initialize(SemeruHeapRegion* hr, bool init_threshold);
   void update();
   void forward(oop object, size_t size);
+  static void forward_to(oop object, HeapWord* dest);
+  HeapWord* allocate(size_t size);
   void add(SemeruHeapRegion* hr);
   void merge(G1SemeruCompactionPoint* other);
 
@@ -65,6 +68,16 @@ public:
   // Semeru MS need to reset the CP information at the end of compaction task.
   void reset_compactionPoint();
 
+  // The freed Regions are kept per worker, no lock is taken while compacting.
+  void add_freed(SemeruHeapRegion* hr) { _freed_regions->append(hr); }
+  void collect_freed_regions();
+  GrowableArray<SemeruHeapRegion*>* freed_regions() { return _freed_regions; }
+
+  // Free words left in the current destination Region.
+  size_t free_words();
+  // Make the last enqueued Region the destination, its alive objects slide to its bottom.
+  void slide_in_place_last();
+
 };
 
 #endif // SHARE_GC_G1_G1_SEMERU_COMPACTIONPOINT_HPP
@@ -0,0 +1,79 @@
+/*
+ * Semeru memory server - compressed oops of the Semeru heap.
+ *
+ * The CPU server places the Semeru heap at RDMA_DATA_SPACE_START_ADDR and uses the heap based
+ * compressed oops, base SEMERU_NARROW_OOP_BASE, shift LogMinObjAlignmentInBytes.
+ * The Universe narrow oop base of the memory server belongs to its own Java heap,
+ * so the closures scanning the Semeru heap decode/encode the fields with the functions here.
+ *
+ * The same overload style with CompressedOops, the template closures don't need conditionals.
+ * The object layout follows the CPU server, UseCompressedOops has to be the same on both sides.
+ * It's checked by the RDMA meta layout digest at connection.
+ */
+
+#ifndef SHARE_VM_GC_G1_SEMERU_G1COMPRESSEDOOPS_INLINE_HPP
+#define SHARE_VM_GC_G1_SEMERU_G1COMPRESSEDOOPS_INLINE_HPP
+
+#include "gc/shared/taskqueue.hpp"
+#include "oops/access.inline.hpp"
+#include "oops/compressedOops.inline.hpp"
+#include "oops/oop.hpp"
+#include "utilities/globalDefinitions.hpp"
+
+namespace SemeruCompressedOops {
+  inline address base()  { return (address)SEMERU_NARROW_OOP_BASE; }
+  inline int     shift() { return LogMinObjAlignmentInBytes; }
+
+  inline oop decode_not_null(narrowOop v) {
+    assert(!CompressedOops::is_null(v), "narrow oop value can never be zero");
+    oop result = (oop)(void*)((uintptr_t)base() + ((uintptr_t)v << shift()));
+    assert(check_obj_alignment(result), "address not aligned: " INTPTR_FORMAT, p2i((void*) result));
+    return result;
+  }
+
+  inline oop decode(narrowOop v) {
+    return CompressedOops::is_null(v) ? (oop)NULL : decode_not_null(v);
+  }
+
+  inline narrowOop encode_not_null(oop v) {
+    assert(!CompressedOops::is_null(v), "oop value can never be zero");
+    assert(check_obj_alignment(v), "Address not aligned");
+    assert((size_t)(HeapWord*)v >= RDMA_DATA_SPACE_START_ADDR, "Address not in the Semeru heap");
+    uint64_t  pd = (uint64_t)(pointer_delta((void*)v, (void*)base(), 1));
+    assert(OopEncodingHeapMax > pd, "Semeru heap exceeds the compressed oops range");
+    return (narrowOop)(pd >> shift());
+  }
+
+  // No conversions needed for these overloads
+  inline oop decode_not_null(oop v)             { return v; }
+  inline oop decode(oop v)                      { return v; }
+
+  // Raw load and decode of a field, NULL for empty field.
+  template <class T>
+  inline oop load_decode(T* p) {
+    T heap_oop = RawAccess<MO_VOLATILE>::oop_load(p);
+    return decode(heap_oop);
+  }
+
+  inline void store_not_null(oop* p, oop v)       { RawAccess<IS_NOT_NULL>::oop_store(p, v); }
+  inline void store_not_null(narrowOop* p, oop v) { RawAccess<IS_NOT_NULL>::oop_store(p, encode_not_null(v)); }
+
+  // Raw store of a field, v can be NULL.
+  inline void store(oop* p, oop v)       { RawAccess<>::oop_store(p, v); }
+  inline void store(narrowOop* p, oop v) { RawAccess<>::oop_store(p, v == NULL ? (narrowOop)0 : encode_not_null(v)); }
+
+  // The fields recorded in the StarTask queues can be either width.
+  inline oop load_decode(StarTask ref) {
+    return ref.is_narrow() ? load_decode((narrowOop*)ref) : load_decode((oop*)ref);
+  }
+
+  inline void store_not_null(StarTask ref, oop v) {
+    if (ref.is_narrow()) {
+      store_not_null((narrowOop*)ref, v);
+    } else {
+      store_not_null((oop*)ref, v);
+    }
+  }
+}
+
+#endif // SHARE_VM_GC_G1_SEMERU_G1COMPRESSEDOOPS_INLINE_HPP
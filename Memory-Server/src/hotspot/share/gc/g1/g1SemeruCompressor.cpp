@@ -0,0 +1,224 @@
+/**
+ * Semeru Memory Server - Compressor style address calculation of the compaction.
+ *
+ */
+
+#include "precompiled.hpp"
+#include "gc/g1/g1ConcurrentMarkBitMap.inline.hpp"
+#include "gc/g1/g1SemeruCompactionPoint.hpp"
+#include "gc/g1/g1SemeruCompressor.hpp"
+#include "gc/g1/g1SemeruSTWCompact.inline.hpp"
+#include "gc/g1/SemeruHeapRegion.hpp"
+#include "logging/log.hpp"
+#include "oops/oop.inline.hpp"
+#include "utilities/align.hpp"
+#include "utilities/bitMap.inline.hpp"
+#include "utilities/copy.hpp"
+#include "utilities/growableArray.hpp"
+
+
+G1SemeruCompressor::G1SemeruCompressor(size_t region_words) :
+  _region(NULL),
+  _bottom(NULL),
+  _live_words(region_words, mtGC),
+  _block_base(NULL),
+  _num_blocks(region_words >> LogBlockWords),
+  _summarized_live_words(0)
+{
+  assert(is_aligned(region_words, BitsPerWord), "Region words 0x%lx are not aligned to the bitmap word.", region_words);
+  _block_base = NEW_C_HEAP_ARRAY(HeapWord*, _num_blocks, mtGC);
+}
+
+G1SemeruCompressor::~G1SemeruCompressor() {
+  FREE_C_HEAP_ARRAY(HeapWord*, _block_base);
+}
+
+
+/**
+ * Semeru MS - Phase#1 of the Compressor mode.
+ *
+ * 1) Only the object size is read from the header.
+ * 2) The objects starting in the same block are compacted together.
+ *    The run [first object start, last object end) is reserved at the compaction point at once,
+ *    so it never crosses a destination Region boundary.
+ */
+void G1SemeruCompressor::summarize(SemeruHeapRegion* hr, G1CMBitMap* alive_bitmap, G1SemeruCompactionPoint* cp) {
+  summarize_work(hr, alive_bitmap, cp, NULL);
+}
+
+HeapWord* G1SemeruCompressor::summarize_in_place(SemeruHeapRegion* hr, G1CMBitMap* alive_bitmap) {
+  HeapWord* new_top = hr->bottom();
+  summarize_work(hr, alive_bitmap, NULL, &new_top);
+  return new_top;
+}
+
+inline HeapWord* G1SemeruCompressor::reserve(G1SemeruCompactionPoint* cp, HeapWord** in_place_top, size_t words) {
+  if (cp != NULL) {
+    return cp->allocate(words);
+  }
+
+  HeapWord* dest = *in_place_top;
+  *in_place_top += words;
+  return dest;
+}
+
+/**
+ * Semeru MS - The summary of one alive object, applied by the word scan of the alive bitmap.
+ *  The live words and the block bases are built in the same pass, the live words are counted by the way.
+ */
+class G1SemeruSummarizeClosure : public StackObj {
+  G1SemeruCompressor*      _compressor;
+  G1SemeruCompactionPoint* _cp;
+  HeapWord**               _in_place_top;
+  size_t                   _block;        // _num_blocks if no block yet
+  size_t                   _group_start;
+  size_t                   _group_end;
+  size_t                   _live_words;
+
+public:
+  G1SemeruSummarizeClosure(G1SemeruCompressor* compressor, G1SemeruCompactionPoint* cp, HeapWord** in_place_top) :
+    _compressor(compressor), _cp(cp), _in_place_top(in_place_top),
+    _block(compressor->_num_blocks), _group_start(0), _group_end(0), _live_words(0) { }
+
+  size_t apply(oop obj) {
+    size_t size   = obj->size();
+    size_t offset = pointer_delta((HeapWord*)obj, _compressor->_bottom);
+    _compressor->_live_words.set_range(offset, offset + size);
+    _live_words += size;
+
+    if ((offset >> G1SemeruCompressor::LogBlockWords) != _block) {
+      finish_block();
+      _block       = offset >> G1SemeruCompressor::LogBlockWords;
+      _group_start = offset;
+    }
+    _group_end = offset + size;
+    return size;
+  }
+
+  // Reserve the run of objects starting in the current block.
+  void finish_block() {
+    if (_block != _compressor->_num_blocks) {
+      size_t words   = _group_end - _group_start;
+      HeapWord* dest = G1SemeruCompressor::reserve(_cp, _in_place_top, words);
+      if (dest != _compressor->_bottom + _group_start) {
+        SemeruHeapRegion* to = _cp != NULL ? _cp->current_region() : _compressor->_region;
+        to->note_rewritten(dest, dest + words);
+      }
+      _compressor->_block_base[_block] = dest - _compressor->live_words_in_block_before(_group_start);
+    }
+  }
+
+  size_t live_words() const { return _live_words; }
+};
+
+void G1SemeruCompressor::summarize_work(SemeruHeapRegion* hr, G1CMBitMap* alive_bitmap, G1SemeruCompactionPoint* cp,
+                                        HeapWord** in_place_top) {
+  HeapWord* top = hr->top();
+
+  _region = hr;
+  _bottom = hr->bottom();
+  _live_words.clear_range(0, align_up(pointer_delta(top, _bottom), (size_t)BitsPerWord));
+
+  G1SemeruSummarizeClosure summarize(this, cp, in_place_top);
+  alive_bitmap->iterate_marked_objects(_bottom, top, &summarize);
+  summarize.finish_block();
+  _summarized_live_words = summarize.live_words();
+
+  log_debug(semeru, mem_compact)("%s, Region[0x%x] summarized, 0x%lx live words", __func__,
+                                 hr->hrm_index(), _summarized_live_words);
+}
+
+
+/**
+ * Semeru MS - Phase#2 and Phase#3 of the Compressor mode.
+ *
+ * Following the address order, the new address of an object is never behind its old address.
+ * So the copy only overwrites the processed objects, the unprocessed ones are intact.
+ * The markOop is copied as it is, it was never used for forwarding.
+ */
+void G1SemeruCompressor::adjust_and_compact(SemeruHeapRegion* hr, G1CMBitMap* alive_bitmap, G1SemeruAdjustClosure* adjust_pointer) {
+  assert(hr == _region, "Region[0x%x] is not summarized.", hr->hrm_index());
+
+  HeapWord* top = hr->top();
+  HeapWord* addr;
+
+  for (addr = alive_bitmap->get_next_marked_addr(_bottom, top); addr < top; ) {
+    HeapWord* dest = new_addr(addr);
+    assert(dest <= addr || !is_in_summarized_region(dest), "obj 0x%lx slides forward to 0x%lx", (size_t)addr, (size_t)dest);
+
+    size_t size = oop(addr)->oop_iterate_size(adjust_pointer);
+    if (dest != addr) {
+      Copy::aligned_conjoint_words(addr, dest, size);
+    }
+
+    addr = alive_bitmap->get_next_marked_addr(addr + size, top);
+  }
+}
+
+
+/**
+ * Semeru MS - The concurrent compaction, the CPU server can still swap in the Region's pages.
+ *
+ * Copy each alive object to its place in the shadow first, then iterate the original object.
+ * The adjusted intra-Region fields are stored into the shadow copy by the closure's shadow delta.
+ * The inter-Region fields are recorded by their new addresses, the same with the STW compaction.
+ */
+void G1SemeruCompressor::compact_to_shadow(SemeruHeapRegion* hr, G1CMBitMap* alive_bitmap, G1SemeruAdjustClosure* adjust_pointer,
+                                           HeapWord* shadow) {
+  assert(hr == _region, "Region[0x%x] is not summarized.", hr->hrm_index());
+
+  HeapWord* top = hr->top();
+  HeapWord* addr;
+
+  for (addr = alive_bitmap->get_next_marked_addr(_bottom, top); addr < top; ) {
+    HeapWord* copy = shadow + pointer_delta(new_addr(addr), _bottom);
+    size_t size = oop(addr)->size();
+    Copy::aligned_disjoint_words(addr, copy, size);
+
+    adjust_pointer->set_shadow_delta((char*)copy - (char*)addr);
+    oop(addr)->oop_iterate(adjust_pointer);
+
+    addr = alive_bitmap->get_next_marked_addr(addr + size, top);
+  }
+
+  adjust_pointer->set_shadow_delta(0);
+}
+
+
+/**
+ * The objects of the other pages are intact in the shadow. An object crossing into a rewritten page is copied whole.
+ */
+size_t G1SemeruCompressor::recompact_pages_to_shadow(SemeruHeapRegion* hr, G1CMBitMap* alive_bitmap, G1SemeruAdjustClosure* adjust_pointer,
+                                                     HeapWord* shadow, const uint32_t* pages, uint num_pages,
+                                                     GrowableArray<MemRegion>* moved) {
+  assert(hr == _region, "Region[0x%x] is not summarized.", hr->hrm_index());
+
+  const size_t page_words = PAGE_SIZE / HeapWordSize;   // the pages of the CPU server
+  HeapWord* top = hr->top();
+  HeapWord* addr;
+  size_t copied = 0;
+  uint p = 0;
+
+  for (addr = alive_bitmap->get_next_marked_addr(_bottom, top); addr < top && p < num_pages; ) {
+    size_t size = oop(addr)->size();
+
+    // Skip the pages in front of the object.
+    while (p < num_pages && _bottom + (size_t)(pages[p] + 1) * page_words <= addr) {
+      p++;
+    }
+    if (p < num_pages && _bottom + (size_t)pages[p] * page_words < addr + size) {
+      HeapWord* copy = shadow + pointer_delta(new_addr(addr), _bottom);
+      Copy::aligned_disjoint_words(addr, copy, size);
+
+      adjust_pointer->set_shadow_delta((char*)copy - (char*)addr);
+      oop(addr)->oop_iterate(adjust_pointer);
+      moved->append(MemRegion(new_addr(addr), size));
+      copied++;
+    }
+
+    addr = alive_bitmap->get_next_marked_addr(addr + size, top);
+  }
+
+  adjust_pointer->set_shadow_delta(0);
+  return copied;
+}
@@ -0,0 +1,113 @@
+/**
+ * Semeru Memory Server - Compressor style address calculation of the compaction.
+ *
+ */
+
+#ifndef SHARE_GC_G1_G1_SEMERU_COMPRESSOR_HPP
+#define SHARE_GC_G1_G1_SEMERU_COMPRESSOR_HPP
+
+#include "memory/allocation.hpp"
+#include "memory/memRegion.hpp"
+#include "oops/oopsHierarchy.hpp"
+#include "utilities/bitMap.hpp"
+#include "utilities/globalDefinitions.hpp"
+
+class G1CMBitMap;
+class G1SemeruAdjustClosure;
+class G1SemeruCompactionPoint;
+class SemeruHeapRegion;
+template <class E> class GrowableArray;
+
+
+/**
+ * Semeru MS - Derive the new address of the alive objects from bitmaps, -XX:+SemeruCompressorCompact.
+ *
+ * The default compaction stores a forwarding pointer in each alive object's markOop (phase#1),
+ * reads it back for each reference (phase#2), and again for the copy (phase#3).
+ * The Compressor mode never writes the object headers :
+ *
+ * 1) summarize(), one pass over the alive objects of the compacted Region.
+ *    a. Mark every word of the alive objects in a live words bitmap.
+ *    b. For each block of 64 words, one bitmap word, reserve the run of objects starting in it
+ *       at the compaction point, and record the base of their new addresses.
+ * 2) new_addr(obj) = block base + live words of the block in front of obj, a popcount.
+ * 3) adjust_and_compact(), one pass adjusting each object's fields, then sliding it to its new address.
+ *    The referenced objects' headers are never read, so the copy can overwrite them.
+ *
+ * One instance per compaction worker, reused by the Regions the worker compacts.
+ * It's only valid for the Region summarized last.
+ *
+ * The concurrent compaction, -XX:+SemeruConcurrentCompact on the CPU server, slides a Region into itself
+ * out of the STW window. The heap is read only then, the compacted image is built into a shadow buffer.
+ */
+class G1SemeruCompressor : public CHeapObj<mtGC> {
+  friend class G1SemeruSummarizeClosure;
+
+  SemeruHeapRegion* _region;      // the Region summarized last
+  HeapWord*         _bottom;
+  CHeapBitMap       _live_words;  // 1 bit per HeapWord of the Region
+  HeapWord**        _block_base;  // new address of the block's first object, minus the live words in front of it.
+  size_t            _num_blocks;
+  size_t            _summarized_live_words;
+
+  static const uint LogBlockWords = LogBitsPerWord;   // one bitmap word per block
+
+  static inline size_t popcount(BitMap::bm_word_t w) {
+    w = w - ((w >> 1) & (BitMap::bm_word_t)0x5555555555555555ULL);
+    w = (w & (BitMap::bm_word_t)0x3333333333333333ULL) + ((w >> 2) & (BitMap::bm_word_t)0x3333333333333333ULL);
+    w = (w + (w >> 4)) & (BitMap::bm_word_t)0x0f0f0f0f0f0f0f0fULL;
+    return (size_t)((w * (BitMap::bm_word_t)0x0101010101010101ULL) >> 56);
+  }
+
+  // Reserve words at cp, or at *in_place_top when compacting the Region into itself.
+  static inline HeapWord* reserve(G1SemeruCompactionPoint* cp, HeapWord** in_place_top, size_t words);
+
+  void summarize_work(SemeruHeapRegion* hr, G1CMBitMap* alive_bitmap, G1SemeruCompactionPoint* cp, HeapWord** in_place_top);
+
+  // Live words of block in front of word offset
+  inline size_t live_words_in_block_before(size_t offset) const {
+    BitMap::bm_word_t w = _live_words.words()[offset >> LogBlockWords];
+    return popcount(w & (((BitMap::bm_word_t)1 << (offset & (BitsPerWord - 1))) - 1));
+  }
+
+public:
+  G1SemeruCompressor(size_t region_words);
+  ~G1SemeruCompressor();
+
+  // Phase#1, calculate the new addresses of hr's alive objects at cp.
+  void summarize(SemeruHeapRegion* hr, G1CMBitMap* alive_bitmap, G1SemeruCompactionPoint* cp);
+
+  // Phase#1 of the concurrent compaction, slide hr's alive objects to its bottom. Return the new top.
+  HeapWord* summarize_in_place(SemeruHeapRegion* hr, G1CMBitMap* alive_bitmap);
+
+  // The new address of an alive object of the summarized Region.
+  inline HeapWord* new_addr(HeapWord* obj) const {
+    assert(_region != NULL && obj >= _bottom && pointer_delta(obj, _bottom) < _num_blocks << LogBlockWords,
+           "obj 0x%lx is not in the summarized Region", (size_t)obj);
+    size_t offset = pointer_delta(obj, _bottom);
+    return _block_base[offset >> LogBlockWords] + live_words_in_block_before(offset);
+  }
+
+  // Live words of the Region summarized last, counted by the summary pass.
+  size_t summarized_live_words() const { return _summarized_live_words; }
+
+  // The summarized Region contains obj.
+  bool is_in_summarized_region(HeapWord* obj) const {
+    return _region != NULL && obj >= _bottom && pointer_delta(obj, _bottom) < _num_blocks << LogBlockWords;
+  }
+
+  // Phase#2 and #3 in one pass.
+  void adjust_and_compact(SemeruHeapRegion* hr, G1CMBitMap* alive_bitmap, G1SemeruAdjustClosure* adjust_pointer);
+
+  // Phase#2 and #3 of the concurrent compaction. The objects and their adjusted fields are written to
+  // shadow + (new address - bottom), the Region itself isn't modified.
+  void compact_to_shadow(SemeruHeapRegion* hr, G1CMBitMap* alive_bitmap, G1SemeruAdjustClosure* adjust_pointer, HeapWord* shadow);
+
+  // The concurrent compaction, the pages rewritten by the CPU server since compact_to_shadow(), sorted page indexes
+  // within the Region. Copy the alive objects overlapping them into the shadow again, their fields adjusted.
+  // The new ranges of the copied objects are appended to moved, in address order. Return the number of them.
+  size_t recompact_pages_to_shadow(SemeruHeapRegion* hr, G1CMBitMap* alive_bitmap, G1SemeruAdjustClosure* adjust_pointer,
+                                   HeapWord* shadow, const uint32_t* pages, uint num_pages, GrowableArray<MemRegion>* moved);
+};
+
+#endif // SHARE_GC_G1_G1_SEMERU_COMPRESSOR_HPP
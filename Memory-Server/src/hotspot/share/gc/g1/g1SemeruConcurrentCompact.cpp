@@ -0,0 +1,393 @@
+/**
+ * Semeru Memory Server - compact the Regions fully evicted by the CPU server, out of the STW window.
+ *
+ */
+
+#include "precompiled.hpp"
+#include "gc/g1/g1SemeruCollectedHeap.hpp"
+#include "gc/g1/g1SemeruColdStore.hpp"
+#include "gc/g1/g1SemeruCompressor.hpp"
+#include "gc/g1/g1SemeruConcurrentCompact.hpp"
+#include "gc/g1/g1SemeruCounters.hpp"
+#include "gc/g1/g1SemeruForwardTable.hpp"
+#include "gc/g1/g1SemeruRemoteRefProcessor.hpp"
+#include "gc/g1/g1SemeruSTWCompact.inline.hpp"
+#include "gc/g1/g1SemeruStringDedup.hpp"
+#include "gc/g1/SemeruHeapRegion.inline.hpp"
+#include "gc/shared/rdmaMetaLayout.hpp"
+#include "gc/shared/rdmaStructure.hpp"
+#include "gc/shared/workgroup.hpp"
+#include "jfr/jfrEvents.hpp"
+#include "logging/log.hpp"
+#include "memory/resourceArea.hpp"
+#include "oops/oop.inline.hpp"
+#include "runtime/atomic.hpp"
+#include "runtime/orderAccess.hpp"
+#include "runtime/rdma_comm.hpp"
+#include "utilities/copy.hpp"
+#include "utilities/growableArray.hpp"
+#include "utilities/quickSort.hpp"
+
+
+G1SemeruConcurrentCompact::G1SemeruConcurrentCompact(G1SemeruSTWCompact* semeru_sc) :
+  _semeru_sc(semeru_sc),
+  _compressor(NULL),
+  _num_images(0),
+  _claimable_set(false)
+{
+  _compressor = new G1SemeruCompressor(SemeruHeapRegion::SemeruGrainWords);
+}
+
+G1SemeruConcurrentCompact::~G1SemeruConcurrentCompact() {
+  for (uint i = 0; i < _num_images; i++) {
+    discard_image(&_images[i]);
+  }
+  delete _compressor;
+}
+
+
+bool G1SemeruConcurrentCompact::has_image(SemeruHeapRegion* hr) const {
+  for (uint i = 0; i < _num_images; i++) {
+    if (_images[i]._region == hr) {
+      return true;
+    }
+  }
+  return false;
+}
+
+
+/**
+ * Semeru MS - The CPU atomics on the state words are only safe with the RDMA atomics of the CPU server
+ *  under IBV_ATOMIC_GLOB. Without it, the words are left to the CPU server and the grants work as before.
+ */
+bool G1SemeruConcurrentCompact::by_state_words(flags_of_cpu_server_state* cpu_server_flags) {
+  if (!cpu_server_flags->_region_state_atomics || !semeru_rdma_atomic_glob()) {
+    return false;
+  }
+
+  if (!_claimable_set) {
+    _semeru_sc->_semeru_h->_region_states->set_claimable(SemeruMetaLayout::num_regions());
+    _claimable_set = true;
+    log_info(semeru, mem_compact)("%s, the granted Regions are claimed by their state words.", __func__);
+  }
+  return true;
+}
+
+
+/**
+ * Semeru MS - The grants are written by the CPU server at the end of its STW window.
+ *  Only the Regions scanned by the concurrent tracing have a complete alive bitmap.
+ *  The grants not processed before the next STW window are compacted there as before.
+ */
+uint G1SemeruConcurrentCompact::compact_granted_regions(flags_of_cpu_server_state* cpu_server_flags) {
+  G1SemeruCounters* counters = _semeru_sc->_semeru_h->semeru_counters();
+  jlong compact_start = os::elapsed_counter();
+  uint built = 0;
+  size_t num_granted = cpu_server_flags->_num_granted_regions;
+  OrderAccess::loadload();
+  bool by_state = by_state_words(cpu_server_flags);
+  region_state_words* states = _semeru_sc->_semeru_h->_region_states;
+
+  for (size_t i = 0; i < num_granted && _num_images < SEMERU_MAX_GRANTED_REGIONS; i++) {
+    if (cpu_server_flags->_is_cpu_server_in_stw) {
+      break;
+    }
+    if (cpu_server_flags->_grant_state[i] != flags_of_cpu_server_state::grant_open) {
+      continue;
+    }
+
+    SemeruHeapRegion* hr = _semeru_sc->_semeru_h->region_at_or_null(cpu_server_flags->_granted_regions[i]);
+    if (hr == NULL || hr->is_humongous() || hr->is_pinned() || !hr->is_region_cm_scanned() ||
+        hr->alive_ratio() >= COMPACT_THRESHOLD || hr->fwd_table() != NULL || has_image(hr)) {
+      continue;
+    }
+
+    // A grant the CPU server already took back is skipped, it doesn't wait for the compaction.
+    if (by_state && !states->transit(hr->hrm_index(), region_state_words::granted, region_state_words::compacting)) {
+      continue;
+    }
+
+    EventSemeruRegionCompaction evt;
+    G1SemeruColdStore::restore_region(hr);
+    if (build_image(hr, cpu_server_flags)) {
+      built++;
+      counters->inc_compacted_region(hr->marked_alive_bytes());
+      if (evt.should_commit()) {
+        evt.set_index(hr->hrm_index());
+        evt.set_liveBytes(hr->marked_alive_bytes());
+        evt.set_chunked(false);
+        evt.set_concurrent(true);
+        evt.commit();
+      }
+      if (by_state && !states->transit(hr->hrm_index(), region_state_words::compacting, region_state_words::compacted)) {
+        log_debug(semeru, mem_compact)("%s, Region[0x%x] is taken back by the CPU server, its image will be discarded",
+                                       __func__, hr->hrm_index());
+      }
+    } else if (by_state) {
+      states->transit(hr->hrm_index(), region_state_words::compacting, region_state_words::granted);
+    }
+  }
+
+  if (built > 0) {
+    counters->add_compact_ticks(os::elapsed_counter() - compact_start);
+    counters->update();
+    log_debug(semeru, mem_compact)("%s, built the compacted images of 0x%x granted Regions", __func__, built);
+  }
+  return built;
+}
+
+
+/**
+ * Phase#1 to #3 of the Compressor mode, into the shadow. The Region is only read.
+ * False if the Region has dead referents but no slot is left to report them.
+ */
+bool G1SemeruConcurrentCompact::build_image(SemeruHeapRegion* hr, flags_of_cpu_server_state* cpu_server_flags) {
+  Image* img = &_images[_num_images];
+  G1CMBitMap* alive_bitmap = hr->alive_bitmap();
+  G1SemeruDeadReferents dead_refs;
+
+  if (!dead_refs.collect(hr, alive_bitmap, cpu_server_flags, _semeru_sc->_semeru_h->mem_server_flags())) {
+    return false;   // compacted in the STW window, after the CPU server takes the reported chains.
+  }
+
+  img->_region    = hr;
+  img->_new_top   = _compressor->summarize_in_place(hr, alive_bitmap);
+  img->_dense_end = img->_new_top;
+  img->_committed = false;
+
+  HeapWord* top = hr->top();
+  for (HeapWord* addr = alive_bitmap->get_next_marked_addr(hr->bottom(), top); addr < top;
+       addr = alive_bitmap->get_next_marked_addr(addr + oop(addr)->size(), top)) {
+    if (_compressor->new_addr(addr) != addr) {
+      img->_dense_end = _compressor->new_addr(addr);
+      break;
+    }
+  }
+  img->_shadow  = NEW_C_HEAP_ARRAY(HeapWord, MAX2(pointer_delta(img->_new_top, hr->bottom()), (size_t)1), mtGC);
+
+  // All the alive objects, the STW compaction may need any of them.
+  img->_fwd_table = G1SemeruForwardTable::create(hr, alive_bitmap, alive_bitmap, _compressor);
+
+  img->_inter_region_refs = new SemeruCompactTaskQueue();
+  img->_inter_region_refs->initialize();
+
+  G1SemeruAdjustClosure adjust_pointer(hr, img->_inter_region_refs, _compressor);
+  _compressor->compact_to_shadow(hr, alive_bitmap, &adjust_pointer, img->_shadow);
+  _semeru_sc->_semeru_h->string_dedup()->apply_in_shadow(hr, _compressor, img->_shadow);
+
+  img->_has_ref_chain = !dead_refs.is_empty();
+  if (img->_has_ref_chain) {
+    dead_refs.clear_in_shadow(_compressor, img->_shadow);
+    img->_ref_chain_slot = dead_refs.slot();
+    img->_ref_chain_head = dead_refs.head();
+    img->_ref_chain_tail = dead_refs.tail();
+  }
+
+  _num_images++;
+
+  log_debug(semeru, mem_compact)("%s, Region[0x%x] compacted into the shadow, top 0x%lx -> 0x%lx", __func__,
+                                 hr->hrm_index(), (size_t)hr->top(), (size_t)img->_new_top);
+  return true;
+}
+
+
+/**
+ * Semeru MS - Commit the images of the granted Regions, one Region per worker.
+ *  The Regions are disjoint, so are their BOT entries.
+ */
+class G1SemeruCommitImagesTask : public AbstractGangTask {
+  G1SemeruConcurrentCompact* _cc;
+  volatile uint              _next_image;
+
+public:
+  G1SemeruCommitImagesTask(G1SemeruConcurrentCompact* cc) :
+    AbstractGangTask("Semeru MS Commit Compacted Images"),
+    _cc(cc),
+    _next_image(0) { }
+
+  void work(uint worker_id) {
+    for (uint i = Atomic::add(1u, &_next_image) - 1; i < _cc->_num_images; i = Atomic::add(1u, &_next_image) - 1) {
+      G1SemeruConcurrentCompact::Image* img = &_cc->_images[i];
+      if (img->_committed) {
+        _cc->commit_image(img);
+      }
+    }
+  }
+};
+
+
+/**
+ * Semeru MS - Invoked by the CM thread at the start of the STW window, before the compaction workers run.
+ *  The CPU server waits for MEM_SERVER_NOTIFY_COMPACT_START to release the committed Regions.
+ */
+uint G1SemeruConcurrentCompact::commit(flags_of_cpu_server_state* cpu_server_flags, flags_of_mem_server_state* mem_server_flags) {
+  uint committed = 0;
+  bool by_state = by_state_words(cpu_server_flags);
+
+  for (uint i = 0; i < _num_images; i++) {
+    Image* img = &_images[i];
+    img->_committed = cpu_server_flags->grant_state_of(img->_region->hrm_index()) == flags_of_cpu_server_state::grant_committed;
+    if (by_state && region_state_words::state_of(_semeru_sc->_semeru_h->_region_states->word(img->_region->hrm_index())) !=
+                    region_state_words::compacted) {
+      img->_committed = false;    // taken back by the CPU server
+    }
+    const uint32_t* pages = NULL;
+    uint num_pages = cpu_server_flags->reconciled_pages_of(img->_region->hrm_index(), &pages);
+    if (img->_committed && num_pages > 0) {
+      img->_committed = reconcile_image(img, pages, num_pages);
+    }
+    if (img->_committed) {
+      committed++;
+    }
+  }
+
+  if (committed > 1) {
+    WorkGang* workers = _semeru_sc->_concurrent_workers;
+    G1SemeruCommitImagesTask commit_task(this);
+    workers->run_task(&commit_task, MIN2(committed, workers->active_workers()));
+  } else if (committed == 1) {
+    G1SemeruCommitImagesTask commit_task(this);
+    commit_task.work(0);
+  }
+
+  // The phase#4 of worker 0 updates the inter-Region fields.
+  SemeruCompactTaskQueue* queue = _semeru_sc->_compact_task_queues->queue(0);
+  for (uint i = 0; i < _num_images; i++) {
+    Image* img = &_images[i];
+
+    if (img->_committed) {
+      // Relink the chunks, no ref is copied.
+      img->_inter_region_refs->transfer_to(queue);
+      _semeru_sc->_semeru_h->_compacted_region_ring->push(img->_region->hrm_index());
+      if (img->_has_ref_chain) {
+        G1SemeruDeadReferents::publish(mem_server_flags, img->_ref_chain_slot, img->_ref_chain_head, img->_ref_chain_tail);
+      }
+    } else {
+      log_debug(semeru, mem_compact)("%s, Region[0x%x] grant is revoked, discard its image", __func__, img->_region->hrm_index());
+      if (img->_has_ref_chain) {
+        G1SemeruDeadReferents::publish(mem_server_flags, img->_ref_chain_slot, NULL, NULL);
+      }
+    }
+    discard_image(img);
+  }
+  if (committed > 0) {
+    _semeru_sc->record_rewritten_pages();
+  }
+
+  _num_images = 0;
+  return committed;
+}
+
+
+static int compare_page_index(uint32_t* a, uint32_t* b) {
+  return *a < *b ? -1 : (*a > *b ? 1 : 0);
+}
+
+static bool is_in_moved(GrowableArray<MemRegion>* moved, HeapWord* addr) {
+  int lo = 0;
+  int hi = moved->length() - 1;
+  while (lo <= hi) {
+    int mid = (lo + hi) / 2;
+    MemRegion mr = moved->at(mid);
+    if (addr < mr.start()) {
+      hi = mid - 1;
+    } else if (addr >= mr.end()) {
+      lo = mid + 1;
+    } else {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * Semeru MS - The CPU server swapped some pages of the granted Region in and wrote them back since the grant.
+ *  The kernel of the CPU server waited for their writes before it closed the grant, they are final here.
+ *
+ * 1) The object sizes and the liveness don't change, so don't the new addresses. Summarize the Region again.
+ * 2) Copy the alive objects on the written pages into the shadow again, their fields adjusted again.
+ * 3) Their inter-Region fields recorded by the image are replaced by those found now.
+ * The cleared referents of the image could be written back by the CPU server, such an image isn't reconciled.
+ */
+bool G1SemeruConcurrentCompact::reconcile_image(Image* img, const uint32_t* pages, uint num_pages) {
+  SemeruHeapRegion* hr = img->_region;
+  G1CMBitMap* alive_bitmap = hr->alive_bitmap();
+
+  if (img->_has_ref_chain || _compressor->summarize_in_place(hr, alive_bitmap) != img->_new_top) {
+    log_debug(semeru, mem_compact)("%s, Region[0x%x] can't be reconciled, discard its image", __func__, hr->hrm_index());
+    return false;
+  }
+
+  ResourceMark rm;
+  uint32_t* sorted = NEW_RESOURCE_ARRAY(uint32_t, num_pages);
+  memcpy(sorted, pages, num_pages * sizeof(uint32_t));
+  QuickSort::sort(sorted, num_pages, compare_page_index, false);
+
+  GrowableArray<MemRegion>* moved = new GrowableArray<MemRegion>(num_pages * 4);
+  SemeruCompactTaskQueue* refs = new SemeruCompactTaskQueue();
+  refs->initialize();
+  G1SemeruAdjustClosure adjust_pointer(hr, refs, _compressor);
+  size_t copied = _compressor->recompact_pages_to_shadow(hr, alive_bitmap, &adjust_pointer, img->_shadow, sorted, num_pages, moved);
+
+  // Keep the recorded fields of the other objects.
+  size_t dropped = 0;
+  StarTask ref;
+  while (img->_inter_region_refs->pop_local(ref)) {
+    HeapWord* field = ref.is_narrow() ? (HeapWord*)(narrowOop*)ref : (HeapWord*)(oop*)ref;
+    if (is_in_moved(moved, field)) {
+      dropped++;
+    } else {
+      refs->push(ref);
+    }
+  }
+  delete img->_inter_region_refs;
+  img->_inter_region_refs = refs;
+
+  log_debug(semeru, mem_compact)("%s, Region[0x%x] 0x%x written pages, 0x%lx objects copied again, 0x%lx inter-Region fields replaced",
+                                 __func__, hr->hrm_index(), num_pages, copied, dropped);
+  return true;
+}
+
+
+/**
+ * The BOT entries below the dense prefix end are intact, the rebuild starts from there.
+ */
+void G1SemeruConcurrentCompact::commit_image(Image* img) {
+  SemeruHeapRegion* hr = img->_region;
+  HeapWord* bottom = hr->bottom();
+
+  assert(hr->fwd_table() == NULL, "Region[0x%x] is compacted twice in one compaction window.", hr->hrm_index());
+
+  Copy::aligned_disjoint_words(img->_shadow, bottom, pointer_delta(img->_new_top, bottom));
+
+  size_t bot_index;
+  HeapWord* threshold = hr->initialize_threshold_at(img->_dense_end, &bot_index);
+  for (HeapWord* addr = img->_dense_end; addr < img->_new_top; addr += oop(addr)->size()) {
+    threshold = hr->cross_threshold_at(threshold, &bot_index, addr, addr + oop(addr)->size());
+  }
+  hr->set_threshold(threshold, bot_index);
+
+  hr->set_compaction_top(img->_new_top);
+  hr->complete_compaction();
+  hr->record_bot_update(img->_dense_end);
+  hr->record_compaction_checksums();
+
+  hr->set_fwd_table(img->_fwd_table);
+  img->_fwd_table = NULL;   // deleted with the STW compaction's tables
+
+  log_debug(semeru, mem_compact)("%s, Region[0x%x] is committed, top 0x%lx, BOT rebuilt from 0x%lx", __func__,
+                                 hr->hrm_index(), (size_t)hr->top(), (size_t)img->_dense_end);
+}
+
+
+void G1SemeruConcurrentCompact::discard_image(Image* img) {
+  FREE_C_HEAP_ARRAY(HeapWord, img->_shadow);
+  delete img->_fwd_table;
+  delete img->_inter_region_refs;
+
+  img->_region            = NULL;
+  img->_shadow            = NULL;
+  img->_fwd_table         = NULL;
+  img->_inter_region_refs = NULL;
+  img->_has_ref_chain     = false;
+}
@@ -0,0 +1,89 @@
+/**
+ * Semeru Memory Server - compact the Regions fully evicted by the CPU server, out of the STW window.
+ *
+ */
+
+#ifndef SHARE_GC_G1_G1_SEMERU_CONCURRENTCOMPACT_HPP
+#define SHARE_GC_G1_G1_SEMERU_CONCURRENTCOMPACT_HPP
+
+#include "gc/shared/rdmaStructure.hpp"
+#include "gc/shared/taskqueue.hpp"
+#include "memory/allocation.hpp"
+#include "utilities/globalDefinitions.hpp"
+
+class flags_of_cpu_server_state;
+class flags_of_mem_server_state;
+class G1SemeruCompressor;
+class G1SemeruForwardTable;
+class G1SemeruSTWCompact;
+class SemeruHeapRegion;
+
+
+/**
+ * Semeru MS - The concurrent compaction, -XX:+SemeruConcurrentCompact on the CPU server.
+ *
+ * The CPU server grants the fully evicted Regions of the MS CSet at the end of its STW window.
+ * The kernel of the CPU server fences them and records their swap-ins and swap-outs by page.
+ * The Region's pages here are the swap backing of the CPU server, they are only written by its swap-outs :
+ *
+ * 1) compact_granted_regions(), after the concurrent tracing, by the CM thread.
+ *    Slide each granted and scanned Region into itself in the Compressor mode,
+ *    and build its compacted image into a shadow buffer. The inter-Region fields are recorded by their new addresses.
+ *    The dead referents are cleared in the shadow too, see G1SemeruDeadReferents.
+ * 2) commit(), at the start of the next STW window, before MEM_SERVER_NOTIFY_COMPACT_START.
+ *    a. Committed, the CPU server didn't touch the Region, or wrote some of its pages back.
+ *       The alive objects on the written pages are copied into the image again, see reconcile_image().
+ *       Copy the image back and rebuild the BOT
+ *       from the first moved object, one Region per worker, see G1SemeruCommitImagesTask.
+ *       The CPU server pulls only the rebuilt BOT cards, see SemeruHeapRegion::record_bot_update().
+ *       Hand the forwarding table and the inter-Region fields to the STW compaction, which skips the Region.
+ *       Report the chain of the cleared References.
+ *    b. Revoked, a page is still swapped in, or the image can't be reconciled. Discard the image and drop the chain.
+ *       The Region is compacted in the STW window as before.
+ *
+ * The forwarding table records all the alive objects, the targets referenced after the grant are covered too.
+ */
+class G1SemeruConcurrentCompact : public CHeapObj<mtGC> {
+  friend class G1SemeruCommitImagesTask;
+
+  struct Image {
+    SemeruHeapRegion*        _region;
+    HeapWord*                _shadow;             // compacted copy of [bottom, _new_top)
+    HeapWord*                _new_top;
+    HeapWord*                _dense_end;          // the objects below it are not moved, nor their BOT entries
+    bool                     _committed;
+    G1SemeruForwardTable*    _fwd_table;
+    SemeruCompactTaskQueue*  _inter_region_refs;  // new addresses of the inter-Region fields
+    bool                     _has_ref_chain;      // the cleared References, see G1SemeruDeadReferents
+    size_t                   _ref_chain_slot;
+    HeapWord*                _ref_chain_head;
+    HeapWord*                _ref_chain_tail;
+  };
+
+  G1SemeruSTWCompact*  _semeru_sc;
+  G1SemeruCompressor*  _compressor;
+  Image                _images[SEMERU_MAX_GRANTED_REGIONS];
+  uint                 _num_images;
+  bool                 _claimable_set;      // the Region state words are claimable, see region_state_words
+
+  // The grants are also claimed by the Region state words, -XX:+SemeruRegionStateAtomics on the CPU server.
+  bool by_state_words(flags_of_cpu_server_state* cpu_server_flags);
+
+  bool has_image(SemeruHeapRegion* hr) const;
+  bool build_image(SemeruHeapRegion* hr, flags_of_cpu_server_state* cpu_server_flags);
+  bool reconcile_image(Image* img, const uint32_t* pages, uint num_pages);
+  void commit_image(Image* img);
+  void discard_image(Image* img);
+
+public:
+  G1SemeruConcurrentCompact(G1SemeruSTWCompact* semeru_sc);
+  ~G1SemeruConcurrentCompact();
+
+  // Build the images of the granted Regions scanned by the concurrent tracing. Stop at the STW window.
+  uint compact_granted_regions(flags_of_cpu_server_state* cpu_server_flags);
+
+  // Copy the committed images back, discard the revoked ones. Return the number of committed Regions.
+  uint commit(flags_of_cpu_server_state* cpu_server_flags, flags_of_mem_server_state* mem_server_flags);
+};
+
+#endif // SHARE_GC_G1_G1_SEMERU_CONCURRENTCOMPACT_HPP
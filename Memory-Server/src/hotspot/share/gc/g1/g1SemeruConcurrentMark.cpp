@@ -57,16 +57,25 @@
 #include "runtime/atomic.hpp"
 #include "runtime/handles.inline.hpp"
 #include "runtime/java.hpp"
+#include "runtime/mutexLocker.hpp"
+#include "runtime/os.hpp"
 #include "runtime/prefetch.inline.hpp"
+#include "runtime/rdma_comm.hpp"
 #include "services/memTracker.hpp"
 #include "utilities/align.hpp"
 #include "utilities/growableArray.hpp"
+#include "utilities/quickSort.hpp"
 
 // Semeru
 #include "gc/g1/g1SemeruCollectedHeap.inline.hpp"
+#include "gc/g1/g1SemeruColdStore.hpp"
 #include "gc/g1/g1SemeruConcurrentMark.hpp"
 #include "gc/g1/g1SemeruConcurrentMark.inline.hpp"
 #include "gc/g1/g1SemeruConcurrentMarkThread.inline.hpp"
+#include "gc/g1/g1SemeruCounters.hpp"
+#include "gc/g1/g1SemeruRemoteRefProcessor.hpp"
+#include "gc/g1/g1SemeruStringDedup.hpp"
+#include <sys/mman.h>
 #include <unistd.h>
 #include "gc/g1/SemeruHeapRegion.inline.hpp"
 #include "gc/g1/SemeruHeapRegionSet.inline.hpp"
@@ -76,7 +85,12 @@
 G1SemeruCMMarkStack::G1SemeruCMMarkStack() :
 	_max_chunk_capacity(0),
 	_base(NULL),
-	_chunk_capacity(0) {
+	_chunk_capacity(0),
+	_spill_base(NULL),
+	_spill_capacity(0),
+	_spilled_chunks(0),
+	_spill_hwm(0),
+	_spill_lock(NULL) {
 	set_empty();
 }
 
@@ -96,6 +110,9 @@ bool G1SemeruCMMarkStack::resize(size_t new_capacity) {
 		MmapArrayAllocator<TaskQueueEntryChunk>::free(_base, _chunk_capacity);
 	}
 
+	// The chunks are touched by the GC workers, bound to the NIC's node with them.
+	semeru_numa_bind_memory((char*)new_base, new_capacity * sizeof(TaskQueueEntryChunk));
+
 	_base = new_base;
 	_chunk_capacity = new_capacity;
 	set_empty();
@@ -123,9 +140,50 @@ bool G1SemeruCMMarkStack::initialize(size_t initial_capacity, size_t max_capacit
 	log_debug(gc)("Initialize mark stack with " SIZE_FORMAT " chunks, maximum " SIZE_FORMAT,
 								initial_chunk_capacity, _max_chunk_capacity);
 
+	if (SemeruMarkStackSpillDir != NULL) {
+		initialize_spill();
+	}
+
 	return resize(initial_chunk_capacity);
 }
 
+/**
+ * Semeru MS - The spill file is unlinked once mapped, it goes away with the memory server process.
+ */
+bool G1SemeruCMMarkStack::initialize_spill() {
+	char path[JVM_MAXPATHLEN];
+	jio_snprintf(path, sizeof(path), "%s/semeru_mark_stack_XXXXXX", SemeruMarkStackSpillDir);
+
+	int fd = mkstemp(path);
+	if (fd < 0) {
+		log_warning(gc)("Failed to create the mark stack spill file in %s, %s.", SemeruMarkStackSpillDir, os::strerror(errno));
+		return false;
+	}
+	unlink(path);
+
+	size_t capacity = SemeruMarkStackSpillSize / sizeof(TaskQueueEntryChunk);
+	size_t size = capacity * sizeof(TaskQueueEntryChunk);
+	if (capacity == 0 || ftruncate(fd, (off_t)size) != 0) {
+		log_warning(gc)("Failed to resize the mark stack spill file to " SIZE_FORMAT "B.", size);
+		close(fd);
+		return false;
+	}
+
+	void* base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_NORESERVE, fd, 0);
+	close(fd);
+	if (base == MAP_FAILED) {
+		log_warning(gc)("Failed to map the mark stack spill file of " SIZE_FORMAT "B, %s.", size, os::strerror(errno));
+		return false;
+	}
+
+	_spill_base = (TaskQueueEntryChunk*)base;
+	_spill_capacity = capacity;
+	_spill_lock = new Mutex(Mutex::leaf, "Semeru mark stack spill lock", true, Monitor::_safepoint_check_never);
+
+	log_info(gc)("Mark stack spills up to " SIZE_FORMAT " chunks to %s.", _spill_capacity, SemeruMarkStackSpillDir);
+	return true;
+}
+
 void G1SemeruCMMarkStack::expand() {
 	if (_chunk_capacity == _max_chunk_capacity) {
 		log_debug(gc)("Can not expand overflow mark stack further, already at maximum capacity of " SIZE_FORMAT " chunks.", _chunk_capacity);
@@ -148,6 +206,10 @@ G1SemeruCMMarkStack::~G1SemeruCMMarkStack() {
 	if (_base != NULL) {
 		MmapArrayAllocator<TaskQueueEntryChunk>::free(_base, _chunk_capacity);
 	}
+	if (_spill_base != NULL) {
+		munmap((char*)_spill_base, _spill_capacity * sizeof(TaskQueueEntryChunk));
+		delete _spill_lock;
+	}
 }
 
 void G1SemeruCMMarkStack::add_chunk_to_list(TaskQueueEntryChunk* volatile* list, TaskQueueEntryChunk* elem) {
@@ -215,7 +277,8 @@ bool G1SemeruCMMarkStack::par_push_chunk(G1SemeruTaskQueueEntry* ptr_arr) {
 		new_chunk = allocate_new_chunk();
 
 		if (new_chunk == NULL) {
-			return false;
+			// Out of the chunks in memory, spill the buffer instead of overflowing.
+			return _spill_base != NULL && spill_chunk(ptr_arr);
 		}
 	}
 
@@ -230,7 +293,7 @@ bool G1SemeruCMMarkStack::par_pop_chunk(G1SemeruTaskQueueEntry* ptr_arr) {
 	TaskQueueEntryChunk* cur = remove_chunk_from_chunk_list();
 
 	if (cur == NULL) {
-		return false;
+		return _spill_base != NULL && unspill_chunk(ptr_arr);
 	}
 
 	Copy::conjoint_memory_atomic(cur->data, ptr_arr, EntriesPerChunk * sizeof(G1SemeruTaskQueueEntry));
@@ -239,11 +302,49 @@ bool G1SemeruCMMarkStack::par_pop_chunk(G1SemeruTaskQueueEntry* ptr_arr) {
 	return true;
 }
 
+/**
+ * Semeru MS - Push a chunk to the top of the spill stack.
+ *  The copy is done under the lock, the spill tier is the slow path of an overflowing mark stack.
+ */
+bool G1SemeruCMMarkStack::spill_chunk(G1SemeruTaskQueueEntry* ptr_arr) {
+	MutexLockerEx x(_spill_lock, Mutex::_no_safepoint_check_flag);
+	if (_spilled_chunks == _spill_capacity) {
+		return false;
+	}
+
+	if (_spill_hwm == 0) {
+		log_debug(gc)("Mark stack is full at " SIZE_FORMAT " chunks, spill to %s.", _chunk_capacity, SemeruMarkStackSpillDir);
+	}
+	Copy::conjoint_memory_atomic(ptr_arr, _spill_base[_spilled_chunks].data, EntriesPerChunk * sizeof(G1SemeruTaskQueueEntry));
+	_spilled_chunks++;
+	_spill_hwm = MAX2(_spill_hwm, (size_t)_spilled_chunks);
+	return true;
+}
+
+bool G1SemeruCMMarkStack::unspill_chunk(G1SemeruTaskQueueEntry* ptr_arr) {
+	MutexLockerEx x(_spill_lock, Mutex::_no_safepoint_check_flag);
+	if (_spilled_chunks == 0) {
+		return false;
+	}
+
+	_spilled_chunks--;
+	Copy::conjoint_memory_atomic(_spill_base[_spilled_chunks].data, ptr_arr, EntriesPerChunk * sizeof(G1SemeruTaskQueueEntry));
+	return true;
+}
+
 void G1SemeruCMMarkStack::set_empty() {
 	_chunks_in_chunk_list = 0;
 	_hwm = 0;
 	_chunk_list = NULL;
 	_free_list = NULL;
+
+	// Punch the spilled chunks out of the spill file, they are never read again.
+	if (_spill_hwm > 0) {
+		log_debug(gc)("Mark stack spilled at most " SIZE_FORMAT " chunks.", _spill_hwm);
+		madvise((char*)_spill_base, _spill_hwm * sizeof(TaskQueueEntryChunk), MADV_REMOVE);
+	}
+	_spilled_chunks = 0;
+	_spill_hwm = 0;
 }
 
 
@@ -433,6 +534,68 @@ SemeruHeapRegion* G1SemeruCMCSetRegions::claim_cm_scanned_next() {
 	return NULL;
 }
 
+/**
+ * Semeru MS - Garbage first.
+ *
+ * The efficiency of compacting a Region is its reclaimable bytes per the estimated cost.
+ * The cost is dominated by copying the alive objects and updating their references,
+ * plus the fixed work of a Region, scanning its alive bitmap and syncing it to the CPU server.
+ * The liveness is the alive_ratio of the last tracing, 1.0 for a failed scan.
+ * The alive humongous and the pinned Regions aren't moved, they reclaim nothing.
+ */
+struct SemeruCompactCandidate {
+	SemeruHeapRegion* _hr;
+	double            _efficiency;
+};
+
+static double semeru_compact_efficiency(SemeruHeapRegion* hr) {
+	double alive = MIN2(MAX2(hr->alive_ratio(), 0.0), 1.0);
+	if (hr->is_pinned() || (hr->is_humongous() && alive > 0.0)) {
+		return 0.0;
+	}
+	// The fixed work of a Region, as a fraction of copying the whole Region.
+	const double region_overhead = 1.0 / 32;
+	return (1.0 - alive) / (alive + region_overhead);
+}
+
+// The most efficient first.
+static int compare_compact_efficiency(SemeruCompactCandidate* a, SemeruCompactCandidate* b) {
+	if (a->_efficiency != b->_efficiency) {
+		return a->_efficiency > b->_efficiency ? -1 : 1;
+	}
+	// The scanning order otherwise.
+	return a->_hr->hrm_index() < b->_hr->hrm_index() ? -1 : (a->_hr->hrm_index() > b->_hr->hrm_index() ? 1 : 0);
+}
+
+/**
+ * Reorder the slots [_claimed_cm_scanned_regions, _num_cm_scanned_regions) of the ring.
+ * The unclaimed Regions left by the last budget are reordered with the new ones.
+ */
+void G1SemeruCMCSetRegions::order_unclaimed_cm_scanned_regions() {
+	size_t claimed = _claimed_cm_scanned_regions;
+	size_t num = _num_cm_scanned_regions;
+	if (num <= claimed + 1) {
+		return;
+	}
+
+	size_t n = num - claimed;
+	SemeruCompactCandidate* candidates = NEW_C_HEAP_ARRAY(SemeruCompactCandidate, n, mtGC);
+	for (size_t i = 0; i < n; i++) {
+		SemeruHeapRegion* hr = _cm_scanned_regions[(claimed + i) % _max_regions];
+		candidates[i]._hr = hr;
+		candidates[i]._efficiency = semeru_compact_efficiency(hr);
+	}
+	QuickSort::sort(candidates, n, compare_compact_efficiency, false);
+
+	for (size_t i = 0; i < n; i++) {
+		_cm_scanned_regions[(claimed + i) % _max_regions] = candidates[i]._hr;
+	}
+	log_debug(semeru, mem_compact)("%s, 0x%lx Regions, the first Region[0x%x] alive_ratio %f, the last Region[0x%x] alive_ratio %f",
+																	__func__, n, candidates[0]._hr->hrm_index(), candidates[0]._hr->alive_ratio(),
+																	candidates[n - 1]._hr->hrm_index(), candidates[n - 1]._hr->alive_ratio());
+	FREE_C_HEAP_ARRAY(SemeruCompactCandidate, candidates);
+}
+
 /**
  * Claim a freshly evicted region to concurrent tracing in Memory Server.
  * 1) All the data of the Region has been evicted to memory server once.
@@ -463,8 +626,13 @@ SemeruHeapRegion* G1SemeruCMCSetRegions::claim_freshly_evicted_next() {
 			add_freshly_evicted_regions(claimed_region);	// add this region back.
 			// return null directly.
 			// Let the caller to decide what to do.
+		}else if(SemeruIncrementalTracing && claimed_region->is_traced_liveness_valid()){
+			// Path#2, the Region is unchanged since its last tracing, keep its liveness.
+			// return null, the caller claims the next one.
+			claimed_region->restore_traced_liveness();
+			add_cm_scanned_regions(claimed_region);
 		}else{
-			// Path#2, claimed a Region successfully
+			// Path#3, claimed a Region successfully
 			claimed_region->store_write_verion_tag(); // store current version_tag
 
 			log_debug(semeru,mem_trace)("%s, claimed Region[%d], _claimed_freshly_evicted_regions 0x%lx, _num_freshly_evicted_regions 0x%lx", __func__,
@@ -486,6 +654,19 @@ size_t G1SemeruCMCSetRegions::num_freshly_evicted_regions() const {
 	return (size_t)_num_freshly_evicted_regions;
 }
 
+// The claimed counters run ahead of the enqueued ones by the failed claims.
+size_t G1SemeruCMCSetRegions::num_unclaimed_cm_scanned_regions() const {
+	size_t num = _num_cm_scanned_regions;
+	size_t claimed = _claimed_cm_scanned_regions;
+	return num > claimed ? num - claimed : 0;
+}
+
+size_t G1SemeruCMCSetRegions::num_unclaimed_freshly_evicted_regions() const {
+	size_t num = _num_freshly_evicted_regions;
+	size_t claimed = _claimed_freshly_evicted_regions;
+	return num > claimed ? num - claimed : 0;
+}
+
 
 /**
  * [??] This lock is used for Phase control ?
@@ -1244,6 +1425,7 @@ public:
 	void work(uint worker_id) {
 		assert(Thread::current()->is_ConcurrentGC_thread(), "Not a concurrent GC thread");
 		ResourceMark rm;			// [?] What's this resource used for ?
+		semeru_numa_bind_thread();	// -XX:+SemeruNUMABind
 
 		double start_vtime = os::elapsedVTime();
 
@@ -1306,7 +1488,9 @@ public:
  */
 uint G1SemeruConcurrentMark::calc_active_marking_workers() {
 	uint result = 0;
-	if (!UseDynamicNumberOfGCThreads ||
+	if (SemeruAdaptiveConcGCThreads) {
+		result = calc_adaptive_marking_workers();
+	} else if (!UseDynamicNumberOfGCThreads ||
 			(!FLAG_IS_DEFAULT(ConcGCThreads) &&
 			 !ForceDynamicNumberOfGCThreads)) {
 		result = _max_concurrent_workers;
@@ -1325,6 +1509,26 @@ uint G1SemeruConcurrentMark::calc_active_marking_workers() {
 	return result;
 }
 
+/**
+ * Semeru MS - One tracing worker per SemeruRegionsPerConcGCThread freshly evicted Regions in backlog.
+ *  The eviction of the CPU servers fills the backlog, the workers left idle block in the WorkGang
+ *  and leave their cores to the RDMA.
+ *  In the STW window of the CPU server all the workers are taken, the window is the latency critical part.
+ */
+uint G1SemeruConcurrentMark::calc_adaptive_marking_workers() {
+	if (_semeru_h->cpu_server_flags()->_is_cpu_server_in_stw) {
+		return _max_concurrent_workers;
+	}
+
+	size_t backlog = _mem_server_cset.num_unclaimed_freshly_evicted_regions();
+	size_t wanted = (backlog + SemeruRegionsPerConcGCThread - 1) / SemeruRegionsPerConcGCThread;
+	uint result = (uint)MIN2(MAX2(wanted, (size_t)1), (size_t)_max_concurrent_workers);
+
+	log_debug(semeru, mem_trace)("%s, 0x%lx freshly evicted Regions in backlog, %u of %u workers", __func__,
+															 backlog, result, _max_concurrent_workers);
+	return result;
+}
+
 /**
  * Tag : CM - Root Region Scan phase
  * 
@@ -1569,11 +1773,14 @@ void G1SemeruConcurrentMark::semeru_concurrent_marking() {
 
 	// Schedule the multiple concurrent workers to run.
 	//
+	jlong trace_start = os::elapsed_counter();
 	G1SemeruCMConcurrentMarkingTask marking_task(this);
 	_concurrent_workers->run_task(&marking_task);			// The G1SemeruConcurrentMarkThread will wait here until all workers finished.
 
 	// When exit the function, current worker thread will exeit automatically.
 	mem_server_cset()->scan_finished();  // Notify others, current scanning work is finished.
+	_semeru_h->semeru_counters()->add_trace_ticks(os::elapsed_counter() - trace_start);
+	_semeru_h->semeru_counters()->update();
 	print_stats();
 }
 
@@ -2491,6 +2698,7 @@ public:
 	void work(uint worker_id) {
 		G1SemeruCMTask* task = _semeru_cm->task(worker_id);  // Get the real G1SemeruCMTask after assinged worker_id by the task scheduler.
 		task->record_start_time();
+		semeru_numa_bind_thread();	// -XX:+SemeruNUMABind
 		{
 			ResourceMark rm;
 			HandleMark hm;
@@ -2829,9 +3037,11 @@ void G1SemeruConcurrentMark::print_on_error(outputStream* st) const {
  * 			=> cld ？
  * 
  */
-static ReferenceProcessor* get_cm_oop_closure_ref_processor(G1SemeruCollectedHeap* g1h) {
-	ReferenceProcessor* result = g1h->ref_processor_cm();
-	assert(result != NULL, "CM reference processor should not be NULL");
+static ReferenceDiscoverer* get_cm_oop_closure_ref_processor(G1SemeruCollectedHeap* g1h) {
+	// The discovery of the ref_processor_cm() is never enabled, all the referents are traced strongly.
+	// The remote discoverer falls back to it until the CPU server enables -XX:+SemeruRemoteRefProcessing.
+	ReferenceDiscoverer* result = g1h->remote_ref_discoverer();
+	assert(result != NULL, "CM reference discoverer should not be NULL");
 	return result;
 }
 
@@ -2860,6 +3070,10 @@ void G1SemeruCMTask::setup_for_region(SemeruHeapRegion* hr) {
 
 	_region_limit	=	hr->next_top_at_mark_start();  // Semeru memory server abandoned the _finger, updat _region_limit only.
 
+	// The objects swapped out by the CPU server, not in our caches yet.
+	semeru_cxl_sync(hr->bottom(), pointer_delta(_region_limit, hr->bottom(), 1));
+	G1SemeruColdStore::restore(hr->bottom(), _region_limit);
+
 	//_finger       = hr->bottom();		// Semeru memory server CM doesn't use the local _finger.
 	//update_region_limit();
 }
@@ -3097,6 +3311,115 @@ bool G1SemeruCMTask::semeru_ms_regular_clock_call() {
 }
 
 
+/**
+ * Semeru MS - Preemption check of the marking clock.
+ *  The CPU server writes its flags before ringing the doorbell, and the poll_cq thread records the doorbell
+ *  on its recv completion. So a tick only loads the local doorbell sequence, the flags are read when it moved.
+ *  Once the CPU server is in STW, the current Region is given up as a scan failure, alive ratio 1.0,
+ *  and the worker switches to the compaction without waiting for the Region boundary.
+ *  The abort set here only stops the draining, it's cleared by abandon_region_scan().
+ */
+void G1SemeruCMTask::semeru_ms_preempt_if_stw() {
+	recalculate_limits();
+
+	uint32_t doorbell = cpu_server_doorbell();
+	if (doorbell == _seen_doorbell) {
+		return;
+	}
+	_seen_doorbell = doorbell;
+
+	if (has_aborted() || _curr_region == NULL || !_semeru_h->cpu_server_flags()->_is_cpu_server_in_stw) {
+		return;
+	}
+
+	log_debug(semeru,mem_trace)("%s, worker[0x%x] gives up Region[0x%x] for the STW window of CPU server, doorbell 0x%x.",
+																__func__, worker_id(), _curr_region->hrm_index(), doorbell);
+	_curr_region->scan_failure = true;
+	_preempted_by_stw = true;
+	set_has_aborted();
+}
+
+/**
+ * Semeru MS - Append the batched targets to the outbox of this server, -XX:+SemeruMarkMessages.
+ *  The CPU server drains it at the start of its next pause, see G1CollectedHeap::relay_mark_messages().
+ *  A batch without room is dropped, its targets are left to the roots of a later cycle as before.
+ */
+void G1SemeruCMTask::flush_mark_messages() {
+	if (_num_mark_messages == 0) {
+		return;
+	}
+	if (!_semeru_h->_mark_messages->append(_mark_messages, _num_mark_messages)) {
+		log_debug(semeru,mem_trace)("%s, worker[0x%x] dropped %u mark messages on a full outbox.", __func__, worker_id(), _num_mark_messages);
+	}
+	_num_mark_messages = 0;
+}
+
+static int compare_affinity_pages(size_t* a, size_t* b) {
+	return *a < *b ? -1 : (*a > *b ? 1 : 0);
+}
+
+/**
+ * Semeru MS - -XX:+SemeruPageAffinity on the CPU server, see page_affinity_table.
+ *  The roots of a Region are traced one by one : the local queue is drained after each root,
+ *  so the objects marked meanwhile are reached from it. The entries moved to the global stack are
+ *  left to the draining of the Region, their pages don't join the group.
+ */
+void G1SemeruCMTask::trace_affinity_root(oop obj) {
+	_num_affinity_pages    = 0;
+	_tracing_affinity_root = true;
+	make_reference_alive(obj);
+	drain_local_queue(false);
+	_tracing_affinity_root = false;
+	link_affinity_group();
+}
+
+/**
+ * Semeru MS - Link the pages of the current root into a ring, in address order.
+ *  A page already in the group of an earlier root keeps it.
+ */
+void G1SemeruCMTask::link_affinity_group() {
+	page_affinity_table* table = _semeru_h->_page_affinity;
+	uint num = 0;
+
+	for (uint i = 0; i < _num_affinity_pages; i++) {
+		if (table->_next[_affinity_pages[i]] == 0) {
+			_affinity_pages[num++] = _affinity_pages[i];
+		}
+	}
+	_num_affinity_pages = 0;
+	if (num < 2) {
+		return;
+	}
+
+	QuickSort::sort(_affinity_pages, num, compare_affinity_pages, false);
+	for (uint i = 0; i < num; i++) {
+		size_t next = _affinity_pages[(i + 1) % num];
+		table->_next[_affinity_pages[i]] = (int32_t)((intptr_t)next - (intptr_t)_affinity_pages[i]);
+	}
+
+	log_trace(semeru,mem_trace)("%s, worker[0x%x] linked %u pages from 0x%lx in Region[%u]", __func__, worker_id(), num,
+															_affinity_pages[0], _curr_region->hrm_index());
+}
+
+/**
+ * Semeru MS - Drop the entries of _curr_region, it's handled as scanned with failure.
+ */
+void G1SemeruCMTask::abandon_region_scan() {
+	log_debug(semeru,mem_trace)("%s, concurrent tracing for Region[%d] failed. skip it.\n",__func__, _curr_region->hrm_index());
+	_semeru_h->_cld_liveness->set_all(_curr_region->hrm_index());	// the class loaders of the untraced objects are unknown.
+
+	if (_preempted_by_stw) {
+		_preempted_by_stw = false;
+		if (!_semeru_cm->has_overflown() && !_semeru_cm->has_aborted()) {
+			clear_has_aborted();
+		}
+	}
+
+	// Clear the object already pushed into task_queue and stack
+	fault_tolerance_drain_local_queue(); 	// drain the local task_queue
+	falut_tolerance_drain_global_stack();
+}
+
 void G1SemeruCMTask::recalculate_limits() {
 	_real_words_scanned_limit = _words_scanned + words_scanned_period;
 	_words_scanned_limit      = _real_words_scanned_limit;
@@ -3170,7 +3493,7 @@ void G1SemeruCMTask::move_entries_to_global_stack() {
 	G1SemeruTaskQueueEntry task_entry;
 	while (n < G1SemeruCMMarkStack::EntriesPerChunk && _semeru_task_queue->pop_local(task_entry)) {
 		buffer[n] = task_entry;		// Assign the poped entry to the newly created buffer[].
-		assert(_curr_region->is_in_reserved(task_entry.holder_addr()), "All the entries of one Chunk should belong to same Region[%d]", _curr_region->hrm_index() );
+		assert(scan_region_of(task_entry.holder_addr()) == _curr_region, "All the entries of one Chunk should belong to same Region[%d]", _curr_region->hrm_index() );
 		++n;
 	}
 
@@ -3210,7 +3533,7 @@ bool G1SemeruCMTask::get_entries_from_global_stack() {
 	//    The entries will be on claimed by the G1SemeruCMTask who cause the overflow.
 	// 2) The G1SemeruCMTask can steal work from other worker's local queue.
 	if(buffer[0].is_null() == false){
-		SemeruHeapRegion* 	target_region = _semeru_h->hrm()->addr_to_region((HeapWord*)buffer[0].holder_addr());
+		SemeruHeapRegion* 	target_region = scan_region_of(buffer[0].holder_addr());
 		
 		// abandon the entries belonging to a region with scan_failure flag setted.
 		if(target_region->scan_failure){
@@ -3268,7 +3591,7 @@ bool G1SemeruCMTask::get_entries_from_global_stack_may_switch_region() {
 	//    The entries will be on claimed by the G1SemeruCMTask who cause the overflow.
 	// 2) The G1SemeruCMTask can steal work from other worker's local queue.
 	if(buffer[0].is_null() == false){
-		SemeruHeapRegion* 	target_region = _semeru_h->hrm()->addr_to_region((HeapWord*)buffer[0].holder_addr());
+		SemeruHeapRegion* 	target_region = scan_region_of(buffer[0].holder_addr());
 		// abandon the entries belonging to a region with scan_failure flag setted.
 		if(target_region->scan_failure){
 			log_debug(semeru, mem_trace)("%s, find entries belonging to region[0x%x] with scan_failure setted, skip it.",__func__, target_region->hrm_index() );
@@ -3322,7 +3645,7 @@ bool G1SemeruCMTask::delete_entries_from_global_stack() {
 	//    The entries will be on claimed by the G1SemeruCMTask who cause the overflow.
 	// 2) The G1SemeruCMTask can steal work from other worker's local queue.
 	if(buffer[0].is_null() == false){
-		SemeruHeapRegion* 	target_region = _semeru_h->hrm()->addr_to_region((HeapWord*)buffer[0].holder_addr());
+		SemeruHeapRegion* 	target_region = scan_region_of(buffer[0].holder_addr());
 		
 		// abandon the entries belonging to a region with scan_failure flag setted.
 		if(target_region->scan_failure){
@@ -3362,6 +3685,11 @@ void G1SemeruCMTask::drain_local_queue(bool partially) {
 		target_size = 0;  // Drain all the items.
 	}
 
+	if (_prefetch_fifo.distance() > 0) {
+		drain_local_queue_prefetch(target_size);
+		return;
+	}
+
 	if (_semeru_task_queue->size() > target_size) {
 		G1SemeruTaskQueueEntry entry;
 		bool ret = _semeru_task_queue->pop_local(entry);
@@ -3376,6 +3704,36 @@ void G1SemeruCMTask::drain_local_queue(bool partially) {
 	} // end of if
 }
 
+/**
+ * Semeru MS : drain_local_queue() in the prefetch mode.
+ * 1) Pop an entry, prefetch it and append it to the FIFO.
+ * 2) Once the FIFO is full, scan its oldest entry before popping the next one.
+ * 3) When the queue reaches target_size, scan the rest of the FIFO. Their children can be pushed again,
+ *    the queue may end a bit above target_size for a partial draining.
+ * An aborted task pushes the not scanned entries back, they are already marked.
+ */
+void G1SemeruCMTask::drain_local_queue_prefetch(size_t target_size) {
+	G1SemeruTaskQueueEntry entry;
+
+	while (!has_aborted()) {
+		if (_semeru_task_queue->size() > target_size && _semeru_task_queue->pop_local(entry)) {
+			prefetch_task_entry(entry);
+			if (_prefetch_fifo.is_full()) {
+				scan_task_entry(_prefetch_fifo.pop());
+			}
+			_prefetch_fifo.push(entry);
+		} else if (!_prefetch_fifo.is_empty()) {
+			scan_task_entry(_prefetch_fifo.pop());
+		} else {
+			break;
+		}
+	}
+
+	while (!_prefetch_fifo.is_empty()) {
+		push(_prefetch_fifo.pop());
+	}
+}
+
 /**
  * Fault tolerance
  * Drain the task_queue cause of concurrent tracing failure.
@@ -3609,8 +3967,20 @@ void G1SemeruCMTask::print_stats() {
  * 		 	 All the local task queues belong to global : G1SemeruCOncurrentMark->_task_queues.
  * 				
  */
+bool G1SemeruConcurrentMark::mark_stack_push(G1SemeruTaskQueueEntry* arr) {
+	if (!_global_mark_stack.par_push_chunk(arr)) {
+		_semeru_h->semeru_counters()->inc_mark_stack_overflows();
+		set_has_overflown();
+		return false;
+	}
+	_semeru_h->semeru_counters()->note_mark_stack_size(_global_mark_stack.size());
+	return true;
+}
+
 bool G1SemeruConcurrentMark::try_stealing(uint worker_id, G1SemeruTaskQueueEntry& task_entry) {
-	return _task_queues->steal(worker_id, task_entry);
+	bool stolen = _task_queues->steal(worker_id, task_entry);
+	_semeru_h->semeru_counters()->note_steal(worker_id, stolen);
+	return stolen;
 }
 
 /*****************************************************************************
@@ -3826,54 +4196,21 @@ void G1SemeruCMTask::do_semeru_marking_step(double time_target_ms,
 
 
 			// 1.1) Handle humonguous objects separately
-			// [?] _curr_region can the start of a humongous region or in the midle of a humongous obejcts ?
-			//	=> Only scan the first humongous Region occupied by the humongous objects.
-			if (_curr_region->is_humongous()) {
-				
-				assert(_curr_region->used()!=0, "%s, Can't be empty humongous Region. ", __func__);
-
-				// 1) Humongous object is larger than SemeruHeapRegion size/2
-				// 2) Humongous object allocation is always SemeruHeapRegion alignment.
-				// 3) One humongous object can spread several continous HeapRegions.
-				if ( _curr_region->is_starts_humongous() &&  
-							_alive_bitmap->is_marked(_curr_region->bottom())) {
-
-					// The object is marked - apply the closure
-					// [?] Can this detect if this is a oop start address ??
-					//			=> seem no. if not start of a oop, will crash.
-					// [x] Just push this humongous objects into task_queue  ?
-					//			=> [?] The humongous objects is marked when pusing it into StarTask queue
-					//			=> Mark its fields alive and push them into task_queue.
-					// [x] How to mark multiple Regions' alive_bitmap ??
-					//			=> Only mark the start humongous Region as alive in alive_bitmap ?
-					//bitmap_closure.do_addr(_curr_region->bottom());  
-
-					if(semeru_cm_task_do_addr(_curr_region->bottom()) ){
-						// if scan failed,
-						assert(false, "%s, process humongous Region error.",__func__);
-						break; 
-					}
-
-				}
-
-				// 1) After handle a humongous Region, reset all the  fields pointed to this Region.
-				// 2) No need to process continuous humongous Regions, just skip them.
-				//			[?] How to record the already scanned region , Semeru Memory Server CSet ?
-				//							=> Can we use the global  G1SemeruConcurrentMark->_finger ??
-				// Even if this task aborted while scanning the humongous object
-				// we can (and should) give up the current region.
-
-				_curr_region->set_region_cm_scanned();	// also set this continous humongous regions as cm scanned.
-				giveup_current_region();								// _curr_region will be setted as NULL.
-				semeru_ms_abort_marking_if_regular_check_fail();  
-
+			// The humongous object is traced with its starts humongous Region, by the same root path as a normal Region.
+			// Its slices in the continues humongous Regions are claimed by the starts Region, see scan_region_of().
+			// So a continues humongous Region has nothing to trace by itself.
+			if (_curr_region->is_continues_humongous()) {
+				_curr_region->set_region_cm_scanned();
+				giveup_current_region();
+				semeru_ms_abort_marking_if_regular_check_fail();
+				goto claim_region;
 			} else{
 			
-				// 1.2) Process a Normal Region.
+				// 1.2) Process a Normal Region, or a starts humongous Region.
+				// A referenced humongous array is pushed as a whole and sliced by the G1SemeruCMObjArrayProcessor.
 
 				// The source queue for the Region.
 				//HashQueue* cross_region_ref_queue =  _curr_region->cross_region_ref_update_queue();
-				G1CMBitMap *target_oop_bitmap_ptr = _curr_region->target_obj_queue();
 
 				log_debug(semeru,mem_trace)("%s, worker[0x%x] get Region[0x%lx]'s target_oop_bitmap[0x%lx]: bitmap start at 0x%lx. \n",__func__,
 																																					worker_id(),
@@ -3883,17 +4220,14 @@ void G1SemeruCMTask::do_semeru_marking_step(double time_target_ms,
 
 				assert(_curr_region->hrm_index() == _curr_region->_sync_mem_cpu->_cross_region_ref_target_queue->_region_index, "Target oop bitmap and Region aren't match.");
 				
-				// Scan the Region by using target_oop_bitmap as root.
+				// Scan the Region by using target_oop_bitmap as root, by its list or summary.
 				SemeruScanTargetOopClosure scan_target_bipmap(this);
-				_curr_region->semeru_apply_to_marked_objects(target_oop_bitmap_ptr, &scan_target_bipmap);
+				_curr_region->semeru_apply_to_root_objects(&scan_target_bipmap);
 
 				// reset the value on bitmap after scaning.
-				target_oop_bitmap_ptr->clear();
+				_curr_region->clear_root_objects();
 				if(_curr_region->scan_failure){
-					log_debug(semeru,mem_trace)("%s, concurrent tracing for Region[%d] failed. skip it.\n",__func__, _curr_region->hrm_index());
-					// Clear the object already pushed into task_queue and stack
-					fault_tolerance_drain_local_queue(); 	// drain the local task_queue
-					falut_tolerance_drain_global_stack();
+					abandon_region_scan();
 					goto scan_done;
 				}
 			}
@@ -3907,9 +4241,18 @@ void G1SemeruCMTask::do_semeru_marking_step(double time_target_ms,
 			log_debug(semeru,mem_trace)("%s, worker[0x%x]  Drain reference queue for Region[%d]",__func__, worker_id(), _curr_region->hrm_index() );
 			drain_local_queue(false);		// Current G1SemeruCMTask->_semeru_task_queue
 			drain_global_stack(false);  // Get a Chunk from global/overflow _global_mark_stack, ONLY process objects pushed by this G1SemeruCMTask.
+			if(_curr_region->scan_failure){
+				abandon_region_scan();		// preempted by the STW window of CPU server during the draining.
+			}
 
 		scan_done:
 
+			// The targets out of the Region, found by the tracing so far.
+			flush_mark_messages();
+
+			// The Region can grow by the eviction of CPU server during the tracing.
+			_curr_region->note_alive_bitmap_dirty();
+
 			// Transfer the marking statistics to Region.
 			restore_region_mark_stats();
 
@@ -3934,8 +4277,27 @@ void G1SemeruCMTask::do_semeru_marking_step(double time_target_ms,
 																					_curr_region->hrm_index(), _curr_region->write_check_tag_version_val(), (size_t)_curr_region->_write_check_flag );
 
 
+			// The inputs of a complete tracing, the next claim of an unchanged Region reuses its liveness.
+			if(SemeruIncrementalTracing && !_curr_region->scan_failure && !_curr_region->is_override_during_tracing()){
+				_curr_region->record_traced_liveness();
+			}
+
+			// The page groups of a failed tracing are partial, they wait for the next one.
+			if(!_curr_region->scan_failure){
+				_curr_region->publish_page_affinity();
+			}
+
 			_curr_region->set_region_cm_scanned(); // if setted by Remark, it's ok.
-			_semeru_cm->mem_server_cset()->add_cm_scanned_regions(_curr_region);	// Add the scanned Region into scanned_region list.
+			_semeru_h->semeru_counters()->inc_traced_regions();
+			// After the epoch bump, the merges are dropped by any later change of the Region's liveness.
+			if(_dedup_candidates != NULL && _dedup_candidates->is_nonempty() && !_curr_region->scan_failure){
+				_semeru_h->string_dedup()->enqueue_region(_curr_region, _dedup_candidates);
+				_dedup_candidates = NULL;
+			}
+			// A humongous object is never moved, the CPU server frees it by the reported liveness. Keep it out of the compaction.
+			if(!_curr_region->is_humongous()){
+				_semeru_cm->mem_server_cset()->add_cm_scanned_regions(_curr_region);	// Add the scanned Region into scanned_region list.
+			}
 			giveup_current_region();			// finished scanning of current Region.
 
 			// Finish Site#1
@@ -3972,10 +4334,16 @@ void G1SemeruCMTask::do_semeru_marking_step(double time_target_ms,
 			if (claimed_region != NULL) {
 				// Yes, we managed to claim one
 				// #1 Reset the fields of claimed Region.
-				claimed_region->_mem_to_cpu_gc->reset();
+				claimed_region->reset_region_liveness();
+				_semeru_h->_cld_liveness->clear(claimed_region->hrm_index());
 				_semeru_cm->clear_statistics(claimed_region);
-				claimed_region->_alive_bitmap.clear_region(claimed_region); // the bitmap only cover itself.
+				claimed_region->clear_alive_bitmap(); // the bitmap only cover itself.
+				claimed_region->note_alive_bitmap_dirty();
 				claimed_region->scan_failure = false;
+				claimed_region->clear_page_affinity();
+				if(_dedup_candidates != NULL){
+					_dedup_candidates->clear();
+				}
 		
 				// #2 set current G1SemeruCMTask's context to claimed Region.
 				setup_for_region(claimed_region);
@@ -4075,8 +4443,8 @@ out_tracing:
 				// switch processing Region.
 				// Not care about if the entry is an oop or an array slice, we only want its address.
 				// _curr_region should be NULL.
-				if(_curr_region == NULL || !_curr_region->is_in_reserved(entry.holder_addr()) ){
-					_curr_region = _semeru_h->hrm()->addr_to_region((HeapWord*)entry.holder_addr());
+				if(_curr_region == NULL || scan_region_of(entry.holder_addr()) != _curr_region ){
+					_curr_region = scan_region_of(entry.holder_addr());
 					setup_for_region(_curr_region); // switch other fields to this Region.
 				}
 
@@ -4147,7 +4515,7 @@ out_tracing:
 		// hence its should_exit_termination() method will also decide
 		// whether to exit the termination protocol or not.
 		bool finished = (is_serial ||
-										 _semeru_cm->terminator()->offer_termination(this));  // [?] offer 1 termination for each thread.
+										 _semeru_cm->terminator()->offer_semeru_termination(this, _worker_id));  // [?] offer 1 termination for each thread.
 
 
 		double termination_end_time_ms = os::elapsedVTime() * 1000.0;
@@ -4301,6 +4669,12 @@ G1SemeruCMTask::G1SemeruCMTask(uint worker_id,
 	_curr_region(NULL),
 	_finger(NULL),
 	_region_limit(NULL),
+	_dedup_candidates(NULL),
+	_seen_doorbell(0),
+	_preempted_by_stw(false),
+	_num_mark_messages(0),
+	_num_affinity_pages(0),
+	_tracing_affinity_root(false),
 	_words_scanned(0),
 	_words_scanned_limit(0),
 	_real_words_scanned_limit(0),
@@ -4318,6 +4692,7 @@ G1SemeruCMTask::G1SemeruCMTask(uint worker_id,
 {
 	guarantee(task_queue != NULL, "invariant");
 
+	_prefetch_fifo.set_distance(SemeruCMPrefetchDistance);
 	_marking_step_diffs_ms.add(0.5);
 }
 
@@ -42,6 +42,7 @@ class G1CMOopClosure;
 class G1OldTracer;
 class G1RegionToSpaceMapper;
 class G1SurvivorRegions;
+class Mutex;
 
 // Semeru
 class G1SemeruCMTask;
@@ -195,6 +196,21 @@ private:
   volatile size_t _hwm;          // High water mark within the reserved space.
   char _pad4[DEFAULT_CACHE_LINE_SIZE - sizeof(size_t)];
 
+  // Semeru MS - The spill tier, -XX:SemeruMarkStackSpillDir.
+  //  Once the chunks in memory are used up at MarkStackSizeMax, the pushed chunks go to a shared mapping
+  //  of an unlinked file on the local NVMe, kept as a LIFO stack. The page cache writes them back under pressure.
+  //  The chunks in memory are popped first, the spilled ones only when the memory part is empty.
+  TaskQueueEntryChunk* _spill_base;       // NULL if the spill tier is off.
+  size_t _spill_capacity;                 // Number of TaskQueueEntryChunk in the spill file.
+  volatile size_t _spilled_chunks;        // Top of the spill stack.
+  size_t _spill_hwm;                      // Max _spilled_chunks since the last set_empty().
+  Mutex* _spill_lock;
+
+  // Map the spill file. Return false and keep the tier off on failure.
+  bool initialize_spill();
+  bool spill_chunk(G1SemeruTaskQueueEntry* ptr_arr);
+  bool unspill_chunk(G1SemeruTaskQueueEntry* ptr_arr);
+
   // Allocate a new chunk from the reserved memory, using the high water mark. Returns
   // NULL if out of memory.
   TaskQueueEntryChunk* allocate_new_chunk();
@@ -239,7 +255,7 @@ private:
 
   // Return whether the chunk list is empty. Racy due to unsynchronized access to
   // _chunk_list.
-  bool is_empty() const { return _chunk_list == NULL; }
+  bool is_empty() const { return _chunk_list == NULL && _spilled_chunks == 0; }
 
   size_t capacity() const  { return _chunk_capacity; }
 
@@ -248,7 +264,7 @@ private:
 
   // Return the approximate number of oops on this mark stack. Racy due to
   // unsynchronized access to _chunks_in_chunk_list.
-  size_t size() const { return _chunks_in_chunk_list * EntriesPerChunk; }
+  size_t size() const { return (_chunks_in_chunk_list + _spilled_chunks) * EntriesPerChunk; }
 
   void set_empty();
 
@@ -379,6 +395,9 @@ public:
 
   // Forces get_next() to return NULL so that the iteration aborts early.
   void abort_compact() { _should_abort_compact = true; }
+  // Each STW window claims from a clean state, see G1SemeruSTWCompact::start_compact_budget().
+  void clear_abort_compact() { _should_abort_compact = false; }
+  bool should_abort_compact() { return _should_abort_compact; }
   void abort_scan()    { _should_abort_scan = true; }
 
 
@@ -390,11 +409,17 @@ public:
   // Claim the next root region to scan atomically, or return NULL if
   // all have been claimed.
   SemeruHeapRegion* claim_cm_scanned_next();
+  // Reorder the unclaimed scanned Regions, the most reclaimable bytes per copying cost first.
+  // By the CM thread before a STW window's compaction, nothing is enqueued or claimed meanwhile.
+  void order_unclaimed_cm_scanned_regions();
   SemeruHeapRegion* claim_freshly_evicted_next();
 
   // The number of root regions to scan.
   size_t num_cm_scanned_regions() const;
   size_t num_freshly_evicted_regions() const;
+  // The backlog, the Regions enqueued but not claimed yet.
+  size_t num_unclaimed_cm_scanned_regions() const;
+  size_t num_unclaimed_freshly_evicted_regions() const;
 
   bool is_compact_finished();
   bool is_cm_scan_finished();
@@ -677,13 +702,7 @@ public:
   // Manipulation of the global mark stack.
   // The push and pop operations are used by tasks for transfers
   // between task-local queues and the global mark stack.
-  bool mark_stack_push(G1SemeruTaskQueueEntry* arr) {
-    if (!_global_mark_stack.par_push_chunk(arr)) {
-      set_has_overflown();
-      return false;
-    }
-    return true;
-  }
+  bool mark_stack_push(G1SemeruTaskQueueEntry* arr);
 
   bool mark_stack_pop(G1SemeruTaskQueueEntry* arr) {
     return _global_mark_stack.par_pop_chunk(arr);
@@ -733,6 +752,8 @@ public:
 
   // Calculates the number of concurrent GC threads to be used in the marking phase.
   uint calc_active_marking_workers();
+  // -XX:+SemeruAdaptiveConcGCThreads, the tracing workers by the backlog of freshly evicted Regions.
+  uint calc_adaptive_marking_workers();
 
   // Moves all per-task cached data into global state.
   void flush_all_task_caches();
@@ -828,6 +849,53 @@ private:
 };
 
 
+/**
+ * Semeru MS - FIFO-buffered prefetching of the traversal, -XX:SemeruCMPrefetchDistance.
+ *
+ * The memory server cores are weak, the tracing is bound by the latency of the cache misses on the popped objects.
+ * In the spirit of the prefetch FIFO of Cher et al., an entry popped from the local task queue is prefetched first
+ * and waits here. It's scanned after SemeruCMPrefetchDistance younger entries are popped and prefetched,
+ * so its miss overlaps with the scanning of the older ones.
+ * The chunks taken from the G1SemeruCMMarkStack go through the local task queue, they are buffered the same way.
+ *
+ * The FIFO is only used inside G1SemeruCMTask::drain_local_queue() and is always empty out of it,
+ * e.g. before the task switches its scanning Region or steals.
+ */
+class G1SemeruCMPrefetchFIFO {
+public:
+  static const uint MaxDistance = 64;
+
+private:
+  G1SemeruTaskQueueEntry  _buf[MaxDistance];
+  uint                    _head;
+  uint                    _length;
+  uint                    _distance;
+
+public:
+  G1SemeruCMPrefetchFIFO() : _head(0), _length(0), _distance(0) { }
+
+  void set_distance(uint distance) { _distance = MIN2(distance, MaxDistance); }
+  uint distance() const            { return _distance; }
+
+  bool is_empty() const { return _length == 0; }
+  bool is_full()  const { return _length >= _distance; }
+
+  void push(G1SemeruTaskQueueEntry entry) {
+    assert(_length < MaxDistance, "prefetch FIFO overflow");
+    _buf[(_head + _length) % MaxDistance] = entry;
+    _length++;
+  }
+
+  G1SemeruTaskQueueEntry pop() {
+    assert(!is_empty(), "prefetch FIFO underflow");
+    G1SemeruTaskQueueEntry entry = _buf[_head];
+    _head = (_head + 1) % MaxDistance;
+    _length--;
+    return entry;
+  }
+};
+
+
 /** 
  * A class representing a marking task.
  *  
@@ -869,6 +937,9 @@ private:
   // the task(entry) queue of this task
   G1SemeruCMTaskQueue*              _semeru_task_queue;      // The StarTask queue for CM
 
+  // The popped entries waiting for their prefetches.
+  G1SemeruCMPrefetchFIFO            _prefetch_fifo;
+
   // This is a Task local cache.
   // It points to a global strucure : G1SemeruCompact->_region_mark_stats
   G1RegionMarkStatsCache      _mark_stats_cache;    // [x] Store the CM scanning information. e.g. scanned alive objects.
@@ -893,6 +964,24 @@ private:
   // Limit of the region this task is scanning, NULL if we're not scanning one
   HeapWord*                   _region_limit;
 
+  // Semeru MS - The marked Strings of _curr_region, handed to G1SemeruStringDedup when the Region is traced completely.
+  GrowableArray<HeapWord*>*   _dedup_candidates;
+
+  // Semeru MS - The last CPU server doorbell seen by the marking clock.
+  uint32_t                    _seen_doorbell;
+  // Semeru MS - _curr_region is given up for the STW window of the CPU server, see semeru_ms_preempt_if_stw().
+  bool                        _preempted_by_stw;
+
+  // Semeru MS - The targets out of _curr_region, appended to the mark_message_ring in batches, -XX:+SemeruMarkMessages.
+  static const uint           MarkMessageBatch = 256;
+  HeapWord*                   _mark_messages[MarkMessageBatch];
+  uint                        _num_mark_messages;
+
+  // Semeru MS - The pages of _curr_region reached from the root being traced, -XX:+SemeruPageAffinity on the CPU server.
+  size_t                      _affinity_pages[SEMERU_AFFINITY_GROUP_MAX];
+  uint                        _num_affinity_pages;
+  bool                        _tracing_affinity_root;
+
   //
   // Semeru Memory Server concurrent marking and compacting process
   //
@@ -956,6 +1045,9 @@ private:
   // Updates the local fields after this task has claimed
   // a new region to scan
   void setup_for_region(SemeruHeapRegion* hr);
+  // The Region whose tracing owns the entry at addr.
+  // The slices of a humongous array belong to its starts humongous Region.
+  inline SemeruHeapRegion* scan_region_of(const void* addr) const;
   // Makes the limit of the region up-to-date
   void update_region_limit();
 
@@ -984,6 +1076,37 @@ private:
 
   bool semeru_ms_regular_clock_call();
 
+  // Semeru MS - The marking clock of the memory server tracing, ticked every words_scanned_period words.
+  //  Only the STW window of the CPU server is checked, the time slicing of G1 is off.
+  void semeru_ms_check_limits() {
+    if (_words_scanned >= _words_scanned_limit) {
+      semeru_ms_preempt_if_stw();
+    }
+  }
+  void semeru_ms_preempt_if_stw();
+  // Give up the tracing of _curr_region after a scan failure or a preemption.
+  void abandon_region_scan();
+
+  // -XX:+SemeruMarkMessages, a reference out of _curr_region. The repeat of the last target is skipped.
+  void add_mark_message(HeapWord* target) {
+    if (_num_mark_messages > 0 && _mark_messages[_num_mark_messages - 1] == target) {
+      return;
+    }
+    _mark_messages[_num_mark_messages++] = target;
+    if (_num_mark_messages == MarkMessageBatch) {
+      flush_mark_messages();
+    }
+  }
+  void flush_mark_messages();
+
+  // -XX:+SemeruPageAffinity on the CPU server, the roots of a Region are traced one by one.
+  inline bool tracing_page_affinity() const;
+  // Note the page of an object marked in _curr_region, for the group of the current root.
+  inline void note_affinity_page(oop obj);
+  // Trace the closure of a root of _curr_region before the next one, and link the pages it reached.
+  void trace_affinity_root(oop obj);
+  void link_affinity_group();
+
   // Set abort flag if regular_clock_call() check fails
   inline void abort_marking_if_regular_check_fail();
 
@@ -1002,6 +1125,8 @@ public:
   // Apply the closure on the given area of the objArray. Return the number of words
   // scanned.
   inline size_t scan_objArray(objArrayOop obj, MemRegion mr);
+  // Apply the closure to the non-null elements in [from, to), skipping the null blocks.
+  template <class T> inline void scan_objArray_elements(T* from, T* to);
   // Resets the task; should be called right at the beginning of a marking phase.
   void reset(G1CMBitMap* next_mark_bitmap);
   // Clears all the fields that correspond to a claimed region.
@@ -1095,6 +1220,9 @@ public:
   // Scans an object and visits its children.
   inline void scan_task_entry(G1SemeruTaskQueueEntry task_entry);
 
+  // Prefetch the header and the first fields of the object, or the start of the array slice.
+  inline void prefetch_task_entry(G1SemeruTaskQueueEntry task_entry);
+
   // Pushes an object on the local queue.
   inline void push(G1SemeruTaskQueueEntry task_entry);
 
@@ -1111,6 +1239,8 @@ public:
   // true, then it stops when the queue size is of a given limit. If
   // partially is false, then it stops when the queue is empty.
   void drain_local_queue(bool partially);
+  // drain_local_queue() through the prefetch FIFO.
+  void drain_local_queue_prefetch(size_t target_size);
 
   // Fault tolerance
   void fault_tolerance_drain_local_queue();
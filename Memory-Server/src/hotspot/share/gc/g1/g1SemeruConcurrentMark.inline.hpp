@@ -30,6 +30,7 @@
 #include "gc/g1/g1ConcurrentMarkBitMap.inline.hpp"
 //#include "gc/g1/g1ConcurrentMarkObjArrayProcessor.inline.hpp"
 #include "gc/g1/g1OopClosures.inline.hpp"
+#include "gc/g1/g1SemeruCompressedOops.inline.hpp"
 #include "gc/g1/g1Policy.hpp"
 #include "gc/g1/g1RegionMarkStatsCache.inline.hpp"
 // #include "gc/g1/g1RemSetTrackingPolicy.hpp"
@@ -44,9 +45,13 @@
 #include "gc/g1/g1SemeruConcurrentMark.hpp"
 #include "gc/g1/g1ParScanThreadState.hpp"
 #include "gc/g1/g1SemeruConcurrentMarkObjArrayProcessor.inline.hpp"
+#include "gc/g1/g1SemeruKlassLayoutCache.inline.hpp"
 #include "gc/g1/SemeruHeapRegion.hpp"
 #include "gc/g1/g1SemeruRemSetTrackingPolicy.hpp"
+#include "gc/g1/g1SemeruStringDedup.inline.hpp"
 #include "oops/oop.inline.hpp"
+#include "runtime/prefetch.inline.hpp"
+#include "runtime/rdma_comm.hpp"
 
 
 // inline bool G1CMIsAliveClosure::do_object_b(oop obj) {
@@ -143,6 +148,15 @@ inline void G1SemeruCMMarkStack::iterate(Fn fn) const {
     cur = cur->next;
     num_chunks++;
   }
+
+  for (size_t c = 0; c < _spilled_chunks; c++) {
+    for (size_t i = 0; i < EntriesPerChunk; ++i) {
+      if (_spill_base[c].data[i].is_null()) {
+        break;
+      }
+      fn(_spill_base[c].data[i]);
+    }
+  }
 }
 #endif
 
@@ -223,6 +237,11 @@ inline void G1SemeruConcurrentMark::add_to_liveness(uint worker_id, oop const ob
 
 
 
+inline SemeruHeapRegion* G1SemeruCMTask::scan_region_of(const void* addr) const {
+  SemeruHeapRegion* hr = _semeru_h->hrm()->addr_to_region((HeapWord*)addr);
+  return hr->is_continues_humongous() ? hr->humongous_start_region() : hr;
+}
+
 // It scans an object and visits its children.
 // 1) pop items from the G1SemeruCMTask->_semeru_task_queue one by one
 // 2) Apply G1SemeruCMOopClosure to scan each object's field .
@@ -231,6 +250,12 @@ inline void G1SemeruCMTask::scan_task_entry(G1SemeruTaskQueueEntry task_entry) {
   process_grey_task_entry<true>(task_entry); 
 }
 
+inline void G1SemeruCMTask::prefetch_task_entry(G1SemeruTaskQueueEntry task_entry) {
+  HeapWord* addr = task_entry.is_array_slice() ? task_entry.slice() : (HeapWord*)task_entry.obj();
+  Prefetch::read(addr, 0);
+  Prefetch::read(addr, DEFAULT_CACHE_LINE_SIZE);
+}
+
 
 inline void G1SemeruCMTask::push(G1SemeruTaskQueueEntry task_entry) {
   // assert(task_entry.is_array_slice() || _semeru_h->is_in_g1_reserved(task_entry.obj()), "invariant");
@@ -339,13 +364,15 @@ inline void G1SemeruCMTask::process_grey_task_entry(G1SemeruTaskQueueEntry task_
       if (G1CMObjArrayProcessor::should_be_sliced(obj)) {   // an entire object array, should be sliced
         _words_scanned += _objArray_processor.process_obj(obj);
       } else {
-        _words_scanned += obj->oop_iterate_size(_semeru_cm_oop_closure);  // a normal object instance, scan its fields.
+        _words_scanned += G1SemeruKlassLayoutCache::oop_iterate_size(obj, _semeru_cm_oop_closure);  // a normal object instance, scan its fields.
       }
     }
   } // end of scan.
   
-  // For semeru memory server, we don't need to count such a scavenge limitations ??
-  // check_limits();
+  // For semeru memory server, the clock only checks the STW window of the CPU server.
+  if (SemeruPreemptTracingOnSTW) {
+    semeru_ms_check_limits();
+  }
 }
 
 
@@ -353,10 +380,48 @@ inline void G1SemeruCMTask::process_grey_task_entry(G1SemeruTaskQueueEntry task_
  *  Scan a slice, specified by the MemRegion, of an object array.
  */
 inline size_t G1SemeruCMTask::scan_objArray(objArrayOop obj, MemRegion mr) {
-  obj->oop_iterate(_semeru_cm_oop_closure, mr);
+  // The closure doesn't visit the metadata, only the elements within the slice are scanned.
+  HeapWord* low  = MAX2(mr.start(), obj->base_raw());
+  HeapWord* high = MIN2(mr.end(), (HeapWord*)((char*)obj->base_raw() + (size_t)obj->length() * heapOopSize));
+  if (low < high) {
+    if (UseCompressedOops) {
+      scan_objArray_elements((narrowOop*)low, (narrowOop*)high);
+    } else {
+      scan_objArray_elements((oop*)low, (oop*)high);
+    }
+  }
   return mr.word_size();
 }
 
+/**
+ * The large arrays of the analytics heaps are mostly null, e.g. the sparse tables.
+ * OR a block of elements as raw words first, the compiler vectorizes it,
+ * and only visit the elements of a non-null block.
+ */
+template <class T>
+inline void G1SemeruCMTask::scan_objArray_elements(T* from, T* to) {
+  const size_t block_elems = 8;
+  const size_t block_words = block_elems * sizeof(T) / HeapWordSize;
+
+  T* p = from;
+  for (; p + block_elems <= to; p += block_elems) {
+    const uintptr_t* w = (const uintptr_t*)p;
+    uintptr_t any = 0;
+    for (size_t i = 0; i < block_words; i++) {
+      any |= w[i];
+    }
+    if (any == 0) {
+      continue;
+    }
+    for (size_t i = 0; i < block_elems; i++) {
+      _semeru_cm_oop_closure->do_oop_work(p + i);
+    }
+  }
+  for (; p < to; p++) {
+    _semeru_cm_oop_closure->do_oop_work(p);
+  }
+}
+
 
 inline void G1SemeruCMTask::update_liveness(oop const obj, const size_t obj_size) {
   _mark_stats_cache.add_live_words(_semeru_h->addr_to_region((HeapWord*)obj), obj_size);
@@ -426,6 +491,27 @@ inline bool G1SemeruCMTask::mark_in_alive_bitmap(uint const worker_id, oop const
 
 
 
+inline bool G1SemeruCMTask::tracing_page_affinity() const {
+  return _semeru_h->cpu_server_flags()->_page_affinity;
+}
+
+inline void G1SemeruCMTask::note_affinity_page(oop obj) {
+  HeapWord* addr = (HeapWord*)obj;
+  if (addr < _curr_region->bottom() || addr >= _curr_region->end()) {
+    return;
+  }
+
+  size_t page = page_affinity_table::page_of(addr);
+  for (uint i = _num_affinity_pages; i > 0; i--) {
+    if (_affinity_pages[i - 1] == page) {
+      return;
+    }
+  }
+  if (_num_affinity_pages < SEMERU_AFFINITY_GROUP_MAX) {
+    _affinity_pages[_num_affinity_pages++] = page;
+  }
+}
+
 /**
  * Semeru Memory Server - Concurrently mark an object alive in SemeruHeapRegion->alive_bitmap
  *  
@@ -452,6 +538,20 @@ inline bool G1SemeruCMTask::make_reference_alive(oop obj) {
 
 	log_trace(semeru,mem_trace)("%s, mark obj 0x%lx alive in Region[%d]'s alive_bitmap", __func__, (size_t)(HeapWord*)obj ,_curr_region->hrm_index() );
 
+  // The replicated Klass has the ClassLoaderData* of the CPU server, it's only hashed here.
+  _semeru_h->_cld_liveness->record(_curr_region->hrm_index(), obj->klass()->class_loader_data());
+
+  if (_tracing_affinity_root) {
+    note_affinity_page(obj);
+  }
+
+  if (G1SemeruStringDedup::is_candidate(obj, _semeru_h->cpu_server_flags())) {
+    if (_dedup_candidates == NULL) {
+      _dedup_candidates = new (ResourceObj::C_HEAP, mtGC) GrowableArray<HeapWord*>(16, true, mtGC);
+    }
+    _dedup_candidates->append((HeapWord*)obj);
+  }
+
   // No OrderAccess:store_load() is needed. It is implicit in the
   // CAS done in G1CMBitMap::parMark() call in the routine above.
   //HeapWord* global_finger = _cm->finger();
@@ -501,7 +601,8 @@ inline bool G1SemeruCMTask::deal_with_reference(T* p) {
   // increment_refs_reached();  // [?] Purpose for this counting ? count the incoming cross-region reference.
 
   // 1) Confirm this is a valid object
-  oop const obj = RawAccess<MO_VOLATILE>::oop_load(p);   // [?] how to confirm this is a valid oop, not a evacuated Region ?
+  //    The narrow field is encoded by the CPU server's Semeru heap base.
+  oop const obj = SemeruCompressedOops::load_decode(p);   // [?] how to confirm this is a valid oop, not a evacuated Region ?
   if (obj == NULL) {
     return false;
   }
@@ -513,11 +614,21 @@ inline bool G1SemeruCMTask::deal_with_reference(T* p) {
   if(_curr_region->is_in_reserved(obj) == false ){
 		log_trace(semeru,mem_trace)("%s, Referenced obj 0x%lx is Not in _curr_region[0x%x]  _bottom(0x%lx), _end(0x%lx). SKIP", __func__, 
 																			(size_t)(HeapWord*)obj, _curr_region->hrm_index(), (size_t)_curr_region->bottom(), (size_t)_curr_region->end());
+    if (SemeruMarkMessages && _curr_region->scan_failure == false && _semeru_h->is_in_g1_reserved(obj)) {
+      add_mark_message((HeapWord*)obj);
+    }
     return false;
   }
 
   // 3) Check for bug#8, bug#9
   if( !obj->is_klass_valid(obj->klass()) ){
+    if(semeru_page_discarded(obj)){
+      // The CPU server freed the swap slot of this page, its objects are unknown here.
+      // Keep the Region as it is, alive ratio 1.0 and not compacted.
+      _curr_region->scan_failure = true;
+      log_debug(semeru,mem_trace)("%s, obj 0x%lx is on a discarded page, skip it.", __func__, (size_t)(HeapWord*)obj);
+      return false;
+    }
     log_warning(semeru,mem_trace)("%s, obj 0x%lx is not accessible for now. klass value: 0x%lx skip it. \n", __func__, 
                                                                   (size_t)(HeapWord*)obj, (size_t)obj->_metadata._klass);
     return false;
@@ -547,22 +658,6 @@ inline void G1SemeruCMTask::trim_target_object_queue(TargetObjQueue* target_obj_
 
 inline void G1SemeruCMTask::trim_target_object_queue_to_threshold(TargetObjQueue* target_obj_queue, uint threshold) {
 	StarTask ref;
-	// Drain the overflow stack first, so other threads can potentially steal.
-	while (target_obj_queue->pop_overflow(ref)) {
-		if (!target_obj_queue->try_push_to_taskqueue(ref)) {
-
-      log_debug(semeru,mem_trace)("ERROR in %s, Used the overflow queue.", __func__);
-      // // Enqueue the makred object into SemeruHeapRegion->_cross_region_ref_update_queue
-      // // [X] It's target_obj_queue's purpose to do de-duplication.
-      // oop const obj = RawAccess<MO_VOLATILE>::oop_load((oop*)ref);
-      // if(obj != NULL){
-      //   _curr_region->cross_region_ref_update_queue()->push(obj, NULL);
-      // }
-
-			dispatch_reference(ref);
-		}// failed to push into normal taskque
-	}
-
 	while (target_obj_queue->pop_local(ref, threshold)) {  // process all the content length than threshold.
 
     // Enqueue the makred object into SemeruHeapRegion->_cross_region_ref_update_queue
@@ -593,9 +688,7 @@ inline void G1SemeruCMTask::dispatch_reference(StarTask ref) {
   //assert(verify_task(ref), "sanity");
 
 	if (ref.is_narrow()) {
-		//deal_with_reference((narrowOop*)ref);
-    assert(false, "%s, Not support narrow oop ye \n",__func__);
-
+		deal_with_reference((narrowOop*)ref);
 	} else {
 		deal_with_reference((oop*)ref);
 	}
@@ -655,7 +748,11 @@ inline size_t SemeruScanTargetOopClosure::apply(oop obj){
   if(obj_size == 0)
     return 0;
 
-  _semeru_cm_scan_task->make_reference_alive(obj);
+  if (_semeru_cm_scan_task->tracing_page_affinity()) {
+    _semeru_cm_scan_task->trace_affinity_root(obj);
+  } else {
+    _semeru_cm_scan_task->make_reference_alive(obj);
+  }
   return obj_size;
 }
 
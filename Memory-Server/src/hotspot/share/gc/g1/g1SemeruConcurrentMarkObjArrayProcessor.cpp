@@ -30,22 +30,36 @@ void G1SemeruCMObjArrayProcessor::push_array_slice(HeapWord* what) {
   _semeru_task->push(G1SemeruTaskQueueEntry::from_slice(what));
 }
 
-size_t G1SemeruCMObjArrayProcessor::process_array_slice(objArrayOop obj, HeapWord* start_from, size_t remaining) {
-  size_t words_to_scan = MIN2(remaining, (size_t)ObjArrayMarkingStride);
+size_t G1SemeruCMObjArrayProcessor::process_array_chunks(objArrayOop obj, size_t chunk, size_t num_chunks) {
+  HeapWord* const start = (HeapWord*)obj;
+  size_t const size = (size_t)obj->size();
+  size_t const total_chunks = (size + ObjArrayMarkingStride - 1) / ObjArrayMarkingStride;
 
-  if (remaining > ObjArrayMarkingStride) {
-    push_array_slice(start_from + ObjArrayMarkingStride);
+  // Push the upper halves first, the largest one is at the stealing end of the queue.
+  while (num_chunks > 1) {
+    num_chunks >>= 1;
+    if (chunk + num_chunks < total_chunks) {
+      push_array_slice(start + (chunk + num_chunks) * ObjArrayMarkingStride);
+    }
   }
 
-  // Then process current area.
-  MemRegion mr(start_from, words_to_scan);
+  // Then process current chunk.
+  HeapWord* const start_from = start + chunk * ObjArrayMarkingStride;
+  MemRegion mr(start_from, MIN2(size - chunk * ObjArrayMarkingStride, (size_t)ObjArrayMarkingStride));
   return _semeru_task->scan_objArray(obj, mr);
 }
 
 size_t G1SemeruCMObjArrayProcessor::process_obj(oop obj) {
   assert(should_be_sliced(obj), "Must be an array object %d and large " SIZE_FORMAT, obj->is_objArray(), (size_t)obj->size());
 
-  return process_array_slice(objArrayOop(obj), (HeapWord*)obj, (size_t)objArrayOop(obj)->size());
+  size_t const size = (size_t)objArrayOop(obj)->size();
+  size_t const total_chunks = (size + ObjArrayMarkingStride - 1) / ObjArrayMarkingStride;
+  // The whole array is the slice at chunk 0, rounded up to a power of 2 chunks.
+  size_t num_chunks = 1;
+  while (num_chunks < total_chunks) {
+    num_chunks <<= 1;
+  }
+  return process_array_chunks(objArrayOop(obj), 0, num_chunks);
 }
 
 /**
@@ -80,7 +94,9 @@ size_t G1SemeruCMObjArrayProcessor::process_slice(HeapWord* slice) {
   objArrayOop objArray = objArrayOop(start_address);
 
   size_t already_scanned = slice - start_address;
-  size_t remaining = objArray->size() - already_scanned;
+  assert(already_scanned % ObjArrayMarkingStride == 0, "Slice " PTR_FORMAT " isn't at a chunk boundary", p2i(slice));
+  size_t chunk = already_scanned / ObjArrayMarkingStride;
 
-  return process_array_slice(objArray, slice, remaining);
+  // The slice covers the chunks up to the lowest set bit of its index.
+  return process_array_chunks(objArray, chunk, chunk & (~chunk + 1));
 }
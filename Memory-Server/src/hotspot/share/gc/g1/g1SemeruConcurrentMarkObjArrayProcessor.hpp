@@ -34,6 +34,14 @@ class G1SemeruCMTask;
 // Instead of pushing large object arrays, we push continuations onto the
 // mark stack. These continuations are identified by having their LSB set.
 // This allows incremental processing of large objects.
+//
+// Semeru memory server, the array is split in halves instead of a chain of continuations.
+// The array is cut into chunks of ObjArrayMarkingStride words. A slice is identified by its address alone,
+// the slice at chunk k covers the chunks [k, k + lowest set bit of k), clipped to the end of the array.
+// Processing a slice pushes its upper half as a new slice until one chunk is left, and scans that chunk.
+// The owner pops the small slices next to its scanning point, while the idle workers steal the largest
+// slices from the other end of the queue. So the stolen work grows with the number of idle workers,
+// rather than one continuation passed from worker to worker.
 class G1SemeruCMObjArrayProcessor {
 private:
   // Reference to the task for doing the actual work.
@@ -42,8 +50,8 @@ private:
   // Push the continuation at the given address onto the mark stack.
   void push_array_slice(HeapWord* addr);
 
-  // Process (apply the closure) on the given continuation of the given objArray.
-  size_t process_array_slice(objArrayOop const obj, HeapWord* start_from, size_t remaining);
+  // Split the chunks [chunk, chunk + num_chunks) of the objArray, and scan the first chunk.
+  size_t process_array_chunks(objArrayOop const obj, size_t chunk, size_t num_chunks);
 public:
   static bool should_be_sliced(oop obj);
 
@@ -36,9 +36,11 @@
 #include "gc/shared/gcId.hpp"
 #include "gc/shared/gcTrace.hpp"
 #include "gc/shared/gcTraceTime.inline.hpp"
+#include "gc/shared/rdmaWireCodec.hpp"
 #include "gc/shared/suspendibleThreadSet.hpp"
 #include "logging/log.hpp"
 #include "memory/resourceArea.hpp"
+#include "oops/oop.inline.hpp"
 #include "runtime/handles.inline.hpp"
 #include "runtime/vmThread.hpp"
 #include "utilities/debug.hpp"
@@ -48,7 +50,12 @@
 #include "gc/g1/g1SemeruConcurrentMark.inline.hpp"
 #include "gc/g1/g1SemeruCollectedHeap.inline.hpp"
 #include "gc/g1/g1SemeruConcurrentMarkThread.inline.hpp"
+#include "gc/g1/g1SemeruColdStore.hpp"
+#include "gc/g1/g1SemeruConcurrentCompact.hpp"
+#include "gc/g1/g1SemeruKlassLayoutCache.hpp"
+#include "gc/g1/g1SemeruTenantScheduler.hpp"
 #include "semeru/debug_function.h"
+#include "runtime/rdma_comm.hpp"
 
 
 // ======= Semeru Concurrent Mark Thread ========
@@ -122,6 +129,7 @@ G1SemeruConcurrentMarkThread::G1SemeruConcurrentMarkThread(G1SemeruConcurrentMar
   _semeru_sc(NULL),         // [XX] STW compacter for Semeru MS.
   _semeru_ms_gc_should_terminated(false),
   _state(Idle),
+  _dispatched_cset_seq(0),
   _phase_manager_stack() {
 
   set_name("Semeru Memory Server Concurrent Thread");
@@ -441,6 +449,11 @@ void G1SemeruConcurrentMarkThread::run_service() {
     _semeru_cm->pre_initial_mark();
   }
 
+  // Share the cores with the memory servers of the other tenants on this machine.
+  G1SemeruTenantScheduler::initialize();
+  G1SemeruColdStore::initialize();
+  G1SemeruKlassLayoutCache::initialize();
+
   // [?] What's  the purpose of these phase ?
   //    Just for Log ? Can also synchronize, schedule some thing?
   //    e.g. Concurrent Tracing and STW Compact are different phases, we need to schedule and switch between these 2 phases.
@@ -448,6 +461,9 @@ void G1SemeruConcurrentMarkThread::run_service() {
   cpmanager.set_phase(G1SemeruConcurrentPhase::SEMERU_CONCURRENT_CYCLE, false /* force */);
 
 
+  // The doorbells rung before this point are covered by the first round.
+  uint32_t doorbell_seen = cpu_server_doorbell();
+
   // [x] Keep runing until the G1SemeruConcurrentThread is stopped.
   //     only ConcurrentThread->_should_terminate can end the MS GC.
   while (!should_terminate()  && !semeru_ms_gc_should_terminated() ) {
@@ -460,6 +476,9 @@ void G1SemeruConcurrentMarkThread::run_service() {
       HandleMark   hm;
       double cycle_start = os::elapsedVTime();
 
+      // The CPU server may have unloaded some classes and reused their metaspace since the last round.
+      G1SemeruKlassLayoutCache::clear();
+
       // 
       // Interrupped by CPU server 2-sided RDMA message here, reschedule each phase
       //  Phase 1) dispatch recieved CSet and target Oop Queue
@@ -505,6 +524,9 @@ void G1SemeruConcurrentMarkThread::run_service() {
         // Enqueue the received Regions to _cm_scanned_region, _freshly_evicetd_regions.
         dispatch_received_regions(recv_mem_server_cset);
 
+        // The CPU server waits at a safepoint for the histogram, serve it before the tracing.
+        serve_heap_histogram(semeru_heap->_heap_histogram);
+
       }  // end of phase 1)'s code block
 
 
@@ -534,6 +556,21 @@ void G1SemeruConcurrentMarkThread::run_service() {
         //
         if(cpu_server_flags->_is_cpu_server_in_stw ) {
 
+          // The CPU server estimates the clock offset from the doorbell opening the window and the states pushed back.
+          if(cpu_server_flags->_timeline){
+            mem_server_flags->timeline_start(cpu_server_flags->state_seq());
+            mem_server_flags->timeline_record(SEMERU_TL_DOORBELL_SEEN, cpu_server_doorbell(), cpu_server_doorbell_arrival());
+            mem_server_flags->timeline_record(SEMERU_TL_WINDOW_SEEN, 0);
+          }
+
+          // The pause budget covers the commit below and the compaction.
+          _semeru_sc->start_compact_budget(cpu_server_flags->_stw_budget_us);
+
+          // Copy the images of the concurrent compaction back, before the CPU server releases the Regions.
+          mem_server_flags->timeline_record(SEMERU_TL_COMMIT_START, 0);
+          _semeru_sc->concurrent_compact()->commit(cpu_server_flags, mem_server_flags);
+          mem_server_flags->timeline_record(SEMERU_TL_COMMIT_END, 0);
+
           if(_semeru_sc->_mem_server_cset->is_compact_finished() == false){
 
             
@@ -541,6 +578,8 @@ void G1SemeruConcurrentMarkThread::run_service() {
 					  log_debug(semeru,mem_compact)("%s, Memory Server compact starts .", __func__);
 
             mem_server_flags->set_all_flags_to_start_mode();
+            mem_server_flags->timeline_record(SEMERU_TL_STATE_PUSHED, MEM_SERVER_NOTIFY_COMPACT_START);
+            notify_cpu_server(MEM_SERVER_NOTIFY_COMPACT_START);
             
             //
             // Skip the Compact for now..
@@ -548,8 +587,13 @@ void G1SemeruConcurrentMarkThread::run_service() {
             // _semeru_sc->semeru_stw_compact();
           }
 
-          // Exit the  STW window. 
+          // The cleared References read by the CPU server at the start of this window.
+          mem_server_flags->retire_pending_ref_chains(cpu_server_flags, SemeruMemServerID);
+
+          // Exit the  STW window.
           mem_server_flags->set_all_flags_to_end_mode();
+          mem_server_flags->timeline_record(SEMERU_TL_STATE_PUSHED, MEM_SERVER_NOTIFY_COMPACT_DONE);
+          notify_cpu_server(MEM_SERVER_NOTIFY_COMPACT_DONE);
 
         }
         
@@ -570,6 +614,8 @@ void G1SemeruConcurrentMarkThread::run_service() {
         //
         cpmanager.set_phase(G1SemeruConcurrentPhase::SEMERU_CONCURRENT_MARK, false); 
       
+        // Wait for the turn of this tenant, given back at the end of the round.
+        G1SemeruTenantGCSlot tenant_slot;
         
         jlong mark_start = os::elapsed_counter();
         const char* cm_title = lookup_concurrent_phase_title(G1SemeruConcurrentPhase::SEMERU_CONCURRENT_MARK);
@@ -587,6 +633,12 @@ void G1SemeruConcurrentMarkThread::run_service() {
 
   
 
+        // Compact the scanned Regions granted by the CPU server into their shadows, out of the STW window.
+        _semeru_sc->concurrent_compact()->compact_granted_regions(cpu_server_flags);
+
+        // Compress the compacted Regions the CPU server stopped accessing, -XX:+SemeruColdStore.
+        G1SemeruColdStore::compress_cold_regions();
+
         // [??] If all the freshly evicted Regions are scanned, waiting for the CPU server interruption
         //
         log_debug(semeru, gc)("%s, MS Concurrent Tracing processed all the freshly evicted Regions, wait for CPU server intteruption. \n",__func__);
@@ -617,11 +669,9 @@ void G1SemeruConcurrentMarkThread::run_service() {
     // Debug - Terminate the ConcurrentThread
     //
 
-    //#ifdef ASSERT
-      // Infinite loop. 
-      // Debug - Sleep and wake up to check CSet.
-      os::sleep(this, 600, false); // sleep a while to wait for CSet..
-    //#endif
+    // Sleep until the CPU server rings the doorbell for a new CSet or the STW window.
+    // The timeout keeps the periodical check in case the doorbell is lost or unsupported.
+    doorbell_seen = wait_for_cpu_server_doorbell(doorbell_seen, 600);
     //set_semeru_ms_gc_terminated();
     //this->_should_terminate = true;
 
@@ -667,6 +717,52 @@ void G1SemeruConcurrentMarkThread::run_service() {
 }
 
 
+/**
+ * Semeru Memory Server - Count the instances of each klass in the requested Regions, see remote_heap_histogram.
+ *
+ * The Regions are fully evicted, the content here is complete and parsable up to the used words sent by
+ * the CPU server. The klasses are read from the replicated metadata, at the CPU server's addresses.
+ * The CPU server is at a safepoint, nothing changes the Regions meanwhile.
+ */
+void G1SemeruConcurrentMarkThread::serve_heap_histogram(remote_heap_histogram* histo){
+  uint32_t seq = histo->_request_seq;
+  if(seq == histo->_done_seq){
+    return;
+  }
+  OrderAccess::loadload();   // the used words are written before the sequence.
+
+  G1SemeruCollectedHeap* semeru_heap = G1SemeruCollectedHeap::heap();
+  double start = os::elapsedTime();
+  histo->clear_entries();
+
+  for(uint i = 0; i < SEMERU_MAX_REGIONS && histo->_overflow == 0; i++){
+    size_t used_words = histo->_used_words[i];
+    SemeruHeapRegion* hr = used_words == 0 ? NULL : semeru_heap->region_at_or_null(i);
+    if(hr == NULL){
+      continue;
+    }
+
+    HeapWord* end = hr->bottom() + MIN2(used_words, SemeruHeapRegion::SemeruGrainWords);
+    G1SemeruColdStore::restore(hr->bottom(), end);
+    for(HeapWord* cur = hr->bottom(); cur < end; ){
+      oop obj = oop(cur);
+      size_t words = obj->size();
+      if(!histo->add(obj->klass(), words)){
+        histo->_overflow = 1;
+        break;
+      }
+      cur += words;
+    }
+    histo->_num_regions++;
+  }
+
+  histo->publish(seq);
+  log_info(semeru, mem_trace)("%s, heap histogram %u, 0x%lx Regions, %lu klasses%s, %.3f ms.", __func__, seq,
+                              (size_t)histo->_num_regions, (size_t)histo->_num_entries,
+                              histo->_overflow ? " (overflow)" : "", (os::elapsedTime() - start) * 1000.0);
+}
+
+
 /**
  * Semeru Memory Server - Dispatch the received Regions CSet into scanned/freshly_evicted queues.
  * 
@@ -680,8 +776,21 @@ void G1SemeruConcurrentMarkThread::dispatch_received_regions(received_memory_ser
   assert(recv_mem_server_cset!= NULL, "%s, must initiate the G1SemeruCollectHeap->_mem_server_cset \n", __func__);
 
   G1SemeruCollectedHeap* semeru_heap = G1SemeruCollectedHeap::heap();
+
+  // The header page is written last, a new sequence has all its overflow pages.
+  uint32_t seq = recv_mem_server_cset->seq(SemeruMemServerID);
+  if(seq == _dispatched_cset_seq){
+    return;
+  }
+  log_debug(semeru,mem_trace)("%s, CSet seq %u, 0x%x Regions, 0x%x CSets missed.", __func__, seq,
+                              recv_mem_server_cset->num_of_enqueued_regions(SemeruMemServerID), seq - _dispatched_cset_seq - 1);
+  _dispatched_cset_seq = seq;
+
+  // The large target queue pages and BOT parts of the CSet, compressed by the CPU server.
+  SemeruWireBuffer::apply(SemeruMemServerID, seq);
+
   //size_t* received_num = mem_server_cset->num_received_regions();
-  volatile int received_region_ind = recv_mem_server_cset->pop(CUR_MEMORY_SERVER_ID);  // can be negative 
+  volatile int received_region_ind = recv_mem_server_cset->pop(SemeruMemServerID);  // can be negative 
    SemeruHeapRegion* region_received = NULL;
 
   while(received_region_ind != -1){
@@ -707,7 +816,7 @@ void G1SemeruConcurrentMarkThread::dispatch_received_regions(received_memory_ser
     }
 
     // process next region_id
-		received_region_ind = recv_mem_server_cset->pop(CUR_MEMORY_SERVER_ID);
+		received_region_ind = recv_mem_server_cset->pop(SemeruMemServerID);
 
   }// Received CSet isn't emtpy.
 
@@ -764,13 +873,10 @@ void G1SemeruConcurrentMarkThread::sleep_before_next_cycle() {
   	}
 	}
 
-	// debug - memory server
-	int sleep_time = 10;
-	log_debug(semeru,rdma)("%s, Sleep Concurrent GC thread %d seconds to let connect to CPU server. \n",__func__, sleep_time);
-	//sleep(sleep_time);
-	os::sleep(this, sleep_time*100, false);
-
   if (started()) {      // G1SemeruConcurrentMarkThread->_state Started 
+    // The heap is written by the CPU server, don't trace it before the CPU server has bound the memory pool.
+    // Returns at once for the cycles requested by the CPU server. No fixed sleep for the connection.
+    wait_for_cpu_server_bound();
     set_in_progress();  // switch to G1SemeruConcurrentMarkThread->_state InProgress from Started.
   }
 }
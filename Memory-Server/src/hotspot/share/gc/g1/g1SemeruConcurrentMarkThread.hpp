@@ -87,6 +87,9 @@ class G1SemeruConcurrentMarkThread: public ConcurrentGCThread {
 
   volatile State _state;
 
+  // The sequence of the last CSet dispatched, see received_memory_server_cset.
+  uint32_t _dispatched_cset_seq;
+
   // WhiteBox testing support.
   // Tag : Push PhaseManager into the stack, shared by different PhaseManager.
   ConcurrentGCPhaseManager::Stack _phase_manager_stack;
@@ -162,6 +165,9 @@ class G1SemeruConcurrentMarkThread: public ConcurrentGCThread {
   //
   void dispatch_received_regions( received_memory_server_cset* mem_server_cset);
 
+  // Count the classes of the fully evicted Regions for the CPU server's class histogram, if requested.
+  void serve_heap_histogram(remote_heap_histogram* histo);
+
   // Debug functions
 
   // suspend current concurrent thread on SemeruCGC_lock
@@ -0,0 +1,125 @@
+/**
+ * Semeru Memory Server - the perf-data counters of the tracing and the compaction, sun.gc.semeru.*
+ *
+ */
+
+#include "precompiled.hpp"
+#include "gc/g1/g1SemeruCollectedHeap.hpp"
+#include "gc/g1/g1SemeruCounters.hpp"
+#include "gc/shared/rdmaStructure.hpp"
+#include "memory/resourceArea.hpp"
+#include "runtime/atomic.hpp"
+#include "runtime/perfData.hpp"
+
+
+G1SemeruCounters::G1SemeruCounters(G1SemeruCollectedHeap* semeru_h, uint max_workers) :
+  _semeru_h(semeru_h),
+  _max_workers(max_workers),
+  _traced_regions(0),
+  _compacted_regions(0),
+  _compacted_bytes(0),
+  _mark_stack_overflows(0),
+  _mark_stack_high_water(0),
+  _trace_ticks(0),
+  _compact_ticks(0),
+  _steal_attempts(NEW_C_HEAP_ARRAY(size_t, max_workers, mtGC)),
+  _steals(NEW_C_HEAP_ARRAY(size_t, max_workers, mtGC)),
+  _traced_regions_counter(NULL),
+  _trace_time_counter(NULL),
+  _compacted_regions_counter(NULL),
+  _compacted_bytes_counter(NULL),
+  _compact_time_counter(NULL),
+  _mark_stack_overflows_counter(NULL),
+  _mark_stack_high_water_counter(NULL),
+  _steal_attempts_counter(NULL),
+  _steals_counter(NULL),
+  _receive_backlog_counter(NULL)
+{
+  for (uint i = 0; i < max_workers; i++) {
+    _steal_attempts[i] = 0;
+    _steals[i] = 0;
+  }
+
+  if (UsePerfData) {
+    create_counters();
+  }
+}
+
+
+void G1SemeruCounters::create_counters() {
+  EXCEPTION_MARK;
+  ResourceMark rm;
+
+  const char* ns = "semeru";
+
+  _traced_regions_counter = PerfDataManager::create_variable(SUN_GC, PerfDataManager::counter_name(ns, "tracedRegions"),
+                                                             PerfData::U_Events, CHECK);
+  _trace_time_counter = PerfDataManager::create_variable(SUN_GC, PerfDataManager::counter_name(ns, "traceTime"),
+                                                         PerfData::U_Ticks, CHECK);
+  _compacted_regions_counter = PerfDataManager::create_variable(SUN_GC, PerfDataManager::counter_name(ns, "compactedRegions"),
+                                                                PerfData::U_Events, CHECK);
+  _compacted_bytes_counter = PerfDataManager::create_variable(SUN_GC, PerfDataManager::counter_name(ns, "compactedBytes"),
+                                                              PerfData::U_Bytes, CHECK);
+  _compact_time_counter = PerfDataManager::create_variable(SUN_GC, PerfDataManager::counter_name(ns, "compactTime"),
+                                                           PerfData::U_Ticks, CHECK);
+  _mark_stack_overflows_counter = PerfDataManager::create_variable(SUN_GC, PerfDataManager::counter_name(ns, "markStackOverflows"),
+                                                                   PerfData::U_Events, CHECK);
+  _mark_stack_high_water_counter = PerfDataManager::create_variable(SUN_GC, PerfDataManager::counter_name(ns, "markStackHighWater"),
+                                                                    PerfData::U_None, CHECK);
+  _steal_attempts_counter = PerfDataManager::create_variable(SUN_GC, PerfDataManager::counter_name(ns, "stealAttempts"),
+                                                             PerfData::U_Events, CHECK);
+  _steals_counter = PerfDataManager::create_variable(SUN_GC, PerfDataManager::counter_name(ns, "steals"),
+                                                     PerfData::U_Events, CHECK);
+  _receive_backlog_counter = PerfDataManager::create_variable(SUN_GC, PerfDataManager::counter_name(ns, "receiveBacklog"),
+                                                              PerfData::U_None, CHECK);
+}
+
+
+void G1SemeruCounters::inc_traced_regions() {
+  Atomic::inc(&_traced_regions);
+}
+
+void G1SemeruCounters::inc_compacted_region(size_t live_bytes) {
+  Atomic::inc(&_compacted_regions);
+  Atomic::add(live_bytes, &_compacted_bytes);
+}
+
+void G1SemeruCounters::inc_mark_stack_overflows() {
+  Atomic::inc(&_mark_stack_overflows);
+}
+
+void G1SemeruCounters::note_mark_stack_size(size_t chunks) {
+  size_t high = _mark_stack_high_water;
+  while (chunks > high) {
+    size_t prev = Atomic::cmpxchg(chunks, &_mark_stack_high_water, high);
+    if (prev == high) {
+      break;
+    }
+    high = prev;
+  }
+}
+
+
+void G1SemeruCounters::update() {
+  if (!UsePerfData) {
+    return;
+  }
+
+  size_t steal_attempts = 0;
+  size_t steals = 0;
+  for (uint i = 0; i < _max_workers; i++) {
+    steal_attempts += _steal_attempts[i];
+    steals += _steals[i];
+  }
+
+  _traced_regions_counter->set_value((jlong)_traced_regions);
+  _trace_time_counter->set_value(_trace_ticks);
+  _compacted_regions_counter->set_value((jlong)_compacted_regions);
+  _compacted_bytes_counter->set_value((jlong)_compacted_bytes);
+  _compact_time_counter->set_value(_compact_ticks);
+  _mark_stack_overflows_counter->set_value((jlong)_mark_stack_overflows);
+  _mark_stack_high_water_counter->set_value((jlong)_mark_stack_high_water);
+  _steal_attempts_counter->set_value((jlong)steal_attempts);
+  _steals_counter->set_value((jlong)steals);
+  _receive_backlog_counter->set_value((jlong)_semeru_h->recv_mem_server_cset()->num_of_enqueued_regions(SemeruMemServerID));
+}
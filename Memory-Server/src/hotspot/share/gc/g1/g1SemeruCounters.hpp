@@ -0,0 +1,79 @@
+/**
+ * Semeru Memory Server - the perf-data counters of the tracing and the compaction, sun.gc.semeru.*
+ *
+ */
+
+#ifndef SHARE_VM_GC_G1_G1SEMERUCOUNTERS_HPP
+#define SHARE_VM_GC_G1_G1SEMERUCOUNTERS_HPP
+
+#include "memory/allocation.hpp"
+#include "runtime/perfData.hpp"
+#include "utilities/debug.hpp"
+
+class G1SemeruCollectedHeap;
+
+/**
+ * Semeru MS - The workers only bump the plain accumulators, by atomics or by their own slots.
+ *  The control thread publishes them to the perf-data after each concurrent tracing round and compaction window,
+ *  read by jstat or any perf-data reader of the memory server host. The rates are the counters over their times.
+ *
+ *  tracedRegions / traceTime        Regions traced completely, the time of the tracing rounds.
+ *  compactedRegions / compactedBytes / compactTime
+ *                                   Regions and their live bytes compacted, in or out of the STW window.
+ *  markStackOverflows               Chunks failed to be pushed to the global mark stack.
+ *  markStackHighWater               The max chunks of the global mark stack.
+ *  stealAttempts / steals           The task queue steals of the tracing workers.
+ *  receiveBacklog                   The received CSet Regions not dispatched yet.
+ */
+class G1SemeruCounters : public CHeapObj<mtGC> {
+  G1SemeruCollectedHeap* _semeru_h;
+  uint                   _max_workers;
+
+  volatile size_t _traced_regions;
+  volatile size_t _compacted_regions;
+  volatile size_t _compacted_bytes;
+  volatile size_t _mark_stack_overflows;
+  volatile size_t _mark_stack_high_water;
+  jlong           _trace_ticks;
+  jlong           _compact_ticks;
+
+  // One slot per worker, no atomics on the stealing path.
+  size_t*         _steal_attempts;
+  size_t*         _steals;
+
+  PerfVariable*   _traced_regions_counter;
+  PerfVariable*   _trace_time_counter;
+  PerfVariable*   _compacted_regions_counter;
+  PerfVariable*   _compacted_bytes_counter;
+  PerfVariable*   _compact_time_counter;
+  PerfVariable*   _mark_stack_overflows_counter;
+  PerfVariable*   _mark_stack_high_water_counter;
+  PerfVariable*   _steal_attempts_counter;
+  PerfVariable*   _steals_counter;
+  PerfVariable*   _receive_backlog_counter;
+
+  void create_counters();
+
+public:
+  G1SemeruCounters(G1SemeruCollectedHeap* semeru_h, uint max_workers);
+
+  // Workers.
+  void inc_traced_regions();
+  void inc_compacted_region(size_t live_bytes);
+  void inc_mark_stack_overflows();
+  void note_mark_stack_size(size_t chunks);
+  void note_steal(uint worker_id, bool stolen) {
+    assert(worker_id < _max_workers, "worker %u out of the %u slots", worker_id, _max_workers);
+    _steal_attempts[worker_id]++;
+    if (stolen) {
+      _steals[worker_id]++;
+    }
+  }
+
+  // Control thread.
+  void add_trace_ticks(jlong ticks)   { _trace_ticks += ticks; }
+  void add_compact_ticks(jlong ticks) { _compact_ticks += ticks; }
+  void update();
+};
+
+#endif // SHARE_VM_GC_G1_G1SEMERUCOUNTERS_HPP
@@ -0,0 +1,189 @@
+/**
+ * Semeru Memory Server - move the large objects of the compaction by the DMA engine, -XX:SemeruCompactDMADevice.
+ *
+ */
+
+#include "precompiled.hpp"
+#include "gc/g1/g1SemeruDMACopier.hpp"
+#include "gc/shared/gc_globals.hpp"
+#include "logging/log.hpp"
+#include "oops/oop.inline.hpp"
+#include "runtime/orderAccess.hpp"
+#include "runtime/os.hpp"
+#include "utilities/align.hpp"
+#include "utilities/copy.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// The idxd uapi, include/uapi/linux/idxd.h
+#define SEMERU_DSA_OPCODE_MEMMOVE     0x03
+#define SEMERU_DSA_FLAG_CRAV          0x0004    // completion record address valid
+#define SEMERU_DSA_FLAG_RCR           0x0008    // request completion record
+#define SEMERU_DSA_FLAG_CC            0x0100    // the destination writes are allocated in the cache
+#define SEMERU_DSA_COMP_NONE          0x00
+#define SEMERU_DSA_COMP_SUCCESS       0x01
+#define SEMERU_DSA_PORTAL_SIZE        4096
+
+void* G1SemeruDMACopier::_portal = NULL;
+
+bool G1SemeruDMACopier::initialize() {
+#ifdef AMD64
+  if (SemeruCompactDMADevice == NULL) {
+    return false;
+  }
+
+  int fd = open(SemeruCompactDMADevice, O_RDWR);
+  if (fd < 0) {
+    log_warning(semeru, mem_compact)("%s, can't open %s, %s. The compaction copies by the CPU.",
+                                     __func__, SemeruCompactDMADevice, os::strerror(errno));
+    return false;
+  }
+
+  void* portal = mmap(NULL, SEMERU_DSA_PORTAL_SIZE, PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+  close(fd);
+  if (portal == MAP_FAILED) {
+    log_warning(semeru, mem_compact)("%s, can't map the portal of %s, %s. The compaction copies by the CPU.",
+                                     __func__, SemeruCompactDMADevice, os::strerror(errno));
+    return false;
+  }
+
+  _portal = portal;
+  log_info(semeru, mem_compact)("%s, the objects of at least " SIZE_FORMAT " bytes are moved by %s",
+                                __func__, SemeruCompactDMAMinBytes, SemeruCompactDMADevice);
+  return true;
+#else
+  return false;
+#endif
+}
+
+G1SemeruDMACopier::G1SemeruDMACopier() :
+  _completions(NULL),
+  _desc(NULL),
+  _raw(NULL),
+  _num_in_flight(0),
+  _src_low(NULL),
+  _src_high(NULL),
+  _dst_low(NULL),
+  _dst_high(NULL),
+  _min_words(SemeruCompactDMAMinBytes / HeapWordSize),
+  _dma_words(0),
+  _cpu_fallback_words(0) {
+  size_t bytes = MaxInFlight * sizeof(CompletionRecord) + sizeof(Descriptor) + 64;
+  _raw = NEW_C_HEAP_ARRAY(char, bytes, mtGC);
+  memset(_raw, 0, bytes);
+  _desc = (Descriptor*)align_up(_raw, 64);
+  _completions = (CompletionRecord*)((char*)_desc + sizeof(Descriptor));   // 32 bytes aligned
+}
+
+G1SemeruDMACopier::~G1SemeruDMACopier() {
+  finish();
+  FREE_C_HEAP_ARRAY(char, _raw);
+}
+
+void G1SemeruDMACopier::copy_by_cpu(HeapWord* from, HeapWord* to, size_t words) {
+  Copy::aligned_conjoint_words(from, to, words);
+}
+
+/**
+ * ENQCMD, the descriptor is accepted by the shared work queue unless ZF is set.
+ * Encoded as bytes, the older assemblers don't know the instruction : enqcmd (%rdx), %rax.
+ */
+bool G1SemeruDMACopier::submit(HeapWord* from, HeapWord* to, size_t words) {
+#ifdef AMD64
+  uint index = _num_in_flight;
+  CompletionRecord* comp = &_completions[index];
+  comp->_status = SEMERU_DSA_COMP_NONE;
+
+  memset(_desc, 0, sizeof(Descriptor));
+  _desc->_flags = (SEMERU_DSA_OPCODE_MEMMOVE << 24) | SEMERU_DSA_FLAG_CRAV | SEMERU_DSA_FLAG_RCR | SEMERU_DSA_FLAG_CC;
+  _desc->_completion_addr = (uint64_t)(uintptr_t)comp;
+  _desc->_src_addr = (uint64_t)(uintptr_t)from;
+  _desc->_dst_addr = (uint64_t)(uintptr_t)to;
+  _desc->_xfer_size = (uint32_t)(words * HeapWordSize);
+
+  unsigned char retry;
+  __asm__ __volatile__(".byte 0xf2, 0x0f, 0x38, 0xf8, 0x02\n\t"
+                       "setz %0\n\t"
+                       : "=r"(retry)
+                       : "a"(_portal), "d"(_desc)
+                       : "cc", "memory");
+  if (retry) {
+    return false;
+  }
+
+  _in_flight[index]._from = from;
+  _in_flight[index]._to = to;
+  _in_flight[index]._words = words;
+  _num_in_flight++;
+
+  if (index == 0) {
+    _src_low = from;
+    _src_high = from + words;
+    _dst_low = to;
+    _dst_high = to + words;
+  } else {
+    _src_low = MIN2(_src_low, from);
+    _src_high = MAX2(_src_high, from + words);
+    _dst_low = MIN2(_dst_low, to);
+    _dst_high = MAX2(_dst_high, to + words);
+  }
+  return true;
+#else
+  return false;
+#endif
+}
+
+// Finish the rest of a failed descriptor, e.g. a page fault, by the CPU.
+void G1SemeruDMACopier::complete(uint index) {
+  CompletionRecord* comp = &_completions[index];
+  InFlight* f = &_in_flight[index];
+
+  while (comp->_status == SEMERU_DSA_COMP_NONE) {
+    SpinPause();
+  }
+  OrderAccess::loadload();
+
+  if (comp->_status == SEMERU_DSA_COMP_SUCCESS) {
+    _dma_words += f->_words;
+  } else {
+    size_t done_words = MIN2((size_t)comp->_bytes_completed / HeapWordSize, f->_words);
+    log_debug(semeru, mem_compact)("%s, descriptor of 0x%lx failed, status 0x%x, 0x%lx of 0x%lx words moved",
+                                   __func__, (size_t)f->_from, comp->_status, done_words, f->_words);
+    copy_by_cpu(f->_from + done_words, f->_to + done_words, f->_words - done_words);
+    _dma_words += done_words;
+    _cpu_fallback_words += f->_words - done_words;
+  }
+  oop(f->_to)->init_mark_raw();
+}
+
+void G1SemeruDMACopier::finish() {
+  for (uint i = 0; i < _num_in_flight; i++) {
+    complete(i);
+  }
+  _num_in_flight = 0;
+}
+
+void G1SemeruDMACopier::move(HeapWord* from, HeapWord* to, size_t words) {
+  // The destination would overwrite a source still read, or the source is being written.
+  if (_num_in_flight > 0 &&
+      ((to < _src_high && to + words > _src_low) || (from < _dst_high && from + words > _dst_low))) {
+    finish();
+  }
+
+  // Only the memmove of disjoint ranges is submitted.
+  bool disjoint = to + words <= from || from + words <= to;
+  if (words >= _min_words && disjoint) {
+    if (_num_in_flight == MaxInFlight) {
+      finish();
+    }
+    if (submit(from, to, words)) {
+      return;   // the mark word is reinitialized at the completion
+    }
+    _cpu_fallback_words += words;
+  }
+
+  copy_by_cpu(from, to, words);
+  oop(to)->init_mark_raw();
+}
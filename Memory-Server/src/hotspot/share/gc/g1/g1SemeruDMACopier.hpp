@@ -0,0 +1,103 @@
+/**
+ * Semeru Memory Server - move the large objects of the compaction by the DMA engine, -XX:SemeruCompactDMADevice.
+ *
+ */
+
+#ifndef SHARE_GC_G1_G1_SEMERU_DMA_COPIER_HPP
+#define SHARE_GC_G1_G1_SEMERU_DMA_COPIER_HPP
+
+#include "memory/allocation.hpp"
+#include "utilities/globalDefinitions.hpp"
+
+/**
+ * Semeru MS - The memory server cores are slow, the copy of the large arrays dominates the phase#3 of the compaction.
+ * The Data Streaming Accelerator of the memory server moves them instead, submitted to a shared work queue
+ * of the idxd driver from user space, e.g. /dev/dsa/wq0.0.
+ *
+ * 1) move(), the objects of at least SemeruCompactDMAMinBytes are submitted as a memmove descriptor,
+ *    the smaller ones are copied by the CPU meanwhile. The mark word of a moved object is reinitialized
+ *    when its descriptor completes.
+ * 2) The compaction slides the objects, a destination can overlap the source of an object still in flight.
+ *    Then all the descriptors are waited first. An object overlapping itself is copied by the CPU.
+ * 3) A descriptor failed on a page fault, or not accepted by the work queue, is finished by the CPU.
+ * 4) finish(), wait for all the descriptors before the Region's compaction completes.
+ *
+ * One instance per compaction worker, each worker submits to the portal by itself.
+ */
+class G1SemeruDMACopier : public CHeapObj<mtGC> {
+public:
+  // The layouts of the idxd uapi, include/uapi/linux/idxd.h.
+  struct Descriptor {
+    uint32_t _pasid;      // pasid:20, rsvd:11, priv:1. Filled by ENQCMD.
+    uint32_t _flags;      // flags:24, opcode:8
+    uint64_t _completion_addr;
+    uint64_t _src_addr;
+    uint64_t _dst_addr;
+    uint32_t _xfer_size;
+    uint16_t _int_handle;
+    uint16_t _rsvd1;
+    uint8_t  _op_specific[24];
+  };
+
+  struct CompletionRecord {
+    volatile uint8_t _status;
+    uint8_t  _result;
+    uint16_t _rsvd;
+    uint32_t _bytes_completed;
+    uint64_t _fault_addr;
+    uint8_t  _op_specific[16];
+  };
+
+private:
+  static const uint MaxInFlight = 32;
+
+  struct InFlight {
+    HeapWord* _from;
+    HeapWord* _to;
+    size_t    _words;
+  };
+
+  // The portal of the shared work queue, mapped once.
+  static void* _portal;
+
+  CompletionRecord* _completions;   // 32 bytes aligned, MaxInFlight of them
+  Descriptor*       _desc;          // 64 bytes aligned
+  void*             _raw;
+  InFlight          _in_flight[MaxInFlight];
+  uint              _num_in_flight;
+
+  // The ranges touched by the descriptors in flight.
+  HeapWord* _src_low;
+  HeapWord* _src_high;
+  HeapWord* _dst_low;
+  HeapWord* _dst_high;
+
+  size_t    _min_words;
+
+  // Statistics
+  size_t _dma_words;
+  size_t _cpu_fallback_words;
+
+  bool submit(HeapWord* from, HeapWord* to, size_t words);
+  void complete(uint index);
+  static void copy_by_cpu(HeapWord* from, HeapWord* to, size_t words);
+
+public:
+  G1SemeruDMACopier();
+  ~G1SemeruDMACopier();
+
+  // Map the portal of SemeruCompactDMADevice. False if there's no usable work queue.
+  static bool initialize();
+  static bool is_available() { return _portal != NULL; }
+
+  // Move the object of words from from to to, and reinitialize its mark word.
+  void move(HeapWord* from, HeapWord* to, size_t words);
+
+  // Wait for all the descriptors in flight.
+  void finish();
+
+  size_t dma_words() const { return _dma_words; }
+  size_t cpu_fallback_words() const { return _cpu_fallback_words; }
+};
+
+#endif // SHARE_GC_G1_G1_SEMERU_DMA_COPIER_HPP
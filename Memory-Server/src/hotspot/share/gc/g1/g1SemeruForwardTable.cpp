@@ -0,0 +1,155 @@
+/**
+ * Semeru Memory Server - per Region forwarding table of the compaction.
+ *
+ */
+
+#include "precompiled.hpp"
+#include "gc/g1/g1ConcurrentMarkBitMap.inline.hpp"
+#include "gc/g1/g1SemeruCompressor.hpp"
+#include "gc/g1/g1SemeruForwardTable.hpp"
+#include "gc/g1/SemeruHeapRegion.hpp"
+#include "logging/log.hpp"
+#include "oops/oop.inline.hpp"
+#include "utilities/align.hpp"
+#include "utilities/debug.hpp"
+
+
+G1SemeruForwardTable::G1SemeruForwardTable(uint region_index, HeapWord* bottom, size_t num_blocks, size_t num_entries) :
+  _region_index(region_index),
+  _bottom(bottom),
+  _num_blocks(num_blocks),
+  _num_entries(num_entries),
+  _buf(NULL),
+  _buf_size(0),
+  _index(NULL),
+  _entries(NULL)
+{
+  size_t index_size = align_up((num_blocks + 1) * sizeof(uint), sizeof(Entry));
+  _buf_size = index_size + num_entries * sizeof(Entry);
+  _buf      = NEW_C_HEAP_ARRAY(char, _buf_size, mtGC);
+  _index    = (uint*)_buf;
+  _entries  = (Entry*)(_buf + index_size);
+}
+
+G1SemeruForwardTable::~G1SemeruForwardTable() {
+  FREE_C_HEAP_ARRAY(char, _buf);
+}
+
+
+/**
+ * Semeru MS - Build the forwarding table of a Region.
+ *
+ * 1) Count the alive target objects, the table is allocated by the exact size.
+ * 2) Record the < old offset, new address > pair, the sparse index is filled at the same time.
+ *    The forwardee is NULL for the objects not moved, see G1SemeruCompactionPoint::forward().
+ *    In the Compressor mode, the markOop isn't a forwarding pointer, the new address comes from the compressor.
+ */
+G1SemeruForwardTable* G1SemeruForwardTable::create(SemeruHeapRegion* hr, G1CMBitMap* alive_bitmap, G1CMBitMap* target_bitmap,
+                                                   G1SemeruCompressor* compressor) {
+  HeapWord* bottom = hr->bottom();
+  HeapWord* top    = hr->top();
+  HeapWord* addr;
+
+  // 1) count
+  size_t num_entries = 0;
+  for (addr = target_bitmap->get_next_marked_addr(bottom, top); addr < top;
+       addr = target_bitmap->get_next_marked_addr(addr + 1, top)) {
+    if (alive_bitmap->is_marked(addr)) {
+      num_entries++;
+    }
+  }
+
+  size_t num_blocks = SemeruHeapRegion::SemeruGrainWords >> LogBlockWords;
+  G1SemeruForwardTable* table = new G1SemeruForwardTable(hr->hrm_index(), bottom, num_blocks, num_entries);
+
+  // 2) fill the entries and the index
+  size_t i = 0;
+  size_t block = 0;
+  for (addr = target_bitmap->get_next_marked_addr(bottom, top); addr < top;
+       addr = target_bitmap->get_next_marked_addr(addr + 1, top)) {
+    if (!alive_bitmap->is_marked(addr)) {
+      continue;
+    }
+
+    uint from = (uint)pointer_delta(addr, bottom);
+    while (block <= (from >> LogBlockWords)) {
+      table->_index[block++] = (uint)i;
+    }
+
+    table->_entries[i]._from = from;
+    if (compressor != NULL) {
+      table->_entries[i]._to = compressor->new_addr(addr);
+    } else {
+      oop forwardee = oop(addr)->forwardee();
+      table->_entries[i]._to = forwardee != NULL ? (HeapWord*)forwardee : addr;
+    }
+    i++;
+  }
+  assert(i == num_entries, "Region[0x%x] target bitmap changed during the table building.", hr->hrm_index());
+
+  while (block <= num_blocks) {
+    table->_index[block++] = (uint)i;
+  }
+
+  log_debug(semeru, mem_compact)("%s, Region[0x%x] forwarding table, 0x%lx entries, 0x%lx bytes",
+                                 __func__, hr->hrm_index(), num_entries, table->_buf_size);
+  return table;
+}
+
+
+/**
+ * Binary search within the index block of obj.
+ */
+HeapWord* G1SemeruForwardTable::forwardee(HeapWord* obj) const {
+  assert(obj >= _bottom && pointer_delta(obj, _bottom) < SemeruHeapRegion::SemeruGrainWords,
+         "obj 0x%lx is not in Region[0x%x]", (size_t)obj, _region_index);
+
+  uint   from  = (uint)pointer_delta(obj, _bottom);
+  size_t block = from >> LogBlockWords;
+  size_t low   = _index[block];
+  size_t high  = _index[block + 1];   // exclusive
+
+  while (low < high) {
+    size_t mid = low + (high - low) / 2;
+    if (_entries[mid]._from < from) {
+      low = mid + 1;
+    } else if (_entries[mid]._from > from) {
+      high = mid;
+    } else {
+      return _entries[mid]._to;
+    }
+  }
+
+  return NULL;
+}
+
+
+/**
+ * The entries in front of *cursor are all below obj, the binary search starts from there.
+ * The phase#4 batches are sorted by the target, so consecutive lookups narrow down the range.
+ */
+HeapWord* G1SemeruForwardTable::forwardee_ascending(HeapWord* obj, size_t* cursor) const {
+  assert(obj >= _bottom && pointer_delta(obj, _bottom) < SemeruHeapRegion::SemeruGrainWords,
+         "obj 0x%lx is not in Region[0x%x]", (size_t)obj, _region_index);
+
+  uint   from  = (uint)pointer_delta(obj, _bottom);
+  size_t block = from >> LogBlockWords;
+  size_t low   = MAX2(*cursor, (size_t)_index[block]);
+  size_t high  = _index[block + 1];   // exclusive
+
+  // lower bound of from
+  while (low < high) {
+    size_t mid = low + (high - low) / 2;
+    if (_entries[mid]._from < from) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+
+  *cursor = low;
+  if (low < _index[block + 1] && _entries[low]._from == from) {
+    return _entries[low]._to;
+  }
+  return NULL;
+}
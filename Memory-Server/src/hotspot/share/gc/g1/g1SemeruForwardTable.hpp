@@ -0,0 +1,81 @@
+/**
+ * Semeru Memory Server - per Region forwarding table of the compaction.
+ *
+ */
+
+#ifndef SHARE_GC_G1_G1_SEMERU_FORWARDTABLE_HPP
+#define SHARE_GC_G1_G1_SEMERU_FORWARDTABLE_HPP
+
+#include "memory/allocation.hpp"
+#include "oops/oopsHierarchy.hpp"
+#include "utilities/globalDefinitions.hpp"
+
+class G1CMBitMap;
+class G1SemeruCompressor;
+class SemeruHeapRegion;
+
+
+/**
+ * Semeru MS - The new address of the cross-region referenced objects of a compacted Region.
+ *
+ * After phase#3, the forwarding pointers in the source Region's markOop are overwritten by the copy.
+ * The inter-Region fields recorded in phase#2 are updated in phase#4 by looking up their target Region's table.
+ *
+ * 1) Only the alive objects recorded in the Region's target oop bitmap are stored.
+ *    They are the only objects referenced from other Regions, see BitQueue.
+ * 2) Built in record_new_addr_for_target_obj(), between phase#2 and phase#3, following the bitmap order.
+ *    So the entries are sorted by the old word offset.
+ * 3) A sparse index, one uint per LogBlockWords block, points to the first entry of each block.
+ *    A lookup is a binary search within one block.
+ * 4) The index and the entries are in one contiguous buffer,
+ *    so a peer server can fetch the whole table with a single RDMA read.
+ *
+ * The table is only valid for the compaction window it's built in.
+ * G1SemeruSTWCompact deletes all the tables at the end of the window.
+ */
+class G1SemeruForwardTable : public CHeapObj<mtGC> {
+public:
+  struct Entry {
+    uint      _from;    // word offset to the Region's bottom, before compaction
+    HeapWord* _to;      // address after compaction, can be the same with the old one.
+  };
+
+  static const uint LogBlockWords = 13;   // 64KB per index block
+
+private:
+  uint      _region_index;
+  HeapWord* _bottom;
+  size_t    _num_blocks;
+  size_t    _num_entries;
+
+  char*     _buf;           // [ index[_num_blocks + 1] | entries[_num_entries] ]
+  size_t    _buf_size;
+  uint*     _index;
+  Entry*    _entries;
+
+  G1SemeruForwardTable(uint region_index, HeapWord* bottom, size_t num_blocks, size_t num_entries);
+
+public:
+  ~G1SemeruForwardTable();
+
+  // Build the table of a Region, whose alive objects already have their forwarding pointer,
+  // or whose new addresses are summarized by compressor.
+  static G1SemeruForwardTable* create(SemeruHeapRegion* hr, G1CMBitMap* alive_bitmap, G1CMBitMap* target_bitmap,
+                                      G1SemeruCompressor* compressor = NULL);
+
+  // The new address of obj, NULL if obj isn't recorded in the table.
+  HeapWord* forwardee(HeapWord* obj) const;
+
+  // Same as forwardee(), for the lookups in ascending obj order.
+  // *cursor is the entry found by the previous lookup, 0 for the first one.
+  HeapWord* forwardee_ascending(HeapWord* obj, size_t* cursor) const;
+
+  uint   region_index() const { return _region_index; }
+  size_t num_entries()  const { return _num_entries;  }
+
+  // The contiguous buffer, for the RDMA transfer.
+  char*  buffer()       const { return _buf;      }
+  size_t buffer_size()  const { return _buf_size; }
+};
+
+#endif // SHARE_GC_G1_G1_SEMERU_FORWARDTABLE_HPP
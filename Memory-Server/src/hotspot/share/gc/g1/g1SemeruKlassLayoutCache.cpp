@@ -0,0 +1,75 @@
+/**
+ * Semeru Memory Server - a flat cache of the field layouts of the replicated klasses, -XX:SemeruKlassLayoutCache.
+ *
+ */
+
+#include "precompiled.hpp"
+#include "gc/g1/g1SemeruKlassLayoutCache.inline.hpp"
+#include "gc/shared/gc_globals.hpp"
+#include "logging/log.hpp"
+#include "oops/instanceKlass.hpp"
+#include "runtime/atomic.hpp"
+#include "utilities/align.hpp"
+
+G1SemeruKlassLayoutCache::Entry* G1SemeruKlassLayoutCache::_entries = NULL;
+size_t                           G1SemeruKlassLayoutCache::_mask = 0;
+Klass* const                     G1SemeruKlassLayoutCache::Busy = (Klass*)(uintptr_t)1;
+
+void G1SemeruKlassLayoutCache::initialize() {
+  STATIC_ASSERT(sizeof(Entry) == DEFAULT_CACHE_LINE_SIZE);
+
+  if (SemeruKlassLayoutCache == 0 || is_enabled()) {
+    return;
+  }
+
+  size_t num_entries = (size_t)1 << log2_intptr((intptr_t)SemeruKlassLayoutCache);
+  char* mem = NEW_C_HEAP_ARRAY(char, num_entries * sizeof(Entry) + DEFAULT_CACHE_LINE_SIZE, mtGC);
+  Entry* entries = (Entry*)align_up(mem, DEFAULT_CACHE_LINE_SIZE);
+  memset(entries, 0, num_entries * sizeof(Entry));
+
+  _mask = num_entries - 1;
+  OrderAccess::storestore();
+  _entries = entries;
+
+  log_info(semeru, mem_trace)("%s, the layouts of 0x%lx klasses are cached", __func__, num_entries);
+}
+
+void G1SemeruKlassLayoutCache::clear() {
+  if (is_enabled()) {
+    memset(_entries, 0, (_mask + 1) * sizeof(Entry));
+  }
+}
+
+/**
+ * Cache the layout of k if it's a plain instance of a fixed size, with at most MaxMaps oop maps.
+ * A lost race for the entry leaves it to the next object of the klass.
+ */
+void G1SemeruKlassLayoutCache::install(Klass* k) {
+  if (k->id() != InstanceKlassID) {
+    return;
+  }
+  const int lh = k->layout_helper();
+  if (lh <= Klass::_lh_neutral_value || Klass::layout_helper_needs_slow_path(lh)) {
+    return;
+  }
+  InstanceKlass* ik = (InstanceKlass*)k;
+  const uint num_maps = ik->nonstatic_oop_map_count();
+  if (num_maps > MaxMaps) {
+    return;
+  }
+
+  Entry* e = entry_of(k);
+  Klass* old = e->_klass;
+  if (old == Busy || old == k || Atomic::cmpxchg(Busy, &e->_klass, old) != old) {
+    return;
+  }
+
+  const OopMapBlock* map = ik->start_of_nonstatic_oop_maps();
+  e->_size     = (uint)(lh >> LogHeapWordSize);
+  e->_num_maps = num_maps;
+  for (uint i = 0; i < num_maps; i++) {
+    e->_offset[i] = map[i].offset();
+    e->_count[i]  = map[i].count();
+  }
+  OrderAccess::release_store(&e->_klass, k);
+}
@@ -0,0 +1,69 @@
+/**
+ * Semeru Memory Server - a flat cache of the field layouts of the replicated klasses, -XX:SemeruKlassLayoutCache.
+ *
+ */
+
+#ifndef SHARE_GC_G1_G1_SEMERU_KLASS_LAYOUT_CACHE_HPP
+#define SHARE_GC_G1_G1_SEMERU_KLASS_LAYOUT_CACHE_HPP
+
+#include "memory/allocation.hpp"
+#include "oops/oopsHierarchy.hpp"
+#include "utilities/globalDefinitions.hpp"
+
+class Klass;
+
+/**
+ * Semeru MS - The tracing and the pointer adjustment decode each object by its Klass, replicated from the CPU server.
+ * oop_iterate_size() reads the layout helper and the kind of the Klass, and then the oop maps,
+ * which are behind the vtable and the itable, usually on other cache lines, or other pages, of the meta space.
+ *
+ * 1) One cache line per plain InstanceKlass, its size and up to MaxMaps oop maps.
+ *    Direct mapped by the klass address, the KLASS_INSTANCE area is at the same address on every server.
+ * 2) The mirrors, references, class loaders, arrays and the instances of a slow path size aren't cached,
+ *    they go through oop_iterate_size() as before. So do the closures visiting the metadata.
+ * 3) A round of the concurrent service starts with an empty cache. The CPU server may unload a class
+ *    and reuse its metaspace for another one between two rounds.
+ *
+ * The GC workers fill the cache concurrently. A writer claims an entry by CAS on its _klass,
+ * a reader copies the entry and checks its _klass didn't change meanwhile.
+ */
+class G1SemeruKlassLayoutCache : public AllStatic {
+public:
+  static const uint MaxMaps = 5;
+
+private:
+  struct Entry {
+    Klass* volatile _klass;
+    uint            _size;                // words
+    uint            _num_maps;
+    int             _offset[MaxMaps];     // bytes
+    uint            _count[MaxMaps];
+    uint            _pad[2];              // one cache line
+  };
+
+  static Entry* _entries;
+  static size_t _mask;
+
+  static Klass* const Busy;
+
+  static Entry* entry_of(Klass* k) { return &_entries[((uintptr_t)k >> LogHeapWordSize) & _mask]; }
+
+  static bool lookup(Klass* k, Entry* copy);
+  static void install(Klass* k);
+
+  template <typename T, class OopClosureType>
+  static void iterate_fields(oop obj, const Entry* e, OopClosureType* cl);
+
+public:
+  static void initialize();
+  static bool is_enabled() { return _entries != NULL; }
+
+  // Between the rounds of the concurrent service, no GC worker is running.
+  static void clear();
+
+  // oop_iterate_size(), through the cached layout if there is one.
+  template <class OopClosureType>
+  static int oop_iterate_size(oop obj, OopClosureType* cl);
+};
+
+#endif // SHARE_GC_G1_G1_SEMERU_KLASS_LAYOUT_CACHE_HPP
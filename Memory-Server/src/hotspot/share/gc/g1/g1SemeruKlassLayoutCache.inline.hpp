@@ -0,0 +1,53 @@
+/**
+ * Semeru Memory Server - a flat cache of the field layouts of the replicated klasses, -XX:SemeruKlassLayoutCache.
+ *
+ */
+
+#ifndef SHARE_GC_G1_G1_SEMERU_KLASS_LAYOUT_CACHE_INLINE_HPP
+#define SHARE_GC_G1_G1_SEMERU_KLASS_LAYOUT_CACHE_INLINE_HPP
+
+#include "gc/g1/g1SemeruKlassLayoutCache.hpp"
+#include "memory/iterator.inline.hpp"
+#include "oops/oop.inline.hpp"
+#include "runtime/orderAccess.hpp"
+
+inline bool G1SemeruKlassLayoutCache::lookup(Klass* k, Entry* copy) {
+  const Entry* e = entry_of(k);
+  if (OrderAccess::load_acquire(&e->_klass) != k) {
+    return false;
+  }
+  *copy = *e;
+  OrderAccess::loadload();
+  return e->_klass == k;   // not claimed for another klass while copied
+}
+
+template <typename T, class OopClosureType>
+inline void G1SemeruKlassLayoutCache::iterate_fields(oop obj, const Entry* e, OopClosureType* cl) {
+  for (uint i = 0; i < e->_num_maps; i++) {
+    T* p         = (T*)obj->obj_field_addr_raw<T>(e->_offset[i]);
+    T* const end = p + e->_count[i];
+    for (; p < end; ++p) {
+      Devirtualizer::semeru_do_field(obj, cl, p);
+    }
+  }
+}
+
+template <class OopClosureType>
+inline int G1SemeruKlassLayoutCache::oop_iterate_size(oop obj, OopClosureType* cl) {
+  if (is_enabled() && !Devirtualizer::do_metadata(cl)) {
+    Klass* k = obj->klass();
+    Entry e;
+    if (lookup(k, &e)) {
+      if (UseCompressedOops) {
+        iterate_fields<narrowOop>(obj, &e, cl);
+      } else {
+        iterate_fields<oop>(obj, &e, cl);
+      }
+      return (int)e._size;
+    }
+    install(k);
+  }
+  return obj->oop_iterate_size(cl);
+}
+
+#endif // SHARE_GC_G1_G1_SEMERU_KLASS_LAYOUT_CACHE_INLINE_HPP
@@ -0,0 +1,230 @@
+/**
+ * Semeru Memory Server - scan the remembered set cards of the evicted old Regions, -XX:+SemeruRemoteCardScan on the CPU server.
+ * And refine their dirty cards, -XX:+SemeruRemoteRefinement on the CPU server.
+ * And update the Regions kept in place by the full GC, -XX:+SemeruRemoteFullGC on the CPU server.
+ * And send the fields out of the Regions the concurrent mark leaves, -XX:+SemeruRemoteConcurrentMark on the CPU server.
+ * And copy or fill the swapped out array ranges, -XX:+SemeruRemoteArrayOps on the CPU server.
+ *
+ */
+
+#include "precompiled.hpp"
+#include "gc/g1/g1SemeruCollectedHeap.inline.hpp"
+#include "gc/g1/g1SemeruColdStore.hpp"
+#include "gc/g1/g1SemeruCompressedOops.inline.hpp"
+#include "gc/g1/g1SemeruRemoteCardScanThread.hpp"
+#include "gc/shared/rdmaStructure.hpp"
+#include "logging/log.hpp"
+#include "memory/iterator.inline.hpp"
+#include "oops/oop.inline.hpp"
+#include "runtime/orderAccess.hpp"
+#include "runtime/os.hpp"
+#include "runtime/rdma_comm.hpp"
+
+// The doorbell wait is bounded, to notice the termination.
+static const int remote_card_scan_wait_ms = 100;
+
+// Record the fields pointing into the Regions marked by the CPU server,
+// or for the refinement, into any other Region.
+class G1SemeruRemoteCardClosure : public BasicOopIterateClosure {
+  G1SemeruCollectedHeap* _heap;
+  remote_card_scan*      _scan;
+  bool                   _refine;
+
+  template <class T>
+  void do_oop_work(T* p) {
+    oop const obj = SemeruCompressedOops::load_decode(p);
+    if (obj == NULL || !_heap->is_in_g1_reserved(obj)) {
+      return;
+    }
+    uint const region = _heap->addr_to_region((HeapWord*)obj);
+    if (_refine ? region != _heap->addr_to_region((HeapWord*)p) : _scan->_in_cset[region] != 0) {
+      _scan->add((void*)p, (HeapWord*)obj);
+    }
+  }
+
+public:
+  G1SemeruRemoteCardClosure(G1SemeruCollectedHeap* heap, remote_card_scan* scan) :
+    _heap(heap), _scan(scan), _refine(scan->_mode == remote_card_scan::Refine) { }
+
+  // The refinement visits the referents as fields, as G1ConcurrentRefineOopClosure on the CPU server.
+  virtual ReferenceIterationMode reference_iteration_mode() { return _refine ? DO_FIELDS : DO_DISCOVERY; }
+
+  virtual void do_oop(oop* p)       { do_oop_work(p); }
+  virtual void do_oop(narrowOop* p) { do_oop_work(p); }
+};
+
+
+G1SemeruRemoteCardScanThread::G1SemeruRemoteCardScanThread(remote_card_scan* scan, remote_card_scan* refine,
+                                                           remote_array_op* array_op) :
+  ConcurrentGCThread(),
+  _vtime_start(0.0),
+  _vtime_accum(0.0),
+  _scan(scan),
+  _refine(refine),
+  _array_op(array_op)
+{
+  set_name("G1 Semeru Remote Card Scan");
+  create_and_start();
+}
+
+/**
+ * Semeru Memory Server - Walk the objects of each requested card, see remote_card_scan.
+ *
+ * The Regions are fully evicted, the content here is complete. The CPU server only sends the cards
+ * whose block starts above its prev TAMS, every object from the block on is live and parsable.
+ * As the local scan of the CPU server, an object array is only visited within the card,
+ * any other object overlapping the card is visited in full.
+ */
+void G1SemeruRemoteCardScanThread::serve_request(remote_card_scan* scan) {
+  uint32_t seq = scan->_request_seq;
+  if (seq == scan->_done_seq) {
+    return;
+  }
+  OrderAccess::loadload();   // the cards are written before the sequence.
+
+  G1SemeruCollectedHeap* semeru_heap = G1SemeruCollectedHeap::heap();
+  if (scan->_mode == remote_card_scan::Apply) {
+    apply_slots(semeru_heap, scan, seq);
+    return;
+  }
+
+  G1SemeruRemoteCardClosure cl(semeru_heap, scan);
+  double start = os::elapsedTime();
+  uint32_t num_cards = MIN2((uint32_t)scan->_num_cards, (uint32_t)SEMERU_MAX_REMOTE_CARDS);
+  scan->clear_slots();
+
+  for (uint32_t i = 0; i < num_cards && scan->_overflow == 0; i++) {
+    remote_card_scan::card* c = &scan->_cards[i];
+    if (!semeru_heap->is_in_g1_reserved(c->_block) || c->_block > c->_start || c->_start >= c->_end ||
+        semeru_heap->addr_to_region(c->_block) != semeru_heap->addr_to_region(c->_end - 1)) {
+      log_warning(semeru, mem_trace)("%s, request %u, wrong card [0x%lx, 0x%lx) from 0x%lx.", __func__, seq,
+                                     (size_t)c->_start, (size_t)c->_end, (size_t)c->_block);
+      scan->_overflow = 1;
+      break;
+    }
+
+    // The last object may run over the card, up to the end of its Region.
+    G1SemeruColdStore::restore(c->_block, semeru_heap->heap_region_containing(c->_block)->end());
+
+    MemRegion mr(c->_start, c->_end);
+    for (HeapWord* cur = c->_block; cur < c->_end && scan->_overflow == 0; ) {
+      oop obj = oop(cur);
+      HeapWord* next = cur + obj->size();
+      if (next > c->_start) {
+        if (!obj->is_objArray() || (cur >= c->_start && next <= c->_end)) {
+          obj->oop_iterate(&cl);
+        } else {
+          obj->oop_iterate(&cl, mr);
+        }
+      }
+      cur = next;
+    }
+    scan->_num_scanned++;
+  }
+
+  scan->publish(seq);
+  log_debug(semeru, mem_trace)("%s, %s %u, %u cards, 0x%lx slots%s, %.3f ms.", __func__,
+                               scan->_mode == remote_card_scan::Refine ? "refinement" : "request", seq, num_cards,
+                               (size_t)scan->_num_slots, scan->_overflow ? " (overflow)" : "", (os::elapsedTime() - start) * 1000.0);
+}
+
+/**
+ * Semeru Memory Server - Store the new values of the fields of a Region kept in place by the CPU full GC.
+ *
+ * The CPU server compacted the rest of the heap, _slots holds [field, new value]. A slot out of the heap
+ * stops the request with _overflow, the CPU server stores the rest itself. Nothing is read back.
+ */
+void G1SemeruRemoteCardScanThread::apply_slots(G1SemeruCollectedHeap* semeru_heap, remote_card_scan* scan, uint32_t seq) {
+  size_t num_slots = MIN2((size_t)scan->_num_slots, (size_t)SEMERU_MAX_REMOTE_SLOTS);
+  scan->_overflow    = 0;
+  scan->_num_scanned = 0;
+
+  for (size_t i = 0; i < num_slots; i++) {
+    remote_card_scan::slot* s = &scan->_slots[i];
+    if (!semeru_heap->is_in_g1_reserved(s->_addr) || !semeru_heap->is_in_g1_reserved(s->_value)) {
+      log_warning(semeru, mem_trace)("%s, request %u, wrong slot 0x%lx -> 0x%lx.", __func__, seq,
+                                     (size_t)s->_addr, (size_t)s->_value);
+      scan->_overflow = 1;
+      break;
+    }
+    G1SemeruColdStore::restore(s->_addr, (char*)s->_addr + (UseCompressedOops ? sizeof(narrowOop) : sizeof(oop)));
+    if (UseCompressedOops) {
+      SemeruCompressedOops::store_not_null((narrowOop*)s->_addr, oop(s->_value));
+    } else {
+      SemeruCompressedOops::store_not_null((oop*)s->_addr, oop(s->_value));
+    }
+    scan->_num_scanned++;
+  }
+
+  scan->_num_slots = 0;
+  scan->publish(seq);
+  log_debug(semeru, mem_trace)("%s, request %u, 0x%lx of 0x%lx slots stored.", __func__, seq,
+                               (size_t)scan->_num_scanned, num_slots);
+}
+
+/**
+ * Semeru Memory Server - Copy or fill the array range of a request, see remote_array_op.
+ *
+ * The CPU server swapped out every page of it and doesn't touch them until the reply, it drops their
+ * local copies then. A request it cancelled in the meantime, or out of the heap, is refused.
+ */
+void G1SemeruRemoteCardScanThread::serve_array_op(remote_array_op* op) {
+  uint32_t seq = op->_request_seq;
+  if (seq == op->_done_seq) {
+    return;
+  }
+  OrderAccess::loadload();   // the request is written before the sequence.
+
+  G1SemeruCollectedHeap* semeru_heap = G1SemeruCollectedHeap::heap();
+  char*  dst   = op->_dst;
+  char*  src   = op->_src;
+  size_t bytes = op->_bytes;
+  bool   copy  = op->_op == remote_array_op::Copy;
+  if (seq <= op->_cancel_seq || bytes == 0 ||
+      !semeru_heap->is_in_g1_reserved(dst) || !semeru_heap->is_in_g1_reserved(dst + bytes - 1) ||
+      (copy && (!semeru_heap->is_in_g1_reserved(src) || !semeru_heap->is_in_g1_reserved(src + bytes - 1)))) {
+    log_debug(semeru, mem_trace)("%s, array op %u refused, 0x%lx bytes at 0x%lx.", __func__, seq, bytes, (size_t)dst);
+    op->publish(seq, remote_array_op::Refused);
+    return;
+  }
+
+  double start = os::elapsedTime();
+  if (copy) {
+    G1SemeruColdStore::restore(src, src + bytes);
+  }
+  G1SemeruColdStore::restore(dst, dst + bytes);
+  if (copy) {
+    memmove(dst, src, bytes);
+  } else {
+    memset(dst, (int)(op->_value & 0xff), bytes);
+  }
+
+  op->publish(seq, remote_array_op::Done);
+  log_debug(semeru, mem_trace)("%s, array op %u, %s of 0x%lx bytes at 0x%lx, %.3f ms.", __func__, seq,
+                               copy ? "copy" : "fill", bytes, (size_t)dst, (os::elapsedTime() - start) * 1000.0);
+}
+
+void G1SemeruRemoteCardScanThread::run_service() {
+  _vtime_start = os::elapsedVTime();
+  uint32_t doorbell_seen = cpu_server_doorbell();
+
+  while (!should_terminate()) {
+    serve_request(_scan);
+    serve_request(_refine);
+    serve_array_op(_array_op);
+
+    doorbell_seen = wait_for_cpu_server_doorbell(doorbell_seen, remote_card_scan_wait_ms);
+
+    if (os::supports_vtime()) {
+      _vtime_accum = (os::elapsedVTime() - _vtime_start);
+    } else {
+      _vtime_accum = 0.0;
+    }
+  }
+
+  log_debug(semeru, mem_trace)("%s, stopping", __func__);
+}
+
+void G1SemeruRemoteCardScanThread::stop_service() {
+  // Nothing to notify, the doorbell wait times out.
+}
@@ -0,0 +1,49 @@
+/**
+ * Semeru Memory Server - scan the remembered set cards of the evicted old Regions, -XX:+SemeruRemoteCardScan on the CPU server.
+ * And refine their dirty cards, -XX:+SemeruRemoteRefinement on the CPU server.
+ * And update the Regions kept in place by the full GC, -XX:+SemeruRemoteFullGC on the CPU server.
+ * And copy or fill the swapped out array ranges, -XX:+SemeruRemoteArrayOps on the CPU server.
+ *
+ */
+
+#ifndef SHARE_GC_G1_G1_SEMERU_REMOTECARDSCANTHREAD_HPP
+#define SHARE_GC_G1_G1_SEMERU_REMOTECARDSCANTHREAD_HPP
+
+#include "gc/shared/concurrentGCThread.hpp"
+
+class G1SemeruCollectedHeap;
+class remote_array_op;
+class remote_card_scan;
+
+/**
+ * Semeru MS - The card scan thread, serves the requests of the two remote_card_scan, the pause scan and the refinement,
+ * and the array copies and fills of the remote_array_op.
+ *
+ * The CPU server waits for the reply at the start of its evacuation pause, so the request isn't left
+ * to the concurrent mark thread, which may be in the middle of tracing a Region.
+ * It sleeps on the doorbell of the CPU server and only reads the heap, except the Apply requests
+ * of the CPU full GC, sent while the CPU server is at a safepoint and the Regions are fully evicted,
+ * and the array ops, which only write the primitive content of old or humongous Regions out of our CSet.
+ */
+class G1SemeruRemoteCardScanThread: public ConcurrentGCThread {
+  double _vtime_start;  // Initial virtual time.
+  double _vtime_accum;  // Accumulated virtual time.
+
+  remote_card_scan* _scan;     // REMOTE_CARD_SCAN_OFFSET
+  remote_card_scan* _refine;   // REMOTE_REFINE_OFFSET
+  remote_array_op*  _array_op; // REMOTE_ARRAY_OP_OFFSET
+
+  void serve_request(remote_card_scan* scan);
+  void serve_array_op(remote_array_op* op);
+  void apply_slots(G1SemeruCollectedHeap* semeru_heap, remote_card_scan* scan, uint32_t seq);
+
+  void run_service();
+  void stop_service();
+public:
+  G1SemeruRemoteCardScanThread(remote_card_scan* scan, remote_card_scan* refine, remote_array_op* array_op);
+
+  // Total virtual time so far.
+  double vtime_accum() { return _vtime_accum; }
+};
+
+#endif // SHARE_GC_G1_G1_SEMERU_REMOTECARDSCANTHREAD_HPP
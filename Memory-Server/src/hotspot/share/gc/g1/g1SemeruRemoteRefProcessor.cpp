@@ -0,0 +1,201 @@
+/**
+ * Semeru Memory Server - clear the dead referents of the compacted Regions, -XX:+SemeruRemoteRefProcessing on the CPU server.
+ *
+ */
+
+#include "precompiled.hpp"
+#include "classfile/javaClasses.inline.hpp"
+#include "gc/g1/g1ConcurrentMarkBitMap.inline.hpp"
+#include "gc/g1/g1SemeruCollectedHeap.inline.hpp"
+#include "gc/g1/g1SemeruCompressedOops.inline.hpp"
+#include "gc/g1/g1SemeruCompressor.hpp"
+#include "gc/g1/g1SemeruRemoteRefProcessor.hpp"
+#include "gc/g1/g1SemeruSTWCompact.inline.hpp"
+#include "gc/g1/SemeruHeapRegion.inline.hpp"
+#include "gc/shared/rdmaStructure.hpp"
+#include "logging/log.hpp"
+#include "oops/instanceKlass.hpp"
+#include "oops/oop.inline.hpp"
+
+
+// The fields of the Semeru heap are encoded by the CPU server.
+static oop load_field(oop obj, int offset) {
+  if (UseCompressedOops) {
+    return SemeruCompressedOops::load_decode(obj->obj_field_addr_raw<narrowOop>(offset));
+  }
+  return SemeruCompressedOops::load_decode(obj->obj_field_addr_raw<oop>(offset));
+}
+
+// at is the address of obj after the compaction, where the field is finally written.
+static void store_field(HeapWord* obj, int offset, HeapWord* value, SemeruHeapRegion* hr, HeapWord* at) {
+  hr->note_rewritten((char*)at + offset, (char*)at + offset + heapOopSize);
+  if (UseCompressedOops) {
+    SemeruCompressedOops::store((narrowOop*)((char*)obj + offset), (oop)value);
+  } else {
+    SemeruCompressedOops::store((oop*)((char*)obj + offset), (oop)value);
+  }
+}
+
+static bool is_cleared_by_gc(ReferenceType type) {
+  return type == REF_SOFT || type == REF_WEAK || type == REF_PHANTOM;
+}
+
+
+bool G1SemeruRemoteRefDiscoverer::is_clearable(oop obj, ReferenceType type, SemeruHeapRegion* hr,
+                                               flags_of_cpu_server_state* cpu_server_flags) {
+  if (!cpu_server_flags->_remote_ref_processing || hr->is_humongous() || !is_cleared_by_gc(type)) {
+    return false;
+  }
+
+  oop referent = load_field(obj, java_lang_ref_Reference::referent_offset);
+  if (referent == NULL || !hr->is_in((HeapWord*)referent)) {
+    return false;   // the referent in another Region is alive by its target queue, if it's alive.
+  }
+  if (load_field(obj, java_lang_ref_Reference::discovered_offset) != NULL) {
+    return false;   // on a list of the CPU server.
+  }
+
+  // LRUCurrentHeapPolicy::should_clear_reference()
+  if (type == REF_SOFT) {
+    jlong interval = cpu_server_flags->_soft_ref_clock - java_lang_ref_SoftReference::timestamp(obj);
+    if (interval <= cpu_server_flags->_soft_ref_max_interval) {
+      return false;
+    }
+  }
+  return true;
+}
+
+
+bool G1SemeruRemoteRefDiscoverer::discover_reference(oop obj, ReferenceType type) {
+  SemeruHeapRegion* hr = _semeru_h->heap_region_containing(obj);
+  if (!is_clearable(obj, type, hr, _semeru_h->cpu_server_flags())) {
+    return false;
+  }
+
+  // Skip the referent, it's marked later if it's reachable by any other path.
+  oop referent = load_field(obj, java_lang_ref_Reference::referent_offset);
+  return !hr->alive_bitmap()->is_marked(referent);
+}
+
+
+
+
+G1SemeruDeadReferents::G1SemeruDeadReferents() :
+  _region(NULL),
+  _refs(new (ResourceObj::C_HEAP, mtGC) GrowableArray<HeapWord*>(16, true, mtGC)),
+  _slot(0),
+  _head(NULL),
+  _tail(NULL) { }
+
+G1SemeruDeadReferents::~G1SemeruDeadReferents() {
+  delete _refs;
+}
+
+
+/**
+ * The referent of a collected Reference is freed by the compaction, so all of them are cleared.
+ * The ones already on a list of the CPU server aren't chained, the CPU server drops them as cleared.
+ */
+bool G1SemeruDeadReferents::collect(SemeruHeapRegion* hr, G1CMBitMap* alive_bitmap,
+                                    flags_of_cpu_server_state* cpu_server_flags, flags_of_mem_server_state* mem_server_flags) {
+  _region = hr;
+  _refs->clear();
+  _head = NULL;
+  _tail = NULL;
+
+  if (!cpu_server_flags->_remote_ref_processing || hr->is_humongous()) {
+    return true;    // all the referents are marked.
+  }
+
+  HeapWord* top = hr->top();
+  for (HeapWord* addr = alive_bitmap->get_next_marked_addr(hr->bottom(), top); addr < top;
+       addr = alive_bitmap->get_next_marked_addr(addr + oop(addr)->size(), top)) {
+    Klass* k = oop(addr)->klass();
+    if (!k->is_instance_klass() || !is_cleared_by_gc(InstanceKlass::cast(k)->reference_type())) {
+      continue;
+    }
+
+    oop referent = load_field(oop(addr), java_lang_ref_Reference::referent_offset);
+    if (referent != NULL && hr->is_in((HeapWord*)referent) && !alive_bitmap->is_marked(referent)) {
+      _refs->append(addr);
+    }
+  }
+
+  if (is_empty()) {
+    return true;
+  }
+
+  if (!mem_server_flags->reserve_pending_ref_chain(&_slot)) {
+    log_debug(semeru, mem_compact)("%s, no slot for the 0x%x References of Region[0x%x], skip its compaction.",
+                                   __func__, _refs->length(), hr->hrm_index());
+    return false;
+  }
+  return true;
+}
+
+
+void G1SemeruDeadReferents::clear_in_place() {
+  HeapWord* next = NULL;    // the tail's discovered field, the CPU server links it to its pending list.
+
+  for (int i = 0; i < _refs->length(); i++) {
+    HeapWord* ref = _refs->at(i);
+    bool listed = load_field(oop(ref), java_lang_ref_Reference::discovered_offset) != NULL;
+
+    store_field(ref, java_lang_ref_Reference::referent_offset, NULL, _region, ref);
+    if (listed) {
+      continue;
+    }
+    store_field(ref, java_lang_ref_Reference::discovered_offset, next, _region, ref);
+    if (_tail == NULL) {
+      _tail = ref;
+    }
+    _head = ref;
+    next  = ref;
+  }
+}
+
+
+void G1SemeruDeadReferents::record_new_addrs(G1SemeruCompressor* compressor) {
+  if (_head == NULL) {
+    return;
+  }
+
+  HeapWord* new_head = G1SemeruAdjustClosure::new_addr_of(oop(_head), compressor);
+  HeapWord* new_tail = G1SemeruAdjustClosure::new_addr_of(oop(_tail), compressor);
+  _head = new_head != NULL ? new_head : _head;    // NULL for not moved
+  _tail = new_tail != NULL ? new_tail : _tail;
+}
+
+
+/**
+ * The copies in the shadow have their fields adjusted, a dead referent to a meaningless new address.
+ * The Region itself still has the original fields.
+ */
+void G1SemeruDeadReferents::clear_in_shadow(G1SemeruCompressor* compressor, HeapWord* shadow) {
+  HeapWord* bottom = _region->bottom();
+  HeapWord* next = NULL;
+
+  for (int i = 0; i < _refs->length(); i++) {
+    HeapWord* ref     = _refs->at(i);
+    HeapWord* new_ref = compressor->new_addr(ref);
+    HeapWord* copy    = shadow + pointer_delta(new_ref, bottom);
+
+    store_field(copy, java_lang_ref_Reference::referent_offset, NULL, _region, new_ref);
+    if (load_field(oop(ref), java_lang_ref_Reference::discovered_offset) != NULL) {
+      continue;
+    }
+    store_field(copy, java_lang_ref_Reference::discovered_offset, next, _region, new_ref);
+    if (_tail == NULL) {
+      _tail = new_ref;
+    }
+    _head = new_ref;
+    next  = new_ref;
+  }
+}
+
+
+void G1SemeruDeadReferents::publish(flags_of_mem_server_state* mem_server_flags, size_t slot, HeapWord* head, HeapWord* tail) {
+  mem_server_flags->publish_pending_ref_chain(slot, head, tail);
+
+  log_debug(semeru, mem_compact)("%s, pending References[0x%lx] head 0x%lx tail 0x%lx", __func__, slot, (size_t)head, (size_t)tail);
+}
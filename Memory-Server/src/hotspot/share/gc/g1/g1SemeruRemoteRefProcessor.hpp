@@ -0,0 +1,92 @@
+/**
+ * Semeru Memory Server - clear the dead referents of the compacted Regions, -XX:+SemeruRemoteRefProcessing on the CPU server.
+ *
+ */
+
+#ifndef SHARE_GC_G1_G1_SEMERU_REMOTEREFPROCESSOR_HPP
+#define SHARE_GC_G1_G1_SEMERU_REMOTEREFPROCESSOR_HPP
+
+#include "gc/shared/referenceDiscoverer.hpp"
+#include "memory/allocation.hpp"
+#include "memory/referenceType.hpp"
+#include "oops/oopsHierarchy.hpp"
+#include "utilities/globalDefinitions.hpp"
+#include "utilities/growableArray.hpp"
+
+class flags_of_cpu_server_state;
+class flags_of_mem_server_state;
+class G1CMBitMap;
+class G1SemeruCollectedHeap;
+class G1SemeruCompressor;
+class SemeruHeapRegion;
+
+
+/**
+ * Semeru MS - The Soft, Weak and Phantom References are processed here, only the cleared ones go back to the CPU server.
+ *
+ * 1) The concurrent tracing skips the referent of a Reference, when the referent is in the same Region,
+ *    not marked yet, and the SoftReference policy of the CPU server lets it go, see G1SemeruRemoteRefDiscoverer.
+ *    A referent reached by any other path is marked as usual.
+ * 2) The compaction of the Region collects the References whose referent is still not marked,
+ *    clears their referents and links them by their discovered fields, see G1SemeruDeadReferents.
+ *    The concurrent compaction does it in the shadow, so the clearing is committed or discarded with the Region's image.
+ * 3) The <head, tail> of the chain is reported in flags_of_mem_server_state.
+ *    The CPU server links the tail to its pending list at the start of its next STW window,
+ *    G1CollectedHeap::enqueue_remote_pending_references(), the Reference objects are never swapped in for the discovery.
+ *
+ * The FinalReferences, and the referents in other Regions, are traced strongly and left to the CPU server.
+ * A Reference already on a discovered or pending list, with a discovered field, is left too.
+ */
+class G1SemeruRemoteRefDiscoverer : public ReferenceDiscoverer {
+  G1SemeruCollectedHeap* _semeru_h;
+
+public:
+  G1SemeruRemoteRefDiscoverer(G1SemeruCollectedHeap* semeru_h) : _semeru_h(semeru_h) { }
+
+  // True to skip the referent. Invoked for a not NULL referent.
+  virtual bool discover_reference(oop obj, ReferenceType type);
+
+  // The Reference obj of hr can have its referent cleared, if the referent stays unmarked.
+  static bool is_clearable(oop obj, ReferenceType type, SemeruHeapRegion* hr, flags_of_cpu_server_state* cpu_server_flags);
+};
+
+
+/**
+ * Semeru MS - The References of a compacted Region whose referent is dead.
+ *  Only the worker compacting the Region uses it.
+ */
+class G1SemeruDeadReferents : public StackObj {
+  SemeruHeapRegion*          _region;
+  GrowableArray<HeapWord*>*  _refs;     // old addresses, in the bitmap order
+  size_t                     _slot;     // the reserved slot of flags_of_mem_server_state::_pending_ref_chains
+  HeapWord*                  _head;     // new addresses
+  HeapWord*                  _tail;
+
+public:
+  G1SemeruDeadReferents();
+  ~G1SemeruDeadReferents();
+
+  // Collect the References of hr whose referent isn't marked in alive_bitmap, hr is only read.
+  // Reserve a slot for their chain. False if no slot is left, hr can't be compacted in this window.
+  bool collect(SemeruHeapRegion* hr, G1CMBitMap* alive_bitmap,
+               flags_of_cpu_server_state* cpu_server_flags, flags_of_mem_server_state* mem_server_flags);
+
+  bool is_empty() const { return _refs->is_empty(); }
+
+  // The STW compaction, before phase#1. Linked by the old addresses, phase#2 adjusts the discovered fields.
+  void clear_in_place();
+  // The STW compaction, after phase#1.
+  void record_new_addrs(G1SemeruCompressor* compressor);
+
+  // The concurrent compaction, after the Region is compacted into the shadow. Linked by the new addresses.
+  void clear_in_shadow(G1SemeruCompressor* compressor, HeapWord* shadow);
+
+  size_t    slot() const { return _slot; }
+  HeapWord* head() const { return _head; }
+  HeapWord* tail() const { return _tail; }
+
+  // Report the chain of a reserved slot, a NULL head drops it.
+  static void publish(flags_of_mem_server_state* mem_server_flags, size_t slot, HeapWord* head, HeapWord* tail);
+};
+
+#endif // SHARE_GC_G1_G1_SEMERU_REMOTEREFPROCESSOR_HPP
@@ -2,6 +2,18 @@
 
 // Have to use some G1SemeruConcurrentMark's structure
 #include "gc/g1/g1SemeruConcurrentMark.hpp"
+#include "gc/g1/g1SemeruColdStore.hpp"
+#include "gc/g1/g1SemeruCompactChunk.hpp"
+#include "gc/g1/g1SemeruConcurrentCompact.hpp"
+#include "gc/g1/g1SemeruCompressor.hpp"
+#include "gc/g1/g1SemeruCounters.hpp"
+#include "gc/g1/g1SemeruDMACopier.hpp"
+#include "gc/g1/g1SemeruForwardTable.hpp"
+#include "gc/g1/g1SemeruRemoteRefProcessor.hpp"
+#include "jfr/jfrEvents.hpp"
+#include "runtime/prefetch.inline.hpp"
+#include "runtime/rdma_comm.hpp"
+#include "utilities/quickSort.hpp"
 
 
 
@@ -30,6 +42,12 @@ G1SemeruSTWCompact::G1SemeruSTWCompact(G1SemeruCollectedHeap* 	g1h,
 	_concurrent(false),
 	_has_aborted(false),
 	_compaction_points(NULL),
+	_freed_regions(NULL),
+	_num_freed_regions(0),
+	_chunk_tasks(NULL),
+	_num_chunked_regions(0),
+	_concurrent_compact(NULL),
+	_compact_deadline(0.0),
 	_gc_timer_cm(new (ResourceObj::C_HEAP, mtGC) ConcurrentGCTimer()),
 	_gc_tracer_cm(new (ResourceObj::C_HEAP, mtGC) G1OldTracer()),
 
@@ -75,11 +93,24 @@ G1SemeruSTWCompact::G1SemeruSTWCompact(G1SemeruCollectedHeap* 	g1h,
   for (uint i = 0; i < _max_num_tasks; i++) {
     _compaction_points[i] = new G1SemeruCompactionPoint();
   }
+	_freed_regions = NEW_C_HEAP_ARRAY(SemeruHeapRegion*, _semeru_h->max_regions(), mtGC);
+
+	// Chunks of the large Regions, 1 word at least.
+	size_t chunk_words = MAX2(SemeruCompactChunkSize / HeapWordSize, (size_t)1);
+	_chunk_tasks = NEW_C_HEAP_ARRAY(G1SemeruCompactChunkTask*, _max_num_tasks, mtGC);
+	for (uint i = 0; i < _max_num_tasks; i++) {
+		_chunk_tasks[i] = new G1SemeruCompactChunkTask(SemeruHeapRegion::SemeruGrainWords, chunk_words);
+	}
+
+	_concurrent_compact = new G1SemeruConcurrentCompact(this);
 
 
 
 
 	
+	// The portal of the DMA engine is mapped once, each task builds its descriptors.
+	G1SemeruDMACopier::initialize();
+
 	// We don't register the G1SemeruCompactTask here
 	// But We allocate and register the compatc task queue here.
 	//
@@ -177,7 +208,16 @@ void G1SemeruSTWCompact::semeru_stw_compact() {
 
 	_num_concurrent_workers = _num_active_tasks;  // This value is gotten from G1SemeruConcurrentMark
 
+	// Within the budget, the most profitable Regions go first.
+	if (SemeruCompactGarbageFirst) {
+		_mem_server_cset->order_unclaimed_cm_scanned_regions();
+	}
+
 	uint active_workers = MAX2(1U, _num_concurrent_workers);
+	if (SemeruAdaptiveConcGCThreads) {
+		// One worker per Region to compact. The chunks of a large Region are helped by the workers done early.
+		active_workers = (uint)MIN2((size_t)active_workers, MAX2(_mem_server_cset->num_unclaimed_cm_scanned_regions(), (size_t)1));
+	}
 
 	// Setting active workers is not guaranteed since fewer
 	// worker threads may currently exist and more may not be
@@ -187,16 +227,127 @@ void G1SemeruSTWCompact::semeru_stw_compact() {
 
 	// Parallel task terminator is set in "set_concurrency_and_phase()"
 	set_concurrency_and_phase(active_workers, true /* concurrent */);  // actually here is executed in STW.
+	_num_freed_regions = 0;
 
 	// Build the G1SemeruSTWCompactGangTask here.
 	// How about move them into G1SemeruSTWCompact, and get one to run here.
+	jlong compact_start = os::elapsed_counter();
 	G1SemeruSTWCompactGangTask compacting_task(this, active_workers);  		// Invoke the G1SemeruSTWCompactGangTask WorkGang to run.
 	_concurrent_workers->run_task(&compacting_task);		// STWCompact share ConcurrentMark's concurrent workers.
+	_semeru_h->semeru_counters()->add_compact_ticks(os::elapsed_counter() - compact_start);
+	_semeru_h->semeru_counters()->update();
 	print_stats();
-	
+	log_debug(semeru, mem_compact)("%s, 0x%x Regions freed in this window.", __func__, num_freed_regions());
+
+	// The inter-Region references are all updated now.
+	delete_fwd_tables();
+	sync_cxl_regions();
+	record_rewritten_pages();
+}
+
+
+/**
+ * Semeru MS - Help the other workers compacting their large Regions by chunks.
+ * 	Only the chunks of the phase published now are claimed, the owner publishes its next phase later.
+ */
+bool G1SemeruSTWCompact::help_compact_chunks(G1SemeruSTWCompactTerminatorTask* worker) {
+	bool worked = false;
+
+	for (uint i = 0; i < _num_active_tasks; i++) {
+		if (i != worker->worker_id()) {
+			worked |= _chunk_tasks[i]->help(worker);
+		}
+	}
+	return worked;
+}
+
+
+/**
+ * Semeru MS - Append a worker's freed Regions at the end of its compaction.
+ * 	A Region is freed by one worker only, the slices never overlap.
+ */
+void G1SemeruSTWCompact::merge_freed_regions(G1SemeruCompactionPoint* cp) {
+	GrowableArray<SemeruHeapRegion*>* freed = cp->freed_regions();
+	uint num = (uint)freed->length();
+	if (num == 0) {
+		return;
+	}
+
+	uint start = Atomic::add(num, &_num_freed_regions) - num;
+	assert(start + num <= _semeru_h->max_regions(), "freed 0x%x Regions, more than the heap", start + num);
+	for (uint i = 0; i < num; i++) {
+		_freed_regions[start + i] = freed->at(i);
+	}
+}
+
+
+/**
+ * Semeru MS - The forwarding tables are only valid for current compaction window.
+ * 	The Regions compacted in the window are evacuated, their tables are stale now.
+ */
+/**
+ * Semeru MS - The budget is measured from here, when the memory server sees the STW window.
+ */
+void G1SemeruSTWCompact::start_compact_budget(uint32_t budget_us) {
+	_mem_server_cset->clear_abort_compact();
+	_compact_deadline = budget_us == 0 ? 0.0 : os::elapsedTime() + (double)budget_us / 1000000.0;
+	log_debug(semeru, mem_compact)("%s, compaction budget %uus", __func__, budget_us);
+}
+
+void G1SemeruSTWCompact::check_compact_budget(double next_region_sec) {
+	if (_compact_deadline == 0.0 || _mem_server_cset->should_abort_compact()) {
+		return;
+	}
+
+	if (os::elapsedTime() + next_region_sec > _compact_deadline) {
+		_mem_server_cset->abort_compact();
+		log_info(semeru, mem_compact)("%s, the pause budget runs out, stop claiming the 0x%lx scanned Regions.", __func__,
+																	_mem_server_cset->num_cm_scanned_regions());
+	}
+}
+
+
+void G1SemeruSTWCompact::delete_fwd_tables() {
+	for (uint i = 0; i < _semeru_h->max_regions(); i++) {
+		SemeruHeapRegion* hr = _semeru_h->region_at_or_null(i);
+		if (hr != NULL && hr->fwd_table() != NULL) {
+			delete hr->fwd_table();
+			hr->set_fwd_table(NULL);
+		}
+	}
+}
+
+
+
+/**
+ * Semeru MS - -XX:+SemeruMemPoolCXL, the CPU server reads the compacted Regions from the pool directly.
+ * 	Any used Region may have been written, by the compaction or the inter-Region reference update.
+ */
+void G1SemeruSTWCompact::sync_cxl_regions() {
+	if (!SemeruMemPoolCXL) {
+		return;
+	}
+	for (uint i = 0; i < _semeru_h->max_regions(); i++) {
+		SemeruHeapRegion* hr = _semeru_h->region_at_or_null(i);
+		if (hr != NULL && !hr->is_free()) {
+			semeru_cxl_sync(hr->bottom(), pointer_delta(hr->top(), hr->bottom(), 1));
+		}
+	}
 }
 
 
+/**
+ * Semeru MS - Both the source Regions and the destination Regions of the window, the fields of the phase#4 included.
+ */
+void G1SemeruSTWCompact::record_rewritten_pages() {
+	for (uint i = 0; i < _semeru_h->max_regions(); i++) {
+		SemeruHeapRegion* hr = _semeru_h->region_at_or_null(i);
+		if (hr != NULL) {
+			hr->record_rewritten_pages();
+		}
+	}
+}
+
 
 void G1SemeruSTWCompact::set_concurrency_and_phase(uint active_tasks, bool concurrent) {
 	set_concurrency(active_tasks);
@@ -261,13 +412,31 @@ G1SemeruSTWCompactTerminatorTask::G1SemeruSTWCompactTerminatorTask(uint worker_i
 	_has_timed_out(false),
 	_cp(NULL),
 	_humongous_regions_removed(0),
-	_inter_region_ref_queue(inter_region_ref_q)
+	_inter_region_ref_queue(inter_region_ref_q),
+	_compressor(NULL),
+	_dma_copier(NULL)
 {
 
 	// #1 Get resource from the global list at G1SemeruSTWCompact
 	_cp = _semeru_sc->compaction_point(_worker_id); 
 
+	// #2 Reused by all the Regions compacted by this task.
+	if (SemeruCompressorCompact) {
+		_compressor = new G1SemeruCompressor(SemeruHeapRegion::SemeruGrainWords);
+	}
+	if (G1SemeruDMACopier::is_available()) {
+		_dma_copier = new G1SemeruDMACopier();
+	}
+
+}
 
+G1SemeruSTWCompactTerminatorTask::~G1SemeruSTWCompactTerminatorTask() {
+	if (_compressor != NULL) {
+		delete _compressor;
+	}
+	if (_dma_copier != NULL) {
+		delete _dma_copier;
+	}
 }
 
 
@@ -280,9 +449,10 @@ bool G1SemeruSTWCompactTerminatorTask::should_exit_termination(){
 
 
 	// This is called when we are in the termination protocol. We should
-	// quit if, for some reason, this task wants to abort or the global
-	// stack is not empty (this means that we can get work from it).
-	return !inter_region_ref_taskqueue()->is_empty() || has_aborted();
+	// quit if, for some reason, this task wants to abort or a large Region is published
+	// by chunks, the only compaction work we can take from the others.
+	// The inter-Region references queued here wait for the data exchange, they don't keep us.
+	return _semeru_sc->num_chunked_regions() > 0 || has_aborted();
 }
 
 
@@ -312,6 +482,8 @@ bool G1SemeruSTWCompactTerminatorTask::should_exit_termination(){
 		//_cp = _semeru_sc->compaction_point(_worker_id); 
 
 		SemeruHeapRegion* region_to_evacuate = NULL;
+		// The cost of the last Region compacted by this worker, the estimate of the next one.
+		double region_sec = 0.0;
 
 		log_debug(semeru, mem_compact)("%s, Enter SemeruSWTCompact worker[0x%x] \n", __func__, worker_id());
 
@@ -327,13 +499,38 @@ bool G1SemeruSTWCompactTerminatorTask::should_exit_termination(){
 				// Start: When the compacting for a Region is started,
 				// do not interrupt it until the end of compacting.
 
+				// Past the pause budget, the claim returns NULL as if the CSet ran out.
+				_semeru_sc->check_compact_budget(region_sec);
 				region_to_evacuate = _semeru_sc->claim_region_for_comapct(worker_id(), region_to_evacuate);
-				if(region_to_evacuate != NULL && region_to_evacuate->alive_ratio() < COMPACT_THRESHOLD  ){
+				if(region_to_evacuate != NULL){
+					G1SemeruColdStore::restore_region(region_to_evacuate);
+				}
+				double region_start = os::elapsedTime();
+				if(region_to_evacuate != NULL && region_to_evacuate->fwd_table() != NULL){
+					// Compacted out of the STW window and committed at the start of it, see G1SemeruConcurrentCompact.
+					log_debug(semeru,mem_compact)("%s, worker[0x%x] skips the committed Region[0x%lx].", __func__, worker_id(), (size_t)region_to_evacuate->hrm_index() );
+
+				}else if(region_to_evacuate != NULL && region_to_evacuate->alive_ratio() < COMPACT_THRESHOLD &&
+					 G1SemeruCompactChunkTask::should_split(region_to_evacuate, _semeru_sc->active_tasks()) ){
+					// A large Region, compacted into itself by all the workers.
+					compact_region_by_chunks(region_to_evacuate);
+					region_sec = os::elapsedTime() - region_start;
+
+				}else if(region_to_evacuate != NULL && region_to_evacuate->alive_ratio() < COMPACT_THRESHOLD  ){
 					log_debug(semeru,mem_compact)("%s, worker[0x%x] Claimed Region[0x%lx] to be evacuted.", __func__, worker_id(), (size_t)region_to_evacuate->hrm_index() );
+					EventSemeruRegionCompaction evt;
 
 					//	if(region_to_evacuate->hrm_index() == 0x7)
 					//		check_cross_region_reg_queue(region_to_evacuate, "Before phase1, Region[0x7]");	
 
+					// Phase#0 Clear the referents left unmarked by the remote Reference discovery.
+					// They are freed by the compaction, a Region whose chain can't be reported isn't compacted.
+					G1SemeruDeadReferents dead_refs;
+					if(!dead_refs.collect(region_to_evacuate, region_to_evacuate->alive_bitmap(), cpu_server_flags, mem_server_flags)){
+						continue;
+					}
+					dead_refs.clear_in_place();
+
 
 					// Phase#1 Sumarize alive objects' destinazion
 					// 1) put forwarding pointer in alive object's markOop
@@ -341,16 +538,21 @@ bool G1SemeruSTWCompactTerminatorTask::should_exit_termination(){
 					// [??] Make this phase Concurrent ??
 					//
 					phase1_prepare_for_compact(region_to_evacuate);
+					dead_refs.record_new_addrs(_compressor);
 
 					// Phase#2 Adjust object's intra-Region feild pointer
 					// The adjustment is based on forwarding pointer.
 					// This has to be finished bofore data copy, which may overwrite the original alive objects and their forwarding pointer.
-					phase2_adjust_intra_region_pointer(region_to_evacuate);
+					// The Compressor mode merges it into the copy, Phase#3.
+					if (_compressor == NULL) {
+						phase2_adjust_intra_region_pointer(region_to_evacuate);
+					}
 
 					// Phase#2.1
 					// Record the new address for the objects in target_obj_queue
 					// Only these objects are cross-region referenced. 
-					// Their new addr is stored in the markOop for now.
+					// Copy their new addr from the markOop into the Region's forwarding table,
+					// phase#3 overwrites the markOop.
 					record_new_addr_for_target_obj(region_to_evacuate);
 
 	
@@ -359,11 +561,19 @@ bool G1SemeruSTWCompactTerminatorTask::should_exit_termination(){
 					// 		CPU server can read the data now.
 					// 2) If Claimed, must finish the compacting.
 					//
-					mem_server_flags->add_claimed_region(region_to_evacuate->hrm_index());
+					_semeru_sc->_semeru_h->_compacted_region_ring->push(region_to_evacuate->hrm_index());
+					G1SemeruColdStore::note_compacted(region_to_evacuate);
+					if(!dead_refs.is_empty()){
+						G1SemeruDeadReferents::publish(mem_server_flags, dead_refs.slot(), dead_refs.head(), dead_refs.tail());
+					}
 
 					// Phase#3 Do the compaction
 					// Multiple worker threads do this parallelly
-					phase3_compact_region(region_to_evacuate);
+					if (_compressor == NULL) {
+						phase3_compact_region(region_to_evacuate);
+					} else {
+						phase2_3_adjust_and_compact_region(region_to_evacuate);
+					}
 
 
 					// Debug Drain the CompactTask _cross_region_ref_update_queue
@@ -372,7 +582,17 @@ bool G1SemeruSTWCompactTerminatorTask::should_exit_termination(){
 					// Check the Region's cross_region_ref queue
 					//check_cross_region_reg_queue(region_to_evacuate, "Before phase4");					
 
+					_semeru_sc->_semeru_h->semeru_counters()->inc_compacted_region(region_to_evacuate->marked_alive_bytes());
+					if(evt.should_commit()){
+						evt.set_index(region_to_evacuate->hrm_index());
+						evt.set_liveBytes(region_to_evacuate->marked_alive_bytes());
+						evt.set_chunked(false);
+						evt.set_concurrent(false);
+						evt.commit();
+					}
+
 					log_debug(semeru,mem_compact)("%s, worker[0x%x] Evacuation for Region[0x%lx] is done.", __func__, worker_id(), (size_t)region_to_evacuate->hrm_index() );
+					region_sec = os::elapsedTime() - region_start;
 				}
 
 			// End: Check if we need to stop the compacting work
@@ -380,14 +600,23 @@ bool G1SemeruSTWCompactTerminatorTask::should_exit_termination(){
 		}while( cpu_server_flags->_is_cpu_server_in_stw && region_to_evacuate != NULL && !_semeru_sc->has_aborted() );
 
 
-
-
 		// Only the last thread can set the flags value.
 		// The Inter_region_ref queue can be non-empty when we get a termination offer.
-		// 1) [?] Will this sync these threads here ? 
-		//     and then go into the next block at the same time ?
-		// 2) Can we also do work stealing here ?
-		bool all_task_finished =	_semeru_sc->terminator()->offer_semeru_compact_termination(this);
+		// The spin budget of the termination is bounded by the pause budget of the CPU server.
+		// A worker leaves the termination to help a large Region published by chunks meanwhile, then offers again.
+		bool all_task_finished;
+		do{
+			// No more Regions to claim, help the workers still compacting their large Regions.
+			// Their inter-Region fields are recorded into this worker's queue too.
+			while(_semeru_sc->num_chunked_regions() > 0){
+				if(!_semeru_sc->help_compact_chunks(this)){
+					SpinPause();
+				}
+			}
+
+			all_task_finished = _semeru_sc->terminator()->offer_semeru_compact_termination(this, worker_id(),
+			                                                                               _semeru_sc->compact_deadline());
+		}while(!all_task_finished && !has_aborted() && _semeru_sc->num_chunked_regions() > 0);
 		if(all_task_finished){
 		//
 		// Do the Phase#4, update inter-Region reference here.
@@ -423,6 +652,8 @@ bool G1SemeruSTWCompactTerminatorTask::should_exit_termination(){
 						// This flag means all the claimed Region are compacted.
 						// CPU server has to re-read the Compacted_region information now.
 						mem_server_flags->_mem_server_wait_on_data_exchange = true; // cpu server can send its data.
+						mem_server_flags->timeline_record(SEMERU_TL_STATE_PUSHED, MEM_SERVER_NOTIFY_WAIT_ON_EXCHANGE);
+						notify_cpu_server(MEM_SERVER_NOTIFY_WAIT_ON_EXCHANGE);
 						
 						// If the memory server finished the compaction earlier than CPU server's evacuation, busy wit on the lock.
 						//
@@ -494,6 +725,8 @@ bool G1SemeruSTWCompactTerminatorTask::should_exit_termination(){
 		
 
 		// Reset fields
+		_cp->collect_freed_regions();
+		_semeru_sc->merge_freed_regions(_cp);
 		_cp->reset_compactionPoint();
 
 		// statistics 
@@ -520,7 +753,7 @@ void G1SemeruSTWCompactTerminatorTask::phase1_prepare_for_compact(SemeruHeapRegi
 	log_debug(semeru, mem_compact)("%s, worker[0x%x] Enter Semeru MS Compact Phase#1, preparation ", __func__, worker_id());
 
 	// get _cp from G1SemeruSTWCompact->compaction_point(worker_id)
-	G1SemeruCalculatePointersClosure semeru_ms_prepare(_semeru_sc, hr->alive_bitmap(), _cp, &_humongous_regions_removed);  
+	G1SemeruCalculatePointersClosure semeru_ms_prepare(_semeru_sc, hr->alive_bitmap(), _cp, &_humongous_regions_removed, _compressor);  
 	semeru_ms_prepare.do_heap_region(hr);
 
 	// update compaction_top to Region's top
@@ -613,34 +846,15 @@ void G1SemeruSTWCompactTerminatorTask::record_new_addr_for_target_obj(SemeruHeap
 
 	log_debug(semeru, mem_compact)("%s, Store new address for the objects in Target_obj_queue of Region[0x%lx] , worker [0x%x] ", 
 																																								__func__, (size_t)hr->hrm_index(), this->_worker_id);
-	
-	HashQueue* cross_region_ref_ptr = hr->cross_region_ref_update_queue();
-	//cross_region_ref_ptr->organize(); // sort and de-duplicate
-
-	size_t len = cross_region_ref_ptr->length(); // new length.
-	size_t i;
-	ElemPair* elem_ptr;
-	oop new_addr;
-
-	log_debug(semeru, mem_compact)("%s, worker[0x%x] Cross_region_ref_queue of Region[0x%lx], lenth 0x%lx  ", 
-																														__func__, worker_id(),  (size_t)hr->hrm_index(),  len );
 
-	for( i =0; i< len; i++){
-		elem_ptr = cross_region_ref_ptr->retrieve_item(i);
-		
-		// For HashMap, it's ok to find some items to null.
-		// if(elem_ptr->from == NULL){
-		// 	continue;
-		// }
+	assert(hr->fwd_table() == NULL, "Region[0x%x] is compacted twice in one compaction window.", hr->hrm_index());
 
-		// new_addr = elem_ptr->from->forwardee(); // If the object is not moved, to can also be null.
-		// //elem_ptr->to = new_addr;
-		
-		// //debug
-		// log_trace(semeru,mem_compact)("%s, worker[0x%x] store target obj[0x%lx] <old addr 0x%lx, new addr 0x%lx >",__func__, 
-		// 																		worker_id(), i, (size_t)elem_ptr->from, (size_t)new_addr );
-	}// end of for
+	// Only one worker claims the Region, no need to synchronize.
+	G1SemeruForwardTable* fwd_table = G1SemeruForwardTable::create(hr, hr->alive_bitmap(), hr->target_obj_queue(), _compressor);
+	hr->set_fwd_table(fwd_table);
 
+	log_debug(semeru, mem_compact)("%s, worker[0x%x] forwarding table of Region[0x%lx], length 0x%lx  ", 
+																														__func__, worker_id(),  (size_t)hr->hrm_index(),  fwd_table->num_entries() );
 }
 
 /**
@@ -661,8 +875,11 @@ void G1SemeruSTWCompactTerminatorTask::phase3_compact_region(SemeruHeapRegion* h
 	assert(!hr->is_humongous(), "Should be no humongous regions in compaction queue");
 
 	// Warning : for a void parameter constructor, do not assign () at the end.
-  G1SemeruCompactRegionClosure semeru_ms_compact;			// the closure to evacuate a single alive object to dest
+  G1SemeruCompactRegionClosure semeru_ms_compact(_dma_copier);			// the closure to evacuate a single alive object to dest
   hr->apply_to_marked_objects(hr->alive_bitmap(), &semeru_ms_compact);  // Do this compaction in the bitmap.
+	if (_dma_copier != NULL) {
+		_dma_copier->finish();		// the moved objects' mark words are reinitialized
+	}
 
 	//
 	// [?]Check the compaction is not interrupped. How ?
@@ -677,6 +894,8 @@ void G1SemeruSTWCompactTerminatorTask::phase3_compact_region(SemeruHeapRegion* h
 	// 1) Restore Compaction,e.g. _compaction_top, information to normal fields, e.g. _top
   // 2) Clear not used range.
 	hr->complete_compaction();
+	hr->record_bot_update(hr->bottom());		// the BOT is rebuilt by phase#1
+	hr->record_compaction_checksums();
 }
 
 
@@ -685,107 +904,223 @@ void G1SemeruSTWCompactTerminatorTask::phase3_compact_region(SemeruHeapRegion* h
 
 
 /**
- * Drain the both overflow queue and taskqueue
- * 
- * Update by following the outgoing direction.
- * 
- * [XX] Slow Version [XX]
- * 	The problem is that, we need to check the target region for each objects.
- * 
- * 
+ * Semeru MS - Compact a large Region into itself by chunks.
+ * 	The other workers claim the chunks of each published phase, see G1SemeruCompactChunkTask.
+ * 	The phases and the sub-phases are the same with the whole Region compaction.
  */
-void G1SemeruSTWCompactTerminatorTask::update_cross_region_ref_taskqueue(){
-  StarTask ref;
-	oop new_target_oop_addr;
-	oop old_target_oop_addr;
-	SemeruHeapRegion* target_region;
-  size_t count;
-  SemeruCompactTaskQueue* inter_region_ref_queue = this->inter_region_ref_taskqueue();
+void G1SemeruSTWCompactTerminatorTask::compact_region_by_chunks(SemeruHeapRegion* hr) {
+	G1SemeruCompactChunkTask* chunks = _semeru_sc->chunk_task(worker_id());
+	flags_of_mem_server_state* mem_server_flags	 = _semeru_sc->_semeru_h->mem_server_flags();
 
-  log_debug(semeru,mem_compact)("\n%s, start for updating Inter-Region ref, worker[0x%lx]", __func__, (size_t)worker_id() );
+	log_debug(semeru,mem_compact)("%s, worker[0x%x] Claimed Region[0x%lx] to be evacuted by chunks.", __func__, worker_id(), (size_t)hr->hrm_index() );
+	assert(!hr->is_humongous() && !hr->is_pinned(), "Region[0x%x] can't be split.", hr->hrm_index());
+	EventSemeruRegionCompaction evt;
 
+	// Phase#0 Clear the unmarked referents, the same with the whole Region compaction.
+	G1SemeruDeadReferents dead_refs;
+	if(!dead_refs.collect(hr, hr->alive_bitmap(), _semeru_sc->_semeru_h->cpu_server_flags(), mem_server_flags)){
+		return;
+	}
+	dead_refs.clear_in_place();
+
+	_semeru_sc->inc_chunked_regions();
+	chunks->setup(hr);
+
+	// Phase#1 Sumarize alive objects' destinazion
+	chunks->run_phase(G1SemeruCompactChunkTask::CountLive, this);
+	chunks->calculate_destinations();
+	chunks->run_phase(G1SemeruCompactChunkTask::Forward, this);
+	dead_refs.record_new_addrs(NULL);		// forwarded by the markOops
+
+	// Phase#2 Adjust object's intra-Region feild pointer
+	chunks->run_phase(G1SemeruCompactChunkTask::Adjust, this);
+
+	// Phase#2.1 Record the new address for the objects in target_obj_queue
+	record_new_addr_for_target_obj(hr);
+	_semeru_sc->_semeru_h->_compacted_region_ring->push(hr->hrm_index());
+	G1SemeruColdStore::note_compacted(hr);
+	if(!dead_refs.is_empty()){
+		G1SemeruDeadReferents::publish(mem_server_flags, dead_refs.slot(), dead_refs.head(), dead_refs.tail());
+	}
 
-  // #1 Drain the overflow queue
-  count =0;
-	while (inter_region_ref_queue->pop_overflow(ref)) {
+	// Phase#3 Do the compaction
+	chunks->run_phase(G1SemeruCompactChunkTask::Copy, this);
+	chunks->finish();
+	hr->complete_compaction();
+	hr->record_bot_update(hr->bottom());
+	hr->record_compaction_checksums();
+
+	_semeru_sc->dec_chunked_regions();
+
+	_semeru_sc->_semeru_h->semeru_counters()->inc_compacted_region(hr->marked_alive_bytes());
+	if(evt.should_commit()){
+		evt.set_index(hr->hrm_index());
+		evt.set_liveBytes(hr->marked_alive_bytes());
+		evt.set_chunked(true);
+		evt.set_concurrent(false);
+		evt.commit();
+	}
 
-		 // the old addr can points to Regions in other severs.
-		 // We have to fetch these Regions' _cross_region_ref_update_queue here.
-    old_target_oop_addr = RawAccess<>::oop_load((oop*)ref);		
-		if(old_target_oop_addr!= NULL ){
+	log_debug(semeru,mem_compact)("%s, worker[0x%x] Evacuation for Region[0x%lx] by %u chunks is done.", __func__, worker_id(), (size_t)hr->hrm_index(), chunks->num_chunks() );
+}
 
-			assert((size_t)(HeapWord*)old_target_oop_addr != (size_t)0xbaadbabebaadbabe, "Wrong fields.");
 
-			target_region = _semeru_sc->_semeru_h->heap_region_containing(old_target_oop_addr); // [??] This is too slow ?
 
-			new_target_oop_addr = target_region->cross_region_ref_update_queue()->get(old_target_oop_addr);
-			//assert(new_target_oop_addr != (oop)MAX_SIZE_T, "The corresponding item for old target oop 0x%lx can't be found.", (size_t)old_target_oop_addr );
-			//Debug
-			if(new_target_oop_addr == (oop)(HeapWord*)MAX_SIZE_T){
-				tty->print("Overflow :Wrong in %s,  worker[0x%x]  old_target_oop_addr 0x%lx is not in Region[0x%lx]'s cross_region_ref queue \n", __func__, 
-																																		worker_id(), (size_t)(HeapWord*)old_target_oop_addr, (size_t)target_region->hrm_index() );
-				continue;
-			}
 
-			if(new_target_oop_addr!=NULL ){
-				RawAccess<IS_NOT_NULL>::oop_store((oop*)ref, new_target_oop_addr);
-			}else{
-				log_debug(semeru,mem_compact)("%s, old target oop 0x%lx is not moved. ", __func__,(size_t)(HeapWord*)old_target_oop_addr );
-			}
+/**
+ * Semeru MS - Compressor mode, adjust the fields and copy each alive object in a single pass.
+ * 	The new addresses are calculated by phase#1 into _compressor, the markOops are never used.
+ * 	Inter-Region fields are recorded for phase#4, the same with phase#2.
+ */
+void G1SemeruSTWCompactTerminatorTask::phase2_3_adjust_and_compact_region(SemeruHeapRegion* hr) {
 
-			log_debug(semeru,mem_compact)(" Overflow: update ref[0x%lx] 0x%lx from obj 0x%lx to new obj 0x%lx",
-										           																count, (size_t)(HeapWord*)(oop*)ref ,(size_t)(HeapWord*)old_target_oop_addr, 
-																															new_target_oop_addr == NULL ? (size_t)(HeapWord*)old_target_oop_addr : (size_t)(HeapWord*)new_target_oop_addr );
+	log_debug(semeru, mem_compact)("%s, worker[0x%x] Enter Semeru MS Compact Phase#2+3, adjust and compact Region[0x%x] ", 
+																													__func__, this->_worker_id, hr->hrm_index());
 
-		}else{
-       log_debug(semeru,mem_compact)(" Overflow: ERROR Find filed 0x%lx points to 0x%lx",(size_t)(oop*)ref, (size_t)(HeapWord*)old_target_oop_addr);
-    }
+	assert(!hr->is_humongous(), "Should be no humongous regions in compaction queue");
 
-    count++;
-  }// end of while
+	G1SemeruAdjustClosure adjust_pointer(hr, _inter_region_ref_queue, _compressor);
+	_compressor->adjust_and_compact(hr, hr->alive_bitmap(), &adjust_pointer);
+
+	hr->complete_compaction();
+	hr->record_bot_update(hr->bottom());
+	hr->record_compaction_checksums();
+}
 
 
-  // #1 Drain the task queue
-  count =0;
-  while (inter_region_ref_queue->pop_local(ref, 0 /*threshold*/)) { 
 
- 		 // the old addr can points to Regions in other severs.
-		 // We have to fetch these Regions' _cross_region_ref_update_queue here.
-    old_target_oop_addr = RawAccess<>::oop_load((oop*)ref);		
-		if(old_target_oop_addr!= NULL ){
 
-			assert((size_t)(HeapWord*)old_target_oop_addr != (size_t)0xbaadbabebaadbabe, "Wrong fields.");
+/**
+ * Load the old target of an inter-Region field into the batch.
+ * 	The old addr can points to Regions in other severs.
+ */
+size_t G1SemeruSTWCompactTerminatorTask::add_inter_region_ref(G1SemeruInterRegionRef* batch, size_t n, StarTask ref, const char* tag){
+	oop old_target_oop_addr = SemeruCompressedOops::load_decode(ref);
+	if(old_target_oop_addr == NULL ){
+		log_debug(semeru,mem_compact)("%s ERROR Find filed 0x%lx points to 0x%lx", tag, (size_t)(oop*)ref, (size_t)(HeapWord*)old_target_oop_addr);
+		return n;
+	}
 
-			target_region = _semeru_sc->_semeru_h->heap_region_containing(old_target_oop_addr); // [??] This is too slow ?
+	assert((size_t)(HeapWord*)old_target_oop_addr != (size_t)0xbaadbabebaadbabe, "Wrong fields.");
 
-			new_target_oop_addr = target_region->cross_region_ref_update_queue()->get(old_target_oop_addr);
-			//assert(new_target_oop_addr != (oop)MAX_SIZE_T, "The corresponding item for old target oop 0x%lx can't be found.", (size_t)old_target_oop_addr );
-			//Debug
-			if(new_target_oop_addr == (oop)(HeapWord*)MAX_SIZE_T){
-				tty->print(" Wrong in %s, worker[0x%x]  old_target_oop_addr 0x%lx is not in Region[0x%lx]'s cross_region_ref queue \n", __func__, 
-																																worker_id(), (size_t)(HeapWord*)old_target_oop_addr, (size_t)target_region->hrm_index() );
+	batch[n]._target = (HeapWord*)old_target_oop_addr;
+	batch[n]._ref    = ref;
+	return n + 1;
+}
+
+
+static int compare_inter_region_ref(G1SemeruInterRegionRef* a, G1SemeruInterRegionRef* b) {
+	if (a->_target < b->_target) {
+		return -1;
+	}
+	return a->_target > b->_target ? 1 : 0;
+}
+
+
+/**
+ * Update a batch of inter-Region fields.
+ * 
+ * 1) Sort the batch by the old target. The fields pointing to the same Region are contiguous,
+ *    the Region and its forwarding table are resolved once per bucket.
+ * 2) The target Region isn't compacted in this window, no table, the target objects aren't moved.
+ * 3) The target Region is compacted, all its cross-region referenced objects are in the table.
+ *    The lookups are in ascending order, each one continues from the previous entry.
+ * 4) The fields are scattered, prefetch the ones written a few iterations later.
+ * 
+ * [?] The target Region can be on other servers, their tables are still not exchanged.
+ */
+void G1SemeruSTWCompactTerminatorTask::update_inter_region_ref_batch(G1SemeruInterRegionRef* batch, size_t n){
+	const size_t prefetch_distance = 8;
+	size_t updated = 0;
+	size_t i = 0;
+
+	QuickSort::sort(batch, n, compare_inter_region_ref, false);
+
+	while (i < n) {
+		SemeruHeapRegion* target_region = _semeru_sc->_semeru_h->heap_region_containing(batch[i]._target);
+		HeapWord* region_end = target_region->end();
+		G1SemeruForwardTable* fwd_table = target_region->fwd_table();
+
+		// The bucket of target_region, [i, j)
+		size_t j = i + 1;
+		while (j < n && batch[j]._target < region_end) {
+			j++;
+		}
+
+		if (fwd_table == NULL) {
+			log_trace(semeru,mem_compact)("%s, 0x%lx fields point to Region[0x%lx], it is not compacted. ", __func__,
+																			j - i, (size_t)target_region->hrm_index() );
+			i = j;
+			continue;
+		}
+
+		size_t cursor = 0;
+		for (size_t k = i; k < j; k++) {
+			if (k + prefetch_distance < j) {
+				Prefetch::write((void*)(oop*)batch[k + prefetch_distance]._ref, 0);
+			}
+
+			HeapWord* old_target = batch[k]._target;
+			HeapWord* new_target = fwd_table->forwardee_ascending(old_target, &cursor);
+			if (new_target == NULL) {
+				tty->print("Wrong in %s, worker[0x%x]  old_target_oop_addr 0x%lx is not in Region[0x%lx]'s forwarding table \n", __func__, 
+																																worker_id(), (size_t)old_target, (size_t)target_region->hrm_index() );
 				continue;
 			}
 
-			if(new_target_oop_addr!=NULL){
-				RawAccess<IS_NOT_NULL>::oop_store((oop*)ref, new_target_oop_addr);
-			}else{
-				log_debug(semeru,mem_compact)("%s, old target oop 0x%lx is not moved. ", __func__,(size_t)(HeapWord*)old_target_oop_addr );
+			if (new_target != old_target) {
+				SemeruCompressedOops::store_not_null(batch[k]._ref, oop(new_target));
+				updated++;
 			}
 
-			log_debug(semeru,mem_compact)(" update ref[0x%lx] 0x%lx from obj 0x%lx to new obj 0x%lx",
-										           																count, (size_t)(oop*)ref ,(size_t)(HeapWord*)old_target_oop_addr, 
-																															new_target_oop_addr == NULL ? (size_t)(HeapWord*)old_target_oop_addr : (size_t)(HeapWord*)new_target_oop_addr );
+			log_trace(semeru,mem_compact)("%s update ref 0x%lx from obj 0x%lx to new obj 0x%lx", __func__,
+																		(size_t)(oop*)batch[k]._ref, (size_t)old_target, (size_t)new_target );
+		}
 
-		}else{
-       log_debug(semeru,mem_compact)(" ERROR Find filed 0x%lx points to 0x%lx",(size_t)(oop*)ref, (size_t)(HeapWord*)old_target_oop_addr);
-    }
-    count++;
+		i = j;
+	}
+
+	log_debug(semeru,mem_compact)("%s, worker[0x%x] batch of 0x%lx fields, 0x%lx updated", __func__, worker_id(), n, updated);
+}
+
+
+/**
+ * Drain the chunked task queue.
+ * 
+ * Update by following the outgoing direction.
+ * The new address is looked up in the target Region's forwarding table, a batch at a time.
+ * 
+ */
+void G1SemeruSTWCompactTerminatorTask::update_cross_region_ref_taskqueue(){
+  const size_t batch_size = 4096;
+  StarTask ref;
+  size_t n = 0;
+  size_t count = 0;
+  SemeruCompactTaskQueue* inter_region_ref_queue = this->inter_region_ref_taskqueue();
+
+  log_debug(semeru,mem_compact)("\n%s, start for updating Inter-Region ref, worker[0x%lx]", __func__, (size_t)worker_id() );
+
+  ResourceMark rm;
+  G1SemeruInterRegionRef* batch = NEW_RESOURCE_ARRAY(G1SemeruInterRegionRef, batch_size);
+
+  // Drain the task queue
+  while (inter_region_ref_queue->pop_local(ref, 0 /*threshold*/)) { 
+		n = add_inter_region_ref(batch, n, ref, "");
+		if (n == batch_size) {
+			update_inter_region_ref_batch(batch, n);
+			count += n;
+			n = 0;
+		}
   }// end of while
 
+  if (n > 0) {
+    update_inter_region_ref_batch(batch, n);
+    count += n;
+  }
+
   assert(inter_region_ref_queue->is_empty(), "should drain the queue");
 
-  log_debug(semeru,mem_compact)("%s, End for updating Inter-Region ref, worker[0x%lx] \n", __func__, (size_t)worker_id());
+  log_debug(semeru,mem_compact)("%s, End for updating 0x%lx Inter-Region ref, worker[0x%lx] \n", __func__, count, (size_t)worker_id());
 }
 
 
@@ -828,11 +1163,13 @@ void G1SemeruSTWCompactTerminatorTask::phase4_adjust_inter_region_pointer(Semeru
 G1SemeruCalculatePointersClosure::G1SemeruCalculatePointersClosure( G1SemeruSTWCompact* semeru_sc,
 																																		G1CMBitMap* bitmap,
                                                              				G1SemeruCompactionPoint* cp,
-																																		uint* humongous_regions_removed) :
+																																		uint* humongous_regions_removed,
+																																		G1SemeruCompressor* compressor) :
   _semeru_sc(semeru_sc),
   _bitmap(bitmap),
   _cp(cp),
-	_humongous_regions_removed(humongous_regions_removed) { 
+	_humongous_regions_removed(humongous_regions_removed),
+	_compressor(compressor) { 
 
 		#ifdef ASSERT
 			tty->print("%s, initialized G1SemeruCalculatePointersClosure. \n", __func__);
@@ -871,23 +1208,16 @@ bool G1SemeruCalculatePointersClosure::do_heap_region(SemeruHeapRegion* hr) {
 
 
 /**
- * Tag : a humongous Region need to be freed separately ?? 
- *  
+ * A dead humongous Region is only recorded here.
+ * The free Region lists are owned by the CPU server, it frees the whole object by the reported liveness,
+ * without swapping in the object. So keep the Region out of the destination candidates.
  */
 void G1SemeruCalculatePointersClosure::free_humongous_region(SemeruHeapRegion* hr) {
-
-	//debug
-	tty->print("%s, Error Not implement this function yet. \n", __func__);
-
-
-  // FreeRegionList dummy_free_list("Dummy Free List for G1MarkSweep");
-
-  // hr->set_containing_set(NULL);
-  // _humongous_regions_removed++;
-
-  // _g1h->free_humongous_region(hr, &dummy_free_list);
-  // prepare_for_compaction(hr);   // Add this Region into Destination Region candidates
-  // dummy_free_list.remove_all();
+  hr->set_alive_ratio(0.0);
+  hr->set_region_cm_scanned();
+  _cp->add_freed(hr);
+  (*_humongous_regions_removed)++;
+  log_debug(semeru,mem_compact)("%s, humongous Region[0x%x] is dead, left for the CPU server to free.", __func__, hr->hrm_index());
 }
 
 
@@ -931,6 +1261,15 @@ void G1SemeruCalculatePointersClosure::prepare_for_compaction(SemeruHeapRegion*
   }
   // Enqueue this Region into destination Region queue.
   _cp->add(hr);
+
+  // Slide or evacuate.
+  // A sparse Region is evacuated into the tail of the current destination and freed wholesale.
+  // A dense one slides into itself, its tail becomes the destination of the sparse Regions behind it.
+  // Staying enqueued, an evacuated Region still takes the objects not fitting into the destination.
+  size_t live_words = hr->marked_alive_bytes() / HeapWordSize;
+  if (hr->alive_ratio() * 100 >= SemeruEvacuateLiveRatio && live_words > _cp->free_words()) {
+    _cp->slide_in_place_last();
+  }
   prepare_for_compaction_work(_cp, hr);
 
 }
@@ -946,8 +1285,15 @@ void G1SemeruCalculatePointersClosure::prepare_for_compaction(SemeruHeapRegion*
  */
 void G1SemeruCalculatePointersClosure::prepare_for_compaction_work(G1SemeruCompactionPoint* cp,
                                                                                   SemeruHeapRegion* hr) {
-  G1SemeruPrepareCompactLiveClosure prepare_compact(cp);
   hr->set_compaction_top(hr->bottom());     // SemeruHeapRegion->_compaction_top is that if using this Region as a Destination, this is his top.
+
+  if (_compressor != NULL) {
+    // Compressor mode, keep the object headers intact.
+    _compressor->summarize(hr, _bitmap, cp);
+    return;
+  }
+
+  G1SemeruPrepareCompactLiveClosure prepare_compact(cp);
   hr->apply_to_marked_objects(_bitmap, &prepare_compact);
 }
 
@@ -957,7 +1303,7 @@ void G1SemeruCalculatePointersClosure::prepare_for_compaction_work(G1SemeruCompa
  *  
  */
 bool G1SemeruCalculatePointersClosure::freed_regions() {
-  if (_humongous_regions_removed > 0) {
+  if (*_humongous_regions_removed > 0) {
     // Free regions from dead humongous regions.
     return true;
   }
@@ -1049,6 +1395,11 @@ size_t G1SemeruCompactRegionClosure::apply(oop obj) {
   // copy object and reinit its mark
   HeapWord* obj_addr = (HeapWord*) obj;
   assert(obj_addr != destination, "everything in this pass should be moving");
+  if (_dma_copier != NULL) {
+    // The large objects are still in flight, the mark word is initialized at their completion.
+    _dma_copier->move(obj_addr, destination, size);
+    return size;
+  }
   Copy::aligned_conjoint_words(obj_addr, destination, size);      // 4 bytes alignment copy ?
   oop(destination)->init_mark_raw();    // initialize the MarkOop.
   assert(oop(destination)->klass() != NULL, "should have a class");
@@ -1084,6 +1435,7 @@ size_t G1SemeruCompactRegionClosure::apply(oop obj) {
  * 
  */
 void  G1SemeruSTWCompactGangTask::work(uint worker_id){
+		semeru_numa_bind_thread();	// -XX:+SemeruNUMABind
 
 		{
 			// Can this sts_join sync all the running GangWorkers ??
@@ -1172,7 +1524,7 @@ void G1SemeruSTWCompactTerminatorTask::check_cross_region_reg_queue( SemeruHeapR
 
 }
 
-// Drain the both overflow queue and taskqueue
+// Drain the chunked task queue
 void G1SemeruSTWCompactTerminatorTask::check_overflow_taskqueue( const char* message){
   StarTask ref;
   size_t count;
@@ -1181,26 +1533,10 @@ void G1SemeruSTWCompactTerminatorTask::check_overflow_taskqueue( const char* mes
   log_debug(semeru,mem_compact)("\n%s, start for Semeru MS CompactTask [0x%lx]", message, (size_t)worker_id() );
 
 
-  // #1 Drain the overflow queue
-  count =0;
-	while (inter_region_ref_queue->pop_overflow(ref)) {
-    oop const obj = RawAccess<>::oop_load((oop*)ref);
-		if(obj!= NULL && (size_t)(HeapWord*)obj != (size_t)0xbaadbabebaadbabe){
-			 log_debug(semeru,mem_compact)(" Overflow: ref[0x%lx] 0x%lx points to obj 0x%lx",
-										           																								count, (size_t)(HeapWord*)(oop*)ref ,(size_t)(HeapWord*)obj);
-
-		}else{
-       log_debug(semeru,mem_compact)(" Overflow: ERROR Find filed 0x%lx points to 0x%lx",(size_t)(HeapWord*)(oop*)ref, (size_t)(HeapWord*)obj);
-    }
-
-    count++;
-  }
-
-
-  // #1 Drain the task queue
+  // Drain the task queue
   count =0;
   while (inter_region_ref_queue->pop_local(ref, 0 /*threshold*/)) { 
-    oop const obj = RawAccess<>::oop_load((oop*)ref);
+    oop const obj = SemeruCompressedOops::load_decode(ref);
 		if(obj!= NULL && (size_t)(HeapWord*)obj != (size_t)0xbaadbabebaadbabe){
 		 log_debug(semeru,mem_compact)(" ref[0x%lx] 0x%lx points to obj 0x%lx",
 										           																	count, (size_t)(HeapWord*)(oop*)ref ,(size_t)(HeapWord*)obj);
@@ -16,6 +16,7 @@
 #include "gc/g1/g1HeapVerifier.hpp"
 #include "gc/g1/g1RegionMarkStatsCache.hpp"
 #include "gc/g1/SemeruHeapRegionSet.hpp"
+#include "gc/shared/rdmaStructure.hpp"
 #include "gc/shared/taskqueue.hpp"
 #include "gc/shared/gcTimer.hpp"
 #include "gc/shared/gcTrace.hpp"
@@ -27,6 +28,8 @@
 // memory module
 #include "memory/resourceArea.hpp"
 #include "memory/allocation.hpp"
+#include "runtime/atomic.hpp"
+#include "runtime/orderAccess.hpp"
 
 
 
@@ -56,6 +59,17 @@ class G1SemeruCMCSetRegions;
 class G1SemeruAdjustRegionClosure;
 class G1SemeruAdjustLiveClosure;
 class G1SemeruAdjustClosure;
+class G1SemeruCompressor;
+class G1SemeruDMACopier;
+class G1SemeruCompactChunkTask;
+class G1SemeruConcurrentCompact;
+
+
+// Semeru MS - a popped inter-Region field and its old target, sorted by the target in Phase#4.
+struct G1SemeruInterRegionRef {
+  HeapWord* _target;
+  StarTask  _ref;
+};
 
 
 // Do object compaction closures
@@ -122,6 +136,21 @@ public:
 
   G1SemeruCompactionPoint** _compaction_points;  // each thread use one, clear it after the compaction phase.
 
+  // The Regions freed in current compaction window, merged from the workers' compaction points at their end.
+  SemeruHeapRegion**        _freed_regions;
+  volatile uint             _num_freed_regions;
+
+  // -XX:SemeruCompactChunkSize, each thread publishes the chunks of its large Region here.
+  G1SemeruCompactChunkTask** _chunk_tasks;
+  volatile uint             _num_chunked_regions;   // Regions being compacted by chunks.
+
+  // -XX:+SemeruConcurrentCompact on the CPU server, the images of the granted Regions built out of the STW window.
+  G1SemeruConcurrentCompact* _concurrent_compact;
+
+  // -XX:+SemeruPauseBudget on the CPU server, os::elapsedTime() when the budget of this STW window runs out.
+  // 0, unbounded, the window closes the compaction.
+  double                    _compact_deadline;
+
 
 	//
 	// Statistics fields
@@ -264,6 +293,13 @@ public:
   // Enter the Semeru MS compact tasks.
   void 				semeru_stw_compact();
 
+	// Delete the per Region forwarding tables at the end of a compaction window.
+	void				delete_fwd_tables();
+	// -XX:+SemeruMemPoolCXL, write the used Regions back to the pool for the CPU server.
+	void				sync_cxl_regions();
+	// Report the pages rewritten by the compactions of this window, -XX:+SemeruSelectiveInvalidation on the CPU server.
+	void				record_rewritten_pages();
+
 
 	// to check if current STW compaction is interrupped by the CPU server.
   inline bool do_interrupt_check();
@@ -283,6 +319,28 @@ public:
   //
   G1SemeruCompactionPoint* compaction_point(uint id) { return _compaction_points[id]; }
 
+  // Each worker reserves its slice of _freed_regions with one atomic add, MT safe.
+  void merge_freed_regions(G1SemeruCompactionPoint* cp);
+  uint num_freed_regions() { return OrderAccess::load_acquire(&_num_freed_regions); }
+  SemeruHeapRegion* freed_region_at(uint i) { return _freed_regions[i]; }
+
+  G1SemeruCompactChunkTask* chunk_task(uint id) { return _chunk_tasks[id]; }
+  uint num_chunked_regions() { return OrderAccess::load_acquire(&_num_chunked_regions); }
+  void inc_chunked_regions() { Atomic::inc(&_num_chunked_regions); }
+  void dec_chunked_regions() { Atomic::dec(&_num_chunked_regions); }
+
+  // Process the published chunks of other workers. Return false if there is nothing to claim.
+  bool help_compact_chunks(G1SemeruSTWCompactTerminatorTask* worker);
+
+  G1SemeruConcurrentCompact* concurrent_compact() { return _concurrent_compact; }
+
+  // Start the budget of a STW window, flags_of_cpu_server_state::_stw_budget_us.
+  void start_compact_budget(uint32_t budget_us);
+  // Stop the claiming of all the workers if the budget can't cover a Region of next_region_sec.
+  // The claimed Regions are finished, the compaction stops at Region boundaries.
+  void check_compact_budget(double next_region_sec);
+  double compact_deadline() const { return _compact_deadline; }
+
 
 
 	//
@@ -377,6 +435,13 @@ public:
   // Need to be initialized.  
   SemeruCompactTaskQueue*  _inter_region_ref_queue;  // Points to one item of G1SemeruSTWCompact->_compact_task_queues
 
+  // -XX:+SemeruCompressorCompact, the live words bitmap and block table of the compacting Region.
+  // NULL for the forwarding pointer mode.
+  G1SemeruCompressor*      _compressor;
+
+  // -XX:SemeruCompactDMADevice, moves the large objects of phase#3. NULL, copy by the CPU.
+  G1SemeruDMACopier*       _dma_copier;
+
 	//
 	// Functions declaration.
 	//
@@ -388,7 +453,7 @@ public:
   // Constructor
   G1SemeruSTWCompactTerminatorTask(uint worker_id,	G1SemeruSTWCompact* sc, SemeruCompactTaskQueue* inter_region_ref_q, uint max_regions );
 
-	~G1SemeruSTWCompactTerminatorTask() { }
+	~G1SemeruSTWCompactTerminatorTask();
 
 
 
@@ -460,12 +525,20 @@ public:
   // Phase 3,
 	void phase3_compact_region(SemeruHeapRegion* hr);  // Compact a single SemeruHeapRegion.
 
+  // Phase#1 to Phase#3 of a large Region, by chunks with the other workers' help.
+  void compact_region_by_chunks(SemeruHeapRegion* hr);
+
+  // Compressor mode, Phase#2 and Phase#3 in one pass.
+  void phase2_3_adjust_and_compact_region(SemeruHeapRegion* hr);
+
   // Phase 4,
   // Need to share data between CPU server and other Memory servers.
 	void phase4_adjust_inter_region_pointer(SemeruHeapRegion* hr);	// Inter-Region fields update ? Intra-Region reference is done during compaction.
 
   // Drain && process the G1SemeruSTWCompactGangTask->_inter_region_ref_queue
   void update_cross_region_ref_taskqueue();
+  size_t add_inter_region_ref(G1SemeruInterRegionRef* batch, size_t n, StarTask ref, const char* tag);
+  void update_inter_region_ref_batch(G1SemeruInterRegionRef* batch, size_t n);
 
 
   SemeruCompactTaskQueue* inter_region_ref_taskqueue()  { return _inter_region_ref_queue;  }
@@ -567,8 +640,9 @@ protected:
   //  G1CollectedHeap* _g1h;
     G1SemeruSTWCompact* _semeru_sc;
     G1CMBitMap* _bitmap;
-    G1SemeruCompactionPoint* _cp;       // The destination Region, for Semeru MS, each Region compact to itself.
+    G1SemeruCompactionPoint* _cp;       // The destination Regions of this worker, see prepare_for_compaction().
     uint* _humongous_regions_removed;   // stateless,  pointed to G1SemeruSTWCompactGangTask->_humongous_regions_removed
+    G1SemeruCompressor* _compressor;    // Compressor mode, summarize the Region instead of forwarding the objects.
 
     virtual void prepare_for_compaction(SemeruHeapRegion* hr);
     void prepare_for_compaction_work(G1SemeruCompactionPoint* cp, SemeruHeapRegion* hr);
@@ -579,7 +653,8 @@ public:
     G1SemeruCalculatePointersClosure( G1SemeruSTWCompact* semeru_sc,
                                       G1CMBitMap* bitmap,
                                       G1SemeruCompactionPoint* cp,
-                                      uint* humongous_regions_removed);
+                                      uint* humongous_regions_removed,
+                                      G1SemeruCompressor* compressor = NULL);
 
     void update_sets();       // [?] Young, Old, Humongous set ?
     bool do_heap_region(SemeruHeapRegion* hr); // Main Entry :  Claim and process a Region.
@@ -626,23 +701,33 @@ public:
 class G1SemeruAdjustClosure : public BasicOopIterateClosure {
   SemeruHeapRegion* _curr_region;   // Current compacting Region.
   SemeruCompactTaskQueue* _inter_region_ref_queue;  // points to the G1SemeruSTWCompactGangTask->_inter_region_ref_queue
+  G1SemeruCompressor* _compressor;  // -XX:+SemeruCompressorCompact, the new addresses of _curr_region. NULL, use the forwarding pointers.
+  ptrdiff_t _shadow_delta;          // bytes from the object to its copy in the shadow, the concurrent compaction. 0 in STW.
+
+  // The new address of an alive object in the compacting Region, NULL if not moved.
+  static inline HeapWord* new_addr_of(oop obj, G1SemeruCompressor* compressor);
 
   template <class T> static inline void adjust_intra_region_pointer(T* p, SemeruHeapRegion* hr);
 
   // Used for Semeru Memory Server Compaction.
   // This is a static function
-  template <class T> static inline void semeru_ms_adjust_intra_region_pointer(oop obj, T* p, SemeruHeapRegion* hr, SemeruCompactTaskQueue* inter_region_ref_queue);
+  template <class T> static inline void semeru_ms_adjust_intra_region_pointer(oop obj, T* p, SemeruHeapRegion* hr, SemeruCompactTaskQueue* inter_region_ref_queue,
+                                                                           G1SemeruCompressor* compressor, ptrdiff_t shadow_delta);
 
 public:
-  G1SemeruAdjustClosure(SemeruHeapRegion* curr_region, SemeruCompactTaskQueue* inter_region_ref_queue) : 
+  G1SemeruAdjustClosure(SemeruHeapRegion* curr_region, SemeruCompactTaskQueue* inter_region_ref_queue, G1SemeruCompressor* compressor = NULL) : 
   _curr_region(curr_region),
-  _inter_region_ref_queue(inter_region_ref_queue) { }
+  _inter_region_ref_queue(inter_region_ref_queue),
+  _compressor(compressor),
+  _shadow_delta(0) { }
+
+  void set_shadow_delta(ptrdiff_t delta) { _shadow_delta = delta; }
 
   template <class T> void do_oop_work(T* p) { adjust_intra_region_pointer(p , _curr_region); }
 
   // Used for Semeru Memory Server Compaction.
   // Pass in the object information containing the field p.
-  template <class T> void semeru_ms_do_oop_work(oop obj, T* p) { semeru_ms_adjust_intra_region_pointer(obj, p , _curr_region, _inter_region_ref_queue); }
+  template <class T> void semeru_ms_do_oop_work(oop obj, T* p) { semeru_ms_adjust_intra_region_pointer(obj, p , _curr_region, _inter_region_ref_queue, _compressor, _shadow_delta); }
 
 
 
@@ -655,6 +740,10 @@ public:
   virtual ReferenceIterationMode reference_iteration_mode() { return DO_FIELDS; }
 };
 
+// The oop_oop_iterate family passes each field of G1SemeruAdjustClosure to semeru_ms_do_oop(), inlined.
+template <>
+struct SemeruMSFieldClosure<G1SemeruAdjustClosure> : public TrueType {};
+
 
 
 
@@ -669,9 +758,7 @@ public:
   G1SemeruAdjustLiveClosure(G1SemeruAdjustClosure* cl) :
     _adjust_pointer(cl) { }
 
-  size_t apply(oop object) {
-    return object->oop_iterate_size(_adjust_pointer);
-  }
+  inline size_t apply(oop object);
 };
 
 
@@ -690,9 +777,10 @@ public:
 	// Define all the behaviors of how to evacuate an alive object.
 	// srouce, destination, do the copy action.
 	class G1SemeruCompactRegionClosure : public StackObj {
+    G1SemeruDMACopier* _dma_copier;   // NULL, copy by the CPU.
 
   public:
-    G1SemeruCompactRegionClosure() {}
+    G1SemeruCompactRegionClosure(G1SemeruDMACopier* dma_copier = NULL) : _dma_copier(dma_copier) {}
 
     size_t apply(oop object);		// [?] The closure is applied to an object ? not to a Region ??
   };
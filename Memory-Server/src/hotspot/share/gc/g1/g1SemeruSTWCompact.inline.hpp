@@ -4,6 +4,9 @@
 
 #include "gc/g1/g1SemeruSTWCompact.hpp"
 #include "gc/g1/g1Allocator.inline.hpp"
+#include "gc/g1/g1SemeruCompressedOops.inline.hpp"
+#include "gc/g1/g1SemeruCompressor.hpp"
+#include "gc/g1/g1SemeruKlassLayoutCache.inline.hpp"
 #include "gc/g1/heapRegionRemSet.hpp"
 #include "memory/iterator.inline.hpp"
 #include "oops/access.inline.hpp"
@@ -40,7 +43,7 @@ inline void G1SemeruAdjustClosure::adjust_intra_region_pointer(T* p, SemeruHeapR
     return;
   }
 
-  oop obj = CompressedOops::decode_not_null(heap_oop);
+  oop obj = SemeruCompressedOops::decode_not_null(heap_oop);
 
   log_info(semeru,mem_compact)("\n Warning in %s. Should Not Reach Here ? or obj 0x%lx is not moved. \n\n", __func__, (size_t)(HeapWord*)obj );
 
@@ -105,7 +108,7 @@ inline void G1SemeruAdjustClosure::adjust_intra_region_pointer(T* p, SemeruHeapR
 
   // Forwarded, just update.
   assert(Universe::semeru_heap()->is_in_semeru_reserved(forwardee), "should be in object space");
-  RawAccess<IS_NOT_NULL>::oop_store(p, forwardee);
+  SemeruCompressedOops::store_not_null(p, forwardee);
 }
 
 
@@ -113,6 +116,20 @@ inline void G1SemeruAdjustClosure::adjust_intra_region_pointer(T* p, SemeruHeapR
 
 
 
+/**
+ * The forwarding pointer mode reads the markOop, the Compressor mode never writes it.
+ */
+inline HeapWord* G1SemeruAdjustClosure::new_addr_of(oop obj, G1SemeruCompressor* compressor) {
+  if (compressor == NULL) {
+    return (HeapWord*)obj->forwardee();
+  }
+
+  HeapWord* new_addr = compressor->new_addr((HeapWord*)obj);
+  return new_addr == (HeapWord*)obj ? NULL : new_addr;
+}
+
+
+
 /**
  * Tag: apply this pointer adjustment to each field of the alive objects.
  *      This scavenge is in the order of alive bitmap.
@@ -122,13 +139,14 @@ inline void G1SemeruAdjustClosure::adjust_intra_region_pointer(T* p, SemeruHeapR
  * 
  */
 template <class T> 
-inline void G1SemeruAdjustClosure::semeru_ms_adjust_intra_region_pointer(oop src_obj, T* p, SemeruHeapRegion* curr_region, SemeruCompactTaskQueue* inter_region_ref_queue) {
+inline void G1SemeruAdjustClosure::semeru_ms_adjust_intra_region_pointer(oop src_obj, T* p, SemeruHeapRegion* curr_region, SemeruCompactTaskQueue* inter_region_ref_queue,
+                                                                        G1SemeruCompressor* compressor, ptrdiff_t shadow_delta) {
   T heap_oop = RawAccess<>::oop_load(p);
   if (CompressedOops::is_null(heap_oop)) {
     return;
   }
 
-  oop obj = CompressedOops::decode_not_null(heap_oop);
+  oop obj = SemeruCompressedOops::decode_not_null(heap_oop);
 
 	// There are 2 pathes for field update, based on if this obj is within current scanning Region.
   //
@@ -142,8 +160,11 @@ inline void G1SemeruAdjustClosure::semeru_ms_adjust_intra_region_pointer(oop src
 		// We use a bitmap,_inter_region_ref_bitmap, to record the fields points to object in another Region.
     // The _inter_region_ref_bitmap is only used in Memory server. No need to allocate into the RDMA Meta space.
     // It's also safe to delete after the compaction.
-		assert(src_obj->is_forwarded(), "The source object must already forwarded.");
-    assert(src_obj->forwardee() != NULL, "Must be a legal forwarding pointer." );
+		assert(compressor != NULL || src_obj->is_forwarded(), "The source object must already forwarded.");
+    HeapWord* src_new_addr = new_addr_of(src_obj, compressor);
+    if (src_new_addr == NULL) {
+      src_new_addr = (HeapWord*)src_obj;   // not moved
+    }
 
 		log_trace(semeru,mem_compact)("%s, Record an inter-Region reference src_obj 0x%lx[ field 0x%lx ] --> obj 0x%lx", 
                                                       __func__, (size_t)(HeapWord*)src_obj, (size_t)p, (size_t)(HeapWord*)obj );
@@ -153,16 +174,17 @@ inline void G1SemeruAdjustClosure::semeru_ms_adjust_intra_region_pointer(oop src
     // Attention, use the new address of the field. The address after compaction.
     // Assumption, the field offset in old and new objects is same.
     size_t field_offset = (char*)p - (char*)(HeapWord*)src_obj;
-    T* new_field_addr =  (T*)((char*)(HeapWord*)src_obj->forwardee() + field_offset) ;  // T is oop.
+    T* new_field_addr =  (T*)((char*)src_new_addr + field_offset) ;  // T is oop.
 
 
     log_trace(semeru,mem_compact)("%s, enqueue the new addr. new obj addr 0x%lx, new field addr 0x%lx \n", 
-                                                        __func__, (size_t)(HeapWord*)src_obj->forwardee(), (size_t)new_field_addr );
+                                                        __func__, (size_t)src_new_addr, (size_t)new_field_addr );
 
     // curr_region is the old/original Region.
     // It can only be claimed by one thread. So the push is thread safe.
     // But it's better to put the StarTask queue at Compact task. 
     inter_region_ref_queue->push(new_field_addr); // cast oop* to StarTask
+    SemeruHeapRegion::note_rewritten_field(new_field_addr);   // by the phase#4
 
     // go out, can't update the field now.
 		return;
@@ -180,10 +202,11 @@ inline void G1SemeruAdjustClosure::semeru_ms_adjust_intra_region_pointer(oop src
     return;
   }
 
-  oop forwardee = obj->forwardee(); // get the new address of the referenced object.
+  oop forwardee = (oop)new_addr_of(obj, compressor); // get the new address of the referenced object.
   if (forwardee == NULL) {
     // Not forwarded, return current reference.
-    assert(obj->mark_raw() == markOopDesc::prototype_for_object(obj) || // Correct mark
+    assert(compressor != NULL ||
+           obj->mark_raw() == markOopDesc::prototype_for_object(obj) || // Correct mark
            obj->mark_raw()->must_be_preserved(obj) || // Will be restored by PreservedMarksSet
            (UseBiasedLocking && obj->has_bias_pattern_raw()), // Will be restored by BiasedLocking
            "Must have correct prototype or be preserved, obj: " PTR_FORMAT ", mark: " PTR_FORMAT ", prototype: " PTR_FORMAT,
@@ -192,8 +215,10 @@ inline void G1SemeruAdjustClosure::semeru_ms_adjust_intra_region_pointer(oop src
   }
 
   // Forwarded, just update.
+  // The concurrent compaction updates the field's copy in the shadow.
   assert(Universe::semeru_heap()->is_in_semeru_reserved(forwardee), "should be in object space");
-  RawAccess<IS_NOT_NULL>::oop_store(p, forwardee);
+  SemeruCompressedOops::store_not_null((T*)((char*)p + shadow_delta), forwardee);
+  curr_region->note_rewritten(p, p + 1);   // copied along if the object moves
 }
 
 
@@ -205,7 +230,11 @@ inline void G1SemeruAdjustClosure::do_oop(oop* p)       { do_oop_work(p); }
 inline void G1SemeruAdjustClosure::do_oop(narrowOop* p) { do_oop_work(p); }
 
 inline void G1SemeruAdjustClosure::semeru_ms_do_oop(oop obj, oop* p) { semeru_ms_do_oop_work(obj, p); }
-inline void G1SemeruAdjustClosure::semeru_ms_do_oop(oop obj, narrowOop* p) { do_oop_work(p); }
+inline void G1SemeruAdjustClosure::semeru_ms_do_oop(oop obj, narrowOop* p) { semeru_ms_do_oop_work(obj, p); }
+
+inline size_t G1SemeruAdjustLiveClosure::apply(oop object) {
+  return G1SemeruKlassLayoutCache::oop_iterate_size(object, _adjust_pointer);
+}
 
 
 
@@ -0,0 +1,263 @@
+/**
+ * Semeru Memory Server - merge the identical value arrays of the traced Strings, -XX:+SemeruRemoteStringDedup on the CPU server.
+ *
+ */
+
+#include "precompiled.hpp"
+#include "classfile/javaClasses.inline.hpp"
+#include "gc/g1/g1ConcurrentMarkBitMap.inline.hpp"
+#include "gc/g1/g1SemeruCollectedHeap.inline.hpp"
+#include "gc/g1/g1SemeruCompressedOops.inline.hpp"
+#include "gc/g1/g1SemeruCompressor.hpp"
+#include "gc/g1/g1SemeruStringDedup.inline.hpp"
+#include "gc/g1/g1SemeruStringDedupThread.hpp"
+#include "gc/g1/SemeruHeapRegion.inline.hpp"
+#include "gc/shared/rdmaStructure.hpp"
+#include "logging/log.hpp"
+#include "oops/arrayOop.hpp"
+#include "oops/oop.inline.hpp"
+#include "runtime/atomic.hpp"
+#include "runtime/mutexLocker.hpp"
+
+
+// The fields of the Semeru heap are encoded by the CPU server.
+static oop load_field(oop obj, int offset) {
+  if (UseCompressedOops) {
+    return SemeruCompressedOops::load_decode(obj->obj_field_addr_raw<narrowOop>(offset));
+  }
+  return SemeruCompressedOops::load_decode(obj->obj_field_addr_raw<oop>(offset));
+}
+
+static void store_field(HeapWord* obj, int offset, HeapWord* value) {
+  if (UseCompressedOops) {
+    SemeruCompressedOops::store((narrowOop*)((char*)obj + offset), (oop)value);
+  } else {
+    SemeruCompressedOops::store((oop*)((char*)obj + offset), (oop)value);
+  }
+}
+
+static int length_of(HeapWord* array) {
+  return arrayOop(array)->length();
+}
+
+static jbyte* bytes_of(HeapWord* array) {
+  return (jbyte*)((char*)array + arrayOopDesc::base_offset_in_bytes(T_BYTE));
+}
+
+
+G1SemeruStringDedup::G1SemeruStringDedup(G1SemeruCollectedHeap* semeru_h, uint max_regions) :
+  _semeru_h(semeru_h),
+  _monitor(NULL),
+  _batches(new (ResourceObj::C_HEAP, mtGC) GrowableArray<Batch>(16, true, mtGC)),
+  _merges(NEW_C_HEAP_ARRAY(Merges, max_regions, mtGC)),
+  _max_regions(max_regions),
+  _thread(NULL),
+  _merged(0),
+  _merged_bytes(0)
+{
+  _monitor = new Monitor(Mutex::nonleaf, "Semeru string dedup monitor", true,
+                         Monitor::_safepoint_check_never);
+
+  for (uint i = 0; i < max_regions; i++) {
+    _merges[i]._epoch = 0;
+    _merges[i]._list  = NULL;
+  }
+
+  _thread = new G1SemeruStringDedupThread(this);
+}
+
+
+void G1SemeruStringDedup::enqueue_region(SemeruHeapRegion* hr, GrowableArray<HeapWord*>* strings) {
+  Batch batch;
+  batch._region  = hr->hrm_index();
+  batch._epoch   = hr->_liveness_epochs->epoch_of(hr->hrm_index());
+  batch._strings = strings;
+
+  MutexLockerEx x(_monitor, Mutex::_no_safepoint_check_flag);
+  _batches->append(batch);
+  _monitor->notify();
+}
+
+
+bool G1SemeruStringDedup::has_batches() const {
+  assert_lock_strong(_monitor);
+  return _batches->is_nonempty();
+}
+
+
+bool G1SemeruStringDedup::process_next_batch() {
+  Batch batch;
+  {
+    MutexLockerEx x(_monitor, Mutex::_no_safepoint_check_flag);
+    if (_batches->is_empty()) {
+      return false;
+    }
+    batch = _batches->pop();
+  }
+
+  GrowableArray<Merge>* merges = new (ResourceObj::C_HEAP, mtGC) GrowableArray<Merge>(16, true, mtGC);
+  dedup_batch(&batch, merges);
+  delete batch._strings;
+
+  GrowableArray<Merge>* stale;
+  {
+    MutexLockerEx x(_monitor, Mutex::_no_safepoint_check_flag);
+    stale = _merges[batch._region]._list;
+    _merges[batch._region]._epoch = batch._epoch;
+    _merges[batch._region]._list  = merges->is_nonempty() ? merges : NULL;
+  }
+  delete stale;
+  if (merges->is_empty()) {
+    delete merges;
+  }
+  return true;
+}
+
+
+HeapWord* G1SemeruStringDedup::value_in_region(HeapWord* obj, SemeruHeapRegion* hr,
+                                               flags_of_cpu_server_state* cpu_server_flags) const {
+  HeapWord* top = hr->top();
+  if (obj < hr->bottom() || obj >= top || oop(obj)->klass() != cpu_server_flags->_string_klass) {
+    return NULL;
+  }
+
+  HeapWord* value = (HeapWord*)load_field(oop(obj), java_lang_String::value_offset_in_bytes());
+  if (value == NULL || value < hr->bottom() || value >= top ||
+      oop(value)->klass() != cpu_server_flags->_byte_array_klass ||
+      !hr->alive_bitmap()->is_marked(value)) {
+    return NULL;
+  }
+
+  // The mutators of the CPU server may have rewritten the Region, never read beyond its top.
+  int length = length_of(value);
+  if (length < 0 || pointer_delta(top, value) < arrayOopDesc::header_size(T_BYTE) + align_up((size_t)length, HeapWordSize) / HeapWordSize) {
+    return NULL;
+  }
+  return value;
+}
+
+
+bool G1SemeruStringDedup::equals(HeapWord* a, HeapWord* b) {
+  int length = length_of(a);
+  return length == length_of(b) && memcmp(bytes_of(a), bytes_of(b), length) == 0;
+}
+
+
+unsigned int G1SemeruStringDedup::hash(HeapWord* array) {
+  unsigned int h = 0;
+  int length = length_of(array);
+  jbyte* bytes = bytes_of(array);
+  for (int i = 0; i < length; i++) {
+    h = 31 * h + (unsigned int)bytes[i];
+  }
+  return h;
+}
+
+
+/**
+ * An open addressing table of the first array of each content, twice the candidates.
+ */
+void G1SemeruStringDedup::dedup_batch(Batch* batch, GrowableArray<Merge>* merges) {
+  flags_of_cpu_server_state* cpu_server_flags = _semeru_h->cpu_server_flags();
+  SemeruHeapRegion* hr = _semeru_h->region_at(batch->_region);
+  GrowableArray<HeapWord*>* strings = batch->_strings;
+
+  size_t capacity = 16;
+  while (capacity < 2 * (size_t)strings->length()) {
+    capacity <<= 1;
+  }
+  HeapWord**    arrays = NEW_C_HEAP_ARRAY(HeapWord*, capacity, mtGC);
+  unsigned int* hashes = NEW_C_HEAP_ARRAY(unsigned int, capacity, mtGC);
+  memset(arrays, 0, capacity * sizeof(HeapWord*));
+
+  size_t merged_bytes = 0;
+  for (int i = 0; i < strings->length(); i++) {
+    HeapWord* string = strings->at(i);
+    HeapWord* value  = value_in_region(string, hr, cpu_server_flags);
+    if (value == NULL) {
+      continue;
+    }
+
+    unsigned int h = hash(value);
+    size_t slot = h & (capacity - 1);
+    while (arrays[slot] != NULL && !(hashes[slot] == h && equals(arrays[slot], value))) {
+      slot = (slot + 1) & (capacity - 1);
+    }
+
+    if (arrays[slot] == NULL) {
+      arrays[slot] = value;
+      hashes[slot] = h;
+    } else if (arrays[slot] != value) {
+      Merge m;
+      m._string    = string;
+      m._value     = value;
+      m._canonical = arrays[slot];
+      merges->append(m);
+      merged_bytes += length_of(value);
+    }
+  }
+
+  FREE_C_HEAP_ARRAY(HeapWord*, arrays);
+  FREE_C_HEAP_ARRAY(unsigned int, hashes);
+
+  log_debug(semeru, mem_compact)("%s, Region[0x%x] 0x%x Strings, 0x%x duplicated arrays of 0x%lx bytes", __func__,
+                                 batch->_region, strings->length(), merges->length(), merged_bytes);
+}
+
+
+/**
+ * The Region may be traced again, or rewritten by the CPU server, since the merges were recorded.
+ * A changed liveness epoch drops all of them, the rest are checked one by one.
+ */
+size_t G1SemeruStringDedup::apply_in_shadow(SemeruHeapRegion* hr, G1SemeruCompressor* compressor, HeapWord* shadow) {
+  GrowableArray<Merge>* merges;
+  uint32_t epoch;
+  {
+    MutexLockerEx x(_monitor, Mutex::_no_safepoint_check_flag);
+    merges = _merges[hr->hrm_index()]._list;
+    epoch  = _merges[hr->hrm_index()]._epoch;
+    _merges[hr->hrm_index()]._list = NULL;
+  }
+  if (merges == NULL) {
+    return 0;
+  }
+
+  size_t applied = 0;
+  size_t applied_bytes = 0;
+  if (epoch == hr->_liveness_epochs->epoch_of(hr->hrm_index())) {
+    flags_of_cpu_server_state* cpu_server_flags = _semeru_h->cpu_server_flags();
+    G1CMBitMap* alive_bitmap = hr->alive_bitmap();
+    HeapWord* bottom = hr->bottom();
+
+    for (int i = 0; i < merges->length(); i++) {
+      Merge* m = merges->adr_at(i);
+      if (!alive_bitmap->is_marked(m->_string) ||
+          value_in_region(m->_string, hr, cpu_server_flags) != m->_value ||
+          !hr->is_in(m->_canonical) || m->_canonical >= hr->top() ||
+          !alive_bitmap->is_marked(m->_canonical) ||
+          oop(m->_canonical)->klass() != cpu_server_flags->_byte_array_klass ||
+          !equals(m->_value, m->_canonical)) {
+        continue;
+      }
+
+      HeapWord* copy = shadow + pointer_delta(compressor->new_addr(m->_string), bottom);
+      store_field(copy, java_lang_String::value_offset_in_bytes(), compressor->new_addr(m->_canonical));
+      applied++;
+      applied_bytes += length_of(m->_value);
+    }
+  }
+  delete merges;
+
+  if (applied > 0) {
+    Atomic::add(applied, &_merged);
+    Atomic::add(applied_bytes, &_merged_bytes);
+    log_debug(semeru, mem_compact)("%s, Region[0x%x] 0x%lx Strings merged, 0x%lx bytes, total 0x%lx Strings", __func__,
+                                   hr->hrm_index(), applied, applied_bytes, _merged);
+  }
+  return applied;
+}
+
+
+void G1SemeruStringDedup::stop() {
+  _thread->stop();
+}
@@ -0,0 +1,97 @@
+/**
+ * Semeru Memory Server - merge the identical value arrays of the traced Strings, -XX:+SemeruRemoteStringDedup on the CPU server.
+ *
+ */
+
+#ifndef SHARE_GC_G1_G1_SEMERU_STRINGDEDUP_HPP
+#define SHARE_GC_G1_G1_SEMERU_STRINGDEDUP_HPP
+
+#include "memory/allocation.hpp"
+#include "oops/oopsHierarchy.hpp"
+#include "utilities/globalDefinitions.hpp"
+#include "utilities/growableArray.hpp"
+
+class flags_of_cpu_server_state;
+class G1SemeruCollectedHeap;
+class G1SemeruCompressor;
+class G1SemeruStringDedupThread;
+class Monitor;
+class SemeruHeapRegion;
+
+
+/**
+ * Semeru MS - The Strings are deduplicated where they are traced, the CPU server never swaps them in for it.
+ *
+ * 1) The concurrent tracing collects the marked Strings of the Region it traces, see is_candidate().
+ *    A completely traced Region hands them over to the dedup thread, enqueue_region().
+ * 2) The dedup thread hashes their value arrays and picks the first alive array of each content as the canonical one.
+ *    The merges <String, value, canonical> are recorded by the old addresses, with the Region's liveness epoch.
+ * 3) The concurrent compaction applies the merges of a Region in its shadow, apply_in_shadow().
+ *    Each merge is validated again, the String copies get the new address of the canonical array.
+ *    The merges are committed or discarded with the Region's image.
+ * 4) The duplicated arrays are unreachable after the commit, the next tracing and compaction of the Region free them.
+ *    The CPU server reads the merged fields when it swaps in the committed pages, there is nothing to tell it.
+ *
+ * Only the arrays of the String's own Region are merged, the compaction can't redirect a field to another Region.
+ */
+class G1SemeruStringDedup : public CHeapObj<mtGC> {
+  friend class G1SemeruStringDedupThread;
+
+  // A String whose value array is replaced, all old addresses.
+  struct Merge {
+    HeapWord* _string;
+    HeapWord* _value;       // the array when it was hashed
+    HeapWord* _canonical;
+  };
+
+  // The candidates of a traced Region.
+  struct Batch {
+    uint                      _region;
+    uint32_t                  _epoch;     // the liveness epoch of the tracing
+    GrowableArray<HeapWord*>* _strings;
+  };
+
+  // The merges of a Region, valid while its liveness epoch is unchanged.
+  struct Merges {
+    uint32_t              _epoch;
+    GrowableArray<Merge>* _list;
+  };
+
+  G1SemeruCollectedHeap*     _semeru_h;
+  Monitor*                   _monitor;    // guards _batches and _merges
+  GrowableArray<Batch>*      _batches;
+  Merges*                    _merges;     // by Region index
+  uint                       _max_regions;
+  G1SemeruStringDedupThread* _thread;
+
+  // Statistics
+  volatile size_t _merged;
+  volatile size_t _merged_bytes;
+
+  // The byte[] value of the String obj, if it's alive in hr. NULL otherwise.
+  HeapWord* value_in_region(HeapWord* obj, SemeruHeapRegion* hr, flags_of_cpu_server_state* cpu_server_flags) const;
+  static bool equals(HeapWord* a, HeapWord* b);
+  static unsigned int hash(HeapWord* array);
+
+  // The dedup thread.
+  bool has_batches() const;
+  bool process_next_batch();
+  void dedup_batch(Batch* batch, GrowableArray<Merge>* merges);
+
+public:
+  G1SemeruStringDedup(G1SemeruCollectedHeap* semeru_h, uint max_regions);
+
+  // A String of the CPU server. The klasses are set by the CPU server before it enables the dedup.
+  static inline bool is_candidate(oop obj, flags_of_cpu_server_state* cpu_server_flags);
+
+  // The CM task traced hr completely. Takes the ownership of strings.
+  void enqueue_region(SemeruHeapRegion* hr, GrowableArray<HeapWord*>* strings);
+
+  // The concurrent compaction, after hr is compacted into the shadow. Returns the number of merged Strings.
+  // The merges of hr are consumed either way.
+  size_t apply_in_shadow(SemeruHeapRegion* hr, G1SemeruCompressor* compressor, HeapWord* shadow);
+
+  void stop();
+};
+
+#endif // SHARE_GC_G1_G1_SEMERU_STRINGDEDUP_HPP
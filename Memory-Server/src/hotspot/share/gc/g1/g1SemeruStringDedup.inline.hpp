@@ -0,0 +1,17 @@
+/**
+ * Semeru Memory Server - merge the identical value arrays of the traced Strings, -XX:+SemeruRemoteStringDedup on the CPU server.
+ *
+ */
+
+#ifndef SHARE_GC_G1_G1_SEMERU_STRINGDEDUP_INLINE_HPP
+#define SHARE_GC_G1_G1_SEMERU_STRINGDEDUP_INLINE_HPP
+
+#include "gc/g1/g1SemeruStringDedup.hpp"
+#include "gc/shared/rdmaStructure.hpp"
+#include "oops/oop.inline.hpp"
+
+inline bool G1SemeruStringDedup::is_candidate(oop obj, flags_of_cpu_server_state* cpu_server_flags) {
+  return cpu_server_flags->_remote_string_dedup && obj->klass() == cpu_server_flags->_string_klass;
+}
+
+#endif // SHARE_GC_G1_G1_SEMERU_STRINGDEDUP_INLINE_HPP
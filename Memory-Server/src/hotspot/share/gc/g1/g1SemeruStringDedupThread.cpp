@@ -0,0 +1,56 @@
+/**
+ * Semeru Memory Server - merge the identical value arrays of the traced Strings, -XX:+SemeruRemoteStringDedup on the CPU server.
+ *
+ */
+
+#include "precompiled.hpp"
+#include "gc/g1/g1SemeruStringDedup.hpp"
+#include "gc/g1/g1SemeruStringDedupThread.hpp"
+#include "logging/log.hpp"
+#include "runtime/mutexLocker.hpp"
+#include "runtime/os.hpp"
+
+G1SemeruStringDedupThread::G1SemeruStringDedupThread(G1SemeruStringDedup* dedup) :
+  ConcurrentGCThread(),
+  _vtime_start(0.0),
+  _vtime_accum(0.0),
+  _dedup(dedup)
+{
+  set_name("G1 Semeru String Dedup");
+  create_and_start();
+}
+
+void G1SemeruStringDedupThread::wait_for_batches() {
+  MutexLockerEx x(_dedup->_monitor, Mutex::_no_safepoint_check_flag);
+  while (!should_terminate() && !_dedup->has_batches()) {
+    _dedup->_monitor->wait(Mutex::_no_safepoint_check_flag);
+  }
+}
+
+void G1SemeruStringDedupThread::run_service() {
+  _vtime_start = os::elapsedVTime();
+
+  while (!should_terminate()) {
+    wait_for_batches();
+    if (should_terminate()) {
+      break;
+    }
+
+    while (!should_terminate() && _dedup->process_next_batch()) {
+      // drain the traced Regions
+    }
+
+    if (os::supports_vtime()) {
+      _vtime_accum = (os::elapsedVTime() - _vtime_start);
+    } else {
+      _vtime_accum = 0.0;
+    }
+  }
+
+  log_debug(semeru, mem_compact)("%s, stopping", __func__);
+}
+
+void G1SemeruStringDedupThread::stop_service() {
+  MutexLockerEx x(_dedup->_monitor, Mutex::_no_safepoint_check_flag);
+  _dedup->_monitor->notify();
+}
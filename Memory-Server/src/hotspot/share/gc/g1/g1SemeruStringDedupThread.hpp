@@ -0,0 +1,36 @@
+/**
+ * Semeru Memory Server - merge the identical value arrays of the traced Strings, -XX:+SemeruRemoteStringDedup on the CPU server.
+ *
+ */
+
+#ifndef SHARE_GC_G1_G1_SEMERU_STRINGDEDUPTHREAD_HPP
+#define SHARE_GC_G1_G1_SEMERU_STRINGDEDUPTHREAD_HPP
+
+#include "gc/shared/concurrentGCThread.hpp"
+
+class G1SemeruStringDedup;
+
+/**
+ * Semeru MS - The dedup thread, hashes the Strings of the traced Regions off the tracing path.
+ *
+ * It sleeps until a CM task hands over the candidates of a Region, see G1SemeruStringDedup::enqueue_region().
+ * The merges it records are only applied by the concurrent compaction, it never writes the heap.
+ */
+class G1SemeruStringDedupThread: public ConcurrentGCThread {
+  double _vtime_start;  // Initial virtual time.
+  double _vtime_accum;  // Accumulated virtual time.
+
+  G1SemeruStringDedup* _dedup;
+
+  void wait_for_batches();
+
+  void run_service();
+  void stop_service();
+public:
+  G1SemeruStringDedupThread(G1SemeruStringDedup* dedup);
+
+  // Total virtual time so far.
+  double vtime_accum() { return _vtime_accum; }
+};
+
+#endif // SHARE_GC_G1_G1_SEMERU_STRINGDEDUPTHREAD_HPP
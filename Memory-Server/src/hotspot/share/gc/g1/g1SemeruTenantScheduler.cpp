@@ -0,0 +1,78 @@
+/**
+ * Semeru Memory Server - schedule the concurrent GC of the memory servers sharing a machine.
+ *
+ */
+
+#include "precompiled.hpp"
+#include "gc/g1/g1SemeruTenantScheduler.hpp"
+#include "logging/log.hpp"
+#include "runtime/atomic.hpp"
+#include "runtime/globals.hpp"
+#include "runtime/orderAccess.hpp"
+#include "runtime/os.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// Created by the first tenant, zero filled.
+static const char semeru_tenant_slots_path[] = "/dev/shm/semeru_tenant_gc_slots";
+
+G1SemeruTenantScheduler::SharedSlots* G1SemeruTenantScheduler::_slots = NULL;
+
+
+void G1SemeruTenantScheduler::initialize() {
+  if (SemeruTenantGCSlots == 0 || _slots != NULL) {
+    return;
+  }
+
+  int fd = ::open(semeru_tenant_slots_path, O_RDWR | O_CREAT, 0666);
+  if (fd < 0 || ::ftruncate(fd, os::vm_page_size()) != 0) {
+    log_warning(semeru, gc)("%s, can't open %s, tenant %u is not scheduled with the other tenants.",
+                            __func__, semeru_tenant_slots_path, SemeruTenantID);
+    if (fd >= 0) {
+      ::close(fd);
+    }
+    return;
+  }
+
+  void* addr = ::mmap(NULL, os::vm_page_size(), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (addr == MAP_FAILED) {
+    log_warning(semeru, gc)("%s, can't map %s, tenant %u is not scheduled with the other tenants.",
+                            __func__, semeru_tenant_slots_path, SemeruTenantID);
+    return;
+  }
+
+  _slots = (SharedSlots*)addr;
+  log_info(semeru, gc)("%s, tenant %u shares %u concurrent GC slots, ticket %u, released %u.", __func__,
+                       SemeruTenantID, SemeruTenantGCSlots, _slots->ticket, _slots->released);
+}
+
+
+bool G1SemeruTenantScheduler::acquire() {
+  assert(is_enabled(), "the tenant scheduler is off");
+
+  uint32_t my_ticket = Atomic::add(1u, &_slots->ticket) - 1;
+  jlong wait_start = os::javaTimeMillis();
+
+  // Unsigned distance, safe across the wrap of the counters.
+  while (my_ticket - OrderAccess::load_acquire(&_slots->released) >= (uint32_t)SemeruTenantGCSlots) {
+    if ((julong)(os::javaTimeMillis() - wait_start) >= SemeruTenantGCSlotWaitMillis) {
+      log_info(semeru, gc)("%s, tenant %u waited " JLONG_FORMAT " ms for ticket %u, run without a slot.", __func__,
+                           SemeruTenantID, os::javaTimeMillis() - wait_start, my_ticket);
+      return false;
+    }
+    os::naked_short_sleep(1);
+  }
+
+  log_debug(semeru, gc)("%s, tenant %u got slot of ticket %u after " JLONG_FORMAT " ms.", __func__,
+                        SemeruTenantID, my_ticket, os::javaTimeMillis() - wait_start);
+  return true;
+}
+
+
+void G1SemeruTenantScheduler::release() {
+  assert(is_enabled(), "the tenant scheduler is off");
+  Atomic::inc(&_slots->released);
+}
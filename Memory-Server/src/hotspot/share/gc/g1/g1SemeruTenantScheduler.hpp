@@ -0,0 +1,63 @@
+/**
+ * Semeru Memory Server - schedule the concurrent GC of the memory servers sharing a machine.
+ *
+ */
+
+#ifndef SHARE_GC_G1_G1_SEMERU_TENANT_SCHEDULER_HPP
+#define SHARE_GC_G1_G1_SEMERU_TENANT_SCHEDULER_HPP
+
+#include "memory/allocation.hpp"
+#include "utilities/globalDefinitions.hpp"
+
+
+/**
+ * Semeru MS - Several CPU servers can keep their memory servers on one machine, -XX:SemeruTenantID.
+ *
+ * Each tenant is a separate memory server process. The Semeru heap is reserved at the fixed
+ * virtual addresses shared with its CPU server, so the tenants can't share one address space.
+ * Being separate processes, each tenant has its own
+ *  1) RDMA listener, the base port + SemeruTenantID,
+ *  2) protection domain and memory regions, allocated and registered by its own rdma_comm,
+ *  3) GC worker budget, its SemeruConcGCThreads.
+ *
+ * What the tenants share are the cores. With -XX:SemeruTenantGCSlots=N, at most N of them
+ * run their concurrent tracing and compaction at a time. The slots are granted in the order
+ * they are asked for, a ticket semaphore in a page of shared memory:
+ *
+ *  ticket   : the next ticket to hand out.
+ *  released : number of slots given back.
+ *
+ * The holder of ticket t runs once t - released < N. A tenant gives its slot back after each
+ * round of the concurrent phase, and waits behind the other tenants for the next one.
+ *
+ * A tenant dying with a slot leaks it. Waiters give up after SemeruTenantGCSlotWaitMillis and
+ * run anyway, their release covers the leaked one.
+ * The STW compaction never waits for a slot, the CPU server is paused.
+ */
+class G1SemeruTenantScheduler : public AllStatic {
+  struct SharedSlots {
+    volatile uint32_t ticket;
+    volatile uint32_t released;
+  };
+
+  static SharedSlots* _slots;      // NULL if the scheduling is off.
+
+public:
+  // Map the slots shared by the tenants of this machine.
+  static void initialize();
+
+  static bool is_enabled() { return _slots != NULL; }
+
+  // Wait for a slot. Return false if the wait timed out.
+  static bool acquire();
+  static void release();
+};
+
+// Hold a slot of the tenant scheduler within a scope.
+class G1SemeruTenantGCSlot : public StackObj {
+public:
+  G1SemeruTenantGCSlot()  { if (G1SemeruTenantScheduler::is_enabled()) G1SemeruTenantScheduler::acquire(); }
+  ~G1SemeruTenantGCSlot() { if (G1SemeruTenantScheduler::is_enabled()) G1SemeruTenantScheduler::release(); }
+};
+
+#endif // SHARE_GC_G1_G1_SEMERU_TENANT_SCHEDULER_HPP
@@ -743,6 +743,185 @@
           range(0, 128)                                               \
           /*constraint(SemeruConcGCThreadsConstraintFunc,AfterErgo) */      \
                                                                             \
+  product(uint, SemeruMemServerNum, NUM_OF_MEMORY_SERVER,                   \
+          "Number of memory servers of the CPU server. "                    \
+          "Has to divide RDMA_DATA_REGION_NUM")                             \
+          range(1, MAX_NUM_OF_MEMORY_SERVER)                                \
+                                                                            \
+  product(uint, SemeruMemServerID, CUR_MEMORY_SERVER_ID,                    \
+          "Id of this memory server, in [0, SemeruMemServerNum)")           \
+          range(0, MAX_NUM_OF_MEMORY_SERVER - 1)                            \
+                                                                            \
+  product(bool, SemeruMemPoolODP, true,                                     \
+          "Register the data Regions as On-Demand-Paging RDMA buffers, "    \
+          "if the HCA supports it. They are not pinned then")               \
+                                                                            \
+  product(bool, SemeruRdmaSRQ, false,                                       \
+          "Receive the 2-sided RDMA messages of all the QPs of the CPU "    \
+          "servers through one shared receive queue, instead of a recv "    \
+          "queue and a registered buffer per QP")                           \
+                                                                            \
+  product(ccstr, SemeruMemPoolFile, NULL,                                   \
+          "Back the data Regions of the Semeru memory pool by this file, "  \
+          "on hugetlbfs or a DAX file system. A restarted memory server "   \
+          "keeps the pages swapped out by the CPU server")                  \
+                                                                            \
+  product(bool, SemeruMemPoolCXL, false,                                    \
+          "The SemeruMemPoolFile is a window of a CXL memory pool, e.g. "   \
+          "/dev/dax0.0, accessed by the CPU server with loads and stores. " \
+          "Write back and drop the cached lines of the Regions around the " \
+          "tracing and the compaction")                                     \
+                                                                            \
+  product(bool, SemeruCompressorCompact, false,                             \
+          "Memory server compaction derives the new addresses from the "    \
+          "alive bitmap and per block live words, instead of the "          \
+          "forwarding pointers in the object headers")                      \
+                                                                            \
+  product(size_t, SemeruCompactChunkSize, 32*M,                             \
+          "Memory server compaction splits the Regions holding more than "  \
+          "two chunks of used bytes into chunks of this size, compacted "   \
+          "by all the workers. 0 disables the splitting")                   \
+          range(0, max_uintx)                                               \
+                                                                            \
+  product(ccstr, SemeruCompactDMADevice, NULL,                              \
+          "The shared work queue of a DMA engine, e.g. /dev/dsa/wq0.0. "    \
+          "The memory server compaction moves the large objects by it, "    \
+          "overlapped with the CPU copy of the small ones")                 \
+                                                                            \
+  product(size_t, SemeruCompactDMAMinBytes, 16*K,                           \
+          "The smallest object moved by SemeruCompactDMADevice. An "        \
+          "object over the max transfer size of the work queue is "         \
+          "finished by the CPU")                                            \
+          range(HeapWordSize, max_uintx)                                    \
+                                                                            \
+  product(uint, SemeruCMPrefetchDistance, 8,                                \
+          "Memory server tracing prefetches the popped objects and scans "  \
+          "each of them after this many younger ones are popped. "          \
+          "0 disables the prefetching")                                     \
+          range(0, 64)                                                      \
+                                                                            \
+  product(bool, SemeruIncrementalTracing, false,                            \
+          "Memory server keeps the liveness of the evicted Regions whose "  \
+          "contents and root bitmaps are unchanged since their last "       \
+          "tracing. Needs the write check tags of the block path")          \
+                                                                            \
+  product(bool, SemeruNUMABind, false,                                      \
+          "Memory server places the data Regions and the mark stack on "    \
+          "the NUMA node of the RDMA NIC, and runs the GC workers there")   \
+                                                                            \
+  product(bool, SemeruAdaptiveConcGCThreads, false,                         \
+          "Memory server activates the SemeruConcGCThreads workers by the " \
+          "backlog of its CSet, one per Region to compact in the STW "      \
+          "window. The idle workers leave their cores to the RDMA")         \
+                                                                            \
+  product(uint, SemeruRegionsPerConcGCThread, 2,                            \
+          "With SemeruAdaptiveConcGCThreads, one more tracing worker is "   \
+          "activated per this many freshly evicted Regions in backlog")     \
+          range(1, 1024)                                                    \
+                                                                            \
+  product(uint, SemeruTenantID, 0,                                          \
+          "Tenant of this memory server process, when the memory servers "  \
+          "of several CPU servers share a machine. Listens on the base "    \
+          "port plus this id")                                              \
+          range(0, 63)                                                      \
+                                                                            \
+  product(uint, SemeruTenantGCSlots, 0,                                     \
+          "Number of tenants on this machine allowed to trace and compact " \
+          "concurrently, granted in FIFO order. 0 disables the "            \
+          "scheduling across the tenants")                                  \
+          range(0, 64)                                                      \
+                                                                            \
+  product(uintx, SemeruTenantGCSlotWaitMillis, 1000,                        \
+          "With SemeruTenantGCSlots, longest wait for a slot before the "   \
+          "tenant runs its concurrent phase anyway")                        \
+          range(0, max_uintx)                                               \
+                                                                            \
+  product(bool, SemeruPreemptTracingOnSTW, true,                            \
+          "Check the doorbell of the CPU server every few thousand words "  \
+          "traced, and give up the traced Region as soon as the CPU server "\
+          "is in STW, instead of at the next Region boundary")              \
+                                                                            \
+  product(ccstr, SemeruMarkStackSpillDir, NULL,                             \
+          "Directory on a local NVMe. Once the global mark stack is full "  \
+          "at MarkStackSizeMax, its chunks are spilled to a file there, "   \
+          "instead of restarting the marking on overflow")                  \
+                                                                            \
+  product(size_t, SemeruMarkStackSpillSize, 4*G,                            \
+          "Size of the mark stack spill file in SemeruMarkStackSpillDir")   \
+          range(0, max_uintx)                                               \
+                                                                            \
+  product(uintx, SemeruEvacuateLiveRatio, 30,                               \
+          "Percentage of alive bytes below which a compacted Region is "    \
+          "evacuated into the current destination Region and freed. "       \
+          "The denser Regions slide into themselves")                       \
+          range(0, 100)                                                     \
+                                                                            \
+  product(bool, SemeruDiscardDeadPages, false,                              \
+          "Give back the physical pages whose swap slots are freed by "     \
+          "the CPU server. Their objects are skipped by the tracing. "      \
+          "Without an ODP MR the pages are only recorded as dead")          \
+                                                                            \
+  product(bool, SemeruTCPTransport, false,                                  \
+          "Serve the reads and writes of the CPU server over TCP, on the "  \
+          "RDMA port + 100, for the CPU servers without an HCA. The "       \
+          "messages still need an RDMA device, e.g. soft-RoCE")             \
+                                                                            \
+  product(bool, SemeruMarkMessages, false,                                  \
+          "Batch the targets the concurrent marking finds out of the "      \
+          "traced Region into the outbox of this server. The CPU server "   \
+          "relays them to the owning servers as roots of their Regions")    \
+                                                                            \
+  product(bool, SemeruColdStore, false,                                     \
+          "Compress the Regions whose blocks the CPU server handed over "   \
+          "as cold into the C heap by LZ4, and give their pages back. "     \
+          "Needs liblz4.so.1 and the On-Demand-Paging memory pool")         \
+                                                                            \
+  product(uint, SemeruColdRegionCycles, 4,                                  \
+          "Rounds of the concurrent service a compacted Region stays "      \
+          "cold before it is compressed, -XX:+SemeruColdStore")             \
+          range(1, max_juint)                                               \
+                                                                            \
+  product(ccstr, SemeruColdSpillDir, NULL,                                  \
+          "Directory on a local NVMe. The blocks of the Regions cold for "  \
+          "SemeruColdSpillCycles rounds are spilled to a file there and "   \
+          "read back on access, -XX:+SemeruColdStore")                      \
+                                                                            \
+  product(uint, SemeruColdSpillCycles, 16,                                  \
+          "Rounds of the concurrent service a compacted Region stays "      \
+          "cold before it is spilled to SemeruColdSpillDir")                \
+          range(1, max_juint)                                               \
+                                                                            \
+  product(bool, SemeruHeadless, false,                                      \
+          "The memory server JVM runs interpreted only, no compiler "       \
+          "threads, and without the perf data file. Its Java code only "    \
+          "waits for the GC threads and the RDMA daemon")                   \
+                                                                            \
+  product(uintx, SemeruKlassLayoutCache, 4096,                              \
+          "Entries, rounded down to a power of 2, of the cache of the "     \
+          "field layouts of the plain instance klasses, used by the "       \
+          "tracing and the pointer adjustment. 0 disables it")              \
+          range(0, 1024*1024)                                               \
+                                                                            \
+  product(uintx, SemeruTerminationSpinMicros, 200,                          \
+          "Within this many microseconds of the end of the pause budget "   \
+          "of the CPU server, the idle compaction workers spin and yield "  \
+          "in the termination protocol instead of sleeping "                \
+          "WorkStealingSleepMillis")                                        \
+          range(0, max_uintx)                                               \
+                                                                            \
+  product(bool, SemeruCompactGarbageFirst, true,                            \
+          "Each pause budget compacts the scanned Regions in the order of " \
+          "their reclaimable bytes per estimated copying cost, the most "   \
+          "garbage first, rather than in the order they were scanned")      \
+                                                                            \
+  product(uint, SemeruAddressWindow, 0,                                     \
+          "The address window of the CPU server JVM this memory server "    \
+          "process serves, its -XX:SemeruAddressWindow. The Semeru space "  \
+          "is mapped at the same virtual addresses. The Semeru kernel "     \
+          "module connects to the RDMA port plus the slot of the window in "\
+          "its address_windows")                                            \
+          range(0, SEMERU_MAX_ADDRESS_WINDOWS - 1)                          \
+                                                                            \
                                                                             \
   /* Semeru end */                                                          \
                                                                             \
@@ -75,6 +75,15 @@ void MarkBitMap::do_clear(MemRegion mr, bool large) {
   }
 }
 
+// Semeru MS - Clear the bitmap of a traced Region, without pulling it into the caches.
+void MarkBitMap::clear_range_nontemporal(MemRegion mr) {
+  MemRegion intersection = mr.intersection(_covered);
+  assert(!intersection.is_empty(),
+         "Given range from " PTR_FORMAT " to " PTR_FORMAT " is completely outside the heap",
+         p2i(mr.start()), p2i(mr.end()));
+  _bm.clear_large_range_nontemporal(addr_to_offset(intersection.start()), addr_to_offset(intersection.end()));
+}
+
 #ifdef ASSERT
 void MarkBitMap::check_mark(HeapWord* addr) {
   assert(Universe::heap()->is_in_reserved(addr),
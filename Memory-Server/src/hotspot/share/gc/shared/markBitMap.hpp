@@ -98,6 +98,7 @@ public:
   // semeru
   size_t covered_start()  { return (size_t)_covered.start(); };
   size_t covered_end()    { return (size_t)_covered.end(); }
+  void clear_range_nontemporal(MemRegion mr);
 
 
   // Clear bitmap.
@@ -25,6 +25,7 @@
 
 #include "gc/shared/owstTaskTerminator.hpp"
 #include "logging/log.hpp"
+#include "runtime/os.hpp"
 
 bool OWSTTaskTerminator::exit_termination(size_t tasks, TerminatorTerminator* terminator) {
   return tasks > 0 || (terminator != NULL && terminator->should_exit_termination());
@@ -206,12 +207,58 @@ bool OWSTTaskTerminator::do_spin_master_work(TerminatorTerminator* terminator) {
 //
 // Semeru Support
 //
+// The memory server compacts in the STW window of the CPU server, with a few slow cores,
+// and within the pause budget the CPU server sends, flags_of_cpu_server_state::_stw_budget_us.
+// The WorkStealing* backoff above is tuned for many fast cores and no deadline,
+// a waiter sleeps WorkStealingSleepMillis, about a whole short window.
+// 1) Within SemeruTerminationSpinMicros of the deadline, or past it, the waiters only spin and yield.
+//    Before that, no sleep crosses into this last stretch.
+// 2) The spin master peeks the queues of the workers last seen on its NUMA node first,
+//    and the other queues only if those are empty.
+//
+
+int OWSTTaskTerminator::semeru_current_node() {
+  return os::numa_get_groups_num() > 1 ? os::numa_get_group_id() : 0;
+}
+
+// The longest sleep of a waiter, 0 if it should spin.
+uint OWSTTaskTerminator::semeru_sleep_millis(double deadline) {
+  if (deadline == 0.0) {
+    return WorkStealingSleepMillis;
+  }
+  double slack_ms = (deadline - os::elapsedTime()) * MILLIUNITS - (double)SemeruTerminationSpinMicros / 1000.0;
+  if (slack_ms < 1.0) {
+    return 0;
+  }
+  return (uint)MIN2((double)WorkStealingSleepMillis, slack_ms);
+}
+
+size_t OWSTTaskTerminator::semeru_tasks_in_queue_set(int node) {
+  uint n = _queue_set->size();
+  size_t tasks = 0;
+
+  for (uint i = 0; i < n && i < MaxNodeHints; i++) {
+    if (_worker_node[i] == node) {
+      tasks += _queue_set->tasks_in(i);
+    }
+  }
+  if (tasks > 0) {
+    return tasks;
+  }
+
+  for (uint i = 0; i < n; i++) {
+    if (i >= MaxNodeHints || _worker_node[i] != node) {
+      tasks += _queue_set->tasks_in(i);
+    }
+  }
+  return tasks;
+}
 
 /**
- * For a Semeru Memory Server Compact task, we allow it to get terminaton offer with non-empty queueSet.
- *  
+ * offer_termination() with the spin budget of the deadline.
+ * Without count_tasks, the tasks in the queue set don't keep the workers, only the terminator does.
  */
-bool OWSTTaskTerminator::offer_semeru_compact_termination(TerminatorTerminator* terminator) {
+bool OWSTTaskTerminator::offer_semeru_termination(TerminatorTerminator* terminator, uint worker_id, double deadline, bool count_tasks) {
   assert(_n_threads > 0, "Initialization is incorrect");
   assert(_offered_termination < _n_threads, "Invariant");
   assert(_blocker != NULL, "Invariant");
@@ -219,17 +266,22 @@ bool OWSTTaskTerminator::offer_semeru_compact_termination(TerminatorTerminator*
   // Single worker, done
   if (_n_threads == 1) {
     _offered_termination = 1;
-    //assert(!peek_in_queue_set(), "Precondition");  // [?] What's the purpose of checking the queue set ?
+    assert(!count_tasks || !peek_in_queue_set(), "Precondition");
     return true;
   }
 
+  int node = semeru_current_node();
+  if (worker_id < MaxNodeHints) {
+    _worker_node[worker_id] = node;
+  }
+
   _blocker->lock_without_safepoint_check();
   _offered_termination++;
   // All arrived, done
   if (_offered_termination == _n_threads) {
     _blocker->notify_all();
     _blocker->unlock();
-    //assert(!peek_in_queue_set(), "Precondition");
+    assert(!count_tasks || !peek_in_queue_set(), "Precondition");
     return true;
   }
 
@@ -240,31 +292,42 @@ bool OWSTTaskTerminator::offer_semeru_compact_termination(TerminatorTerminator*
 
       _blocker->unlock();
 
-      if (do_spin_master_work(terminator)) {
+      if (do_semeru_spin_master_work(terminator, node, deadline, count_tasks)) {
         assert(_offered_termination == _n_threads, "termination condition");
-        //assert(!peek_in_queue_set(), "Precondition");
+        assert(!count_tasks || !peek_in_queue_set(), "Precondition");
         return true;
       } else {
         _blocker->lock_without_safepoint_check();
         // There is possibility that termination is reached between dropping the lock
-        // before returning from do_spin_master_work() and acquiring lock above.
+        // before returning from do_semeru_spin_master_work() and acquiring lock above.
         if (_offered_termination == _n_threads) {
           _blocker->unlock();
-          //assert(!peek_in_queue_set(), "Precondition");
+          assert(!count_tasks || !peek_in_queue_set(), "Precondition");
           return true;
         }
       }
     } else {
-      _blocker->wait(true, WorkStealingSleepMillis);
+      uint sleep_millis = semeru_sleep_millis(deadline);
+      if (sleep_millis > 0) {
+        _blocker->wait(true, sleep_millis);
+      } else {
+        // Close to the deadline, a wakeup by notify comes too late.
+        _blocker->unlock();
+        for (uint j = 0; j < WorkStealingHardSpins; j++) {
+          SpinPause();
+        }
+        yield();
+        _blocker->lock_without_safepoint_check();
+      }
 
       if (_offered_termination == _n_threads) {
         _blocker->unlock();
-        //assert(!peek_in_queue_set(), "Precondition");
+        assert(!count_tasks || !peek_in_queue_set(), "Precondition");
         return true;
       }
     }
 
-    size_t tasks = tasks_in_queue_set();
+    size_t tasks = count_tasks ? semeru_tasks_in_queue_set(node) : 0;
     if (exit_termination(tasks, terminator)) {
       assert_lock_strong(_blocker);
       _offered_termination--;
@@ -274,3 +337,74 @@ bool OWSTTaskTerminator::offer_semeru_compact_termination(TerminatorTerminator*
   }
 }
 
+/**
+ * do_spin_master_work(), but the sleeps are bounded by the deadline and the queues are peeked by node.
+ */
+bool OWSTTaskTerminator::do_semeru_spin_master_work(TerminatorTerminator* terminator, int node, double deadline, bool count_tasks) {
+  uint yield_count = 0;
+  // Number of hard spin loops done since last yield
+  uint hard_spin_count = 0;
+  // Number of iterations in the hard spin loop.
+  uint hard_spin_limit = WorkStealingHardSpins;
+
+  if (WorkStealingSpinToYieldRatio > 0) {
+    hard_spin_limit = WorkStealingHardSpins >> WorkStealingSpinToYieldRatio;
+    hard_spin_limit = MAX2(hard_spin_limit, 1U);
+  }
+
+  // Remember the initial spin limit.
+  uint hard_spin_start = hard_spin_limit;
+
+  while (true) {
+    uint sleep_millis = semeru_sleep_millis(deadline);
+    if (yield_count <= WorkStealingYieldsBeforeSleep || sleep_millis == 0) {
+      yield_count++;
+
+      if (hard_spin_count > WorkStealingSpinToYieldRatio) {
+        yield();
+        hard_spin_count = 0;
+        hard_spin_limit = hard_spin_start;
+      } else {
+        hard_spin_limit = MIN2(2*hard_spin_limit, (uint) WorkStealingHardSpins);
+        for (uint j = 0; j < hard_spin_limit; j++) {
+          SpinPause();
+        }
+        hard_spin_count++;
+      }
+    } else {
+      log_develop_trace(gc, task)("OWSTTaskTerminator::do_semeru_spin_master_work() thread " PTR_FORMAT " sleeps %ums after %u yields",
+                                  p2i(Thread::current()), sleep_millis, yield_count);
+      yield_count = 0;
+
+      MonitorLockerEx locker(_blocker, Mutex::_no_safepoint_check_flag);
+      _spin_master = NULL;
+      locker.wait(Mutex::_no_safepoint_check_flag, sleep_millis);
+      if (_spin_master == NULL) {
+        _spin_master = Thread::current();
+      } else {
+        return false;
+      }
+    }
+
+    size_t tasks = count_tasks ? semeru_tasks_in_queue_set(node) : 0;
+    bool exit = exit_termination(tasks, terminator);
+    {
+      MonitorLockerEx locker(_blocker, Mutex::_no_safepoint_check_flag);
+      // Termination condition reached
+      if (_offered_termination == _n_threads) {
+        _spin_master = NULL;
+        return true;
+      } else if (exit) {
+        if (tasks >= _offered_termination - 1) {
+          locker.notify_all();
+        } else {
+          for (; tasks > 1; tasks--) {
+            locker.notify();
+          }
+        }
+        _spin_master = NULL;
+        return false;
+      }
+    }
+  }
+}
@@ -44,14 +44,24 @@
  */
 
 class OWSTTaskTerminator: public ParallelTaskTerminator {
+public:
+  // Semeru MS, the workers whose NUMA node is remembered.
+  static const uint MaxNodeHints = 64;
+
 private:
   Monitor*    _blocker;       // heavy locker ?  
   Thread*     _spin_master;   // spin-lock ?
 
+  // Semeru MS, the NUMA node each worker last offered termination on, -1 unknown.
+  volatile int _worker_node[MaxNodeHints];
+
 public:
   OWSTTaskTerminator(uint n_threads, TaskQueueSetSuper* queue_set) :
     ParallelTaskTerminator(n_threads, queue_set), _spin_master(NULL) {
     _blocker = new Monitor(Mutex::leaf, "OWSTTaskTerminator", false, Monitor::_safepoint_check_never);
+    for (uint i = 0; i < MaxNodeHints; i++) {
+      _worker_node[i] = -1;
+    }
   }
 
   virtual ~OWSTTaskTerminator() {
@@ -62,8 +72,16 @@ public:
 
   bool offer_termination(TerminatorTerminator* terminator);
 
-  // Semeru MS
-  bool offer_semeru_compact_termination(TerminatorTerminator* terminator);
+  // Semeru MS, the compaction workers. Their queues hold the inter-Region references of the next phase,
+  // they are neither stolen nor counted. deadline is the os::elapsedTime() the pause budget runs out, 0 if none.
+  bool offer_semeru_compact_termination(TerminatorTerminator* terminator, uint worker_id, double deadline) {
+    return offer_semeru_termination(terminator, worker_id, deadline, false);
+  }
+
+  // Semeru MS, the marking workers, concurrent and without a deadline.
+  bool offer_semeru_termination(TerminatorTerminator* terminator, uint worker_id) {
+    return offer_semeru_termination(terminator, worker_id, 0.0, true);
+  }
 
   
 protected:
@@ -78,6 +96,13 @@ private:
    * Return true if termination condition is detected, otherwise return false
    */
   bool do_spin_master_work(TerminatorTerminator* terminator);
+
+  // Semeru MS
+  bool offer_semeru_termination(TerminatorTerminator* terminator, uint worker_id, double deadline, bool count_tasks);
+  bool do_semeru_spin_master_work(TerminatorTerminator* terminator, int node, double deadline, bool count_tasks);
+  size_t semeru_tasks_in_queue_set(int node);
+  static int  semeru_current_node();
+  static uint semeru_sleep_millis(double deadline);
 };
 
 
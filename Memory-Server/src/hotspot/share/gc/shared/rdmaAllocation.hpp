@@ -13,6 +13,7 @@
 #include "runtime/atomic.hpp"
 #include "utilities/globalDefinitions.hpp"
 #include "memory/allocation.hpp"  // Include all the headers of orginal allocation.hpp
+#include "gc/shared/rdmaMetaLayout.hpp"
 #include "logging/log.hpp"
 
 
@@ -258,7 +259,7 @@ public:
         //    First time entering the zone.
         if(CHeapRDMAObj<E, MEM_TO_CPU_AT_GC_ALLOCTYPE>::_alloc_ptr == NULL){
           requested_addr = (char*)(SEMERU_START_ADDR + MEMORY_TO_CPU_GC_OFFSET);
-          CHeapRDMAObj<E, CPU_TO_MEM_AT_GC_ALLOCTYPE>::_instance_size = commit_size;  // init here, compared latter.
+          CHeapRDMAObj<E, MEM_TO_CPU_AT_GC_ALLOCTYPE>::_instance_size = commit_size;  // init here, compared latter.
           
           if( (char*)commit_at(MEMORY_TO_CPU_GC_SIZE_LIMIT, mtGC, requested_addr) ==  requested_addr ){
 
@@ -500,9 +501,9 @@ public:
     switch(Alloc_type)  // based on the instantiation of Template
     {
        case ALLOC_TARGET_OBJ_QUEUE_ALLOCTYPE :
-        requested_addr = (char*)(SEMERU_START_ADDR + CROSS_REGION_REF_TARGET_Q_OFFSET + index * commit_size) ;
+        requested_addr = (char*)(SEMERU_START_ADDR + SemeruMetaLayout::cross_region_ref_target_q_offset() + index * commit_size) ;
 
-        assert(requested_addr + commit_size < (char*)(SEMERU_START_ADDR + CROSS_REGION_REF_TARGET_Q_OFFSET +CROSS_REGION_REF_TARGET_Q_SIZE_LIMIT), 
+        assert(requested_addr + commit_size < (char*)(SEMERU_START_ADDR + SemeruMetaLayout::cross_region_ref_target_q_offset() + SemeruMetaLayout::cross_region_ref_target_q_size()), 
                                                         "%s, Exceed the TARGET_OBJ_QUEUE's space range. \n", __func__ );
         
         // [?] How to handle the failure ?
@@ -27,7 +27,8 @@ E* CHeapRDMAObj<E, Alloc_type>::commit_at(size_t commit_size, MEMFLAGS flags, ch
 	//size_t size = size_for(length);
 
   // why here is !ExecMem ?
-  os::commit_memory_or_exit(requested_addr, commit_size, !ExecMem, "Allocator (commit)");  // Commit the space.
+  // The RDMA structures are registered with the meta Region, THP backs them under -XX:+UseTransparentHugePages.
+  os::commit_memory_or_exit(requested_addr, commit_size, os::large_page_size(), !ExecMem, "Allocator (commit)");  // Commit the space.
 
   return (E*)requested_addr;
 }
@@ -0,0 +1,54 @@
+/**
+ * CRC32C of the Semeru heap pages, computed by the memory servers and verified by the CPU server.
+ *
+ */
+
+#include "precompiled.hpp"
+#include "gc/shared/rdmaChecksum.hpp"
+#include "runtime/globals.hpp"
+#include "runtime/orderAccess.hpp"
+#include "runtime/stubRoutines.hpp"
+
+juint         SemeruCRC32C::_table[256];
+volatile bool SemeruCRC32C::_table_initialized = false;
+
+// The stub of java.util.zip.CRC32C.updateBytes(), the crc is not inverted by the stub.
+typedef juint (*semeru_crc32c_stub_t)(juint crc, const jbyte* buf, jint len);
+
+
+// Racing threads compute the same table.
+void SemeruCRC32C::initialize_table() {
+  for (juint i = 0; i < 256; i++) {
+    juint crc = i;
+    for (int k = 0; k < 8; k++) {
+      crc = (crc & 1) != 0 ? (crc >> 1) ^ 0x82F63B78 : crc >> 1;
+    }
+    _table[i] = crc;
+  }
+  OrderAccess::release_store(&_table_initialized, true);
+}
+
+
+juint SemeruCRC32C::compute(const void* buf, size_t len) {
+  juint crc = 0xFFFFFFFF;
+  const jbyte* p = (const jbyte*)buf;
+
+  address stub = UseCRC32CIntrinsics ? StubRoutines::updateBytesCRC32C() : NULL;
+  if (stub != NULL) {
+    while (len > 0) {
+      jint n = (jint)MIN2(len, (size_t)max_jint);
+      crc = ((semeru_crc32c_stub_t)stub)(crc, p, n);
+      p   += n;
+      len -= n;
+    }
+    return ~crc;
+  }
+
+  if (!OrderAccess::load_acquire(&_table_initialized)) {
+    initialize_table();
+  }
+  for (size_t i = 0; i < len; i++) {
+    crc = _table[(crc ^ (juint)(jubyte)p[i]) & 0xFF] ^ (crc >> 8);
+  }
+  return ~crc;
+}
@@ -0,0 +1,26 @@
+/**
+ * CRC32C of the Semeru heap pages, computed by the memory servers and verified by the CPU server.
+ *
+ */
+
+#ifndef SHARE_GC_SHARED_RDMACHECKSUM_HPP
+#define SHARE_GC_SHARED_RDMACHECKSUM_HPP
+
+#include "memory/allocation.hpp"
+#include "utilities/globalDefinitions.hpp"
+
+/**
+ * The same CRC32C, Castagnoli, as java.util.zip.CRC32C on both servers.
+ * The intrinsic stub of CRC32C is used when it's generated, SSE4.2 crc32 on x86, a table otherwise.
+ */
+class SemeruCRC32C : AllStatic {
+  static juint _table[256];
+  static volatile bool _table_initialized;
+
+  static void initialize_table();
+
+public:
+  static juint compute(const void* buf, size_t len);
+};
+
+#endif // SHARE_GC_SHARED_RDMACHECKSUM_HPP
@@ -0,0 +1,134 @@
+/**
+ * Runtime layout of the RDMA meta space.
+ *
+ */
+
+#include "precompiled.hpp"
+#include "gc/shared/blockOffsetTable.hpp"
+#include "gc/shared/rdmaMetaLayout.hpp"
+#include "logging/log.hpp"
+#include "runtime/globals.hpp"
+#include "runtime/os.hpp"
+#include "utilities/align.hpp"
+#include "utilities/debug.hpp"
+#include "utilities/ostream.hpp"
+
+
+bool   SemeruMetaLayout::_initialized                       = false;
+size_t SemeruMetaLayout::_heap_size                         = 0;
+size_t SemeruMetaLayout::_region_size                       = 0;
+uint   SemeruMetaLayout::_mem_server_num                    = 0;
+size_t SemeruMetaLayout::_block_offset_table_size           = 0;
+size_t SemeruMetaLayout::_cross_region_ref_target_q_offset  = 0;
+size_t SemeruMetaLayout::_cross_region_ref_target_q_len     = 0;
+size_t SemeruMetaLayout::_cross_region_ref_target_q_size    = 0;
+size_t SemeruMetaLayout::_wire_buffer_offset                = 0;
+size_t SemeruMetaLayout::_task_queue_chunk_offset           = 0;
+size_t SemeruMetaLayout::_used_size                         = 0;
+
+
+/**
+ * Compute the runtime part of the meta space.
+ *
+ * 1) The Semeru heap is the whole data space, mapped by every memory server.
+ * 2) Check the fixed part can hold the Regions.
+ *    The per-Region zones bump one page per Region, and the allocator asserts strictly below the limit.
+ * 3) BOT, the Cross-Region reference target queues, the wire buffers, then the task queue chunks.
+ *    An extra page for the queues, the same reason as 2).
+ *    Keep the last page of the meta space for the compressed oops no-access prefix.
+ */
+void SemeruMetaLayout::initialize(size_t region_size, uint mem_server_num) {
+  assert(!_initialized, "%s, initialize the RDMA meta layout only once.", __func__);
+
+  // 1) the Semeru heap
+  _heap_size      = (size_t)RDMA_DATA_REGION_NUM * REGION_SIZE_GB * ONE_GB;
+  _region_size    = region_size;
+  _mem_server_num = mem_server_num;
+  guarantee(region_size > 0 && _heap_size % region_size == 0,
+            "The Semeru heap 0x%lx is not aligned to the Region size 0x%lx.", _heap_size, region_size);
+
+  size_t regions = _heap_size / region_size;
+
+  // 2) the fixed part, sized for SEMERU_MAX_REGIONS
+  guarantee(regions < HEAP_REGION_MANAGER_SIZE_LIMIT / PAGE_SIZE,
+            "%lu Regions exceed the per-Region meta zones, 0x%lx bytes each. Use a larger Region size.",
+            regions, (size_t)HEAP_REGION_MANAGER_SIZE_LIMIT);
+  guarantee(regions <= FLAGS_OF_CPU_WRITE_CHECK_SIZE_LIMIT / sizeof(uint32_t),
+            "%lu Regions exceed the write check flags, 0x%lx bytes.", regions, (size_t)FLAGS_OF_CPU_WRITE_CHECK_SIZE_LIMIT);
+  guarantee(regions <= LIVENESS_EPOCH_SIZE_LIMIT / sizeof(uint32_t),
+            "%lu Regions exceed the liveness epochs, 0x%lx bytes.", regions, (size_t)LIVENESS_EPOCH_SIZE_LIMIT);
+  guarantee(regions <= MEMORY_SERVER_CSET_OVERFLOW_PAGES * PAGE_SIZE / sizeof(uint),
+            "%lu Regions exceed the memory server CSet, %lu overflow pages.", regions, (size_t)MEMORY_SERVER_CSET_OVERFLOW_PAGES);
+  guarantee(regions <= SEMERU_MAX_COMPACTED_REGION_SLOTS,
+            "%lu Regions exceed the compacted Region ring, %lu slots.", regions, (size_t)SEMERU_MAX_COMPACTED_REGION_SLOTS);
+  guarantee(regions <= CLD_LIVENESS_SIZE_LIMIT / (SEMERU_CLD_BITMAP_WORDS * sizeof(uint64_t)),
+            "%lu Regions exceed the class loader liveness, 0x%lx bytes.", regions, (size_t)CLD_LIVENESS_SIZE_LIMIT);
+  guarantee(regions <= REMSET_STASH_SIZE_LIMIT / PAGE_SIZE,
+            "%lu Regions exceed the remembered set stash, 0x%lx bytes.", regions, (size_t)REMSET_STASH_SIZE_LIMIT);
+  guarantee(_heap_size / BitsPerByte / HeapWordSize <= ALIVE_BITMAP_SIZE,
+            "The alive bitmap of the Semeru heap 0x%lx exceeds 0x%lx.", _heap_size, (size_t)ALIVE_BITMAP_SIZE);
+
+  // 3) the runtime part
+  _block_offset_table_size          = align_up(_heap_size >> BOTConstants::LogN, os::vm_allocation_granularity());
+  _cross_region_ref_target_q_offset = BLOCK_OFFSET_TABLE_OFFSET + _block_offset_table_size;
+  _cross_region_ref_target_q_len    = region_size / HeapWordSize / BitsPerWord;   // 1 bit per HeapWord
+  _initialized = true;
+
+  _cross_region_ref_target_q_size   = regions * cross_region_ref_target_q_commit_size() + PAGE_SIZE;
+  _wire_buffer_offset               = _cross_region_ref_target_q_offset + _cross_region_ref_target_q_size;
+  _task_queue_chunk_offset          = _wire_buffer_offset + (size_t)mem_server_num * SEMERU_WIRE_BUFFER_SIZE;
+  _used_size                        = _task_queue_chunk_offset + (size_t)mem_server_num * SEMERU_TASK_QUEUE_CHUNK_ZONE_SIZE;
+  guarantee(_used_size <= RDMA_STRUCTURE_SPACE_SIZE - PAGE_SIZE,
+            "The RDMA meta space needs 0x%lx bytes, exceeds RDMA_STRUCTURE_SPACE_SIZE 0x%lx minus the narrow oop prefix page.",
+            _used_size, (size_t)RDMA_STRUCTURE_SPACE_SIZE);
+
+  log_info(semeru, alloc)("%s, RDMA meta space uses 0x%lx of 0x%lx bytes. BOT [0x%lx, 0x%lx), cross region ref target queue [0x%lx, 0x%lx)",
+                          __func__, _used_size, (size_t)RDMA_STRUCTURE_SPACE_SIZE,
+                          (size_t)(SEMERU_START_ADDR + BLOCK_OFFSET_TABLE_OFFSET),
+                          (size_t)(SEMERU_START_ADDR + _cross_region_ref_target_q_offset),
+                          (size_t)(SEMERU_START_ADDR + _cross_region_ref_target_q_offset),
+                          (size_t)(SEMERU_START_ADDR + _used_size));
+}
+
+
+// The same with CHeapRDMAObj::commit_size_for_queue(sizeof(BitQueue), len) , BitQueue is within 4K.
+size_t SemeruMetaLayout::cross_region_ref_target_q_commit_size() {
+  return align_up(PAGE_SIZE + cross_region_ref_target_q_len() * sizeof(size_t), os::vm_allocation_granularity());
+}
+
+
+void SemeruMetaLayout::fill_digest(struct semeru_meta_layout_digest* digest) {
+  assert(_initialized, "RDMA meta layout is not initialized.");
+
+  digest->magic          = SEMERU_META_LAYOUT_MAGIC;
+  digest->mem_server_num = (uint32_t)_mem_server_num;
+  digest->heap_size      = (uint64_t)_heap_size;
+  digest->region_size    = (uint64_t)_region_size;
+  digest->used_size      = (uint64_t)_used_size;
+  digest->use_compressed_oops = UseCompressedOops ? 1 : 0;
+  digest->obj_alignment  = (uint32_t)ObjectAlignmentInBytes;
+}
+
+bool SemeruMetaLayout::match_digest(const struct semeru_meta_layout_digest* digest) {
+  assert(_initialized, "RDMA meta layout is not initialized.");
+
+  if(digest->magic == SEMERU_META_LAYOUT_KERNEL_MAGIC){
+    return digest->mem_server_num == (uint32_t)_mem_server_num &&
+           digest->heap_size      == (uint64_t)_heap_size;
+  }
+
+  return digest->magic          == SEMERU_META_LAYOUT_MAGIC &&
+         digest->mem_server_num == (uint32_t)_mem_server_num &&
+         digest->heap_size      == (uint64_t)_heap_size &&
+         digest->region_size    == (uint64_t)_region_size &&
+         digest->used_size      == (uint64_t)_used_size &&
+         digest->use_compressed_oops == (UseCompressedOops ? 1u : 0u) &&
+         digest->obj_alignment  == (uint32_t)ObjectAlignmentInBytes;
+}
+
+
+void SemeruMetaLayout::print_on(outputStream* st) {
+  st->print_cr("RDMA meta layout: heap 0x%lx, Region 0x%lx, %u memory servers, used 0x%lx of 0x%lx, compressed oops %d, object alignment %d",
+               _heap_size, _region_size, _mem_server_num, _used_size, (size_t)RDMA_STRUCTURE_SPACE_SIZE,
+               UseCompressedOops ? 1 : 0, (int)ObjectAlignmentInBytes);
+}
@@ -4,69 +4,136 @@
  */
 
 #include "gc/shared/rdmaStructure.inline.hpp"   // why can't find this header by using shared/rdmaStructure.hpp
+#include "gc/shared/rdmaMetaLayout.hpp"
+#include "logging/log.hpp"
+#include "runtime/thread.hpp"
 
 
 
 
 
 //
-// Structure - TaskQueueRDMASuper
+// Structure - task_queue_chunk_zone
 //
 
-
-
-
-//
-// Structure - GenericTaskQueueRDMA
-//
-
-
-
-
-
-
-
-
-template<class E, CHeapAllocType Alloc_type, unsigned int N>
-int GenericTaskQueueRDMA<E, Alloc_type, N>::next_random_queue_id() {
-  return randomParkAndMiller(&_seed);  // defined in taskqueue.inlinel.hpp
+task_queue_chunk_zone* task_queue_chunk_zone::at(size_t mem_id) {
+  assert(mem_id < MAX_NUM_OF_MEMORY_SERVER, "%s, wrong memory server id %lu", __func__, mem_id);
+  return (task_queue_chunk_zone*)(SEMERU_START_ADDR + SemeruMetaLayout::task_queue_chunk_offset() +
+                                  mem_id * SEMERU_TASK_QUEUE_CHUNK_ZONE_SIZE);
 }
 
+// All the chunks are free. The directory is page aligned, the chunks behind it.
+task_queue_chunk_zone::task_queue_chunk_zone() :
+  _num_spilled(0),
+  _next_queue_id(0),
+  _lock(0) {
+  // A slot per chunk, solve for the number of chunks fitting the zone with their slots.
+  size_t chunks = (SEMERU_TASK_QUEUE_CHUNK_ZONE_SIZE - sizeof(task_queue_chunk_zone)) /
+                  (SEMERU_TASK_QUEUE_CHUNK_SIZE + sizeof(task_queue_chunk_slot));
+  size_t directory = align_up(sizeof(task_queue_chunk_zone) + chunks * sizeof(task_queue_chunk_slot), PAGE_SIZE);
+  chunks = (SEMERU_TASK_QUEUE_CHUNK_ZONE_SIZE - directory) / SEMERU_TASK_QUEUE_CHUNK_SIZE;
+
+  _num_chunks    = (uint32_t)chunks;
+  _chunks_offset = (uint32_t)directory;
+  _num_free      = _num_chunks;
+  memset((void*)_spills, 0, sizeof(_spills));
+
+  for (uint32_t i = 0; i < _num_chunks; i++) {
+    _slots[i]._queue = NoQueue;
+    _slots[i]._used  = 0;
+    _slots[i]._next  = i + 1 < _num_chunks ? i + 1 : NoChunk;
+  }
+  _free = _num_chunks > 0 ? 0 : NoChunk;
+
+  log_debug(semeru, alloc)("%s, 0x%x chunks of 0x%lx bytes behind the directory of 0x%x bytes, at 0x%lx", __func__,
+                           _num_chunks, (size_t)SEMERU_TASK_QUEUE_CHUNK_SIZE, _chunks_offset, (size_t)this);
+}
 
+void task_queue_chunk_zone::lock(volatile int* l) {
+  Thread::SpinAcquire(l, "Semeru task queue chunks");
+}
 
+void task_queue_chunk_zone::unlock(volatile int* l) {
+  Thread::SpinRelease(l);
+}
 
+uint32_t task_queue_chunk_zone::allocate(uint32_t queue) {
+  lock(&_lock);
+  if (_free == NoChunk) {
+    // Spill a block of C-heap chunks, published before their indexes are handed out.
+    uint32_t block = _num_spilled / SpillChunks;
+    guarantee(block < MaxSpills, "%s, the task queue chunks are exhausted, 0x%x in the zone and 0x%x in the C-heap.",
+              __func__, _num_chunks, _num_spilled);
+    Spill* spill = NEW_C_HEAP_OBJ(Spill, mtGC);
+    spill->_chunks = NEW_C_HEAP_ARRAY(char, (size_t)SpillChunks * SEMERU_TASK_QUEUE_CHUNK_SIZE, mtGC);
+    for (uint32_t i = 0; i < SpillChunks; i++) {
+      spill->_slots[i]._queue = NoQueue;
+      spill->_slots[i]._used  = 0;
+      spill->_slots[i]._next  = i + 1 < SpillChunks ? _num_chunks + _num_spilled + i + 1 : NoChunk;
+    }
+    OrderAccess::release_store(&_spills[block], spill);
+    _free = _num_chunks + _num_spilled;
+    _num_free += SpillChunks;
+    _num_spilled += SpillChunks;
+    log_info(semeru, alloc)("%s, the task queue chunk zone is full, 0x%x chunks spilled into the C-heap.", __func__, _num_spilled);
+  }
+  uint32_t c = _free;
+  _free = slot(c)->_next;
+  _num_free--;
+  unlock(&_lock);
+
+  slot(c)->_queue = queue;
+  slot(c)->_used  = 0;
+  slot(c)->_next  = NoChunk;
+  return c;
+}
 
+void task_queue_chunk_zone::release(uint32_t c) {
+  slot(c)->_queue = NoQueue;
+  slot(c)->_used  = 0;
 
-
-
-//
-// OverflowTargetObjQueue
-//
-
-
-
-
-
-
-
+  lock(&_lock);
+  slot(c)->_next = _free;
+  _free = c;
+  _num_free++;
+  unlock(&_lock);
+}
 
 
 
-// The size of the flexible array _region_cset[] is limited by global macro, utilities/globalDefinitions.hpp :
-//	#define MEMORY_SERVER_CSET_OFFSET     (size_t)0x8000000   // +128MB
-//	#define MEMORY_SERVER_CSET_SIZE       (size_t)0x1000      // 4KB 
+// The header page, MEMORY_SERVER_CSET_HEADER_SIZE. The overflow pages behind it are written by the CPU server.
 received_memory_server_cset::received_memory_server_cset(){
+	STATIC_ASSERT(sizeof(received_memory_server_cset) <= MEMORY_SERVER_CSET_HEADER_SIZE);
 
 	reset(); // reset all the fields.
-
+	for(int i = 0; i < MAX_NUM_OF_MEMORY_SERVER; i++){
+		_slots[i]._seq = 0;
+	}
 }
 
 
 
 flags_of_cpu_server_state::flags_of_cpu_server_state():
 _is_cpu_server_in_stw(false),
-_cpu_server_data_sent(false)
+_cpu_server_data_sent(false),
+_state_seq(0),
+_stw_budget_us(0),
+_num_granted_regions(0),
+_region_state_atomics(false),
+_remote_ref_processing(false),
+_soft_ref_clock(0),
+_soft_ref_max_interval(0),
+_remote_string_dedup(false),
+_string_klass(NULL),
+_byte_array_klass(NULL),
+_checksum_sample_percent(0)
 {
+	STATIC_ASSERT(sizeof(flags_of_cpu_server_state) <= FLAGS_OF_CPU_SERVER_STATE_SIZE);
+	for (int i = 0; i < MAX_NUM_OF_MEMORY_SERVER; i++) {
+		_pending_ref_chains_acked_epoch[i] = 0;
+		_pending_ref_chains_acked[i] = 0;
+	}
+
 	
 	// debug
 	#ifdef ASSERT
@@ -80,8 +147,14 @@ _cpu_server_data_sent(false)
 flags_of_mem_server_state::flags_of_mem_server_state():
 _mem_server_wait_on_data_exchange(false),
 _is_mem_server_in_compact(false),
-_compacted_region_length(0)
+_state_seq(0),
+_reserved_pending_ref_chains(0),
+_pending_ref_chains_epoch(0),
+_num_pending_ref_chains(0),
+_timeline_window(0),
+_num_timeline_events(0)
 {
+	STATIC_ASSERT(sizeof(flags_of_mem_server_state) <= FLAGS_OF_MEM_SERVER_STATE_SIZE);
 	
 	// debug
 	#ifdef ASSERT
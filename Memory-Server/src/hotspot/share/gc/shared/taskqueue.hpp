@@ -452,6 +452,10 @@ public:
   virtual bool peek() = 0;
   // Tasks in queue
   virtual uint tasks() const = 0;
+
+  // Semeru, the queues peeked one by one.
+  virtual uint size() const = 0;
+  virtual uint tasks_in(uint i) const = 0;
 };
 
 template <MEMFLAGS F> class TaskQueueSetSuperImpl: public CHeapObj<F>, public TaskQueueSetSuper {
@@ -482,6 +486,7 @@ public:
 
   bool peek();
   uint tasks() const;
+  uint tasks_in(uint i) const { return _queues[i]->size(); }
 
   uint size() const { return _n; }
 };
@@ -578,10 +583,14 @@ public:
   virtual bool offer_termination(TerminatorTerminator* terminator);
 
   // Semeru
-  virtual bool offer_semeru_compact_termination(TerminatorTerminator* terminator){
+  virtual bool offer_semeru_compact_termination(TerminatorTerminator* terminator, uint worker_id, double deadline){
     ShouldNotReachHere();
     return false;
   }
+  // Semeru, the marking workers. Only the OWSTTaskTerminator peeks by the NUMA node.
+  virtual bool offer_semeru_termination(TerminatorTerminator* terminator, uint worker_id){
+    return offer_termination(terminator);
+  }
 
   // Reset the terminator, so that it may be reused again.
   // The caller is responsible for ensuring that this is done
@@ -722,8 +731,4 @@ typedef OverflowTaskQueue<size_t, mtGC>             RegionTaskQueue;
 typedef GenericTaskQueueSet<RegionTaskQueue, mtGC>  RegionTaskQueueSet;
 
 
-typedef OverflowTaskQueue<StarTask, mtGC, TASKQUEUE_SIZE>  SemeruCompactTaskQueue;
-typedef GenericTaskQueueSet<SemeruCompactTaskQueue, mtGC>  SemeruCompactTaskQueueSet;
-
-
 #endif // SHARE_VM_GC_SHARED_TASKQUEUE_HPP
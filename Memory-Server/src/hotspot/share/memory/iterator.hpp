@@ -27,6 +27,7 @@
 
 #include "memory/allocation.hpp"
 #include "memory/memRegion.hpp"
+#include "metaprogramming/integralConstant.hpp"
 #include "oops/oopsHierarchy.hpp"
 
 class CodeBlob;
@@ -365,6 +366,12 @@ class SymbolClosure : public StackObj {
   }
 };
 
+// Semeru MS - The closures visiting each field together with the object holding it,
+// through semeru_ms_do_oop(). Specialize to TrueType next to such a closure,
+// e.g. G1SemeruAdjustClosure. Resolved per OopClosureType at compile time.
+template <typename OopClosureType>
+struct SemeruMSFieldClosure : public FalseType {};
+
 // Dispatches to the non-virtual functions if OopClosureType has
 // a concrete implementation, otherwise a virtual call is taken.
 class Devirtualizer {
@@ -379,6 +386,8 @@ class Devirtualizer {
   // Pass the object information to the oop iterate function
   template <typename OopClosureType, typename T> static void semeru_ms_do_oop(oop obj, OopClosureType* closure, T* p);
   template <typename OopClosureType, typename T> static void semeru_ms_do_oop_no_verify(oop obj, OopClosureType* closure, T* p);
+  // The field p of obj, semeru_ms_do_oop() for a SemeruMSFieldClosure, do_oop() otherwise.
+  template <typename OopClosureType, typename T> static void semeru_do_field(oop obj, OopClosureType* closure, T* p);
 
 };
 
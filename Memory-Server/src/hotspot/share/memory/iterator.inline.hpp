@@ -158,11 +158,17 @@ inline void Devirtualizer::do_oop(OopClosureType* closure, T* p) {
  * 	void (Base::*)(T, T*)				// the base class function pointer, a pure virtual function.
  * 
  */
+template <typename T, typename Receiver, typename Base, typename OopClosureType>
+static typename EnableIf<IsSame<Receiver, Base>::value, void>::type
+call_do_oop(void (Receiver::*)(oop, T*), void (Base::*)(oop, T*), OopClosureType* closure, oop obj, T* p ) {
+	closure->semeru_ms_do_oop(obj, p);
+}
+
 template <typename T, typename Receiver, typename Base, typename OopClosureType>
 static typename EnableIf<!IsSame<Receiver, Base>::value, void>::type
 call_do_oop(void (Receiver::*)(oop, T*), void (Base::*)(oop, T*), OopClosureType* closure, oop obj, T* p ) {
 	// Sanity check
-//	STATIC_ASSERT((!IsSame<OopClosureType, OopIterateClosure>::value));  // [?] What's the purpose this check ??
+	STATIC_ASSERT((!IsSame<OopClosureType, OopIterateClosure>::value));
 	closure->OopClosureType::semeru_ms_do_oop(obj, p);
 }
 
@@ -186,6 +192,19 @@ inline void Devirtualizer::semeru_ms_do_oop(oop obj, OopClosureType* closure, T*
 
 }
 
+/**
+ * The field visit of the oop_oop_iterate family.
+ *  The branch is a constant of OopClosureType, each instantiation keeps only one of the inlined calls.
+ */
+template <typename OopClosureType, typename T>
+inline void Devirtualizer::semeru_do_field(oop obj, OopClosureType* closure, T* p) {
+	if (SemeruMSFieldClosure<OopClosureType>::value) {
+		semeru_ms_do_oop(obj, closure, p);
+	} else {
+		do_oop(closure, p);
+	}
+}
+
 
 // End of Semeru
 // 
@@ -85,7 +85,7 @@ class VirtualSpaceNode : public CHeapObj<mtClass> {
  public:
 
   // Semeru 
-  static char* VirtualSpaceNode_alloc_ptr;  // We want to know its global index.
+  static size_t VirtualSpaceNode_alloc_offset;  // the next free offset in the Semeru meta space, of any address window.
 
   //
   // Functions
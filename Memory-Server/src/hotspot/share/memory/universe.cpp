@@ -970,8 +970,11 @@ ReservedSpace Universe::reserve_semeru_memory_pool(size_t heap_size, size_t alig
 				 alignment, SemeruMemPoolMaxSize );
 
 	size_t total_reserved = align_up(heap_size, alignment);
-	assert(!UseCompressedOops || (total_reserved <= (OopEncodingHeapMax - os::vm_page_size())),
-			"heap size is too big for compressed oops");
+	// The Semeru heap, behind the RDMA meta space, is encoded with the CPU server's base, SEMERU_NARROW_OOP_BASE.
+	// The Universe narrow oop base still belongs to the memory server's own Java heap,
+	// see gc/g1/g1SemeruCompressedOops.inline.hpp.
+	guarantee(!UseCompressedOops || (total_reserved - RDMA_STRUCTURE_SPACE_SIZE <= (OopEncodingHeapMax - os::vm_page_size())),
+			"Semeru heap size 0x%lx is too big for compressed oops", total_reserved - RDMA_STRUCTURE_SPACE_SIZE);
 
 	bool use_large_pages = UseLargePages && is_aligned(alignment, os::large_page_size());
 	assert(!UseLargePages
@@ -34,6 +34,7 @@
 
 // Semeru - headers
 #include "runtime/rdma_comm.hpp"
+#include "gc/shared/rdmaMetaLayout.hpp"
 
 // ReservedSpace
 
@@ -323,7 +324,7 @@ void ReservedSpace::initialize_semeru(size_t size, size_t alignment, bool large,
     old_size = size;
 		old_alignment = alignment;
 
-    size = (size_t)BLOCK_OFFSET_TABLE_OFFSET_SIZE_LIMIT;
+    size = SemeruMetaLayout::block_offset_table_size();
     alignment = (size_t)PAGE_SIZE;
   }
 
@@ -469,9 +470,23 @@ void ReservedSpace::initialize_semeru(size_t size, size_t alignment, bool large,
 
 		char* commit_start = (char*)(base + RDMA_STRUCTURE_SPACE_SIZE );
 		size_t commit_size = (size_t)(RDMA_DATA_REGION_NUM * REGION_SIZE_GB * ONE_GB);
-		// Commit the whole JVM  memory range
-		log_debug(semeru,alloc)("%s, Commit the whole DATA Regions [0x%lx, 0x%lx) immediately \n", __func__, (size_t)commit_start, (size_t)(commit_start +commit_size) );
-		os::commit_memory_or_exit(commit_start, commit_size, PAGE_SIZE, false, "Debug DATA Regions");
+		if (SemeruMemPoolFile != NULL) {
+			// The shared mapping of the file is committed already. An anonymous commit would drop its content,
+			// so the heap of the data Regions is never committed nor uncommitted again.
+			if (!semeru_map_mem_pool_file(commit_start, commit_size)) {
+				vm_exit_during_initialization(err_msg("Could not map the Semeru memory pool to %s", SemeruMemPoolFile));
+			}
+			_special = true;
+		} else if (UseLargePages && os::semeru_commit_large_pages(commit_start, commit_size)) {
+			// Pinned by the RDMA registration anyway. An uncommit would bring back the small pages.
+			log_info(semeru,alloc)("%s, Commit the whole DATA Regions [0x%lx, 0x%lx) with large pages of 0x%lx bytes \n", __func__,
+			                       (size_t)commit_start, (size_t)(commit_start + commit_size), os::large_page_size());
+			_special = true;
+		} else {
+			// Commit the whole JVM  memory range
+			log_debug(semeru,alloc)("%s, Commit the whole DATA Regions [0x%lx, 0x%lx) immediately \n", __func__, (size_t)commit_start, (size_t)(commit_start +commit_size) );
+			os::commit_memory_or_exit(commit_start, commit_size, PAGE_SIZE, false, "Debug DATA Regions");
+		}
 	
 	// End of DEBUG
 	//
@@ -490,10 +505,11 @@ void ReservedSpace::initialize_semeru(size_t size, size_t alignment, bool large,
   	}
 
 		char* commit_start = (char*)(SEMERU_START_ADDR + BLOCK_OFFSET_TABLE_OFFSET);
-		size_t commit_size = (size_t)(BLOCK_OFFSET_TABLE_OFFSET_SIZE_LIMIT);
+		size_t commit_size = SemeruMetaLayout::block_offset_table_size();
 		// Commit the whole JVM  memory range
 		log_debug(semeru,alloc)("%s, Commit the whole BlockOffsetTable [0x%lx, 0x%lx) immediately \n", __func__, (size_t)commit_start, (size_t)(commit_start +commit_size) );
-		os::commit_memory_or_exit(commit_start, commit_size, PAGE_SIZE, false, "Debug Block Offset Table");
+		// Registered with the meta Region, THP backs it under -XX:+UseTransparentHugePages.
+		os::commit_memory_or_exit(commit_start, commit_size, os::large_page_size(), false, "Debug Block Offset Table");
 	
 	// End of DEBUG
 	//
@@ -69,33 +69,18 @@ inline void InstanceKlass::release_set_methods_jmethod_ids(jmethodID* jmeths) {
 /**
  * Semeru MS support
  * 
- * [?] How to modify the oop iteration, let Semeru MS G1SemeruAdjustClosure goes into semeru_ms_do_oop only ?
+ * The fields go to semeru_ms_do_oop() with obj for a SemeruMSFieldClosure, e.g. G1SemeruAdjustClosure,
+ * to do_oop() for the others. Chosen per OopClosureType at compile time, see Devirtualizer::semeru_do_field().
  * 
  */
-class G1SemeruAdjustClosure;
-
 template <typename T, class OopClosureType>
 ALWAYSINLINE void InstanceKlass::oop_oop_iterate_oop_map(OopMapBlock* map, oop obj, OopClosureType* closure) {
 	T* p         = (T*)obj->obj_field_addr_raw<T>(map->offset());
 	T* const end = p + map->count();
 
-	// Non-Semeru all fall into the Path#1.
-	// Semeru but not forwarded object alsp goes into Path#1.
-	//if(!SemeruEnableMemPool || !obj->is_forwarded()){
-	if(IsSame<OopClosureType, G1SemeruAdjustClosure>::value == false ){
-		// #1, the normal path
-		for (; p < end; ++p) {
-			Devirtualizer::do_oop(closure, p);
-		}
-	}else{
-		// #2, traver a forwardee object, go to the Semeru MS path.
-		// Pass the object information down to the oop iteration function.
-		for (; p < end; ++p) {
-			Devirtualizer::semeru_ms_do_oop(obj, closure, p);
-		}
+	for (; p < end; ++p) {
+		Devirtualizer::semeru_do_field(obj, closure, p);
 	}
-
-
 }
 
 
@@ -109,7 +94,7 @@ ALWAYSINLINE void InstanceKlass::oop_oop_iterate_oop_map_reverse(OopMapBlock* ma
 
 	while (start < p) {
 		--p;
-		Devirtualizer::do_oop(closure, p);
+		Devirtualizer::semeru_do_field(obj, closure, p);
 	}
 }
 
@@ -132,7 +117,7 @@ ALWAYSINLINE void InstanceKlass::oop_oop_iterate_oop_map_bounded(OopMapBlock* ma
 	}
 
 	for (;p < end; ++p) {
-		Devirtualizer::do_oop(closure, p);
+		Devirtualizer::semeru_do_field(obj, closure, p);
 	}
 }
 
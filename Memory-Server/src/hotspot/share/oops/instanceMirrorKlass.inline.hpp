@@ -38,21 +38,9 @@ void InstanceMirrorKlass::oop_oop_iterate_statics(oop obj, OopClosureType* closu
   T* p         = (T*)start_of_static_fields(obj);
   T* const end = p + java_lang_Class::static_oop_field_count_raw(obj);
 
-  	// Non-Semeru all fall into the Path#1.
-	// Semeru but not forwarded object alsp goes into Path#1.
-	//if(!SemeruEnableMemPool || !obj->is_forwarded()){
-  if(IsSame<OopClosureType, G1SemeruAdjustClosure>::value == false ){
-		// #1, the normal path
-    for (; p < end; ++p) {
-      Devirtualizer::do_oop(closure, p);
-    }
-  }else{
-    // #2, traver a forwardee object, go to the Semeru MS path.
-		// Pass the object information down to the oop iteration function.
-		for (; p < end; ++p) {
-			Devirtualizer::semeru_ms_do_oop(obj, closure, p);
-		}
-  }// end of else
+  for (; p < end; ++p) {
+    Devirtualizer::semeru_do_field(obj, closure, p);
+  }
 }
 
 template <typename T, class OopClosureType>
@@ -118,7 +106,7 @@ void InstanceMirrorKlass::oop_oop_iterate_statics_bounded(oop obj,
   }
 
   for (;p < end; ++p) {
-    Devirtualizer::do_oop(closure, p);
+    Devirtualizer::semeru_do_field(obj, closure, p);
   }
 }
 
@@ -1658,6 +1658,14 @@ void Arguments::set_use_compressed_klass_ptrs() {
       warning("UseCompressedClassPointers requires UseCompressedOops");
     }
     FLAG_SET_DEFAULT(UseCompressedClassPointers, false);
+  } else if (SemeruEnableMemPool) {
+    // Semeru - the memory servers read the Klass pointers of the object headers directly,
+    // and they don't share the compressed class space of the CPU server.
+    // Only the oops are compressed, with the fixed base SEMERU_NARROW_OOP_BASE.
+    if (UseCompressedClassPointers && !FLAG_IS_DEFAULT(UseCompressedClassPointers)) {
+      warning("UseCompressedClassPointers is not supported by SemeruEnableMemPool");
+    }
+    FLAG_SET_DEFAULT(UseCompressedClassPointers, false);
   } else {
     // Turn on UseCompressedClassPointers too
     if (FLAG_IS_DEFAULT(UseCompressedClassPointers)) {
@@ -3141,6 +3149,15 @@ jint Arguments::finalize_vm_init_args(bool patch_mod_javabase) {
     set_mode_flags(_int);
   }
 
+  // Semeru MS - the memory server only runs the GC threads and the RDMA daemon,
+  // its main method just waits. Nothing is worth a compiler thread or a code cache of nmethods.
+  if (SemeruHeadless) {
+    set_mode_flags(_int);
+    if (FLAG_IS_DEFAULT(UsePerfData)) {
+      FLAG_SET_DEFAULT(UsePerfData, false);
+    }
+  }
+
   // eventually fix up InitialTenuringThreshold if only MaxTenuringThreshold is set
   if (FLAG_IS_DEFAULT(InitialTenuringThreshold) && (InitialTenuringThreshold > MaxTenuringThreshold)) {
     FLAG_SET_ERGO(uintx, InitialTenuringThreshold, MaxTenuringThreshold);
@@ -3938,6 +3955,9 @@ jint Arguments::parse(const JavaVMInitArgs* initial_cmd_args) {
 }
 
 jint Arguments::apply_ergo() {
+  // Semeru - the meta and data space of this JVM, before anything is placed in them.
+  semeru_start_addr = SEMERU_BASE_START_ADDR + (size_t)SemeruAddressWindow * SEMERU_ADDRESS_WINDOW_SIZE;
+
   // Set flags based on ergonomics.
   jint result = set_ergonomics_flags();
   if (result != JNI_OK) return result;
@@ -1745,6 +1745,14 @@ char* os::attempt_reserve_memory_at(size_t bytes, char* addr, int file_desc) {
   return result;
 }
 
+bool os::semeru_commit_large_pages(char* addr, size_t bytes) {
+  bool res = semeru_pd_commit_large_pages(addr, bytes);
+  if (res) {
+    MemTracker::record_virtual_memory_commit((address)addr, bytes, CALLER_PC);
+  }
+  return res;
+}
+
 
 
 
@@ -166,6 +166,7 @@ class os: AllStatic {
   // Semeru
   //
   static char* semeru_pd_attempt_reserve_memory_at(size_t bytes, char* requested_addr, size_t alignment);
+  static bool  semeru_pd_commit_large_pages(char* addr, size_t bytes);
 
 
  public:
@@ -372,6 +373,9 @@ class os: AllStatic {
   // file_desc : if != -1, the heap is file backed.
   static char*  semeru_attempt_reserve_memory_at(size_t bytes, char* addr, size_t alignment, int file_desc = -1 );
 
+  // Commit the reserved range with large pages, -XX:+UseLargePages. false if no large page is available.
+  static bool   semeru_commit_large_pages(char* addr, size_t bytes);
+
 
 
 
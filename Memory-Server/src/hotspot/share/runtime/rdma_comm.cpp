@@ -1,4 +1,20 @@
 #include "rdma_comm.hpp"
+#include "gc/g1/g1SemeruColdStore.hpp"
+#include "gc/shared/rdmaMetaLayout.hpp"
+#include "runtime/atomic.hpp"
+#include "runtime/globals.hpp"
+#include "runtime/orderAccess.hpp"
+#include "runtime/os.hpp"
+#include "utilities/align.hpp"
+#include "utilities/count_trailing_zeros.hpp"
+
+#include <fcntl.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
 
 
 
@@ -6,6 +22,22 @@
 // Define global variables
 struct context *global_rdma_ctx = NULL;					// The RDMA controll context.
 int rdma_queue_count = 0;
+
+// The doorbell rung by the CPU server, updated by the poll_cq thread.
+static volatile uint32_t cpu_server_doorbell_seq = 0;
+static volatile jlong    cpu_server_doorbell_ns  = 0;   // os::javaTimeNanos() at its arrival, -XX:+SemeruTimeline
+static pthread_mutex_t   cpu_server_doorbell_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t    cpu_server_doorbell_cond = PTHREAD_COND_INITIALIZER;
+
+// The RDMA meta layout carried by the pending connect request.
+// The private data is freed by rdma_ack_cm_event, copy it before.
+// IB pads the private data with zero, check the magic.
+static struct semeru_meta_layout_digest connect_request_layout;
+static bool connect_request_has_layout = false;
+
+// -XX:SemeruMemPoolFile, the data Regions are a shared mapping of the file.
+static int  mem_pool_file_fd = -1;
+static bool mem_pool_file_kept = false;   // the content was left by the previous memory server process.
 //struct rdma_mem_pool* global_mem_pool = NULL;
 
 //
@@ -23,7 +55,7 @@ int rdma_queue_count = 0;
  * 2) Pass down the heap information to RDMA module and register them as RDMA buffer.
  * 
  * 3) Create a daemon thread to run this Main function, handle the CM evetn.
- * 		Then this thread will create another one daemon thread, poll_cq to handle the RDMA evetn.
+ * 		Then this thread will create RDMA_CQ_POLLER_NUM daemon threads, poll_cq to handle the RDMA evetn.
  * 
  * 
  * Parameters
@@ -58,7 +90,7 @@ void* Build_rdma_to_cpu_server(void* _args ){
   memset(&addr, 0, sizeof(addr));  // not struct sockaddr_in6
   addr.sin6_family = AF_INET6;                    //[?] Ipv6 is cpmpatible with Ipv4.
   inet_pton(AF_INET6, ip_str, &addr.sin6_addr);		// Remote memory pool is waiting on 10.0.10.6:9400.
-  addr.sin6_port = htons(atoi(port_str));
+  addr.sin6_port = htons(atoi(port_str) + SemeruTenantID);   // the memory servers of several tenants share the machine
 
   guarantee((ec = rdma_create_event_channel()) != NULL, "rdma_create_event_channel failed.");
   guarantee(rdma_create_id(ec, &listener, NULL, RDMA_PS_TCP) == 0, "rdma_create_id failed.");
@@ -82,6 +114,9 @@ void* Build_rdma_to_cpu_server(void* _args ){
   global_rdma_ctx->connected = 0; // a global connect state.  enable in fucntion on_connection()
   global_rdma_ctx->server_state = S_WAIT;
 	init_memory_pool(heap_start, heap_size, global_rdma_ctx);
+  if(SemeruTCPTransport){
+    semeru_start_tcp_server(atoi(port_str) + SemeruTenantID + SEMERU_TCP_PORT_OFFSET);
+  }
 
   
   // poll the cm event explicitly
@@ -90,6 +125,15 @@ void* Build_rdma_to_cpu_server(void* _args ){
     struct rdma_cm_event event_copy;
 
     memcpy(&event_copy, event, sizeof(*event));   // [?] Can we handle the received event first, and the ack it ?
+    if(event->event == RDMA_CM_EVENT_CONNECT_REQUEST){
+      connect_request_has_layout = event->param.conn.private_data != NULL &&
+                                   event->param.conn.private_data_len >= sizeof(struct semeru_meta_layout_digest);
+      if(connect_request_has_layout){
+        memcpy(&connect_request_layout, event->param.conn.private_data, sizeof(struct semeru_meta_layout_digest));
+        connect_request_has_layout = (connect_request_layout.magic == SEMERU_META_LAYOUT_MAGIC ||
+                                      connect_request_layout.magic == SEMERU_META_LAYOUT_KERNEL_MAGIC);
+      }
+    }
     rdma_ack_cm_event(event);    		// [x] Free the even gotten by rdma_get_cm_event. Have to pair it with rdma_get_cm_event
 
     if (on_cm_event(&event_copy))   // [x] Further handler of the received event.
@@ -121,6 +165,12 @@ void* Build_rdma_to_cpu_server(void* _args ){
 void init_memory_pool(char* heap_start, size_t heap_size, struct context* rdma_ctx ){
 
 	int i;
+
+  // The CPU server splits the data Regions by the same topology.
+  guarantee(RDMA_DATA_REGION_NUM % SemeruMemServerNum == 0 && SemeruMemServerID < SemeruMemServerNum,
+            "%s, wrong topology, memory server[%u] of %u memory servers, " SIZE_FORMAT " data Regions.",
+            __func__, SemeruMemServerID, SemeruMemServerNum, (size_t)RDMA_DATA_REGION_NUM);
+
 	rdma_ctx->mem_pool = (struct rdma_mem_pool* )calloc(1, sizeof(struct rdma_mem_pool));
 
 	#ifdef DEBUG_RDMA_SERVER
@@ -139,13 +189,18 @@ void init_memory_pool(char* heap_start, size_t heap_size, struct context* rdma_c
 	// Initialize the status of Region 
 	// Divide the heap into multiple Regions.
 	rdma_ctx->mem_pool->region_num = heap_size/ONE_GB/REGION_SIZE_GB;
+  if(rdma_ctx->mem_pool->region_num < (int)(RDMA_META_REGION_NUM + RDMA_DATA_REGION_NUM)){
+    // The CPU server places a data Region at its own index, on any memory server.
+    log_warning(semeru,rdma)("%s, %d Regions don't cover the " SIZE_FORMAT " data Regions, the rest are unavailable to the CPU server.",
+                             __func__, rdma_ctx->mem_pool->region_num, (size_t)RDMA_DATA_REGION_NUM);
+  }
 
   // The fist part is used for RDMA meta data transfering.
   // Its reserved size is REGION_SIZE_GB aligned.
   // BUT it may not commit all its size. 
   // Only commited size can be registered as RDMA buffer.
   rdma_ctx->mem_pool->region_list[0]  = heap_start;
-  rdma_ctx->mem_pool->region_mapped_size[0]  = (size_t)(END_OF_RDMA_COMMIT_ADDR - SEMERU_START_ADDR); // not fully used Region.
+  rdma_ctx->mem_pool->region_mapped_size[0]  = SemeruMetaLayout::used_size(); // not fully used Region.
   // debug
   //rdma_ctx->mem_pool->region_mapped_size[0]  = 4096;  // count at bytes
   rdma_ctx->mem_pool->cache_status[0] = -1;
@@ -242,12 +297,30 @@ int on_cm_event(struct rdma_cm_event *event){
  * 
  * rdma_cm_id : is listening on the Ip of the IB.
  * 
+ * The JVM of the CPU server sends the digest of its RDMA meta layout.
+ * Reject it if the layout is different, both sides would access the meta space at different offsets.
+ * The kernel module doesn't carry the layout, accept it directly.
+ * 
  */
 int on_connect_request(struct rdma_cm_id *id)
 {
   struct rdma_conn_param cm_params;
   struct semeru_rdma_queue *rdma_queue;
 
+  if(connect_request_has_layout && !SemeruMetaLayout::match_digest(&connect_request_layout)){
+    tty->print("%s, reject the connection. CPU server RDMA meta layout : heap 0x%lx, Region 0x%lx, %u memory servers, used 0x%lx, compressed oops %u, object alignment %u. \n",
+                                                              __func__,
+                                                              (size_t)connect_request_layout.heap_size,
+                                                              (size_t)connect_request_layout.region_size,
+                                                              (unsigned)connect_request_layout.mem_server_num,
+                                                              (size_t)connect_request_layout.used_size,
+                                                              (unsigned)connect_request_layout.use_compressed_oops,
+                                                              (unsigned)connect_request_layout.obj_alignment);
+    SemeruMetaLayout::print_on(tty);
+    TEST_NZ(rdma_reject(id, NULL, 0));
+    return 0;
+  }
+
   rdma_queue = &(global_rdma_ctx->rdma_queues[rdma_queue_count++]);  // rdma_queue_count is a global counter
   rdma_queue->q_index = rdma_queue_count - 1;
   rdma_queue->cm_id = id;  // get the rdma_cm_id for this queue.
@@ -287,7 +360,7 @@ void build_connection(struct semeru_rdma_queue * rdma_queue){
   struct ibv_qp_init_attr qp_attr;
 
   // 1) build a listening daemon thread 
-  get_device_info(rdma_queue);  // create a daemon thread, poll_cq
+  get_device_info(rdma_queue);  // create the daemon threads, poll_cq, and the cq of this queue.
   build_qp_attr(rdma_queue, &qp_attr);   // Initialize qp_attr
 
   TEST_NZ(rdma_create_qp(rdma_queue->cm_id, global_rdma_ctx->rdma_dev->pd, &qp_attr));   // Build the QP.
@@ -306,11 +379,14 @@ void build_connection(struct semeru_rdma_queue * rdma_queue){
 
 
 /**
- * Build a daemon thread,poll_cq(void *ctx), to handle the 2-sided RDMA communication.
+ * Build the daemon threads, poll_cq(void *ctx), to handle the 2-sided RDMA communication.
  * The 2-sided RDMA message is used to build the connection with CPU server.
  * After this, CPU server uses 1-sided RDMA read/write to access the memory pool in current Memory server.	   
  * 
  * Create : pd, rdma_channel, cq here.
+ *    The pd, the completion channels and the pollers are created once.
+ *    Each rdma_queue has its own cq, bound to the channel of poller[q_index % RDMA_CQ_POLLER_NUM].
+ *    So the 2-sided messages of different QPs are not serialized behind one thread.
  * 
  * Parametsers :
  * 		ibv_context : rdma_cm_id->verbs, IB hardware descriptor.
@@ -318,7 +394,8 @@ void build_connection(struct semeru_rdma_queue * rdma_queue){
  */
 void get_device_info(struct semeru_rdma_queue * rdma_queue)  // rdma_cm_id->verbs
 {
-
+  int i;
+  struct semeru_cq_poller *poller;
 
   // For multiple QP, only need to initialize global_rdma_ctx->rdma_dev once.
   if(global_rdma_ctx->rdma_dev == NULL){
@@ -326,33 +403,45 @@ void get_device_info(struct semeru_rdma_queue * rdma_queue)  // rdma_cm_id->verb
     global_rdma_ctx->rdma_dev->ctx = rdma_queue->cm_id->verbs;    // Use the ibv_context of the first rdma_queue.
 
     TEST_Z(global_rdma_ctx->rdma_dev->pd = ibv_alloc_pd(rdma_queue->cm_id->verbs));   // global
-    TEST_Z(global_rdma_ctx->comp_channel = ibv_create_comp_channel(rdma_queue->cm_id->verbs));
 
+    // Pin the data Regions only when the HCA can't page fault.
+    global_rdma_ctx->mem_pool->odp_enabled = SemeruMemPoolODP && query_odp_support(global_rdma_ctx->rdma_dev);
+    tty->print("%s, data Regions are registered as %s RDMA buffer. \n", __func__,
+               global_rdma_ctx->mem_pool->odp_enabled ? "On-Demand-Paging" : "pinned");
+    global_rdma_ctx->mem_pool->atomic_glob = query_atomic_glob(global_rdma_ctx->rdma_dev);
 
-	  // Parameters of ibv_create_cq :
-	  //		struct ibv_context *context, 	// IB hardware context, 
-	  //		int cqe,  										// Number of Completion Queue Entries, then we can  poll WC from the cq. [?] We poll CQ one by one?
-	  //		void *cq_context, 						// NULL, 
-	  //		struct ibv_comp_channel *channel, 	
-	  //		int comp_vector								// 0,
-	  //
-    TEST_Z(rdma_queue->cq = ibv_create_cq(rdma_queue->cm_id->verbs, 10, NULL, global_rdma_ctx->comp_channel, 0)); /* cqe=10 is arbitrary */
-    TEST_NZ(ibv_req_notify_cq(rdma_queue->cq, 0));			// , solicited_only == 0, means give a notification for any WC.
+    // Before the first QP is built, all the QPs are attached to it.
+    if(SemeruRdmaSRQ && build_srq(global_rdma_ctx->rdma_dev) == false){
+      tty->print("%s, can't create the shared receive queue, receive per QP. \n", __func__);
+    }
 
-	  // Thread : global_rdma_ctx->cq_poller_thread,
+	  // Thread : global_rdma_ctx->cq_pollers[i].thread,
 	  // Thread attributes : NULL
 	  // Thread main routine : poll_cq(void *), 
-	  // Thread parametes : NULL
-	  //	[?] Works for ? the rdma_queue[0] ? 
+	  // Thread parametes : the poller, pinned to its core by itself.
 	  //
-    TEST_NZ(pthread_create(&global_rdma_ctx->cq_poller_thread, NULL, poll_cq, NULL));  // [?] Busy polling. 
-
-    // Got device info, e.g. pd, debice, we can register rdma buffer now.
-    register_rdma_comm_buffer(global_rdma_ctx);  // Reserve 2-sided RDMA message memory regions, recv/send.
-
+    for(i = 0; i < RDMA_CQ_POLLER_NUM; i++){
+      poller = &(global_rdma_ctx->cq_pollers[i]);
+      poller->index = i;
+      TEST_Z(poller->comp_channel = ibv_create_comp_channel(rdma_queue->cm_id->verbs));
+      TEST_NZ(pthread_create(&poller->thread, NULL, poll_cq, poller));
+    }
   }
 
- 
+	// Parameters of ibv_create_cq :
+	//		struct ibv_context *context, 	// IB hardware context, 
+	//		int cqe,  										// Number of Completion Queue Entries.
+	//		void *cq_context, 						// the rdma_queue, 
+	//		struct ibv_comp_channel *channel, 	
+	//		int comp_vector								// spread the pollers over the completion vectors.
+	//
+  rdma_queue->poller = &(global_rdma_ctx->cq_pollers[rdma_queue->q_index % RDMA_CQ_POLLER_NUM]);
+  TEST_Z(rdma_queue->cq = ibv_create_cq(rdma_queue->cm_id->verbs, RDMA_CQ_DEPTH, rdma_queue, rdma_queue->poller->comp_channel,
+                                        rdma_queue->poller->index % rdma_queue->cm_id->verbs->num_comp_vectors));
+  TEST_NZ(ibv_req_notify_cq(rdma_queue->cq, 0));			// , solicited_only == 0, means give a notification for any WC.
+
+  // Reserve 2-sided RDMA message memory regions, recv/send.
+  register_rdma_comm_buffer(rdma_queue);
 }
 
 
@@ -363,7 +452,7 @@ void build_qp_attr(struct semeru_rdma_queue * rdma_queue, struct ibv_qp_init_att
 {
   memset(qp_attr, 0, sizeof(*qp_attr));
 
-  qp_attr->send_cq = rdma_queue->cq;  // Only the first rdma_queue has a solid cq. Other are NULL.
+  qp_attr->send_cq = rdma_queue->cq;  // Each rdma_queue has its own cq.
   qp_attr->recv_cq = rdma_queue->cq;
   qp_attr->qp_type = IBV_QPT_RC;		// QP type, Reliable Communication.
 
@@ -371,28 +460,54 @@ void build_qp_attr(struct semeru_rdma_queue * rdma_queue, struct ibv_qp_init_att
   qp_attr->cap.max_recv_wr = 16;
   qp_attr->cap.max_send_sge = MAX_REQUEST_SGL;    // enable  the scatter/gather
   qp_attr->cap.max_recv_sge = MAX_REQUEST_SGL;
+
+  // The receive side of the QP is the SRQ, no recv queue is allocated per QP.
+  if(global_rdma_ctx->rdma_dev->srq != NULL){
+    qp_attr->srq = global_rdma_ctx->rdma_dev->srq;
+    qp_attr->cap.max_recv_wr = 0;
+    qp_attr->cap.max_recv_sge = 0;
+  }
 }
 
 
 /**
- * 	A deamon thread who is busy polling the CQ.
+ * 	A deamon thread polling the CQs bound to its completion channel.
  *  Handle the two-sided RDMA messages
  * 	
- * 	The paramter is NULL at present. 
+ * 	The paramter is the struct semeru_cq_poller.
+ *  Reap at most RDMA_CQ_POLL_BATCH WC per ibv_poll_cq.
  * 
  */
 void * poll_cq(void *ctx)
 {
+  struct semeru_cq_poller *poller = (struct semeru_cq_poller *)ctx;
   struct ibv_cq *cq;  // 2-sided, completion queue, retrieve receive_wr hre.
-  struct ibv_wc wc;		// 
+  void *cq_ctx;
+  struct ibv_wc wc[RDMA_CQ_POLL_BATCH];
+  cpu_set_t cpu_set;
+  long online_cores = sysconf(_SC_NPROCESSORS_ONLN);
+  int n;
+  int i;
+
+  // Pin the poller to its core. Not fatal, keep polling on any core.
+  CPU_ZERO(&cpu_set);
+  CPU_SET((RDMA_CQ_POLLER_FIRST_CORE + poller->index) % (online_cores > 0 ? online_cores : 1), &cpu_set);
+  if(pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) != 0){
+    log_debug(semeru,rdma)("%s, pin cq poller[%d] failed. \n", __func__, poller->index);
+  }
 
   while (1) {
-    TEST_NZ(ibv_get_cq_event(global_rdma_ctx->comp_channel, &cq, &ctx));
-    ibv_ack_cq_events(cq, 1);						// [?] work with mutex, heavy ? 
-    TEST_NZ(ibv_req_notify_cq(cq, 0));	// Should use global_rdma_ctx->cq ??
+    TEST_NZ(ibv_get_cq_event(poller->comp_channel, &cq, &cq_ctx));
+    ibv_ack_cq_events(cq, 1);
+    TEST_NZ(ibv_req_notify_cq(cq, 0));  // re-arm before polling, no WC is missed.
 
-    while (ibv_poll_cq(cq, 1, &wc))   // If here busily polls the CQ, no need to use the ibv_req_notify_cq ?
-      handle_cqe(&wc);
+    while ((n = ibv_poll_cq(cq, RDMA_CQ_POLL_BATCH, wc)) > 0){
+      for(i = 0; i < n; i++){
+        handle_cqe(&wc[i]);
+      }
+    }
+    if(n < 0)
+      die("poll_cq: ibv_poll_cq failed.");
   }
 
   return NULL;
@@ -403,28 +518,31 @@ void * poll_cq(void *ctx)
 
 
 /**
- * Build and register the 2-sided RDMA buffers.  
+ * Build and register the 2-sided RDMA buffers of a rdma_queue.  
  *  a. DMA buffer, user level.
- *      context->send_msg/recv_msg 
+ *      rdma_queue->send_msg/recv_msg 
  */
-void register_rdma_comm_buffer(struct context *rdma_session){
-  rdma_session->send_msg = (struct message *)calloc(1, sizeof(struct message));   // 2-sided RDMA messages
-  rdma_session->recv_msg = (struct message *)calloc(1, sizeof(struct message));
+void register_rdma_comm_buffer(struct semeru_rdma_queue *rdma_queue){
+  rdma_queue->send_msg = (struct message *)calloc(1, sizeof(struct message));   // 2-sided RDMA messages
+  rdma_queue->recv_msg = (struct message *)calloc(1, sizeof(struct message));
 
 	// [?] Is the the 1-sided RDMA buffer ?
-  TEST_Z(rdma_session->send_mr = ibv_reg_mr(
-    rdma_session->rdma_dev->pd, 						// protect domain 
-    rdma_session->send_msg, 			// start address
+  TEST_Z(rdma_queue->send_mr = ibv_reg_mr(
+    global_rdma_ctx->rdma_dev->pd, 						// protect domain 
+    rdma_queue->send_msg, 			// start address
     sizeof(struct message),   // Register the send_msg/recv_msg as 1-sided RDMA buffer.
     IBV_ACCESS_LOCAL_WRITE | IBV_ACCESS_REMOTE_READ));
 
-  TEST_Z(rdma_session->recv_mr = ibv_reg_mr(
-    rdma_session->rdma_dev->pd, 
-    rdma_session->recv_msg, 
-    sizeof(struct message),  
-    IBV_ACCESS_LOCAL_WRITE | IBV_ACCESS_REMOTE_READ));
+  // With the SRQ, the received message is copied into recv_msg, it's not a RDMA buffer.
+  if(global_rdma_ctx->rdma_dev->srq == NULL){
+    TEST_Z(rdma_queue->recv_mr = ibv_reg_mr(
+      global_rdma_ctx->rdma_dev->pd, 
+      rdma_queue->recv_msg, 
+      sizeof(struct message),  
+      IBV_ACCESS_LOCAL_WRITE | IBV_ACCESS_REMOTE_READ));
+  }
 
-  tty->print("%s, Reserve 2-sided rdma buffer done.\n", __func__);
+  tty->print("%s, rdma_queue[%d] Reserve 2-sided rdma buffer done.\n", __func__, rdma_queue->q_index);
 }
 
 /**
@@ -435,21 +553,105 @@ void post_receives(struct semeru_rdma_queue *rdma_queue){
 
   struct ibv_recv_wr wr, *bad_wr = NULL;
   struct ibv_sge sge;
-  struct context *rdma_session = rdma_queue->rdma_session;
+
+  // The SRQ slot is posted again by receive_from_srq().
+  if(global_rdma_ctx->rdma_dev->srq != NULL)
+    return;
 
   wr.wr_id    = (uintptr_t)rdma_queue;
   wr.next     = NULL;
   wr.sg_list  = &sge;
   wr.num_sge  = 1;					// [?] Why does the number of sge for each WR is always 1 ??
 
-  sge.addr    = (uintptr_t)rdma_session->recv_msg;   // Put a recv_wr to wait for 2-sided RDMA message.
+  sge.addr    = (uintptr_t)rdma_queue->recv_msg;   // Put a recv_wr to wait for 2-sided RDMA message.
   sge.length  = (uint32_t)sizeof(struct message);
-  sge.lkey    = rdma_session->recv_mr->lkey;         // For message receive, use the lkey of receive RDMA MR. 
+  sge.lkey    = rdma_queue->recv_mr->lkey;         // For message receive, use the lkey of receive RDMA MR. 
 
   TEST_NZ(ibv_post_recv(rdma_queue->qp, &wr, &bad_wr)); // post a recv wait for WR.
 }
 
 
+/**
+ * Build the shared receive queue, -XX:+SemeruRdmaSRQ.
+ *  Each QP kept a registered recv_msg and its own recv queue, the QP state grows with the cores of the CPU servers.
+ *  The QPs share RDMA_SRQ_DEPTH receive buffers instead, a message is copied to the recv_msg of its QP by the poller.
+ *  Return false if the HCA can't create it, then each QP receives by itself.
+ */
+bool build_srq(struct semeru_rdma_dev * rdma_dev){
+  struct ibv_srq_init_attr srq_attr;
+  int i;
+
+  memset(&srq_attr, 0, sizeof(srq_attr));
+  srq_attr.attr.max_wr  = RDMA_SRQ_DEPTH;
+  srq_attr.attr.max_sge = 1;
+
+  rdma_dev->srq = ibv_create_srq(rdma_dev->pd, &srq_attr);
+  if(rdma_dev->srq == NULL){
+    return false;
+  }
+
+  rdma_dev->srq_msgs = (struct message *)calloc(RDMA_SRQ_DEPTH, sizeof(struct message));
+  TEST_Z(rdma_dev->srq_mr = ibv_reg_mr(rdma_dev->pd, rdma_dev->srq_msgs, RDMA_SRQ_DEPTH * sizeof(struct message),
+                                      IBV_ACCESS_LOCAL_WRITE));
+
+  for(i = 0; i < RDMA_SRQ_DEPTH; i++){
+    post_srq_receive(rdma_dev, i);
+  }
+
+  tty->print("%s, %d recv wr shared by the QPs. \n", __func__, RDMA_SRQ_DEPTH);
+  return true;
+}
+
+/**
+ * Post the SRQ slot to receive the next message of any QP.
+ *  ibv_post_srq_recv is thread safe, the pollers post at the same time.
+ */
+void post_srq_receive(struct semeru_rdma_dev * rdma_dev, int slot){
+  struct ibv_recv_wr wr, *bad_wr = NULL;
+  struct ibv_sge sge;
+
+  wr.wr_id    = (uintptr_t)slot;
+  wr.next     = NULL;
+  wr.sg_list  = &sge;
+  wr.num_sge  = 1;
+
+  sge.addr    = (uintptr_t)&(rdma_dev->srq_msgs[slot]);
+  sge.length  = (uint32_t)sizeof(struct message);
+  sge.lkey    = rdma_dev->srq_mr->lkey;
+
+  TEST_NZ(ibv_post_srq_recv(rdma_dev->srq, &wr, &bad_wr));
+}
+
+/**
+ * A recv WC of the SRQ, the wr_id is the slot and the QP is found by its number.
+ *  The message is copied to the recv_msg of the QP, then the slot is posted again.
+ *  The WC of a QP are all handled by the poller of its CQ, the recv_msg is not overwritten meanwhile.
+ */
+struct semeru_rdma_queue* receive_from_srq(struct ibv_wc *wc){
+  struct semeru_rdma_dev *rdma_dev = global_rdma_ctx->rdma_dev;
+  struct semeru_rdma_queue *rdma_queue = NULL;
+  int slot = (int)wc->wr_id;
+  int i;
+
+  for(i = 0; i < RDMA_QUEUE_NUM; i++){
+    if(global_rdma_ctx->rdma_queues[i].qp != NULL && global_rdma_ctx->rdma_queues[i].qp->qp_num == wc->qp_num){
+      rdma_queue = &(global_rdma_ctx->rdma_queues[i]);
+      break;
+    }
+  }
+  if(rdma_queue == NULL)
+    die("receive_from_srq: a message of an unknown QP.");
+
+  // The doorbell carries no message.
+  if((wc->wc_flags & IBV_WC_WITH_IMM) == 0){
+    memcpy(rdma_queue->recv_msg, &(rdma_dev->srq_msgs[slot]), sizeof(struct message));
+  }
+  post_srq_receive(rdma_dev, slot);
+
+  return rdma_queue;
+}
+
+
 //
 // 1.2 Build the RDMA parameters 
 //
@@ -486,22 +688,42 @@ void build_params(struct rdma_conn_param *params)
  *  Is there any orders between  the CM_event and wr ?
  * 
  * Warning:
- *  Only rdma_queue[0] has an online CQ. 
- *  The CPU has to query all the information via the rdma_queue[0].
+ *  Each rdma_queue has its own CQ, the WC of different QPs are handled by different pollers at the same time.
+ *  Only touch the per-queue message buffers here.
  * 
  */
 void handle_cqe(struct ibv_wc *wc){
 
-  // wc->wr_id is a reserved viod* pointer for any self-attached context.
-  // context->recv_msg is the binded DMA buffer.
-  struct semeru_rdma_queue * rdma_queue = (struct semeru_rdma_queue *)(uintptr_t)wc->wr_id;
-  struct context *rdma_session = rdma_queue->rdma_session;
+  struct semeru_rdma_queue * rdma_queue;
+  struct context *rdma_session;
 
   if (wc->status != IBV_WC_SUCCESS)
     die("handle_cqe: status is not IBV_WC_SUCCESS.");
 
+  // wc->wr_id is a reserved viod* pointer for any self-attached context.
+  // context->recv_msg is the binded DMA buffer.
+  // With the SRQ, the wr_id of a recv WC is the slot of the shared buffers.
+  if (wc->opcode == IBV_WC_RECV && global_rdma_ctx->rdma_dev->srq != NULL){
+    rdma_queue = receive_from_srq(wc);
+  }else{
+    rdma_queue = (struct semeru_rdma_queue *)(uintptr_t)wc->wr_id;
+  }
+  rdma_session = rdma_queue->rdma_session;
+
   if (wc->opcode == IBV_WC_RECV){         // Recv
-    switch (rdma_session->recv_msg->type){    // Check the DMA buffer of recevei WR.
+    // The zero-byte doorbell of CPU server, no message in the recv_msg.
+    if(wc->wc_flags & IBV_WC_WITH_IMM){
+      pthread_mutex_lock(&cpu_server_doorbell_lock);
+      cpu_server_doorbell_ns  = os::javaTimeNanos();
+      cpu_server_doorbell_seq = ntohl(wc->imm_data);
+      pthread_cond_broadcast(&cpu_server_doorbell_cond);
+      pthread_mutex_unlock(&cpu_server_doorbell_lock);
+
+      post_receives(rdma_queue);
+      return;
+    }
+
+    switch (rdma_queue->recv_msg->type){    // Check the DMA buffer of recevei WR.
       case QUERY:
         tty->print("%s, QUERY \n", __func__);
         send_free_mem_size(rdma_queue);				// Inform cpu server the available memory size
@@ -511,10 +733,54 @@ void handle_cqe(struct ibv_wc *wc){
       case REQUEST_CHUNKS:          //client requests for multiple memory chunks from current server.
         tty->print("%s, REQUEST_CHUNKS, Send available Regions to CPU server \n", __func__);
         // Send all the available Regions to CPU
-        rdma_session->server_state = S_BIND;
+        set_cpu_server_bound(rdma_session);
 				send_regions(rdma_queue);
         // post a recv wr to wait for responds.
         post_receives(rdma_queue);
+        // and the recv wr for the doorbells after the connection is built.
+        if(rdma_queue == &(rdma_session->rdma_queues[RDMA_NOTIFY_QUEUE])){
+          for(int i = 0; i < RDMA_DOORBELL_RECV_NUM; i++){
+            post_receives(rdma_queue);
+          }
+        }
+        break;
+
+      case EXPAND_CHUNKS:           // CPU server commits more heap, register the marked Regions.
+        tty->print("%s, EXPAND_CHUNKS, %d Regions \n", __func__, rdma_queue->recv_msg->mapped_chunk);
+        expand_regions(rdma_queue);
+        post_receives(rdma_queue);
+        break;
+
+      case RELEASE_CHUNKS:          // CPU server uncommits the heap, give the marked Regions back.
+        tty->print("%s, RELEASE_CHUNKS, %d Regions \n", __func__, rdma_queue->recv_msg->mapped_chunk);
+        release_regions(rdma_queue);
+        post_receives(rdma_queue);
+        break;
+
+      case REATTACH:                // CPU server reconnects after this memory server restarted.
+        tty->print("%s, REATTACH, the data Regions are %s \n", __func__, semeru_mem_pool_kept() ? "kept" : "lost");
+        if(semeru_mem_pool_kept()){
+          send_free_mem_size(rdma_queue);   // the CPU server binds the same chunks again, by the new rkeys.
+        }else{
+          rdma_queue->send_msg->type = DONE;
+          send_message(rdma_queue);
+        }
+        post_receives(rdma_queue);
+        break;
+
+      case INVALIDATE_PAGES:        // CPU server freed the swap slots, the pages are dead.
+        invalidate_pages(rdma_queue);
+        post_receives(rdma_queue);
+        break;
+
+      case COLD_BLOCKS:             // CPU server stopped accessing the marked blocks.
+        cold_blocks(rdma_queue);
+        post_receives(rdma_queue);
+        break;
+
+      case FETCH_BLOCK:             // CPU server accesses a cold block again.
+        fetch_block(rdma_queue);
+        post_receives(rdma_queue);
         break;
 
       case REQUEST_SINGLE_CHUNK:    // client requests for single memory chunk from this server. Usually used for debuging.
@@ -525,7 +791,7 @@ void handle_cqe(struct ibv_wc *wc){
         break;
 
       default:
-        tty->print("Recived error message type : %d \n",rdma_session->recv_msg->type);
+        tty->print("Recived error message type : %d \n",rdma_queue->recv_msg->type);
         die("unknow received message type\n");
     }
 
@@ -557,7 +823,6 @@ void handle_cqe(struct ibv_wc *wc){
  * 		After expantion, Memory server to register all the newaly allocated Regions to CPU server.
  */
 int rdma_connected( struct semeru_rdma_queue * rdma_queue){
-	int i;
   int ret = 0;
   bool succ = true;
 
@@ -590,33 +855,13 @@ int rdma_connected( struct semeru_rdma_queue * rdma_queue){
     //  This design is easy to handle the Memory pool scale. 
     // [XX] We need to COMMIT the whole space first, and then resiter them as RDMA buffer.
     //      Or we will get BAD_ADDRESS error.
-	  for(i=0; i< rdma_session->mem_pool->region_num; i++){
-    
-		  rdma_session->mem_pool->Java_heap_mr[i] = ibv_reg_mr(rdma_session->rdma_dev->pd, 
-                                                    rdma_session->mem_pool->region_list[i], 
-                                                    (size_t)rdma_session->mem_pool->region_mapped_size[i],
-	 																									IBV_ACCESS_LOCAL_WRITE  | 
-                                                    IBV_ACCESS_REMOTE_WRITE | 
-                                                    IBV_ACCESS_REMOTE_READ);
-  
-      #ifdef DEBUG_RDMA_SERVER
-      if (rdma_session->mem_pool->Java_heap_mr[i]!= NULL){
-        tty->print("Register Region[%d] : 0x%llx to RDMA Buffer[%d] : 0x%llx, rkey: 0x%llx, mapped_size 0x%lx done \n", i, 
-                                                            (unsigned long long)rdma_session->mem_pool->region_list[i],
-                                                            i, 
-                                                            (unsigned long long)rdma_session->mem_pool->Java_heap_mr[i],
-                                                            (unsigned long long)rdma_session->mem_pool->Java_heap_mr[i]->rkey,
-                                                            (unsigned long)rdma_session->mem_pool->region_mapped_size[i]);
-      }else{
-        tty->print("%s, region[%d], 0x%lx is registered wrongly, with NULL. \n",__func__, 
-                                                                              i,
-                                                                              (size_t)rdma_session->mem_pool->region_list[i]);
-        tty->print("ERROR in %s, %s\n",__func__, strerror(errno));
-        succ = false;  // For debug.
-      }
-      #endif
-
-    }
+    // With SEMERU_ELASTIC_MEM_POOL, only the meta Region is registered here.
+    // The data Regions are registered on demand of the CPU server, REQUEST_CHUNKS for ODP, or EXPAND_CHUNKS.
+    #ifdef SEMERU_ELASTIC_MEM_POOL
+    succ = register_regions(rdma_session, MIN2(rdma_session->mem_pool->region_num, (int)RDMA_META_REGION_NUM));
+    #else
+    succ = register_regions(rdma_session, rdma_session->mem_pool->region_num);
+    #endif
 
     if(succ == false)
       goto err;
@@ -641,7 +886,7 @@ err:
  */ 
 void inform_memory_pool_available(struct semeru_rdma_queue * rdma_queue){
   
-  rdma_queue->rdma_session->send_msg->type = AVAILABLE_TO_QUERY;
+  rdma_queue->send_msg->type = AVAILABLE_TO_QUERY;
   tty->print("%s , rdma_queue [%d] Informa CPU server that memory server is prepared well for serving \n",  __func__, rdma_queue->q_index);
   send_message(rdma_queue);
 
@@ -670,16 +915,16 @@ void send_free_mem_size(struct semeru_rdma_queue * rdma_queue){
   struct context * rdma_session = rdma_queue->rdma_session;
 
   // 1 Meta Region, N-1 Data Region
-  rdma_session->send_msg->mapped_chunk = rdma_session->mem_pool->region_num; // 1 meta data Region, N data Region
+  rdma_queue->send_msg->mapped_chunk = rdma_session->mem_pool->region_num; // 1 meta data Region, N data Region
   
   // Only send the free Region number.
 	for(i=0; i<rdma_session->mem_pool->region_num; i++ ){
-		rdma_session->send_msg->buf[i]	= 0x0;
-		rdma_session->send_msg->rkey[i]	=	0x0;  // The contend tag of the RDMA message.
+		rdma_queue->send_msg->buf[i]	= 0x0;
+		rdma_queue->send_msg->rkey[i]	=	0x0;  // The contend tag of the RDMA message.
 	}
 
-  rdma_session->send_msg->type = FREE_SIZE;			// Need to modify the CPU server behavior.
-  tty->print("%s , Send free memory information to CPU server, %d Chunks \n", __func__, rdma_session->send_msg->mapped_chunk);
+  rdma_queue->send_msg->type = FREE_SIZE;			// Need to modify the CPU server behavior.
+  tty->print("%s , Send free memory information to CPU server, %d Chunks \n", __func__, rdma_queue->send_msg->mapped_chunk);
   send_message(rdma_queue);
 }
 
@@ -695,16 +940,259 @@ void send_regions(struct semeru_rdma_queue * rdma_queue){
   struct context * rdma_session = rdma_queue->rdma_session;
 
 	// 1 meta Data Region, N-1 Data Regions.
-	rdma_session->send_msg->mapped_chunk = rdma_session->mem_pool->region_num; 
+	rdma_queue->send_msg->mapped_chunk = rdma_session->mem_pool->region_num; 
 	
+  // An ODP registration pins nothing, bind all the Regions at the first request of the CPU server.
+  // The resident size still follows the pages written by the CPU server.
+  if(rdma_session->mem_pool->odp_enabled)
+    register_regions(rdma_session, rdma_session->mem_pool->region_num);
+
 	for(i=0; i<rdma_session->mem_pool->region_num; i++ ){
-		rdma_session->send_msg->buf[i]	= (uint64_t)rdma_session->mem_pool->Java_heap_mr[i]->addr;
-    rdma_session->send_msg->mapped_size[i]  = (uint64_t)rdma_session->mem_pool->region_mapped_size[i]; // count at bytes.
-		rdma_session->send_msg->rkey[i]	=	rdma_session->mem_pool->Java_heap_mr[i]->rkey;
+    // Not registered yet, rkey 0 tells the CPU server to skip it.
+    if(rdma_session->mem_pool->Java_heap_mr[i] == NULL){
+      rdma_queue->send_msg->buf[i]  = 0x0;
+      rdma_queue->send_msg->mapped_size[i] = 0x0;
+      rdma_queue->send_msg->rkey[i] = 0x0;
+      continue;
+    }
+
+		rdma_queue->send_msg->buf[i]	= (uint64_t)rdma_session->mem_pool->Java_heap_mr[i]->addr;
+    rdma_queue->send_msg->mapped_size[i]  = (uint64_t)rdma_session->mem_pool->region_mapped_size[i]; // count at bytes.
+		rdma_queue->send_msg->rkey[i]	=	rdma_session->mem_pool->Java_heap_mr[i]->rkey;
 	}
 
-  rdma_session->send_msg->type = SEND_CHUNKS;			// Need to modify the CPU server behavior.
-  tty->print("%s , Send registered Java heap to CPU server, %d chunks \n", __func__, rdma_session->send_msg->mapped_chunk);
+  rdma_queue->send_msg->type = SEND_CHUNKS;			// Need to modify the CPU server behavior.
+  tty->print("%s , Send registered Java heap to CPU server, %d chunks \n", __func__, rdma_queue->send_msg->mapped_chunk);
+  send_message(rdma_queue);
+}
+
+
+/**
+ * Register the Region[index] as RDMA buffer, if it's not registered yet.
+ * The Region has to be committed by the JVM initialization already, or we will get BAD_ADDRESS error.
+ * 
+ * Return false if the registration failed.
+ */
+bool register_region(struct context * rdma_session, int index){
+  struct rdma_mem_pool* mem_pool = rdma_session->mem_pool;
+  int access = IBV_ACCESS_LOCAL_WRITE | IBV_ACCESS_REMOTE_WRITE | IBV_ACCESS_REMOTE_READ;
+
+  if(mem_pool->Java_heap_mr[index] != NULL)
+    return true;
+
+  // The meta Region is small and accessed by every control path transfer, keep it pinned.
+  // The CPU server claims and releases the Regions by the RDMA atomics on their state words in it.
+  if(index < (int)RDMA_META_REGION_NUM)
+    access |= IBV_ACCESS_REMOTE_ATOMIC;
+  else if(mem_pool->odp_enabled)
+    access |= IBV_ACCESS_ON_DEMAND;
+
+  // Before the pinning or the first page fault of the HCA.
+  semeru_numa_bind_memory(mem_pool->region_list[index], (size_t)mem_pool->region_mapped_size[index]);
+
+  mem_pool->Java_heap_mr[index] = ibv_reg_mr(rdma_session->rdma_dev->pd, 
+                                             mem_pool->region_list[index], 
+                                             (size_t)mem_pool->region_mapped_size[index],
+                                             access);
+  if(mem_pool->Java_heap_mr[index] == NULL){
+    tty->print("%s, region[%d], 0x%lx is registered wrongly, with NULL. \n",__func__, 
+                                                                          index,
+                                                                          (size_t)mem_pool->region_list[index]);
+    tty->print("ERROR in %s, %s\n",__func__, strerror(errno));
+    return false;
+  }
+
+  #ifdef DEBUG_RDMA_SERVER
+  tty->print("Register Region[%d] : 0x%llx to RDMA Buffer[%d] : 0x%llx, rkey: 0x%llx, mapped_size 0x%lx done \n", index, 
+                                                      (unsigned long long)mem_pool->region_list[index],
+                                                      index, 
+                                                      (unsigned long long)mem_pool->Java_heap_mr[index],
+                                                      (unsigned long long)mem_pool->Java_heap_mr[index]->rkey,
+                                                      (unsigned long)mem_pool->region_mapped_size[index]);
+  #endif
+
+  return true;
+}
+
+
+struct register_regions_args {
+  struct context* rdma_session;
+  int             first;
+  int             end;
+  int             stride;
+  bool            succ;
+};
+
+static void* register_regions_worker(void* _args){
+  struct register_regions_args* args = (struct register_regions_args*)_args;
+
+  for(int i = args->first; i < args->end; i += args->stride){
+    if(register_region(args->rdma_session, i) == false)
+      args->succ = false;
+  }
+  return NULL;
+}
+
+/**
+ * Register the Regions [0, end), one thread per core at most.
+ * ibv_reg_mr pins and maps the pages of a whole Region, a few hundred ms per GB,
+ * the serial loop kept the CPU server waiting for seconds on a large memory pool.
+ * ibv_reg_mr is thread safe, and each thread only writes the Java_heap_mr of its own Regions.
+ *
+ * Return false if any registration failed.
+ */
+bool register_regions(struct context * rdma_session, int end){
+  int nr_threads = MIN2(os::active_processor_count(), end);
+  struct register_regions_args* args;
+  pthread_t* threads;
+  bool succ = true;
+  int i;
+
+  if(nr_threads <= 1){
+    for(i = 0; i < end; i++){
+      if(register_region(rdma_session, i) == false)
+        succ = false;
+    }
+    return succ;
+  }
+
+  args    = (struct register_regions_args*)calloc(nr_threads, sizeof(struct register_regions_args));
+  threads = (pthread_t*)calloc(nr_threads, sizeof(pthread_t));
+  for(i = 0; i < nr_threads; i++){
+    args[i].rdma_session = rdma_session;
+    args[i].first        = i;
+    args[i].end          = end;
+    args[i].stride       = nr_threads;
+    args[i].succ         = true;
+    if(pthread_create(&threads[i], NULL, register_regions_worker, &args[i]) != 0){
+      register_regions_worker(&args[i]);   // register them by ourselves
+      threads[i] = 0;
+    }
+  }
+
+  for(i = 0; i < nr_threads; i++){
+    if(threads[i] != 0)
+      pthread_join(threads[i], NULL);
+    if(args[i].succ == false)
+      succ = false;
+  }
+
+  log_debug(semeru,rdma)("%s, registered %d Regions by %d threads, %s", __func__, end, nr_threads, succ ? "done" : "failed");
+  free(threads);
+  free(args);
+  return succ;
+}
+
+
+/**
+ * Can the HCA serve RDMA read/write on an On-Demand-Paging MR of a RC QP ?
+ */
+bool query_odp_support(struct semeru_rdma_dev * rdma_dev){
+  struct ibv_device_attr_ex attr;
+  const uint32_t rc_caps = IBV_ODP_SUPPORT_WRITE | IBV_ODP_SUPPORT_READ;
+
+  memset(&attr, 0, sizeof(attr));
+  if(ibv_query_device_ex(rdma_dev->ctx, NULL, &attr) != 0){
+    tty->print("%s, ibv_query_device_ex failed, %s \n", __func__, strerror(errno));
+    return false;
+  }
+
+  return (attr.odp_caps.general_caps & IBV_ODP_SUPPORT) != 0 &&
+         (attr.odp_caps.per_transport_caps.rc_odp_caps & rc_caps) == rc_caps;
+}
+
+
+/**
+ * Are the atomics of the HCA atomic with the CPU atomics ?
+ * Otherwise a CPU CAS on a word the CPU server changes by the RDMA atomics can be lost.
+ */
+bool query_atomic_glob(struct semeru_rdma_dev * rdma_dev){
+  struct ibv_device_attr attr;
+
+  memset(&attr, 0, sizeof(attr));
+  if(ibv_query_device(rdma_dev->ctx, &attr) != 0){
+    tty->print("%s, ibv_query_device failed, %s \n", __func__, strerror(errno));
+    return false;
+  }
+
+  return attr.atomic_cap == IBV_ATOMIC_GLOB;
+}
+
+bool semeru_rdma_atomic_glob(){
+  return global_rdma_ctx != NULL && global_rdma_ctx->mem_pool != NULL && global_rdma_ctx->mem_pool->atomic_glob;
+}
+
+bool semeru_mem_pool_odp(){
+  return global_rdma_ctx != NULL && global_rdma_ctx->mem_pool != NULL && global_rdma_ctx->mem_pool->odp_enabled;
+}
+
+
+/**
+ * EXPAND_CHUNKS, recv_msg->buf[i] != 0 marks the Region[i] to be registered.
+ * 
+ * Reply SEND_CHUNKS with only the marked Regions filled, the CPU server binds the Regions by index.
+ * A Region failed to be registered is replied with rkey 0.
+ * 
+ * Warning : 
+ *  The resizing messages only come from the RDMA_NOTIFY_QUEUE, a single poller handles them in order.
+ */
+void expand_regions(struct semeru_rdma_queue * rdma_queue){
+  int i;
+  struct context * rdma_session = rdma_queue->rdma_session;
+  struct rdma_mem_pool* mem_pool = rdma_session->mem_pool;
+
+  rdma_queue->send_msg->mapped_chunk = 0;
+  for(i=0; i<(int)MAX_REGION_NUM; i++ ){
+    rdma_queue->send_msg->buf[i]  = 0x0;
+    rdma_queue->send_msg->mapped_size[i] = 0x0;
+    rdma_queue->send_msg->rkey[i] = 0x0;
+
+    if(i >= mem_pool->region_num || rdma_queue->recv_msg->buf[i] == 0)
+      continue;
+
+    if(register_region(rdma_session, i) == false)
+      continue;
+
+    rdma_queue->send_msg->buf[i]  = (uint64_t)mem_pool->Java_heap_mr[i]->addr;
+    rdma_queue->send_msg->mapped_size[i]  = (uint64_t)mem_pool->region_mapped_size[i];
+    rdma_queue->send_msg->rkey[i] = mem_pool->Java_heap_mr[i]->rkey;
+    rdma_queue->send_msg->mapped_chunk++;
+  }
+
+  rdma_queue->send_msg->type = SEND_CHUNKS;
+  send_message(rdma_queue);
+}
+
+
+/**
+ * RELEASE_CHUNKS, recv_msg->buf[i] != 0 marks the Region[i] to be released.
+ * 
+ * The CPU server already unmapped these Regions and drained its data path.
+ * Deregister them and discard their physical pages. The virtual range is kept, 
+ * a later EXPAND_CHUNKS registers them again on zero pages.
+ * An ODP MR is kept, discarding the pages is enough. EXPAND_CHUNKS replies the same rkey.
+ */
+void release_regions(struct semeru_rdma_queue * rdma_queue){
+  int i;
+  struct context * rdma_session = rdma_queue->rdma_session;
+  struct rdma_mem_pool* mem_pool = rdma_session->mem_pool;
+
+  for(i=(int)RDMA_META_REGION_NUM; i<mem_pool->region_num && i<(int)MAX_REGION_NUM; i++ ){
+    if(rdma_queue->recv_msg->buf[i] == 0 || mem_pool->Java_heap_mr[i] == NULL)
+      continue;
+
+    if(!mem_pool->odp_enabled){
+      ibv_dereg_mr(mem_pool->Java_heap_mr[i]);
+      mem_pool->Java_heap_mr[i] = NULL;
+    }
+    mem_pool->cache_status[i] = -1;
+
+    if(!semeru_discard_memory(mem_pool->region_list[i], mem_pool->region_mapped_size[i])){
+      tty->print("%s, discard region[%d] failed, %s \n", __func__, i, strerror(errno));
+    }
+  }
+
+  rdma_queue->send_msg->type = DONE;
   send_message(rdma_queue);
 }
 
@@ -729,10 +1217,10 @@ void send_message(struct semeru_rdma_queue * rdma_queue){
   wr.num_sge = 1;
   wr.send_flags = IBV_SEND_SIGNALED;
 
-  sge.addr = (uintptr_t)rdma_session->send_msg;
+  sge.addr = (uintptr_t)rdma_queue->send_msg;
   sge.length = (uint32_t)sizeof(struct message);
   tty->print("%s, message size = %lu\n", __func__, sizeof(struct message));
-  sge.lkey = rdma_session->send_mr->lkey;
+  sge.lkey = rdma_queue->send_mr->lkey;
 
   while (!rdma_session->connected);  // Wait until RDMA connection is built.
 
@@ -742,6 +1230,125 @@ void send_message(struct semeru_rdma_queue * rdma_queue){
 
 
 
+/**
+ * Push a state transition to the CPU server, e.g. MEM_SERVER_NOTIFY_COMPACT_DONE.
+ * 
+ *  A zero-byte RDMA send-with-immediate, the imm_data is the state.
+ *  The CPU server sleeps on it instead of reading the flags_of_mem_server_state repeatedly.
+ *  Update the flags before the notification, the CPU server may read them after the wake up.
+ * 
+ *  Invoked by the GC threads, ibv_post_send is thread safe.
+ */
+void notify_cpu_server(uint32_t state){
+  struct ibv_send_wr wr, *bad_wr = NULL;
+  struct semeru_rdma_queue *rdma_queue;
+
+  // The CPU server hasn't bound the memory pool yet, nobody waits.
+  if(global_rdma_ctx == NULL || global_rdma_ctx->server_state != S_BIND)
+    return;
+
+  rdma_queue = &(global_rdma_ctx->rdma_queues[RDMA_NOTIFY_QUEUE]);
+  if(rdma_queue->connected == 0)
+    return;
+
+  memset(&wr, 0, sizeof(wr));
+  wr.wr_id      = (uintptr_t)rdma_queue;
+  wr.opcode     = IBV_WR_SEND_WITH_IMM;
+  wr.sg_list    = NULL;   // no payload
+  wr.num_sge    = 0;
+  wr.imm_data   = htonl(state);
+  wr.send_flags = IBV_SEND_SIGNALED;
+
+  // Make the flags visible before the notification.
+  OrderAccess::fence();
+
+  if(ibv_post_send(rdma_queue->qp, &wr, &bad_wr) != 0){
+    log_debug(semeru,rdma)("%s, post state %u to CPU server failed, %s. \n", __func__, state, strerror(errno));
+  }
+}
+
+
+
+/**
+ * The CPU server got the Regions of REQUEST_CHUNKS, it can write the memory pool from now on.
+ * Wake up the GC threads waiting for it, they share the lock of the doorbells.
+ */
+void set_cpu_server_bound(struct context * rdma_session){
+  pthread_mutex_lock(&cpu_server_doorbell_lock);
+  rdma_session->server_state = S_BIND;
+  pthread_cond_broadcast(&cpu_server_doorbell_cond);
+  pthread_mutex_unlock(&cpu_server_doorbell_lock);
+}
+
+/**
+ * Block until a CPU server has bound the memory pool.
+ * The readiness handshake is REQUEST_CHUNKS, the GC threads don't guess it by sleeping.
+ */
+void wait_for_cpu_server_bound(){
+  pthread_mutex_lock(&cpu_server_doorbell_lock);
+  while(global_rdma_ctx == NULL || global_rdma_ctx->server_state != S_BIND){
+    pthread_cond_wait(&cpu_server_doorbell_cond, &cpu_server_doorbell_lock);
+  }
+  pthread_mutex_unlock(&cpu_server_doorbell_lock);
+}
+
+
+/**
+ * The latest doorbell rung by the CPU server.
+ */
+uint32_t cpu_server_doorbell(){
+  return cpu_server_doorbell_seq;
+}
+
+/**
+ * When the latest doorbell arrived, by os::javaTimeNanos(). Read along with cpu_server_doorbell(),
+ * a doorbell arriving in between may pair the seqno of one with the time of the other.
+ */
+jlong cpu_server_doorbell_arrival(){
+  return cpu_server_doorbell_ns;
+}
+
+/**
+ * Wait for a doorbell newer than seen, e.g. a new CSet or the STW window.
+ * 
+ *  Spin a while first, the CPU server rings several times at the start and end of the STW window.
+ *  And then sleep until the poll_cq thread receives the doorbell, or timeout.
+ * 
+ *  Return the latest doorbell. The caller has to check its state again, the timeout isn't distinguished.
+ */
+uint32_t wait_for_cpu_server_doorbell(uint32_t seen, int timeout_ms){
+  struct timespec deadline;
+  int i;
+
+  for(i = 0; i < RDMA_DOORBELL_SPIN; i++){
+    if(cpu_server_doorbell_seq != seen){
+      return cpu_server_doorbell_seq;
+    }
+    SpinPause();
+  }
+
+  clock_gettime(CLOCK_REALTIME, &deadline);
+  deadline.tv_sec  += timeout_ms / 1000;
+  deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+  if(deadline.tv_nsec >= 1000000000L){
+    deadline.tv_sec  += 1;
+    deadline.tv_nsec -= 1000000000L;
+  }
+
+  pthread_mutex_lock(&cpu_server_doorbell_lock);
+  while(cpu_server_doorbell_seq == seen){
+    if(pthread_cond_timedwait(&cpu_server_doorbell_cond, &cpu_server_doorbell_lock, &deadline) == ETIMEDOUT){
+      break;
+    }
+  }
+  seen = cpu_server_doorbell_seq;
+  pthread_mutex_unlock(&cpu_server_doorbell_lock);
+
+  return seen;
+}
+
+
+
 //
 // <<<<<<<<<<<<<<<<<<<<<<<  End of sending 2-sided RDMA message to CPU server <<<<<<<<<<<<<<<<<<<<<<<
 //
@@ -750,6 +1357,597 @@ void send_message(struct semeru_rdma_queue * rdma_queue){
 
 
 
+//
+// >>>>>>>>>>>>>>>>>>>>>>  Start of NUMA placement >>>>>>>>>>>>>>>>>>>>>>
+//
+// Design Logic
+//	The CPU server reaches the heap of the memory server only through its RDMA NIC.
+//	A NIC sits on one socket, the DMA to the pages of the other socket and the GC workers there
+//	cross the socket interconnect.
+//	With -XX:+SemeruNUMABind, the data Regions and the mark stack prefer the NIC's node,
+//	and the GC workers only run on its CPUs. The other GC structures, e.g. the task queues
+//	and the alive bitmaps, are first touched by the bound workers.
+//
+
+#ifndef MPOL_PREFERRED
+#define MPOL_PREFERRED  1
+#endif
+#ifndef MPOL_MF_MOVE
+#define MPOL_MF_MOVE    (1 << 1)
+#endif
+
+static int             nic_numa_node = -1;   // -1, unknown.
+static cpu_set_t       nic_numa_cpus;
+static volatile bool   nic_numa_queried = false;
+static pthread_mutex_t nic_numa_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * The node of the RDMA device the session is connected through, /sys/class/infiniband/<dev>/device/numa_node,
+ * and its CPUs, /sys/devices/system/node/node<n>/cpulist, e.g. "0-13,28-41".
+ */
+static void query_nic_numa_node(struct ibv_device* dev){
+  int   node = -1;
+  char  path[256];
+  FILE* fp;
+
+  CPU_ZERO(&nic_numa_cpus);
+
+  snprintf(path, sizeof(path), "/sys/class/infiniband/%s/device/numa_node", ibv_get_device_name(dev));
+  fp = fopen(path, "r");
+  if(fp != NULL){
+    if(fscanf(fp, "%d", &node) != 1)
+      node = -1;
+    fclose(fp);
+  }
+
+  if(node >= 0){
+    snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+    fp = fopen(path, "r");
+    if(fp != NULL){
+      int lo, hi, sep;
+      while(fscanf(fp, "%d", &lo) == 1){
+        hi  = lo;
+        sep = fgetc(fp);
+        if(sep == '-'){
+          if(fscanf(fp, "%d", &hi) != 1)
+            break;
+          sep = fgetc(fp);
+        }
+        for(int cpu = lo; cpu <= hi && cpu < CPU_SETSIZE; cpu++)
+          CPU_SET(cpu, &nic_numa_cpus);
+        if(sep != ',')
+          break;
+      }
+      fclose(fp);
+    }
+
+    if(CPU_COUNT(&nic_numa_cpus) == 0)
+      node = -1;
+  }
+
+  nic_numa_node = node;
+  log_info(semeru,rdma)("%s, RDMA NIC %s is on NUMA node %d, with %d CPUs", __func__, ibv_get_device_name(dev),
+                        node, CPU_COUNT(&nic_numa_cpus));
+}
+
+/**
+ * The node of global_rdma_ctx->rdma_dev, queried once the first rdma_queue picked the device, see get_device_info().
+ * Before that it's unknown, the memory touched earlier isn't bound.
+ */
+int semeru_nic_numa_node(){
+  if(!OrderAccess::load_acquire(&nic_numa_queried)){
+    pthread_mutex_lock(&nic_numa_lock);
+    if(!nic_numa_queried && global_rdma_ctx != NULL && global_rdma_ctx->rdma_dev != NULL &&
+       global_rdma_ctx->rdma_dev->ctx != NULL){
+      query_nic_numa_node(global_rdma_ctx->rdma_dev->ctx->device);
+      OrderAccess::release_store(&nic_numa_queried, true);
+    }
+    pthread_mutex_unlock(&nic_numa_lock);
+  }
+  return nic_numa_node;
+}
+
+/**
+ * Prefer the NIC's node for the pages of [addr, addr + size), the present pages are moved.
+ * Invoked before the first touch, e.g. before ibv_reg_mr pins the range.
+ */
+void semeru_numa_bind_memory(char* addr, size_t size){
+  unsigned long nodemask[16];
+  int node;
+
+  if(!SemeruNUMABind || (node = semeru_nic_numa_node()) < 0 || node >= (int)(sizeof(nodemask) * 8))
+    return;
+
+  char* start = align_up(addr, os::vm_page_size());
+  char* end   = align_down(addr + size, os::vm_page_size());
+  if(start >= end)
+    return;
+
+  memset(nodemask, 0, sizeof(nodemask));
+  nodemask[node / (sizeof(unsigned long) * 8)] |= 1UL << (node % (sizeof(unsigned long) * 8));
+
+  if(syscall(SYS_mbind, start, (unsigned long)(end - start), MPOL_PREFERRED, nodemask,
+             (unsigned long)(sizeof(nodemask) * 8), MPOL_MF_MOVE) != 0){
+    log_warning(semeru,rdma)("%s, mbind [0x%lx, 0x%lx) to node %d failed, %s", __func__,
+                             (size_t)start, (size_t)end, node, strerror(errno));
+  }
+}
+
+/**
+ * Run the current GC worker on the NIC's CPUs. Cheap enough to be invoked at each task start.
+ */
+void semeru_numa_bind_thread(){
+  if(!SemeruNUMABind || semeru_nic_numa_node() < 0)
+    return;
+
+  if(sched_setaffinity(0, sizeof(cpu_set_t), &nic_numa_cpus) != 0){
+    log_warning(semeru,rdma)("%s, bind the thread to node %d failed, %s", __func__, nic_numa_node, strerror(errno));
+  }
+}
+
+
+
+//
+// <<<<<<<<<<<<<<<<<<<<<<<  End of NUMA placement <<<<<<<<<<<<<<<<<<<<<<<
+//
+
+
+
+
+//
+// >>>>>>>>>>>>>>>>>>>>>>  Start of Warm restart >>>>>>>>>>>>>>>>>>>>>>
+//
+// Design Logic
+//  With -XX:SemeruMemPoolFile, the data Regions live in a file on hugetlbfs or a DAX file system.
+//  If this memory server process dies, or is upgraded, the file keeps the pages swapped out by the CPU server.
+//  The restarted process maps the same file at the same address and registers the Regions again.
+//  The CPU server reconnects by REATTACH and binds the chunks by their new rkeys.
+//
+//  Only the data Regions are kept. The meta Region is rebuilt as a cold start.
+//
+
+/**
+ * Map the data Regions [start, start + size) to -XX:SemeruMemPoolFile.
+ * A file of the same size is the heap of the previous memory server process, its content is kept.
+ * Any other file is resized, its content is discarded.
+ *
+ * The range is committed by the mapping, it must never be committed again by an anonymous mapping.
+ */
+bool semeru_map_mem_pool_file(char* start, size_t size){
+  struct stat st;
+  int fd = open(SemeruMemPoolFile, O_RDWR | O_CREAT, 0600);
+  if(fd < 0){
+    log_error(semeru,rdma)("%s, open %s failed, %s", __func__, SemeruMemPoolFile, strerror(errno));
+    return false;
+  }
+
+  if(fstat(fd, &st) != 0){
+    log_error(semeru,rdma)("%s, stat %s failed, %s", __func__, SemeruMemPoolFile, strerror(errno));
+    close(fd);
+    return false;
+  }
+
+  // A device DAX window, -XX:+SemeruMemPoolCXL, can't be resized. It is the memory pool itself.
+  mem_pool_file_kept = ((size_t)st.st_size == size) || S_ISCHR(st.st_mode);
+  if(!mem_pool_file_kept && (ftruncate(fd, 0) != 0 || ftruncate(fd, (off_t)size) != 0)){
+    log_error(semeru,rdma)("%s, resize %s to 0x%lx failed, %s", __func__, SemeruMemPoolFile, size, strerror(errno));
+    close(fd);
+    return false;
+  }
+
+  if(mmap(start, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) != (void*)start){
+    log_error(semeru,rdma)("%s, map %s at 0x%lx failed, %s", __func__, SemeruMemPoolFile, (size_t)start, strerror(errno));
+    close(fd);
+    return false;
+  }
+
+  mem_pool_file_fd = fd;
+  log_info(semeru,rdma)("%s, data Regions [0x%lx, 0x%lx) %s %s", __func__, (size_t)start, (size_t)(start + size),
+                        mem_pool_file_kept ? "reattached from" : "backed by", SemeruMemPoolFile);
+  return true;
+}
+
+bool semeru_mem_pool_kept(){
+  return mem_pool_file_kept;
+}
+
+/**
+ * Give the physical pages of a released data Region back.
+ * The pages of a shared file mapping are only unmapped by madvise, punch them out of the file.
+ */
+bool semeru_discard_memory(char* addr, size_t size){
+  if(mem_pool_file_fd < 0)
+    return madvise(addr, size, MADV_DONTNEED) == 0;
+
+  off_t offset = (off_t)((size_t)addr - RDMA_DATA_SPACE_START_ADDR);
+  return fallocate(mem_pool_file_fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, offset, (off_t)size) == 0;
+}
+
+/**
+ * -XX:+SemeruMemPoolCXL, the CPU server copies the pages in and out of the shared window, bypassing our caches.
+ * Write back and drop the cached lines of [addr, addr + size) :
+ *  before reading what the CPU server wrote, and after writing what the CPU server reads.
+ */
+void semeru_cxl_sync(const void* addr, size_t size){
+  if(!SemeruMemPoolCXL || size == 0)
+    return;
+
+#if defined(__x86_64__)
+  const uintptr_t line = 64;   // clflush granularity. DEFAULT_CACHE_LINE_SIZE is the padding of 2 lines.
+  const char* p = (const char*)align_down((uintptr_t)addr, line);
+  const char* end = (const char*)addr + size;
+  __asm__ volatile("mfence" ::: "memory");
+  for(; p < end; p += line){
+    __asm__ volatile("clflush %0" : "+m" (*(volatile char*)p));
+  }
+  __asm__ volatile("mfence" ::: "memory");
+#else
+  OrderAccess::fence();
+#endif
+}
+
+//
+// <<<<<<<<<<<<<<<<<<<<<<<  End of Warm restart <<<<<<<<<<<<<<<<<<<<<<<
+//
+
+
+
+//
+// >>>>>>>>>>>>>>>>>>>>>>  Start of Dead swap pages >>>>>>>>>>>>>>>>>>>>>>
+//
+// The CPU server frees a swap slot after the page is swapped in and dirtied.
+// Its copy here is dead until the page is written again, INVALIDATE_PAGES sends them in batches:
+//  recv_msg->mapped_chunk : the Region index, region_list[].
+//  recv_msg->buf[0] : the first page of the batch, offset within the Region.
+//  recv_msg->buf[1, MAX_REGION_NUM) : the bitmap, bit i for the page buf[0] + i.
+//
+// -XX:+SemeruDiscardDeadPages gives their physical pages back, they read zero until the next write.
+// Only an ODP MR follows the discard. A pinned MR keeps the old physical pages, the later RDMA writes
+// would land there while the JVM reads fresh zero pages. Without ODP the pages are only recorded as dead.
+// The tracing skips the objects on a discarded page, see G1SemeruCMTask::deal_with_reference().
+// The CPU server never discards a page being written, it waits for the DONE.
+// A write revives the page, see semeru_page_revive().
+//
+
+static const size_t dead_page_map_bits = (RDMA_DATA_REGION_NUM * REGION_SIZE_GB * ONE_GB) / PAGE_SIZE;
+static volatile uint64_t dead_page_map[dead_page_map_bits / BitsPerWord];  // 1 bit per discarded data page
+
+// The tracing and the TCP transport clear the bits concurrently.
+static void dead_page_map_update(size_t index, bool dead){
+  volatile uint64_t* word = &dead_page_map[index / BitsPerWord];
+  uint64_t bit = (uint64_t)1 << (index % BitsPerWord);
+  uint64_t old_value = *word;
+  while(((old_value & bit) != 0) != dead){
+    uint64_t new_value = dead ? (old_value | bit) : (old_value & ~bit);
+    uint64_t cur = Atomic::cmpxchg(new_value, word, old_value);
+    if(cur == old_value){
+      return;
+    }
+    old_value = cur;
+  }
+}
+
+void invalidate_pages(struct semeru_rdma_queue * rdma_queue){
+  struct rdma_mem_pool* mem_pool = rdma_queue->rdma_session->mem_pool;
+  struct message* msg = rdma_queue->recv_msg;
+  int chunk = msg->mapped_chunk;
+  size_t discarded = 0;
+
+  if(chunk < (int)RDMA_META_REGION_NUM || chunk >= mem_pool->region_num || mem_pool->region_list[chunk] == NULL){
+    log_warning(semeru,rdma)("%s, wrong Region[%d] to invalidate.", __func__, chunk);
+    goto out;
+  }
+
+  for(size_t w = 1; w < MAX_REGION_NUM; w++){
+    uint64_t bits = msg->buf[w];
+    while(bits != 0){
+      // One run of contiguous dead pages per madvise.
+      size_t first = count_trailing_zeros(bits);
+      uint64_t rest = ~(bits >> first);
+      size_t len = (rest == 0) ? (size_t)BitsPerWord - first : count_trailing_zeros(rest);
+      size_t page = msg->buf[0] + (w - 1) * BitsPerWord + first;
+      char* addr = mem_pool->region_list[chunk] + page * PAGE_SIZE;
+
+      if(addr + len * PAGE_SIZE > mem_pool->region_list[chunk] + mem_pool->region_mapped_size[chunk]){
+        log_warning(semeru,rdma)("%s, page 0x%lx is out of Region[%d].", __func__, page, chunk);
+        goto out;
+      }
+
+      if(SemeruDiscardDeadPages){
+        size_t index = ((size_t)addr - RDMA_DATA_SPACE_START_ADDR) / PAGE_SIZE;
+        for(size_t i = index; i < index + len; i++){
+          dead_page_map_update(i, true);
+        }
+        OrderAccess::fence();
+        if(mem_pool->odp_enabled && !semeru_discard_memory(addr, len * PAGE_SIZE)){
+          log_debug(semeru,rdma)("%s, discard 0x%lx pages at 0x%lx failed, %s", __func__, len, (size_t)addr, strerror(errno));
+        }
+      }
+      discarded += len;
+      bits &= (first + len < BitsPerWord) ? ~(((uint64_t)1 << (first + len)) - 1) : 0;
+    }
+  }
+  log_debug(semeru,rdma)("%s, Region[%d] 0x%lx dead pages from page 0x%lx", __func__, chunk, discarded, (size_t)msg->buf[0]);
+
+out:
+  rdma_queue->send_msg->type = DONE;
+  send_message(rdma_queue);
+}
+
+/**
+ * Whether the page of addr was discarded as dead.
+ * A one-sided RDMA write isn't seen here. A discarded page which doesn't read zero was written again,
+ * its bit is cleared. A page only recorded as dead, without ODP, keeps the bit until a seen write.
+ */
+bool semeru_page_discarded(const void* addr){
+  if((size_t)addr < RDMA_DATA_SPACE_START_ADDR){
+    return false;
+  }
+  size_t index = ((size_t)addr - RDMA_DATA_SPACE_START_ADDR) / PAGE_SIZE;
+  if(index >= dead_page_map_bits){
+    return false;
+  }
+  if((dead_page_map[index / BitsPerWord] & ((uint64_t)1 << (index % BitsPerWord))) == 0){
+    return false;
+  }
+
+  if(semeru_mem_pool_odp()){
+    const uint64_t* page = (const uint64_t*)align_down((size_t)addr, PAGE_SIZE);
+    for(size_t i = 0; i < PAGE_SIZE / sizeof(uint64_t); i++){
+      if(page[i] != 0){
+        semeru_page_revive(page, PAGE_SIZE);
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+/**
+ * [addr, addr + size) of the data space is written again, e.g. by the TCP transport.
+ * Its pages are alive.
+ */
+void semeru_page_revive(const void* addr, size_t size){
+  if((size_t)addr < RDMA_DATA_SPACE_START_ADDR || size == 0){
+    return;
+  }
+  size_t first = ((size_t)addr - RDMA_DATA_SPACE_START_ADDR) / PAGE_SIZE;
+  size_t end = MIN2(((size_t)addr + size - RDMA_DATA_SPACE_START_ADDR + PAGE_SIZE - 1) / PAGE_SIZE, dead_page_map_bits);
+  for(size_t i = first; i < end; i++){
+    dead_page_map_update(i, false);
+  }
+}
+
+//
+// <<<<<<<<<<<<<<<<<<<<<<<  End of Dead swap pages <<<<<<<<<<<<<<<<<<<<<<<
+//
+
+
+
+
+//
+// >>>>>>>>>>>>>>>>>>>>>>  Start of Cold blocks >>>>>>>>>>>>>>>>>>>>>>
+//
+// -XX:+SemeruColdStore, the CPU server hands over the SEMERU_COLD_BLOCK_SIZE blocks it stopped swapping,
+// see G1SemeruColdStore. COLD_BLOCKS sends them in batches:
+//  recv_msg->mapped_chunk : the Region index, region_list[].
+//  recv_msg->buf[0] : the first block of the batch, offset within the Region.
+//  recv_msg->buf[1, MAX_REGION_NUM) : the bitmap, bit i for the block buf[0] + i.
+// FETCH_BLOCK takes one back, buf[0] is the block within the Region.
+// The CPU server doesn't access the block until the DONE.
+//
+
+// The start of the block within the Region, NULL if it's out of the Region.
+static char* cold_block_addr(struct rdma_mem_pool* mem_pool, int chunk, size_t block){
+  if(chunk < (int)RDMA_META_REGION_NUM || chunk >= mem_pool->region_num || mem_pool->region_list[chunk] == NULL){
+    return NULL;
+  }
+  if((block + 1) * SEMERU_COLD_BLOCK_SIZE > mem_pool->region_mapped_size[chunk]){
+    return NULL;
+  }
+  return mem_pool->region_list[chunk] + block * SEMERU_COLD_BLOCK_SIZE;
+}
+
+void cold_blocks(struct semeru_rdma_queue * rdma_queue){
+  struct rdma_mem_pool* mem_pool = rdma_queue->rdma_session->mem_pool;
+  struct message* msg = rdma_queue->recv_msg;
+  int chunk = msg->mapped_chunk;
+  size_t handed = 0;
+
+  for(size_t w = 1; w < MAX_REGION_NUM; w++){
+    uint64_t bits = msg->buf[w];
+    while(bits != 0){
+      size_t block = msg->buf[0] + (w - 1) * BitsPerWord + count_trailing_zeros(bits);
+      char* addr = cold_block_addr(mem_pool, chunk, block);
+      if(addr == NULL){
+        log_warning(semeru,rdma)("%s, block 0x%lx is out of Region[%d].", __func__, block, chunk);
+        goto out;
+      }
+      G1SemeruColdStore::hand_over(addr);
+      handed++;
+      bits &= bits - 1;
+    }
+  }
+  log_debug(semeru,rdma)("%s, Region[%d] 0x%lx cold blocks from block 0x%lx", __func__, chunk, handed, (size_t)msg->buf[0]);
+
+out:
+  rdma_queue->send_msg->type = DONE;
+  send_message(rdma_queue);
+}
+
+void fetch_block(struct semeru_rdma_queue * rdma_queue){
+  struct message* msg = rdma_queue->recv_msg;
+  char* addr = cold_block_addr(rdma_queue->rdma_session->mem_pool, msg->mapped_chunk, msg->buf[0]);
+
+  if(addr == NULL){
+    log_warning(semeru,rdma)("%s, block 0x%lx is out of Region[%d].", __func__, (size_t)msg->buf[0], msg->mapped_chunk);
+  }else{
+    G1SemeruColdStore::fetch(addr);
+  }
+
+  rdma_queue->send_msg->type = DONE;
+  send_message(rdma_queue);
+}
+
+//
+// <<<<<<<<<<<<<<<<<<<<<<<  End of Cold blocks <<<<<<<<<<<<<<<<<<<<<<<
+//
+
+
+
+
+//
+// >>>>>>>>>>>>>>>>>>>>>>  Start of TCP transport >>>>>>>>>>>>>>>>>>>>>>
+//
+// -XX:+SemeruTCPTransport, the CPU server kernel module with tcp_transport=1 reads and writes
+// the heap over TCP instead of the 1-sided RDMA, for the machines without an HCA.
+// The 2-sided messages are still on the RDMA connection, e.g. soft-RoCE (rxe).
+//
+// Each connection carries one request at a time, a struct semeru_tcp_req, followed by the data of a write.
+// We reply a struct semeru_tcp_resp after the write is in the heap, followed by the data of a read.
+//
+
+static bool tcp_xfer(int fd, char* buf, size_t len, bool send){
+  while(len > 0){
+    ssize_t ret = send ? ::send(fd, buf, len, MSG_NOSIGNAL) : ::recv(fd, buf, len, MSG_WAITALL);
+    if(ret < 0 && errno == EINTR){
+      continue;
+    }
+    if(ret <= 0){
+      return false;
+    }
+    buf += ret;
+    len -= (size_t)ret;
+  }
+  return true;
+}
+
+/**
+ * [addr, addr + len) is within one registered Region.
+ */
+static bool tcp_range_valid(struct rdma_mem_pool* mem_pool, size_t addr, size_t len){
+  if(addr < SEMERU_START_ADDR || len == 0){
+    return false;
+  }
+  size_t index = (addr - SEMERU_START_ADDR) / ((size_t)REGION_SIZE_GB * ONE_GB);
+  if(index >= (size_t)mem_pool->region_num || mem_pool->region_list[index] == NULL){
+    return false;
+  }
+  return addr + len <= (size_t)mem_pool->region_list[index] + mem_pool->region_mapped_size[index];
+}
+
+static void* tcp_serve_connection(void* arg){
+  int fd = (int)(intptr_t)arg;
+  struct rdma_mem_pool* mem_pool = global_rdma_ctx->mem_pool;
+  struct semeru_tcp_req req;
+  struct semeru_tcp_resp resp;
+
+  while(tcp_xfer(fd, (char*)&req, sizeof(req), false)){
+    resp.magic  = SEMERU_TCP_MAGIC;
+    resp.status = 0;
+    if(req.magic != SEMERU_TCP_MAGIC){
+      log_warning(semeru,rdma)("%s, wrong magic 0x%x, close the connection.", __func__, req.magic);
+      break;
+    }
+    if((req.op != SEMERU_TCP_READ && req.op != SEMERU_TCP_WRITE) || !tcp_range_valid(mem_pool, req.addr, req.len)){
+      log_warning(semeru,rdma)("%s, reject op %u at 0x%lx, len 0x%lx", __func__, req.op, (size_t)req.addr, (size_t)req.len);
+      if(req.op == SEMERU_TCP_WRITE){
+        break;  // its data is already on the way, the stream can't be resynchronized.
+      }
+      resp.status = -EINVAL;
+      if(!tcp_xfer(fd, (char*)&resp, sizeof(resp), true)){
+        break;
+      }
+      continue;
+    }
+
+    char* addr = (char*)req.addr;
+    if(req.op == SEMERU_TCP_WRITE){
+      if(!tcp_xfer(fd, addr, req.len, false)){
+        break;
+      }
+      semeru_cxl_sync(addr, req.len);
+      semeru_page_revive(addr, req.len);
+      if(!tcp_xfer(fd, (char*)&resp, sizeof(resp), true)){
+        break;
+      }
+    }else{
+      semeru_cxl_sync(addr, req.len);
+      if(!tcp_xfer(fd, (char*)&resp, sizeof(resp), true) || !tcp_xfer(fd, addr, req.len, true)){
+        break;
+      }
+    }
+  }
+
+  close(fd);
+  return NULL;
+}
+
+static void* tcp_accept_connections(void* arg){
+  int listen_fd = (int)(intptr_t)arg;
+
+  for(;;){
+    int fd = accept(listen_fd, NULL, NULL);
+    if(fd < 0){
+      if(errno == EINTR){
+        continue;
+      }
+      tty->print("%s, accept failed, %s \n", __func__, strerror(errno));
+      break;
+    }
+
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    pthread_t thread;
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    if(pthread_create(&thread, &attr, tcp_serve_connection, (void*)(intptr_t)fd) != 0){
+      close(fd);
+    }
+    pthread_attr_destroy(&attr);
+  }
+
+  close(listen_fd);
+  return NULL;
+}
+
+/**
+ * Listen on the port, a thread per connection of the CPU server.
+ * The heap is read and written directly, the Regions must be in init_memory_pool() first.
+ */
+void semeru_start_tcp_server(int port){
+  struct sockaddr_in addr;
+  int one = 1;
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+
+  guarantee(fd >= 0, "TCP transport, socket failed.");
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family      = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  addr.sin_port        = htons(port);
+  if(bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(fd, 64) != 0){
+    perror("TCP transport, bind failed.");
+    assert(0, "TCP transport, bind failed.");
+  }
+
+  pthread_t thread;
+  TEST_NZ(pthread_create(&thread, NULL, tcp_accept_connections, (void*)(intptr_t)fd));
+  pthread_detach(thread);
+  tty->print("TCP transport listening on port %d.\n", port);
+}
+
+//
+// <<<<<<<<<<<<<<<<<<<<<<<  End of TCP transport <<<<<<<<<<<<<<<<<<<<<<<
+//
+
+
+
+
+
 //
 // >>>>>>>>>>>>>>>>>>>>>>  Start of Resource collection >>>>>>>>>>>>>>>>>>>>>>
 //
@@ -766,6 +1964,11 @@ int on_disconnect(struct semeru_rdma_queue *rdma_queue){
    if(rdma_queue->connected == 1){
     rdma_destroy_qp( rdma_queue->cm_id );
     rdma_destroy_id( rdma_queue->cm_id );
+    ibv_dereg_mr(rdma_queue->send_mr);
+    if(rdma_queue->recv_mr != NULL)
+      ibv_dereg_mr(rdma_queue->recv_mr);
+    free(rdma_queue->send_msg);
+    free(rdma_queue->recv_msg);
     tty->print("%s, free rdma_queue[%d] \n", __func__, rdma_queue->q_index);
     rdma_queue->connected = 0;
 
@@ -787,11 +1990,6 @@ void destroy_connection(struct context * rdma_session){
   int i = 0;
   int index;
 
-  ibv_dereg_mr(rdma_session->send_mr);
-  ibv_dereg_mr(rdma_session->recv_mr);
-  free(rdma_session->send_msg);
-  free(rdma_session->recv_msg);
-
 	// All the Regions should be freed.
   for (i=0; i<rdma_session->mem_pool->region_num; i++){
     if (rdma_session->mem_pool->Java_heap_mr[i] == NULL) {
@@ -808,6 +2006,11 @@ void destroy_connection(struct context * rdma_session){
 	//free(global_mem_pool);
 	free(global_rdma_ctx);
 
+  // The CPU server is gone, nobody will reattach the data Regions. The next memory server starts cold.
+  if(mem_pool_file_fd >= 0 && ftruncate(mem_pool_file_fd, 0) != 0){
+    tty->print("%s, discard %s failed, %s \n", __func__, SemeruMemPoolFile, strerror(errno));
+  }
+
   // Exit the Java instance.
   tty->print("%s, Exit Memory Server JVM Instance. \n", __func__);
   vm_direct_exit(0);  // 0 : normally exit.
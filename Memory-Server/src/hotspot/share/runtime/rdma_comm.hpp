@@ -45,6 +45,25 @@
 
 
 #define RDMA_QUEUE_NUM  16  // Larger or equal to the online core of CPU server
+#define RDMA_CQ_POLLER_NUM  4   // Threads polling the CQs, the rdma_queue[i] is polled by poller[i % RDMA_CQ_POLLER_NUM].
+#define RDMA_CQ_POLLER_FIRST_CORE 0  // poller[i] is pinned to core (RDMA_CQ_POLLER_FIRST_CORE + i) % online cores.
+#define RDMA_CQ_POLL_BATCH  32  // WC reaped by each ibv_poll_cq.
+#define RDMA_CQ_DEPTH       64  // Larger than the outstanding signaled send wr plus recv wr of a QP.
+#define RDMA_NOTIFY_QUEUE 0  // The first QP of the CPU server kernel keeps recv wr for the state notification.
+#define RDMA_DOORBELL_RECV_NUM  8     // Recv wr kept posted on RDMA_NOTIFY_QUEUE for the CPU server doorbells.
+#define RDMA_DOORBELL_SPIN      4096  // Spin before sleeping on the doorbell, the CPU server usually rings a STW window in a burst.
+#define RDMA_SRQ_DEPTH  (2 * RDMA_QUEUE_NUM + RDMA_DOORBELL_RECV_NUM)  // Recv wr kept posted on the shared receive queue, -XX:+SemeruRdmaSRQ.
+
+
+/**
+ * A daemon thread polling the CQs of a subset of the rdma_queues.
+ * Each poller owns a completion channel, the CQs of its rdma_queues are bound to it.
+ */
+struct semeru_cq_poller {
+  struct ibv_comp_channel *comp_channel;
+  pthread_t thread;
+  int index;
+};
 
 
 /**
@@ -56,8 +75,17 @@ struct semeru_rdma_queue {
 	struct rdma_cm_id *cm_id;		//  ? bind to QP
 
 	// ib events 
-  struct ibv_cq *cq;			// Completion queue
+  struct ibv_cq *cq;			// Completion queue, one per QP.
 	struct ibv_qp *qp;			// Queue Pair
+  struct semeru_cq_poller *poller;  // The thread polling the cq.
+
+  // Reserve wr for 2-sided RDMA communications, per QP.
+  // The QPs are handled by different pollers at the same time.
+  struct message *recv_msg;				// RDMA commandline attached to each RDMA request.
+	struct ibv_mr *recv_mr;       	// Need to register recv_msg as RDMA MR, then RDMA device can read/write it.
+
+  struct message *send_msg;
+  struct ibv_mr *send_mr;
 
 	//enum rdma_queue_state state;  // the current status of the QP.
 	//wait_queue_head_t 		sem;    // semaphore for wait/wakeup
@@ -69,8 +97,14 @@ struct semeru_rdma_queue {
 
 
 struct semeru_rdma_dev {
-  struct ibv_context *ctx;  // Memory server only needs one CQ, use the CQ of rdma_queue[0].
+  struct ibv_context *ctx;  // The ibv_context of the first rdma_queue.
   struct ibv_pd *pd;
+
+  // -XX:+SemeruRdmaSRQ. All the QPs receive into one pool of RDMA_SRQ_DEPTH messages,
+  // instead of a registered recv_msg and the recv wr per QP. NULL if the HCA can't create it.
+  struct ibv_srq *srq;
+  struct message *srq_msgs;
+  struct ibv_mr *srq_mr;
 };
 
 
@@ -121,7 +155,13 @@ enum region_status{
 		REQUEST_SINGLE_CHUNK,	// Send a request to ask for a single chunk.
 		QUERY,         			  // 10
     
-    AVAILABLE_TO_QUERY    // This memory server is oneline to server.
+    AVAILABLE_TO_QUERY,   // This memory server is oneline to server.
+    EXPAND_CHUNKS,        // 12, register the marked Regions and send them back by SEND_CHUNKS.
+    RELEASE_CHUNKS,       // 13, deregister the marked Regions and give their memory back to the OS. Reply DONE.
+    REATTACH,             // 14, the CPU server reconnects after this memory server restarted. Reply FREE_SIZE if the data Regions are kept, DONE otherwise.
+    INVALIDATE_PAGES,     // 15, the swap slots of the marked pages are freed on the CPU server, discard them. Reply DONE.
+    COLD_BLOCKS,          // 16, the marked blocks aren't accessed by the CPU server until FETCH_BLOCK, -XX:+SemeruColdStore. Reply DONE.
+    FETCH_BLOCK           // 17, the CPU server accesses the cold block again, decompress it first. Reply DONE.
 
 	};
 
@@ -151,17 +191,8 @@ struct context {
   struct semeru_rdma_queue * rdma_queues;
 
 
-  struct ibv_comp_channel *comp_channel;
-  pthread_t cq_poller_thread;  // Deamon thread to handle the 2-sided RDMA messages.
-
-
-  // 2) Reserve wr for 2-sided RDMA communications
-  //    
-  struct message *recv_msg;				// RDMA commandline attached to each RDMA request.
-	struct ibv_mr *recv_mr;       	// Need to register recv_msg as RDMA MR, then RDMA device can read/write it.
-
-  struct message *send_msg;
-  struct ibv_mr *send_mr;
+  // Deamon threads to handle the 2-sided RDMA messages.
+  struct semeru_cq_poller cq_pollers[RDMA_CQ_POLLER_NUM];
 
 
   // 3) Used for 1-sided RDMA communications
@@ -198,6 +229,14 @@ struct rdma_mem_pool{
   char*	  region_list[MAX_FREE_MEM_GB];       		// Start address of each Region. region_list[0] == Java_start.
   size_t  region_mapped_size[MAX_FREE_MEM_GB];    // The byte size of the corresponding Region. Count at bytes.
   int		  cache_status[MAX_FREE_MEM_GB];					// -1 NOT bind with CPU server. Or check the value of region_status.
+
+  // The data Regions are registered as On-Demand-Paging MR, SemeruMemPoolODP.
+  // They are not pinned, the physical pages are faulted in by the HCA on the first RDMA access. 
+  bool    odp_enabled;
+
+  // The HCA's atomics are atomic with the CPU atomics of the memory server, IBV_ATOMIC_GLOB.
+  // Only then the memory server updates the Region state words the CPU server changes by the RDMA atomics.
+  bool    atomic_glob;
 };
 
 
@@ -212,6 +251,29 @@ struct rdma_main_thread_args {
 
 
 
+/**
+ * The TCP transport, the same as semeru/frontswap_path.h of the CPU server kernel module.
+ * The CPU server connects to the RDMA port + SEMERU_TCP_PORT_OFFSET.
+ */
+#define SEMERU_TCP_PORT_OFFSET  100
+#define SEMERU_TCP_MAGIC        0x53454d55
+#define SEMERU_TCP_READ         1
+#define SEMERU_TCP_WRITE        2
+
+struct semeru_tcp_req {
+  uint32_t magic;
+  uint32_t op;
+  uint64_t addr;  // the virtual address in our heap
+  uint64_t len;
+} __attribute__((packed));
+
+struct semeru_tcp_resp {
+  uint32_t magic;
+  int32_t  status;  // 0, or the request is rejected and no data follows
+} __attribute__((packed));
+
+
+
 /**
  * Define tools
  * 
@@ -248,14 +310,54 @@ void  handle_cqe(struct ibv_wc *wc);
 void  inform_memory_pool_available(struct semeru_rdma_queue * rdma_queue);
 void  send_free_mem_size(struct semeru_rdma_queue* rdma_queue);
 void  send_regions(struct semeru_rdma_queue* rdma_queue);
+bool  register_region(struct context * rdma_session, int index);
+bool  register_regions(struct context * rdma_session, int end);
+bool  query_odp_support(struct semeru_rdma_dev * rdma_dev);
+bool  query_atomic_glob(struct semeru_rdma_dev * rdma_dev);
+void  expand_regions(struct semeru_rdma_queue * rdma_queue);
+void  release_regions(struct semeru_rdma_queue * rdma_queue);
+void  invalidate_pages(struct semeru_rdma_queue * rdma_queue);
+void  cold_blocks(struct semeru_rdma_queue * rdma_queue);
+void  fetch_block(struct semeru_rdma_queue * rdma_queue);
 void  send_message(struct semeru_rdma_queue * rdma_queue);
+void  notify_cpu_server(uint32_t state);
+uint32_t cpu_server_doorbell();
+jlong cpu_server_doorbell_arrival();
+void  set_cpu_server_bound(struct context * rdma_session);
+void  wait_for_cpu_server_bound();
+uint32_t wait_for_cpu_server_doorbell(uint32_t seen, int timeout_ms);
 
 void 	destroy_connection(struct context * rdma_session);
 void*	poll_cq(void *ctx);
 void 	post_receives(struct semeru_rdma_queue * rdma_queue);
+bool  build_srq(struct semeru_rdma_dev * rdma_dev);
+void  post_srq_receive(struct semeru_rdma_dev * rdma_dev, int slot);
+struct semeru_rdma_queue* receive_from_srq(struct ibv_wc *wc);
 
 void 	init_memory_pool(char* heap_start, size_t heap_size, struct context * rdma_ctx );
-void 	register_rdma_comm_buffer(struct context *rdma_ctx);
+void 	register_rdma_comm_buffer(struct semeru_rdma_queue *rdma_queue);
+
+// Warm restart, -XX:SemeruMemPoolFile
+bool  semeru_map_mem_pool_file(char* start, size_t size);
+bool  semeru_mem_pool_kept();
+bool  semeru_discard_memory(char* addr, size_t size);
+bool  semeru_mem_pool_odp();
+void  semeru_cxl_sync(const void* addr, size_t size);
+
+// Dead swap slots of the CPU server, INVALIDATE_PAGES
+bool  semeru_page_discarded(const void* addr);
+void  semeru_page_revive(const void* addr, size_t size);
+
+// The TCP transport of the CPU server, -XX:+SemeruTCPTransport
+void  semeru_start_tcp_server(int port);
+
+// Region state words, -XX:+SemeruRegionStateAtomics on the CPU server
+bool  semeru_rdma_atomic_glob();
+
+// NUMA placement, -XX:+SemeruNUMABind
+int   semeru_nic_numa_node();
+void  semeru_numa_bind_memory(char* addr, size_t size);
+void  semeru_numa_bind_thread();
 
 
 /**
@@ -26,9 +26,13 @@
 #include "memory/allocation.inline.hpp"
 #include "memory/resourceArea.hpp"
 #include "runtime/atomic.hpp"
+#include "utilities/align.hpp"
 #include "utilities/bitMap.inline.hpp"
 #include "utilities/copy.hpp"
 #include "utilities/debug.hpp"
+#if defined(AMD64) && defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 STATIC_ASSERT(sizeof(BitMap::bm_word_t) == BytesPerWord); // "Implementation assumption."
 
@@ -305,6 +309,41 @@ void BitMap::clear_large_range(idx_t beg, idx_t end) {
   clear_range_within_word(bit_index(end_full_word), end);
 }
 
+// Streaming stores of 16 bytes, SSE2 is in the x86_64 baseline. The write combining
+// buffers flush whole cache lines, wider stores don't change the memory traffic.
+static void clear_words_nontemporal(BitMap::bm_word_t* from, BitMap::bm_word_t* to) {
+#if defined(AMD64) && defined(__SSE2__)
+  while (from < to && !is_aligned(from, sizeof(__m128i))) {
+    *from++ = 0;
+  }
+  const __m128i zero = _mm_setzero_si128();
+  for (; from + 2 <= to; from += 2) {
+    _mm_stream_si128((__m128i*)from, zero);
+  }
+  // The streaming stores are weakly ordered, complete them before the marking.
+  _mm_sfence();
+#endif
+  while (from < to) {
+    *from++ = 0;
+  }
+}
+
+void BitMap::clear_large_range_nontemporal(idx_t beg, idx_t end) {
+  verify_range(beg, end);
+
+  idx_t beg_full_word = word_index_round_up(beg);
+  idx_t end_full_word = word_index(end);
+
+  if (is_small_range_of_words(beg_full_word, end_full_word)) {
+    clear_range(beg, end);
+    return;
+  }
+
+  clear_range_within_word(beg, bit_index(beg_full_word));
+  clear_words_nontemporal(_map + beg_full_word, _map + end_full_word);
+  clear_range_within_word(bit_index(end_full_word), end);
+}
+
 void BitMap::at_put(idx_t offset, bool value) {
   if (value) {
     set_bit(offset);
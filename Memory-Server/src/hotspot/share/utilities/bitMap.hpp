@@ -197,6 +197,8 @@ class BitMap {
 
   idx_t size() const          { return _size; }
   idx_t size_in_words() const { return calc_size_in_words(size()); }
+  // Semeru MS - Read only access to the words, for the scans of whole bitmap words.
+  const bm_word_t* words() const { return _map; }
   idx_t size_in_bytes() const { return calc_size_in_bytes(size()); }
 
   bool at(idx_t index) const {
@@ -236,6 +238,8 @@ class BitMap {
   void clear_range (idx_t beg, idx_t end);
   void set_large_range   (idx_t beg, idx_t end);
   void clear_large_range (idx_t beg, idx_t end);
+  // Semeru MS - clear_large_range() by non-temporal stores, the cleared words stay out of the caches.
+  void clear_large_range_nontemporal(idx_t beg, idx_t end);
   void at_put_range(idx_t beg, idx_t end, bool value);
   void par_at_put_range(idx_t beg, idx_t end, bool value);
   void at_put_large_range(idx_t beg, idx_t end, bool value);
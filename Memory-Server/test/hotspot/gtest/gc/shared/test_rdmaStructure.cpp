@@ -0,0 +1,315 @@
+/*
+ * Semeru - the RDMA structures of rdmaStructure.hpp.
+ *
+ * The structures are allocated at fixed addresses of the RDMA meta space in the JVM,
+ * here they are placed into C heap buffers of the same layout instead, the header
+ * followed by the content at the next page.
+ * The fake oops are never dereferenced, only their offsets to the covered Region are used.
+ */
+
+#include "precompiled.hpp"
+#include "gc/shared/rdmaStructure.inline.hpp"
+#include "memory/allocation.inline.hpp"
+#include "utilities/align.hpp"
+#include "utilities/bitMap.inline.hpp"
+#include "utilities/globalDefinitions.hpp"
+#include "unittest.hpp"
+
+// A page aligned, zeroed buffer, the same as the committed RDMA meta space.
+class RDMABuffer {
+  char* _raw;
+  char* _start;
+
+public:
+  RDMABuffer(size_t size) {
+    _raw = NEW_C_HEAP_ARRAY(char, size + PAGE_SIZE, mtGC);
+    _start = align_up(_raw, PAGE_SIZE);
+    memset(_start, 0, size);
+  }
+
+  ~RDMABuffer() { FREE_C_HEAP_ARRAY(char, _raw); }
+
+  char* start() const { return _start; }
+};
+
+// The covered Region of the tests, 256K words.
+static const size_t _region_words = 256 * K;
+static HeapWord* const _region_bottom = (HeapWord*)(SEMERU_START_ADDR + 64 * M);
+
+static oop fake_oop(size_t word) {
+  return cast_to_oop(_region_bottom + word);
+}
+
+static size_t popcount_words(size_t* words, size_t n) {
+  return BitMapView((BitMap::bm_word_t*)words, n * BitsPerWord).count_one_bits();
+}
+
+TEST_VM(BitQueue, push_and_clear) {
+  RDMABuffer buf(PAGE_SIZE + BitQueue::heap_words_to_bitmap_words(_region_words) * sizeof(size_t));
+  BitQueue* q = ::new (buf.start()) BitQueue(_region_words);
+  q->initialize(0, _region_bottom);
+
+  // Sparse, a few words.
+  q->push(fake_oop(0));
+  q->push(fake_oop(2));
+  q->push(fake_oop(64));
+  q->push(fake_oop(64));      // duplicate
+  EXPECT_EQ(2u, (uint)q->_num_words);
+  EXPECT_TRUE(q->is_sparse());
+  EXPECT_EQ((size_t)0x5, *q->getbyte(0));
+  EXPECT_EQ((size_t)0x1, *q->getbyte(64));
+  EXPECT_TRUE(q->is_page_dirty(0));
+  EXPECT_FALSE(q->is_page_dirty(1));
+
+  q->clear_bits();
+  EXPECT_EQ(0u, (uint)q->_num_words);
+  EXPECT_EQ((size_t)0, popcount_words(q->_target_bitmap, q->bitmap_words()));
+
+  // Dense, one mark per word of the whole bitmap, the list overflows to the summary.
+  for (size_t w = 0; w < q->bitmap_words(); w++) {
+    q->push(fake_oop(w * 64 + (w % 64)));
+  }
+  EXPECT_FALSE(q->is_sparse());
+  EXPECT_EQ(q->bitmap_words(), (size_t)q->_num_words);
+  EXPECT_EQ(q->bitmap_words(), popcount_words(q->_target_bitmap, q->bitmap_words()));
+  for (size_t p = 0; p < q->num_pages(); p++) {
+    EXPECT_TRUE(q->is_page_dirty(p)) << "page " << p;
+  }
+
+  q->reset();
+  EXPECT_EQ((size_t)0, popcount_words(q->_target_bitmap, q->bitmap_words()));
+
+  // Marked from root, the pushes are dropped.
+  q->_marked_from_root = true;
+  q->push(fake_oop(8));
+  EXPECT_EQ(0u, (uint)q->_num_words);
+}
+
+TEST_VM(HashQueue, push_dedup) {
+  const size_t tot = 1024;
+  RDMABuffer bitmap(BitQueue::heap_words_to_bitmap_words(_region_words) * sizeof(size_t));
+  RDMABuffer items(tot * sizeof(ElemPair));
+  RDMABuffer buf(sizeof(HashQueue));
+
+  // initialize() is left to the allocation site, set the fields by hand.
+  HashQueue* q = ::new (buf.start()) HashQueue((size_t*)bitmap.start());
+  q->_tot = tot;
+  q->_length = 0;
+  q->_base = _region_bottom;
+  q->_marked_from_root = false;
+  q->bitmap_st = 0;
+  q->_queue = (ElemPair*)items.start();
+  EXPECT_TRUE(q->is_empty());
+
+  for (size_t i = 0; i < 100; i++) {
+    q->push(fake_oop(i * 2), fake_oop(i * 2));
+    q->push(fake_oop(i * 2), fake_oop(i * 2));    // a second reference to the same target
+  }
+  ASSERT_EQ((size_t)100, q->length());
+  for (size_t i = 0; i < q->length(); i++) {
+    EXPECT_EQ((uint)(i * 2), q->retrieve_item(i)->from);
+  }
+
+  // The lookup is by the dedup bitmap, one bit per pushed target.
+  for (size_t i = 0; i < 200; i++) {
+    bool pushed = (i % 2) == 0;
+    EXPECT_EQ(pushed, ((*q->getbyte(i) >> (i % 64)) & 1) != 0) << "word " << i;
+  }
+  EXPECT_EQ(fake_oop(10), q->get(fake_oop(10)));
+
+  // Full, the later targets are dropped.
+  for (size_t i = 100; i < tot + 100; i++) {
+    q->push(fake_oop(i * 2), fake_oop(i * 2));
+  }
+  EXPECT_EQ(tot, q->length());
+}
+
+static size_t tasks_of(task_queue_chunk_zone* zone, uint32_t queue) {
+  size_t tasks = 0;
+  for (uint32_t i = 0; i < zone->_num_chunks; i++) {
+    if (zone->slot(i)->_queue == queue) {
+      tasks += zone->slot(i)->_used;
+    }
+  }
+  return tasks;
+}
+
+TEST_VM(TargetObjQueue, push_pop_steal_transfer) {
+  RDMABuffer buf(SEMERU_TASK_QUEUE_CHUNK_ZONE_SIZE);
+  task_queue_chunk_zone* zone = ::new (buf.start()) task_queue_chunk_zone();
+  const uint32_t num_chunks = zone->_num_chunks;
+  ASSERT_GT(num_chunks, 3u);
+  EXPECT_EQ(num_chunks, (uint32_t)zone->_num_free);
+
+  TargetObjQueue* owner = new TargetObjQueue();
+  TargetObjQueue* thief = new TargetObjQueue();
+  owner->initialize(zone);
+  thief->initialize(zone);
+  EXPECT_NE(owner->id(), thief->id());
+  EXPECT_TRUE(owner->is_empty());
+
+  // Two full chunks and a current one, the directory records their owner and used elements.
+  const size_t chunk = TargetObjQueue::ChunkElems;
+  const size_t n = 2 * chunk + 10;
+  for (size_t i = 1; i <= n; i++) {
+    EXPECT_TRUE(owner->push(StarTask((oop*)(i * HeapWordSize))));
+  }
+  EXPECT_EQ(n, (size_t)owner->size());
+  EXPECT_EQ(num_chunks - 3, (uint32_t)zone->_num_free);
+  EXPECT_EQ(n, tasks_of(zone, owner->id()));
+
+  // The most recently filled chunk is stolen whole, the current chunk never.
+  EXPECT_FALSE(owner->steal_chunk(owner));
+  ASSERT_TRUE(thief->steal_chunk(owner));
+  EXPECT_EQ(chunk, (size_t)thief->size());
+  EXPECT_EQ(n - chunk, (size_t)owner->size());
+  EXPECT_EQ(chunk, tasks_of(zone, thief->id()));
+
+  StarTask t;
+  ASSERT_TRUE(thief->pop_local(t));
+  EXPECT_EQ((oop*)(2 * chunk * HeapWordSize), (oop*)t);
+  ASSERT_TRUE(thief->steal_chunk(owner));
+  EXPECT_FALSE(thief->steal_chunk(owner));
+  EXPECT_EQ((size_t)10, (size_t)owner->size());
+
+  size_t popped = 1;
+  size_t sum = 2 * chunk;
+  while (owner->pop_local(t)) {
+    EXPECT_GT((size_t)(oop*)t, 2 * chunk * HeapWordSize);
+    sum += (size_t)(oop*)t / HeapWordSize;
+    popped++;
+  }
+  EXPECT_EQ((size_t)11, popped);
+  EXPECT_TRUE(owner->is_empty());
+
+  // The chunks are handed back to the owner, no chunk is taken and no task copied.
+  uint32_t num_free = zone->_num_free;
+  size_t remaining = thief->size();
+  thief->transfer_to(owner);
+  EXPECT_TRUE(thief->is_empty());
+  EXPECT_EQ(remaining, (size_t)owner->size());
+  EXPECT_EQ(num_free, (uint32_t)zone->_num_free);
+  EXPECT_EQ(remaining, tasks_of(zone, owner->id()));
+  EXPECT_EQ((size_t)0, tasks_of(zone, thief->id()));
+
+  while (owner->pop_local(t)) {
+    sum += (size_t)(oop*)t / HeapWordSize;
+    popped++;
+  }
+  EXPECT_EQ(n, popped);
+  EXPECT_EQ(n * (n + 1) / 2, sum);
+  EXPECT_TRUE(owner->is_empty());
+
+  delete owner;
+  delete thief;
+  EXPECT_EQ(num_chunks, (uint32_t)zone->_num_free);
+  EXPECT_EQ(0u, (uint32_t)zone->_num_spilled);
+}
+
+TEST_VM(MemoryServerCSet, add_pop_overflow) {
+  RDMABuffer buf(MEMORY_SERVER_CSET_SIZE);
+  received_memory_server_cset* cset = ::new (buf.start()) received_memory_server_cset();
+
+  for (int mem_id = 0; mem_id < MAX_NUM_OF_MEMORY_SERVER; mem_id++) {
+    EXPECT_EQ(0u, cset->num_of_enqueued_regions(mem_id));
+    EXPECT_EQ(-1, cset->pop(mem_id));
+  }
+
+  // Within the header slot, nothing to write from the overflow pages.
+  char* start;
+  cset->add(7, 1);
+  cset->add(9, 1);
+  EXPECT_EQ((size_t)0, cset->overflow_size(1, &start));
+  EXPECT_EQ((size_t)buf.start() + MEMORY_SERVER_CSET_HEADER_SIZE + MEMORY_SERVER_CSET_OVERFLOW_PAGES * PAGE_SIZE, (size_t)start);
+  EXPECT_EQ(0u, cset->num_of_enqueued_regions(0));
+  EXPECT_EQ(9, cset->pop(1));
+  EXPECT_EQ(7, cset->pop(1));
+  EXPECT_EQ(-1, cset->pop(1));
+
+  // Across the inline and overflow boundary, up to the full CSet.
+  const uint num = (uint)MEM_SERVER_CSET_REGION_NUM;
+  for (uint i = 0; i < num; i++) {
+    cset->add(i, 3);
+  }
+  EXPECT_EQ(num, cset->num_of_enqueued_regions(3));
+  EXPECT_EQ((num - MEM_SERVER_CSET_INLINE_REGIONS) * sizeof(uint), cset->overflow_size(3, &start));
+  EXPECT_EQ((uint)MEM_SERVER_CSET_INLINE_REGIONS, ((uint*)start)[0]);
+  for (uint i = 0; i < num; i++) {
+    EXPECT_EQ(i, cset->get(3, i));
+  }
+  EXPECT_EQ(0u, cset->num_of_enqueued_regions(2));
+  EXPECT_EQ(0u, cset->num_of_enqueued_regions(4));
+  for (int i = (int)num - 1; i >= 0; i--) {
+    EXPECT_EQ(i, cset->pop(3));
+  }
+
+  uint32_t seq = cset->seq(5);
+  cset->bump_seq(5);
+  EXPECT_EQ(seq + 1, cset->seq(5));
+  cset->add(1, 5);
+  cset->reset_cset_for_target_mem(5);
+  EXPECT_EQ(0u, cset->num_of_enqueued_regions(5));
+}
+
+TEST_VM(RemoteHeapHistogram, add_publish) {
+  RDMABuffer buf(HEAP_HISTOGRAM_SIZE_LIMIT);
+  remote_heap_histogram* histo = ::new (buf.start()) remote_heap_histogram();
+  EXPECT_GE((size_t)HEAP_HISTOGRAM_SIZE_LIMIT,
+            sizeof(remote_heap_histogram) + SEMERU_MAX_HISTOGRAM_KLASSES * sizeof(remote_heap_histogram::entry));
+
+  // Two klasses, hashed to the neighbouring slots of the table.
+  Klass* k1 = (Klass*)(SEMERU_START_ADDR + 8);
+  Klass* k2 = (Klass*)(SEMERU_START_ADDR + 16);
+  histo->clear_entries();
+  EXPECT_TRUE(histo->add(k1, 2));
+  EXPECT_TRUE(histo->add(k2, 4));
+  EXPECT_TRUE(histo->add(k1, 2));
+  histo->publish(1);
+  EXPECT_EQ(1u, (uint)histo->_done_seq);
+  ASSERT_EQ((size_t)2, (size_t)histo->_num_entries);
+  for (size_t i = 0; i < 2; i++) {
+    remote_heap_histogram::entry* e = &histo->_entries[i];
+    EXPECT_EQ(e->_klass == k1 ? (size_t)2 : (size_t)1, e->_count);
+    EXPECT_EQ((size_t)4, e->_words);
+  }
+
+  // More klasses than the entries, nothing is published.
+  histo->clear_entries();
+  for (size_t i = 1; i <= SEMERU_MAX_HISTOGRAM_KLASSES; i++) {
+    EXPECT_TRUE(histo->add((Klass*)(i * BytesPerWord), 1));
+  }
+  EXPECT_FALSE(histo->add((Klass*)((SEMERU_MAX_HISTOGRAM_KLASSES + 1) * BytesPerWord), 1));
+  histo->_overflow = 1;
+  histo->publish(2);
+  EXPECT_EQ(2u, (uint)histo->_done_seq);
+  EXPECT_EQ((size_t)0, (size_t)histo->_num_entries);
+}
+
+TEST_VM(RegionLivenessVector, publish) {
+  RDMABuffer buf(LIVENESS_VECTOR_SIZE_LIMIT);
+  region_liveness_vector* vec = ::new (buf.start()) region_liveness_vector(buf.start(), LIVENESS_VECTOR_SIZE_LIMIT);
+  EXPECT_EQ((size_t)32, sizeof(region_liveness_vector::entry));
+
+  region_liveness_vector::entry* e = &vec->_entries[5];
+  EXPECT_TRUE(region_liveness_vector::is_stable(e));
+  EXPECT_EQ(0u, (uint)e->_version);
+
+  vec->publish(5, true, 4096, 0.25);
+  EXPECT_TRUE(region_liveness_vector::is_stable(e));
+  EXPECT_EQ(2u, (uint)e->_version);
+  EXPECT_EQ(1u, e->_cm_scanned);
+  EXPECT_EQ((size_t)4096, e->_marked_alive_bytes);
+  EXPECT_EQ(0.25, e->_alive_ratio);
+
+  // A writer in the middle of the entry.
+  e->_version = 3;
+  EXPECT_FALSE(region_liveness_vector::is_stable(e));
+  e->_version = 4;
+  EXPECT_FALSE(region_liveness_vector::is_stable(e));
+  e->_version = 2;
+
+  vec->publish(5, false, 0, 0.0);
+  EXPECT_EQ(4u, (uint)e->_version);
+  EXPECT_EQ(0u, e->_cm_scanned);
+  EXPECT_EQ(0u, (uint)vec->_entries[4]._version);
+}
@@ -0,0 +1,395 @@
+/*
+ * Semeru - parallel micro-benchmarks of the RDMA structures in rdmaStructure.hpp.
+ *
+ * Like test_oopStorage_parperf.cpp, these "tests" mostly log the time of each
+ * worker with varying numbers of threads. They are the baseline for the
+ * concurrent paths the tracing threads hit:
+ *  BitQueue::push, the CAS on the bitmap word and the sparse list,
+ *  HashQueue::push, the dedup bitmap and the bump of _length,
+ *  TargetObjQueue, the owner push and pop against the chunk stealers,
+ *  received_memory_server_cset, one producer and consumer per memory server slot.
+ * The results are verified after each run, a regression of the algorithm fails the test.
+ */
+
+#include "precompiled.hpp"
+#include "gc/shared/rdmaStructure.inline.hpp"
+#include "gc/shared/workgroup.hpp"
+#include "memory/allocation.inline.hpp"
+#include "runtime/atomic.hpp"
+#include "runtime/interfaceSupport.inline.hpp"
+#include "runtime/os.hpp"
+#include "runtime/thread.hpp"
+#include "runtime/vmOperations.hpp"
+#include "runtime/vmThread.hpp"
+#include "utilities/align.hpp"
+#include "utilities/bitMap.inline.hpp"
+#include "utilities/debug.hpp"
+#include "utilities/ostream.hpp"
+#include "utilities/ticks.hpp"
+
+#include "unittest.hpp"
+
+const uint _max_workers = 10;
+static uint _num_workers = 0;
+
+// BitQueue and HashQueue, a 64MB Region with an object every 2 words.
+const size_t _region_words = 8 * M;
+const size_t _object_words = 2;
+const size_t _num_objects = _region_words / _object_words;
+static HeapWord* const _region_bottom = (HeapWord*)(SEMERU_START_ADDR + 64 * M);
+
+// TargetObjQueue, a few hundred chunks of the zone, the thieves take them whole.
+const size_t _num_tasks = 100000;
+
+// received_memory_server_cset, full CSets per memory server.
+const uint _cset_rounds = 200;
+
+class RDMAStructureParPerf : public ::testing::Test {
+public:
+  RDMAStructureParPerf();
+  ~RDMAStructureParPerf();
+
+  WorkGang* workers() const;
+
+  class VM_ParTime;
+  class Task;
+  class BitQueueTask;
+  class HashQueueTask;
+  class TaskQueueTask;
+  class CSetTask;
+
+  Tickspan run_task(Task* task, uint nthreads);
+  void show_task(const Task* task, Tickspan duration, uint nthreads);
+
+  template<typename T> void run_test(uint nthreads);
+  template<typename T> void run_tests();
+
+  static WorkGang* _workers;
+
+  // The page aligned, zeroed space of the structures, the same as the RDMA meta space.
+  static const size_t _space_size = 32 * M;
+  char* _raw;
+  char* _space;
+};
+
+WorkGang* RDMAStructureParPerf::_workers = NULL;
+
+WorkGang* RDMAStructureParPerf::workers() const {
+  if (_workers == NULL) {
+    WorkGang* wg = new WorkGang("RDMAStructureParPerf workers",
+                                _num_workers,
+                                false,
+                                false);
+    wg->initialize_workers();
+    wg->update_active_workers(_num_workers);
+    _workers = wg;
+  }
+  return _workers;
+}
+
+RDMAStructureParPerf::RDMAStructureParPerf() {
+  _raw = NEW_C_HEAP_ARRAY(char, _space_size + PAGE_SIZE, mtGC);
+  _space = align_up(_raw, PAGE_SIZE);
+  _num_workers = MIN2(_max_workers, (uint)os::processor_count());
+}
+
+RDMAStructureParPerf::~RDMAStructureParPerf() {
+  FREE_C_HEAP_ARRAY(char, _raw);
+}
+
+class RDMAStructureParPerf::VM_ParTime : public VM_GTestExecuteAtSafepoint {
+public:
+  VM_ParTime(WorkGang* workers, AbstractGangTask* task, uint nthreads) :
+    _workers(workers), _task(task), _nthreads(nthreads)
+  {}
+
+  void doit() {
+    _workers->run_task(_task, _nthreads);
+  }
+
+private:
+  WorkGang* _workers;
+  AbstractGangTask* _task;
+  uint _nthreads;
+};
+
+class RDMAStructureParPerf::Task : public AbstractGangTask {
+  Tickspan* _worker_times;
+
+protected:
+  char* _space;
+  uint _nthreads;
+
+  virtual void do_work(uint worker_id) = 0;
+
+public:
+  Task(const char* name, char* space, uint nthreads) :
+    AbstractGangTask(name),
+    _worker_times(NULL),
+    _space(space),
+    _nthreads(nthreads)
+  {
+    memset(space, 0, _space_size);
+    Tickspan* wtimes = NEW_C_HEAP_ARRAY(Tickspan, _num_workers, mtInternal);
+    for (uint i = 0; i < _num_workers; ++i) {
+      new (&wtimes[i]) Tickspan();
+    }
+    _worker_times = wtimes;
+  }
+
+  virtual ~Task() {
+    FREE_C_HEAP_ARRAY(Tickspan, _worker_times);
+  }
+
+  virtual void work(uint worker_id) {
+    Ticks start_time = Ticks::now();
+    do_work(worker_id);
+    _worker_times[worker_id] = Ticks::now() - start_time;
+  }
+
+  // Check the structure after the run.
+  virtual void verify() = 0;
+
+  const Tickspan* worker_times() const { return _worker_times; }
+};
+
+// The objects of a bitmap word are pushed by different threads, the worst case of the CAS.
+class RDMAStructureParPerf::BitQueueTask : public RDMAStructureParPerf::Task {
+  BitQueue* _queue;
+
+public:
+  BitQueueTask(char* space, uint nthreads) :
+    Task("RDMAStructureParPerf::BitQueueTask", space, nthreads)
+  {
+    STATIC_ASSERT(PAGE_SIZE + _region_words / BitsPerWord * sizeof(size_t) <= _space_size);
+    _queue = ::new (space) BitQueue(_region_words);
+    _queue->initialize(0, _region_bottom);
+  }
+
+  virtual void do_work(uint worker_id) {
+    for (size_t i = worker_id; i < _num_objects; i += _nthreads) {
+      _queue->push(cast_to_oop(_region_bottom + i * _object_words));
+    }
+  }
+
+  virtual void verify() {
+    size_t words = _queue->bitmap_words();
+    EXPECT_EQ(words, (size_t)_queue->_num_words);
+    EXPECT_EQ(_num_objects,
+              BitMapView((BitMap::bm_word_t*)_queue->_target_bitmap, words * BitsPerWord).count_one_bits());
+    for (size_t p = 0; p < _queue->num_pages(); p++) {
+      ASSERT_TRUE(_queue->is_page_dirty(p)) << "page " << p;
+    }
+  }
+};
+
+// Every thread pushes all the objects, from its own start, the dedup races on each of them.
+class RDMAStructureParPerf::HashQueueTask : public RDMAStructureParPerf::Task {
+  HashQueue* _queue;
+
+public:
+  HashQueueTask(char* space, uint nthreads) :
+    Task("RDMAStructureParPerf::HashQueueTask", space, nthreads)
+  {
+    size_t bitmap_bytes = _region_words / BitsPerWord * sizeof(size_t);
+    size_t queue_bytes = align_up(sizeof(HashQueue), PAGE_SIZE);
+    STATIC_ASSERT(_region_words / BitsPerWord * sizeof(size_t) + PAGE_SIZE + _num_objects * sizeof(ElemPair) <= _space_size);
+
+    // HashQueue::initialize() is left to the allocation site, set the fields by hand.
+    _queue = ::new (space + bitmap_bytes) HashQueue((size_t*)space);
+    _queue->_tot = _num_objects;
+    _queue->_length = 0;
+    _queue->_base = _region_bottom;
+    _queue->_marked_from_root = false;
+    _queue->bitmap_st = 0;
+    _queue->_queue = (ElemPair*)(space + bitmap_bytes + queue_bytes);
+  }
+
+  virtual void do_work(uint worker_id) {
+    size_t start = _num_objects / _nthreads * worker_id;
+    for (size_t i = 0; i < _num_objects; i++) {
+      size_t k = (start + i) % _num_objects;
+      oop obj = cast_to_oop(_region_bottom + k * _object_words);
+      _queue->push(obj, obj);
+    }
+  }
+
+  virtual void verify() {
+    ASSERT_EQ(_num_objects, _queue->length());
+    CHeapBitMap seen(_region_words);
+    for (size_t i = 0; i < _queue->length(); i++) {
+      size_t k = _queue->retrieve_item(i)->from;
+      ASSERT_LT(k, _region_words);
+      ASSERT_FALSE(seen.at(k)) << "duplicated item " << k;
+      seen.set_bit(k);
+    }
+  }
+};
+
+// Worker 0 pushes all the tasks to its queue and pops them back, the other workers steal its full chunks
+// into their own queues and drain them.
+class RDMAStructureParPerf::TaskQueueTask : public RDMAStructureParPerf::Task {
+  task_queue_chunk_zone* _zone;
+  TargetObjQueue*        _queues[_max_workers];
+  volatile size_t        _popped;
+  volatile size_t        _sum;
+  volatile uint          _stolen;
+
+  void consume(StarTask t) {
+    Atomic::add((size_t)(oop*)t / HeapWordSize, &_sum);
+    Atomic::add((size_t)1, &_popped);
+  }
+
+public:
+  TaskQueueTask(char* space, uint nthreads) :
+    Task("RDMAStructureParPerf::TaskQueueTask", space, nthreads),
+    _popped(0),
+    _sum(0),
+    _stolen(0)
+  {
+    STATIC_ASSERT(SEMERU_TASK_QUEUE_CHUNK_ZONE_SIZE <= _space_size);
+    _zone = ::new (space) task_queue_chunk_zone();
+    guarantee(_num_tasks / TargetObjQueue::ChunkElems < _zone->_num_chunks, "the tasks should fit the zone");
+    for (uint i = 0; i < _max_workers; i++) {
+      _queues[i] = new TargetObjQueue();
+      _queues[i]->initialize(_zone);
+    }
+  }
+
+  ~TaskQueueTask() {
+    for (uint i = 0; i < _max_workers; i++) {
+      delete _queues[i];
+    }
+  }
+
+  virtual void do_work(uint worker_id) {
+    TargetObjQueue* q = _queues[worker_id];
+    StarTask t;
+    if (worker_id == 0) {
+      for (size_t i = 1; i <= _num_tasks; i++) {
+        q->push(StarTask((oop*)(i * HeapWordSize)));
+      }
+      while (q->pop_local(t)) {
+        consume(t);
+      }
+    } else {
+      // The owner may not have started, steal until all the tasks are consumed.
+      while (_popped < _num_tasks) {
+        if (q->steal_chunk(_queues[0])) {
+          Atomic::inc(&_stolen);
+          while (q->pop_local(t)) {
+            consume(t);
+          }
+        } else {
+          SpinPause();
+        }
+      }
+    }
+  }
+
+  virtual void verify() {
+    EXPECT_EQ(_num_tasks, (size_t)_popped);
+    EXPECT_EQ(_num_tasks * (_num_tasks + 1) / 2, (size_t)_sum);
+    for (uint i = 0; i < _max_workers; i++) {
+      EXPECT_TRUE(_queues[i]->is_empty()) << "queue " << i;
+    }
+    if (_nthreads == 1) {
+      EXPECT_EQ(0u, (uint)_stolen);
+    }
+    // Only the chunks the queues still hold as their current one are out of the free list.
+    EXPECT_LE(_zone->_num_chunks - _max_workers, (uint32_t)_zone->_num_free);
+    EXPECT_EQ(0u, (uint32_t)_zone->_num_spilled);
+  }
+};
+
+// A worker produces and consumes full CSets of its memory servers, the slots share the header page.
+class RDMAStructureParPerf::CSetTask : public RDMAStructureParPerf::Task {
+  received_memory_server_cset* _cset;
+
+public:
+  CSetTask(char* space, uint nthreads) :
+    Task("RDMAStructureParPerf::CSetTask", space, nthreads)
+  {
+    STATIC_ASSERT(MEMORY_SERVER_CSET_SIZE <= _space_size);
+    _cset = ::new (space) received_memory_server_cset();
+  }
+
+  virtual void do_work(uint worker_id) {
+    for (size_t mem_id = worker_id; mem_id < MAX_NUM_OF_MEMORY_SERVER; mem_id += _nthreads) {
+      for (uint round = 0; round < _cset_rounds; round++) {
+        _cset->bump_seq(mem_id);
+        for (uint r = 0; r < MEM_SERVER_CSET_REGION_NUM; r++) {
+          _cset->add(r, (int)mem_id);
+        }
+        for (int r = (int)MEM_SERVER_CSET_REGION_NUM - 1; r >= 0; r--) {
+          guarantee(_cset->pop(mem_id) == r, "CSet of memory server[%lu] is corrupted", mem_id);
+        }
+      }
+    }
+  }
+
+  virtual void verify() {
+    for (size_t mem_id = 0; mem_id < MAX_NUM_OF_MEMORY_SERVER; mem_id++) {
+      EXPECT_EQ(0u, _cset->num_of_enqueued_regions(mem_id));
+      EXPECT_EQ(_cset_rounds, _cset->seq(mem_id));
+    }
+  }
+};
+
+Tickspan RDMAStructureParPerf::run_task(Task* task, uint nthreads) {
+  tty->print_cr("Running test with %u threads", nthreads);
+  VM_ParTime op(workers(), task, nthreads);
+  ThreadInVMfromNative invm(JavaThread::current());
+  Ticks start_time = Ticks::now();
+  VMThread::execute(&op);
+  return Ticks::now() - start_time;
+}
+
+void RDMAStructureParPerf::show_task(const Task* task, Tickspan duration, uint nthreads) {
+  tty->print_cr("Run %s with %u threads: " JLONG_FORMAT, task->name(), nthreads, duration.value());
+  const Tickspan* wtimes = task->worker_times();
+  for (uint i = 0; i < _num_workers; ++i) {
+    if (wtimes[i] != Tickspan()) {
+      tty->print_cr("  %u: " JLONG_FORMAT, i, wtimes[i].value());
+    }
+  }
+  tty->cr();
+}
+
+template<typename T>
+void RDMAStructureParPerf::run_test(uint nthreads) {
+  if (nthreads <= _num_workers) {
+    SCOPED_TRACE(err_msg("Running test with %u threads", nthreads).buffer());
+    T task(_space, nthreads);
+    Tickspan t = run_task(&task, nthreads);
+    show_task(&task, t, nthreads);
+    task.verify();
+  }
+}
+
+template<typename T>
+void RDMAStructureParPerf::run_tests() {
+  run_test<T>(1);
+  run_test<T>(2);
+  run_test<T>(3);
+  run_test<T>(4);
+  run_test<T>(6);
+  run_test<T>(8);
+  run_test<T>(10);
+}
+
+TEST_VM_F(RDMAStructureParPerf, bitqueue_push) {
+  run_tests<BitQueueTask>();
+}
+
+TEST_VM_F(RDMAStructureParPerf, hashqueue_push) {
+  run_tests<HashQueueTask>();
+}
+
+TEST_VM_F(RDMAStructureParPerf, taskqueue_push_pop_steal) {
+  run_tests<TaskQueueTask>();
+}
+
+TEST_VM_F(RDMAStructureParPerf, memory_server_cset) {
+  run_tests<CSetTask>();
+}
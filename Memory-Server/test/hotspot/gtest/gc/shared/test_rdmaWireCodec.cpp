@@ -0,0 +1,72 @@
+/*
+ * Semeru - the run-length coding of the wire buffers, rdmaWireCodec.hpp.
+ *
+ * The CPU server encodes, the memory server decodes, the same code on both sides.
+ */
+
+#include "precompiled.hpp"
+#include "gc/shared/rdmaWireCodec.hpp"
+#include "memory/allocation.inline.hpp"
+#include "utilities/globalDefinitions.hpp"
+#include "unittest.hpp"
+
+static void check_round_trip(const void* src, size_t bytes, size_t expected_max_words) {
+  size_t cap = bytes / sizeof(uint64_t) + 2;
+  uint64_t* encoded = NEW_C_HEAP_ARRAY(uint64_t, cap, mtGC);
+  char* decoded = NEW_C_HEAP_ARRAY(char, bytes + sizeof(uint64_t), mtGC);
+  memset(decoded, 0x5a, bytes + sizeof(uint64_t));
+
+  size_t words = SemeruWireCodec::encode(src, bytes, encoded, cap);
+  ASSERT_GT(words, 0u);
+  ASSERT_LE(words, expected_max_words);
+  ASSERT_TRUE(SemeruWireCodec::decode(encoded, words, decoded, bytes));
+  ASSERT_EQ(0, memcmp(src, decoded, bytes));
+  ASSERT_EQ(0x5a, decoded[bytes]);   // nothing written behind the range
+
+  FREE_C_HEAP_ARRAY(char, decoded);
+  FREE_C_HEAP_ARRAY(uint64_t, encoded);
+}
+
+TEST_VM(SemeruWireCodec, sparse_bitmap) {
+  const size_t n = 4096;
+  uint64_t* bitmap = NEW_C_HEAP_ARRAY(uint64_t, n, mtGC);
+  memset(bitmap, 0, n * sizeof(uint64_t));
+  bitmap[7]    = 0x10;
+  bitmap[8]    = 0x3;
+  bitmap[2000] = (uint64_t)1 << 63;
+  bitmap[n - 1] = 0xff;
+
+  // zero, literal of 2, zero, literal, zero, literal
+  check_round_trip(bitmap, n * sizeof(uint64_t), 10);
+  FREE_C_HEAP_ARRAY(uint64_t, bitmap);
+}
+
+TEST_VM(SemeruWireCodec, fill_runs_and_tail) {
+  const size_t bytes = 1000;   // not a multiple of words
+  char* bot = NEW_C_HEAP_ARRAY(char, bytes, mtGC);
+  memset(bot, 0x40, 600);
+  for (size_t i = 600; i < bytes; i++) {
+    bot[i] = (char)(i * 7);
+  }
+
+  check_round_trip(bot, bytes, bytes / sizeof(uint64_t));
+  FREE_C_HEAP_ARRAY(char, bot);
+}
+
+TEST_VM(SemeruWireCodec, no_room_and_corruption) {
+  uint64_t src[16];
+  uint64_t encoded[32];
+  uint64_t dst[16];
+  for (size_t i = 0; i < 16; i++) {
+    src[i] = i + 1;   // incompressible
+  }
+
+  ASSERT_EQ(0u, SemeruWireCodec::encode(src, sizeof(src), encoded, 16));
+  size_t words = SemeruWireCodec::encode(src, sizeof(src), encoded, 32);
+  ASSERT_EQ(17u, words);
+
+  ASSERT_FALSE(SemeruWireCodec::decode(encoded, words - 1, dst, sizeof(dst)));    // truncated literal
+  ASSERT_FALSE(SemeruWireCodec::decode(encoded, words, dst, sizeof(dst) - 8));    // longer than the range
+  encoded[0] |= (uint64_t)3 << SemeruWireCodec::KindShift;
+  ASSERT_FALSE(SemeruWireCodec::decode(encoded, words, dst, sizeof(dst)));        // unknown kind
+}
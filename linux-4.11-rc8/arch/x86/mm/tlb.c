@@ -370,6 +370,7 @@ out:
 		flush_tlb_others(mm_cpumask(mm), mm, start, end);
 	preempt_enable();
 }
+EXPORT_SYMBOL_GPL(flush_tlb_mm_range); // Semeru, the control path write-protects the synced user pages.
 
 void flush_tlb_page(struct vm_area_struct *vma, unsigned long start)
 {
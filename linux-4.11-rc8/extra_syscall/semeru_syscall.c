@@ -9,9 +9,67 @@
 
 // Develop syscall for this section
 #include <linux/swap_global_struct_mem_layer.h>
+#include <linux/swap_global_struct_bd_layer.h>
 #include <linux/swap.h>
 #include <asm/tlb.h>
 #include <linux/mm.h>
+#include <linux/mutex.h>
+#include <linux/vmalloc.h>
+#include <linux/sched/mm.h>
+#include <linux/workqueue.h>
+#include <linux/swapops.h>
+#include <linux/syscalls.h>
+#include <linux/mman.h>
+#include <linux/radix-tree.h>
+#include <linux/rmap.h>
+#include <linux/pagemap.h>
+#include <linux/memcontrol.h>
+#include <linux/mmu_notifier.h>
+
+
+// The address windows served by the Semeru module, module parameter address_windows.
+// Only the window 0 until the module is loaded. See swap_global_struct.h.
+unsigned int semeru_nr_windows = 1;
+EXPORT_SYMBOL(semeru_nr_windows);
+unsigned int semeru_windows[SEMERU_MAX_ADDRESS_WINDOWS];
+EXPORT_SYMBOL(semeru_windows);
+int semeru_window_slot[SEMERU_MAX_ADDRESS_WINDOWS] = { [0] = 0, [1 ... SEMERU_MAX_ADDRESS_WINDOWS - 1] = -1 };
+EXPORT_SYMBOL(semeru_window_slot);
+
+/**
+ * The slot of the window mapped by mm, the meta or data space of a JVM, -1 if mm maps none of the served ones.
+ * The control path requests without an address and the shared maps of a JVM go to its own window.
+ */
+int semeru_window_of_mm(struct mm_struct *mm)
+{
+	struct vm_area_struct *vma;
+	unsigned int slot;
+	int ret = -1;
+
+	if (mm == NULL)
+		return -1;
+
+	down_read(&mm->mmap_sem);
+	for (slot = 0; slot < READ_ONCE(semeru_nr_windows) && ret < 0; slot++) {
+		vma = find_vma(mm, semeru_meta_start(slot));
+		if (vma != NULL && vma->vm_start < semeru_data_start(slot) + RDMA_DATA_SPACE_SIZE)
+			ret = (int)slot;
+	}
+	up_read(&mm->mmap_sem);
+
+	return ret;
+}
+EXPORT_SYMBOL(semeru_window_of_mm);
+
+// The window of the calling JVM, for its shared maps.
+static int semeru_caller_window(const char *func)
+{
+	int window = semeru_window_of_mm(current->mm);
+
+	if (window < 0)
+		printk(KERN_ERR "%s, the caller maps no Semeru address window served by the module \n", func);
+	return window;
+}
 
 
 /**
@@ -26,6 +84,23 @@ int rdma_ops_wrapper(struct semeru_rdma_ops* module_defined_rdma_ops){
 		
 		rdma_ops_in_kernel.rdma_read = module_defined_rdma_ops->rdma_read;
 		rdma_ops_in_kernel.rdma_write = module_defined_rdma_ops->rdma_write;
+		rdma_ops_in_kernel.prefetch_hint = module_defined_rdma_ops->prefetch_hint;
+		rdma_ops_in_kernel.rdma_writev = module_defined_rdma_ops->rdma_writev;
+		rdma_ops_in_kernel.rdma_wait = module_defined_rdma_ops->rdma_wait;
+		rdma_ops_in_kernel.meta_reg = module_defined_rdma_ops->meta_reg;
+		rdma_ops_in_kernel.rdma_write_dirty = module_defined_rdma_ops->rdma_write_dirty;
+		rdma_ops_in_kernel.wait_mem_server = module_defined_rdma_ops->wait_mem_server;
+		rdma_ops_in_kernel.ring_doorbell = module_defined_rdma_ops->ring_doorbell;
+		rdma_ops_in_kernel.resize_chunks = module_defined_rdma_ops->resize_chunks;
+		rdma_ops_in_kernel.query_placement = module_defined_rdma_ops->query_placement;
+		rdma_ops_in_kernel.region_fence = module_defined_rdma_ops->region_fence;
+		rdma_ops_in_kernel.rdma_readv = module_defined_rdma_ops->rdma_readv;
+		rdma_ops_in_kernel.prefetch_range = module_defined_rdma_ops->prefetch_range;
+		rdma_ops_in_kernel.rdma_bcast = module_defined_rdma_ops->rdma_bcast;
+		rdma_ops_in_kernel.rdma_atomic = module_defined_rdma_ops->rdma_atomic;
+		rdma_ops_in_kernel.rdma_peek = module_defined_rdma_ops->rdma_peek;
+		rdma_ops_in_kernel.fetch_async = module_defined_rdma_ops->fetch_async;
+		rdma_ops_in_kernel.prefetch_ready = module_defined_rdma_ops->prefetch_ready;
 	}
 
 	return 0;
@@ -46,6 +121,56 @@ EXPORT_SYMBOL(rdma_ops_wrapper);
  * 		type 1, 1-sided rdma read;  
  *    		type 2, 1-sided rdma data write. Flush the dirty data to memory servers but keep data on CPU server;
  * 		type 3, 1-sided rdma signal write. Flush all the outstanding messages before issue signal;
+ * 		type 9, swap-in prefetch hint. target_server is the prefetch window in pages for [start_addr, start_addr + size).
+ * 				0 removes the hints overlapping the range, negative value prints and resets the prefetch statistics;
+ * 		type 10, vectored rdma write. start_addr points to a user array of struct semeru_rdma_iovec, size is the entry number.
+ * 				All the entries are chained and posted together, return after all of them are done;
+ * 		type 11, async vectored rdma write, the same as type 10 but return a ticket id without waiting;
+ * 		type 12, wait for the async vectored rdma write. target_server is the ticket id;
+ * 		type 13, register the meta space [start_addr, start_addr + size) for the control path. size 0 unregisters it;
+ * 		type 14, incremental rdma write. Only send the pages written since the last type 14 sync of the range.
+ * 				target_server -1 sends them to all the memory servers. Return the number of pages sent;
+ * 		type 15, wait for the state pushed by memory server target_server. size is the state, 0 resets it.
+ * 				Return 0 when the state is reached, -1 for timeout;
+ * 		type 16, ring the doorbell of memory server target_server. size is the sequence number;
+ * 		type 17, expand the remote memory chunks backing the data space [start_addr, start_addr + size);
+ * 		type 18, release the remote memory chunks fully covered by the data space [start_addr, start_addr + size);
+ * 		type 19, return the id of the memory server backing the data space address start_addr;
+ * 		type 20, fence the data space [start_addr, start_addr + size) for the concurrent compaction.
+ * 				target_server is the op, 0 grants, 1 closes and 2 releases the fence,
+ * 				3 drops the local compressed copies of a range the memory server rewrites.
+ * 				Return 1 if the closed range wasn't swapped in or out since the grant;
+ * 		type 21, vectored rdma read. start_addr points to a user array of struct semeru_rdma_iovec, size is the entry number.
+ * 				The write_type of the entries has to be 0. Return after all of them are done;
+ * 		type 22, share the swapped out pages with the JVM. [start_addr, start_addr + size) is a page aligned array of
+ * 				4 bytes counters, one for each (1 << target_server) bytes of the data space. size 0 unregisters it;
+ * 		type 23, evict the anonymous pages of [start_addr, start_addr + size) to the memory servers at once.
+ * 				target_server 0 returns the number of pages not paged out, non-zero queues the eviction and returns 0;
+ * 		type 24, wait for all the queued evictions of type 23. Return the number of pages they didn't page out;
+ * 		type 25, read the swapped out pages of [start_addr, start_addr + size) into the swap-in prefetch cache.
+ * 				Return the number of pages issued without waiting for them;
+ * 		type 26, broadcast rdma data write. Write [start_addr, start_addr + size) to the memory servers of the mask
+ * 				target_server, bit i for memory server i, 0 for all of them. Posted in parallel,
+ * 				return after all of them acknowledged;
+ * 		type 27, broadcast rdma signal write, the same as type 26 but each server is drained before its signal;
+ * 		type 28, rdma atomic on an 8 bytes word of the meta space of memory server target_server.
+ * 				start_addr points to a user struct semeru_rdma_atomic, the old value is written back to its result;
+ * 		type 29, read a few bytes of a swapped out data page without swapping it in. start_addr points to a user
+ * 				struct semeru_rdma_peek. Return 1 if the page is resident, the caller loads the bytes itself;
+ * 		type 30, share the reclaim hints of the JVM. [start_addr, start_addr + size) is a page aligned array of
+ * 				1 byte hints, one for each (1 << target_server) bytes of the data space. size 0 unregisters it;
+ * 		type 31, discard [start_addr, start_addr + size) of the data space, freed by the JVM. The local pages are
+ * 				lazily freed and the swap entries dropped. Return the number of swap entries freed;
+ * 		type 33, a fault without waiting. Read the swapped out pages of [start_addr, start_addr + size) into the
+ * 				swap-in prefetch cache, at most 64 pages. Return the number of them still on the fly,
+ * 				0 if touching the range doesn't wait for a memory server;
+ * 		type 34, fault-around. Map the swapped out pages of [start_addr, start_addr + size) already in the swap cache
+ * 				or the swap-in prefetch cache in one pass. Return the number of pages mapped;
+ * 		type 35, local cache limit. Return the memory cgroup limit of the caller in MB, 0 if unlimited.
+ * 				target_server > 0 evicts the cold Regions of [start_addr, start_addr + size) every
+ * 				target_server ms while the cgroup is close to the limit, 0 stops it;
+ * 		type 36, share the swap-ins with the JVM. The same as type 22, but each counter is the number of pages
+ * 				of its unit read back from the memory servers so far;
  * 		target_server : the id of memory server
  * 		start_addr,
  * 		size, 		4KB alignment
@@ -55,6 +180,7 @@ EXPORT_SYMBOL(rdma_ops_wrapper);
 asmlinkage int sys_do_semeru_rdma_ops(int type, int target_server, char __user *start_addr, unsigned long size)
 {
 	char *ret;
+	int write_ret;
 	int write_type;
 	int cpu;
 
@@ -159,6 +285,170 @@ asmlinkage int sys_do_semeru_rdma_ops(int type, int target_server, char __user *
 		// yifan: user needs to resume data path swap out after doing
 		// control path operations.
 		control_path_flush_done();
+	} else if (type == 9) {
+		// The JVM hints the range it's going to scan, e.g. the Regions in CSet.
+		// Reuse target_server as the prefetch window.
+		if (rdma_ops_in_kernel.prefetch_hint != NULL) {
+			return rdma_ops_in_kernel.prefetch_hint(target_server, start_addr, size);
+		} else {
+			printk("rdma_ops_in_kernel.prefetch_hint is NULL. Can't execute it. \n");
+		}
+	} else if (type == 10 || type == 11) {
+		// vectored rdma write, sync or async
+		return semeru_rdma_writev_from_user(start_addr, size, type == 11);
+	} else if (type == 12) {
+		// wait for an async vectored rdma write
+		if (rdma_ops_in_kernel.rdma_wait != NULL) {
+			return rdma_ops_in_kernel.rdma_wait(target_server);
+		} else {
+			printk("rdma_ops_in_kernel.rdma_wait is NULL. Can't execute it. \n");
+			return -1;
+		}
+	} else if (type == 13) {
+		// register the meta space
+		if (rdma_ops_in_kernel.meta_reg != NULL) {
+			return rdma_ops_in_kernel.meta_reg(start_addr, size);
+		} else {
+			printk("rdma_ops_in_kernel.meta_reg is NULL. Can't execute it. \n");
+			return -1;
+		}
+	} else if (type == 14) {
+		// incremental rdma write
+		if (rdma_ops_in_kernel.rdma_write_dirty != NULL) {
+			// Like type 2, pause the data path swap-out during the flush.
+			prepare_control_path_flush();
+			write_ret = rdma_ops_in_kernel.rdma_write_dirty(target_server, start_addr, size);
+			control_path_flush_done();
+
+			return write_ret;
+		} else {
+			printk("rdma_ops_in_kernel.rdma_write_dirty is NULL. Can't execute it. \n");
+			return -1;
+		}
+	} else if (type == 15) {
+		// wait for the memory server state
+		if (rdma_ops_in_kernel.wait_mem_server != NULL) {
+			return rdma_ops_in_kernel.wait_mem_server(target_server, (int)size);
+		} else {
+			printk("rdma_ops_in_kernel.wait_mem_server is NULL. Can't execute it. \n");
+			return -1;
+		}
+	} else if (type == 16) {
+		// ring the doorbell of the memory server
+		if (rdma_ops_in_kernel.ring_doorbell != NULL) {
+			return rdma_ops_in_kernel.ring_doorbell(target_server, (unsigned int)size);
+		} else {
+			printk("rdma_ops_in_kernel.ring_doorbell is NULL. Can't execute it. \n");
+			return -1;
+		}
+	} else if (type == 17 || type == 18) {
+		// expand or release the remote memory chunks
+		if (rdma_ops_in_kernel.resize_chunks != NULL) {
+			return rdma_ops_in_kernel.resize_chunks(start_addr, size, type == 17);
+		} else {
+			printk("rdma_ops_in_kernel.resize_chunks is NULL. Can't execute it. \n");
+			return -1;
+		}
+	} else if (type == 19) {
+		// query the data Region placement
+		if (rdma_ops_in_kernel.query_placement != NULL) {
+			return rdma_ops_in_kernel.query_placement(start_addr);
+		} else {
+			printk("rdma_ops_in_kernel.query_placement is NULL. Can't execute it. \n");
+			return -1;
+		}
+	} else if (type == 20) {
+		// fence the Region for the concurrent compaction
+		if (rdma_ops_in_kernel.region_fence != NULL) {
+			return rdma_ops_in_kernel.region_fence(target_server, start_addr, size);
+		} else {
+			printk("rdma_ops_in_kernel.region_fence is NULL. Can't execute it. \n");
+			return -1;
+		}
+	} else if (type == 21) {
+		// vectored rdma read
+		return semeru_rdma_readv_from_user(start_addr, size);
+	} else if (type == 22) {
+		// register the swap out map shared with the JVM
+		return semeru_swap_out_map_register(target_server, start_addr, size);
+	} else if (type == 23) {
+		// bulk eviction, target_server is 0 for sync, non-zero for async
+		return semeru_bulk_evict(target_server, start_addr, size);
+	} else if (type == 24) {
+		// wait for the async bulk evictions
+		return semeru_bulk_evict_wait();
+	} else if (type == 25) {
+		// prefetch a range before it's touched
+		if (rdma_ops_in_kernel.prefetch_range != NULL) {
+			return rdma_ops_in_kernel.prefetch_range(start_addr, size);
+		} else {
+			printk("rdma_ops_in_kernel.prefetch_range is NULL. Can't execute it. \n");
+			return -1;
+		}
+	} else if (type == 26 || type == 27) {
+		// broadcast rdma write, data or signal
+		if (rdma_ops_in_kernel.rdma_bcast != NULL) {
+			write_type = (type == 27); // signal write
+			// Like type 2, pause the data path swap-out during a data flush.
+			if (!write_type)
+				prepare_control_path_flush();
+			write_ret = rdma_ops_in_kernel.rdma_bcast(target_server, write_type, start_addr, size);
+			if (!write_type)
+				control_path_flush_done();
+
+			if (unlikely(write_ret)) {
+				printk(KERN_ERR "%s, broadcast rdma write [0x%lx, 0x%lx) to mask 0x%x failed. ", __func__,
+				       (unsigned long)start_addr, (unsigned long)(start_addr + size), target_server);
+			}
+			return write_ret;
+		} else {
+			printk("rdma_ops_in_kernel.rdma_bcast is NULL. Can't execute it. \n");
+			return -1;
+		}
+	} else if (type == 28) {
+		// rdma atomic, CAS or fetch-and-add
+		return semeru_rdma_atomic_from_user(target_server, start_addr);
+	} else if (type == 29) {
+		// rdma peek, a sub-page read of a swapped out page
+		return semeru_rdma_peek_from_user(start_addr);
+	} else if (type == 30) {
+		// register the reclaim hints of the JVM
+		return semeru_reclaim_hint_register(target_server, start_addr, size);
+	} else if (type == 31) {
+		// discard the freed Regions
+		return semeru_discard_range(start_addr, size);
+	} else if (type == 32) {
+		// heap snapshot, target_server is the op
+		return semeru_heap_snapshot(target_server, start_addr, size);
+	} else if (type == 33) {
+		// non-blocking fetch, the caller runs other work until it returns 0
+		if (rdma_ops_in_kernel.fetch_async != NULL) {
+			return rdma_ops_in_kernel.fetch_async(start_addr, size);
+		} else {
+			printk("rdma_ops_in_kernel.fetch_async is NULL. Can't execute it. \n");
+			return -1;
+		}
+	} else if (type == 34) {
+		// map the arrived pages of the range
+		return semeru_fault_around_range(start_addr, size);
+	} else if (type == 35) {
+		// the memory cgroup limit, and the proactive eviction under it
+		return semeru_cache_limit_register(target_server, start_addr, size);
+	} else if (type == 36) {
+		// register the swap-in counters of the JVM
+		return semeru_swap_in_map_register(target_server, start_addr, size);
+	} else if (type == 37) {
+		// drop the local copies of the pages rewritten by the memory servers
+		return semeru_invalidate_rewritten(start_addr, size);
+	} else if (type == 38) {
+		// the page affinity of the data space, for the prefetch
+		return semeru_page_affinity_register(start_addr, size);
+	} else if (type == 39) {
+		// the remote faults of the JVM threads, target_server is the op
+		return semeru_fault_state_register(target_server, start_addr, size);
+	} else if (type == 40) {
+		// the sampled swap-ins of the JVM, target_server is the period
+		return semeru_fault_sample_register(target_server, start_addr, size);
 	} else {
 		// wrong types
 		printk("%s, wrong type. \n", __func__);
@@ -167,194 +457,1912 @@ asmlinkage int sys_do_semeru_rdma_ops(int type, int target_server, char __user *
 	return 0;
 }
 
-//
-// Functions for swap ratio monitor
-//
-
 /**
- * Semeru CPU, reset array initial value to 0.
- * 
- * 	return 0 , succ,
- * 				-1 , error. 
+ * Copy the user iovec into kernel.
  * 
+ * return :
+ * 	the kmalloc'ed kernel copy, NULL for error.
  */
-asmlinkage int sys_swap_stat_reset_and_check(u64 start_vaddr, u64 bytes_len)
+static struct semeru_rdma_iovec *semeru_rdma_iov_from_user(char __user *iov_addr, unsigned long nr_iov)
 {
-	u32 i;
-
-	//printk(KERN_INFO"%s, reset swap out monitor information. \n", __func__);
-
-	// 1) reset on-demand swapin counter.
-	reset_swap_info();
-	printk(KERN_INFO "%s, ater reset, on_demand_swapin_number 0x%x \n", __func__, get_on_demand_swapin_number());
-
-// 2) the [buff, buff+ bytes_len) must fall into the cover of the array.
-//
-#ifdef DEBUG_SERVER_HOME
-	if (within_range(start_vaddr)) {
-		for (i = 0; i < SWAP_OUT_MONITOR_ARRAY_LEN; i++) {
-			//jvm_region_swap_out_counter[i] = 0;
-			atomic_set(&jvm_region_swap_out_counter[i], 0);
-		}
+	struct semeru_rdma_iovec *iov;
 
-		return 0;
-	} // end of if.
-#else
-	if ((u64)start_vaddr >= SWAP_OUT_MONITOR_VADDR_START &&
-	    bytes_len <= (u64)(SWAP_OUT_MONITOR_ARRAY_LEN * (1 << SWAP_OUT_MONITOR_UNIT_LEN_LOG))) {
-		for (i = 0; i < SWAP_OUT_MONITOR_ARRAY_LEN; i++) {
-			//jvm_region_swap_out_counter[i] = 0;
-			atomic_set(&jvm_region_swap_out_counter[i], 0);
-		}
+	if (nr_iov == 0 || nr_iov > SEMERU_RDMA_IOV_MAX) {
+		printk(KERN_ERR "%s, wrong iovec entry number %lu, at most %d. \n", __func__, nr_iov,
+		       SEMERU_RDMA_IOV_MAX);
+		return NULL;
+	}
 
-		printk(KERN_INFO "%s, Region monitoring, reset jvm_region_swap_out_counter[] to 0 \n", __func__);
+	iov = kmalloc_array(nr_iov, sizeof(struct semeru_rdma_iovec), GFP_KERNEL);
+	if (unlikely(iov == NULL)) {
+		printk(KERN_ERR "%s, allocate kernel iovec failed. \n", __func__);
+		return NULL;
+	}
 
-		return 0;
-	} // end of if.
-#endif
+	if (copy_from_user(iov, iov_addr, nr_iov * sizeof(struct semeru_rdma_iovec))) {
+		printk(KERN_ERR "%s, copy iovec 0x%lx from user failed. \n", __func__, (unsigned long)iov_addr);
+		kfree(iov);
+		return NULL;
+	}
 
-	printk(KERN_ERR "%s, [0x%llx, 0x%llx) exceed the swap out array range [0x%llx, 0x%llx),  ", __func__,
-	       (u64)start_vaddr, (u64)(start_vaddr + bytes_len), (u64)SWAP_OUT_MONITOR_VADDR_START,
-	       (u64)(SWAP_OUT_MONITOR_VADDR_START + SWAP_OUT_MONITOR_ARRAY_LEN * (1 << SWAP_OUT_MONITOR_UNIT_LEN_LOG)));
-	return -1;
+	return iov;
 }
 
 /**
- * Semeru CPU : get the swapped out pages number.
- * Because we can't use any FPU in kernel, return the number of swapped pages. 
+ * Copy the iovec into kernel and post all the entries by one module call.
  * 
- * Warning : For a not-full Region. Using swapped-out pages to calculate cached-paged ratio is not that accurate.
+ * Like type 2, the data path swap-out is paused while the entries are being posted.
+ * An async vector resumes it before the packages finish, its pages stay pinned by the ticket till then.
  * 
+ * return :
+ * 	sync : 0 for success;
+ * 	async : the ticket id;
+ * 	-1 for error.
  */
-asmlinkage u64 sys_num_of_swap_out_pages(u64 start_vaddr, u64 bytes_len){
-	return swap_out_pages_for_range(start_vaddr, start_vaddr + bytes_len);
-}
+int semeru_rdma_writev_from_user(char __user *iov_addr, unsigned long nr_iov, int async)
+{
+	int ret;
+	struct semeru_rdma_iovec *iov;
+
+	if (rdma_ops_in_kernel.rdma_writev == NULL) {
+		printk("rdma_ops_in_kernel.rdma_writev is NULL. Can't execute it. \n");
+		return -1;
+	}
+
+	iov = semeru_rdma_iov_from_user(iov_addr, nr_iov);
+	if (iov == NULL)
+		return -1;
 
+	// wait the exit of all the threads within swap zone
+	prepare_control_path_flush();
+	ret = rdma_ops_in_kernel.rdma_writev(iov, (int)nr_iov, async);
+	control_path_flush_done(); // reset cp flushing flag despite the write results
+
+	if (unlikely(ret < 0)) {
+		printk(KERN_ERR "%s, vectored rdma write of %lu entries failed. \n", __func__, nr_iov);
+	}
 
+	kfree(iov);
+	return ret;
+}
 
 /**
- * Semeru CPU, get the on-demand swapin number.
- * 						For each on-demand swapin operation, it may load multiple pages into Swap Cache.
- * Syscall id, 337
- *  
- * Warning : Some pages are prefetched into CPU DRAM. However, we can't count them accurately right now.
+ * Copy the iovec into kernel and read all the entries by one module call.
+ * 
+ * Like type 1, a read doesn't pause the data path.
  * 
+ * return :
+ * 	0 for success, -1 for error.
  */
-asmlinkage int sys_num_of_on_demand_swapin(void){
+int semeru_rdma_readv_from_user(char __user *iov_addr, unsigned long nr_iov)
+{
+	int ret;
+	struct semeru_rdma_iovec *iov;
 
-	printk(KERN_INFO"%s, on-demand swapin page number : %d \n", __func__, get_on_demand_swapin_number());
-	printk(KERN_INFO"%s, prefetch swapin page number : %d \n", __func__, get_prefetch_swapin_number());
-	printk(KERN_INFO"%s, hit on swap cache page number : %d \n\n", __func__, get_hit_on_swap_cache_number());
-	
-	return get_on_demand_swapin_number();
-}
+	if (rdma_ops_in_kernel.rdma_readv == NULL) {
+		printk("rdma_ops_in_kernel.rdma_readv is NULL. Can't execute it. \n");
+		return -1;
+	}
 
+	iov = semeru_rdma_iov_from_user(iov_addr, nr_iov);
+	if (iov == NULL)
+		return -1;
+
+	ret = rdma_ops_in_kernel.rdma_readv(iov, (int)nr_iov);
+	if (unlikely(ret < 0)) {
+		printk(KERN_ERR "%s, vectored rdma read of %lu entries failed. \n", __func__, nr_iov);
+	}
 
+	kfree(iov);
+	return ret;
+}
 
 /**
- * Copy data to between user space and kernel space.
- *  
+ * Copy the user struct semeru_rdma_atomic into kernel, execute it and copy the old value back.
+ *
+ * return :
+ * 	0 for success, -1 for error.
  */
-asmlinkage int sys_test_syscall(char* __user *buff, uint64_t len){
-	int ret = 0;
-	uint64_t i;
+int semeru_rdma_atomic_from_user(int mem_server_id, char __user *atomic_addr)
+{
+	struct semeru_rdma_atomic atomic;
 
+	if (rdma_ops_in_kernel.rdma_atomic == NULL) {
+		printk("rdma_ops_in_kernel.rdma_atomic is NULL. Can't execute it. \n");
+		return -1;
+	}
 
-	char* kernel_buf = kzalloc(PAGE_SIZE, GFP_KERNEL);
-	
-	for(i=0; i<PAGE_SIZE/sizeof(uint64_t); i++ ){
-		((uint64_t*)kernel_buf)[i] = 1;
+	if (copy_from_user(&atomic, atomic_addr, sizeof(struct semeru_rdma_atomic))) {
+		printk(KERN_ERR "%s, copy the rdma atomic from 0x%lx failed. \n", __func__, (unsigned long)atomic_addr);
+		return -1;
 	}
 
-	printk(KERN_INFO "%s, Before copy_from_user, first uint64_t kernel_buf value: 0x%llx \n", 
-																																					__func__,
-																												 									*((uint64_t*)kernel_buf));
+	if (unlikely(rdma_ops_in_kernel.rdma_atomic(mem_server_id, &atomic)))
+		return -1;
 
-	//1) copy data from user space to kernel space	
-	if(len > PAGE_SIZE){
-		len = PAGE_SIZE;
+	if (put_user(atomic.result, &((struct semeru_rdma_atomic __user *)atomic_addr)->result)) {
+		printk(KERN_ERR "%s, copy the old value back to 0x%lx failed. \n", __func__, (unsigned long)atomic_addr);
+		return -1;
 	}
-	
-	// void *to, const void __user *from, unsigned long n
-  ret = copy_from_user(kernel_buf, buff, len);
-	if(ret!=0){
-		printk(KERN_ERR "%s, %d bytes are not copied in copy_from_user. \n", __func__, ret);
-		goto err;
+
+	return 0;
+}
+
+/**
+ * Copy the user struct semeru_rdma_peek into kernel, read the bytes into a kernel buffer and copy them to the user.
+ *
+ * return :
+ * 	0 for success, 1 if the page is resident, -1 for error.
+ */
+int semeru_rdma_peek_from_user(char __user *peek_addr)
+{
+	struct semeru_rdma_peek peek;
+	char *kbuf; // the RDMA device writes it, can't be on the stack
+	int ret;
+
+	if (rdma_ops_in_kernel.rdma_peek == NULL) {
+		return 1; // the normal load still works
 	}
 
-	printk(KERN_INFO "%s, After copy_from_user, first uint64_t kernel_buf value: 0x%llx \n", 
-																																					__func__,
-																												 									*((uint64_t*)kernel_buf));
+	if (copy_from_user(&peek, peek_addr, sizeof(struct semeru_rdma_peek))) {
+		printk(KERN_ERR "%s, copy the rdma peek from 0x%lx failed. \n", __func__, (unsigned long)peek_addr);
+		return -1;
+	}
+	if (unlikely(peek.size == 0 || peek.size > SEMERU_RDMA_PEEK_MAX_SIZE)) {
+		printk(KERN_ERR "%s, wrong peek size %lu. \n", __func__, peek.size);
+		return -1;
+	}
 
+	kbuf = kmalloc(peek.size, GFP_KERNEL);
+	if (unlikely(kbuf == NULL))
+		return -1;
 
-	// 2) Copy data to user space
-	// rseet the value.
-	for(i=0; i<PAGE_SIZE/sizeof(uint64_t); i++ ){
-		((uint64_t*)kernel_buf)[i] = 1;
+	ret = rdma_ops_in_kernel.rdma_peek(peek.addr, kbuf, peek.size);
+	if (ret == 0 && copy_to_user(peek.buf, kbuf, peek.size)) {
+		printk(KERN_ERR "%s, copy the peeked bytes to 0x%lx failed. \n", __func__, (unsigned long)peek.buf);
+		ret = -1;
 	}
 
-	// void __user *to, const void *from, unsigned long n
-	ret = copy_to_user(buff, kernel_buf, len);
-	if(ret!=0){
-		printk(KERN_ERR "%s, %d bytes are not copied in copy_to_user. \n", __func__, ret);
+	kfree(kbuf);
+	return ret;
+}
+
+//
+// Functions for swap ratio monitor
+//
+
+/**
+ * Pin the page aligned user array [start_addr, start_addr + nr_pages * PAGE_SIZE) and map it into kernel space.
+ * Shared by the JVM and the kernel, e.g. the swap out map and the reclaim hints.
+ *
+ * return the kernel address and the pinned pages in *pages, NULL for error.
+ */
+static void *semeru_pin_user_array(char __user *start_addr, unsigned long nr_pages, int write, struct page ***pages)
+{
+	struct page **pinned_pages;
+	long pinned;
+	void *addr;
+
+	pinned_pages = kmalloc_array(nr_pages, sizeof(struct page *), GFP_KERNEL);
+	if (pinned_pages == NULL)
+		return NULL;
+
+	pinned = get_user_pages_fast((unsigned long)start_addr, nr_pages, write, pinned_pages);
+	if (pinned != nr_pages)
 		goto err;
-	}
+
+	addr = vmap(pinned_pages, nr_pages, VM_MAP, PAGE_KERNEL);
+	if (addr == NULL)
+		goto err;
+
+	*pages = pinned_pages;
+	return addr;
 
 err:
-	return ret;
+	printk(KERN_ERR "%s, pin [0x%lx, 0x%lx) failed, %ld pages pinned \n", __func__, (unsigned long)start_addr,
+	       (unsigned long)(start_addr + (nr_pages << PAGE_SHIFT)), pinned);
+	while (pinned > 0)
+		put_page(pinned_pages[--pinned]);
+	kfree(pinned_pages);
+	return NULL;
 }
 
+static void semeru_unpin_user_array(void *addr, struct page **pages, unsigned long nr_pages)
+{
+	unsigned long i;
+
+	vunmap(addr);
+	for (i = 0; i < nr_pages; i++)
+		put_page(pages[i]);
+	kfree(pages);
+}
 
+struct swap_out_shared_map __rcu *swap_out_shared_map[SEMERU_MAX_ADDRESS_WINDOWS];
+struct swap_out_shared_map __rcu *swap_in_shared_map[SEMERU_MAX_ADDRESS_WINDOWS];
+EXPORT_SYMBOL(swap_in_shared_map); // updated by the frontswap load of the Semeru module
+static DEFINE_MUTEX(swap_out_shared_map_lock); // both of the maps
 
+static void swap_out_shared_map_free(struct swap_out_shared_map *map)
+{
+	semeru_unpin_user_array(map->counters, map->pages, map->nr_pages);
+	kfree(map);
+}
 
 /**
- * @brief only anonmous data can be paged out.
- * 
- * @param vma 
- * @return true : can be swapped out
- * @return false : can not be swapped out
+ * The owner of the swap out and swap in maps, per address window.
+ *
+ * The mmu notifier follows the teardown of the registering mm, its release unpins the maps of the window
+ * even if the JVM exits without unregistering them. The notifier holds the mm_struct, so shared_map_mm can't be
+ * reused by another process, until the notifier is unregistered at the registration of another process.
+ * The owner changes are serialized by shared_map_owner_lock, taken before swap_out_shared_map_lock.
  */
-static inline bool can_do_swapout(struct vm_area_struct *vma)
+static struct mmu_notifier shared_map_mn[SEMERU_MAX_ADDRESS_WINDOWS];
+static struct mm_struct *shared_map_mm[SEMERU_MAX_ADDRESS_WINDOWS]; // NULL if the notifier isn't registered.
+static DEFINE_MUTEX(shared_map_owner_lock);
+
+static void shared_map_release_all(int window)
 {
-	return vma && vma_is_anonymous(vma);
+	struct swap_out_shared_map *out, *in;
+
+	mutex_lock(&swap_out_shared_map_lock);
+	out = rcu_dereference_protected(swap_out_shared_map[window], lockdep_is_held(&swap_out_shared_map_lock));
+	in = rcu_dereference_protected(swap_in_shared_map[window], lockdep_is_held(&swap_out_shared_map_lock));
+	RCU_INIT_POINTER(swap_out_shared_map[window], NULL);
+	RCU_INIT_POINTER(swap_in_shared_map[window], NULL);
+	mutex_unlock(&swap_out_shared_map_lock);
+
+	if (out == NULL && in == NULL)
+		return;
+
+	synchronize_rcu();
+	if (out != NULL)
+		swap_out_shared_map_free(out);
+	if (in != NULL)
+		swap_out_shared_map_free(in);
+	printk(KERN_INFO "%s, window %d, the shared maps of the exited JVM are unpinned \n", __func__, window);
 }
 
+/**
+ * exit_mmap() of the registering mm. Only the swap path may still update the maps, under RCU.
+ */
+static void shared_map_mn_release(struct mmu_notifier *mn, struct mm_struct *mm)
+{
+	shared_map_release_all((int)(mn - shared_map_mn));
+}
 
+static const struct mmu_notifier_ops shared_map_mn_ops = {
+	.release = shared_map_mn_release,
+};
 
 /**
- * @brief Force swapping out the spcificed virtual address range
- * 
- * @param vma 
- * @param prev 
- * @param start_addr 
- * @param end_addr 
- * @return int 
- * 	0: all the spcificed pages are paged out
- * 	negative value : error code
- * 	positive value : the number of pages are not paged out 
+ * Make current->mm the owner of the window's maps. The maps of a previous owner are released.
+ * Invoked with shared_map_owner_lock held.
  */
-int semeru_force_swapout(unsigned long start_addr, unsigned long end_addr)
+static int shared_map_follow_mm(int window)
 {
-	struct mm_struct *mm = current->mm; // current points to the the caller process.
-	struct vm_area_struct *vma = find_vma(mm, start_addr);
-	struct mmu_gather tlb;
-	int ret = 0;
+	int ret;
 
-	if (!can_do_swapout(vma)) {
-		pr_warn("vma %p for range [0x%lx, 0x%lx) cannot be swapped out!",
-			vma, start_addr, end_addr);
+	if (shared_map_mm[window] == current->mm)
 		return 0;
+
+	if (shared_map_mm[window] != NULL) {
+		// Invokes the release if the mm is still alive, then drops the mm_struct.
+		mmu_notifier_unregister(&shared_map_mn[window], shared_map_mm[window]);
+		shared_map_mm[window] = NULL;
 	}
+	shared_map_release_all(window);
 
-	lru_add_drain_all(); // release the cpu local physical pages
-	// yifan: I feel these tlb calls are unneccessary but simply leave them
-	// here unless we need further optimizes.
-	tlb_gather_mmu(&tlb, mm, start_addr, end_addr); // prepare TLB flushing info
-	ret = semeru_swapout_page_range(&tlb, mm, start_addr, end_addr);
-	tlb_finish_mmu(&tlb,start_addr, end_addr);
+	shared_map_mn[window].ops = &shared_map_mn_ops;
+	ret = mmu_notifier_register(&shared_map_mn[window], current->mm);
+	if (unlikely(ret)) {
+		printk(KERN_ERR "%s, follow the mm of the JVM failed, %d \n", __func__, ret);
+		return ret;
+	}
+	shared_map_mm[window] = current->mm;
+	return 0;
+}
 
-	pr_warn("%s, Force swap out for [0x%lx, 0x%lx) finished.\n",
-		__func__, start_addr, end_addr);
+/**
+ * Pin the user counters and publish them to the swap path as the map of the caller's window in shared[].
+ * The counters start from 0, the JVM registers them before the data space is swapped out.
+ * The previous map is freed after a grace period, the swap path may be still updating it.
+ * The map belongs to current->mm, it's unpinned when the mm goes away, see shared_map_mn_release().
+ *
+ * 	return 0 , succ,
+ * 				-1 , error.
+ */
+static int semeru_shared_map_register(struct swap_out_shared_map __rcu **shared, int unit_log,
+				      char __user *start_addr, unsigned long size)
+{
+	struct swap_out_shared_map *map = NULL;
+	struct swap_out_shared_map *old;
+	unsigned long nr_pages = size >> PAGE_SHIFT;
+	int window = semeru_caller_window(__func__);
 
-	return ret;
-}
\ No newline at end of file
+	if (window < 0)
+		return -1;
+
+	if (size != 0) {
+		if (!PAGE_ALIGNED(start_addr) || !PAGE_ALIGNED(size) || unit_log < PAGE_SHIFT ||
+		    unit_log > SWAP_OUT_MONITOR_UNIT_LEN_LOG ||
+		    (size / sizeof(atomic_t)) > U32_MAX) {
+			printk(KERN_ERR "%s, wrong counters [0x%lx, 0x%lx), unit log %d \n", __func__,
+			       (unsigned long)start_addr, (unsigned long)(start_addr + size), unit_log);
+			return -1;
+		}
+
+		map = kzalloc(sizeof(struct swap_out_shared_map), GFP_KERNEL);
+		if (map == NULL)
+			return -1;
+
+		map->counters = semeru_pin_user_array(start_addr, nr_pages, 1 /* write */, &map->pages);
+		if (map->counters == NULL) {
+			kfree(map);
+			return -1;
+		}
+
+		memset(map->counters, 0, size);
+		map->unit_log   = (u32)unit_log;
+		map->nr_entries = (u32)(size / sizeof(atomic_t));
+		map->nr_pages   = nr_pages;
+	}
+
+	mutex_lock(&shared_map_owner_lock);
+	if (map != NULL && shared_map_follow_mm(window)) {
+		mutex_unlock(&shared_map_owner_lock);
+		swap_out_shared_map_free(map);
+		return -1;
+	}
+
+	mutex_lock(&swap_out_shared_map_lock);
+	old = rcu_dereference_protected(shared[window], lockdep_is_held(&swap_out_shared_map_lock));
+	rcu_assign_pointer(shared[window], map);
+	mutex_unlock(&swap_out_shared_map_lock);
+	mutex_unlock(&shared_map_owner_lock);
+
+	if (old != NULL) {
+		synchronize_rcu();
+		swap_out_shared_map_free(old);
+	}
+
+	return 0;
+}
+
+/**
+ * Semeru CPU, share the swapped out pages of each unit with the JVM, sys_do_semeru_rdma_ops type 22.
+ */
+int semeru_swap_out_map_register(int unit_log, char __user *start_addr, unsigned long size)
+{
+	int ret = semeru_shared_map_register(swap_out_shared_map, unit_log, start_addr, size);
+
+	printk(KERN_INFO "%s, swap out map [0x%lx, 0x%lx), unit log %d, %d \n", __func__,
+	       (unsigned long)start_addr, (unsigned long)(start_addr + size), unit_log, ret);
+	return ret;
+}
+
+/**
+ * Semeru CPU, share the swap-ins of each unit with the JVM, sys_do_semeru_rdma_ops type 36.
+ */
+int semeru_swap_in_map_register(int unit_log, char __user *start_addr, unsigned long size)
+{
+	int ret = semeru_shared_map_register(swap_in_shared_map, unit_log, start_addr, size);
+
+	printk(KERN_INFO "%s, swap in map [0x%lx, 0x%lx), unit log %d, %d \n", __func__,
+	       (unsigned long)start_addr, (unsigned long)(start_addr + size), unit_log, ret);
+	return ret;
+}
+
+struct reclaim_hint_shared_map __rcu *reclaim_hint_shared_map[SEMERU_MAX_ADDRESS_WINDOWS];
+EXPORT_SYMBOL(reclaim_hint_shared_map); // read by the frontswap store of the Semeru module
+static DEFINE_MUTEX(reclaim_hint_shared_map_lock);
+
+/**
+ * Semeru CPU, pin the reclaim hints written by the JVM, sys_do_semeru_rdma_ops type 30.
+ * One byte per (1 << unit_log) bytes of the data space of the caller's window, see swap_global_struct_mem_layer.h.
+ * The kernel keeps the hints the JVM already wrote. size 0 unregisters them.
+ *
+ * 	return 0 , succ,
+ * 				-1 , error.
+ */
+int semeru_reclaim_hint_register(int unit_log, char __user *start_addr, unsigned long size)
+{
+	struct reclaim_hint_shared_map *map = NULL;
+	struct reclaim_hint_shared_map *old;
+	unsigned long nr_pages = size >> PAGE_SHIFT;
+	int window = semeru_caller_window(__func__);
+
+	if (window < 0)
+		return -1;
+
+	if (size != 0) {
+		if (!PAGE_ALIGNED(start_addr) || !PAGE_ALIGNED(size) || unit_log < PAGE_SHIFT ||
+		    unit_log > SWAP_OUT_MONITOR_UNIT_LEN_LOG || size > U32_MAX) {
+			printk(KERN_ERR "%s, wrong reclaim hints [0x%lx, 0x%lx), unit log %d \n", __func__,
+			       (unsigned long)start_addr, (unsigned long)(start_addr + size), unit_log);
+			return -1;
+		}
+
+		map = kzalloc(sizeof(struct reclaim_hint_shared_map), GFP_KERNEL);
+		if (map == NULL)
+			return -1;
+
+		map->hints = semeru_pin_user_array(start_addr, nr_pages, 0 /* read */, &map->pages);
+		if (map->hints == NULL) {
+			kfree(map);
+			return -1;
+		}
+
+		map->unit_log   = (u32)unit_log;
+		map->nr_entries = (u32)size;
+		map->nr_pages   = nr_pages;
+	}
+
+	mutex_lock(&reclaim_hint_shared_map_lock);
+	old = rcu_dereference_protected(reclaim_hint_shared_map[window], lockdep_is_held(&reclaim_hint_shared_map_lock));
+	rcu_assign_pointer(reclaim_hint_shared_map[window], map);
+	mutex_unlock(&reclaim_hint_shared_map_lock);
+
+	if (old != NULL) {
+		synchronize_rcu();
+		semeru_unpin_user_array(old->hints, old->pages, old->nr_pages);
+		kfree(old);
+	}
+
+	printk(KERN_INFO "%s, reclaim hints [0x%lx, 0x%lx), unit log %d \n", __func__,
+	       (unsigned long)start_addr, (unsigned long)(start_addr + size), unit_log);
+	return 0;
+}
+
+struct page_affinity_shared_map __rcu *page_affinity_shared_map[SEMERU_MAX_ADDRESS_WINDOWS];
+EXPORT_SYMBOL(page_affinity_shared_map); // read by the frontswap prefetch of the Semeru module
+static DEFINE_MUTEX(page_affinity_shared_map_lock);
+
+/**
+ * Semeru CPU, pin the page affinity written by the JVM, sys_do_semeru_rdma_ops type 38.
+ * One s32 per page of the data space of the caller's window, see swap_global_struct_mem_layer.h.
+ * size 0 unregisters it.
+ *
+ * 	return 0 , succ,
+ * 				-1 , error.
+ */
+int semeru_page_affinity_register(char __user *start_addr, unsigned long size)
+{
+	struct page_affinity_shared_map *map = NULL;
+	struct page_affinity_shared_map *old;
+	unsigned long nr_pages = size >> PAGE_SHIFT;
+	int window = semeru_caller_window(__func__);
+
+	if (window < 0)
+		return -1;
+
+	if (size != 0) {
+		if (!PAGE_ALIGNED(start_addr) || !PAGE_ALIGNED(size) || size / sizeof(s32) > U32_MAX) {
+			printk(KERN_ERR "%s, wrong page affinity [0x%lx, 0x%lx) \n", __func__,
+			       (unsigned long)start_addr, (unsigned long)(start_addr + size));
+			return -1;
+		}
+
+		map = kzalloc(sizeof(struct page_affinity_shared_map), GFP_KERNEL);
+		if (map == NULL)
+			return -1;
+
+		map->next = semeru_pin_user_array(start_addr, nr_pages, 0 /* read */, &map->pages);
+		if (map->next == NULL) {
+			kfree(map);
+			return -1;
+		}
+
+		map->nr_entries = (u32)(size / sizeof(s32));
+		map->nr_pages   = nr_pages;
+	}
+
+	mutex_lock(&page_affinity_shared_map_lock);
+	old = rcu_dereference_protected(page_affinity_shared_map[window], lockdep_is_held(&page_affinity_shared_map_lock));
+	rcu_assign_pointer(page_affinity_shared_map[window], map);
+	mutex_unlock(&page_affinity_shared_map_lock);
+
+	if (old != NULL) {
+		synchronize_rcu();
+		semeru_unpin_user_array(old->next, old->pages, old->nr_pages);
+		kfree(old);
+	}
+
+	printk(KERN_INFO "%s, page affinity [0x%lx, 0x%lx) \n", __func__,
+	       (unsigned long)start_addr, (unsigned long)(start_addr + size));
+	return 0;
+}
+
+struct fault_state_shared_map __rcu *fault_state_shared_map[SEMERU_MAX_ADDRESS_WINDOWS];
+EXPORT_SYMBOL(fault_state_shared_map); // written by the frontswap load of the Semeru module
+static DEFINE_MUTEX(fault_state_shared_map_lock);
+
+static void fault_state_shared_map_free(struct fault_state_shared_map *map)
+{
+	semeru_unpin_user_array(map->state, map->pages, map->nr_pages);
+	kfree(map->tids);
+	kfree(map);
+}
+
+// Under fault_state_shared_map_lock. slot 0 drops the slot of pid.
+static int fault_state_bind_slot(struct fault_state_shared_map *map, pid_t pid, u32 slot)
+{
+	u32 i, ind = hash_32((u32)pid, map->hash_bits);
+	int free = -1;
+	pid_t cur;
+
+	for (i = 0; i < SEMERU_FAULT_PROBE; i++) {
+		cur = map->tids[ind].pid;
+		if (cur == pid) {
+			if (slot == 0) {
+				WRITE_ONCE(map->tids[ind].pid, SEMERU_FAULT_TID_GONE);
+			} else {
+				WRITE_ONCE(map->tids[ind].slot, slot);
+			}
+			return 0;
+		}
+		if (free < 0 && (cur == SEMERU_FAULT_TID_FREE || cur == SEMERU_FAULT_TID_GONE))
+			free = ind;
+		if (cur == SEMERU_FAULT_TID_FREE)
+			break;
+		ind = (ind + 1) & ((1U << map->hash_bits) - 1);
+	}
+
+	if (slot == 0)
+		return 0;
+	if (free < 0)
+		return -1; // the thread stays unattributed
+
+	// A lookup sees the slot before the pid.
+	WRITE_ONCE(map->tids[free].slot, slot);
+	smp_wmb();
+	WRITE_ONCE(map->tids[free].pid, pid);
+	return 0;
+}
+
+/**
+ * Semeru CPU, the remote faults of the JVM threads, sys_do_semeru_rdma_ops type 39.
+ * See swap_global_struct_mem_layer.h. The array of the caller's window.
+ * 	op 0, pin the u32 array [start_addr, start_addr + size). size 0 unregisters it.
+ * 	op 1, the current thread takes the slot size of the array, 0 drops its slot.
+ *
+ * 	return 0 , succ,
+ * 				-1 , error.
+ */
+int semeru_fault_state_register(int op, char __user *start_addr, unsigned long size)
+{
+	struct fault_state_shared_map *map = NULL;
+	struct fault_state_shared_map *old;
+	unsigned long nr_pages = size >> PAGE_SHIFT;
+	int window = semeru_caller_window(__func__);
+	int ret = 0;
+
+	if (window < 0)
+		return -1;
+
+	if (op == 1) {
+		mutex_lock(&fault_state_shared_map_lock);
+		map = rcu_dereference_protected(fault_state_shared_map[window],
+						lockdep_is_held(&fault_state_shared_map_lock));
+		if (map == NULL || size >= map->nr_entries)
+			ret = -1;
+		else
+			ret = fault_state_bind_slot(map, current->pid, (u32)size);
+		mutex_unlock(&fault_state_shared_map_lock);
+		return ret;
+	}
+
+	if (size != 0) {
+		if (!PAGE_ALIGNED(start_addr) || !PAGE_ALIGNED(size) || size / sizeof(u32) > U16_MAX) {
+			printk(KERN_ERR "%s, wrong fault state [0x%lx, 0x%lx) \n", __func__,
+			       (unsigned long)start_addr, (unsigned long)(start_addr + size));
+			return -1;
+		}
+
+		map = kzalloc(sizeof(struct fault_state_shared_map), GFP_KERNEL);
+		if (map == NULL)
+			return -1;
+
+		map->nr_entries = (u32)(size / sizeof(u32));
+		map->hash_bits  = ilog2(roundup_pow_of_two(map->nr_entries * 2));
+		map->tids = kcalloc(1UL << map->hash_bits, sizeof(struct fault_state_tid), GFP_KERNEL);
+		if (map->tids == NULL) {
+			kfree(map);
+			return -1;
+		}
+
+		map->state = semeru_pin_user_array(start_addr, nr_pages, 1 /* write */, &map->pages);
+		if (map->state == NULL) {
+			kfree(map->tids);
+			kfree(map);
+			return -1;
+		}
+		map->nr_pages = nr_pages;
+	}
+
+	// The slots of the threads are bound to the old array, the JVM binds them again.
+	mutex_lock(&fault_state_shared_map_lock);
+	old = rcu_dereference_protected(fault_state_shared_map[window], lockdep_is_held(&fault_state_shared_map_lock));
+	rcu_assign_pointer(fault_state_shared_map[window], map);
+	mutex_unlock(&fault_state_shared_map_lock);
+
+	if (old != NULL) {
+		synchronize_rcu();
+		fault_state_shared_map_free(old);
+	}
+
+	printk(KERN_INFO "%s, fault state [0x%lx, 0x%lx) \n", __func__,
+	       (unsigned long)start_addr, (unsigned long)(start_addr + size));
+	return 0;
+}
+
+struct fault_sample_shared_map __rcu *fault_sample_shared_map[SEMERU_MAX_ADDRESS_WINDOWS];
+EXPORT_SYMBOL(fault_sample_shared_map); // written by the frontswap load of the Semeru module
+static DEFINE_MUTEX(fault_sample_shared_map_lock);
+
+static void fault_sample_shared_map_free(struct fault_sample_shared_map *map)
+{
+	semeru_unpin_user_array(map->ring, map->pages, map->nr_pages);
+	mmdrop(map->mm);
+	kfree(map);
+}
+
+/**
+ * Semeru CPU, pin the ring of the sampled swap-ins, sys_do_semeru_rdma_ops type 40.
+ * See swap_global_struct_mem_layer.h. 1 of period swap-ins of the caller's process, in its window, is sampled.
+ * size 0 unregisters it.
+ *
+ * 	return 0 , succ,
+ * 				-1 , error.
+ */
+int semeru_fault_sample_register(int period, char __user *start_addr, unsigned long size)
+{
+	struct fault_sample_shared_map *map = NULL;
+	struct fault_sample_shared_map *old;
+	unsigned long nr_pages = size >> PAGE_SHIFT;
+	unsigned long nr_entries;
+	int window = semeru_caller_window(__func__);
+
+	if (window < 0)
+		return -1;
+
+	if (size != 0) {
+		nr_entries = (size - sizeof(struct semeru_fault_sample_ring)) / sizeof(struct semeru_fault_sample);
+		if (!PAGE_ALIGNED(start_addr) || !PAGE_ALIGNED(size) || period <= 0 || nr_entries == 0 ||
+		    nr_entries > U32_MAX) {
+			printk(KERN_ERR "%s, wrong sample ring [0x%lx, 0x%lx), period %d \n", __func__,
+			       (unsigned long)start_addr, (unsigned long)(start_addr + size), period);
+			return -1;
+		}
+
+		map = kzalloc(sizeof(struct fault_sample_shared_map), GFP_KERNEL);
+		if (map == NULL)
+			return -1;
+
+		map->ring = semeru_pin_user_array(start_addr, nr_pages, 1 /* write */, &map->pages);
+		if (map->ring == NULL) {
+			kfree(map);
+			return -1;
+		}
+		map->nr_pages = nr_pages;
+		spin_lock_init(&map->lock);
+		atomic_set(&map->count, 0);
+		mmgrab(current->mm);
+		map->mm = current->mm;
+
+		map->ring->head = 0;
+		map->ring->tail = 0;
+		map->ring->dropped = 0;
+		map->ring->nr_entries = (u32)nr_entries;
+		map->ring->period = (u32)period;
+	}
+
+	mutex_lock(&fault_sample_shared_map_lock);
+	old = rcu_dereference_protected(fault_sample_shared_map[window], lockdep_is_held(&fault_sample_shared_map_lock));
+	rcu_assign_pointer(fault_sample_shared_map[window], map);
+	mutex_unlock(&fault_sample_shared_map_lock);
+
+	if (old != NULL) {
+		synchronize_rcu();
+		fault_sample_shared_map_free(old);
+	}
+
+	printk(KERN_INFO "%s, sample ring [0x%lx, 0x%lx), period %d \n", __func__,
+	       (unsigned long)start_addr, (unsigned long)(start_addr + size), period);
+	return 0;
+}
+
+// The shared counters of the window go back to 0 along with its entries of jvm_region_swap_out_counter[].
+static void swap_out_shared_map_reset(int window)
+{
+	struct swap_out_shared_map *map;
+	u32 i;
+
+	if (window < 0)
+		return;
+	rcu_read_lock();
+	map = rcu_dereference(swap_out_shared_map[window]);
+	if (map != NULL) {
+		for (i = 0; i < map->nr_entries; i++)
+			atomic_set(&map->counters[i], 0);
+	}
+	rcu_read_unlock();
+}
+
+// The entries of jvm_region_swap_out_counter[] of the address window of vaddr.
+static void swap_out_monitor_reset_window(u64 vaddr)
+{
+	u64 first = ((vaddr - SWAP_OUT_MONITOR_VADDR_START) >> SEMERU_ADDRESS_WINDOW_SHIFT) * SWAP_OUT_MONITOR_WINDOW_ENTRIES;
+	u64 i;
+
+	for (i = first; i < first + SWAP_OUT_MONITOR_WINDOW_ENTRIES && i < SWAP_OUT_MONITOR_ARRAY_LEN; i++) {
+		//jvm_region_swap_out_counter[i] = 0;
+		atomic_set(&jvm_region_swap_out_counter[i], 0);
+	}
+	swap_out_shared_map_reset(semeru_window_of(vaddr));
+}
+
+/**
+ * Semeru CPU, reset array initial value to 0.
+ * Only the counters of the address window of start_vaddr, the other JVMs keep theirs.
+ * 
+ * 	return 0 , succ,
+ * 				-1 , error. 
+ * 
+ */
+asmlinkage int sys_swap_stat_reset_and_check(u64 start_vaddr, u64 bytes_len)
+{
+	//printk(KERN_INFO"%s, reset swap out monitor information. \n", __func__);
+
+	// 1) reset on-demand swapin counter.
+	reset_swap_info();
+	printk(KERN_INFO "%s, ater reset, on_demand_swapin_number 0x%x \n", __func__, get_on_demand_swapin_number());
+
+// 2) the [buff, buff+ bytes_len) must fall into the cover of the array.
+//
+#ifdef DEBUG_SERVER_HOME
+	if (within_range(start_vaddr)) {
+		swap_out_monitor_reset_window(start_vaddr);
+
+		return 0;
+	} // end of if.
+#else
+	if ((u64)start_vaddr >= SWAP_OUT_MONITOR_VADDR_START &&
+	    (u64)start_vaddr - SWAP_OUT_MONITOR_VADDR_START < SEMERU_MAX_ADDRESS_WINDOWS * SEMERU_ADDRESS_WINDOW_SIZE &&
+	    bytes_len <= SEMERU_ADDRESS_WINDOW_SIZE - (((u64)start_vaddr - SWAP_OUT_MONITOR_VADDR_START) & (SEMERU_ADDRESS_WINDOW_SIZE - 1))) {
+		swap_out_monitor_reset_window(start_vaddr);
+
+		printk(KERN_INFO "%s, Region monitoring, reset jvm_region_swap_out_counter[] of window 0x%llx to 0 \n",
+		       __func__, ((u64)start_vaddr - SWAP_OUT_MONITOR_VADDR_START) >> SEMERU_ADDRESS_WINDOW_SHIFT);
+
+		return 0;
+	} // end of if.
+#endif
+
+	printk(KERN_ERR "%s, [0x%llx, 0x%llx) exceed the swap out array range [0x%llx, 0x%llx),  ", __func__,
+	       (u64)start_vaddr, (u64)(start_vaddr + bytes_len), (u64)SWAP_OUT_MONITOR_VADDR_START,
+	       (u64)(SWAP_OUT_MONITOR_VADDR_START + SWAP_OUT_MONITOR_ARRAY_LEN * (1 << SWAP_OUT_MONITOR_UNIT_LEN_LOG)));
+	return -1;
+}
+
+/**
+ * Semeru CPU : get the swapped out pages number.
+ * Because we can't use any FPU in kernel, return the number of swapped pages. 
+ * 
+ * Warning : For a not-full Region. Using swapped-out pages to calculate cached-paged ratio is not that accurate.
+ * 
+ */
+asmlinkage u64 sys_num_of_swap_out_pages(u64 start_vaddr, u64 bytes_len){
+	return swap_out_pages_for_range(start_vaddr, start_vaddr + bytes_len);
+}
+
+
+
+/**
+ * Semeru CPU, get the on-demand swapin number.
+ * 						For each on-demand swapin operation, it may load multiple pages into Swap Cache.
+ * Syscall id, 337
+ *  
+ * Warning : Some pages are prefetched into CPU DRAM. However, we can't count them accurately right now.
+ * 
+ * The JVM may call it at every GC pause, so the counters are only printed with dynamic debug.
+ */
+asmlinkage int sys_num_of_on_demand_swapin(void){
+
+	pr_debug("%s, on-demand swapin page number : %d \n", __func__, get_on_demand_swapin_number());
+	pr_debug("%s, prefetch swapin page number : %d \n", __func__, get_prefetch_swapin_number());
+	pr_debug("%s, hit on swap cache page number : %d \n", __func__, get_hit_on_swap_cache_number());
+	
+	return get_on_demand_swapin_number();
+}
+
+
+
+/**
+ * Copy data to between user space and kernel space.
+ *  
+ */
+asmlinkage int sys_test_syscall(char* __user *buff, uint64_t len){
+	int ret = 0;
+	uint64_t i;
+
+
+	char* kernel_buf = kzalloc(PAGE_SIZE, GFP_KERNEL);
+	
+	for(i=0; i<PAGE_SIZE/sizeof(uint64_t); i++ ){
+		((uint64_t*)kernel_buf)[i] = 1;
+	}
+
+	printk(KERN_INFO "%s, Before copy_from_user, first uint64_t kernel_buf value: 0x%llx \n", 
+																																					__func__,
+																												 									*((uint64_t*)kernel_buf));
+
+	//1) copy data from user space to kernel space	
+	if(len > PAGE_SIZE){
+		len = PAGE_SIZE;
+	}
+	
+	// void *to, const void __user *from, unsigned long n
+  ret = copy_from_user(kernel_buf, buff, len);
+	if(ret!=0){
+		printk(KERN_ERR "%s, %d bytes are not copied in copy_from_user. \n", __func__, ret);
+		goto err;
+	}
+
+	printk(KERN_INFO "%s, After copy_from_user, first uint64_t kernel_buf value: 0x%llx \n", 
+																																					__func__,
+																												 									*((uint64_t*)kernel_buf));
+
+
+	// 2) Copy data to user space
+	// rseet the value.
+	for(i=0; i<PAGE_SIZE/sizeof(uint64_t); i++ ){
+		((uint64_t*)kernel_buf)[i] = 1;
+	}
+
+	// void __user *to, const void *from, unsigned long n
+	ret = copy_to_user(buff, kernel_buf, len);
+	if(ret!=0){
+		printk(KERN_ERR "%s, %d bytes are not copied in copy_to_user. \n", __func__, ret);
+		goto err;
+	}
+
+err:
+	return ret;
+}
+
+
+
+
+/**
+ * @brief only anonmous data can be paged out.
+ * 
+ * @param vma 
+ * @return true : can be swapped out
+ * @return false : can not be swapped out
+ */
+static inline bool can_do_swapout(struct vm_area_struct *vma)
+{
+	return vma && vma_is_anonymous(vma);
+}
+
+
+
+/**
+ * @brief Force swapping out the spcificed virtual address range
+ * 
+ * @param vma 
+ * @param prev 
+ * @param start_addr 
+ * @param end_addr 
+ * @return int 
+ * 	0: all the spcificed pages are paged out
+ * 	negative value : error code
+ * 	positive value : the number of pages are not paged out 
+ */
+int semeru_force_swapout(unsigned long start_addr, unsigned long end_addr)
+{
+	struct mm_struct *mm = current->mm; // current points to the the caller process.
+	struct vm_area_struct *vma = find_vma(mm, start_addr);
+	struct mmu_gather tlb;
+	int ret = 0;
+
+	if (!can_do_swapout(vma)) {
+		pr_warn("vma %p for range [0x%lx, 0x%lx) cannot be swapped out!",
+			vma, start_addr, end_addr);
+		return 0;
+	}
+
+	lru_add_drain_all(); // release the cpu local physical pages
+	// yifan: I feel these tlb calls are unneccessary but simply leave them
+	// here unless we need further optimizes.
+	tlb_gather_mmu(&tlb, mm, start_addr, end_addr); // prepare TLB flushing info
+	ret = semeru_swapout_page_range(&tlb, mm, start_addr, end_addr);
+	tlb_finish_mmu(&tlb,start_addr, end_addr);
+
+	pr_warn("%s, Force swap out for [0x%lx, 0x%lx) finished.\n",
+		__func__, start_addr, end_addr);
+
+	return ret;
+}
+
+
+//
+// Bulk eviction, sys_do_semeru_rdma_ops type 23 and 24
+//
+
+// The asynchronous evictions of the JVMs, counted per address window, each JVM waits for its own.
+static atomic_t semeru_evict_pending[SEMERU_MAX_ADDRESS_WINDOWS];
+static atomic_long_t semeru_evict_not_paged_out[SEMERU_MAX_ADDRESS_WINDOWS];
+static DECLARE_WAIT_QUEUE_HEAD(semeru_evict_wait);
+
+struct semeru_evict_work {
+	struct work_struct work;
+	struct mm_struct *mm;
+	int window;
+	unsigned long start_addr;
+	unsigned long end_addr;
+};
+
+/**
+ * The end of the run of pages from addr that are all kept, or all not kept, by the reclaim hints.
+ */
+static unsigned long semeru_evict_run_end(unsigned long addr, unsigned long end, bool keep)
+{
+	for (addr += PAGE_SIZE; addr < end; addr += PAGE_SIZE) {
+		if ((semeru_reclaim_priority(addr) == SEMERU_RECLAIM_KEEP) != keep)
+			break;
+	}
+	return min(addr, end);
+}
+
+/**
+ * Swap out the anonymous pages of [start_addr, end_addr) of mm, VMA by VMA, in address order.
+ * The swap entries follow the virtual addresses, the frontswap store ring chains the contiguous
+ * pages into one RDMA write per batch. The pages are freed by the reclaim right after their store.
+ * The pages hinted SEMERU_RECLAIM_KEEP by the JVM, e.g. an eden Region, are skipped.
+ *
+ * return :
+ * 	the number of pages not paged out, or negative error code.
+ */
+static int semeru_evict_mm_range(struct mm_struct *mm, unsigned long start_addr, unsigned long end_addr)
+{
+	struct vm_area_struct *vma;
+	struct mmu_gather tlb;
+	unsigned long start, end, run_end;
+	bool keep;
+	int ret = 0;
+	int not_paged_out = 0;
+
+	lru_add_drain_all(); // release the cpu local physical pages
+
+	down_read(&mm->mmap_sem);
+	for (vma = find_vma(mm, start_addr); vma != NULL && vma->vm_start < end_addr; vma = vma->vm_next) {
+		if (!can_do_swapout(vma))
+			continue;
+
+		end = min(end_addr, vma->vm_end);
+		for (start = max(start_addr, vma->vm_start); start < end; start = run_end) {
+			keep = semeru_reclaim_priority(start) == SEMERU_RECLAIM_KEEP;
+			run_end = semeru_evict_run_end(start, end, keep);
+			if (keep) {
+				not_paged_out += (run_end - start) >> PAGE_SHIFT;
+				continue;
+			}
+
+			tlb_gather_mmu(&tlb, mm, start, run_end);
+			ret = semeru_swapout_page_range(&tlb, mm, start, run_end);
+			tlb_finish_mmu(&tlb, start, run_end);
+
+			if (unlikely(ret < 0))
+				break;
+			not_paged_out += ret;
+		}
+
+		if (unlikely(ret < 0)) {
+			not_paged_out = ret;
+			break;
+		}
+	}
+	up_read(&mm->mmap_sem);
+
+	return not_paged_out;
+}
+
+static void semeru_evict_work_fn(struct work_struct *work)
+{
+	struct semeru_evict_work *evict = container_of(work, struct semeru_evict_work, work);
+	int ret = semeru_evict_mm_range(evict->mm, evict->start_addr, evict->end_addr);
+
+	if (unlikely(ret < 0)) {
+		pr_err("%s, evict [0x%lx, 0x%lx) failed, %d \n", __func__, evict->start_addr, evict->end_addr, ret);
+		ret = (int)((evict->end_addr - evict->start_addr) >> PAGE_SHIFT);
+	}
+	atomic_long_add(ret, &semeru_evict_not_paged_out[evict->window]);
+
+	if (atomic_dec_and_test(&semeru_evict_pending[evict->window]))
+		wake_up_all(&semeru_evict_wait);
+
+	mmput(evict->mm);
+	kfree(evict);
+}
+
+/**
+ * Semeru CPU, evict the page aligned range [start_addr, start_addr + size), e.g. a cold old Region.
+ * The pages are unmapped and written to the memory servers at once, not picked by the kswapd's LRU.
+ *
+ * return :
+ * 	sync : the number of pages not paged out;
+ * 	async : 0 after the eviction is queued, waited by semeru_bulk_evict_wait();
+ * 	-1 for error, or an async range out of the served address windows.
+ */
+int semeru_bulk_evict(int async, char __user *start_addr, unsigned long size)
+{
+	struct mm_struct *mm = current->mm;
+	struct semeru_evict_work *evict;
+	int window = semeru_window_of((unsigned long)start_addr);
+
+	if (!PAGE_ALIGNED(start_addr) || !PAGE_ALIGNED(size) || size == 0) {
+		printk(KERN_ERR "%s, wrong range [0x%lx, 0x%lx) \n", __func__, (unsigned long)start_addr,
+		       (unsigned long)(start_addr + size));
+		return -1;
+	}
+
+	if (!async)
+		return semeru_evict_mm_range(mm, (unsigned long)start_addr, (unsigned long)(start_addr + size));
+
+	if (window < 0) {
+		printk(KERN_ERR "%s, [0x%lx, 0x%lx) is out of the served address windows \n", __func__,
+		       (unsigned long)start_addr, (unsigned long)(start_addr + size));
+		return -1;
+	}
+
+	evict = kmalloc(sizeof(struct semeru_evict_work), GFP_KERNEL);
+	if (unlikely(evict == NULL))
+		return -1;
+
+	mmget(mm); // dropped by the worker
+	evict->mm = mm;
+	evict->window = window;
+	evict->start_addr = (unsigned long)start_addr;
+	evict->end_addr = (unsigned long)(start_addr + size);
+	INIT_WORK(&evict->work, semeru_evict_work_fn);
+
+	atomic_inc(&semeru_evict_pending[window]);
+	queue_work(system_unbound_wq, &evict->work);
+	return 0;
+}
+
+/**
+ * Semeru CPU, wait for all the queued asynchronous evictions of the caller's address window.
+ *
+ * return :
+ * 	the number of pages they didn't page out, reset to 0. -1 if interrupted.
+ */
+int semeru_bulk_evict_wait(void)
+{
+	int window = semeru_caller_window(__func__);
+
+	if (window < 0)
+		return -1;
+	if (wait_event_killable(semeru_evict_wait, atomic_read(&semeru_evict_pending[window]) == 0))
+		return -1;
+
+	return (int)atomic_long_xchg(&semeru_evict_not_paged_out[window], 0);
+}
+
+
+//
+// Discard the freed Regions, sys_do_semeru_rdma_ops type 31
+//
+
+static int semeru_discard_pte(pte_t *pte, unsigned long addr, unsigned long next, struct mm_walk *walk)
+{
+	pte_t ptent = *pte;
+
+	// The swap entry is freed by MADV_FREE, not by a swap in.
+	if (!pte_none(ptent) && !pte_present(ptent) && !non_swap_entry(pte_to_swp_entry(ptent))) {
+		swap_in_one_page_record(addr);
+		(*(unsigned long *)walk->private)++;
+	}
+	return 0;
+}
+
+/**
+ * Semeru CPU, the JVM freed the Regions of the page aligned range [start_addr, start_addr + size).
+ * Their content is dead:
+ * 	1) the resident pages are lazily freed, MADV_FREE. They are dropped by the reclaim without a
+ * 	   frontswap store, unless the JVM writes them again;
+ * 	2) the swap entries are freed, the frontswap invalidate_page drops their compressed and prefetched copies.
+ * 	   A later touch gets a zero page instead of reading the memory server.
+ * The swapped out pages leave the swap out counters here, nothing swaps them in.
+ *
+ * return :
+ * 	the number of swap entries freed, -1 for error.
+ */
+int semeru_discard_range(char __user *start_addr, unsigned long size)
+{
+	struct mm_struct *mm = current->mm;
+	unsigned long swapped_out = 0;
+	struct mm_walk discard_walk = {
+		.pte_entry = semeru_discard_pte,
+		.mm = mm,
+		.private = &swapped_out,
+	};
+
+	if (!PAGE_ALIGNED(start_addr) || !PAGE_ALIGNED(size) || size == 0 ||
+	    semeru_data_offset_of((unsigned long)start_addr, size) < 0) {
+		printk(KERN_ERR "%s, wrong range [0x%lx, 0x%lx) \n", __func__, (unsigned long)start_addr,
+		       (unsigned long)(start_addr + size));
+		return -1;
+	}
+
+	down_read(&mm->mmap_sem);
+	walk_page_range((unsigned long)start_addr, (unsigned long)(start_addr + size), &discard_walk);
+	up_read(&mm->mmap_sem);
+
+	if (sys_madvise((unsigned long)start_addr, size, MADV_FREE) != 0) {
+		printk(KERN_ERR "%s, MADV_FREE [0x%lx, 0x%lx) failed \n", __func__, (unsigned long)start_addr,
+		       (unsigned long)(start_addr + size));
+		return -1;
+	}
+
+	return (int)swapped_out;
+}
+
+
+//
+// Heap snapshot, sys_do_semeru_rdma_ops type 32
+//
+// The swap entries of a saved range are held by the snapshot, not only by the page tables of the JVM.
+// After the JVM exits, the swap slots and the pages on the memory servers stay, no frontswap invalidate.
+// A process mapping the same range gets them back as swap entries, its pages are read from the memory servers
+// by the frontswap load at the first touch.
+//
+
+static DEFINE_MUTEX(semeru_snapshot_lock);
+static RADIX_TREE(semeru_snapshot_tree, GFP_KERNEL); // page index of the data offset -> held swap entry
+static unsigned long semeru_snapshot_pages;
+
+// The page index of the data offset of addr, the range is checked by semeru_heap_snapshot().
+static unsigned long semeru_snapshot_index(unsigned long addr)
+{
+	return (unsigned long)semeru_data_offset_of(addr, PAGE_SIZE) >> PAGE_SHIFT;
+}
+
+struct semeru_snapshot_walk {
+	unsigned long held;
+	unsigned long missed;
+};
+
+static int semeru_snapshot_hold_pte(pte_t *pte, unsigned long addr, unsigned long next, struct mm_walk *walk)
+{
+	struct semeru_snapshot_walk *snapshot = walk->private;
+	unsigned long index = semeru_snapshot_index(addr);
+	pte_t ptent = *pte;
+	swp_entry_t entry;
+	int err;
+
+	if (pte_none(ptent))
+		return 0;
+
+	if (pte_present(ptent) || non_swap_entry(pte_to_swp_entry(ptent))) {
+		snapshot->missed++; // not paged out, e.g. mlocked
+		return 0;
+	}
+
+	entry = pte_to_swp_entry(ptent);
+	if (radix_tree_lookup(&semeru_snapshot_tree, index) != NULL)
+		return 0; // saved twice
+
+	err = swap_duplicate(entry);
+	while (err == -ENOMEM) {
+		if (add_swap_count_continuation(entry, GFP_KERNEL) < 0)
+			break;
+		err = swap_duplicate(entry);
+	}
+	if (unlikely(err)) {
+		snapshot->missed++;
+		return 0;
+	}
+
+	if (unlikely(radix_tree_insert(&semeru_snapshot_tree, index, swp_to_radix_entry(entry)))) {
+		swap_free(entry);
+		snapshot->missed++;
+		return 0;
+	}
+	snapshot->held++;
+	return 0;
+}
+
+/**
+ * Swap out the whole range, the KEEP hints of the JVM don't apply, and hold the swap entries.
+ * Return the number of pages not held, or negative error code.
+ */
+static int semeru_snapshot_save(struct mm_struct *mm, unsigned long start_addr, unsigned long end_addr)
+{
+	struct vm_area_struct *vma;
+	struct mmu_gather tlb;
+	unsigned long start, end;
+	struct semeru_snapshot_walk snapshot = { 0, 0 };
+	struct mm_walk hold_walk = {
+		.pte_entry = semeru_snapshot_hold_pte,
+		.mm = mm,
+		.private = &snapshot,
+	};
+	int ret = 0;
+
+	lru_add_drain_all(); // release the cpu local physical pages
+
+	down_read(&mm->mmap_sem);
+	for (vma = find_vma(mm, start_addr); vma != NULL && vma->vm_start < end_addr; vma = vma->vm_next) {
+		if (!can_do_swapout(vma))
+			continue;
+
+		start = max(start_addr, vma->vm_start);
+		end = min(end_addr, vma->vm_end);
+		tlb_gather_mmu(&tlb, mm, start, end);
+		ret = semeru_swapout_page_range(&tlb, mm, start, end);
+		tlb_finish_mmu(&tlb, start, end);
+		if (unlikely(ret < 0))
+			break;
+
+		walk_page_range(start, end, &hold_walk);
+	}
+	up_read(&mm->mmap_sem);
+
+	semeru_snapshot_pages += snapshot.held;
+	pr_warn("%s, [0x%lx, 0x%lx) %lu pages held, %lu missed, %lu pages in the snapshot\n", __func__, start_addr,
+		end_addr, snapshot.held, snapshot.missed, semeru_snapshot_pages);
+
+	return ret < 0 ? ret : (int)snapshot.missed;
+}
+
+/**
+ * Map the held swap entries of the range into mm, where nothing is mapped yet, and drop the others.
+ * The references of the snapshot go to the page tables.
+ * Return the number of pages mapped.
+ */
+static int semeru_snapshot_restore(struct mm_struct *mm, unsigned long start_addr, unsigned long end_addr)
+{
+	struct radix_tree_iter iter;
+	struct vm_area_struct *vma;
+	void **slot;
+	swp_entry_t entry;
+	unsigned long addr;
+	unsigned long end_index = semeru_snapshot_index(start_addr) + ((end_addr - start_addr) >> PAGE_SHIFT);
+	spinlock_t *ptl;
+	pte_t *pte;
+	bool mapped;
+	int restored = 0;
+
+	down_read(&mm->mmap_sem);
+	radix_tree_for_each_slot(slot, &semeru_snapshot_tree, &iter, semeru_snapshot_index(start_addr)) {
+		if (iter.index >= end_index)
+			break;
+		addr = semeru_data_addr(iter.index << PAGE_SHIFT);
+
+		entry = radix_to_swp_entry(radix_tree_deref_slot(slot));
+		radix_tree_delete(&semeru_snapshot_tree, iter.index);
+		slot = radix_tree_iter_resume(slot, &iter);
+		semeru_snapshot_pages--;
+
+		mapped = false;
+		vma = find_vma(mm, addr);
+		// do_swap_page() expects the anon_vma of a vma with swap entries.
+		if (vma != NULL && vma->vm_start <= addr && can_do_swapout(vma) && anon_vma_prepare(vma) == 0) {
+			pte = get_locked_pte(mm, addr, &ptl);
+			if (pte != NULL) {
+				if (pte_none(*pte)) {
+					set_pte_at(mm, addr, pte, swp_entry_to_pte(entry));
+					inc_mm_counter(mm, MM_SWAPENTS);
+					swap_out_one_page_record(addr);
+					mapped = true;
+				}
+				pte_unmap_unlock(pte, ptl);
+			}
+		}
+
+		if (mapped)
+			restored++;
+		else
+			swap_free(entry); // written by the new process already
+	}
+	up_read(&mm->mmap_sem);
+
+	pr_warn("%s, [0x%lx, 0x%lx) %d pages restored, %lu pages left in the snapshot\n", __func__, start_addr, end_addr,
+		restored, semeru_snapshot_pages);
+	return restored;
+}
+
+/**
+ * Release the held swap entries of the range, their pages on the memory servers are dropped by the invalidate.
+ * Return the number of pages dropped.
+ */
+static int semeru_snapshot_drop(unsigned long start_addr, unsigned long end_addr)
+{
+	struct radix_tree_iter iter;
+	void **slot;
+	unsigned long end_index = semeru_snapshot_index(start_addr) + ((end_addr - start_addr) >> PAGE_SHIFT);
+	int dropped = 0;
+
+	radix_tree_for_each_slot(slot, &semeru_snapshot_tree, &iter, semeru_snapshot_index(start_addr)) {
+		if (iter.index >= end_index)
+			break;
+
+		swap_free(radix_to_swp_entry(radix_tree_deref_slot(slot)));
+		radix_tree_delete(&semeru_snapshot_tree, iter.index);
+		slot = radix_tree_iter_resume(slot, &iter);
+		dropped++;
+	}
+	semeru_snapshot_pages -= dropped;
+
+	return dropped;
+}
+
+/**
+ * Semeru CPU, snapshot the page aligned range [start_addr, start_addr + size) of the data space, e.g. the Java heap.
+ *
+ * op :
+ * 	SEMERU_SNAPSHOT_SAVE, write all the pages to the memory servers and keep them beyond this process.
+ * 		Return the number of pages not saved;
+ * 	SEMERU_SNAPSHOT_RESTORE, map the saved pages into the calling process at the same addresses, the unmapped
+ * 		part of the range is skipped. Return the number of pages mapped, the rest of the range is dropped;
+ * 	SEMERU_SNAPSHOT_DROP, give up the saved pages. Return the number of pages dropped;
+ * 	-1 for error.
+ *
+ * A held swap slot isn't taken by another page, with identity swap slots that's the page at the same address.
+ * Drop a snapshot nobody restores.
+ */
+int semeru_heap_snapshot(int op, char __user *start_addr, unsigned long size)
+{
+	struct mm_struct *mm = current->mm;
+	unsigned long start = (unsigned long)start_addr;
+	unsigned long end = start + size;
+	int ret;
+
+	if (!PAGE_ALIGNED(start) || !PAGE_ALIGNED(size) || size == 0 || semeru_data_offset_of(start, size) < 0) {
+		printk(KERN_ERR "%s, wrong range [0x%lx, 0x%lx) \n", __func__, start, end);
+		return -1;
+	}
+
+	mutex_lock(&semeru_snapshot_lock);
+	switch (op) {
+	case SEMERU_SNAPSHOT_SAVE:
+		ret = semeru_snapshot_save(mm, start, end);
+		break;
+	case SEMERU_SNAPSHOT_RESTORE:
+		ret = semeru_snapshot_restore(mm, start, end);
+		break;
+	case SEMERU_SNAPSHOT_DROP:
+		ret = semeru_snapshot_drop(start, end);
+		break;
+	default:
+		printk(KERN_ERR "%s, wrong op %d \n", __func__, op);
+		ret = -1;
+	}
+	mutex_unlock(&semeru_snapshot_lock);
+
+	return ret;
+}
+
+
+
+//
+// Fault-around of the data space, sys_do_semeru_rdma_ops type 34
+//
+// A swapped out page whose data arrived early, read ahead into the swap cache or prefetched by the frontswap path,
+// still costs a fault of its own to be mapped. Map the arrived neighbours of a range in one pass instead,
+// the sequential scans of the JVM stop paying an exception per page.
+//
+
+#define SEMERU_FAULT_AROUND_BATCH	64 // pages collected per page table walk
+
+struct semeru_fault_around_walk {
+	unsigned long addrs[SEMERU_FAULT_AROUND_BATCH];
+	int num;
+};
+
+/**
+ * The swap-in of the page doesn't wait for a memory server:
+ * 	1) it's up to date in the swap cache, a minor fault maps it;
+ * 	2) or its data is ready in the swap-in prefetch cache of the frontswap path, the load copies it.
+ */
+static bool semeru_swap_page_arrived(swp_entry_t entry, unsigned long addr)
+{
+	struct page *page;
+	bool arrived;
+
+	page = find_get_page(swap_address_space(entry), swp_offset(entry));
+	if (page != NULL) {
+		// A locked page is being read, or written out.
+		arrived = PageUptodate(page) && !PageLocked(page);
+		put_page(page);
+		return arrived;
+	}
+
+	return rdma_ops_in_kernel.prefetch_ready != NULL && rdma_ops_in_kernel.prefetch_ready(addr) == 1;
+}
+
+static int semeru_fault_around_pte(pte_t *pte, unsigned long addr, unsigned long next, struct mm_walk *walk)
+{
+	struct semeru_fault_around_walk *fa = walk->private;
+	pte_t ptent = *pte;
+	swp_entry_t entry;
+
+	if (pte_none(ptent) || pte_present(ptent))
+		return 0;
+
+	entry = pte_to_swp_entry(ptent);
+	if (non_swap_entry(entry) || !semeru_swap_page_arrived(entry, addr))
+		return 0;
+
+	fa->addrs[fa->num++] = addr;
+	return fa->num == SEMERU_FAULT_AROUND_BATCH; // stop the walk, the batch is full
+}
+
+/**
+ * Map the arrived swapped out pages of [start, end) of the anonymous vma.
+ * Each page goes through handle_mm_fault(), do_swap_page() maps it and updates the swap out counters as usual.
+ * No FAULT_FLAG_ALLOW_RETRY, the mmap_sem is never dropped.
+ * The pages whose data isn't there are skipped, nothing waits for a memory server.
+ *
+ * Caller must hold vma->vm_mm->mmap_sem.
+ *
+ * return :
+ * 	the number of pages mapped.
+ */
+int semeru_fault_around(struct vm_area_struct *vma, unsigned long start, unsigned long end)
+{
+	int i;
+	int mapped = 0;
+	unsigned long addr = max(start, vma->vm_start);
+	struct semeru_fault_around_walk fa;
+	struct mm_walk fa_walk = {
+		.pte_entry = semeru_fault_around_pte,
+		.mm = vma->vm_mm,
+		.private = &fa,
+	};
+
+	if (!vma_is_anonymous(vma))
+		return 0;
+
+	end = min(end, vma->vm_end);
+	while (addr < end) {
+		fa.num = 0;
+		walk_page_range(addr, end, &fa_walk);
+
+		for (i = 0; i < fa.num; i++) {
+			if (!(handle_mm_fault(vma, fa.addrs[i], 0) & VM_FAULT_ERROR))
+				mapped++;
+		}
+
+		if (fa.num < SEMERU_FAULT_AROUND_BATCH)
+			break;
+		addr = fa.addrs[fa.num - 1] + PAGE_SIZE;
+	}
+
+	return mapped;
+}
+
+/**
+ * Semeru CPU, map the arrived swapped out pages of [start_addr, start_addr + size) of the data space,
+ * e.g. after the JVM's RDMA_PREFETCH_RANGE of a Region it's going to scan.
+ *
+ * return :
+ * 	the number of pages mapped, -1 for error.
+ */
+int semeru_fault_around_range(char __user *start_addr, unsigned long size)
+{
+	struct mm_struct *mm = current->mm;
+	struct vm_area_struct *vma;
+	unsigned long start = (unsigned long)start_addr & PAGE_MASK;
+	unsigned long end = PAGE_ALIGN((unsigned long)start_addr + size);
+	int mapped = 0;
+
+	if (size == 0 || end <= start || semeru_data_offset_of(start, end - start) < 0) {
+		printk(KERN_ERR "%s, wrong range [0x%lx, 0x%lx) \n", __func__, (unsigned long)start_addr,
+		       (unsigned long)(start_addr + size));
+		return -1;
+	}
+
+	down_read(&mm->mmap_sem);
+	for (vma = find_vma(mm, start); vma != NULL && vma->vm_start < end; vma = vma->vm_next)
+		mapped += semeru_fault_around(vma, start, end);
+	up_read(&mm->mmap_sem);
+
+#if defined(DEBUG_MODE_BRIEF) || defined(DEBUG_MODE_DETAIL)
+	printk("%s, mapped %d pages of [0x%lx, 0x%lx) \n", __func__, mapped, start, end);
+#endif
+
+	return mapped;
+}
+
+
+
+//
+// Clean swap-ins
+//
+// do_swap_page() frees the swap slot of a swapped in page once vm_swap_full(), and always for the Semeru swap
+// partition, mostly full of the swapped out heap. The page is dirty from then on, its next eviction writes
+// the same 4KB back over RDMA although the memory server has them. The read-mostly old Regions pay the write
+// bandwidth again for each round trip.
+//
+// The swap partition covers the data space of every window at fixed offsets, a kept slot costs nothing.
+// Only the write faults free the slot, do_wp_page() through reuse_swap_page(), so the slot stands for
+// "the remote copy is still valid".
+//
+
+int semeru_keep_clean_swapin = 0;
+EXPORT_SYMBOL(semeru_keep_clean_swapin); // module parameter keep_clean_swapin of the Semeru module
+
+/**
+ * Keep the swap slot of the page do_swap_page() swapped in for the fault at address.
+ * A write fault dirties the page right away, its slot is freed as usual.
+ */
+bool semeru_swap_keep_slot(unsigned long address, unsigned int fault_flags)
+{
+	if (!READ_ONCE(semeru_keep_clean_swapin) || (fault_flags & FAULT_FLAG_WRITE))
+		return false;
+
+	return semeru_data_offset_of(address & PAGE_MASK, PAGE_SIZE) >= 0;
+}
+
+
+
+//
+// Local cache limit, sys_do_semeru_rdma_ops type 35
+//
+// The local memory of the JVM is bounded by its memory cgroup. Past memory.high, its charges are throttled
+// and the LRU reclaims whatever it finds, it knows nothing about the Regions.
+// Evict whole Regions before that by the bulk eviction, the old and humongous ones first by the reclaim hints
+// of the JVM. The eden and survivor Regions are kept, see semeru_evict_mm_range().
+//
+
+#ifdef CONFIG_MEMCG
+
+#define SEMERU_CACHE_LIMIT_HEADROOM	16 // evict above limit - limit / 16
+#define SEMERU_CACHE_LIMIT_UNITS	64 // units evicted per round at most
+
+struct semeru_cache_limit {
+	struct delayed_work dwork;
+	struct mm_struct *mm;		// mmgrab'ed, the JVM may exit without unregistering
+	struct mem_cgroup *memcg;	// css_get'ed
+	unsigned long start_addr;	// unit aligned
+	unsigned long end_addr;
+	unsigned long cursor;		// the next unit to check, round robin
+	unsigned long period;		// jiffies
+	unsigned long evicted_units;
+};
+
+static struct semeru_cache_limit *semeru_cache_limit[SEMERU_MAX_ADDRESS_WINDOWS]; // of the JVM of each window
+static DEFINE_MUTEX(semeru_cache_limit_lock);
+
+// The tightest of memory.high, the soft limit of cgroup v1 and the hard limit, in pages.
+static unsigned long semeru_memcg_limit(struct mem_cgroup *memcg)
+{
+	unsigned long limit = min(READ_ONCE(memcg->high), READ_ONCE(memcg->soft_limit));
+
+	return min(limit, READ_ONCE(memcg->memory.limit));
+}
+
+/**
+ * Evict the units of the swap out counters, 64MB, with resident pages until the usage of the cgroup is
+ * below the headroom. The units hinted SEMERU_RECLAIM_FIRST are tried in a first pass, then SEMERU_RECLAIM_NORMAL.
+ */
+static void semeru_cache_limit_fn(struct work_struct *work)
+{
+	static const int passes[] = { SEMERU_RECLAIM_FIRST, SEMERU_RECLAIM_NORMAL };
+	struct semeru_cache_limit *cl = container_of(to_delayed_work(work), struct semeru_cache_limit, dwork);
+	unsigned long unit = 1UL << SWAP_OUT_MONITOR_UNIT_LEN_LOG;
+	unsigned long nr_units = (cl->end_addr - cl->start_addr) >> SWAP_OUT_MONITOR_UNIT_LEN_LOG;
+	unsigned long limit = semeru_memcg_limit(cl->memcg);
+	unsigned long target = limit - limit / SEMERU_CACHE_LIMIT_HEADROOM;
+	unsigned long addr;
+	unsigned long checked;
+	int evicted = 0;
+	int i;
+
+	if (limit >= PAGE_COUNTER_MAX || page_counter_read(&cl->memcg->memory) <= target)
+		goto next;
+
+	if (!mmget_not_zero(cl->mm))
+		return; // the JVM exited, freed by the next registration
+
+	for (i = 0; i < ARRAY_SIZE(passes) && evicted < SEMERU_CACHE_LIMIT_UNITS; i++) {
+		addr = cl->cursor;
+		for (checked = 0; checked < nr_units && evicted < SEMERU_CACHE_LIMIT_UNITS; checked++) {
+			if (page_counter_read(&cl->memcg->memory) <= target)
+				goto done;
+
+			if (semeru_reclaim_priority(addr) == passes[i] &&
+			    swap_out_pages_for_range(addr, addr + unit) < (unit >> PAGE_SHIFT)) {
+				semeru_evict_mm_range(cl->mm, addr, addr + unit);
+				evicted++;
+				cl->cursor = addr + unit < cl->end_addr ? addr + unit : cl->start_addr;
+			}
+
+			addr += unit;
+			if (addr >= cl->end_addr)
+				addr = cl->start_addr;
+		}
+	}
+
+done:
+	mmput(cl->mm);
+	cl->evicted_units += evicted;
+
+#if defined(DEBUG_MODE_BRIEF) || defined(DEBUG_MODE_DETAIL)
+	printk("%s, evicted %d units, usage 0x%lx pages, limit 0x%lx pages \n", __func__, evicted,
+	       page_counter_read(&cl->memcg->memory), limit);
+#endif
+
+next:
+	queue_delayed_work(system_unbound_wq, &cl->dwork, cl->period);
+}
+
+static void semeru_cache_limit_free(struct semeru_cache_limit *cl)
+{
+	cancel_delayed_work_sync(&cl->dwork);
+	printk(KERN_INFO "%s, evicted %lu units of [0x%lx, 0x%lx) \n", __func__, cl->evicted_units,
+	       cl->start_addr, cl->end_addr);
+	mmdrop(cl->mm);
+	css_put(&cl->memcg->css);
+	kfree(cl);
+}
+
+/**
+ * Semeru CPU, the JVM sizes its young generation by the limit of its memory cgroup.
+ * With period_ms > 0, the data space [start_addr, start_addr + size) of current process is evicted
+ * proactively every period_ms while the cgroup is within 1/16 of the limit. 0 stops the eviction.
+ * One eviction per address window, the range is in the caller's window.
+ *
+ * 	return the limit in MB, 0 if unlimited, -1 for error.
+ */
+int semeru_cache_limit_register(int period_ms, char __user *start_addr, unsigned long size)
+{
+	struct semeru_cache_limit *cl = NULL;
+	struct semeru_cache_limit *old;
+	struct mem_cgroup *memcg;
+	unsigned long unit = 1UL << SWAP_OUT_MONITOR_UNIT_LEN_LOG;
+	unsigned long limit;
+	int window;
+
+	if (mem_cgroup_disabled())
+		return 0;
+
+	window = semeru_caller_window(__func__);
+	if (window < 0)
+		return -1;
+
+	if (period_ms > 0) {
+		if (!IS_ALIGNED((unsigned long)start_addr, unit) || size < unit ||
+		    semeru_data_offset_of((unsigned long)start_addr, size) < 0 ||
+		    semeru_window_of((unsigned long)start_addr) != window) {
+			printk(KERN_ERR "%s, wrong range [0x%lx, 0x%lx) \n", __func__, (unsigned long)start_addr,
+			       (unsigned long)(start_addr + size));
+			return -1;
+		}
+
+		cl = kzalloc(sizeof(struct semeru_cache_limit), GFP_KERNEL);
+		if (cl == NULL)
+			return -1;
+
+		cl->start_addr = (unsigned long)start_addr;
+		cl->end_addr = cl->start_addr + (size & ~(unit - 1));
+		cl->cursor = cl->start_addr;
+		cl->period = msecs_to_jiffies(period_ms);
+		cl->mm = current->mm;
+		mmgrab(cl->mm);
+		INIT_DELAYED_WORK(&cl->dwork, semeru_cache_limit_fn);
+	}
+
+	rcu_read_lock();
+	memcg = mem_cgroup_from_task(current);
+	css_get(&memcg->css);
+	rcu_read_unlock();
+	limit = semeru_memcg_limit(memcg);
+
+	if (cl != NULL)
+		cl->memcg = memcg; // takes the reference
+	else
+		css_put(&memcg->css);
+
+	mutex_lock(&semeru_cache_limit_lock);
+	old = semeru_cache_limit[window];
+	semeru_cache_limit[window] = cl;
+	if (old != NULL)
+		semeru_cache_limit_free(old);
+	if (cl != NULL)
+		queue_delayed_work(system_unbound_wq, &cl->dwork, cl->period);
+	mutex_unlock(&semeru_cache_limit_lock);
+
+	if (limit >= PAGE_COUNTER_MAX)
+		return 0;
+	return (int)min(limit >> (20 - PAGE_SHIFT), (unsigned long)INT_MAX);
+}
+
+#else
+
+int semeru_cache_limit_register(int period_ms, char __user *start_addr, unsigned long size)
+{
+	return 0; // no memory cgroup, no limit
+}
+
+#endif // CONFIG_MEMCG
+
+
+
+//
+// Rewritten pages, sys_do_semeru_rdma_ops type 37
+//
+// The memory server compaction rewrites a part of a Region in place, the local copies of these pages get stale.
+// They are turned into swap entries again, without any frontswap store. The next touch reads the rewritten
+// page from the memory server. The pages of the Region out of the rewritten ranges stay mapped.
+// The compressed and prefetched copies of the frontswap path were dropped by the REWRITE fence of the dispatch.
+//
+
+#define SEMERU_INVALIDATE_BATCH	64 // pages collected per page table walk
+
+struct semeru_invalidate_walk {
+	struct page *pages[SEMERU_INVALIDATE_BATCH];
+	unsigned long addrs[SEMERU_INVALIDATE_BATCH];
+	int num;
+	unsigned long end; // where the walk stopped
+};
+
+static int semeru_invalidate_pte(pte_t *pte, unsigned long addr, unsigned long next, struct mm_walk *walk)
+{
+	struct semeru_invalidate_walk *iw = walk->private;
+	pte_t ptent = *pte;
+	struct page *page;
+	swp_entry_t entry;
+
+	if (pte_none(ptent))
+		return 0;
+
+	if (pte_present(ptent)) {
+		page = vm_normal_page(walk->vma, addr, ptent);
+		if (page == NULL || !PageAnon(page) || PageTransCompound(page))
+			return 0;
+		get_page(page);
+	} else {
+		// Swapped out, only its swap cache page is stale, e.g. read ahead.
+		entry = pte_to_swp_entry(ptent);
+		if (non_swap_entry(entry))
+			return 0;
+		page = find_get_page(swap_address_space(entry), swp_offset(entry));
+		if (page == NULL)
+			return 0;
+	}
+
+	iw->pages[iw->num] = page;
+	iw->addrs[iw->num++] = addr;
+	iw->end = next;
+	return iw->num == SEMERU_INVALIDATE_BATCH; // stop the walk, the batch is full
+}
+
+/**
+ * Give the page a swap slot standing for its copy on the memory server, the identity slot of its address.
+ * Like add_to_swap(), but the frontswap map is marked as stored instead of writing the page out.
+ */
+static bool semeru_invalidate_add_to_swap(struct page *page, unsigned long addr)
+{
+#ifdef SEMERU_SWP_IDENTITY_OFFSET
+	struct swap_info_struct *sis;
+	swp_entry_t entry;
+
+	entry = get_swap_page_semeru(page, addr);
+	if (entry.val == 0)
+		return false;
+
+	if (add_to_swap_cache(page, entry, __GFP_HIGH | __GFP_NOMEMALLOC | __GFP_NOWARN) != 0) {
+		swapcache_free(entry);
+		return false;
+	}
+
+	sis = page_swap_info(page);
+	if (sis->frontswap_map != NULL && !test_and_set_bit(swp_offset(entry), sis->frontswap_map))
+		atomic_inc(&sis->frontswap_pages);
+	return true;
+#else
+	return false; // no slot to translate the address from
+#endif
+}
+
+/**
+ * Unmap a stale page of the data space into swap entries, and drop it from the swap cache.
+ * Return true if the page is gone.
+ */
+static bool semeru_invalidate_page(struct page *page, unsigned long addr, bool *was_mapped)
+{
+	swp_entry_t entry;
+	bool dropped = false;
+
+	*was_mapped = false;
+	if (!trylock_page(page))
+		return false;
+	if (PageWriteback(page) || !PageAnon(page))
+		goto out;
+
+	if (!PageSwapCache(page) && !semeru_invalidate_add_to_swap(page, addr))
+		goto out;
+
+	// The remote copy is the only valid one. Without its frontswap bit, the load would read the swap device.
+	entry.val = page_private(page);
+	if (page_swap_info(page)->frontswap_map == NULL ||
+	    !test_bit(swp_offset(entry), page_swap_info(page)->frontswap_map))
+		goto out;
+
+	if (page_mapped(page)) {
+		*was_mapped = true;
+		if (try_to_unmap(page, TTU_UNMAP | TTU_IGNORE_ACCESS) != SWAP_SUCCESS)
+			goto out;
+	}
+
+	ClearPageDirty(page); // the local content is dropped, not written out
+	delete_from_swap_cache(page);
+	dropped = true;
+out:
+	unlock_page(page);
+	return dropped;
+}
+
+/**
+ * Semeru CPU, the memory servers rewrote the page aligned range [start_addr, start_addr + size) of the data space.
+ * Drop its resident pages and swap cache pages, each touch reads the new data from the memory server.
+ *
+ * return :
+ * 	the number of the local pages not dropped, e.g. locked or under writeback, -1 for error.
+ * 	They still have the content from before the rewrite.
+ */
+int semeru_invalidate_rewritten(char __user *start_addr, unsigned long size)
+{
+	struct mm_struct *mm = current->mm;
+	unsigned long start = (unsigned long)start_addr;
+	unsigned long end = start + size;
+	unsigned long dropped = 0;
+	int left = 0;
+	bool mapped;
+	int i;
+	struct semeru_invalidate_walk iw;
+	struct mm_walk invalidate_walk = {
+		.pte_entry = semeru_invalidate_pte,
+		.mm = mm,
+		.private = &iw,
+	};
+
+	if (!PAGE_ALIGNED(start) || !PAGE_ALIGNED(size) || size == 0 || semeru_data_offset_of(start, size) < 0) {
+		printk(KERN_ERR "%s, wrong range [0x%lx, 0x%lx) \n", __func__, start, end);
+		return -1;
+	}
+
+	down_read(&mm->mmap_sem);
+	while (start < end) {
+		iw.num = 0;
+		iw.end = end;
+		walk_page_range(start, end, &invalidate_walk);
+
+		for (i = 0; i < iw.num; i++) {
+			if (semeru_invalidate_page(iw.pages[i], iw.addrs[i], &mapped)) {
+				if (mapped)
+					swap_out_one_page_record(iw.addrs[i]);
+				dropped++;
+			} else {
+				left++;
+			}
+			put_page(iw.pages[i]);
+		}
+
+		if (iw.num < SEMERU_INVALIDATE_BATCH)
+			break;
+		start = iw.end;
+	}
+	up_read(&mm->mmap_sem);
+
+#if defined(DEBUG_MODE_BRIEF) || defined(DEBUG_MODE_DETAIL)
+	printk("%s, [0x%lx, 0x%lx) %lu pages dropped, %d left \n", __func__, (unsigned long)start_addr, end, dropped,
+	       left);
+#endif
+
+	return left;
+}
@@ -39,11 +39,144 @@
 typedef char* (semeru_rdma_read)(int,  char __user * , unsigned long);
 typedef char* (semeru_rdma_write)(int, int, char __user * , unsigned long);
 
+// prefetch hint for the frontswap path
+// int : prefetch window in pages. 0 to remove the hints, negative to print and reset the prefetch statistics.
+// char _user* 		: start addr
+// unsigned long 	: range size
+typedef int (semeru_prefetch_hint)(int, char __user *, unsigned long);
+
+// vectored control path write
+// A user space array of struct semeru_rdma_iovec, copied into kernel by the syscall.
+// The layout has to be the same with the one in the JVM.
+#define SEMERU_RDMA_IOV_MAX	1024 // entries per syscall
+
+struct semeru_rdma_iovec {
+	int mem_server_id;
+	int write_type;		// 0 for data, 1 for signal
+	char __user *start_addr;
+	unsigned long size;
+};
+
+// struct semeru_rdma_iovec* : kernel copy of the iovec
+// int : number of entries
+// int : 0 for sync, non-zero for async
+// return 0 for sync success, the ticket id for async, -1 for error
+typedef int (semeru_rdma_writev)(struct semeru_rdma_iovec *, int, int);
+
+// int : ticket id returned by the async semeru_rdma_writev
+typedef int (semeru_rdma_wait)(int);
+
+// char __user * : start address of the meta space, page aligned
+// unsigned long : size of the meta space, 0 to unregister
+typedef int (semeru_rdma_meta_reg)(char __user *, unsigned long);
+
+// int : target memory server, -1 for all the memory servers
+// char __user * : start address, unsigned long : size
+// return the number of dirty pages sent, -1 for error
+typedef int (semeru_rdma_write_dirty)(int, char __user *, unsigned long);
+
+// int : memory server id
+// int : the state to wait for, 0 resets the recorded state
+// return 0 when the state is reached, -1 for timeout
+typedef int (semeru_wait_mem_server)(int, int);
+
+// int : memory server id
+// unsigned int : sequence number, sent as the imm_data
+// return 0 for success, -1 for error
+typedef int (semeru_ring_doorbell)(int, unsigned int);
+
+// char __user * : start address of the data space range
+// unsigned long : size of the range
+// int : 1 for expanding the remote chunks, 0 for releasing them
+// return 0 for success, -1 for error
+typedef int (semeru_resize_chunks)(char __user *, unsigned long, int);
+
+// char __user * : address within the data space
+// return the id of the memory server backing it, -1 for error
+typedef int (semeru_query_placement)(char __user *);
+
+// int : fence op, 0 grant, 1 close, 2 release
+// char __user * : start address, unsigned long : size
+// return 1 for a closed intact range, 0 for success or a revoked range, -1 for error
+typedef int (semeru_region_fence)(int, char __user *, unsigned long);
+
+// struct semeru_rdma_iovec * : kernel copy of the iovec, int : entry number
+// return 0 for success, -1 for error
+typedef int (semeru_rdma_readv)(struct semeru_rdma_iovec *, int);
+
+// char __user * : start address, unsigned long : size
+// return the number of swapped out pages whose reads are issued, -1 for error
+typedef int (semeru_prefetch_range)(char __user *, unsigned long);
+
+// int : memory server mask, bit i for memory server i, 0 for all the memory servers
+// int : 0 for data, non-zero for signal
+// char __user * : start address, unsigned long : size
+// return 0 after all the memory servers acknowledged, -1 for error
+typedef int (semeru_rdma_bcast)(int, int, char __user *, unsigned long);
+
+// remote atomic on an 8 bytes word of the meta space, executed by the memory server's RDMA device.
+// The layout has to be the same with the one in the JVM.
+#define SEMERU_RDMA_ATOMIC_CAS		0
+#define SEMERU_RDMA_ATOMIC_FETCH_ADD	1
+
+struct semeru_rdma_atomic {
+	int op;			// SEMERU_RDMA_ATOMIC_xx
+	int pad;
+	char __user *addr;	// 8 bytes aligned, within the meta space
+	uint64_t compare_add;	// the expected value of CAS, or the addend of fetch-and-add
+	uint64_t swap;		// the new value of CAS
+	uint64_t result;	// the old value of the word
+};
+
+// int : memory server id
+// struct semeru_rdma_atomic * : kernel copy of the request, its result is filled in
+// return 0 for success, -1 for error
+typedef int (semeru_rdma_atomic)(int, struct semeru_rdma_atomic *);
+
+// read a few bytes of a swapped out page without swapping it in.
+// The layout has to be the same with the one in the JVM.
+#define SEMERU_RDMA_PEEK_MAX_SIZE	256
+
+struct semeru_rdma_peek {
+	char __user *addr;	// within one page of the data space
+	char __user *buf;	// the bytes are copied here
+	unsigned long size;	// at most SEMERU_RDMA_PEEK_MAX_SIZE
+};
+
+// char __user * : start address, void * : kernel buffer, unsigned long : size
+// return 0 for success, 1 if the page is resident, -1 for error
+typedef int (semeru_rdma_peek)(char __user *, void *, unsigned long);
+
+// char __user * : start address, unsigned long : size
+// return the number of swapped out pages not arrived yet, their reads are issued. -1 for error
+typedef int (semeru_fetch_async)(char __user *, unsigned long);
+
+// unsigned long : a page of the data space
+// return 1 if its data is ready in the swap-in prefetch cache, the swap-in doesn't wait for a memory server
+typedef int (semeru_prefetch_ready)(unsigned long);
+
 
 
 struct semeru_rdma_ops{
 	semeru_rdma_read* 	rdma_read;
 	semeru_rdma_write* 	rdma_write;
+	semeru_prefetch_hint*	prefetch_hint;
+	semeru_rdma_writev*	rdma_writev;
+	semeru_rdma_wait*	rdma_wait;
+	semeru_rdma_meta_reg*	meta_reg;
+	semeru_rdma_write_dirty*	rdma_write_dirty;
+	semeru_wait_mem_server*	wait_mem_server;
+	semeru_ring_doorbell*	ring_doorbell;
+	semeru_resize_chunks*	resize_chunks;
+	semeru_query_placement*	query_placement;
+	semeru_region_fence*	region_fence;
+	semeru_rdma_readv*	rdma_readv;
+	semeru_prefetch_range*	prefetch_range;
+	semeru_rdma_bcast*	rdma_bcast;
+	semeru_rdma_atomic*	rdma_atomic;
+	semeru_rdma_peek*	rdma_peek;
+	semeru_fetch_async*	fetch_async;
+	semeru_prefetch_ready*	prefetch_ready;
 };
 
 
@@ -59,3 +192,26 @@ struct semeru_rdma_ops  rdma_ops_in_kernel;
 
 
 int semeru_force_swapout(unsigned long start_addr, unsigned long end_addr);
+int semeru_rdma_writev_from_user(char __user *iov_addr, unsigned long nr_iov, int async);
+int semeru_rdma_readv_from_user(char __user *iov_addr, unsigned long nr_iov);
+int semeru_swap_out_map_register(int unit_log, char __user *start_addr, unsigned long size);
+int semeru_swap_in_map_register(int unit_log, char __user *start_addr, unsigned long size);
+int semeru_reclaim_hint_register(int unit_log, char __user *start_addr, unsigned long size);
+int semeru_bulk_evict(int async, char __user *start_addr, unsigned long size);
+int semeru_bulk_evict_wait(void);
+int semeru_discard_range(char __user *start_addr, unsigned long size);
+int semeru_rdma_atomic_from_user(int mem_server_id, char __user *atomic_addr);
+int semeru_rdma_peek_from_user(char __user *peek_addr);
+
+// ops of the heap snapshot, the same as the JVM.
+#define SEMERU_SNAPSHOT_SAVE	0
+#define SEMERU_SNAPSHOT_RESTORE	1
+#define SEMERU_SNAPSHOT_DROP	2
+
+int semeru_heap_snapshot(int op, char __user *start_addr, unsigned long size);
+int semeru_fault_around_range(char __user *start_addr, unsigned long size);
+int semeru_cache_limit_register(int period_ms, char __user *start_addr, unsigned long size);
+int semeru_invalidate_rewritten(char __user *start_addr, unsigned long size);
+int semeru_page_affinity_register(char __user *start_addr, unsigned long size);
+int semeru_fault_state_register(int op, char __user *start_addr, unsigned long size);
+int semeru_fault_sample_register(int period, char __user *start_addr, unsigned long size);
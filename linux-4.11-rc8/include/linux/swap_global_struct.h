@@ -35,6 +35,14 @@
 // The memory range not in the RANGE will be not swapped out by adding them into unevictable list.
 #define ENABLE_SWP_ENTRY_VIRT_REMAPPING 1
 
+// #1.1 Identity swap slots for the data space, requires #1.
+//    The swap slot of a data page is allocated at SEMERU_SWP_IDENTITY_BASE + semeru_data_offset_of(vaddr) >> PAGE_SHIFT,
+//    so the offset is translated back by arithmetic instead of the swp_entry_to_virtual_remapping lookup.
+//    The slots of a chunk are contiguous and 2MB aligned. The swap device has to cover the data space of every window.
+#ifdef ENABLE_SWP_ENTRY_VIRT_REMAPPING
+#define SEMERU_SWP_IDENTITY_OFFSET 1
+#endif
+
 // #2 This sync is uselesss. Because all the unmapped dirty page will be writteen to swap partition immediately.
 //#define SYNC_PAGE_OUT
 
@@ -42,6 +50,134 @@
 //    frontswap path only supports one memory server now. We will add the supports of multiple memory servers later.
 #define SEMERU_FRONTSWAP_PATH 1
 
+// #4 Asynchronous frontswap store.
+//    Stored pages are staged into a per-core ring and consecutive swap offsets of the same chunk
+//    are coalesced into one multi-SGE RDMA write. The store returns before the write is acked.
+//    Comment it out to fall back to the synchronous, one page per RDMA write, store path.
+#define SEMERU_FS_ASYNC_STORE 1
+
+// #5 Swap-in prefetch for the frontswap path.
+//    A demand load issues asynchronous RDMA reads for the neighbouring pages within the same chunk.
+//    The policy is sequential, stride or hinted by the JVM via sys_do_semeru_rdma_ops type 9.
+#define SEMERU_FS_PREFETCH 1
+
+// #6 Extent store, requires #4.
+//    Physically contiguous pages, e.g. the sub-pages of a split THP, are merged into one sge.
+//    A 2MB extent of the data regions is written by one RDMA write.
+#ifdef SEMERU_FS_ASYNC_STORE
+#define SEMERU_FS_STORE_EXTENT 1
+#endif
+
+// #7 Adaptive polling for the data path CQ.
+//    A synchronous frontswap load/store spins for a budget derived from the recent completion latency,
+//    then arms the CQ and sleeps until the completion interrupt. The core is not burnt with preemption off.
+//    Comment it out to busy-poll the CQ, via drain_rdma_queue(), for every load/store.
+#define SEMERU_ADAPTIVE_POLLING 1
+
+// #7.1 Dedicated CQ pollers, requires #7.
+//    With the module parameter cq_poller_cpu, kernel threads pinned to the listed cores poll all the data path CQs.
+//    The frontswap load/store sleeps until its poller wakes it, instead of polling the CQ itself.
+//    For the servers sparing a core or two, a steadier fault latency and the mutator cores are left alone.
+#ifdef SEMERU_ADAPTIVE_POLLING
+#define SEMERU_CQ_POLLER 1
+#endif
+
+// #7.2 Persistent DMA mappings of the synchronous data path.
+//    With the module parameter dma_bounce_pages, each rdma_queue keeps a pool of bounce pages mapped once at its setup.
+//    A frontswap load/store copies through one of them, instead of an IOMMU map and unmap of the swapped page.
+#define SEMERU_FS_DMA_BOUNCE 1
+
+// #8 Multiple control path QPs.
+//    The control path picks the rdma_queue of the calling core, so the GC threads on different cores
+//    post and poll on their own QP/CQ. A signal write still drains all the queues of the memory server first.
+//    Comment it out to put all the control path transfers on rdma_queues[control_path_fixed_qp].
+#define SEMERU_CP_MULTI_QP 1
+
+// #9 Compressed local tier of the frontswap path.
+//    The stored pages are also compressed by LZ4 into a bounded local zsmalloc pool, module parameter compress_pool_mb.
+//    A frontswap load hits the pool before the prefetch cache and the RDMA read. Requires CONFIG_ZSMALLOC and CONFIG_LZ4_COMPRESS.
+//    The pool is write-through, the memory servers always have the swapped out pages to trace and compact.
+//    Built only with both configs, and off until compress_pool_mb is set at module load.
+#if IS_ENABLED(CONFIG_ZSMALLOC) && IS_ENABLED(CONFIG_LZ4_COMPRESS)
+#define SEMERU_FS_COMPRESS 1
+#endif
+
+// #10 Zero page elision of the frontswap path.
+//    A zero page already zero on the memory server isn't written again, and is zero filled at load without the RDMA read.
+#define SEMERU_FS_ZERO_PAGE 1
+
+// #10.1 Remote reclamation of the dead swap slots.
+//    The freed swap slots are batched per memory server and sent by the INVALIDATE_PAGES message.
+//    The memory server discards the dead pages, its footprint follows the live data instead of every page ever swapped.
+#define SEMERU_FS_INVALIDATE 1
+
+// #10.1.1 Cold tier of the memory servers, requires #10.1.
+//    With the module parameter cold_report_ms, the data blocks not swapped in or out within a report are handed over
+//    to their memory server by the COLD_BLOCKS message. It may compress them and give the DRAM back,
+//    the first access to a handed over block restores it by the FETCH_BLOCK message before the RDMA read or write.
+#ifdef SEMERU_FS_INVALIDATE
+#define SEMERU_FS_COLD 1
+#endif
+
+// #10.2 CXL transport.
+//    With the module parameter cxl_window, the data Regions of the memory servers are accessed by memcpy and cache flushes
+//    over a window of a CXL memory pool, instead of the RDMA read/write. The meta Region and the messages stay on RDMA.
+#define SEMERU_TRANSPORT_CXL 1
+
+// #10.3 TCP transport.
+//    With the module parameter tcp_transport=1, the data Regions and the control path copies go over kernel TCP sockets
+//    to the memory servers, -XX:+SemeruTCPTransport. For the development and CI machines without an HCA,
+//    the 2-sided messages still need an RDMA device, e.g. soft-RoCE (rxe).
+#define SEMERU_TRANSPORT_TCP 1
+
+// #10.4 Clean swap-ins.
+//    With the module parameter keep_clean_swapin, a page of the data space swapped in by a read fault keeps its swap slot,
+//    the copy on the memory server stays valid. The reclaim drops the page again for free while it isn't written,
+//    a write fault frees the slot as usual and the next eviction stores the new data.
+#define SEMERU_FS_CLEAN_SWAPIN 1
+
+// #11 Latency histograms of the swap and control paths.
+//    Per-core log2 histograms of the frontswap store/load, the control path read/write and the CQ draining,
+//    per memory server. Read from /sys/kernel/debug/semeru/latency. Costs two clock reads per operation.
+#define SEMERU_FS_LATENCY_HIST 1
+
+// #12 Micro-benchmark of the frontswap path, requires #11.
+//    Synthetic stores and loads issued by kernel threads, driven by /sys/kernel/debug/semeru/bench
+//    and the user tool semeru/bench/semeru_bench.c. It overwrites the remote pages it touches, run it without the JVMs.
+#ifdef SEMERU_FS_LATENCY_HIST
+#define SEMERU_FS_BENCH 1
+#endif
+
+// #13 Live migration of the data chunks between the memory servers, requires #11 and SEMERU_PLACEMENT_LOAD.
+//    Driven by /sys/kernel/debug/semeru/migrate, a data chunk is copied to another memory server while the stores
+//    to it are mirrored, then its placement is switched at the next GC pause of the JVM. Drains a memory server,
+//    or evens out the data chunks of the memory servers, without restarting the JVM.
+#ifdef SEMERU_FS_LATENCY_HIST
+#define SEMERU_CHUNK_MIGRATION 1
+#endif
+
+// #13.1 CPU-local SSD tier of the frontswap path, requires #13.
+//    With the module parameter local_swap_file, a store goes to the local NVMe instead when its memory server
+//    is out of credit, unreachable or doesn't ack within 5ms. A bitmap records the pages whose latest copy is local,
+//    the loads check it first. A background worker writes them to the memory servers once they recover.
+#ifdef SEMERU_CHUNK_MIGRATION
+#define SEMERU_FS_LOCAL_TIER 1
+#endif
+
+// #14 Emulation of a slower fabric, for the capacity planning.
+//    With the module parameters emu_delay_us, emu_jitter_us and emu_bw_mbps, each successful frontswap load/store
+//    and control path read/write waits for the added latency and a token bucket of its memory server.
+//    Writable at runtime under /sys/module/semeru_cpu_server/parameters/. All 0, the default, costs one check per operation.
+#define SEMERU_FS_EMULATE 1
+
+// #15 Trace of the swap-ins and swap-outs, requires #11.
+//    Each successful frontswap load/store appends a 24 bytes record to the ring of its core, read from /dev/semeru_trace.
+//    The rings are only allocated with the module parameter trace_entries, 0 by default, then recording costs no clock read.
+//    The user tool semeru/bench/semeru_replay.c saves the trace and replays it against other prefetch and eviction policies.
+#ifdef SEMERU_FS_LATENCY_HIST
+#define SEMERU_FS_TRACE 1
+#endif
+
 
 //
 // ##################### Parameters configuration  ###################### 
@@ -49,37 +185,52 @@
 
 // Structures of the Regions
 // | -- Meta Region -- | -- Data Regsons --|
-//  The meta Regions starts from SEMERU_START_ADDR. Its size is defined by RDMA_STRUCTURE_SPACE_SIZE.
+//  The meta Regions starts from the start of the address window. Its size is defined by RDMA_STRUCTURE_SPACE_SIZE.
 #define REGION_SIZE_GB 4UL // RDMA manage granularity, not the Heap Region.
 #define RDMA_META_REGION_NUM 1UL
 #define RDMA_DATA_REGION_NUM 8UL  // default 32GB
-#define SEMERU_START_ADDR 0x400000000000UL
-#define NUM_OF_MEMORY_SERVER 1UL  // default 2 memory servers
+#define SEMERU_BASE_START_ADDR 0x400000000000UL
+// The address windows of the Semeru JVMs, module parameter address_windows and JVM option SemeruAddressWindow.
+// Window w holds the meta and data space at SEMERU_BASE_START_ADDR + w * SEMERU_ADDRESS_WINDOW_SIZE.
+#define SEMERU_ADDRESS_WINDOW_SHIFT 40
+#define SEMERU_ADDRESS_WINDOW_SIZE (1UL << SEMERU_ADDRESS_WINDOW_SHIFT)  // 1TB
+#define SEMERU_MAX_ADDRESS_WINDOWS 16UL
+#define NUM_OF_MEMORY_SERVER 1UL  // default number of memory servers, overridden at runtime.
+#define MAX_NUM_OF_MEMORY_SERVER 8UL // upper bound of the runtime memory server topology.
 
 // ###
 // below is derived macros
 
 //
-// Meta space
-#define RDMA_META_SPACE_START_ADDR (SEMERU_START_ADDR)
+// Meta space, at the start of its window
 #define RDMA_STRUCTURE_SPACE_SIZE (RDMA_META_REGION_NUM * REGION_SIZE_GB * ONE_GB)
 
 //
-// Data space
-#define RDMA_DATA_SPACE_START_ADDR (RDMA_META_SPACE_START_ADDR + RDMA_STRUCTURE_SPACE_SIZE)
+// Data space, right after the meta space of its window
+#define RDMA_DATA_SPACE_SIZE (RDMA_DATA_REGION_NUM * REGION_SIZE_GB * ONE_GB)
 #define DATA_REGION_PER_MEM_SERVER (RDMA_DATA_REGION_NUM / NUM_OF_MEMORY_SERVER)
 
+// Runtime topology, N memory servers with RDMA_DATA_REGION_NUM % N == 0 :
+// memory server i owns the data Regions [i * RDMA_DATA_REGION_NUM/N, (i+1) * RDMA_DATA_REGION_NUM/N).
+// The N is configured by the Semeru module parameter, num_mem_servers, and the JVM option, SemeruMemServerNum.
+// The macros below only describe the default, NUM_OF_MEMORY_SERVER, topology.
+//
+// Placement policy of the data Regions, module parameter placement_policy and JVM option SemeruPlacementPolicy.
+// Each memory server still backs data_region_per_mem_server data Regions, only the order changes.
+// A data Region keeps its chunk index, RDMA_META_REGION_NUM + i, on the memory server picked,
+// which maps chunk k at its heap start + k * REGION_SIZE_GB. So every memory server reserves the whole window.
+#define SEMERU_PLACEMENT_RANGE 0      // the contiguous split above.
+#define SEMERU_PLACEMENT_INTERLEAVE 1 // round-robin, data Region i is on memory server i % N.
+#define SEMERU_PLACEMENT_LOAD 2       // the least loaded memory server is picked at the first access of a data Region.
+
 // Memory server #1, Data Region[1] to Region[5]
 // Only being used for correctness checks,
 // Plase calculated this derived information.
 #define MEMORY_SERVER_0_REGION_START_ID (RDMA_META_REGION_NUM)
-#define MEMORY_SERVER_0_START_ADDR (RDMA_DATA_SPACE_START_ADDR)
 
 // Memory server #2, Data Region[5] to Region[9]
 #define MEMORY_SERVER_1_REGION_START_ID (MEMORY_SERVER_0_REGION_START_ID + DATA_REGION_PER_MEM_SERVER)
 //#define MEMORY_SERVER_1_REGION_START_ID 9 //debug, single server
-#define MEMORY_SERVER_1_START_ADDR (MEMORY_SERVER_0_START_ADDR + DATA_REGION_PER_MEM_SERVER * REGION_SIZE_GB * ONE_GB)
-
 
 //
 // ###################### Debug options ######################
@@ -353,7 +504,7 @@ struct AddrPair{
 //
 // x. End of RDMA structure commit size
 //
-#define END_OF_RDMA_COMMIT_ADDR   (size_t)(SEMERU_START_ADDR + RDMA_PADDING_OFFSET + RDMA_PADDING_SIZE_LIMIT)
+#define END_OF_RDMA_COMMIT_OFFSET (size_t)(RDMA_PADDING_OFFSET + RDMA_PADDING_SIZE_LIMIT)  // to the start of the window
 
 // properties for the whole Semeru heap.
 // [ RDMA meta data sapce] [RDMA data space]
@@ -362,6 +513,10 @@ struct AddrPair{
 #define MAX_REGION_NUM    ((size_t) MAX_FREE_MEM_GB/REGION_SIZE_GB)     //for msg passing, ?
 #define MAX_SWAP_MEM_GB   (u64)(REGION_SIZE_GB * RDMA_DATA_REGION_NUM)		// Space managed by SWAP
 
+// The unit of the cold tier of the memory servers, see semeru/frontswap_cold.c.
+#define SEMERU_COLD_BLOCK_SHIFT   21UL    // 2MB, a huge page of the memory server
+#define SEMERU_COLD_BLOCK_SIZE    ((size_t)1 << SEMERU_COLD_BLOCK_SHIFT)
+
 
 
 
@@ -383,6 +538,68 @@ struct AddrPair{
 // File address to Remote virtual memory address translation
 //
 
+// The address windows served by the Semeru module, module parameter address_windows.
+// Slot s of the module serves window semeru_windows[s], its RDMA sessions and shared maps are the s-th ones.
+// Defined in extra_syscall/semeru_syscall.c, set by the module at load, window 0 only without it.
+extern unsigned int semeru_nr_windows;
+extern unsigned int semeru_windows[SEMERU_MAX_ADDRESS_WINDOWS];
+extern int semeru_window_slot[SEMERU_MAX_ADDRESS_WINDOWS]; // slot of each window, -1 if not served
+
+int semeru_window_of_mm(struct mm_struct *mm);
+
+// The slot serving the window of addr, -1 if it isn't served.
+static inline int semeru_window_of(unsigned long addr){
+	unsigned long window;
+
+	if (addr < SEMERU_BASE_START_ADDR)
+		return -1;
+	window = (addr - SEMERU_BASE_START_ADDR) >> SEMERU_ADDRESS_WINDOW_SHIFT;
+	if (window >= SEMERU_MAX_ADDRESS_WINDOWS)
+		return -1;
+	return READ_ONCE(semeru_window_slot[window]);
+}
+
+static inline unsigned long semeru_meta_start(int slot){
+	return SEMERU_BASE_START_ADDR + ((unsigned long)READ_ONCE(semeru_windows[slot]) << SEMERU_ADDRESS_WINDOW_SHIFT);
+}
+
+static inline unsigned long semeru_data_start(int slot){
+	return semeru_meta_start(slot) + RDMA_STRUCTURE_SPACE_SIZE;
+}
+
+// The data offset concatenates the data spaces of the slots, slot s covers [s, s + 1) * RDMA_DATA_SPACE_SIZE.
+// It indexes the per page and per chunk state of the module and the identity swap slots.
+static inline unsigned long semeru_data_space_size(void){
+	return READ_ONCE(semeru_nr_windows) * RDMA_DATA_SPACE_SIZE;
+}
+
+// The data offset of [addr, addr + size), -1 unless it's within the data space of one served window.
+static inline long semeru_data_offset_of(unsigned long addr, unsigned long size){
+	int slot = semeru_window_of(addr);
+	unsigned long start;
+
+	if (slot < 0)
+		return -1;
+	start = semeru_data_start(slot);
+	if (addr < start || size > RDMA_DATA_SPACE_SIZE || addr - start > RDMA_DATA_SPACE_SIZE - size)
+		return -1;
+	return (long)((unsigned long)slot * RDMA_DATA_SPACE_SIZE + (addr - start));
+}
+
+static inline unsigned long semeru_data_addr(unsigned long offset){
+	return semeru_data_start(offset / RDMA_DATA_SPACE_SIZE) + offset % RDMA_DATA_SPACE_SIZE;
+}
+
+// The slot of [addr, addr + size), -1 unless it's within the meta space of one served window.
+static inline int semeru_meta_window_of(unsigned long addr, unsigned long size){
+	int slot = semeru_window_of(addr);
+
+	if (slot < 0 || size > RDMA_STRUCTURE_SPACE_SIZE ||
+	    addr - semeru_meta_start(slot) > RDMA_STRUCTURE_SPACE_SIZE - size)
+		return -1;
+	return slot;
+}
+
 
 
 
@@ -72,7 +72,7 @@ static inline void reset_swap_remamping_virt_addr(swp_entry_t entry){
 }
 
 // [x] virtual address is countted in PAGE.
-// The stored value is the offset to RDMA_DATA_SPACE_START_ADDR.
+// The stored value is the data offset, see semeru_data_offset_of().
 // We can't use the absolute virtual address to as the sector address.
 // It will not pass the sector size check. [sector 0, sector N)
 static inline unsigned long retrieve_swap_remmaping_virt_addr(swp_entry_t entry){
@@ -81,6 +81,32 @@ static inline unsigned long retrieve_swap_remmaping_virt_addr(swp_entry_t entry)
 
 unsigned long retrieve_swap_remmaping_virt_addr_via_offset(pgoff_t offset);
 
+
+#ifdef SEMERU_SWP_IDENTITY_OFFSET
+// Offset 0 is the swap header. Skip a whole 2MB extent to keep the data pages aligned.
+#define SEMERU_SWP_IDENTITY_BASE	((pgoff_t)(1UL << (PMD_SHIFT - PAGE_SHIFT)))
+
+// The identity swap slot of a data space page, vaddr within the data space of a served window.
+static inline pgoff_t semeru_virt_to_swp_offset(unsigned long vaddr){
+	long offset = semeru_data_offset_of(vaddr, PAGE_SIZE);
+
+	VM_BUG_ON(offset < 0);
+	return SEMERU_SWP_IDENTITY_BASE + ((unsigned long)offset >> PAGE_SHIFT);
+}
+
+// [x] virtual address is countted in PAGE, the data offset, see semeru_data_offset_of().
+// Same as retrieve_swap_remmaping_virt_addr_via_offset(), without the table.
+static inline unsigned long semeru_swp_offset_to_virt_page(pgoff_t offset){
+	VM_BUG_ON(offset < SEMERU_SWP_IDENTITY_BASE);
+	return offset - SEMERU_SWP_IDENTITY_BASE;
+}
+
+// Reserve the identity slot of the data page mapped at vaddr, called by the swap slot allocator.
+// Return the swap entry, or (swp_entry_t){0} if the slot is still held, e.g. by the swap cache of the old copy.
+// The page is not reclaimed this round then, there is no other slot it can be translated from.
+swp_entry_t get_swap_page_semeru(struct page *page, unsigned long vaddr);
+#endif
+
 //
 // ###################### Debug functions ######################
 //
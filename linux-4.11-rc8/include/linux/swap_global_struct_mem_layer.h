@@ -14,6 +14,10 @@
 #define __LINUX_SWAP_SWAP_GLOBAL_STRUCT_MEM_LAYER_H
 
 #include <linux/swap_global_struct.h>
+#include <linux/rcupdate.h>
+#include <linux/hash.h>
+#include <linux/ptrace.h>
+#include <linux/spinlock.h>
 //#include <linux/pagemap.h>
 
 //
@@ -21,11 +25,12 @@
 //
 
 
-//#define SWAP_OUT_MONITOR_VADDR_START		(size_t)(SEMERU_START_ADDR+ RDMA_STRUCTURE_SPACE_SIZE)  // Start of Data Regions, 0x400,100,000,000
-#define SWAP_OUT_MONITOR_VADDR_START		(size_t)SEMERU_START_ADDR // Start of Meta Region, 0x400,000,000,000
+// Start of the Meta Region of window 0, 0x400,000,000,000. The array covers all the address windows.
+#define SWAP_OUT_MONITOR_VADDR_START		(size_t)SEMERU_BASE_START_ADDR
 #define SWAP_OUT_MONITOR_UNIT_LEN_LOG		26 // 1<<26, recording granulairy is 64M per entry. The query can span multiple entries.
 #define SWAP_OUT_MONITOR_OFFSET_MASK		(u64)(~((1<<SWAP_OUT_MONITOR_UNIT_LEN_LOG) -1))		//0xfffffffff0000000
 #define SWAP_OUT_MONITOR_ARRAY_LEN		(u64)2*1024*1024 //2M item, Coverred heap size: SWAP_OUT_MONITOR_ARRAY_LEN * (1<<SWAP_OUT_MONITOR_UNIT_LENG_LOG)
+#define SWAP_OUT_MONITOR_WINDOW_ENTRIES		(u64)(SEMERU_ADDRESS_WINDOW_SIZE >> SWAP_OUT_MONITOR_UNIT_LEN_LOG) // 16K items per address window
 
 
 
@@ -205,6 +210,301 @@ extern atomic_t hit_on_swap_cache_number;
 extern atomic_t jvm_region_swap_out_counter[]; // 4 bytes for each counter is good enough.
 
 
+/**
+ * The swapped out pages shared with the JVM, sys_do_semeru_rdma_ops type 22.
+ *
+ * The JVM registers a page aligned array of 4 bytes counters, one for each (1 << unit_log) bytes
+ * of the data space of its address window, starting from semeru_data_start(). The unit is usually the G1 Region.
+ * Each served window has its own map, the ones below too.
+ * The kernel pins the pages and maps them into kernel space, the counters are updated along with
+ * jvm_region_swap_out_counter[]. The JVM reads them by plain loads instead of a syscall per Region.
+ *
+ * Replaced or unregistered under RCU, the swap path never waits for it.
+ */
+struct swap_out_shared_map {
+	u32 unit_log;
+	u32 nr_entries;
+	unsigned long nr_pages;
+	struct page **pages;	// pinned user pages
+	atomic_t *counters;	// vmap of the pages
+};
+
+extern struct swap_out_shared_map __rcu *swap_out_shared_map[SEMERU_MAX_ADDRESS_WINDOWS];
+
+static inline void swap_out_shared_map_add(u64 vaddr, int delta){
+	struct swap_out_shared_map *map;
+	int slot = semeru_window_of(vaddr);
+	u64 entry_ind;
+
+	if (slot < 0)
+		return;
+	rcu_read_lock();
+	map = rcu_dereference(swap_out_shared_map[slot]);
+	if (map != NULL && vaddr >= semeru_data_start(slot)) {
+		entry_ind = (vaddr - semeru_data_start(slot)) >> map->unit_log;
+		if (entry_ind < map->nr_entries)
+			atomic_add(delta, &map->counters[entry_ind]);
+	}
+	rcu_read_unlock();
+}
+
+/**
+ * The swap-ins shared with the JVM, sys_do_semeru_rdma_ops type 36. The same layout with the swap out map.
+ * Each counter only grows, by one for each page of its unit loaded from the memory servers,
+ * demand or prefetched. The JVM decays the deltas between two reads into the heat of the Region.
+ */
+extern struct swap_out_shared_map __rcu *swap_in_shared_map[SEMERU_MAX_ADDRESS_WINDOWS];
+
+static inline void swap_in_shared_map_inc(u64 vaddr){
+	struct swap_out_shared_map *map;
+	int slot = semeru_window_of(vaddr);
+	u64 entry_ind;
+
+	if (slot < 0)
+		return;
+	rcu_read_lock();
+	map = rcu_dereference(swap_in_shared_map[slot]);
+	if (map != NULL && vaddr >= semeru_data_start(slot)) {
+		entry_ind = (vaddr - semeru_data_start(slot)) >> map->unit_log;
+		if (entry_ind < map->nr_entries)
+			atomic_inc(&map->counters[entry_ind]);
+	}
+	rcu_read_unlock();
+}
+
+
+
+/**
+ * The reclaim hints of the JVM, sys_do_semeru_rdma_ops type 30.
+ *
+ * The JVM registers a page aligned array of 1 byte hints, one for each (1 << unit_log) bytes
+ * of the data space, and rewrites a hint whenever its Region changes type :
+ * 	bits 0-3, the G1HeapRegionTraceType of the Region, for debugging;
+ * 	bits 4-5, the reclaim priority, SEMERU_RECLAIM_xx.
+ * The kernel only reads them. Pinned and replaced under RCU like the swap out map.
+ *
+ * A Region is published as non-free before the JVM allocates in it. A store reads the hint after
+ * the page is unmapped, so a page written after the Region left the free list is never discarded.
+ */
+#define SEMERU_REGION_TYPE_MASK		0xf
+#define SEMERU_RECLAIM_SHIFT		4
+
+#define SEMERU_RECLAIM_NORMAL		0 // no hint, e.g. not committed by the JVM
+#define SEMERU_RECLAIM_KEEP		1 // eden and survivor, and the RDMA meta space
+#define SEMERU_RECLAIM_FIRST		2 // old and humongous
+#define SEMERU_RECLAIM_DISCARD		3 // free, the content is dead. Evicted without the write back.
+
+struct reclaim_hint_shared_map {
+	u32 unit_log;
+	u32 nr_entries;
+	unsigned long nr_pages;
+	struct page **pages;	// pinned user pages
+	u8 *hints;		// vmap of the pages
+};
+
+extern struct reclaim_hint_shared_map __rcu *reclaim_hint_shared_map[SEMERU_MAX_ADDRESS_WINDOWS];
+
+static inline int semeru_reclaim_priority(u64 vaddr){
+	struct reclaim_hint_shared_map *map;
+	int slot = semeru_window_of(vaddr);
+	u64 entry_ind;
+	int priority = SEMERU_RECLAIM_NORMAL;
+
+	if (slot < 0)
+		return SEMERU_RECLAIM_NORMAL;
+	if (vaddr < semeru_data_start(slot))
+		return SEMERU_RECLAIM_KEEP; // the CHeapRDMAObj structures and the flag pages
+
+	rcu_read_lock();
+	map = rcu_dereference(reclaim_hint_shared_map[slot]);
+	if (map != NULL) {
+		entry_ind = (vaddr - semeru_data_start(slot)) >> map->unit_log;
+		if (entry_ind < map->nr_entries)
+			priority = (READ_ONCE(map->hints[entry_ind]) >> SEMERU_RECLAIM_SHIFT) & 0x3;
+	}
+	rcu_read_unlock();
+
+	return priority;
+}
+
+/**
+ * Semeru CPU - The page affinity of the data space, -XX:+SemeruPageAffinity.
+ *
+ * The memory servers trace the Regions root by root, and link the pages reached from the same root
+ * into a ring. One s32 per page of the data space, the distance in pages to the next page of its ring,
+ * 0 for a page out of any ring. The JVM pulls the table from the meta space, the kernel only reads it.
+ * A ring may be torn while the JVM rewrites it, the walk is bounded, a wrong page only wastes a prefetch.
+ */
+struct page_affinity_shared_map {
+	u32 nr_entries;
+	unsigned long nr_pages;
+	struct page **pages;	// pinned user pages
+	s32 *next;		// vmap of the pages
+};
+
+extern struct page_affinity_shared_map __rcu *page_affinity_shared_map[SEMERU_MAX_ADDRESS_WINDOWS];
+
+// Under rcu_read_lock(). The distance to the next page of the ring of the data page, 0 for none.
+static inline s32 semeru_page_affinity_next(struct page_affinity_shared_map *map, u64 page_ind){
+	if (map == NULL || page_ind >= map->nr_entries)
+		return 0;
+	return READ_ONCE(map->next[page_ind]);
+}
+
+/**
+ * Semeru CPU - The remote faults of the JVM threads, -XX:+SemeruSafepointFaultState.
+ *
+ * The JVM shares one u32 array, pinned and replaced under RCU like the maps above.
+ * 	Entry 0, SEMERU_FAULT_SAFEPOINT, is written by the JVM. Non-zero while it synchronizes a safepoint.
+ * 	Entry i > 0 is the slot of one JVM thread, registered by the thread itself. The kernel sets it
+ * 	while the thread is in a frontswap load, the JVM attributes its time to safepoint to the load.
+ * The thread of a slot is found by its pid, an open addressing table of the kernel.
+ */
+#define SEMERU_FAULT_SAFEPOINT		0
+#define SEMERU_FAULT_PROBE		8 // slots probed per pid at most
+#define SEMERU_FAULT_TID_FREE		0
+#define SEMERU_FAULT_TID_GONE		(-1) // a dropped slot, the probe goes on
+
+struct fault_state_tid {
+	pid_t pid;
+	u32 slot;
+};
+
+struct fault_state_shared_map {
+	u32 nr_entries;
+	unsigned long nr_pages;
+	struct page **pages;	// pinned user pages
+	u32 *state;		// vmap of the pages
+	u32 hash_bits;
+	struct fault_state_tid *tids;
+};
+
+extern struct fault_state_shared_map __rcu *fault_state_shared_map[SEMERU_MAX_ADDRESS_WINDOWS];
+
+/**
+ * Semeru CPU - The sampled swap-ins of the JVM, -XX:SemeruFaultSamplePeriod.
+ *
+ * The JVM shares a ring, pinned and replaced under RCU like the maps above. 1 of period swap-ins of the JVM's
+ * process is written into it, the user ip and sp of the faulting thread and the faulting address.
+ * The kernel only writes head and the samples before it, the JVM only writes tail. A full ring drops the sample.
+ * The same layout as the JVM's globalDefinitions.hpp.
+ */
+struct semeru_fault_sample {
+	u64 ip;			// the user ip, of the faulting instruction, or after the syscall touching the page
+	u64 sp;
+	u64 vaddr;		// the faulting address, or the page if it's unknown
+	u32 latency_ns;
+	u32 type;		// how it was served, the same as enum fs_trace_type of the module
+	s32 tid;
+	u32 pad;
+};
+
+struct semeru_fault_sample_ring {
+	u64 head;
+	u64 tail;
+	u64 dropped;
+	u32 nr_entries;
+	u32 period;
+	u64 reserved[4];	// the samples start at the second cache line
+	struct semeru_fault_sample samples[0];
+};
+
+struct fault_sample_shared_map {
+	struct mm_struct *mm;	// of the JVM, the other processes aren't sampled
+	atomic_t count;
+	spinlock_t lock;	// the producers
+	unsigned long nr_pages;
+	struct page **pages;	// pinned user pages
+	struct semeru_fault_sample_ring *ring;	// vmap of the pages
+};
+
+extern struct fault_sample_shared_map __rcu *fault_sample_shared_map[SEMERU_MAX_ADDRESS_WINDOWS];
+
+// Under rcu_read_lock(). The slot of the thread pid, 0 for none.
+static inline u32 semeru_fault_slot(struct fault_state_shared_map *map, pid_t pid){
+	u32 i, ind;
+	pid_t cur;
+
+	if (map == NULL)
+		return 0;
+	ind = hash_32((u32)pid, map->hash_bits);
+	for (i = 0; i < SEMERU_FAULT_PROBE; i++) {
+		cur = READ_ONCE(map->tids[ind].pid);
+		if (cur == pid)
+			return READ_ONCE(map->tids[ind].slot);
+		if (cur == SEMERU_FAULT_TID_FREE)
+			break;
+		ind = (ind + 1) & ((1U << map->hash_bits) - 1);
+	}
+	return 0;
+}
+
+/**
+ * Mark the current thread in, or out of, a remote fault of vaddr, in the map of the window of vaddr.
+ * Return true if the JVM is synchronizing a safepoint.
+ */
+static inline bool semeru_fault_state_set(unsigned long vaddr, u32 in_fault){
+	struct fault_state_shared_map *map;
+	int window = semeru_window_of(vaddr);
+	bool safepoint = false;
+	u32 slot;
+
+	if (window < 0)
+		return false;
+	rcu_read_lock();
+	map = rcu_dereference(fault_state_shared_map[window]);
+	slot = semeru_fault_slot(map, current->pid);
+	if (slot != 0) {
+		WRITE_ONCE(map->state[slot], in_fault);
+		safepoint = READ_ONCE(map->state[SEMERU_FAULT_SAFEPOINT]) != 0;
+	}
+	rcu_read_unlock();
+
+	return safepoint;
+}
+
+/**
+ * Sample the swap-in of vaddr by the current thread, after it's done.
+ * In the task context, the user registers are the ones of the fault, or of the syscall touching the page.
+ */
+static inline void semeru_fault_sample(unsigned long vaddr, u32 type, u64 latency_ns){
+	struct fault_sample_shared_map *map;
+	struct semeru_fault_sample_ring *ring;
+	struct semeru_fault_sample *sample;
+	struct pt_regs *regs;
+	int window = semeru_window_of(vaddr);
+	unsigned long flags;
+	u64 head;
+
+	if (window < 0)
+		return;
+	rcu_read_lock();
+	map = rcu_dereference(fault_sample_shared_map[window]);
+	if (map == NULL || map->mm != current->mm ||
+	    (u32)atomic_inc_return(&map->count) % READ_ONCE(map->ring->period) != 0)
+		goto out;
+
+	ring = map->ring;
+	regs = task_pt_regs(current);
+	spin_lock_irqsave(&map->lock, flags);
+	head = ring->head;
+	if (head - READ_ONCE(ring->tail) >= ring->nr_entries) {
+		ring->dropped++;
+	} else {
+		sample = &ring->samples[head % ring->nr_entries];
+		sample->ip = instruction_pointer(regs);
+		sample->sp = user_stack_pointer(regs);
+		sample->vaddr = vaddr;
+		sample->latency_ns = (u32)min_t(u64, latency_ns, U32_MAX);
+		sample->type = type;
+		sample->tid = current->pid;
+		// The JVM reads the sample after it sees the head.
+		smp_store_release(&ring->head, head + 1);
+	}
+	spin_unlock_irqrestore(&map->lock, flags);
+out:
+	rcu_read_unlock();
+}
 
 // Invoked in syscall sys_swap_stat_reset_and_check
 static inline void reset_swap_info(void){
@@ -248,8 +548,12 @@ static inline int get_hit_on_swap_cache_number(void){
 //	  If it's swapped in, we already decrease it from the count.
 static inline void swap_out_one_page_record(u64 vaddr){
 	u64 entry_ind = (vaddr - SWAP_OUT_MONITOR_VADDR_START) >> SWAP_OUT_MONITOR_UNIT_LEN_LOG;
+
+	if (unlikely(vaddr < SWAP_OUT_MONITOR_VADDR_START || entry_ind >= SWAP_OUT_MONITOR_ARRAY_LEN))
+		return;
 	//jvm_region_swap_out_counter[entry_ind]++;
 	atomic_inc(&jvm_region_swap_out_counter[entry_ind]);
+	swap_out_shared_map_add(vaddr, 1);
 
 	#ifdef DEBUG_MODE_DETAIL
 		printk("%s, swap out page, entry[0x%llx] vaddr 0x%llx \n", __func__, entry_ind, vaddr);
@@ -261,8 +565,12 @@ static inline void swap_out_one_page_record(u64 vaddr){
 //
 static inline void swap_in_one_page_record(u64 vaddr){
 	u64 entry_ind = (vaddr - SWAP_OUT_MONITOR_VADDR_START) >> SWAP_OUT_MONITOR_UNIT_LEN_LOG;
+
+	if (unlikely(vaddr < SWAP_OUT_MONITOR_VADDR_START || entry_ind >= SWAP_OUT_MONITOR_ARRAY_LEN))
+		return;
 	//jvm_region_swap_out_counter[entry_ind]--;
 	atomic_dec(&jvm_region_swap_out_counter[entry_ind]);
+	swap_out_shared_map_add(vaddr, -1);
 
 	#ifdef DEBUG_MODE_DETAIL
 		printk("%s, swap in page, entry[0x%llx], vaddr 0x%llx \n", __func__, entry_ind, vaddr);
@@ -275,6 +583,7 @@ static inline void swap_in_one_page_record(u64 vaddr){
  * 2) end_vaddr - start_vaddr should be Region alignment and 1 Region at least.
  * 		For the corner case, end_vaddr must > start_vaddr, 
  * 		the size can't be 0.
+ * 3) The range out of the monitored windows counts nothing.
  */
 static inline u64 swap_out_pages_for_range(u64 start_vaddr, u64 end_vaddr){
 	u64 entry_start = (start_vaddr - SWAP_OUT_MONITOR_VADDR_START)>> SWAP_OUT_MONITOR_UNIT_LEN_LOG;
@@ -282,6 +591,10 @@ static inline u64 swap_out_pages_for_range(u64 start_vaddr, u64 end_vaddr){
 	u64 swap_out_total = 0;
 	u32 i;
 
+	if (start_vaddr < SWAP_OUT_MONITOR_VADDR_START || end_vaddr <= start_vaddr ||
+	    entry_end >= SWAP_OUT_MONITOR_ARRAY_LEN)
+		return 0;
+
 	#if defined(DEBUG_MODE_BRIEF) || defined(DEBUG_MODE_DETAIL)
 	printk("%s, Get the swapped out pages for addr[0x%llx, 0x%llx), entry[0x%llx, 0x%llx] \n", __func__, 
 																															(u64)start_vaddr, (u64)end_vaddr,
@@ -307,6 +620,18 @@ int is_page_in_swap_cache(pte_t	pte);
 struct page* page_in_swap_cache(pte_t	pte); 
 struct page* try_to_find_page_in_swap_cache(swp_entry_t entry);
 
+// Fault-around, extra_syscall/semeru_syscall.c.
+// do_swap_page() calls it for the pmd of a data space fault after the faulting page is mapped and the pte
+// is unlocked, the arrived neighbours are mapped without a fault of their own.
+struct vm_area_struct;
+int semeru_fault_around(struct vm_area_struct *vma, unsigned long start, unsigned long end);
+
+// Clean swap-ins, extra_syscall/semeru_syscall.c.
+// do_swap_page() doesn't free the swap slot of the page it swapped in, e.g. for vm_swap_full(), if it returns true.
+// The page stays clean in the swap cache, the reclaim drops it without a store while it isn't written.
+extern int semeru_keep_clean_swapin; // set by the Semeru module
+bool semeru_swap_keep_slot(unsigned long address, unsigned int fault_flags);
+
 
 
 
@@ -0,0 +1,352 @@
+/**
+ * Semeru micro-benchmark, the user tool. No JVM needed, only the loaded semeru_cpu_server module.
+ *
+ * 1) Data path, the frontswap store/load. Run by the kernel threads of frontswap_bench.c,
+ *    the arguments are passed to /sys/kernel/debug/semeru/bench as they are :
+ * 	semeru_bench dp op=load threads=8 ops=200000 pages=1 pattern=zipf range_mb=512 servers=2
+ *
+ * 2) Control path, the one-sided read/write of the meta space, sys_do_semeru_rdma_ops type 1 and 2.
+ *    Run by the threads of this tool, the meta space has to be mapped in the caller :
+ * 	semeru_bench cp op=write threads=4 ops=10000 size_kb=64 pattern=rand range_mb=64 servers=2
+ *    The buffer is the top range_mb of the meta Region, accessed as range_mb / size_kb slots.
+ *    Thread t sends its requests to memory server t % servers.
+ *
+ * Both print a summary line, then per memory server : count p50_ns p99_ns p999_ns and the log2 buckets.
+ * The percentiles are the upper bounds of their buckets, the same as /sys/kernel/debug/semeru/latency.
+ *
+ * Warning : both overwrite the remote memory they write, run them before the JVMs.
+ *
+ * Build : gcc -O2 -pthread -o semeru_bench semeru_bench.c -lm
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+// The same as include/linux/swap_global_struct.h and the JVM's globalDefinitions.hpp.
+#define SYS_DO_SEMERU_RDMA_OPS		333
+#define SEMERU_START_ADDR		0x400000000000UL
+#define RDMA_STRUCTURE_SPACE_SIZE	(4UL << 30) // one 4GB meta Region
+#define MAX_NUM_OF_MEMORY_SERVER	8
+
+#define BENCH_DEBUGFS			"/sys/kernel/debug/semeru/bench"
+#define LAT_BUCKETS			32
+#define MAX_THREADS			256
+
+enum { PATTERN_SEQ = 0, PATTERN_RAND, PATTERN_ZIPF };
+
+struct cp_config {
+	int write;
+	int pattern;
+	unsigned int threads;
+	unsigned int ops;
+	unsigned int size_kb;
+	unsigned int range_mb;
+	unsigned int servers;
+	unsigned int seed;
+	char *buf;
+	uint64_t slots;
+};
+
+struct cp_thread {
+	struct cp_config *cfg;
+	pthread_t tid;
+	int id;
+	unsigned int rnd;
+	uint64_t seq_next;
+	uint64_t errors;
+	uint64_t bucket[LAT_BUCKETS];
+};
+
+static pthread_barrier_t start_barrier;
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000UL + ts.tv_nsec;
+}
+
+static int lat_bucket(uint64_t ns)
+{
+	int b = ns ? 64 - __builtin_clzll(ns) : 0;
+
+	return b < LAT_BUCKETS - 1 ? b : LAT_BUCKETS - 1;
+}
+
+static uint64_t lat_percentile(uint64_t *bucket, uint64_t count, int per_mille)
+{
+	uint64_t rank = (count * per_mille + 999) / 1000;
+	uint64_t seen = 0;
+	int b;
+
+	for (b = 0; b < LAT_BUCKETS; b++) {
+		seen += bucket[b];
+		if (seen >= rank)
+			return 1ULL << b;
+	}
+	return 1ULL << (LAT_BUCKETS - 1);
+}
+
+//
+// Data path, run by the kernel module.
+//
+
+static int run_dp(int argc, char **argv)
+{
+	char line[4096] = "";
+	char result[4096];
+	FILE *f;
+	size_t n;
+	int i;
+
+	for (i = 0; i < argc; i++) {
+		strncat(line, argv[i], sizeof(line) - strlen(line) - 2);
+		strcat(line, " ");
+	}
+
+	f = fopen(BENCH_DEBUGFS, "w");
+	if (f == NULL) {
+		perror(BENCH_DEBUGFS);
+		return 1;
+	}
+	// Returns after the run.
+	if (fputs(line, f) == EOF || fclose(f) == EOF) {
+		fprintf(stderr, "benchmark failed : %s\n", strerror(errno));
+		return 1;
+	}
+
+	f = fopen(BENCH_DEBUGFS, "r");
+	if (f == NULL) {
+		perror(BENCH_DEBUGFS);
+		return 1;
+	}
+	while ((n = fread(result, 1, sizeof(result), f)) > 0)
+		fwrite(result, 1, n, stdout);
+	fclose(f);
+
+	return 0;
+}
+
+//
+// Control path, run by this tool.
+//
+
+// Zipfian rank in [0, n) with s = 1, the inverse CDF n^u. The same distribution with the kernel benchmark.
+static uint64_t zipf(unsigned int *rnd, uint64_t n)
+{
+	uint64_t rank = (uint64_t)pow((double)n, (double)rand_r(rnd) / ((double)RAND_MAX + 1)) - 1;
+
+	return rank < n ? rank : n - 1;
+}
+
+static uint64_t next_slot(struct cp_thread *t)
+{
+	struct cp_config *cfg = t->cfg;
+	uint64_t slot;
+
+	switch (cfg->pattern) {
+	case PATTERN_RAND:
+		return (uint64_t)rand_r(&t->rnd) % cfg->slots;
+	case PATTERN_ZIPF:
+		return zipf(&t->rnd, cfg->slots) * 2654435761ULL % cfg->slots;
+	default:
+		slot = t->seq_next;
+		t->seq_next = (t->seq_next + 1) % cfg->slots;
+		return slot;
+	}
+}
+
+static void *cp_thread_fn(void *arg)
+{
+	struct cp_thread *t = arg;
+	struct cp_config *cfg = t->cfg;
+	unsigned long size = (unsigned long)cfg->size_kb << 10;
+	int server = t->id % cfg->servers;
+	uint64_t start;
+	char *addr;
+	unsigned int i;
+	long ret;
+
+	pthread_barrier_wait(&start_barrier);
+
+	for (i = 0; i < cfg->ops; i++) {
+		addr = cfg->buf + next_slot(t) * size;
+		start = now_ns();
+		ret = syscall(SYS_DO_SEMERU_RDMA_OPS, cfg->write ? 2 : 1, server, addr, size);
+		if (ret < 0)
+			t->errors++;
+		else
+			t->bucket[lat_bucket(now_ns() - start)]++;
+	}
+
+	return NULL;
+}
+
+static int parse_cp(struct cp_config *cfg, int argc, char **argv)
+{
+	unsigned int *field;
+	char *value;
+	int i;
+
+	for (i = 0; i < argc; i++) {
+		value = strchr(argv[i], '=');
+		if (value == NULL)
+			return -1;
+		*value++ = '\0';
+
+		if (strcmp(argv[i], "op") == 0) {
+			if (strcmp(value, "read") && strcmp(value, "write"))
+				return -1;
+			cfg->write = strcmp(value, "write") == 0;
+			continue;
+		}
+		if (strcmp(argv[i], "pattern") == 0) {
+			if (strcmp(value, "seq") == 0)
+				cfg->pattern = PATTERN_SEQ;
+			else if (strcmp(value, "rand") == 0)
+				cfg->pattern = PATTERN_RAND;
+			else if (strcmp(value, "zipf") == 0)
+				cfg->pattern = PATTERN_ZIPF;
+			else
+				return -1;
+			continue;
+		}
+
+		if (strcmp(argv[i], "threads") == 0)
+			field = &cfg->threads;
+		else if (strcmp(argv[i], "ops") == 0)
+			field = &cfg->ops;
+		else if (strcmp(argv[i], "size_kb") == 0)
+			field = &cfg->size_kb;
+		else if (strcmp(argv[i], "range_mb") == 0)
+			field = &cfg->range_mb;
+		else if (strcmp(argv[i], "servers") == 0)
+			field = &cfg->servers;
+		else if (strcmp(argv[i], "seed") == 0)
+			field = &cfg->seed;
+		else
+			return -1;
+		*field = (unsigned int)strtoul(value, NULL, 0);
+	}
+
+	if (cfg->threads == 0 || cfg->threads > MAX_THREADS || cfg->servers == 0 ||
+	    cfg->servers > MAX_NUM_OF_MEMORY_SERVER || cfg->size_kb == 0 || cfg->size_kb % 4 != 0 ||
+	    cfg->range_mb == 0 || ((uint64_t)cfg->range_mb << 20) > RDMA_STRUCTURE_SPACE_SIZE ||
+	    ((uint64_t)cfg->range_mb << 10) < cfg->size_kb)
+		return -1;
+
+	return 0;
+}
+
+static int run_cp(int argc, char **argv)
+{
+	struct cp_config cfg = {
+		.write = 0,
+		.pattern = PATTERN_SEQ,
+		.threads = 1,
+		.ops = 10000,
+		.size_kb = 4,
+		.range_mb = 64,
+		.servers = 1,
+		.seed = 1,
+	};
+	static const char *pattern_name[] = { "seq", "rand", "zipf" };
+	uint64_t bucket[MAX_NUM_OF_MEMORY_SERVER][LAT_BUCKETS] = { { 0 } };
+	uint64_t ops = 0, errors = 0, count, elapsed_us, start;
+	size_t range;
+	struct cp_thread *threads;
+	unsigned int i;
+	int server, b;
+
+	if (parse_cp(&cfg, argc, argv)) {
+		fprintf(stderr, "invalid control path configuration\n");
+		return 1;
+	}
+
+	// The control path only sends the meta space, the top of the meta Region is the least used.
+	range = (size_t)cfg.range_mb << 20;
+	cfg.buf = mmap((void *)(SEMERU_START_ADDR + RDMA_STRUCTURE_SPACE_SIZE - range), range, PROT_READ | PROT_WRITE,
+		       MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED | MAP_NORESERVE, -1, 0);
+	if (cfg.buf == MAP_FAILED) {
+		perror("mmap the meta space");
+		return 1;
+	}
+	memset(cfg.buf, 0x5a, range); // populated, the kernel walks the page table of the range
+	cfg.slots = range / ((size_t)cfg.size_kb << 10);
+
+	threads = calloc(cfg.threads, sizeof(struct cp_thread));
+	if (threads == NULL)
+		return 1;
+	pthread_barrier_init(&start_barrier, NULL, cfg.threads + 1);
+	for (i = 0; i < cfg.threads; i++) {
+		threads[i].cfg = &cfg;
+		threads[i].id = i;
+		threads[i].rnd = cfg.seed * 7919 + i;
+		threads[i].seq_next = cfg.slots * i / cfg.threads;
+		pthread_create(&threads[i].tid, NULL, cp_thread_fn, &threads[i]);
+	}
+
+	start = now_ns();
+	pthread_barrier_wait(&start_barrier);
+	for (i = 0; i < cfg.threads; i++) {
+		pthread_join(threads[i].tid, NULL);
+		errors += threads[i].errors;
+		for (b = 0; b < LAT_BUCKETS; b++) {
+			bucket[i % cfg.servers][b] += threads[i].bucket[b];
+			ops += threads[i].bucket[b];
+		}
+	}
+	elapsed_us = (now_ns() - start) / 1000;
+	if (elapsed_us == 0)
+		elapsed_us = 1;
+
+	printf("# op pattern threads size_kb servers ops errors elapsed_ns kops_per_s MB_per_s\n");
+	printf("cp_%s %s %u %u %u %lu %lu %lu %lu %lu\n", cfg.write ? "write" : "read", pattern_name[cfg.pattern],
+	       cfg.threads, cfg.size_kb, cfg.servers, ops, errors, elapsed_us * 1000, ops * 1000 / elapsed_us,
+	       ops * ((uint64_t)cfg.size_kb << 10) / elapsed_us);
+
+	printf("# server count p50_ns p99_ns p999_ns buckets(upper_ns:count)\n");
+	for (server = 0; server < (int)cfg.servers; server++) {
+		count = 0;
+		for (b = 0; b < LAT_BUCKETS; b++)
+			count += bucket[server][b];
+		if (count == 0)
+			continue;
+
+		printf("%d %lu %lu %lu %lu", server, count, lat_percentile(bucket[server], count, 500),
+		       lat_percentile(bucket[server], count, 990), lat_percentile(bucket[server], count, 999));
+		for (b = 0; b < LAT_BUCKETS; b++) {
+			if (bucket[server][b])
+				printf(" %llu:%lu", 1ULL << b, bucket[server][b]);
+		}
+		printf("\n");
+	}
+
+	free(threads);
+	munmap(cfg.buf, range);
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	if (argc >= 2 && strcmp(argv[1], "dp") == 0)
+		return run_dp(argc - 2, argv + 2);
+	if (argc >= 2 && strcmp(argv[1], "cp") == 0)
+		return run_cp(argc - 2, argv + 2);
+
+	fprintf(stderr, "usage : %s dp|cp key=value ...\n", argv[0]);
+	fprintf(stderr, "  dp : op=store|load|mixed threads= ops= pages= pattern=seq|rand|zipf range_mb= servers= read_pct= seed=\n");
+	fprintf(stderr, "  cp : op=read|write threads= ops= size_kb= pattern=seq|rand|zipf range_mb= servers= seed=\n");
+	return 1;
+}
@@ -0,0 +1,580 @@
+/**
+ * Semeru swap trace, the user tool. Records the trace of the loaded semeru_cpu_server module, trace_entries > 0,
+ * and replays it offline against other prefetch and eviction policies.
+ *
+ * 1) Record, until SIGINT. The records of all the cores are saved as they are read, not in time order :
+ * 	semeru_replay record > app.trace
+ *
+ * 2) Replay, the records are sorted by time first :
+ * 	semeru_replay replay app.trace cache_mb=256 evict=lru|fifo|clock prefetch=none|seq|trend window=8 remote_ns=0
+ *
+ * The model. The trace only holds the misses of the recorded run, the swap-ins and the swap-outs.
+ * The simulated cache is the local memory added on top of the recorded run, cache_mb of it :
+ * 	a swap-out puts the page into the cache instead of sending it away, the eviction policy picks the victim,
+ * 	a swap-in of a cached page is a hit and costs nothing, a miss costs a read of its memory server.
+ * A miss also issues the prefetches of the policy, for the swapped out pages only. A prefetched page is usable
+ * one read latency after its miss, a swap-in before that is a late hit and waits for the rest.
+ * With cache_mb=0 and prefetch=none, every swap-in is a miss, the recorded prefetch and local hits included.
+ *
+ * The read latency of a miss is the recorded one if the page was read from its memory server in the trace,
+ * otherwise the mean of the recorded reads of that memory server. A non-zero remote_ns replaces the means.
+ * The records of each core are a stream of their own for the trend detection, the threads migrate rarely.
+ *
+ * Build : gcc -O2 -o semeru_replay semeru_replay.c
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// The same as semeru/frontswap_path.h, struct fs_trace_record and enum fs_trace_type.
+enum { FS_TRACE_LOAD = 0, FS_TRACE_LOAD_PREFETCHED, FS_TRACE_LOAD_LOCAL, FS_TRACE_STORE, FS_TRACE_STORE_DISCARD,
+       FS_TRACE_TYPE_NUM };
+
+struct fs_trace_record {
+	uint64_t ns;
+	uint64_t vaddr;
+	uint32_t latency_ns;
+	uint8_t type;
+	uint8_t mem_server_id;
+	uint16_t cpu;
+};
+
+#define TRACE_DEVICE			"/dev/semeru_trace"
+#define TRACE_MAGIC			"SEMERUTR"
+#define TRACE_VERSION			1
+#define PAGE_SHIFT			12
+#define MAX_NUM_OF_MEMORY_SERVER	8
+#define MAX_CPUS			4096
+#define TREND_HISTORY			8 // the deltas of the last misses of a core, for prefetch=trend
+#define NIL				UINT32_MAX
+
+struct trace_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t record_size;
+};
+
+enum { EVICT_LRU = 0, EVICT_FIFO, EVICT_CLOCK };
+enum { PREFETCH_NONE = 0, PREFETCH_SEQ, PREFETCH_TREND };
+
+struct replay_config {
+	unsigned int cache_mb;
+	int evict;
+	int prefetch;
+	unsigned int window;
+	unsigned int remote_ns;
+};
+
+// All the pages of the trace, found by page_index().
+struct page_entry {
+	uint64_t page;
+	uint64_t ready_ns; // a prefetched page is usable from then
+	uint32_t prev, next; // in the cache list, the head is the most recent
+	uint8_t swapped; // the last record was a swap-out, the page is on its memory server
+	uint8_t cached;
+	uint8_t prefetched; // by the policy and not hit yet
+	uint8_t referenced; // evict=clock
+	uint8_t mem_server_id;
+};
+
+struct replay_stats {
+	uint64_t loads, hits, late_hits, misses;
+	uint64_t prefetch_issued, prefetch_used, prefetch_wasted;
+	uint64_t evictions;
+	uint64_t stall_ns; // the reads of the misses and the waits of the late hits
+};
+
+struct trend_stream {
+	uint64_t last_page;
+	int64_t delta[TREND_HISTORY]; // a ring
+	unsigned int misses;
+};
+
+static struct page_entry *entries;
+static uint32_t num_entries, max_entries;
+static uint32_t *slots; // open addressing, entry indexes
+static uint64_t slot_mask;
+
+static uint32_t cache_head = NIL, cache_tail = NIL;
+static uint64_t cache_pages, cache_capacity;
+
+static uint64_t mean_read_ns[MAX_NUM_OF_MEMORY_SERVER];
+static struct trend_stream streams[MAX_CPUS];
+
+//
+// Record.
+//
+
+static volatile sig_atomic_t stop_recording = 0;
+
+static void on_signal(int sig)
+{
+	stop_recording = 1;
+}
+
+static int run_record(void)
+{
+	static struct fs_trace_record buf[65536];
+	struct trace_header header = { TRACE_MAGIC, TRACE_VERSION, sizeof(struct fs_trace_record) };
+	struct sigaction sa;
+	uint64_t records = 0;
+	ssize_t n;
+	int fd;
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = on_signal; // no SA_RESTART, the blocked read returns
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+
+	fd = open(TRACE_DEVICE, O_RDONLY);
+	if (fd < 0) {
+		perror(TRACE_DEVICE);
+		return 1;
+	}
+	if (fwrite(&header, sizeof(header), 1, stdout) != 1) {
+		perror("write the trace");
+		return 1;
+	}
+
+	while (!stop_recording) {
+		n = read(fd, buf, sizeof(buf));
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			perror("read the trace");
+			break;
+		}
+		if (fwrite(buf, 1, n, stdout) != (size_t)n) {
+			perror("write the trace");
+			break;
+		}
+		records += n / sizeof(struct fs_trace_record);
+	}
+
+	close(fd);
+	fflush(stdout);
+	fprintf(stderr, "%lu records\n", records);
+	return 0;
+}
+
+//
+// Replay.
+//
+
+static int compare_records(const void *a, const void *b)
+{
+	const struct fs_trace_record *ra = a, *rb = b;
+
+	return ra->ns < rb->ns ? -1 : ra->ns > rb->ns;
+}
+
+static struct fs_trace_record *load_trace(const char *path, uint64_t *num)
+{
+	struct trace_header header;
+	struct fs_trace_record *records;
+	long size;
+	FILE *f;
+
+	f = fopen(path, "r");
+	if (f == NULL) {
+		perror(path);
+		return NULL;
+	}
+	if (fread(&header, sizeof(header), 1, f) != 1 || memcmp(header.magic, TRACE_MAGIC, 8) ||
+	    header.version != TRACE_VERSION || header.record_size != sizeof(struct fs_trace_record)) {
+		fprintf(stderr, "%s isn't a trace of this version\n", path);
+		fclose(f);
+		return NULL;
+	}
+
+	fseek(f, 0, SEEK_END);
+	size = ftell(f) - sizeof(header);
+	fseek(f, sizeof(header), SEEK_SET);
+	*num = size / sizeof(struct fs_trace_record);
+	records = malloc(*num * sizeof(struct fs_trace_record) + 1);
+	if (records == NULL || fread(records, sizeof(struct fs_trace_record), *num, f) != *num) {
+		fprintf(stderr, "read %s failed\n", path);
+		free(records);
+		fclose(f);
+		return NULL;
+	}
+	fclose(f);
+
+	qsort(records, *num, sizeof(struct fs_trace_record), compare_records);
+	return records;
+}
+
+static uint64_t hash_page(uint64_t page)
+{
+	return (page * 0x9e3779b97f4a7c15ULL) >> 17;
+}
+
+// The entry of page, NIL if it isn't in the trace.
+static uint32_t page_index(uint64_t page)
+{
+	uint64_t s;
+
+	for (s = hash_page(page) & slot_mask; slots[s] != NIL; s = (s + 1) & slot_mask) {
+		if (entries[slots[s]].page == page)
+			return slots[s];
+	}
+	return NIL;
+}
+
+static uint32_t page_insert(uint64_t page, int mem_server_id)
+{
+	uint64_t s;
+
+	for (s = hash_page(page) & slot_mask; slots[s] != NIL; s = (s + 1) & slot_mask) {
+		if (entries[slots[s]].page == page)
+			return slots[s];
+	}
+	slots[s] = num_entries;
+	memset(&entries[num_entries], 0, sizeof(struct page_entry));
+	entries[num_entries].page = page;
+	entries[num_entries].mem_server_id = mem_server_id;
+	entries[num_entries].prev = entries[num_entries].next = NIL;
+	return num_entries++;
+}
+
+// One entry per distinct page, the table stays at most half full.
+static int init_pages(uint64_t num_records)
+{
+	uint64_t num_slots = 1;
+
+	while (num_slots < num_records * 2)
+		num_slots <<= 1;
+	max_entries = num_records;
+	entries = malloc((size_t)max_entries * sizeof(struct page_entry) + 1);
+	slots = malloc(num_slots * sizeof(uint32_t));
+	if (entries == NULL || slots == NULL)
+		return -1;
+	memset(slots, 0xff, num_slots * sizeof(uint32_t));
+	slot_mask = num_slots - 1;
+	return 0;
+}
+
+static void list_unlink(uint32_t i)
+{
+	struct page_entry *e = &entries[i];
+
+	if (e->prev != NIL)
+		entries[e->prev].next = e->next;
+	else
+		cache_head = e->next;
+	if (e->next != NIL)
+		entries[e->next].prev = e->prev;
+	else
+		cache_tail = e->prev;
+	e->prev = e->next = NIL;
+}
+
+static void list_push_head(uint32_t i)
+{
+	struct page_entry *e = &entries[i];
+
+	e->prev = NIL;
+	e->next = cache_head;
+	if (cache_head != NIL)
+		entries[cache_head].prev = i;
+	cache_head = i;
+	if (cache_tail == NIL)
+		cache_tail = i;
+}
+
+static void cache_evict(struct replay_config *cfg, struct replay_stats *st)
+{
+	uint32_t victim = cache_tail;
+
+	// The second chance, the referenced pages go around once.
+	while (cfg->evict == EVICT_CLOCK && entries[victim].referenced) {
+		entries[victim].referenced = 0;
+		list_unlink(victim);
+		list_push_head(victim);
+		victim = cache_tail;
+	}
+
+	if (entries[victim].prefetched)
+		st->prefetch_wasted++;
+	entries[victim].cached = 0;
+	entries[victim].prefetched = 0;
+	list_unlink(victim);
+	cache_pages--;
+	st->evictions++;
+}
+
+static void cache_insert(uint32_t i, struct replay_config *cfg, struct replay_stats *st)
+{
+	if (cache_capacity == 0)
+		return;
+	if (entries[i].cached) {
+		if (cfg->evict == EVICT_LRU) {
+			list_unlink(i);
+			list_push_head(i);
+		}
+		entries[i].referenced = 1;
+		return;
+	}
+
+	if (cache_pages >= cache_capacity)
+		cache_evict(cfg, st);
+	entries[i].cached = 1;
+	entries[i].referenced = 0;
+	list_push_head(i);
+	cache_pages++;
+}
+
+static void prefetch_page(uint64_t page, uint64_t now, struct replay_config *cfg, struct replay_stats *st)
+{
+	uint32_t i = page_index(page);
+
+	// Only the pages on the memory servers, a resident or never swapped out page isn't read.
+	if (cache_capacity == 0 || i == NIL || !entries[i].swapped || entries[i].cached)
+		return;
+
+	cache_insert(i, cfg, st);
+	entries[i].prefetched = 1;
+	entries[i].ready_ns = now + mean_read_ns[entries[i].mem_server_id];
+	st->prefetch_issued++;
+}
+
+// The majority of the last deltas, 0 if there isn't one. Boyer-Moore vote, then checked.
+static int64_t trend_delta(struct trend_stream *s)
+{
+	unsigned int n = s->misses - 1 < TREND_HISTORY ? s->misses - 1 : TREND_HISTORY;
+	unsigned int count = 0, k;
+	int64_t candidate = 0;
+	int votes = 0;
+
+	for (k = 0; k < n; k++) {
+		if (votes == 0)
+			candidate = s->delta[k];
+		votes += s->delta[k] == candidate ? 1 : -1;
+	}
+	for (k = 0; k < n; k++)
+		count += s->delta[k] == candidate;
+	return count * 2 > n ? candidate : 0;
+}
+
+static void issue_prefetch(const struct fs_trace_record *r, uint64_t page, struct replay_config *cfg,
+			   struct replay_stats *st)
+{
+	struct trend_stream *s = &streams[r->cpu % MAX_CPUS];
+	int64_t delta = 1;
+	unsigned int k;
+
+	if (cfg->prefetch == PREFETCH_TREND) {
+		if (s->misses > 0)
+			s->delta[(s->misses - 1) % TREND_HISTORY] = (int64_t)(page - s->last_page);
+		s->last_page = page;
+		if (s->misses++ == 0)
+			return;
+		delta = trend_delta(s);
+		if (delta == 0)
+			return;
+	}
+
+	for (k = 1; k <= cfg->window; k++)
+		prefetch_page(page + delta * k, r->ns, cfg, st);
+}
+
+static void replay_load(const struct fs_trace_record *r, struct replay_config *cfg, struct replay_stats *st)
+{
+	uint64_t page = r->vaddr >> PAGE_SHIFT;
+	uint32_t i = page_insert(page, r->mem_server_id);
+	struct page_entry *e = &entries[i];
+
+	st->loads++;
+	e->swapped = 0;
+
+	if (e->cached) {
+		st->hits++;
+		if (e->prefetched) {
+			st->prefetch_used++;
+			e->prefetched = 0;
+			if (e->ready_ns > r->ns) {
+				st->late_hits++;
+				st->stall_ns += e->ready_ns - r->ns;
+			}
+		}
+		cache_insert(i, cfg, st); // touched, the page stays local
+		return;
+	}
+
+	st->misses++;
+	st->stall_ns += r->type == FS_TRACE_LOAD ? r->latency_ns : mean_read_ns[r->mem_server_id];
+	if (cfg->prefetch != PREFETCH_NONE)
+		issue_prefetch(r, page, cfg, st);
+}
+
+static void replay_store(const struct fs_trace_record *r, struct replay_config *cfg, struct replay_stats *st)
+{
+	uint32_t i = page_insert(r->vaddr >> PAGE_SHIFT, r->mem_server_id);
+
+	entries[i].swapped = 1;
+	cache_insert(i, cfg, st);
+}
+
+static int parse_replay(struct replay_config *cfg, int argc, char **argv)
+{
+	unsigned int *field;
+	char *value;
+	int i;
+
+	for (i = 0; i < argc; i++) {
+		value = strchr(argv[i], '=');
+		if (value == NULL)
+			return -1;
+		*value++ = '\0';
+
+		if (strcmp(argv[i], "evict") == 0) {
+			if (strcmp(value, "lru") == 0)
+				cfg->evict = EVICT_LRU;
+			else if (strcmp(value, "fifo") == 0)
+				cfg->evict = EVICT_FIFO;
+			else if (strcmp(value, "clock") == 0)
+				cfg->evict = EVICT_CLOCK;
+			else
+				return -1;
+			continue;
+		}
+		if (strcmp(argv[i], "prefetch") == 0) {
+			if (strcmp(value, "none") == 0)
+				cfg->prefetch = PREFETCH_NONE;
+			else if (strcmp(value, "seq") == 0)
+				cfg->prefetch = PREFETCH_SEQ;
+			else if (strcmp(value, "trend") == 0)
+				cfg->prefetch = PREFETCH_TREND;
+			else
+				return -1;
+			continue;
+		}
+
+		if (strcmp(argv[i], "cache_mb") == 0)
+			field = &cfg->cache_mb;
+		else if (strcmp(argv[i], "window") == 0)
+			field = &cfg->window;
+		else if (strcmp(argv[i], "remote_ns") == 0)
+			field = &cfg->remote_ns;
+		else
+			return -1;
+		*field = (unsigned int)strtoul(value, NULL, 0);
+	}
+
+	if (cfg->prefetch != PREFETCH_NONE && cfg->window == 0)
+		return -1;
+	return 0;
+}
+
+static int run_replay(int argc, char **argv)
+{
+	struct replay_config cfg = {
+		.cache_mb = 256,
+		.evict = EVICT_LRU,
+		.prefetch = PREFETCH_NONE,
+		.window = 8,
+		.remote_ns = 0,
+	};
+	static const char *evict_name[] = { "lru", "fifo", "clock" };
+	static const char *prefetch_name[] = { "none", "seq", "trend" };
+	static const char *type_name[FS_TRACE_TYPE_NUM] = { "load", "load_prefetched", "load_local", "store",
+							    "store_discard" };
+	uint64_t type_count[FS_TRACE_TYPE_NUM] = { 0 };
+	uint64_t read_ns[MAX_NUM_OF_MEMORY_SERVER] = { 0 }, reads[MAX_NUM_OF_MEMORY_SERVER] = { 0 };
+	uint64_t recorded_stall_ns = 0, num, k;
+	struct replay_stats st;
+	struct fs_trace_record *records;
+	int server, t;
+
+	if (argc < 1 || parse_replay(&cfg, argc - 1, argv + 1)) {
+		fprintf(stderr, "invalid replay configuration\n");
+		return 1;
+	}
+	records = load_trace(argv[0], &num);
+	if (records == NULL)
+		return 1;
+	if (num == 0 || init_pages(num)) {
+		fprintf(stderr, "no records, or out of memory\n");
+		return 1;
+	}
+
+	// The recorded run, and the read latency of each memory server.
+	for (k = 0; k < num; k++) {
+		struct fs_trace_record *r = &records[k];
+
+		if (r->type >= FS_TRACE_TYPE_NUM || r->mem_server_id >= MAX_NUM_OF_MEMORY_SERVER) {
+			fprintf(stderr, "record %lu is corrupted\n", k);
+			return 1;
+		}
+		type_count[r->type]++;
+		if (r->type <= FS_TRACE_LOAD_LOCAL)
+			recorded_stall_ns += r->latency_ns;
+		if (r->type == FS_TRACE_LOAD) {
+			read_ns[r->mem_server_id] += r->latency_ns;
+			reads[r->mem_server_id]++;
+		}
+	}
+	for (server = 0; server < MAX_NUM_OF_MEMORY_SERVER; server++) {
+		if (cfg.remote_ns != 0 || reads[server] == 0)
+			mean_read_ns[server] = cfg.remote_ns;
+		else
+			mean_read_ns[server] = read_ns[server] / reads[server];
+	}
+
+	memset(&st, 0, sizeof(st));
+	cache_capacity = ((uint64_t)cfg.cache_mb << 20) >> PAGE_SHIFT;
+	for (k = 0; k < num; k++) {
+		if (records[k].type <= FS_TRACE_LOAD_LOCAL)
+			replay_load(&records[k], &cfg, &st);
+		else
+			replay_store(&records[k], &cfg, &st);
+	}
+
+	printf("# recorded : records pages elapsed_ns stall_ns");
+	for (t = 0; t < FS_TRACE_TYPE_NUM; t++)
+		printf(" %s", type_name[t]);
+	printf("\nrecorded %lu %u %lu %lu", num, num_entries, records[num - 1].ns - records[0].ns, recorded_stall_ns);
+	for (t = 0; t < FS_TRACE_TYPE_NUM; t++)
+		printf(" %lu", type_count[t]);
+	printf("\n");
+
+	printf("# server mean_read_ns\n");
+	for (server = 0; server < MAX_NUM_OF_MEMORY_SERVER; server++) {
+		if (reads[server] || mean_read_ns[server])
+			printf("%d %lu\n", server, mean_read_ns[server]);
+	}
+
+	printf("# replay : cache_mb evict prefetch window loads hits late_hits misses hit_pct "
+	       "prefetch_issued prefetch_used prefetch_wasted accuracy_pct remote_reads stall_ns stall_pct_of_recorded\n");
+	printf("replay %u %s %s %u %lu %lu %lu %lu %.2f %lu %lu %lu %.2f %lu %lu %.2f\n", cfg.cache_mb,
+	       evict_name[cfg.evict], prefetch_name[cfg.prefetch], cfg.prefetch == PREFETCH_NONE ? 0 : cfg.window,
+	       st.loads, st.hits, st.late_hits, st.misses, st.loads ? 100.0 * st.hits / st.loads : 0.0,
+	       st.prefetch_issued, st.prefetch_used, st.prefetch_wasted,
+	       st.prefetch_issued ? 100.0 * st.prefetch_used / st.prefetch_issued : 0.0,
+	       st.misses + st.prefetch_issued, st.stall_ns,
+	       recorded_stall_ns ? 100.0 * st.stall_ns / recorded_stall_ns : 0.0);
+
+	free(records);
+	free(entries);
+	free(slots);
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	if (argc >= 2 && strcmp(argv[1], "record") == 0)
+		return run_record();
+	if (argc >= 3 && strcmp(argv[1], "replay") == 0)
+		return run_replay(argc - 2, argv + 2);
+
+	fprintf(stderr, "usage : %s record > trace | replay trace key=value ...\n", argv[0]);
+	fprintf(stderr, "  replay : cache_mb= evict=lru|fifo|clock prefetch=none|seq|trend window= remote_ns=\n");
+	return 1;
+}
@@ -249,8 +249,17 @@ struct rmem_meta_space_layout{
  * 
  * More Explanation
  *	Build a seperate WR for each I/O request and sent them to remote memory pool via  RDMA read/write.
+ *	A merged request, multiple bio and multiple segments, is gathered by the sge_list of one WR.
+ *	The request queue limits the segments of a request to the sge of a WR, rmem_max_request_sge(),
+ *	and never lets a request cross a chunk, so one remote address covers the whole request.
  * 
  */
+
+// The QP is created with MAX_REQUEST_SGL send sge, keep 2 for safety.
+#define RMEM_MAX_REQUEST_SGE		(MAX_REQUEST_SGL - 2)
+
+// The WCs reaped by one poll of the block layer, semeru_poll_rdma_queue().
+#define RMEM_POLL_BATCH			16
 struct rmem_rdma_command{
  
 	struct semeru_rdma_queue * rdma_queue;
@@ -540,6 +549,7 @@ int 	rdma_session_connect(struct rdma_session_context *rdma_session_ptr);
 int 	octopus_rdma_cm_event_handler(struct rdma_cm_id *cma_id, struct rdma_cm_event *event);
 
 void 	semeru_cq_event_handler(struct ib_cq * cq, void *rdma_session_context);
+int 	semeru_poll_rdma_queue(struct semeru_rdma_queue *rdma_queue, unsigned int tag);
 int 	handle_recv_wr(struct semeru_rdma_queue *rdma_session, struct ib_wc *wc);
 int 	send_message_to_remote(struct rdma_session_context *rdma_session, int rmda_queue_ind, int messge_type  , int size_gb);
 void 	map_single_remote_memory_chunk(struct rdma_session_context *rdma_session);
@@ -722,10 +732,27 @@ char* semeru_rdma_write(int target_mem_server, char __user * start_addr, unsigne
 // If we put the static function declaration in header, each .cpp file include it needs to implement its own walk_page_table. 
 
 
+struct semeru_rdma_iovec;
+struct semeru_rdma_atomic;
+
 // the strucute assigned to kernel.
 struct semeru_rdma_ops{
 	char* (*rdma_read)(int, char __user *, unsigned long);   // a function pointer, to  return value char*,  parameter(char*, unsigned long)
 	char* (*rdma_write)(int, char __user *, unsigned long);
+	int (*prefetch_hint)(int, char __user *, unsigned long); // no prefetch for the block path
+	int (*rdma_writev)(struct semeru_rdma_iovec *, int, int); // no vectored control path for the block path
+	int (*rdma_wait)(int);
+	int (*meta_reg)(char __user *, unsigned long);
+	int (*rdma_write_dirty)(int, char __user *, unsigned long);
+	int (*wait_mem_server)(int, int);
+	int (*ring_doorbell)(int, unsigned int);
+	int (*resize_chunks)(char __user *, unsigned long, int);
+	int (*query_placement)(char __user *);
+	int (*region_fence)(int, char __user *, unsigned long);
+	int (*rdma_readv)(struct semeru_rdma_iovec *, int);
+	int (*prefetch_range)(char __user *, unsigned long);
+	int (*rdma_bcast)(int, int, char __user *, unsigned long);
+	int (*rdma_atomic)(int, struct semeru_rdma_atomic *);
 };
 
 
@@ -380,7 +380,11 @@ int semeru_create_rdma_queue(struct rdma_session_context *rdma_session, int rdma
 	// 2) Build CQ
 	memset(&init_attr, 0, sizeof(init_attr));
 	init_attr.cqe = rdma_session->send_queue_depth + rdma_session->recv_queue_depth; // [x]The depth of cq. Number of completion queue entries.
-	init_attr.comp_vector = 0;
+	// Spread the queues over the completion vectors, the IRQ of each vector is affine to its own cores.
+	// The dispatch queue[i] is mapped to rdma_queue[i], so the completion is handled near the submitting core.
+	if(cm_id->device->num_comp_vectors > 0)
+		comp_vector = rdma_queue_index % cm_id->device->num_comp_vectors;
+	init_attr.comp_vector = comp_vector;
 	
 	// Set up the completion queues and the cq evnet handler.
 	// [?] a softIRQ CQ
@@ -646,6 +650,91 @@ err:
 //
 
 
+/**
+ * Handle one WC of a rdma_queue's CQ, for the CQ event handler and the polling of the block layer.
+ * The data path ends the i/o request of the WC here.
+ */
+static int semeru_handle_wc(struct semeru_rdma_queue *rdma_queue, struct ib_wc *wc){
+	struct rmem_rdma_command *rdma_cmd_ptr;
+	int ret = 0;
+
+	if (wc->status != IB_WC_SUCCESS) {   		// IB_WC_SUCCESS == 0
+		// if (wc->status == IB_WC_WR_FLUSH_ERR) {
+		// 	printk(KERN_ERR "%s, cq flushed\n", __func__);
+		// 	//continue; 
+		// 	// IB_WC_WR_FLUSH_ERR is different ??
+		// 	goto err;
+		// } else {
+			printk(KERN_ERR "%s, cq completion failed with wr_id 0x%llx status %d,  status name %s, opcode %d,\n",__func__,
+															wc->wr_id, wc->status, rdma_wc_status_name(wc->status), wc->opcode);
+			
+			//print the rmda_command information
+			rdma_cmd_ptr = (struct rmem_rdma_command *)(wc->wr_id);
+			printk(KERN_ERR "%s, ERROR i/o request->tag : %d \n", __func__,  rdma_cmd_ptr->io_rq->tag );
+
+			goto err;
+		//}
+	}	
+
+	switch (wc->opcode){
+		case IB_WC_RECV:				
+			// Recieve 2-sided RDMA recive wr
+
+			#if defined(DEBUG_MODE_BRIEF) || defined(DEBUG_MODE_DETAIL)
+			printk("%s, Got a WC from CQ, IB_WC_RECV. \n", __func__);
+			#endif
+			// Need to do actions based on the received message type.
+			ret = handle_recv_wr(rdma_queue, wc);
+		  	if (unlikely(ret)) {
+			 	printk(KERN_ERR "%s, recv wc error: %d\n", __func__, ret);
+			 	goto err;
+			}
+
+			break;
+		case IB_WC_SEND:
+
+			#if defined(DEBUG_MODE_BRIEF) || defined(DEBUG_MODE_DETAIL)
+			printk("%s, Got a WC from CQ, IB_WC_SEND. 2-sided RDMA post done. \n", __func__);
+			#endif
+
+			break;
+		case IB_WC_RDMA_READ:
+			// 1-sided RDMA read is done. 
+			// The data is in registered RDMA buffer.
+			#if defined(DEBUG_MODE_BRIEF) || defined(DEBUG_MODE_DETAIL)
+			printk("%s, Got a WC from CQ, IB_WC_RDMA_READ \n", __func__);
+			#endif
+			 
+			 // Read data from RDMA buffer and responds it back to Kernel.
+			 ret = rdma_read_done( wc);
+			 if (unlikely(ret)) {
+			 	printk(KERN_ERR "%s, Handle cq event, IB_WC_RDMA_READ, error \n", __func__);
+			 	goto err;
+			 }
+			break;
+		case IB_WC_RDMA_WRITE:
+			ret = rdma_write_done(wc);
+			 if (unlikely(ret)) {
+			 	printk(KERN_ERR "%s, Handle cq event, IB_WC_RDMA_WRITE, error \n", __func__);
+			 	goto err;
+			 }
+
+			#if defined(DEBUG_MODE_BRIEF) || defined(DEBUG_MODE_DETAIL)
+			printk("%s, Got a WC from CQ, IB_WC_RDMA_WRITE \n", __func__);
+			#endif
+
+			break;
+		default:
+			printk(KERN_ERR "%s:%d Unexpected opcode %d, Shutting down\n", __func__, __LINE__, wc->opcode);
+			goto err;
+	} // switch
+
+	return 0;
+err:
+	return -1;
+}
+
+
 /**
  * RDMA  CQ event handler.
  * After invoke the cq_notify, everytime a wc is insert into completion queue entry, 
@@ -660,10 +749,8 @@ err:
  */
 void semeru_cq_event_handler(struct ib_cq * cq, void *rdma_ctx){    // cq : kernel_cb->cq;  ctx : cq->context, just the kernel_cb
 
-	bool 	 												stop_waiting_on_cq 	= false;
 	struct semeru_rdma_queue 	*rdma_queue				=	rdma_ctx;
 	struct ib_wc 									wc;
-	struct rmem_rdma_command *rdma_cmd_ptr;
 	int ret = 0;
 
 
@@ -695,81 +782,9 @@ void semeru_cq_event_handler(struct ib_cq * cq, void *rdma_ctx){    // cq : kern
 	//
 
 	while(likely( (ret = ib_poll_cq(rdma_queue->cq, 1, &wc)) == 1  )) {
-		if (wc.status != IB_WC_SUCCESS) {   		// IB_WC_SUCCESS == 0
-			// if (wc.status == IB_WC_WR_FLUSH_ERR) {
-			// 	printk(KERN_ERR "%s, cq flushed\n", __func__);
-			// 	//continue; 
-			// 	// IB_WC_WR_FLUSH_ERR is different ??
-			// 	goto err;
-			// } else {
-				printk(KERN_ERR "%s, cq completion failed with wr_id 0x%llx status %d,  status name %s, opcode %d,\n",__func__,
-																wc.wr_id, wc.status, rdma_wc_status_name(wc.status), wc.opcode);
-				
-				//print the rmda_command information
-				rdma_cmd_ptr = (struct rmem_rdma_command *)(wc.wr_id);
-				printk(KERN_ERR "%s, ERROR i/o request->tag : %d \n", __func__,  rdma_cmd_ptr->io_rq->tag );
-
-				goto err;
-			//}
-		}	
-
-		switch (wc.opcode){
-			case IB_WC_RECV:				
-				// Recieve 2-sided RDMA recive wr
-
-				#if defined(DEBUG_MODE_BRIEF) || defined(DEBUG_MODE_DETAIL)
-				printk("%s, Got a WC from CQ, IB_WC_RECV. \n", __func__);
-				#endif
-				// Need to do actions based on the received message type.
-				ret = handle_recv_wr(rdma_queue, &wc);
-			  	if (unlikely(ret)) {
-				 	printk(KERN_ERR "%s, recv wc error: %d\n", __func__, ret);
-				 	goto err;
-				}
-
-				 // debug
-				 // Stop waiting for message.
-				 stop_waiting_on_cq = true;
-
-
-				break;
-			case IB_WC_SEND:
-
-				#if defined(DEBUG_MODE_BRIEF) || defined(DEBUG_MODE_DETAIL)
-				printk("%s, Got a WC from CQ, IB_WC_SEND. 2-sided RDMA post done. \n", __func__);
-				#endif
-
-				break;
-			case IB_WC_RDMA_READ:
-				// 1-sided RDMA read is done. 
-				// The data is in registered RDMA buffer.
-				#if defined(DEBUG_MODE_BRIEF) || defined(DEBUG_MODE_DETAIL)
-				printk("%s, Got a WC from CQ, IB_WC_RDMA_READ \n", __func__);
-				#endif
-				 
-				 // Read data from RDMA buffer and responds it back to Kernel.
-				 ret = rdma_read_done( &wc);
-				 if (unlikely(ret)) {
-				 	printk(KERN_ERR "%s, Handle cq event, IB_WC_RDMA_READ, error \n", __func__);
-				 	goto err;
-				 }
-				break;
-			case IB_WC_RDMA_WRITE:
-				ret = rdma_write_done(&wc);
-				 if (unlikely(ret)) {
-				 	printk(KERN_ERR "%s, Handle cq event, IB_WC_RDMA_WRITE, error \n", __func__);
-				 	goto err;
-				 }
-
-				#if defined(DEBUG_MODE_BRIEF) || defined(DEBUG_MODE_DETAIL)
-				printk("%s, Got a WC from CQ, IB_WC_RDMA_WRITE \n", __func__);
-				#endif
-
-				break;
-			default:
-				printk(KERN_ERR "%s:%d Unexpected opcode %d, Shutting down\n", __func__, __LINE__, wc.opcode);
-				goto err;
-		} // switch
+		if (unlikely(semeru_handle_wc(rdma_queue, &wc))) {
+			goto err;
+		}
 
 		//
 		// Notify_cq, poll_cq are all both one-shot
@@ -802,6 +817,49 @@ err:
 
 
 
+/**
+ * Poll the CQ of a rdma_queue for the block layer, blk_mq_ops->poll of the block path device.
+ * A synchronous reader spins here for its request instead of waiting for the CQ interrupt.
+ * 
+ * 1) Reap up to RMEM_POLL_BATCH WCs, any of them, and complete them as the CQ event handler does.
+ *    The CQ stays armed, the handler and the pollers share the CQ. Each WC is reaped once.
+ * 2) Return 1 once the request of tag is completed here, 0 to poll again, -1 on a broken queue.
+ *    A request completed by the handler meanwhile is noticed by the block layer itself.
+ */
+int semeru_poll_rdma_queue(struct semeru_rdma_queue *rdma_queue, unsigned int tag){
+	struct ib_wc wcs[RMEM_POLL_BATCH];
+	struct rmem_rdma_command *rdma_cmd_ptr;
+	int found = 0;
+	int n, i;
+
+	if (unlikely(rdma_queue->state == ERROR || rdma_queue->cq == NULL)) {
+		return -1;
+	}
+
+	n = ib_poll_cq(rdma_queue->cq, RMEM_POLL_BATCH, wcs);
+	for (i = 0; i < n; i++) {
+		// The tag is read before the request is ended and reused.
+		if (wcs[i].status == IB_WC_SUCCESS && (wcs[i].opcode == IB_WC_RDMA_READ || wcs[i].opcode == IB_WC_RDMA_WRITE)) {
+			rdma_cmd_ptr = (struct rmem_rdma_command *)(wcs[i].wr_id);
+			if (rdma_cmd_ptr != NULL && rdma_cmd_ptr->io_rq != NULL && rdma_cmd_ptr->io_rq->tag == tag) {
+				found = 1;
+			}
+		}
+
+		if (unlikely(semeru_handle_wc(rdma_queue, &wcs[i]))) {
+			printk(KERN_ERR "ERROR in %s \n", __func__);
+			rdma_queue->state = ERROR;
+			semeru_disconenct_and_collect_resource(rdma_queue->rdma_session);
+			return -1;
+		}
+	}
+
+	return found;
+}
+
+
+
+
 /**
  * Send a RDMA message to remote server.
  * Used for RDMA conenction build.
@@ -1336,12 +1394,10 @@ int dp_post_rdma_write(struct rdma_session_context *rdma_session, struct request
   // Second, write the real data.
 	// Register the physical pages attached to i/o requset as RDMA mr directly to save one more data copy.
 	 ret = dp_build_rdma_wr(rdma_cmd_ptr, io_rq, remote_chunk_ptr, offset_within_chunk, len);
-	 #if defined(DEBUG_MODE_BRIEF) || defined(DEBUG_MODE_DETAIL)
-	 if(unlikely(ret != 0) ){  // ret == 0 is error here???
+	 if(unlikely(ret != 0) ){
 	 		printk(KERN_ERR "%s, 2nd, data pages,  build 1-sided RDMA write failed. \n", __func__);
-		 goto err;
+		 return ret;
 	 }
-	 #endif
 
 	//post the 1-sided RDMA write
 	// Use the global RDMA context, rdma_session_global
@@ -1740,13 +1796,10 @@ int dp_post_rdma_read(struct rdma_session_context *rdma_session, struct request*
 
 	// Initialize the reserved space behind i/o request to struct rmem_rdma_command.
 	ret = dp_build_rdma_wr( rdma_cmd_ptr, io_rq, remote_chunk_ptr, offset_within_chunk, len);
-	#if defined(DEBUG_MODE_BRIEF) || defined(DEBUG_MODE_DETAIL)
 	if(unlikely(ret != 0)){
 		printk(KERN_ERR "%s, DP Build ib_rdma_wr failed. \n", __func__);
-		ret = -1;
-	  goto err;
+		return ret;
 	}
-	#endif
 
 
 	//post the 1-sided RDMA write
@@ -2006,6 +2059,9 @@ int cp_rdma_read_done(struct rmem_rdma_command 	*rdma_cmd_ptr){
  * 
  * 
  * [x] The segments/sectors in the i/o request are contiguous.
+ * 	The request can be merged from multiple bio, each physical segment is gathered by one ib_sge.
+ * 	The request queue guarantees at most rmem_max_request_sge() segments and no chunk crossing,
+ * 	see init_blk_mq_queue().
  * 
  * [?] The sector should be 4KB alignment. This can only be guaranteed in paging.
  * 
@@ -2065,16 +2121,17 @@ int dp_build_rdma_wr(struct rmem_rdma_command *rdma_cmd_ptr, struct request * io
 	// 3)  one or multiple DMA areas,
 	// Need to use the scatter & gather characteristics of IB.
 	// We need to confirm that all the sectors are contiguous or we have to split the bio into multiple ib_rdma_wr.	
-	#if defined(DEBUG_MODE_BRIEF) || defined(DEBUG_MODE_DETAIL)
-		// Limit the max number of segments in each bio by setting parameter,  request_queue->limits.max_segments
-		// The support max scatter-gather numbers is limited by InfiniBand hardware.
-		if(dma_entry >= MAX_REQUEST_SGL){
-			printk(KERN_ERR "%s : Too many(%d) segments in this i/o request. Limit and reset the number to %d \n", __func__, 
-																																																					dma_entry,
-																																																					MAX_REQUEST_SGL);
-			dma_entry = MAX_REQUEST_SGL - 2;   // 32 leads to error, reserver 2 slots.
-		}
-	#endif
+	// The max number of segments in each request is limited by request_queue->limits.max_segments.
+	// The support max scatter-gather numbers is limited by InfiniBand hardware.
+	// Truncating the sge list would lose data silently, fail the request instead.
+	if(unlikely(dma_entry > RMEM_MAX_REQUEST_SGE)){
+		printk(KERN_ERR "%s : Too many(%d) segments in this i/o request, the limit is %d \n", __func__,
+																																																				dma_entry,
+																																																				RMEM_MAX_REQUEST_SGE);
+		ib_dma_unmap_sg(ibdev, rdma_cmd_ptr->sgl, rdma_cmd_ptr->nentry,
+										rq_data_dir(io_rq) == WRITE ? DMA_TO_DEVICE : DMA_FROM_DEVICE);
+		return -EINVAL;
+	}
 
 	// Local RDMA buffer
 	// [Warning] assume all the sectors in this bio is contiguous.
@@ -2702,6 +2759,20 @@ void init_kernel_semeru_rdma_ops(void){
 		struct semeru_rdma_ops module_rdma_ops;					 // temporary var
 		module_rdma_ops.rdma_read 	= &semeru_rdma_read;   // the address of function is fixed.
 		module_rdma_ops.rdma_write 	= &semeru_rdma_write;
+		module_rdma_ops.prefetch_hint	= NULL;
+		module_rdma_ops.rdma_writev	= NULL;
+		module_rdma_ops.rdma_wait	= NULL;
+		module_rdma_ops.meta_reg	= NULL;
+		module_rdma_ops.rdma_write_dirty	= NULL;
+		module_rdma_ops.wait_mem_server	= NULL;
+		module_rdma_ops.ring_doorbell	= NULL;
+		module_rdma_ops.resize_chunks	= NULL;
+		module_rdma_ops.query_placement	= NULL;
+		module_rdma_ops.region_fence	= NULL;
+		module_rdma_ops.rdma_readv	= NULL;
+		module_rdma_ops.prefetch_range	= NULL;
+		module_rdma_ops.rdma_bcast	= NULL;
+		module_rdma_ops.rdma_atomic	= NULL;
 
 		rdma_ops_wrapper(&module_rdma_ops);							 // exported kernel call
 	#endif
@@ -2720,6 +2791,20 @@ void reset_kernel_semeru_rdma_ops(void){
 		struct semeru_rdma_ops module_rdma_ops;		// temporary var
 		module_rdma_ops.rdma_read 	= NULL;   		// reset to NULL
 		module_rdma_ops.rdma_write 	= NULL;
+		module_rdma_ops.prefetch_hint	= NULL;
+		module_rdma_ops.rdma_writev	= NULL;
+		module_rdma_ops.rdma_wait	= NULL;
+		module_rdma_ops.meta_reg	= NULL;
+		module_rdma_ops.rdma_write_dirty	= NULL;
+		module_rdma_ops.wait_mem_server	= NULL;
+		module_rdma_ops.ring_doorbell	= NULL;
+		module_rdma_ops.resize_chunks	= NULL;
+		module_rdma_ops.query_placement	= NULL;
+		module_rdma_ops.region_fence	= NULL;
+		module_rdma_ops.rdma_readv	= NULL;
+		module_rdma_ops.prefetch_range	= NULL;
+		module_rdma_ops.rdma_bcast	= NULL;
+		module_rdma_ops.rdma_atomic	= NULL;
 
 		rdma_ops_wrapper(&module_rdma_ops);				// exported kernel call
 	#endif
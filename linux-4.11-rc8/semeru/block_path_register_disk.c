@@ -187,15 +187,12 @@ static int rmem_queue_rq(struct blk_mq_hw_ctx *hctx, const struct blk_mq_queue_d
     check_io_request_basic_info(rq, __func__);
 
 
-    // 2) Check the number of bio in each Request.
-    //    One i/o request can contain multiple bio,
-    //    but the acculated pages can't exceed the scatter/gather limitation, 32.
-    if(check_number_of_bio_in_request(rq, __func__) > 1){
-      printk(KERN_WARNING "%s, Detect more than 1 bio in current i/o request. \n", __func__);
-			//blk_mq_end_request(rq,rq->errors);  // This will cause the kernel get stuck ???
-		//	internal_ret =-1;
-		//	put_cpu(); 
-		//	goto err;
+    // 2) Check the number of segments in each Request.
+    //    One i/o request can contain multiple bio, merged by the block layer,
+    //    but the acculated segments can't exceed the scatter/gather limitation, blk_queue_max_segments().
+    if(rq->nr_phys_segments > queue_max_segments(rq->q)){
+      printk(KERN_WARNING "%s, %u segments in current i/o request of %u bio, exceed the limit %u. \n", __func__,
+                rq->nr_phys_segments, check_number_of_bio_in_request(rq, __func__), queue_max_segments(rq->q));
     }
 
 
@@ -313,18 +310,38 @@ int rmem_end_io(struct bio * bio, int err){
 
 
 
+#ifndef DEBUG_BD_ONLY
+/**
+ * Polled completion, blk_mq_poll(). The waiter of a REQ_HIPRI request spins on the CQ of
+ * its dispatch queue's rdma_queue, instead of sleeping until the CQ interrupt ends the request.
+ * 
+ * Returns 1 if the request of tag is completed, 0 to keep polling, -1 to stop.
+ */
+static int rmem_poll(struct blk_mq_hw_ctx *hctx, unsigned int tag){
+  struct semeru_rdma_queue* rdma_queue = hctx->driver_data;
+
+  return semeru_poll_rdma_queue(rdma_queue, tag);
+}
+#endif
+
+
+
 /**
  * the devicer operations
  * 
  * queue_rq : handle the queued i/o operation
  * map_queues : map the hardware dispatch queue to cpu
  * init_hctx : initialize the hardware dispatch queue ?? 
+ * poll : reap the CQ of the dispatch queue for a polled request
  * 
  */
 static struct blk_mq_ops rmem_mq_ops = {
     .queue_rq       = rmem_queue_rq,
     .map_queues     = blk_mq_map_queues,    // Map staging queues to  hardware dispatch queues via the cpu id.
     .init_hctx      = rmem_init_hctx,
+#ifndef DEBUG_BD_ONLY
+    .poll           = rmem_poll,
+#endif
  // .complete       =                       // [?] Do we need to initialize this ?
 };
 
@@ -468,6 +485,12 @@ int transfer_requet_to_rdma_message(struct semeru_rdma_queue* rdma_queue, struct
   err:
   #endif
 
+  // The WR can't be built, e.g. too many segments. Fail the request, it has been started.
+  if(unlikely(ret == -EINVAL)){
+    blk_mq_end_request(rq, -EIO);
+    ret = 0;
+  }
+
   return ret;
 }
 
@@ -486,6 +509,20 @@ int transfer_requet_to_rdma_message(struct semeru_rdma_queue* rdma_queue, struct
  */
 
 
+/**
+ * The numa node of the NIC, the request data is DMAed through it.
+ * NUMA_NO_NODE when the RDMA device isn't built.
+ */
+static int rmem_dev_numa_node(struct rmem_device_control* rmem_dev_ctrl){
+  #ifndef DEBUG_BD_ONLY
+  if(rmem_dev_ctrl->rdma_session != NULL && rmem_dev_ctrl->rdma_session->rdma_dev != NULL){
+    return dev_to_node(&rmem_dev_ctrl->rdma_session->rdma_dev->dev->dev);
+  }
+  #endif
+
+  return NUMA_NO_NODE;
+}
+
 /**
  * blk_mq_tag_set stores all i/o operations definition. 
  * 
@@ -515,7 +552,7 @@ static int init_blk_mq_tag_set(struct rmem_device_control* rmem_dev_ctrl){
   tag_set->ops = &rmem_mq_ops;
   tag_set->nr_hw_queues = rmem_dev_ctrl->nr_queues;   // hardware dispatch queue == software staging queue == avaible cores
   tag_set->queue_depth = rmem_dev_ctrl->queue_depth;  // [?] on the fly requet, for each hw queue. Controlled by the availbe request->tag
-  tag_set->numa_node  = NUMA_NO_NODE;
+  tag_set->numa_node  = rmem_dev_numa_node(rmem_dev_ctrl);  // blk-mq places each hw queue on the node of its cores, this is the fallback.
 
   // Reserve RDMA_command space. Get it by blk_mq_rq_to_pdu(struct request*)
   // scatterlist is only used as temporary data structure, no need to send the Remote memory pool.
@@ -544,6 +581,21 @@ err:
 
 
 
+/**
+ * The number of segments a request can have, each one is gathered into an ib_sge of the same WR.
+ */
+static unsigned short rmem_max_request_sge(struct rmem_device_control* rmem_dev_ctrl){
+  unsigned short max_sge = RMEM_MAX_REQUEST_SGE;
+
+  #ifndef DEBUG_BD_ONLY
+  if(rmem_dev_ctrl->rdma_session != NULL && rmem_dev_ctrl->rdma_session->rdma_dev != NULL){
+    max_sge = min_t(int, max_sge, rmem_dev_ctrl->rdma_session->rdma_dev->dev->attrs.max_sge);
+  }
+  #endif
+
+  return max_sge;
+}
+
 /**
  * request_queue is the requst queue descriptor/cotrollor, not the real queue.
  * 
@@ -595,6 +647,17 @@ static int init_blk_mq_queue(struct rmem_device_control* rmem_dev_ctrl){
   sector_div(page_size, RMEM_LOGICAL_SECT_SIZE);                              // page_size /=RMEM_SECT_SIZE
   blk_queue_max_hw_sectors(rmem_dev_ctrl->queue, RMEM_QUEUE_MAX_SECT_SIZE);   // [?] 256kb for current /dev/sda
 
+  // Merged requests, e.g. the swap clusters of swap_writepage, are sent by a single RDMA WR.
+  // 1) Each physical segment takes one sge of the WR, bounded by the device's max_sge.
+  // 2) The WR has one remote address, and each chunk is a seperate remote Region. Never merge across chunks.
+  blk_queue_max_segments(rmem_dev_ctrl->queue, rmem_max_request_sge(rmem_dev_ctrl));
+  blk_queue_chunk_sectors(rmem_dev_ctrl->queue, (unsigned int)((REGION_SIZE_GB * ONE_GB) / RMEM_LOGICAL_SECT_SIZE));
+
+  // Polled i/o, rmem_poll(). Also switchable by /sys/block/xxx/queue/io_poll.
+  #ifndef DEBUG_BD_ONLY
+  queue_flag_set_unlocked(QUEUE_FLAG_POLL, rmem_dev_ctrl->queue);
+  #endif
+
 
   return ret;
 
@@ -700,7 +763,7 @@ int init_gendisk(struct rmem_device_control* rmem_dev_ctrl ){
   int ret = 0;
   sector_t remote_mem_sector_num = RMEM_SIZE_IN_PHY_SECT; // size of the disk. number of physical sector
 
-  rmem_dev_ctrl->disk = alloc_disk_node(1, NUMA_NO_NODE); // minors =1, at most have one partition.
+  rmem_dev_ctrl->disk = alloc_disk_node(1, rmem_dev_numa_node(rmem_dev_ctrl)); // minors =1, at most have one partition.
   if(unlikely(!rmem_dev_ctrl->disk)){
     printk("%s: Failed to allocate disk node\n", __func__);
         ret = -ENOMEM;
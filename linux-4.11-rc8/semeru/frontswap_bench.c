@@ -0,0 +1,497 @@
+/**
+ * Micro-benchmark of the frontswap path, no JVM needed.
+ *
+ * Kernel threads issue synthetic semeru_frontswap_store() and semeru_frontswap_load() calls,
+ * through the same batching, prefetch, compression, zero page and polling code as the swap.
+ * The swap offsets from FS_BENCH_OFFSET_BASE are translated to the data pages directly, see translate_to_mem_server_addr().
+ *
+ * 	/sys/kernel/debug/semeru/bench		write a configuration to run it, read the result of the last run
+ *
+ * The configuration is a line of key=value, the missing keys keep their defaults :
+ * 	op=store|load|mixed	the operation, mixed issues read_pct percent loads.
+ * 	threads=1		kernel threads, bound to the online cores round-robin.
+ * 	ops=100000		pages per thread.
+ * 	pages=1			consecutive pages per access, e.g. 512 for a 2MB extent.
+ * 	pattern=seq|rand|zipf	the access pattern within the working set of a memory server.
+ * 	range_mb=256		the working set per memory server, the top of its last data chunk.
+ * 	servers=N		the accesses are spread round-robin over the memory servers [0, N), all by default.
+ * 	read_pct=50		for op=mixed.
+ * 	seed=1			the random patterns are reproducible with the same seed.
+ *
+ * The write returns after the run, -EBUSY if a run is in progress. The result is one summary line,
+ * then one line per memory server in the format of /sys/kernel/debug/semeru/latency.
+ *
+ * Warning : the stores overwrite the remote pages of the working set, and the compressed and zero page tiers
+ * 	keep their copies. Run it before any JVM uses the data Regions, or reload the module after it.
+ */
+
+#include "frontswap_path.h"
+#include "semeru_cpu.h"
+
+#include <linux/kthread.h>
+#include <linux/random.h>
+#include <linux/seq_file.h>
+
+#ifdef SEMERU_FS_BENCH
+
+#define FS_BENCH_MAX_THREADS	256
+#define FS_BENCH_MAX_PAGES	512
+
+enum fs_bench_op {
+	FS_BENCH_STORE = 0,
+	FS_BENCH_LOAD,
+	FS_BENCH_MIXED,
+	FS_BENCH_OP_NUM
+};
+
+enum fs_bench_pattern {
+	FS_BENCH_SEQ = 0,
+	FS_BENCH_RAND,
+	FS_BENCH_ZIPF,
+	FS_BENCH_PATTERN_NUM
+};
+
+static const char *fs_bench_op_name[FS_BENCH_OP_NUM] = { "store", "load", "mixed" };
+static const char *fs_bench_pattern_name[FS_BENCH_PATTERN_NUM] = { "seq", "rand", "zipf" };
+
+struct fs_bench_config {
+	int op;
+	int pattern;
+	unsigned int threads;
+	unsigned int ops;
+	unsigned int pages;
+	unsigned int range_mb;
+	unsigned int servers;
+	unsigned int read_pct;
+	unsigned int seed;
+};
+
+struct fs_bench_thread {
+	struct fs_bench_config *cfg;
+	int id;
+	struct rnd_state rnd;
+	u64 seq_next; // next page index of the sequential pattern
+	u64 errors;
+	u64 bucket[MAX_NUM_OF_MEMORY_SERVER][FS_LAT_BUCKETS];
+	struct completion done;
+};
+
+// The result of the last run, summed up from its threads.
+struct fs_bench_result {
+	struct fs_bench_config cfg;
+	int valid;
+	u64 ops;
+	u64 errors;
+	u64 elapsed_ns;
+	u64 bucket[MAX_NUM_OF_MEMORY_SERVER][FS_LAT_BUCKETS];
+};
+
+//
+// ###################### Global variables ######################
+//
+
+static DEFINE_MUTEX(fs_bench_lock); // one run at a time, held for the whole run
+static struct fs_bench_result fs_bench_last; // under fs_bench_lock
+static size_t fs_bench_base[MAX_NUM_OF_MEMORY_SERVER]; // data space offset of the working set of each memory server
+static DECLARE_COMPLETION(fs_bench_start);
+static int fs_bench_stopping = 0;
+
+//
+// ###################### Access patterns ######################
+//
+
+/**
+ * Zipfian rank in [0, n) with s = 1, P(rank k) ~ 1/(k + 1).
+ * The inverse CDF is about n^u for a uniform u in [0, 1), 2^x is interpolated linearly between the powers of 2.
+ */
+static u64 fs_bench_zipf(struct rnd_state *rnd, u64 n)
+{
+	int shift = fls64(n) - 1;
+	u64 log2_n = ((u64)shift << 16) + (((n << 16) >> shift) - (1ULL << 16)); // 16.16 fixed point
+	u64 x = ((prandom_u32_state(rnd) >> 16) * log2_n) >> 16;
+	u64 pow = 1ULL << (x >> 16);
+	u64 rank = pow + ((pow * (x & 0xffff)) >> 16) - 1;
+
+	return min_t(u64, rank, n - 1);
+}
+
+/**
+ * The first page index of the next access, the access covers [index, index + cfg->pages).
+ * The zipfian ranks are scattered over the working set by a multiplicative hash, a bijection for n < 2^32,
+ * so the hot pages aren't all neighbours for the prefetcher.
+ */
+static u64 fs_bench_next_index(struct fs_bench_thread *t, u64 n)
+{
+	struct fs_bench_config *cfg = t->cfg;
+	u64 index;
+
+	switch (cfg->pattern) {
+	case FS_BENCH_RAND:
+		index = reciprocal_scale(prandom_u32_state(&t->rnd), (u32)n);
+		break;
+
+	case FS_BENCH_ZIPF:
+		div64_u64_rem(fs_bench_zipf(&t->rnd, n) * 2654435761ULL, n, &index);
+		break;
+
+	default: // FS_BENCH_SEQ
+		index = t->seq_next;
+		t->seq_next = (t->seq_next + cfg->pages) % n;
+		break;
+	}
+
+	return index;
+}
+
+//
+// ###################### Benchmark threads ######################
+//
+
+static int fs_bench_thread_fn(void *data)
+{
+	struct fs_bench_thread *t = data;
+	struct fs_bench_config *cfg = t->cfg;
+	u64 n = (((u64)cfg->range_mb << 20) >> PAGE_SHIFT) - cfg->pages + 1; // access start indexes
+	struct page *store_page = alloc_page(GFP_KERNEL);
+	struct page *load_page = alloc_page(GFP_KERNEL);
+	unsigned int access = t->id;
+	unsigned int i, j;
+	int server, load;
+	size_t data_page;
+	u64 start;
+	int ret;
+
+	if (unlikely(store_page == NULL || load_page == NULL)) {
+		t->errors = cfg->ops;
+		goto out;
+	}
+	// Not zero, or the zero page tier elides the stores.
+	memset(page_address(store_page), 0xa5 + t->id, PAGE_SIZE);
+	t->seq_next = div_u64(n * t->id, cfg->threads); // the sequential streams start apart
+
+	wait_for_completion(&fs_bench_start);
+
+	for (i = 0; i < cfg->ops && !READ_ONCE(fs_bench_stopping); access++) {
+		server = access % cfg->servers;
+		data_page = (fs_bench_base[server] >> PAGE_SHIFT) + fs_bench_next_index(t, n);
+		load = cfg->op == FS_BENCH_LOAD ||
+		       (cfg->op == FS_BENCH_MIXED && prandom_u32_state(&t->rnd) % 100 < cfg->read_pct);
+
+		for (j = 0; j < cfg->pages && i < cfg->ops; j++, i++) {
+			start = ktime_get_ns();
+			if (load)
+				ret = semeru_frontswap_load(0, FS_BENCH_OFFSET_BASE + data_page + j, load_page);
+			else
+				ret = semeru_frontswap_store(0, FS_BENCH_OFFSET_BASE + data_page + j, store_page);
+
+			if (unlikely(ret))
+				t->errors++;
+			else
+				t->bucket[server][min_t(int, fls64(ktime_get_ns() - start), FS_LAT_BUCKETS - 1)]++;
+		}
+		cond_resched();
+	}
+
+out:
+	// A staged store still holds its own reference of the page.
+	if (store_page != NULL)
+		put_page(store_page);
+	if (load_page != NULL)
+		put_page(load_page);
+	complete(&t->done);
+	return 0;
+}
+
+/**
+ * The working set of each memory server is the top range_mb of its last data chunk in the first address window,
+ * the data Regions used last by a JVM. Only the placed chunks count for SEMERU_PLACEMENT_LOAD.
+ */
+static int fs_bench_place(struct fs_bench_config *cfg)
+{
+	int server;
+	long chunk;
+
+	for (server = 0; server < cfg->servers; server++) {
+		for (chunk = RDMA_DATA_REGION_NUM - 1; chunk >= 0; chunk--) {
+			if (READ_ONCE(data_chunk_placement[chunk].mem_server_id) == server)
+				break;
+		}
+
+		if (chunk < 0) {
+			pr_err("%s, no data chunk is placed on memory server[%d] yet.\n", __func__, server);
+			return -ENODEV;
+		}
+		fs_bench_base[server] = ((size_t)(chunk + 1) << CHUNK_SHIFT) - ((size_t)cfg->range_mb << 20);
+	}
+
+	return 0;
+}
+
+static int fs_bench_run(struct fs_bench_config *cfg)
+{
+	struct fs_bench_thread *threads;
+	struct task_struct *task;
+	unsigned int i, started = 0;
+	int cpu = -1;
+	int server, b;
+	u64 start;
+	int ret;
+
+	ret = fs_bench_place(cfg);
+	if (unlikely(ret))
+		return ret;
+
+	threads = vzalloc(sizeof(struct fs_bench_thread) * cfg->threads);
+	if (unlikely(threads == NULL))
+		return -ENOMEM;
+
+	reinit_completion(&fs_bench_start);
+	for (i = 0; i < cfg->threads; i++) {
+		threads[i].cfg = cfg;
+		threads[i].id = i;
+		prandom_seed_state(&threads[i].rnd, ((u64)cfg->seed << 32) | i);
+		init_completion(&threads[i].done);
+
+		cpu = cpumask_next(cpu, cpu_online_mask);
+		if (cpu >= nr_cpu_ids)
+			cpu = cpumask_first(cpu_online_mask);
+
+		task = kthread_create_on_node(fs_bench_thread_fn, &threads[i], cpu_to_node(cpu), "semeru_bench/%u", i);
+		if (IS_ERR(task)) {
+			pr_err("%s, create the benchmark thread %u failed.\n", __func__, i);
+			ret = PTR_ERR(task);
+			cfg->ops = 0; // the started threads return at once
+			break;
+		}
+		kthread_bind(task, cpu);
+		wake_up_process(task);
+		started++;
+	}
+
+	// All the threads are at the start line, or stopping.
+	start = ktime_get_ns();
+	complete_all(&fs_bench_start);
+
+	for (i = 0; i < started; i++)
+		wait_for_completion(&threads[i].done);
+
+	// The staged stores are acked before the clock stops.
+	if (cfg->op != FS_BENCH_LOAD) {
+		for (server = 0; server < cfg->servers; server++)
+			drain_all_rdma_queue(fs_session(0, server));
+	}
+
+	memset(&fs_bench_last, 0, sizeof(fs_bench_last));
+	fs_bench_last.elapsed_ns = ktime_get_ns() - start;
+	fs_bench_last.cfg = *cfg;
+	fs_bench_last.valid = (ret == 0);
+	for (i = 0; i < started; i++) {
+		fs_bench_last.errors += threads[i].errors;
+		for (server = 0; server < cfg->servers; server++) {
+			for (b = 0; b < FS_LAT_BUCKETS; b++) {
+				fs_bench_last.bucket[server][b] += threads[i].bucket[server][b];
+				fs_bench_last.ops += threads[i].bucket[server][b];
+			}
+		}
+	}
+
+	vfree(threads);
+	return ret;
+}
+
+//
+// ###################### debugfs ######################
+//
+
+static int fs_bench_parse(struct fs_bench_config *cfg, char *buf)
+{
+	char *token, *value;
+	unsigned int *field;
+	int i;
+
+	while ((token = strsep(&buf, " \t\n")) != NULL) {
+		if (*token == '\0')
+			continue;
+
+		value = strchr(token, '=');
+		if (value == NULL)
+			return -EINVAL;
+		*value++ = '\0';
+
+		if (strcmp(token, "op") == 0 || strcmp(token, "pattern") == 0) {
+			int is_op = (token[0] == 'o');
+			int num = is_op ? FS_BENCH_OP_NUM : FS_BENCH_PATTERN_NUM;
+			const char **names = is_op ? fs_bench_op_name : fs_bench_pattern_name;
+
+			for (i = 0; i < num && strcmp(value, names[i]) != 0; i++)
+				;
+			if (i == num)
+				return -EINVAL;
+			if (is_op)
+				cfg->op = i;
+			else
+				cfg->pattern = i;
+			continue;
+		}
+
+		if (strcmp(token, "threads") == 0)
+			field = &cfg->threads;
+		else if (strcmp(token, "ops") == 0)
+			field = &cfg->ops;
+		else if (strcmp(token, "pages") == 0)
+			field = &cfg->pages;
+		else if (strcmp(token, "range_mb") == 0)
+			field = &cfg->range_mb;
+		else if (strcmp(token, "servers") == 0)
+			field = &cfg->servers;
+		else if (strcmp(token, "read_pct") == 0)
+			field = &cfg->read_pct;
+		else if (strcmp(token, "seed") == 0)
+			field = &cfg->seed;
+		else
+			return -EINVAL;
+
+		if (kstrtouint(value, 0, field))
+			return -EINVAL;
+	}
+
+	if (cfg->threads == 0 || cfg->threads > FS_BENCH_MAX_THREADS || cfg->pages == 0 ||
+	    cfg->pages > FS_BENCH_MAX_PAGES || cfg->servers == 0 || cfg->servers > num_mem_servers ||
+	    cfg->read_pct > 100 || cfg->range_mb == 0 || ((u64)cfg->range_mb << 20) > (1ULL << CHUNK_SHIFT) ||
+	    (((u64)cfg->range_mb << 20) >> PAGE_SHIFT) < cfg->pages)
+		return -EINVAL;
+
+	return 0;
+}
+
+static ssize_t fs_bench_write(struct file *file, const char __user *ubuf, size_t count, loff_t *ppos)
+{
+	struct fs_bench_config cfg = {
+		.op = FS_BENCH_STORE,
+		.pattern = FS_BENCH_SEQ,
+		.threads = 1,
+		.ops = 100000,
+		.pages = 1,
+		.range_mb = 256,
+		.servers = num_mem_servers,
+		.read_pct = 50,
+		.seed = 1,
+	};
+	char *buf;
+	int ret;
+
+	if (count > PAGE_SIZE)
+		return -EINVAL;
+
+	buf = memdup_user_nul(ubuf, count);
+	if (IS_ERR(buf))
+		return PTR_ERR(buf);
+
+	ret = fs_bench_parse(&cfg, buf);
+	kfree(buf);
+	if (ret) {
+		pr_err("%s, invalid benchmark configuration.\n", __func__);
+		return ret;
+	}
+
+	if (!mutex_trylock(&fs_bench_lock))
+		return -EBUSY;
+	if (READ_ONCE(fs_bench_stopping))
+		ret = -ESHUTDOWN;
+	else
+		ret = fs_bench_run(&cfg);
+	mutex_unlock(&fs_bench_lock);
+
+	return ret ? ret : count;
+}
+
+/**
+ * # op pattern threads pages servers ops errors elapsed_ns kops_per_s MB_per_s
+ * # server count p50_ns p99_ns p999_ns buckets(upper_ns:count)
+ */
+static int fs_bench_show(struct seq_file *m, void *v)
+{
+	struct fs_bench_result *r = &fs_bench_last;
+	u64 elapsed_us;
+	u64 count;
+	int server, b;
+
+	mutex_lock(&fs_bench_lock);
+	if (!r->valid) {
+		seq_puts(m, "# no benchmark run yet\n");
+		goto out;
+	}
+
+	elapsed_us = max_t(u64, div_u64(r->elapsed_ns, 1000), 1);
+	seq_puts(m, "# op pattern threads pages servers ops errors elapsed_ns kops_per_s MB_per_s\n");
+	seq_printf(m, "%s %s %u %u %u %llu %llu %llu %llu %llu\n", fs_bench_op_name[r->cfg.op],
+		   fs_bench_pattern_name[r->cfg.pattern], r->cfg.threads, r->cfg.pages, r->cfg.servers, r->ops,
+		   r->errors, r->elapsed_ns, div64_u64(r->ops * 1000, elapsed_us),
+		   div64_u64(r->ops << PAGE_SHIFT, elapsed_us));
+
+	seq_puts(m, "# server count p50_ns p99_ns p999_ns buckets(upper_ns:count)\n");
+	for (server = 0; server < r->cfg.servers; server++) {
+		u64 *bucket = r->bucket[server];
+
+		count = 0;
+		for (b = 0; b < FS_LAT_BUCKETS; b++)
+			count += bucket[b];
+		if (count == 0)
+			continue;
+
+		seq_printf(m, "%d %llu %llu %llu %llu", server, count, fs_lat_percentile(bucket, count, 500),
+			   fs_lat_percentile(bucket, count, 990), fs_lat_percentile(bucket, count, 999));
+		for (b = 0; b < FS_LAT_BUCKETS; b++) {
+			if (bucket[b])
+				seq_printf(m, " %llu:%llu", 1ULL << b, bucket[b]);
+		}
+		seq_putc(m, '\n');
+	}
+
+out:
+	mutex_unlock(&fs_bench_lock);
+	return 0;
+}
+
+static int fs_bench_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, fs_bench_show, NULL);
+}
+
+static const struct file_operations fs_bench_fops = {
+	.owner = THIS_MODULE,
+	.open = fs_bench_open,
+	.read = seq_read,
+	.write = fs_bench_write,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+//
+// ###################### Init and exit ######################
+//
+
+/**
+ * Invoked after the frontswap path is enabled, the files go to the debugfs directory of the latency histograms.
+ */
+int init_fs_bench(void)
+{
+	WRITE_ONCE(fs_bench_stopping, 0);
+	if (fs_lat_debugfs_dir != NULL)
+		debugfs_create_file("bench", 0600, fs_lat_debugfs_dir, NULL, &fs_bench_fops);
+
+	return 0;
+}
+
+/**
+ * Invoked first at rmmod. The running threads stop at their next access and the run is waited for.
+ * The file itself is removed with the debugfs directory.
+ */
+void exit_fs_bench(void)
+{
+	WRITE_ONCE(fs_bench_stopping, 1);
+	mutex_lock(&fs_bench_lock);
+	mutex_unlock(&fs_bench_lock);
+}
+
+#endif // SEMERU_FS_BENCH
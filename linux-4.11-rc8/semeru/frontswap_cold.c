@@ -0,0 +1,350 @@
+/**
+ * Cold tier of the memory servers.
+ *
+ * The memory servers keep the swapped out pages uncompressed. Much of a large heap is archival,
+ * swapped out once and never swapped in again. Its memory server could compress it and give the DRAM back,
+ * but only if we stop reading and writing it behind the memory server's back by the 1-sided RDMA.
+ *
+ * The data space is split into SEMERU_COLD_BLOCK_SIZE blocks:
+ * 1) A store, a load, or a control path access of a data page sets the touched bit of its block.
+ * 2) Every cold_report_ms, the blocks not touched since the last report are handed over to their memory server
+ * 	by the 2-sided COLD_BLOCKS message, one bitmap per window of FS_COLD_WINDOW_BLOCKS:
+ * 	mapped_chunk : the chunk index within the memory server, the meta Regions are counted.
+ * 	buf[0] : the first block of the window, offset within the chunk.
+ * 	buf[1, MAX_REGION_NUM) : the bitmap, bit i for the block buf[0] + i.
+ * 	The memory server compresses the handed over blocks of its cold Regions, see G1SemeruColdStore.
+ * 3) The first access to a handed over block sends FETCH_BLOCK, mapped_chunk and buf[0] the block.
+ * 	The memory server decompresses the block if it has to, and replies DONE. Then the access goes on.
+ *
+ * An access sets the touched bit before it checks the handed bit, a report sets the handed bit before
+ * it checks the touched bit. Either the access fetches the block, or the report takes it back.
+ * The prefetch, which can't wait for a message, skips the handed over blocks.
+ *
+ * The messages share the send buffer with EXPAND_CHUNKS/RELEASE_CHUNKS, under remote_chunk_list.resize_lock.
+ */
+
+#include "frontswap_path.h"
+#include "semeru_cpu.h"
+
+#include <linux/bitmap.h>
+#include <linux/workqueue.h>
+
+#ifdef SEMERU_FS_COLD
+
+// Blocks of the data offsets, see semeru_data_offset_of(). The bitmaps cover all the address windows.
+#define FS_COLD_MAX_BLOCKS	((SEMERU_MAX_ADDRESS_WINDOWS * MAX_SWAP_MEM_GB * ONE_GB) >> SEMERU_COLD_BLOCK_SHIFT)
+#define FS_COLD_NR_BLOCKS	(semeru_data_space_size() >> SEMERU_COLD_BLOCK_SHIFT) // the served windows
+
+//
+// ###################### Global variables ######################
+//
+
+static bool fs_cold_enabled = false;
+static DECLARE_BITMAP(fs_cold_touched, FS_COLD_MAX_BLOCKS); // accessed since the last report
+static DECLARE_BITMAP(fs_cold_handed_map, FS_COLD_MAX_BLOCKS); // handed over, fetch before the access
+static struct delayed_work fs_cold_work;
+
+// profiling
+static atomic_long_t fs_cold_reports; // rounds over the data space
+static atomic_long_t fs_cold_msgs; // COLD_BLOCKS messages
+static atomic_long_t fs_cold_blocks; // blocks handed over
+static atomic_long_t fs_cold_taken_back; // touched while being handed over
+static atomic_long_t fs_cold_fetches; // FETCH_BLOCK messages
+static atomic_long_t fs_cold_fetch_failed;
+
+/**
+ * Post the filled send buffer to the memory server and poll its DONE, the same as fs_inval_send().
+ * Invoked with remote_chunk_list.resize_lock held.
+ */
+static int fs_cold_send(struct rdma_session_context *rdma_session)
+{
+	struct remote_mapping_chunk_list *chunk_list = &rdma_session->remote_chunk_list;
+	struct semeru_rdma_queue *rdma_queue = &(rdma_session->rdma_queues[MEM_SERVER_NOTIFY_QUEUE]);
+	const struct ib_send_wr *bad_wr;
+	unsigned long flags;
+	unsigned long deadline;
+	int ret;
+
+	reinit_completion(&chunk_list->resize_done);
+	atomic_inc(&rdma_queue->rdma_post_counter);
+	ret = ib_post_send(rdma_queue->qp, &rdma_session->rdma_send_req.sq_wr, &bad_wr);
+	if (unlikely(ret)) {
+		atomic_dec(&rdma_queue->rdma_post_counter);
+		return ret;
+	}
+
+	deadline = jiffies + msecs_to_jiffies(CHUNK_RESIZE_TIMEOUT_MS);
+	while (!try_wait_for_completion(&chunk_list->resize_done)) {
+		spin_lock_irqsave(&rdma_queue->cq_lock, flags);
+		ib_process_cq_direct(rdma_queue->cq, 16);
+		spin_unlock_irqrestore(&rdma_queue->cq_lock, flags);
+
+		if (time_after(jiffies, deadline))
+			return -ETIMEDOUT;
+		usleep_range(20, 50);
+	}
+	return 0;
+}
+
+/**
+ * Hand the untouched blocks of the window [first_block, first_block + FS_COLD_WINDOW_BLOCKS) over.
+ * The window is within one data chunk.
+ */
+static void fs_cold_report_window(size_t first_block)
+{
+	unsigned long bits[BITS_TO_LONGS(FS_COLD_WINDOW_BLOCKS)];
+	size_t data_chunk = first_block >> (CHUNK_SHIFT - SEMERU_COLD_BLOCK_SHIFT);
+	struct rdma_session_context *rdma_session;
+	struct remote_mapping_chunk_list *chunk_list;
+	struct message *send_buf;
+	struct mem_server_addr mem_addr;
+	unsigned int nr = 0;
+	size_t block;
+	size_t i;
+	int ret;
+
+	// Not placed yet, nothing swapped out.
+	if (data_chunk_placement[data_chunk].mem_server_id < 0)
+		return;
+
+#ifdef SEMERU_CHUNK_MIGRATION
+	// Copied to another memory server, both copies have to stay readable.
+	if (fs_migrate_busy(first_block << SEMERU_COLD_BLOCK_SHIFT,
+			    (first_block + FS_COLD_WINDOW_BLOCKS) << SEMERU_COLD_BLOCK_SHIFT))
+		return;
+#endif
+
+	translate_data_addr_to_mem_server_addr(&mem_addr, first_block << SEMERU_COLD_BLOCK_SHIFT);
+	rdma_session = fs_session(mem_addr.window, mem_addr.mem_server_id);
+	chunk_list = &rdma_session->remote_chunk_list;
+	if (!rdma_session->notify.enabled ||
+	    chunk_list->remote_chunk[mem_addr.mem_server_chunk_index].chunk_state != MAPPED)
+		return;
+
+	mutex_lock(&chunk_list->resize_lock);
+
+	bitmap_zero(bits, FS_COLD_WINDOW_BLOCKS);
+	for (i = 0; i < FS_COLD_WINDOW_BLOCKS; i++) {
+		block = first_block + i;
+		if (test_bit(block, fs_cold_handed_map))
+			continue;
+		if (test_and_clear_bit(block, fs_cold_touched))
+			continue; // accessed within this report
+
+		set_bit(block, fs_cold_handed_map);
+		smp_mb__after_atomic();
+		if (unlikely(test_bit(block, fs_cold_touched))) {
+			// An access is going on, it may not have seen the handed bit.
+			clear_bit(block, fs_cold_handed_map);
+			atomic_long_inc(&fs_cold_taken_back);
+			continue;
+		}
+		__set_bit(i, bits);
+		nr++;
+	}
+
+	if (nr == 0)
+		goto out;
+
+	send_buf = rdma_session->rdma_send_req.send_buf;
+	memset(send_buf->buf, 0, sizeof(send_buf->buf));
+	send_buf->buf[0] = mem_addr.mem_server_offset_within_chunk >> SEMERU_COLD_BLOCK_SHIFT;
+	memcpy(&send_buf->buf[1], bits, sizeof(bits));
+	send_buf->type = COLD_BLOCKS;
+	send_buf->mapped_chunk = (int)mem_addr.mem_server_chunk_index;
+
+	// The blocks stay handed over even if the message is lost, a FETCH_BLOCK of an unknown block is only a DONE.
+	ret = fs_cold_send(rdma_session);
+	if (unlikely(ret))
+		pr_err("%s, memory server[%d] COLD_BLOCKS of %u blocks failed, %d \n", __func__,
+		       rdma_session->mem_server_id, nr, ret);
+
+	atomic_long_add(nr, &fs_cold_blocks);
+	atomic_long_inc(&fs_cold_msgs);
+
+out:
+	mutex_unlock(&chunk_list->resize_lock);
+}
+
+static void fs_cold_work_fn(struct work_struct *work)
+{
+	size_t first_block;
+
+	for (first_block = 0; first_block < FS_COLD_NR_BLOCKS; first_block += FS_COLD_WINDOW_BLOCKS) {
+		fs_cold_report_window(first_block);
+		cond_resched();
+	}
+	atomic_long_inc(&fs_cold_reports);
+
+	queue_delayed_work(system_wq, &fs_cold_work, msecs_to_jiffies(cold_report_ms));
+}
+
+/**
+ * Ask the memory server to restore a handed over block, and wait for the DONE.
+ */
+static int fs_cold_fetch(size_t block)
+{
+	struct rdma_session_context *rdma_session;
+	struct remote_mapping_chunk_list *chunk_list;
+	struct message *send_buf;
+	struct mem_server_addr mem_addr;
+	int ret = 0;
+
+	translate_data_addr_to_mem_server_addr(&mem_addr, block << SEMERU_COLD_BLOCK_SHIFT);
+	rdma_session = fs_session(mem_addr.window, mem_addr.mem_server_id);
+	chunk_list = &rdma_session->remote_chunk_list;
+
+	mutex_lock(&chunk_list->resize_lock);
+
+	// Fetched by another access, or taken back by the report.
+	if (!test_bit(block, fs_cold_handed_map))
+		goto out;
+
+	if (unlikely(!rdma_session->notify.enabled)) {
+		ret = -ENOTCONN;
+		goto fail;
+	}
+
+	send_buf = rdma_session->rdma_send_req.send_buf;
+	send_buf->buf[0] = mem_addr.mem_server_offset_within_chunk >> SEMERU_COLD_BLOCK_SHIFT;
+	send_buf->type = FETCH_BLOCK;
+	send_buf->mapped_chunk = (int)mem_addr.mem_server_chunk_index;
+
+	ret = fs_cold_send(rdma_session);
+	if (unlikely(ret))
+		goto fail;
+
+	clear_bit(block, fs_cold_handed_map);
+	atomic_long_inc(&fs_cold_fetches);
+	goto out;
+
+fail:
+	// The block may be compressed, the access can't go on.
+	pr_err("%s, memory server[%d] FETCH_BLOCK of block 0x%lx failed, %d \n", __func__,
+	       rdma_session->mem_server_id, block, ret);
+	atomic_long_inc(&fs_cold_fetch_failed);
+out:
+	mutex_unlock(&chunk_list->resize_lock);
+	return ret;
+}
+
+/**
+ * The data space [start, end) is going to be read or written by RDMA, restore its handed over blocks first.
+ * May sleep, invoked before the core is held.
+ *
+ * return 0, or the error of the FETCH_BLOCK. The access has to fail then.
+ */
+int fs_cold_touch(size_t start, size_t end)
+{
+	size_t block;
+	size_t last;
+	int ret;
+
+	if (!fs_cold_enabled || start >= end)
+		return 0;
+
+	last = min_t(size_t, (end - 1) >> SEMERU_COLD_BLOCK_SHIFT, FS_COLD_NR_BLOCKS - 1);
+	for (block = start >> SEMERU_COLD_BLOCK_SHIFT; block <= last; block++) {
+		// Only the first access of a report dirties the shared line.
+		if (!test_bit(block, fs_cold_touched))
+			set_bit(block, fs_cold_touched);
+		smp_mb();
+
+		if (unlikely(test_bit(block, fs_cold_handed_map))) {
+			ret = fs_cold_fetch(block);
+			if (unlikely(ret))
+				return ret;
+		}
+	}
+	return 0;
+}
+
+/**
+ * The control path range of the user space, only its part in the data space of its address window.
+ */
+int fs_cold_touch_user(char __user *start_addr, unsigned long size)
+{
+	uint64_t start = (uint64_t)start_addr;
+	uint64_t end = start + size;
+	uint64_t data_start;
+	int window = semeru_window_of((unsigned long)start_addr);
+
+	if (!fs_cold_enabled || window < 0)
+		return 0;
+
+	data_start = semeru_data_start(window);
+	start = max_t(uint64_t, start, data_start);
+	end = min_t(uint64_t, end, data_start + RDMA_DATA_SPACE_SIZE);
+	if (end <= start)
+		return 0;
+	return fs_cold_touch(window * RDMA_DATA_SPACE_SIZE + start - data_start,
+			     window * RDMA_DATA_SPACE_SIZE + end - data_start);
+}
+
+/**
+ * The data page is in a handed over block. For the paths which can't wait for a fetch.
+ */
+bool fs_cold_handed(size_t data_page)
+{
+	size_t block = data_page >> (SEMERU_COLD_BLOCK_SHIFT - PAGE_SHIFT);
+
+	return fs_cold_enabled && block < FS_COLD_NR_BLOCKS && test_bit(block, fs_cold_handed_map);
+}
+
+//
+// ###################### Init and free ######################
+//
+
+int init_fs_cold(void)
+{
+	BUILD_BUG_ON(BITS_TO_LONGS(FS_COLD_WINDOW_BLOCKS) > MAX_REGION_NUM - 1);
+	BUILD_BUG_ON(((CHUNK_MASK + 1) >> SEMERU_COLD_BLOCK_SHIFT) % FS_COLD_WINDOW_BLOCKS != 0);
+
+	atomic_long_set(&fs_cold_reports, 0);
+	atomic_long_set(&fs_cold_msgs, 0);
+	atomic_long_set(&fs_cold_blocks, 0);
+	atomic_long_set(&fs_cold_taken_back, 0);
+	atomic_long_set(&fs_cold_fetches, 0);
+	atomic_long_set(&fs_cold_fetch_failed, 0);
+
+	if (cold_report_ms == 0) {
+		pr_info("%s, the cold tier of the memory servers is disabled.\n", __func__);
+		return 0;
+	}
+
+	bitmap_zero(fs_cold_touched, FS_COLD_NR_BLOCKS);
+	bitmap_zero(fs_cold_handed_map, FS_COLD_NR_BLOCKS);
+	INIT_DELAYED_WORK(&fs_cold_work, fs_cold_work_fn);
+	fs_cold_enabled = true;
+	queue_delayed_work(system_wq, &fs_cold_work, msecs_to_jiffies(cold_report_ms));
+
+	pr_info("%s, %lu blocks of %lu KB, reported every %u ms\n", __func__, (unsigned long)FS_COLD_NR_BLOCKS,
+		SEMERU_COLD_BLOCK_SIZE >> 10, cold_report_ms);
+	return 0;
+}
+
+/**
+ * Invoked after the frontswap ops are deregistered.
+ * The handed over blocks stay on the memory servers as they are, the JVM is gone.
+ */
+void free_fs_cold(void)
+{
+	if (!fs_cold_enabled)
+		return;
+
+	cancel_delayed_work_sync(&fs_cold_work);
+	fs_cold_enabled = false;
+}
+
+void fs_cold_print_stats(void)
+{
+	if (!fs_cold_enabled)
+		return;
+
+	pr_warn("%s, %ld reports, %ld blocks handed over in %ld messages, %ld taken back, %ld fetched, %ld fetches failed\n",
+		__func__, atomic_long_read(&fs_cold_reports), atomic_long_read(&fs_cold_blocks),
+		atomic_long_read(&fs_cold_msgs), atomic_long_read(&fs_cold_taken_back),
+		atomic_long_read(&fs_cold_fetches), atomic_long_read(&fs_cold_fetch_failed));
+}
+
+#endif // end of SEMERU_FS_COLD
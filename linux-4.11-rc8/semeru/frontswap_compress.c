@@ -0,0 +1,449 @@
+/**
+ * Compressed local tier of the frontswap path.
+ *
+ * Many swapped out pages of the Java heap compress well, e.g. the zeroed eden and the sparse arrays.
+ * A local pool of compressed pages serves their swap-in without the RDMA read.
+ *
+ * 1) A frontswap store writes the page to the memory server as before, then compresses it by LZ4
+ * 	into a zsmalloc pool. The zero pages and the incompressible pages take no pool memory.
+ * 2) A frontswap load checks the pool first. A hit is decompressed into the swap cache page
+ * 	and dropped from the pool.
+ * 3) The pool is bounded by the module parameter compress_pool_mb, the oldest stores are dropped first.
+ *
+ * The pool is write-through. The memory servers trace and compact the swapped out pages,
+ * an entry holding the only copy of a page would hide it from them.
+ *
+ */
+
+#include "frontswap_path.h"
+#include "semeru_cpu.h"
+
+#include <linux/lz4.h>
+#include <linux/zsmalloc.h>
+#include <linux/rbtree.h>
+#include <linux/percpu.h>
+#include <linux/highmem.h>
+
+#ifdef SEMERU_FS_COMPRESS
+
+//
+// ###################### Global variables ######################
+//
+
+static struct zs_pool *fs_compress_pool = NULL;
+static struct kmem_cache *fs_compress_entry_cache = NULL;
+static unsigned long fs_compress_max_pages; // pool bound, in pages
+
+// The index and the LRU, both protected by fs_compress_lock.
+static struct rb_root fs_compress_tree = RB_ROOT;
+static LIST_HEAD(fs_compress_lru);
+static DEFINE_SPINLOCK(fs_compress_lock);
+
+// Per core LZ4 working memory, and the compressed output before it's copied into the pool.
+struct fs_compress_buf {
+	void *wrkmem;
+	u8 *dst;
+};
+static DEFINE_PER_CPU(struct fs_compress_buf, fs_compress_bufs);
+
+// profiling
+static atomic_t fs_compress_stored; // pages compressed into the pool
+static atomic_t fs_compress_zero; // zero pages, entry only
+static atomic_t fs_compress_rejected; // incompressible, or no memory
+static atomic_t fs_compress_hit; // loads served by the pool
+static atomic_t fs_compress_miss; // loads going to the memory server
+static atomic_t fs_compress_evicted; // dropped for the pool bound
+static atomic_t fs_compress_invalidated; // dropped for a free or a rewrite
+
+//
+// ###################### Index ######################
+//
+
+// Caller must hold fs_compress_lock.
+static struct fs_compress_entry *fs_compress_search(size_t data_page)
+{
+	struct rb_node *node = fs_compress_tree.rb_node;
+	struct fs_compress_entry *entry;
+
+	while (node) {
+		entry = rb_entry(node, struct fs_compress_entry, rbnode);
+		if (data_page < entry->data_page)
+			node = node->rb_left;
+		else if (data_page > entry->data_page)
+			node = node->rb_right;
+		else
+			return entry;
+	}
+
+	return NULL;
+}
+
+// Insert entry, return the replaced one of the same page, or NULL.
+// Caller must hold fs_compress_lock.
+static struct fs_compress_entry *fs_compress_insert(struct fs_compress_entry *entry)
+{
+	struct rb_node **link = &fs_compress_tree.rb_node;
+	struct rb_node *parent = NULL;
+	struct fs_compress_entry *cur;
+
+	while (*link) {
+		parent = *link;
+		cur = rb_entry(parent, struct fs_compress_entry, rbnode);
+		if (entry->data_page < cur->data_page) {
+			link = &parent->rb_left;
+		} else if (entry->data_page > cur->data_page) {
+			link = &parent->rb_right;
+		} else {
+			rb_replace_node(&cur->rbnode, &entry->rbnode, &fs_compress_tree);
+			list_del(&cur->lru);
+			list_add(&entry->lru, &fs_compress_lru);
+			return cur;
+		}
+	}
+
+	rb_link_node(&entry->rbnode, parent, link);
+	rb_insert_color(&entry->rbnode, &fs_compress_tree);
+	list_add(&entry->lru, &fs_compress_lru);
+	return NULL;
+}
+
+// Caller must hold fs_compress_lock.
+static inline void fs_compress_erase(struct fs_compress_entry *entry)
+{
+	rb_erase(&entry->rbnode, &fs_compress_tree);
+	list_del(&entry->lru);
+}
+
+// zs_free() never sleeps, it can be called under fs_compress_lock.
+static inline void fs_compress_free_entry(struct fs_compress_entry *entry)
+{
+	if (entry->handle)
+		zs_free(fs_compress_pool, entry->handle);
+	kmem_cache_free(fs_compress_entry_cache, entry);
+}
+
+//
+// ###################### Store and load ######################
+//
+
+/**
+ * Drop the least recently stored copies until the pool is under its bound.
+ * At most FS_COMPRESS_EVICT_BATCH per store, the freed zspages are released by zsmalloc lazily.
+ * Caller must hold fs_compress_lock.
+ */
+static void fs_compress_evict(void)
+{
+	int i;
+	struct fs_compress_entry *entry;
+
+	for (i = 0; i < FS_COMPRESS_EVICT_BATCH && zs_get_total_pages(fs_compress_pool) > fs_compress_max_pages; i++) {
+		if (list_empty(&fs_compress_lru))
+			break;
+		entry = list_last_entry(&fs_compress_lru, struct fs_compress_entry, lru);
+		fs_compress_erase(entry);
+		fs_compress_free_entry(entry);
+		atomic_inc(&fs_compress_evicted);
+	}
+}
+
+/**
+ * Invoked after the page is written, or staged, to the memory server.
+ * Best effort, the page is only on the memory server if anything fails.
+ * The store runs in the reclaim path, never sleep for memory.
+ */
+void fs_compress_store(size_t data_page, struct page *page)
+{
+	unsigned long flags;
+	struct fs_compress_buf *buf;
+	struct fs_compress_entry *entry;
+	struct fs_compress_entry *dup;
+	unsigned long handle = 0;
+	int length = 0;
+	u8 *src;
+	u8 *dst;
+
+	if (fs_compress_pool == NULL)
+		return;
+
+	entry = kmem_cache_alloc(fs_compress_entry_cache, GFP_NOWAIT | __GFP_NOWARN);
+	if (unlikely(entry == NULL))
+		goto reject;
+
+	src = kmap_atomic(page);
+	if (memchr_inv(src, 0, PAGE_SIZE) == NULL) {
+		kunmap_atomic(src);
+		atomic_inc(&fs_compress_zero);
+		goto insert;
+	}
+
+	buf = &get_cpu_var(fs_compress_bufs);
+	length = LZ4_compress_default((const char *)src, (char *)buf->dst, PAGE_SIZE, FS_COMPRESS_MAX_SIZE,
+				      buf->wrkmem);
+	kunmap_atomic(src);
+	if (length <= 0) {
+		// doesn't fit into FS_COMPRESS_MAX_SIZE
+		put_cpu_var(fs_compress_bufs);
+		goto reject;
+	}
+
+	handle = zs_malloc(fs_compress_pool, length, GFP_NOWAIT | __GFP_NOWARN | __GFP_HIGHMEM | __GFP_MOVABLE);
+	if (unlikely(handle == 0)) {
+		put_cpu_var(fs_compress_bufs);
+		goto reject;
+	}
+	dst = zs_map_object(fs_compress_pool, handle, ZS_MM_WO);
+	memcpy(dst, buf->dst, length);
+	zs_unmap_object(fs_compress_pool, handle);
+	put_cpu_var(fs_compress_bufs);
+	atomic_inc(&fs_compress_stored);
+
+insert:
+	entry->data_page = data_page;
+	entry->handle = handle;
+	entry->length = length;
+
+	spin_lock_irqsave(&fs_compress_lock, flags);
+	dup = fs_compress_insert(entry);
+	if (dup != NULL)
+		fs_compress_free_entry(dup);
+	fs_compress_evict();
+	spin_unlock_irqrestore(&fs_compress_lock, flags);
+	return;
+
+reject:
+	if (entry != NULL)
+		kmem_cache_free(fs_compress_entry_cache, entry);
+	atomic_inc(&fs_compress_rejected);
+
+	// The copy of the previous store is stale now.
+	fs_compress_invalidate(data_page);
+}
+
+/**
+ * Serve the load from the pool. The entry is dropped, the page is in swap cache after the load.
+ *
+ * return
+ *  0 : hit, the data is decompressed into page.
+ *  -1 : miss, caller reads it from memory server.
+ */
+int fs_compress_load(size_t data_page, struct page *page)
+{
+	int ret = 0;
+	unsigned long flags;
+	struct fs_compress_entry *entry;
+	u8 *src;
+	u8 *dst;
+
+	if (fs_compress_pool == NULL)
+		return -1;
+
+	spin_lock_irqsave(&fs_compress_lock, flags);
+	entry = fs_compress_search(data_page);
+	if (entry != NULL)
+		fs_compress_erase(entry);
+	spin_unlock_irqrestore(&fs_compress_lock, flags);
+
+	if (entry == NULL) {
+		atomic_inc(&fs_compress_miss);
+		return -1;
+	}
+
+	if (entry->length == 0) {
+		clear_highpage(page);
+	} else {
+		src = zs_map_object(fs_compress_pool, entry->handle, ZS_MM_RO);
+		dst = kmap_atomic(page);
+		if (unlikely(LZ4_decompress_safe((const char *)src, (char *)dst, entry->length, PAGE_SIZE) != PAGE_SIZE))
+			ret = -1;
+		kunmap_atomic(dst);
+		zs_unmap_object(fs_compress_pool, entry->handle);
+	}
+	fs_compress_free_entry(entry);
+
+	if (unlikely(ret)) {
+		pr_err("%s, corrupted compressed copy of data page 0x%lx, read it from memory server.\n", __func__,
+		       data_page);
+		atomic_inc(&fs_compress_miss);
+		return -1;
+	}
+
+	atomic_inc(&fs_compress_hit);
+	return 0;
+}
+
+/**
+ * The swap entry of data_page is freed.
+ */
+void fs_compress_invalidate(size_t data_page)
+{
+	unsigned long flags;
+	struct fs_compress_entry *entry;
+
+	if (fs_compress_pool == NULL)
+		return;
+
+	spin_lock_irqsave(&fs_compress_lock, flags);
+	entry = fs_compress_search(data_page);
+	if (entry != NULL) {
+		fs_compress_erase(entry);
+		fs_compress_free_entry(entry);
+		atomic_inc(&fs_compress_invalidated);
+	}
+	spin_unlock_irqrestore(&fs_compress_lock, flags);
+}
+
+/**
+ * The memory server rewrites the data pages [start_page, end_page), e.g. its compaction.
+ * Drop their copies, the following loads read the new data.
+ */
+void fs_compress_invalidate_range(size_t start_page, size_t end_page)
+{
+	unsigned long flags;
+	struct rb_node *node;
+	struct rb_node *first = NULL;
+	struct fs_compress_entry *entry;
+
+	if (fs_compress_pool == NULL)
+		return;
+
+	spin_lock_irqsave(&fs_compress_lock, flags);
+
+	// The first entry >= start_page.
+	node = fs_compress_tree.rb_node;
+	while (node) {
+		entry = rb_entry(node, struct fs_compress_entry, rbnode);
+		if (entry->data_page >= start_page) {
+			first = node;
+			node = node->rb_left;
+		} else {
+			node = node->rb_right;
+		}
+	}
+
+	while (first != NULL) {
+		entry = rb_entry(first, struct fs_compress_entry, rbnode);
+		if (entry->data_page >= end_page)
+			break;
+		first = rb_next(first);
+		fs_compress_erase(entry);
+		fs_compress_free_entry(entry);
+		atomic_inc(&fs_compress_invalidated);
+	}
+
+	spin_unlock_irqrestore(&fs_compress_lock, flags);
+}
+
+//
+// ###################### Init and free ######################
+//
+
+static void free_fs_compress_bufs(void)
+{
+	int cpu;
+	struct fs_compress_buf *buf;
+
+	for_each_possible_cpu(cpu) {
+		buf = per_cpu_ptr(&fs_compress_bufs, cpu);
+		vfree(buf->wrkmem);
+		kfree(buf->dst);
+		buf->wrkmem = NULL;
+		buf->dst = NULL;
+	}
+}
+
+int init_fs_compress(void)
+{
+	int cpu;
+	struct fs_compress_buf *buf;
+
+	if (compress_pool_mb == 0) {
+		pr_info("%s, compressed local tier is disabled.\n", __func__);
+		return 0;
+	}
+
+	for_each_possible_cpu(cpu) {
+		buf = per_cpu_ptr(&fs_compress_bufs, cpu);
+		buf->wrkmem = vmalloc_node(LZ4_MEM_COMPRESS, cpu_to_node(cpu));
+		buf->dst = kmalloc_node(FS_COMPRESS_MAX_SIZE, GFP_KERNEL, cpu_to_node(cpu));
+		if (unlikely(buf->wrkmem == NULL || buf->dst == NULL)) {
+			pr_err("%s, allocate the compression buffers of cpu %d failed.\n", __func__, cpu);
+			goto err;
+		}
+	}
+
+	fs_compress_entry_cache = KMEM_CACHE(fs_compress_entry, 0);
+	if (unlikely(fs_compress_entry_cache == NULL)) {
+		pr_err("%s, create fs_compress_entry cache failed.\n", __func__);
+		goto err;
+	}
+
+	fs_compress_pool = zs_create_pool("semeru_fs_compress");
+	if (unlikely(fs_compress_pool == NULL)) {
+		pr_err("%s, create the zsmalloc pool failed.\n", __func__);
+		kmem_cache_destroy(fs_compress_entry_cache);
+		fs_compress_entry_cache = NULL;
+		goto err;
+	}
+
+	fs_compress_max_pages = ((size_t)compress_pool_mb << 20) >> PAGE_SHIFT;
+	atomic_set(&fs_compress_stored, 0);
+	atomic_set(&fs_compress_zero, 0);
+	atomic_set(&fs_compress_rejected, 0);
+	atomic_set(&fs_compress_hit, 0);
+	atomic_set(&fs_compress_miss, 0);
+	atomic_set(&fs_compress_evicted, 0);
+	atomic_set(&fs_compress_invalidated, 0);
+
+	pr_info("%s, compressed local tier of %u MB\n", __func__, compress_pool_mb);
+	return 0;
+
+err:
+	free_fs_compress_bufs();
+	return -ENOMEM;
+}
+
+/**
+ * Invoked after the frontswap ops are deregistered, no more stores or loads.
+ */
+void free_fs_compress(void)
+{
+	struct fs_compress_entry *entry;
+	struct fs_compress_entry *next;
+
+	if (fs_compress_pool == NULL)
+		return;
+
+	rbtree_postorder_for_each_entry_safe (entry, next, &fs_compress_tree, rbnode) {
+		fs_compress_free_entry(entry);
+	}
+	fs_compress_tree = RB_ROOT;
+	INIT_LIST_HEAD(&fs_compress_lru);
+
+	zs_destroy_pool(fs_compress_pool);
+	fs_compress_pool = NULL;
+	kmem_cache_destroy(fs_compress_entry_cache);
+	fs_compress_entry_cache = NULL;
+	free_fs_compress_bufs();
+}
+
+/**
+ * Hit ratio = hit / (hit + miss). No FPU in kernel, print it in per-mille.
+ */
+void fs_compress_print_stats(void)
+{
+	int stored = atomic_read(&fs_compress_stored);
+	int zero = atomic_read(&fs_compress_zero);
+	int hit = atomic_read(&fs_compress_hit);
+	int miss = atomic_read(&fs_compress_miss);
+
+	if (fs_compress_pool == NULL)
+		return;
+
+	pr_warn("%s, stored %d, zero %d, rejected %d, evicted %d, invalidated %d, pool 0x%lx pages\n", __func__, stored,
+		zero, atomic_read(&fs_compress_rejected), atomic_read(&fs_compress_evicted),
+		atomic_read(&fs_compress_invalidated), zs_get_total_pages(fs_compress_pool));
+	pr_warn("%s, hit %d, miss %d, hit ratio %d/1000\n", __func__, hit, miss,
+		(hit + miss) ? (int)((long)hit * 1000 / (hit + miss)) : 0);
+}
+
+#endif // end of SEMERU_FS_COMPRESS
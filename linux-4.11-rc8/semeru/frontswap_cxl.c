@@ -0,0 +1,234 @@
+/**
+ * CXL transport of the frontswap and control paths.
+ *
+ * With a CXL attached memory pool, the memory of a memory server is load/store accessible from the CPU server.
+ * The memory server backs its data Regions by a window of the pool, -XX:SemeruMemPoolFile=/dev/daxX.Y,
+ * and the CPU server maps the same window, module parameter cxl_window=<phys addr>,... one per memory server
+ * of each address window, in the order of the sessions.
+ *
+ * The window is laid out as the SemeruMemPoolFile, the data Regions of the memory server from offset 0:
+ * 	chunk i of the memory server, i >= RDMA_META_REGION_NUM, is at (i - RDMA_META_REGION_NUM) << CHUNK_SHIFT.
+ * 	The chunk index of a data Region is its own index in the address window, see data_chunk_placement,
+ * 	so the window spans all the RDMA_DATA_REGION_NUM data Regions, even if the memory server only holds some.
+ *
+ * 1) Store : copy the page into the window, then write the lines back to the pool.
+ * 2) Load : drop the cached lines of the window first, the memory server may have compacted the page. Then copy.
+ * 3) Control path read/write of the data Regions : the same, on the user buffer.
+ *
+ * The copies are synchronous, there is no QP, no completion and no credit.
+ * They are in the pool before any later signal, which is still an RDMA write.
+ * Only the data Regions are in the window. The meta Region, the 2-sided messages and the signals stay on RDMA.
+ *
+ */
+
+#include "frontswap_path.h"
+#include "semeru_cpu.h"
+
+#include <linux/highmem.h>
+#include <linux/io.h>
+#include <linux/uaccess.h>
+#include <asm/cacheflush.h>
+
+#ifdef SEMERU_TRANSPORT_CXL
+
+//
+// ###################### Global variables ######################
+//
+
+// The data Regions of each memory server, indexed the same as the sessions, see fs_session().
+static void *fs_cxl_window[SEMERU_MAX_ADDRESS_WINDOWS * MAX_NUM_OF_MEMORY_SERVER];
+static size_t fs_cxl_window_size;
+
+// profiling
+static atomic_long_t fs_cxl_stores;
+static atomic_long_t fs_cxl_loads;
+static atomic_long_t fs_cxl_cp_read_bytes;
+static atomic_long_t fs_cxl_cp_write_bytes;
+
+//
+// ###################### Window access ######################
+//
+
+static inline void *fs_cxl_addr(struct mem_server_addr *mem_addr)
+{
+	return (char *)fs_cxl_window[mem_addr->window * num_mem_servers + mem_addr->mem_server_id] +
+	       ((mem_addr->mem_server_chunk_index - RDMA_META_REGION_NUM) << CHUNK_SHIFT) +
+	       mem_addr->mem_server_offset_within_chunk;
+}
+
+static int fs_cxl_store(struct mem_server_addr *mem_addr, struct page *page)
+{
+	void *dst = fs_cxl_addr(mem_addr);
+	void *src = kmap_atomic(page);
+
+	memcpy(dst, src, PAGE_SIZE);
+	kunmap_atomic(src);
+	clflush_cache_range(dst, PAGE_SIZE); // fenced
+
+	atomic_long_inc(&fs_cxl_stores);
+	return 0;
+}
+
+static int fs_cxl_load(struct mem_server_addr *mem_addr, struct page *page)
+{
+	void *src = fs_cxl_addr(mem_addr);
+	void *dst;
+
+	clflush_cache_range(src, PAGE_SIZE);
+	dst = kmap_atomic(page);
+	memcpy(dst, src, PAGE_SIZE);
+	kunmap_atomic(dst);
+
+	atomic_long_inc(&fs_cxl_loads);
+	return 0;
+}
+
+/**
+ * Copy [addr, addr + size) of the data Regions between the user buffer and the window, chunk by chunk.
+ * Return -ENOENT if the range isn't in the data Regions of mem_server_id of one address window,
+ * the caller uses RDMA then.
+ */
+static int fs_cxl_cp_copy(int mem_server_id, char __user *addr, unsigned long size, enum dma_data_direction dir)
+{
+	struct mem_server_addr mem_addr;
+	long offset = semeru_data_offset_of((unsigned long)addr, size);
+	size_t start = (size_t)offset;
+	size_t end = start + size;
+	size_t len;
+	void *win;
+
+	if (offset < 0)
+		return -ENOENT;
+
+	// All the chunks are on mem_server_id, checked before any copy.
+	for (len = start & ~CHUNK_MASK; len < end; len += ((size_t)1 << CHUNK_SHIFT)) {
+		translate_data_addr_to_mem_server_addr(&mem_addr, len);
+		if (mem_addr.mem_server_id != mem_server_id)
+			return -ENOENT;
+	}
+
+#ifdef SEMERU_FS_ZERO_PAGE
+	if (dir == DMA_TO_DEVICE)
+		fs_zero_forget_range(start >> PAGE_SHIFT, (end + PAGE_SIZE - 1) >> PAGE_SHIFT);
+#endif
+#ifdef SEMERU_FS_INVALIDATE
+	if (dir == DMA_TO_DEVICE)
+		fs_invalidate_revive(mem_server_id, start >> PAGE_SHIFT, (end + PAGE_SIZE - 1) >> PAGE_SHIFT);
+#endif
+#ifdef SEMERU_CHUNK_MIGRATION
+	if (dir == DMA_TO_DEVICE)
+		fs_migrate_rewrite(start, end);
+#endif
+
+	while (start < end) {
+		translate_data_addr_to_mem_server_addr(&mem_addr, start);
+		len = min_t(size_t, end - start, ((size_t)1 << CHUNK_SHIFT) - mem_addr.mem_server_offset_within_chunk);
+		win = fs_cxl_addr(&mem_addr);
+
+		if (dir == DMA_TO_DEVICE) {
+			if (copy_from_user(win, addr, len))
+				return -EFAULT;
+			clflush_cache_range(win, len);
+		} else {
+			clflush_cache_range(win, len);
+			if (copy_to_user(addr, win, len))
+				return -EFAULT;
+		}
+
+		start += len;
+		addr += len;
+	}
+
+	if (dir == DMA_TO_DEVICE)
+		atomic_long_add(size, &fs_cxl_cp_write_bytes);
+	else
+		atomic_long_add(size, &fs_cxl_cp_read_bytes);
+	return 0;
+}
+
+static int fs_cxl_cp_read(int mem_server_id, char __user *addr, unsigned long size)
+{
+	return fs_cxl_cp_copy(mem_server_id, addr, size, DMA_FROM_DEVICE);
+}
+
+static int fs_cxl_cp_write(int mem_server_id, char __user *addr, unsigned long size)
+{
+	return fs_cxl_cp_copy(mem_server_id, addr, size, DMA_TO_DEVICE);
+}
+
+static const struct semeru_transport fs_cxl_transport = {
+	.name = "cxl",
+	.store = fs_cxl_store,
+	.load = fs_cxl_load,
+	.cp_read = fs_cxl_cp_read,
+	.cp_write = fs_cxl_cp_write,
+};
+
+//
+// ###################### Initialization ######################
+//
+
+/**
+ * Map the window of each memory server of each address window, if cxl_window is given.
+ * Otherwise the swap and control paths stay on RDMA.
+ */
+int init_fs_cxl(void)
+{
+	int i;
+
+	atomic_long_set(&fs_cxl_stores, 0);
+	atomic_long_set(&fs_cxl_loads, 0);
+	atomic_long_set(&fs_cxl_cp_read_bytes, 0);
+	atomic_long_set(&fs_cxl_cp_write_bytes, 0);
+
+	if (num_cxl_window == 0)
+		return 0;
+
+	if (num_cxl_window < fs_num_sessions()) {
+		pr_err("%s, %d cxl_window for %u memory servers of %u address windows.\n", __func__, num_cxl_window,
+		       num_mem_servers, semeru_nr_windows);
+		return -EINVAL;
+	}
+
+	fs_cxl_window_size = (size_t)RDMA_DATA_REGION_NUM << CHUNK_SHIFT;
+	for (i = 0; i < fs_num_sessions(); i++) {
+		fs_cxl_window[i] = memremap(cxl_window[i], fs_cxl_window_size, MEMREMAP_WB);
+		if (fs_cxl_window[i] == NULL) {
+			pr_err("%s, map the window of window[%d] memory server[%d] at 0x%lx failed.\n", __func__,
+			       i / (int)num_mem_servers, i % (int)num_mem_servers, cxl_window[i]);
+			free_fs_cxl();
+			return -ENOMEM;
+		}
+		pr_info("%s, window[%d] memory server[%d] data Regions in the CXL window [0x%lx, 0x%lx)\n", __func__,
+			i / (int)num_mem_servers, i % (int)num_mem_servers, cxl_window[i],
+			cxl_window[i] + fs_cxl_window_size);
+	}
+
+	semeru_transport = &fs_cxl_transport;
+	return 0;
+}
+
+void free_fs_cxl(void)
+{
+	int i;
+
+	if (semeru_transport == &fs_cxl_transport)
+		semeru_transport = NULL;
+	for (i = 0; i < SEMERU_MAX_ADDRESS_WINDOWS * MAX_NUM_OF_MEMORY_SERVER; i++) {
+		if (fs_cxl_window[i] != NULL)
+			memunmap(fs_cxl_window[i]);
+		fs_cxl_window[i] = NULL;
+	}
+}
+
+void fs_cxl_print_stats(void)
+{
+	if (num_cxl_window == 0)
+		return;
+
+	pr_warn("%s, CXL stores %ld, loads %ld, control path read 0x%lx bytes, written 0x%lx bytes\n", __func__,
+		atomic_long_read(&fs_cxl_stores), atomic_long_read(&fs_cxl_loads),
+		atomic_long_read(&fs_cxl_cp_read_bytes), atomic_long_read(&fs_cxl_cp_write_bytes));
+}
+
+#endif // SEMERU_TRANSPORT_CXL
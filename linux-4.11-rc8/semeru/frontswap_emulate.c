@@ -0,0 +1,129 @@
+/**
+ * Emulation of a slower fabric, for the capacity planning.
+ *
+ * Run the production workloads on the existing racks, as if the memory servers were farther or behind thinner links.
+ * Each successful frontswap load/store and control path read/write of memory server i, after its real transfer :
+ * 1) Waits emu_delay_us[i], plus a uniformly distributed [0, emu_jitter_us[i]].
+ * 2) Takes its bytes from the token bucket of memory server i, refilled at emu_bw_mbps[i] MB/s up to emu_burst_kb.
+ * 	A bucket in debt makes its caller wait until the refill pays it back, so the concurrent callers queue up
+ * 	behind each other as on a saturated link.
+ *
+ * The parameters are writable at runtime, e.g. sweep emu_delay_us and read the latency histograms for each step,
+ * /sys/kernel/debug/semeru/latency, the injected waits are included there.
+ *
+ * Not a wire model : the real transfer isn't slowed down, only its caller is held back afterwards.
+ * The prefetches, the async store batches and the 2-sided messages are not delayed by themselves.
+ * A wait shorter than FS_EMU_SPIN_NS, or in a context that can't sleep, spins.
+ */
+
+#include "frontswap_path.h"
+#include "semeru_cpu.h"
+
+#include <linux/delay.h>
+#include <linux/random.h>
+
+#ifdef SEMERU_FS_EMULATE
+
+//
+// ###################### Global variables ######################
+//
+
+static struct fs_emu_bucket fs_emu_buckets[MAX_NUM_OF_MEMORY_SERVER];
+
+void init_fs_emulate(void)
+{
+	int i;
+
+	for (i = 0; i < MAX_NUM_OF_MEMORY_SERVER; i++) {
+		spin_lock_init(&fs_emu_buckets[i].lock);
+		fs_emu_buckets[i].tokens = (s64)emu_burst_kb << 10;
+		fs_emu_buckets[i].last_ns = ktime_get_ns();
+		atomic64_set(&fs_emu_buckets[i].waits, 0);
+		atomic64_set(&fs_emu_buckets[i].wait_ns, 0);
+	}
+}
+
+//
+// ###################### The waits ######################
+//
+
+/**
+ * Take bytes from the bucket, return the ns until the bucket is out of debt.
+ * 1 MB/s refills 1 byte per 1000ns.
+ */
+static u64 fs_emu_take_tokens(struct fs_emu_bucket *bucket, unsigned int mbps, unsigned long bytes)
+{
+	s64 burst = (s64)READ_ONCE(emu_burst_kb) << 10;
+	unsigned long flags;
+	u64 now;
+	s64 tokens;
+
+	spin_lock_irqsave(&bucket->lock, flags);
+	now = ktime_get_ns();
+	// The idle time is capped to a second, against the overflow. A slow bucket with a large burst refills partially.
+	tokens = bucket->tokens + (s64)div_u64(min_t(u64, now - bucket->last_ns, NSEC_PER_SEC) * mbps, 1000);
+	bucket->tokens = min(tokens, burst) - (s64)bytes;
+	bucket->last_ns = now;
+	tokens = bucket->tokens;
+	spin_unlock_irqrestore(&bucket->lock, flags);
+
+	if (tokens >= 0)
+		return 0;
+	return div_u64((u64)(-tokens) * 1000, mbps);
+}
+
+static void fs_emu_wait(u64 wait_ns)
+{
+	u64 end = ktime_get_ns() + wait_ns;
+
+	if (wait_ns >= FS_EMU_SPIN_NS && preemptible()) {
+		usleep_range(div_u64(wait_ns, NSEC_PER_USEC), div_u64(wait_ns, NSEC_PER_USEC) + 1);
+		return;
+	}
+
+	while (ktime_get_ns() < end)
+		cpu_relax();
+}
+
+void fs_emu_delay(int mem_server_id, unsigned long bytes)
+{
+	struct fs_emu_bucket *bucket;
+	unsigned int delay_us, jitter_us, mbps;
+	u64 wait_ns = 0;
+
+	if (unlikely(mem_server_id < 0 || mem_server_id >= MAX_NUM_OF_MEMORY_SERVER))
+		return;
+
+	delay_us = READ_ONCE(emu_delay_us[mem_server_id]);
+	jitter_us = READ_ONCE(emu_jitter_us[mem_server_id]);
+	mbps = READ_ONCE(emu_bw_mbps[mem_server_id]);
+	if (likely(delay_us == 0 && jitter_us == 0 && mbps == 0))
+		return;
+
+	bucket = &fs_emu_buckets[mem_server_id];
+	if (mbps != 0)
+		wait_ns = fs_emu_take_tokens(bucket, mbps, bytes);
+	wait_ns += (u64)delay_us * NSEC_PER_USEC;
+	if (jitter_us != 0)
+		wait_ns += (u64)prandom_u32_max(jitter_us + 1) * NSEC_PER_USEC;
+	if (wait_ns == 0)
+		return;
+
+	fs_emu_wait(wait_ns);
+	atomic64_inc(&bucket->waits);
+	atomic64_add(wait_ns, &bucket->wait_ns);
+}
+
+void fs_emulate_print_stats(void)
+{
+	int i;
+
+	for (i = 0; i < num_mem_servers; i++) {
+		if (atomic64_read(&fs_emu_buckets[i].waits) == 0)
+			continue;
+		pr_info("%s, memory server[%d] delayed %lld operations by %lld us in total\n", __func__, i,
+			atomic64_read(&fs_emu_buckets[i].waits), atomic64_read(&fs_emu_buckets[i].wait_ns) / NSEC_PER_USEC);
+	}
+}
+
+#endif // SEMERU_FS_EMULATE
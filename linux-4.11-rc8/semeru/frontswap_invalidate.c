@@ -0,0 +1,375 @@
+/**
+ * Remote reclamation of the dead swap slots.
+ *
+ * The kernel frees a swap slot after the page is swapped in and dirtied, or at swapoff.
+ * The memory server's copy of the page is dead then, but it keeps the physical page and traces it.
+ *
+ * The dead pages are batched per session, memory server and address window, one bitmap of a FS_INVAL_WINDOW_PAGES window,
+ * and sent by the 2-sided INVALIDATE_PAGES message:
+ * 	mapped_chunk : the chunk index within the memory server, the meta Regions are counted.
+ * 	buf[0] : the first page of the window, offset within the chunk.
+ * 	buf[1, MAX_REGION_NUM) : the bitmap, bit i for the page buf[0] + i.
+ * The memory server discards the pages and replies DONE.
+ *
+ * 1) The batch is sent when an invalidation falls out of its window, or FS_INVAL_DELAY_MS after its first page.
+ * 	One batch per memory server is posted at a time. A batch closed while the previous one is still
+ * 	on the fly is dropped, the pages are only reclaimed later by the memory server's compaction.
+ * 2) Any write to the memory server's copy revives the page: a store, a control path write of the data space,
+ * 	and the memory server's own compaction of the Region. Its bit is cleared from the batch.
+ * 	If the batch is already posted, the writer waits for the DONE, or the discard could land after the write.
+ *
+ * The message shares the send buffer with EXPAND_CHUNKS/RELEASE_CHUNKS, under remote_chunk_list.resize_lock.
+ */
+
+#include "frontswap_path.h"
+#include "semeru_cpu.h"
+
+#include <linux/bitmap.h>
+#include <linux/workqueue.h>
+
+#ifdef SEMERU_FS_INVALIDATE
+
+enum fs_inval_state {
+	FS_INVAL_IDLE, // no batch to send
+	FS_INVAL_READY, // a batch is closed, the work is going to post it
+	FS_INVAL_POSTED, // waiting for the memory server's DONE
+};
+
+struct fs_inval_batch {
+	spinlock_t lock;
+	struct rdma_session_context *rdma_session;
+
+	// the filling batch, data pages [window, window + FS_INVAL_WINDOW_PAGES)
+	size_t window;
+	unsigned int nr;
+	unsigned long bits[BITS_TO_LONGS(FS_INVAL_WINDOW_PAGES)];
+
+	// the closed batch
+	enum fs_inval_state state;
+	size_t ready_window;
+	unsigned long ready_bits[BITS_TO_LONGS(FS_INVAL_WINDOW_PAGES)];
+
+	struct delayed_work work;
+};
+
+//
+// ###################### Global variables ######################
+//
+
+static struct fs_inval_batch *fs_inval_batches = NULL; // one per session, see fs_session()
+
+// profiling
+static atomic_long_t fs_inval_pages; // pages sent to the memory servers
+static atomic_long_t fs_inval_msgs; // INVALIDATE_PAGES messages
+static atomic_long_t fs_inval_dropped; // pages of the dropped batches
+static atomic_long_t fs_inval_revived; // bits cleared by the writes
+static atomic_long_t fs_inval_waits; // writes waiting for a posted batch
+
+/**
+ * The batch of the session serving the data page, NULL if there is none.
+ */
+static struct fs_inval_batch *fs_inval_batch_of(int mem_server_id, size_t data_page)
+{
+	size_t window = (data_page << PAGE_SHIFT) / RDMA_DATA_SPACE_SIZE;
+
+	if (fs_inval_batches == NULL ||
+	    unlikely(mem_server_id < 0 || (unsigned int)mem_server_id >= num_mem_servers ||
+		     window >= semeru_nr_windows))
+		return NULL;
+	return &fs_inval_batches[window * num_mem_servers + mem_server_id];
+}
+
+/**
+ * Hand the filling batch to the work. Invoked with the batch lock held.
+ */
+static void fs_inval_close_batch(struct fs_inval_batch *batch)
+{
+	if (batch->nr == 0)
+		return;
+
+	if (batch->state != FS_INVAL_IDLE) {
+		atomic_long_add(batch->nr, &fs_inval_dropped);
+	} else {
+		batch->ready_window = batch->window;
+		bitmap_copy(batch->ready_bits, batch->bits, FS_INVAL_WINDOW_PAGES);
+		batch->state = FS_INVAL_READY;
+		mod_delayed_work(system_wq, &batch->work, 0);
+	}
+
+	bitmap_zero(batch->bits, FS_INVAL_WINDOW_PAGES);
+	batch->nr = 0;
+}
+
+/**
+ * Post the closed batch and wait for the DONE.
+ */
+static void fs_inval_send(struct fs_inval_batch *batch)
+{
+	struct rdma_session_context *rdma_session = batch->rdma_session;
+	struct remote_mapping_chunk_list *chunk_list = &rdma_session->remote_chunk_list;
+	struct semeru_rdma_queue *rdma_queue = &(rdma_session->rdma_queues[MEM_SERVER_NOTIFY_QUEUE]);
+	struct message *send_buf = rdma_session->rdma_send_req.send_buf;
+	const struct ib_send_wr *bad_wr;
+	struct mem_server_addr mem_addr;
+	unsigned long flags;
+	unsigned long deadline;
+	unsigned int nr;
+	int ret;
+
+	mutex_lock(&chunk_list->resize_lock);
+
+	// 1) Fill the message under the batch lock, the writes may clear the bits until it's posted.
+	spin_lock_irqsave(&batch->lock, flags);
+	nr = batch->state == FS_INVAL_READY ? bitmap_weight(batch->ready_bits, FS_INVAL_WINDOW_PAGES) : 0;
+	if (nr == 0 || !rdma_session->notify.enabled) {
+		batch->state = FS_INVAL_IDLE;
+		spin_unlock_irqrestore(&batch->lock, flags);
+		goto out;
+	}
+
+	translate_data_addr_to_mem_server_addr(&mem_addr, batch->ready_window << PAGE_SHIFT);
+	if (unlikely(mem_addr.mem_server_id != rdma_session->mem_server_id)) {
+		// The data chunk moved to another memory server, the dead pages only cost its memory.
+		batch->state = FS_INVAL_IDLE;
+		spin_unlock_irqrestore(&batch->lock, flags);
+		atomic_long_add(nr, &fs_inval_dropped);
+		goto out;
+	}
+	memset(send_buf->buf, 0, sizeof(send_buf->buf));
+	send_buf->buf[0] = mem_addr.mem_server_offset_within_chunk >> PAGE_SHIFT;
+	memcpy(&send_buf->buf[1], batch->ready_bits, sizeof(batch->ready_bits));
+	send_buf->type = INVALIDATE_PAGES;
+	send_buf->mapped_chunk = (int)mem_addr.mem_server_chunk_index;
+
+	reinit_completion(&chunk_list->resize_done);
+	atomic_inc(&rdma_queue->rdma_post_counter);
+	ret = ib_post_send(rdma_queue->qp, &rdma_session->rdma_send_req.sq_wr, &bad_wr);
+	if (unlikely(ret)) {
+		atomic_dec(&rdma_queue->rdma_post_counter);
+		batch->state = FS_INVAL_IDLE;
+		spin_unlock_irqrestore(&batch->lock, flags);
+		pr_err("%s, post INVALIDATE_PAGES to memory server[%d] failed, %d \n", __func__,
+		       rdma_session->mem_server_id, ret);
+		atomic_long_add(nr, &fs_inval_dropped);
+		goto out;
+	}
+	batch->state = FS_INVAL_POSTED;
+	spin_unlock_irqrestore(&batch->lock, flags);
+
+	// 2) Poll the response, the same as cp_resize_chunks_of_server().
+	deadline = jiffies + msecs_to_jiffies(CHUNK_RESIZE_TIMEOUT_MS);
+	while (!try_wait_for_completion(&chunk_list->resize_done)) {
+		spin_lock_irqsave(&rdma_queue->cq_lock, flags);
+		ib_process_cq_direct(rdma_queue->cq, 16);
+		spin_unlock_irqrestore(&rdma_queue->cq_lock, flags);
+
+		if (time_after(jiffies, deadline)) {
+			pr_err("%s, memory server[%d] response of %u pages timeout for %dms \n", __func__,
+			       rdma_session->mem_server_id, nr, CHUNK_RESIZE_TIMEOUT_MS);
+			break;
+		}
+		usleep_range(20, 50);
+	}
+
+	atomic_long_add(nr, &fs_inval_pages);
+	atomic_long_inc(&fs_inval_msgs);
+
+	spin_lock_irqsave(&batch->lock, flags);
+	batch->state = FS_INVAL_IDLE;
+	spin_unlock_irqrestore(&batch->lock, flags);
+
+out:
+	mutex_unlock(&chunk_list->resize_lock);
+}
+
+static void fs_inval_work_fn(struct work_struct *work)
+{
+	struct fs_inval_batch *batch = container_of(to_delayed_work(work), struct fs_inval_batch, work);
+	unsigned long flags;
+
+	// A filling batch left alone for FS_INVAL_DELAY_MS.
+	spin_lock_irqsave(&batch->lock, flags);
+	if (batch->state == FS_INVAL_IDLE)
+		fs_inval_close_batch(batch);
+	spin_unlock_irqrestore(&batch->lock, flags);
+
+	fs_inval_send(batch);
+
+	// The pages invalidated while the batch was on the fly.
+	spin_lock_irqsave(&batch->lock, flags);
+	if (batch->nr != 0)
+		mod_delayed_work(system_wq, &batch->work, msecs_to_jiffies(FS_INVAL_DELAY_MS));
+	spin_unlock_irqrestore(&batch->lock, flags);
+}
+
+/**
+ * The swap slot of the data page is freed. Invoked with the swap_info lock held.
+ */
+void fs_invalidate_page(int mem_server_id, size_t data_page)
+{
+	struct fs_inval_batch *batch = fs_inval_batch_of(mem_server_id, data_page);
+	unsigned long flags;
+
+	if (batch == NULL)
+		return;
+
+	spin_lock_irqsave(&batch->lock, flags);
+	if (batch->nr != 0 && round_down(data_page, FS_INVAL_WINDOW_PAGES) != batch->window)
+		fs_inval_close_batch(batch);
+
+	if (batch->nr == 0) {
+		batch->window = round_down(data_page, FS_INVAL_WINDOW_PAGES);
+		// Or the work re-arms the delay after the batch on the fly.
+		if (batch->state == FS_INVAL_IDLE)
+			mod_delayed_work(system_wq, &batch->work, msecs_to_jiffies(FS_INVAL_DELAY_MS));
+	}
+	if (!__test_and_set_bit(data_page - batch->window, batch->bits))
+		batch->nr++;
+	spin_unlock_irqrestore(&batch->lock, flags);
+}
+
+/**
+ * The memory server's copy of the data pages [start_page, end_page) is going to be written.
+ * Invoked before the write is posted, the range is within one chunk.
+ */
+void fs_invalidate_revive(int mem_server_id, size_t start_page, size_t end_page)
+{
+	struct fs_inval_batch *batch = fs_inval_batch_of(mem_server_id, start_page);
+	struct rdma_session_context *rdma_session;
+	struct semeru_rdma_queue *rdma_queue;
+	unsigned long flags;
+	unsigned long deadline;
+	size_t page;
+	bool wait = false;
+
+	if (batch == NULL)
+		return;
+
+	spin_lock_irqsave(&batch->lock, flags);
+	for (page = start_page; page < end_page; page++) {
+		if (batch->nr != 0 && page - batch->window < FS_INVAL_WINDOW_PAGES &&
+		    __test_and_clear_bit(page - batch->window, batch->bits)) {
+			batch->nr--;
+			atomic_long_inc(&fs_inval_revived);
+		}
+
+		if (batch->state != FS_INVAL_IDLE && page - batch->ready_window < FS_INVAL_WINDOW_PAGES &&
+		    test_bit(page - batch->ready_window, batch->ready_bits)) {
+			if (batch->state == FS_INVAL_POSTED) {
+				wait = true;
+			} else {
+				__clear_bit(page - batch->ready_window, batch->ready_bits);
+				atomic_long_inc(&fs_inval_revived);
+			}
+		}
+	}
+	spin_unlock_irqrestore(&batch->lock, flags);
+
+	if (likely(!wait))
+		return;
+
+	// The discard is on the fly. Poll its DONE without consuming it, the work waits on it too.
+	atomic_long_inc(&fs_inval_waits);
+	rdma_session = batch->rdma_session;
+	rdma_queue = &(rdma_session->rdma_queues[MEM_SERVER_NOTIFY_QUEUE]);
+	deadline = jiffies + msecs_to_jiffies(CHUNK_RESIZE_TIMEOUT_MS);
+	while (READ_ONCE(batch->state) == FS_INVAL_POSTED &&
+	       !completion_done(&rdma_session->remote_chunk_list.resize_done)) {
+		spin_lock_irqsave(&rdma_queue->cq_lock, flags);
+		ib_process_cq_direct(rdma_queue->cq, 16);
+		spin_unlock_irqrestore(&rdma_queue->cq_lock, flags);
+
+		if (time_after(jiffies, deadline)) {
+			pr_err("%s, memory server[%d] response of INVALIDATE_PAGES timeout for %dms \n", __func__,
+			       mem_server_id, CHUNK_RESIZE_TIMEOUT_MS);
+			break;
+		}
+		cpu_relax();
+	}
+}
+
+/**
+ * Send the filling batches, e.g. at swapoff.
+ */
+void fs_invalidate_flush(void)
+{
+	struct fs_inval_batch *batch;
+	unsigned long flags;
+	int i;
+
+	if (fs_inval_batches == NULL)
+		return;
+
+	for (i = 0; i < fs_num_sessions(); i++) {
+		batch = &fs_inval_batches[i];
+		spin_lock_irqsave(&batch->lock, flags);
+		if (batch->nr != 0)
+			mod_delayed_work(system_wq, &batch->work, 0);
+		spin_unlock_irqrestore(&batch->lock, flags);
+	}
+}
+
+//
+// ###################### Init and free ######################
+//
+
+int init_fs_invalidate(void)
+{
+	struct fs_inval_batch *batch;
+	int i;
+
+	BUILD_BUG_ON(BITS_TO_LONGS(FS_INVAL_WINDOW_PAGES) > MAX_REGION_NUM - 1);
+
+	fs_inval_batches = kcalloc(fs_num_sessions(), sizeof(struct fs_inval_batch), GFP_KERNEL);
+	if (unlikely(fs_inval_batches == NULL)) {
+		pr_err("%s, allocate the invalidation batches of %d sessions failed.\n", __func__,
+		       fs_num_sessions());
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < fs_num_sessions(); i++) {
+		batch = &fs_inval_batches[i];
+		spin_lock_init(&batch->lock);
+		batch->rdma_session = &rdma_session_global_ptr[i];
+		batch->state = FS_INVAL_IDLE;
+		INIT_DELAYED_WORK(&batch->work, fs_inval_work_fn);
+	}
+
+	atomic_long_set(&fs_inval_pages, 0);
+	atomic_long_set(&fs_inval_msgs, 0);
+	atomic_long_set(&fs_inval_dropped, 0);
+	atomic_long_set(&fs_inval_revived, 0);
+	atomic_long_set(&fs_inval_waits, 0);
+
+	pr_info("%s, invalidation window of %lu pages\n", __func__, FS_INVAL_WINDOW_PAGES);
+	return 0;
+}
+
+/**
+ * Invoked after the frontswap ops are deregistered, no more invalidations.
+ */
+void free_fs_invalidate(void)
+{
+	int i;
+
+	if (fs_inval_batches == NULL)
+		return;
+
+	for (i = 0; i < fs_num_sessions(); i++)
+		cancel_delayed_work_sync(&fs_inval_batches[i].work);
+	kfree(fs_inval_batches);
+	fs_inval_batches = NULL;
+}
+
+void fs_invalidate_print_stats(void)
+{
+	if (fs_inval_batches == NULL)
+		return;
+
+	pr_warn("%s, dead pages sent %ld in %ld messages, dropped %ld, revived %ld, writes waited %ld\n", __func__,
+		atomic_long_read(&fs_inval_pages), atomic_long_read(&fs_inval_msgs),
+		atomic_long_read(&fs_inval_dropped), atomic_long_read(&fs_inval_revived),
+		atomic_long_read(&fs_inval_waits));
+}
+
+#endif // end of SEMERU_FS_INVALIDATE
@@ -0,0 +1,414 @@
+/**
+ * CPU-local SSD tier of the frontswap path.
+ *
+ * The swap out stalls on the memory servers, out of credit, disconnected or not acking within 5ms,
+ * and fails the store at the end. With the module parameter local_swap_file, a sparse file or a partition
+ * on the local NVMe of at least the data space, such a store is written there instead.
+ *
+ * 1) A page sits at its own offset of the data space, no slot allocation. One bit per data page records
+ * 	that its latest copy is the local one, the copy on the memory server is stale.
+ * 2) A frontswap load checks the bit first, before the zero page map, the compressed pool and the prefetch cache.
+ * 	The prefetcher skips the local pages.
+ * 3) A background worker writes the local pages to their memory servers, once they are reachable with credit,
+ * 	then clears their bits. It holds fs_local_rwsem for write per page, a store of the same page waits
+ * 	for it in fs_local_forget(), so its stale copy never overwrites the new store.
+ * 4) Before the memory server traces or compacts a range, its local pages are written back synchronously,
+ * 	fs_local_sync_range(). The pages still local then are dropped, or the range isn't given to the memory server.
+ * 	The worker never writes a pre-compaction copy over the compacted layout.
+ *
+ * The file is accessed by direct I/O of the page itself, no page cache is allocated on the swap out path.
+ *
+ */
+
+#include "frontswap_path.h"
+#include "semeru_cpu.h"
+
+#include <linux/bitmap.h>
+#include <linux/falloc.h>
+#include <linux/fs.h>
+#include <linux/sched/mm.h>
+#include <linux/uio.h>
+#include <linux/vmalloc.h>
+
+#ifdef SEMERU_FS_LOCAL_TIER
+
+//
+// ###################### Global variables ######################
+//
+
+static struct file *fs_local_file = NULL;
+static unsigned long *fs_local_map = NULL; // 1 bit per data page, its latest copy is local
+static size_t fs_local_map_pages; // number of bits
+static DECLARE_RWSEM(fs_local_rwsem); // the loads read, the migration and the forgetting stores write
+
+static struct page *fs_local_page; // the buffer of the worker
+static void fs_local_migrate_fn(struct work_struct *work);
+static DECLARE_DELAYED_WORK(fs_local_migrate_work, fs_local_migrate_fn);
+static int fs_local_stopping;
+
+// profiling
+static atomic_long_t fs_local_stored; // stores diverted to the local file
+static atomic_long_t fs_local_failed; // stores the local file couldn't take either
+static atomic_long_t fs_local_loads; // loads served by the local file
+static atomic_long_t fs_local_migrated; // written back to the memory servers
+static atomic_long_t fs_local_forgot; // overwritten or freed before the migration
+
+//
+// ###################### Local I/O ######################
+//
+
+/**
+ * Read or write the page at the offset start_addr of the local file, synchronously.
+ * No swap out is entered by the allocations of the file system here.
+ */
+static int fs_local_rw(struct page *page, size_t start_addr, int rw)
+{
+	struct bio_vec bvec = { .bv_page = page, .bv_len = PAGE_SIZE, .bv_offset = 0 };
+	struct iov_iter iter;
+	loff_t pos = (loff_t)start_addr;
+	unsigned int noio = memalloc_noio_save();
+	ssize_t n;
+
+	iov_iter_bvec(&iter, ITER_BVEC | rw, &bvec, 1, PAGE_SIZE);
+	if (rw == WRITE)
+		n = vfs_iter_write(fs_local_file, &iter, &pos);
+	else
+		n = vfs_iter_read(fs_local_file, &iter, &pos);
+
+	memalloc_noio_restore(noio);
+	return n == PAGE_SIZE ? 0 : -EIO;
+}
+
+/**
+ * Write the page to the local file instead of its memory server.
+ * The caller forgot the page before, fs_local_forget(), and holds its page lock.
+ *
+ * return 0 on success, the store is done.
+ */
+int fs_local_store(size_t start_addr, struct page *page)
+{
+	size_t data_page = start_addr >> PAGE_SHIFT;
+
+	if (fs_local_map == NULL || unlikely(data_page >= fs_local_map_pages))
+		return -1;
+
+	if (unlikely(fs_local_rw(page, start_addr, WRITE))) {
+		pr_err_ratelimited("%s, write data page 0x%lx to %s failed.\n", __func__, data_page, local_swap_file);
+		atomic_long_inc(&fs_local_failed);
+		return -EIO;
+	}
+
+	set_bit(data_page, fs_local_map);
+	atomic_long_inc(&fs_local_stored);
+	if (!READ_ONCE(fs_local_stopping))
+		schedule_delayed_work(&fs_local_migrate_work, msecs_to_jiffies(FS_LOCAL_MIGRATE_MS));
+	return 0;
+}
+
+/**
+ * return :
+ * 	0, the page is read from the local file.
+ * 	-1, not local, read it from the memory server.
+ * 	other, the local copy is lost.
+ */
+int fs_local_load(size_t start_addr, struct page *page)
+{
+	size_t data_page = start_addr >> PAGE_SHIFT;
+	int ret = -1;
+
+	if (fs_local_map == NULL || unlikely(data_page >= fs_local_map_pages) || !test_bit(data_page, fs_local_map))
+		return -1;
+
+	down_read(&fs_local_rwsem);
+	if (test_bit(data_page, fs_local_map)) {
+		ret = fs_local_rw(page, start_addr, READ);
+		if (unlikely(ret))
+			pr_err("%s, read data page 0x%lx from %s failed.\n", __func__, data_page, local_swap_file);
+		else
+			atomic_long_inc(&fs_local_loads);
+	}
+	up_read(&fs_local_rwsem);
+	return ret;
+}
+
+/**
+ * The page is being stored again, its local copy is stale.
+ * Waits for the worker writing it back meanwhile. May sleep.
+ */
+void fs_local_forget(size_t start_addr)
+{
+	size_t data_page = start_addr >> PAGE_SHIFT;
+
+	if (fs_local_map == NULL || unlikely(data_page >= fs_local_map_pages) || !test_bit(data_page, fs_local_map))
+		return;
+
+	down_write(&fs_local_rwsem);
+	if (test_and_clear_bit(data_page, fs_local_map))
+		atomic_long_inc(&fs_local_forgot);
+	up_write(&fs_local_rwsem);
+}
+
+/**
+ * The swap slot is freed, under the swap_info lock. No sleep, a racing write back of the dead page is harmless.
+ */
+void fs_local_drop(size_t data_page)
+{
+	if (fs_local_map == NULL || unlikely(data_page >= fs_local_map_pages))
+		return;
+
+	if (test_bit(data_page, fs_local_map) && test_and_clear_bit(data_page, fs_local_map))
+		atomic_long_inc(&fs_local_forgot);
+}
+
+bool fs_local_has(size_t data_page)
+{
+	return fs_local_map != NULL && data_page < fs_local_map_pages && test_bit(data_page, fs_local_map);
+}
+
+/**
+ * Whether any page of the data space [start, end) has its latest copy local. No sleep.
+ */
+bool fs_local_has_range(size_t start, size_t end)
+{
+	size_t first = start >> PAGE_SHIFT;
+	size_t last = min_t(size_t, (end + PAGE_SIZE - 1) >> PAGE_SHIFT, fs_local_map_pages);
+
+	return fs_local_map != NULL && first < last && find_next_bit(fs_local_map, last, first) < last;
+}
+
+//
+// ###################### Migration to the memory servers ######################
+//
+
+/**
+ * Write one local page back to its memory server.
+ *
+ * return :
+ * 	0, written back or forgotten meanwhile.
+ * 	-EAGAIN, the memory server can't take it yet.
+ */
+static int fs_local_migrate_page(size_t data_page)
+{
+	size_t start_addr = data_page << PAGE_SHIFT;
+	struct mem_server_addr mem_addr;
+	bool copying;
+	int ret = 0;
+
+	copying = fs_migrate_begin(start_addr, &mem_addr, true);
+	if (fs_mem_server_congested(&mem_addr)) {
+		ret = -EAGAIN;
+		goto out;
+	}
+
+	down_write(&fs_local_rwsem);
+	if (!test_bit(data_page, fs_local_map))
+		goto unlock; // stored again meanwhile
+
+	ret = fs_local_rw(fs_local_page, start_addr, READ);
+	if (unlikely(ret)) {
+		pr_err("%s, read data page 0x%lx from %s failed, it's lost.\n", __func__, data_page, local_swap_file);
+		clear_bit(data_page, fs_local_map);
+		ret = 0;
+		goto unlock;
+	}
+
+#ifdef SEMERU_FS_COLD
+	// The memory server may have compressed the block, restore it before writing into it.
+	ret = fs_cold_touch(start_addr, start_addr + PAGE_SIZE);
+	if (unlikely(ret)) {
+		ret = -EAGAIN;
+		goto unlock;
+	}
+#endif
+	if (unlikely(copying))
+		fs_migrate_mirror(start_addr, fs_local_page);
+
+	if (fs_migrate_page_rw(&mem_addr, fs_local_page, DMA_TO_DEVICE)) {
+		ret = -EAGAIN;
+		goto unlock;
+	}
+
+	// The memory server has the latest copy now.
+#ifdef SEMERU_FS_ZERO_PAGE
+	fs_zero_forget_range(data_page, data_page + 1);
+#endif
+#ifdef SEMERU_FS_PREFETCH
+	fs_prefetch_invalidate(data_page);
+#endif
+	clear_bit(data_page, fs_local_map);
+	vfs_fallocate(fs_local_file, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, (loff_t)start_addr, PAGE_SIZE);
+	atomic_long_inc(&fs_local_migrated);
+
+unlock:
+	up_write(&fs_local_rwsem);
+out:
+	fs_migrate_end(start_addr, copying);
+	return ret;
+}
+
+/**
+ * Write the local pages of the data space [start, end) back to their memory servers now,
+ * e.g. before the memory server compacts the range. The congested memory servers are retried
+ * for FS_LOCAL_SYNC_MS. May sleep.
+ *
+ * return the number of pages still local.
+ */
+size_t fs_local_sync_range(size_t start, size_t end)
+{
+	size_t first = start >> PAGE_SHIFT;
+	size_t last = min_t(size_t, (end + PAGE_SIZE - 1) >> PAGE_SHIFT, fs_local_map_pages);
+	unsigned long deadline = jiffies + msecs_to_jiffies(FS_LOCAL_SYNC_MS);
+	size_t left;
+	size_t bit;
+
+	if (fs_local_map == NULL || first >= last)
+		return 0;
+
+	do {
+		left = 0;
+		for (bit = find_next_bit(fs_local_map, last, first); bit < last;
+		     bit = find_next_bit(fs_local_map, last, bit + 1)) {
+			if (fs_local_migrate_page(bit))
+				left++;
+			cond_resched();
+		}
+		if (left == 0 || time_after(jiffies, deadline))
+			break;
+		msleep(1);
+	} while (1);
+
+	return left;
+}
+
+/**
+ * Drop the local copies of the data space [start, end), the memory server rewrites the range.
+ * Waits for the worker writing one of them back meanwhile. May sleep.
+ *
+ * return the number of pages dropped.
+ */
+size_t fs_local_drop_range(size_t start, size_t end)
+{
+	size_t first = start >> PAGE_SHIFT;
+	size_t last = min_t(size_t, (end + PAGE_SIZE - 1) >> PAGE_SHIFT, fs_local_map_pages);
+	size_t dropped = 0;
+	size_t bit;
+
+	if (!fs_local_has_range(start, end))
+		return 0;
+
+	down_write(&fs_local_rwsem);
+	for (bit = find_next_bit(fs_local_map, last, first); bit < last;
+	     bit = find_next_bit(fs_local_map, last, bit + 1)) {
+		if (test_and_clear_bit(bit, fs_local_map))
+			dropped++;
+	}
+	up_write(&fs_local_rwsem);
+
+	atomic_long_add(dropped, &fs_local_forgot);
+	return dropped;
+}
+
+/**
+ * Write back up to FS_LOCAL_MIGRATE_BATCH pages per run, re-armed until the local file is empty.
+ * A congested memory server is retried at the next run.
+ */
+static void fs_local_migrate_fn(struct work_struct *work)
+{
+	size_t bit;
+	int budget = FS_LOCAL_MIGRATE_BATCH;
+	bool pending = false;
+
+	for (bit = find_first_bit(fs_local_map, fs_local_map_pages); bit < fs_local_map_pages;
+	     bit = find_next_bit(fs_local_map, fs_local_map_pages, bit + 1)) {
+		if (READ_ONCE(fs_local_stopping))
+			return;
+		if (budget-- == 0) {
+			pending = true;
+			break;
+		}
+		if (fs_local_migrate_page(bit))
+			pending = true;
+		cond_resched();
+	}
+
+	if (pending && !READ_ONCE(fs_local_stopping))
+		schedule_delayed_work(&fs_local_migrate_work, msecs_to_jiffies(FS_LOCAL_MIGRATE_MS));
+}
+
+//
+// ###################### Init and free ######################
+//
+
+int init_fs_local(void)
+{
+	struct file *file;
+
+	if (local_swap_file == NULL || local_swap_file[0] == '\0')
+		return 0;
+
+	file = filp_open(local_swap_file, O_RDWR | O_LARGEFILE | O_DIRECT, 0);
+	if (IS_ERR(file)) {
+		pr_err("%s, open %s for the direct I/O failed, %ld.\n", __func__, local_swap_file, PTR_ERR(file));
+		return PTR_ERR(file);
+	}
+
+	fs_local_page = alloc_page(GFP_KERNEL);
+	fs_local_map_pages = semeru_data_space_size() >> PAGE_SHIFT;
+	fs_local_map = vzalloc(BITS_TO_LONGS(fs_local_map_pages) * sizeof(unsigned long));
+	if (unlikely(fs_local_page == NULL || fs_local_map == NULL)) {
+		pr_err("%s, allocate the local page map of 0x%lx pages failed.\n", __func__, fs_local_map_pages);
+		vfree(fs_local_map);
+		fs_local_map = NULL;
+		if (fs_local_page != NULL)
+			__free_page(fs_local_page);
+		filp_close(file, NULL);
+		return -ENOMEM;
+	}
+
+	atomic_long_set(&fs_local_stored, 0);
+	atomic_long_set(&fs_local_failed, 0);
+	atomic_long_set(&fs_local_loads, 0);
+	atomic_long_set(&fs_local_migrated, 0);
+	atomic_long_set(&fs_local_forgot, 0);
+	fs_local_stopping = 0;
+
+	fs_local_file = file;
+	smp_wmb(); // the file before the map, the store path checks the map only.
+	pr_info("%s, the stores of the congested memory servers go to %s\n", __func__, local_swap_file);
+	return 0;
+}
+
+/**
+ * Stop the write back, before the memory servers are disconnected.
+ * The stores may still go to the local file until the frontswap ops are deregistered.
+ */
+void exit_fs_local(void)
+{
+	if (fs_local_map == NULL)
+		return;
+
+	WRITE_ONCE(fs_local_stopping, 1);
+	cancel_delayed_work_sync(&fs_local_migrate_work);
+}
+
+/**
+ * Invoked after the frontswap ops are deregistered. The pages still local are lost with the module.
+ */
+void free_fs_local(void)
+{
+	if (fs_local_map == NULL)
+		return;
+
+	pr_warn("%s, stores diverted %ld, failed %ld, loaded locally %ld, written back %ld, forgot %ld, left 0x%lx\n",
+		__func__, atomic_long_read(&fs_local_stored), atomic_long_read(&fs_local_failed),
+		atomic_long_read(&fs_local_loads), atomic_long_read(&fs_local_migrated),
+		atomic_long_read(&fs_local_forgot), (size_t)bitmap_weight(fs_local_map, fs_local_map_pages));
+
+	vfree(fs_local_map);
+	fs_local_map = NULL;
+	__free_page(fs_local_page);
+	filp_close(fs_local_file, NULL);
+	fs_local_file = NULL;
+}
+
+#endif // end of SEMERU_FS_LOCAL_TIER
@@ -0,0 +1,763 @@
+/**
+ * Live migration of the data chunks between the memory servers.
+ *
+ * 	/sys/kernel/debug/semeru/migrate	write a command, read the moving data chunks and the counters
+ *
+ * Commands :
+ * 	move chunk=N server=S	move the data chunk N to the memory server S.
+ * 	drain server=S		move all the data chunks of S to the least loaded other memory servers.
+ * 	rebalance		move the data chunks until the memory servers differ by one data chunk at most.
+ * 	cancel			give up all the moves.
+ *
+ * A move is driven by the placement sync points of the JVM, semeru_query_placement(NULL) at the start of each GC pause.
+ * 1) Sync point, start. The free slot of the target is reserved, the stores to the data chunk are mirrored to it from now on.
+ * 2) The worker copies the data chunk from the source to the target, see fs_migrate_copy().
+ * 3) Next sync point, switch. The placement points to the target, the old slot is free.
+ * 	The JVM drops its cached placement and dispatches the data chunk's Regions to the target from this GC on.
+ * 	If the memory server or the control path rewrote the data chunk on the source since the last sync point,
+ * 	it's copied again instead, at most FS_MIGRATE_MAX_PASSES times.
+ *
+ * The swap in/out hold the read side of fs_migrate_rwsem, the sync point takes its write side,
+ * so the placement never switches under a fault. The loads stay on the source until the switch.
+ *
+ * A data chunk moves between the memory servers of its own address window, each window is placed separately.
+ * Only SEMERU_PLACEMENT_LOAD, the JVM computes the placement of the other policies itself.
+ * Not with replica_mode=1, the replica of a data chunk is defined by its slot.
+ * The concurrent compaction isn't granted on a moving data chunk, its writes wouldn't be mirrored.
+ *
+ */
+
+#include "frontswap_path.h"
+#include "semeru_cpu.h"
+
+#include <linux/percpu-rwsem.h>
+#include <linux/sched/mm.h>
+#include <linux/seq_file.h>
+
+#ifdef SEMERU_CHUNK_MIGRATION
+
+//
+// ###################### Global variables ######################
+//
+
+static struct fs_migration fs_migrations[SEMERU_MAX_ADDRESS_WINDOWS * RDMA_DATA_REGION_NUM];
+static atomic_t fs_migrate_active = ATOMIC_INIT(0); // data chunks not FS_MIGRATE_IDLE, the fast path of the sync point
+static DEFINE_MUTEX(fs_migrate_lock); // the state transitions
+DEFINE_STATIC_PERCPU_RWSEM(fs_migrate_rwsem);
+
+static struct workqueue_struct *fs_migrate_wq;
+static void fs_migrate_work_fn(struct work_struct *work);
+static DECLARE_WORK(fs_migrate_work, fs_migrate_work_fn);
+static int fs_migrate_stopping;
+
+static const char *fs_migrate_state_name[] = { "idle", "queued", "copying", "ready" };
+
+// profiling
+static atomic_long_t fs_migrate_moved;
+static atomic_long_t fs_migrate_aborted;
+static atomic_long_t fs_migrate_copied_pages;
+static atomic_long_t fs_migrate_mirrored;
+
+// The data chunks of all the served address windows.
+static inline size_t fs_migrate_nr_chunks(void)
+{
+	return semeru_nr_windows * RDMA_DATA_REGION_NUM;
+}
+
+//
+// ###################### Page copy ######################
+//
+
+/**
+ * Read or write a page at mem_addr, synchronously.
+ * No swap out is entered by an allocation here, its store could wait on the copy_lock held by the caller.
+ * Also the write back of the local SSD tier.
+ */
+int fs_migrate_page_rw(struct mem_server_addr *mem_addr, struct page *page, enum dma_data_direction dir)
+{
+	struct rdma_session_context *rdma_session = fs_session(mem_addr->window, mem_addr->mem_server_id);
+	struct semeru_rdma_queue *rdma_queue;
+	struct remote_mapping_chunk *remote_chunk_ptr;
+	struct fs_rdma_req *rdma_req;
+	unsigned int noio = memalloc_noio_save();
+	int ret;
+
+#ifdef SEMERU_TRANSPORT
+	if (semeru_transport != NULL) {
+		ret = dir == DMA_TO_DEVICE ? semeru_transport->store(mem_addr, page) :
+					     semeru_transport->load(mem_addr, page);
+		goto out;
+	}
+#endif
+
+	rdma_queue = get_dp_rdma_queue(rdma_session, get_cpu());
+	remote_chunk_ptr = &(rdma_session->remote_chunk_list.remote_chunk[mem_addr->mem_server_chunk_index]);
+	if (unlikely(!rdma_queue_alive(rdma_queue) ||
+		     mem_addr->mem_server_chunk_index >= rdma_session->remote_chunk_list.chunk_num ||
+		     remote_chunk_ptr->chunk_state != MAPPED)) {
+		put_cpu();
+		ret = -EINVAL;
+		goto out;
+	}
+
+	rdma_req = fs_rdma_req_get(rdma_queue);
+	if (unlikely(rdma_req == NULL)) {
+		put_cpu();
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	ret = semeru_fs_rdma_send(rdma_session, rdma_queue, rdma_req, remote_chunk_ptr,
+				  mem_addr->mem_server_offset_within_chunk, page, dir);
+	put_cpu();
+	if (unlikely(ret)) {
+		fs_rdma_req_put(rdma_queue, rdma_req);
+		goto out;
+	}
+
+	wait_rdma_queue(rdma_queue);
+	if (unlikely(wait_for_completion_timeout(&rdma_req->done, msecs_to_jiffies(FS_MIGRATE_TIMEOUT_MS)) == 0)) {
+		pr_err("%s, memory server[%d] chunk[%lu] offset 0x%lx timeout for %dms\n", __func__,
+		       mem_addr->mem_server_id, mem_addr->mem_server_chunk_index,
+		       mem_addr->mem_server_offset_within_chunk, FS_MIGRATE_TIMEOUT_MS);
+		ret = -ETIMEDOUT; // the request is still owned by the CQ
+		goto out;
+	}
+	fs_rdma_req_put(rdma_queue, rdma_req);
+
+out:
+	memalloc_noio_restore(noio);
+	return ret;
+}
+
+// The bytes of the source slot backed by the memory server, 0 if the JVM released it.
+static size_t fs_migrate_mapped_size(int window, int mem_server_id, int slot)
+{
+	struct remote_mapping_chunk_list *chunk_list = &fs_session(window, mem_server_id)->remote_chunk_list;
+	size_t index = slot + RDMA_META_REGION_NUM;
+
+	if (index >= chunk_list->chunk_num || chunk_list->remote_chunk[index].chunk_state != MAPPED)
+		return 0;
+	return chunk_list->remote_chunk[index].mapped_size;
+}
+
+/**
+ * One pass over the data chunk, page by page from the source slot to the target slot.
+ *
+ * Each batch of FS_MIGRATE_BATCH_PAGES holds the write side of copy_lock. The staged stores of the source
+ * are drained first, the stores waiting on the lock write both slots after the batch.
+ */
+static int fs_migrate_copy(size_t chunk, struct fs_migration *m)
+{
+	struct mem_server_addr src = { .window = m->window,
+				       .mem_server_id = m->source,
+				       .mem_server_chunk_index = m->source_slot + RDMA_META_REGION_NUM };
+	struct mem_server_addr dst = { .window = m->window,
+				       .mem_server_id = m->target,
+				       .mem_server_chunk_index = m->target_slot + RDMA_META_REGION_NUM };
+	size_t end = fs_migrate_mapped_size(m->window, m->source, m->source_slot);
+	size_t offset = 0;
+	size_t batch_end;
+	struct page *page;
+	int ret = 0;
+
+	page = alloc_page(GFP_KERNEL);
+	if (page == NULL)
+		return -ENOMEM;
+
+	while (ret == 0 && offset < end) {
+		if (READ_ONCE(fs_migrate_stopping) || READ_ONCE(m->failed)) {
+			ret = -ECANCELED;
+			break;
+		}
+
+		batch_end = min_t(size_t, offset + ((size_t)FS_MIGRATE_BATCH_PAGES << PAGE_SHIFT), end);
+#ifdef SEMERU_FS_COLD
+		// The source may have compressed the batch.
+		ret = fs_cold_touch((chunk << CHUNK_SHIFT) + offset, (chunk << CHUNK_SHIFT) + batch_end);
+		if (unlikely(ret))
+			break;
+#endif
+		down_write(&m->copy_lock);
+		drain_all_rdma_queue(fs_session(m->window, m->source));
+		for (; offset < batch_end; offset += PAGE_SIZE) {
+			src.mem_server_offset_within_chunk = offset;
+			dst.mem_server_offset_within_chunk = offset;
+			ret = fs_migrate_page_rw(&src, page, DMA_FROM_DEVICE);
+			if (ret == 0)
+				ret = fs_migrate_page_rw(&dst, page, DMA_TO_DEVICE);
+			if (unlikely(ret))
+				break;
+			atomic_long_inc(&fs_migrate_copied_pages);
+		}
+		up_write(&m->copy_lock);
+		cond_resched();
+	}
+
+	__free_page(page);
+	if (ret)
+		pr_err("%s, data chunk[%lu] memory server[%d] -> [%d] failed at 0x%lx, %d\n", __func__, chunk, m->source,
+		       m->target, offset, ret);
+	return ret;
+}
+
+//
+// ###################### State transitions ######################
+//
+
+/**
+ * Give up the move, under fs_migrate_lock. The data chunk stays on its source.
+ * Not for a data chunk being copied by the worker, it sets failed for that.
+ */
+static void fs_migrate_abort(size_t chunk, int err)
+{
+	struct fs_migration *m = &fs_migrations[chunk];
+	int state = m->state;
+
+	down_write(&m->copy_lock); // no store is mirroring
+	WRITE_ONCE(m->state, FS_MIGRATE_IDLE);
+	up_write(&m->copy_lock);
+
+	if (state >= FS_MIGRATE_COPYING)
+		release_data_chunk_slot(m->window, m->target, m->target_slot);
+	atomic_dec(&fs_migrate_active);
+	atomic_long_inc(&fs_migrate_aborted);
+	pr_warn("%s, data chunk[%lu] stays on memory server[%d], %s, %d\n", __func__, chunk,
+		data_chunk_placement[chunk].mem_server_id, fs_migrate_state_name[state], err);
+}
+
+/**
+ * QUEUED -> COPYING, at the sync point with fs_migrate_rwsem held.
+ * Return true if the worker has to copy it.
+ */
+static bool fs_migrate_start(size_t chunk)
+{
+	struct fs_migration *m = &fs_migrations[chunk];
+	struct remote_mapping_chunk_list *chunk_list = &fs_session(m->window, m->target)->remote_chunk_list;
+	size_t index;
+	int slot;
+
+	m->source = data_chunk_placement[chunk].mem_server_id;
+	m->source_slot = data_chunk_placement[chunk].chunk_index;
+	if (m->source == m->target) {
+		WRITE_ONCE(m->state, FS_MIGRATE_IDLE);
+		atomic_dec(&fs_migrate_active);
+		return false;
+	}
+
+	// Granted for the concurrent compaction before it's queued, released by this GC.
+	if (fs_fence_overlaps(chunk << CHUNK_SHIFT, (chunk + 1) << CHUNK_SHIFT))
+		return false;
+
+	slot = reserve_data_chunk_slot(chunk, m->target);
+	if (slot < 0) {
+		fs_migrate_abort(chunk, -ENOSPC);
+		return false;
+	}
+
+	index = slot + RDMA_META_REGION_NUM;
+	if (index >= chunk_list->chunk_num || chunk_list->remote_chunk[index].chunk_state != MAPPED ||
+	    chunk_list->remote_chunk[index].mapped_size < fs_migrate_mapped_size(m->window, m->source, m->source_slot)) {
+		release_data_chunk_slot(m->window, m->target, slot);
+		fs_migrate_abort(chunk, -ENXIO);
+		return false;
+	}
+
+	m->target_slot = slot;
+	m->passes = 1;
+	m->dirty = false;
+	WRITE_ONCE(m->state, FS_MIGRATE_COPYING);
+	return true;
+}
+
+/**
+ * READY -> IDLE, at the sync point with fs_migrate_rwsem held. The target slot has all the pages.
+ *
+ * The prefetches in flight may still read the old slot, it keeps the same data until it's placed again.
+ */
+static void fs_migrate_switch(size_t chunk)
+{
+	struct fs_migration *m = &fs_migrations[chunk];
+
+	drain_all_rdma_queue(fs_session(m->window, m->source)); // the staged stores of the old slot, before it's reused
+	move_data_chunk(chunk, m->target, m->target_slot);
+	WRITE_ONCE(m->state, FS_MIGRATE_IDLE);
+	atomic_dec(&fs_migrate_active);
+	atomic_long_inc(&fs_migrate_moved);
+
+	pr_info("%s, data chunk[%lu] moved from memory server[%d] chunk[%d] to memory server[%d] chunk[%d], %d passes\n",
+		__func__, chunk, m->source, m->source_slot, m->target, m->target_slot, m->passes);
+}
+
+/**
+ * The worker, one copy pass for each data chunk in FS_MIGRATE_COPYING.
+ */
+static void fs_migrate_work_fn(struct work_struct *work)
+{
+	struct fs_migration *m;
+	size_t chunk;
+	int ret;
+
+	for (chunk = 0; chunk < fs_migrate_nr_chunks(); chunk++) {
+		m = &fs_migrations[chunk];
+		if (READ_ONCE(m->state) != FS_MIGRATE_COPYING)
+			continue;
+
+		ret = fs_migrate_copy(chunk, m);
+
+		mutex_lock(&fs_migrate_lock);
+		if (ret)
+			fs_migrate_abort(chunk, ret);
+		else
+			WRITE_ONCE(m->state, FS_MIGRATE_READY);
+		mutex_unlock(&fs_migrate_lock);
+	}
+}
+
+/**
+ * The placement sync point of the JVM, at the start of each GC pause. No data chunk of the last pause is
+ * written by the memory servers any more.
+ *
+ * Start the queued moves, switch the copied ones, copy the rewritten ones again.
+ * Return the placement epoch.
+ */
+int fs_migrate_sync(void)
+{
+	struct fs_migration *m;
+	size_t chunk;
+	bool kick = false;
+
+	if (atomic_read(&fs_migrate_active) == 0)
+		return data_chunk_placement_epoch_read();
+
+	mutex_lock(&fs_migrate_lock);
+	percpu_down_write(&fs_migrate_rwsem);
+
+	for (chunk = 0; chunk < fs_migrate_nr_chunks(); chunk++) {
+		m = &fs_migrations[chunk];
+
+		switch (m->state) {
+		case FS_MIGRATE_QUEUED:
+			kick |= fs_migrate_start(chunk);
+			break;
+
+		case FS_MIGRATE_READY:
+			if (READ_ONCE(m->failed)) {
+				fs_migrate_abort(chunk, -EIO);
+			} else if (READ_ONCE(m->dirty)) {
+				if (++m->passes > FS_MIGRATE_MAX_PASSES) {
+					fs_migrate_abort(chunk, -EBUSY);
+					break;
+				}
+				WRITE_ONCE(m->dirty, false);
+				WRITE_ONCE(m->state, FS_MIGRATE_COPYING);
+				kick = true;
+			} else {
+				fs_migrate_switch(chunk);
+			}
+			break;
+
+		default:
+			break;
+		}
+	}
+
+	percpu_up_write(&fs_migrate_rwsem);
+	mutex_unlock(&fs_migrate_lock);
+
+	if (kick)
+		queue_work(fs_migrate_wq, &fs_migrate_work);
+
+	return data_chunk_placement_epoch_read();
+}
+
+//
+// ###################### Hooks of the swap and control paths ######################
+//
+
+/**
+ * Invoked by the frontswap store and load of the page at start_addr, a data offset,
+ * after its translation. mem_addr is translated again, the placement may have switched before.
+ *
+ * Return true if the store has to mirror the page, fs_migrate_mirror(). The read side of copy_lock is held then.
+ */
+bool fs_migrate_begin(size_t start_addr, struct mem_server_addr *mem_addr, bool store)
+{
+	struct fs_migration *m = &fs_migrations[start_addr >> CHUNK_SHIFT];
+
+	percpu_down_read(&fs_migrate_rwsem);
+	translate_data_addr_to_mem_server_addr(mem_addr, start_addr);
+
+	if (likely(!store || READ_ONCE(m->state) < FS_MIGRATE_COPYING))
+		return false;
+
+	down_read(&m->copy_lock);
+	if (unlikely(m->state < FS_MIGRATE_COPYING)) {
+		up_read(&m->copy_lock); // aborted meanwhile
+		return false;
+	}
+	return true;
+}
+
+void fs_migrate_end(size_t start_addr, bool copying)
+{
+	if (unlikely(copying))
+		up_read(&fs_migrations[start_addr >> CHUNK_SHIFT].copy_lock);
+	percpu_up_read(&fs_migrate_rwsem);
+}
+
+/**
+ * Write the stored page to the target slot too, before the source. A failure gives up the move.
+ */
+void fs_migrate_mirror(size_t start_addr, struct page *page)
+{
+	struct fs_migration *m = &fs_migrations[start_addr >> CHUNK_SHIFT];
+	struct mem_server_addr dst = { .window = m->window,
+				       .mem_server_id = m->target,
+				       .mem_server_chunk_index = m->target_slot + RDMA_META_REGION_NUM,
+				       .mem_server_offset_within_chunk = start_addr & CHUNK_MASK };
+
+	if (unlikely(fs_migrate_page_rw(&dst, page, DMA_TO_DEVICE))) {
+		WRITE_ONCE(m->failed, true);
+		return;
+	}
+	atomic_long_inc(&fs_migrate_mirrored);
+}
+
+/**
+ * Is a data chunk of [start, end) queued or moving ? Not granted for the concurrent compaction then.
+ */
+bool fs_migrate_busy(size_t start, size_t end)
+{
+	size_t chunk;
+
+	if (atomic_read(&fs_migrate_active) == 0)
+		return false;
+
+	for (chunk = start >> CHUNK_SHIFT; chunk < fs_migrate_nr_chunks() && (chunk << CHUNK_SHIFT) < end; chunk++) {
+		if (READ_ONCE(fs_migrations[chunk].state) != FS_MIGRATE_IDLE)
+			return true;
+	}
+	return false;
+}
+
+/**
+ * [start, end) is written on its memory server, not mirrored. By the memory server in the STW window,
+ * or by the control path. The moving data chunks of it are copied again after this GC.
+ */
+void fs_migrate_rewrite(size_t start, size_t end)
+{
+	size_t chunk;
+
+	if (atomic_read(&fs_migrate_active) == 0)
+		return;
+
+	for (chunk = start >> CHUNK_SHIFT; chunk < fs_migrate_nr_chunks() && (chunk << CHUNK_SHIFT) < end; chunk++) {
+		if (READ_ONCE(fs_migrations[chunk].state) >= FS_MIGRATE_COPYING)
+			WRITE_ONCE(fs_migrations[chunk].dirty, true);
+	}
+}
+
+//
+// ###################### debugfs ######################
+//
+
+// Under fs_migrate_lock.
+static void fs_migrate_queue(size_t chunk, int target)
+{
+	struct fs_migration *m = &fs_migrations[chunk];
+
+	m->target = target;
+	m->passes = 0;
+	m->dirty = false;
+	m->failed = false;
+	atomic_inc(&fs_migrate_active);
+	WRITE_ONCE(m->state, FS_MIGRATE_QUEUED);
+}
+
+// The data chunks of the window on each memory server, the queued and moving ones are counted at their targets.
+static void fs_migrate_loads(int window, int *load)
+{
+	size_t chunk;
+	int id;
+
+	memset(load, 0, sizeof(int) * MAX_NUM_OF_MEMORY_SERVER);
+	for (chunk = window * RDMA_DATA_REGION_NUM; chunk < (window + 1) * RDMA_DATA_REGION_NUM; chunk++) {
+		id = READ_ONCE(data_chunk_placement[chunk].mem_server_id);
+		if (id < 0)
+			continue;
+		if (fs_migrations[chunk].state != FS_MIGRATE_IDLE)
+			id = fs_migrations[chunk].target;
+		load[id]++;
+	}
+}
+
+// The least loaded memory server other than exclude with a free slot, -1 if none.
+static int fs_migrate_least_loaded(int *load, int exclude)
+{
+	int i;
+	int target = -1;
+
+	for (i = 0; i < (int)num_mem_servers; i++) {
+		if (i == exclude || load[i] >= (int)data_region_per_mem_server)
+			continue;
+		if (target < 0 || load[i] < load[target])
+			target = i;
+	}
+	return target;
+}
+
+// An idle data chunk of the window placed on mem_server_id, -1 if none.
+static int fs_migrate_pick(int window, int mem_server_id)
+{
+	size_t chunk;
+
+	for (chunk = window * RDMA_DATA_REGION_NUM; chunk < (window + 1) * RDMA_DATA_REGION_NUM; chunk++) {
+		if (fs_migrations[chunk].state == FS_MIGRATE_IDLE &&
+		    READ_ONCE(data_chunk_placement[chunk].mem_server_id) == mem_server_id)
+			return (int)chunk;
+	}
+	return -1;
+}
+
+/**
+ * Queue the moves of a command, under fs_migrate_lock. Return the number of data chunks queued.
+ */
+static int fs_migrate_command(const char *verb, long chunk, long server)
+{
+	int load[MAX_NUM_OF_MEMORY_SERVER];
+	int queued = 0;
+	int window;
+	int from, to, c;
+	size_t i;
+
+	if (strcmp(verb, "cancel") == 0) {
+		for (i = 0; i < fs_migrate_nr_chunks(); i++) {
+			if (fs_migrations[i].state == FS_MIGRATE_COPYING)
+				WRITE_ONCE(fs_migrations[i].failed, true); // the worker gives it up
+			else if (fs_migrations[i].state != FS_MIGRATE_IDLE)
+				fs_migrate_abort(i, -ECANCELED);
+		}
+		return 0;
+	}
+
+	if (placement_policy != SEMERU_PLACEMENT_LOAD || replica_mode == SEMERU_REPLICA_MIRROR) {
+		pr_err("%s, only with placement_policy=%d and no replica.\n", __func__, SEMERU_PLACEMENT_LOAD);
+		return -EOPNOTSUPP;
+	}
+
+	if (strcmp(verb, "move") == 0) {
+		if (chunk < 0 || chunk >= fs_migrate_nr_chunks() || server < 0 || server >= num_mem_servers ||
+		    data_chunk_placement[chunk].mem_server_id < 0)
+			return -EINVAL;
+		fs_migrate_loads(fs_migrations[chunk].window, load);
+		if (fs_migrations[chunk].state != FS_MIGRATE_IDLE)
+			return -EBUSY;
+		if (data_chunk_placement[chunk].mem_server_id == server)
+			return 0;
+		if (load[server] >= (int)data_region_per_mem_server)
+			return -ENOSPC;
+		fs_migrate_queue(chunk, (int)server);
+		return 1;
+	}
+
+	if (strcmp(verb, "drain") == 0) {
+		if (server < 0 || server >= num_mem_servers)
+			return -EINVAL;
+		for (window = 0; window < (int)semeru_nr_windows; window++) {
+			fs_migrate_loads(window, load);
+			while ((c = fs_migrate_pick(window, (int)server)) >= 0) {
+				to = fs_migrate_least_loaded(load, (int)server);
+				if (to < 0)
+					return queued ? queued : -ENOSPC;
+				fs_migrate_queue(c, to);
+				load[server]--;
+				load[to]++;
+				queued++;
+			}
+		}
+		return queued;
+	}
+
+	if (strcmp(verb, "rebalance") == 0) {
+		for (window = 0; window < (int)semeru_nr_windows; window++) {
+			fs_migrate_loads(window, load);
+			for (;;) {
+				from = 0;
+				for (i = 1; i < num_mem_servers; i++) {
+					if (load[i] > load[from])
+						from = (int)i;
+				}
+				to = fs_migrate_least_loaded(load, from);
+				if (to < 0 || load[from] - load[to] <= 1)
+					break;
+				c = fs_migrate_pick(window, from);
+				if (c < 0)
+					break; // all of them are moving already
+				fs_migrate_queue(c, to);
+				load[from]--;
+				load[to]++;
+				queued++;
+			}
+		}
+		return queued;
+	}
+
+	return -EINVAL;
+}
+
+static ssize_t fs_migrate_write(struct file *file, const char __user *ubuf, size_t count, loff_t *ppos)
+{
+	char *buf, *cur, *token, *value;
+	const char *verb = NULL;
+	long chunk = -1;
+	long server = -1;
+	int ret = 0;
+
+	if (count > PAGE_SIZE)
+		return -EINVAL;
+
+	buf = memdup_user_nul(ubuf, count);
+	if (IS_ERR(buf))
+		return PTR_ERR(buf);
+
+	cur = buf;
+	while (ret == 0 && (token = strsep(&cur, " \t\n")) != NULL) {
+		if (*token == '\0')
+			continue;
+
+		value = strchr(token, '=');
+		if (value == NULL) {
+			if (verb != NULL)
+				ret = -EINVAL;
+			verb = token;
+			continue;
+		}
+		*value++ = '\0';
+
+		if (strcmp(token, "chunk") == 0)
+			ret = kstrtol(value, 0, &chunk);
+		else if (strcmp(token, "server") == 0)
+			ret = kstrtol(value, 0, &server);
+		else
+			ret = -EINVAL;
+	}
+
+	if (ret == 0 && verb == NULL)
+		ret = -EINVAL;
+	if (ret == 0) {
+		mutex_lock(&fs_migrate_lock);
+		ret = READ_ONCE(fs_migrate_stopping) ? -ESHUTDOWN : fs_migrate_command(verb, chunk, server);
+		mutex_unlock(&fs_migrate_lock);
+		if (ret > 0)
+			pr_info("%s, %s queued %d data chunks, moved from the next GC pause of the JVM.\n", __func__, verb,
+				ret);
+	}
+	kfree(buf);
+
+	return ret < 0 ? ret : count;
+}
+
+/**
+ * # moved aborted copied_pages mirrored_stores epoch
+ * # chunk server slot state target passes dirty
+ */
+static int fs_migrate_show(struct seq_file *m, void *v)
+{
+	struct fs_migration *mig;
+	size_t chunk;
+
+	seq_puts(m, "# moved aborted copied_pages mirrored_stores epoch\n");
+	seq_printf(m, "%ld %ld %ld %ld %d\n", atomic_long_read(&fs_migrate_moved), atomic_long_read(&fs_migrate_aborted),
+		   atomic_long_read(&fs_migrate_copied_pages), atomic_long_read(&fs_migrate_mirrored),
+		   data_chunk_placement_epoch_read());
+
+	seq_puts(m, "# chunk server slot state target passes dirty\n");
+	mutex_lock(&fs_migrate_lock);
+	for (chunk = 0; chunk < fs_migrate_nr_chunks(); chunk++) {
+		mig = &fs_migrations[chunk];
+		if (data_chunk_placement[chunk].mem_server_id < 0)
+			continue;
+		seq_printf(m, "%lu %d %d %s", chunk, data_chunk_placement[chunk].mem_server_id,
+			   data_chunk_placement[chunk].chunk_index, fs_migrate_state_name[mig->state]);
+		if (mig->state != FS_MIGRATE_IDLE)
+			seq_printf(m, " %d %d %d", mig->target, mig->passes, mig->dirty);
+		seq_putc(m, '\n');
+	}
+	mutex_unlock(&fs_migrate_lock);
+
+	return 0;
+}
+
+static int fs_migrate_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, fs_migrate_show, NULL);
+}
+
+static const struct file_operations fs_migrate_fops = {
+	.owner = THIS_MODULE,
+	.open = fs_migrate_open,
+	.read = seq_read,
+	.write = fs_migrate_write,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+//
+// ###################### Init and exit ######################
+//
+
+/**
+ * Invoked after the frontswap path is enabled, the file goes to the debugfs directory of the latency histograms.
+ */
+int init_fs_migrate(void)
+{
+	size_t chunk;
+
+	for (chunk = 0; chunk < fs_migrate_nr_chunks(); chunk++) {
+		fs_migrations[chunk].state = FS_MIGRATE_IDLE;
+		fs_migrations[chunk].window = (int)(chunk / RDMA_DATA_REGION_NUM);
+		init_rwsem(&fs_migrations[chunk].copy_lock);
+	}
+	atomic_long_set(&fs_migrate_moved, 0);
+	atomic_long_set(&fs_migrate_aborted, 0);
+	atomic_long_set(&fs_migrate_copied_pages, 0);
+	atomic_long_set(&fs_migrate_mirrored, 0);
+	WRITE_ONCE(fs_migrate_stopping, 0);
+
+	fs_migrate_wq = alloc_ordered_workqueue("semeru_migrate", WQ_MEM_RECLAIM);
+	if (fs_migrate_wq == NULL)
+		return -ENOMEM;
+
+	if (fs_lat_debugfs_dir != NULL)
+		debugfs_create_file("migrate", 0600, fs_lat_debugfs_dir, NULL, &fs_migrate_fops);
+
+	return 0;
+}
+
+/**
+ * Invoked at rmmod, before the memory servers are disconnected. The copy in progress is given up.
+ */
+void exit_fs_migrate(void)
+{
+	size_t chunk;
+
+	WRITE_ONCE(fs_migrate_stopping, 1);
+	if (fs_migrate_wq != NULL) {
+		destroy_workqueue(fs_migrate_wq); // waits for the copy pass
+		fs_migrate_wq = NULL;
+	}
+
+	mutex_lock(&fs_migrate_lock);
+	for (chunk = 0; chunk < fs_migrate_nr_chunks(); chunk++) {
+		if (fs_migrations[chunk].state != FS_MIGRATE_IDLE)
+			fs_migrate_abort(chunk, -ESHUTDOWN);
+	}
+	mutex_unlock(&fs_migrate_lock);
+
+	pr_warn("%s, data chunks moved %ld, aborted %ld, pages copied %ld, stores mirrored %ld\n", __func__,
+		atomic_long_read(&fs_migrate_moved), atomic_long_read(&fs_migrate_aborted),
+		atomic_long_read(&fs_migrate_copied_pages), atomic_long_read(&fs_migrate_mirrored));
+}
+
+#endif // SEMERU_CHUNK_MIGRATION
@@ -12,6 +12,9 @@
 #include "frontswap_path.h"
 #include "local_dram.h"
 #include "semeru_cpu.h"
+#include "semeru_trace.h"
+
+#include <linux/swapops.h>
 
 
 
@@ -28,7 +31,21 @@
 void drain_rdma_queue(struct semeru_rdma_queue *rdma_queue)
 {
 	unsigned long flags;
-
+	u64 lat_start;
+
+	if (atomic_read(&rdma_queue->rdma_post_counter) <= 0)
+		return;
+
+	lat_start = fs_lat_start();
+#ifdef SEMERU_CQ_POLLER
+	// Only the back pressure and the flushes get here. Wait for the poller, off its cq_lock.
+	if (fs_cq_pollers_on()) {
+		fs_cq_poller_kick(rdma_queue);
+		while (atomic_read(&rdma_queue->rdma_post_counter) > 0 && fs_cq_pollers_on() &&
+		       READ_ONCE(rdma_queue->freed) == 0)
+			cpu_relax();
+	}
+#endif
 	while (atomic_read(&rdma_queue->rdma_post_counter) > 0) {
 		spin_lock_irqsave(&rdma_queue->cq_lock, flags);
 		//  default, IB_POLL_BATCH is 16. return when cqe reaches min(16, IB_POLL_BATCH) or CQ is empty.
@@ -36,25 +53,201 @@ void drain_rdma_queue(struct semeru_rdma_queue *rdma_queue)
 		spin_unlock_irqrestore(&rdma_queue->cq_lock, flags); // [?] Is the spin lock necessary ?
 		cpu_relax(); // insert PAUSE, good for HT cores
 	}
+	fs_lat_record(FS_LAT_CQ_DRAIN, rdma_queue->rdma_session->mem_server_id, lat_start);
 
 	return;
 }
 
+#ifdef SEMERU_ADAPTIVE_POLLING
+
+void init_rdma_queue_polling(struct semeru_rdma_queue *rdma_queue)
+{
+	init_waitqueue_head(&rdma_queue->cq_wait);
+	atomic_set(&rdma_queue->cq_event, 0);
+	rdma_queue->avg_wait_ns = CQ_SPIN_MIN_NS;
+	atomic64_set(&rdma_queue->spin_ns, 0);
+	atomic_set(&rdma_queue->spin_done, 0);
+	atomic_set(&rdma_queue->irq_wakeups, 0);
+}
+
+/**
+ * The CQ interrupt handler, replaces the default one of IB_POLL_DIRECT CQ.
+ * Only wake up the sleepers, the CQE are processed by themselves.
+ * Invoked in interrupt context.
+ */
+void semeru_cq_comp_handler(struct ib_cq *cq, void *cq_context)
+{
+	struct semeru_rdma_queue *rdma_queue = cq_context;
+
+	atomic_set(&rdma_queue->cq_event, 1);
+	wake_up(&rdma_queue->cq_wait);
+
+	// The waiter of memory server state polls this CQ too.
+	if (rdma_queue->q_index == MEM_SERVER_NOTIFY_QUEUE && rdma_queue->rdma_session->notify.enabled)
+		wake_up(&rdma_queue->rdma_session->notify.wait);
+}
+
+static inline void poll_rdma_queue_once(struct semeru_rdma_queue *rdma_queue)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&rdma_queue->cq_lock, flags);
+	ib_process_cq_direct(rdma_queue->cq, 16);
+	spin_unlock_irqrestore(&rdma_queue->cq_lock, flags);
+}
+
+/**
+ * Wait for the finish of ALL the outstanding rdma_request, hybrid version of drain_rdma_queue().
+ * 
+ * 1) Spin on the CQ within the budget, most of the 4KB RDMA requests finish here.
+ * 2) Arm the CQ and sleep until the completion interrupt.
+ * 
+ * Warning : may sleep, can't be invoked with preemption disabled.
+ */
+void wait_rdma_queue(struct semeru_rdma_queue *rdma_queue)
+{
+	u64 start;
+	u64 now;
+	u64 budget;
+	u64 avg;
+	bool slept = false;
+
+	if (atomic_read(&rdma_queue->rdma_post_counter) <= 0)
+		return;
+
+#ifdef SEMERU_CQ_POLLER
+	if (fs_cq_pollers_on()) {
+		fs_cq_poller_wait(rdma_queue);
+		return;
+	}
+#endif
+
+	avg = READ_ONCE(rdma_queue->avg_wait_ns);
+	budget = clamp_t(u64, avg * CQ_SPIN_FACTOR, CQ_SPIN_MIN_NS, CQ_SPIN_MAX_NS);
+	start = ktime_get_ns();
+	now = start;
+
+	// 1) spin
+	while (atomic_read(&rdma_queue->rdma_post_counter) > 0) {
+		poll_rdma_queue_once(rdma_queue);
+		now = ktime_get_ns();
+		if (now - start >= budget)
+			break;
+		cpu_relax(); // insert PAUSE, good for HT cores
+	}
+	atomic64_add(now - start, &rdma_queue->spin_ns);
+
+	// 2) sleep
+	while (atomic_read(&rdma_queue->rdma_post_counter) > 0) {
+		atomic_set(&rdma_queue->cq_event, 0);
+
+		// Positive return value means some CQE arrived before arming, poll them directly.
+		if (ib_req_notify_cq(rdma_queue->cq, IB_CQ_NEXT_COMP | IB_CQ_REPORT_MISSED_EVENTS) == 0) {
+			wait_event_timeout(rdma_queue->cq_wait,
+					   atomic_read(&rdma_queue->cq_event) ||
+						   atomic_read(&rdma_queue->rdma_post_counter) <= 0,
+					   msecs_to_jiffies(CQ_SLEEP_TIMEOUT_MS));
+			slept = true;
+		}
+
+		poll_rdma_queue_once(rdma_queue);
+	}
+
+	if (slept)
+		atomic_inc(&rdma_queue->irq_wakeups);
+	else
+		atomic_inc(&rdma_queue->spin_done);
+
+	// 3) EWMA of the completion latency
+	now = ktime_get_ns();
+	WRITE_ONCE(rdma_queue->avg_wait_ns, avg - (avg >> CQ_EWMA_SHIFT) + ((now - start) >> CQ_EWMA_SHIFT));
+	fs_lat_record(FS_LAT_CQ_DRAIN, rdma_queue->rdma_session->mem_server_id, start);
+}
+
+void print_rdma_queue_polling_stats(struct semeru_rdma_queue *rdma_queue)
+{
+	pr_info("%s, rdma_queue[%d] avg latency %llu ns, spin %lld ns, spin done %d, interrupt wakeups %d\n", __func__,
+		rdma_queue->q_index, READ_ONCE(rdma_queue->avg_wait_ns), atomic64_read(&rdma_queue->spin_ns),
+		atomic_read(&rdma_queue->spin_done), atomic_read(&rdma_queue->irq_wakeups));
+}
+
+#endif // end of SEMERU_ADAPTIVE_POLLING
+
 /**
- * Drain all the outstanding messages for a specific memory server.
+ * Drain all the outstanding messages of a session, one memory server for one address window.
  * [?] TO BE DONE. Multiple memory server 
  * 
  */
-void drain_all_rdma_queue(int target_mem_server)
+void drain_all_rdma_queue(struct rdma_session_context *rdma_session)
 {
 	int i;
-	struct rdma_session_context *rdma_session = &rdma_session_global_ptr[target_mem_server];
 
 	for (i = 0; i < online_cores; i++) {
+#ifdef SEMERU_FS_ASYNC_STORE
+		// Post the staged stores first, or the memory server misses them.
+		fs_flush_store_ring(&(rdma_session->rdma_queues[i]));
+#endif
 		drain_rdma_queue(&(rdma_session->rdma_queues[i]));
 	}
 }
 
+//
+// Credit-based flow control
+//
+
+void fs_credit_init(struct rdma_session_context *rdma_session)
+{
+	atomic64_set(&rdma_session->credit_bytes, (long)mem_server_credit_mb << 20);
+	atomic_set(&rdma_session->credit_stalls, 0);
+	atomic_set(&rdma_session->demand_loads, 0);
+	atomic_set(&rdma_session->cp_yields, 0);
+}
+
+bool fs_credit_low(struct rdma_session_context *rdma_session)
+{
+	return mem_server_credit_mb != 0 &&
+	       atomic64_read(&rdma_session->credit_bytes) < ((long)mem_server_credit_mb << 20) >> FS_CREDIT_LOW_SHIFT;
+}
+
+/**
+ * Take the credit of a store to the memory server, wait if it's used up.
+ * 
+ * The caller's bytes are taken first. While the balance is negative, post the staged stores of the server
+ * and reap its queues one by one, spinning then sleeping on the CQ, until the acked writes cover them.
+ * 
+ * Warning : may sleep, can't be invoked with preemption disabled.
+ */
+void fs_credit_get(struct rdma_session_context *rdma_session, long bytes)
+{
+	int i;
+	unsigned long deadline;
+	struct semeru_rdma_queue *rdma_queue;
+
+	if (mem_server_credit_mb == 0)
+		return;
+
+	if (likely(atomic64_sub_return(bytes, &rdma_session->credit_bytes) >= 0))
+		return;
+
+	atomic_inc(&rdma_session->credit_stalls);
+	deadline = jiffies + msecs_to_jiffies(FS_CREDIT_THROTTLE_MS);
+	while (atomic64_read(&rdma_session->credit_bytes) < 0) {
+		for (i = 0; i < online_cores && atomic64_read(&rdma_session->credit_bytes) < 0; i++) {
+			rdma_queue = &(rdma_session->rdma_queues[i]);
+#ifdef SEMERU_FS_ASYNC_STORE
+			fs_flush_store_ring(rdma_queue);
+#endif
+			wait_rdma_queue(rdma_queue);
+		}
+
+		if (time_after(jiffies, deadline)) {
+			pr_warn_ratelimited("%s, memory server[%d] acked no write for %d ms, overdraw the credit.\n",
+					    __func__, rdma_session->mem_server_id, FS_CREDIT_THROTTLE_MS);
+			break;
+		}
+	}
+}
+
 /**
  * The function to process rdma write done.
  * 
@@ -63,12 +256,13 @@ void fs_rdma_write_done(struct ib_cq *cq, struct ib_wc *wc){
 	// get the instance start address of fs_rdma_req, whose filed, fs_rdma_req->cqe is pointed by wc->wr_cqe
 	struct fs_rdma_req *rdma_req = container_of(wc->wr_cqe, struct fs_rdma_req, cqe);  
 	struct semeru_rdma_queue *rdma_queue = cq->cq_context;
-	struct ib_device *ibdev = rdma_queue->rdma_session->rdma_dev->dev;
 
+	trace_semeru_rdma_cqe(rdma_queue->rdma_session->mem_server_id, rdma_queue->q_index, SEMERU_WR_FS_WRITE,
+			      wc->status, wc->byte_len);
 	if (unlikely(wc->status != IB_WC_SUCCESS)) {
 		pr_err("%s status is not success, it is=%d\n", __func__, wc->status);
 	}
-	ib_dma_unmap_page(ibdev, rdma_req->dma_addr, PAGE_SIZE, DMA_TO_DEVICE);
+	fs_rdma_req_unmap(rdma_queue, rdma_req, DMA_TO_DEVICE);
 
 	atomic_dec(&rdma_queue->rdma_post_counter); // decrease outstanding rdma request counter
 	complete(&rdma_req->done);  // inform caller, write is done. is this necessary for a write?
@@ -80,12 +274,13 @@ void fs_rdma_read_done(struct ib_cq *cq, struct ib_wc *wc){
 	// get the instance start address of fs_rdma_req, whose filed, fs_rdma_req->cqe is pointed by wc->wr_cqe
 	struct fs_rdma_req *rdma_req = container_of(wc->wr_cqe, struct fs_rdma_req, cqe);  
 	struct semeru_rdma_queue *rdma_queue = cq->cq_context;
-	struct ib_device *ibdev = rdma_queue->rdma_session->rdma_dev->dev;
 
+	trace_semeru_rdma_cqe(rdma_queue->rdma_session->mem_server_id, rdma_queue->q_index, SEMERU_WR_FS_READ,
+			      wc->status, wc->byte_len);
 	if (unlikely(wc->status != IB_WC_SUCCESS)) {
 		pr_err("%s status is not success, it is=%d\n", __func__, wc->status);
 	}
-	ib_dma_unmap_page(ibdev, rdma_req->dma_addr, PAGE_SIZE, DMA_FROM_DEVICE);
+	fs_rdma_req_unmap(rdma_queue, rdma_req, DMA_FROM_DEVICE); // copied out of the bounce page
 
 
 	atomic_dec(&rdma_queue->rdma_post_counter); // decrease outstanding rdma request counter
@@ -116,30 +311,32 @@ void fs_rdma_read_done(struct ib_cq *cq, struct ib_wc *wc){
  *	init_attr.cap.max_recv_wr
  * 
  */
-int fs_enqueue_send_wr(struct rdma_session_context *rdma_session, struct semeru_rdma_queue *rdma_queue,
-		       struct fs_rdma_req *rdma_req)
+int fs_enqueue_wr(struct semeru_rdma_queue *rdma_queue, struct ib_send_wr *wr)
 {
 	int ret = 0;
 	const struct ib_send_wr *bad_wr;
 	int test;
 
-	rdma_req->rdma_queue = rdma_queue; // points to the rdma_queue to be enqueued.
-
 	// Post 1-sided RDMA read wr
 	// wait and enqueue wr
 	// Both 1-sided read/write queue depth are RDMA_SEND_QUEUE_DEPTH
 	while (1) {
 		test = atomic_inc_return(&rdma_queue->rdma_post_counter);
-		if (test < RDMA_SEND_QUEUE_DEPTH - 16) {
+		if (test < RDMA_POST_LIMIT(rdma_queue->rdma_session)) {
 			//post the 1-sided RDMA write
 			// Use the global RDMA context, rdma_session_global
-			ret = ib_post_send(rdma_queue->qp, (struct ib_send_wr *)&rdma_req->rdma_wr, &bad_wr);
+			ret = ib_post_send(rdma_queue->qp, wr, &bad_wr);
 			if (unlikely(ret)) {
 				printk(KERN_ERR "%s, post 1-sided RDMA send wr failed, return value :%d. counter %d \n",
 				       __func__, ret, test);
+				atomic_dec(&rdma_queue->rdma_post_counter);
 				ret = -1;
 				goto err;
 			}
+			trace_semeru_rdma_post(rdma_queue->rdma_session->mem_server_id, rdma_queue->q_index, 1, test);
+#ifdef SEMERU_CQ_POLLER
+			fs_cq_poller_kick(rdma_queue);
+#endif
 
 			// Enqueue successfully.
 			// exit loop.
@@ -161,6 +358,14 @@ err:
 	return -1;
 }
 
+int fs_enqueue_send_wr(struct rdma_session_context *rdma_session, struct semeru_rdma_queue *rdma_queue,
+		       struct fs_rdma_req *rdma_req)
+{
+	rdma_req->rdma_queue = rdma_queue; // points to the rdma_queue to be enqueued.
+
+	return fs_enqueue_wr(rdma_queue, (struct ib_send_wr *)&rdma_req->rdma_wr);
+}
+
 /**
  * Build a rdma_wr for frontswap data path.
  *  
@@ -179,11 +384,20 @@ int dp_build_fs_rdma_wr(struct rdma_session_context *rdma_session, struct semeru
 	rdma_req->page = page;
 	init_completion( &(rdma_req->done) );
 
+#ifdef SEMERU_FS_DMA_BOUNCE
+	// Or copy it through a bounce page mapped already, no IOMMU map/unmap.
+	rdma_req->bounce = fs_dma_bounce_get(rdma_queue);
+	if (rdma_req->bounce != NULL) {
+		if (dir == DMA_TO_DEVICE)
+			copy_highpage(rdma_req->bounce->page, page);
+		rdma_req->dma_addr = rdma_req->bounce->dma_addr;
+	} else
+#endif
 	rdma_req->dma_addr = ib_dma_map_page(dev, page, 0, PAGE_SIZE, dir);
 	if ( unlikely(ib_dma_mapping_error(dev, rdma_req->dma_addr)) ){
 		pr_err("%s, ib_dma_mapping_error\n",__func__);
 		ret = -ENOMEM;
-		kmem_cache_free(rdma_queue->fs_rdma_req_cache, rdma_req);
+		fs_rdma_req_put(rdma_queue, rdma_req);
 		goto out;
 	}
 
@@ -250,6 +464,7 @@ int semeru_fs_rdma_send(struct rdma_session_context *rdma_session, struct semeru
 	ret = fs_enqueue_send_wr(rdma_session, rdma_queue, rdma_req);
 	if(unlikely(ret)){
 		pr_err("%s, enqueue rdma_wr failed.\n",__func__);
+		fs_rdma_req_unmap(rdma_queue, rdma_req, dir);
 		goto out;
 	}
 
@@ -264,81 +479,1691 @@ out:
 
 
 
+#ifdef SEMERU_FS_ASYNC_STORE
+
 //
-// ############################ Start of Fronswap operations definition ############################
+// ############################ Asynchronous frontswap store ############################
 //
 
 /**
- * @brief Get the memory server id. 
- * 	The memory server id is decided by the chunk index.
- * 	The mapping is defined in include/linux/swap_global_struct.h
- * 
- * 	Warning : alreays reserve the first chunk in each memory server.
+ * The data pages staged into a batch and not acked yet, 1 bit per data page.
+ * Set when the page is appended to a batch, cleared by the batch when it is released.
+ * The swap cache page can't carry the state, a page flag in use makes reclaim treat it as a page with fs private data.
+ */
+static unsigned long *fs_store_inflight_map = NULL;
+static size_t fs_store_inflight_pages; // number of bits
+
+static int init_fs_store_inflight(void)
+{
+	fs_store_inflight_pages = semeru_data_space_size() >> PAGE_SHIFT;
+	fs_store_inflight_map = vzalloc(BITS_TO_LONGS(fs_store_inflight_pages) * sizeof(unsigned long));
+	if (unlikely(fs_store_inflight_map == NULL)) {
+		pr_err("%s, allocate the in-flight store map of 0x%lx pages failed.\n", __func__, fs_store_inflight_pages);
+		return -ENOMEM;
+	}
+	return 0;
+}
+
+/**
+ * Invoked after the memory servers are disconnected, no batch is released any more.
+ */
+static void free_fs_store_inflight(void)
+{
+	vfree(fs_store_inflight_map);
+	fs_store_inflight_map = NULL;
+}
+
+/**
+ * Process the available CQEs without waiting for the outstanding ones.
+ * Used to release the acked store batches.
+ */
+static void fs_reap_rdma_queue(struct semeru_rdma_queue *rdma_queue)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&rdma_queue->cq_lock, flags);
+	ib_process_cq_direct(rdma_queue->cq, 16);
+	spin_unlock_irqrestore(&rdma_queue->cq_lock, flags);
+}
+
+/**
+ * Unmap and release all the pages of a batch.
+ *
+ * The stores of a batch that isn't written were already reported as done to frontswap.
+ * Their pages are still in swap cache, pinned by the batch, redirty them so that reclaim stores them again
+ * instead of dropping the only up-to-date copy.
+ */
+static void fs_release_store_batch(struct semeru_rdma_queue *rdma_queue, struct fs_rdma_batch_req *batch, bool written)
+{
+	struct ib_device *ibdev = rdma_queue->rdma_session->rdma_dev->dev;
+	int i;
+
+#ifdef SEMERU_FS_ZERO_PAGE
+	if (unlikely(!written))
+		fs_zero_forget_range(batch->start_data_page, batch->start_data_page + batch->nr_pages);
+#endif
+
+	for (i = 0; i < batch->nr_pages; i++) {
+		ib_dma_unmap_page(ibdev, batch->dma_addr[i], PAGE_SIZE, DMA_TO_DEVICE);
+#ifdef SEMERU_FS_PREFETCH
+		// Drop the prefetched copy read before this write landed.
+		fs_prefetch_invalidate(batch->start_data_page + i);
+#endif
+		if (unlikely(!written))
+			set_page_dirty(batch->pages[i]);
+		clear_bit(batch->start_data_page + i, fs_store_inflight_map); // the page can be stored again.
+		put_page(batch->pages[i]); // drop the reference got at staging.
+	}
+	fs_credit_put(rdma_queue->rdma_session, (long)batch->nr_pages << PAGE_SHIFT);
+	batch->nr_pages = 0;
+}
+
+/**
+ * The CQ callback of an asynchronous store batch.
+ * Release all the pages of the batch, then return the slot to the ring.
  * 
- * @return int , the id of memory server.
+ * Invoked with rdma_queue->cq_lock held, never acquire store_ring->lock here.
+ */
+void fs_rdma_batch_write_done(struct ib_cq *cq, struct ib_wc *wc)
+{
+	struct fs_rdma_batch_req *batch = container_of(wc->wr_cqe, struct fs_rdma_batch_req, cqe);
+	struct semeru_rdma_queue *rdma_queue = cq->cq_context;
+	struct fs_store_ring *ring = rdma_queue->store_ring;
+
+	trace_semeru_rdma_cqe(rdma_queue->rdma_session->mem_server_id, rdma_queue->q_index, SEMERU_WR_FS_BATCH_WRITE,
+			      wc->status, wc->byte_len);
+	if (unlikely(wc->status != IB_WC_SUCCESS)) {
+		pr_err("%s, rdma_queue[%d] status is not success, it is=%d, %d pages redirtied\n", __func__,
+		       rdma_queue->q_index, wc->status, batch->nr_pages);
+	}
+
+	fs_release_store_batch(rdma_queue, batch, wc->status == IB_WC_SUCCESS);
+
+	// 1-sided RDMA wr on one QP are acked in order, the acked batch is ring->reqs[head].
+	smp_store_release(&ring->head, ring->head + 1);
+	atomic_dec(&rdma_queue->rdma_post_counter); // decrease outstanding rdma request counter
+}
+
+/**
+ * Post the open batch of the ring.
+ * Caller must hold ring->lock.
  */
-static inline int get_memory_server_id(size_t chunk_index)
+static int fs_post_store_batch(struct semeru_rdma_queue *rdma_queue)
 {
-	return (int)(chunk_index/DATA_REGION_PER_MEM_SERVER);
+	int ret = 0;
+	struct fs_store_ring *ring = rdma_queue->store_ring;
+	struct fs_rdma_batch_req *batch;
+
+	if (!ring->batch_open)
+		goto out;
+
+	batch = &ring->reqs[ring->tail & (FS_STORE_RING_DEPTH - 1)];
+	batch->rdma_wr.wr.num_sge = batch->nr_sge;
+	ring->batch_open = false;
+
+	ret = fs_enqueue_wr(rdma_queue, (struct ib_send_wr *)&batch->rdma_wr);
+	if (unlikely(ret)) {
+		// The QP is broken. Release the pages to not pin them forever.
+		pr_err("%s, rdma_queue[%d] post store batch of %d pages failed.\n", __func__, rdma_queue->q_index,
+		       batch->nr_pages);
+		fs_release_store_batch(rdma_queue, batch, false);
+		goto out;
+	}
+
+	ring->tail++; // the batch is on the fly now.
+
+out:
+	return ret;
 }
 
+/**
+ * Post the staged stores of a rdma_queue.
+ * Invoked before draining a rdma_queue, e.g. the signal write of control path.
+ */
+void fs_flush_store_ring(struct semeru_rdma_queue *rdma_queue)
+{
+	unsigned long flags;
+	struct fs_store_ring *ring = rdma_queue->store_ring;
+
+	if (ring == NULL)
+		return;
+
+	spin_lock_irqsave(&ring->lock, flags);
+	fs_post_store_batch(rdma_queue);
+	spin_unlock_irqrestore(&ring->lock, flags);
+}
 
 /**
- * @brief Translate the CPU serve virtual address to memory server virtual address.
- * 	1) Reserve the first region for each memory server as meta region. 
- * 	Never write any data to meta region via data path.
- * 	2) This function is only used by both Data path and Control path.
- * 	3) This function is only used for data region area.
+ * Deferred flush,
+ * 1) post the partial batch, if no more pages were appended within FS_STORE_FLUSH_DELAY_US.
+ * 2) reap the completions, until all the staged pages are released.
+ * 	The data path CQ is IB_POLL_DIRECT, nobody else polls it when the swap out stops. 
+ */
+static void fs_store_ring_flush_work(struct work_struct *work)
+{
+	struct fs_store_ring *ring = container_of(to_delayed_work(work), struct fs_store_ring, flush_work);
+	struct semeru_rdma_queue *rdma_queue = (struct semeru_rdma_queue *)ring->reqs[0].rdma_wr.wr.wr_id;
+
+	fs_flush_store_ring(rdma_queue);
+	fs_reap_rdma_queue(rdma_queue);
+
+	if (READ_ONCE(ring->head) != READ_ONCE(ring->tail))
+		schedule_delayed_work(&ring->flush_work, usecs_to_jiffies(FS_STORE_FLUSH_DELAY_US));
+}
+
+int init_fs_store_ring(struct semeru_rdma_queue *rdma_queue)
+{
+	int i;
+	struct fs_store_ring *ring;
+	struct fs_rdma_batch_req *batch;
+
+	// The ring is written by the core of the queue, keep it on the node of that core.
+	ring = vzalloc_node(sizeof(struct fs_store_ring), cpu_to_node(rdma_queue->q_index));
+	if (unlikely(ring == NULL)) {
+		pr_err("%s, rdma_queue[%d] allocate store ring failed.\n", __func__, rdma_queue->q_index);
+		return -ENOMEM;
+	}
+
+	spin_lock_init(&ring->lock);
+	ring->head = 0;
+	ring->tail = 0;
+	ring->batch_open = false;
+	INIT_DELAYED_WORK(&ring->flush_work, fs_store_ring_flush_work);
+
+	// The static fields of the batch wr.
+	for (i = 0; i < FS_STORE_RING_DEPTH; i++) {
+		batch = &ring->reqs[i];
+		batch->cqe.done = fs_rdma_batch_write_done;
+		batch->rdma_wr.wr.next = NULL;
+		batch->rdma_wr.wr.wr_cqe = &batch->cqe;
+		batch->rdma_wr.wr.wr_id = (u64)rdma_queue; // the flush worker uses it to find the rdma_queue
+		batch->rdma_wr.wr.sg_list = batch->sge_list;
+		batch->rdma_wr.wr.opcode = IB_WR_RDMA_WRITE;
+		batch->rdma_wr.wr.send_flags = IB_SEND_SIGNALED;
+	}
+
+	rdma_queue->store_ring = ring;
+	return 0;
+}
+
+void free_fs_store_ring(struct semeru_rdma_queue *rdma_queue)
+{
+	if (rdma_queue->store_ring == NULL)
+		return;
+
+	cancel_delayed_work_sync(&rdma_queue->store_ring->flush_work);
+	vfree(rdma_queue->store_ring);
+	rdma_queue->store_ring = NULL;
+}
+
+/**
+ * Can the page, mapped at dma_addr, extend the last sge of the batch ?
+ */
+static inline bool fs_batch_can_merge(struct fs_rdma_batch_req *batch, u64 dma_addr)
+{
+#ifdef SEMERU_FS_STORE_EXTENT
+	struct ib_sge *last_sge;
+
+	if (batch->nr_sge == 0)
+		return false;
+
+	last_sge = &batch->sge_list[batch->nr_sge - 1];
+	return last_sge->addr + last_sge->length == dma_addr;
+#else
+	return false;
+#endif
+}
+
+/**
+ * Stage a page into the store ring of current core.
  * 
- * Examples of Memory region
- * 	// | -- Meta Region -- | -- Data Regsons --|
+ * 1) Append the page to the open batch, if its remote address follows the batch.
+ * 2) Or post the open batch and start a new one.
+ * 3) A full batch, or a batch reaching the extent boundary, is posted immediately.
  * 
- * 	There are 2 translation path
- * 	1) via the swap_entry_t, 
- * 	CPU server virtual addr -> swap_entry_t => memory server virtual addr.
- * 	Data on both meta regions and data regions can be swapped out to memory servers.
- * 	In theory, no need to reserve the meta Regions in memory server.
- * 	We skip the meta regions here only to prevent writing irrelevant signals to crash the memory servers.
- * 	
- * 	2) via the  swap_remmaping table,
- * 	CPU server virtual addr -> swap_entry_t -> CPU server_virtual addr => memory server virtual addr.
- * 	Because Only data on data regions can be swapped out. 
- * 	The  swap_remmaping table count start from the first page in Data region.
- * 	So, we also need to add the RDMA_META_REGION_NUM back when calcualting the region index.
+ * The page is written to memory server asynchronously. 
  * 
- * @param mem_addr 
- * @param swap_entry_offset 
+ * return
+ *  0 : success
+ *  non-zero : failed.
  */
-size_t translate_to_mem_server_addr(struct mem_server_addr * mem_addr, pgoff_t swap_entry_offset)
+static int semeru_frontswap_store_async(struct rdma_session_context *rdma_session, struct mem_server_addr *mem_addr,
+					size_t start_addr, struct page *page)
 {
-	
-	// page offset, compared start of Data Region
-	// The real virtual address is RDMA_DATA_SPACE_START_ADDR + start_addr.
-#ifdef ENABLE_SWP_ENTRY_VIRT_REMAPPING
-	// byte address offset to the RDMA_DATA_SPACE_START_ADDR 
-	size_t start_addr = retrieve_swap_remmaping_virt_addr_via_offset(swap_entry_offset) << PAGE_SHIFT; 
-#else
-	// For the default kernel, no need to do the swp_offset -> virt translation
-	size_t start_addr = swap_entry_offset << PAGE_SHIFT;
+	int ret = 0;
+	int cpu;
+	unsigned long flags;
+	struct semeru_rdma_queue *rdma_queue;
+	struct fs_store_ring *ring;
+	struct fs_rdma_batch_req *batch;
+	struct remote_mapping_chunk *remote_chunk_ptr;
+	struct ib_device *ibdev = rdma_session->rdma_dev->dev;
+	u64 dma_addr;
+
+	if (unlikely((start_addr >> PAGE_SHIFT) >= fs_store_inflight_pages))
+		return -EINVAL;
+
+	// 1) The previous write of this data page is still on the fly.
+	// Its wr may be posted to another core's QP, which has no ordering with ours.
+	// Wait for it here, or the old write may overwrite the new data on memory server.
+	// Rare, the page has to be swapped in and dirtied within the write window.
+	if (unlikely(test_bit(start_addr >> PAGE_SHIFT, fs_store_inflight_map))) {
+		drain_all_rdma_queue(rdma_session);
+	}
+
+	// Throttled here when the memory server is slow. Returned by the CQ callback of the batch.
+	fs_credit_get(rdma_session, PAGE_SIZE);
+
+	cpu = get_cpu(); // disable preempt
+	rdma_queue = get_dp_rdma_queue(rdma_session, cpu);
+	ring = rdma_queue->store_ring;
+	remote_chunk_ptr = &(rdma_session->remote_chunk_list.remote_chunk[mem_addr->mem_server_chunk_index]);
+	if (unlikely(remote_chunk_ptr->chunk_state != MAPPED)) {
+		// Released by the JVM, the rkey is invalid. Keep the page in swap cache.
+		pr_err("%s, memory server[%d] chunk[%lu] isn't mapped.\n", __func__, mem_addr->mem_server_id,
+		       mem_addr->mem_server_chunk_index);
+		fs_credit_put(rdma_session, PAGE_SIZE);
+		ret = -EINVAL;
+		goto out;
+	}
+
+	// 2) Map the page as RDMA buffer, it will be unmapped in CQ callback.
+	dma_addr = ib_dma_map_page(ibdev, page, 0, PAGE_SIZE, DMA_TO_DEVICE);
+	if (unlikely(ib_dma_mapping_error(ibdev, dma_addr))) {
+		pr_err("%s, ib_dma_mapping_error\n", __func__);
+		fs_credit_put(rdma_session, PAGE_SIZE);
+		ret = -ENOMEM;
+		goto out;
+	}
+	ib_dma_sync_single_for_device(ibdev, dma_addr, PAGE_SIZE, DMA_TO_DEVICE);
+
+retry:
+	spin_lock_irqsave(&ring->lock, flags);
+
+	// 3) Try to coalesce with the open batch
+	// A failed post redirties the pages of the open batch, and this store fails on the broken QP too.
+	if (ring->batch_open) {
+		batch = &ring->reqs[ring->tail & (FS_STORE_RING_DEPTH - 1)];
+		if (batch->chunk_index != mem_addr->mem_server_chunk_index ||
+		    batch->next_offset_within_chunk != mem_addr->mem_server_offset_within_chunk) {
+			// not contiguous, post it.
+			ret = fs_post_store_batch(rdma_queue);
+		} else if (batch->nr_sge == FS_STORE_BATCH_SGE && !fs_batch_can_merge(batch, dma_addr)) {
+			// fragmented, run out of sge.
+			ret = fs_post_store_batch(rdma_queue);
+		}
+		if (unlikely(ret)) {
+			spin_unlock_irqrestore(&ring->lock, flags);
+			ib_dma_unmap_page(ibdev, dma_addr, PAGE_SIZE, DMA_TO_DEVICE);
+			fs_credit_put(rdma_session, PAGE_SIZE);
+			goto out;
+		}
+	}
+
+	// 4) Open a new batch
+	if (!ring->batch_open) {
+		if (unlikely(ring->tail - smp_load_acquire(&ring->head) >= FS_STORE_RING_DEPTH)) {
+			// Ring is full, wait for the oldest batch.
+			spin_unlock_irqrestore(&ring->lock, flags);
+			drain_rdma_queue(rdma_queue);
+			goto retry;
+		}
+
+		batch = &ring->reqs[ring->tail & (FS_STORE_RING_DEPTH - 1)];
+		batch->nr_pages = 0;
+		batch->nr_sge = 0;
+		batch->chunk_index = mem_addr->mem_server_chunk_index;
+		batch->next_offset_within_chunk = mem_addr->mem_server_offset_within_chunk;
+		batch->start_data_page = start_addr >> PAGE_SHIFT;
+		batch->rdma_wr.remote_addr = remote_chunk_ptr->remote_addr + mem_addr->mem_server_offset_within_chunk;
+		batch->rdma_wr.rkey = remote_chunk_ptr->remote_rkey;
+		ring->batch_open = true;
+	}
+
+	// 5) Append the page
+	// Pin the page until the write is acked. The reference keeps the page in swap cache.
+	get_page(page);
+	set_bit(start_addr >> PAGE_SHIFT, fs_store_inflight_map);
+	batch->pages[batch->nr_pages] = page;
+	batch->dma_addr[batch->nr_pages] = dma_addr;
+	batch->nr_pages++;
+	batch->next_offset_within_chunk += PAGE_SIZE;
+
+	if (fs_batch_can_merge(batch, dma_addr)) {
+		batch->sge_list[batch->nr_sge - 1].length += PAGE_SIZE; // physically contiguous
+	} else {
+		batch->sge_list[batch->nr_sge].addr = dma_addr;
+		batch->sge_list[batch->nr_sge].length = PAGE_SIZE;
+		batch->sge_list[batch->nr_sge].lkey = rdma_session->rdma_dev->pd->local_dma_lkey;
+		batch->nr_sge++;
+	}
+
+	// A batch can't cross the chunk boundary.
+	if (batch->nr_pages == FS_STORE_BATCH_PAGES || batch->next_offset_within_chunk >= remote_chunk_ptr->mapped_size) {
+		ret = fs_post_store_batch(rdma_queue);
+	}
+#ifdef SEMERU_FS_STORE_EXTENT
+	// Or the extent boundary of memory server.
+	else if ((batch->next_offset_within_chunk & (FS_STORE_EXTENT_SIZE - 1)) == 0) {
+		ret = fs_post_store_batch(rdma_queue);
+	}
 #endif
 
-	size_t start_chunk_index = start_addr >> CHUNK_SHIFT; // absolute data chunk index
-	size_t offset_within_chunk = start_addr & CHUNK_MASK;
+	spin_unlock_irqrestore(&ring->lock, flags);
 
-	//debug
-	//pr_warn("%s, for swap_entry 0x%lx , start_addr 0x%lx, start_chunk_index %lu, offset 0x%lx \n",
-	//	__func__, swap_entry_offset, start_addr, start_chunk_index, offset_within_chunk);
+	// 6) Release the acked batches and arm the deferred flush.
+	fs_reap_rdma_queue(rdma_queue);
+	schedule_delayed_work(&ring->flush_work, usecs_to_jiffies(FS_STORE_FLUSH_DELAY_US));
 
-	// Calculate the target memory server
-	mem_addr->mem_server_id = get_memory_server_id(start_chunk_index);
-	// calculate chunk index within the memory server
-	mem_addr->mem_server_chunk_index = start_chunk_index - (mem_addr->mem_server_id * DATA_REGION_PER_MEM_SERVER);
-	// skip the meta regions for both translation paths.
-	mem_addr->mem_server_chunk_index += RDMA_META_REGION_NUM;
-	mem_addr->mem_server_offset_within_chunk = offset_within_chunk;
+#ifdef DEBUG_MODE_DETAIL
+	pr_info("%s, rdma_queue[%d] staged page 0x%lx, chunk[%lu] offset 0x%lx\n", __func__, rdma_queue->q_index,
+		(size_t)page, mem_addr->mem_server_chunk_index, mem_addr->mem_server_offset_within_chunk);
+#endif
 
-	return start_addr; // offset to data space
+out:
+	put_cpu(); // enable preeempt.
+	return ret;
+}
+
+#endif // end of SEMERU_FS_ASYNC_STORE
+
+
+
+
+//
+// ############################ Start of Fronswap operations definition ############################
+//
+
+/**
+ * @brief The placement of each data chunk.
+ * 	The policy is defined in include/linux/swap_global_struct.h, with the runtime num_mem_servers.
+ * 
+ * 	Warning : alreays reserve the first chunk in each memory server.
+ * 	The chunk_index here doesn't count it.
+ *
+ * 	Indexed by the data chunk of the data offset, address window major.
+ * 	Each window is placed on its own sessions, the chunk_index is within the memory server's copy of the window.
+ *
+ * 	The chunk_index is always the data chunk's own index in its window, whatever the policy.
+ * 	The memory server maps its chunk k at heap_start + k * 4GB, and traces the objects there as the Java heap,
+ * 	so any other chunk_index would make it scan the wrong bytes. The policy only picks the memory server,
+ * 	and data_region_per_mem_server caps the number of data chunks each of them holds.
+ */
+struct data_chunk_placement data_chunk_placement[SEMERU_MAX_ADDRESS_WINDOWS * RDMA_DATA_REGION_NUM];
+// number of placed chunks on each memory server, per window
+static int data_chunk_placed[SEMERU_MAX_ADDRESS_WINDOWS][MAX_NUM_OF_MEMORY_SERVER];
+// the data chunks held by each memory server, by chunk_index, per window
+static DECLARE_BITMAP(data_chunk_slot_used[SEMERU_MAX_ADDRESS_WINDOWS][MAX_NUM_OF_MEMORY_SERVER], RDMA_DATA_REGION_NUM);
+static DEFINE_SPINLOCK(data_chunk_placement_lock);
+
+#ifdef SEMERU_CHUNK_MIGRATION
+// A placed data chunk is moved by move_data_chunk(), the translations retry on a torn placement.
+static seqcount_t data_chunk_placement_seq = SEQCNT_ZERO(data_chunk_placement_seq);
+static atomic_t data_chunk_placement_epoch = ATOMIC_INIT(0); // number of the moves
+#endif
+
+void init_data_chunk_placement(void)
+{
+	size_t i;
+	size_t chunk; // within the window
+	size_t window;
+
+	memset(data_chunk_placed, 0, sizeof(data_chunk_placed));
+	memset(data_chunk_slot_used, 0, sizeof(data_chunk_slot_used));
+
+	for (i = 0; i < semeru_nr_windows * RDMA_DATA_REGION_NUM; i++) {
+		window = i / RDMA_DATA_REGION_NUM;
+		chunk = i % RDMA_DATA_REGION_NUM;
+		switch (placement_policy) {
+		case SEMERU_PLACEMENT_INTERLEAVE:
+			data_chunk_placement[i].mem_server_id = (int)(chunk % num_mem_servers);
+			data_chunk_placement[i].chunk_index = (int)chunk;
+			break;
+
+		case SEMERU_PLACEMENT_LOAD:
+			data_chunk_placement[i].mem_server_id = -1;
+			data_chunk_placement[i].chunk_index = -1;
+			break;
+
+		default: // SEMERU_PLACEMENT_RANGE
+			data_chunk_placement[i].mem_server_id = (int)(chunk / data_region_per_mem_server);
+			data_chunk_placement[i].chunk_index = (int)chunk;
+			break;
+		}
+
+		if (data_chunk_placement[i].mem_server_id >= 0) {
+			data_chunk_placed[window][data_chunk_placement[i].mem_server_id]++;
+			set_bit(data_chunk_placement[i].chunk_index,
+				data_chunk_slot_used[window][data_chunk_placement[i].mem_server_id]);
+		}
+	}
+}
+
+/**
+ * Outstanding RDMA requests on all the queues of a session.
+ */
+static int mem_server_outstanding_wr(int window, int mem_server_id)
+{
+	int i;
+	int outstanding = 0;
+	struct rdma_session_context *rdma_session;
+
+	if (unlikely(rdma_session_global_ptr == NULL))
+		return 0;
+
+	rdma_session = fs_session(window, mem_server_id);
+	if (rdma_session->rdma_queues == NULL)
+		return 0;
+
+	for (i = 0; i < online_cores; i++)
+		outstanding += atomic_read(&rdma_session->rdma_queues[i].rdma_post_counter);
+
+	return outstanding;
+}
+
+/**
+ * SEMERU_PLACEMENT_LOAD, place the data chunk on the memory server with the fewest placed chunks.
+ * Break the tie by the credit of the swap out, then by the outstanding RDMA requests.
+ * 
+ * Only invoked once per data chunk, at its first access. The chunks of the other windows don't count.
+ */
+static int place_data_chunk_by_load(size_t data_chunk)
+{
+	unsigned long flags;
+	int window = (int)(data_chunk / RDMA_DATA_REGION_NUM);
+	int *placed = data_chunk_placed[window];
+	int i;
+	int target = -1;
+	int target_outstanding = 0;
+	int outstanding;
+	bool low;
+	bool target_low = false;
+	struct data_chunk_placement *placement = &data_chunk_placement[data_chunk];
+
+	spin_lock_irqsave(&data_chunk_placement_lock, flags);
+
+	if (placement->mem_server_id >= 0) // placed by others
+		goto out;
+
+	for (i = 0; i < num_mem_servers; i++) {
+		if (placed[i] >= data_region_per_mem_server)
+			continue; // full
+
+		outstanding = mem_server_outstanding_wr(window, i);
+		low = rdma_session_global_ptr != NULL && fs_credit_low(fs_session(window, i));
+		if (target < 0 || placed[i] < placed[target] ||
+		    (placed[i] == placed[target] &&
+		     (low < target_low || (low == target_low && outstanding < target_outstanding)))) {
+			target = i;
+			target_outstanding = outstanding;
+			target_low = low;
+		}
+	}
+
+	// never happens, the memory servers back all the data chunks.
+	BUG_ON(target < 0);
+
+	// Identity, see data_chunk_placement.
+	placement->chunk_index = (int)(data_chunk % RDMA_DATA_REGION_NUM);
+	set_bit(placement->chunk_index, data_chunk_slot_used[window][target]);
+	placed[target]++;
+	smp_wmb(); // chunk_index is read after mem_server_id without lock
+	WRITE_ONCE(placement->mem_server_id, target);
+
+#if defined(DEBUG_MODE_BRIEF) || defined(DEBUG_MODE_DETAIL)
+	printk(KERN_INFO "%s, place data chunk[%lu] on memory server[%d] chunk[%d] \n", __func__, data_chunk, target,
+	       placement->chunk_index);
+#endif
+
+out:
+	spin_unlock_irqrestore(&data_chunk_placement_lock, flags);
+	return placement->mem_server_id;
+}
+
+#ifdef SEMERU_CHUNK_MIGRATION
+/**
+ * Live migration, take the slot of data_chunk on mem_server_id for the data chunk moving onto it.
+ * The slot is the chunk's own index in its window, see data_chunk_placement.
+ * The slot counts as placed until it's released, or the data chunk is moved onto it.
+ *
+ * Return the chunk index within the memory server, -1 if it's full or holds the chunk already.
+ */
+int reserve_data_chunk_slot(size_t data_chunk, int mem_server_id)
+{
+	unsigned long flags;
+	int window = (int)(data_chunk / RDMA_DATA_REGION_NUM);
+	int index = (int)(data_chunk % RDMA_DATA_REGION_NUM);
+	int ret = -1;
+
+	spin_lock_irqsave(&data_chunk_placement_lock, flags);
+	if (data_chunk_placed[window][mem_server_id] < data_region_per_mem_server &&
+	    !test_bit(index, data_chunk_slot_used[window][mem_server_id])) {
+		set_bit(index, data_chunk_slot_used[window][mem_server_id]);
+		data_chunk_placed[window][mem_server_id]++;
+		ret = index;
+	}
+	spin_unlock_irqrestore(&data_chunk_placement_lock, flags);
+
+	return ret;
+}
+
+void release_data_chunk_slot(int window, int mem_server_id, int chunk_index)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&data_chunk_placement_lock, flags);
+	clear_bit(chunk_index, data_chunk_slot_used[window][mem_server_id]);
+	data_chunk_placed[window][mem_server_id]--;
+	spin_unlock_irqrestore(&data_chunk_placement_lock, flags);
+}
+
+/**
+ * Switch the placement of data_chunk to the slot reserved on mem_server_id, in the window of data_chunk.
+ * Its old slot is released.
+ * The swap in/out in flight are excluded by the caller, see fs_migrate_switch().
+ * The other translations, e.g. the prefetcher, see either the old or the new placement, never a mix.
+ */
+void move_data_chunk(size_t data_chunk, int mem_server_id, int chunk_index)
+{
+	unsigned long flags;
+	size_t window = data_chunk / RDMA_DATA_REGION_NUM;
+	struct data_chunk_placement *placement = &data_chunk_placement[data_chunk];
+
+	spin_lock_irqsave(&data_chunk_placement_lock, flags);
+	clear_bit(placement->chunk_index, data_chunk_slot_used[window][placement->mem_server_id]);
+	data_chunk_placed[window][placement->mem_server_id]--;
+
+	write_seqcount_begin(&data_chunk_placement_seq);
+	placement->chunk_index = chunk_index;
+	WRITE_ONCE(placement->mem_server_id, mem_server_id);
+	write_seqcount_end(&data_chunk_placement_seq);
+
+	atomic_inc(&data_chunk_placement_epoch);
+	spin_unlock_irqrestore(&data_chunk_placement_lock, flags);
+}
+
+int data_chunk_placement_epoch_read(void)
+{
+	return atomic_read(&data_chunk_placement_epoch);
+}
+#endif
+
+/**
+ * Semeru Control Path - return the memory server id of a data space address.
+ * Used by the JVM to dispatch the Region to the memory server backing it.
+ *
+ * A NULL start_addr is the placement sync point of the JVM, at the start of each GC pause.
+ * The copied data chunks are moved then, return the placement epoch. The JVM drops its cached placement if it changed.
+ */
+int semeru_query_placement(char __user *start_addr)
+{
+	struct mem_server_addr mem_addr;
+	long offset;
+
+#ifdef SEMERU_CHUNK_MIGRATION
+	if (start_addr == NULL)
+		return fs_migrate_sync();
+#endif
+
+	offset = semeru_data_offset_of((unsigned long)start_addr, 1);
+	if (unlikely(offset < 0)) {
+		pr_err("%s, 0x%lx is out of the data space. \n", __func__, (size_t)start_addr);
+		return -1;
+	}
+
+	translate_data_addr_to_mem_server_addr(&mem_addr, (size_t)offset);
+	return mem_addr.mem_server_id;
+}
+
+
+/**
+ * @brief Translate the CPU serve virtual address to memory server virtual address.
+ * 	1) Reserve the first region for each memory server as meta region. 
+ * 	Never write any data to meta region via data path.
+ * 	2) This function is only used by both Data path and Control path.
+ * 	3) This function is only used for data region area.
+ * 
+ * Examples of Memory region
+ * 	// | -- Meta Region -- | -- Data Regsons --|
+ * 
+ * 	There are 2 translation path
+ * 	1) via the swap_entry_t, 
+ * 	CPU server virtual addr -> swap_entry_t => memory server virtual addr.
+ * 	Data on both meta regions and data regions can be swapped out to memory servers.
+ * 	In theory, no need to reserve the meta Regions in memory server.
+ * 	We skip the meta regions here only to prevent writing irrelevant signals to crash the memory servers.
+ * 	
+ * 	2) via the  swap_remmaping table,
+ * 	CPU server virtual addr -> swap_entry_t -> CPU server_virtual addr => memory server virtual addr.
+ * 	Because Only data on data regions can be swapped out. 
+ * 	The  swap_remmaping table count start from the first page in Data region.
+ * 	So, we also need to add the RDMA_META_REGION_NUM back when calcualting the region index.
+ * 	With SEMERU_SWP_IDENTITY_OFFSET, the swap slot is the data page itself, shifted by SEMERU_SWP_IDENTITY_BASE,
+ * 	and the table isn't looked up.
+ * 
+ * @param mem_addr 
+ * @param swap_entry_offset 
+ */
+size_t translate_to_mem_server_addr(struct mem_server_addr * mem_addr, pgoff_t swap_entry_offset)
+{
+	
+	// page offset, compared start of Data Region
+	// The real virtual address is semeru_data_addr(start_addr).
+#ifdef ENABLE_SWP_ENTRY_VIRT_REMAPPING
+	// byte address offset, the data offset of semeru_data_offset_of()
+	size_t start_addr;
+
+#ifdef SEMERU_FS_BENCH
+	if (unlikely(swap_entry_offset >= FS_BENCH_OFFSET_BASE))
+		start_addr = (swap_entry_offset - FS_BENCH_OFFSET_BASE) << PAGE_SHIFT;
+	else
+#endif
+#ifdef SEMERU_SWP_IDENTITY_OFFSET
+		start_addr = semeru_swp_offset_to_virt_page(swap_entry_offset) << PAGE_SHIFT;
+#else
+		start_addr = retrieve_swap_remmaping_virt_addr_via_offset(swap_entry_offset) << PAGE_SHIFT;
+#endif
+#else
+	// For the default kernel, no need to do the swp_offset -> virt translation
+	size_t start_addr = swap_entry_offset << PAGE_SHIFT;
+
+#ifdef SEMERU_FS_BENCH
+	if (unlikely(swap_entry_offset >= FS_BENCH_OFFSET_BASE))
+		start_addr -= FS_BENCH_OFFSET_BASE << PAGE_SHIFT;
+#endif
+#endif
+
+	//debug
+	//pr_warn("%s, for swap_entry 0x%lx , start_addr 0x%lx \n",
+	//	__func__, swap_entry_offset, start_addr);
+
+	translate_data_addr_to_mem_server_addr(mem_addr, start_addr);
+
+	return start_addr; // offset to data space
+
+}
+
+/**
+ * Translate the data offset, see semeru_data_offset_of(), to memory server address.
+ * The second half of translate_to_mem_server_addr(), 
+ * also used by the prefetcher which works on the data space address directly.
+ * 
+ * @param mem_addr 
+ * @param start_addr : the data offset, the address window and the byte offset within its data space
+ */
+void translate_data_addr_to_mem_server_addr(struct mem_server_addr *mem_addr, size_t start_addr)
+{
+	size_t start_chunk_index = start_addr >> CHUNK_SHIFT; // absolute data chunk index
+	size_t offset_within_chunk = start_addr & CHUNK_MASK;
+	struct data_chunk_placement *placement = &data_chunk_placement[start_chunk_index];
+	int mem_server_id;
+	int chunk_index;
+#ifdef SEMERU_CHUNK_MIGRATION
+	unsigned int seq;
+
+retry:
+	seq = read_seqcount_begin(&data_chunk_placement_seq);
+#endif
+	mem_server_id = READ_ONCE(placement->mem_server_id);
+
+	// Calculate the target memory server
+	if (unlikely(mem_server_id < 0))
+		mem_server_id = place_data_chunk_by_load(start_chunk_index);
+	smp_rmb();
+	chunk_index = placement->chunk_index;
+#ifdef SEMERU_CHUNK_MIGRATION
+	if (unlikely(read_seqcount_retry(&data_chunk_placement_seq, seq)))
+		goto retry; // moved meanwhile
+#endif
+	mem_addr->window = (int)(start_chunk_index / RDMA_DATA_REGION_NUM);
+	mem_addr->mem_server_id = mem_server_id;
+	// calculate chunk index within the memory server
+	// skip the meta regions for both translation paths.
+	mem_addr->mem_server_chunk_index = chunk_index + RDMA_META_REGION_NUM;
+	mem_addr->mem_server_offset_within_chunk = offset_within_chunk;
+}
+
+// Stores of the free Regions, not written to the memory servers, see semeru_reclaim_priority().
+static atomic_long_t fs_discarded_stores = ATOMIC_LONG_INIT(0);
+
+#ifdef SEMERU_FS_CLEAN_SWAPIN
+/**
+ * Clean swap-ins, module parameter keep_clean_swapin.
+ * One bit per data page, set by a load and cleared by a store or the free of the slot: the copy on the memory server
+ * is the latest while the slot is kept. A load finding it set means the page was dropped clean, a store saved.
+ */
+static unsigned long *fs_clean_map = NULL;
+static size_t fs_clean_map_pages;
+static atomic_long_t fs_clean_drops = ATOMIC_LONG_INIT(0); // evicted clean, then loaded again
+static atomic_long_t fs_clean_rewrites = ATOMIC_LONG_INIT(0); // written after a load, the page was dirtied
+
+static int init_fs_clean_map(void)
+{
+	if (!keep_clean_swapin)
+		return 0;
+
+	fs_clean_map_pages = semeru_data_space_size() >> PAGE_SHIFT;
+	fs_clean_map = vzalloc(BITS_TO_LONGS(fs_clean_map_pages) * sizeof(unsigned long));
+	if (unlikely(fs_clean_map == NULL)) {
+		pr_err("%s, allocate the clean page map of 0x%lx pages failed.\n", __func__, fs_clean_map_pages);
+		return -ENOMEM;
+	}
+
+	// The kernel keeps the slots of the read faults from now on.
+	WRITE_ONCE(semeru_keep_clean_swapin, 1);
+	return 0;
+}
+
+/**
+ * Invoked after the frontswap ops are deregistered.
+ */
+static void free_fs_clean_map(void)
+{
+	WRITE_ONCE(semeru_keep_clean_swapin, 0);
+	if (fs_clean_map == NULL)
+		return;
+
+	pr_warn("%s, clean pages dropped and loaded again %ld, written again after a load %ld\n", __func__,
+		atomic_long_read(&fs_clean_drops), atomic_long_read(&fs_clean_rewrites));
+	vfree(fs_clean_map);
+	fs_clean_map = NULL;
+}
+
+static inline void fs_clean_loaded(size_t data_page)
+{
+	if (fs_clean_map != NULL && data_page < fs_clean_map_pages && test_and_set_bit(data_page, fs_clean_map))
+		atomic_long_inc(&fs_clean_drops);
+}
+
+static inline void fs_clean_stored(size_t data_page)
+{
+	if (fs_clean_map != NULL && data_page < fs_clean_map_pages && test_and_clear_bit(data_page, fs_clean_map))
+		atomic_long_inc(&fs_clean_rewrites);
+}
+
+static inline void fs_clean_forget(size_t data_page)
+{
+	if (fs_clean_map != NULL && data_page < fs_clean_map_pages)
+		clear_bit(data_page, fs_clean_map);
+}
+#endif
+
+#ifdef SEMERU_TRANSPORT
+// The transport of the data Regions, installed by init_fs_cxl() or init_fs_tcp(). NULL, the built-in RDMA path.
+const struct semeru_transport *semeru_transport = NULL;
+#endif
+
+//
+// ############################ Asynchronous replication ############################
+//
+
+static struct {
+	atomic_t written; // replica writes posted
+	atomic_t skipped; // the replica chunk is unavailable, or the post failed
+	atomic_t failed; // acked with error
+	atomic_t degraded_loads; // loads served by the replica
+	atomic_t invalid_loads; // degraded loads failed, the replica is older
+} fs_replica_stats;
+
+static atomic_t fs_replica_inflight = ATOMIC_INIT(0);
+
+/**
+ * Validity of the replica, one bit per data page, see frontswap_path.h.
+ * The 3 bits of a page change together, under its hashed lock. The acks run in the CQ context.
+ */
+static unsigned long *fs_replica_valid = NULL; // the replica has the latest store
+static unsigned long *fs_replica_pending; // a replica write is in flight
+static unsigned long *fs_replica_stale; // the replica write in flight is older than the page
+static size_t fs_replica_pages;
+static spinlock_t fs_replica_locks[FS_REPLICA_LOCKS];
+
+static inline spinlock_t *fs_replica_lock(size_t data_page)
+{
+	return &fs_replica_locks[data_page % FS_REPLICA_LOCKS];
+}
+
+static int init_fs_replica(void)
+{
+	size_t longs;
+	int i;
+
+	if (replica_mode != SEMERU_REPLICA_MIRROR)
+		return 0;
+
+	fs_replica_pages = semeru_data_space_size() >> PAGE_SHIFT;
+	longs = BITS_TO_LONGS(fs_replica_pages);
+	fs_replica_valid = vzalloc(3 * longs * sizeof(unsigned long));
+	if (unlikely(fs_replica_valid == NULL)) {
+		pr_err("%s, allocate the replica validity of 0x%lx pages failed.\n", __func__, fs_replica_pages);
+		return -ENOMEM;
+	}
+	fs_replica_pending = fs_replica_valid + longs;
+	fs_replica_stale = fs_replica_pending + longs;
+
+	for (i = 0; i < FS_REPLICA_LOCKS; i++)
+		spin_lock_init(&fs_replica_locks[i]);
+	return 0;
+}
+
+/**
+ * Invoked after the RDMA sessions are disconnected, no replica write is acked anymore.
+ */
+static void free_fs_replica(void)
+{
+	vfree(fs_replica_valid);
+	fs_replica_valid = NULL;
+}
+
+/**
+ * The page is stored, or rewritten by the memory server. Its replica is older from now on.
+ */
+static void fs_replica_forget(size_t data_page)
+{
+	unsigned long flags;
+
+	if (fs_replica_valid == NULL || unlikely(data_page >= fs_replica_pages))
+		return;
+
+	spin_lock_irqsave(fs_replica_lock(data_page), flags);
+	clear_bit(data_page, fs_replica_valid);
+	if (test_bit(data_page, fs_replica_pending))
+		set_bit(data_page, fs_replica_stale);
+	spin_unlock_irqrestore(fs_replica_lock(data_page), flags);
+}
+
+static void fs_replica_forget_range(size_t start_page, size_t end_page)
+{
+	size_t data_page;
+
+	if (fs_replica_valid == NULL)
+		return;
+
+	end_page = min(end_page, fs_replica_pages);
+	data_page = start_page;
+	for_each_set_bit_from(data_page, fs_replica_valid, end_page)
+		fs_replica_forget(data_page);
+	data_page = start_page;
+	for_each_set_bit_from(data_page, fs_replica_pending, end_page)
+		fs_replica_forget(data_page);
+}
+
+/**
+ * Return true if the caller can post the replica write of the page, false if one is still in flight.
+ */
+static bool fs_replica_write_begin(size_t data_page)
+{
+	unsigned long flags;
+	bool posted;
+
+	if (fs_replica_valid == NULL || unlikely(data_page >= fs_replica_pages))
+		return false;
+
+	spin_lock_irqsave(fs_replica_lock(data_page), flags);
+	posted = !test_and_set_bit(data_page, fs_replica_pending);
+	spin_unlock_irqrestore(fs_replica_lock(data_page), flags);
+	return posted;
+}
+
+/**
+ * The replica write of the page is acked, or given up. Only a successful one not overtaken makes it valid.
+ */
+static void fs_replica_write_end(size_t data_page, bool written)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(fs_replica_lock(data_page), flags);
+	if (written && !test_bit(data_page, fs_replica_stale))
+		set_bit(data_page, fs_replica_valid);
+	clear_bit(data_page, fs_replica_stale);
+	clear_bit(data_page, fs_replica_pending);
+	spin_unlock_irqrestore(fs_replica_lock(data_page), flags);
+}
+
+static inline bool fs_replica_page_valid(size_t data_page)
+{
+	return fs_replica_valid != NULL && data_page < fs_replica_pages && test_bit(data_page, fs_replica_valid);
+}
+
+static void fs_replica_reap_fn(struct work_struct *work);
+static DECLARE_DELAYED_WORK(fs_replica_reap_work, fs_replica_reap_fn);
+
+/**
+ * The mirror of a data chunk, at the same chunk index of the next memory server.
+ * The placement is identity, so no primary chunk takes the index there,
+ * and the memory server finds the replica at the Java heap address of the data chunk.
+ * replica_addr and mem_addr can be the same.
+ */
+void translate_to_replica_addr(struct mem_server_addr *replica_addr, struct mem_server_addr *mem_addr)
+{
+	int mem_server_id = mem_addr->mem_server_id;
+
+	replica_addr->window = mem_addr->window;
+	replica_addr->mem_server_id = (mem_server_id + 1) % num_mem_servers;
+	replica_addr->mem_server_chunk_index = mem_addr->mem_server_chunk_index;
+	replica_addr->mem_server_offset_within_chunk = mem_addr->mem_server_offset_within_chunk;
+}
+
+/**
+ * Can the chunk of the memory server be accessed via the rdma_queue ?
+ * The QP is disconnected by the memory server, freed == 255, or the chunk is released or out of the capacity.
+ */
+static inline bool fs_chunk_unavailable(struct rdma_session_context *rdma_session, struct semeru_rdma_queue *rdma_queue,
+					size_t chunk_index)
+{
+	if (!rdma_queue_alive(rdma_queue))
+		return true;
+
+	return chunk_index >= rdma_session->remote_chunk_list.chunk_num ||
+	       rdma_session->remote_chunk_list.remote_chunk[chunk_index].chunk_state != MAPPED;
+}
+
+#ifdef SEMERU_FS_LOCAL_TIER
+/**
+ * Should the stores to mem_addr go to the local SSD tier ? Its memory server is out of credit, or unreachable.
+ */
+bool fs_mem_server_congested(struct mem_server_addr *mem_addr)
+{
+	struct rdma_session_context *rdma_session = fs_session(mem_addr->window, mem_addr->mem_server_id);
+
+#ifdef SEMERU_TRANSPORT
+	if (semeru_transport != NULL)
+		return false;
+#endif
+	return fs_credit_low(rdma_session) ||
+	       fs_chunk_unavailable(rdma_session, get_dp_rdma_queue(rdma_session, raw_smp_processor_id()),
+				    mem_addr->mem_server_chunk_index);
+}
+
+/**
+ * Store the page to the local SSD tier instead of its memory server.
+ * The memory server's copy, and the local caches of it, are stale from now on.
+ */
+static int fs_store_local(size_t start_addr, struct page *page)
+{
+	int ret = fs_local_store(start_addr, page);
+
+	if (ret)
+		return ret;
+	fs_fence_revoke(start_addr);
+#ifdef SEMERU_FS_ZERO_PAGE
+	fs_zero_forget_range(start_addr >> PAGE_SHIFT, (start_addr >> PAGE_SHIFT) + 1);
+#endif
+#ifdef SEMERU_FS_COMPRESS
+	fs_compress_invalidate(start_addr >> PAGE_SHIFT);
+#endif
+#ifdef SEMERU_FS_PREFETCH
+	fs_prefetch_invalidate(start_addr >> PAGE_SHIFT);
+#endif
+	return 0;
+}
+#endif
+
+static void fs_rdma_replica_write_done(struct ib_cq *cq, struct ib_wc *wc)
+{
+	struct fs_rdma_req *rdma_req = container_of(wc->wr_cqe, struct fs_rdma_req, cqe);
+	struct semeru_rdma_queue *rdma_queue = cq->cq_context;
+
+	if (unlikely(wc->status != IB_WC_SUCCESS)) {
+		pr_err("%s, memory server[%d] status is not success, it is=%d\n", __func__,
+		       rdma_queue->rdma_session->mem_server_id, wc->status);
+		atomic_inc(&fs_replica_stats.failed);
+	}
+	fs_replica_write_end(rdma_req->data_page, wc->status == IB_WC_SUCCESS);
+	fs_rdma_req_unmap(rdma_queue, rdma_req, DMA_TO_DEVICE);
+
+	put_page(rdma_req->page); // drop the reference got at posting.
+	atomic_dec(&fs_replica_inflight);
+	atomic_dec(&rdma_queue->rdma_post_counter); // decrease outstanding rdma request counter
+	fs_rdma_req_put(rdma_queue, rdma_req); // nobody waits on it.
+}
+
+/**
+ * Process the acked replica writes of all the memory servers.
+ * Re-arm itself until all the replica writes are released.
+ */
+static void fs_replica_reap_fn(struct work_struct *work)
+{
+	int session;
+	int i;
+	unsigned long flags;
+	struct semeru_rdma_queue *rdma_queue;
+
+	for (session = 0; session < fs_num_sessions(); session++) {
+		for (i = 0; i < online_cores; i++) {
+			rdma_queue = &(rdma_session_global_ptr[session].rdma_queues[i]);
+			if (atomic_read(&rdma_queue->rdma_post_counter) <= 0)
+				continue;
+
+			spin_lock_irqsave(&rdma_queue->cq_lock, flags);
+			ib_process_cq_direct(rdma_queue->cq, 16);
+			spin_unlock_irqrestore(&rdma_queue->cq_lock, flags);
+		}
+	}
+
+	if (atomic_read(&fs_replica_inflight) > 0)
+		schedule_delayed_work(&fs_replica_reap_work, usecs_to_jiffies(FS_REPLICA_REAP_DELAY_US));
+}
+
+/**
+ * Post the replica write of a stored page, without waiting for it.
+ * The primary copy is already written, or staged, by the caller.
+ * 
+ * A failed replica write only loses the redundancy, the store still succeeds.
+ * The page's replica stays invalid then, see fs_replica_write_end().
+ */
+void fs_store_replica(size_t start_addr, struct mem_server_addr *mem_addr, struct page *page)
+{
+	int ret;
+	struct mem_server_addr replica_addr;
+	struct rdma_session_context *rdma_session;
+	struct semeru_rdma_queue *rdma_queue;
+	struct remote_mapping_chunk *remote_chunk_ptr;
+	struct fs_rdma_req *rdma_req;
+	size_t data_page = start_addr >> PAGE_SHIFT;
+
+	// The replica write of the last store is in flight, it can't be ordered after it.
+	if (!fs_replica_write_begin(data_page)) {
+		atomic_inc(&fs_replica_stats.skipped);
+		return;
+	}
+
+	translate_to_replica_addr(&replica_addr, mem_addr);
+	// The chunk state is checked and the wr posted with preemption disabled, see cp_resize_chunks_of_server().
+	preempt_disable();
+	rdma_session = fs_session(replica_addr.window, replica_addr.mem_server_id);
+	// One QP per page, the replica writes of the page are acked in order, the old data never overwrites the new one.
+	rdma_queue = &(rdma_session->rdma_queues[(start_addr >> PAGE_SHIFT) % online_cores]);
+
+	if (unlikely(fs_chunk_unavailable(rdma_session, rdma_queue, replica_addr.mem_server_chunk_index))) {
+		fs_replica_write_end(data_page, false);
+		atomic_inc(&fs_replica_stats.skipped);
+		goto out;
+	}
+
+	rdma_req = fs_rdma_req_get(rdma_queue);
+	if (unlikely(rdma_req == NULL)) {
+		fs_replica_write_end(data_page, false);
+		atomic_inc(&fs_replica_stats.skipped);
+		goto out;
+	}
+
+	remote_chunk_ptr = &(rdma_session->remote_chunk_list.remote_chunk[replica_addr.mem_server_chunk_index]);
+	ret = dp_build_fs_rdma_wr(rdma_session, rdma_queue, rdma_req, remote_chunk_ptr,
+				  replica_addr.mem_server_offset_within_chunk, page, DMA_TO_DEVICE);
+	if (unlikely(ret)) {
+		// rdma_req is freed by dp_build_fs_rdma_wr().
+		fs_replica_write_end(data_page, false);
+		atomic_inc(&fs_replica_stats.skipped);
+		goto out;
+	}
+	rdma_req->cqe.done = fs_rdma_replica_write_done;
+	rdma_req->data_page = data_page;
+
+	// Pin the page until the replica write is acked.
+	get_page(page);
+	atomic_inc(&fs_replica_inflight);
+
+	ret = fs_enqueue_send_wr(rdma_session, rdma_queue, rdma_req);
+	if (unlikely(ret)) {
+		pr_err("%s, enqueue replica write to memory server[%d] failed.\n", __func__, replica_addr.mem_server_id);
+		fs_rdma_req_unmap(rdma_queue, rdma_req, DMA_TO_DEVICE);
+		put_page(page);
+		atomic_dec(&fs_replica_inflight);
+		fs_rdma_req_put(rdma_queue, rdma_req);
+		fs_replica_write_end(data_page, false);
+		atomic_inc(&fs_replica_stats.skipped);
+		goto out;
+	}
+
+	atomic_inc(&fs_replica_stats.written);
+	schedule_delayed_work(&fs_replica_reap_work, usecs_to_jiffies(FS_REPLICA_REAP_DELAY_US));
+
+out:
+	preempt_enable();
+}
+
+/**
+ * Stop reaping the replica writes, before the RDMA sessions are freed.
+ */
+void fs_replica_exit(void)
+{
+	cancel_delayed_work_sync(&fs_replica_reap_work);
+
+	pr_info("%s, replica writes %d, skipped %d, failed %d, degraded loads %d, invalid %d\n", __func__,
+		atomic_read(&fs_replica_stats.written), atomic_read(&fs_replica_stats.skipped),
+		atomic_read(&fs_replica_stats.failed), atomic_read(&fs_replica_stats.degraded_loads),
+		atomic_read(&fs_replica_stats.invalid_loads));
+}
+
+//
+// ############################ Region fence of the concurrent compaction ############################
+//
+
+static struct {
+	struct fs_fence_range range[FS_FENCE_MAX_RANGES];
+	atomic_t active; // ranges not FS_FENCE_FREE, the fast path of the swap-in/out checks.
+	spinlock_t lock;
+	wait_queue_head_t wait; // faults on a committing range
+} fs_fence = {
+	.active = ATOMIC_INIT(0),
+	.lock = __SPIN_LOCK_UNLOCKED(fs_fence.lock),
+	.wait = __WAIT_QUEUE_HEAD_INITIALIZER(fs_fence.wait),
+};
+
+/**
+ * Find the fenced range of [start, end), under fs_fence.lock.
+ * The ranges, JVM Regions, never overlap.
+ */
+static struct fs_fence_range *fs_fence_find(size_t start, size_t end)
+{
+	int i;
+
+	for (i = 0; i < FS_FENCE_MAX_RANGES; i++) {
+		if (fs_fence.range[i].state != FS_FENCE_FREE && fs_fence.range[i].start < end &&
+		    start < fs_fence.range[i].end)
+			return &fs_fence.range[i];
+	}
+
+	return NULL;
+}
+
+/**
+ * Drop the fenced ranges of an address window, all of them if window < 0, and wake up the faults on them.
+ */
+static void fs_fence_drop(int window)
+{
+	unsigned long flags;
+	int dropped = 0;
+	int i;
+
+	spin_lock_irqsave(&fs_fence.lock, flags);
+	for (i = 0; i < FS_FENCE_MAX_RANGES; i++) {
+		if (fs_fence.range[i].state == FS_FENCE_FREE ||
+		    (window >= 0 && fs_fence.range[i].start / RDMA_DATA_SPACE_SIZE != (size_t)window))
+			continue;
+		fs_fence.range[i].state = FS_FENCE_FREE;
+		atomic_dec(&fs_fence.active);
+		dropped++;
+	}
+	spin_unlock_irqrestore(&fs_fence.lock, flags);
+
+	if (dropped > 0) {
+		pr_warn("%s, dropped %d fenced ranges of window[%d] \n", __func__, dropped, window);
+		wake_up_all(&fs_fence.wait);
+	}
+}
+
+/**
+ * The owner of the fenced ranges, per address window.
+ * 
+ * Like cp_meta_mn, the mmu notifier follows the teardown of the granting mm. Its release drops the window's ranges,
+ * a JVM exiting between the grant and the release leaks neither a granted range nor a blocked fault.
+ * The notifier holds the mm_struct until the first grant of another process in the window, or the module exit.
+ * Serialized by fs_fence_mn_mutex.
+ */
+static struct mmu_notifier fs_fence_mn[SEMERU_MAX_ADDRESS_WINDOWS];
+static struct mm_struct *fs_fence_mm[SEMERU_MAX_ADDRESS_WINDOWS]; // NULL if the notifier isn't registered.
+static DEFINE_MUTEX(fs_fence_mn_mutex);
+
+/**
+ * exit_mmap() of the granting mm, nobody is going to release its ranges.
+ */
+static void fs_fence_mn_release(struct mmu_notifier *mn, struct mm_struct *mm)
+{
+	fs_fence_drop((int)(mn - fs_fence_mn));
+}
+
+static const struct mmu_notifier_ops fs_fence_mn_ops = {
+	.release = fs_fence_mn_release,
+};
+
+/**
+ * Drop the notifier of the window's owner and its ranges. Invoked with fs_fence_mn_mutex held.
+ */
+static void fs_fence_drop_owner(int window)
+{
+	if (fs_fence_mm[window] != NULL) {
+		// Invokes the release if the mm is still alive, then drops the mm_struct.
+		mmu_notifier_unregister(&fs_fence_mn[window], fs_fence_mm[window]);
+		fs_fence_mm[window] = NULL;
+	}
+	fs_fence_drop(window);
+}
+
+/**
+ * Make current->mm the owner of the window's ranges, before a grant. Sleeps.
+ */
+static int fs_fence_follow_mm(int window)
+{
+	int ret = 0;
+
+	mutex_lock(&fs_fence_mn_mutex);
+	if (fs_fence_mm[window] == current->mm)
+		goto out;
+
+	// Another JVM runs in the window, the ranges of the previous one are void.
+	fs_fence_drop_owner(window);
+
+	fs_fence_mn[window].ops = &fs_fence_mn_ops;
+	ret = mmu_notifier_register(&fs_fence_mn[window], current->mm);
+	if (unlikely(ret)) {
+		pr_err("%s, follow the mm of the JVM failed, %d.\n", __func__, ret);
+		goto out;
+	}
+	fs_fence_mm[window] = current->mm;
+
+out:
+	mutex_unlock(&fs_fence_mn_mutex);
+	return ret;
+}
+
+/**
+ * Module exit, before the sessions are freed. The notifier ops are module text.
+ */
+void fs_fence_exit(void)
+{
+	int window;
+
+	mutex_lock(&fs_fence_mn_mutex);
+	for (window = 0; window < (int)semeru_nr_windows; window++)
+		fs_fence_drop_owner(window);
+	mutex_unlock(&fs_fence_mn_mutex);
+	fs_fence_drop(-1);
+}
+
+/**
+ * A fault waited FS_FENCE_COMMIT_TIMEOUT_MS on the committing range of start_addr.
+ * The JVM is stuck, or the memory server is lost. Drop the range, the page is read or written as it is.
+ */
+static void fs_fence_expire(size_t start_addr)
+{
+	unsigned long flags;
+	struct fs_fence_range *range;
+	bool expired = false;
+
+	spin_lock_irqsave(&fs_fence.lock, flags);
+	range = fs_fence_find(start_addr, start_addr + PAGE_SIZE);
+	if (range != NULL && range->state == FS_FENCE_COMMITTING) {
+		pr_err("%s, [0x%lx, 0x%lx) isn't released in %dms, drop it. \n", __func__, range->start, range->end,
+		       FS_FENCE_COMMIT_TIMEOUT_MS);
+		range->state = FS_FENCE_FREE;
+		atomic_dec(&fs_fence.active);
+		expired = true;
+	}
+	spin_unlock_irqrestore(&fs_fence.lock, flags);
+
+	if (expired)
+		wake_up_all(&fs_fence.wait);
+}
+
+static bool fs_fence_committing(size_t start_addr)
+{
+	unsigned long flags;
+	struct fs_fence_range *range;
+	bool committing;
+
+	spin_lock_irqsave(&fs_fence.lock, flags);
+	range = fs_fence_find(start_addr, start_addr + PAGE_SIZE);
+	committing = range != NULL && range->state == FS_FENCE_COMMITTING;
+	spin_unlock_irqrestore(&fs_fence.lock, flags);
+
+	return committing;
+}
+
+/**
+ * Is the page at start_addr in a range the memory server is compacting, granted or committing ?
+ * Its memory server's copy may be moved under a read.
+ */
+bool fs_fence_busy(size_t start_addr)
+{
+	unsigned long flags;
+	struct fs_fence_range *range;
+	bool busy;
+
+	if (likely(atomic_read(&fs_fence.active) == 0))
+		return false;
+
+	spin_lock_irqsave(&fs_fence.lock, flags);
+	range = fs_fence_find(start_addr, start_addr + PAGE_SIZE);
+	busy = range != NULL && (range->state == FS_FENCE_GRANTED || range->state == FS_FENCE_COMMITTING);
+	spin_unlock_irqrestore(&fs_fence.lock, flags);
+
+	return busy;
+}
+
+#ifdef SEMERU_CHUNK_MIGRATION
+/**
+ * Is any part of [start, end) fenced for the concurrent compaction ? Checked before a data chunk is moved.
+ */
+bool fs_fence_overlaps(size_t start, size_t end)
+{
+	unsigned long flags;
+	bool overlaps;
+
+	spin_lock_irqsave(&fs_fence.lock, flags);
+	overlaps = fs_fence_find(start, end) != NULL;
+	spin_unlock_irqrestore(&fs_fence.lock, flags);
+
+	return overlaps;
+}
+#endif
+
+static void fs_fence_revoke_range(struct fs_fence_range *range, size_t start_addr)
+{
+	range->state = FS_FENCE_REVOKED;
+#if defined(DEBUG_MODE_BRIEF) || defined(DEBUG_MODE_DETAIL)
+	pr_info("%s, page 0x%lx revoked the fence [0x%lx, 0x%lx) \n", __func__, start_addr, range->start, range->end);
+#endif
+}
+
+/**
+ * Add the page to a list of the range, under fs_fence.lock. False if the list is full.
+ */
+static bool fs_fence_add_page(unsigned int *pages, unsigned int *nr_pages, unsigned int page)
+{
+	unsigned int i;
+
+	for (i = 0; i < *nr_pages; i++) {
+		if (pages[i] == page)
+			return true;
+	}
+	if (*nr_pages == FS_FENCE_MAX_PAGES)
+		return false;
+	pages[(*nr_pages)++] = page;
+	return true;
+}
+
+static void fs_fence_remove_page(unsigned int *pages, unsigned int *nr_pages, unsigned int page)
+{
+	unsigned int i;
+
+	for (i = 0; i < *nr_pages; i++) {
+		if (pages[i] == page) {
+			pages[i] = pages[--(*nr_pages)];
+			return;
+		}
+	}
+}
+
+/**
+ * Record an access to a granted range, under fs_fence.lock.
+ * A stored page is written back, its memory server copy is what the memory server reconciles.
+ */
+static void fs_fence_record(struct fs_fence_range *range, size_t start_addr, enum fs_fence_access access)
+{
+	unsigned int page = (start_addr - range->start) >> PAGE_SHIFT;
+
+	switch (access) {
+	case FS_FENCE_LOAD:
+		if (!fs_fence_add_page(range->loaded, &range->nr_loaded, page))
+			fs_fence_revoke_range(range, start_addr);
+		break;
+	case FS_FENCE_STORE:
+		fs_fence_remove_page(range->loaded, &range->nr_loaded, page);
+		if (!fs_fence_add_page(range->written, &range->nr_written, page))
+			fs_fence_revoke_range(range, start_addr);
+		break;
+	case FS_FENCE_PEEK:
+		break;
+	}
+}
+
+/**
+ * Invoked by the frontswap load and store, and the peek, of the page at start_addr, a data offset.
+ *
+ * 1) A granted range is being compacted by the memory server concurrently.
+ * 	The page is read or written as it is, the access is recorded, see fs_fence_record().
+ * 	Never block here, the faulting mutator has to reach the next safepoint.
+ * 2) A committing range is being copied back by the memory server in the STW window.
+ * 	Wait until the JVM releases it, the page is at its new place by then.
+ * 	The faults may come from kswapd, the wait is bounded by FS_FENCE_COMMIT_TIMEOUT_MS, not by a signal.
+ */
+void fs_fence_check(size_t start_addr, enum fs_fence_access access)
+{
+	unsigned long flags;
+	struct fs_fence_range *range;
+	bool committing = false;
+
+	if (likely(atomic_read(&fs_fence.active) == 0))
+		return;
+
+	spin_lock_irqsave(&fs_fence.lock, flags);
+	range = fs_fence_find(start_addr, start_addr + PAGE_SIZE);
+	if (range != NULL) {
+		if (range->state == FS_FENCE_GRANTED) {
+			fs_fence_record(range, start_addr, access);
+		} else if (range->state == FS_FENCE_COMMITTING) {
+			committing = true;
+		}
+	}
+	spin_unlock_irqrestore(&fs_fence.lock, flags);
+
+	if (unlikely(committing) &&
+	    !wait_event_timeout(fs_fence.wait, !fs_fence_committing(start_addr),
+				msecs_to_jiffies(FS_FENCE_COMMIT_TIMEOUT_MS)))
+		fs_fence_expire(start_addr);
+}
+
+/**
+ * The page at start_addr isn't written to its memory server, e.g. it's stored to the local tier.
+ * The memory server can't reconcile it, revoke the grant.
+ */
+void fs_fence_revoke(size_t start_addr)
+{
+	unsigned long flags;
+	struct fs_fence_range *range;
+
+	if (likely(atomic_read(&fs_fence.active) == 0))
+		return;
+
+	spin_lock_irqsave(&fs_fence.lock, flags);
+	range = fs_fence_find(start_addr, start_addr + PAGE_SIZE);
+	if (range != NULL && range->state == FS_FENCE_GRANTED)
+		fs_fence_revoke_range(range, start_addr);
+	spin_unlock_irqrestore(&fs_fence.lock, flags);
+}
+
+/**
+ * FS_FENCE_OP_WRITTEN, copy the written pages of a committing range to the user buffer.
+ */
+static int fs_fence_copy_written(char __user *buf, unsigned long size)
+{
+	unsigned long flags;
+	struct fs_fence_range *range;
+	struct fs_fence_written written;
+	long offset;
+	size_t start;
+
+	if (size < sizeof(written) || copy_from_user(&written.start, buf, sizeof(written.start)))
+		return -1;
+	offset = semeru_data_offset_of((unsigned long)written.start, PAGE_SIZE);
+	if (offset < 0)
+		return -1;
+	start = (size_t)offset;
+
+	spin_lock_irqsave(&fs_fence.lock, flags);
+	range = fs_fence_find(start, start + PAGE_SIZE);
+	if (range == NULL || range->state != FS_FENCE_COMMITTING) {
+		spin_unlock_irqrestore(&fs_fence.lock, flags);
+		return -1;
+	}
+	written.nr_pages = range->nr_written;
+	memcpy(written.pages, range->written, range->nr_written * sizeof(written.pages[0]));
+	spin_unlock_irqrestore(&fs_fence.lock, flags);
+
+	return copy_to_user(buf, &written, sizeof(written)) ? -1 : 0;
+}
+
+#ifdef SEMERU_FS_INVALIDATE
+/**
+ * The data space [start, end) is rewritten by the memory servers, chunk by chunk.
+ */
+static void fs_invalidate_revive_range(size_t start, size_t end)
+{
+	struct mem_server_addr mem_addr;
+	size_t chunk_end;
+
+	for (; start < end; start = chunk_end) {
+		chunk_end = min_t(size_t, (start | CHUNK_MASK) + 1, end);
+		translate_data_addr_to_mem_server_addr(&mem_addr, start);
+		fs_invalidate_revive(mem_addr.mem_server_id, start >> PAGE_SHIFT,
+				     (chunk_end + PAGE_SIZE - 1) >> PAGE_SHIFT);
+	}
+}
+#endif
+
+/**
+ * Semeru Control Path - fence a data space range for the concurrent compaction, sys_do_semeru_rdma_ops type 20.
+ *
+ * op :
+ * 	FS_FENCE_OP_GRANT, start watching the range. Return 0, -1 if the table is full, the range is migrating
+ * 		or its pages on the local SSD tier can't be written back;
+ * 	FS_FENCE_OP_CLOSE, at the start of the STW window. Return 1 and block the faults on the range
+ * 		if no page of it was swapped in or out since the grant, 2 if its swapped in pages are all written back
+ * 		to the memory servers, 0 and drop the fence if revoked or a page of it is on the local SSD tier;
+ * 	FS_FENCE_OP_RELEASE, drop the fence and wake up the blocked faults. Return 0;
+ * 	FS_FENCE_OP_REWRITE, the memory server compacts the range in the STW window, write back its pages
+ * 		on the local SSD tier, drop its local copies. Return 0, -1 if a local page had to be dropped unwritten.
+ * 	FS_FENCE_OP_WRITTEN, start_addr is a struct fs_fence_written of size bytes. Return 0, -1 if the range isn't committing.
+ */
+int semeru_region_fence(int op, char __user *start_addr, unsigned long size)
+{
+	unsigned long flags;
+	struct fs_fence_range *range;
+	long offset;
+	size_t start;
+	size_t end;
+	int i;
+	int ret = -1;
+
+	if (op == FS_FENCE_OP_WRITTEN)
+		return fs_fence_copy_written(start_addr, size);
+
+	// The range stays in the data space of one address window.
+	offset = semeru_data_offset_of((unsigned long)start_addr, size);
+	start = (size_t)offset;
+	end = start + size;
+	if (unlikely(offset < 0 || size == 0)) {
+		pr_err("%s, [0x%lx, 0x%lx) is out of the data space. \n", __func__, (size_t)start_addr,
+		       (size_t)start_addr + size);
+		return -1;
+	}
+
+	// The grants are dropped at the exit of the JVM.
+	if (op == FS_FENCE_OP_GRANT && fs_fence_follow_mm((int)(start / RDMA_DATA_SPACE_SIZE)) != 0)
+		return -1;
+
+#ifdef SEMERU_FS_LOCAL_TIER
+	// The memory server traces and compacts its own copy, the local pages have to be there before.
+	if (op == FS_FENCE_OP_GRANT && fs_local_sync_range(start, end) != 0)
+		return -1;
+#endif
+
+	spin_lock_irqsave(&fs_fence.lock, flags);
+	range = fs_fence_find(start, end);
+
+	switch (op) {
+	case FS_FENCE_OP_GRANT:
+		if (range != NULL) {
+			pr_err("%s, [0x%lx, 0x%lx) is fenced already. \n", __func__, (size_t)start_addr,
+			       (size_t)start_addr + size);
+			break;
+		}
+#ifdef SEMERU_CHUNK_MIGRATION
+		// The compaction would write the old memory server only.
+		if (fs_migrate_busy(start, end))
+			break;
+#endif
+		for (i = 0; i < FS_FENCE_MAX_RANGES; i++) {
+			if (fs_fence.range[i].state == FS_FENCE_FREE) {
+				fs_fence.range[i].start = start;
+				fs_fence.range[i].end = end;
+				fs_fence.range[i].state = FS_FENCE_GRANTED;
+				fs_fence.range[i].nr_loaded = 0;
+				fs_fence.range[i].nr_written = 0;
+				atomic_inc(&fs_fence.active);
+				ret = 0;
+				break;
+			}
+		}
+		break;
+
+	case FS_FENCE_OP_CLOSE:
+		if (range == NULL)
+			break;
+		if (range->state == FS_FENCE_GRANTED && range->nr_loaded == 0
+#ifdef SEMERU_FS_LOCAL_TIER
+		    && !fs_local_has_range(start, end)
+#endif
+		    ) {
+			range->state = FS_FENCE_COMMITTING;
+			ret = range->nr_written == 0 ? 1 : 2;
+		} else {
+			range->state = FS_FENCE_FREE;
+			atomic_dec(&fs_fence.active);
+			ret = 0;
+		}
+		break;
+
+	case FS_FENCE_OP_RELEASE:
+		if (range != NULL) {
+			range->state = FS_FENCE_FREE;
+			atomic_dec(&fs_fence.active);
+		}
+		ret = 0;
+		break;
+
+	case FS_FENCE_OP_REWRITE:
+		ret = 0; // not a fence, see below.
+		break;
+
+	default:
+		pr_err("%s, wrong fence op %d \n", __func__, op);
+	}
+
+	spin_unlock_irqrestore(&fs_fence.lock, flags);
+
+	if (op == FS_FENCE_OP_RELEASE)
+		wake_up_all(&fs_fence.wait);
+
+	// The written pages are read by the memory server at the commit, post and wait for the staged stores.
+	if (op == FS_FENCE_OP_CLOSE && ret == 2) {
+		for (i = 0; i < fs_num_sessions(); i++)
+			drain_all_rdma_queue(&rdma_session_global_ptr[i]);
+	}
+
+#ifdef SEMERU_FS_LOCAL_TIER
+	// The memory server CSet, its compaction reads the memory server's copy.
+	// A page it can't get in time is lost, the worker must not write it over the compacted layout.
+	if (op == FS_FENCE_OP_REWRITE && fs_local_sync_range(start, end) != 0) {
+		pr_err("%s, dropped 0x%lx pages of [0x%lx, 0x%lx) on the local SSD tier, the memory servers are congested.\n",
+		       __func__, fs_local_drop_range(start, end), (size_t)start_addr, (size_t)start_addr + size);
+		ret = -1;
+	}
+#endif
+
+	// The memory server is going to write the range. The committing grant, or the memory server CSet.
+	if ((op == FS_FENCE_OP_CLOSE && ret >= 1) || op == FS_FENCE_OP_REWRITE) {
+#ifdef SEMERU_FS_COMPRESS
+		fs_compress_invalidate_range(start >> PAGE_SHIFT, (end + PAGE_SIZE - 1) >> PAGE_SHIFT);
+#endif
+#ifdef SEMERU_FS_ZERO_PAGE
+		fs_zero_forget_range(start >> PAGE_SHIFT, (end + PAGE_SIZE - 1) >> PAGE_SHIFT);
+#endif
+#ifdef SEMERU_FS_PREFETCH
+		fs_prefetch_invalidate_range(start >> PAGE_SHIFT, (end + PAGE_SIZE - 1) >> PAGE_SHIFT);
+#endif
+		// Only the primary copy is compacted.
+		fs_replica_forget_range(start >> PAGE_SHIFT, (end + PAGE_SIZE - 1) >> PAGE_SHIFT);
+#ifdef SEMERU_FS_INVALIDATE
+		fs_invalidate_revive_range(start, end);
+#endif
+#ifdef SEMERU_CHUNK_MIGRATION
+		fs_migrate_rewrite(start, end);
+#endif
+	}
 
+	return ret;
 }
 
 /**
@@ -371,6 +2196,14 @@ int semeru_frontswap_store(unsigned type, pgoff_t swap_entry_offset, struct page
 	struct remote_mapping_chunk *remote_chunk_ptr;
 	struct mem_server_addr mem_addr;
 	size_t start_addr;
+	u64 lat_start = fs_lat_start();
+	int trace_type = FS_TRACE_STORE;
+#ifdef SEMERU_FS_ZERO_PAGE
+	int zero;
+#endif
+#ifdef SEMERU_CHUNK_MIGRATION
+	bool migrating;
+#endif
 
 	//debug - before translation
 	//pr_warn("%s, store page 0x%lx, swap_entry 0x%lx \n", __func__, (size_t)page,  swap_entry_offset);
@@ -378,6 +2211,37 @@ int semeru_frontswap_store(unsigned type, pgoff_t swap_entry_offset, struct page
 	// 1) Translate swap index to memory server address
 	// page offset, compared start of Data Region
 	start_addr = translate_to_mem_server_addr(&mem_addr, swap_entry_offset);
+	fs_fence_check(start_addr, FS_FENCE_STORE);
+#ifdef SEMERU_CHUNK_MIGRATION
+	// Translated again within, the placement doesn't switch until fs_migrate_end().
+	migrating = fs_migrate_begin(start_addr, &mem_addr, true);
+#endif
+	// Whichever path takes the page, the replica is older until it's mirrored again.
+	fs_replica_forget(start_addr >> PAGE_SHIFT);
+	trace_semeru_fs_store_enter(swap_entry_offset, mem_addr.mem_server_id, mem_addr.mem_server_chunk_index,
+				    mem_addr.mem_server_offset_within_chunk);
+
+#ifdef SEMERU_FS_CLEAN_SWAPIN
+	// A page loaded with its slot kept is only stored again once written.
+	fs_clean_stored(start_addr >> PAGE_SHIFT);
+#endif
+
+#ifdef SEMERU_FS_LOCAL_TIER
+	// The page is stored again, its local copy is stale.
+	fs_local_forget(start_addr);
+#endif
+
+#ifdef SEMERU_FS_COLD
+	// The memory server may have compressed the block, restore it before writing into it.
+	ret = fs_cold_touch(start_addr, start_addr + PAGE_SIZE);
+	if (unlikely(ret)) {
+#ifdef SEMERU_FS_LOCAL_TIER
+		if (fs_store_local(start_addr, page) == 0)
+			ret = 0; // the memory server is unreachable, written back after it recovers.
+#endif
+		goto out;
+	}
+#endif
 
 	// debug - after translation
 	//pr_warn("%s, for swap_entry 0x%lx mem_server_id %d, chunk index %lu, offset 0x%lx \n", 
@@ -404,21 +2268,128 @@ int semeru_frontswap_store(unsigned type, pgoff_t swap_entry_offset, struct page
 
 #else
 	// 2) RDMA path
-	rdma_session = &rdma_session_global_ptr[mem_addr.mem_server_id];
-	
+	rdma_session = fs_session(mem_addr.window, mem_addr.mem_server_id);
+
+	// 2.0 the page belongs to a free Region of the JVM, its content is dead.
+	// The stale remote copy is swapped in if the Region is reused, the JVM initializes the objects it allocates.
+	if (semeru_reclaim_priority(semeru_data_addr(start_addr)) == SEMERU_RECLAIM_DISCARD) {
+#ifdef SEMERU_FS_COMPRESS
+		fs_compress_invalidate(start_addr >> PAGE_SHIFT);
+#endif
+#ifdef SEMERU_FS_PREFETCH
+		fs_prefetch_invalidate(start_addr >> PAGE_SHIFT);
+#endif
+		atomic_long_inc(&fs_discarded_stores);
+		trace_type = FS_TRACE_STORE_DISCARD;
+		goto out;
+	}
+
+#ifdef SEMERU_FS_INVALIDATE
+	// the page is alive again, drop its pending discard.
+	fs_invalidate_revive(mem_addr.mem_server_id, start_addr >> PAGE_SHIFT, (start_addr >> PAGE_SHIFT) + 1);
+#endif
+
+#ifdef SEMERU_FS_ZERO_PAGE
+	// the memory server has the zero page already.
+	zero = fs_zero_store(start_addr >> PAGE_SHIFT, page);
+#ifdef SEMERU_FS_COMPRESS
+	if (zero != FS_ZERO_NONE)
+		fs_compress_invalidate(start_addr >> PAGE_SHIFT); // served by the zero page map
+#endif
+	if (zero == FS_ZERO_ELIDED) {
+#ifdef SEMERU_FS_PREFETCH
+		fs_prefetch_invalidate(start_addr >> PAGE_SHIFT);
+#endif
+		goto out;
+	}
+#endif
+
+#ifdef SEMERU_FS_LOCAL_TIER
+	// 2.1 the memory server is out of credit or unreachable, don't stall on it.
+	if (local_swap_file != NULL && fs_mem_server_congested(&mem_addr) && fs_store_local(start_addr, page) == 0)
+		goto out;
+#endif
+
+#ifdef SEMERU_CHUNK_MIGRATION
+	// 2.1 the data chunk is being copied to another memory server, it gets the page too.
+	if (unlikely(migrating))
+		fs_migrate_mirror(start_addr, page);
+#endif
+
+#ifdef SEMERU_TRANSPORT
+	// 2.1 the window of the memory server or the TCP connection, written through.
+	if (semeru_transport != NULL) {
+		ret = semeru_transport->store(&mem_addr, page);
+#ifdef SEMERU_FS_COMPRESS
+		fs_compress_invalidate(start_addr >> PAGE_SHIFT); // the local tier only saves RDMA reads
+#endif
+#ifdef SEMERU_FS_PREFETCH
+		fs_prefetch_invalidate(start_addr >> PAGE_SHIFT);
+#endif
+#ifdef SEMERU_FS_ZERO_PAGE
+		if (likely(ret == 0) && zero == FS_ZERO_WRITE)
+			fs_zero_store_done(start_addr >> PAGE_SHIFT);
+#endif
+		goto out;
+	}
+#endif
+
+#ifdef SEMERU_FS_ASYNC_STORE
+	ret = semeru_frontswap_store_async(rdma_session, &mem_addr, start_addr, page);
+	if (unlikely(ret)) {
+		pr_err("%s, staging frontswap store for swap_entry 0x%lx failed.\n", __func__, swap_entry_offset);
+#ifdef SEMERU_FS_COMPRESS
+		fs_compress_invalidate(start_addr >> PAGE_SHIFT);
+#endif
+#ifdef SEMERU_FS_LOCAL_TIER
+		if (fs_store_local(start_addr, page) == 0)
+			ret = 0;
+#endif
+		goto out;
+	}
+
+	if (replica_mode == SEMERU_REPLICA_MIRROR)
+		fs_store_replica(start_addr, &mem_addr, page);
+#ifdef SEMERU_FS_ZERO_PAGE
+	// Written in QP order, before any later signal to the memory server.
+	if (zero == FS_ZERO_WRITE) {
+		fs_zero_store_done(start_addr >> PAGE_SHIFT);
+		goto out;
+	}
+#endif
+#ifdef SEMERU_FS_COMPRESS
+	// The page is pinned in swap cache until the write is acked, no load can hit the copy before that.
+	fs_compress_store(start_addr >> PAGE_SHIFT, page);
+#endif
+	goto out;
+#endif
+
+	// Throttled here when the memory server is slow.
+	fs_credit_get(rdma_session, PAGE_SIZE);
+
 	cpu = get_cpu(); // disable preempt
 	//cpu = smp_processor_id(); // if already disabled the preempt in caller, use this one
 
 	// 2.1 get the rdma queue and remote chunk
-	rdma_queue = &(rdma_session->rdma_queues[cpu]);
-	rdma_req = (struct fs_rdma_req *)kmem_cache_alloc(rdma_queue->fs_rdma_req_cache, GFP_ATOMIC);
+	rdma_queue = get_dp_rdma_queue(rdma_session, cpu);
+	rdma_req = fs_rdma_req_get(rdma_queue);
 	if (unlikely(rdma_req == NULL)) {
 		pr_err("%s, get reserved fs_rdma_req failed. \n", __func__);
+		fs_credit_put(rdma_session, PAGE_SIZE);
 		ret = -1;
 		goto out;
 	}
 
 	remote_chunk_ptr = &(rdma_session->remote_chunk_list.remote_chunk[mem_addr.mem_server_chunk_index]);
+	if (unlikely(remote_chunk_ptr->chunk_state != MAPPED)) {
+		pr_err("%s, memory server[%d] chunk[%lu] isn't mapped.\n", __func__, mem_addr.mem_server_id,
+		       mem_addr.mem_server_chunk_index);
+		fs_rdma_req_put(rdma_queue, rdma_req);
+		put_cpu();
+		fs_credit_put(rdma_session, PAGE_SIZE);
+		ret = -EINVAL;
+		goto out;
+	}
 
 	// TO BE DONE
 	// Warning : The data in Meta Region can be swapped out.
@@ -448,44 +2419,79 @@ int semeru_frontswap_store(unsigned type, pgoff_t swap_entry_offset, struct page
 #ifdef DEBUG_MODE_DETAIL
 	// Diable swap-out of Meta Region
 	pr_info("%s,  rdma_queue[%d] store page 0x%lx, virt addr 0x%lx, swp_offset 0x%lx >>>>> \n",
-	                   __func__, rdma_queue->q_index, (size_t)page, (size_t)(RDMA_DATA_SPACE_START_ADDR + start_addr), (size_t)swap_entry_offset );
+	                   __func__, rdma_queue->q_index, (size_t)page, (size_t)semeru_data_addr(start_addr), (size_t)swap_entry_offset );
 
 	// // Enable swap-out of Meta Region
 	// pr_info("%s,  rdma_queue[%d] store page 0x%lx, virt addr 0x%lx, swp_offset 0x%lx >>>>> \n", __func__,
-	// 	rdma_queue->q_index, (size_t)page, (size_t)(SEMERU_START_ADDR + start_addr), (size_t)swap_entry_offset);
+	// 	rdma_queue->q_index, (size_t)page, (size_t)semeru_data_addr(start_addr), (size_t)swap_entry_offset);
 #endif
 
 	
 
 	// 2.3 wait for write is done.
 
-	// busy wait on the rdma_queue[cpu].
-	// This is not exclusive.
-	drain_rdma_queue(rdma_queue); // poll the corresponding RDMA CQ
+	put_cpu(); // enable preeempt.
 
+	// wait on the rdma_queue[cpu], spin first and then sleep.
+	// This is not exclusive.
+	wait_rdma_queue(rdma_queue); // poll the corresponding RDMA CQ
 
-	put_cpu(); // enable preeempt.
 
 	// 3) wait for the finish of current fs_rdma_req
 	//  [??] uninterruptible is good. drain_rdma_queue() already processed all the outstanding rdma requests
 	// 5ms at most. The waiting is un-interrupptible
 	ret = wait_for_completion_timeout(&(rdma_req->done), msecs_to_jiffies(5)); 
+	fs_credit_put(rdma_session, PAGE_SIZE); // acked, or lost.
 	if (unlikely(ret == 0)) {
 		pr_err("%s, wait for rdma_req timeout for 5ms.\n", __func__);
 		ret = -1;
+#ifdef SEMERU_FS_LOCAL_TIER
+		// The write may still land, with the same content. The loads read the local copy until it's written back.
+		if (fs_store_local(start_addr, page) == 0)
+			ret = 0;
+#endif
 		goto out;
 	}
 
-	kmem_cache_free(rdma_queue->fs_rdma_req_cache, rdma_req); // safe to free
+	fs_rdma_req_put(rdma_queue, rdma_req); // safe to free
 	ret = 0; // reset to 0 for succss.
 
+#ifdef SEMERU_FS_PREFETCH
+	fs_prefetch_invalidate(start_addr >> PAGE_SHIFT);
+#endif
+
+	// 4) the primary copy is written, mirror it in background.
+	if (replica_mode == SEMERU_REPLICA_MIRROR)
+		fs_store_replica(start_addr, &mem_addr, page);
+
+#ifdef SEMERU_FS_ZERO_PAGE
+	if (zero == FS_ZERO_WRITE) {
+		fs_zero_store_done(start_addr >> PAGE_SHIFT);
+		goto out;
+	}
+#endif
+
+#ifdef SEMERU_FS_COMPRESS
+	// 5) keep the compressed local copy.
+	fs_compress_store(start_addr >> PAGE_SHIFT, page);
+#endif
+
 #ifdef DEBUG_MODE_DETAIL
 	pr_info("%s, rdma_queue[%d] store page 0x%lx, virt addr 0x%lx DONE <<<<< \n", __func__, rdma_queue->q_index,
-		(size_t)page, RDMA_DATA_SPACE_START_ADDR + start_addr);
+		(size_t)page, semeru_data_addr(start_addr));
 #endif
 #endif // end of DEBUG_FRONTSWAP_ONLY
 
 out:
+#ifdef SEMERU_CHUNK_MIGRATION
+	fs_migrate_end(start_addr, migrating);
+#endif
+	trace_semeru_fs_store_exit(swap_entry_offset, mem_addr.mem_server_id, ret);
+	if (likely(ret == 0)) {
+		fs_emu_delay(mem_addr.mem_server_id, PAGE_SIZE);
+		fs_trace_record(trace_type, mem_addr.mem_server_id, semeru_data_addr(start_addr), lat_start);
+		fs_lat_record(FS_LAT_STORE, mem_addr.mem_server_id, lat_start);
+	}
 	return ret;
 }
 
@@ -508,9 +2514,40 @@ int semeru_frontswap_load(unsigned type, pgoff_t swap_entry_offset, struct page
 
 	struct remote_mapping_chunk *remote_chunk_ptr;
 	struct mem_server_addr mem_addr;
+	size_t start_addr;
+	bool degraded = false;
+	bool safepoint;
+	u64 lat_start = fs_lat_start();
+	int trace_type = FS_TRACE_LOAD_LOCAL; // until the memory server is read
+	unsigned long fault_addr;
 
 	// 1) Translate swap index to memory server address
-	translate_to_mem_server_addr(&mem_addr, swap_entry_offset);
+	start_addr = translate_to_mem_server_addr(&mem_addr, swap_entry_offset);
+	fault_addr = fs_fault_address(semeru_data_addr(start_addr));
+	fs_fence_check(start_addr, FS_FENCE_LOAD);
+	// The JVM attributes its time to safepoint to the thread's wait, no speculative reads meanwhile.
+	safepoint = semeru_fault_state_set(fault_addr, 1);
+#ifdef SEMERU_CHUNK_MIGRATION
+	fs_migrate_begin(start_addr, &mem_addr, false);
+#endif
+	swap_in_shared_map_inc(semeru_data_addr(start_addr));
+	trace_semeru_fs_load_enter(swap_entry_offset, mem_addr.mem_server_id, mem_addr.mem_server_chunk_index,
+				   mem_addr.mem_server_offset_within_chunk);
+
+#ifdef SEMERU_FS_LOCAL_TIER
+	// The latest copy is on the local SSD, the memory server's is stale.
+	ret = fs_local_load(start_addr, page);
+	if (ret != -1)
+		goto out;
+	ret = 0;
+#endif
+
+#ifdef SEMERU_FS_COLD
+	// The memory server may have compressed the block, restore it before reading it.
+	ret = fs_cold_touch(start_addr, start_addr + PAGE_SIZE);
+	if (unlikely(ret))
+		goto out;
+#endif
 
 #ifdef RDMA_MESSAGE_PROFILING
 	rdma_read_from_mem_server_inc(mem_addr.mem_server_id);	
@@ -531,13 +2568,70 @@ int semeru_frontswap_load(unsigned type, pgoff_t swap_entry_offset, struct page
 
 #else
 	// 2) RDMA path
-	rdma_session = &rdma_session_global_ptr[mem_addr.mem_server_id];
+	rdma_session = fs_session(mem_addr.window, mem_addr.mem_server_id);
+
+#ifdef SEMERU_FS_ZERO_PAGE
+	// 2.0 the memory server's copy is zero, fill it locally.
+	if (fs_zero_load(start_addr >> PAGE_SHIFT, page) == 0)
+		goto out;
+#endif
+
+#ifdef SEMERU_TRANSPORT
+	// 2.0 the window of the memory server or the TCP connection, a copy is cheaper than the prefetch and the local tier.
+	if (semeru_transport != NULL) {
+		trace_type = FS_TRACE_LOAD;
+		ret = semeru_transport->load(&mem_addr, page);
+		goto out;
+	}
+#endif
+
+#ifdef SEMERU_FS_COMPRESS
+	// 2.0 the compressed local copy, no RDMA read at all.
+	if (fs_compress_load(start_addr >> PAGE_SHIFT, page) == 0)
+		goto out;
+#endif
+
+	// 2.0 degraded mode, the primary memory server is lost. Read the replica.
+	if (replica_mode == SEMERU_REPLICA_MIRROR &&
+	    unlikely(fs_chunk_unavailable(rdma_session, get_dp_rdma_queue(rdma_session, raw_smp_processor_id()),
+					  mem_addr.mem_server_chunk_index))) {
+		translate_to_replica_addr(&mem_addr, &mem_addr);
+		rdma_session = fs_session(mem_addr.window, mem_addr.mem_server_id);
+		degraded = true;
+		atomic_inc(&fs_replica_stats.degraded_loads);
+
+		if (unlikely(!fs_replica_page_valid(start_addr >> PAGE_SHIFT))) {
+			atomic_inc(&fs_replica_stats.invalid_loads);
+			pr_err_ratelimited("%s, the replica of data page 0x%lx on memory server[%d] is older than the lost copy.\n",
+					   __func__, start_addr >> PAGE_SHIFT, mem_addr.mem_server_id);
+			ret = -EIO;
+			goto out;
+		}
+
+		if (unlikely(fs_chunk_unavailable(rdma_session, get_dp_rdma_queue(rdma_session, raw_smp_processor_id()),
+						  mem_addr.mem_server_chunk_index))) {
+			pr_err("%s, the replica on memory server[%d] chunk[%lu] is unavailable too.\n", __func__,
+			       mem_addr.mem_server_id, mem_addr.mem_server_chunk_index);
+			ret = -EINVAL;
+			goto out;
+		}
+	}
+
+#ifdef SEMERU_FS_PREFETCH
+	// 2.0 the page is prefetched, no need to read it again.
+	if (fs_prefetch_lookup(start_addr >> PAGE_SHIFT, page) == 0) {
+		if (!degraded && !safepoint)
+			fs_prefetch_trigger(rdma_session, start_addr >> PAGE_SHIFT); // keep the stream going
+		trace_type = FS_TRACE_LOAD_PREFETCHED;
+		goto out;
+	}
+#endif
 
 	cpu = get_cpu(); // disable preempt
 
 	// 2.1 get the rdma queue and remote chunk
-	rdma_queue = &(rdma_session->rdma_queues[cpu]);
-	rdma_req = (struct fs_rdma_req *)kmem_cache_alloc(rdma_queue->fs_rdma_req_cache, GFP_ATOMIC);
+	rdma_queue = get_dp_rdma_queue(rdma_session, cpu);
+	rdma_req = fs_rdma_req_get(rdma_queue);
 	if (unlikely(rdma_req == NULL)) {
 		pr_err("%s, get reserved fs_rdma_req failed. \n", __func__);
 		ret = -1;
@@ -549,48 +2643,68 @@ int semeru_frontswap_load(unsigned type, pgoff_t swap_entry_offset, struct page
 	// We keep some useless data in the Meta Region.
 	// Swap out them to memory server can save the CPU server local cache.
 	remote_chunk_ptr = &(rdma_session->remote_chunk_list.remote_chunk[mem_addr.mem_server_chunk_index]);
+	if (unlikely(remote_chunk_ptr->chunk_state != MAPPED)) {
+		pr_err("%s, memory server[%d] chunk[%lu] isn't mapped.\n", __func__, mem_addr.mem_server_id,
+		       mem_addr.mem_server_chunk_index);
+		fs_rdma_req_put(rdma_queue, rdma_req);
+		put_cpu();
+		ret = -EINVAL;
+		goto out;
+	}
 
-	// 2.2 enqueue RDMA request
+	// 2.2 enqueue RDMA request, the control path holds its bulk traffic until it's done.
+	trace_type = FS_TRACE_LOAD;
+	atomic_inc(&rdma_session->demand_loads);
 	ret = semeru_fs_rdma_send(rdma_session, rdma_queue, rdma_req, remote_chunk_ptr,
 				  mem_addr.mem_server_offset_within_chunk, page, DMA_FROM_DEVICE);
 	if (unlikely(ret)) {
+		atomic_dec(&rdma_session->demand_loads);
 		pr_err("%s, enqueuing rdma frontswap write failed.\n", __func__);
 		goto out;
 	}
 
 #ifdef DEBUG_MODE_DETAIL
 	//pr_info("%s, rdma_queue[%d]  load page 0x%lx, virt addr 0x%lx, swp_offset 0x%lx  >>>>> \n",
-	//                  __func__, rdma_queue->q_index, (size_t)page, (size_t)(RDMA_DATA_SPACE_START_ADDR + start_addr), (size_t)swap_entry_offset);
+	//                  __func__, rdma_queue->q_index, (size_t)page, (size_t)semeru_data_addr(start_addr), (size_t)swap_entry_offset);
 
 	// enable swap out of Meta Region
 	pr_info("%s, rdma_queue[%d]  load page 0x%lx, virt addr 0x%lx, swp_offset 0x%lx  >>>>> \n", __func__,
-		rdma_queue->q_index, (size_t)page, (size_t)(SEMERU_START_ADDR + start_addr), (size_t)swap_entry_offset);
+		rdma_queue->q_index, (size_t)page, (size_t)semeru_data_addr(start_addr), (size_t)swap_entry_offset);
 #endif
 
 	
 
 	// 2.3 wait for write is done.
 
-	// busy wait on the rdma_queue[cpu].
-	// This is not exclusive.
-	drain_rdma_queue(rdma_queue); // poll the corresponding RDMA CQ
+	put_cpu(); // enable preeempt.
 
+	// wait on the rdma_queue[cpu], spin first and then sleep.
+	// This is not exclusive.
+	wait_rdma_queue(rdma_queue); // poll the corresponding RDMA CQ
 
-	put_cpu(); // enable preeempt.
 
 	// 3) wait for the finish of current fs_rdma_req
 	//  [??] uninterruptible is good. drain_rdma_queue() already processed all the outstanding rdma requests
 	// 5ms at most. The waiting is un-interrupptible
 	ret = wait_for_completion_timeout(&(rdma_req->done), msecs_to_jiffies(5));
+	atomic_dec(&rdma_session->demand_loads);
 	if (unlikely(ret == 0)) {
 		pr_err("%s, rdma_queue[%d] wait for rdma_req timeout for 5ms.\n", __func__, rdma_queue->q_index);
 		ret = -1;
 		goto out;
 	}
 
-	kmem_cache_free(rdma_queue->fs_rdma_req_cache, rdma_req); // safe to free
+	fs_rdma_req_put(rdma_queue, rdma_req); // safe to free
 	ret = 0; // reset to 0 for succss.
 
+#ifdef SEMERU_FS_PREFETCH
+	// 4) issue the prefetch after the demand read, not to delay the fault.
+	//    The prefetcher reads the primary memory server only.
+	//    A safepoint waits for the faulting threads, their reads go first.
+	if (!degraded && !safepoint)
+		fs_prefetch_trigger(rdma_session, start_addr >> PAGE_SHIFT);
+#endif
+
 #ifdef DEBUG_MODE_DETAIL
 	pr_info("%s, rdma_queue[%d] load page 0x%lx, virt addr 0x%lx DONE <<<<< \n", __func__, rdma_queue->q_index,
 		(size_t)page, start_addr);
@@ -599,11 +2713,249 @@ int semeru_frontswap_load(unsigned type, pgoff_t swap_entry_offset, struct page
 #endif // end of DEBUG_FRONTSWAP_ONLY
 
 out:
+#ifdef SEMERU_CHUNK_MIGRATION
+	fs_migrate_end(start_addr, false);
+#endif
+#ifdef SEMERU_FS_CLEAN_SWAPIN
+	if (likely(ret == 0))
+		fs_clean_loaded(start_addr >> PAGE_SHIFT);
+#endif
+	semeru_fault_state_set(fault_addr, 0);
+	trace_semeru_fs_load_exit(swap_entry_offset, mem_addr.mem_server_id, ret);
+	if (likely(ret == 0)) {
+		fs_emu_delay(mem_addr.mem_server_id, PAGE_SIZE);
+		fs_trace_record(trace_type, mem_addr.mem_server_id, semeru_data_addr(start_addr), lat_start);
+		semeru_fault_sample(fault_addr, trace_type, fs_lat_start() - lat_start);
+		fs_lat_record(FS_LAT_LOAD, mem_addr.mem_server_id, lat_start); // the replica server in degraded mode
+	}
 	return ret;
 }
 
+/**
+ * Look up the pte of the user address addr.
+ * Caller must hold mm->mmap_sem.
+ *
+ * return true if addr is swapped out and its page isn't in swap cache, i.e. the memory server has the newest copy.
+ * A page in swap cache is being swapped in or written back, or its async store isn't acked yet.
+ */
+static bool fs_peek_swapped_out(struct mm_struct *mm, unsigned long addr)
+{
+	pgd_t *pgd;
+	p4d_t *p4d;
+	pud_t *pud;
+	pmd_t *pmd;
+	pte_t *ptep;
+	pte_t pte;
+	spinlock_t *ptl;
+	swp_entry_t entry;
+	struct page *page;
+
+	pgd = pgd_offset(mm, addr);
+	if (pgd_none(*pgd) || unlikely(pgd_bad(*pgd)))
+		return false;
+
+	p4d = p4d_offset(pgd, addr);
+	if (p4d_none(*p4d) || unlikely(p4d_bad(*p4d)))
+		return false;
+
+	pud = pud_offset(p4d, addr);
+	if (pud_none(*pud) || unlikely(pud_bad(*pud)))
+		return false;
+
+	pmd = pmd_offset(pud, addr);
+	if (pmd_none(*pmd) || pmd_trans_huge(*pmd))
+		return false; // never touched, or resident
+
+	ptep = pte_offset_map_lock(mm, pmd, addr, &ptl);
+	pte = *ptep;
+	pte_unmap_unlock(ptep, ptl);
+
+	if (!is_swap_pte(pte) || non_swap_entry(pte_to_swp_entry(pte)))
+		return false;
+
+	entry = pte_to_swp_entry(pte);
+	page = find_get_page(swap_address_space(entry), swp_offset(entry));
+	if (page != NULL) {
+		put_page(page);
+		return false;
+	}
+
+	return true;
+}
+
+static void fs_rdma_peek_done(struct ib_cq *cq, struct ib_wc *wc)
+{
+	struct fs_rdma_req *rdma_req = container_of(wc->wr_cqe, struct fs_rdma_req, cqe);
+	struct semeru_rdma_queue *rdma_queue = cq->cq_context;
+	struct ib_device *ibdev = rdma_queue->rdma_session->rdma_dev->dev;
+
+	trace_semeru_rdma_cqe(rdma_queue->rdma_session->mem_server_id, rdma_queue->q_index, SEMERU_WR_FS_READ,
+			      wc->status, wc->byte_len);
+	if (unlikely(wc->status != IB_WC_SUCCESS)) {
+		pr_err("%s status is not success, it is=%d\n", __func__, wc->status);
+	}
+	ib_dma_unmap_single(ibdev, rdma_req->dma_addr, rdma_req->sge.length, DMA_FROM_DEVICE);
+
+	atomic_dec(&rdma_queue->rdma_post_counter);
+	complete(&rdma_req->done);
+}
+
+/**
+ * Registered into kernel as rdma_ops_in_kernel.rdma_peek, sys_do_semeru_rdma_ops type 29.
+ *
+ * Read [addr, addr + size) of a swapped out page of current process from its memory server into buf,
+ * by one RDMA read of size bytes. The page is not swapped in, it takes no slot of the local cache.
+ * Used by the JVM for the sparse accesses to the cold Regions, e.g. a probe of a large hash table.
+ *
+ * The peek is as racy as a load of a field written by another thread. A page swapped in and out again
+ * during the read gives either its old or its new value.
+ *
+ * buf is a kmalloc'ed kernel buffer, the range can't cross the page.
+ *
+ * return :
+ * 	0 for success;
+ * 	1 if the page is resident, or its local copy is the newest. Load it by the normal path;
+ * 	-1 for error.
+ */
+int semeru_rdma_peek(char __user *addr, void *buf, unsigned long size)
+{
+	int ret;
+	int cpu;
+	struct mm_struct *mm = current->mm;
+	struct ib_device *ibdev;
+	struct fs_rdma_req *rdma_req;
+	struct semeru_rdma_queue *rdma_queue;
+	struct rdma_session_context *rdma_session;
+	struct remote_mapping_chunk *remote_chunk_ptr;
+	struct mem_server_addr mem_addr;
+	long offset = semeru_data_offset_of((unsigned long)addr, size);
+	size_t start_addr = (size_t)offset;
+	u64 lat_start = fs_lat_start();
+
+	if (offset < 0 || size == 0 || (start_addr & PAGE_MASK) != ((start_addr + size - 1) & PAGE_MASK)) {
+		pr_err("%s, range [0x%lx, 0x%lx) is not within a page of the data space.\n", __func__, (size_t)addr,
+		       (size_t)addr + size);
+		return -1;
+	}
+
+#ifdef DEBUG_FRONTSWAP_ONLY
+	return 1; // the pages are in local dram
+#endif
+
+	// 1) Only the swapped out pages. The mmap_sem keeps the vma, not the pte.
+	down_read(&mm->mmap_sem);
+	if (!fs_peek_swapped_out(mm, (unsigned long)addr)) {
+		up_read(&mm->mmap_sem);
+		return 1;
+	}
+
+	translate_data_addr_to_mem_server_addr(&mem_addr, start_addr);
+	fs_fence_check(start_addr & PAGE_MASK, FS_FENCE_PEEK);
+	rdma_session = fs_session(mem_addr.window, mem_addr.mem_server_id);
+
+	cpu = get_cpu(); // disable preempt
+	rdma_queue = get_dp_rdma_queue(rdma_session, cpu);
+	if (unlikely(fs_chunk_unavailable(rdma_session, rdma_queue, mem_addr.mem_server_chunk_index))) {
+		// released, or the degraded mode. The normal load knows where the page is.
+		put_cpu();
+		up_read(&mm->mmap_sem);
+		return 1;
+	}
+	remote_chunk_ptr = &(rdma_session->remote_chunk_list.remote_chunk[mem_addr.mem_server_chunk_index]);
+
+	rdma_req = fs_rdma_req_get(rdma_queue);
+	if (unlikely(rdma_req == NULL)) {
+		pr_err("%s, get reserved fs_rdma_req failed. \n", __func__);
+		put_cpu();
+		up_read(&mm->mmap_sem);
+		return -1;
+	}
+
+	// 2) Map the bytes of buf only, the sub-page read.
+	ibdev = rdma_session->rdma_dev->dev;
+	rdma_req->page = NULL;
+	init_completion(&rdma_req->done);
+	rdma_req->dma_addr = ib_dma_map_single(ibdev, buf, size, DMA_FROM_DEVICE);
+	if (unlikely(ib_dma_mapping_error(ibdev, rdma_req->dma_addr))) {
+		pr_err("%s, ib_dma_mapping_error\n", __func__);
+		fs_rdma_req_put(rdma_queue, rdma_req);
+		put_cpu();
+		up_read(&mm->mmap_sem);
+		return -1;
+	}
+	rdma_req->cqe.done = fs_rdma_peek_done;
+
+	rdma_req->sge.addr = rdma_req->dma_addr;
+	rdma_req->sge.length = (u32)size;
+	rdma_req->sge.lkey = rdma_session->rdma_dev->pd->local_dma_lkey;
+
+	rdma_req->rdma_wr.wr.next = NULL;
+	rdma_req->rdma_wr.wr.wr_cqe = &rdma_req->cqe;
+	rdma_req->rdma_wr.wr.sg_list = &(rdma_req->sge);
+	rdma_req->rdma_wr.wr.num_sge = 1;
+	rdma_req->rdma_wr.wr.opcode = IB_WR_RDMA_READ;
+	rdma_req->rdma_wr.wr.send_flags = IB_SEND_SIGNALED;
+	rdma_req->rdma_wr.remote_addr = remote_chunk_ptr->remote_addr + mem_addr.mem_server_offset_within_chunk;
+	rdma_req->rdma_wr.rkey = remote_chunk_ptr->remote_rkey;
+
+	// 3) A demand read like the swap-in, the control path holds its bulk traffic until it's done.
+	atomic_inc(&rdma_session->demand_loads);
+	ret = fs_enqueue_send_wr(rdma_session, rdma_queue, rdma_req);
+	put_cpu(); // enable preeempt.
+	if (unlikely(ret)) {
+		atomic_dec(&rdma_session->demand_loads);
+		ib_dma_unmap_single(ibdev, rdma_req->dma_addr, size, DMA_FROM_DEVICE);
+		fs_rdma_req_put(rdma_queue, rdma_req);
+		up_read(&mm->mmap_sem);
+		pr_err("%s, enqueuing rdma peek failed.\n", __func__);
+		return -1;
+	}
+
+	wait_rdma_queue(rdma_queue);
+	ret = wait_for_completion_timeout(&(rdma_req->done), msecs_to_jiffies(5));
+	atomic_dec(&rdma_session->demand_loads);
+	up_read(&mm->mmap_sem);
+	if (unlikely(ret == 0)) {
+		pr_err("%s, rdma_queue[%d] wait for rdma_req timeout for 5ms.\n", __func__, rdma_queue->q_index);
+		return -1;
+	}
+	fs_rdma_req_put(rdma_queue, rdma_req);
+
+	fs_lat_record(FS_LAT_PEEK, mem_addr.mem_server_id, lat_start);
+	return 0;
+}
+
 static void semeru_invalidate_page(unsigned type, pgoff_t offset)
 {
+#if defined(SEMERU_FS_PREFETCH) || defined(SEMERU_FS_COMPRESS) || defined(SEMERU_FS_INVALIDATE) || \
+	defined(SEMERU_FS_LOCAL_TIER) || defined(SEMERU_FS_CLEAN_SWAPIN)
+	struct mem_server_addr mem_addr;
+	size_t data_page = translate_to_mem_server_addr(&mem_addr, offset) >> PAGE_SHIFT;
+#endif
+
+#ifdef SEMERU_FS_PREFETCH
+	// The swap entry is freed, its prefetched copy is useless.
+	fs_prefetch_invalidate(data_page);
+#endif
+
+#ifdef SEMERU_FS_COMPRESS
+	fs_compress_invalidate(data_page);
+#endif
+
+#ifdef SEMERU_FS_INVALIDATE
+	// The memory server can discard its copy.
+	fs_invalidate_page(mem_addr.mem_server_id, data_page);
+#endif
+
+#ifdef SEMERU_FS_LOCAL_TIER
+	fs_local_drop(data_page);
+#endif
+
+#ifdef SEMERU_FS_CLEAN_SWAPIN
+	// The slot is freed, e.g. by a write fault, the remote copy goes stale.
+	fs_clean_forget(data_page);
+#endif
+
 #ifdef DEBUG_MODE_DETAIL
 	pr_info("%s, remove page_virt addr 0x%lx\n", __func__, offset << PAGE_OFFSET);
 #endif
@@ -613,13 +2965,17 @@ static void semeru_invalidate_page(unsigned type, pgoff_t offset)
 
 /**
  * Remove the stale pages
- * 
+ * The swap area is off, all its slots are invalidated one by one before. Send the last batches.
  */
 static void semeru_invalidate_area(unsigned type)
 {
 	#ifdef DEBUG_MODE_DETAIL
 		pr_warn("%s, remove the pages of area 0x%x ?\n", __func__, type);
 	#endif
+
+#ifdef SEMERU_FS_INVALIDATE
+	fs_invalidate_flush();
+#endif
 	return;
 }
 
@@ -644,6 +3000,84 @@ static struct frontswap_ops semeru_frontswap_ops = {
 
 
 int semeru_init_frontswap(void){
+#if defined(SEMERU_FS_PREFETCH) || defined(SEMERU_FS_COMPRESS) || defined(SEMERU_FS_ZERO_PAGE) || \
+	defined(SEMERU_FS_INVALIDATE) || defined(SEMERU_TRANSPORT) || defined(SEMERU_FS_ASYNC_STORE)
+	int ret;
+#endif
+
+#ifdef SEMERU_FS_ASYNC_STORE
+	ret = init_fs_store_inflight();
+	if (unlikely(ret))
+		return ret;
+#endif
+
+#ifdef SEMERU_FS_PREFETCH
+
+	ret = init_fs_prefetch();
+	if (unlikely(ret)) {
+		pr_err("%s, init frontswap prefetch failed.\n", __func__);
+		return ret;
+	}
+#endif
+
+#ifdef SEMERU_FS_COMPRESS
+	ret = init_fs_compress();
+	if (unlikely(ret)) {
+		pr_err("%s, init the compressed local tier failed.\n", __func__);
+		return ret;
+	}
+#endif
+
+#ifdef SEMERU_FS_ZERO_PAGE
+	ret = init_fs_zero_map();
+	if (unlikely(ret)) {
+		pr_err("%s, init the zero page map failed.\n", __func__);
+		return ret;
+	}
+#endif
+
+#ifdef SEMERU_FS_INVALIDATE
+	ret = init_fs_invalidate();
+	if (unlikely(ret)) {
+		pr_err("%s, init the remote slot reclamation failed.\n", __func__);
+		return ret;
+	}
+#endif
+
+#ifdef SEMERU_FS_COLD
+	ret = init_fs_cold();
+	if (unlikely(ret)) {
+		pr_err("%s, init the cold tier failed.\n", __func__);
+		return ret;
+	}
+#endif
+
+#ifdef SEMERU_FS_CLEAN_SWAPIN
+	ret = init_fs_clean_map();
+	if (unlikely(ret))
+		return ret;
+#endif
+
+	ret = init_fs_replica();
+	if (unlikely(ret))
+		return ret;
+
+#ifdef SEMERU_TRANSPORT_CXL
+	ret = init_fs_cxl();
+	if (unlikely(ret)) {
+		pr_err("%s, map the CXL windows failed.\n", __func__);
+		return ret;
+	}
+#endif
+
+#ifdef SEMERU_TRANSPORT_TCP
+	ret = init_fs_tcp();
+	if (unlikely(ret)) {
+		pr_err("%s, connect the TCP transport failed.\n", __func__);
+		return ret;
+	}
+#endif
+
 	frontswap_register_ops(&semeru_frontswap_ops); // will enable the frontswap path
 
 	#ifdef DEBUG_FRONTSWAP_ONLY
@@ -657,6 +3091,8 @@ int semeru_init_frontswap(void){
 
 
 void semeru_exit_frontswap(void){
+	int i;
+
 	#ifdef DEBUG_FRONTSWAP_ONLY
 		semeru_remove_local_dram();
 	#endif
@@ -671,6 +3107,68 @@ void semeru_exit_frontswap(void){
 	pr_info("2) Remove all registered frontswap_ops from the link list.\n");
 
 	frontswap_deregister_ops();
+
+	for (i = 0; rdma_session_global_ptr != NULL && i < fs_num_sessions(); i++)
+		pr_warn("%s, window[%d] memory server[%d] stores throttled for credit %d, control path yields to swap-ins %d\n",
+			__func__, rdma_session_global_ptr[i].window, rdma_session_global_ptr[i].mem_server_id,
+			atomic_read(&rdma_session_global_ptr[i].credit_stalls),
+			atomic_read(&rdma_session_global_ptr[i].cp_yields));
+	pr_warn("%s, stores of the free Regions discarded %ld\n", __func__, atomic_long_read(&fs_discarded_stores));
+#ifdef SEMERU_FS_CLEAN_SWAPIN
+	free_fs_clean_map();
+#endif
+	free_fs_replica();
+
+#ifdef SEMERU_FS_LATENCY_HIST
+	fs_lat_print_stats();
+#endif
+
+#ifdef SEMERU_FS_EMULATE
+	fs_emulate_print_stats();
+#endif
+
+#ifdef SEMERU_FS_PREFETCH
+	fs_prefetch_print_stats();
+	free_fs_prefetch();
+#endif
+
+#ifdef SEMERU_FS_COMPRESS
+	fs_compress_print_stats();
+	free_fs_compress();
+#endif
+
+#ifdef SEMERU_FS_ZERO_PAGE
+	fs_zero_print_stats();
+	free_fs_zero_map();
+#endif
+
+#ifdef SEMERU_FS_ASYNC_STORE
+	free_fs_store_inflight();
+#endif
+
+#ifdef SEMERU_FS_INVALIDATE
+	fs_invalidate_print_stats();
+	free_fs_invalidate();
+#endif
+
+#ifdef SEMERU_FS_COLD
+	fs_cold_print_stats();
+	free_fs_cold();
+#endif
+
+#ifdef SEMERU_FS_LOCAL_TIER
+	free_fs_local();
+#endif
+
+#ifdef SEMERU_TRANSPORT_CXL
+	fs_cxl_print_stats();
+	free_fs_cxl();
+#endif
+
+#ifdef SEMERU_TRANSPORT_TCP
+	fs_tcp_print_stats();
+	free_fs_tcp();
+#endif
 }
 
 
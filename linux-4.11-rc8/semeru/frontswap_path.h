@@ -39,9 +39,13 @@
 #include <linux/slab.h> // kmem_cache
 #include <linux/debugfs.h>
 #include <linux/vmalloc.h>
+#include <linux/mmu_notifier.h>
+#include <linux/mutex.h>
 #include <linux/delay.h>
 #include <linux/page-flags.h>
+#include <linux/highmem.h>
 #include <linux/smp.h>
+#include <linux/workqueue.h>
 
 // Semeru
 #include <linux/swap_global_struct_bd_layer.h>
@@ -99,7 +103,14 @@ enum message_type {
 	REQUEST_SINGLE_CHUNK, // Send a request to ask for a single chunk.
 	QUERY, // 10
 
-	AVAILABLE_TO_QUERY // 11 This memory server is oneline to server.
+	AVAILABLE_TO_QUERY, // 11 This memory server is oneline to server.
+
+	EXPAND_CHUNKS, // 12 Request the chunks whose buf[i] is non-zero. Responded by GOT_CHUNKS.
+	RELEASE_CHUNKS, // 13 Return the chunks whose buf[i] is non-zero. Responded by DONE.
+	REATTACH, // 14 Reconnected to a restarted memory server. FREE_SIZE if it kept the data Regions, DONE otherwise.
+	INVALIDATE_PAGES, // 15 Discard the dead pages of a window, see frontswap_invalidate.c. Responded by DONE.
+	COLD_BLOCKS, // 16 Hand the cold blocks of a window over to the memory server, see frontswap_cold.c. Responded by DONE.
+	FETCH_BLOCK // 17 Restore a handed over block before accessing it. Responded by DONE.
 };
 
 /**
@@ -119,6 +130,24 @@ struct message {
 	enum message_type type;
 };
 
+/**
+ * The digest of the RDMA meta layout, the private data of the connect request.
+ * Keep the same with gc/shared/rdmaMetaLayout.hpp of the JVMs.
+ * The module doesn't know the Region size, the meta space usage and the object layout of the JVM,
+ * SEMERU_META_LAYOUT_KERNEL_MAGIC lets the memory server check the rest, the topology and the heap, only.
+ */
+#define SEMERU_META_LAYOUT_KERNEL_MAGIC 0x534d4c4b // "SMLK"
+
+struct semeru_meta_layout_digest {
+	u32 magic;
+	u32 mem_server_num;
+	u64 heap_size; // the data space
+	u64 region_size;
+	u64 used_size;
+	u32 use_compressed_oops;
+	u32 obj_alignment;
+};
+
 // The semeru_rdma_req_sg type
 enum rdma_seq_type {
 	CONTROL_PATH_MEG, //0
@@ -166,10 +195,17 @@ struct remote_mapping_chunk {
 struct remote_mapping_chunk_list {
 	struct remote_mapping_chunk *remote_chunk;
 	uint32_t remote_free_size; // total mapped byte size. Accumulated each remote_mapping_chunk[i]->mapped_size
-	uint32_t chunk_num; // length of remote_chunk list
-	uint32_t chunk_ptr; // points to first empty chunk.
+	uint32_t chunk_num; // length of remote_chunk list, the capacity of the memory server.
+	uint32_t chunk_ptr; // number of MAPPED chunks.
+
+	// Elastic capacity. The JVM expands/releases the chunks along with its heap, sys_do_semeru_rdma_ops type 17/18.
+	// remote_chunk[i] is the chunk i of the memory server, the same index with the message buf[i].
+	struct mutex resize_lock; // one EXPAND_CHUNKS/RELEASE_CHUNKS request on the fly.
+	struct completion resize_done; // completed by the GOT_CHUNKS/DONE response.
 };
 
+#define CHUNK_RESIZE_TIMEOUT_MS 5000 // The memory server registers, or deregisters, the chunks as RDMA buffer.
+
 /**
  * 1-sided RDMA (read/write) message.
  * Both Semeru Control Path(CP) and Data Path(DP) use this rdma command structu.
@@ -193,6 +229,14 @@ struct remote_mapping_chunk_list {
  *	Build a seperate WR for each I/O request and sent them to remote memory pool via  RDMA read/write.
  * 
  */
+/**
+ * The control path writes of at most CP_RDMA_INLINE_MAX bytes in the meta space, e.g. flags_of_cpu_server_state,
+ * are copied into the WQE by IB_SEND_INLINE. The exact bytes are written, the user page is neither pinned nor mapped,
+ * and the neighbour bytes of the page are not overwritten on the memory server.
+ * The QP asks for this inline size at creation, a device offering less uses the page path.
+ */
+#define CP_RDMA_INLINE_MAX		64
+
 struct semeru_rdma_req_sg {
 	struct semeru_rdma_queue *rdma_queue;
 
@@ -208,6 +252,12 @@ struct semeru_rdma_req_sg {
 	// points to the physical pages of i/o requset.
 	u64 nentry; // number of the segments, usually one pysical page per segment
 	struct scatterlist sgl[MAX_REQUEST_SGL]; // store the dma address
+
+	bool release_at_done; // nobody waits on it, free it in the CQ callback.
+	struct cp_rdma_ticket *ticket; // vectored control path, the ticket to notify at done. Can be NULL.
+	bool meta_reg; // sge are built from the registered meta space, no dma unmap at done.
+	bool inlined; // the bytes are copied into the WQE from inline_data, nothing is mapped.
+	u8 inline_data[CP_RDMA_INLINE_MAX];
 };
 
 /**
@@ -224,6 +274,446 @@ struct fs_rdma_req {
 
 	struct completion done; // spinlock. caller wait on it.
 	struct semeru_rdma_queue *rdma_queue; // which rdma_queue is enqueued.
+	size_t data_page; // the replica write, its page in the data space.
+#ifdef SEMERU_FS_DMA_BOUNCE
+	struct fs_dma_bounce *bounce; // the page is copied through it, NULL if the page itself is mapped.
+#endif
+};
+
+/**
+ * Doorbell batching.
+ * 
+ * Chain multiple wr via wr.next and post them by one ib_post_send, i.e. ring the doorbell once.
+ * Only every WR_BATCH_SIGNAL_INTERVAL-th wr, and the last wr of the chain, is IB_SEND_SIGNALED.
+ * The CQE of a signaled wr implies all the previous wr on the QP are done,
+ * so its completion runs the done() of all the wr in its group, in post order.
+ * 
+ * Each wr still holds one rdma_post_counter, released by its own done() as before.
+ * Once a wr is added to a batch, its done() is always invoked,
+ * with IB_WC_WR_FLUSH_ERR if the wr can't be posted.
+ */
+#define WR_BATCH_SIGNAL_INTERVAL	16 // wr per CQE
+#define WR_BATCH_MAX_WR			64 // post the chain when it grows this long
+
+struct semeru_wr_group {
+	struct ib_cqe cqe; // replaces the wr_cqe of the signaled wr
+	int nr_wr;
+	struct ib_cqe *wr_cqe[WR_BATCH_SIGNAL_INTERVAL]; // the original wr_cqe of each wr in the group
+	bool fenced; // signaled by fence_wr, which holds one rdma_post_counter too.
+	struct ib_rdma_wr fence_wr; // a zero-length write closing the part of a group taken by a failed post.
+};
+
+// Built on the caller's stack, not thread-safe.
+struct semeru_wr_batch {
+	struct semeru_rdma_queue *rdma_queue;
+	struct ib_send_wr *head;
+	struct ib_send_wr *tail;
+	int nr_wr;
+	struct semeru_wr_group *group; // the open group, NULL if none.
+};
+
+/**
+ * Incremental control path write.
+ * 
+ * Only the pages written since the last sync are sent, found by the soft-dirty bit of their pte.
+ * The soft-dirty bit is cleared and the pte is write-protected after the page is picked,
+ * the next write to the page faults and marks it soft-dirty again.
+ * The dirty runs are collected into semeru_rdma_iovec and posted by semeru_cp_rdma_writev().
+ * 
+ * Warning : a range has to be always synced to the same memory servers.
+ * 	Syncing it to server #0 cleans the pages for server #1 too.
+ */
+#define CP_DIRTY_IOV_NUM		256 // dirty runs posted by one vectored write
+#define CP_DIRTY_ALL_SERVERS		(-1) // target_server of a broadcast sync
+
+/**
+ * Vectored control path.
+ * 
+ * The JVM sends a batch of metadata structures, each one is a semeru_rdma_iovec, by one syscall.
+ * All the packages to the same memory server are chained and posted by the doorbell batching.
+ * Every package is released in its CQ callback and decreases the pending counter of the ticket.
+ * 
+ * The async caller gets the ticket id back and waits on it later, sys_do_semeru_rdma_ops type 12.
+ * A signal entry, write_type != 0, still drains all the previous messages before being posted.
+ */
+#define CP_RDMA_TICKET_NUM		64
+#define CP_RDMA_WAIT_TIMEOUT_MS		100 // the whole vector may carry several Regions.
+
+// Keep the same layout with the one in kernel, extra_syscall/semeru_syscall.h
+struct semeru_rdma_iovec {
+	int mem_server_id;
+	int write_type; // 0 for data, 1 for signal
+	char __user *start_addr;
+	unsigned long size;
+};
+
+struct cp_rdma_ticket {
+	atomic_t pending; // outstanding packages. Biased by 1 until all of them are posted.
+	struct completion done;
+	int status; // 0, or -EIO if any package failed.
+	bool in_use;
+	bool orphaned; // the waiter timed out, the last completion releases the ticket.
+	struct page **pages; // the user pages pinned until the packages finish, async only.
+	unsigned long nr_pages;
+	unsigned long server_mask; // the memory servers whose control path queue needs polling.
+	int window; // the address window of the packages, they go to its sessions.
+	int q_index; // the control path queue of each memory server the packages are posted to.
+};
+
+/**
+ * Registered meta space.
+ * 
+ * The JVM registers the meta space once, sys_do_semeru_rdma_ops type 13.
+ * A meta page is pinned and mapped to the RDMA device at its first control path transfer,
+ * then its dma address is reused by all the following transfers. No page walking or dma map/unmap per call.
+ * A page which can't be pinned without sleeping, e.g. never touched, is sent by the per-call mapping instead.
+ * 
+ * The registration belongs to the mm of the registering JVM, only the transfers of that mm use it.
+ * The pinned pages are released when the JVM unregisters the space, size 0, when its mm is torn down,
+ * e.g. it exits without unregistering, or when the module exits.
+ * The JVM never uncommits the meta space, so the pinned pages stay valid.
+ */
+struct cp_meta_reg {
+	char __user *start_addr;
+	unsigned long nr_pages;
+	struct page **pages; // NULL entry : not pinned yet.
+	u64 *dma_addr;
+	struct mm_struct *mm; // the registering mm
+	spinlock_t lock;
+	bool enabled;
+};
+
+/**
+ * Memory server state notification.
+ * 
+ * The memory server pushes its state transitions, e.g. the end of its compaction, by a zero-byte
+ * RDMA send-with-immediate on rdma_queues[MEM_SERVER_NOTIFY_QUEUE]. The imm_data is the state.
+ * CP_NOTIFY_RECV_NUM recv wr are kept posted on the queue, each one is re-posted by its done().
+ * The JVM sleeps until the state is reached, sys_do_semeru_rdma_ops type 15,
+ * instead of reading the flags_of_mem_server_state again and again.
+ * 
+ * The recv wr are not counted in rdma_post_counter, nobody drains the queue for them.
+ * The states of one STW window increase, the JVM resets the state to 0 at the start of the window.
+ */
+#define MEM_SERVER_NOTIFY_QUEUE		0 // the memory server only has a CQ for its first QP.
+#define CP_NOTIFY_RECV_NUM		4
+#define CP_NOTIFY_TIMEOUT_MS		1000 // the JVM falls back to reading the flags.
+
+struct cp_notify_recv {
+	struct ib_cqe cqe;
+	struct ib_recv_wr rq_wr; // no sge, only the imm_data is received.
+	struct rdma_session_context *rdma_session;
+};
+
+struct cp_notify {
+	struct cp_notify_recv recv[CP_NOTIFY_RECV_NUM];
+	atomic_t state; // the latest state pushed by the memory server.
+	wait_queue_head_t wait;
+	bool enabled; // the recv wr are posted.
+};
+
+/**
+ * CPU server doorbell.
+ * 
+ * The reverse direction of the notification. After writing a new CSet or the STW flags,
+ * the JVM rings the memory server by a zero-byte RDMA send-with-immediate on
+ * rdma_queues[MEM_SERVER_NOTIFY_QUEUE], sys_do_semeru_rdma_ops type 16. The imm_data is a sequence number.
+ * The memory server sleeps on its CQ event channel for it, instead of waking up periodically to check the CSet.
+ * 
+ * The send is signaled and counted in rdma_post_counter. One outstanding doorbell per session.
+ */
+struct cp_doorbell {
+	struct ib_cqe cqe;
+	struct ib_send_wr sq_wr; // no sge, only the imm_data is sent.
+	struct semeru_rdma_queue *rdma_queue;
+	struct mutex lock;
+};
+
+/**
+ * CPU server remote atomics.
+ * 
+ * The JVM claims and releases a Region by a CAS or fetch-and-add on its 8 bytes state word in the meta space,
+ * sys_do_semeru_rdma_ops type 28. The memory server's RDMA device executes the atomic on its copy of the word,
+ * no page is swapped in or written back, and the memory server doesn't have to be in a handshake with the CPU server.
+ * The old value is returned into the DMA buffer result.
+ * 
+ * The atomic is posted on rdma_queues[MEM_SERVER_NOTIFY_QUEUE] like the doorbell. One outstanding atomic per session.
+ */
+#define SEMERU_RDMA_ATOMIC_CAS		0
+#define SEMERU_RDMA_ATOMIC_FETCH_ADD	1
+
+// Keep the same layout with the one in kernel, extra_syscall/semeru_syscall.h
+struct semeru_rdma_atomic {
+	int op; // SEMERU_RDMA_ATOMIC_xx
+	int pad;
+	char __user *addr; // 8 bytes aligned, within the meta space
+	uint64_t compare_add; // the expected value of CAS, or the addend of fetch-and-add
+	uint64_t swap; // the new value of CAS
+	uint64_t result; // the old value of the word
+};
+
+struct cp_atomic {
+	struct ib_cqe cqe;
+	struct ib_atomic_wr atomic_wr;
+	struct ib_sge sge;
+	uint64_t *result; // 8 bytes DMA buffer, written by the RDMA device.
+	u64 result_dma_addr;
+	enum ib_wc_status status;
+	struct semeru_rdma_queue *rdma_queue;
+	struct mutex lock;
+	bool enabled; // the RDMA device supports the atomics.
+};
+
+/**
+ * Region fence of the concurrent compaction.
+ * 
+ * The memory server compacts the Regions fully evicted by the CPU server out of the STW window.
+ * The JVM grants a Region to it by fencing the data space range, sys_do_semeru_rdma_ops type 20.
+ * 1) The frontswap loads and stores on a granted range are recorded by page.
+ * 	A page loaded and written back to its memory server is reconciled by the memory server at the commit.
+ * 	A page still loaded, or stored locally, or too many pages, revoke the grant, the compaction result is discarded.
+ * 2) At the start of the STW window, the JVM closes the grant. An intact or reconcilable range becomes committing,
+ * 	the faults on it wait until the memory server copied its compacted image back and the JVM released it.
+ * The ranges are data offsets, see semeru_data_offset_of().
+ * The ranges of an address window belong to the mm of the JVM granting them, they are dropped at its exit,
+ * at the first grant of another JVM in the window, and at the module exit.
+ * A fault waits FS_FENCE_COMMIT_TIMEOUT_MS at most for a committing range, then drops it.
+ */
+#define FS_FENCE_MAX_RANGES 	64
+#define FS_FENCE_COMMIT_TIMEOUT_MS 	10000 // longer than the JVM waits for the commit, SemeruConcurrentCompactCommitWaits.
+#define FS_FENCE_MAX_PAGES 	32 // loaded or written pages recorded per range, the same as SEMERU_FENCE_MAX_PAGES of the JVM.
+
+#define FS_FENCE_OP_GRANT 	0
+#define FS_FENCE_OP_CLOSE 	1
+#define FS_FENCE_OP_RELEASE 	2
+#define FS_FENCE_OP_REWRITE 	3 // the memory server rewrites the range in place, write back and drop the local copies.
+#define FS_FENCE_OP_WRITTEN 	4 // the pages written into a range closed as reconcilable, see struct fs_fence_written.
+
+enum fs_fence_state {
+	FS_FENCE_FREE = 0,
+	FS_FENCE_GRANTED,
+	FS_FENCE_REVOKED, // a page is swapped in and not written back, or too many pages
+	FS_FENCE_COMMITTING
+};
+
+enum fs_fence_access {
+	FS_FENCE_LOAD = 0,
+	FS_FENCE_STORE,
+	FS_FENCE_PEEK // a RDMA read of a swapped out page, it stays out.
+};
+
+struct fs_fence_range {
+	size_t start;
+	size_t end;
+	enum fs_fence_state state;
+	unsigned int nr_loaded; // swapped in, not written back yet
+	unsigned int nr_written; // written back to the memory server since the grant
+	unsigned int loaded[FS_FENCE_MAX_PAGES]; // page index within the range
+	unsigned int written[FS_FENCE_MAX_PAGES];
+};
+
+/**
+ * The user buffer of FS_FENCE_OP_WRITTEN. start is filled by the JVM, the rest by the kernel.
+ */
+struct fs_fence_written {
+	u64 start; // the user address of the range
+	u32 nr_pages;
+	u32 pages[FS_FENCE_MAX_PAGES];
+};
+
+/**
+ * Asynchronous frontswap store.
+ * 
+ * 1) A store stages the page into the store ring of current core's rdma_queue
+ * 	and returns without waiting for the RDMA write.
+ * 2) Pages with consecutive remote addresses in the same remote_mapping_chunk
+ * 	are coalesced into one multi-SGE RDMA write, at most FS_STORE_BATCH_PAGES pages.
+ * 3) The batch is released in the CQ callback, fs_rdma_batch_write_done().
+ * 
+ * The staged page is pinned by an extra reference until the write is done, its data page is marked in the
+ * in-flight store map meanwhile. A batch that isn't written redirties its pages, they're stored again.
+ * The extra reference keeps the page in swap cache, so a swap-in can never read a stale remote copy.
+ * 
+ */
+#define FS_STORE_BATCH_SGE 		(MAX_REQUEST_SGL - 2) // the same S/G limit as the control path
+#define FS_STORE_RING_DEPTH 		64 // batches per rdma_queue, MUST be power of 2.
+#define FS_STORE_FLUSH_DELAY_US 	50 // post a partial batch if no new page comes in.
+
+/**
+ * Extent store, for the bulk eviction of cold Regions.
+ * 
+ * The sub-pages of a split THP stay physically contiguous.
+ * When the DMA address of a page follows the last sge, extend the sge instead of taking a new one.
+ * A whole 2MB extent, aligned to FS_STORE_EXTENT_SIZE on the memory server, can then be sent by one RDMA write with one sge.
+ * Under fragmentation, the batch falls back to one sge per page fragment, at most FS_STORE_BATCH_SGE sges.
+ */
+#ifdef SEMERU_FS_STORE_EXTENT
+#define FS_STORE_EXTENT_SIZE		(1UL << 21) // THP size
+#define FS_STORE_BATCH_PAGES		(FS_STORE_EXTENT_SIZE >> PAGE_SHIFT)
+#else
+#define FS_STORE_BATCH_PAGES		FS_STORE_BATCH_SGE
+#endif
+
+struct fs_rdma_batch_req {
+	struct ib_cqe cqe; // CQE complete function
+	struct ib_sge sge_list[FS_STORE_BATCH_SGE]; // one physically contiguous fragment per sge
+	struct ib_rdma_wr rdma_wr; // wr for 1-sided RDMA write.
+	int nr_sge;
+
+	struct page *pages[FS_STORE_BATCH_PAGES];
+	u64 dma_addr[FS_STORE_BATCH_PAGES];
+	int nr_pages;
+
+	// The remote range covered by current batch
+	size_t chunk_index;
+	size_t next_offset_within_chunk; // the offset of the next page can be appended.
+	size_t start_data_page; // page index of the first page, of the data offset
+};
+
+/**
+ * Ring of fs_rdma_batch_req, one per rdma_queue.
+ * 	reqs[head, tail) are posted and not acked yet.
+ * 	reqs[tail] is the open batch, if batch_open is true.
+ * 
+ * The producers, store path and flush worker, are serialized by the lock.
+ * The consumer, CQ callback, only moves head forward.
+ * 1-sided RDMA wr on the same QP complete in order, so the ring is freed in FIFO.
+ */
+struct fs_store_ring {
+	spinlock_t lock;
+	unsigned int head;
+	unsigned int tail;
+	bool batch_open;
+
+	struct delayed_work flush_work; // post the partial batch and reap the completions.
+	struct fs_rdma_batch_req reqs[FS_STORE_RING_DEPTH];
+};
+
+/**
+ * Swap-in prefetch.
+ * 
+ * 1) After a demand load, the prefetcher selects some neighbouring pages, in the same chunk,
+ * 	by the policy and issues asynchronous RDMA reads for them.
+ * 2) The prefetched pages are kept in a direct-mapped cache indexed by the data page index,
+ * 	the page of the data offset.
+ * 3) The following frontswap load checks the cache first, e.g. the loads issued by swapin_readahead().
+ * 
+ * A store to the page invalidates its cached copy, after the RDMA write is acked.
+ * 
+ */
+#define FS_PREFETCH_SLOT_SHIFT		12
+#define FS_PREFETCH_SLOT_NUM		(1UL << FS_PREFETCH_SLOT_SHIFT) // 16MB prefetched data at most
+#define FS_PREFETCH_SLOT_MASK		(FS_PREFETCH_SLOT_NUM - 1)
+#define FS_PREFETCH_WINDOW		8 // pages issued per demand load
+#define FS_PREFETCH_WINDOW_MAX		32 // upper bound of the JVM hinted window
+#define FS_PREFETCH_MAX_STRIDE		64 // in pages, larger strides are treated as random access
+#define FS_PREFETCH_HINT_NUM		16 // ranges hinted by the JVM at the same time
+#define FS_PREFETCH_RANGE_MAX		(FS_PREFETCH_SLOT_NUM / 4) // pages read per range prefetch at most
+#define FS_PREFETCH_RANGE_BATCH		256 // pages posted per doorbell by the range prefetch
+#define FS_FETCH_ASYNC_MAX		64 // pages checked per non-blocking fetch at most, on the stack
+#define FS_PREFETCH_DEFAULT_POLICY	FS_PREFETCH_STRIDE // policy for the un-hinted ranges
+
+enum fs_prefetch_policy_type {
+	FS_PREFETCH_SEQUENTIAL = 0,
+	FS_PREFETCH_STRIDE,
+	FS_PREFETCH_HINTED,
+	FS_PREFETCH_AFFINITY,
+	FS_PREFETCH_POLICY_NUM
+};
+
+enum fs_prefetch_slot_state {
+	FS_SLOT_EMPTY = 0,
+	FS_SLOT_INFLIGHT, // RDMA read is posted
+	FS_SLOT_READY // data arrived
+};
+
+struct fs_prefetch_slot {
+	spinlock_t lock;
+	enum fs_prefetch_slot_state state;
+	bool stale; // the page was stored again during the read, drop the data.
+	size_t data_page; // the key
+
+	struct page *page;
+	u64 dma_addr;
+	struct semeru_rdma_queue *rdma_queue; // which rdma_queue is enqueued.
+
+	struct ib_cqe cqe; // CQE complete function
+	struct ib_sge sge;
+	struct ib_rdma_wr rdma_wr;
+};
+
+// Per core access history, used by the stride policy.
+struct fs_prefetch_stream {
+	size_t last_page;
+	long stride;
+	int confidence; // times the stride repeats
+	size_t affinity_group; // 1 + the lowest page of the last ring prefetched, 0 for none
+};
+
+// [start_page, end_page) will be scanned by the JVM, e.g. the Regions in CSet.
+struct fs_prefetch_hint {
+	size_t start_page;
+	size_t end_page;
+	int window; // 0 for a free hint
+};
+
+// The policy fills the data pages to be prefetched into candidates[].
+// return the number of candidates.
+struct fs_prefetch_policy {
+	const char *name;
+	int (*select)(struct fs_prefetch_stream *stream, struct fs_prefetch_hint *hint, size_t data_page,
+		      size_t *candidates, int max);
+};
+
+/**
+ * Zero page elision, one bit per data page for the memory server's copy is all zero.
+ * Returned by fs_zero_store().
+ */
+#define FS_ZERO_NONE		0 // write the page as usual
+#define FS_ZERO_WRITE		1 // write the zero page, then fs_zero_store_done()
+#define FS_ZERO_ELIDED		2 // the memory server has the zero page, no write
+
+/**
+ * Compressed local tier.
+ *
+ * 1) A frontswap store writes the page to the memory server as before, then keeps an LZ4 compressed copy
+ * 	in a local zsmalloc pool, indexed by the data page index. The zero pages only take an entry.
+ * 2) A frontswap load takes the compressed copy out of the pool, exclusively, the page is in swap cache after it.
+ * 3) The pool is bounded by compress_pool_mb. The least recently stored copies are dropped first,
+ * 	the memory server has the data of every entry, nothing is written back.
+ *
+ * The memory servers compact the swapped out pages in place. The JVM drops the copies of its memory server CSet
+ * by FS_FENCE_OP_REWRITE, the committed grants of the concurrent compaction are dropped at FS_FENCE_OP_CLOSE.
+ */
+#define FS_COMPRESS_MAX_SIZE		(PAGE_SIZE * 3 / 4) // keep the pages compressed to 75% or less
+#define FS_COMPRESS_EVICT_BATCH		32 // copies dropped per store at most, when the pool is full
+
+struct fs_compress_entry {
+	struct rb_node rbnode; // in fs_compress_tree, keyed by data_page
+	struct list_head lru; // the most recently stored first
+	size_t data_page; // page index, of the data offset
+	unsigned long handle; // zsmalloc handle, 0 for a zero page
+	unsigned int length; // compressed bytes, 0 for a zero page
+};
+
+/**
+ * Latency histograms, one set per core, see frontswap_stats.c.
+ * Bucket b counts the samples in [2^(b-1), 2^b) ns, the last bucket also holds the longer ones.
+ */
+#define FS_LAT_BUCKETS		32 // up to 2s
+
+enum fs_lat_type {
+	FS_LAT_STORE = 0, // semeru_frontswap_store()
+	FS_LAT_LOAD, // semeru_frontswap_load()
+	FS_LAT_CP_READ, // semeru_cp_rdma_read()
+	FS_LAT_CP_WRITE, // semeru_cp_rdma_write()
+	FS_LAT_CQ_DRAIN, // drain_rdma_queue() and wait_rdma_queue() with outstanding wr
+	FS_LAT_PEEK, // semeru_rdma_peek()
+	FS_LAT_TYPE_NUM
+};
+
+struct fs_lat_hist {
+	u64 bucket[FS_LAT_TYPE_NUM][MAX_NUM_OF_MEMORY_SERVER][FS_LAT_BUCKETS];
 };
 
 struct two_sided_rdma_send {
@@ -246,6 +736,49 @@ struct two_sided_rdma_recv {
 	struct semeru_rdma_queue *rdma_queue; // which rdma_queue is enqueued.
 };
 
+/**
+ * Preallocated requests of a rdma_queue.
+ * 
+ * The frontswap store/load runs under memory pressure, a GFP_ATOMIC allocation can fail right then.
+ * Each rdma_queue keeps a free stack of requests, allocated on the node of its core at connection.
+ * The slab cache is only the spill when the stack is empty, e.g. requests leaked by a timed out wait.
+ * Taken and returned under the lock, the CQ handler returns the requests nobody waits on.
+ */
+#define FS_REQ_POOL_DEPTH	256 // fs_rdma_req per rdma_queue, for the synchronous data path and the replicas.
+#define CP_REQ_POOL_DEPTH	64 // semeru_rdma_req_sg per rdma_queue, it's about 2KB.
+
+struct semeru_req_pool {
+	spinlock_t lock;
+	int nr_free;
+	int depth;
+	size_t obj_size;
+	void *objs; // depth objects, contiguous
+	void **free; // stack of the free objects
+	struct kmem_cache *cache; // spill when the stack is empty
+	atomic_t spills;
+};
+
+#ifdef SEMERU_FS_DMA_BOUNCE
+/**
+ * Persistent DMA mappings, module parameter dma_bounce_pages.
+ * The bounce pages of a rdma_queue are mapped DMA_BIDIRECTIONAL when its CQ is built, and unmapped with it.
+ * An empty pool falls back to mapping the swapped page.
+ */
+struct fs_dma_bounce {
+	struct page *page;
+	u64 dma_addr;
+};
+
+struct fs_dma_bounce_pool {
+	spinlock_t lock;
+	int nr_free;
+	int depth;
+	struct fs_dma_bounce *bounces;
+	struct fs_dma_bounce **free; // stack of the free bounce pages
+	atomic_t misses; // mapped the swapped page, the pool was empty
+};
+#endif
+
 /**
  * Build a QP for each core on cpu server. 
  * [?] This design assume we only have one memory server.
@@ -270,15 +803,105 @@ struct semeru_rdma_queue {
 	// 255 : One of memory server crashed, start disconnecting from all memory servers.
 	uint8_t freed; // are resource freed
 	atomic_t rdma_post_counter;
+	u32 max_inline; // bytes the QP can send inline, CP_RDMA_INLINE_MAX or 0.
 
 	int q_index; // initialized to disk hardware queue index
+	int path; // the port of the memory server this QP is connected through, rdma_session->path_addr[path].
 	struct rdma_session_context *rdma_session; // Record the RDMA session this queue belongs to.
 
 	// cache for fs_rdma_request. One for each rdma_queue
 	struct kmem_cache *fs_rdma_req_cache; // only for fs_rdma_req ?
 	struct kmem_cache *rdma_req_sg_cache; // used for rdma request with scatter/gather
+	struct kmem_cache *wr_group_cache; // semeru_wr_group of the doorbell batching
+	struct semeru_req_pool fs_req_pool; // fs_rdma_req, spill to fs_rdma_req_cache
+	struct semeru_req_pool cp_req_pool; // semeru_rdma_req_sg, spill to rdma_req_sg_cache
+
+#ifdef SEMERU_FS_ASYNC_STORE
+	struct fs_store_ring *store_ring; // staged asynchronous frontswap stores
+#endif
+
+#ifdef SEMERU_FS_DMA_BOUNCE
+	struct fs_dma_bounce_pool bounce_pool;
+#endif
+
+#ifdef SEMERU_ADAPTIVE_POLLING
+	wait_queue_head_t cq_wait; // sleep here for the CQ interrupt
+	atomic_t cq_event; // set by the CQ interrupt handler
+	u64 avg_wait_ns; // EWMA of the completion latency, updated without lock.
+
+	// statistics
+	atomic64_t spin_ns; // time spent on spinning
+	atomic_t spin_done; // waits finished within the spin budget
+	atomic_t irq_wakeups; // waits finished after sleeping on the CQ interrupt
+#endif
 };
 
+int init_semeru_req_pool(struct semeru_req_pool *pool, struct kmem_cache *cache, size_t obj_size, int depth, int node);
+void free_semeru_req_pool(struct semeru_req_pool *pool);
+void *semeru_req_pool_get(struct semeru_req_pool *pool);
+void semeru_req_pool_put(struct semeru_req_pool *pool, void *obj);
+
+static inline struct fs_rdma_req *fs_rdma_req_get(struct semeru_rdma_queue *rdma_queue)
+{
+	return (struct fs_rdma_req *)semeru_req_pool_get(&rdma_queue->fs_req_pool);
+}
+
+static inline void fs_rdma_req_put(struct semeru_rdma_queue *rdma_queue, struct fs_rdma_req *rdma_req)
+{
+	semeru_req_pool_put(&rdma_queue->fs_req_pool, rdma_req);
+}
+
+#ifdef SEMERU_FS_DMA_BOUNCE
+int init_fs_dma_bounce_pool(struct semeru_rdma_queue *rdma_queue, struct ib_device *ibdev);
+void free_fs_dma_bounce_pool(struct semeru_rdma_queue *rdma_queue);
+struct fs_dma_bounce *fs_dma_bounce_get(struct semeru_rdma_queue *rdma_queue);
+void fs_dma_bounce_put(struct semeru_rdma_queue *rdma_queue, struct fs_dma_bounce *bounce);
+#endif
+
+/**
+ * Release the DMA buffer of a fs_rdma_req built by dp_build_fs_rdma_wr().
+ * A read through a bounce page is copied to the swapped page here.
+ */
+static inline void fs_rdma_req_unmap(struct semeru_rdma_queue *rdma_queue, struct fs_rdma_req *rdma_req,
+				     enum dma_data_direction dir)
+{
+	struct ib_device *ibdev = rdma_queue->rdma_session->rdma_dev->dev;
+
+#ifdef SEMERU_FS_DMA_BOUNCE
+	if (rdma_req->bounce != NULL) {
+		if (dir == DMA_FROM_DEVICE) {
+			ib_dma_sync_single_for_cpu(ibdev, rdma_req->dma_addr, PAGE_SIZE, DMA_FROM_DEVICE);
+			copy_highpage(rdma_req->page, rdma_req->bounce->page);
+		}
+		fs_dma_bounce_put(rdma_queue, rdma_req->bounce);
+		rdma_req->bounce = NULL;
+		return;
+	}
+#endif
+	ib_dma_unmap_page(ibdev, rdma_req->dma_addr, PAGE_SIZE, dir);
+}
+
+static inline struct semeru_rdma_req_sg *cp_rdma_req_sg_get(struct semeru_rdma_queue *rdma_queue)
+{
+	return (struct semeru_rdma_req_sg *)semeru_req_pool_get(&rdma_queue->cp_req_pool);
+}
+
+static inline void cp_rdma_req_sg_put(struct semeru_rdma_queue *rdma_queue, struct semeru_rdma_req_sg *rdma_req_sg)
+{
+	semeru_req_pool_put(&rdma_queue->cp_req_pool, rdma_req_sg);
+}
+
+/**
+ * Adaptive polling.
+ * Spin for CQ_SPIN_FACTOR times of the average completion latency, bounded by [CQ_SPIN_MIN_NS, CQ_SPIN_MAX_NS].
+ * Then arm the CQ and sleep. Re-poll every CQ_SLEEP_TIMEOUT_MS in case of a lost interrupt.
+ */
+#define CQ_SPIN_MIN_NS		2000
+#define CQ_SPIN_MAX_NS		50000
+#define CQ_SPIN_FACTOR		2
+#define CQ_EWMA_SHIFT		3 // the new sample weighs 1/8
+#define CQ_SLEEP_TIMEOUT_MS	1
+
 /**
  * The rdma device.
  * It's shared by multiple QP and CQ. 
@@ -290,6 +913,41 @@ struct semeru_rdma_dev {
 	struct ib_pd *pd;
 };
 
+/**
+ * Credit-based flow control of the swap out, per memory server.
+ *
+ * Each memory server has a budget of unacked write bytes, module parameter mem_server_credit_mb.
+ * A store takes PAGE_SIZE of credit when the page is staged or posted, the CQ callback returns it.
+ * When a memory server is slow, e.g. compacting, its credits run out and the reclaimer is throttled:
+ * it posts and reaps the writes of that server, sleeping on the CQ, until its bytes are covered.
+ * The send queue never fills up and the stores don't run into the 5ms completion timeout.
+ *
+ * The pages can't be steered to another memory server, or kept in the local tier only. The memory server
+ * of a Region has to hold all its swapped out pages to trace them. So only the new placements
+ * (SEMERU_PLACEMENT_LOAD) and the prefetch reads avoid the servers short of credit.
+ */
+#define FS_CREDIT_THROTTLE_MS	1000 // overdraw the credit after waiting this long, the server may be lost.
+#define FS_CREDIT_LOW_SHIFT	2 // below 1/4 of the budget, a server is short of credit.
+
+/**
+ * Priority of the demand swap-ins over the bulk control path, e.g. the target queues sent at GC.
+ *
+ * The posted wr of a QP are served in order, a multi-MB control path transfer delays the faults behind it.
+ * The control path posts its packages in chunks of CP_PRIO_CHUNK_PAGES. Between two chunks it waits
+ * while the memory server has demand swap-ins in flight, at most CP_PRIO_YIELD_MAX_US per chunk.
+ * At most one chunk of GC traffic is in front of a fault.
+ */
+#define CP_PRIO_CHUNK_PAGES	64 // 256KB
+#define CP_PRIO_YIELD_MAX_US	200
+
+// Ports of a memory server, module parameter mem_server_path_ip.
+#define SEMERU_MAX_RDMA_PATHS	2
+// Send a data path wr through the queue of another port, when the own queue has more outstanding wr.
+#define RDMA_PATH_BALANCE_DEPTH	(RDMA_SEND_QUEUE_DEPTH / 2)
+
+// Outstanding 1-sided wr of a QP. The send queue of a soft-RoCE device can be shorter than RDMA_SEND_QUEUE_DEPTH.
+#define RDMA_POST_LIMIT(rdma_session)	((rdma_session)->send_queue_depth - 1 - 16)
+
 /**
  * Mange the RDMA connection to a remote server. 
  * Every Remote Memory Server has a dedicated rdma_session_context as controller.
@@ -305,13 +963,21 @@ struct rdma_session_context {
 
 	// For infiniband connection rdma_cm operation
 	int mem_server_id;
+	int window; // the slot of the address window served, connected to mem_server_port + window
 	// The first region is reserved for meta data. data region start from 1.
+	// Chunk RDMA_META_REGION_NUM + i is the data Region i of the window, on any memory server holding it.
 	int data_region_start_id; 
 	int data_region_num;
 
 	uint16_t port; /* dst port in NBO */
 	u8 addr[16]; /* dst addr in NBO */
 	uint8_t addr_type; /* ADDR_FAMILY - IPv4/V6 */
+
+	// The ports of the memory server, the QPs are spread over them round robin. path_addr[0] is addr.
+	// All the ports have to be on the same HCA of both servers, they share the PD and the rkeys.
+	int num_paths;
+	u8 path_addr[SEMERU_MAX_RDMA_PATHS][16]; /* dst addr of each port in NBO */
+	unsigned long failed_paths; // bit per path, can't be resolved at connection. Its QPs use path 0.
 	int send_queue_depth; // Send queue depth. Both 1-sided/2-sided RDMA wr is limited by this number.
 	int recv_queue_depth; // Receive Queue depth. 2-sided RDMA need to post a recv wr.
 
@@ -336,6 +1002,24 @@ struct rdma_session_context {
 	// 4) manage the CHUNK mapping.
 	struct remote_mapping_chunk_list remote_chunk_list;
 
+	// 5) registered meta space of the control path
+	struct cp_meta_reg meta_reg;
+
+	// 6) state notifications pushed by the memory server
+	struct cp_notify notify;
+
+	// 7) doorbell to the memory server
+	struct cp_doorbell doorbell;
+	struct cp_atomic atomic; // remote atomics on the meta space, on the same queue.
+
+	// 8) credit-based flow control of the swap out
+	atomic64_t credit_bytes; // unacked write bytes still allowed, negative when overdrawn.
+	atomic_t credit_stalls; // stores throttled for credit
+
+	// demand swap-ins posted and not completed, the bulk control path yields to them.
+	atomic_t demand_loads;
+	atomic_t cp_yields; // control path packages delayed for the swap-ins
+
 	// Keep a rdma buffer for flag byte specially
 	// Fill these information into a 1-sided ib_rdma_wr
 	// Write the value 1 to the corresponding Region's flag .
@@ -343,8 +1027,18 @@ struct rdma_session_context {
 	uint32_t *write_tag;
 	uint64_t write_tag_dma_addr; // corresponding dma address, just the physical address.
 	struct semeru_rdma_req_sg *write_tag_rdma_cmd;
+
+	// 9) reattach to a restarted memory server, see semeru_reattach_mem_server().
+	struct delayed_work reattach_work;
+	unsigned long reattach_state; // SEMERU_REATTACH_xx bits
+	bool heap_lost; // the memory server restarted without its data Regions, never reattach.
 };
 
+#define SEMERU_REATTACH_PENDING 0
+#define SEMERU_REATTACH_STOPPED 1 // until the first connection is up, and after rmmod.
+#define SEMERU_REATTACH_DELAY_MS 1000 // retry interval, the restarted memory server listens again after its JVM init.
+#define SEMERU_REATTACH_DRAIN_MS 100 // the flushed WRs of a broken QP complete right away.
+
 
 //
 // ###################### address translation related #######################
@@ -355,11 +1049,45 @@ struct rdma_session_context {
  * 	the memory servers.
  */
 struct mem_server_addr{
+	int window;	// the slot of the address window, its sessions
 	int mem_server_id;
 	size_t mem_server_chunk_index;
 	size_t mem_server_offset_within_chunk;
 };
 
+/**
+ * Placement of a data Region, REGION_SIZE_GB, on the memory servers.
+ * Decided by the placement_policy at initialization, or at the first access for SEMERU_PLACEMENT_LOAD.
+ * 
+ * mem_server_id : -1 means not placed yet.
+ * chunk_index : the data chunk index within the memory server, the meta Regions are not counted.
+ */
+struct data_chunk_placement {
+	int mem_server_id;
+	int chunk_index;
+};
+extern struct data_chunk_placement data_chunk_placement[];
+
+/**
+ * Asynchronous mirroring of the swapped out pages, module parameter replica_mode.
+ * 
+ * 1) The store completes with the write to the primary memory server, as before.
+ * 2) A second RDMA write of the page, to the next memory server, is posted and not waited for.
+ * 	The page is pinned by an extra reference until the replica write is acked.
+ * 	The replica writes of a page always go to the same rdma_queue, so they are acked in order.
+ * 3) A load reads the replica when the primary memory server is disconnected or its chunk isn't mapped.
+ * 
+ * The replica of the primary chunk i is the chunk i of the next memory server, not used by its primary chunks.
+ * 
+ * A data page's replica is valid only once its latest store is mirrored and acked.
+ * Any store, the local tier and the transports included, or a rewrite by the memory server, invalidates it.
+ * A store while the replica write of the page is in flight isn't mirrored, the page stays invalid until its next store.
+ * A degraded load of an invalid page fails, rather than returning the older copy.
+ * The replica is only refreshed by the stores of the CPU server.
+ */
+#define FS_REPLICA_REAP_DELAY_US	50 // reap the replica writes, nobody else polls the CQ when the swap out stops.
+#define FS_REPLICA_LOCKS		64 // the validity of the data pages, hashed by the page
+
 
 
 
@@ -382,11 +1110,13 @@ int semeru_init_rdma_queue(struct rdma_session_context *rdma_session, int cpu);
 int semeru_create_rdma_queue(struct rdma_session_context *rdma_session, int rdma_queue_index);
 int semeru_connect_remote_memory_server(struct rdma_session_context *rdma_session, int rdma_queue_inx);
 int semeru_query_available_memory(struct rdma_session_context *rdma_session);
+void semeru_schedule_reattach(struct rdma_session_context *rdma_session);
 int setup_rdma_session_commu_buffer(struct rdma_session_context *rdma_session);
 int semeru_setup_buffers(struct rdma_session_context *rdma_session);
 
 int init_remote_chunk_list(struct rdma_session_context *rdma_session);
 void bind_remote_memory_chunks(struct rdma_session_context *rdma_session);
+int semeru_resize_remote_chunks(char __user *start_addr, unsigned long size, int expand);
 
 
 int semeru_disconnect_mem_servers(struct rdma_session_context *rdma_session_global);
@@ -400,6 +1130,18 @@ int handle_recv_wr(struct semeru_rdma_queue *rdma_queue, struct ib_wc *wc);
 int send_message_to_remote(struct rdma_session_context *rdma_session, int rdma_queue_ind, int messge_type,
 			   int chunk_num);
 
+// memory server state notification
+int init_mem_server_notify(struct rdma_session_context *rdma_session);
+void mem_server_notify_done(struct ib_cq *cq, struct ib_wc *wc);
+int semeru_wait_mem_server_state(int mem_server_id, int state);
+void init_cp_doorbell(struct rdma_session_context *rdma_session);
+void cp_doorbell_done(struct ib_cq *cq, struct ib_wc *wc);
+int semeru_cp_ring_doorbell(int mem_server_id, unsigned int seqno);
+int init_cp_atomic(struct rdma_session_context *rdma_session);
+void cp_atomic_release(struct rdma_session_context *rdma_session);
+void cp_atomic_done(struct ib_cq *cq, struct ib_wc *wc);
+int semeru_cp_rdma_atomic(int mem_server_id, struct semeru_rdma_atomic *atomic);
+
 // functions for 1-sided RDMA
 int init_write_tag_rdma_command(struct rdma_session_context *rdma_session);
 
@@ -407,8 +1149,20 @@ int init_write_tag_rdma_command(struct rdma_session_context *rdma_session);
 int semeru_init_frontswap(void);
 void semeru_exit_frontswap(void);
 size_t translate_to_mem_server_addr(struct mem_server_addr * mem_addr, pgoff_t swap_entry_offset);
+void translate_data_addr_to_mem_server_addr(struct mem_server_addr *mem_addr, size_t start_addr);
+void init_data_chunk_placement(void);
+int semeru_query_placement(char __user *start_addr);
+void fs_fence_check(size_t start_addr, enum fs_fence_access access);
+void fs_fence_exit(void);
+void fs_fence_revoke(size_t start_addr);
+bool fs_fence_busy(size_t start_addr);
+int semeru_region_fence(int op, char __user *start_addr, unsigned long size);
+void translate_to_replica_addr(struct mem_server_addr *replica_addr, struct mem_server_addr *mem_addr);
+void fs_store_replica(size_t start_addr, struct mem_server_addr *mem_addr, struct page *page);
+void fs_replica_exit(void);
 int semeru_frontswap_store(unsigned type, pgoff_t page_offset, struct page *page);
 int semeru_frontswap_load(unsigned type, pgoff_t page_offset, struct page *page);
+int semeru_rdma_peek(char __user *addr, void *buf, unsigned long size);
 
 int semeru_fs_rdma_send(struct rdma_session_context *rdma_session, struct semeru_rdma_queue *rdma_queue,
 			struct fs_rdma_req *rdma_req, struct remote_mapping_chunk *remote_chunk_ptr,
@@ -418,13 +1172,421 @@ int dp_build_fs_rdma_wr(struct rdma_session_context *rdma_session, struct semeru
 			struct fs_rdma_req *rdma_req, struct remote_mapping_chunk *remote_chunk_ptr,
 			size_t offset_within_chunk, struct page *page, enum dma_data_direction dir);
 
+int fs_enqueue_wr(struct semeru_rdma_queue *rdma_queue, struct ib_send_wr *wr);
 int fs_enqueue_send_wr(struct rdma_session_context *rdma_session, struct semeru_rdma_queue *rdma_queue,
 		       struct fs_rdma_req *rdma_req);
 void fs_rdma_read_done(struct ib_cq *cq, struct ib_wc *wc);
 void fs_rdma_write_done(struct ib_cq *cq, struct ib_wc *wc);
 
 void drain_rdma_queue(struct semeru_rdma_queue *rdma_queue);
-void drain_all_rdma_queue(int target_mem_server);
+void drain_all_rdma_queue(struct rdma_session_context *rdma_session);
+
+void fs_credit_init(struct rdma_session_context *rdma_session);
+void fs_credit_get(struct rdma_session_context *rdma_session, long bytes);
+bool fs_credit_low(struct rdma_session_context *rdma_session);
+
+// The CQ callbacks return the credit, no wake up. The throttled reclaimer polls the CQ itself.
+static inline void fs_credit_put(struct rdma_session_context *rdma_session, long bytes)
+{
+	atomic64_add(bytes, &rdma_session->credit_bytes);
+}
+
+bool rdma_queue_alive(struct semeru_rdma_queue *rdma_queue);
+struct semeru_rdma_queue *get_dp_rdma_queue(struct rdma_session_context *rdma_session, int cpu);
+
+#ifdef SEMERU_ADAPTIVE_POLLING
+void init_rdma_queue_polling(struct semeru_rdma_queue *rdma_queue);
+void semeru_cq_comp_handler(struct ib_cq *cq, void *cq_context);
+void wait_rdma_queue(struct semeru_rdma_queue *rdma_queue);
+void print_rdma_queue_polling_stats(struct semeru_rdma_queue *rdma_queue);
+#else
+// Busy polling only.
+static inline void wait_rdma_queue(struct semeru_rdma_queue *rdma_queue)
+{
+	drain_rdma_queue(rdma_queue);
+}
+#endif
+
+#ifdef SEMERU_CQ_POLLER
+/**
+ * Dedicated CQ pollers, see frontswap_poller.c.
+ * Poller i polls the rdma_queues[q_index % nr] of all the memory servers, FS_CQ_POLLER_BATCH CQE per CQ each sweep.
+ * It sleeps after FS_CQ_POLLER_IDLE_US without any outstanding wr, until a post or a waiter kicks it.
+ */
+#define FS_CQ_POLLER_BATCH	64
+#define FS_CQ_POLLER_IDLE_US	100
+
+struct fs_cq_poller {
+	struct task_struct *task;
+	int id;
+	int cpu;
+	int sleeping; // the waiters wake it up
+
+	// statistics, written by the poller only
+	u64 sweeps;
+	u64 cqes;
+	u64 sleeps;
+};
+
+extern struct fs_cq_poller fs_cq_pollers[];
+extern int fs_nr_cq_pollers;
+extern bool fs_cq_poller_enabled;
+
+int init_fs_cq_poller(void);
+void exit_fs_cq_poller(void);
+void fs_cq_poller_wait(struct semeru_rdma_queue *rdma_queue);
+
+static inline bool fs_cq_pollers_on(void)
+{
+	return READ_ONCE(fs_cq_poller_enabled);
+}
+
+// A wr is posted, or a caller waits on it. The counter of the queue is already increased.
+static inline void fs_cq_poller_kick(struct semeru_rdma_queue *rdma_queue)
+{
+	struct fs_cq_poller *poller;
+
+	rcu_read_lock();
+	if (fs_cq_pollers_on()) {
+		poller = &fs_cq_pollers[rdma_queue->q_index % fs_nr_cq_pollers];
+		smp_mb(); // pairs with the poller's check of the counters after it sets sleeping
+		if (READ_ONCE(poller->sleeping))
+			wake_up_process(poller->task);
+	}
+	rcu_read_unlock();
+}
+#endif
+
+#ifdef SEMERU_FS_ASYNC_STORE
+int init_fs_store_ring(struct semeru_rdma_queue *rdma_queue);
+void free_fs_store_ring(struct semeru_rdma_queue *rdma_queue);
+void fs_flush_store_ring(struct semeru_rdma_queue *rdma_queue);
+void fs_rdma_batch_write_done(struct ib_cq *cq, struct ib_wc *wc);
+#endif
+
+#ifdef SEMERU_FS_ZERO_PAGE
+int init_fs_zero_map(void);
+void free_fs_zero_map(void);
+int fs_zero_store(size_t data_page, struct page *page);
+void fs_zero_store_done(size_t data_page);
+int fs_zero_load(size_t data_page, struct page *page);
+void fs_zero_forget_range(size_t start_page, size_t end_page);
+void fs_zero_print_stats(void);
+#endif
+
+#ifdef SEMERU_FS_INVALIDATE
+// The window of one INVALIDATE_PAGES message, its bitmap is buf[1, MAX_REGION_NUM).
+#define FS_INVAL_WINDOW_PAGES	512UL
+#define FS_INVAL_DELAY_MS	10 // send a batch not filled within the delay
+int init_fs_invalidate(void);
+void free_fs_invalidate(void);
+void fs_invalidate_page(int mem_server_id, size_t data_page);
+void fs_invalidate_revive(int mem_server_id, size_t start_page, size_t end_page);
+void fs_invalidate_flush(void);
+void fs_invalidate_print_stats(void);
+#endif
+
+#ifdef SEMERU_FS_COLD
+// The window of one COLD_BLOCKS message, its bitmap is buf[1, MAX_REGION_NUM).
+#define FS_COLD_WINDOW_BLOCKS	512UL
+int init_fs_cold(void);
+void free_fs_cold(void);
+int fs_cold_touch(size_t start, size_t end);
+int fs_cold_touch_user(char __user *start_addr, unsigned long size);
+bool fs_cold_handed(size_t data_page);
+void fs_cold_print_stats(void);
+#endif
+
+#if defined(SEMERU_TRANSPORT_CXL) || defined(SEMERU_TRANSPORT_TCP)
+#define SEMERU_TRANSPORT 1
+
+/**
+ * Transport of the memory server data Regions.
+ * The RDMA transport is built in the frontswap and control path functions, with its async stores,
+ * doorbell batching, prefetch and replicas. An installed transport takes over the data Regions, synchronously.
+ * 
+ * store/load : the page at mem_addr. Return 0 on success.
+ * cp_read/cp_write : [addr, addr + size) of the data Regions placed on mem_server_id, or of its meta Region.
+ * 	Return -ENOENT if the range isn't reachable by the transport, it goes to RDMA then.
+ */
+struct semeru_transport {
+	const char *name;
+	int (*store)(struct mem_server_addr *mem_addr, struct page *page);
+	int (*load)(struct mem_server_addr *mem_addr, struct page *page);
+	int (*cp_read)(int mem_server_id, char __user *addr, unsigned long size);
+	int (*cp_write)(int mem_server_id, char __user *addr, unsigned long size);
+};
+extern const struct semeru_transport *semeru_transport; // NULL, RDMA
+#endif
+
+#ifdef SEMERU_TRANSPORT_CXL
+int init_fs_cxl(void);
+void free_fs_cxl(void);
+void fs_cxl_print_stats(void);
+#endif
+
+#ifdef SEMERU_TRANSPORT_TCP
+/**
+ * The TCP transport, for the machines without an HCA.
+ * Each connection carries one request at a time, FS_TCP_CONN_NUM connections per memory server.
+ * The wire format is shared with the memory server, runtime/rdma_comm.hpp.
+ */
+#define FS_TCP_CONN_NUM		8
+#define SEMERU_TCP_PORT_OFFSET	100 // the memory server listens on its RDMA port + 100
+#define SEMERU_TCP_MAGIC	0x53454d55
+#define SEMERU_TCP_READ		1
+#define SEMERU_TCP_WRITE	2
+
+struct semeru_tcp_req {
+	uint32_t magic;
+	uint32_t op;
+	uint64_t addr; // the virtual address on the memory server
+	uint64_t len;
+} __attribute__((packed));
+
+struct semeru_tcp_resp {
+	uint32_t magic;
+	int32_t status; // 0, or the request is rejected and no data follows
+} __attribute__((packed));
+
+int init_fs_tcp(void);
+void free_fs_tcp(void);
+void fs_tcp_print_stats(void);
+#endif
+
+#ifdef SEMERU_FS_COMPRESS
+int init_fs_compress(void);
+void free_fs_compress(void);
+void fs_compress_store(size_t data_page, struct page *page);
+int fs_compress_load(size_t data_page, struct page *page);
+void fs_compress_invalidate(size_t data_page);
+void fs_compress_invalidate_range(size_t start_page, size_t end_page);
+void fs_compress_print_stats(void);
+#endif
+
+#ifdef SEMERU_FS_PREFETCH
+int init_fs_prefetch(void);
+void free_fs_prefetch(void);
+int fs_prefetch_lookup(size_t data_page, struct page *page);
+void fs_prefetch_trigger(struct rdma_session_context *rdma_session, size_t data_page);
+void fs_prefetch_invalidate(size_t data_page);
+void fs_prefetch_invalidate_range(size_t start_page, size_t end_page);
+void fs_prefetch_read_done(struct ib_cq *cq, struct ib_wc *wc);
+int semeru_prefetch_hint(int window, char __user *start_addr, unsigned long size);
+int semeru_prefetch_range(char __user *start_addr, unsigned long size);
+int semeru_fetch_async(char __user *start_addr, unsigned long size);
+int semeru_prefetch_ready(unsigned long addr);
+void fs_prefetch_print_stats(void);
+#endif
+
+#ifdef SEMERU_FS_LATENCY_HIST
+extern struct fs_lat_hist __percpu *fs_lat_hist;
+extern struct dentry *fs_lat_debugfs_dir;
+int init_fs_lat_hist(void);
+void free_fs_lat_hist(void);
+void fs_lat_print_stats(void);
+u64 fs_lat_percentile(u64 *bucket, u64 count, int per_mille);
+
+static inline u64 fs_lat_start(void)
+{
+	return ktime_get_ns();
+}
+
+// Lock-free, the sample goes to the buckets of current core.
+static inline void fs_lat_record(int type, int mem_server_id, u64 start_ns)
+{
+	u64 delta = ktime_get_ns() - start_ns;
+
+	this_cpu_inc(fs_lat_hist->bucket[type][mem_server_id][min_t(int, fls64(delta), FS_LAT_BUCKETS - 1)]);
+}
+#else
+static inline u64 fs_lat_start(void)
+{
+	return 0;
+}
+
+static inline void fs_lat_record(int type, int mem_server_id, u64 start_ns)
+{
+}
+#endif
+
+#ifdef SEMERU_FS_EMULATE
+/**
+ * Emulation of a slower fabric, see frontswap_emulate.c.
+ * The token bucket of a memory server is in bytes, it refills at emu_bw_mbps up to emu_burst_kb.
+ * A caller takes its bytes even if the bucket goes negative, and waits until the debt is paid back.
+ */
+#define FS_EMU_SPIN_NS	(20 * NSEC_PER_USEC) // shorter waits spin, the timers are too coarse for them
+
+struct fs_emu_bucket {
+	spinlock_t lock;
+	s64 tokens; // bytes
+	u64 last_ns;
+
+	// statistics
+	atomic64_t waits;
+	atomic64_t wait_ns;
+} ____cacheline_aligned_in_smp;
+
+void init_fs_emulate(void);
+void fs_emulate_print_stats(void);
+void fs_emu_delay(int mem_server_id, unsigned long bytes);
+#else
+static inline void fs_emu_delay(int mem_server_id, unsigned long bytes)
+{
+}
+#endif
+
+/**
+ * Trace of the swap-ins and swap-outs, see frontswap_trace.c.
+ * The records are read from /dev/semeru_trace as they are, the user tool declares the same layout.
+ */
+enum fs_trace_type {
+	FS_TRACE_LOAD = 0, // a demand read of the memory server
+	FS_TRACE_LOAD_PREFETCHED, // the page was prefetched
+	FS_TRACE_LOAD_LOCAL, // served locally, the compressed copy, the zero page or the local tier
+	FS_TRACE_STORE, // written to the memory server
+	FS_TRACE_STORE_DISCARD, // the page of a free Region, not written
+	FS_TRACE_TYPE_NUM
+};
+
+/**
+ * The faulting address within the page at page_addr, for the sampled swap-ins, see semeru_fault_sample().
+ * Invoked before the load sleeps, cr2 still holds the address if the fault of this core is the one being served.
+ * Otherwise, e.g. the page is touched by a syscall, the page itself.
+ */
+static inline unsigned long fs_fault_address(unsigned long page_addr)
+{
+#ifdef CONFIG_X86
+	unsigned long cr2;
+
+	if (rcu_access_pointer(fault_sample_shared_map) != NULL) {
+		cr2 = read_cr2();
+		if ((cr2 & PAGE_MASK) == page_addr)
+			return cr2;
+	}
+#endif
+	return page_addr;
+}
+
+#ifdef SEMERU_FS_TRACE
+struct fs_trace_record {
+	u64 ns; // ktime_get_ns() at the end of the operation, CLOCK_MONOTONIC
+	u64 vaddr; // page aligned user virtual address
+	u32 latency_ns; // saturated at U32_MAX
+	u8 type; // enum fs_trace_type
+	u8 mem_server_id;
+	u16 cpu;
+};
+
+// One producer, the core itself with its interrupts off, and one consumer, the reader of the device.
+struct fs_trace_ring {
+	struct fs_trace_record *records; // trace_entries
+	u64 head; // written by the producer
+	u64 tail; // written by the consumer
+	u64 dropped; // the ring was full
+} ____cacheline_aligned_in_smp;
+
+extern struct fs_trace_ring __percpu *fs_trace_rings;
+int init_fs_trace(void);
+void free_fs_trace(void);
+void fs_trace_append(int type, int mem_server_id, size_t vaddr, u64 start_ns);
+
+static inline void fs_trace_record(int type, int mem_server_id, size_t vaddr, u64 start_ns)
+{
+	if (unlikely(fs_trace_rings != NULL))
+		fs_trace_append(type, mem_server_id, vaddr, start_ns);
+}
+#else
+static inline void fs_trace_record(int type, int mem_server_id, size_t vaddr, u64 start_ns)
+{
+}
+#endif
+
+#ifdef SEMERU_FS_BENCH
+/**
+ * Micro-benchmark of the frontswap path, see frontswap_bench.c.
+ * The swap offsets from FS_BENCH_OFFSET_BASE aren't swap entries of the kernel, they are the data pages
+ * (offset - FS_BENCH_OFFSET_BASE) picked by the benchmark, without the swap entry remapping.
+ */
+#define FS_BENCH_OFFSET_BASE	((pgoff_t)SWAP_ARRAY_LENGTH)
+
+int init_fs_bench(void);
+void exit_fs_bench(void);
+#endif
+
+#ifdef SEMERU_CHUNK_MIGRATION
+/**
+ * Live migration of the data chunks between the memory servers, see frontswap_migrate.c.
+ *
+ * A moving data chunk is copied to a free slot of the target by batches of FS_MIGRATE_BATCH_PAGES,
+ * each under the write side of its copy_lock. The stores of the chunk hold the read side, and write
+ * the target too, until the placement is switched. Loads stay on the source until then.
+ * The switch is done at the placement sync point of the JVM, semeru_query_placement(NULL).
+ */
+#define FS_MIGRATE_BATCH_PAGES	512 // 2MB per hold of copy_lock
+#define FS_MIGRATE_TIMEOUT_MS	100 // a page read or write of the copy
+#define FS_MIGRATE_MAX_PASSES	8 // the data chunk is rewritten by every GC, give up
+
+enum fs_migrate_state {
+	FS_MIGRATE_IDLE = 0,
+	FS_MIGRATE_QUEUED, // waiting for the worker, not mirrored yet
+	FS_MIGRATE_COPYING, // mirrored, a copy pass is pending or running
+	FS_MIGRATE_READY // mirrored, copied, switched at the next sync point unless dirty
+};
+
+struct fs_migration {
+	int state; // enum fs_migrate_state
+	int window; // address window of the data chunk, it moves between the sessions of this window
+	int source; // memory server and slot, recorded when the copy starts
+	int source_slot;
+	int target;
+	int target_slot; // reserved when the copy starts
+	int passes;
+	bool dirty; // rewritten on the source by the memory server or the control path, copy it again
+	bool failed; // a mirrored store failed, give up
+	struct rw_semaphore copy_lock;
+};
+
+int reserve_data_chunk_slot(size_t data_chunk, int mem_server_id);
+void release_data_chunk_slot(int window, int mem_server_id, int chunk_index);
+void move_data_chunk(size_t data_chunk, int mem_server_id, int chunk_index);
+int data_chunk_placement_epoch_read(void);
+bool fs_fence_overlaps(size_t start, size_t end);
+
+int init_fs_migrate(void);
+void exit_fs_migrate(void);
+bool fs_migrate_begin(size_t start_addr, struct mem_server_addr *mem_addr, bool store);
+void fs_migrate_end(size_t start_addr, bool copying);
+void fs_migrate_mirror(size_t start_addr, struct page *page);
+bool fs_migrate_busy(size_t start, size_t end);
+void fs_migrate_rewrite(size_t start, size_t end);
+int fs_migrate_sync(void);
+int fs_migrate_page_rw(struct mem_server_addr *mem_addr, struct page *page, enum dma_data_direction dir);
+#endif
+
+#ifdef SEMERU_FS_LOCAL_TIER
+/**
+ * CPU-local SSD tier of the frontswap path, see frontswap_local.c.
+ * The worker writes back at most FS_LOCAL_MIGRATE_BATCH pages per run, every FS_LOCAL_MIGRATE_MS.
+ */
+#define FS_LOCAL_MIGRATE_MS	100
+#define FS_LOCAL_MIGRATE_BATCH	1024
+#define FS_LOCAL_SYNC_MS	1000 // a fenced range waits for its congested memory servers at most this long.
+
+int init_fs_local(void);
+void exit_fs_local(void);
+void free_fs_local(void);
+int fs_local_store(size_t start_addr, struct page *page);
+int fs_local_load(size_t start_addr, struct page *page);
+void fs_local_forget(size_t start_addr);
+void fs_local_drop(size_t data_page);
+bool fs_local_has(size_t data_page);
+bool fs_local_has_range(size_t start, size_t end);
+size_t fs_local_sync_range(size_t start, size_t end);
+size_t fs_local_drop_range(size_t start, size_t end);
+bool fs_mem_server_congested(struct mem_server_addr *mem_addr);
+#endif
 
 //
 // control path
@@ -442,6 +1604,28 @@ uint64_t meta_data_map_sg(struct rdma_session_context *rdma_session, struct scat
 			  char *end_addr);
 int cp_enqueue_send_wr(struct rdma_session_context *rdma_session, struct semeru_rdma_queue *rdma_queue,
 		       struct semeru_rdma_req_sg *rdma_req);
+
+// vectored control path
+int semeru_cp_rdma_writev(struct semeru_rdma_iovec *iov, int nr_iov, int async);
+int semeru_cp_rdma_readv(struct semeru_rdma_iovec *iov, int nr_iov);
+int semeru_cp_rdma_bcast(int server_mask, int write_type, char __user *start_addr, unsigned long size);
+int semeru_cp_rdma_wait(int ticket_id);
+void init_cp_rdma_tickets(void);
+
+// registered meta space
+int semeru_cp_register_meta(char __user *start_addr, unsigned long size);
+void cp_meta_reg_release(struct rdma_session_context *rdma_session);
+void cp_meta_reg_exit(void);
+
+// incremental control path write
+int semeru_cp_rdma_write_dirty(int target_server, char __user *start_addr, unsigned long size);
+void cp_rdma_ticket_put(struct cp_rdma_ticket *ticket, enum ib_wc_status status);
+
+// doorbell batching, for both data path and control path
+void wr_batch_init(struct semeru_wr_batch *batch, struct semeru_rdma_queue *rdma_queue);
+int wr_batch_add(struct semeru_wr_batch *batch, struct ib_send_wr *wr);
+int wr_batch_flush(struct semeru_wr_batch *batch);
+void wr_group_done(struct ib_cq *cq, struct ib_wc *wc);
 void cp_rdma_write_done(struct ib_cq *cq, struct ib_wc *wc);
 void cp_rdma_read_done(struct ib_cq *cq, struct ib_wc *wc);
 void reset_semeru_rdma_req_sg(struct semeru_rdma_req_sg *rmem_rdma_cmd_ptr);
@@ -457,6 +1641,23 @@ struct semeru_rdma_ops {
 		unsigned long); // a function pointer, to  return value char*,  parameter(char*, unsigned long)
 	char *(*rdma_write)(int, int, char __user *,
 			    unsigned long); // (2nd int -> message type. 0 for data, 1 for signal )
+	int (*prefetch_hint)(int, char __user *, unsigned long); // (prefetch window, start_addr, size)
+	int (*rdma_writev)(struct semeru_rdma_iovec *, int, int); // (kernel copy of the iovec, entries, async)
+	int (*rdma_wait)(int); // (ticket id)
+	int (*meta_reg)(char __user *, unsigned long); // (start_addr, size), size 0 to unregister
+	int (*rdma_write_dirty)(int, char __user *, unsigned long); // (target_server or -1 for all, start_addr, size)
+	int (*wait_mem_server)(int, int); // (mem_server_id, state), state 0 resets
+	int (*ring_doorbell)(int, unsigned int); // (mem_server_id, sequence number)
+	int (*resize_chunks)(char __user *, unsigned long, int); // (start_addr, size, 1 expand or 0 release)
+	int (*query_placement)(char __user *); // (start_addr), return the memory server id
+	int (*region_fence)(int, char __user *, unsigned long); // (fence op, start_addr, size)
+	int (*rdma_readv)(struct semeru_rdma_iovec *, int); // (kernel copy of the iovec, entries)
+	int (*prefetch_range)(char __user *, unsigned long); // (start_addr, size), return the pages issued
+	int (*rdma_bcast)(int, int, char __user *, unsigned long); // (server mask or 0 for all, write_type, start_addr, size)
+	int (*rdma_atomic)(int, struct semeru_rdma_atomic *); // (mem_server_id, kernel copy of the atomic)
+	int (*rdma_peek)(char __user *, void *, unsigned long); // (start_addr, kernel buffer, size), 1 if the page is resident
+	int (*fetch_async)(char __user *, unsigned long); // (start_addr, size), return the pages not arrived yet
+	int (*prefetch_ready)(unsigned long); // (addr), 1 if the data of the page is in the prefetch cache
 };
 
 // a exported_symbol, defined in kernel.
@@ -495,7 +1696,7 @@ void print_scatterlist_info(struct scatterlist *sl_ptr, int nents);
  */
 
 // Initialize in main().
-// One rdma_session_context per memory server connected by IB.
+// One rdma_session_context per address window and memory server connected by IB, see fs_session().
 // [!!] Unify the RDMA context and Disk Driver context global var [!!]
 extern struct rdma_session_context * rdma_session_global_ptr; 
 
@@ -0,0 +1,219 @@
+/**
+ * Dedicated CQ pollers of the swap path.
+ *
+ * By default every frontswap load/store polls the CQ of its own rdma_queue, drain_rdma_queue() or wait_rdma_queue().
+ * The faulting mutator spins on its core, and several of them contend on the cq_lock of a shared queue.
+ * With the module parameter cq_poller_cpu, a kernel thread is pinned to each of the listed cores instead.
+ *
+ * 1) Poller i polls the rdma_queues[q_index % nr] of all the memory servers, in batches of FS_CQ_POLLER_BATCH.
+ * 	The CQE callbacks complete the fs_rdma_req->done as before, then the poller wakes the waiters of the queue.
+ * 2) wait_rdma_queue() sleeps on the cq_wait of its queue until the queue is drained. The CQ is never armed.
+ * 	drain_rdma_queue(), with preemption disabled, only waits for the counter, it doesn't take the cq_lock.
+ * 3) A poller without any outstanding wr for FS_CQ_POLLER_IDLE_US sleeps, the next post or waiter wakes it.
+ * 	It still sweeps every CQ_SLEEP_TIMEOUT_MS, in case of a wr posted without kicking it.
+ *
+ * The queues being retired by the reattach, freed != 0, are left to it.
+ *
+ */
+
+#include "frontswap_path.h"
+#include "semeru_cpu.h"
+
+#include <linux/kthread.h>
+
+#ifdef SEMERU_CQ_POLLER
+
+//
+// ###################### Global variables ######################
+//
+
+struct fs_cq_poller fs_cq_pollers[MAX_CQ_POLLERS];
+int fs_nr_cq_pollers = 0;
+bool fs_cq_poller_enabled = false; // the waiters leave the CQ to the pollers
+
+//
+// ###################### The pollers ######################
+//
+
+/**
+ * Reap a batch of CQE of the queue, and wake its waiters.
+ * Return true if the queue still has outstanding wr.
+ */
+static bool fs_cq_poll_queue(struct fs_cq_poller *poller, struct semeru_rdma_queue *rdma_queue)
+{
+	struct rdma_session_context *rdma_session = rdma_queue->rdma_session;
+	bool notify = rdma_queue->q_index == MEM_SERVER_NOTIFY_QUEUE && rdma_session->notify.enabled;
+	unsigned long flags;
+	int n;
+
+	if (READ_ONCE(rdma_queue->freed) != 0)
+		return false;
+	if (atomic_read(&rdma_queue->rdma_post_counter) <= 0 && !notify)
+		return false;
+
+	// The control path and the reattach still poll some CQs by themselves.
+	if (!spin_trylock_irqsave(&rdma_queue->cq_lock, flags))
+		return true;
+	n = ib_process_cq_direct(rdma_queue->cq, FS_CQ_POLLER_BATCH);
+	spin_unlock_irqrestore(&rdma_queue->cq_lock, flags);
+
+	if (n > 0) {
+		poller->cqes += n;
+		if (wq_has_sleeper(&rdma_queue->cq_wait))
+			wake_up(&rdma_queue->cq_wait);
+		if (notify)
+			wake_up(&rdma_session->notify.wait);
+	}
+
+	return atomic_read(&rdma_queue->rdma_post_counter) > 0;
+}
+
+static bool fs_cq_poller_sweep(struct fs_cq_poller *poller)
+{
+	bool busy = false;
+	int session, i;
+
+	for (session = 0; session < fs_num_sessions(); session++) {
+		for (i = poller->id; i < online_cores; i += fs_nr_cq_pollers) {
+			if (fs_cq_poll_queue(poller, &rdma_session_global_ptr[session].rdma_queues[i]))
+				busy = true;
+		}
+	}
+	poller->sweeps++;
+
+	return busy;
+}
+
+static int fs_cq_poller_fn(void *data)
+{
+	struct fs_cq_poller *poller = data;
+	u64 idle_since = ktime_get_ns();
+
+	while (!kthread_should_stop()) {
+		if (fs_cq_poller_sweep(poller)) {
+			idle_since = ktime_get_ns();
+		} else if (ktime_get_ns() - idle_since >= FS_CQ_POLLER_IDLE_US * NSEC_PER_USEC) {
+			// 3) sleep, a kick sees sleeping after its wr is counted.
+			set_current_state(TASK_INTERRUPTIBLE);
+			WRITE_ONCE(poller->sleeping, 1);
+			smp_mb();
+			if (!fs_cq_poller_sweep(poller) && !kthread_should_stop()) {
+				schedule_timeout(msecs_to_jiffies(CQ_SLEEP_TIMEOUT_MS));
+				poller->sleeps++;
+			}
+			WRITE_ONCE(poller->sleeping, 0);
+			__set_current_state(TASK_RUNNING);
+			idle_since = ktime_get_ns();
+			continue;
+		}
+
+		cond_resched();
+		cpu_relax();
+	}
+
+	return 0;
+}
+
+//
+// ###################### The waiters ######################
+//
+
+/**
+ * wait_rdma_queue() with the pollers. Sleep until the poller drains the queue.
+ * Fall back to polling the CQ by ourselves once the pollers are stopped, or the queue is retired.
+ */
+void fs_cq_poller_wait(struct semeru_rdma_queue *rdma_queue)
+{
+	unsigned long flags;
+	u64 lat_start;
+
+	if (atomic_read(&rdma_queue->rdma_post_counter) <= 0)
+		return;
+
+	lat_start = fs_lat_start();
+	fs_cq_poller_kick(rdma_queue);
+	while (atomic_read(&rdma_queue->rdma_post_counter) > 0) {
+		if (!fs_cq_pollers_on() || READ_ONCE(rdma_queue->freed) != 0) {
+			spin_lock_irqsave(&rdma_queue->cq_lock, flags);
+			ib_process_cq_direct(rdma_queue->cq, 16);
+			spin_unlock_irqrestore(&rdma_queue->cq_lock, flags);
+			cpu_relax();
+			continue;
+		}
+
+		wait_event_timeout(rdma_queue->cq_wait, atomic_read(&rdma_queue->rdma_post_counter) <= 0,
+				   msecs_to_jiffies(CQ_SLEEP_TIMEOUT_MS));
+	}
+	fs_lat_record(FS_LAT_CQ_DRAIN, rdma_queue->rdma_session->mem_server_id, lat_start);
+}
+
+//
+// ###################### Start and stop ######################
+//
+
+int init_fs_cq_poller(void)
+{
+	struct fs_cq_poller *poller;
+	struct task_struct *task;
+	int i;
+
+	if (num_cq_poller_cpu == 0)
+		return 0;
+
+	for (i = 0; i < num_cq_poller_cpu; i++) {
+		if (cq_poller_cpu[i] >= nr_cpu_ids || !cpu_online(cq_poller_cpu[i])) {
+			pr_err("%s, cq_poller_cpu %u isn't an online core.\n", __func__, cq_poller_cpu[i]);
+			return -EINVAL;
+		}
+	}
+
+	// The pollers stride the queues by fs_nr_cq_pollers, fixed before they start.
+	fs_nr_cq_pollers = min(num_cq_poller_cpu, online_cores);
+	for (i = 0; i < fs_nr_cq_pollers; i++) {
+		poller = &fs_cq_pollers[i];
+		poller->id = i;
+		poller->cpu = cq_poller_cpu[i];
+
+		task = kthread_create_on_node(fs_cq_poller_fn, poller, cpu_to_node(poller->cpu), "semeru_cq/%d",
+					      poller->cpu);
+		if (IS_ERR(task)) {
+			pr_err("%s, create the CQ poller on core %d failed.\n", __func__, poller->cpu);
+			fs_nr_cq_pollers = i;
+			exit_fs_cq_poller();
+			return PTR_ERR(task);
+		}
+		kthread_bind(task, poller->cpu);
+		poller->task = task;
+		wake_up_process(task);
+	}
+
+	WRITE_ONCE(fs_cq_poller_enabled, true);
+	pr_info("%s, %d CQ pollers for %d rdma_queues per memory server.\n", __func__, fs_nr_cq_pollers, online_cores);
+	return 0;
+}
+
+/**
+ * The waiters poll by themselves from now on, then the pollers are stopped.
+ * No kick refers to the task of a poller after the grace period.
+ */
+void exit_fs_cq_poller(void)
+{
+	struct fs_cq_poller *poller;
+	int i;
+
+	WRITE_ONCE(fs_cq_poller_enabled, false);
+	synchronize_rcu();
+
+	for (i = 0; i < fs_nr_cq_pollers; i++) {
+		poller = &fs_cq_pollers[i];
+		if (poller->task == NULL)
+			continue;
+
+		kthread_stop(poller->task);
+		poller->task = NULL;
+		pr_info("%s, CQ poller on core %d, sweeps %llu, cqes %llu, sleeps %llu\n", __func__, poller->cpu,
+			poller->sweeps, poller->cqes, poller->sleeps);
+	}
+}
+
+#endif // SEMERU_CQ_POLLER
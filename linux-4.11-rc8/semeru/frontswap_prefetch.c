@@ -0,0 +1,900 @@
+/**
+ * Swap-in prefetch for the frontswap path.
+ *
+ * The frontswap load is a synchronous 4KB RDMA read.
+ * For the scan-heavy mutators, the fault latency is dominated by these demand reads.
+ *
+ * 1) After each demand load, select some neighbouring pages by the policy,
+ * 	and issue asynchronous RDMA reads for them, within the same chunk.
+ * 2) The prefetched data is kept in fs_prefetch_slots[], indexed by the data page index.
+ * 3) The following frontswap loads, issued by the readahead of kernel or by the next faults,
+ * 	copy the prefetched data into the swap cache page without going to the memory server.
+ *
+ * Policies:
+ * 	a. sequential, prefetch the next FS_PREFETCH_WINDOW pages.
+ * 	b. stride, prefetch along the detected stride of current core. The default one.
+ * 	c. hinted, the JVM tells the range it's going to scan, via sys_do_semeru_rdma_ops type 9.
+ * 	d. affinity, the pages the memory servers reached from the same root, -XX:+SemeruPageAffinity.
+ * 		The ring of the faulting page is read as a whole, once per ring and core.
+ *
+ * The JVM can also prefetch a whole range before it's touched, via sys_do_semeru_rdma_ops type 25,
+ * e.g. the swapped out pages of the CSet Regions before the evacuation.
+ *
+ */
+
+#include "frontswap_path.h"
+#include "semeru_cpu.h"
+#include "semeru_trace.h"
+
+#include <linux/swapops.h>
+
+#ifdef SEMERU_FS_PREFETCH
+
+//
+// ###################### Global variables ######################
+//
+
+static struct fs_prefetch_slot *fs_prefetch_slots = NULL;
+static DEFINE_PER_CPU(struct fs_prefetch_stream, fs_prefetch_streams);
+
+static struct fs_prefetch_hint fs_prefetch_hints[FS_PREFETCH_HINT_NUM];
+static DEFINE_RWLOCK(fs_prefetch_hint_lock);
+
+// profiling
+static atomic_t fs_prefetch_issued; // RDMA reads issued by the prefetcher
+static atomic_t fs_prefetch_hit; // loads served by the prefetched data
+static atomic_t fs_prefetch_miss; // loads going to the memory server
+static atomic_t fs_prefetch_wasted; // prefetched data dropped without being used
+
+//
+// ###################### Policies ######################
+//
+
+static inline bool same_chunk(size_t page_a, size_t page_b)
+{
+	return (page_a >> (CHUNK_SHIFT - PAGE_SHIFT)) == (page_b >> (CHUNK_SHIFT - PAGE_SHIFT));
+}
+
+static int fs_prefetch_select_sequential(struct fs_prefetch_stream *stream, struct fs_prefetch_hint *hint,
+					 size_t data_page, size_t *candidates, int max)
+{
+	int i;
+	int num = 0;
+
+	for (i = 1; i <= max; i++) {
+		if (!same_chunk(data_page, data_page + i))
+			break;
+		candidates[num++] = data_page + i;
+	}
+
+	return num;
+}
+
+/**
+ * Only prefetch when the same stride repeats,
+ * or the random faults waste the RDMA bandwidth.
+ */
+static int fs_prefetch_select_stride(struct fs_prefetch_stream *stream, struct fs_prefetch_hint *hint,
+				     size_t data_page, size_t *candidates, int max)
+{
+	int i;
+	int num = 0;
+	long target;
+
+	if (stream->confidence < 1)
+		return 0;
+
+	for (i = 1; i <= max; i++) {
+		target = (long)data_page + stream->stride * i;
+		if (target < 0 || !same_chunk(data_page, (size_t)target))
+			break;
+		candidates[num++] = (size_t)target;
+	}
+
+	return num;
+}
+
+/**
+ * Prefetch forward within the hinted range.
+ * The JVM scans the hinted Regions sequentially, e.g. the tracing of CSet Regions.
+ */
+static int fs_prefetch_select_hinted(struct fs_prefetch_stream *stream, struct fs_prefetch_hint *hint,
+				     size_t data_page, size_t *candidates, int max)
+{
+	int i;
+	int num = 0;
+
+	if (hint->window < max)
+		max = hint->window;
+
+	for (i = 1; i <= max; i++) {
+		if (data_page + i >= hint->end_page || !same_chunk(data_page, data_page + i))
+			break;
+		candidates[num++] = data_page + i;
+	}
+
+	return num;
+}
+
+/**
+ * Walk the ring of data_page in the page affinity shared by the JVM of its address window.
+ * The ring may be torn by a concurrent rewrite, stop at the window or out of the data space of the address window.
+ * A ring just prefetched by this core is skipped, its next pages fault in one by one.
+ */
+static int fs_prefetch_select_affinity(struct fs_prefetch_stream *stream, struct fs_prefetch_hint *hint,
+				       size_t data_page, size_t *candidates, int max)
+{
+	struct page_affinity_shared_map *map;
+	size_t window_pages = RDMA_DATA_SPACE_SIZE >> PAGE_SHIFT;
+	long base = (long)(data_page - data_page % window_pages); // first data page of the address window
+	size_t lowest = data_page;
+	long target = (long)data_page;
+	int num = 0;
+	s32 delta;
+
+	rcu_read_lock();
+	map = rcu_dereference(page_affinity_shared_map[data_page / window_pages]);
+	while (num < max) {
+		delta = semeru_page_affinity_next(map, (u64)(target - base));
+		if (delta == 0)
+			break;
+		target += delta;
+		if (target < base || target == (long)data_page)
+			break;
+		candidates[num++] = (size_t)target;
+		if ((size_t)target < lowest)
+			lowest = (size_t)target;
+	}
+	rcu_read_unlock();
+
+	if (stream->affinity_group == lowest + 1)
+		return 0;
+	stream->affinity_group = lowest + 1;
+
+	return num;
+}
+
+static struct fs_prefetch_policy fs_prefetch_policies[FS_PREFETCH_POLICY_NUM] = {
+	[FS_PREFETCH_SEQUENTIAL] = { .name = "sequential", .select = fs_prefetch_select_sequential },
+	[FS_PREFETCH_STRIDE] = { .name = "stride", .select = fs_prefetch_select_stride },
+	[FS_PREFETCH_HINTED] = { .name = "hinted", .select = fs_prefetch_select_hinted },
+	[FS_PREFETCH_AFFINITY] = { .name = "affinity", .select = fs_prefetch_select_affinity },
+};
+
+// Record the access of current core, for the stride policy.
+static void fs_prefetch_update_stream(struct fs_prefetch_stream *stream, size_t data_page)
+{
+	long delta = (long)data_page - (long)stream->last_page;
+
+	if (delta != 0 && delta == stream->stride) {
+		stream->confidence++;
+	} else {
+		stream->stride = (delta <= FS_PREFETCH_MAX_STRIDE && delta >= -FS_PREFETCH_MAX_STRIDE) ? delta : 0;
+		stream->confidence = 0;
+	}
+
+	stream->last_page = data_page;
+}
+
+// The memory servers linked data_page with the other pages reached from the same root.
+static bool fs_prefetch_in_affinity_ring(size_t data_page)
+{
+	struct page_affinity_shared_map *map;
+	size_t window_pages = RDMA_DATA_SPACE_SIZE >> PAGE_SHIFT;
+	bool ret;
+
+	rcu_read_lock();
+	map = rcu_dereference(page_affinity_shared_map[data_page / window_pages]);
+	ret = semeru_page_affinity_next(map, data_page % window_pages) != 0;
+	rcu_read_unlock();
+
+	return ret;
+}
+
+// Copy the hint covering data_page into *hint.
+// return true if found.
+static bool fs_prefetch_find_hint(size_t data_page, struct fs_prefetch_hint *hint)
+{
+	int i;
+	bool found = false;
+	unsigned long flags;
+
+	read_lock_irqsave(&fs_prefetch_hint_lock, flags);
+	for (i = 0; i < FS_PREFETCH_HINT_NUM; i++) {
+		if (fs_prefetch_hints[i].window > 0 && data_page >= fs_prefetch_hints[i].start_page &&
+		    data_page < fs_prefetch_hints[i].end_page) {
+			*hint = fs_prefetch_hints[i];
+			found = true;
+			break;
+		}
+	}
+	read_unlock_irqrestore(&fs_prefetch_hint_lock, flags);
+
+	return found;
+}
+
+//
+// ###################### Prefetch cache ######################
+//
+
+static inline struct fs_prefetch_slot *fs_prefetch_slot_of(size_t data_page)
+{
+	return &fs_prefetch_slots[data_page & FS_PREFETCH_SLOT_MASK];
+}
+
+// Caller must hold slot->lock.
+static inline void fs_prefetch_release_slot(struct fs_prefetch_slot *slot)
+{
+	__free_page(slot->page);
+	slot->page = NULL;
+	slot->state = FS_SLOT_EMPTY;
+	slot->stale = false;
+}
+
+/**
+ * The CQ callback of a prefetch read.
+ * Invoked with rdma_queue->cq_lock held.
+ */
+void fs_prefetch_read_done(struct ib_cq *cq, struct ib_wc *wc)
+{
+	struct fs_prefetch_slot *slot = container_of(wc->wr_cqe, struct fs_prefetch_slot, cqe);
+	struct semeru_rdma_queue *rdma_queue = cq->cq_context;
+	struct ib_device *ibdev = rdma_queue->rdma_session->rdma_dev->dev;
+	unsigned long flags;
+
+	trace_semeru_rdma_cqe(rdma_queue->rdma_session->mem_server_id, rdma_queue->q_index, SEMERU_WR_FS_PREFETCH,
+			      wc->status, wc->byte_len);
+	spin_lock_irqsave(&slot->lock, flags);
+	ib_dma_unmap_page(ibdev, slot->dma_addr, PAGE_SIZE, DMA_FROM_DEVICE);
+
+	if (unlikely(wc->status != IB_WC_SUCCESS)) {
+		pr_err("%s, rdma_queue[%d] status is not success, it is=%d\n", __func__, rdma_queue->q_index,
+		       wc->status);
+		fs_prefetch_release_slot(slot);
+	} else if (unlikely(slot->stale)) {
+		// stored during the read, the data may be old.
+		atomic_inc(&fs_prefetch_wasted);
+		fs_prefetch_release_slot(slot);
+	} else {
+		slot->state = FS_SLOT_READY;
+	}
+	spin_unlock_irqrestore(&slot->lock, flags);
+
+	atomic_dec(&rdma_queue->rdma_post_counter); // decrease outstanding rdma request counter
+}
+
+/**
+ * Issue an asynchronous RDMA read for data_page into its slot.
+ * Skip the page if it's cached, or being read, already, or the memory server is compacting it.
+ */
+static void fs_prefetch_issue(struct rdma_session_context *rdma_session, struct semeru_wr_batch *wr_batch,
+			      size_t data_page)
+{
+	unsigned long flags;
+	struct semeru_rdma_queue *rdma_queue = wr_batch->rdma_queue;
+	struct fs_prefetch_slot *slot = fs_prefetch_slot_of(data_page);
+	struct remote_mapping_chunk *remote_chunk_ptr;
+	struct mem_server_addr mem_addr;
+	struct ib_device *ibdev = rdma_session->rdma_dev->dev;
+	struct page *page;
+
+	// A granted or committing Region, the read could return the pre-compaction copy.
+	if (fs_fence_busy(data_page << PAGE_SHIFT))
+		return;
+
+	spin_lock_irqsave(&slot->lock, flags);
+	if (slot->state == FS_SLOT_INFLIGHT)
+		goto out; // the slot is busy, no matter which page it's reading.
+
+	if (slot->state == FS_SLOT_READY) {
+		if (slot->data_page == data_page)
+			goto out; // cached already.
+
+		// evict the unused data of another page
+		atomic_inc(&fs_prefetch_wasted);
+		fs_prefetch_release_slot(slot);
+	}
+
+#ifdef SEMERU_FS_COLD
+	// The block may be compressed, only the demand load fetches it.
+	if (fs_cold_handed(data_page))
+		goto out;
+#endif
+
+#ifdef SEMERU_FS_LOCAL_TIER
+	// The memory server's copy is stale, the load reads the local one.
+	if (fs_local_has(data_page))
+		goto out;
+#endif
+
+	// Never read a chunk released by the JVM, its rkey is invalid.
+	translate_data_addr_to_mem_server_addr(&mem_addr, data_page << PAGE_SHIFT);
+	remote_chunk_ptr = &(rdma_session->remote_chunk_list.remote_chunk[mem_addr.mem_server_chunk_index]);
+	if (unlikely(remote_chunk_ptr->chunk_state != MAPPED))
+		goto out;
+
+	page = alloc_page(GFP_ATOMIC | __GFP_NOWARN);
+	if (unlikely(page == NULL))
+		goto out; // prefetch is best effort.
+
+	slot->dma_addr = ib_dma_map_page(ibdev, page, 0, PAGE_SIZE, DMA_FROM_DEVICE);
+	if (unlikely(ib_dma_mapping_error(ibdev, slot->dma_addr))) {
+		pr_err("%s, ib_dma_mapping_error\n", __func__);
+		__free_page(page);
+		goto out;
+	}
+
+	slot->page = page;
+	slot->data_page = data_page;
+	slot->stale = false;
+	slot->rdma_queue = rdma_queue;
+	slot->state = FS_SLOT_INFLIGHT;
+
+	slot->sge.addr = slot->dma_addr;
+	slot->sge.length = PAGE_SIZE;
+	slot->sge.lkey = rdma_session->rdma_dev->pd->local_dma_lkey;
+
+	slot->cqe.done = fs_prefetch_read_done;
+	slot->rdma_wr.wr.next = NULL;
+	slot->rdma_wr.wr.wr_cqe = &slot->cqe;
+	slot->rdma_wr.wr.sg_list = &slot->sge;
+	slot->rdma_wr.wr.num_sge = 1;
+	slot->rdma_wr.wr.opcode = IB_WR_RDMA_READ;
+	slot->rdma_wr.wr.send_flags = 0; // signaled by the batch
+	slot->rdma_wr.remote_addr = remote_chunk_ptr->remote_addr + mem_addr.mem_server_offset_within_chunk;
+	slot->rdma_wr.rkey = remote_chunk_ptr->remote_rkey;
+	spin_unlock_irqrestore(&slot->lock, flags);
+
+	// The CQ callback takes slot->lock, chain the wr without holding it.
+	// If the post fails, the slot is released by fs_prefetch_read_done().
+	wr_batch_add(wr_batch, (struct ib_send_wr *)&slot->rdma_wr);
+
+	atomic_inc(&fs_prefetch_issued);
+	return;
+
+out:
+	spin_unlock_irqrestore(&slot->lock, flags);
+}
+
+/**
+ * Serve the load from the prefetched data.
+ * If the read is still on the fly, poll its rdma_queue until the data arrives.
+ *
+ * return
+ *  0 : hit, the data is copied into page.
+ *  -1 : miss, caller reads it from memory server.
+ */
+int fs_prefetch_lookup(size_t data_page, struct page *page)
+{
+	int ret = -1;
+	unsigned long flags;
+	struct fs_prefetch_slot *slot = fs_prefetch_slot_of(data_page);
+	struct semeru_rdma_queue *rdma_queue;
+
+	spin_lock_irqsave(&slot->lock, flags);
+	while (slot->state == FS_SLOT_INFLIGHT && slot->data_page == data_page) {
+		rdma_queue = slot->rdma_queue;
+		spin_unlock_irqrestore(&slot->lock, flags);
+		wait_rdma_queue(rdma_queue);
+		spin_lock_irqsave(&slot->lock, flags);
+	}
+
+	if (slot->state == FS_SLOT_READY && slot->data_page == data_page) {
+		copy_highpage(page, slot->page);
+		fs_prefetch_release_slot(slot);
+		ret = 0;
+	}
+	spin_unlock_irqrestore(&slot->lock, flags);
+
+	if (ret == 0)
+		atomic_inc(&fs_prefetch_hit);
+	else
+		atomic_inc(&fs_prefetch_miss);
+
+	return ret;
+}
+
+/**
+ * Select the pages to prefetch after a load of data_page and issue them.
+ * The prefetch reads are chained and posted to current core's rdma_queue by one doorbell.
+ */
+void fs_prefetch_trigger(struct rdma_session_context *rdma_session, size_t data_page)
+{
+	int cpu;
+	int i;
+	int num;
+	size_t candidates[FS_PREFETCH_WINDOW_MAX];
+	struct fs_prefetch_stream *stream;
+	struct fs_prefetch_hint hint;
+	struct fs_prefetch_policy *policy;
+	struct semeru_wr_batch wr_batch;
+
+	cpu = get_cpu(); // disable preempt
+	stream = this_cpu_ptr(&fs_prefetch_streams);
+	fs_prefetch_update_stream(stream, data_page);
+
+	// The memory server is backed up by the swap out, no speculative reads.
+	if (fs_credit_low(rdma_session)) {
+		put_cpu();
+		return;
+	}
+
+	if (fs_prefetch_find_hint(data_page, &hint)) {
+		policy = &fs_prefetch_policies[FS_PREFETCH_HINTED];
+		num = policy->select(stream, &hint, data_page, candidates, FS_PREFETCH_WINDOW_MAX);
+	} else if (fs_prefetch_in_affinity_ring(data_page)) {
+		policy = &fs_prefetch_policies[FS_PREFETCH_AFFINITY];
+		num = policy->select(stream, NULL, data_page, candidates, FS_PREFETCH_WINDOW_MAX);
+	} else {
+		policy = &fs_prefetch_policies[FS_PREFETCH_DEFAULT_POLICY];
+		num = policy->select(stream, NULL, data_page, candidates, FS_PREFETCH_WINDOW);
+	}
+
+	wr_batch_init(&wr_batch, get_dp_rdma_queue(rdma_session, cpu));
+	for (i = 0; i < num; i++) {
+		fs_prefetch_issue(rdma_session, &wr_batch, candidates[i]);
+	}
+	wr_batch_flush(&wr_batch);
+
+#ifdef DEBUG_MODE_DETAIL
+	pr_info("%s, rdma_queue[%d] %s policy, prefetch %d pages after data page 0x%lx\n", __func__, cpu, policy->name,
+		num, data_page);
+#endif
+
+	put_cpu(); // enable preeempt.
+}
+
+/**
+ * The remote copy of data_page is changed, or freed.
+ * Drop its prefetched data.
+ */
+void fs_prefetch_invalidate(size_t data_page)
+{
+	unsigned long flags;
+	struct fs_prefetch_slot *slot;
+
+	if (unlikely(fs_prefetch_slots == NULL))
+		return;
+
+	slot = fs_prefetch_slot_of(data_page);
+	spin_lock_irqsave(&slot->lock, flags);
+	if (slot->data_page == data_page) {
+		if (slot->state == FS_SLOT_INFLIGHT) {
+			slot->stale = true; // dropped in the CQ callback
+		} else if (slot->state == FS_SLOT_READY) {
+			atomic_inc(&fs_prefetch_wasted);
+			fs_prefetch_release_slot(slot);
+		}
+	}
+	spin_unlock_irqrestore(&slot->lock, flags);
+}
+
+/**
+ * The memory server rewrites the data pages [start_page, end_page), e.g. its compaction.
+ * Drop their prefetched data, the ready and the in-flight reads.
+ */
+void fs_prefetch_invalidate_range(size_t start_page, size_t end_page)
+{
+	unsigned long flags;
+	struct fs_prefetch_slot *slot;
+	size_t i;
+
+	if (unlikely(fs_prefetch_slots == NULL))
+		return;
+
+	// A range wider than the cache, check each slot once.
+	if (end_page - start_page > FS_PREFETCH_SLOT_NUM) {
+		for (i = 0; i < FS_PREFETCH_SLOT_NUM; i++) {
+			slot = &fs_prefetch_slots[i];
+			spin_lock_irqsave(&slot->lock, flags);
+			if (slot->state != FS_SLOT_EMPTY && slot->data_page >= start_page && slot->data_page < end_page) {
+				if (slot->state == FS_SLOT_INFLIGHT) {
+					slot->stale = true; // dropped in the CQ callback
+				} else {
+					atomic_inc(&fs_prefetch_wasted);
+					fs_prefetch_release_slot(slot);
+				}
+			}
+			spin_unlock_irqrestore(&slot->lock, flags);
+		}
+		return;
+	}
+
+	for (i = start_page; i < end_page; i++)
+		fs_prefetch_invalidate(i);
+}
+
+//
+// ###################### JVM hint ######################
+//
+
+/**
+ * Registered into kernel as rdma_ops_in_kernel.prefetch_hint.
+ *
+ * window > 0 : prefetch window in pages for [start_addr, start_addr + size)
+ * window == 0 : remove the hints overlapping with [start_addr, start_addr + size). Remove all, if size is 0.
+ * window < 0 : print and reset the prefetch statistics.
+ * A hint of size 0 is rejected.
+ *
+ * return 0 for success, -1 for error.
+ */
+int semeru_prefetch_hint(int window, char __user *start_addr, unsigned long size)
+{
+	int i;
+	int ret = 0;
+	unsigned long flags;
+	size_t start_page;
+	size_t end_page;
+	long offset;
+
+	if (window < 0) {
+		fs_prefetch_print_stats();
+		atomic_set(&fs_prefetch_issued, 0);
+		atomic_set(&fs_prefetch_hit, 0);
+		atomic_set(&fs_prefetch_miss, 0);
+		atomic_set(&fs_prefetch_wasted, 0);
+		return 0;
+	}
+
+	if (size == 0) {
+		if (window != 0) {
+			pr_err("%s, empty hint range at 0x%lx.\n", __func__, (size_t)start_addr);
+			return -1;
+		}
+
+		// drop all the hints, the range is not used.
+		write_lock_irqsave(&fs_prefetch_hint_lock, flags);
+		for (i = 0; i < FS_PREFETCH_HINT_NUM; i++)
+			fs_prefetch_hints[i].window = 0;
+		write_unlock_irqrestore(&fs_prefetch_hint_lock, flags);
+		return 0;
+	}
+
+	offset = semeru_data_offset_of((unsigned long)start_addr, size);
+	if (offset < 0) {
+		pr_err("%s, hint range [0x%lx, 0x%lx) is not in data space.\n", __func__, (size_t)start_addr,
+		       (size_t)start_addr + size);
+		return -1;
+	}
+
+	start_page = (size_t)offset >> PAGE_SHIFT;
+	end_page = ((size_t)offset + size + PAGE_SIZE - 1) >> PAGE_SHIFT;
+	if (window > FS_PREFETCH_WINDOW_MAX)
+		window = FS_PREFETCH_WINDOW_MAX;
+
+	write_lock_irqsave(&fs_prefetch_hint_lock, flags);
+	if (window == 0) {
+		for (i = 0; i < FS_PREFETCH_HINT_NUM; i++) {
+			if (fs_prefetch_hints[i].start_page < end_page && fs_prefetch_hints[i].end_page > start_page)
+				fs_prefetch_hints[i].window = 0;
+		}
+	} else {
+		for (i = 0; i < FS_PREFETCH_HINT_NUM; i++) {
+			if (fs_prefetch_hints[i].window == 0)
+				break;
+		}
+
+		if (i < FS_PREFETCH_HINT_NUM) {
+			fs_prefetch_hints[i].start_page = start_page;
+			fs_prefetch_hints[i].end_page = end_page;
+			fs_prefetch_hints[i].window = window;
+		} else {
+			pr_warn("%s, no free hint slot for [0x%lx, 0x%lx), remove the old hints first.\n", __func__,
+				(size_t)start_addr, (size_t)start_addr + size);
+			ret = -1;
+		}
+	}
+	write_unlock_irqrestore(&fs_prefetch_hint_lock, flags);
+
+#if defined(DEBUG_MODE_BRIEF) || defined(DEBUG_MODE_DETAIL)
+	pr_info("%s, window %d for [0x%lx, 0x%lx)\n", __func__, window, (size_t)start_addr,
+		(size_t)start_addr + size);
+#endif
+
+	return ret;
+}
+
+/**
+ * Collect the data pages of [addr, end) swapped out of mm, end within the pmd of addr.
+ * base is the address of data offset 0 in the address window of the range, addr minus its data offset.
+ * Caller must hold mm->mmap_sem.
+ *
+ * return the number of pages collected into data_pages[], at most max.
+ */
+static int fs_prefetch_collect_pmd(struct mm_struct *mm, unsigned long base, unsigned long addr, unsigned long end,
+				   size_t *data_pages, int max)
+{
+	pgd_t *pgd;
+	p4d_t *p4d;
+	pud_t *pud;
+	pmd_t *pmd;
+	pte_t *ptep;
+	pte_t *start_ptep;
+	spinlock_t *ptl;
+	int num = 0;
+
+	pgd = pgd_offset(mm, addr);
+	if (pgd_none(*pgd) || unlikely(pgd_bad(*pgd)))
+		return 0;
+
+	p4d = p4d_offset(pgd, addr);
+	if (p4d_none(*p4d) || unlikely(p4d_bad(*p4d)))
+		return 0;
+
+	pud = pud_offset(p4d, addr);
+	if (pud_none(*pud) || unlikely(pud_bad(*pud)))
+		return 0;
+
+	pmd = pmd_offset(pud, addr);
+	if (pmd_none(*pmd) || pmd_trans_huge(*pmd))
+		return 0; // never touched, or resident
+
+	start_ptep = ptep = pte_offset_map_lock(mm, pmd, addr, &ptl);
+	for (; addr < end && num < max; addr += PAGE_SIZE, ptep++) {
+		if (is_swap_pte(*ptep) && !non_swap_entry(pte_to_swp_entry(*ptep)))
+			data_pages[num++] = (addr - base) >> PAGE_SHIFT;
+	}
+	pte_unmap_unlock(start_ptep, ptl);
+
+	return num;
+}
+
+/**
+ * Registered into kernel as rdma_ops_in_kernel.prefetch_range.
+ *
+ * Read the swapped out pages of [start_addr, start_addr + size) of current process into the prefetch cache.
+ * The reads are chained per memory server and posted by one doorbell for each FS_PREFETCH_RANGE_BATCH pages,
+ * the call returns without waiting for them. The faults on the range copy the data from the cache.
+ * The resident pages are skipped, FS_PREFETCH_RANGE_MAX pages are read at most.
+ *
+ * return the number of pages issued, -1 for error.
+ */
+int semeru_prefetch_range(char __user *start_addr, unsigned long size)
+{
+	int cpu;
+	int i;
+	int num;
+	int issued = 0;
+	int mem_server_id;
+	unsigned long addr = (unsigned long)start_addr & PAGE_MASK;
+	unsigned long end = ((unsigned long)start_addr + size + PAGE_SIZE - 1) & PAGE_MASK;
+	unsigned long next;
+	unsigned long base;
+	int window;
+	long offset = semeru_data_offset_of(addr, end - addr);
+	struct mm_struct *mm = current->mm;
+	struct mem_server_addr mem_addr;
+	struct rdma_session_context *rdma_session;
+	struct semeru_wr_batch wr_batch[MAX_NUM_OF_MEMORY_SERVER];
+	size_t *data_pages;
+
+	if (offset < 0) {
+		pr_err("%s, range [0x%lx, 0x%lx) is not in data space.\n", __func__, (size_t)start_addr,
+		       (size_t)start_addr + size);
+		return -1;
+	}
+	base = addr - (unsigned long)offset;
+	window = (int)(offset / RDMA_DATA_SPACE_SIZE);
+
+	data_pages = kmalloc_array(FS_PREFETCH_RANGE_BATCH, sizeof(size_t), GFP_KERNEL);
+	if (unlikely(data_pages == NULL))
+		return -1;
+
+	down_read(&mm->mmap_sem);
+	while (addr < end && issued < FS_PREFETCH_RANGE_MAX) {
+		// 1) Collect a batch of swapped out pages under the pte locks.
+		num = 0;
+		for (; addr < end && num < FS_PREFETCH_RANGE_BATCH; addr = next) {
+			next = pmd_addr_end(addr, end);
+			num += fs_prefetch_collect_pmd(mm, base, addr, next, data_pages + num,
+						       FS_PREFETCH_RANGE_BATCH - num);
+			if (num == FS_PREFETCH_RANGE_BATCH)
+				next = ((data_pages[num - 1] + 1) << PAGE_SHIFT) + base;
+		}
+
+		// 2) Issue them to the memory server of each page, one doorbell per server of the window.
+		cpu = get_cpu(); // disable preempt
+		for (mem_server_id = 0; mem_server_id < num_mem_servers; mem_server_id++) {
+			rdma_session = fs_session(window, mem_server_id);
+			wr_batch_init(&wr_batch[mem_server_id], get_dp_rdma_queue(rdma_session, cpu));
+		}
+		for (i = 0; i < num; i++) {
+			translate_data_addr_to_mem_server_addr(&mem_addr, data_pages[i] << PAGE_SHIFT);
+			fs_prefetch_issue(fs_session(mem_addr.window, mem_addr.mem_server_id),
+					  &wr_batch[mem_addr.mem_server_id], data_pages[i]);
+		}
+		for (mem_server_id = 0; mem_server_id < num_mem_servers; mem_server_id++) {
+			wr_batch_flush(&wr_batch[mem_server_id]);
+		}
+		put_cpu(); // enable preeempt.
+
+		issued += num;
+	}
+	up_read(&mm->mmap_sem);
+
+	kfree(data_pages);
+
+#if defined(DEBUG_MODE_BRIEF) || defined(DEBUG_MODE_DETAIL)
+	pr_info("%s, issue %d swapped out pages of [0x%lx, 0x%lx)\n", __func__, issued, (size_t)start_addr,
+		(size_t)start_addr + size);
+#endif
+
+	return issued;
+}
+
+// Ready, the fault on data_page copies the data locally.
+static bool fs_prefetch_arrived(size_t data_page)
+{
+	bool arrived;
+	unsigned long flags;
+	struct fs_prefetch_slot *slot = fs_prefetch_slot_of(data_page);
+
+	spin_lock_irqsave(&slot->lock, flags);
+	arrived = slot->state == FS_SLOT_READY && slot->data_page == data_page;
+	spin_unlock_irqrestore(&slot->lock, flags);
+
+	return arrived;
+}
+
+/**
+ * Registered into kernel as rdma_ops_in_kernel.fetch_async, sys_do_semeru_rdma_ops type 33.
+ *
+ * A fault on a swapped out page of the data space waits for the RDMA round trip in semeru_frontswap_load().
+ * A JVM thread with other work to do asks here first instead of faulting:
+ * the swapped out pages of [start_addr, start_addr + size) not in the prefetch cache yet are read into it,
+ * and the call returns at once. The thread runs its other work and asks again later,
+ * the range is touched after the call returns 0.
+ * A page whose slot is taken by the read of another page is counted on the fly, the next call issues it.
+ * FS_FETCH_ASYNC_MAX pages are checked at most, the rest of the range isn't counted.
+ *
+ * return the number of swapped out pages not arrived yet, -1 for error.
+ */
+int semeru_fetch_async(char __user *start_addr, unsigned long size)
+{
+	int cpu;
+	int i;
+	int num = 0;
+	int pending = 0;
+	int mem_server_id;
+	unsigned long addr = (unsigned long)start_addr & PAGE_MASK;
+	unsigned long end = ((unsigned long)start_addr + size + PAGE_SIZE - 1) & PAGE_MASK;
+	unsigned long next;
+	unsigned long base;
+	int window;
+	long offset = semeru_data_offset_of(addr, end - addr);
+	struct mm_struct *mm = current->mm;
+	struct mem_server_addr mem_addr;
+	struct rdma_session_context *rdma_session;
+	struct semeru_wr_batch wr_batch[MAX_NUM_OF_MEMORY_SERVER];
+	size_t data_pages[FS_FETCH_ASYNC_MAX];
+
+	if (offset < 0) {
+		pr_err("%s, range [0x%lx, 0x%lx) is not in data space.\n", __func__, (size_t)start_addr,
+		       (size_t)start_addr + size);
+		return -1;
+	}
+	base = addr - (unsigned long)offset;
+	window = (int)(offset / RDMA_DATA_SPACE_SIZE);
+
+	down_read(&mm->mmap_sem);
+	for (; addr < end && num < FS_FETCH_ASYNC_MAX; addr = next) {
+		next = pmd_addr_end(addr, end);
+		num += fs_prefetch_collect_pmd(mm, base, addr, next, data_pages + num, FS_FETCH_ASYNC_MAX - num);
+	}
+	up_read(&mm->mmap_sem);
+
+	if (num == 0)
+		return 0;
+
+	cpu = get_cpu(); // disable preempt
+	for (mem_server_id = 0; mem_server_id < num_mem_servers; mem_server_id++) {
+		rdma_session = fs_session(window, mem_server_id);
+		wr_batch_init(&wr_batch[mem_server_id], get_dp_rdma_queue(rdma_session, cpu));
+	}
+	for (i = 0; i < num; i++) {
+		if (fs_prefetch_arrived(data_pages[i]))
+			continue;
+
+		// skipped if it's on the fly already
+		translate_data_addr_to_mem_server_addr(&mem_addr, data_pages[i] << PAGE_SHIFT);
+		fs_prefetch_issue(fs_session(mem_addr.window, mem_addr.mem_server_id), &wr_batch[mem_addr.mem_server_id],
+				  data_pages[i]);
+		pending++;
+	}
+	for (mem_server_id = 0; mem_server_id < num_mem_servers; mem_server_id++) {
+		wr_batch_flush(&wr_batch[mem_server_id]);
+	}
+	put_cpu(); // enable preeempt.
+
+#if defined(DEBUG_MODE_DETAIL)
+	pr_info("%s, %d of %d swapped out pages of [0x%lx, 0x%lx) on the fly\n", __func__, pending, num,
+		(size_t)start_addr, (size_t)start_addr + size);
+#endif
+
+	return pending;
+}
+
+/**
+ * Registered into kernel as rdma_ops_in_kernel.prefetch_ready, for the fault-around of sys_do_semeru_rdma_ops type 34.
+ * Only the data arrived counts, a swap-in of a page on the fly would wait for its read.
+ *
+ * return 1 if the data of the page at addr is ready in the prefetch cache, 0 otherwise.
+ */
+int semeru_prefetch_ready(unsigned long addr)
+{
+	long offset = semeru_data_offset_of(addr, 1);
+
+	if (offset < 0)
+		return 0;
+
+	return fs_prefetch_arrived((size_t)offset >> PAGE_SHIFT);
+}
+
+//
+// ###################### Init and free ######################
+//
+
+int init_fs_prefetch(void)
+{
+	size_t i;
+
+	fs_prefetch_slots = vzalloc(sizeof(struct fs_prefetch_slot) * FS_PREFETCH_SLOT_NUM);
+	if (unlikely(fs_prefetch_slots == NULL)) {
+		pr_err("%s, allocate fs_prefetch_slots failed.\n", __func__);
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < FS_PREFETCH_SLOT_NUM; i++) {
+		spin_lock_init(&fs_prefetch_slots[i].lock);
+		fs_prefetch_slots[i].state = FS_SLOT_EMPTY;
+	}
+
+	memset(fs_prefetch_hints, 0, sizeof(fs_prefetch_hints));
+	atomic_set(&fs_prefetch_issued, 0);
+	atomic_set(&fs_prefetch_hit, 0);
+	atomic_set(&fs_prefetch_miss, 0);
+	atomic_set(&fs_prefetch_wasted, 0);
+
+	pr_info("%s, %lu prefetch slots, default policy %s\n", __func__, FS_PREFETCH_SLOT_NUM,
+		fs_prefetch_policies[FS_PREFETCH_DEFAULT_POLICY].name);
+	return 0;
+}
+
+/**
+ * Invoked after the RDMA connections are closed,
+ * no more CQ callbacks can touch the slots.
+ */
+void free_fs_prefetch(void)
+{
+	size_t i;
+
+	if (fs_prefetch_slots == NULL)
+		return;
+
+	for (i = 0; i < FS_PREFETCH_SLOT_NUM; i++) {
+		if (fs_prefetch_slots[i].state != FS_SLOT_EMPTY)
+			__free_page(fs_prefetch_slots[i].page);
+	}
+
+	vfree(fs_prefetch_slots);
+	fs_prefetch_slots = NULL;
+}
+
+/**
+ * Hit ratio = hit / (hit + miss), accuracy = hit / issued.
+ * No FPU in kernel, print them in per-mille.
+ */
+void fs_prefetch_print_stats(void)
+{
+	int issued = atomic_read(&fs_prefetch_issued);
+	int hit = atomic_read(&fs_prefetch_hit);
+	int miss = atomic_read(&fs_prefetch_miss);
+	int wasted = atomic_read(&fs_prefetch_wasted);
+
+	pr_warn("%s, prefetch issued %d, hit %d, miss %d, wasted %d\n", __func__, issued, hit, miss, wasted);
+	pr_warn("%s, hit ratio %d/1000, accuracy %d/1000\n", __func__,
+		(hit + miss) ? (int)((long)hit * 1000 / (hit + miss)) : 0,
+		issued ? (int)((long)hit * 1000 / issued) : 0);
+}
+
+#endif // end of SEMERU_FS_PREFETCH
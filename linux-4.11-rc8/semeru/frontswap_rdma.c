@@ -31,6 +31,7 @@
 // Semeru
 #include "frontswap_path.h"
 #include "semeru_cpu.h"
+#include "semeru_trace.h"
 
 // kernel header
 //#include <linux/swap_global_struct_mem_layer.h>
@@ -77,18 +78,15 @@ u64 cq_get_count = 0;
  * to always [madvise] never
  * OR we have to delete the last level pte.
  * 
- * [XX] If too many pages need to be walked, switch to huge page.
- * 			Or this function will cause significantly overhead.
- * 
+ * The control path walks a range once per pmd, see meta_data_map_sg().
  * 
  */
-static pte_t *walk_page_table(struct mm_struct *mm, uint64_t addr)
+static pmd_t *walk_page_table_pmd(struct mm_struct *mm, uint64_t addr)
 {
 	pgd_t *pgd;
 	p4d_t *p4d;
 	pud_t *pud;
 	pmd_t *pmd;
-	pte_t *ptep;
 
 	pgd = pgd_offset(mm, addr);
 
@@ -107,9 +105,7 @@ static pte_t *walk_page_table(struct mm_struct *mm, uint64_t addr)
 	if (pmd_none(*pmd))
 		return NULL;
 
-	ptep = pte_offset_map(pmd, addr);
-
-	return ptep;
+	return pmd;
 }
 
 //
@@ -260,9 +256,28 @@ int handle_recv_wr(struct semeru_rdma_queue *rdma_queue, struct ib_wc *wc)
 		printk(KERN_INFO "%s, Received FREE_SIZE, avaible chunk number : %d \n ", __func__,
 		       rdma_session->rdma_recv_req.recv_buf->mapped_chunk);
 
+		// The response of REATTACH. Keep the chunk list, its chunks are bound again with the new rkeys.
+		if (rdma_session->remote_chunk_list.remote_chunk != NULL) {
+			if (rdma_session->rdma_recv_req.recv_buf->mapped_chunk != rdma_session->remote_chunk_list.chunk_num) {
+				printk(KERN_ERR "%s, memory server[%d] restarted with %d chunks, it had %u. \n", __func__,
+				       rdma_session->mem_server_id, rdma_session->rdma_recv_req.recv_buf->mapped_chunk,
+				       rdma_session->remote_chunk_list.chunk_num);
+				rdma_session->heap_lost = true;
+			}
+			rdma_queue->state = FREE_MEM_RECV;
+			wake_up_interruptible(&rdma_queue->sem);
+			break;
+		}
+
 		rdma_session->remote_chunk_list.chunk_num = rdma_session->rdma_recv_req.recv_buf->mapped_chunk;
 		rdma_queue->state = FREE_MEM_RECV;
 
+		// Each data chunk is at its own index on whichever memory server holds it.
+		if (rdma_session->remote_chunk_list.chunk_num < RDMA_META_REGION_NUM + RDMA_DATA_REGION_NUM)
+			printk(KERN_ERR "%s, memory server[%d] has %u chunks, the data Regions up to chunk[%d] are unavailable. \n",
+			       __func__, rdma_session->mem_server_id, rdma_session->remote_chunk_list.chunk_num,
+			       RDMA_META_REGION_NUM + RDMA_DATA_REGION_NUM - 1);
+
 		ret = init_remote_chunk_list(rdma_session);
 		if (unlikely(ret)) {
 			printk(KERN_ERR "Initialize the remote chunk failed. \n");
@@ -281,6 +296,13 @@ int handle_recv_wr(struct semeru_rdma_queue *rdma_queue, struct ib_wc *wc)
 		rdma_queue->state = RECEIVED_CHUNKS;
 		wake_up_interruptible(&rdma_queue->sem); // Finish main function.
 
+		// Or the response of EXPAND_CHUNKS.
+		complete(&rdma_session->remote_chunk_list.resize_done);
+		break;
+
+	case DONE:
+		// The response of RELEASE_CHUNKS, the chunks are unmapped before the request.
+		complete(&rdma_session->remote_chunk_list.resize_done);
 		break;
 
 	default:
@@ -378,6 +400,402 @@ err:
 	return ret;
 }
 
+/**
+ * Post the recv wr for the memory server state notification.
+ * Also invoked to re-post them on the new QP of a reattached memory server, the waiters may still sleep on notify->wait.
+ */
+static int post_mem_server_notify(struct rdma_session_context *rdma_session)
+{
+	int ret = 0;
+	int i;
+	const struct ib_recv_wr *bad_wr;
+	struct cp_notify *notify = &rdma_session->notify;
+	struct semeru_rdma_queue *rdma_queue = &(rdma_session->rdma_queues[MEM_SERVER_NOTIFY_QUEUE]);
+
+	for (i = 0; i < CP_NOTIFY_RECV_NUM; i++) {
+		notify->recv[i].rdma_session = rdma_session;
+		notify->recv[i].cqe.done = mem_server_notify_done;
+		notify->recv[i].rq_wr.wr_cqe = &(notify->recv[i].cqe);
+		// The zero-byte send only carries imm_data.
+		// But the 2-sided message of a chunk resizing lands here too, the recv wr are consumed in order.
+		notify->recv[i].rq_wr.sg_list = &(rdma_session->rdma_recv_req.recv_sgl);
+		notify->recv[i].rq_wr.num_sge = 1;
+		notify->recv[i].rq_wr.next = NULL;
+
+		ret = ib_post_recv(rdma_queue->qp, &(notify->recv[i].rq_wr), &bad_wr);
+		if (unlikely(ret)) {
+			printk(KERN_ERR "%s, post the notification recv wr to memory server[%d] failed, %d \n", __func__,
+			       rdma_session->mem_server_id, ret);
+			goto err;
+		}
+	}
+
+	notify->enabled = true;
+
+err:
+	return ret;
+}
+
+/**
+ * Invoked after the chunk mapping, all the 2-sided messages of the connection are received.
+ */
+int init_mem_server_notify(struct rdma_session_context *rdma_session)
+{
+	atomic_set(&rdma_session->notify.state, 0);
+	init_waitqueue_head(&rdma_session->notify.wait);
+
+	return post_mem_server_notify(rdma_session);
+}
+
+/**
+ * Received a state notification from the memory server.
+ * Record the state, wake up the waiters and re-post the recv wr.
+ * A message without imm_data is the response of EXPAND_CHUNKS/RELEASE_CHUNKS, pass it to handle_recv_wr.
+ * 
+ * Invoked by whoever polls the CQ of rdma_queues[MEM_SERVER_NOTIFY_QUEUE].
+ */
+void mem_server_notify_done(struct ib_cq *cq, struct ib_wc *wc)
+{
+	struct cp_notify_recv *recv = container_of(wc->wr_cqe, struct cp_notify_recv, cqe);
+	struct cp_notify *notify = &(recv->rdma_session->notify);
+	const struct ib_recv_wr *bad_wr;
+
+	if (unlikely(wc->status != IB_WC_SUCCESS)) {
+		// The QP is being destroyed, don't re-post.
+		if (wc->status != IB_WC_WR_FLUSH_ERR) {
+			printk(KERN_ERR "%s, memory server[%d] notification failed, status %d, %s \n", __func__,
+			       recv->rdma_session->mem_server_id, wc->status, rdma_wc_status_name(wc->status));
+		}
+		return;
+	}
+
+	if (likely(wc->wc_flags & IB_WC_WITH_IMM)) {
+		atomic_set(&notify->state, (int)be32_to_cpu(wc->ex.imm_data));
+		wake_up(&notify->wait);
+	} else if (handle_recv_wr(&(recv->rdma_session->rdma_queues[MEM_SERVER_NOTIFY_QUEUE]), wc)) {
+		printk(KERN_ERR "%s, memory server[%d] wrong message without imm_data. \n", __func__,
+		       recv->rdma_session->mem_server_id);
+	}
+
+	if (unlikely(ib_post_recv(wc->qp, &(recv->rq_wr), &bad_wr))) {
+		printk(KERN_ERR "%s, re-post the notification recv wr to memory server[%d] failed. \n", __func__,
+		       recv->rdma_session->mem_server_id);
+	}
+}
+
+/**
+ * The session of mem_server_id serving the address window of the calling JVM, NULL if it has none.
+ * For the control path requests without an address, e.g. the notification and the doorbell.
+ */
+static struct rdma_session_context *cp_caller_session(int mem_server_id)
+{
+	int window = semeru_window_of_mm(current->mm);
+
+	if (unlikely(window < 0 || mem_server_id < 0 || mem_server_id >= num_mem_servers)) {
+		pr_err("%s, no session of memory server[%d] for the caller \n", __func__, mem_server_id);
+		return NULL;
+	}
+	return fs_session(window, mem_server_id);
+}
+
+/**
+ * Semeru Control Path - Wait for the memory server of the caller's address window to reach a state.
+ * 
+ * Parameters:
+ * 	state : the state pushed by the memory server. 0 resets the recorded state and returns directly.
+ * 
+ * The CQ is IB_POLL_DIRECT, the waiter reaps the notification by itself.
+ * With the adaptive polling, the CQ is armed and semeru_cq_comp_handler wakes us up.
+ * Or re-poll the CQ every CQ_SLEEP_TIMEOUT_MS.
+ * 
+ * return :
+ * 	0 for success, -1 for timeout or no notification support.
+ */
+int semeru_wait_mem_server_state(int mem_server_id, int state)
+{
+	unsigned long flags;
+	unsigned long deadline;
+	struct cp_notify *notify;
+	struct semeru_rdma_queue *rdma_queue;
+	struct rdma_session_context *rdma_session = cp_caller_session(mem_server_id);
+
+	if (unlikely(rdma_session == NULL))
+		return -1;
+	notify = &(rdma_session->notify);
+	rdma_queue = &(rdma_session->rdma_queues[MEM_SERVER_NOTIFY_QUEUE]);
+
+	if (unlikely(!notify->enabled))
+		return -1;
+
+	if (state <= 0) {
+		atomic_set(&notify->state, 0);
+		return 0;
+	}
+
+	deadline = jiffies + msecs_to_jiffies(CP_NOTIFY_TIMEOUT_MS);
+	while (atomic_read(&notify->state) < state) {
+		// 1) reap the notification
+		spin_lock_irqsave(&rdma_queue->cq_lock, flags);
+		ib_process_cq_direct(rdma_queue->cq, 16);
+		spin_unlock_irqrestore(&rdma_queue->cq_lock, flags);
+
+		if (atomic_read(&notify->state) >= state)
+			break;
+
+		if (time_after(jiffies, deadline)) {
+			pr_warn("%s, memory server[%d] state %d, wait for state %d timeout for %dms \n", __func__,
+				mem_server_id, atomic_read(&notify->state), state, CP_NOTIFY_TIMEOUT_MS);
+			return -1;
+		}
+
+		// 2) sleep
+#ifdef SEMERU_ADAPTIVE_POLLING
+		// Positive return value means some CQE arrived before arming, poll them directly.
+		if (ib_req_notify_cq(rdma_queue->cq, IB_CQ_NEXT_COMP | IB_CQ_REPORT_MISSED_EVENTS) > 0)
+			continue;
+#endif
+		wait_event_timeout(notify->wait, atomic_read(&notify->state) >= state,
+				   msecs_to_jiffies(CQ_SLEEP_TIMEOUT_MS));
+	}
+
+	return 0;
+}
+
+/**
+ * Prepare the doorbell send wr of the session.
+ * Invoked with the state notification, both of them use rdma_queues[MEM_SERVER_NOTIFY_QUEUE].
+ */
+void init_cp_doorbell(struct rdma_session_context *rdma_session)
+{
+	struct cp_doorbell *doorbell = &rdma_session->doorbell;
+
+	mutex_init(&doorbell->lock);
+	doorbell->rdma_queue = &(rdma_session->rdma_queues[MEM_SERVER_NOTIFY_QUEUE]);
+	doorbell->cqe.done = cp_doorbell_done;
+
+	memset(&doorbell->sq_wr, 0, sizeof(struct ib_send_wr));
+	doorbell->sq_wr.wr_cqe = &doorbell->cqe;
+	doorbell->sq_wr.opcode = IB_WR_SEND_WITH_IMM;
+	doorbell->sq_wr.send_flags = IB_SEND_SIGNALED;
+	doorbell->sq_wr.sg_list = NULL; // zero-byte send
+	doorbell->sq_wr.num_sge = 0;
+}
+
+void cp_doorbell_done(struct ib_cq *cq, struct ib_wc *wc)
+{
+	struct cp_doorbell *doorbell = container_of(wc->wr_cqe, struct cp_doorbell, cqe);
+
+	if (unlikely(wc->status != IB_WC_SUCCESS)) {
+		printk(KERN_ERR "%s, doorbell failed, status %d, %s \n", __func__, wc->status,
+		       rdma_wc_status_name(wc->status));
+	}
+
+	atomic_dec(&doorbell->rdma_queue->rdma_post_counter);
+}
+
+/**
+ * Semeru Control Path - Wake up the memory server.
+ * 
+ * Invoke it after the CSet or flags are written. RC QP places the data before the ack,
+ * the memory server sees the written data when it receives the doorbell.
+ * The memory server only uses the seqno to tell a new doorbell, it doesn't have to be continuous.
+ * 
+ * return :
+ * 	0 for success, -1 for error. The memory server falls back to its periodical check.
+ */
+int semeru_cp_ring_doorbell(int mem_server_id, unsigned int seqno)
+{
+	int ret = 0;
+	const struct ib_send_wr *bad_wr;
+	struct cp_doorbell *doorbell;
+	struct rdma_session_context *rdma_session = cp_caller_session(mem_server_id);
+
+	if (unlikely(rdma_session == NULL))
+		return -1;
+	doorbell = &(rdma_session->doorbell);
+
+	// The doorbell is prepared with the notification.
+	if (unlikely(!rdma_session->notify.enabled))
+		return -1;
+
+	mutex_lock(&doorbell->lock);
+
+	doorbell->sq_wr.ex.imm_data = cpu_to_be32(seqno);
+	atomic_inc(&doorbell->rdma_queue->rdma_post_counter);
+	ret = ib_post_send(doorbell->rdma_queue->qp, &doorbell->sq_wr, &bad_wr);
+	if (unlikely(ret)) {
+		atomic_dec(&doorbell->rdma_queue->rdma_post_counter);
+		pr_err("%s, post doorbell %u to memory server[%d] failed, %d \n", __func__, seqno, mem_server_id, ret);
+		ret = -1;
+		goto out;
+	}
+
+	// The sq_wr is reused by the next doorbell, wait for the send.
+	drain_rdma_queue(doorbell->rdma_queue);
+
+out:
+	mutex_unlock(&doorbell->lock);
+	return ret;
+}
+
+/**
+ * Prepare the atomic wr and its result buffer of the session.
+ * Invoked after the chunks are mapped, the session is reattached with the same device.
+ *
+ * return :
+ * 	0 for success, -1 if the device doesn't support the atomics.
+ */
+int init_cp_atomic(struct rdma_session_context *rdma_session)
+{
+	struct cp_atomic *atomic = &rdma_session->atomic;
+	struct ib_device *dev = rdma_session->rdma_dev->dev;
+
+	if (atomic->result != NULL)
+		return atomic->enabled ? 0 : -1;
+
+	mutex_init(&atomic->lock);
+	atomic->enabled = false;
+	atomic->rdma_queue = &(rdma_session->rdma_queues[MEM_SERVER_NOTIFY_QUEUE]);
+	atomic->cqe.done = cp_atomic_done;
+
+	if (dev->attrs.atomic_cap == IB_ATOMIC_NONE) {
+		printk(KERN_WARNING "%s, RDMA device %s doesn't support atomics. \n", __func__, dev->name);
+		return -1;
+	}
+
+	atomic->result = kzalloc(sizeof(uint64_t), GFP_KERNEL);
+	if (unlikely(atomic->result == NULL))
+		return -1;
+	atomic->result_dma_addr = ib_dma_map_single(dev, atomic->result, sizeof(uint64_t), DMA_FROM_DEVICE);
+	if (unlikely(ib_dma_mapping_error(dev, atomic->result_dma_addr))) {
+		kfree(atomic->result);
+		atomic->result = NULL;
+		return -1;
+	}
+
+	atomic->sge.addr = atomic->result_dma_addr;
+	atomic->sge.length = sizeof(uint64_t);
+	atomic->sge.lkey = dev->local_dma_lkey;
+
+	memset(&atomic->atomic_wr, 0, sizeof(struct ib_atomic_wr));
+	atomic->atomic_wr.wr.wr_cqe = &atomic->cqe;
+	atomic->atomic_wr.wr.send_flags = IB_SEND_SIGNALED;
+	atomic->atomic_wr.wr.sg_list = &atomic->sge;
+	atomic->atomic_wr.wr.num_sge = 1;
+
+	atomic->enabled = true;
+	return 0;
+}
+
+void cp_atomic_release(struct rdma_session_context *rdma_session)
+{
+	struct cp_atomic *atomic = &rdma_session->atomic;
+
+	if (atomic->result == NULL)
+		return;
+
+	atomic->enabled = false;
+	ib_dma_unmap_single(rdma_session->rdma_dev->dev, atomic->result_dma_addr, sizeof(uint64_t), DMA_FROM_DEVICE);
+	kfree(atomic->result);
+	atomic->result = NULL;
+}
+
+void cp_atomic_done(struct ib_cq *cq, struct ib_wc *wc)
+{
+	struct cp_atomic *atomic = container_of(wc->wr_cqe, struct cp_atomic, cqe);
+
+	atomic->status = wc->status;
+	if (unlikely(wc->status != IB_WC_SUCCESS)) {
+		printk(KERN_ERR "%s, atomic failed, status %d, %s \n", __func__, wc->status,
+		       rdma_wc_status_name(wc->status));
+	}
+
+	atomic_dec(&atomic->rdma_queue->rdma_post_counter);
+}
+
+/**
+ * Semeru Control Path - Remote atomic
+ * CAS or fetch-and-add an 8 bytes word of the meta space on memory server mem_server_id, in the word's address window.
+ * The meta Regions are the same on all the memory servers, the word is addressed by the meta chunk.
+ *
+ * Warning : the RDMA device's atomics are only atomic to each other, not to the CPU atomics of the memory server.
+ * 	The memory server has to update the word by the loopback atomics or leave it to the CPU server.
+ *
+ * return :
+ * 	0 for success, the old value is in atomic->result. -1 for error.
+ */
+int semeru_cp_rdma_atomic(int mem_server_id, struct semeru_rdma_atomic *atomic)
+{
+	int ret = 0;
+	const struct ib_send_wr *bad_wr;
+	struct rdma_session_context *rdma_session;
+	struct cp_atomic *cp_atomic;
+	struct remote_mapping_chunk *remote_chunk_ptr;
+	uint64_t addr = (uint64_t)atomic->addr;
+	int window = semeru_meta_window_of(addr, sizeof(uint64_t));
+
+	if (unlikely(mem_server_id < 0 || mem_server_id >= num_mem_servers)) {
+		pr_err("%s, wrong memory server id %d \n", __func__, mem_server_id);
+		return -1;
+	}
+	if (unlikely(window < 0 || (addr & (sizeof(uint64_t) - 1)) ||
+		     (atomic->op != SEMERU_RDMA_ATOMIC_CAS && atomic->op != SEMERU_RDMA_ATOMIC_FETCH_ADD))) {
+		pr_err("%s, wrong atomic op %d on 0x%llx \n", __func__, atomic->op, addr);
+		return -1;
+	}
+
+	rdma_session = fs_session(window, mem_server_id);
+	cp_atomic = &rdma_session->atomic;
+	if (unlikely(!cp_atomic->enabled))
+		return -1;
+
+	remote_chunk_ptr = &(rdma_session->remote_chunk_list.remote_chunk[(addr - semeru_meta_start(window)) >> CHUNK_SHIFT]);
+	if (unlikely(remote_chunk_ptr->remote_addr == 0)) {
+		pr_err("%s, the meta chunk of 0x%llx isn't mapped on memory server[%d] \n", __func__, addr, mem_server_id);
+		return -1;
+	}
+
+	mutex_lock(&cp_atomic->lock);
+
+	if (atomic->op == SEMERU_RDMA_ATOMIC_CAS) {
+		cp_atomic->atomic_wr.wr.opcode = IB_WR_ATOMIC_CMP_AND_SWP;
+		cp_atomic->atomic_wr.swap = atomic->swap;
+	} else {
+		cp_atomic->atomic_wr.wr.opcode = IB_WR_ATOMIC_FETCH_AND_ADD;
+		cp_atomic->atomic_wr.swap = 0;
+	}
+	cp_atomic->atomic_wr.compare_add = atomic->compare_add;
+	cp_atomic->atomic_wr.remote_addr = remote_chunk_ptr->remote_addr + (addr & CHUNK_MASK);
+	cp_atomic->atomic_wr.rkey = remote_chunk_ptr->remote_rkey;
+	cp_atomic->status = IB_WC_GENERAL_ERR;
+
+	atomic_inc(&cp_atomic->rdma_queue->rdma_post_counter);
+	ret = ib_post_send(cp_atomic->rdma_queue->qp, &cp_atomic->atomic_wr.wr, &bad_wr);
+	if (unlikely(ret)) {
+		atomic_dec(&cp_atomic->rdma_queue->rdma_post_counter);
+		pr_err("%s, post atomic on 0x%llx to memory server[%d] failed, %d \n", __func__, addr, mem_server_id, ret);
+		ret = -1;
+		goto out;
+	}
+
+	// The result buffer is reused by the next atomic, wait for it.
+	drain_rdma_queue(cp_atomic->rdma_queue);
+	if (unlikely(cp_atomic->status != IB_WC_SUCCESS)) {
+		ret = -1;
+		goto out;
+	}
+
+	ib_dma_sync_single_for_cpu(rdma_session->rdma_dev->dev, cp_atomic->result_dma_addr, sizeof(uint64_t),
+				   DMA_FROM_DEVICE);
+	atomic->result = *(cp_atomic->result);
+	ib_dma_sync_single_for_device(rdma_session->rdma_dev->dev, cp_atomic->result_dma_addr, sizeof(uint64_t),
+				      DMA_FROM_DEVICE);
+
+out:
+	mutex_unlock(&cp_atomic->lock);
+	return ret;
+}
+
 //
 // <<<<<<<<<<<<<<  End of handling TWO-SIDED RDMA message section <<<<<<<<<<<<<<
 //
@@ -490,6 +908,9 @@ int semeru_rdma_cm_event_handler(struct rdma_cm_id *cma_id, struct rdma_cm_event
 			// All the QP are disconnected already.
 
 			rdma_queue->freed = 255; // one of memory servers crashed
+
+			// It may come back with its data Regions, -XX:SemeruMemPoolFile.
+			semeru_schedule_reattach(rdma_queue->rdma_session);
 		}
 		break;
 
@@ -539,9 +960,12 @@ static int rdma_resolve_ip_to_ib_device(struct rdma_session_context *rdma_sessio
 
 
 	sin4->sin_family = AF_INET;
-	memcpy((void *)&(sin4->sin_addr.s_addr), rdma_session->addr, 4);   	// copy 32bits/ 4bytes from cb->addr to sin4->sin_addr.s_addr
+	memcpy((void *)&(sin4->sin_addr.s_addr), rdma_session->path_addr[rdma_queue->path], 4);   	// copy 32bits/ 4bytes of the port's addr to sin4->sin_addr.s_addr
 	sin4->sin_port = rdma_session->port;                             		// assign cb->port to sin4->sin_port
 
+	// The route, SL or traffic class, is resolved by the type of service of the traffic on the QP.
+	if (rdma_queue->q_index == control_path_fixed_qp ? cp_tos != 0 : dp_tos != 0)
+		rdma_set_service_type(rdma_queue->cm_id, rdma_queue->q_index == control_path_fixed_qp ? cp_tos : dp_tos);
 
 	ret = rdma_resolve_addr(rdma_queue->cm_id, NULL, (struct sockaddr *)&sin, 2000); // timeout time 2000ms 
 	if (ret) {
@@ -562,10 +986,39 @@ static int rdma_resolve_ip_to_ib_device(struct rdma_session_context *rdma_sessio
 		return -EINTR;
 	}
 
+	// The PD, the lkey and the DMA mapping are per HCA. All the QPs of a session have to be on the same one.
+	if (rdma_session->rdma_dev != NULL && rdma_queue->cm_id->device != rdma_session->rdma_dev->dev) {
+		printk(KERN_ERR "%s, rdma_queue[%d] port %d is resolved to another HCA %s\n", __func__,
+		       rdma_queue->q_index, rdma_queue->path, rdma_queue->cm_id->device->name);
+		return -EXDEV;
+	}
+
 	printk(KERN_INFO "%s, resolve address and route successfully\n", __func__);
 	return ret;
 }
 
+/**
+ * The port of the rdma_queue can't be resolved, remove it from the session.
+ * Connect the rdma_queue through the first port, by a new cm_id. The failed cm_id may have a bound device.
+ */
+static int rdma_resolve_first_path(struct rdma_session_context *rdma_session, struct semeru_rdma_queue *rdma_queue)
+{
+	if (!test_and_set_bit(rdma_queue->path, &rdma_session->failed_paths))
+		pr_warn("%s, memory server[%d] port %d is removed.\n", __func__, rdma_session->mem_server_id,
+			rdma_queue->path);
+
+	rdma_destroy_id(rdma_queue->cm_id);
+	rdma_queue->path = 0;
+	rdma_queue->state = IDLE;
+	rdma_queue->cm_id = rdma_create_id(&init_net, semeru_rdma_cm_event_handler, rdma_queue, RDMA_PS_TCP, IB_QPT_RC);
+	if (IS_ERR(rdma_queue->cm_id)) {
+		printk(KERN_ERR "failed to create cm id: %ld\n", PTR_ERR(rdma_queue->cm_id));
+		return -ENODEV;
+	}
+
+	return rdma_resolve_ip_to_ib_device(rdma_session, rdma_queue);
+}
+
 
 
 /**
@@ -585,14 +1038,22 @@ int semeru_create_qp(struct rdma_session_context *rdma_session, struct semeru_rd
 	init_attr.sq_sig_type = IB_SIGNAL_REQ_WR;     // Receive a signal when posted wr is done.
 	init_attr.qp_type = IB_QPT_RC;                // Queue Pair connect type, Reliable Communication.  [?] Already assign this during create cm_id.
 
+	init_attr.cap.max_inline_data = CP_RDMA_INLINE_MAX;	// the small control path writes
+
 	// Both recv_cq and send_cq use the same cq.
 	init_attr.send_cq = rdma_queue->cq;
 	init_attr.recv_cq = rdma_queue->cq;
 
 	ret = rdma_create_qp(rdma_queue->cm_id, rdma_session->rdma_dev->pd, &init_attr);
+	if (ret) {
+		// The device can't send this much inline, every write goes through the pages.
+		init_attr.cap.max_inline_data = 0;
+		ret = rdma_create_qp(rdma_queue->cm_id, rdma_session->rdma_dev->pd, &init_attr);
+	}
 	if (!ret){
 		// Record this queue pair.
 		rdma_queue->qp = rdma_queue->cm_id->qp;
+		rdma_queue->max_inline = init_attr.cap.max_inline_data >= CP_RDMA_INLINE_MAX ? CP_RDMA_INLINE_MAX : 0;
   	}else{
     	printk(KERN_ERR "%s:  Create QP falied. errno : %d \n", __func__, ret);
   	}
@@ -629,13 +1090,35 @@ int semeru_create_rdma_queue(struct rdma_session_context *rdma_session, int rdma
 			printk(KERN_ERR "%s, ib_alloc_pd failed\n", __func__);
 			goto err;
 		}
-		printk(KERN_INFO "%s, created pd %p\n", __func__, rdma_session->rdma_dev->pd);
+		printk(KERN_INFO "%s, created pd %p, NIC on numa node %d\n", __func__, rdma_session->rdma_dev->pd,
+		       dev_to_node(&cm_id->device->dev));
+
+		// Soft-RoCE (rxe) and the virtual HCAs of the CI machines are smaller than the lab's HCAs.
+		// Shorten the send queue. The gather list of the control path can't be shortened.
+		if (cm_id->device->attrs.max_sge < MAX_REQUEST_SGL) {
+			printk(KERN_ERR "%s, %s supports %d sge per wr, %d needed.\n", __func__, cm_id->device->name,
+			       cm_id->device->attrs.max_sge, (int)MAX_REQUEST_SGL);
+			ret = -EINVAL;
+			goto err;
+		}
+		if (rdma_session->send_queue_depth > cm_id->device->attrs.max_qp_wr ||
+		    rdma_session->send_queue_depth + rdma_session->recv_queue_depth > cm_id->device->attrs.max_cqe) {
+			rdma_session->send_queue_depth = min(cm_id->device->attrs.max_qp_wr,
+							     cm_id->device->attrs.max_cqe - rdma_session->recv_queue_depth);
+			printk(KERN_WARNING "%s, %s, send queue depth is limited to %d.\n", __func__, cm_id->device->name,
+			       rdma_session->send_queue_depth);
+		}
 
 		// Time to reserve RDMA buffer for this session.
 		setup_rdma_session_commu_buffer(rdma_session);
 	}
 
 	// 2) Build CQ
+	// Spread the queues over the completion vectors, the IRQ of each vector is affine to its own cores.
+	// Only the armed CQ raises the interrupt, see SEMERU_ADAPTIVE_POLLING.
+	if (cm_id->device->num_comp_vectors > 0)
+		comp_vector = rdma_queue_index % cm_id->device->num_comp_vectors;
+
 	rdma_queue->cq = ib_alloc_cq(cm_id->device, rdma_queue,
 				     (rdma_session->send_queue_depth + rdma_session->recv_queue_depth), comp_vector,
 				     IB_POLL_DIRECT);
@@ -646,6 +1129,19 @@ int semeru_create_rdma_queue(struct rdma_session_context *rdma_session, int rdma
 	}
 	printk(KERN_INFO "%s, created cq %p\n", __func__, rdma_queue->cq);
 
+#ifdef SEMERU_ADAPTIVE_POLLING
+	// IB_POLL_DIRECT CQ has no interrupt handler, install ours to wake up the sleepers.
+	// The CQ is only armed by wait_rdma_queue().
+	rdma_queue->cq->comp_handler = semeru_cq_comp_handler;
+#endif
+
+#ifdef SEMERU_FS_DMA_BOUNCE
+	// The device is known now, map the bounce pages once.
+	ret = init_fs_dma_bounce_pool(rdma_queue, cm_id->device);
+	if (unlikely(ret))
+		goto err;
+#endif
+
 	// 3) Build QP.
 	ret = semeru_create_qp(rdma_session, rdma_queue);
 	if (ret) {
@@ -770,6 +1266,7 @@ err:
  */
 int semeru_connect_remote_memory_server(struct rdma_session_context *rdma_session, int rdma_queue_inx ){
 	struct rdma_conn_param conn_param;
+	struct semeru_meta_layout_digest layout_digest;
 	int ret;
 	struct semeru_rdma_queue * rdma_queue;
 	const struct ib_recv_wr *bad_wr;
@@ -780,6 +1277,15 @@ int semeru_connect_remote_memory_server(struct rdma_session_context *rdma_sessio
 	conn_param.responder_resources = 1;
 	conn_param.initiator_depth = 1;
 	conn_param.retry_count = 10;
+	conn_param.rnr_retry_count = 7; // infinite retry, the memory server re-posts the recv wr of doorbells.
+
+	// The memory server rejects the connection if its layout doesn't match, RDMA_CM_EVENT_REJECTED.
+	memset(&layout_digest, 0, sizeof(layout_digest));
+	layout_digest.magic = SEMERU_META_LAYOUT_KERNEL_MAGIC;
+	layout_digest.mem_server_num = num_mem_servers;
+	layout_digest.heap_size = RDMA_DATA_SPACE_SIZE;
+	conn_param.private_data = &layout_digest;
+	conn_param.private_data_len = sizeof(layout_digest);
 
 	// After rdma connection built, memory server will send a 2-sided RDMA message immediately
 	// post a recv on cq to wait wc
@@ -973,6 +1479,8 @@ int init_remote_chunk_list(struct rdma_session_context *rdma_session ){
 	//		The 2nd -> rest are fully mapped at REGION_SIZE_GB size.
 	rdma_session->remote_chunk_list.chunk_ptr = 0;	// Points to the first empty chunk.
 	rdma_session->remote_chunk_list.remote_free_size = 0; // not clear the exactly free size now.
+	mutex_init(&rdma_session->remote_chunk_list.resize_lock);
+	init_completion(&rdma_session->remote_chunk_list.resize_done);
 	rdma_session->remote_chunk_list.remote_chunk = (struct remote_mapping_chunk*)kzalloc(  \
 																									sizeof(struct remote_mapping_chunk) * rdma_session->remote_chunk_list.chunk_num,\
 																									GFP_KERNEL);
@@ -994,71 +1502,261 @@ int init_remote_chunk_list(struct rdma_session_context *rdma_session ){
 
 /**
  * Get a chunk mapping 2-sided RDMA message.
- * Bind these chunks to the cient in order.
+ * Bind these chunks to the cient by their index.
  * 
  *	1) The information of Chunks to be bound,  is stored in the recv WR associated DMA buffer.
  * Record the address of the mapped chunk:
  * 		remote_rkey : Used by the client, read/write data here.
  * 		remote_addr : The actual virtual address of the mapped chunk
  * 
- *	2) Attach the received chunks to the rdma_session_context->remote_mapping_chunk_list->remote_mapping_chunk[]
+ *	2) Attach the received chunk i to the rdma_session_context->remote_mapping_chunk_list->remote_mapping_chunk[i].
+ *	   The memory server may only send part of its chunks at connection, and the others by EXPAND_CHUNKS.
  */
 void bind_remote_memory_chunks(struct rdma_session_context *rdma_session ){
 
 	int i; 
-	uint32_t *chunk_ptr;
+	struct remote_mapping_chunk *remote_chunk_ptr;
+	struct message *recv_buf = rdma_session->rdma_recv_req.recv_buf;
 
-	chunk_ptr = &(rdma_session->remote_chunk_list.chunk_ptr);
 	// Traverse the receive WR to find all the got chunks.
 	for(i = 0; i < MAX_REGION_NUM; i++ ){
 		
-		#if defined(DEBUG_MODE_BRIEF) || defined(DEBUG_MODE_DETAIL)
-		if( *chunk_ptr >= rdma_session->remote_chunk_list.chunk_num){
-			printk(KERN_ERR "%s, Get too many chunks. \n", __func__);
+		if(recv_buf->rkey[i] == 0)
+			continue;
+
+		if(unlikely(i >= rdma_session->remote_chunk_list.chunk_num)){
+			printk(KERN_ERR "%s, Get chunk[%d] out of the %u chunks. \n", __func__, i, rdma_session->remote_chunk_list.chunk_num);
 			break;
 		}
-		#endif
-		
-		if(rdma_session->rdma_recv_req.recv_buf->rkey[i]){
-			// Sent chunk, attach to current chunk_list's tail.
-			rdma_session->remote_chunk_list.remote_chunk[*chunk_ptr].remote_rkey = rdma_session->rdma_recv_req.recv_buf->rkey[i];
-			rdma_session->remote_chunk_list.remote_chunk[*chunk_ptr].remote_addr = rdma_session->rdma_recv_req.recv_buf->buf[i];
-			rdma_session->remote_chunk_list.remote_chunk[*chunk_ptr].mapped_size = rdma_session->rdma_recv_req.recv_buf->mapped_size[i];
-			rdma_session->remote_chunk_list.remote_chunk[*chunk_ptr].chunk_state = MAPPED;
-			
-			rdma_session->remote_chunk_list.remote_free_size += rdma_session->rdma_recv_req.recv_buf->mapped_size[i]; // byte size, 4KB alignment
 
+		remote_chunk_ptr = &(rdma_session->remote_chunk_list.remote_chunk[i]);
+		if(remote_chunk_ptr->chunk_state != MAPPED){
+			rdma_session->remote_chunk_list.chunk_ptr++;
+			rdma_session->remote_chunk_list.remote_free_size += recv_buf->mapped_size[i]; // byte size, 4KB alignment
+		}
 
-			#if defined(DEBUG_MODE_BRIEF) || defined(DEBUG_MODE_DETAIL)
-				printk(KERN_INFO "Got chunk[%d] : remote_addr : 0x%llx, remote_rkey: 0x%x, mapped_size: 0x%llx \n", i, 
-																						rdma_session->remote_chunk_list.remote_chunk[*chunk_ptr].remote_addr,
-																						rdma_session->remote_chunk_list.remote_chunk[*chunk_ptr].remote_rkey,
-																						rdma_session->remote_chunk_list.remote_chunk[*chunk_ptr].mapped_size);
-			#endif
+		remote_chunk_ptr->remote_rkey = recv_buf->rkey[i];
+		remote_chunk_ptr->remote_addr = recv_buf->buf[i];
+		remote_chunk_ptr->mapped_size = recv_buf->mapped_size[i];
 
-			(*chunk_ptr)++;
-		}
+		// The data path checks the state without lock.
+		smp_wmb();
+		remote_chunk_ptr->chunk_state = MAPPED;
+		trace_semeru_chunk_bind(rdma_session->mem_server_id, i, remote_chunk_ptr->remote_addr,
+					remote_chunk_ptr->remote_rkey, remote_chunk_ptr->mapped_size, 1);
 
-	} // for
+		#if defined(DEBUG_MODE_BRIEF) || defined(DEBUG_MODE_DETAIL)
+			printk(KERN_INFO "Got chunk[%d] : remote_addr : 0x%llx, remote_rkey: 0x%x, mapped_size: 0x%llx \n", i, 
+																					remote_chunk_ptr->remote_addr,
+																					remote_chunk_ptr->remote_rkey,
+																					remote_chunk_ptr->mapped_size);
+		#endif
 
-	rdma_session->remote_chunk_list.chunk_num	= *chunk_ptr;  // Record the number of received chunks.
+	} // for
 
 }
 
+/**
+ * Expand or release the chunks [first, end) of one memory server.
+ * 
+ * The request is sent on rdma_queues[MEM_SERVER_NOTIFY_QUEUE]. The response lands in one of the
+ * notification recv wr, which are always posted, so no extra recv wr is counted in rdma_post_counter.
+ * 
+ * For releasing, the chunks are unmapped, and the outstanding data path requests are drained,
+ * before the memory server deregisters them.
+ */
+static int cp_resize_chunks_of_server(struct rdma_session_context *rdma_session, size_t first, size_t end, int expand)
+{
+	int ret = 0;
+	size_t i;
+	int nr_chunks = 0;
+	unsigned long flags;
+	unsigned long deadline;
+	const struct ib_send_wr *bad_wr;
+	struct remote_mapping_chunk_list *chunk_list = &rdma_session->remote_chunk_list;
+	struct semeru_rdma_queue *rdma_queue = &(rdma_session->rdma_queues[MEM_SERVER_NOTIFY_QUEUE]);
+	struct message *send_buf = rdma_session->rdma_send_req.send_buf;
 
+	if (unlikely(!rdma_session->notify.enabled)) {
+		pr_err("%s, memory server[%d] has no notification recv wr for the response. \n", __func__,
+		       rdma_session->mem_server_id);
+		return -1;
+	}
 
+	if (unlikely(end > chunk_list->chunk_num || end > MAX_REGION_NUM)) {
+		pr_err("%s, chunk[%lu, %lu) is out of the %u chunks of memory server[%d]. \n", __func__, first, end,
+		       chunk_list->chunk_num, rdma_session->mem_server_id);
+		return -1;
+	}
 
+	mutex_lock(&chunk_list->resize_lock);
 
-//
-// <<<<<<<<<<<<<<<<<<<<<  End of handling chunk management <<<<<<<<<<<<<<<<<<<<<
-//
+	// 1) Mark the chunks to be changed.
+	memset(send_buf->buf, 0, sizeof(send_buf->buf));
+	for (i = first; i < end; i++) {
+		if ((chunk_list->remote_chunk[i].chunk_state == MAPPED) == (expand != 0))
+			continue; // expanded or released already.
 
+		send_buf->buf[i] = 1;
+		nr_chunks++;
 
+		if (!expand) {
+			chunk_list->remote_chunk[i].chunk_state = EMPTY;
+			trace_semeru_chunk_bind(rdma_session->mem_server_id, i, chunk_list->remote_chunk[i].remote_addr,
+						chunk_list->remote_chunk[i].remote_rkey,
+						chunk_list->remote_chunk[i].mapped_size, 0);
+			chunk_list->chunk_ptr--;
+			chunk_list->remote_free_size -= chunk_list->remote_chunk[i].mapped_size;
+		}
+	}
+	if (nr_chunks == 0)
+		goto out;
 
+	// 2) No data path requests to the released chunks on the fly.
+	//    The data path checks the chunk state and posts with preemption disabled, get_cpu().
+	//    Wait for the posters that saw MAPPED, their requests are counted before the drain.
+	if (!expand) {
+		synchronize_sched();
+		drain_all_rdma_queue(rdma_session);
+	}
 
-//
-// >>>>>>>>>>>>>>>  Start of  RDMA Control Path >>>>>>>>>>>>>>>
-//
+	// 3) Send the request and poll the response.
+	reinit_completion(&chunk_list->resize_done);
+	send_buf->type = expand ? EXPAND_CHUNKS : RELEASE_CHUNKS;
+	send_buf->mapped_chunk = nr_chunks;
+
+	atomic_inc(&rdma_queue->rdma_post_counter);
+	ret = ib_post_send(rdma_queue->qp, &rdma_session->rdma_send_req.sq_wr, &bad_wr);
+	if (unlikely(ret)) {
+		atomic_dec(&rdma_queue->rdma_post_counter);
+		pr_err("%s, post %s to memory server[%d] failed, %d \n", __func__, expand ? "EXPAND_CHUNKS" : "RELEASE_CHUNKS",
+		       rdma_session->mem_server_id, ret);
+		ret = -1;
+		goto out;
+	}
+
+	// Registering a 4GB chunk as RDMA buffer takes a while on the memory server, don't spin on it.
+	deadline = jiffies + msecs_to_jiffies(CHUNK_RESIZE_TIMEOUT_MS);
+	while (!try_wait_for_completion(&chunk_list->resize_done)) {
+		spin_lock_irqsave(&rdma_queue->cq_lock, flags);
+		ib_process_cq_direct(rdma_queue->cq, 16);
+		spin_unlock_irqrestore(&rdma_queue->cq_lock, flags);
+
+		if (time_after(jiffies, deadline)) {
+			pr_err("%s, memory server[%d] response of %d chunks timeout for %dms \n", __func__,
+			       rdma_session->mem_server_id, nr_chunks, CHUNK_RESIZE_TIMEOUT_MS);
+			ret = -1;
+			goto out;
+		}
+		usleep_range(50, 100);
+	}
+
+	// 4) The memory server may not have enough memory to expand all of them.
+	if (expand) {
+		for (i = first; i < end; i++) {
+			if (send_buf->buf[i] && chunk_list->remote_chunk[i].chunk_state != MAPPED)
+				ret = -1;
+		}
+	}
+
+#if defined(DEBUG_MODE_BRIEF) || defined(DEBUG_MODE_DETAIL)
+	printk(KERN_INFO "%s, memory server[%d] %s %d chunks in [%lu, %lu), %u chunks mapped. \n", __func__,
+	       rdma_session->mem_server_id, expand ? "expand" : "release", nr_chunks, first, end, chunk_list->chunk_ptr);
+#endif
+
+out:
+	mutex_unlock(&chunk_list->resize_lock);
+	return ret;
+}
+
+/**
+ * Semeru Control Path - Expand or release the remote memory of the data space [start_addr, start_addr + size).
+ * 
+ * The JVM invokes it along with its heap commit/uncommit.
+ * The range is split to the chunks of each memory server, at REGION_SIZE_GB granularity.
+ * Releasing a range only releases the chunks fully covered by it, expanding covers all the touched chunks.
+ * 
+ * return :
+ * 	0 for success, -1 if any chunk failed.
+ */
+int semeru_resize_remote_chunks(char __user *start_addr, unsigned long size, int expand)
+{
+	int ret = 0;
+	size_t start_offset;
+	size_t end_offset;
+	size_t data_chunk;
+	size_t data_chunk_end;
+	struct mem_server_addr mem_addr;
+	struct mem_server_addr last_addr;
+	long offset = semeru_data_offset_of((unsigned long)start_addr, size);
+
+	if (unlikely(offset < 0 || size == 0)) {
+		pr_err("%s, [0x%lx, 0x%lx) is out of the data space. \n", __func__, (size_t)start_addr,
+		       (size_t)start_addr + size);
+		return -1;
+	}
+
+	// the data offset, the range is within one address window
+	start_offset = (size_t)offset;
+	end_offset = start_offset + size;
+
+	if (expand) {
+		data_chunk = start_offset >> CHUNK_SHIFT;
+		data_chunk_end = (end_offset + CHUNK_MASK) >> CHUNK_SHIFT;
+	} else {
+		data_chunk = (start_offset + CHUNK_MASK) >> CHUNK_SHIFT;
+		data_chunk_end = end_offset >> CHUNK_SHIFT;
+	}
+
+	// Merge the data chunks contiguous on the same memory server into one request.
+	// It depends on the placement_policy, e.g. interleaving sends one request per chunk.
+	while (data_chunk < data_chunk_end) {
+		translate_data_addr_to_mem_server_addr(&mem_addr, data_chunk << CHUNK_SHIFT);
+		last_addr = mem_addr;
+		while (data_chunk + 1 < data_chunk_end) {
+			struct mem_server_addr next_addr;
+
+			translate_data_addr_to_mem_server_addr(&next_addr, (data_chunk + 1) << CHUNK_SHIFT);
+			if (next_addr.mem_server_id != mem_addr.mem_server_id ||
+			    next_addr.mem_server_chunk_index != last_addr.mem_server_chunk_index + 1)
+				break;
+			last_addr = next_addr;
+			data_chunk++;
+		}
+
+		if (cp_resize_chunks_of_server(fs_session(mem_addr.window, mem_addr.mem_server_id), mem_addr.mem_server_chunk_index,
+					       last_addr.mem_server_chunk_index + 1, expand))
+			ret = -1;
+
+		// The replicas follow their primary chunks.
+		if (replica_mode == SEMERU_REPLICA_MIRROR) {
+			translate_to_replica_addr(&mem_addr, &mem_addr);
+			translate_to_replica_addr(&last_addr, &last_addr);
+			if (cp_resize_chunks_of_server(fs_session(mem_addr.window, mem_addr.mem_server_id),
+						       mem_addr.mem_server_chunk_index, last_addr.mem_server_chunk_index + 1,
+						       expand))
+				ret = -1;
+		}
+
+		data_chunk++;
+	}
+
+	return ret;
+}
+
+
+
+
+//
+// <<<<<<<<<<<<<<<<<<<<<  End of handling chunk management <<<<<<<<<<<<<<<<<<<<<
+//
+
+
+
+
+//
+// >>>>>>>>>>>>>>>  Start of  RDMA Control Path >>>>>>>>>>>>>>>
+//
 
 
 
@@ -1081,6 +1779,7 @@ void cp_rdma_read_done(struct ib_cq *cq, struct ib_wc *wc){
 	int ret = 0;
   struct semeru_rdma_req_sg 	*rdma_cmd_ptr;
 	struct semeru_rdma_queue	*rdma_queue;
+	struct cp_rdma_ticket	*ticket;
   
 	// Get rdma_command  attached to wr->wr_id
 	// Reuse the rmem_rdam_command instance.
@@ -1095,11 +1794,22 @@ void cp_rdma_read_done(struct ib_cq *cq, struct ib_wc *wc){
 	
 	// unmap rdma buffer from device
 	// [?] if we keep this mapping ,will it batter for our re-map next time ?
-	ib_dma_unmap_sg(rdma_queue->rdma_session->rdma_dev->dev, rdma_cmd_ptr->sgl, rdma_cmd_ptr->nentry,	DMA_FROM_DEVICE);
+	// The pages of registered meta space keep their mapping.
+	if (!rdma_cmd_ptr->meta_reg)
+		ib_dma_unmap_sg(rdma_queue->rdma_session->rdma_dev->dev, rdma_cmd_ptr->sgl, rdma_cmd_ptr->nentry,	DMA_FROM_DEVICE);
+	trace_semeru_rdma_cqe(rdma_queue->rdma_session->mem_server_id, rdma_queue->q_index, SEMERU_WR_CP_READ, wc->status,
+			      wc->byte_len);
 
 	// Return one wr, decrease the number of outstanding (read) wr.
 	ret = atomic_dec_return(&(rdma_queue->rdma_post_counter));
-	complete(&rdma_cmd_ptr->done); 
+	if (rdma_cmd_ptr->release_at_done) {
+		ticket = rdma_cmd_ptr->ticket;
+		cp_rdma_req_sg_put(rdma_queue, rdma_cmd_ptr);
+		if (ticket != NULL)
+			cp_rdma_ticket_put(ticket, wc->status);
+	} else {
+		complete(&rdma_cmd_ptr->done); 
+	}
 
 	#if defined(DEBUG_MODE_BRIEF) || defined(DEBUG_MODE_DETAIL)
 		printk(KERN_INFO "%s, rdma_queue[%d], rdma_wr[%d] done. <<<< \n", __func__, rdma_queue->q_index, ret + 1);
@@ -1118,6 +1828,7 @@ void cp_rdma_write_done(struct ib_cq *cq, struct ib_wc *wc){
 	int ret = 0;
   struct semeru_rdma_req_sg 	*rdma_cmd_ptr;
 	struct semeru_rdma_queue	*rdma_queue;
+	struct cp_rdma_ticket	*ticket;
   
 	// Get rdma_command  attached to wr->wr_id
 	// Reuse the rmem_rdam_command instance.
@@ -1134,11 +1845,22 @@ void cp_rdma_write_done(struct ib_cq *cq, struct ib_wc *wc){
 
 	// unmap rdma buffer from device
 	// [?] if we keep this mapping ,will it batter for our re-map next time ?
-	ib_dma_unmap_sg(rdma_queue->rdma_session->rdma_dev->dev, rdma_cmd_ptr->sgl, rdma_cmd_ptr->nentry,	DMA_TO_DEVICE);
+	// The pages of registered meta space keep their mapping.
+	if (!rdma_cmd_ptr->meta_reg && !rdma_cmd_ptr->inlined)
+		ib_dma_unmap_sg(rdma_queue->rdma_session->rdma_dev->dev, rdma_cmd_ptr->sgl, rdma_cmd_ptr->nentry,	DMA_TO_DEVICE);
+	trace_semeru_rdma_cqe(rdma_queue->rdma_session->mem_server_id, rdma_queue->q_index, SEMERU_WR_CP_WRITE, wc->status,
+			      wc->byte_len);
 
 	// Return one wr, decrease the number of outstanding (read) wr.
 	ret = atomic_dec_return(&(rdma_queue->rdma_post_counter));
-	complete(&rdma_cmd_ptr->done); 
+	if (rdma_cmd_ptr->release_at_done) {
+		ticket = rdma_cmd_ptr->ticket;
+		cp_rdma_req_sg_put(rdma_queue, rdma_cmd_ptr);
+		if (ticket != NULL)
+			cp_rdma_ticket_put(ticket, wc->status);
+	} else {
+		complete(&rdma_cmd_ptr->done); 
+	}
 
 	#if defined(DEBUG_MODE_BRIEF) || defined(DEBUG_MODE_DETAIL)
 		printk(KERN_INFO "%s, rdma_queue[%d], rdma_wr[%d] done. <<<< \n", __func__, rdma_queue->q_index, ret+1);
@@ -1184,7 +1906,7 @@ int cp_enqueue_send_wr(struct rdma_session_context *rdma_session, struct semeru_
 	// Both 1-sided read/write queue depth are RDMA_SEND_QUEUE_DEPTH
 	while (1) {
 		test = atomic_inc_return(&rdma_queue->rdma_post_counter);
-		if (test < RDMA_SEND_QUEUE_DEPTH - 16) {
+		if (test < RDMA_POST_LIMIT(rdma_queue->rdma_session)) {
 			//post the 1-sided RDMA write
 			// Use the global RDMA context, rdma_session_global
 			ret = ib_post_send(rdma_queue->qp, (struct ib_send_wr *)&rdma_req->rdma_sq_wr, &bad_wr);
@@ -1194,6 +1916,7 @@ int cp_enqueue_send_wr(struct rdma_session_context *rdma_session, struct semeru_
 				ret = -1;
 				goto err;
 			}
+			trace_semeru_rdma_post(rdma_session->mem_server_id, rdma_queue->q_index, 1, test);
 
 #if defined(DEBUG_MODE_BRIEF) || defined(DEBUG_MODE_DETAIL)
 			printk(KERN_INFO "%s, rdma_queue[%d] enqueued rdma_wr[%d] >>>> \n", __func__,
@@ -1219,17 +1942,345 @@ err:
 	return -1;
 }
 
+//
+// Doorbell batching
+//
+
+void wr_batch_init(struct semeru_wr_batch *batch, struct semeru_rdma_queue *rdma_queue)
+{
+	batch->rdma_queue = rdma_queue;
+	batch->head = NULL;
+	batch->tail = NULL;
+	batch->nr_wr = 0;
+	batch->group = NULL;
+}
+
+/**
+ * The CQ callback of a signaled wr.
+ * All the wr in its group are done, invoke their own completion functions in post order.
+ */
+void wr_group_done(struct ib_cq *cq, struct ib_wc *wc)
+{
+	struct semeru_wr_group *group = container_of(wc->wr_cqe, struct semeru_wr_group, cqe);
+	struct semeru_rdma_queue *rdma_queue = cq->cq_context;
+	struct ib_wc wr_wc = *wc;
+	int i;
+
+	for (i = 0; i < group->nr_wr; i++) {
+		wr_wc.wr_cqe = group->wr_cqe[i];
+		group->wr_cqe[i]->done(cq, &wr_wc);
+	}
+
+	if (group->fenced)
+		atomic_dec(&rdma_queue->rdma_post_counter);
+	kmem_cache_free(rdma_queue->wr_group_cache, group);
+}
+
+// The tail wr closes the open group and carries the signal.
+static void wr_batch_close_group(struct semeru_wr_batch *batch)
+{
+	struct semeru_wr_group *group = batch->group;
+
+	if (group == NULL)
+		return;
+
+	if (group->nr_wr == 1) {
+		// single wr, no need to forward the completion.
+		batch->tail->wr_cqe = group->wr_cqe[0];
+		kmem_cache_free(batch->rdma_queue->wr_group_cache, group);
+	} else {
+		group->cqe.done = wr_group_done;
+		batch->tail->wr_cqe = &group->cqe;
+	}
+
+	batch->tail->send_flags |= IB_SEND_SIGNALED;
+	batch->group = NULL;
+}
+
+/**
+ * The first taken wr of the group, nr_taken of them, were taken by a failed post, the rest weren't.
+ * Move the taken ones to a group of their own, signaled by a zero-length write posted behind them,
+ * their pages stay in use until the CQ completes them.
+ * If the write can't be posted either, the QP is broken. Its flushed CQEs complete the taken wr,
+ * they are left out of both groups.
+ */
+static void wr_group_split(struct semeru_rdma_queue *rdma_queue, struct semeru_wr_group *group, int nr_taken)
+{
+	struct semeru_wr_group *taken;
+	struct ib_send_wr *bad_wr = NULL;
+	int i;
+
+	taken = kmem_cache_alloc(rdma_queue->wr_group_cache, GFP_ATOMIC);
+	if (likely(taken != NULL)) {
+		taken->nr_wr = nr_taken;
+		for (i = 0; i < nr_taken; i++)
+			taken->wr_cqe[i] = group->wr_cqe[i];
+		taken->fenced = true;
+		taken->cqe.done = wr_group_done;
+
+		memset(&taken->fence_wr, 0, sizeof(struct ib_rdma_wr));
+		taken->fence_wr.wr.wr_cqe = &taken->cqe;
+		taken->fence_wr.wr.opcode = IB_WR_RDMA_WRITE;
+		taken->fence_wr.wr.num_sge = 0;
+		taken->fence_wr.wr.send_flags = IB_SEND_SIGNALED;
+
+		atomic_inc(&rdma_queue->rdma_post_counter);
+		if (ib_post_send(rdma_queue->qp, &taken->fence_wr.wr, &bad_wr)) {
+			atomic_dec(&rdma_queue->rdma_post_counter);
+			kmem_cache_free(rdma_queue->wr_group_cache, taken);
+			taken = NULL;
+		}
+	}
+
+	if (unlikely(taken == NULL))
+		pr_err("%s, rdma_queue[%d] %d taken wr are left to the flushed CQEs \n", __func__, rdma_queue->q_index,
+		       nr_taken);
+
+	group->nr_wr -= nr_taken;
+	for (i = 0; i < group->nr_wr; i++)
+		group->wr_cqe[i] = group->wr_cqe[i + nr_taken];
+}
+
+/**
+ * ib_post_send() took the wr of the chain before bad_wr, and none from bad_wr on.
+ * 
+ * 1) A group whose signaled wr is before bad_wr is on the send queue, it completes from the CQ.
+ * 	Its wr are never touched here, the done() of its group may already run on another core.
+ * 2) A group whose signaled wr is bad_wr or after it never completes, even if some of its unsignaled wr were taken.
+ * 	Its taken wr are split off first, see wr_group_split(), the HCA may still be reading their pages.
+ * 	Complete the rest with IB_WC_WR_FLUSH_ERR through its signaled wr, the same as a QP in error state does.
+ * 	A signaled wr without group is the same, a group of itself.
+ * 
+ * return : the number of wr failed here, i.e. not on the send queue.
+ */
+static int wr_batch_flush_err(struct semeru_wr_batch *batch, struct ib_send_wr *bad_wr)
+{
+	struct semeru_rdma_queue *rdma_queue = batch->rdma_queue;
+	struct ib_wc wc;
+	struct ib_send_wr *wr = bad_wr;
+	struct ib_send_wr *next;
+	int nr_failed = 0;
+	int nr_taken = 0;
+
+	// The drivers set bad_wr on any failure after taking a wr. Without it, the post was rejected as a whole.
+	if (WARN_ON_ONCE(wr == NULL))
+		wr = batch->head;
+
+	// The taken wr of the group bad_wr is in, after the last signaled wr before it.
+	for (next = batch->head; next != wr; next = next->next) {
+		if (next->send_flags & IB_SEND_SIGNALED)
+			nr_taken = 0;
+		else
+			nr_taken++;
+	}
+	if (nr_taken > 0) {
+		for (next = wr; !(next->send_flags & IB_SEND_SIGNALED); next = next->next)
+			;
+		if (next->wr_cqe->done == wr_group_done)
+			wr_group_split(rdma_queue, container_of(next->wr_cqe, struct semeru_wr_group, cqe), nr_taken);
+	}
+
+	memset(&wc, 0, sizeof(struct ib_wc));
+	wc.status = IB_WC_WR_FLUSH_ERR;
+	wc.qp = rdma_queue->qp;
+
+	for (; wr != NULL; wr = next) {
+		next = wr->next; // the wr may be freed by its done()
+		nr_failed++;
+		if (wr->send_flags & IB_SEND_SIGNALED) {
+			wc.wr_cqe = wr->wr_cqe;
+			wr->wr_cqe->done(rdma_queue->cq, &wc);
+		}
+	}
+	return nr_failed;
+}
+
+/**
+ * Post the chained wr by one ib_post_send.
+ * The chain must end with a signaled wr.
+ */
+static int wr_batch_post(struct semeru_wr_batch *batch)
+{
+	int ret = 0;
+	int test;
+	int nr_failed;
+	struct ib_send_wr *bad_wr = NULL;
+	struct semeru_rdma_queue *rdma_queue = batch->rdma_queue;
+
+	if (batch->head == NULL)
+		goto out;
+
+	// Reserve the send queue slots for the whole chain.
+	while (1) {
+		test = atomic_add_return(batch->nr_wr, &rdma_queue->rdma_post_counter);
+		if (test < RDMA_POST_LIMIT(rdma_queue->rdma_session)) {
+			break;
+		}
+
+		// RDMA send queue is full, wait for next turn.
+		atomic_sub(batch->nr_wr, &rdma_queue->rdma_post_counter);
+		drain_rdma_queue(rdma_queue);
+	}
+
+	ret = ib_post_send(rdma_queue->qp, batch->head, &bad_wr);
+	if (unlikely(ret)) {
+		nr_failed = wr_batch_flush_err(batch, bad_wr);
+		printk(KERN_ERR "%s, rdma_queue[%d] post %d chained wr failed, %d not taken, return value :%d. counter %d \n",
+		       __func__, rdma_queue->q_index, batch->nr_wr, nr_failed, ret, test);
+		ret = -1;
+	} else {
+		trace_semeru_rdma_post(rdma_queue->rdma_session->mem_server_id, rdma_queue->q_index, batch->nr_wr, test);
+	}
+
+#if defined(DEBUG_MODE_BRIEF) || defined(DEBUG_MODE_DETAIL)
+	printk(KERN_INFO "%s, rdma_queue[%d] posted %d chained wr >>>> \n", __func__, rdma_queue->q_index,
+	       batch->nr_wr);
+#endif
+
+	batch->head = NULL;
+	batch->tail = NULL;
+	batch->nr_wr = 0;
+
+out:
+	return ret;
+}
+
+/**
+ * Append a built wr to the batch.
+ * The wr.next and the IB_SEND_SIGNALED flag are managed by the batch.
+ * 
+ * return :
+ *  0 : success;
+ *  -1 : the chain is posted and failed. The done() of the wr was invoked with an error status.
+ */
+int wr_batch_add(struct semeru_wr_batch *batch, struct ib_send_wr *wr)
+{
+	int ret = 0;
+	struct semeru_wr_group *group = batch->group;
+
+	if (group == NULL) {
+		group = kmem_cache_alloc(batch->rdma_queue->wr_group_cache, GFP_ATOMIC);
+		if (unlikely(group == NULL)) {
+			// Fall back to a signaled wr without group.
+			wr->next = NULL;
+			wr->send_flags |= IB_SEND_SIGNALED;
+			if (batch->tail == NULL)
+				batch->head = wr;
+			else
+				batch->tail->next = wr;
+			batch->tail = wr;
+			batch->nr_wr++;
+			return wr_batch_post(batch);
+		}
+		group->nr_wr = 0;
+		group->fenced = false;
+		batch->group = group;
+	}
+
+	wr->next = NULL;
+	wr->send_flags &= ~IB_SEND_SIGNALED;
+	if (batch->tail == NULL)
+		batch->head = wr;
+	else
+		batch->tail->next = wr;
+	batch->tail = wr;
+	batch->nr_wr++;
+	group->wr_cqe[group->nr_wr++] = wr->wr_cqe;
+
+	if (group->nr_wr == WR_BATCH_SIGNAL_INTERVAL)
+		wr_batch_close_group(batch);
+
+	if (batch->nr_wr >= WR_BATCH_MAX_WR)
+		ret = wr_batch_flush(batch);
+
+	return ret;
+}
+
+/**
+ * Signal the last wr and post the whole chain.
+ */
+int wr_batch_flush(struct semeru_wr_batch *batch)
+{
+	wr_batch_close_group(batch);
+	return wr_batch_post(batch);
+}
+
+/**
+ * Control-Path, the physical page of a pte to be sent, or NULL.
+ * 
+ * 1) not present : the page is swapped out, OR it's being swapped out.
+ * 	if the page is unmapped, in swap cache and dirty,
+ * 	control path need to write it to remote memory server.
+ * 	Or the memory server tracing can be wrong.
+ * 
+ * Warning : the page_in_swap_cache will get_page, 
+ * which increased the reference count of the page.
+ * if the data path is swapping out this page, this can cause race problem.
+ * Must drop the page->_refcount via put_page after invoking the page_in_swap_cache()
+ * 
+ * 2) Default-Path : the mapped pte.
+ * 	TO be done: filter out the non-dirty pages. 
+ */
+static struct page *cp_pte_page(pte_t pte)
+{
+	struct page *buf_page;
+	bool dirty;
+
+	if (pte_present(pte))
+		return pfn_to_page(pte_pfn(pte));
+
+	buf_page = page_in_swap_cache(pte);
+	if (buf_page == NULL)
+		return NULL;
+
+	dirty = PageDirty(buf_page);
+	// drop the refcount by one here.
+	put_page(buf_page);
+	return dirty ? buf_page : NULL;
+}
+
+/**
+ * Control-Path, append the physical range [page, page + len) to the S/G list.
+ * Merged into the last entry if the two ranges are physically contiguous.
+ * 
+ * Return false if the S/G list is full, the range is not added.
+ */
+static bool cp_sg_add_range(struct scatterlist *sgl, uint64_t *entries, uint64_t max_entries, struct page *page,
+			    unsigned int len)
+{
+	struct scatterlist *last;
+
+	if (*entries != 0) {
+		last = &sgl[*entries - 1];
+		if (page_to_pfn(sg_page(last)) + (last->length >> PAGE_SHIFT) == page_to_pfn(page)) {
+			last->length += len;
+			return true;
+		}
+	}
+
+	if (*entries >= max_entries)
+		return false;
+
+	// Assign the pages to s/g. offset in page is 0x0.
+	sg_set_page(&sgl[(*entries)++], page, len, 0);
+	return true;
+}
+
 /**
  * Semeru CS - Map multiple meta data structure's physical address to rdma scatter-gather.
  * 
  * Find several contiguous virtual pages and register them as RDMA buffer for a S/G WR.
- * The max contiguous pages number is (MAX_REQUEST_SGL -2).  2 for safety.
+ * The max S/G entries number is (MAX_REQUEST_SGL -2).  2 for safety.
  * 
  * 
  * Build the RDMA buffer of CPU server. 
  * CPU Server : multiple sg entries, their physical/dma address are not contiguous.
  * Memory Server : a contiguous virtual RDMA buffer. 
  * 
+ * The range is walked once per pmd, then the ptes under it are scanned linearly.
+ * 1) The physically contiguous pages are merged into one sg entry, of sg->length bytes.
+ * 2) A huge pmd is mapped as one entry, without walking its ptes.
+ * 
  *  Parameters
  * 	*addr_scan_ptr : 
  * 	entry point - points to the start addr to be scanned.
@@ -1240,175 +2291,417 @@ err:
  * 	*addr_scan_ptr points the end of page #5, start of page #6.
  *       page #5 is the last page in the package. It's mapped.			
  * 
+ * Return : the number of sg entries. 
  */
 uint64_t meta_data_map_sg(struct rdma_session_context *rdma_session, struct scatterlist *sgl, char **addr_scan_ptr,
 			  char *end_addr)
 {
-	uint64_t entries = 0; // mapped pages
-	size_t package_page_num_limit = (MAX_REQUEST_SGL - 2); // InfiniBand hardware S/G limits, bytes
-	//size_t package_page_num_limit = 1; // InfiniBand hardware S/G limits, bytes
-
+	uint64_t entries = 0; // initialized sg entries
+	uint64_t package_entry_num_limit = (MAX_REQUEST_SGL - 2); // InfiniBand hardware S/G limits
+	uint64_t addr = (uint64_t)*addr_scan_ptr;
+	uint64_t pmd_end;
+	pmd_t *pmd;
+	pte_t *start_pte;
 	pte_t *pte_ptr;
 	struct page *buf_page;
+	bool mapped;
+
+	// Scan and find several contiguous pages as RDMA buffer.
+	// [?] It's much safer to lock the pmd here. 
+	// Or the users need to guarantte there is no swap/user-modification to the page-table.
+	while (addr < (uint64_t)end_addr) {
+		pmd_end = min_t(uint64_t, (addr + PMD_SIZE) & PMD_MASK, (uint64_t)end_addr);
+		pmd = walk_page_table_pmd(current->mm, addr);
+
+		// 1) Never touched, skip the pages of this pmd.
+		if (pmd == NULL)
+			goto skip_pmd;
+
+		// 2) Huge page, one physically contiguous range.
+		if (pmd_trans_huge(*pmd) || pmd_large(*pmd)) {
+			buf_page = pmd_page(*pmd) + ((addr & ~PMD_MASK) >> PAGE_SHIFT);
+			if (!cp_sg_add_range(sgl, &entries, package_entry_num_limit, buf_page,
+					     (unsigned int)(pmd_end - addr)))
+				goto out; // Exit#1, the S/G list is full.
+			addr = pmd_end;
+			continue;
+		}
 
-	// Scan and find several, at most package_len_limit, contiguous pages as RDMA buffer.
-	while (*addr_scan_ptr < end_addr) {
-		// [?] Will this walking cause too much overhead ?
-		// [?] It's much safer to lock the pmd here. 
-		// Or the users need to guarantte there is no swap/user-modification to the page-table.
-		pte_ptr = walk_page_table(current->mm, (uint64_t)(*addr_scan_ptr)); 
-
-
-		// 1) Never touched, skip this page.
-		if(pte_ptr == NULL)
-			goto skip_page;
-
-		// 2)not present : the page is swapped out, OR it's being swapped out.
-		//
-		// if the page is dirty and stays in swap_cache, 
-		// we have to flush it to remote memory servesr.
-		if (!pte_present(*pte_ptr)) {
-
-			// if the page is unmapped, in swap cache and dirty
-			// control path need to write it to remote memory server
-			// Or the memory server tracing can be wrong.
-			//
-			// Warning : the try_to_find_page_in_swap_cache will get_page, 
-			// which increased the reference count of the page.
-			// if the data path is swapping out this page, this can cause race problem.
-			// Must drop the page->_refcount via put_page after invoking the page_in_swap_cache()
-			//
-	
-
-			// flush the swap-cached dirty page to memory servers
-		
-			buf_page = page_in_swap_cache(*pte_ptr);
-			if ( buf_page != NULL  ) {
-
-				if(PageDirty(buf_page) ){
-#if defined(DEBUG_MODE_BRIEF) || defined(DEBUG_MODE_DETAIL)
-				 	printk(KERN_WARNING "%s, Virt page 0x%llx -> (dirty) phys page is in Swap Cache. Flushed.\n", __func__,
-				        		(uint64_t)(*addr_scan_ptr));
-#endif						
-
-					// drop the refcount by one here.
-					put_page(buf_page);
-					goto found_page;
-				} // find a swap-cached dirty page
-					
-				// skip thsi page
-				// drop the refcount by one
-				put_page(buf_page);
-			} // target page is in swap-cache
-
-			goto skip_page;
-		} // end of non-present
-
-		
-		// 3) Default-Path : Page Walk the mapped pte.
-		//
-		// TO be done: filter out the non-dirty pages. 
-		//
-		buf_page = pfn_to_page(pte_pfn(*pte_ptr));
+		// 3) Scan the ptes of this pmd linearly.
+		start_pte = pte_offset_map(pmd, addr);
+		for (pte_ptr = start_pte; addr < pmd_end; pte_ptr++, addr += PAGE_SIZE) {
+			buf_page = cp_pte_page(*pte_ptr);
+			if (buf_page == NULL) {
+				if (entries != 0)
+					break; // Exit#2, Find a breaking point.
+				continue; // Skip the unmapped page at the beginning.
+			}
 
-found_page:
-		// Assign a page to s/g. entire apge, offset in page is 0x0,.
-		sg_set_page(&(sgl[entries++]), buf_page, PAGE_SIZE, 0); 
+			mapped = cp_sg_add_range(sgl, &entries, package_entry_num_limit, buf_page, PAGE_SIZE);
+			if (!mapped)
+				break; // Exit#1, the S/G list is full.
 
 #if defined(DEBUG_MODE_BRIEF) || defined(DEBUG_MODE_DETAIL)
-		printk(KERN_INFO "%s, Virt page 0x%lx, pte 0x%lx, page 0x%lx, dma_addr 0x%lx \n", __func__,
-		       (size_t)*addr_scan_ptr, (size_t)pte_val(*pte_ptr), (size_t)buf_page,
-		       (size_t)sgl[entries - 1].dma_address);
+			printk(KERN_INFO "%s, Virt page 0x%lx, pte 0x%lx, page 0x%lx \n", __func__, (size_t)addr,
+			       (size_t)pte_val(*pte_ptr), (size_t)buf_page);
 #endif
-
-		// Find a mapped page, update the interator pointer
-		*addr_scan_ptr += PAGE_SIZE;
-
-		// Exit#1, Find enough contiguous virtual pages.
-		if (entries >= package_page_num_limit) {
-			goto out;
 		}
-		
-		continue; // goto find the first mapped pte.
+		pte_unmap(start_pte);
 
+		if (addr < pmd_end)
+			goto out;
+		continue;
 
-skip_page:
+skip_pmd:
 		// Exit#2, Find a breaking point.
 		// Stop building the S/G buffer.
-		if (entries != 0) {
-			goto out; // Break RDMA buffer registration
-		} else {
-			// Skip the unmapped page at the beginning, update the iterator.
-			*addr_scan_ptr += PAGE_SIZE;
-		}
-
-
+		if (entries != 0)
+			goto out;
+		addr = pmd_end;
 	} // end of while
 
 out:
-	return entries; // number of initialized ib_sge
+	*addr_scan_ptr = (char *)addr;
+	return entries; // number of initialized sg entries
+}
+
+/**
+ * Control-Path, the bytes mapped by the S/G list of meta_data_map_sg().
+ */
+static uint64_t cp_sg_mapped_bytes(struct scatterlist *sgl, uint64_t nentry)
+{
+	uint64_t bytes = 0;
+	uint64_t i;
+
+	for (i = 0; i < nentry; i++)
+		bytes += sgl[i].length;
+	return bytes;
 }
 
 
 /**
- * Control-Path, build a rdma wr for the RDMA read/write in CP.
- * 
- * Return : The number of pages being sent.
+ * Control-Path, fill the sge of the rdma wr by the registered meta space.
  * 
- * 1) Put the contiguous pages into one RDMA wr by utilizing Scatter/Gather.
- * 		Every time we just put a contiguous range of virtual memory into the S/G buffer.
- * 2) start_addr/end_addr stores the virtual address range to be processed.
+ * Return : The number of pages filled. 0 means the range is not registered,
+ * 	or the first page can't be pinned here. Then fall back to meta_data_map_sg().
  * 
+ * Take at most (MAX_REQUEST_SGL - 2) contiguous pages, the same as meta_data_map_sg.
+ * Stop at the first page which can't be pinned, the next package handles it.
+ * Invoked with preemption disabled, so only pin the present pages by __get_user_pages_fast.
  */
-int cp_build_rdma_wr(struct rdma_session_context *rdma_session, struct semeru_rdma_req_sg *rdma_cmd_ptr,
-		     enum dma_data_direction dir, struct remote_mapping_chunk *remote_chunk_ptr, char **addr_scan_ptr,
-		     char *end_addr)
+static int cp_meta_reg_map(struct rdma_session_context *rdma_session, struct semeru_rdma_req_sg *rdma_cmd_ptr,
+			   char **addr_scan_ptr, char *end_addr)
 {
-	int mapped_pages = 0;
-	int i;
-	int dma_entry = 0;
-	struct ib_device *ibdev = rdma_session->rdma_dev->dev; // get the ib_devices
+	struct cp_meta_reg *meta_reg = &rdma_session->meta_reg;
+	struct ib_device *ibdev = rdma_session->rdma_dev->dev;
+	unsigned long index;
+	struct page *page;
+	u64 dma_addr;
+	int entries = 0;
+
+	if (!meta_reg->enabled || meta_reg->mm != current->mm)
+		return 0;
+
+	spin_lock(&meta_reg->lock);
+	while (*addr_scan_ptr < end_addr && entries < MAX_REQUEST_SGL - 2) {
+		// Another process, the user addresses of the cache aren't its own.
+		if (!meta_reg->enabled || meta_reg->mm != current->mm || *addr_scan_ptr < meta_reg->start_addr)
+			break;
+		index = (unsigned long)(*addr_scan_ptr - meta_reg->start_addr) >> PAGE_SHIFT;
+		if (index >= meta_reg->nr_pages)
+			break;
 
-#if defined(DEBUG_MODE_BRIEF) || defined(DEBUG_MODE_DETAIL)
-	printk(KERN_INFO "%s, build wr for range [0x%llx, 0x%llx)\n", __func__, (uint64_t)*addr_scan_ptr,
-	       (uint64_t)end_addr);
-#endif
+		// Pin and map the page at its first transfer.
+		if (meta_reg->pages[index] == NULL) {
+			if (__get_user_pages_fast((unsigned long)*addr_scan_ptr, 1, 1, &page) != 1)
+				break;
 
-	// 1) Register the CPU server's local RDMA buffer.
-	//	  Map the corresponding physical pages to S/G structure.
-	init_completion(&(rdma_cmd_ptr->done));
-	rdma_cmd_ptr->nentry = meta_data_map_sg(rdma_session, rdma_cmd_ptr->sgl, addr_scan_ptr, end_addr);
-	rdma_cmd_ptr->seq_type = CONTROL_PATH_MEG; // means this is CP path data.
-	if (unlikely(rdma_cmd_ptr->nentry == 0)) {
-		// It's ok, the pte are not mapped to any physical pages.
-#if defined(DEBUG_MODE_BRIEF) || defined(DEBUG_MODE_DETAIL)
-		printk(KERN_INFO "%s, Find zero mapped pages, end at 0x%lx. Skip this wr. \n", __func__,
-		       (size_t)end_addr);
-#endif
-		mapped_pages = 0;
-		goto err; // return 0.
+			dma_addr = ib_dma_map_page(ibdev, page, 0, PAGE_SIZE, DMA_BIDIRECTIONAL);
+			if (unlikely(ib_dma_mapping_error(ibdev, dma_addr))) {
+				put_page(page);
+				break;
+			}
+			meta_reg->pages[index] = page;
+			meta_reg->dma_addr[index] = dma_addr;
+		}
+
+		rdma_cmd_ptr->sge_list[entries].addr = meta_reg->dma_addr[index];
+		rdma_cmd_ptr->sge_list[entries].length = PAGE_SIZE;
+		rdma_cmd_ptr->sge_list[entries].lkey = ibdev->local_dma_lkey;
+		entries++;
+		*addr_scan_ptr += PAGE_SIZE;
 	}
+	spin_unlock(&meta_reg->lock);
 
-	// 2) Register the physical address stored in S/G structure to DMA device.
-	//  	Here gets the scatterlist->dma_address.
-	//    CPU server RDMA buffer  registration.
-	// Inform PCI device the dma address of these scatterlist.
-	dma_entry = ib_dma_map_sg(ibdev, rdma_cmd_ptr->sgl, rdma_cmd_ptr->nentry, dir);
-	if (unlikely(dma_entry != rdma_cmd_ptr->nentry)) {
-		printk(KERN_ERR "ERROR in %s. Registered %d entries to rdma scatterlist. Expected %llu \n", 
-			__func__, dma_entry, rdma_cmd_ptr->nentry);
+	return entries;
+}
+
+/**
+ * Control-Path, drop the registered meta space of a session.
+ * Unmap and unpin all the pages pinned by cp_meta_reg_map().
+ * 
+ * The caller has to guarantee no control path wr is using the registered pages.
+ */
+void cp_meta_reg_release(struct rdma_session_context *rdma_session)
+{
+	struct cp_meta_reg *meta_reg = &rdma_session->meta_reg;
+	struct page **pages;
+	u64 *dma_addr;
+	unsigned long nr_pages;
+	unsigned long i;
+
+	// 1) Detach the arrays under the lock, then no new wr can use them.
+	spin_lock(&meta_reg->lock);
+	meta_reg->enabled = false;
+	pages = meta_reg->pages;
+	dma_addr = meta_reg->dma_addr;
+	nr_pages = meta_reg->nr_pages;
+	meta_reg->pages = NULL;
+	meta_reg->dma_addr = NULL;
+	meta_reg->nr_pages = 0;
+	meta_reg->start_addr = NULL;
+	meta_reg->mm = NULL;
+	spin_unlock(&meta_reg->lock);
+
+	if (pages == NULL)
+		return;
+
+	// 2) Release the pinned pages.
+	for (i = 0; i < nr_pages; i++) {
+		if (pages[i] == NULL)
+			continue;
+		ib_dma_unmap_page(rdma_session->rdma_dev->dev, dma_addr[i], PAGE_SIZE, DMA_BIDIRECTIONAL);
+		put_page(pages[i]);
+	}
+
+	vfree(pages);
+	vfree(dma_addr);
+}
+
+/**
+ * The owner of the registered meta space, per address window.
+ * 
+ * The mmu notifier follows the teardown of the registering mm, its release unpins the pages of the window's sessions
+ * even if the JVM exits without unregistering. The notifier holds the mm_struct, so cp_meta_mm can't be reused
+ * by another process, until the notifier is unregistered at the next registration or the module exit.
+ * The registrations are serialized by cp_meta_reg_mutex.
+ */
+static struct mmu_notifier cp_meta_mn[SEMERU_MAX_ADDRESS_WINDOWS];
+static struct mm_struct *cp_meta_mm[SEMERU_MAX_ADDRESS_WINDOWS]; // NULL if the notifier isn't registered.
+static DEFINE_MUTEX(cp_meta_reg_mutex);
+
+static void cp_meta_reg_release_all(int window)
+{
+	int mem_server_id;
+
+	for (mem_server_id = 0; rdma_session_global_ptr != NULL && mem_server_id < num_mem_servers; mem_server_id++)
+		cp_meta_reg_release(fs_session(window, mem_server_id));
+}
+
+/**
+ * exit_mmap() of the registering mm. Its threads are gone, no control path wr uses the pinned pages.
+ */
+static void cp_meta_mn_release(struct mmu_notifier *mn, struct mm_struct *mm)
+{
+	cp_meta_reg_release_all((int)(mn - cp_meta_mn));
+}
+
+static const struct mmu_notifier_ops cp_meta_mn_ops = {
+	.release = cp_meta_mn_release,
+};
+
+/**
+ * Release the registration of the window's sessions and drop the notifier of its owner.
+ * Invoked with cp_meta_reg_mutex held.
+ */
+static void cp_meta_reg_drop_owner(int window)
+{
+	if (cp_meta_mm[window] != NULL) {
+		// Invokes the release if the mm is still alive, then drops the mm_struct.
+		mmu_notifier_unregister(&cp_meta_mn[window], cp_meta_mm[window]);
+		cp_meta_mm[window] = NULL;
+	}
+	cp_meta_reg_release_all(window);
+}
+
+/**
+ * Control-Path, register [start_addr, start_addr + size) of the RDMA meta space for the sessions of its address window.
+ * After the registration, the control path wr reuse the pinned pages and their DMA addresses,
+ * instead of walking the page table and mapping a scatterlist for each call.
+ * 
+ * The pages are pinned lazily at their first transfer, so the untouched meta space is not pinned.
+ * The registration belongs to current->mm, it replaces the one of any other process in the same window.
+ * size 0 : unregister the meta space of the window of start_addr, or of the caller's window.
+ * 
+ * Invoked from the syscall, sleeping is allowed.
+ */
+int semeru_cp_register_meta(char __user *start_addr, unsigned long size)
+{
+	struct rdma_session_context *rdma_session;
+	struct cp_meta_reg *meta_reg;
+	unsigned long nr_pages = size >> PAGE_SHIFT;
+	struct page **pages;
+	u64 *dma_addr;
+	int mem_server_id;
+	int window;
+	int ret = 0;
+
+	// 1) Check the range.
+	if (size == 0) {
+		window = semeru_window_of((unsigned long)start_addr);
+		if (window < 0)
+			window = semeru_window_of_mm(current->mm);
+	} else {
+		window = semeru_meta_window_of((unsigned long)start_addr, size);
+	}
+	if (window < 0 || ((unsigned long)start_addr & ~PAGE_MASK) || (size & ~PAGE_MASK)) {
+		pr_err("%s, range [0x%lx, 0x%lx) is out of the RDMA meta space.\n", __func__,
+		       (unsigned long)start_addr, (unsigned long)start_addr + size);
+		return -EINVAL;
+	}
+
+	mutex_lock(&cp_meta_reg_mutex);
+
+	// 2) Drop the previous registration of the window, of this process or another one.
+	cp_meta_reg_drop_owner(window);
+	if (size == 0)
+		goto out;
+
+	// 3) Follow the teardown of the registering mm.
+	cp_meta_mn[window].ops = &cp_meta_mn_ops;
+	ret = mmu_notifier_register(&cp_meta_mn[window], current->mm);
+	if (unlikely(ret)) {
+		pr_err("%s, follow the mm of the JVM failed, %d.\n", __func__, ret);
+		goto out;
+	}
+	cp_meta_mm[window] = current->mm;
+
+	for (mem_server_id = 0; mem_server_id < num_mem_servers; mem_server_id++) {
+		rdma_session = fs_session(window, mem_server_id);
+		meta_reg = &rdma_session->meta_reg;
+
+		// 4) Build the page and DMA address cache.
+		pages = vzalloc(sizeof(struct page *) * nr_pages);
+		dma_addr = vzalloc(sizeof(u64) * nr_pages);
+		if (unlikely(pages == NULL || dma_addr == NULL)) {
+			pr_err("%s, allocate the page cache for memory server[%d] failed.\n", __func__, mem_server_id);
+			vfree(pages);
+			vfree(dma_addr);
+			// Unwind the sessions registered so far, none is left half initialized.
+			cp_meta_reg_drop_owner(window);
+			ret = -ENOMEM;
+			goto out;
+		}
+
+		spin_lock(&meta_reg->lock);
+		meta_reg->start_addr = start_addr;
+		meta_reg->nr_pages = nr_pages;
+		meta_reg->pages = pages;
+		meta_reg->dma_addr = dma_addr;
+		meta_reg->mm = current->mm;
+		meta_reg->enabled = true;
+		spin_unlock(&meta_reg->lock);
+	}
+
+#if defined(DEBUG_MODE_BRIEF) || defined(DEBUG_MODE_DETAIL)
+	printk(KERN_INFO "%s, registered meta space [0x%lx, 0x%lx)\n", __func__, (unsigned long)start_addr,
+	       (unsigned long)start_addr + size);
+#endif
+
+out:
+	mutex_unlock(&cp_meta_reg_mutex);
+	return ret;
+}
+
+/**
+ * Module exit, before the sessions are freed. The notifier ops are module text.
+ */
+void cp_meta_reg_exit(void)
+{
+	int window;
+
+	mutex_lock(&cp_meta_reg_mutex);
+	for (window = 0; window < (int)semeru_nr_windows; window++)
+		cp_meta_reg_drop_owner(window);
+	mutex_unlock(&cp_meta_reg_mutex);
+}
+
+/**
+ * Control-Path, build a rdma wr for the RDMA read/write in CP.
+ * 
+ * Return : The number of pages being sent.
+ * 
+ * 1) Put the contiguous pages into one RDMA wr by utilizing Scatter/Gather.
+ * 		Every time we just put a contiguous range of virtual memory into the S/G buffer.
+ * 2) start_addr/end_addr stores the virtual address range to be processed.
+ * 
+ */
+int cp_build_rdma_wr(struct rdma_session_context *rdma_session, struct semeru_rdma_req_sg *rdma_cmd_ptr,
+		     enum dma_data_direction dir, struct remote_mapping_chunk *remote_chunk_ptr, char **addr_scan_ptr,
+		     char *end_addr)
+{
+	int mapped_pages = 0;
+	uint64_t mapped_bytes = 0;
+	int i;
+	int dma_entry = 0;
+	struct ib_device *ibdev = rdma_session->rdma_dev->dev; // get the ib_devices
+
+#if defined(DEBUG_MODE_BRIEF) || defined(DEBUG_MODE_DETAIL)
+	printk(KERN_INFO "%s, build wr for range [0x%llx, 0x%llx)\n", __func__, (uint64_t)*addr_scan_ptr,
+	       (uint64_t)end_addr);
+#endif
+
+	init_completion(&(rdma_cmd_ptr->done));
+	rdma_cmd_ptr->seq_type = CONTROL_PATH_MEG; // means this is CP path data.
+
+	// 0) Reuse the pinned pages of the registered meta space.
+	//    The sge_list is filled, only need to build the remote part of the wr.
+	dma_entry = cp_meta_reg_map(rdma_session, rdma_cmd_ptr, addr_scan_ptr, end_addr);
+	if (dma_entry > 0) {
+		rdma_cmd_ptr->meta_reg = true;
+		rdma_cmd_ptr->nentry = dma_entry;
+		mapped_bytes = (uint64_t)dma_entry * PAGE_SIZE;
+		mapped_pages = dma_entry;
+		goto build_wr;
+	}
+	rdma_cmd_ptr->meta_reg = false;
+
+	// 1) Register the CPU server's local RDMA buffer.
+	//	  Map the corresponding physical pages to S/G structure.
+	rdma_cmd_ptr->nentry = meta_data_map_sg(rdma_session, rdma_cmd_ptr->sgl, addr_scan_ptr, end_addr);
+	if (unlikely(rdma_cmd_ptr->nentry == 0)) {
+		// It's ok, the pte are not mapped to any physical pages.
+#if defined(DEBUG_MODE_BRIEF) || defined(DEBUG_MODE_DETAIL)
+		printk(KERN_INFO "%s, Find zero mapped pages, end at 0x%lx. Skip this wr. \n", __func__,
+		       (size_t)end_addr);
+#endif
+		mapped_pages = 0;
+		goto err; // return 0.
+	}
+
+	// 2) Register the physical address stored in S/G structure to DMA device.
+	//  	Here gets the scatterlist->dma_address.
+	//    CPU server RDMA buffer  registration.
+	// Inform PCI device the dma address of these scatterlist.
+	dma_entry = ib_dma_map_sg(ibdev, rdma_cmd_ptr->sgl, rdma_cmd_ptr->nentry, dir);
+	if (unlikely(dma_entry != rdma_cmd_ptr->nentry)) {
+		printk(KERN_ERR "ERROR in %s. Registered %d entries to rdma scatterlist. Expected %llu \n", 
+			__func__, dma_entry, rdma_cmd_ptr->nentry);
 		mapped_pages = 0;
 		goto err;
 	}
-	mapped_pages = dma_entry; // return the number of pages mapped to RDMA device.
+	// The physically contiguous pages share one entry.
+	mapped_bytes = cp_sg_mapped_bytes(rdma_cmd_ptr->sgl, rdma_cmd_ptr->nentry);
+	mapped_pages = (int)(mapped_bytes >> PAGE_SHIFT); // return the number of pages mapped to RDMA device.
 
+build_wr:
 	// 3) Register Remote RDMA buffer to WR.
 	// 		The whole remote virtual memory pool is already resigered as RDMA buffer.
 	//		Here just fills the information into the rdma_sq_wr.
 	rdma_cmd_ptr->rdma_sq_wr.rkey = remote_chunk_ptr->remote_rkey;
 	// Start address of the S/G vector. Universal address space.
 	rdma_cmd_ptr->rdma_sq_wr.remote_addr = remote_chunk_ptr->remote_addr +
-		((uint64_t)(*addr_scan_ptr - rdma_cmd_ptr->nentry * PAGE_SIZE) & CHUNK_MASK);
+		((uint64_t)(*addr_scan_ptr - mapped_bytes) & CHUNK_MASK);
 	rdma_cmd_ptr->rdma_sq_wr.wr.opcode = (dir == DMA_TO_DEVICE ? IB_WR_RDMA_WRITE : IB_WR_RDMA_READ);
 	rdma_cmd_ptr->rdma_sq_wr.wr.send_flags = IB_SEND_SIGNALED; // 1-sided RDMA message ? both read /write
 
@@ -1430,9 +2723,9 @@ int cp_build_rdma_wr(struct rdma_session_context *rdma_session, struct semeru_rd
 
 	printk(KERN_INFO
 	       "%s,  Mapped %d entries. From CPU server [0x%lx, 0x%lx) to Memory server[0x%lx, 0x%lx) , in current rdma_wr \n",
-	       __func__, dma_entry, (size_t)(*addr_scan_ptr - dma_entry * PAGE_SIZE), (size_t)*addr_scan_ptr,
+	       __func__, dma_entry, (size_t)(*addr_scan_ptr - mapped_bytes), (size_t)*addr_scan_ptr,
 	       (size_t)rdma_cmd_ptr->rdma_sq_wr.remote_addr,
-	       (size_t)(rdma_cmd_ptr->rdma_sq_wr.remote_addr + dma_entry * PAGE_SIZE));
+	       (size_t)(rdma_cmd_ptr->rdma_sq_wr.remote_addr + mapped_bytes));
 
 	//print_scatterlist_info(rdma_cmd_ptr->sgl, rdma_cmd_ptr->nentry);
 #endif
@@ -1446,10 +2739,11 @@ int cp_build_rdma_wr(struct rdma_session_context *rdma_session, struct semeru_rd
 	//struct ib_sge sge_list[dma_entry];
 	//
 	// [?] not use the scatterlist->page_link at all ?
-	for (i = 0; i < dma_entry; i++) {
+	// The registered meta space already filled the sge_list.
+	for (i = 0; !rdma_cmd_ptr->meta_reg && i < dma_entry; i++) {
 		rdma_cmd_ptr->sge_list[i].addr = sg_dma_address(&(rdma_cmd_ptr->sgl[i])); // scatterlist->addr
 		rdma_cmd_ptr->sge_list[i].length =
-			PAGE_SIZE; // should be the size for each ib_sge !! not the total size of RDMA S/G !!
+			sg_dma_len(&(rdma_cmd_ptr->sgl[i])); // should be the size for each ib_sge !! not the total size of RDMA S/G !!
 		rdma_cmd_ptr->sge_list[i].lkey = rdma_session->rdma_dev->dev->local_dma_lkey;
 
 #if defined(DEBUG_MODE_BRIEF) || defined(DEBUG_MODE_DETAIL)
@@ -1470,45 +2764,126 @@ err:
 }
 
 /**
- * Semeru CPU Server - Control Path, Post 1-sided rdma_wr 
- * 	Invoked by user space application, e.g. JVM.
- * 
- * Parameters 
- * 	start_addr,  remote virtual memory address, to be read.
- * 	data length , 4KB alignment.
- * 
- * 	[?]For the ideal case, don't use a RDMA buffer. fetch the data back into CS's corresponding virtual address directly.
+ * Cut [start_addr, start_addr + bytes_len) into packages and append them to the wr_batch.
+ * The caller posts the batch by wr_batch_flush().
  * 
+ * rdma_req_sg : the package waited by the caller, used for the first package. 
+ * 		NULL means nobody waits on any package.
+ * ticket : notified by each package released at done. Can be NULL.
  * 
- * More explanation
- * 		
- * 
+ * The caller has to guarantee the accessd range within one rdma chunk.
  */
-int semeru_cp_rdma_send(struct rdma_session_context *rdma_session, struct semeru_rdma_queue *rdma_queue,
-			struct semeru_rdma_req_sg *rdma_req_sg, char __user *start_addr, uint64_t bytes_len,
-			enum dma_data_direction dir)
+/**
+ * Hold the rest of a bulk control path transfer while the memory server has demand swap-ins in flight.
+ * The chained packages are posted first, the swap-ins only wait behind them.
+ * Invoked with preemption disabled, spin for CP_PRIO_YIELD_MAX_US at most. The swap-ins complete on other cores.
+ */
+static int cp_rdma_yield_to_demand_loads(struct rdma_session_context *rdma_session, struct semeru_wr_batch *wr_batch)
+{
+	int ret;
+	u64 deadline;
+
+	if (likely(atomic_read(&rdma_session->demand_loads) == 0))
+		return 0;
+
+	ret = wr_batch_flush(wr_batch);
+	if (unlikely(ret))
+		return ret;
+
+	atomic_inc(&rdma_session->cp_yields);
+	deadline = ktime_get_ns() + CP_PRIO_YIELD_MAX_US * NSEC_PER_USEC;
+	while (atomic_read(&rdma_session->demand_loads) != 0 && ktime_get_ns() < deadline)
+		cpu_relax();
+
+	return 0;
+}
+
+static int cp_rdma_batch_range(struct rdma_session_context *rdma_session, struct semeru_wr_batch *wr_batch,
+			       struct semeru_rdma_req_sg *rdma_req_sg, struct cp_rdma_ticket *ticket,
+			       char __user *start_addr, uint64_t bytes_len, enum dma_data_direction dir)
 {
 	int ret = 0;
 	char *end_addr = start_addr + bytes_len;
 	char *addr_scan_ptr = start_addr; // Points to the current scanned addr
+	struct semeru_rdma_queue *rdma_queue = wr_batch->rdma_queue;
+	struct semeru_rdma_req_sg *cur_req = rdma_req_sg; // the caller waits on the first package.
+	unsigned long chunk_pages = 0; // pages chained since the last yield to the swap-ins
 
 	// 1) Calculate the remote address
-	//    The caller has to guarantee the accessd range within one rdma chunk.
 	// REGION_SIZE_GB/chunk in default.
-	uint64_t start_chunk_index = ((uint64_t)start_addr - SEMERU_START_ADDR) >> CHUNK_SHIFT; 
-	struct remote_mapping_chunk *remote_chunk_ptr =
-		&(rdma_session->remote_chunk_list.remote_chunk[start_chunk_index]);
+	// The data Regions are placed by the placement_policy, the meta Regions are the same on all memory servers.
+	// Both are in the address window of the session.
+	long offset = semeru_data_offset_of((unsigned long)start_addr, bytes_len);
+	uint64_t start_chunk_index;
+	struct remote_mapping_chunk *remote_chunk_ptr;
+	struct mem_server_addr mem_addr;
+
+	if (offset >= 0) {
+		translate_data_addr_to_mem_server_addr(&mem_addr, (uint64_t)offset);
+		if (unlikely(mem_addr.window != rdma_session->window ||
+			     mem_addr.mem_server_id != rdma_session->mem_server_id)) {
+			pr_err("%s, 0x%lx is placed on window[%d] memory server[%d], not window[%d] memory server[%d]. \n",
+			       __func__, (size_t)start_addr, mem_addr.window, mem_addr.mem_server_id, rdma_session->window,
+			       rdma_session->mem_server_id);
+			return -1;
+		}
+		start_chunk_index = mem_addr.mem_server_chunk_index;
+
+#ifdef SEMERU_FS_ZERO_PAGE
+		// The memory server's copies of the written pages aren't known zero any more.
+		if (dir == DMA_TO_DEVICE)
+			fs_zero_forget_range((uint64_t)offset >> PAGE_SHIFT,
+					     ((uint64_t)offset + bytes_len + PAGE_SIZE - 1) >> PAGE_SHIFT);
+#endif
+#ifdef SEMERU_FS_INVALIDATE
+		// Written again, not to be discarded.
+		if (dir == DMA_TO_DEVICE)
+			fs_invalidate_revive(rdma_session->mem_server_id, (uint64_t)offset >> PAGE_SHIFT,
+					     ((uint64_t)offset + bytes_len + PAGE_SIZE - 1) >> PAGE_SHIFT);
+#endif
+#ifdef SEMERU_CHUNK_MIGRATION
+		// Not mirrored, the moving data chunk is copied again.
+		if (dir == DMA_TO_DEVICE)
+			fs_migrate_rewrite((uint64_t)offset, (uint64_t)offset + bytes_len);
+#endif
+	} else {
+		if (unlikely(semeru_meta_window_of((unsigned long)start_addr, bytes_len) != rdma_session->window)) {
+			pr_err("%s, [0x%lx, 0x%lx) is out of the meta and data space of window[%d]. \n", __func__,
+			       (size_t)start_addr, (size_t)end_addr, rdma_session->window);
+			return -1;
+		}
+		start_chunk_index = ((uint64_t)start_addr - semeru_meta_start(rdma_session->window)) >> CHUNK_SHIFT;
+	}
+	remote_chunk_ptr = &(rdma_session->remote_chunk_list.remote_chunk[start_chunk_index]);
 
 	// Cut the whole data into several packages, limited by the scatter-gather hardware limitations.
+	// Each package has its own semeru_rdma_req_sg, all of them are posted by the doorbell batching.
 	while (addr_scan_ptr < end_addr) {
-		ret = cp_build_rdma_wr(rdma_session, rdma_req_sg, dir, remote_chunk_ptr, &addr_scan_ptr, end_addr);
+		if (cur_req == NULL) {
+			cur_req = cp_rdma_req_sg_get(rdma_queue);
+			if (unlikely(cur_req == NULL)) {
+				pr_err("%s, get reserved rdma_req_sg failed. \n", __func__);
+				ret = -1;
+				break;
+			}
+			memset(cur_req, 0, sizeof(struct semeru_rdma_req_sg));
+			cur_req->release_at_done = true; // only the first package is waited by the caller.
+			cur_req->ticket = ticket;
+		}
+
+		ret = cp_build_rdma_wr(rdma_session, cur_req, dir, remote_chunk_ptr, &addr_scan_ptr, end_addr);
 		if (unlikely(ret == 0)) {
+			#if defined(DEBUG_MODE_BRIEF) || defined(DEBUG_MODE_DETAIL)
 			printk(KERN_WARNING
 			       "%s, Build rdma wr in Control-Path failed OR Skip empty pte. Skip enqueue WR \n",
 			       __func__);
-			complete(&rdma_req_sg->done); // Not enqueue this rdma_queue, mark it complete here.
-			// ret = 0 is good here. But can cause error in the caller.
-			goto err; // Skip the WR enqueue.
+			#endif
+			if (cur_req == rdma_req_sg)
+				complete(&rdma_req_sg->done); // Not enqueue this rdma_queue, mark it complete here.
+			else
+				cp_rdma_req_sg_put(rdma_queue, cur_req);
+			// ret = 0 is good here. No more mapped pages in the range.
+			break; // Skip the WR enqueue.
 		}
 
 		#if defined(DEBUG_MODE_BRIEF) || defined(DEBUG_MODE_DETAIL)
@@ -1516,25 +2891,154 @@ int semeru_cp_rdma_send(struct rdma_session_context *rdma_session, struct semeru
 		       (uint64_t)(addr_scan_ptr - ret * PAGE_SIZE));
 		#endif
 
-		// Post 1-sided RDMA read wr
+		// Chain the 1-sided RDMA wr, it's posted when the batch is full or flushed.
 		// Both read/write queue depth are RDMA_SEND_QUEUE_DEPTH
-		ret = cp_enqueue_send_wr(rdma_session, rdma_queue, rdma_req_sg);
+		cur_req->rdma_queue = rdma_queue;
+		if (cur_req->ticket != NULL)
+			atomic_inc(&cur_req->ticket->pending); // dropped by the done(), even if the post fails.
+		chunk_pages += ret;
+		ret = wr_batch_add(wr_batch, (struct ib_send_wr *)&cur_req->rdma_sq_wr);
+		cur_req = NULL;
 		if (unlikely(ret)) { // -1, non-zero
 			printk(KERN_ERR "%s, enque ib_send_wr failed. \n", __func__);
-			goto err;
+			break;
 		}
 
-
-		//debug - drain after inserting any rdma_wr
-		// drain after queue is full
-		//drain_rdma_queue(rdma_queue);
+		// The swap-ins go before the next chunk.
+		if (chunk_pages >= CP_PRIO_CHUNK_PAGES && addr_scan_ptr < end_addr) {
+			chunk_pages = 0;
+			ret = cp_rdma_yield_to_demand_loads(rdma_session, wr_batch);
+			if (unlikely(ret)) {
+				printk(KERN_ERR "%s, post chained ib_send_wr failed. \n", __func__);
+				break;
+			}
+		}
 
 	} // end of for loop, send data.
 
-err:
 	return ret;
 }
 
+/**
+ * Semeru CPU Server - Control Path, Post 1-sided rdma_wr 
+ * 	Invoked by user space application, e.g. JVM.
+ * 
+ * Parameters 
+ * 	start_addr,  remote virtual memory address, to be read.
+ * 	data length , 4KB alignment.
+ * 
+ * 	[?]For the ideal case, don't use a RDMA buffer. fetch the data back into CS's corresponding virtual address directly.
+ * 
+ * 
+ * More explanation
+ * 		
+ * 
+ */
+int semeru_cp_rdma_send(struct rdma_session_context *rdma_session, struct semeru_rdma_queue *rdma_queue,
+			struct semeru_rdma_req_sg *rdma_req_sg, char __user *start_addr, uint64_t bytes_len,
+			enum dma_data_direction dir)
+{
+	int ret = 0;
+	int flush_ret;
+	struct semeru_wr_batch wr_batch;
+
+	wr_batch_init(&wr_batch, rdma_queue);
+
+	ret = cp_rdma_batch_range(rdma_session, &wr_batch, rdma_req_sg, NULL, start_addr, bytes_len, dir);
+
+	// Post the rest, one doorbell for the whole chain.
+	flush_ret = wr_batch_flush(&wr_batch);
+	if (unlikely(flush_ret)) {
+		printk(KERN_ERR "%s, post chained ib_send_wr failed. \n", __func__);
+		ret = flush_ret;
+	}
+
+	return ret;
+}
+
+/**
+ * The QP can still be used, it's not disconnected nor in error.
+ */
+bool rdma_queue_alive(struct semeru_rdma_queue *rdma_queue)
+{
+	return READ_ONCE(rdma_queue->freed) == 0 && rdma_queue->state != CM_DISCONNECT && rdma_queue->state != ERROR;
+}
+
+/**
+ * Pick the data path queue for the calling core.
+ * Invoked with preemption disabled, or the queue is only used to check the memory server.
+ *
+ * With cp_isolated_qp, the core of the control path QP uses the next core's queue.
+ * With multiple ports, the neighbour queue is on another port.
+ * 1) The port of the core's queue fails, e.g. the QP is disconnected. Use a live queue on another port.
+ * 2) The core's queue is deep, and the neighbour queue is less loaded. Balance the ports by queue depth.
+ * 	The queues are safe to share, the CQ is polled with cq_lock and the store ring has its own lock.
+ */
+struct semeru_rdma_queue *get_dp_rdma_queue(struct rdma_session_context *rdma_session, int cpu)
+{
+	struct semeru_rdma_queue *rdma_queue;
+	struct semeru_rdma_queue *other;
+	int i;
+
+#ifndef SEMERU_CP_MULTI_QP
+	// Leave the control path QP to the GC traffic, its core shares the next queue.
+	if (cp_isolated_qp && cpu == control_path_fixed_qp && online_cores > 1)
+		cpu = (cpu + 1) % online_cores;
+#endif
+	rdma_queue = &(rdma_session->rdma_queues[cpu]);
+
+	if (likely(rdma_session->num_paths == 1))
+		return rdma_queue;
+
+	if (unlikely(!rdma_queue_alive(rdma_queue))) {
+		for (i = 1; i < online_cores; i++) {
+			other = &(rdma_session->rdma_queues[(cpu + i) % online_cores]);
+			if (other->path != rdma_queue->path && rdma_queue_alive(other))
+				return other;
+		}
+		return rdma_queue; // all the ports are lost.
+	}
+
+	if (atomic_read(&rdma_queue->rdma_post_counter) > RDMA_PATH_BALANCE_DEPTH) {
+		other = &(rdma_session->rdma_queues[(cpu + 1) % online_cores]);
+		if (other->path != rdma_queue->path && rdma_queue_alive(other) &&
+		    atomic_read(&other->rdma_post_counter) < atomic_read(&rdma_queue->rdma_post_counter))
+			return other;
+	}
+
+	return rdma_queue;
+}
+
+/**
+ * Pick the control path queue for the calling core.
+ * Invoked with preemption disabled, the cpu is got by get_cpu().
+ */
+static struct semeru_rdma_queue *get_cp_rdma_queue(struct rdma_session_context *rdma_session, int cpu)
+{
+#ifdef SEMERU_CP_MULTI_QP
+	return &(rdma_session->rdma_queues[cpu % online_cores]);
+#else
+	// Control path use the reserved QP on core #control_path_fixed_qp
+	return &(rdma_session->rdma_queues[control_path_fixed_qp]);
+#endif
+}
+
+/**
+ * The session of mem_server_id serving the address window of start_addr, for a control path transfer.
+ * NULL if the memory server id is wrong, or start_addr isn't in a served window.
+ */
+static struct rdma_session_context *cp_session_of(int mem_server_id, char __user *start_addr)
+{
+	int window = semeru_window_of((unsigned long)start_addr);
+
+	if (unlikely(window < 0 || mem_server_id < 0 || mem_server_id >= num_mem_servers)) {
+		pr_err("%s, no session of memory server[%d] for 0x%lx \n", __func__, mem_server_id,
+		       (unsigned long)start_addr);
+		return NULL;
+	}
+	return fs_session(window, mem_server_id);
+}
+
 //
 // Syscall filling operations
 //
@@ -1557,14 +3061,32 @@ char *semeru_cp_rdma_read(int mem_server_id, char __user *start_addr, unsigned l
 	char __user *end_addr_aligned;
 	unsigned long size_aligned;
 	struct semeru_rdma_queue *rdma_queue;
-	struct rdma_session_context *rdma_session = &rdma_session_global_ptr[mem_server_id];
+	struct rdma_session_context *rdma_session = cp_session_of(mem_server_id, start_addr);
 	struct semeru_rdma_req_sg *rdma_req_sg;
+	u64 lat_start = fs_lat_start();
 
 #if defined(DEBUG_MODE_BRIEF) || defined(DEBUG_MODE_DETAIL)
 	printk(KERN_INFO " %s, memory_server[%d] start_addr : 0x%lx, size : 0x%lx \n", 
 		__func__, mem_server_id, (unsigned long)start_addr, size);
 #endif
 
+#ifdef SEMERU_FS_COLD
+	// The compressed blocks of the data space are restored first.
+	if (unlikely(fs_cold_touch_user(start_addr, size)))
+		return NULL;
+#endif
+
+#ifdef SEMERU_TRANSPORT
+	if (semeru_transport != NULL && semeru_transport->cp_read(mem_server_id, start_addr, size) == 0) {
+		fs_emu_delay(mem_server_id, size);
+		fs_lat_record(FS_LAT_CP_READ, mem_server_id, lat_start);
+		return start_addr;
+	}
+#endif
+
+	if (unlikely(rdma_session == NULL))
+		return NULL;
+
 	// #1 Do page alignmetn,
 	// If the sent data small than a page, align up to a page
 	// Because we need to register a whole physical page as RDMA buffer.
@@ -1572,155 +3094,868 @@ char *semeru_cp_rdma_read(int mem_server_id, char __user *start_addr, unsigned l
 	end_addr_aligned = (char *)(((unsigned long)start_addr + size + PAGE_SIZE - 1) & PAGE_MASK); // align_up
 	size_aligned = (unsigned long)(end_addr_aligned - start_addr_aligned);
 
-	cpu = get_cpu(); // disable core preempt
+	cpu = get_cpu(); // disable core preempt
+
+	rdma_queue = get_cp_rdma_queue(rdma_session, cpu);
+	rdma_req_sg = cp_rdma_req_sg_get(rdma_queue);
+	if (unlikely(rdma_req_sg == NULL)) {
+		pr_err("%s, get reserved rdma_req_sg failed. \n", __func__);
+		ret = -1;
+		goto out;
+	}
+	//reset_semeru_rdma_req_sg(rdma_req_sg);
+	memset(rdma_req_sg, 0, sizeof(struct semeru_rdma_req_sg));
+
+#if defined(DEBUG_MODE_BRIEF) || defined(DEBUG_MODE_DETAIL)
+	printk(KERN_INFO "%s, rdma_queue[%d],	aligned start_addr : 0x%lx, aligned size : 0x%lx \n", __func__,
+	       rdma_queue->q_index, (unsigned long)start_addr_aligned, size_aligned);
+#endif
+
+	// 1) build and enqueue the 1-sided rdma_wr
+	ret = semeru_cp_rdma_send(rdma_session, rdma_queue, rdma_req_sg, start_addr_aligned, size_aligned,
+				  DMA_FROM_DEVICE);
+	if (unlikely(ret != 0)) {
+		printk(KERN_ERR "%s, cp_post_rdma_read failed. \n", __func__);
+		start_addr = NULL;
+		goto out;
+	}
+
+
+	// 2) Wait for the completion.
+	// There is no physical page.
+	// So, we just drain the corresponding queue
+	drain_rdma_queue(rdma_queue); // poll the corresponding RDMA CQ
+
+	put_cpu(); // enable core preemtp
+
+	// 5ms at most. The waiting is un-interrupptible
+	ret = wait_for_completion_timeout(&(rdma_req_sg->done),  msecs_to_jiffies(5)); 
+	if (unlikely(ret == 0)) {
+		pr_err("%s, rdma_queue[%d] wait for rdma_req_sg timeout for 5ms.\n", __func__, rdma_queue->q_index);
+		ret = -1;
+		goto out;
+	}
+	cp_rdma_req_sg_put(rdma_queue, rdma_req_sg); // safe to free
+	ret = 0; // reset return value to 0.
+	fs_emu_delay(mem_server_id, size);
+	fs_lat_record(FS_LAT_CP_READ, mem_server_id, lat_start);
+
+out:
+	trace_semeru_cp_transfer(mem_server_id, 0, 0, (unsigned long)start_addr_aligned, size_aligned, ret);
+	return start_addr;
+}
+
+/**
+ * Semeru Control Path - Synchronous inline write of at most CP_RDMA_INLINE_MAX bytes in the meta space.
+ * The bytes are copied from the user first, the WQE carries them, there's nothing to pin or map.
+ *
+ * return :
+ * 	0, written.
+ * 	1, not sent, the caller uses the page path. The QP can't send inline, or the user page isn't readable.
+ * 	-1, error.
+ */
+static int cp_rdma_write_inline(struct rdma_session_context *rdma_session, int write_type, char __user *start_addr,
+				unsigned long size)
+{
+	int ret = 0;
+	int cpu;
+	u8 buf[CP_RDMA_INLINE_MAX];
+	struct semeru_rdma_queue *rdma_queue;
+	struct semeru_rdma_req_sg *rdma_req_sg;
+	struct remote_mapping_chunk *remote_chunk_ptr;
+	struct semeru_wr_batch wr_batch;
+
+	// Sleeps on a page fault, before the preemption is disabled.
+	if (copy_from_user(buf, start_addr, size) != 0)
+		return 1;
+
+	remote_chunk_ptr = &(rdma_session->remote_chunk_list.remote_chunk[((uint64_t)start_addr - semeru_meta_start(rdma_session->window)) >> CHUNK_SHIFT]);
+
+	cpu = get_cpu(); // disable core preempt
+
+	rdma_queue = get_cp_rdma_queue(rdma_session, cpu);
+	if (rdma_queue->max_inline < size) {
+		put_cpu();
+		return 1;
+	}
+
+	rdma_req_sg = cp_rdma_req_sg_get(rdma_queue);
+	if (unlikely(rdma_req_sg == NULL)) {
+		pr_err("%s, get reserved rdma_req_sg failed. \n", __func__);
+		put_cpu();
+		return -1;
+	}
+	memset(rdma_req_sg, 0, sizeof(struct semeru_rdma_req_sg));
+
+	// Drain all the outstanding requests for a signal write
+	if (write_type)
+		drain_all_rdma_queue(rdma_session);
+
+	memcpy(rdma_req_sg->inline_data, buf, size);
+	init_completion(&(rdma_req_sg->done));
+	rdma_req_sg->seq_type = CONTROL_PATH_MEG;
+	rdma_req_sg->inlined = true;
+	rdma_req_sg->rdma_queue = rdma_queue;
+
+	// The lkey is not checked for the inline data, the address is a kernel virtual address.
+	rdma_req_sg->sge_list[0].addr = (u64)(uintptr_t)rdma_req_sg->inline_data;
+	rdma_req_sg->sge_list[0].length = (u32)size;
+	rdma_req_sg->sge_list[0].lkey = rdma_session->rdma_dev->dev->local_dma_lkey;
+
+	rdma_req_sg->rdma_sq_wr.rkey = remote_chunk_ptr->remote_rkey;
+	rdma_req_sg->rdma_sq_wr.remote_addr = remote_chunk_ptr->remote_addr + ((uint64_t)start_addr & CHUNK_MASK);
+	rdma_req_sg->rdma_sq_wr.wr.opcode = IB_WR_RDMA_WRITE;
+	rdma_req_sg->rdma_sq_wr.wr.send_flags = IB_SEND_SIGNALED | IB_SEND_INLINE;
+	rdma_req_sg->cqe.done = cp_rdma_write_done;
+	rdma_req_sg->rdma_sq_wr.wr.wr_cqe = &(rdma_req_sg->cqe);
+	rdma_req_sg->rdma_sq_wr.wr.next = NULL;
+	rdma_req_sg->rdma_sq_wr.wr.sg_list = rdma_req_sg->sge_list;
+	rdma_req_sg->rdma_sq_wr.wr.num_sge = 1;
+
+	wr_batch_init(&wr_batch, rdma_queue);
+	ret = wr_batch_add(&wr_batch, (struct ib_send_wr *)&rdma_req_sg->rdma_sq_wr);
+	if (likely(ret == 0))
+		ret = wr_batch_flush(&wr_batch);
+	if (unlikely(ret)) {
+		printk(KERN_ERR "%s, post the inline write failed. \n", __func__);
+		put_cpu();
+		cp_rdma_req_sg_put(rdma_queue, rdma_req_sg); // completed by the flush error path.
+		return -1;
+	}
+
+	drain_rdma_queue(rdma_queue); // poll the corresponding RDMA CQ
+
+	put_cpu(); // enable core preemtp
+
+	if (unlikely(wait_for_completion_timeout(&(rdma_req_sg->done), msecs_to_jiffies(5)) == 0)) {
+		pr_err("%s, rdma_queue[%d] wait for rdma_req_sg timeout for 5ms.\n", __func__, rdma_queue->q_index);
+		return -1;
+	}
+	cp_rdma_req_sg_put(rdma_queue, rdma_req_sg); // safe to free
+
+	return 0;
+}
+
+/**
+ * Semeru Control Path - Synchronous write
+ * Write data to remote memory pool.
+ * 
+ * Parameters:
+ * target_mem_server : which server to send the data.
+ * write_type: 0 for data; 1(non-zero) for signal.
+ * 	[x] Lots of flag/signals are written by this function.
+ * 		We need to guarantee the signal is the last message on the QP.
+ * 		For example, when we issue an CSet to Memory server, we need to confirm all the other packages are already done.
+ * 
+ * 
+ * 
+ * If succeed, 
+ * 		return the start_addr.
+ * else
+ * 		return NULL.
+ * 
+ */
+char *semeru_cp_rdma_write(int mem_server_id, int write_type, char __user *start_addr, unsigned long size)
+{
+	int ret = 0;
+	int cpu;
+	char __user *start_addr_aligned;
+	char __user *end_addr_aligned;
+	unsigned long size_aligned;
+	struct semeru_rdma_queue *rdma_queue;
+	struct rdma_session_context *rdma_session = cp_session_of(mem_server_id, start_addr);
+	struct semeru_rdma_req_sg *rdma_req_sg;
+	u64 lat_start = fs_lat_start();
+
+#if defined(DEBUG_MODE_BRIEF) || defined(DEBUG_MODE_DETAIL)
+	printk(KERN_INFO " %s, mem_server[%d] write_type 0x%x, start_addr : 0x%lx, size : 0x%lx \n", 
+		__func__, mem_server_id, write_type, (unsigned long)start_addr, size);
+#endif
+
+#ifdef SEMERU_FS_COLD
+	// The compressed blocks of the data space are restored first, or the memory server overwrites this write.
+	if (unlikely(fs_cold_touch_user(start_addr, size)))
+		return NULL;
+#endif
+
+#ifdef SEMERU_TRANSPORT
+	// CXL, only the data Regions. The signals are in the meta Region, still RDMA writes after the copy.
+	// TCP, the meta Region too, each request is acked before the next one.
+	if (semeru_transport != NULL && semeru_transport->cp_write(mem_server_id, start_addr, size) == 0) {
+		fs_emu_delay(mem_server_id, size);
+		fs_lat_record(FS_LAT_CP_WRITE, mem_server_id, lat_start);
+		return start_addr;
+	}
+#endif
+
+	if (unlikely(rdma_session == NULL))
+		return NULL;
+
+	// #0 A small write of the meta space, e.g. a flag, is sent inline with its exact bytes.
+	if (size <= CP_RDMA_INLINE_MAX && size > 0 && semeru_meta_window_of((unsigned long)start_addr, size) >= 0 &&
+	    ((uint64_t)start_addr & CHUNK_MASK) + size <= CHUNK_MASK + 1) {
+		ret = cp_rdma_write_inline(rdma_session, write_type, start_addr, size);
+		if (ret <= 0) {
+			trace_semeru_cp_transfer(mem_server_id, 1, write_type, (unsigned long)start_addr, size, ret);
+			if (unlikely(ret < 0))
+				return NULL;
+			fs_emu_delay(mem_server_id, size);
+			fs_lat_record(FS_LAT_CP_WRITE, mem_server_id, lat_start);
+			return start_addr;
+		}
+		ret = 0;
+	}
+
+	// #1 Do page alignmetn,
+	// If the sent data small than a page, align up to a page
+	// Because we need to register a whole physical page as RDMA buffer.
+	start_addr_aligned = (char *)((unsigned long)start_addr & PAGE_MASK); // align_down
+	end_addr_aligned = (char *)(((unsigned long)start_addr + size + PAGE_SIZE - 1) & PAGE_MASK); // align_up
+	size_aligned = (unsigned long)(end_addr_aligned - start_addr_aligned);
+
+	cpu = get_cpu(); // disable core preempt
+
+	rdma_queue = get_cp_rdma_queue(rdma_session, cpu);
+	rdma_req_sg = cp_rdma_req_sg_get(rdma_queue);
+	if (unlikely(rdma_req_sg == NULL)) {
+		pr_err("%s, get reserved rdma_req_sg failed. \n", __func__);
+		ret = -1;
+		goto out;
+	}
+	//reset_semeru_rdma_req_sg(rdma_req_sg);
+	memset(rdma_req_sg, 0, sizeof(struct semeru_rdma_req_sg));
+
+#if defined(DEBUG_MODE_BRIEF) || defined(DEBUG_MODE_DETAIL)
+	printk(KERN_INFO "%s, mem_server[%d] rdma_queue[%d], aligned start_addr : 0x%lx, aligned size : 0x%lx \n", __func__,
+	       mem_server_id, rdma_queue->q_index, (unsigned long)start_addr_aligned, size_aligned);
+#endif
+
+	// 1) Drain all the outstanding requests for a signal write
+	if (write_type) { // no-zero
+		drain_all_rdma_queue(rdma_session);
+	}
+
+	// 2) build and enqueue the 1-sided rdma_wr
+	// [x] Get the rdma_session_context *rdma_session
+	// [?] How to confirm the rdma_session_global is fully initialized ?
+	ret = semeru_cp_rdma_send(rdma_session, rdma_queue, rdma_req_sg, start_addr_aligned, size_aligned,
+				  DMA_TO_DEVICE);
+	if (unlikely(ret != 0)) {
+		printk(KERN_ERR "%s, cp_post_rdma_read failed. \n", __func__);
+		start_addr = NULL;
+		goto out;
+	}
+
+
+
+	// 1) Wait for the completion.
+	// There is no physical page.
+	// So, we just drain the corresponding queue
+	drain_rdma_queue(rdma_queue); // poll the corresponding RDMA CQ
+
+	put_cpu(); // enable core preemtp
+
+	// 5ms at most. The waiting is un-interrupptible
+	ret = wait_for_completion_timeout(&(rdma_req_sg->done), msecs_to_jiffies(5)); 
+	if (unlikely(ret == 0)) {
+		pr_err("%s, rdma_queue[%d] wait for rdma_req_sg timeout for 5ms.\n", __func__, rdma_queue->q_index);
+		ret = -1;
+		goto out;
+	}
+	cp_rdma_req_sg_put(rdma_queue, rdma_req_sg); // safe to free
+	ret = 0; // reset return value to 0.
+	fs_emu_delay(mem_server_id, size);
+	fs_lat_record(FS_LAT_CP_WRITE, mem_server_id, lat_start);
+
+out:
+	trace_semeru_cp_transfer(mem_server_id, 1, write_type, (unsigned long)start_addr_aligned, size_aligned, ret);
+	return start_addr;
+}
+
+
+
+//
+// Vectored control path
+//
+
+static struct cp_rdma_ticket cp_rdma_tickets[CP_RDMA_TICKET_NUM];
+static DEFINE_SPINLOCK(cp_rdma_ticket_lock);
+
+void init_cp_rdma_tickets(void)
+{
+	int i;
+
+	for (i = 0; i < CP_RDMA_TICKET_NUM; i++) {
+		atomic_set(&cp_rdma_tickets[i].pending, 0);
+		init_completion(&cp_rdma_tickets[i].done);
+		cp_rdma_tickets[i].status = 0;
+		cp_rdma_tickets[i].in_use = false;
+		cp_rdma_tickets[i].orphaned = false;
+		cp_rdma_tickets[i].pages = NULL;
+		cp_rdma_tickets[i].nr_pages = 0;
+		cp_rdma_tickets[i].server_mask = 0;
+		cp_rdma_tickets[i].window = 0;
+		cp_rdma_tickets[i].q_index = control_path_fixed_qp;
+	}
+}
+
+/**
+ * Get a free ticket and bias its pending counter by 1.
+ * 
+ * return :
+ * 	the ticket id, or -1 if all the tickets are in use.
+ */
+static int cp_rdma_ticket_get(void)
+{
+	int i;
+	int ticket_id = -1;
+	struct cp_rdma_ticket *ticket;
+
+	spin_lock(&cp_rdma_ticket_lock);
+	for (i = 0; i < CP_RDMA_TICKET_NUM; i++) {
+		if (!cp_rdma_tickets[i].in_use) {
+			cp_rdma_tickets[i].in_use = true;
+			ticket_id = i;
+			break;
+		}
+	}
+	spin_unlock(&cp_rdma_ticket_lock);
+
+	if (ticket_id < 0)
+		return -1;
+
+	ticket = &cp_rdma_tickets[ticket_id];
+	atomic_set(&ticket->pending, 1);
+	reinit_completion(&ticket->done);
+	ticket->status = 0;
+	ticket->orphaned = false;
+	ticket->server_mask = 0;
+
+	return ticket_id;
+}
+
+/**
+ * Unpin the user pages of the ticket and give it back.
+ * All its packages are finished.
+ */
+static void cp_rdma_ticket_release(struct cp_rdma_ticket *ticket)
+{
+	unsigned long i;
+
+	for (i = 0; i < ticket->nr_pages; i++)
+		put_page(ticket->pages[i]);
+	kfree(ticket->pages);
+	ticket->pages = NULL;
+	ticket->nr_pages = 0;
+
+	spin_lock(&cp_rdma_ticket_lock);
+	ticket->in_use = false;
+	spin_unlock(&cp_rdma_ticket_lock);
+}
+
+/**
+ * Pin the user pages of all the entries for the life of the ticket.
+ * An async vector returns with its packages in flight and the data path swap-out resumed,
+ * the pages can't be swapped out and reused under the DMA.
+ *
+ * return :
+ * 	0 for success, -1 for error. Nothing stays pinned on error.
+ */
+static int cp_rdma_ticket_pin(struct cp_rdma_ticket *ticket, struct semeru_rdma_iovec *iov, int nr_iov,
+			      enum dma_data_direction dir)
+{
+	unsigned long start, nr_pages = 0;
+	long pinned;
+	int i;
+
+	for (i = 0; i < nr_iov; i++)
+		nr_pages += (PAGE_ALIGN((unsigned long)iov[i].start_addr + iov[i].size) -
+			     ((unsigned long)iov[i].start_addr & PAGE_MASK)) >> PAGE_SHIFT;
+
+	ticket->pages = kmalloc_array(nr_pages, sizeof(struct page *), GFP_KERNEL);
+	if (unlikely(ticket->pages == NULL))
+		return -1;
+
+	for (i = 0; i < nr_iov; i++) {
+		start = (unsigned long)iov[i].start_addr & PAGE_MASK;
+		nr_pages = (PAGE_ALIGN((unsigned long)iov[i].start_addr + iov[i].size) - start) >> PAGE_SHIFT;
+		pinned = get_user_pages_fast(start, nr_pages, dir == DMA_FROM_DEVICE, ticket->pages + ticket->nr_pages);
+		if (pinned > 0)
+			ticket->nr_pages += pinned;
+		if (unlikely(pinned != nr_pages)) {
+			pr_err("%s, iov[%d] pin [0x%lx, 0x%lx) failed, %ld pages pinned \n", __func__, i, start,
+			       start + (nr_pages << PAGE_SHIFT), pinned);
+			while (ticket->nr_pages > 0)
+				put_page(ticket->pages[--ticket->nr_pages]);
+			kfree(ticket->pages);
+			ticket->pages = NULL;
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * Drop one pending package of the ticket.
+ * Invoked by the CQ callback, or by the poster to drop the bias.
+ * The ticket given up by a timed out waiter is released by its last package.
+ */
+void cp_rdma_ticket_put(struct cp_rdma_ticket *ticket, enum ib_wc_status status)
+{
+	bool orphaned;
+
+	if (unlikely(status != IB_WC_SUCCESS))
+		ticket->status = -EIO;
+
+	if (atomic_dec_and_test(&ticket->pending)) {
+		spin_lock(&cp_rdma_ticket_lock);
+		orphaned = ticket->orphaned;
+		if (!orphaned)
+			complete(&ticket->done);
+		spin_unlock(&cp_rdma_ticket_lock);
+
+		if (orphaned)
+			cp_rdma_ticket_release(ticket);
+	}
+}
+
+/**
+ * Semeru Control Path - Vectored write or read
+ * Chain a batch of user space ranges, maybe on different memory servers, and post them by one doorbell per server.
+ * All the ranges are in the address window of the first one, see cp_rdma_batch_range().
+ * 
+ * Parameters:
+ * 	iov : kernel copy of the user's semeru_rdma_iovec array.
+ * 	nr_iov : number of entries.
+ * 	async : 0, wait for all the entries; non-zero, return the ticket id without waiting.
+ * 	dir : DMA_TO_DEVICE for write, DMA_FROM_DEVICE for read. Only the write entries can be signals.
+ * 
+ * return :
+ * 	sync : 0 for success, -1 for error.
+ * 	async : the ticket id, waited by semeru_cp_rdma_wait(). -1 for error.
+ */
+static int cp_rdma_vector(struct semeru_rdma_iovec *iov, int nr_iov, int async, enum dma_data_direction dir)
+{
+	int ret = 0;
+	int flush_ret;
+	int i;
+	int mem_server_id;
+	int window = nr_iov > 0 ? semeru_window_of((unsigned long)iov[0].start_addr) : -1;
+	int ticket_id;
+	int cpu;
+	char __user *start_addr_aligned;
+	char __user *end_addr_aligned;
+	struct cp_rdma_ticket *ticket;
+	struct rdma_session_context *rdma_session;
+	struct semeru_wr_batch wr_batch[MAX_NUM_OF_MEMORY_SERVER];
+
+	if (unlikely(window < 0)) {
+		pr_err("%s, the %d entries aren't in a served address window. \n", __func__, nr_iov);
+		return -1;
+	}
+
+#ifdef SEMERU_FS_COLD
+	// 0) The compressed blocks of the data space are restored before the core is held.
+	for (i = 0; i < nr_iov; i++) {
+		if (unlikely(fs_cold_touch_user(iov[i].start_addr, iov[i].size)))
+			return -1;
+	}
+#endif
+
+	// 1) Get a ticket. All the packages of the vector are tracked by it.
+	ticket_id = cp_rdma_ticket_get();
+	if (unlikely(ticket_id < 0)) {
+		pr_err("%s, run out of %d control path tickets. \n", __func__, CP_RDMA_TICKET_NUM);
+		return -1;
+	}
+	ticket = &cp_rdma_tickets[ticket_id];
+	ticket->window = window;
+
+	if (async && unlikely(cp_rdma_ticket_pin(ticket, iov, nr_iov, dir))) {
+		cp_rdma_ticket_release(ticket);
+		return -1;
+	}
+
+	cpu = get_cpu(); // disable core preempt
+
+	// All the packages of the vector go through the control path queue of current core.
+	ticket->q_index = get_cp_rdma_queue(fs_session(window, 0), cpu)->q_index;
+	for (mem_server_id = 0; mem_server_id < num_mem_servers; mem_server_id++) {
+		rdma_session = fs_session(window, mem_server_id);
+		wr_batch_init(&wr_batch[mem_server_id], &(rdma_session->rdma_queues[ticket->q_index]));
+	}
+
+	// 2) Chain the packages of each entry to its memory server's batch.
+	for (i = 0; i < nr_iov; i++) {
+		mem_server_id = iov[i].mem_server_id;
+		if (unlikely(mem_server_id < 0 || mem_server_id >= num_mem_servers)) {
+			pr_err("%s, iov[%d] wrong memory server id %d \n", __func__, i, mem_server_id);
+			ret = -1;
+			break;
+		}
+		rdma_session = fs_session(window, mem_server_id);
+
+		// Do page alignment, the same as semeru_cp_rdma_write()
+		start_addr_aligned = (char *)((unsigned long)iov[i].start_addr & PAGE_MASK); // align_down
+		end_addr_aligned = (char *)(((unsigned long)iov[i].start_addr + iov[i].size + PAGE_SIZE - 1) &
+					    PAGE_MASK); // align_up
+
+#if defined(DEBUG_MODE_BRIEF) || defined(DEBUG_MODE_DETAIL)
+		printk(KERN_INFO "%s, ticket[%d] iov[%d] mem_server[%d] write_type 0x%x, [0x%lx, 0x%lx) \n", __func__,
+		       ticket_id, i, mem_server_id, iov[i].write_type, (unsigned long)start_addr_aligned,
+		       (unsigned long)end_addr_aligned);
+#endif
+
+		// A signal has to be the last message on the QP.
+		// Post the chained packages and drain all the outstanding requests before it.
+		if (iov[i].write_type) { // no-zero
+			if (unlikely(dir != DMA_TO_DEVICE)) {
+				pr_err("%s, iov[%d] a read can't be a signal \n", __func__, i);
+				ret = -1;
+				break;
+			}
+			ret = wr_batch_flush(&wr_batch[mem_server_id]);
+			if (unlikely(ret))
+				break;
+			drain_all_rdma_queue(rdma_session);
+		}
+
+		ticket->server_mask |= (1UL << mem_server_id);
+		ret = cp_rdma_batch_range(rdma_session, &wr_batch[mem_server_id], NULL, ticket, start_addr_aligned,
+					  (uint64_t)(end_addr_aligned - start_addr_aligned), dir);
+		if (unlikely(ret)) {
+			printk(KERN_ERR "%s, build wr for iov[%d] failed. \n", __func__, i);
+			break;
+		}
+	}
+
+	// 3) Post the rest, one doorbell per memory server.
+	for (mem_server_id = 0; mem_server_id < num_mem_servers; mem_server_id++) {
+		flush_ret = wr_batch_flush(&wr_batch[mem_server_id]);
+		if (unlikely(flush_ret)) {
+			printk(KERN_ERR "%s, post chained ib_send_wr to memory server[%d] failed. \n", __func__,
+			       mem_server_id);
+			ret = flush_ret;
+		}
+	}
+
+	put_cpu(); // enable core preemtp
+
+	// All the packages are posted, drop the bias.
+	cp_rdma_ticket_put(ticket, IB_WC_SUCCESS);
+
+	// 4) The posted packages still need the ticket, release it after they finish.
+	if (unlikely(ret)) {
+		semeru_cp_rdma_wait(ticket_id);
+		return -1;
+	}
+
+	if (async)
+		return ticket_id;
+
+	return semeru_cp_rdma_wait(ticket_id);
+}
+
+/**
+ * Semeru Control Path - Vectored write
+ * Write a batch of user space ranges, maybe to different memory servers, by one syscall.
+ */
+int semeru_cp_rdma_writev(struct semeru_rdma_iovec *iov, int nr_iov, int async)
+{
+	return cp_rdma_vector(iov, nr_iov, async, DMA_TO_DEVICE);
+}
+
+/**
+ * Semeru Control Path - Vectored read
+ * Read a batch of user space ranges, e.g. the per-Region meta of all the old Regions, by one syscall.
+ * The local pages have to be mapped, the same as semeru_cp_rdma_read().
+ * 
+ * return :
+ * 	0 for success, -1 for error.
+ */
+int semeru_cp_rdma_readv(struct semeru_rdma_iovec *iov, int nr_iov)
+{
+	return cp_rdma_vector(iov, nr_iov, 0, DMA_FROM_DEVICE);
+}
+
+/**
+ * Semeru Control Path - Broadcast write
+ * Write the same user space range to a set of memory servers, e.g. the klass metadata or the CPU server flags.
+ * The packages of all the servers are posted before any of them is waited, one doorbell per server,
+ * and one ticket completes after every server acknowledged. The cost stays close to a single write
+ * as the memory servers are added, until the NIC bandwidth is saturated.
+ * 
+ * Parameters:
+ * 	server_mask : bit i for memory server i, 0 for all the memory servers.
+ * 	write_type : 0 for data; non-zero for signal, each server's queues are drained before its signal.
+ * 
+ * return :
+ * 	0 for success, -1 for error.
+ */
+int semeru_cp_rdma_bcast(int server_mask, int write_type, char __user *start_addr, unsigned long size)
+{
+	int mem_server_id;
+	int nr_iov = 0;
+	struct semeru_rdma_iovec iov[MAX_NUM_OF_MEMORY_SERVER];
+
+	if (server_mask == 0)
+		server_mask = (1 << num_mem_servers) - 1;
+	if (unlikely(server_mask < 0 || (server_mask >> num_mem_servers) != 0)) {
+		pr_err("%s, wrong memory server mask 0x%x \n", __func__, server_mask);
+		return -1;
+	}
 
-	// !! Fix me !!
-	// Control path use the reserved QP on core #control_path_fixed_qp
-	rdma_queue = &(rdma_session->rdma_queues[control_path_fixed_qp]);
-	rdma_req_sg = (struct semeru_rdma_req_sg *)kmem_cache_alloc(rdma_queue->rdma_req_sg_cache, GFP_ATOMIC);
-	if (unlikely(rdma_req_sg == NULL)) {
-		pr_err("%s, get reserved rdma_req_sg failed. \n", __func__);
-		ret = -1;
-		goto out;
+	for (mem_server_id = 0; mem_server_id < num_mem_servers; mem_server_id++) {
+		if (!(server_mask & (1 << mem_server_id)))
+			continue;
+		iov[nr_iov].mem_server_id = mem_server_id;
+		iov[nr_iov].write_type = write_type;
+		iov[nr_iov].start_addr = start_addr;
+		iov[nr_iov].size = size;
+		nr_iov++;
 	}
-	//reset_semeru_rdma_req_sg(rdma_req_sg);
-	memset(rdma_req_sg, 0, sizeof(struct semeru_rdma_req_sg));
 
-#if defined(DEBUG_MODE_BRIEF) || defined(DEBUG_MODE_DETAIL)
-	printk(KERN_INFO "%s, rdma_queue[%d],	aligned start_addr : 0x%lx, aligned size : 0x%lx \n", __func__,
-	       rdma_queue->q_index, (unsigned long)start_addr_aligned, size_aligned);
-#endif
+	return cp_rdma_vector(iov, nr_iov, 0, DMA_TO_DEVICE);
+}
 
-	// 1) build and enqueue the 1-sided rdma_wr
-	ret = semeru_cp_rdma_send(rdma_session, rdma_queue, rdma_req_sg, start_addr_aligned, size_aligned,
-				  DMA_FROM_DEVICE);
-	if (unlikely(ret != 0)) {
-		printk(KERN_ERR "%s, cp_post_rdma_read failed. \n", __func__);
-		start_addr = NULL;
-		goto out;
+/**
+ * Semeru Control Path - Wait for a vectored write and release its ticket.
+ * On timeout, the ticket is left to its last package, see cp_rdma_ticket_put().
+ * 
+ * return :
+ * 	0 for success, -1 for error.
+ */
+int semeru_cp_rdma_wait(int ticket_id)
+{
+	int ret = 0;
+	bool orphaned = false;
+	int mem_server_id;
+	struct cp_rdma_ticket *ticket;
+	struct rdma_session_context *rdma_session;
+
+	if (unlikely(ticket_id < 0 || ticket_id >= CP_RDMA_TICKET_NUM || !cp_rdma_tickets[ticket_id].in_use ||
+		     cp_rdma_tickets[ticket_id].orphaned)) {
+		pr_err("%s, wrong ticket id %d \n", __func__, ticket_id);
+		return -1;
 	}
+	ticket = &cp_rdma_tickets[ticket_id];
 
+	// 1) The CQ is IB_POLL_DIRECT, poll the control path queues the packages were posted to.
+	for (mem_server_id = 0; mem_server_id < num_mem_servers; mem_server_id++) {
+		if (ticket->server_mask & (1UL << mem_server_id)) {
+			rdma_session = fs_session(ticket->window, mem_server_id);
+			wait_rdma_queue(&(rdma_session->rdma_queues[ticket->q_index]));
+		}
+	}
 
-	// 2) Wait for the completion.
-	// There is no physical page.
-	// So, we just drain the corresponding queue
-	drain_rdma_queue(rdma_queue); // poll the corresponding RDMA CQ
+	// 2) The waiting is un-interrupptible
+	if (unlikely(wait_for_completion_timeout(&ticket->done, msecs_to_jiffies(CP_RDMA_WAIT_TIMEOUT_MS)) == 0)) {
+		// The packages are still in flight, can't reuse the ticket now.
+		// Unless the last one finished meanwhile, it releases the ticket.
+		spin_lock(&cp_rdma_ticket_lock);
+		if (atomic_read(&ticket->pending) != 0) {
+			ticket->orphaned = true;
+			orphaned = true;
+		}
+		spin_unlock(&cp_rdma_ticket_lock);
 
-	put_cpu(); // enable core preemtp
+		if (orphaned) {
+			pr_err("%s, ticket[%d] wait for %d packages timeout for %dms.\n", __func__, ticket_id,
+			       atomic_read(&ticket->pending), CP_RDMA_WAIT_TIMEOUT_MS);
+			return -1;
+		}
+		wait_for_completion(&ticket->done);
+	}
 
-	// 5ms at most. The waiting is un-interrupptible
-	ret = wait_for_completion_timeout(&(rdma_req_sg->done),  msecs_to_jiffies(5)); 
-	if (unlikely(ret == 0)) {
-		pr_err("%s, rdma_queue[%d] wait for rdma_req_sg timeout for 5ms.\n", __func__, rdma_queue->q_index);
+	if (unlikely(ticket->status)) {
+		pr_err("%s, ticket[%d] some packages failed, status %d \n", __func__, ticket_id, ticket->status);
 		ret = -1;
-		goto out;
 	}
-	ret = 0; // reset return value to 0.
 
-out:
-	return start_addr;
+	cp_rdma_ticket_release(ticket);
+
+	return ret;
 }
 
+//
+// Incremental control path
+//
+
 /**
- * Semeru Control Path - Synchronous write
- * Write data to remote memory pool.
- * 
- * Parameters:
- * target_mem_server : which server to send the data.
- * write_type: 0 for data; 1(non-zero) for signal.
- * 	[x] Lots of flag/signals are written by this function.
- * 		We need to guarantee the signal is the last message on the QP.
- * 		For example, when we issue an CSet to Memory server, we need to confirm all the other packages are already done.
- * 
- * 
+ * Control-Path, check whether the user page has to be synced, and clean it.
  * 
- * If succeed, 
- * 		return the start_addr.
- * else
- * 		return NULL.
+ * Return true for the pages written since the last sync, found by the soft-dirty bit.
+ * 	The soft-dirty bit is cleared and the pte is write-protected, same as clear_refs.
+ * 	The caller has to flush the TLB before sending the page.
  * 
+ * The pages not present are always returned, meta_data_map_sg() decides to send them or not.
+ * The THP is not split, returned as dirty.
+ * Without CONFIG_MEM_SOFT_DIRTY, all the mapped pages are dirty.
  */
-char *semeru_cp_rdma_write(int mem_server_id, int write_type, char __user *start_addr, unsigned long size)
+static bool cp_test_and_clear_soft_dirty(struct mm_struct *mm, unsigned long addr)
 {
-	int ret = 0;
-	int cpu;
-	char __user *start_addr_aligned;
-	char __user *end_addr_aligned;
-	unsigned long size_aligned;
-	struct semeru_rdma_queue *rdma_queue;
-	struct rdma_session_context *rdma_session = &rdma_session_global_ptr[mem_server_id];
-	struct semeru_rdma_req_sg *rdma_req_sg;
+	pgd_t *pgd;
+	p4d_t *p4d;
+	pud_t *pud;
+	pmd_t *pmd;
+	pte_t *ptep;
+	pte_t ptent;
+	spinlock_t *ptl;
+	bool dirty = true;
 
-#if defined(DEBUG_MODE_BRIEF) || defined(DEBUG_MODE_DETAIL)
-	printk(KERN_INFO " %s, mem_server[%d] write_type 0x%x, start_addr : 0x%lx, size : 0x%lx \n", 
-		__func__, mem_server_id, write_type, (unsigned long)start_addr, size);
-#endif
+	// 1) Never touched, skip this page. The same as walk_page_table().
+	pgd = pgd_offset(mm, addr);
+	if (pgd_none(*pgd) || unlikely(pgd_bad(*pgd)))
+		return false;
 
-	// #1 Do page alignmetn,
-	// If the sent data small than a page, align up to a page
-	// Because we need to register a whole physical page as RDMA buffer.
-	start_addr_aligned = (char *)((unsigned long)start_addr & PAGE_MASK); // align_down
-	end_addr_aligned = (char *)(((unsigned long)start_addr + size + PAGE_SIZE - 1) & PAGE_MASK); // align_up
-	size_aligned = (unsigned long)(end_addr_aligned - start_addr_aligned);
+	p4d = p4d_offset(pgd, addr);
+	if (p4d_none(*p4d) || unlikely(p4d_bad(*p4d)))
+		return false;
 
-	cpu = get_cpu(); // disable core preempt
+	pud = pud_offset(p4d, addr);
+	if (pud_none(*pud) || unlikely(pud_bad(*pud)))
+		return false;
 
-	// !! Fix me !!
-	// Control path use the reserved QP on core #control_path_fixed_qp
-	rdma_queue = &(rdma_session->rdma_queues[control_path_fixed_qp]);
-	rdma_req_sg = (struct semeru_rdma_req_sg *)kmem_cache_alloc(rdma_queue->rdma_req_sg_cache, GFP_ATOMIC);
-	if (unlikely(rdma_req_sg == NULL)) {
-		pr_err("%s, get reserved rdma_req_sg failed. \n", __func__);
-		ret = -1;
-		goto out;
+	pmd = pmd_offset(pud, addr);
+	if (pmd_none(*pmd))
+		return false;
+
+	if (pmd_trans_huge(*pmd))
+		return true;
+
+	// 2) Test and clear the soft-dirty bit under the pte lock.
+	ptep = pte_offset_map_lock(mm, pmd, addr, &ptl);
+	ptent = *ptep;
+	if (pte_none(ptent)) {
+		dirty = false;
+	} else if (pte_present(ptent)) {
+#ifdef CONFIG_MEM_SOFT_DIRTY
+		dirty = pte_soft_dirty(ptent);
+		if (dirty) {
+			ptent = ptep_modify_prot_start(mm, addr, ptep);
+			ptent = pte_wrprotect(ptent);
+			ptent = pte_clear_soft_dirty(ptent);
+			ptep_modify_prot_commit(mm, addr, ptep, ptent);
+		}
+#endif
 	}
-	//reset_semeru_rdma_req_sg(rdma_req_sg);
-	memset(rdma_req_sg, 0, sizeof(struct semeru_rdma_req_sg));
+	pte_unmap_unlock(ptep, ptl);
 
-#if defined(DEBUG_MODE_BRIEF) || defined(DEBUG_MODE_DETAIL)
-	printk(KERN_INFO "%s, mem_server[%d] rdma_queue[%d], aligned start_addr : 0x%lx, aligned size : 0x%lx \n", __func__,
-	       mem_server_id, rdma_queue->q_index, (unsigned long)start_addr_aligned, size_aligned);
-#endif
+	return dirty;
+}
 
-	// 1) Drain all the outstanding requests for a signal write
-	if (write_type) { // no-zero
-		drain_all_rdma_queue(mem_server_id);
+/**
+ * Semeru Control Path - Incremental write.
+ * 
+ * Only send the pages of [start_addr, start_addr + size) written since the last sync.
+ * The dirty runs are collected and posted by the vectored write, CP_DIRTY_IOV_NUM entries at most per post.
+ * 
+ * Parameters:
+ * 	target_server : the memory server id, or CP_DIRTY_ALL_SERVERS to send the dirty runs to all of them.
+ * 	The range has to be within one rdma chunk, the same as semeru_cp_rdma_write().
+ * 
+ * return :
+ * 	the number of pages sent, or -1 for error.
+ */
+int semeru_cp_rdma_write_dirty(int target_server, char __user *start_addr, unsigned long size)
+{
+	int ret = 0;
+	int nr_iov = 0;
+	int mem_server_id;
+	int server_start, server_end;
+	int sent_pages = 0;
+	unsigned long addr;
+	unsigned long run_start = 0; // 0 means no open dirty run
+	unsigned long flush_start;
+	unsigned long start_addr_aligned;
+	unsigned long end_addr_aligned;
+	struct mm_struct *mm = current->mm;
+	struct semeru_rdma_iovec *iov;
+
+	if (target_server == CP_DIRTY_ALL_SERVERS) {
+		server_start = 0;
+		server_end = num_mem_servers;
+	} else if (target_server >= 0 && target_server < num_mem_servers) {
+		server_start = target_server;
+		server_end = target_server + 1;
+	} else {
+		pr_err("%s, wrong memory server id %d \n", __func__, target_server);
+		return -1;
 	}
 
-	// 2) build and enqueue the 1-sided rdma_wr
-	// [x] Get the rdma_session_context *rdma_session
-	// [?] How to confirm the rdma_session_global is fully initialized ?
-	ret = semeru_cp_rdma_send(rdma_session, rdma_queue, rdma_req_sg, start_addr_aligned, size_aligned,
-				  DMA_TO_DEVICE);
-	if (unlikely(ret != 0)) {
-		printk(KERN_ERR "%s, cp_post_rdma_read failed. \n", __func__);
-		start_addr = NULL;
-		goto out;
+	iov = kmalloc_array(CP_DIRTY_IOV_NUM, sizeof(struct semeru_rdma_iovec), GFP_KERNEL);
+	if (unlikely(iov == NULL)) {
+		pr_err("%s, allocate the iovec failed. \n", __func__);
+		return -1;
 	}
 
+	// Do page alignment, the same as semeru_cp_rdma_write()
+	start_addr_aligned = (unsigned long)start_addr & PAGE_MASK; // align_down
+	end_addr_aligned = ((unsigned long)start_addr + size + PAGE_SIZE - 1) & PAGE_MASK; // align_up
+	flush_start = start_addr_aligned;
+
+	// Keep the vma from being unmapped during the scanning.
+	down_read(&mm->mmap_sem);
+	for (addr = start_addr_aligned; addr < end_addr_aligned; addr += PAGE_SIZE) {
+		// 1) Extend or close the dirty run.
+		if (cp_test_and_clear_soft_dirty(mm, addr)) {
+			if (run_start == 0)
+				run_start = addr;
+			sent_pages++;
+			if (addr + PAGE_SIZE < end_addr_aligned)
+				continue;
+			addr += PAGE_SIZE; // the last page is dirty, close the run at the end.
+		}
 
+		if (run_start == 0)
+			continue;
 
-	// 1) Wait for the completion.
-	// There is no physical page.
-	// So, we just drain the corresponding queue
-	drain_rdma_queue(rdma_queue); // poll the corresponding RDMA CQ
-
-	put_cpu(); // enable core preemtp
+		for (mem_server_id = server_start; mem_server_id < server_end; mem_server_id++) {
+			iov[nr_iov].mem_server_id = mem_server_id;
+			iov[nr_iov].write_type = 0; // data
+			iov[nr_iov].start_addr = (char __user *)run_start;
+			iov[nr_iov].size = addr - run_start;
+			nr_iov++;
+		}
+		run_start = 0;
+
+		// 2) Post the collected runs when the iovec is full.
+		//    The write-protected ptes have to be seen by all the cores before the data is read.
+		if (nr_iov + (server_end - server_start) > CP_DIRTY_IOV_NUM) {
+			flush_tlb_mm_range(mm, flush_start, addr, 0UL);
+			flush_start = addr;
+
+			ret = semeru_cp_rdma_writev(iov, nr_iov, 0);
+			nr_iov = 0;
+			if (unlikely(ret))
+				goto out;
+		}
+	}
 
-	// 5ms at most. The waiting is un-interrupptible
-	ret = wait_for_completion_timeout(&(rdma_req_sg->done), msecs_to_jiffies(5)); 
-	if (unlikely(ret == 0)) {
-		pr_err("%s, rdma_queue[%d] wait for rdma_req_sg timeout for 5ms.\n", __func__, rdma_queue->q_index);
-		ret = -1;
-		goto out;
+	// 3) Post the rest.
+	if (nr_iov > 0) {
+		flush_tlb_mm_range(mm, flush_start, end_addr_aligned, 0UL);
+		ret = semeru_cp_rdma_writev(iov, nr_iov, 0);
 	}
-	ret = 0; // reset return value to 0.
 
 out:
-	return start_addr;
-}
+	up_read(&mm->mmap_sem);
+	kfree(iov);
+
+#if defined(DEBUG_MODE_BRIEF) || defined(DEBUG_MODE_DETAIL)
+	printk(KERN_INFO "%s, target_server %d, [0x%lx, 0x%lx), sent 0x%x dirty pages \n", __func__, target_server,
+	       start_addr_aligned, end_addr_aligned, sent_pages);
+#endif
 
+	if (unlikely(ret)) {
+		pr_err("%s, post the dirty pages of [0x%lx, 0x%lx) failed. \n", __func__, start_addr_aligned,
+		       end_addr_aligned);
+		return -1;
+	}
 
+	return sent_pages;
+}
 
 /**
  * Reset all the fields 
@@ -1812,6 +4047,30 @@ void init_kernel_semeru_rdma_ops(void)
 	// the address of function is fixed.
 	module_rdma_ops.rdma_read = &semeru_cp_rdma_read; 
 	module_rdma_ops.rdma_write = &semeru_cp_rdma_write;
+#ifdef SEMERU_FS_PREFETCH
+	module_rdma_ops.prefetch_hint = &semeru_prefetch_hint;
+	module_rdma_ops.prefetch_range = &semeru_prefetch_range;
+	module_rdma_ops.fetch_async = &semeru_fetch_async;
+	module_rdma_ops.prefetch_ready = &semeru_prefetch_ready;
+#else
+	module_rdma_ops.prefetch_hint = NULL;
+	module_rdma_ops.prefetch_range = NULL;
+	module_rdma_ops.fetch_async = NULL;
+	module_rdma_ops.prefetch_ready = NULL;
+#endif
+	module_rdma_ops.rdma_writev = &semeru_cp_rdma_writev;
+	module_rdma_ops.rdma_wait = &semeru_cp_rdma_wait;
+	module_rdma_ops.meta_reg = &semeru_cp_register_meta;
+	module_rdma_ops.rdma_write_dirty = &semeru_cp_rdma_write_dirty;
+	module_rdma_ops.wait_mem_server = &semeru_wait_mem_server_state;
+	module_rdma_ops.ring_doorbell = &semeru_cp_ring_doorbell;
+	module_rdma_ops.resize_chunks = &semeru_resize_remote_chunks;
+	module_rdma_ops.query_placement = &semeru_query_placement;
+	module_rdma_ops.region_fence = &semeru_region_fence;
+	module_rdma_ops.rdma_readv = &semeru_cp_rdma_readv;
+	module_rdma_ops.rdma_bcast = &semeru_cp_rdma_bcast;
+	module_rdma_ops.rdma_atomic = &semeru_cp_rdma_atomic;
+	module_rdma_ops.rdma_peek = &semeru_rdma_peek;
 
 	rdma_ops_wrapper(&module_rdma_ops); // exported kernel call
 #endif
@@ -1830,6 +4089,23 @@ void reset_kernel_semeru_rdma_ops(void)
 	struct semeru_rdma_ops module_rdma_ops; // temporary var
 	module_rdma_ops.rdma_read = NULL; // reset to NULL
 	module_rdma_ops.rdma_write = NULL;
+	module_rdma_ops.prefetch_hint = NULL;
+	module_rdma_ops.rdma_writev = NULL;
+	module_rdma_ops.rdma_wait = NULL;
+	module_rdma_ops.meta_reg = NULL;
+	module_rdma_ops.rdma_write_dirty = NULL;
+	module_rdma_ops.wait_mem_server = NULL;
+	module_rdma_ops.ring_doorbell = NULL;
+	module_rdma_ops.resize_chunks = NULL;
+	module_rdma_ops.query_placement = NULL;
+	module_rdma_ops.region_fence = NULL;
+	module_rdma_ops.rdma_readv = NULL;
+	module_rdma_ops.prefetch_range = NULL;
+	module_rdma_ops.rdma_bcast = NULL;
+	module_rdma_ops.rdma_atomic = NULL;
+	module_rdma_ops.rdma_peek = NULL;
+	module_rdma_ops.fetch_async = NULL;
+	module_rdma_ops.prefetch_ready = NULL;
 
 	rdma_ops_wrapper(&module_rdma_ops); // exported kernel call
 #endif
@@ -1849,7 +4125,7 @@ void reset_kernel_semeru_rdma_ops(void)
 
 /**
  * @brief the global handler of all the rdma_session_context. 
- *	One rdma_session_context for each memory server.
+ *	One rdma_session_context for each memory server of each served address window, see fs_session().
  * 
  * @param rdma_session_global_ptr 
  * @return int :
@@ -1859,10 +4135,11 @@ void reset_kernel_semeru_rdma_ops(void)
 int init_rdma_sessions(struct rdma_session_context **rdma_session_global_ptr_addr)
 {
 	int ret = 0;
+	int i;
 	int mem_server_id;
 	struct rdma_session_context * rdma_session_ptr = *rdma_session_global_ptr_addr;
 
-	*rdma_session_global_ptr_addr = kzalloc(sizeof(struct rdma_session_context) * NUM_OF_MEMORY_SERVER, GFP_KERNEL);
+	*rdma_session_global_ptr_addr = kzalloc(sizeof(struct rdma_session_context) * fs_num_sessions(), GFP_KERNEL);
 	if (*rdma_session_global_ptr_addr == NULL) {
 		ret = -1;
 		pr_err("%s, rdma_session_global allocation failed.", __func__);
@@ -1871,14 +4148,19 @@ int init_rdma_sessions(struct rdma_session_context **rdma_session_global_ptr_add
 
 	// initialize each rdma_session_context
 	rdma_session_ptr = *rdma_session_global_ptr_addr; // get the pointer value
-	for (mem_server_id = 0; mem_server_id < NUM_OF_MEMORY_SERVER; mem_server_id++) {
-		rdma_session_ptr[mem_server_id].mem_server_id = mem_server_id;
-		rdma_session_ptr[mem_server_id].data_region_num = DATA_REGION_PER_MEM_SERVER;
-		rdma_session_ptr[mem_server_id].data_region_start_id = RDMA_META_REGION_NUM + mem_server_id * DATA_REGION_PER_MEM_SERVER;
-
-		ret = init_rdma_session(&rdma_session_ptr[mem_server_id]);
+	for (i = 0; i < fs_num_sessions(); i++) {
+		mem_server_id = i % num_mem_servers;
+		rdma_session_ptr[i].window = i / num_mem_servers;
+		rdma_session_ptr[i].mem_server_id = mem_server_id;
+		// The data chunks keep their index in the window on any memory server, see data_chunk_placement.
+		rdma_session_ptr[i].data_region_num = RDMA_DATA_REGION_NUM;
+		rdma_session_ptr[i].data_region_start_id = RDMA_META_REGION_NUM;
+		spin_lock_init(&rdma_session_ptr[i].meta_reg.lock);
+
+		ret = init_rdma_session(&rdma_session_ptr[i]);
 		if(ret){
-			pr_err("%s, memory_sever[%d], rdma_session init failed", __func__, mem_server_id);
+			pr_err("%s, window[%d] memory_sever[%d], rdma_session init failed", __func__,
+			       rdma_session_ptr[i].window, mem_server_id);
 			goto out;
 		}
 	}
@@ -1887,6 +4169,8 @@ out:
 	return ret;
 }
 
+static void semeru_reattach_fn(struct work_struct *work);
+
 /**
  * Init the rdma sessions for a memory server.
  */
@@ -1906,10 +4190,17 @@ int init_rdma_session(struct rdma_session_context *rdma_session )
 	rdma_session->rdma_queues = kzalloc(sizeof(struct semeru_rdma_queue) * online_cores, GFP_KERNEL);
 	rdma_session->send_queue_depth = RDMA_SEND_QUEUE_DEPTH + 1;
 	rdma_session->recv_queue_depth = RDMA_RECV_QUEUE_DEPTH + 1;
+	fs_credit_init(rdma_session);
+
+	// The reattach is enabled once the session is connected, rdma_sessions_connect().
+	INIT_DELAYED_WORK(&rdma_session->reattach_work, semeru_reattach_fn);
+	rdma_session->reattach_state = BIT(SEMERU_REATTACH_STOPPED);
+	rdma_session->heap_lost = false;
 
 	// 2) Setup socket information
-	// All the memory servers use the same port, 9400
-	rdma_session->port = htons((uint16_t)mem_server_port); // transffer to big endian
+	// All the memory servers use the same port, module parameter mem_server_port, 9400 by default.
+	// The memory server instance of the window slot s listens on mem_server_port + s.
+	rdma_session->port = htons((uint16_t)(mem_server_port + rdma_session->window)); // transffer to big endian
 	ret = in4_pton(ip, strlen(ip), rdma_session->addr, -1, NULL); // char* to ipv4 address
 	if (ret == 0) { // kernel 4.11.0 , success 1; failed 0.
 		printk(KERN_ERR "Assign ip %s to  rdma_session->addr : %s failed.\n", ip, rdma_session->addr);
@@ -1919,6 +4210,21 @@ int init_rdma_session(struct rdma_session_context *rdma_session )
 
 	rdma_session->addr_type = AF_INET; //ipv4
 
+	// 3) The ports of the memory server.
+	memcpy(rdma_session->path_addr[0], rdma_session->addr, sizeof(rdma_session->addr));
+	rdma_session->num_paths = 1;
+	rdma_session->failed_paths = 0;
+	ip = mem_server_path_ip[rdma_session->mem_server_id];
+	if (ip != NULL && strlen(ip) > 0) {
+		if (in4_pton(ip, strlen(ip), rdma_session->path_addr[1], -1, NULL) == 0) {
+			printk(KERN_ERR "%s, memory server[%d] wrong mem_server_path_ip %s.\n", __func__,
+			       rdma_session->mem_server_id, ip);
+			ret = -EINVAL;
+			goto err;
+		}
+		rdma_session->num_paths = SEMERU_MAX_RDMA_PATHS;
+	}
+
 err:
 	return ret;
 }
@@ -1945,17 +4251,203 @@ int setup_rdma_session_commu_buffer(struct rdma_session_context * rdma_session){
 	}
 
 
-	// 2) Control-Path
-	ret = init_rdma_control_path(rdma_session);
-	if(unlikely(ret)){
-		printk(KERN_ERR "%s, initialize 1-sided RDMA buffers error. \n",__func__);
-		goto err;
-	}
+	// 2) Control-Path
+	ret = init_rdma_control_path(rdma_session);
+	if(unlikely(ret)){
+		printk(KERN_ERR "%s, initialize 1-sided RDMA buffers error. \n",__func__);
+		goto err;
+	}
+
+err:
+	return ret;
+}
+
+/**
+ * Preallocate the requests of a rdma_queue, see struct semeru_req_pool.
+ */
+int init_semeru_req_pool(struct semeru_req_pool *pool, struct kmem_cache *cache, size_t obj_size, int depth, int node)
+{
+	int i;
+
+	obj_size = ALIGN(obj_size, L1_CACHE_BYTES);
+	pool->objs = vzalloc_node(obj_size * depth, node);
+	pool->free = vmalloc_node(sizeof(void *) * depth, node);
+	if (unlikely(pool->objs == NULL || pool->free == NULL)) {
+		free_semeru_req_pool(pool);
+		return -ENOMEM;
+	}
+
+	spin_lock_init(&pool->lock);
+	for (i = 0; i < depth; i++)
+		pool->free[i] = (char *)pool->objs + obj_size * i;
+	pool->nr_free = depth;
+	pool->depth = depth;
+	pool->obj_size = obj_size;
+	pool->cache = cache;
+	atomic_set(&pool->spills, 0);
+	return 0;
+}
+
+void free_semeru_req_pool(struct semeru_req_pool *pool)
+{
+	if (atomic_read(&pool->spills))
+		pr_info("%s, 0x%x requests spilled to the slab.\n", __func__, atomic_read(&pool->spills));
+
+	vfree(pool->free);
+	vfree(pool->objs);
+	pool->free = NULL;
+	pool->objs = NULL;
+	pool->nr_free = 0;
+}
+
+/**
+ * Get a request, never sleep.
+ * Return NULL only if the pool is empty and the slab fails too.
+ */
+void *semeru_req_pool_get(struct semeru_req_pool *pool)
+{
+	unsigned long flags;
+	void *obj = NULL;
+
+	spin_lock_irqsave(&pool->lock, flags);
+	if (likely(pool->nr_free > 0))
+		obj = pool->free[--pool->nr_free];
+	spin_unlock_irqrestore(&pool->lock, flags);
+
+	if (unlikely(obj == NULL)) {
+		atomic_inc(&pool->spills);
+		obj = kmem_cache_alloc(pool->cache, GFP_ATOMIC | __GFP_NOWARN);
+	}
+	return obj;
+}
+
+void semeru_req_pool_put(struct semeru_req_pool *pool, void *obj)
+{
+	unsigned long flags;
+
+	if (unlikely((char *)obj < (char *)pool->objs ||
+		     (char *)obj >= (char *)pool->objs + pool->obj_size * pool->depth)) {
+		kmem_cache_free(pool->cache, obj);
+		return;
+	}
+
+	spin_lock_irqsave(&pool->lock, flags);
+	pool->free[pool->nr_free++] = obj;
+	spin_unlock_irqrestore(&pool->lock, flags);
+}
+
+#ifdef SEMERU_FS_DMA_BOUNCE
+
+/**
+ * Allocate and map the bounce pages of the rdma_queue, on the node of its core.
+ * Mapped once for both directions, the data path only syncs them.
+ */
+int init_fs_dma_bounce_pool(struct semeru_rdma_queue *rdma_queue, struct ib_device *ibdev)
+{
+	struct fs_dma_bounce_pool *pool = &rdma_queue->bounce_pool;
+	int node = cpu_to_node(rdma_queue->q_index);
+	struct fs_dma_bounce *bounce;
+	int i;
+
+	if (dma_bounce_pages == 0 || pool->bounces != NULL)
+		return 0;
+
+	spin_lock_init(&pool->lock);
+	atomic_set(&pool->misses, 0);
+	pool->bounces = vzalloc_node(sizeof(struct fs_dma_bounce) * dma_bounce_pages, node);
+	pool->free = vmalloc_node(sizeof(struct fs_dma_bounce *) * dma_bounce_pages, node);
+	if (unlikely(pool->bounces == NULL || pool->free == NULL))
+		goto err;
+
+	pool->depth = dma_bounce_pages;
+	for (i = 0; i < pool->depth; i++) {
+		bounce = &pool->bounces[i];
+		bounce->page = alloc_pages_node(node, GFP_KERNEL, 0);
+		if (unlikely(bounce->page == NULL))
+			goto err;
+
+		bounce->dma_addr = ib_dma_map_page(ibdev, bounce->page, 0, PAGE_SIZE, DMA_BIDIRECTIONAL);
+		if (unlikely(ib_dma_mapping_error(ibdev, bounce->dma_addr))) {
+			__free_page(bounce->page);
+			bounce->page = NULL;
+			goto err;
+		}
+		pool->free[pool->nr_free++] = bounce;
+	}
+
+	return 0;
+
+err:
+	printk(KERN_ERR "%s, map the bounce pages of rdma_queue[%d] failed.\n", __func__, rdma_queue->q_index);
+	free_fs_dma_bounce_pool(rdma_queue);
+	return -ENOMEM;
+}
+
+/**
+ * No request is in flight, the CQ is gone.
+ */
+void free_fs_dma_bounce_pool(struct semeru_rdma_queue *rdma_queue)
+{
+	struct fs_dma_bounce_pool *pool = &rdma_queue->bounce_pool;
+	struct ib_device *ibdev = rdma_queue->rdma_session->rdma_dev->dev;
+	int i;
+
+	if (pool->bounces == NULL)
+		return;
+
+	if (atomic_read(&pool->misses))
+		pr_info("%s, rdma_queue[%d] 0x%x pages mapped, the bounce pages were used up.\n", __func__,
+			rdma_queue->q_index, atomic_read(&pool->misses));
+
+	for (i = 0; i < pool->depth; i++) {
+		if (pool->bounces[i].page == NULL)
+			continue;
+		ib_dma_unmap_page(ibdev, pool->bounces[i].dma_addr, PAGE_SIZE, DMA_BIDIRECTIONAL);
+		__free_page(pool->bounces[i].page);
+	}
+
+	vfree(pool->free);
+	vfree(pool->bounces);
+	pool->free = NULL;
+	pool->bounces = NULL;
+	pool->nr_free = 0;
+	pool->depth = 0;
+}
+
+/**
+ * Never sleep. NULL if the pool is off or empty, map the swapped page instead.
+ */
+struct fs_dma_bounce *fs_dma_bounce_get(struct semeru_rdma_queue *rdma_queue)
+{
+	struct fs_dma_bounce_pool *pool = &rdma_queue->bounce_pool;
+	struct fs_dma_bounce *bounce = NULL;
+	unsigned long flags;
+
+	if (pool->depth == 0)
+		return NULL;
+
+	spin_lock_irqsave(&pool->lock, flags);
+	if (likely(pool->nr_free > 0))
+		bounce = pool->free[--pool->nr_free];
+	spin_unlock_irqrestore(&pool->lock, flags);
 
-err:
-	return ret;
+	if (unlikely(bounce == NULL))
+		atomic_inc(&pool->misses);
+	return bounce;
+}
+
+void fs_dma_bounce_put(struct semeru_rdma_queue *rdma_queue, struct fs_dma_bounce *bounce)
+{
+	struct fs_dma_bounce_pool *pool = &rdma_queue->bounce_pool;
+	unsigned long flags;
+
+	spin_lock_irqsave(&pool->lock, flags);
+	pool->free[pool->nr_free++] = bounce;
+	spin_unlock_irqrestore(&pool->lock, flags);
 }
 
+#endif // SEMERU_FS_DMA_BOUNCE
+
 /**
  * Build and Connect all the QP for each Session/memory server.
  *  
@@ -1967,6 +4459,9 @@ int semeru_init_rdma_queue(struct rdma_session_context *rdma_session, int cpu)
 
 	rdma_queue->rdma_session = rdma_session;
 	rdma_queue->q_index = cpu;
+	rdma_queue->path = cpu % rdma_session->num_paths; // MEM_SERVER_NOTIFY_QUEUE is on path 0.
+	if (test_bit(rdma_queue->path, &rdma_session->failed_paths))
+		rdma_queue->path = 0;
 	rdma_queue->cm_id = rdma_create_id(&init_net, semeru_rdma_cm_event_handler, rdma_queue, RDMA_PS_TCP, IB_QPT_RC);
 	if (IS_ERR(rdma_queue->cm_id)) {
 		printk(KERN_ERR "failed to create cm id: %ld\n", PTR_ERR(rdma_queue->cm_id));
@@ -1978,6 +4473,10 @@ int semeru_init_rdma_queue(struct rdma_session_context *rdma_session, int cpu)
 	init_waitqueue_head(&rdma_queue->sem); // Initialize the semaphore.
 	spin_lock_init(&(rdma_queue->cq_lock)); // initialize spin lock
 	atomic_set(&(rdma_queue->rdma_post_counter), 0); // Initialize the counter to 0
+#ifdef SEMERU_ADAPTIVE_POLLING
+	init_rdma_queue_polling(rdma_queue);
+#endif
+	// The slab allocates from the node of the calling core, and each queue is mostly used by its own core.
 	rdma_queue->fs_rdma_req_cache = kmem_cache_create("fs_rdma_req_cache", sizeof(struct fs_rdma_req), 0,
 							  SLAB_TEMPORARY | SLAB_HWCACHE_ALIGN, NULL);
 	if (unlikely(rdma_queue->fs_rdma_req_cache == NULL)) {
@@ -1994,8 +4493,36 @@ int semeru_init_rdma_queue(struct rdma_session_context *rdma_session, int cpu)
 		goto err;
 	}
 
+	rdma_queue->wr_group_cache = kmem_cache_create("wr_group_cache", sizeof(struct semeru_wr_group), 0,
+						       SLAB_TEMPORARY | SLAB_HWCACHE_ALIGN, NULL);
+	if (unlikely(rdma_queue->wr_group_cache == NULL)) {
+		printk(KERN_ERR "%s, allocate rdma_queue->wr_group_cache failed.\n", __func__);
+		ret = -1;
+		goto err;
+	}
+
+	ret = init_semeru_req_pool(&rdma_queue->fs_req_pool, rdma_queue->fs_rdma_req_cache, sizeof(struct fs_rdma_req),
+				   FS_REQ_POOL_DEPTH, cpu_to_node(cpu));
+	if (likely(ret == 0))
+		ret = init_semeru_req_pool(&rdma_queue->cp_req_pool, rdma_queue->rdma_req_sg_cache,
+					   sizeof(struct semeru_rdma_req_sg), CP_REQ_POOL_DEPTH, cpu_to_node(cpu));
+	if (unlikely(ret)) {
+		printk(KERN_ERR "%s, preallocate the requests of rdma_queue[%d] failed.\n", __func__, cpu);
+		goto err;
+	}
+
+#ifdef SEMERU_FS_ASYNC_STORE
+	ret = init_fs_store_ring(rdma_queue);
+	if (unlikely(ret)) {
+		printk(KERN_ERR "%s, allocate rdma_queue->store_ring failed.\n", __func__);
+		goto err;
+	}
+#endif
+
 	//2) Resolve address(ip:port) and route to destination IB.
 	ret = rdma_resolve_ip_to_ib_device(rdma_session, rdma_queue);
+	if (unlikely(ret) && rdma_queue->path != 0)
+		ret = rdma_resolve_first_path(rdma_session, rdma_queue);
 	if (unlikely(ret)) {
 		printk(KERN_ERR "%s, bind socket error (addr or route resolve error)\n", __func__);
 		return ret;
@@ -2010,7 +4537,67 @@ err:
 
 
 /**
- * @brief Connect to each memory servers
+ * The bring-up of a memory server, or of one QP of a session, on system_unbound_wq.
+ * Each step waits for its own RDMA CM round trips, so they overlap.
+ */
+struct semeru_connect_work {
+	struct work_struct work;
+	struct rdma_session_context *rdma_session;
+	int index; // the rdma_queue, unused for a session.
+	int ret;
+};
+
+/**
+ * Build and connect one QP of the session.
+ */
+static int semeru_bring_up_rdma_queue(struct rdma_session_context *rdma_session, int cpu)
+{
+	int ret;
+
+	// crete cm_id and other fields e.g. ip
+	ret = semeru_init_rdma_queue(rdma_session, cpu);
+	if (unlikely(ret)) {
+		printk(KERN_ERR "%s,init rdma queue [%d] failed.\n", __func__, cpu);
+		return ret;
+	}
+
+	// Create device PD, QP CP
+	ret = semeru_create_rdma_queue(rdma_session, cpu);
+	if (unlikely(ret)) {
+		printk(KERN_ERR "%s, Create rdma queue [%d] failed. \n", __func__, cpu);
+		return ret;
+	}
+
+	// Connect to memory server
+	ret = semeru_connect_remote_memory_server(rdma_session, cpu);
+	if (ret) {
+		printk(KERN_ERR "%s: Connect rdma queue [%d] to remote server error \n", __func__, cpu);
+		return ret;
+	}
+
+	pr_warn("%s, RDMA queue[%d] Connectted to remote server[%d] successfully \n", 
+		__func__, cpu, rdma_session->mem_server_id);
+	return 0;
+}
+
+static void semeru_rdma_queue_connect_fn(struct work_struct *work)
+{
+	struct semeru_connect_work *connect_work = container_of(work, struct semeru_connect_work, work);
+
+	connect_work->ret = semeru_bring_up_rdma_queue(connect_work->rdma_session, connect_work->index);
+}
+
+static void semeru_session_connect_fn(struct work_struct *work)
+{
+	struct semeru_connect_work *connect_work = container_of(work, struct semeru_connect_work, work);
+
+	connect_work->ret = rdma_session_connect(connect_work->rdma_session);
+}
+
+/**
+ * @brief Connect to each memory servers, for each served address window
+ *  All the memory servers are connected in parallel, one work per session.
+ *  A session queries and binds its chunks while the others are still connecting.
  * 
  * @param rdma_session_global_ptr 
  * @return int , 0 for success. non-zero for errors
@@ -2018,27 +4605,46 @@ err:
 int rdma_sessions_connect(struct rdma_session_context *rdma_session_global_ptr)
 {
 	int ret = 0;
-	int mem_server_id, queue_index;
+	int i, queue_index;
 	struct rdma_session_context * rdma_session_ptr;
+	struct semeru_connect_work *works;
 
-	for(mem_server_id = 0; mem_server_id < NUM_OF_MEMORY_SERVER; mem_server_id++){
-		rdma_session_ptr = &rdma_session_global_ptr[mem_server_id];
-		ret = rdma_session_connect(rdma_session_ptr);
-		if(unlikely(ret)){
-			pr_err("%s, conenct to memory sever[%d] failed.", __func__, mem_server_id);
-			// disconenct the alrady connected resource.
-			for(queue_index = 0; queue_index < online_cores; queue_index++){
-				 // Assuming this mem server is crashed.
-				rdma_session_ptr->rdma_queues[queue_index].freed = 255;
-			}
+	works = kcalloc(fs_num_sessions(), sizeof(struct semeru_connect_work), GFP_KERNEL);
+	if (unlikely(works == NULL)) {
+		pr_err("%s, allocate the connect works failed.", __func__);
+		return -ENOMEM;
+	}
 
-			// disconenct the connection to other memory servers.
-			semeru_disconnect_mem_servers(rdma_session_global_ptr); // disconnect all mem servers.
-			goto out;
+	for(i = 0; i < fs_num_sessions(); i++){
+		works[i].rdma_session = &rdma_session_global_ptr[i];
+		INIT_WORK(&works[i].work, semeru_session_connect_fn);
+		queue_work(system_unbound_wq, &works[i].work);
+	}
+
+	for(i = 0; i < fs_num_sessions(); i++){
+		flush_work(&works[i].work);
+		if(likely(works[i].ret == 0))
+			continue;
+
+		pr_err("%s, conenct to window[%d] memory sever[%d] failed.", __func__, rdma_session_global_ptr[i].window,
+		       rdma_session_global_ptr[i].mem_server_id);
+		ret = works[i].ret;
+		rdma_session_ptr = &rdma_session_global_ptr[i];
+		for(queue_index = 0; queue_index < online_cores; queue_index++){
+			 // Assuming this mem server is crashed.
+			rdma_session_ptr->rdma_queues[queue_index].freed = 255;
 		}
 	}
 
-out:
+	// disconenct the connection to other memory servers.
+	if(unlikely(ret)){
+		semeru_disconnect_mem_servers(rdma_session_global_ptr); // disconnect all mem servers.
+	}else{
+		for(i = 0; i < fs_num_sessions(); i++)
+			clear_bit(SEMERU_REATTACH_STOPPED, &rdma_session_global_ptr[i].reattach_state);
+	}
+
+	kfree(works);
 	return ret;
 }
 
@@ -2049,39 +4655,48 @@ out:
  * 		rdma_session, RDMA controller/context.
  * 			
  * More Exlanation:
+ * 	The QPs are connected in parallel, each has its own cm_id and CQ.
+ * 	The first one is connected alone, it allocates the PD and the 2-sided buffers shared by the others.
+ * 	The memory server sends the same AVAILABLE_TO_QUERY to each QP, all into the session's recv buffer.
+ * 	So the query has to wait until all the QPs are connected.
  * 
  */
 int rdma_session_connect(struct rdma_session_context *rdma_session)
 {
 	int ret;
 	int i;
+	struct semeru_connect_work *works;
 
 	// 1) Build and connect all the QPs of this session
 	//
-	for (i = 0; i < online_cores; i++) {
-		// crete cm_id and other fields e.g. ip
-		ret = semeru_init_rdma_queue(rdma_session, i);
-		if (unlikely(ret)) {
-			printk(KERN_ERR "%s,init rdma queue [%d] failed.\n", __func__, i);
-		}
+	ret = semeru_bring_up_rdma_queue(rdma_session, 0);
+	if (unlikely(ret))
+		goto err;
 
-		// Create device PD, QP CP
-		ret = semeru_create_rdma_queue(rdma_session, i);
-		if (unlikely(ret)) {
-			printk(KERN_ERR "%s, Create rdma queues failed. \n", __func__);
-		}
+	works = kcalloc(online_cores, sizeof(struct semeru_connect_work), GFP_KERNEL);
+	if (unlikely(works == NULL)) {
+		ret = -ENOMEM;
+		goto err;
+	}
 
-		// Connect to memory server
-		ret = semeru_connect_remote_memory_server(rdma_session, i);
-		if (ret) {
-			printk(KERN_ERR "%s: Connect to remote server error \n", __func__);
-			goto err;
-		}
+	for (i = 1; i < online_cores; i++) {
+		works[i].rdma_session = rdma_session;
+		works[i].index = i;
+		INIT_WORK(&works[i].work, semeru_rdma_queue_connect_fn);
+		queue_work(system_unbound_wq, &works[i].work);
+	}
 
-		pr_warn("%s, RDMA queue[%d] Connectted to remote server[%d] successfully \n", 
-			__func__, i, rdma_session->mem_server_id);
+	for (i = 1; i < online_cores; i++) {
+		flush_work(&works[i].work);
+		if (unlikely(works[i].ret) && ret == 0)
+			ret = works[i].ret;
 	}
+	kfree(works);
+	if (unlikely(ret))
+		goto err;
 
+	pr_warn("%s, All %d RDMA queues connectted to remote server[%d] \n", __func__, online_cores,
+		rdma_session->mem_server_id);
 	//
 	// 2) Get the memory pool from memory server.
 	//
@@ -2103,6 +4718,20 @@ int rdma_session_connect(struct rdma_session_context *rdma_session)
 		goto err;
 	}
 
+	// 2.3 Receive the state notifications of the memory server, and ring it by doorbells.
+	//     The JVM falls back to reading the flags if it fails.
+	init_cp_doorbell(rdma_session);
+	if (unlikely(init_mem_server_notify(rdma_session))) {
+		printk(KERN_WARNING "%s, memory server[%d] state notification is disabled.\n", __func__,
+		       rdma_session->mem_server_id);
+	}
+
+	// 2.4 The remote atomics on the meta space. The JVM falls back to the flags handshake without them.
+	if (unlikely(init_cp_atomic(rdma_session))) {
+		printk(KERN_WARNING "%s, memory server[%d] remote atomics are disabled.\n", __func__,
+		       rdma_session->mem_server_id);
+	}
+
 	// FINISHED.
 
 	// [!!] Only reach here afeter got STOP_ACK signal from remote memory server.
@@ -2126,6 +4755,243 @@ err:
 	return ret;
 }
 
+/**
+ * Reattach a restarted memory server.
+ *
+ * The memory server JVM keeps its data Regions in a file on hugetlbfs or DAX, -XX:SemeruMemPoolFile.
+ * After a crash or restart, it maps the file again at the same address and registers the same chunks.
+ * So the swapped out pages are still there, only the QPs and the rkeys are new.
+ *
+ * 1) The DISCONNECTED event of a crashed memory server schedules the reattach, the data path already skips its queues.
+ * 2) The old QPs and cm_ids are destroyed. The PD, the CQs and the registered buffers of the session are kept.
+ * 3) All the QPs are connected again in parallel. Retried every SEMERU_REATTACH_DELAY_MS until the memory server is up.
+ * 4) REATTACH, the memory server responds FREE_SIZE with the kept data Regions, or DONE if it started cold.
+ * 5) The chunks are requested and bound again, the ones mapped by the JVM's heap are expanded again.
+ *
+ * A memory server that lost its data Regions is never reattached, the swapped out pages are gone.
+ * The meta Region is rebuilt by the memory server, the JVM writes its flags and CSet again in the next cycle.
+ */
+void semeru_schedule_reattach(struct rdma_session_context *rdma_session)
+{
+	if (test_bit(SEMERU_REATTACH_STOPPED, &rdma_session->reattach_state) || rdma_session->heap_lost)
+		return;
+	if (test_and_set_bit(SEMERU_REATTACH_PENDING, &rdma_session->reattach_state))
+		return;
+
+	pr_warn("%s, memory server[%d] is lost, reattach it in %dms.\n", __func__, rdma_session->mem_server_id,
+		SEMERU_REATTACH_DELAY_MS);
+	schedule_delayed_work(&rdma_session->reattach_work, msecs_to_jiffies(SEMERU_REATTACH_DELAY_MS));
+}
+
+static void semeru_stop_reattach(struct rdma_session_context *rdma_session_global_ptr)
+{
+	int i;
+
+	for (i = 0; i < fs_num_sessions(); i++) {
+		set_bit(SEMERU_REATTACH_STOPPED, &rdma_session_global_ptr[i].reattach_state);
+		cancel_delayed_work_sync(&rdma_session_global_ptr[i].reattach_work);
+	}
+}
+
+/**
+ * Destroy the QPs and cm_ids of the session, keep the CQs.
+ * The flushed wr are reaped first, their wr_cqe may still be referred by the CQ.
+ */
+static void semeru_retire_rdma_queues(struct rdma_session_context *rdma_session)
+{
+	int i;
+	unsigned long flags;
+	unsigned long deadline;
+	struct semeru_rdma_queue *rdma_queue;
+
+	// 1) No new wr. The data path checks rdma_queue_alive() with preemption disabled.
+	rdma_session->notify.enabled = false;
+	for (i = 0; i < online_cores; i++)
+		WRITE_ONCE(rdma_session->rdma_queues[i].freed, 255);
+	synchronize_sched();
+
+	for (i = 0; i < online_cores; i++) {
+		rdma_queue = &(rdma_session->rdma_queues[i]);
+
+		// 2) A failed 2-sided wr isn't counted down, don't wait for it forever.
+		deadline = jiffies + msecs_to_jiffies(SEMERU_REATTACH_DRAIN_MS);
+		while (atomic_read(&rdma_queue->rdma_post_counter) > 0 && time_before(jiffies, deadline)) {
+			spin_lock_irqsave(&rdma_queue->cq_lock, flags);
+			ib_process_cq_direct(rdma_queue->cq, 16);
+			spin_unlock_irqrestore(&rdma_queue->cq_lock, flags);
+			cpu_relax();
+		}
+		atomic_set(&rdma_queue->rdma_post_counter, 0);
+
+		// 3) A failed reconnection may leave no QP, or an error cm_id.
+		if (!IS_ERR_OR_NULL(rdma_queue->cm_id)) {
+			if (rdma_queue->qp != NULL)
+				rdma_destroy_qp(rdma_queue->cm_id);
+			rdma_destroy_id(rdma_queue->cm_id);
+		}
+		rdma_queue->cm_id = NULL;
+		rdma_queue->qp = NULL;
+	}
+}
+
+/**
+ * Connect one QP of the session again, with the kept CQ and PD.
+ */
+static int semeru_reconnect_rdma_queue(struct rdma_session_context *rdma_session, int cpu)
+{
+	int ret;
+	struct semeru_rdma_queue *rdma_queue = &(rdma_session->rdma_queues[cpu]);
+
+	rdma_queue->path = cpu % rdma_session->num_paths;
+	if (test_bit(rdma_queue->path, &rdma_session->failed_paths))
+		rdma_queue->path = 0;
+	rdma_queue->state = IDLE;
+	rdma_queue->cm_id = rdma_create_id(&init_net, semeru_rdma_cm_event_handler, rdma_queue, RDMA_PS_TCP, IB_QPT_RC);
+	if (IS_ERR(rdma_queue->cm_id)) {
+		printk(KERN_ERR "%s, failed to create cm id: %ld\n", __func__, PTR_ERR(rdma_queue->cm_id));
+		rdma_queue->cm_id = NULL;
+		return -ENODEV;
+	}
+
+	// The PD is kept, the QP has to be on the same HCA.
+	ret = rdma_resolve_ip_to_ib_device(rdma_session, rdma_queue);
+	if (unlikely(ret) && rdma_queue->path != 0)
+		ret = rdma_resolve_first_path(rdma_session, rdma_queue);
+	if (unlikely(ret))
+		return ret;
+
+	ret = semeru_create_qp(rdma_session, rdma_queue);
+	if (unlikely(ret))
+		return ret;
+
+	return semeru_connect_remote_memory_server(rdma_session, cpu);
+}
+
+static void semeru_rdma_queue_reconnect_fn(struct work_struct *work)
+{
+	struct semeru_connect_work *connect_work = container_of(work, struct semeru_connect_work, work);
+
+	connect_work->ret = semeru_reconnect_rdma_queue(connect_work->rdma_session, connect_work->index);
+}
+
+/**
+ * Ask the restarted memory server for its data Regions.
+ * The FREE_SIZE or DONE response is received by the drain, see handle_recv_wr().
+ *
+ * return :
+ * 	0 if the data Regions are kept, -ENODATA if they are lost.
+ */
+static int semeru_reattach_remote_memory(struct rdma_session_context *rdma_session)
+{
+	int ret;
+	struct semeru_rdma_queue *rdma_queue = &(rdma_session->rdma_queues[0]);
+
+	ret = send_message_to_remote(rdma_session, 0, REATTACH, 0);
+	if (unlikely(ret)) {
+		printk(KERN_ERR "%s, Post 2-sided message to remote server[%d] failed.\n", __func__,
+		       rdma_session->mem_server_id);
+		return ret;
+	}
+	drain_rdma_queue(rdma_queue);
+
+	if (rdma_queue->state != FREE_MEM_RECV || rdma_session->heap_lost) {
+		pr_err("%s, memory server[%d] restarted without its data Regions, the swapped out pages are lost.\n",
+		       __func__, rdma_session->mem_server_id);
+		rdma_session->heap_lost = true;
+		return -ENODATA;
+	}
+	return 0;
+}
+
+static int semeru_reattach_mem_server(struct rdma_session_context *rdma_session)
+{
+	int ret = 0;
+	int i;
+	struct semeru_connect_work *works;
+	struct remote_mapping_chunk_list *chunk_list = &rdma_session->remote_chunk_list;
+	DECLARE_BITMAP(mapped, MAX_REGION_NUM);
+
+	// 1) Tear down the broken connection.
+	semeru_retire_rdma_queues(rdma_session);
+
+	// 2) Connect all the QPs again, the memory server sends AVAILABLE_TO_QUERY to each of them.
+	works = kcalloc(online_cores, sizeof(struct semeru_connect_work), GFP_KERNEL);
+	if (unlikely(works == NULL))
+		return -ENOMEM;
+
+	for (i = 0; i < online_cores; i++) {
+		works[i].rdma_session = rdma_session;
+		works[i].index = i;
+		INIT_WORK(&works[i].work, semeru_rdma_queue_reconnect_fn);
+		queue_work(system_unbound_wq, &works[i].work);
+	}
+
+	for (i = 0; i < online_cores; i++) {
+		flush_work(&works[i].work);
+		if (unlikely(works[i].ret) && ret == 0)
+			ret = works[i].ret;
+	}
+	kfree(works);
+	if (unlikely(ret))
+		return ret;
+
+	// 3) Are the swapped out pages still there.
+	ret = semeru_reattach_remote_memory(rdma_session);
+	if (unlikely(ret))
+		return ret;
+
+	// 4) Bind the chunks with the new rkeys, and expand the ones of the JVM's heap again.
+	bitmap_zero(mapped, MAX_REGION_NUM);
+	for (i = 0; i < chunk_list->chunk_num; i++) {
+		if (chunk_list->remote_chunk[i].chunk_state == MAPPED)
+			set_bit(i, mapped);
+		chunk_list->remote_chunk[i].chunk_state = EMPTY;
+	}
+	chunk_list->chunk_ptr = 0;
+	chunk_list->remote_free_size = 0;
+
+	ret = semeru_requset_for_chunk(rdma_session, chunk_list->chunk_num);
+	if (unlikely(ret))
+		return ret;
+
+	if (unlikely(post_mem_server_notify(rdma_session))) {
+		printk(KERN_WARNING "%s, memory server[%d] state notification is disabled.\n", __func__,
+		       rdma_session->mem_server_id);
+	}
+
+	for (i = 0; i < chunk_list->chunk_num; i++) {
+		if (test_bit(i, mapped) && chunk_list->remote_chunk[i].chunk_state != MAPPED &&
+		    cp_resize_chunks_of_server(rdma_session, i, i + 1, 1)) {
+			pr_err("%s, memory server[%d] chunk[%d] can't be expanded again.\n", __func__,
+			       rdma_session->mem_server_id, i);
+			return -EAGAIN;
+		}
+	}
+
+	// 5) Back to the data path.
+	for (i = 0; i < online_cores; i++)
+		WRITE_ONCE(rdma_session->rdma_queues[i].freed, 0);
+
+	pr_warn("%s, memory server[%d] is reattached, %u chunks.\n", __func__, rdma_session->mem_server_id,
+		chunk_list->chunk_ptr);
+	return 0;
+}
+
+static void semeru_reattach_fn(struct work_struct *work)
+{
+	struct rdma_session_context *rdma_session =
+		container_of(to_delayed_work(work), struct rdma_session_context, reattach_work);
+
+	if (semeru_reattach_mem_server(rdma_session) == 0 || rdma_session->heap_lost ||
+	    test_bit(SEMERU_REATTACH_STOPPED, &rdma_session->reattach_state)) {
+		clear_bit(SEMERU_REATTACH_PENDING, &rdma_session->reattach_state);
+		return;
+	}
+
+	schedule_delayed_work(&rdma_session->reattach_work, msecs_to_jiffies(SEMERU_REATTACH_DELAY_MS));
+}
+
+
 /**
  * >>>>>>>>>>>>>>> Start of Resource Free Functions >>>>>>>>>>>>>>>
  * 
@@ -2187,11 +5053,27 @@ void semeru_free_rdma_structure(struct rdma_session_context *rdma_session){
 	if (rdma_session == NULL)
 		return;
 
+	// Unpin the registered meta space before the device is gone.
+	cp_meta_reg_release(rdma_session);
+	cp_atomic_release(rdma_session);
+
+	// The notification recv wr are flushed with the QP.
+	rdma_session->notify.enabled = false;
+
 	// Free each QP
 	for(i=0; i<online_cores; i++){
 
 		rdma_queue = &(rdma_session->rdma_queues[i]);
 
+#ifdef SEMERU_FS_ASYNC_STORE
+		// Stop the deferred flush before the QP is gone.
+		free_fs_store_ring(rdma_queue);
+#endif
+
+#ifdef SEMERU_ADAPTIVE_POLLING
+		print_rdma_queue_polling_stats(rdma_queue);
+#endif
+
 		if(rdma_queue->cm_id != NULL){
 			rdma_destroy_id(rdma_queue->cm_id);
 
@@ -2219,6 +5101,13 @@ void semeru_free_rdma_structure(struct rdma_session_context *rdma_session){
 			#endif
 		}
 
+		// No request is in flight after the QP and CQ are gone.
+		free_semeru_req_pool(&rdma_queue->fs_req_pool);
+		free_semeru_req_pool(&rdma_queue->cp_req_pool);
+#ifdef SEMERU_FS_DMA_BOUNCE
+		free_fs_dma_bounce_pool(rdma_queue);
+#endif
+
 	}// end of free RDMA QP
 
 	// Before invoke this function, free all the resource binded to pd.
@@ -2248,19 +5137,20 @@ void semeru_free_rdma_structure(struct rdma_session_context *rdma_session){
 int semeru_disconnect_mem_servers(struct rdma_session_context *rdma_session_global)
 {
 	int ret = 0;
-	int mem_server_id;
+	int i;
 	struct rdma_session_context *rdma_session_ptr;
 
-	for(mem_server_id = 0; mem_server_id < NUM_OF_MEMORY_SERVER; mem_server_id++){
-		rdma_session_ptr = &rdma_session_global[mem_server_id];
+	for(i = 0; i < fs_num_sessions(); i++){
+		rdma_session_ptr = &rdma_session_global[i];
 		ret = semeru_disconenct_and_collect_resource(rdma_session_ptr);
 		if(unlikely(ret)){
-			pr_err("%s, errors happened in disconnecting to memory server[%d]",
-				__func__, mem_server_id);
+			pr_err("%s, errors happened in disconnecting to window[%d] memory server[%d]",
+				__func__, rdma_session_ptr->window, rdma_session_ptr->mem_server_id);
 			goto out;
 		}
 
-		pr_warn("%s, RDMA connection to memory server[%d] disconnectted.", __func__, mem_server_id);
+		pr_warn("%s, RDMA connection to window[%d] memory server[%d] disconnectted.", __func__,
+			rdma_session_ptr->window, rdma_session_ptr->mem_server_id);
 	}
 
 
@@ -2377,7 +5267,24 @@ int  semeru_fs_rdma_client_init(void){
 	int ret = 0;
 	printk(KERN_INFO "%s, start \n",__func__);
 
+#ifdef SEMERU_FS_LATENCY_HIST
+	ret = init_fs_lat_hist();
+	if (unlikely(ret))
+		goto out;
+#endif
+
+#ifdef SEMERU_FS_EMULATE
+	init_fs_emulate();
+#endif
+
+#ifdef SEMERU_FS_TRACE
+	ret = init_fs_trace();
+	if (unlikely(ret))
+		goto out;
+#endif
+
 	// Initialize the RDMA control path, provided by the RDMA driver.
+	init_cp_rdma_tickets();
 	init_kernel_semeru_rdma_ops();
 
 	// online cores decide the parallelism. e.g. number of QP, CP etc.
@@ -2395,6 +5302,13 @@ int  semeru_fs_rdma_client_init(void){
 		goto out;
 	}
 
+#ifdef SEMERU_CQ_POLLER
+	// The CQs are allocated, poll them before the first swap out.
+	ret = init_fs_cq_poller();
+	if (unlikely(ret))
+		goto out;
+#endif
+
 
 	// Enable the frontswap path
 	ret = semeru_init_frontswap();
@@ -2403,6 +5317,24 @@ int  semeru_fs_rdma_client_init(void){
 		goto out;
 	}
 
+#ifdef SEMERU_FS_BENCH
+	ret = init_fs_bench();
+	if (unlikely(ret))
+		goto out;
+#endif
+
+#ifdef SEMERU_CHUNK_MIGRATION
+	ret = init_fs_migrate();
+	if (unlikely(ret))
+		goto out;
+#endif
+
+#ifdef SEMERU_FS_LOCAL_TIER
+	ret = init_fs_local();
+	if (unlikely(ret))
+		goto out;
+#endif
+
 
 #ifdef RDMA_MESSAGE_PROFILING
 	reset_rdma_message_info();
@@ -2417,11 +5349,35 @@ out:
 void  semeru_fs_rdma_client_exit(void){
   
 	int ret = 0;
+
+#ifdef SEMERU_FS_BENCH
+	// 0) stop the running benchmark, before its memory servers are gone.
+	exit_fs_bench();
+#endif
+
+#ifdef SEMERU_FS_LOCAL_TIER
+	// stop writing the local pages back, before the memory servers are gone.
+	exit_fs_local();
+#endif
+
+#ifdef SEMERU_CHUNK_MIGRATION
+	// give up the data chunk moves, their copies read and write the memory servers.
+	exit_fs_migrate();
+#endif
 	
 	// 1) rest control path
 	reset_kernel_semeru_rdma_ops();
+	fs_replica_exit();
+	cp_meta_reg_exit();
+	fs_fence_exit();
 
-	// 2) disconect rdma connction
+#ifdef SEMERU_CQ_POLLER
+	// the waiters poll their own CQs, before the CQs are gone.
+	exit_fs_cq_poller();
+#endif
+
+	// 2) disconect rdma connction, no reattach from now on.
+	semeru_stop_reattach(rdma_session_global_ptr);
 	ret = semeru_disconnect_mem_servers(rdma_session_global_ptr);
 	if(unlikely(ret)){
 		printk(KERN_ERR "%s,  failed.\n",  __func__);
@@ -2431,6 +5387,14 @@ void  semeru_fs_rdma_client_exit(void){
 	// 3) disconnect fontswap path
 	semeru_exit_frontswap();
 
+#ifdef SEMERU_FS_TRACE
+	free_fs_trace();
+#endif
+
+#ifdef SEMERU_FS_LATENCY_HIST
+	free_fs_lat_hist();
+#endif
+
 	printk(KERN_INFO "%s done.\n",__func__);
 
 	return;
@@ -2648,6 +5612,30 @@ char* rdma_message_print(int message_id){
 			strcpy(message_type_name, "AVAILABLE_TO_QUERY");
 			break;
 
+		case 12:
+			strcpy(message_type_name, "EXPAND_CHUNKS");
+			break;
+
+		case 13:
+			strcpy(message_type_name, "RELEASE_CHUNKS");
+			break;
+
+		case 14:
+			strcpy(message_type_name, "REATTACH");
+			break;
+
+		case 15:
+			strcpy(message_type_name, "INVALIDATE_PAGES");
+			break;
+
+		case 16:
+			strcpy(message_type_name, "COLD_BLOCKS");
+			break;
+
+		case 17:
+			strcpy(message_type_name, "FETCH_BLOCK");
+			break;
+
 		default:
 			strcpy(message_type_name, "ERROR Message Type");
 			break;
@@ -0,0 +1,272 @@
+/**
+ * Latency histograms of the swap and control paths.
+ *
+ * Each core counts its own samples into its own log2 buckets, by this_cpu_inc(). No lock, no shared cache line.
+ * The histograms are per operation type and per memory server, see enum fs_lat_type.
+ *
+ * The readers sum up the buckets of all the cores, in debugfs :
+ * 	/sys/kernel/debug/semeru/latency		the current interval, since the last rotation
+ * 	/sys/kernel/debug/semeru/latency_last		the last closed interval
+ * 	/sys/kernel/debug/semeru/latency_rotate		write anything to close the current interval
+ *
+ * The percentiles are the upper bounds of their buckets, so they are over-estimated by 2x at most.
+ * A sample counted during the summing may land in either interval, the cores are not stopped.
+ */
+
+#include "frontswap_path.h"
+#include "semeru_cpu.h"
+
+#include <linux/percpu.h>
+#include <linux/seq_file.h>
+
+#ifdef SEMERU_FS_LATENCY_HIST
+
+//
+// ###################### Global variables ######################
+//
+
+struct fs_lat_hist __percpu *fs_lat_hist = NULL;
+
+// Sums of all the cores, only touched under fs_lat_rotate_lock.
+static struct fs_lat_hist *fs_lat_base = NULL; // the sum at the last rotation
+static struct fs_lat_hist *fs_lat_last = NULL; // the last closed interval
+static struct fs_lat_hist *fs_lat_snap = NULL; // scratch for the readers
+static DEFINE_MUTEX(fs_lat_rotate_lock);
+
+struct dentry *fs_lat_debugfs_dir = NULL; // also holds the benchmark files, frontswap_bench.c
+
+static const char *fs_lat_type_name[FS_LAT_TYPE_NUM] = {
+	"store", "load", "cp_read", "cp_write", "cq_drain", "peek"
+};
+
+//
+// ###################### Summing ######################
+//
+
+static void fs_lat_sum(struct fs_lat_hist *sum)
+{
+	int cpu;
+	int type, server, b;
+
+	memset(sum, 0, sizeof(struct fs_lat_hist));
+	for_each_possible_cpu (cpu) {
+		struct fs_lat_hist *hist = per_cpu_ptr(fs_lat_hist, cpu);
+
+		for (type = 0; type < FS_LAT_TYPE_NUM; type++)
+			for (server = 0; server < num_mem_servers; server++)
+				for (b = 0; b < FS_LAT_BUCKETS; b++)
+					sum->bucket[type][server][b] += READ_ONCE(hist->bucket[type][server][b]);
+	}
+}
+
+// The upper bound of the bucket where the per-mille rank falls, in ns.
+u64 fs_lat_percentile(u64 *bucket, u64 count, int per_mille)
+{
+	u64 rank = div_u64(count * per_mille + 999, 1000);
+	u64 seen = 0;
+	int b;
+
+	for (b = 0; b < FS_LAT_BUCKETS; b++) {
+		seen += bucket[b];
+		if (seen >= rank)
+			return 1ULL << b;
+	}
+	return 1ULL << (FS_LAT_BUCKETS - 1);
+}
+
+/**
+ * One line per type and memory server with samples :
+ * 	type server count p50 p99 p999, then the non-empty buckets as <upper bound ns>:<count>
+ */
+static void fs_lat_show_hist(struct seq_file *m, struct fs_lat_hist *hist)
+{
+	int type, server, b;
+	u64 count;
+
+	seq_puts(m, "# type server count p50_ns p99_ns p999_ns buckets(upper_ns:count)\n");
+	for (type = 0; type < FS_LAT_TYPE_NUM; type++) {
+		for (server = 0; server < num_mem_servers; server++) {
+			u64 *bucket = hist->bucket[type][server];
+
+			count = 0;
+			for (b = 0; b < FS_LAT_BUCKETS; b++)
+				count += bucket[b];
+			if (count == 0)
+				continue;
+
+			seq_printf(m, "%s %d %llu %llu %llu %llu", fs_lat_type_name[type], server, count,
+				   fs_lat_percentile(bucket, count, 500), fs_lat_percentile(bucket, count, 990),
+				   fs_lat_percentile(bucket, count, 999));
+			for (b = 0; b < FS_LAT_BUCKETS; b++) {
+				if (bucket[b])
+					seq_printf(m, " %llu:%llu", 1ULL << b, bucket[b]);
+			}
+			seq_putc(m, '\n');
+		}
+	}
+}
+
+//
+// ###################### debugfs ######################
+//
+
+static int fs_lat_current_show(struct seq_file *m, void *v)
+{
+	int type, server, b;
+
+	mutex_lock(&fs_lat_rotate_lock);
+	fs_lat_sum(fs_lat_snap);
+	for (type = 0; type < FS_LAT_TYPE_NUM; type++)
+		for (server = 0; server < num_mem_servers; server++)
+			for (b = 0; b < FS_LAT_BUCKETS; b++)
+				fs_lat_snap->bucket[type][server][b] -= fs_lat_base->bucket[type][server][b];
+	fs_lat_show_hist(m, fs_lat_snap);
+	mutex_unlock(&fs_lat_rotate_lock);
+
+	return 0;
+}
+
+static int fs_lat_last_show(struct seq_file *m, void *v)
+{
+	mutex_lock(&fs_lat_rotate_lock);
+	fs_lat_show_hist(m, fs_lat_last);
+	mutex_unlock(&fs_lat_rotate_lock);
+
+	return 0;
+}
+
+static int fs_lat_current_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, fs_lat_current_show, NULL);
+}
+
+static int fs_lat_last_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, fs_lat_last_show, NULL);
+}
+
+/**
+ * Close the current interval : last = sum - base, base = sum.
+ */
+static ssize_t fs_lat_rotate_write(struct file *file, const char __user *buf, size_t count, loff_t *ppos)
+{
+	int type, server, b;
+
+	mutex_lock(&fs_lat_rotate_lock);
+	fs_lat_sum(fs_lat_snap);
+	for (type = 0; type < FS_LAT_TYPE_NUM; type++) {
+		for (server = 0; server < num_mem_servers; server++) {
+			for (b = 0; b < FS_LAT_BUCKETS; b++) {
+				fs_lat_last->bucket[type][server][b] =
+					fs_lat_snap->bucket[type][server][b] - fs_lat_base->bucket[type][server][b];
+				fs_lat_base->bucket[type][server][b] = fs_lat_snap->bucket[type][server][b];
+			}
+		}
+	}
+	mutex_unlock(&fs_lat_rotate_lock);
+
+	return count;
+}
+
+static const struct file_operations fs_lat_current_fops = {
+	.owner = THIS_MODULE,
+	.open = fs_lat_current_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static const struct file_operations fs_lat_last_fops = {
+	.owner = THIS_MODULE,
+	.open = fs_lat_last_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static const struct file_operations fs_lat_rotate_fops = {
+	.owner = THIS_MODULE,
+	.write = fs_lat_rotate_write,
+};
+
+//
+// ###################### Init and free ######################
+//
+
+/**
+ * Invoked before any swap or control path operation.
+ * The module still works without debugfs, the histograms are only printed at exit then.
+ */
+int init_fs_lat_hist(void)
+{
+	fs_lat_hist = alloc_percpu(struct fs_lat_hist);
+	fs_lat_base = vzalloc(sizeof(struct fs_lat_hist));
+	fs_lat_last = vzalloc(sizeof(struct fs_lat_hist));
+	fs_lat_snap = vzalloc(sizeof(struct fs_lat_hist));
+	if (unlikely(fs_lat_hist == NULL || fs_lat_base == NULL || fs_lat_last == NULL || fs_lat_snap == NULL)) {
+		pr_err("%s, allocate the latency histograms failed.\n", __func__);
+		free_fs_lat_hist();
+		return -ENOMEM;
+	}
+
+	fs_lat_debugfs_dir = debugfs_create_dir("semeru", NULL);
+	if (IS_ERR_OR_NULL(fs_lat_debugfs_dir)) {
+		pr_warn("%s, debugfs isn't available, no latency files.\n", __func__);
+		fs_lat_debugfs_dir = NULL;
+		return 0;
+	}
+	debugfs_create_file("latency", 0444, fs_lat_debugfs_dir, NULL, &fs_lat_current_fops);
+	debugfs_create_file("latency_last", 0444, fs_lat_debugfs_dir, NULL, &fs_lat_last_fops);
+	debugfs_create_file("latency_rotate", 0200, fs_lat_debugfs_dir, NULL, &fs_lat_rotate_fops);
+
+	return 0;
+}
+
+/**
+ * Invoked after the frontswap ops are deregistered and the control path is reset.
+ */
+void free_fs_lat_hist(void)
+{
+	debugfs_remove_recursive(fs_lat_debugfs_dir);
+	fs_lat_debugfs_dir = NULL;
+
+	free_percpu(fs_lat_hist);
+	fs_lat_hist = NULL;
+	vfree(fs_lat_base);
+	fs_lat_base = NULL;
+	vfree(fs_lat_last);
+	fs_lat_last = NULL;
+	vfree(fs_lat_snap);
+	fs_lat_snap = NULL;
+}
+
+void fs_lat_print_stats(void)
+{
+	int type, server;
+	u64 count;
+	int b;
+
+	if (fs_lat_hist == NULL)
+		return;
+
+	mutex_lock(&fs_lat_rotate_lock);
+	fs_lat_sum(fs_lat_snap);
+	for (type = 0; type < FS_LAT_TYPE_NUM; type++) {
+		for (server = 0; server < num_mem_servers; server++) {
+			u64 *bucket = fs_lat_snap->bucket[type][server];
+
+			count = 0;
+			for (b = 0; b < FS_LAT_BUCKETS; b++)
+				count += bucket[b];
+			if (count == 0)
+				continue;
+
+			pr_warn("%s, %s memory server[%d] %llu samples, p50 %llu ns, p99 %llu ns, p999 %llu ns\n", __func__,
+				fs_lat_type_name[type], server, count, fs_lat_percentile(bucket, count, 500),
+				fs_lat_percentile(bucket, count, 990), fs_lat_percentile(bucket, count, 999));
+		}
+	}
+	mutex_unlock(&fs_lat_rotate_lock);
+}
+
+#endif // end of SEMERU_FS_LATENCY_HIST
@@ -0,0 +1,330 @@
+/**
+ * TCP transport of the frontswap and control paths.
+ *
+ * For the development and the CI machines without an HCA, module parameter tcp_transport=1.
+ * The memory server JVM listens on its RDMA port + SEMERU_TCP_PORT_OFFSET, -XX:+SemeruTCPTransport.
+ * Each served address window has its own connections, to the memory server JVM of the window.
+ *
+ * Each request is a struct semeru_tcp_req, followed by the data of a SEMERU_TCP_WRITE.
+ * The memory server replies a struct semeru_tcp_resp after the data is in its memory,
+ * followed by the data of a SEMERU_TCP_READ. The same semantics as the acked RDMA read/write:
+ * 1) a store is in the memory server's memory when it returns,
+ * 2) the control path transfers are done in order, before a later signal.
+ *
+ * The address of a request is the memory server's virtual address, the data Regions are translated by their placement.
+ * The messages of the memory servers are still 2-sided RDMA, e.g. over soft-RoCE (rxe) on the same NIC.
+ * The numbers aren't comparable with the HCA, only their trend is.
+ *
+ */
+
+#include "frontswap_path.h"
+#include "semeru_cpu.h"
+
+#include <linux/highmem.h>
+#include <linux/inet.h>
+#include <linux/mutex.h>
+#include <linux/net.h>
+#include <linux/tcp.h>
+#include <linux/uio.h>
+#include <net/sock.h>
+
+#ifdef SEMERU_TRANSPORT_TCP
+
+//
+// ###################### Global variables ######################
+//
+
+struct fs_tcp_conn {
+	struct mutex lock; // one request at a time on the socket
+	struct socket *sock; // NULL if broken
+};
+
+// Indexed the same as the sessions, see fs_session().
+static struct fs_tcp_conn fs_tcp_conns[SEMERU_MAX_ADDRESS_WINDOWS * MAX_NUM_OF_MEMORY_SERVER][FS_TCP_CONN_NUM];
+
+// profiling
+static atomic_long_t fs_tcp_stores;
+static atomic_long_t fs_tcp_loads;
+static atomic_long_t fs_tcp_cp_bytes;
+static atomic_long_t fs_tcp_errors;
+
+//
+// ###################### Socket I/O ######################
+//
+
+/**
+ * Send or receive the whole buffer.
+ * user : buf is a user address, the caller runs in the user's context.
+ */
+static int fs_tcp_xfer(struct socket *sock, void *buf, size_t len, bool send, bool user)
+{
+	struct msghdr msg = { .msg_flags = send ? MSG_NOSIGNAL : MSG_WAITALL };
+	struct iovec iov = { .iov_base = buf, .iov_len = len };
+	struct kvec kv = { .iov_base = buf, .iov_len = len };
+	int ret;
+
+	if (user)
+		iov_iter_init(&msg.msg_iter, send ? WRITE : READ, &iov, 1, len);
+	else
+		iov_iter_kvec(&msg.msg_iter, (send ? WRITE : READ) | ITER_KVEC, &kv, 1, len);
+
+	while (msg_data_left(&msg)) {
+		ret = send ? sock_sendmsg(sock, &msg) : sock_recvmsg(sock, &msg, MSG_WAITALL);
+		if (ret <= 0)
+			return ret == 0 ? -ECONNRESET : ret;
+	}
+	return 0;
+}
+
+/**
+ * One request on a connection of mem_server_id, in the address window.
+ * A socket that fails is closed, its requests fail until the module is reloaded.
+ */
+static int fs_tcp_request(int window, int mem_server_id, uint32_t op, uint64_t remote_addr, void *buf, size_t len,
+			  bool user)
+{
+	struct fs_tcp_conn *conn =
+		&fs_tcp_conns[window * num_mem_servers + mem_server_id][raw_smp_processor_id() % FS_TCP_CONN_NUM];
+	struct semeru_tcp_req req = { .magic = SEMERU_TCP_MAGIC, .op = op, .addr = remote_addr, .len = len };
+	struct semeru_tcp_resp resp;
+	int ret = -ENOTCONN;
+
+	mutex_lock(&conn->lock);
+	if (unlikely(conn->sock == NULL))
+		goto out;
+
+	ret = fs_tcp_xfer(conn->sock, &req, sizeof(req), true, false);
+	if (ret == 0 && op == SEMERU_TCP_WRITE)
+		ret = fs_tcp_xfer(conn->sock, buf, len, true, user);
+	if (ret == 0)
+		ret = fs_tcp_xfer(conn->sock, &resp, sizeof(resp), false, false);
+	if (ret == 0 && (resp.magic != SEMERU_TCP_MAGIC || resp.status != 0)) {
+		pr_err("%s, memory server[%d] rejected op %u at 0x%llx, len 0x%lx, status %d\n", __func__, mem_server_id, op,
+		       remote_addr, len, resp.status);
+		ret = -EIO;
+		goto out; // the stream is still in sync, no data follows a rejected request.
+	}
+	if (ret == 0 && op == SEMERU_TCP_READ)
+		ret = fs_tcp_xfer(conn->sock, buf, len, false, user);
+
+	if (unlikely(ret)) {
+		pr_err("%s, connection to memory server[%d] is broken, %d\n", __func__, mem_server_id, ret);
+		sock_release(conn->sock);
+		conn->sock = NULL;
+	}
+
+out:
+	mutex_unlock(&conn->lock);
+	if (unlikely(ret))
+		atomic_long_inc(&fs_tcp_errors);
+	return ret;
+}
+
+// The memory server's address of a data page, the same as the RDMA remote_addr.
+// The memory server JVM of the window maps its space at the same address as the CPU server.
+static inline uint64_t fs_tcp_remote_addr(struct mem_server_addr *mem_addr)
+{
+	return semeru_meta_start(mem_addr->window) + (mem_addr->mem_server_chunk_index << CHUNK_SHIFT) +
+	       mem_addr->mem_server_offset_within_chunk;
+}
+
+static int fs_tcp_store(struct mem_server_addr *mem_addr, struct page *page)
+{
+	void *vaddr = kmap(page);
+	int ret = fs_tcp_request(mem_addr->window, mem_addr->mem_server_id, SEMERU_TCP_WRITE, fs_tcp_remote_addr(mem_addr), vaddr,
+				 PAGE_SIZE, false);
+
+	kunmap(page);
+	atomic_long_inc(&fs_tcp_stores);
+	return ret;
+}
+
+static int fs_tcp_load(struct mem_server_addr *mem_addr, struct page *page)
+{
+	void *vaddr = kmap(page);
+	int ret = fs_tcp_request(mem_addr->window, mem_addr->mem_server_id, SEMERU_TCP_READ, fs_tcp_remote_addr(mem_addr), vaddr,
+				 PAGE_SIZE, false);
+
+	kunmap(page);
+	atomic_long_inc(&fs_tcp_loads);
+	return ret;
+}
+
+/**
+ * [addr, addr + size) of the CPU server, the meta Region or the data Regions placed on mem_server_id,
+ * of one address window.
+ */
+static int fs_tcp_cp_copy(int mem_server_id, char __user *addr, unsigned long size, uint32_t op)
+{
+	struct mem_server_addr mem_addr;
+	size_t start, end, len;
+	long offset;
+	int window = semeru_meta_window_of((unsigned long)addr, size);
+	int ret;
+
+	if (window >= 0) {
+		ret = fs_tcp_request(window, mem_server_id, op, (uint64_t)addr, addr, size, true);
+		goto out;
+	}
+
+	offset = semeru_data_offset_of((unsigned long)addr, size);
+	if (offset < 0)
+		return -ENOENT;
+	start = (size_t)offset;
+	end = start + size;
+	for (len = start & ~CHUNK_MASK; len < end; len += ((size_t)1 << CHUNK_SHIFT)) {
+		translate_data_addr_to_mem_server_addr(&mem_addr, len);
+		if (mem_addr.mem_server_id != mem_server_id)
+			return -ENOENT;
+	}
+
+#ifdef SEMERU_FS_ZERO_PAGE
+	if (op == SEMERU_TCP_WRITE)
+		fs_zero_forget_range(start >> PAGE_SHIFT, (end + PAGE_SIZE - 1) >> PAGE_SHIFT);
+#endif
+#ifdef SEMERU_FS_INVALIDATE
+	if (op == SEMERU_TCP_WRITE)
+		fs_invalidate_revive(mem_server_id, start >> PAGE_SHIFT, (end + PAGE_SIZE - 1) >> PAGE_SHIFT);
+#endif
+#ifdef SEMERU_CHUNK_MIGRATION
+	if (op == SEMERU_TCP_WRITE)
+		fs_migrate_rewrite(start, end);
+#endif
+
+	ret = 0;
+	while (ret == 0 && start < end) {
+		translate_data_addr_to_mem_server_addr(&mem_addr, start);
+		len = min_t(size_t, end - start, ((size_t)1 << CHUNK_SHIFT) - mem_addr.mem_server_offset_within_chunk);
+		ret = fs_tcp_request(mem_addr.window, mem_server_id, op, fs_tcp_remote_addr(&mem_addr), addr, len, true);
+		start += len;
+		addr += len;
+	}
+
+out:
+	if (ret == 0)
+		atomic_long_add(size, &fs_tcp_cp_bytes);
+	return ret;
+}
+
+static int fs_tcp_cp_read(int mem_server_id, char __user *addr, unsigned long size)
+{
+	return fs_tcp_cp_copy(mem_server_id, addr, size, SEMERU_TCP_READ);
+}
+
+static int fs_tcp_cp_write(int mem_server_id, char __user *addr, unsigned long size)
+{
+	return fs_tcp_cp_copy(mem_server_id, addr, size, SEMERU_TCP_WRITE);
+}
+
+static const struct semeru_transport fs_tcp_transport = {
+	.name = "tcp",
+	.store = fs_tcp_store,
+	.load = fs_tcp_load,
+	.cp_read = fs_tcp_cp_read,
+	.cp_write = fs_tcp_cp_write,
+};
+
+//
+// ###################### Initialization ######################
+//
+
+static int fs_tcp_connect(int window, int mem_server_id, struct socket **sockp)
+{
+	struct sockaddr_in addr;
+	struct socket *sock;
+	int one = 1;
+	int ret;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(mem_server_port + window + SEMERU_TCP_PORT_OFFSET);
+	if (!in4_pton(mem_server_ip[mem_server_id], -1, (u8 *)&addr.sin_addr.s_addr, '\0', NULL))
+		return -EINVAL;
+
+	ret = sock_create_kern(&init_net, AF_INET, SOCK_STREAM, IPPROTO_TCP, &sock);
+	if (ret)
+		return ret;
+
+	ret = kernel_connect(sock, (struct sockaddr *)&addr, sizeof(addr), 0);
+	if (ret) {
+		sock_release(sock);
+		return ret;
+	}
+
+	// A page per request, don't wait for more.
+	kernel_setsockopt(sock, SOL_TCP, TCP_NODELAY, (char *)&one, sizeof(one));
+	*sockp = sock;
+	return 0;
+}
+
+/**
+ * Connect to each memory server of each served address window, if tcp_transport is set.
+ * Otherwise the swap and control paths stay on RDMA.
+ */
+int init_fs_tcp(void)
+{
+	int i, j;
+	int window, id;
+	int ret;
+
+	atomic_long_set(&fs_tcp_stores, 0);
+	atomic_long_set(&fs_tcp_loads, 0);
+	atomic_long_set(&fs_tcp_cp_bytes, 0);
+	atomic_long_set(&fs_tcp_errors, 0);
+
+	if (!tcp_transport)
+		return 0;
+
+	if (semeru_transport != NULL) {
+		pr_err("%s, tcp_transport and the %s transport are both given.\n", __func__, semeru_transport->name);
+		return -EINVAL;
+	}
+
+	for (i = 0; i < fs_num_sessions(); i++) {
+		window = i / (int)num_mem_servers;
+		id = i % (int)num_mem_servers;
+		for (j = 0; j < FS_TCP_CONN_NUM; j++) {
+			mutex_init(&fs_tcp_conns[i][j].lock);
+			ret = fs_tcp_connect(window, id, &fs_tcp_conns[i][j].sock);
+			if (ret) {
+				pr_err("%s, connect to window[%d] memory server[%d] %s:%u failed, %d\n", __func__, window, id,
+				       mem_server_ip[id], mem_server_port + window + SEMERU_TCP_PORT_OFFSET, ret);
+				free_fs_tcp();
+				return ret;
+			}
+		}
+		pr_info("%s, window[%d] memory server[%d] data and control path over %d TCP connections\n", __func__,
+			window, id, FS_TCP_CONN_NUM);
+	}
+
+	semeru_transport = &fs_tcp_transport;
+	return 0;
+}
+
+void free_fs_tcp(void)
+{
+	int i, j;
+
+	if (semeru_transport == &fs_tcp_transport)
+		semeru_transport = NULL;
+
+	for (i = 0; i < SEMERU_MAX_ADDRESS_WINDOWS * MAX_NUM_OF_MEMORY_SERVER; i++) {
+		for (j = 0; j < FS_TCP_CONN_NUM; j++) {
+			if (fs_tcp_conns[i][j].sock != NULL)
+				sock_release(fs_tcp_conns[i][j].sock);
+			fs_tcp_conns[i][j].sock = NULL;
+		}
+	}
+}
+
+void fs_tcp_print_stats(void)
+{
+	if (!tcp_transport)
+		return;
+
+	pr_warn("%s, TCP stores %ld, loads %ld, control path 0x%lx bytes, errors %ld\n", __func__,
+		atomic_long_read(&fs_tcp_stores), atomic_long_read(&fs_tcp_loads), atomic_long_read(&fs_tcp_cp_bytes),
+		atomic_long_read(&fs_tcp_errors));
+}
+
+#endif // SEMERU_TRANSPORT_TCP
@@ -0,0 +1,228 @@
+/**
+ * Trace of the swap-ins and swap-outs, for the offline evaluation of the prefetch and eviction policies.
+ *
+ * Each successful semeru_frontswap_load/store appends a struct fs_trace_record to the ring of its core :
+ * 	the end time, the user virtual address, the latency, how it was served and the memory server.
+ * No lock and no shared cache line, the core writes its own ring with its interrupts off.
+ * A full ring drops the new records and counts them, the records already in it are never overwritten.
+ *
+ * The single reader of /dev/semeru_trace drains the rings of all the cores, core by core.
+ * The records of different cores are not in time order, the user tool sorts them :
+ * 	semeru_replay record > app.trace
+ * 	semeru_replay replay app.trace cache_mb=256 evict=lru prefetch=seq window=8
+ *
+ * Enabled by the module parameter trace_entries, the records per core. 24 bytes each.
+ */
+
+#include "frontswap_path.h"
+#include "semeru_cpu.h"
+
+#include <linux/miscdevice.h>
+#include <linux/percpu.h>
+#include <linux/sched/signal.h>
+
+#ifdef SEMERU_FS_TRACE
+
+#define FS_TRACE_POLL_MS	10 // an empty read sleeps, the producers don't wake it up
+
+//
+// ###################### Global variables ######################
+//
+
+struct fs_trace_ring __percpu *fs_trace_rings = NULL;
+static atomic_t fs_trace_opened = ATOMIC_INIT(0);
+static bool fs_trace_registered = false;
+
+//
+// ###################### The producers ######################
+//
+
+void fs_trace_append(int type, int mem_server_id, size_t vaddr, u64 start_ns)
+{
+	struct fs_trace_ring *ring;
+	struct fs_trace_record *rec;
+	unsigned long flags;
+	u64 now = ktime_get_ns();
+	u64 head;
+
+	local_irq_save(flags);
+	ring = this_cpu_ptr(fs_trace_rings);
+	head = ring->head;
+	if (unlikely(head - READ_ONCE(ring->tail) >= trace_entries)) {
+		ring->dropped++;
+		local_irq_restore(flags);
+		return;
+	}
+
+	rec = &ring->records[head % trace_entries];
+	rec->ns = now;
+	rec->vaddr = vaddr;
+	rec->latency_ns = (u32)min_t(u64, now - start_ns, U32_MAX);
+	rec->type = (u8)type;
+	rec->mem_server_id = (u8)mem_server_id;
+	rec->cpu = (u16)smp_processor_id();
+	// The record is written before the reader sees it.
+	smp_store_release(&ring->head, head + 1);
+	local_irq_restore(flags);
+}
+
+//
+// ###################### The device ######################
+//
+
+static int fs_trace_open(struct inode *inode, struct file *file)
+{
+	if (atomic_cmpxchg(&fs_trace_opened, 0, 1) != 0)
+		return -EBUSY;
+	return nonseekable_open(inode, file);
+}
+
+static int fs_trace_release(struct inode *inode, struct file *file)
+{
+	atomic_set(&fs_trace_opened, 0);
+	return 0;
+}
+
+// Copy the whole records of the ring to buf, return the bytes copied or -EFAULT.
+static ssize_t fs_trace_drain_ring(struct fs_trace_ring *ring, char __user *buf, size_t count)
+{
+	u64 tail = ring->tail;
+	u64 head = smp_load_acquire(&ring->head);
+	u64 n = min_t(u64, head - tail, count / sizeof(struct fs_trace_record));
+	u64 copied = 0;
+	u64 len;
+
+	while (copied < n) {
+		// up to the end of the array
+		len = min_t(u64, n - copied, trace_entries - (tail + copied) % trace_entries);
+		if (copy_to_user(buf + copied * sizeof(struct fs_trace_record),
+				 &ring->records[(tail + copied) % trace_entries], len * sizeof(struct fs_trace_record)))
+			return -EFAULT;
+		copied += len;
+	}
+
+	// The records are copied before the producer reuses their slots.
+	smp_store_release(&ring->tail, tail + n);
+	return n * sizeof(struct fs_trace_record);
+}
+
+/**
+ * Return the whole records ready on all the cores, at least one.
+ * An empty read sleeps until records arrive, or returns -EAGAIN with O_NONBLOCK.
+ */
+static ssize_t fs_trace_read(struct file *file, char __user *buf, size_t count, loff_t *ppos)
+{
+	ssize_t done = 0;
+	ssize_t ret;
+	int cpu;
+
+	if (count < sizeof(struct fs_trace_record))
+		return -EINVAL;
+
+	while (true) {
+		for_each_possible_cpu (cpu) {
+			ret = fs_trace_drain_ring(per_cpu_ptr(fs_trace_rings, cpu), buf + done, count - done);
+			if (unlikely(ret < 0))
+				return done ? done : ret;
+			done += ret;
+		}
+		if (done > 0)
+			return done;
+
+		if (file->f_flags & O_NONBLOCK)
+			return -EAGAIN;
+		if (schedule_timeout_interruptible(msecs_to_jiffies(FS_TRACE_POLL_MS)) || signal_pending(current))
+			return -ERESTARTSYS;
+	}
+}
+
+static const struct file_operations fs_trace_fops = {
+	.owner = THIS_MODULE,
+	.open = fs_trace_open,
+	.release = fs_trace_release,
+	.read = fs_trace_read,
+	.llseek = no_llseek,
+};
+
+static struct miscdevice fs_trace_dev = {
+	.minor = MISC_DYNAMIC_MINOR,
+	.name = "semeru_trace",
+	.fops = &fs_trace_fops,
+	.mode = 0400,
+};
+
+//
+// ###################### Initialization ######################
+//
+
+/**
+ * Invoked before the frontswap ops are registered.
+ * Without trace_entries, nothing is allocated and fs_trace_record() stays a single check.
+ */
+int init_fs_trace(void)
+{
+	struct fs_trace_ring *ring;
+	int cpu;
+	int ret;
+
+	if (trace_entries == 0)
+		return 0;
+
+	fs_trace_rings = alloc_percpu(struct fs_trace_ring);
+	if (unlikely(fs_trace_rings == NULL))
+		goto err;
+	for_each_possible_cpu (cpu) {
+		ring = per_cpu_ptr(fs_trace_rings, cpu);
+		ring->records = vmalloc_node((size_t)trace_entries * sizeof(struct fs_trace_record), cpu_to_node(cpu));
+		if (unlikely(ring->records == NULL))
+			goto err;
+	}
+
+	ret = misc_register(&fs_trace_dev);
+	if (unlikely(ret)) {
+		pr_err("%s, register /dev/%s failed %d.\n", __func__, fs_trace_dev.name, ret);
+		free_fs_trace();
+		return ret;
+	}
+	fs_trace_registered = true;
+
+	pr_info("%s, %u records per core, %lu KB in total.\n", __func__, trace_entries,
+		(size_t)trace_entries * sizeof(struct fs_trace_record) * num_possible_cpus() >> 10);
+	return 0;
+
+err:
+	pr_err("%s, allocate the trace rings failed.\n", __func__);
+	free_fs_trace();
+	return -ENOMEM;
+}
+
+/**
+ * Invoked after the frontswap ops are deregistered, no producer is left.
+ */
+void free_fs_trace(void)
+{
+	struct fs_trace_ring *ring;
+	u64 dropped = 0;
+	int cpu;
+
+	if (fs_trace_registered) {
+		misc_deregister(&fs_trace_dev);
+		fs_trace_registered = false;
+	}
+
+	if (fs_trace_rings == NULL)
+		return;
+	for_each_possible_cpu (cpu) {
+		ring = per_cpu_ptr(fs_trace_rings, cpu);
+		dropped += ring->dropped;
+		vfree(ring->records);
+	}
+	free_percpu(fs_trace_rings);
+	fs_trace_rings = NULL;
+
+	if (dropped)
+		pr_warn("%s, %llu records dropped, the rings were full. Read faster or raise trace_entries.\n", __func__,
+			dropped);
+}
+
+#endif // SEMERU_FS_TRACE
@@ -0,0 +1,165 @@
+/**
+ * Zero page elision of the frontswap path.
+ *
+ * The Java heap swaps out lots of zero pages, e.g. the freed and cleared Regions and the fresh eden.
+ * One bit per data page records that the memory server's copy of the page is all zero.
+ *
+ * 1) A frontswap store of a zero page whose bit is set issues no RDMA write.
+ * 	The first zero store of a page is still written, and sets the bit after it.
+ * 2) A frontswap load of a page whose bit is set is zero filled locally.
+ * 3) Any other write to the memory server's copy clears the bit first: a non-zero store,
+ * 	a control path write of the data space, and the memory server's own compaction of the Region.
+ *
+ * The memory servers trace and compact the swapped out pages, so a page is only elided
+ * when their copy already matches it. Only the zero pages are elided, the other same-filled
+ * pages would need their fill value per page and are rare in the Java heap.
+ *
+ */
+
+#include "frontswap_path.h"
+#include "semeru_cpu.h"
+
+#include <linux/bitmap.h>
+#include <linux/highmem.h>
+#include <linux/vmalloc.h>
+
+#ifdef SEMERU_FS_ZERO_PAGE
+
+//
+// ###################### Global variables ######################
+//
+
+static unsigned long *fs_zero_map = NULL; // 1 bit per data page
+static size_t fs_zero_map_pages; // number of bits
+
+// profiling
+static atomic_long_t fs_zero_written; // zero pages written, their bit is set after
+static atomic_long_t fs_zero_elided; // zero stores without RDMA
+static atomic_long_t fs_zero_loads; // loads zero filled locally
+static atomic_long_t fs_zero_forgot; // bits cleared by the other writes
+
+/**
+ * memchr_inv() compares a word per iteration, the kernel code can't use the vector registers.
+ */
+static inline bool fs_is_zero_page(struct page *page)
+{
+	void *addr = kmap_atomic(page);
+	bool zero = memchr_inv(addr, 0, PAGE_SIZE) == NULL;
+
+	kunmap_atomic(addr);
+	return zero;
+}
+
+/**
+ * Invoked before the page is written to the memory server.
+ *
+ * return :
+ * 	FS_ZERO_ELIDED, the memory server has the zero page already, skip the write.
+ * 	FS_ZERO_WRITE, a zero page to write, call fs_zero_store_done() after the write is posted.
+ * 	FS_ZERO_NONE, not a zero page, or the elision is disabled.
+ */
+int fs_zero_store(size_t data_page, struct page *page)
+{
+	if (fs_zero_map == NULL || unlikely(data_page >= fs_zero_map_pages))
+		return FS_ZERO_NONE;
+
+	if (fs_is_zero_page(page)) {
+		if (test_bit(data_page, fs_zero_map)) {
+			atomic_long_inc(&fs_zero_elided);
+			return FS_ZERO_ELIDED;
+		}
+		return FS_ZERO_WRITE;
+	}
+
+	// The memory server's copy is going to be overwritten by non-zero data.
+	if (test_bit(data_page, fs_zero_map))
+		clear_bit(data_page, fs_zero_map);
+	return FS_ZERO_NONE;
+}
+
+/**
+ * The zero page is posted, or written, to the memory server.
+ * A failed asynchronous write clears the bit again, fs_zero_forget_range().
+ */
+void fs_zero_store_done(size_t data_page)
+{
+	set_bit(data_page, fs_zero_map);
+	atomic_long_inc(&fs_zero_written);
+}
+
+/**
+ * return :
+ * 	0, the page is zero filled, no need to read it.
+ * 	-1, read it from the memory server.
+ */
+int fs_zero_load(size_t data_page, struct page *page)
+{
+	if (fs_zero_map == NULL || unlikely(data_page >= fs_zero_map_pages) || !test_bit(data_page, fs_zero_map))
+		return -1;
+
+	clear_highpage(page);
+	atomic_long_inc(&fs_zero_loads);
+	return 0;
+}
+
+/**
+ * The memory server's copy of the data pages [start_page, end_page) is written by others.
+ * The bits are cleared one by one, atomic against the concurrent stores of the neighbour pages.
+ */
+void fs_zero_forget_range(size_t start_page, size_t end_page)
+{
+	size_t bit;
+
+	if (fs_zero_map == NULL)
+		return;
+
+	end_page = min(end_page, fs_zero_map_pages);
+	for (bit = find_next_bit(fs_zero_map, end_page, start_page); bit < end_page;
+	     bit = find_next_bit(fs_zero_map, end_page, bit + 1)) {
+		clear_bit(bit, fs_zero_map);
+		atomic_long_inc(&fs_zero_forgot);
+	}
+}
+
+//
+// ###################### Init and free ######################
+//
+
+int init_fs_zero_map(void)
+{
+	fs_zero_map_pages = semeru_data_space_size() >> PAGE_SHIFT;
+	fs_zero_map = vzalloc(BITS_TO_LONGS(fs_zero_map_pages) * sizeof(unsigned long));
+	if (unlikely(fs_zero_map == NULL)) {
+		pr_err("%s, allocate the zero page map of 0x%lx pages failed.\n", __func__, fs_zero_map_pages);
+		return -ENOMEM;
+	}
+
+	atomic_long_set(&fs_zero_written, 0);
+	atomic_long_set(&fs_zero_elided, 0);
+	atomic_long_set(&fs_zero_loads, 0);
+	atomic_long_set(&fs_zero_forgot, 0);
+
+	pr_info("%s, zero page map of 0x%lx pages\n", __func__, fs_zero_map_pages);
+	return 0;
+}
+
+/**
+ * Invoked after the frontswap ops are deregistered, no more stores or loads.
+ */
+void free_fs_zero_map(void)
+{
+	vfree(fs_zero_map);
+	fs_zero_map = NULL;
+}
+
+void fs_zero_print_stats(void)
+{
+	if (fs_zero_map == NULL)
+		return;
+
+	pr_warn("%s, zero pages written %ld, elided %ld, loaded locally %ld, forgot %ld\n", __func__,
+		atomic_long_read(&fs_zero_written), atomic_long_read(&fs_zero_elided),
+		atomic_long_read(&fs_zero_loads), atomic_long_read(&fs_zero_forgot));
+}
+
+#endif // end of SEMERU_FS_ZERO_PAGE
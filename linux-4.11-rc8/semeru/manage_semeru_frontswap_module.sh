@@ -11,6 +11,13 @@
 #SWAP_PARTITION_SIZE="48"
 SWAP_PARTITION_SIZE="32"
 
+# Memory server topology, passed to the module.
+# The number of memory servers has to divide the data Regions, RDMA_DATA_REGION_NUM.
+NUM_MEM_SERVERS="1"
+MEM_SERVER_IP="10.0.0.4"   # comma separated, one per memory server
+PLACEMENT_POLICY="0"       # data Region placement, 0 range, 1 interleave, 2 load-aware
+REPLICA_MODE="0"           # swapped out pages, 0 single copy, 1 mirrored to the next memory server
+
 
 # Do NOT use sudo.
 if [ -z ${HOME} ]
@@ -140,7 +147,7 @@ then
 
 	# 2. load semeru module 
 	echo "insmod ~/linux-4.11-rc8/semeru/semeru_cpu_server.ko"
-	sudo insmod ./semeru_cpu_server.ko
+	sudo insmod ./semeru_cpu_server.ko num_mem_servers=${NUM_MEM_SERVERS} mem_server_ip=${MEM_SERVER_IP} placement_policy=${PLACEMENT_POLICY} replica_mode=${REPLICA_MODE}
 
 elif [ "${action}" = "create_swap_file" ]
 then
@@ -151,7 +158,7 @@ then
 
 	# 1, mound semeru
 	echo "insmod ~/linux-4.11-rc8/semeru/semeru_cpu_server.ko"
-	sudo insmod ./semeru_cpu_server.ko
+	sudo insmod ./semeru_cpu_server.ko num_mem_servers=${NUM_MEM_SERVERS} mem_server_ip=${MEM_SERVER_IP} placement_policy=${PLACEMENT_POLICY} replica_mode=${REPLICA_MODE}
 
 elif [	"${action}" = "close_semeru"	]
 then
@@ -13,6 +13,10 @@
 
 #include "semeru_cpu.h"
 
+// Instantiate the tracepoints of semeru_trace.h, only in this file.
+#define CREATE_TRACE_POINTS
+#include "semeru_trace.h"
+
 
 
 MODULE_AUTHOR("Semeru, Chenxi Wang");
@@ -24,13 +28,210 @@ MODULE_VERSION("1.0");
 
 // ##########  Global variables ##########
 
-atomic_t rdma_read_to_mem_server[NUM_OF_MEMORY_SERVER];
-atomic_t rdma_write_to_mem_server[NUM_OF_MEMORY_SERVER];
+atomic_t rdma_read_to_mem_server[MAX_NUM_OF_MEMORY_SERVER];
+atomic_t rdma_write_to_mem_server[MAX_NUM_OF_MEMORY_SERVER];
 
-//char *mem_server_ip[] = { "10.0.0.2", "10.0.0.14" };
-char *mem_server_ip[] = { "10.0.0.4"};
+// The memory server topology, e.g.
+// insmod semeru_cpu_server.ko num_mem_servers=2 mem_server_ip=10.0.0.2,10.0.0.14
+unsigned int num_mem_servers = NUM_OF_MEMORY_SERVER;
+module_param(num_mem_servers, uint, 0444);
+MODULE_PARM_DESC(num_mem_servers, "Number of memory servers, has to divide RDMA_DATA_REGION_NUM");
+
+size_t data_region_per_mem_server = DATA_REGION_PER_MEM_SERVER;
+
+unsigned int placement_policy = SEMERU_PLACEMENT_RANGE;
+module_param(placement_policy, uint, 0444);
+MODULE_PARM_DESC(placement_policy, "Data Region placement, 0 range, 1 interleave, 2 load-aware");
+
+unsigned int replica_mode = SEMERU_REPLICA_NONE;
+module_param(replica_mode, uint, 0444);
+MODULE_PARM_DESC(replica_mode, "Swapped out pages, 0 single copy, 1 mirrored to the next memory server asynchronously");
+
+unsigned int compress_pool_mb = 0;
+module_param(compress_pool_mb, uint, 0444);
+MODULE_PARM_DESC(compress_pool_mb, "Local pool of the compressed swapped out pages in MB, 0 (default) disables it");
+
+unsigned int mem_server_credit_mb = 256;
+module_param(mem_server_credit_mb, uint, 0444);
+MODULE_PARM_DESC(mem_server_credit_mb, "Unacked swap out bytes per memory server in MB, 0 disables the flow control");
+
+unsigned int cold_report_ms = 0;
+module_param(cold_report_ms, uint, 0444);
+MODULE_PARM_DESC(cold_report_ms, "Hand the data blocks untouched for this long over to the cold tier of the memory servers, 0 disables it");
+
+char *local_swap_file = NULL;
+module_param(local_swap_file, charp, 0444);
+MODULE_PARM_DESC(local_swap_file, "A file or partition on the local NVMe taking the stores of the congested memory servers, unset disables it");
+
+// Traffic classes of the swap and the control path, e.g.
+// insmod semeru_cpu_server.ko cp_isolated_qp=1 dp_tos=160 cp_tos=32
+unsigned int cp_isolated_qp = 0;
+module_param(cp_isolated_qp, uint, 0444);
+MODULE_PARM_DESC(cp_isolated_qp, "1, the swap path of all the cores leaves the control path QP to the GC traffic");
 
+unsigned int dp_tos = 0;
+module_param(dp_tos, uint, 0444);
+MODULE_PARM_DESC(dp_tos, "Type of service of the swap path QPs, mapped to the SL or traffic class. 0 keeps the default");
+
+unsigned int cp_tos = 0;
+module_param(cp_tos, uint, 0444);
+MODULE_PARM_DESC(cp_tos, "Type of service of the control path QP, mapped to the SL or traffic class. 0 keeps the default");
+
+//char *mem_server_ip[] = { "10.0.0.2", "10.0.0.14" };
+char *mem_server_ip[MAX_NUM_OF_MEMORY_SERVER] = { "10.0.0.4"};
+static int num_mem_server_ip = 1;
+module_param_array(mem_server_ip, charp, &num_mem_server_ip, 0444);
+MODULE_PARM_DESC(mem_server_ip, "IPv4 address of each memory server");
+
+// The second port of each memory server, e.g. mem_server_path_ip=10.0.1.4
+// The QPs of the memory server are spread over both ports. Empty, or not given, for a single port.
+char *mem_server_path_ip[MAX_NUM_OF_MEMORY_SERVER];
+static int num_mem_server_path_ip = 0;
+module_param_array(mem_server_path_ip, charp, &num_mem_server_path_ip, 0444);
+MODULE_PARM_DESC(mem_server_path_ip, "IPv4 address of the second port of each memory server, on the same HCA");
+
+// The data Regions of each memory server in a CXL memory pool, e.g. cxl_window=0x2080000000,0x4080000000
+// Each window is mapped by its memory server as -XX:SemeruMemPoolFile.
+// With several address_windows, the memory servers of the first address window come first, then the second's, ...
+unsigned long cxl_window[SEMERU_MAX_ADDRESS_WINDOWS * MAX_NUM_OF_MEMORY_SERVER];
+int num_cxl_window = 0;
+module_param_array(cxl_window, ulong, &num_cxl_window, 0444);
+MODULE_PARM_DESC(cxl_window, "Physical address of the CXL window of each memory server, the swap path uses RDMA if not given");
+
+// 1, the data Regions and the control path copies over TCP, to mem_server_port + 100 + slot of each memory server.
+// For the machines without an HCA. Exclusive with cxl_window.
+unsigned int tcp_transport = 0;
+module_param(tcp_transport, uint, 0444);
+MODULE_PARM_DESC(tcp_transport, "Swap and control path data over TCP instead of RDMA, for development and CI");
+
+// The clean pages swapped in are dropped again without a store, see semeru_swap_keep_slot().
+unsigned int keep_clean_swapin = 0;
+module_param(keep_clean_swapin, uint, 0444);
+MODULE_PARM_DESC(keep_clean_swapin, "1, a page swapped in by a read fault keeps its swap slot, it's evicted without a store until written");
+
+// With the IOMMU translating for the HCA, e.g. dma_bounce_pages=64
+// A load/store copies 4KB through a page mapped at the setup, instead of an IOTLB map and invalidation per page.
+unsigned int dma_bounce_pages = 0;
+module_param(dma_bounce_pages, uint, 0444);
+MODULE_PARM_DESC(dma_bounce_pages, "Persistently mapped bounce pages per swap path QP, 0 maps and unmaps each swapped page");
+
+// The cores reserved for the CQ pollers, e.g. cq_poller_cpu=15,31
+// Isolate them from the scheduler, e.g. isolcpus=15,31, the pollers spin there while any wr is outstanding.
+unsigned int cq_poller_cpu[MAX_CQ_POLLERS];
+int num_cq_poller_cpu = 0;
+module_param_array(cq_poller_cpu, uint, &num_cq_poller_cpu, 0444);
+MODULE_PARM_DESC(cq_poller_cpu, "Cores of the kernel threads polling all the swap path CQs, each caller polls its own CQ if not given");
+
+// The memory servers of the tenant k of a shared machine listen on 9400 + k, -XX:SemeruTenantID=k.
 uint16_t mem_server_port = 9400;
+module_param(mem_server_port, ushort, 0444);
+MODULE_PARM_DESC(mem_server_port, "RDMA listen port of the memory servers");
+
+// The address windows of the Semeru JVMs served by this host, -XX:SemeruAddressWindow, e.g. address_windows=0,3
+// The i-th window has its own RDMA sessions, to the tenant at mem_server_port + i of each memory server.
+static unsigned int address_windows[SEMERU_MAX_ADDRESS_WINDOWS];
+static int num_address_windows;
+module_param_array(address_windows, uint, &num_address_windows, 0444);
+MODULE_PARM_DESC(address_windows, "Address windows of the Semeru JVMs, window w starts at 0x400000000000 + w TB, window 0 by default");
+
+// Emulate a slower fabric per memory server, e.g.
+// echo 20,20 > /sys/module/semeru_cpu_server/parameters/emu_delay_us
+// echo 3000,3000 > /sys/module/semeru_cpu_server/parameters/emu_bw_mbps
+// Changed at runtime, an operation may see the old value of one array and the new value of another.
+unsigned int emu_delay_us[MAX_NUM_OF_MEMORY_SERVER];
+static int num_emu_delay_us = 0;
+module_param_array(emu_delay_us, uint, &num_emu_delay_us, 0644);
+MODULE_PARM_DESC(emu_delay_us, "Latency added to each swap and control path operation of each memory server, 0 adds nothing");
+
+unsigned int emu_jitter_us[MAX_NUM_OF_MEMORY_SERVER];
+static int num_emu_jitter_us = 0;
+module_param_array(emu_jitter_us, uint, &num_emu_jitter_us, 0644);
+MODULE_PARM_DESC(emu_jitter_us, "Uniformly distributed extra latency, [0, emu_jitter_us], of each memory server");
+
+unsigned int emu_bw_mbps[MAX_NUM_OF_MEMORY_SERVER];
+static int num_emu_bw_mbps = 0;
+module_param_array(emu_bw_mbps, uint, &num_emu_bw_mbps, 0644);
+MODULE_PARM_DESC(emu_bw_mbps, "Bandwidth cap of each memory server in MB/s, both directions together, 0 leaves it to the fabric");
+
+unsigned int emu_burst_kb = 256;
+module_param(emu_burst_kb, uint, 0644);
+MODULE_PARM_DESC(emu_burst_kb, "Bytes an idle memory server sends at the full speed before its emu_bw_mbps cap applies, in KB");
+
+// Record the swap-ins and swap-outs into per-core rings, drained by the reader of /dev/semeru_trace.
+unsigned int trace_entries = 0;
+module_param(trace_entries, uint, 0444);
+MODULE_PARM_DESC(trace_entries, "Records in the trace ring of each core, 0 disables the trace");
+
+
+
+// Back to the window 0 only, the default of the kernel without the module.
+static void reset_address_windows(void)
+{
+	unsigned int window;
+
+	WRITE_ONCE(semeru_nr_windows, 1);
+	WRITE_ONCE(semeru_windows[0], 0);
+	for (window = 0; window < SEMERU_MAX_ADDRESS_WINDOWS; window++)
+		WRITE_ONCE(semeru_window_slot[window], window == 0 ? 0 : -1);
+}
+
+/**
+ * Check the memory server topology configured by the module parameters.
+ * The data Regions are split evenly and contiguously to the memory servers.
+ * 
+ * The same split is used by the CPU server JVM and the memory server JVMs, SemeruMemServerNum.
+ * Each address window has the same topology, and the data space of each window is split the same way.
+ */
+static int init_mem_server_topology(void)
+{
+	int i;
+
+	if (num_mem_servers == 0 || num_mem_servers > MAX_NUM_OF_MEMORY_SERVER ||
+	    RDMA_DATA_REGION_NUM % num_mem_servers != 0) {
+		pr_err("%s, num_mem_servers %u has to be in [1, %lu] and divide the %lu data Regions. \n", __func__,
+		       num_mem_servers, MAX_NUM_OF_MEMORY_SERVER, RDMA_DATA_REGION_NUM);
+		return -EINVAL;
+	}
+
+	if (num_mem_server_ip < num_mem_servers) {
+		pr_err("%s, %d mem_server_ip for %u memory servers. \n", __func__, num_mem_server_ip, num_mem_servers);
+		return -EINVAL;
+	}
+
+	if (placement_policy > SEMERU_PLACEMENT_LOAD) {
+		pr_err("%s, unknown placement_policy %u. \n", __func__, placement_policy);
+		return -EINVAL;
+	}
+
+	if (replica_mode > SEMERU_REPLICA_MIRROR || (replica_mode == SEMERU_REPLICA_MIRROR && num_mem_servers < 2)) {
+		pr_err("%s, replica_mode %u is unknown or needs at least 2 memory servers. \n", __func__, replica_mode);
+		return -EINVAL;
+	}
+
+	if (num_address_windows == 0)
+		num_address_windows = 1; // window 0
+	for (i = 0; i < SEMERU_MAX_ADDRESS_WINDOWS; i++)
+		WRITE_ONCE(semeru_window_slot[i], -1);
+	for (i = 0; i < num_address_windows; i++) {
+		if (address_windows[i] >= SEMERU_MAX_ADDRESS_WINDOWS || semeru_window_slot[address_windows[i]] >= 0) {
+			pr_err("%s, address_windows[%d] %u is repeated or not below %lu. \n", __func__, i, address_windows[i],
+			       SEMERU_MAX_ADDRESS_WINDOWS);
+			reset_address_windows();
+			return -EINVAL;
+		}
+		// Before any session is connected, every address check and translation goes through them from now on.
+		WRITE_ONCE(semeru_windows[i], address_windows[i]);
+		WRITE_ONCE(semeru_window_slot[address_windows[i]], i);
+	}
+	WRITE_ONCE(semeru_nr_windows, num_address_windows);
+
+	data_region_per_mem_server = RDMA_DATA_REGION_NUM / num_mem_servers;
+	printk(KERN_INFO "%s, %u memory servers, %lu data Regions per memory server, placement policy %u, replica mode %u, "
+	       "%d address windows from window %u at 0x%lx. \n", __func__, num_mem_servers, data_region_per_mem_server,
+	       placement_policy, replica_mode, num_address_windows, address_windows[0], semeru_meta_start(0));
+
+	return 0;
+}
 
 
 
@@ -40,7 +241,7 @@ uint16_t mem_server_port = 9400;
 void reset_rdma_message_info(void){
 	int mem_server_id;
 
-	for(mem_server_id = 0; mem_server_id < NUM_OF_MEMORY_SERVER; mem_server_id++){
+	for(mem_server_id = 0; mem_server_id < num_mem_servers; mem_server_id++){
 		atomic_set(&rdma_read_to_mem_server[mem_server_id],0);
 		atomic_set(&rdma_write_to_mem_server[mem_server_id],0);
 	}
@@ -59,7 +260,7 @@ void periodically_print_info(const char *message)
 {
 	int mem_server_id;
 
-	for (mem_server_id = 0; mem_server_id < NUM_OF_MEMORY_SERVER; mem_server_id++) {
+	for (mem_server_id = 0; mem_server_id < num_mem_servers; mem_server_id++) {
 		if (atomic_read(&rdma_read_to_mem_server[mem_server_id]) &&
 		    atomic_read(&rdma_read_to_mem_server[mem_server_id]) % PRINT_LIMIT == 0) {
 			pr_warn("%s, Memory server[%d] , read %d , write %d (may overflow)", message, mem_server_id,
@@ -78,11 +279,18 @@ int __init semeru_cpu_init(void){
 
   int ret = 0;
 
+  ret = init_mem_server_topology();
+  if(unlikely(ret))
+    goto out;
+
   #ifdef SEMERU_FRONTSWAP_PATH
 
+    init_data_chunk_placement();
+
     ret = semeru_fs_rdma_client_init();
     if(unlikely(ret)){
       printk(KERN_ERR "%s, semeru_fs_rdma_client_init failed. \n",__func__);
+      reset_address_windows();
       goto out;
     }
 
@@ -105,6 +313,7 @@ void __exit semeru_cpu_exit(void)
 
   #ifdef SEMERU_FRONTSWAP_PATH
     semeru_fs_rdma_client_exit();
+    reset_address_windows();
   #else
     printk(KERN_ERR "%s, TO BE DONE.\n",__func__);
   #endif
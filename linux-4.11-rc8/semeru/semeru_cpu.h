@@ -48,8 +48,78 @@
 // Decelare the ip of each memory servers.
 // !! defined in semeru_cpu.c
 extern char *mem_server_ip[];
+extern char *mem_server_path_ip[];
 extern uint16_t mem_server_port;
 
+// The runtime topology, module parameter num_mem_servers.
+// Each memory server holds data_region_per_mem_server data Regions of a window, picked by placement_policy,
+// each at its own chunk index, see data_chunk_placement.
+extern unsigned int num_mem_servers;
+extern size_t data_region_per_mem_server;
+extern unsigned int placement_policy;
+
+#ifdef SEMERU_FRONTSWAP_PATH
+// Each served address window has its own session to each memory server, window major in rdma_session_global_ptr.
+#define fs_num_sessions()	((int)(semeru_nr_windows * num_mem_servers))
+
+static inline struct rdma_session_context *fs_session(int window, int mem_server_id)
+{
+	return &rdma_session_global_ptr[window * num_mem_servers + mem_server_id];
+}
+#endif
+
+// Replication of the swapped out pages, module parameter replica_mode.
+#define SEMERU_REPLICA_NONE	0 // single copy on the primary memory server.
+#define SEMERU_REPLICA_MIRROR	1 // mirrored to the next memory server asynchronously.
+extern unsigned int replica_mode;
+
+// Bound of the compressed local tier in MB, module parameter compress_pool_mb. 0 disables the tier.
+extern unsigned int compress_pool_mb;
+
+// Unacked swap out bytes per memory server in MB, module parameter mem_server_credit_mb. 0 disables the flow control.
+extern unsigned int mem_server_credit_mb;
+
+// Interval of the cold block reports in ms, module parameter cold_report_ms. 0 disables the cold tier.
+extern unsigned int cold_report_ms;
+
+// The local SSD tier under the memory servers, module parameter local_swap_file. NULL disables it.
+extern char *local_swap_file;
+
+// Separate the swap path from the bulk GC traffic of the control path, see cp_rdma_yield_to_demand_loads().
+// cp_isolated_qp, the swap path doesn't use the control path QP, without SEMERU_CP_MULTI_QP.
+// dp_tos/cp_tos, the type of service of the swap path QPs and the control path QP. 0 keeps the default.
+extern unsigned int cp_isolated_qp;
+extern unsigned int dp_tos;
+extern unsigned int cp_tos;
+
+// Physical address of the CXL window of each memory server, indexed as the sessions, module parameter cxl_window.
+// Not given, the data Regions are accessed by RDMA.
+extern unsigned long cxl_window[];
+extern int num_cxl_window;
+
+// 1, the data Regions and the control path copies go over TCP, module parameter tcp_transport.
+extern unsigned int tcp_transport;
+
+// 1, the read faults of the data space keep the swap slots, module parameter keep_clean_swapin.
+extern unsigned int keep_clean_swapin;
+
+// Bounce pages mapped once per rdma_queue, module parameter dma_bounce_pages. 0 maps each swapped page.
+extern unsigned int dma_bounce_pages;
+
+// The cores of the dedicated CQ pollers, module parameter cq_poller_cpu. Not given, each caller polls its CQ.
+#define MAX_CQ_POLLERS 8
+extern unsigned int cq_poller_cpu[];
+extern int num_cq_poller_cpu;
+
+// Emulation of a slower fabric per memory server, module parameters emu_*. Writable at runtime.
+extern unsigned int emu_delay_us[];
+extern unsigned int emu_jitter_us[];
+extern unsigned int emu_bw_mbps[];
+extern unsigned int emu_burst_kb;
+
+// Records per core of the swap trace, module parameter trace_entries. 0 disables it.
+extern unsigned int trace_entries;
+
 
 
 
@@ -0,0 +1,240 @@
+/**
+ * Static tracepoints of the Semeru swap and control paths.
+ *
+ * Consumed by perf, ftrace and eBPF, e.g.
+ * 	perf record -e 'semeru:*' -a
+ * 	echo 1 > /sys/kernel/debug/tracing/events/semeru/enable
+ *
+ * A disabled tracepoint costs a static branch, they are always compiled in.
+ * The timestamps are the trace clock of the kernel, use the same clock, e.g. perf's -k mono,
+ * to correlate them with the GC logs of the JVM.
+ *
+ * The tracepoints are instantiated in semeru_cpu.c.
+ */
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM semeru
+
+#if !defined(_SEMERU_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _SEMERU_TRACE_H
+
+#include <linux/tracepoint.h>
+
+// The CQ callback a completion is for.
+#ifndef _SEMERU_TRACE_WR_KIND
+#define _SEMERU_TRACE_WR_KIND
+enum semeru_trace_wr_kind {
+	SEMERU_WR_FS_WRITE = 0, // synchronous frontswap store
+	SEMERU_WR_FS_READ, // frontswap load
+	SEMERU_WR_FS_BATCH_WRITE, // asynchronous frontswap store batch
+	SEMERU_WR_FS_PREFETCH, // prefetch read
+	SEMERU_WR_CP_READ, // control path read
+	SEMERU_WR_CP_WRITE // control path write
+};
+#endif
+
+#define show_semeru_wr_kind(kind)                                                                  \
+	__print_symbolic(kind, { SEMERU_WR_FS_WRITE, "fs_write" }, { SEMERU_WR_FS_READ, "fs_read" }, \
+			 { SEMERU_WR_FS_BATCH_WRITE, "fs_batch_write" },                             \
+			 { SEMERU_WR_FS_PREFETCH, "fs_prefetch" }, { SEMERU_WR_CP_READ, "cp_read" },  \
+			 { SEMERU_WR_CP_WRITE, "cp_write" })
+
+//
+// Frontswap store/load
+//
+
+DECLARE_EVENT_CLASS(semeru_fs_swap_enter,
+
+	TP_PROTO(unsigned long swap_entry_offset, int mem_server_id, size_t chunk_index, size_t offset_within_chunk),
+
+	TP_ARGS(swap_entry_offset, mem_server_id, chunk_index, offset_within_chunk),
+
+	TP_STRUCT__entry(
+		__field(unsigned long, swap_entry_offset)
+		__field(int, mem_server_id)
+		__field(size_t, chunk_index)
+		__field(size_t, offset_within_chunk)
+	),
+
+	TP_fast_assign(
+		__entry->swap_entry_offset = swap_entry_offset;
+		__entry->mem_server_id = mem_server_id;
+		__entry->chunk_index = chunk_index;
+		__entry->offset_within_chunk = offset_within_chunk;
+	),
+
+	TP_printk("swp_offset=0x%lx mem_server=%d chunk=%zu offset=0x%zx", __entry->swap_entry_offset,
+		  __entry->mem_server_id, __entry->chunk_index, __entry->offset_within_chunk)
+);
+
+DEFINE_EVENT(semeru_fs_swap_enter, semeru_fs_store_enter,
+	TP_PROTO(unsigned long swap_entry_offset, int mem_server_id, size_t chunk_index, size_t offset_within_chunk),
+	TP_ARGS(swap_entry_offset, mem_server_id, chunk_index, offset_within_chunk)
+);
+
+DEFINE_EVENT(semeru_fs_swap_enter, semeru_fs_load_enter,
+	TP_PROTO(unsigned long swap_entry_offset, int mem_server_id, size_t chunk_index, size_t offset_within_chunk),
+	TP_ARGS(swap_entry_offset, mem_server_id, chunk_index, offset_within_chunk)
+);
+
+DECLARE_EVENT_CLASS(semeru_fs_swap_exit,
+
+	TP_PROTO(unsigned long swap_entry_offset, int mem_server_id, int ret),
+
+	TP_ARGS(swap_entry_offset, mem_server_id, ret),
+
+	TP_STRUCT__entry(
+		__field(unsigned long, swap_entry_offset)
+		__field(int, mem_server_id)
+		__field(int, ret)
+	),
+
+	TP_fast_assign(
+		__entry->swap_entry_offset = swap_entry_offset;
+		__entry->mem_server_id = mem_server_id;
+		__entry->ret = ret;
+	),
+
+	TP_printk("swp_offset=0x%lx mem_server=%d ret=%d", __entry->swap_entry_offset, __entry->mem_server_id,
+		  __entry->ret)
+);
+
+DEFINE_EVENT(semeru_fs_swap_exit, semeru_fs_store_exit,
+	TP_PROTO(unsigned long swap_entry_offset, int mem_server_id, int ret),
+	TP_ARGS(swap_entry_offset, mem_server_id, ret)
+);
+
+DEFINE_EVENT(semeru_fs_swap_exit, semeru_fs_load_exit,
+	TP_PROTO(unsigned long swap_entry_offset, int mem_server_id, int ret),
+	TP_ARGS(swap_entry_offset, mem_server_id, ret)
+);
+
+//
+// RDMA post and completion
+//
+
+TRACE_EVENT(semeru_rdma_post,
+
+	TP_PROTO(int mem_server_id, int q_index, int nr_wr, int outstanding),
+
+	TP_ARGS(mem_server_id, q_index, nr_wr, outstanding),
+
+	TP_STRUCT__entry(
+		__field(int, mem_server_id)
+		__field(int, q_index)
+		__field(int, nr_wr)
+		__field(int, outstanding)
+	),
+
+	TP_fast_assign(
+		__entry->mem_server_id = mem_server_id;
+		__entry->q_index = q_index;
+		__entry->nr_wr = nr_wr;
+		__entry->outstanding = outstanding;
+	),
+
+	TP_printk("mem_server=%d queue=%d nr_wr=%d outstanding=%d", __entry->mem_server_id, __entry->q_index,
+		  __entry->nr_wr, __entry->outstanding)
+);
+
+TRACE_EVENT(semeru_rdma_cqe,
+
+	TP_PROTO(int mem_server_id, int q_index, int kind, int status, unsigned int byte_len),
+
+	TP_ARGS(mem_server_id, q_index, kind, status, byte_len),
+
+	TP_STRUCT__entry(
+		__field(int, mem_server_id)
+		__field(int, q_index)
+		__field(int, kind)
+		__field(int, status)
+		__field(unsigned int, byte_len)
+	),
+
+	TP_fast_assign(
+		__entry->mem_server_id = mem_server_id;
+		__entry->q_index = q_index;
+		__entry->kind = kind;
+		__entry->status = status;
+		__entry->byte_len = byte_len;
+	),
+
+	TP_printk("mem_server=%d queue=%d kind=%s status=%d byte_len=%u", __entry->mem_server_id, __entry->q_index,
+		  show_semeru_wr_kind(__entry->kind), __entry->status, __entry->byte_len)
+);
+
+//
+// Control path
+//
+
+TRACE_EVENT(semeru_cp_transfer,
+
+	TP_PROTO(int mem_server_id, int write, int write_type, unsigned long start_addr, unsigned long size, int ret),
+
+	TP_ARGS(mem_server_id, write, write_type, start_addr, size, ret),
+
+	TP_STRUCT__entry(
+		__field(int, mem_server_id)
+		__field(int, write)
+		__field(int, write_type)
+		__field(unsigned long, start_addr)
+		__field(unsigned long, size)
+		__field(int, ret)
+	),
+
+	TP_fast_assign(
+		__entry->mem_server_id = mem_server_id;
+		__entry->write = write;
+		__entry->write_type = write_type;
+		__entry->start_addr = start_addr;
+		__entry->size = size;
+		__entry->ret = ret;
+	),
+
+	TP_printk("mem_server=%d %s%s start_addr=0x%lx size=0x%lx ret=%d", __entry->mem_server_id,
+		  __entry->write ? "write" : "read", __entry->write_type ? " signal" : "", __entry->start_addr,
+		  __entry->size, __entry->ret)
+);
+
+//
+// Chunk binding
+//
+
+TRACE_EVENT(semeru_chunk_bind,
+
+	TP_PROTO(int mem_server_id, int chunk_index, u64 remote_addr, u32 rkey, u64 mapped_size, int mapped),
+
+	TP_ARGS(mem_server_id, chunk_index, remote_addr, rkey, mapped_size, mapped),
+
+	TP_STRUCT__entry(
+		__field(int, mem_server_id)
+		__field(int, chunk_index)
+		__field(u64, remote_addr)
+		__field(u32, rkey)
+		__field(u64, mapped_size)
+		__field(int, mapped)
+	),
+
+	TP_fast_assign(
+		__entry->mem_server_id = mem_server_id;
+		__entry->chunk_index = chunk_index;
+		__entry->remote_addr = remote_addr;
+		__entry->rkey = rkey;
+		__entry->mapped_size = mapped_size;
+		__entry->mapped = mapped;
+	),
+
+	TP_printk("mem_server=%d chunk=%d %s remote_addr=0x%llx rkey=0x%x size=0x%llx", __entry->mem_server_id,
+		  __entry->chunk_index, __entry->mapped ? "bound" : "released", __entry->remote_addr, __entry->rkey,
+		  __entry->mapped_size)
+);
+
+#endif // _SEMERU_TRACE_H
+
+// Out of the kernel include path, see the CFLAGS_semeru_cpu.o in Makefile.
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE semeru_trace
+
+#include <trace/define_trace.h>